@@ -0,0 +1,71 @@
+// Checks the estimates of $approxCountDistinct and $percentile, and that their partial results
+// from the shards of a sharded collection merge.
+
+load('jstests/aggregation/extras/utils.js');
+
+function checkEstimates(coll, n) {
+    var result = coll.aggregate({ $group: { _id: null,
+                                            distinct: { $approxCountDistinct: "$a" },
+                                            exact: { $addToSet: "$b" },
+                                            exactCount: { $approxCountDistinct: "$b" },
+                                            median: { $percentile: { input: "$v", p: 0.5 } },
+                                            others: { $percentile: { input: "$v",
+                                                                     p: [0, 0.9, 1] } } }
+                                }).toArray()[0];
+
+    assert.lte(Math.abs(result.distinct - n / 2), n / 40, tojson(result));
+    assert.eq(result.exact.length, result.exactCount, tojson(result));
+    assert.lte(Math.abs(result.median - (n - 1) / 2), n / 100, tojson(result));
+    assert.eq(0, result.others[0], tojson(result));
+    assert.lte(Math.abs(result.others[1] - (n - 1) * 0.9), n / 100, tojson(result));
+    assert.eq(n - 1, result.others[2], tojson(result));
+}
+
+function insertData(coll, n) {
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < n; i++) {
+        bulk.insert({ _id: i, a: i % (n / 2), b: i % 100, v: (i * 7919) % n });
+    }
+    assert.writeOK(bulk.execute());
+}
+
+var t = db.jstests_aggregation_approx_accumulators;
+t.drop();
+insertData(t, 20000);
+checkEstimates(t, 20000);
+
+// Strings and documents are counted; only numbers have percentiles.
+t.drop();
+t.insert([{ a: "x", v: "x" }, { a: { y: 1 }, v: 2 }, { a: "x", v: 4 }, { v: null }]);
+var result = t.aggregate({ $group: { _id: null,
+                                     n: { $approxCountDistinct: "$a" },
+                                     p: { $percentile: { input: "$v", p: 0.5 } },
+                                     none: { $percentile: { input: "$a", p: [0.5] } } }
+                         }).toArray()[0];
+assert.eq({ _id: null, n: 2, p: 3, none: null }, result);
+
+// Bad $percentile specifications.
+assertErrorCode(t, { $group: { _id: null, p: { $percentile: "$v" } } }, 28613);
+assertErrorCode(t, { $group: { _id: null, p: { $percentile: { input: "$v", p: 0.5, q: 1 } } } },
+                28614);
+assertErrorCode(t, { $group: { _id: null, p: { $percentile: { p: 0.5 } } } }, 28615);
+assertErrorCode(t, { $group: { _id: null, p: { $percentile: { input: "$v" } } } }, 28616);
+assertErrorCode(t, { $group: { _id: null, p: { $percentile: { input: "$v", p: 2 } } } }, 28616);
+assertErrorCode(t, { $group: { _id: null, p: { $percentile: { input: "$v", p: [] } } } }, 28616);
+assertErrorCode(t, { $group: { _id: null, p: { $percentile: { input: "$v", p: ["$v"] } } } },
+                28616);
+
+// Across shards, the merger combines the shards' sketches.
+var s = new ShardingTest({ name: "approx_accumulators", shards: 2, mongos: 1 });
+s.adminCommand({ enablesharding: "test" });
+s.adminCommand({ shardcollection: "test.data", key: { _id: 1 } });
+s.stopBalancer();
+
+var d = s.getDB("test");
+insertData(d.data, 20000);
+s.adminCommand({ split: "test.data", middle: { _id: 10000 } });
+s.adminCommand({ movechunk: "test.data", find: { _id: 15000 },
+                 to: s.getOther(s.getServer("test")).name });
+checkEstimates(d.data, 20000);
+
+s.stop();
@@ -0,0 +1,51 @@
+// Checks that an aggregation whose dependencies are all in an index reads them from the index
+// keys without fetching any documents, and still gives the right results when it can't.
+
+var t = db.jstests_aggregation_covered_index;
+t.drop();
+
+t.ensureIndex({ a: 1, b: 1 });
+for (var i = 0; i < 100; i++) {
+    t.insert({ a: i % 10, b: i % 3, c: i });
+}
+
+var pipeline = [{ $match: { a: { $gte: 5 } } },
+                { $group: { _id: { a: "$a", b: "$b" }, n: { $sum: 1 } } },
+                { $sort: { _id: 1 } }];
+
+function winningPlan() {
+    var explain = t.runCommand("aggregate", { pipeline: pipeline, explain: true });
+    assert.commandWorked(explain);
+    return tojson(explain.stages[0].$cursor.queryPlanner.winningPlan);
+}
+
+function checkResults() {
+    var results = t.aggregate(pipeline).toArray();
+    assert.eq(15, results.length, tojson(results));
+    var total = 0;
+    results.forEach(function(group) {
+        assert.gte(group._id.a, 5, tojson(group));
+        total += group.n;
+    });
+    assert.eq(50, total, tojson(results));
+}
+
+// Covered: only the index is read.
+var plan = winningPlan();
+assert(/IXSCAN/.test(plan), plan);
+assert(!/FETCH/.test(plan), plan);
+checkResults();
+
+// A field outside the index means the documents have to be fetched.
+var coveredPipeline = pipeline;
+pipeline = [{ $match: { a: { $gte: 5 } } },
+            { $group: { _id: { a: "$a", b: "$b" }, n: { $sum: 1 }, c: { $max: "$c" } } }];
+assert(/FETCH/.test(winningPlan()), winningPlan());
+pipeline = coveredPipeline;
+
+// Once the index is multikey its keys no longer hold the field values.
+t.insert({ a: 7, b: [1, 2], c: 100 });
+plan = winningPlan();
+assert(/FETCH/.test(plan), plan);
+var results = t.aggregate(pipeline).toArray();
+assert.eq(16, results.length, tojson(results));
@@ -0,0 +1,54 @@
+// Checks that a $group on sorted input streams its groups and gives the same results as one
+// which reads everything first, with null, missing and array keys in the mix.
+
+var t = db.jstests_aggregation_group_streaming;
+t.drop();
+
+for (var i = 0; i < 200; i++) {
+    var doc = { b: i % 4, v: i };
+    switch (i % 10) {
+    case 0: break;
+    case 1: doc.a = null; break;
+    case 3: doc.a = [i % 3, 5]; break;
+    default: doc.a = i % 7;
+    }
+    t.insert(doc);
+}
+
+function explainGroup(pipeline) {
+    var explain = t.runCommand("aggregate", { pipeline: pipeline, explain: true });
+    assert.commandWorked(explain);
+    for (var i = 0; i < explain.stages.length; i++) {
+        if (explain.stages[i].$group)
+            return explain.stages[i].$group;
+    }
+    assert(false, tojson(explain));
+}
+
+function checkSameGroups(group, sort) {
+    var sortById = { $sort: { _id: 1 } };
+    var streamed = [{ $sort: sort }, { $group: group }];
+    assert(explainGroup(streamed).$streaming, tojson(streamed));
+
+    var expected = t.aggregate([{ $group: group }, sortById]).toArray();
+    var results = t.aggregate(streamed.concat([sortById])).toArray();
+    assert.eq(expected, results, tojson(streamed));
+}
+
+checkSameGroups({ _id: "$a", n: { $sum: 1 }, max: { $max: "$v" } }, { a: 1 });
+checkSameGroups({ _id: "$a", n: { $sum: 1 } }, { a: -1, b: 1 });
+checkSameGroups({ _id: { b: "$b", a: "$a" }, n: { $sum: 1 } }, { a: 1, b: -1 });
+
+// The sort can be done by an index.
+t.ensureIndex({ a: 1 });
+checkSameGroups({ _id: "$a", n: { $sum: 1 }, max: { $max: "$v" } }, { a: 1 });
+
+// A later $limit only needs the first groups, which are those of the lowest plain values.
+var pipeline = [{ $sort: { a: 1 } }, { $group: { _id: "$a", n: { $sum: 1 } } }];
+var firstGroups = t.aggregate(pipeline).toArray().slice(0, 2);
+assert.eq(0, firstGroups[0]._id, tojson(firstGroups));
+assert.eq(1, firstGroups[1]._id, tojson(firstGroups));
+assert.eq(firstGroups, t.aggregate(pipeline.concat([{ $limit: 2 }])).toArray());
+
+// Not sorted on the _id fields, so not streamed.
+assert(!explainGroup([{ $sort: { b: 1 } }, { $group: { _id: "$a" } }]).$streaming);
@@ -0,0 +1,68 @@
+// Checks that a sharded $group whose shards send their groups in key order is merged correctly,
+// including compound _ids with missing parts, and that the streaming merge can be turned off.
+
+var s = new ShardingTest({ name: "group_streaming_merge", shards: 2, mongos: 1 });
+s.adminCommand({ enablesharding: "test" });
+s.adminCommand({ shardcollection: "test.data", key: { _id: 1 } });
+s.stopBalancer();
+
+var d = s.getDB("test");
+var unsharded = d.unsharded;
+unsharded.drop();
+
+for (var i = 0; i < 1000; i++) {
+    var doc = { _id: i, a: i % 7, v: i };
+    if (i % 5 != 0)
+        doc.b = i % 3;
+    d.data.insert(doc);
+    unsharded.insert(doc);
+}
+
+s.adminCommand({ split: "test.data", middle: { _id: 500 } });
+s.adminCommand({ movechunk: "test.data", find: { _id: 750 },
+                 to: s.getOther(s.getServer("test")).name });
+
+var pipelines = [
+    [{ $group: { _id: "$a", n: { $sum: 1 }, avg: { $avg: "$v" } } }],
+    [{ $group: { _id: { a: "$a", b: "$b" }, n: { $sum: 1 }, vs: { $push: "$v" } } }],
+    [{ $group: { _id: { b: "$b" }, max: { $max: "$v" } } }],
+    [{ $group: { _id: "$v", first: { $first: "$a" } } }],
+];
+
+function checkResults() {
+    pipelines.forEach(function(pipeline) {
+        var sortById = { $sort: { _id: 1 } };
+        var sharded = d.data.aggregate(pipeline.concat([sortById])).toArray();
+        var expected = unsharded.aggregate(pipeline.concat([sortById])).toArray();
+        assert.eq(expected.length, sharded.length, tojson(pipeline));
+        for (var i = 0; i < expected.length; i++) {
+            if (expected[i].vs) {
+                expected[i].vs.sort();
+                sharded[i].vs.sort();
+            }
+            assert.eq(expected[i], sharded[i], tojson(pipeline));
+        }
+    });
+}
+
+function splitPipeline(pipeline) {
+    var explain = d.runCommand({ aggregate: "data", pipeline: pipeline, explain: true });
+    assert.commandWorked(explain);
+    return explain.splitPipeline;
+}
+
+// The shards are asked for sorted output and the merger streams it.
+var split = splitPipeline(pipelines[1]);
+assert(split.shardsPart[0].$group.$sortedOutput, tojson(split));
+assert(split.mergerPart[0].$group.$mergePresorted, tojson(split));
+checkResults();
+
+// Without the parameter the merger regroups everything, with the same results.
+assert.commandWorked(s.s0.adminCommand({ setParameter: 1,
+                                         internalAggregationGroupStreamingMerge: false }));
+split = splitPipeline(pipelines[1]);
+assert(!split.shardsPart[0].$group.$sortedOutput, tojson(split));
+assert(!split.mergerPart[0].$group.$mergePresorted, tojson(split));
+checkResults();
+
+s.stop();
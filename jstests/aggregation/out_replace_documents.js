@@ -0,0 +1,58 @@
+// Checks $out's replaceDocuments mode, which upserts each result into the output collection by
+// its _id instead of replacing the collection, and that large outputs are written in batches.
+
+load('jstests/aggregation/extras/utils.js');
+
+var input = db.jstests_aggregation_out_replace_documents_in;
+var output = db.jstests_aggregation_out_replace_documents_out;
+input.drop();
+output.drop();
+
+for (var i = 0; i < 10; i++) {
+    input.insert({ _id: i, a: i % 3 });
+}
+
+// Documents in the output that aren't in the results are left alone.
+output.insert({ _id: 0, old: true });
+output.insert({ _id: 100, old: true });
+output.ensureIndex({ a: 1 });
+
+var out = { $out: { to: output.getName(), mode: "replaceDocuments" } };
+input.aggregate([{ $group: { _id: "$a", n: { $sum: 1 } } }, out]);
+assert.eq([{ _id: 0, n: 4 }, { _id: 1, n: 3 }, { _id: 2, n: 3 }, { _id: 100, old: true }],
+          output.find().sort({ _id: 1 }).toArray());
+assert.eq(2, output.getIndexes().length);
+
+// Running it again leaves the same documents.
+input.aggregate([{ $group: { _id: "$a", n: { $sum: 1 } } }, out]);
+assert.eq(4, output.count());
+
+// Every result needs an _id to upsert on.
+assertErrorCode(input, [{ $project: { _id: 0, a: 1 } }, out], 28608);
+
+// The spec is checked.
+assertErrorCode(input, [{ $out: { to: 1 } }], 28609);
+assertErrorCode(input, [{ $out: { to: output.getName(), mode: "merge" } }], 28610);
+assertErrorCode(input, [{ $out: { to: output.getName(), foo: 1 } }], 28611);
+assertErrorCode(input, [{ $out: { mode: "replaceDocuments" } }], 28612);
+assertErrorCode(input, [{ $out: 1 }], 16990);
+
+// The object form of the default mode replaces the collection as before.
+input.aggregate([{ $match: { a: 0 } },
+                 { $out: { to: output.getName(), mode: "replaceCollection" } }]);
+assert.eq(4, output.count());
+assert.eq(0, output.count({ old: true }));
+
+// More results than fit in one write command, in either mode.
+input.drop();
+output.drop();
+var bulk = input.initializeUnorderedBulkOp();
+for (var i = 0; i < 2500; i++) {
+    bulk.insert({ _id: i, s: "x" });
+}
+assert.writeOK(bulk.execute());
+
+input.aggregate([{ $project: { s: 1 } }, out]);
+assert.eq(2500, output.count());
+input.aggregate([{ $project: { s: 1 } }, { $out: output.getName() }]);
+assert.eq(2500, output.count());
@@ -0,0 +1,30 @@
+// Checks that an $unwind which leaves out the fields its later stages don't use gives the same
+// results as one which outputs whole documents, as it does before a $redact.
+
+var t = db.jstests_aggregation_unwind_unused_fields;
+t.drop();
+
+for (var i = 0; i < 20; i++) {
+    t.insert({ _id: i, a: [i, i + 1, { b: i }], c: { d: i % 3, e: [1, 2] }, f: i % 2, g: "x" });
+}
+
+var keepAll = { $redact: "$$KEEP" };
+
+function checkSameResults(unwind, laterStages) {
+    var sortById = { $sort: { _id: 1, a: 1, "c.e": 1 } };
+    var expected = t.aggregate([unwind, keepAll].concat(laterStages, [sortById])).toArray();
+    var results = t.aggregate([unwind].concat(laterStages, [sortById])).toArray();
+    assert.eq(expected, results, tojson(laterStages));
+}
+
+checkSameResults({ $unwind: "$a" }, [{ $group: { _id: "$c.d", n: { $sum: "$a" } } }]);
+checkSameResults({ $unwind: "$a" }, [{ $project: { a: 1, f: 1 } }]);
+checkSameResults({ $unwind: "$a" }, [{ $match: { f: 1 } }, { $project: { _id: 0, a: 1 } }]);
+checkSameResults({ $unwind: "$c.e" }, [{ $project: { "c.d": 1, e: "$c.e" } }]);
+checkSameResults({ $unwind: "$a" }, [{ $unwind: "$c.e" }, { $project: { x: "$c.e", a: 1 } }]);
+checkSameResults({ $unwind: "$a" }, [{ $group: { _id: null, n: { $sum: 1 } } }]);
+
+// With nothing after it which lists its needs, $unwind outputs whole documents.
+assert.eq(60, t.aggregate({ $unwind: "$a" }).itcount());
+assert.eq({ _id: 0, a: 0, c: { d: 0, e: [1, 2] }, f: 0, g: "x" },
+          t.aggregate([{ $unwind: "$a" }, { $limit: 1 }]).toArray()[0]);
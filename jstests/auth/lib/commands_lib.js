@@ -307,6 +307,35 @@ var authCommandsLib = {
                 }
             ]
         },
+        {
+            testname: "aggregate_write_replace_documents",
+            command: {aggregate: "foo",
+                      pipeline: [ {$out: {to: "foo_out", mode: "replaceDocuments"}} ] },
+            testcases: [
+                {
+                    runOnDb: firstDbName,
+                    roles: { readWrite: 1,
+                             readWriteAnyDatabase: 1,
+                             dbOwner: 1,
+                             root: 1,
+                             __system: 1},
+                    privileges: [
+                        { resource: {db: firstDbName, collection: "foo"}, actions: ["find"] },
+                        { resource: {db: firstDbName, collection: "foo_out"}, actions: ["insert"] },
+                        { resource: {db: firstDbName, collection: "foo_out"}, actions: ["update"] }
+                    ]
+                },
+                {
+                    runOnDb: secondDbName,
+                    roles: {readWriteAnyDatabase: 1, root: 1, __system: 1},
+                    privileges: [
+                        { resource: {db: secondDbName, collection: "foo"}, actions: ["find"] },
+                        { resource: {db: secondDbName, collection: "foo_out"}, actions: ["insert"] },
+                        { resource: {db: secondDbName, collection: "foo_out"}, actions: ["update"] }
+                    ]
+                }
+            ]
+        },
         {
             testname: "appendOplogNote",
             command: {appendOplogNote: 1, data: {a: 1}},
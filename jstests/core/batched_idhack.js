@@ -0,0 +1,44 @@
+// Queries on a list of _id values use the batched idhack, which returns documents in _id order.
+
+var t = db.batched_idhack;
+t.drop();
+
+// Include helpers for analyzing explain output.
+load("jstests/libs/analyze_plan.js");
+
+// Inserted backwards, so the documents aren't stored in _id order.
+for (var i = 19; i >= 0; i--) {
+    t.insert({ _id: i, a: i % 5 });
+}
+t.insert({ _id: { x: 1 }, a: 100 });
+
+var query = { _id: { $in: [15, 3, 7, 3, 42, { x: 1 }, 11.0] } };
+var results = t.find(query).toArray();
+assert.eq([3, 7, 11, 15, { x: 1 }], results.map(function(doc) { return doc._id; }), "A1");
+
+var explain = t.find(query).explain(true);
+print("explain for " + tojson(query, "", true) + " = " + tojson(explain));
+assert(planHasStage(explain.queryPlanner.winningPlan, "BATCHED_IDHACK"), "B1");
+assert.eq(5, explain.executionStats.nReturned, "B2");
+assert.eq(5, explain.executionStats.totalKeysExamined, "B3");
+assert.eq(5, explain.executionStats.totalDocsExamined, "B4");
+
+// A hard limit and a non-covered projection are applied over it.
+assert.eq([{ _id: 3, a: 3 }, { _id: 7, a: 2 }], t.find(query, { a: 1 }).limit(-2).toArray(), "C1");
+assert.eq([{ a: 3 }], t.find(query, { _id: 0, a: 1 }).limit(-1).toArray(), "C2");
+assert.eq(3, t.find(query).sort({ _id: 1 }).next()._id, "C3");
+
+// Queries which it doesn't support are planned as usual, with the same results.
+var others = [ t.find(query).sort({ _id: -1 }),
+               t.find(query).skip(1),
+               t.find(query).hint({ _id: 1 }),
+               t.find(query, { _id: 1 }),
+               t.find({ _id: { $in: [3, /a/] } }),
+               t.find({ _id: { $in: [3, 7] }, a: 3 }) ];
+others.forEach(function(cursor) {
+    assert(!planHasStage(cursor.explain().queryPlanner.winningPlan, "BATCHED_IDHACK"),
+           tojson(cursor));
+});
+assert.eq(15, t.find(query).sort({ _id: -1 }).next()._id, "D1");
+assert.eq([{ _id: 3 }, { _id: 7 }], t.find({ _id: { $in: [7, 3] } }, { _id: 1 }).toArray(), "D2");
+assert.eq([{ _id: 3, a: 3 }], t.find({ _id: { $in: [3, 7] }, a: 3 }).toArray(), "D3");
@@ -0,0 +1,43 @@
+// Tests that benchRun can issue operations at a fixed rate and reports their latency
+// percentiles, corrected for the operations which were sent late.
+
+t = db.bench_test_paced;
+t.drop();
+
+t.insert( { _id : 1 , x : 0 } )
+
+ops = [
+    { op : "update" , ns : t.getFullName() , query : { _id : 1 } , update : { $inc : { x : 1 } } },
+    { op : "findOne" , ns : t.getFullName() , query : { _id : 1 } }
+]
+
+seconds = 2;
+opsPerSecond = 100;
+
+benchArgs = { ops : ops , parallel : 2 , seconds : seconds , opsPerSecond : opsPerSecond ,
+              host : db.getMongo().host };
+
+if (jsTest.options().auth) {
+    benchArgs['db'] = 'admin';
+    benchArgs['username'] = jsTest.options().adminUser;
+    benchArgs['password'] = jsTest.options().adminPassword;
+}
+res = benchRun( benchArgs );
+
+// Half of the operations are updates, and there are no more of them than the rate allows
+updates = t.findOne( { _id : 1 } ).x;
+assert.lt( 0 , updates , "A1" );
+assert.lte( updates , seconds * opsPerSecond / 2 + 2 , "A2" );
+
+assert( res.updateLatencyMicros , "B1" );
+assert( res.updateCorrectedLatencyMicros , "B2" );
+assert.lte( res.updateLatencyMicros.p50 , res.updateLatencyMicros.p99 , "B3" );
+assert.lte( res.updateLatencyMicros.p99 , res.updateLatencyMicros.p999 , "B4" );
+assert.lte( res.findOneLatencyMicros.p50 , res.findOneCorrectedLatencyMicros.p999 , "B5" );
+
+// Closed loop runs don't report corrected latencies
+delete benchArgs.opsPerSecond;
+benchArgs['seconds'] = 1;
+res = benchRun( benchArgs );
+assert( res.updateLatencyMicros , "C1" );
+assert.eq( undefined , res.updateCorrectedLatencyMicros , "C2" );
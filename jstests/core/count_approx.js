@@ -0,0 +1,21 @@
+// Checks the approx option of the count command.
+
+var t = db.count_approx;
+t.drop();
+
+t.ensureIndex({ a: 1 });
+for (var i = 0; i < 100; i++) {
+    t.insert({ a: i });
+}
+
+// Either the index counts these ranges, exactly as they are small, or they are scanned.
+assert.eq(100, t.count({}, { approx: true }));
+assert.eq(10, t.count({ a: { $gte: 10, $lt: 20 } }, { approx: true }));
+assert.eq(10, t.count({ a: { $gte: 10, $lt: 20 } }));
+assert.eq(5, t.find({ a: { $gte: 10, $lt: 20 } }).skip(5).count(true, { approx: true }));
+
+// A count that isn't over a single index range ignores the option.
+assert.eq(50, t.count({ a: { $mod: [2, 0] } }, { approx: true }));
+
+var res = db.runCommand({ count: t.getName(), query: { a: 1 }, approx: 1 });
+assert.commandFailed(res);
@@ -0,0 +1,35 @@
+// Queries on a multikey index are covered when the projection and the filter only use key
+// fields which are never arrays.
+
+// Include helpers for analyzing explain output.
+load("jstests/libs/analyze_plan.js");
+
+var coll = db.covered_multikey_paths;
+coll.drop();
+coll.ensureIndex({ a: 1, b: 1 });
+for (var i = 0; i < 10; i++) {
+    coll.insert({ a: [i, i + 1], b: "b" + i });
+}
+
+// 'b' is never an array, so the index covers it.
+var plan = coll.find({ a: 5 }, { _id: 0, b: 1 }).hint({ a: 1, b: 1 }).explain("executionStats");
+assert(isIndexOnly(plan.queryPlanner.winningPlan), tojson(plan));
+assert.eq(0, plan.executionStats.totalDocsExamined, tojson(plan));
+assert.eq([{ b: "b4" }, { b: "b5" }],
+          coll.find({ a: 5 }, { _id: 0, b: 1 }).hint({ a: 1, b: 1 }).sort({ b: 1 }).toArray());
+
+// The regex on 'b' is applied to the index keys.
+plan = coll.find({ a: 5, b: /5/ }, { _id: 0, b: 1 }).hint({ a: 1, b: 1 })
+           .explain("executionStats");
+assert(isIndexOnly(plan.queryPlanner.winningPlan), tojson(plan));
+assert.eq(1, plan.executionStats.nReturned, tojson(plan));
+
+// 'a' comes from arrays, so projecting it needs the documents.
+plan = coll.find({ a: 5 }, { _id: 0, a: 1 }).hint({ a: 1, b: 1 }).explain("executionStats");
+assert(!isIndexOnly(plan.queryPlanner.winningPlan), tojson(plan));
+
+// Once some 'b' is an array, 'b' is no longer covered.
+coll.insert({ a: 5, b: ["x", "y"] });
+plan = coll.find({ a: 5 }, { _id: 0, b: 1 }).hint({ a: 1, b: 1 }).explain("executionStats");
+assert(!isIndexOnly(plan.queryPlanner.winningPlan), tojson(plan));
+assert.eq(3, coll.find({ a: 5 }, { _id: 0, b: 1 }).hint({ a: 1, b: 1 }).itcount());
@@ -0,0 +1,37 @@
+// Checks the order independent hashes of dbHash with unordered: true.
+
+var mydb = db.getSiblingDB("dbhash_unordered");
+mydb.dropDatabase();
+
+// Capped collections are hashed in insertion order by the ordered hash.
+mydb.createCollection("forward", { capped: true, size: 100000 });
+mydb.createCollection("backward", { capped: true, size: 100000 });
+for (var i = 0; i < 100; i++) {
+    mydb.forward.insert({ _id: i, x: "x" + i });
+    mydb.backward.insert({ _id: 99 - i, x: "x" + (99 - i) });
+}
+mydb.plain.insert({ _id: 1, a: 1 });
+
+var ordered = mydb.runCommand({ dbHash: 1 });
+assert.commandWorked(ordered);
+assert.neq(ordered.collections.forward, ordered.collections.backward, tojson(ordered));
+
+var unordered = mydb.runCommand({ dbHash: 1, unordered: true });
+assert.commandWorked(unordered);
+assert(unordered.unordered, tojson(unordered));
+assert.eq(unordered.collections.forward, unordered.collections.backward, tojson(unordered));
+assert.eq(3, Object.keySet(unordered.collections).length, tojson(unordered));
+assert.eq(32, unordered.collections.plain.length, tojson(unordered));
+
+// The hashes change with the documents.
+mydb.plain.update({ _id: 1 }, { $set: { a: 2 } });
+var changed = mydb.runCommand({ dbHash: 1, unordered: true, collections: ["plain"] });
+assert.commandWorked(changed);
+assert.eq(["plain"], Object.keySet(changed.collections), tojson(changed));
+assert.neq(unordered.collections.plain, changed.collections.plain, tojson(changed));
+
+mydb.plain.update({ _id: 1 }, { $set: { a: 1 } });
+assert.eq(unordered.collections.plain,
+          mydb.runCommand({ dbHash: 1, unordered: true }).collections.plain);
+
+mydb.dropDatabase();
@@ -0,0 +1,74 @@
+// Checks that an index with a partialFilterExpression only holds the documents matching the
+// filter, and is only used by queries which imply it.
+
+var t = db.jstests_index_partial;
+t.drop();
+
+function winningPlan(query) {
+    return tojson(t.find(query).explain().queryPlanner.winningPlan);
+}
+
+function usesIndex(query) {
+    return /IXSCAN/.test(winningPlan(query));
+}
+
+function indexedCount() {
+    // Validate reports the number of keys in each index.
+    var res = t.validate(true);
+    assert.commandWorked(res);
+    return res.keysPerIndex[t.getFullName() + ".$status_1_updatedAt_1"];
+}
+
+assert.commandWorked(t.ensureIndex({ status: 1, updatedAt: 1 },
+                                   { partialFilterExpression: { status: "pending" } }));
+
+for (var i = 0; i < 20; i++) {
+    t.insert({ _id: i, status: (i % 4 == 0 ? "pending" : "done"), updatedAt: i });
+}
+assert.eq(5, indexedCount());
+
+// Only a query which implies the filter can use the index.
+var query = { status: "pending", updatedAt: { $gt: 5 } };
+assert(usesIndex(query), winningPlan(query));
+assert(!usesIndex({ status: "done" }));
+assert(!usesIndex({ updatedAt: { $gt: 5 } }));
+assert.eq(3, t.find({ status: "pending", updatedAt: { $gt: 5 } }).itcount());
+assert.eq(15, t.find({ status: "done" }).itcount());
+
+// A hint for the index can't be honoured by a query which doesn't imply the filter.
+assert.throws(function() {
+    t.find({ status: "done" }).hint({ status: 1, updatedAt: 1 }).itcount();
+});
+
+// Updates move documents in and out of the index.
+t.update({ _id: 1 }, { $set: { status: "pending" } });
+assert.eq(6, indexedCount());
+t.update({ _id: 0 }, { $set: { status: "done" } });
+t.update({ _id: 4 }, { $set: { updatedAt: 100 } });
+assert.eq(5, indexedCount());
+assert.eq(5, t.find({ status: "pending", updatedAt: { $gt: 0 } }).itcount());
+
+t.remove({ _id: 4 });
+assert.eq(4, indexedCount());
+t.remove({ status: "done" });
+assert.eq(4, indexedCount());
+
+// The filter is kept when the index is rebuilt.
+assert.commandWorked(t.reIndex());
+assert.eq(4, indexedCount());
+
+// Invalid specs.
+t.drop();
+assert.commandFailed(t.ensureIndex({ a: 1 }, { partialFilterExpression: 5 }));
+assert.commandFailed(t.ensureIndex({ a: 1 }, { partialFilterExpression: { a: 1 },
+                                               sparse: true }));
+assert.commandFailed(t.ensureIndex({ a: 1 }, { partialFilterExpression: { a: { $ne: 1 } } }));
+assert.commandFailed(t.ensureIndex({ a: 1 },
+                                   { partialFilterExpression: { $or: [{ a: 1 }, { b: 1 }] } }));
+assert.commandFailed(t.ensureIndex({ a: 1 },
+                                   { partialFilterExpression: { $and: [{ $and: [{ a: 1 }] }] } }));
+assert.eq(1, t.getIndexes().length);
+
+assert.commandWorked(t.ensureIndex({ a: 1 }, { partialFilterExpression: {
+    $and: [{ a: { $gte: 1 } }, { b: { $exists: true } }, { c: { $type: 2 } }] } }));
+assert.eq(2, t.getIndexes().length);
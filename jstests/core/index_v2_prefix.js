@@ -0,0 +1,42 @@
+// Checks that v:2 indexes, whose btree buckets share the common prefix of their keys, give the
+// same results as v:1 ones, and that reIndex can move a collection's indexes to v:2.
+
+var t = db.jstests_index_v2_prefix;
+t.drop();
+
+var prefix = new Array(201).join("t");
+for (var i = 0; i < 2000; i++) {
+    t.insert({ a: prefix, b: i, c: i % 10 });
+}
+
+assert.commandWorked(t.ensureIndex({ a: 1, b: 1 }, { v: 2 }));
+
+function checkQueries() {
+    assert.eq(2000, t.find({ a: prefix }).hint({ a: 1, b: 1 }).itcount());
+    assert.eq(100, t.find({ a: prefix, b: { $gte: 1900 } }).hint({ a: 1, b: 1 }).itcount());
+    var last = t.find({ a: prefix }).sort({ a: -1, b: -1 }).hint({ a: 1, b: 1 }).limit(1)[0];
+    assert.eq(1999, last.b);
+}
+
+checkQueries();
+t.remove({ b: { $lt: 1000 } });
+assert.eq(1000, t.find({ a: prefix }).hint({ a: 1, b: 1 }).itcount());
+for (var i = 0; i < 1000; i++) {
+    t.insert({ a: prefix, b: i, c: i % 10 });
+}
+checkQueries();
+assert(t.validate(true).valid);
+
+// Only plain btree indexes have a v:2 format.
+assert.commandFailed(t.ensureIndex({ h: "hashed" }, { v: 2 }));
+
+// reIndex rebuilds the btree indexes in the requested format.
+assert.commandWorked(t.ensureIndex({ c: 1 }));
+assert.commandWorked(t.runCommand("reIndex", { indexVersion: 2 }));
+t.getIndexes().forEach(function(spec) {
+    assert.eq(2, spec.v, tojson(spec));
+});
+checkQueries();
+assert.eq(300, t.find({ c: 3 }).hint({ c: 1 }).itcount());
+
+assert.commandFailed(t.runCommand("reIndex", { indexVersion: 3 }));
@@ -0,0 +1,59 @@
+// Checks that the map and reduce functions mapReduce runs natively give the results of the js
+// functions they stand for.
+
+var t = db.mr_native;
+t.drop();
+
+for (var i = 0; i < 500; i++) {
+    t.insert({ k: i % 7, v: i / 4, n: NumberInt(i) });
+}
+t.insert({ v: 1 });                           // missing key
+t.insert({ k: null, v: 1 });
+t.insert({ k: "str", v: NumberInt(3) });
+t.insert({ k: new ObjectId(), v: -0.5 });
+t.insert({ k: /regex/, v: 1 });               // key the native mapper hands to js
+t.insert({ k: 1, v: "str" });                 // value the native mapper hands to js
+t.insert({ k: NumberLong(5), v: NumberLong(2) });
+
+function mapReduce(map, reduce) {
+    var res = db.runCommand({ mapreduce: t.getName(), map: map, reduce: reduce,
+                              out: { inline: 1 }, verbose: true });
+    assert.commandWorked(res);
+    return res;
+}
+
+function check(map, reduce, jsMap, jsReduce, nativeMap, nativeReduce) {
+    var res = mapReduce(map, reduce);
+    assert.eq(nativeMap, res.timing.nativeMap, tojson(res.timing));
+    assert.eq(nativeReduce, res.timing.nativeReduce, tojson(res.timing));
+
+    var expected = mapReduce(jsMap, jsReduce);
+    assert(!expected.timing.nativeMap && !expected.timing.nativeReduce);
+    assert.eq(tojson(expected.results), tojson(res.results));
+    assert.eq(expected.counts, res.counts);
+}
+
+var sum = "function(key, values) { return Array.sum(values); }";
+var jsSum = "function(key, values) { return Array.sum(values.slice()); }";
+
+check("function() { emit(this.k, 1); }", sum,
+      "function() { emit(this.k, 1 * 1); }", jsSum, true, true);
+check("function() { emit(this.k, this.v); }", sum,
+      "function() { var v = this.v; emit(this.k, v); }", jsSum, true, true);
+check("function() { emit(this.k, this.n); }",
+      "function(k, vals) { var s = 0; for (var i = 0; i < vals.length; i++) { s += vals[i]; } " +
+      "return s; }",
+      "function() { var n = this.n; emit(this.k, n); }",
+      "function(k, vals) { var s = 0; for (var i = 0; i < vals.length; i += 1) { s += vals[i]; } " +
+      "return s; }", true, true);
+check("function() { emit(this.k, -2.5); }",
+      "function(k, vals) { var s = 0; vals.forEach(function(x) { s += x; }); return s; }",
+      "function() { emit(this.k, -5 / 2); }",
+      "function(k, vals) { var s = 0; vals.forEach(function(x) { s = s + x; }); return s; }",
+      true, true);
+
+// js mode keeps to javascript
+var res = db.runCommand({ mapreduce: t.getName(), map: "function() { emit(this.k, 1); }",
+                          reduce: sum, out: { inline: 1 }, verbose: true, jsMode: true });
+assert.commandWorked(res);
+assert(!res.timing.nativeMap && !res.timing.nativeReduce, tojson(res.timing));
@@ -0,0 +1,31 @@
+// Checks that a cursor which reads ahead returns the same results, in the same order, as one
+// which doesn't.
+
+var t = db.read_ahead;
+t.drop();
+
+var big = new Array(10 * 1024).toString();
+for (var i = 0; i < 1000; i++) {
+    t.insert({ _id: i, a: i % 7, big: big });
+}
+t.ensureIndex({ a: 1 });
+
+function check(makeCursor) {
+    var expected = makeCursor().toArray().map(function(doc) { return doc._id; });
+    var actual = makeCursor().readAhead().toArray().map(function(doc) { return doc._id; });
+    assert.eq(expected, actual);
+}
+
+check(function() { return t.find().batchSize(50); });
+check(function() { return t.find({ a: 3 }).sort({ _id: -1 }).batchSize(10); });
+check(function() { return t.find().limit(333).batchSize(20); });
+
+// Default batch sizes, where a getMore batch is about as large as what is read ahead.
+check(function() { return t.find(); });
+
+// The cursor stays usable between getMores which don't drain what was read ahead.
+var cursor = t.find().batchSize(5).readAhead();
+for (var i = 0; i < 1000; i++) {
+    assert.eq(i, cursor.next()._id);
+}
+assert(!cursor.hasNext());
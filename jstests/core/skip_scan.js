@@ -0,0 +1,24 @@
+// An index whose leading field the query doesn't constrain is skip scanned: the scan jumps
+// between the distinct values of the leading field instead of examining every key.
+
+var coll = db.skip_scan;
+coll.drop();
+coll.ensureIndex({ a: 1, b: 1 });
+for (var i = 0; i < 1000; i++) {
+    coll.insert({ a: i % 10, b: Math.floor(i / 10) });
+}
+
+var plan = coll.find({ b: 5 }).hint({ a: 1, b: 1 }).explain("executionStats");
+assert.eq(10, plan.executionStats.nReturned, tojson(plan));
+assert.gt(50, plan.executionStats.totalKeysExamined, tojson(plan));
+assert.eq(10, plan.executionStats.totalDocsExamined, tojson(plan));
+
+// Ranges and $in on the trailing field.
+assert.eq(30, coll.find({ b: { $gte: 10, $lt: 13 } }).hint({ a: 1, b: 1 }).itcount());
+assert.eq(20, coll.find({ b: { $in: [1, 99] } }).hint({ a: 1, b: 1 }).itcount());
+assert.eq(0, coll.find({ b: 100 }).hint({ a: 1, b: 1 }).itcount());
+
+// Without a hint the skip scan races the collection scan and gives the same results.
+assert.eq(10, coll.find({ b: 5 }).itcount());
+assert.eq(coll.find({ b: 7 }).hint({ $natural: 1 }).sort({ a: 1 }).toArray(),
+          coll.find({ b: 7 }).sort({ a: 1 }).toArray());
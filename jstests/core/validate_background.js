@@ -0,0 +1,38 @@
+// Checks validate with background: true, which checks the indexes against the documents.
+
+var t = db.validate_background;
+t.drop();
+
+for (var i = 0; i < 500; i++) {
+    t.insert({ _id: i, a: i % 7, b: [i, i + 1, "s" + i], c: (i % 2) ? NumberLong(i) : i * 1.0,
+               sub: { x: i } });
+}
+t.insert({ _id: "noFields" });
+t.ensureIndex({ a: 1 });
+t.ensureIndex({ b: 1 });               // multikey
+t.ensureIndex({ c: -1, a: 1 });
+t.ensureIndex({ "sub.x": 1 }, { sparse: true });
+t.ensureIndex({ a: "hashed" });
+
+var res = t.validate({ background: true });
+assert.commandWorked(res);
+assert(res.valid, tojson(res));
+assert.eq(0, res.errors.length, tojson(res));
+assert.eq(501, res.nrecords, tojson(res));
+assert.eq(6, res.nIndexes, tojson(res));
+
+var ns = t.getFullName();
+assert.eq(501, res.keysPerIndex[ns + ".$_id_"], tojson(res));
+assert.eq(501, res.keysPerIndex[ns + ".$a_1"], tojson(res));
+assert.eq(1501, res.keysPerIndex[ns + ".$b_1"], tojson(res));
+assert.eq(500, res.keysPerIndex[ns + ".$sub.x_1"], tojson(res));
+
+// The counts agree with the foreground validate.
+var fg = t.validate();
+assert.commandWorked(fg);
+assert.eq(fg.keysPerIndex, res.keysPerIndex);
+
+assert.commandFailed(t.validate({ background: true, full: true }));
+assert.commandFailed(db.validate_background_missing.validate({ background: true }));
+
+t.drop();
@@ -0,0 +1,52 @@
+// Fills the namespace hashtable of a small .ns file, drops and recreates collections in it, and
+// checks that every collection is found again, also after a restart.
+
+var conn = MongoRunner.runMongod({ nssize: 1, smallfiles: "", noprealloc: "" });
+var db = conn.getDB("test");
+
+var created = [];
+for (var i = 0; i < 2000; i++) {
+    var name = "ns_fill_" + i;
+    var res = db.runCommand({ create: name });
+    if (!res.ok) {
+        assert(/too many namespaces/.test(res.errmsg), tojson(res));
+        break;
+    }
+    assert.writeOK(db[name].insert({ _id: i }));
+    created.push(name);
+}
+assert.lt(created.length, 2000, "the .ns file did not fill up");
+assert.gt(created.length, 100);
+
+// Drop every other collection, which frees buckets in the middle of the chains, and reuse them.
+var live = {};
+created.forEach(function(name, i) {
+    if (i % 2) {
+        assert(db[name].drop());
+    }
+    else {
+        live[name] = true;
+    }
+});
+for (var i = 0; i < created.length / 4; i++) {
+    var name = "ns_refill_" + i;
+    assert.commandWorked(db.runCommand({ create: name }));
+    assert.writeOK(db[name].insert({ _id: name }));
+    live[name] = true;
+}
+
+function checkCollections(db) {
+    var names = db.getCollectionNames().filter(function(name) { return /^ns_/.test(name); });
+    assert.eq(Object.keys(live).sort(), names.sort());
+    names.forEach(function(name) {
+        assert.eq(1, db[name].find().itcount(), name);
+        assert.eq(1, db[name].getIndexes().length, name);
+    });
+}
+
+checkCollections(db);
+
+MongoRunner.stopMongod(conn);
+conn = MongoRunner.runMongod({ restart: conn });
+checkCollections(conn.getDB("test"));
+MongoRunner.stopMongod(conn);
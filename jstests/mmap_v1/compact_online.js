@@ -0,0 +1,29 @@
+// An online compact frees the old extents while keeping the indexes, including a unique one, in
+// step with the moved documents.
+
+var t = db.jstests_compact_online;
+t.drop();
+
+t.ensureIndex({ a: 1 }, { unique: true });
+var big = new Array(2000).join("x");
+for (var i = 0; i < 3000; i++) {
+    t.insert({ _id: i, a: i, s: big });
+}
+t.remove({ _id: { $mod: [3, 0] } });
+var before = t.stats();
+assert.gt(before.numExtents, 2, tojson(before));
+
+var res = t.runCommand("compact", { online: true, extentsPerBatch: 2 });
+assert.commandWorked(res);
+assert.gt(res.extentsCompacted, 0, tojson(res));
+
+assert.eq(2000, t.count());
+assert.eq(2000, t.find().hint({ a: 1 }).itcount());
+assert.eq(2000, t.find().hint({ _id: 1 }).itcount());
+assert.eq(null, t.findOne({ a: 3 }));
+assert.eq(4, t.findOne({ a: 4 })._id);
+assert.commandWorked(t.validate(true));
+assert(t.validate(true).valid);
+
+assert.commandFailed(t.runCommand("compact", { extentsPerBatch: 2 }));
+assert.commandFailed(t.runCommand("compact", { online: true, extentsPerBatch: 0 }));
@@ -0,0 +1,57 @@
+// Checks that the records of a collection whose documents grow are padded by the observed growth,
+// so that they move less often, and that the moves are reported by collStats.
+
+var growthDB = db.getSiblingDB("record_growth_padding");
+growthDB.dropDatabase();
+
+function setGrowthPadding(enabled) {
+    assert.commandWorked(db.adminCommand({ setParameter: 1, mmapv1RecordGrowthPadding: enabled }));
+}
+
+// Inserts documents, and appends to an array in each of them, round after round.
+function runGrowth(coll) {
+    coll.drop();
+    assert.commandWorked(growthDB.createCollection(coll.getName()));
+
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < 500; i++) {
+        bulk.insert({ _id: i, a: [] });
+    }
+    assert.writeOK(bulk.execute());
+
+    var item = new Array(100).join("x");
+    for (var round = 0; round < 30; round++) {
+        assert.writeOK(coll.update({}, { $push: { a: item } }, { multi: true }));
+    }
+
+    // Documents inserted now are given room as well
+    bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 500; i < 600; i++) {
+        bulk.insert({ _id: i, a: [] });
+    }
+    assert.writeOK(bulk.execute());
+
+    var stats = coll.stats();
+    printjson(stats.recordGrowth);
+    return stats.recordGrowth;
+}
+
+setGrowthPadding(false);
+var unpadded = runGrowth(growthDB.unpadded);
+assert.eq(600, unpadded.inserts, tojson(unpadded));
+assert.lt(0, unpadded.moves, tojson(unpadded));
+assert.lt(0, unpadded.bytesMoved, tojson(unpadded));
+assert.eq(Math.floor(unpadded.bytesMoved / unpadded.moves), unpadded.avgBytesPerMove,
+          tojson(unpadded));
+
+setGrowthPadding(true);
+var padded = runGrowth(growthDB.padded);
+assert.lt(0, padded.movePadding, tojson(padded));
+assert.lt(0, padded.insertPadding, tojson(padded));
+assert.lt(padded.moves, unpadded.moves, tojson({ padded: padded, unpadded: unpadded }));
+
+// Capped collections never move their records
+assert.commandWorked(growthDB.createCollection("capped", { capped: true, size: 4096 }));
+assert.eq(undefined, growthDB.capped.stats().recordGrowth);
+
+growthDB.dropDatabase();
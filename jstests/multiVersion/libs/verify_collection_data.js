@@ -121,6 +121,10 @@ function CollectionDataValidator() {
         delete newCollectionStats.paddingFactor;
         delete newCollectionStats.paddingFactorNote;
 
+        // as of 2.7.9, we added recordGrowth, which is kept in memory only
+        delete collectionStats.recordGrowth;
+        delete newCollectionStats.recordGrowth;
+
         // Delete keys that appear just because we shard
         delete newCollectionStats["primary"];
         delete newCollectionStats["sharded"];
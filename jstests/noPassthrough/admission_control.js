@@ -0,0 +1,30 @@
+// Checks that adaptive admission control admits operations and reports itself in serverStatus.
+
+var conn = MongoRunner.runMongod({ setParameter: "admissionControlEnabled=true" });
+var db = conn.getDB("test");
+
+// Disabled by default; only reported when enabled.
+var standalone = MongoRunner.runMongod({});
+assert.eq(undefined, standalone.getDB("admin").serverStatus().admissionControl);
+MongoRunner.stopMongod(standalone);
+
+for (var i = 0; i < 1000; i++) {
+    db.admission_control.insert({ i: i });
+}
+assert.eq(1000, db.admission_control.find().itcount());
+
+var status = db.serverStatus().admissionControl;
+assert(status, tojson(db.serverStatus()));
+assert.gt(status.read.admitted, 0, tojson(status));
+assert.gt(status.write.admitted, 0, tojson(status));
+assert.gte(status.read.totalTickets, status.read.minTickets, tojson(status));
+assert.lte(status.write.totalTickets, status.write.maxTickets, tojson(status));
+
+// The limits can be changed at runtime.
+assert.commandWorked(db.adminCommand({ setParameter: 1, admissionControlMaxTickets: 16 }));
+assert.commandFailed(db.adminCommand({ setParameter: 1, admissionControlMinTickets: 0 }));
+status = db.serverStatus().admissionControl;
+assert.eq(16, status.write.maxTickets, tojson(status));
+assert.lte(status.write.totalTickets, 16, tojson(status));
+
+MongoRunner.stopMongod(conn);
@@ -0,0 +1,40 @@
+// Checks that collections which exist at startup are opened on first use when the catalog
+// warmer is off, and are all opened by the warmer when it is on.
+
+var numColls = 200;
+
+var conn = MongoRunner.runMongod({});
+var db = conn.getDB("test");
+for (var i = 0; i < numColls; i++) {
+    var coll = db["catalog_warmer_" + i];
+    assert.writeOK(coll.insert({ _id: i, a: i }));
+    assert.commandWorked(coll.ensureIndex({ a: 1 }));
+}
+MongoRunner.stopMongod(conn);
+
+function warmedCollections(conn) {
+    return conn.getDB("admin").serverStatus().metrics.catalogWarmer.collections;
+}
+
+// Warmer off: nothing is opened behind the operations' back, and the first use opens each.
+conn = MongoRunner.runMongod({ restart: conn, setParameter: "catalogWarmerBatchSize=0" });
+db = conn.getDB("test");
+sleep(1000);
+assert.eq(0, warmedCollections(conn));
+for (var i = 0; i < numColls; i++) {
+    var coll = db["catalog_warmer_" + i];
+    assert.eq(1, coll.find({ a: i }).hint({ a: 1 }).itcount(), coll.getName());
+    assert.writeOK(coll.insert({ _id: numColls + i, a: i }));
+}
+MongoRunner.stopMongod(conn);
+
+// Warmer on, in small batches: every collection is opened, and stays usable meanwhile.
+conn = MongoRunner.runMongod({ restart: conn, setParameter: "catalogWarmerBatchSize=7" });
+db = conn.getDB("test");
+assert.eq(2, db.catalog_warmer_0.find({ a: 0 }).itcount());
+assert.soon(function() { return warmedCollections(conn) >= numColls; },
+            "catalog warmer did not open the collections");
+for (var i = 0; i < numColls; i++) {
+    assert.eq(2, db["catalog_warmer_" + i].find({ a: i }).hint({ a: 1 }).itcount());
+}
+MongoRunner.stopMongod(conn);
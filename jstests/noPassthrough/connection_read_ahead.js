@@ -0,0 +1,33 @@
+// Checks that requests received ahead on a connection are still processed and answered in
+// order, including fire-and-forget writes followed by getLastError.
+
+var conn = MongoRunner.runMongod({ setParameter: "connectionReadAheadMessages=4" });
+
+var ret = conn.adminCommand({ getParameter: 1, connectionReadAheadMessages: 1 });
+assert.commandWorked(ret);
+assert.eq(4, ret.connectionReadAheadMessages);
+
+var c = new Mongo(conn.host);
+c.forceWriteMode("legacy");
+var db = c.getDB("test");
+var coll = db.connection_read_ahead;
+
+for (var i = 0; i < 1000; i++) {
+    coll.insert({ _id: i });
+}
+assert.eq(null, db.getLastError());
+assert.eq(1000, coll.count());
+
+// The last write's error is the one reported.
+coll.insert({ _id: 0 });
+coll.insert({ _id: 1000 });
+assert.eq(null, db.getLastError());
+coll.insert({ _id: 1000 });
+assert.eq(11000, db.getLastErrorObj().code);
+
+// Queries are answered in order.
+for (var i = 0; i < 100; i++) {
+    assert.eq(i, coll.findOne({ _id: i })._id);
+}
+
+MongoRunner.stopMongod(conn);
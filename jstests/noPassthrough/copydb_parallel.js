@@ -0,0 +1,60 @@
+// Checks that copydb, clone and cloneCollection copy the same data whether the documents are
+// read ahead of their insertion and the collections cloned in parallel or not.
+
+var source = MongoRunner.runMongod({});
+var target = MongoRunner.runMongod({});
+var sourceDB = source.getDB("copydb_parallel");
+
+var padding = new Array(1000).join("x");
+for (var c = 0; c < 6; c++) {
+    var bulk = sourceDB["coll" + c].initializeUnorderedBulkOp();
+    for (var i = 0; i < 3000 * (c + 1); i++) {
+        bulk.insert({ _id: i, c: c, a: i % 17, padding: padding });
+    }
+    assert.writeOK(bulk.execute());
+    assert.commandWorked(sourceDB["coll" + c].ensureIndex({ a: 1 }));
+}
+assert.commandWorked(sourceDB.createCollection("capped", { capped: true, size: 100000 }));
+assert.writeOK(sourceDB.capped.insert({ x: 1 }));
+
+function checkCopy(db) {
+    var names = sourceDB.getCollectionNames();
+    assert.eq(names, db.getCollectionNames());
+    names.forEach(function(name) {
+        if (name == "system.indexes") {
+            return;
+        }
+        assert.eq(sourceDB[name].find().sort({ _id: 1 }).toArray(),
+                  db[name].find().sort({ _id: 1 }).toArray(), name);
+        assert.eq(sourceDB[name].getIndexes().length, db[name].getIndexes().length, name);
+    });
+    assert(db.capped.isCapped());
+}
+
+var targetAdmin = target.getDB("admin");
+[{ readAhead: 0, threads: 1 }, { readAhead: 4, threads: 1 }, { readAhead: 4, threads: 4 },
+ { readAhead: 1, threads: 3 }].forEach(function(params) {
+    assert.commandWorked(targetAdmin.runCommand({ setParameter: 1,
+                                                  cloneReadAheadBatches: params.readAhead,
+                                                  cloneCollectionThreads: params.threads }));
+    var copy = target.getDB("copydb_parallel");
+    copy.dropDatabase();
+    assert.commandWorked(targetAdmin.runCommand({ copydb: 1, fromhost: source.host,
+                                                  fromdb: "copydb_parallel",
+                                                  todb: "copydb_parallel" }),
+                         tojson(params));
+    checkCopy(copy);
+
+    copy.dropDatabase();
+    assert.commandWorked(copy.runCommand({ clone: source.host }), tojson(params));
+    checkCopy(copy);
+
+    copy.coll2.drop();
+    assert.commandWorked(copy.runCommand({ cloneCollection: "copydb_parallel.coll2",
+                                           from: source.host }),
+                         tojson(params));
+    assert.eq(sourceDB.coll2.count(), copy.coll2.count());
+});
+
+MongoRunner.stopMongod(target);
+MongoRunner.stopMongod(source);
@@ -0,0 +1,29 @@
+// Checks that mongod keeps diagnostic data samples in the diagnostic.data directory of its
+// dbpath and that mongoftdcdump can read them back.
+
+var conn = MongoRunner.runMongod({ setParameter: "diagnosticDataCollectionPeriodMillis=100" });
+var admin = conn.getDB("admin");
+var dataDir = conn.fullOptions.dbpath + "/diagnostic.data";
+
+assert.commandWorked(admin.runCommand({ setParameter: 1,
+                                        diagnosticDataCollectionSamplesPerInterimUpdate: 1 }));
+
+function metricsFiles() {
+    return listFiles(dataDir).filter(function(f) {
+        return f.baseName.indexOf("metrics.") == 0;
+    });
+}
+
+assert.soon(function() {
+    return metricsFiles().some(function(f) { return f.baseName == "metrics.interim"; });
+}, "no interim diagnostic data file");
+
+// The samples are in the interim file, or in a file of their own once the chunk is finished.
+MongoRunner.stopMongod(conn);
+assert.neq(0, metricsFiles().length);
+
+clearRawMongoProgramOutput();
+assert.eq(0, runMongoProgram("mongoftdcdump", "--metadata", dataDir));
+var output = rawMongoProgramOutput();
+assert(/"serverStatus"/.test(output), output);
+assert(/"buildInfo"/.test(output), output);
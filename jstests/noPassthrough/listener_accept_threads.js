@@ -0,0 +1,22 @@
+// Checks that connections are accepted on every address when the listener is sharded
+// across several SO_REUSEPORT accept threads.
+
+var conn = MongoRunner.runMongod({ setParameter: "listenerAcceptThreads=4" });
+
+var ret = conn.adminCommand({ getParameter: 1, listenerAcceptThreads: 1 });
+assert.commandWorked(ret);
+assert.eq(4, ret.listenerAcceptThreads);
+
+var baseline = conn.getDB("admin").serverStatus().connections.current;
+
+var numConns = 40;
+var conns = [];
+for (var i = 0; i < numConns; i++) {
+    var c = new Mongo(conn.host);
+    assert.commandWorked(c.getDB("admin").runCommand({ ping: 1 }));
+    conns.push(c);
+}
+
+assert.eq(baseline + numConns, conn.getDB("admin").serverStatus().connections.current);
+
+MongoRunner.stopMongod(conn);
@@ -0,0 +1,71 @@
+// Checks that mapReduce gets the same results when its map function runs in several scopes and
+// when its tuples are spilled to a Sorter, rather than to an incremental collection.
+
+var conn = MongoRunner.runMongod({ setParameter: "internalMapReduceSpillMaxMemoryMegabytes=1" });
+var admin = conn.getDB("admin");
+var db = conn.getDB("test");
+var coll = db.mr_parallel_map_spill;
+
+var padding = new Array(200).join("x");
+var bulk = coll.initializeUnorderedBulkOp();
+for (var i = 0; i < 20000; i++) {
+    bulk.insert({ _id: i, key: (i * 7919) % 5003, tags: ["a" + (i % 3), "b" + (i % 5)],
+                  padding: padding });
+}
+assert.writeOK(bulk.execute());
+
+db.system.js.save({ _id: "mrParallelMapSpillWeight", value: function(x) { return x % 13; } });
+
+// Not a form run natively, so that it runs in the js scopes.
+var map = function() {
+    emit(this.key + ":" + padding, mrParallelMapSpillWeight(this._id) * factor);
+    for (var i = 0; i < this.tags.length; i++) {
+        emit(this.tags[i], 1);
+    }
+};
+var reduce = function(key, values) {
+    var total = 0;
+    for (var i = 0; i < values.length; i++) {
+        total += values[i];
+    }
+    return total;
+};
+
+function runMapReduce(out, mapThreads, spillToSorter) {
+    assert.commandWorked(admin.runCommand({ setParameter: 1,
+                                            internalMapReduceMapThreads: mapThreads,
+                                            internalMapReduceSpillToSorter: spillToSorter }));
+    var res = db.runCommand({ mapReduce: coll.getName(), map: map, reduce: reduce, out: out,
+                              scope: { padding: padding, factor: 2 }, verbose: true });
+    assert.commandWorked(res);
+    assert.eq(20000, res.counts.input, tojson(res.counts));
+    assert.eq(60000, res.counts.emit, tojson(res.counts));
+    assert.eq(mapThreads, res.timing.mapThreads, tojson(res.timing));
+    return db[out].find().sort({ _id: 1 }).toArray();
+}
+
+var expected = runMapReduce("mr_parallel_map_spill_serial", 1, false);
+assert.eq(5003 + 8, expected.length);
+
+assert.eq(expected, runMapReduce("mr_parallel_map_spill_sorter", 1, true));
+assert.eq(expected, runMapReduce("mr_parallel_map_spill_parallel", 4, true));
+assert.eq(expected, runMapReduce("mr_parallel_map_spill_parallel_inc", 3, false));
+
+// Errors of the map function are reported from the worker scopes.
+assert.commandWorked(admin.runCommand({ setParameter: 1, internalMapReduceMapThreads: 4 }));
+var res = db.runCommand({ mapReduce: coll.getName(),
+                          map: function() { if (this._id == 12345) throw "bad doc"; emit(1, 1); },
+                          reduce: reduce,
+                          out: "mr_parallel_map_spill_error" });
+assert.commandFailed(res);
+assert(/bad doc/.test(res.errmsg), tojson(res));
+
+// The spilled files are removed once the job is done.
+var tmpFiles = listFiles(conn.fullOptions.dbpath).filter(function(f) {
+    return f.baseName == "_tmp";
+});
+if (tmpFiles.length) {
+    assert.eq([], listFiles(tmpFiles[0].name));
+}
+
+MongoRunner.stopMongod(conn);
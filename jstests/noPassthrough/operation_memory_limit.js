@@ -0,0 +1,29 @@
+// Checks that a blocking sort bounded by internalOperationMaxMemoryMegabytes fails, or spills when
+// it may use the disk, well below its own limit.
+
+var conn = MongoRunner.runMongod({ setParameter: "internalOperationMaxMemoryMegabytes=1" });
+var db = conn.getDB("test");
+var coll = db.operation_memory_limit;
+
+var padding = new Array(1024).join("x");
+var bulk = coll.initializeUnorderedBulkOp();
+for (var i = 0; i < 5000; i++) {
+    bulk.insert({ _id: i, key: (i * 7919) % 5003, padding: padding });
+}
+assert.writeOK(bulk.execute());
+
+// The query sort holds about 5MB, under its own 32MB limit but over the operation's.
+assert.throws(function() { coll.find().sort({ key: 1 }).itcount(); });
+
+// The aggregation sort spills instead, when it is allowed to.
+var res = db.runCommand({ aggregate: coll.getName(), pipeline: [{ $sort: { key: 1 } }],
+                          cursor: {}, allowDiskUse: true });
+assert.commandWorked(res);
+assert.commandFailed(db.runCommand({ aggregate: coll.getName(), pipeline: [{ $sort: { key: 1 } }],
+                                     cursor: {} }));
+
+// Without a limit the query sort succeeds.
+assert.commandWorked(db.adminCommand({ setParameter: 1, internalOperationMaxMemoryMegabytes: 0 }));
+assert.eq(5000, coll.find().sort({ key: 1 }).itcount());
+
+MongoRunner.stopMongod(conn);
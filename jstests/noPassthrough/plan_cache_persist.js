@@ -0,0 +1,39 @@
+// Checks that plan cache entries saved to admin.system.plancache warm the plan cache of a
+// restarted mongod.
+
+var options = { setParameter: "internalQueryCachePersistIntervalSecs=1" };
+var conn = MongoRunner.runMongod(options);
+
+var t = conn.getDB("test").plan_cache_persist;
+t.drop();
+t.ensureIndex({ a: 1 });
+t.ensureIndex({ b: 1 });
+for (var i = 0; i < 100; i++) {
+    t.insert({ a: i % 10, b: i % 3 });
+}
+
+// Two candidate plans, so the winner is cached.
+assert.eq(4, t.find({ a: 1, b: 1 }).itcount());
+var shapes = t.getPlanCache().listQueryShapes();
+assert.eq(1, shapes.length, tojson(shapes));
+
+var saved = conn.getDB("admin").system.plancache;
+assert.soon(function() { return saved.find({ ns: t.getFullName() }).itcount() == 1; },
+            "plan cache entry was not saved");
+
+MongoRunner.stopMongod(conn);
+options.restart = conn;
+conn = MongoRunner.runMongod(options);
+t = conn.getDB("test").plan_cache_persist;
+
+assert.soon(function() { return t.getPlanCache().listQueryShapes().length == 1; },
+            "plan cache was not warmed at startup");
+
+var plans = t.getPlanCache().getPlansByQuery({ a: 1, b: 1 });
+assert.eq(1, plans.length, tojson(plans));
+assert(plans[0].reason.restored, tojson(plans));
+
+// The restored entry is used to answer the query.
+assert.eq(4, t.find({ a: 1, b: 1 }).itcount());
+
+MongoRunner.stopMongod(conn);
@@ -0,0 +1,47 @@
+// Checks that connections serviced by the epoll service executor keep their per-connection
+// state (getLastError, currentOp descriptions) while moving between worker threads.
+
+var conn = MongoRunner.runMongod({ setParameter: "serviceExecutor=epoll" });
+
+var ret = conn.adminCommand({ getParameter: 1, serviceExecutor: 1 });
+assert.commandWorked(ret);
+assert.eq("epoll", ret.serviceExecutor);
+
+var baseline = conn.getDB("admin").serverStatus().connections.current;
+
+// Interleave requests from many idle-most-of-the-time connections.
+var numConns = 50;
+var conns = [];
+for (var i = 0; i < numConns; i++) {
+    var c = new Mongo(conn.host);
+    c.forceWriteMode("legacy");
+    conns.push(c);
+}
+
+for (var round = 0; round < 5; round++) {
+    for (var i = 0; i < numConns; i++) {
+        var t = conns[i].getDB("test").service_executor_epoll;
+        t.insert({ conn: i, round: round });
+    }
+    for (var i = 0; i < numConns; i++) {
+        var db = conns[i].getDB("test");
+
+        // Each connection sees the result of its own last write.
+        var gle = db.runCommand({ getLastError: 1 });
+        assert.commandWorked(gle);
+        assert.eq(null, gle.err, tojson(gle));
+
+        db.service_executor_epoll.insert({ _id: "dup" + i });
+        db.service_executor_epoll.insert({ _id: "dup" + i });
+    }
+    for (var i = 0; i < numConns; i++) {
+        var gle = conns[i].getDB("test").runCommand({ getLastError: 1 });
+        assert.eq(11000, gle.code, tojson(gle));
+    }
+    conn.getDB("test").service_executor_epoll.remove({ _id: /^dup/ });
+}
+
+assert.eq(numConns * 5, conn.getDB("test").service_executor_epoll.count());
+assert.eq(baseline + numConns, conn.getDB("admin").serverStatus().connections.current);
+
+MongoRunner.stopMongod(conn);
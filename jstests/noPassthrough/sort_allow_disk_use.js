@@ -0,0 +1,33 @@
+// Checks that a blocking sort over the memory limit fails, unless the query allows it to use
+// temporary files.
+
+var conn = MongoRunner.runMongod({ setParameter: "internalQueryExecMaxBlockingSortBytes=4096" });
+
+var t = conn.getDB("test").sort_allow_disk_use;
+t.drop();
+for (var i = 0; i < 1000; i++) {
+    t.insert({ a: (i * 7919) % 1000, b: i });
+}
+
+assert.throws(function() { t.find().sort({ a: 1 }).itcount(); });
+
+var results = t.find().sort({ a: 1 }).allowDiskUse().toArray();
+assert.eq(1000, results.length);
+for (var i = 0; i < results.length; i++) {
+    assert.eq(i, results[i].a, tojson(results[i]));
+}
+
+// With a limit the sort keeps only the top documents.
+results = t.find().sort({ a: -1 }).limit(10).allowDiskUse().toArray();
+assert.eq(10, results.length);
+assert.eq(999, results[0].a);
+
+var explain = t.find().sort({ a: 1 }).allowDiskUse().explain("executionStats");
+var sortStage = explain.executionStats.executionStages;
+while (sortStage.stage != "SORT") {
+    sortStage = sortStage.inputStage;
+}
+assert.gt(sortStage.spillFiles, 0, tojson(sortStage));
+assert.gt(sortStage.spillBytes, 0, tojson(sortStage));
+
+MongoRunner.stopMongod(conn);
@@ -0,0 +1,50 @@
+// Checks that the TTL monitor deletes expired documents in batches, in order of expiry, that it
+// keeps to ttlMonitorMaxDeletesPerSecond and that serverStatus reports the expired documents it
+// has not deleted yet.
+
+var conn = MongoRunner.runMongod({ setParameter: { ttlMonitorSleepSecs: 1,
+                                                   ttlMonitorBatchSize: 50,
+                                                   ttlMonitorMaxDeletesPerSecond: 100 } });
+var admin = conn.getDB("admin");
+var coll = conn.getDB("test").ttl_batched_deletes;
+
+function ttlMetrics() {
+    return admin.runCommand({ serverStatus: 1 }).metrics.ttl;
+}
+
+var now = new Date().getTime();
+var bulk = coll.initializeUnorderedBulkOp();
+for (var i = 0; i < 1000; i++) {
+    bulk.insert({ _id: i, x: new Date(now - 3600 * 1000 - i * 1000) });
+}
+for (var i = 1000; i < 1100; i++) {
+    bulk.insert({ _id: i, x: new Date(now + 3600 * 1000) });
+}
+bulk.insert({ _id: "notADate", x: true });
+assert.writeOK(bulk.execute());
+
+var before = ttlMetrics();
+coll.ensureIndex({ x: -1 }, { expireAfterSeconds: 60 });
+
+// At 100 deletes a second, a pass of one second leaves most of the documents behind.
+assert.soon(function() { return ttlMetrics().backlogDocuments > 0; },
+            "backlog not reported: " + tojson(ttlMetrics()));
+assert.gt(coll.count(), 101);
+
+// The oldest documents, those with the highest _ids, are deleted first.
+var expiredLeft = coll.find({ x: { $lt: new Date(now) } }, { _id: 1 }).sort({ _id: 1 }).toArray();
+for (var i = 0; i < expiredLeft.length; i++) {
+    assert.eq(i, expiredLeft[i]._id, tojson(expiredLeft));
+}
+
+assert.commandWorked(admin.runCommand({ setParameter: 1, ttlMonitorMaxDeletesPerSecond: 0 }));
+assert.soon(function() { return coll.count() == 101; }, "not deleted: " + coll.count());
+assert.soon(function() { return ttlMetrics().backlogDocuments == 0; },
+            "backlog left: " + tojson(ttlMetrics()));
+
+var after = ttlMetrics();
+assert.eq(1000, after.deletedDocuments - before.deletedDocuments, tojson(after));
+assert.gte(after.deleteBatches - before.deleteBatches, 1000 / 50, tojson(after));
+assert.eq(1, coll.find({ _id: "notADate" }).itcount());
+
+MongoRunner.stopMongod(conn);
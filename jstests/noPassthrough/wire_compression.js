@@ -0,0 +1,46 @@
+// Checks that replica set members started with networkMessageCompressors=snappy agree on
+// compression in isMaster and replicate over compressed connections.
+
+var replTest = new ReplSetTest({ name: "wire_compression", nodes: 2, oplogSize: 10 });
+replTest.startSet({ setParameter: "networkMessageCompressors=snappy" });
+replTest.initiate();
+
+var master = replTest.getMaster();
+
+// The server offers compression only to clients which ask for it.
+var res = master.adminCommand({ isMaster: 1 });
+assert.commandWorked(res);
+assert(!res.compression, tojson(res));
+
+res = master.adminCommand({ isMaster: 1, compression: [ "snappy" ] });
+assert.commandWorked(res);
+assert.eq([ "snappy" ], res.compression, tojson(res));
+
+// Large, compressible documents, so that the oplog batches are worth compressing.
+var big = new Array(10 * 1024).join("x");
+var coll = master.getDB("test").wire_compression;
+for (var i = 0; i < 200; i++) {
+    coll.insert({ _id: i, s: big });
+}
+assert.eq(null, master.getDB("test").getLastError(2, 60 * 1000));
+
+var slave = replTest.liveNodes.slaves[0];
+assert.eq(200, slave.getDB("test").wire_compression.count());
+
+var masterStats = master.getDB("admin").serverStatus().network.compression.snappy;
+var slaveStats = slave.getDB("admin").serverStatus().network.compression.snappy;
+printjson(masterStats);
+printjson(slaveStats);
+
+// The primary compresses the oplog it sends; the secondary decompresses it.
+assert.gt(masterStats.compressor.bytesIn, masterStats.compressor.bytesOut);
+assert.gt(slaveStats.decompressor.bytesOut, slaveStats.decompressor.bytesIn);
+
+// Without the parameter nothing is offered.
+var conn = MongoRunner.runMongod({});
+res = conn.adminCommand({ isMaster: 1, compression: [ "snappy" ] });
+assert.commandWorked(res);
+assert(!res.compression, tojson(res));
+MongoRunner.stopMongod(conn);
+
+replTest.stopSet();
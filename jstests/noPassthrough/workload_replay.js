@@ -0,0 +1,47 @@
+// Records a workload through mongobridge and replays it with benchRun against another server,
+// including a getMore whose cursor id has to be translated.
+
+var source = MongoRunner.runMongod({});
+var target = MongoRunner.runMongod({});
+
+var recordFile = MongoRunner.dataPath + "workload_replay.capture";
+removeFile(recordFile);
+
+var bridgePort = MongoRunner.nextOpenPort();
+var bridgePid = startMongoProgramNoConnect("mongobridge", "--port", bridgePort,
+                                           "--dest", "localhost:" + source.port,
+                                           "--record", recordFile);
+
+var bridged;
+assert.soon(function() {
+    try {
+        bridged = new Mongo("localhost:" + bridgePort);
+        return true;
+    }
+    catch (e) {
+        return false;
+    }
+});
+
+var coll = bridged.getDB("test").workload_replay;
+for (var i = 0; i < 150; i++) {
+    coll.insert({ _id: i });
+}
+assert.eq(null, bridged.getDB("test").getLastError());
+
+// Reads past the first batch, so the replay needs a getMore on its own cursor
+assert.eq(150, coll.find().batchSize(10).itcount());
+
+stopMongoProgram(bridgePort);
+
+var res = benchRun({ replay: recordFile, replaySpeed: 10, host: "localhost:" + target.port });
+assert.eq(0, res.errCount, tojson(res));
+assert(res.insertLatencyMicros || res.commandLatencyMicros, tojson(res));
+assert(res.queryCorrectedLatencyMicros, tojson(res));
+
+assert.eq(150, target.getDB("test").workload_replay.count());
+var serverStatus = target.getDB("admin").serverStatus();
+assert.lte(14, serverStatus.opcounters.getmore, tojson(serverStatus.opcounters));
+
+MongoRunner.stopMongod(source);
+MongoRunner.stopMongod(target);
@@ -0,0 +1,58 @@
+// Checks that the statistics gathered by the analyze command let the planner discard
+// candidate plans which are far more expensive than the cheapest, without racing them.
+
+load("jstests/libs/analyze_plan.js");
+
+var t = db.analyze_index_stats;
+t.drop();
+
+t.ensureIndex({ a: 1 });
+t.ensureIndex({ b: 1 });
+for (var i = 0; i < 1000; i++) {
+    t.insert({ a: i, b: i % 2 });
+}
+
+var query = { a: { $lt: 10 }, b: 1 };
+
+// Without statistics both indexed plans are raced.
+var explain = t.find(query).explain();
+assert.eq(1, explain.queryPlanner.rejectedPlans.length, tojson(explain));
+
+var res = db.runCommand({ analyze: t.getName(), buckets: 20, verbose: true });
+assert.commandWorked(res);
+assert.eq(1000, res.indexes.a_1.numKeys, tojson(res));
+assert.eq(2, res.indexes.b_1.numDistinct, tojson(res));
+assert.lte(res.indexes.a_1.buckets, 20, tojson(res));
+assert(res.indexes.a_1.histogram, tojson(res));
+assert.eq(1000, res.indexes._id_.numKeys, tojson(res));
+
+// {a: 1} is estimated to examine far fewer keys, so {b: 1} is never tried.
+explain = t.find(query).explain();
+assert.eq(0, explain.queryPlanner.rejectedPlans.length, tojson(explain));
+assert(isIxscan(explain.queryPlanner.winningPlan), tojson(explain));
+assert.eq(5, t.find(query).itcount());
+
+// Analyzing a single index, and bad arguments.
+res = db.runCommand({ analyze: t.getName(), index: "b_1" });
+assert.commandWorked(res);
+assert.eq(["b_1"], Object.keySet(res.indexes));
+assert.commandFailed(db.runCommand({ analyze: t.getName(), index: "c_1" }));
+assert.commandFailed(db.runCommand({ analyze: t.getName(), buckets: 0 }));
+assert.commandFailed(db.runCommand({ analyze: "analyze_index_stats_missing" }));
+
+// Pruning can be disabled.
+assert.commandWorked(db.adminCommand({ setParameter: 1,
+                                       internalQueryPlannerCostBasedPruning: false }));
+explain = t.find(query).explain();
+assert.eq(1, explain.queryPlanner.rejectedPlans.length, tojson(explain));
+assert.commandWorked(db.adminCommand({ setParameter: 1,
+                                       internalQueryPlannerCostBasedPruning: true }));
+
+// Enough writes make the statistics stale.
+for (var i = 0; i < 300; i++) {
+    t.insert({ a: 1000 + i, b: i % 2 });
+}
+explain = t.find(query).explain();
+assert.eq(1, explain.queryPlanner.rejectedPlans.length, tojson(explain));
+
+t.drop();
@@ -0,0 +1,54 @@
+// Checks that a long collection scan hints the storage engine to read ahead of it, and that a
+// short one doesn't.
+
+var t = db.collscan_read_ahead;
+t.drop();
+
+var padding = new Array(1000).join("x");
+var bulk = t.initializeUnorderedBulkOp();
+for (var i = 0; i < 10000; i++) {
+    bulk.insert({ _id: i, padding: padding });
+}
+assert.writeOK(bulk.execute());
+
+function collScanStats(query, direction) {
+    var stats = t.find(query).sort({ $natural: direction }).explain("executionStats");
+    var stage = stats.executionStats.executionStages;
+    while (stage.stage != "COLLSCAN") {
+        stage = stage.inputStage;
+    }
+    return stage;
+}
+
+var isMMAPv1 = db.serverStatus().storageEngine.name == "mmapv1";
+
+[1, -1].forEach(function(direction) {
+    var stage = collScanStats({ x: 1 }, direction);
+    assert.eq(10000, stage.docsExamined, tojson(stage));
+    if (isMMAPv1) {
+        // About 10MB of documents, read in windows of 1MB.
+        assert.gt(stage.readAheads, 5, tojson(stage));
+    }
+    else {
+        assert.gte(stage.readAheads, 0, tojson(stage));
+    }
+});
+
+// Scans stopping before internalQueryExecCollScanReadAheadDocs don't read ahead.
+var stage = t.find({ x: 1 }).limit(1).maxScan(50).explain("executionStats")
+              .executionStats.executionStages;
+while (stage.stage != "COLLSCAN") {
+    stage = stage.inputStage;
+}
+assert.eq(0, stage.readAheads, tojson(stage));
+
+// And nothing reads ahead with the hint switched off.
+var admin = db.getSiblingDB("admin");
+var old = admin.runCommand({ getParameter: 1, internalQueryExecCollScanReadAheadDocs: 1 });
+assert.commandWorked(old);
+assert.commandWorked(admin.runCommand({ setParameter: 1,
+                                        internalQueryExecCollScanReadAheadDocs: 0 }));
+assert.eq(0, collScanStats({ x: 1 }, 1).readAheads);
+assert.commandWorked(admin.runCommand({
+    setParameter: 1,
+    internalQueryExecCollScanReadAheadDocs: old.internalQueryExecCollScanReadAheadDocs }));
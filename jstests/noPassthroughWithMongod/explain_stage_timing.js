@@ -0,0 +1,53 @@
+// Checks that with internalQueryExecStageTiming each stage reports its time in explain and in
+// the profiler, and that the stages which read documents and keys report how many bytes.
+
+var t = db.explain_stage_timing;
+t.drop();
+
+var old = db.adminCommand({ getParameter: 1, internalQueryExecStageTiming: 1 });
+assert.commandWorked(old);
+
+for (var i = 0; i < 100; i++) {
+    t.insert({ _id: i, a: i % 10, s: "xxxxxxxxxx" });
+}
+t.ensureIndex({ a: 1 });
+
+// Without the knob only the millisecond estimate is there.
+assert.commandWorked(db.adminCommand({ setParameter: 1, internalQueryExecStageTiming: false }));
+var explain = t.find({ a: 3 }).explain("executionStats");
+var fetch = explain.executionStats.executionStages;
+assert.eq("FETCH", fetch.stage, tojson(explain));
+assert.eq(undefined, fetch.executionTimeNanos, tojson(fetch));
+assert.eq(undefined, fetch.cpuTimeNanos, tojson(fetch));
+
+// The byte counts are always collected.
+assert.gt(fetch.docBytesExamined, 10 * Object.bsonsize({ _id: 0, a: 0 }), tojson(fetch));
+assert.eq(undefined, fetch.keyBytesExamined, tojson(fetch));
+assert.gt(fetch.inputStage.keyBytesExamined, 0, tojson(fetch));
+assert.eq(undefined, fetch.inputStage.docBytesExamined, tojson(fetch));
+
+assert.commandWorked(db.adminCommand({ setParameter: 1, internalQueryExecStageTiming: true }));
+explain = t.find({ a: { $gte: 0 } }).sort({ s: 1 }).explain("executionStats");
+var sort = explain.executionStats.executionStages;
+assert.eq("SORT", sort.stage, tojson(explain));
+
+// A stage's time includes its children's.
+assert.gt(sort.executionTimeNanos, 0, tojson(sort));
+assert.gte(sort.cpuTimeNanos, 0, tojson(sort));
+assert.gte(sort.executionTimeNanos, sort.inputStage.executionTimeNanos, tojson(sort));
+
+// The profiler records the same stats.
+db.setProfilingLevel(2);
+t.find({ a: 3 }).itcount();
+db.setProfilingLevel(0);
+var op = db.system.profile.find({ ns: t.getFullName(), op: "query" }).sort({ $natural: -1 })
+                          .limit(1).next();
+assert.eq("FETCH", op.execStats.stage, tojson(op));
+assert.gt(op.execStats.executionTimeNanos, 0, tojson(op));
+assert.gt(op.execStats.docBytesExamined, 0, tojson(op));
+db.system.profile.drop();
+
+assert.commandWorked(db.adminCommand({ setParameter: 1,
+                                       internalQueryExecStageTiming:
+                                           old.internalQueryExecStageTiming }));
+t.drop();
@@ -0,0 +1,50 @@
+// Checks that _id lookups through the IdLookupCache find the right documents as they are
+// removed, moved and reinserted.
+
+var t = db.idhack_lookup_cache;
+t.drop();
+
+var old = db.adminCommand({ getParameter: 1, internalQueryIdLookupCacheSize: 1 });
+assert.commandWorked(old);
+assert.commandWorked(db.adminCommand({ setParameter: 1, internalQueryIdLookupCacheSize: 100 }));
+
+function idhackStage(id) {
+    var explain = t.find({ _id: id }).explain("executionStats");
+    var stage = explain.executionStats.executionStages;
+    assert.eq("IDHACK", stage.stage, tojson(explain));
+    return stage;
+}
+
+for (var i = 0; i < 10; i++) {
+    t.insert({ _id: i, x: i });
+}
+
+// The first lookup goes through the _id index, the next ones through the cache.
+assert.eq(1, t.findOne({ _id: 3 }).x);
+var stage = idhackStage(3);
+assert(stage.locFromCache, tojson(stage));
+assert.eq(0, stage.keysExamined, tojson(stage));
+assert.eq(1, stage.nReturned, tojson(stage));
+
+// Documents which grow out of their space are found where they moved to.
+t.update({ _id: 3 }, { $set: { pad: new Array(4096).join("x") } });
+assert.eq(3, t.findOne({ _id: 3 }).x);
+assert.eq(3, t.findOne({ _id: 3 }).x);
+
+// Removed documents aren't found, and reinserted ones are.
+t.remove({ _id: 3 });
+assert.eq(null, t.findOne({ _id: 3 }));
+t.insert({ _id: 3, x: 30 });
+assert.eq(30, t.findOne({ _id: 3 }).x);
+assert.eq(30, t.findOne({ _id: 3 }).x);
+
+// Nor is anything once the collection is emptied.
+t.remove({});
+for (var i = 0; i < 10; i++) {
+    assert.eq(null, t.findOne({ _id: i }));
+}
+
+assert.commandWorked(db.adminCommand({ setParameter: 1,
+                                       internalQueryIdLookupCacheSize:
+                                           old.internalQueryIdLookupCacheSize }));
+t.drop();
@@ -0,0 +1,41 @@
+// Checks that an AwaitData getMore on a capped collection returns as soon as a document is
+// inserted, and returns empty once it waited long enough without one.
+
+var t = db.tailable_await_data;
+t.drop();
+assert.commandWorked(db.createCollection(t.getName(), { capped: true, size: 100000 }));
+assert.writeOK(t.insert({ _id: 0 }));
+
+var cursor = t.find().addOption(DBQuery.Option.tailable).addOption(DBQuery.Option.awaitData);
+assert.eq(0, cursor.next()._id);
+
+// Nothing inserted: the getMore waits, then returns no documents.
+var start = new Date();
+assert(!cursor.hasNext());
+var waited = new Date() - start;
+assert.gte(waited, 2000, "awaitData getMore returned too soon");
+
+// An insert from another connection wakes the waiting getMore.
+var join = startParallelShell("sleep(1000); db.tailable_await_data.insert({ _id: 1 });");
+start = new Date();
+assert(cursor.hasNext());
+assert.eq(1, cursor.next()._id);
+waited = new Date() - start;
+join();
+assert.lt(waited, 3500, "awaitData getMore did not wake up for the insert");
+
+// Several inserts in one unit of work are all returned.
+assert.writeOK(t.insert([{ _id: 2 }, { _id: 3 }, { _id: 4 }]));
+[2, 3, 4].forEach(function(id) { assert.eq(id, cursor.next()._id); });
+
+// Dropping the collection ends the wait.
+var join = startParallelShell("sleep(1000); db.tailable_await_data.drop();");
+start = new Date();
+try {
+    cursor.hasNext();
+}
+catch (e) {
+    // The cursor is killed with its collection.
+}
+join();
+assert.lt(new Date() - start, 6000);
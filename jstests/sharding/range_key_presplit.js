@@ -0,0 +1,83 @@
+// Pre-splitting an empty collection with a range shard key at given split points, or at points
+// taken from a sample of keys, spreads the chunks over the shards before any data is loaded.
+
+var s = new ShardingTest({ shards : 3, mongos : 1 });
+var admin = s.getDB("admin");
+var db = s.getDB("test");
+assert.commandWorked(admin.runCommand({ enablesharding : "test" }));
+s.stopBalancer();
+
+function checkChunks(ns, numChunks) {
+    assert.eq(numChunks, s.config.chunks.count({ ns : ns }), "wrong number of chunks");
+    s.config.shards.find().forEach(function(shard) {
+        var onShard = s.config.chunks.count({ ns : ns, shard : shard._id });
+        assert.gte(onShard, Math.floor(numChunks / 3), "chunks not spread to " + shard._id);
+    });
+}
+
+// Explicit split points, given out of order and with a duplicate.
+var splitPoints = [];
+for (var i = 1; i < 12; i++) {
+    splitPoints.push({ a : i * 100, b : "" });
+}
+splitPoints.push(splitPoints[3]);
+splitPoints.reverse();
+assert.commandWorked(admin.runCommand({ shardcollection : "test.points",
+                                        key : { a : 1, b : 1 },
+                                        splitPoints : splitPoints }));
+checkChunks("test.points", 12);
+s.config.chunks.find({ ns : "test.points" }).forEach(function(chunk) {
+    if (chunk.min.a != MinKey) {
+        assert.eq(0, chunk.min.a % 100, tojson(chunk));
+    }
+});
+
+// Sampled keys: whole documents, split into numInitialChunks chunks.
+var samples = [];
+for (var i = 0; i < 1000; i++) {
+    samples.push({ _id : i, x : (i * 7919) % 1000, other : "y" });
+}
+assert.commandWorked(admin.runCommand({ shardcollection : "test.samples",
+                                        key : { x : 1 },
+                                        sampleKeys : samples,
+                                        numInitialChunks : 9 }));
+checkChunks("test.samples", 9);
+
+// The load is spread over the shards from the start.
+var bulk = db.samples.initializeUnorderedBulkOp();
+for (var i = 0; i < 900; i++) {
+    bulk.insert({ x : i });
+}
+assert.writeOK(bulk.execute());
+s.config.shards.find().forEach(function(shard) {
+    var count = new Mongo(shard.host).getDB("test").samples.count();
+    assert.gt(count, 200, "documents didn't go to " + shard._id);
+});
+
+// Bad requests.
+assert.commandFailed(admin.runCommand({ shardcollection : "test.hashed",
+                                        key : { a : "hashed" },
+                                        splitPoints : [{ a : 1 }] }));
+assert.commandFailed(admin.runCommand({ shardcollection : "test.bad",
+                                        key : { a : 1 },
+                                        splitPoints : [{ b : 1 }] }));
+assert.commandFailed(admin.runCommand({ shardcollection : "test.bad",
+                                        key : { a : 1 },
+                                        splitPoints : [{ a : 1 }],
+                                        sampleKeys : [{ a : 1 }] }));
+assert.commandFailed(admin.runCommand({ shardcollection : "test.bad",
+                                        key : { a : 1 },
+                                        splitPoints : [{ a : MinKey }] }));
+
+// Only empty collections are pre-split.
+assert.writeOK(db.full.insert({ a : 1 }));
+assert.commandWorked(db.full.ensureIndex({ a : 1 }));
+assert.commandFailed(admin.runCommand({ shardcollection : "test.full",
+                                        key : { a : 1 },
+                                        splitPoints : [{ a : 5 }] }));
+assert.eq(0, s.config.chunks.count({ ns : "test.full" }));
+
+// Dropping the pre-split collection works on all the shards.
+assert(db.points.drop());
+
+s.stop();
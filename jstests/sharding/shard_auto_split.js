@@ -0,0 +1,43 @@
+//
+// Tests that a shard splits its chunks itself when it counts the writes, even though each mongos
+// only routes part of them and none splits on its own.
+//
+
+var chunkSize = 1; // MB
+
+var st = new ShardingTest({ shards : 1,
+                            mongos : 2,
+                            other : { chunksize : chunkSize,
+                                      mongosOptions : { noAutoSplit : "" } } });
+
+var admin = st.s0.getDB("admin");
+var config = st.s0.getDB("config");
+var ns = "foo.bar";
+
+assert.commandWorked(admin.runCommand({ enableSharding : "foo" }));
+assert.commandWorked(admin.runCommand({ shardCollection : ns, key : { _id : 1 } }));
+
+var shardAdmin = st.shard0.getDB("admin");
+assert.commandWorked(shardAdmin.runCommand({ setParameter : 1, shardAutoSplit : true }));
+
+var data = new Array(50 * 1024).join("x");
+var colls = [ st.s0.getCollection(ns), st.s1.getCollection(ns) ];
+for (var i = 0; i < 100; i++) {
+    // Each mongos sees half of the writes only
+    assert.writeOK(colls[i % 2].insert({ _id : i, data : data }));
+}
+
+assert.soon(function() {
+    return config.chunks.find({ ns : ns }).count() > 1;
+}, "the shard did not split the chunk", 60 * 1000);
+
+var splits = shardAdmin.serverStatus().metrics.sharding.autoSplit;
+printjson(splits);
+assert.gt(splits.splits, 0);
+
+// The chunks cover all of the documents, through both mongoses
+assert.eq(100, colls[0].find().itcount());
+assert.eq(100, colls[1].find().itcount());
+
+st.printShardingStatus();
+st.stop();
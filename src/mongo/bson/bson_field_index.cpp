@@ -0,0 +1,227 @@
+// bson_field_index.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bson_field_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mongo/bson/bsonobjiterator.h"
+
+namespace mongo {
+
+namespace {
+
+    // FNV-1a; field names are short, and this needs nothing but the bytes.
+    uint32_t hashFieldName(const char* name, size_t len) {
+        uint32_t hash = 2166136261U;
+        for (size_t i = 0; i < len; i++) {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+
+    bool fieldNameEquals(const char* element, const char* name, size_t len) {
+        const char* fieldName = element + 1;
+        return memcmp(fieldName, name, len) == 0 && fieldName[len] == '\0';
+    }
+
+    const size_t kInitialSlots = 64;
+
+} // namespace
+
+    BSONFieldIndex::BSONFieldIndex()
+        : _objdata(NULL),
+          _objsize(0),
+          _probes(0),
+          _built(false),
+          _hasDuplicateFields(false),
+          _mask(0) {
+    }
+
+    void BSONFieldIndex::reset() {
+        if (_built) {
+            std::fill(_slots.begin(), _slots.end(), Slot());
+        }
+        _objdata = NULL;
+        _objsize = 0;
+        _probes = 0;
+        _built = false;
+        _hasDuplicateFields = false;
+    }
+
+    void BSONFieldIndex::release() {
+        reset();
+        std::vector<Slot>().swap(_slots);
+    }
+
+    BSONElement BSONFieldIndex::getField(const BSONObj& obj, const StringData& name) const {
+        _track(obj);
+        if (_built || _maybeBuild()) {
+            return _find(name);
+        }
+        return obj.getField(name);
+    }
+
+    BSONElement BSONFieldIndex::getFieldDotted(const BSONObj& obj, const StringData& name) const {
+        BSONElement e = getField(obj, name);
+        if (e.eoo()) {
+            size_t dot_offset = name.find('.');
+            if (dot_offset != std::string::npos) {
+                BSONElement left = getField(obj, name.substr(0, dot_offset));
+                if (left.type() != Object && left.type() != Array) {
+                    return BSONElement();
+                }
+                BSONObj sub = left.embeddedObject();
+                return sub.isEmpty() ? BSONElement() : sub.getFieldDotted(name.substr(dot_offset + 1));
+            }
+        }
+
+        return e;
+    }
+
+    BSONElement BSONFieldIndex::getFieldDottedOrArray(const BSONObj& obj,
+                                                      const char*& name) const {
+        const char* p = strchr(name, '.');
+
+        BSONElement sub;
+
+        if (p) {
+            sub = getField(obj, StringData(name, p - name));
+            name = p + 1;
+        }
+        else {
+            sub = getField(obj, name);
+            name = name + strlen(name);
+        }
+
+        if (sub.eoo())
+            return BSONElement();
+        else if (sub.type() == Array || name[0] == '\0')
+            return sub;
+        else if (sub.type() == Object)
+            return sub.embeddedObject().getFieldDottedOrArray(name);
+        else
+            return BSONElement();
+    }
+
+    bool BSONFieldIndex::expectProbes(const BSONObj& obj, int numProbes) const {
+        _track(obj);
+        if (_built) {
+            return true;
+        }
+        _probes += numProbes - 1;
+        return _maybeBuild();
+    }
+
+    void BSONFieldIndex::_track(const BSONObj& obj) const {
+        if (obj.objdata() != _objdata || obj.objsize() != _objsize) {
+            const_cast<BSONFieldIndex*>(this)->reset();
+            _objdata = obj.objdata();
+            _objsize = obj.objsize();
+        }
+    }
+
+    bool BSONFieldIndex::_maybeBuild() const {
+        if (++_probes < kMinProbes || _objsize < kMinObjSize) {
+            return false;
+        }
+        _build();
+        return true;
+    }
+
+    void BSONFieldIndex::_build() const {
+        if (_slots.empty()) {
+            _slots.resize(kInitialSlots);
+        }
+        _mask = _slots.size() - 1;
+
+        size_t numFields = 0;
+        const BSONObj obj(_objdata);
+        BSONObjIterator it(obj);
+        while (it.more()) {
+            BSONElement e = it.next();
+            const size_t nameLen = e.fieldNameSize() - 1;
+            const Slot slot = { hashFieldName(e.fieldName(), nameLen),
+                                static_cast<uint32_t>(e.rawdata() - _objdata) };
+
+            // Keep the table at most half full.
+            if (2 * (numFields + 1) > _slots.size()) {
+                std::vector<Slot> old(_slots.size() * 2);
+                old.swap(_slots);
+                _mask = _slots.size() - 1;
+                for (size_t i = 0; i < old.size(); i++) {
+                    if (old[i].offset) {
+                        uint32_t j = old[i].hash & _mask;
+                        while (_slots[j].offset) {
+                            j = (j + 1) & _mask;
+                        }
+                        _slots[j] = old[i];
+                    }
+                }
+            }
+
+            uint32_t i = slot.hash & _mask;
+            bool duplicate = false;
+            while (_slots[i].offset) {
+                if (_slots[i].hash == slot.hash &&
+                    fieldNameEquals(_objdata + _slots[i].offset, e.fieldName(), nameLen)) {
+                    duplicate = true;
+                    break;
+                }
+                i = (i + 1) & _mask;
+            }
+
+            if (duplicate) {
+                // The first one wins, as with BSONObj::getField().
+                _hasDuplicateFields = true;
+                continue;
+            }
+            _slots[i] = slot;
+            numFields++;
+        }
+
+        _built = true;
+    }
+
+    BSONElement BSONFieldIndex::_find(const StringData& name) const {
+        const uint32_t hash = hashFieldName(name.rawData(), name.size());
+        for (uint32_t i = hash & _mask; _slots[i].offset; i = (i + 1) & _mask) {
+            if (_slots[i].hash == hash &&
+                fieldNameEquals(_objdata + _slots[i].offset, name.rawData(), name.size())) {
+                return BSONElement(_objdata + _slots[i].offset);
+            }
+        }
+        return BSONElement();
+    }
+
+} // namespace mongo
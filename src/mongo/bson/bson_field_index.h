@@ -0,0 +1,124 @@
+// bson_field_index.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    /**
+     * Finds the top level fields of one large BSONObj by name without scanning it.
+     *
+     * BSONObj::getField() walks the object from the start, which is what most callers want,
+     * but a document with hundreds of fields which is probed for a handful of them (by each
+     * predicate of a filter, then by the projection and the sort) pays for the walk every time.
+     * A BSONFieldIndex counts the probes of the object it is asked about, and on the
+     * kMinProbes'th probe of an object of at least kMinObjSize bytes builds a hash table of
+     * the offsets of its fields in one walk; later probes are a hash lookup.  Probes of small
+     * objects, or of few fields, are answered by BSONObj::getField() as before.
+     *
+     * The lookups have exactly the semantics of the BSONObj methods they are named after: the
+     * first field of a given name wins.  An index is for one object at a time, and starts over
+     * when asked about another one; the object's buffer must not change while it is indexed,
+     * just as with any BSONElement taken from it.  Not thread safe.
+     */
+    class BSONFieldIndex {
+        MONGO_DISALLOW_COPYING(BSONFieldIndex);
+    public:
+        enum {
+            kMinProbes = 3,
+            kMinObjSize = 1024
+        };
+
+        BSONFieldIndex();
+
+        /**
+         * Forgets the object indexed, if any.  Keeps the table's memory for the next one.
+         */
+        void reset();
+
+        /**
+         * Same as reset(), but also frees the table.
+         */
+        void release();
+
+        /** Same as obj.getField(name). */
+        BSONElement getField(const BSONObj& obj, const StringData& name) const;
+
+        /** Same as obj.getFieldDotted(name), with the first part of 'name' looked up here. */
+        BSONElement getFieldDotted(const BSONObj& obj, const StringData& name) const;
+
+        /** Same as obj.getFieldDottedOrArray(name), but for the first part of 'name'. */
+        BSONElement getFieldDottedOrArray(const BSONObj& obj, const char*& name) const;
+
+        /**
+         * For callers about to probe 'obj' for 'numProbes' fields, and which can do without the
+         * index otherwise: counts the probes now, and returns true if 'obj' is indexed.
+         */
+        bool expectProbes(const BSONObj& obj, int numProbes) const;
+
+        /**
+         * True if the object indexed has more than one field of some name.  Only meaningful
+         * once expectProbes() has returned true.
+         */
+        bool hasDuplicateFields() const { return _hasDuplicateFields; }
+
+    private:
+        struct Slot {
+            uint32_t hash;
+            // Offset of the element in the object; 0 marks an empty slot.
+            uint32_t offset;
+        };
+
+        /** Starts over if 'obj' is not the object being indexed. */
+        void _track(const BSONObj& obj) const;
+
+        /** Indexes the object being tracked if it has been probed enough times. */
+        bool _maybeBuild() const;
+
+        void _build() const;
+
+        BSONElement _find(const StringData& name) const;
+
+        mutable const char* _objdata;
+        mutable int _objsize;
+        mutable int _probes;
+        mutable bool _built;
+        mutable bool _hasDuplicateFields;
+        mutable uint32_t _mask;
+        mutable std::vector<Slot> _slots;
+    };
+
+} // namespace mongo
@@ -0,0 +1,127 @@
+// bson_field_index_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bson_field_index.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+namespace {
+
+    BSONObj makeWideObj(int numFields) {
+        BSONObjBuilder b;
+        for (int i = 0; i < numFields; i++) {
+            b.append(std::string(str::stream() << "field" << i), i);
+        }
+        b.append("sub", BSON("x" << 1 << "arr" << BSON_ARRAY(1 << 2)));
+        b.append("arr", BSON_ARRAY(BSON("y" << 2)));
+        return b.obj();
+    }
+
+    TEST(BSONFieldIndex, SmallObjectNotIndexed) {
+        BSONObj obj = BSON("a" << 1 << "b" << 2);
+        BSONFieldIndex index;
+        ASSERT_FALSE(index.expectProbes(obj, 100));
+        ASSERT_EQUALS(2, index.getField(obj, "b").numberInt());
+        ASSERT(index.getField(obj, "c").eoo());
+    }
+
+    TEST(BSONFieldIndex, MatchesGetField) {
+        BSONObj obj = makeWideObj(300);
+        BSONFieldIndex index;
+        for (int i = 0; i < BSONFieldIndex::kMinProbes - 1; i++) {
+            ASSERT_FALSE(index.expectProbes(obj, 1));
+        }
+        ASSERT(index.expectProbes(obj, 1));
+        ASSERT_FALSE(index.hasDuplicateFields());
+
+        BSONObjIterator it(obj);
+        while (it.more()) {
+            BSONElement e = it.next();
+            ASSERT_EQUALS(e.rawdata(), index.getField(obj, e.fieldName()).rawdata());
+        }
+        ASSERT(index.getField(obj, "field300").eoo());
+        ASSERT(index.getField(obj, "").eoo());
+        ASSERT(index.getField(obj, "field1x").eoo());
+        ASSERT(index.getField(obj, "field").eoo());
+    }
+
+    TEST(BSONFieldIndex, Dotted) {
+        BSONObj obj = makeWideObj(300);
+        BSONFieldIndex index;
+        ASSERT(index.expectProbes(obj, BSONFieldIndex::kMinProbes));
+
+        ASSERT_EQUALS(1, index.getFieldDotted(obj, "sub.x").numberInt());
+        ASSERT_EQUALS(2, index.getFieldDotted(obj, "sub.arr.1").numberInt());
+        ASSERT(index.getFieldDotted(obj, "sub.y").eoo());
+        ASSERT(index.getFieldDotted(obj, "field1.x").eoo());
+
+        const char* name = "arr.y";
+        BSONElement e = index.getFieldDottedOrArray(obj, name);
+        ASSERT_EQUALS(Array, e.type());
+        ASSERT_EQUALS("y", std::string(name));
+
+        name = "sub.x";
+        ASSERT_EQUALS(1, index.getFieldDottedOrArray(obj, name).numberInt());
+        ASSERT_EQUALS("", std::string(name));
+    }
+
+    TEST(BSONFieldIndex, DuplicateFieldsFirstWins) {
+        BSONObjBuilder b;
+        b.append("dup", 1);
+        BSONObj wide = makeWideObj(200);
+        b.appendElements(wide);
+        b.append("dup", 2);
+        BSONObj obj = b.obj();
+
+        BSONFieldIndex index;
+        ASSERT(index.expectProbes(obj, BSONFieldIndex::kMinProbes));
+        ASSERT(index.hasDuplicateFields());
+        ASSERT_EQUALS(1, index.getField(obj, "dup").numberInt());
+    }
+
+    TEST(BSONFieldIndex, FollowsObject) {
+        BSONObj first = makeWideObj(300);
+        BSONObj second = BSON("field0" << "other");
+        BSONFieldIndex index;
+        ASSERT(index.expectProbes(first, BSONFieldIndex::kMinProbes));
+        ASSERT_EQUALS(0, index.getField(first, "field0").numberInt());
+        ASSERT_EQUALS("other", index.getField(second, "field0").str());
+        ASSERT_EQUALS(0, index.getField(first, "field0").numberInt());
+
+        index.release();
+        ASSERT_EQUALS(299, index.getField(first, "field299").numberInt());
+    }
+
+} // namespace
+} // namespace mongo
@@ -28,17 +28,39 @@
  */
 
 #include <cstring>
-#include <deque>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "mongo/base/data_view.h"
 #include "mongo/bson/bson_validate.h"
 #include "mongo/bson/oid.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/util/startup_test.h"
 
 namespace mongo {
 
     namespace {
 
+        /**
+         * Like memchr(p, 0, n). Most field names are short, so look at the first 16 bytes
+         * inline with SSE2 (always available on x86-64) before paying for the call.
+         */
+        inline const char* findNul(const char* p, uint64_t n) {
+#if defined(__SSE2__)
+            if (n >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_setzero_si128()));
+                if (mask)
+                    return p + __builtin_ctz(mask);
+                return static_cast<const char*>(memchr(p + 16, 0, n - 16));
+            }
+#endif
+            return static_cast<const char*>(memchr(p, 0, n));
+        }
+
         /**
          * Creates a status with InvalidBSON code and adds information about _id if available.
          * WARNING: only pass in a non-EOO idElem if it has been fully validated already!
@@ -71,10 +93,10 @@ namespace mongo {
             }
 
             Status readCString( StringData* out ) {
-                const void* x = memchr( _buffer + _position, 0, _maxLength - _position );
+                const char* x = findNul( _buffer + _position, _maxLength - _position );
                 if ( !x )
                     return makeError("no end of c-string", _idElem);
-                uint64_t len = static_cast<uint64_t>( static_cast<const char*>(x) - ( _buffer + _position ) );
+                uint64_t len = static_cast<uint64_t>( x - ( _buffer + _position ) );
 
                 StringData data( _buffer + _position, len );
                 _position += len + 1;
@@ -266,8 +288,45 @@ namespace mongo {
             }
         }
 
+        /**
+         * Stack of the objects being validated. Keeps the first kInlineFrames in place, so that
+         * validating a typical document doesn't allocate.
+         */
+        class FrameStack {
+        public:
+            FrameStack() : _size(0) {}
+
+            void push_back(const ValidationObjectFrame& frame) {
+                if (_size < kInlineFrames)
+                    _inline[_size] = frame;
+                else
+                    _overflow.push_back(frame);
+                _size++;
+            }
+
+            void pop_back() {
+                _size--;
+                if (_size >= kInlineFrames)
+                    _overflow.pop_back();
+            }
+
+            ValidationObjectFrame& back() {
+                return _size <= kInlineFrames ? _inline[_size - 1] : _overflow.back();
+            }
+
+            size_t size() const { return _size; }
+            bool empty() const { return _size == 0; }
+
+        private:
+            static const size_t kInlineFrames = 32;
+
+            ValidationObjectFrame _inline[kInlineFrames];
+            std::vector<ValidationObjectFrame> _overflow;
+            size_t _size;
+        };
+
         Status validateBSONIterative(Buffer* buffer) {
-            std::deque<ValidationObjectFrame> frames;
+            FrameStack frames;
             ValidationObjectFrame* curr = NULL;
             ValidationState::State state = ValidationState::BeginObj;
 
@@ -364,6 +423,21 @@ namespace mongo {
             return Status::OK();
         }
 
+        struct FindNulStartupTest : public StartupTest {
+            void run() {
+                char buf[64];
+                for (size_t len = 0; len <= sizeof(buf); len++) {
+                    for (size_t nul = 0; nul < len; nul++) {
+                        memset(buf, 'x', sizeof(buf));
+                        buf[nul] = 0;
+                        verify(findNul(buf, len) == buf + nul);
+                    }
+                    memset(buf, 'x', sizeof(buf));
+                    verify(findNul(buf, len) == NULL);
+                }
+            }
+        } findNulStartupTest;
+
     }  // namespace
 
     Status validateBSON( const char* originalBuffer, uint64_t maxLength ) {
@@ -288,4 +288,26 @@ namespace {
         ASSERT_NOT_OK(status);
         ASSERT_EQUALS(status.reason(), "not null terminated string in object with unknown _id");
     }
+
+    TEST(BSONValidateFast, DeeplyNested) {
+        // Deeper than the validator keeps without allocating.
+        BSONObj x = BSON("x" << 1);
+        for (int i = 0; i < 100; i++) {
+            x = BSON("a" << x << "b" << BSON_ARRAY(i));
+        }
+        ASSERT_OK(validateBSON(x.objdata(), x.objsize()));
+
+        for (int len = x.objsize() - 1; len > 0; len -= 37) {
+            ASSERT_NOT_OK(validateBSON(x.objdata(), len));
+        }
+    }
+
+    TEST(BSONValidateFast, LongFieldNames) {
+        for (int len = 0; len < 40; len++) {
+            const std::string name(len, 'f');
+            BSONObj x = BSON(name << 1 << "_id" << name << name + "x" << BSON(name << name));
+            ASSERT_OK(validateBSON(x.objdata(), x.objsize()));
+            ASSERT_NOT_OK(validateBSON(x.objdata(), 5 + len));
+        }
+    }
 }
@@ -42,15 +42,26 @@ namespace mongo {
     namespace str = mongoutils::str;
 
     string BSONElement::jsonString( JsonStringFormat format, bool includeFieldNames, int pretty ) const {
+        StringBuilder s;
+        jsonString( s, format, includeFieldNames, pretty );
+        return s.str();
+    }
+
+    void BSONElement::jsonString( StringBuilder& s, JsonStringFormat format, bool includeFieldNames,
+                                  int pretty ) const {
         int sign;
 
-        std::stringstream s;
-        if ( includeFieldNames )
-            s << '"' << escape( fieldName() ) << "\" : ";
+        if ( includeFieldNames ) {
+            s << '"';
+            escape( s, fieldName() );
+            s << "\" : ";
+        }
         switch ( type() ) {
         case mongo::String:
         case Symbol:
-            s << '"' << escape( string(valuestr(), valuestrsize()-1) ) << '"';
+            s << '"';
+            escape( s, StringData( valuestr(), valuestrsize()-1 ) );
+            s << '"';
             break;
         case NumberLong:
             if (format == TenGen) {
@@ -68,8 +79,10 @@ namespace mongo {
         case NumberDouble:
             if ( number() >= -std::numeric_limits< double >::max() &&
                  number() <= std::numeric_limits< double >::max() ) {
-                s.precision( 16 );
-                s << number();
+                // As an ostream with precision 16 would print it.
+                char buf[32];
+                const int len = snprintf( buf, sizeof( buf ), "%.16g", number() );
+                s << StringData( buf, len );
             }
             // This is not valid JSON, but according to RFC-4627, "Numeric values that cannot be
             // represented as sequences of digits (such as Infinity and NaN) are not permitted." so
@@ -102,7 +115,7 @@ namespace mongo {
             }
             break;
         case Object:
-            s << embeddedObject().jsonString( format, pretty );
+            embeddedObject().jsonString( s, format, pretty );
             break;
         case mongo::Array: {
             if ( embeddedObject().isEmpty() ) {
@@ -125,7 +138,7 @@ namespace mongo {
                         s << "undefined";
                     }
                     else {
-                        s << e.jsonString( format, false, pretty?pretty+1:0 );
+                        e.jsonString( s, format, false, pretty?pretty+1:0 );
                         e = i.next();
                     }
                     count++;
@@ -145,7 +158,7 @@ namespace mongo {
             s << '"' << valuestr() << "\", ";
             if ( format != TenGen )
                 s << "\"$id\" : ";
-            s << '"' << mongo::OID::from(valuestr() + valuestrsize()) << "\" ";
+            s << '"' << mongo::OID::from(valuestr() + valuestrsize()).toString() << "\" ";
             if ( format == TenGen )
                 s << ')';
             else
@@ -159,7 +172,7 @@ namespace mongo {
             else {
                 s << "{ \"$oid\" : ";
             }
-            s << '"' << __oid() << '"';
+            s << '"' << __oid().toString() << '"';
             if ( format == TenGen ) {
                 s << " )";
             }
@@ -173,12 +186,10 @@ namespace mongo {
             BinDataType type = static_cast<BinDataType>(reader.readLEAndAdvance<uint8_t>());
 
             s << "{ \"$binary\" : \"";
-            base64::encode( s , reader.view() , len );
-            s << "\", \"$type\" : \"" << hex;
-            s.width( 2 );
-            s.fill( '0' );
-            s << type << dec;
-            s << "\" }";
+            s << base64::encode( reader.view() , len );
+            char hexType[16];
+            snprintf( hexType, sizeof( hexType ), "%02x", static_cast<int>( type ) );
+            s << "\", \"$type\" : \"" << hexType << "\" }";
             break;
         }
         case mongo::Date:
@@ -226,11 +237,14 @@ namespace mongo {
             break;
         case RegEx:
             if ( format == Strict ) {
-                s << "{ \"$regex\" : \"" << escape( regex() );
+                s << "{ \"$regex\" : \"";
+                escape( s, regex() );
                 s << "\", \"$options\" : \"" << regexFlags() << "\" }";
             }
             else {
-                s << "/" << escape( regex() , true ) << "/";
+                s << "/";
+                escape( s, regex() , true );
+                s << "/";
                 // FIXME Worry about alpha order?
                 for ( const char *f = regexFlags(); *f; ++f ) {
                     switch ( *f ) {
@@ -248,14 +262,19 @@ namespace mongo {
         case CodeWScope: {
             BSONObj scope = codeWScopeObject();
             if ( ! scope.isEmpty() ) {
-                s << "{ \"$code\" : \"" << escape(_asCode()) << "\" , "
-                  << "\"$scope\" : " << scope.jsonString() << " }";
+                s << "{ \"$code\" : \"";
+                escape( s, _asCode() );
+                s << "\" , " << "\"$scope\" : ";
+                scope.jsonString( s );
+                s << " }";
                 break;
             }
         }
 
         case Code:
-            s << "\"" << escape(_asCode()) << "\"";
+            s << "\"";
+            escape( s, _asCode() );
+            s << "\"";
             break;
 
         case Timestamp:
@@ -282,7 +301,6 @@ namespace mongo {
             string message = ss.str();
             massert( 10312 ,  message.c_str(), false );
         }
-        return s.str();
     }
 
     int BSONElement::getGtLtOp( int def ) const {
@@ -773,8 +791,29 @@ namespace mongo {
     // used by jsonString()
     std::string escape( const std::string& s , bool escape_slash) {
         StringBuilder ret;
-        for ( std::string::const_iterator i = s.begin(); i != s.end(); ++i ) {
-            switch ( *i ) {
+        escape( ret, s, escape_slash );
+        return ret.str();
+    }
+
+    void escape( StringBuilder& ret, const StringData& s, bool escape_slash ) {
+        const char* p = s.rawData();
+        const char* const end = p + s.size();
+        while ( p < end ) {
+            // Copy the run of characters that need no escaping in one go.
+            const char* run = p;
+            while ( run < end &&
+                    static_cast<unsigned char>( *run ) > 0x1f &&
+                    *run != '"' && *run != '\\' && *run != '/' ) {
+                ++run;
+            }
+            if ( run != p ) {
+                ret << StringData( p, run - p );
+                p = run;
+                if ( p == end )
+                    break;
+            }
+
+            switch ( *p ) {
             case '"':
                 ret << "\\\"";
                 break;
@@ -799,18 +838,14 @@ namespace mongo {
             case '\t':
                 ret << "\\t";
                 break;
-            default:
-                if ( *i >= 0 && *i <= 0x1f ) {
-                    //TODO: these should be utf16 code-units not bytes
-                    char c = *i;
-                    ret << "\\u00" << toHexLower(&c, 1);
-                }
-                else {
-                    ret << *i;
-                }
+            default: {
+                //TODO: these should be utf16 code-units not bytes
+                char c = *p;
+                ret << "\\u00" << toHexLower(&c, 1);
             }
+            }
+            ++p;
         }
-        return ret.str();
     }
 
     /* must be same type when called, unless both sides are #s 
@@ -117,6 +117,9 @@ namespace mongo {
         std::string toString( bool includeFieldName = true, bool full=false) const;
         void toString(StringBuilder& s, bool includeFieldName = true, bool full=false, int depth=0) const;
         std::string jsonString( JsonStringFormat format, bool includeFieldNames = true, int pretty = 0 ) const;
+        /** Appends jsonString() to 's', which can be reused across calls to save allocations. */
+        void jsonString( StringBuilder& s, JsonStringFormat format, bool includeFieldNames = true,
+                         int pretty = 0 ) const;
         operator std::string() const { return toString(); }
 
         /** Returns the type of the element */
@@ -655,5 +658,6 @@ namespace mongo {
 
     // TODO(SERVER-14596): move to a better place; take a StringData.
     std::string escape( const std::string& s , bool escape_slash=false);
+    void escape( StringBuilder& ret, const StringData& s, bool escape_slash=false );
 
 }
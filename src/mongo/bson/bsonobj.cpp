@@ -98,16 +98,25 @@ namespace mongo {
     }
 
     string BSONObj::jsonString( JsonStringFormat format, int pretty, bool isArray ) const {
+        StringBuilder s;
+        jsonString( s, format, pretty, isArray );
+        return s.str();
+    }
 
-        if ( isEmpty() ) return isArray ? "[]" : "{}";
+    void BSONObj::jsonString( StringBuilder& s, JsonStringFormat format, int pretty,
+                              bool isArray ) const {
+
+        if ( isEmpty() ) {
+            s << ( isArray ? "[]" : "{}" );
+            return;
+        }
 
-        StringBuilder s;
         s << (isArray ?  "[ " : "{ ");
         BSONObjIterator i(*this);
         BSONElement e = i.next();
         if ( !e.eoo() )
             while ( 1 ) {
-                s << e.jsonString( format, !isArray, pretty?pretty+1:0 );
+                e.jsonString( s, format, !isArray, pretty?pretty+1:0 );
                 e = i.next();
                 if ( e.eoo() )
                     break;
@@ -122,7 +131,6 @@ namespace mongo {
                 }
             }
         s << (isArray ? " ]" : " }");
-        return s.str();
     }
 
     bool BSONObj::valid() const {
@@ -193,6 +193,14 @@ namespace mongo {
             bool isArray = false
         ) const;
 
+        /** Appends jsonString() to 's', which can be reused across calls to save allocations. */
+        void jsonString(
+            StringBuilder& s,
+            JsonStringFormat format = Strict,
+            int pretty = 0,
+            bool isArray = false
+        ) const;
+
         /** note: addFields always adds _id even if not specified */
         int addFields(BSONObj& from, std::set<std::string>& fields); /* returns n added */
 
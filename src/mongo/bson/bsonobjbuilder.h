@@ -73,6 +73,22 @@ namespace mongo {
             _b.skip(sizeof(int));
         }
 
+        /**
+         * Builds in a buffer recycled by 'arena', if not NULL; see BufBuilderArena.  Meant for
+         * temporary objects: done() rather than obj() keeps the buffer with the arena.
+         */
+        BSONObjBuilder(BufBuilderArena* arena, int initsize=512)
+            : _b(_buf)
+            , _buf(arena, sizeof(BSONObj::Holder) + initsize)
+            , _offset(sizeof(BSONObj::Holder))
+            , _s(this)
+            , _tracker(0)
+            , _doneCalled(false) {
+            // See the comments in the first constructor for details.
+            _b.skip(sizeof(BSONObj::Holder));
+            _b.skip(sizeof(int));
+        }
+
         /** @param baseBuilder construct a BSONObjBuilder using an existing BufBuilder
          *  This is for more efficient adding of subobjects/arrays. See docs for subobjStart for example.
          */
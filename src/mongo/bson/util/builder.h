@@ -41,6 +41,7 @@
 #include "mongo/base/data_view.h"
 #include "mongo/base/string_data.h"
 #include "mongo/bson/inline_decls.h"
+#include "mongo/bson/util/builder_arena.h"
 #include "mongo/util/allocator.h"
 #include "mongo/util/assert_util.h"
 
@@ -78,9 +79,37 @@ namespace mongo {
 
     class TrivialAllocator { 
     public:
-        void* Malloc(size_t sz) { return mongoMalloc(sz); }
-        void* Realloc(void *p, size_t sz) { return mongoRealloc(p, sz); }
-        void Free(void *p) { free(p); }
+        TrivialAllocator() : _arena(NULL), _capacity(0) { }
+
+        /** Draw blocks from 'arena' rather than malloc; see BufBuilderArena. */
+        void setArena(BufBuilderArena* arena) { _arena = arena; }
+
+        void* Malloc(size_t sz) {
+            if ( _arena )
+                return _arena->allocate(sz, &_capacity);
+            return mongoMalloc(sz);
+        }
+        void* Realloc(void *p, size_t sz) {
+            if ( _arena ) {
+                if ( !p )
+                    return _arena->allocate(sz, &_capacity);
+                if ( sz <= _capacity )
+                    return p;
+                return _arena->reallocate(p, _capacity, sz, &_capacity);
+            }
+            return mongoRealloc(p, sz);
+        }
+        void Free(void *p) {
+            if ( _arena ) {
+                if ( p )
+                    _arena->release(p, _capacity);
+                return;
+            }
+            free(p);
+        }
+    private:
+        BufBuilderArena* _arena;
+        size_t _capacity;
     };
 
     class StackAllocator {
@@ -117,15 +146,16 @@ namespace mongo {
         Allocator al;
     public:
         _BufBuilder(int initsize = 512) : size(initsize) {
-            if ( size > 0 ) {
-                data = (char *) al.Malloc(size);
-                if( data == 0 )
-                    msgasserted(10000, "out of memory BufBuilder");
-            }
-            else {
-                data = 0;
-            }
-            l = 0;
+            init();
+        }
+
+        /**
+         * Takes the buffer from 'arena', if not NULL, and gives it back on destruction.  Only
+         * for BufBuilder; the arena must outlive the builder.
+         */
+        _BufBuilder(BufBuilderArena* arena, int initsize) : size(initsize) {
+            al.setArena(arena);
+            init();
         }
         ~_BufBuilder() { kill(); }
 
@@ -237,6 +267,18 @@ namespace mongo {
         }
 
     private:
+        void init() {
+            if ( size > 0 ) {
+                data = (char *) al.Malloc(size);
+                if( data == 0 )
+                    msgasserted(10000, "out of memory BufBuilder");
+            }
+            else {
+                data = 0;
+            }
+            l = 0;
+        }
+
         template<typename T>
         void appendNumImpl(T t) {
             // NOTE: For now, we assume that all things written
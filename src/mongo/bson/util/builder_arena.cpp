@@ -0,0 +1,151 @@
+// builder_arena.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/util/builder_arena.h"
+
+#include <algorithm>
+#include <boost/static_assert.hpp>
+#include <cstdlib>
+#include <cstring>
+
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/threadlocal.h"
+
+namespace mongo {
+
+namespace {
+
+    // The innermost BufBuilderArena::Scope of each thread.
+    ThreadLocalValue<BufBuilderArena::Scope*> currentScope;
+
+    /**
+     * Returns the index of the smallest size class holding 'size' bytes, or -1 if 'size' is
+     * larger than kMaxBlockSize.
+     */
+    int sizeClassFor(size_t size) {
+        size_t blockSize = BufBuilderArena::kMinBlockSize;
+        for (int i = 0; i < BufBuilderArena::kNumSizeClasses; i++) {
+            if (size <= blockSize) {
+                return i;
+            }
+            blockSize *= 2;
+        }
+        return -1;
+    }
+
+    size_t sizeOfClass(int sizeClass) {
+        return static_cast<size_t>(BufBuilderArena::kMinBlockSize) << sizeClass;
+    }
+
+} // namespace
+
+    BufBuilderArena::BufBuilderArena() {
+        BOOST_STATIC_ASSERT(kMinBlockSize << (kNumSizeClasses - 1) == kMaxBlockSize);
+    }
+
+    BufBuilderArena::~BufBuilderArena() {
+        for (int i = 0; i < kNumSizeClasses; i++) {
+            for (int j = 0; j < _freeLists[i].count; j++) {
+                free(_freeLists[i].blocks[j]);
+            }
+        }
+    }
+
+    void* BufBuilderArena::allocate(size_t size, size_t* capacity) {
+        _stats.allocations++;
+
+        const int sizeClass = sizeClassFor(size);
+        if (sizeClass < 0) {
+            *capacity = size;
+            return malloc(size);
+        }
+
+        FreeList& freeList = _freeLists[sizeClass];
+        *capacity = sizeOfClass(sizeClass);
+        if (freeList.count > 0) {
+            _stats.reused++;
+            return freeList.blocks[--freeList.count];
+        }
+        return malloc(*capacity);
+    }
+
+    void* BufBuilderArena::reallocate(void* p, size_t oldCapacity, size_t size,
+                                      size_t* capacity) {
+        void* block = allocate(size, capacity);
+        if (!block) {
+            return NULL;
+        }
+        memcpy(block, p, std::min(oldCapacity, *capacity));
+        release(p, oldCapacity);
+        return block;
+    }
+
+    void BufBuilderArena::release(void* p, size_t capacity) {
+        const int sizeClass = sizeClassFor(capacity);
+        if (sizeClass >= 0 && sizeOfClass(sizeClass) == capacity) {
+            FreeList& freeList = _freeLists[sizeClass];
+            if (freeList.count < kMaxCachedPerSizeClass) {
+                freeList.blocks[freeList.count++] = p;
+                return;
+            }
+        }
+        free(p);
+    }
+
+    BufBuilderArena* BufBuilderArena::current() {
+        Scope* scope = currentScope.get();
+        return scope ? scope->_arena : NULL;
+    }
+
+    BufBuilderArena::Scope::Scope(BufBuilderArena* arena)
+        : _arena(arena),
+          _enclosing(currentScope.get()) {
+        currentScope.set(this);
+    }
+
+    BufBuilderArena::Scope::~Scope() {
+        Scope* scope = currentScope.get();
+        if (scope == this) {
+            currentScope.set(_enclosing);
+            return;
+        }
+
+        // Ended out of order: unlink from the scope nested inside us.
+        for (; scope; scope = scope->_enclosing) {
+            if (scope->_enclosing == this) {
+                scope->_enclosing = _enclosing;
+                return;
+            }
+        }
+        dassert(false);
+    }
+
+} // namespace mongo
@@ -0,0 +1,135 @@
+// builder_arena.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/client/export_macros.h"
+
+namespace mongo {
+
+    /**
+     * Recycles the buffers of short-lived BufBuilders (and so BSONObjBuilders) for the duration
+     * of one operation.  A builder constructed with an arena takes its buffer from the arena's
+     * free lists and hands it back when it is destroyed, so the many temporary objects built
+     * while matching, projecting, updating and generating keys for each document stop going
+     * through malloc and free.  Whatever is still cached is freed in bulk when the arena goes.
+     *
+     * Buffers come in power of two sizes from kMinBlockSize to kMaxBlockSize and are ordinary
+     * malloc() blocks, so a buffer which escapes through BufBuilder::decouple() or
+     * BSONObjBuilder::obj() is simply no longer the arena's, and is free()d by its new owner
+     * as usual.  Larger buffers bypass the free lists.
+     *
+     * An arena is not thread safe, and must outlive every builder that draws from it.
+     */
+    class MONGO_CLIENT_API BufBuilderArena {
+        MONGO_DISALLOW_COPYING(BufBuilderArena);
+    public:
+        enum {
+            kMinBlockSize = 512,
+            kMaxBlockSize = 64 * 1024,
+            kNumSizeClasses = 8,
+            // Blocks cached per size class; any more are freed when returned.
+            kMaxCachedPerSizeClass = 4
+        };
+
+        /**
+         * Allocation statistics, for OpDebug.
+         */
+        struct Stats {
+            Stats() : allocations(0), reused(0) { }
+
+            // Buffers handed out, including those that grew into a larger block.
+            long long allocations;
+            // Of those, the number served from a free list rather than by malloc().
+            long long reused;
+        };
+
+        BufBuilderArena();
+        ~BufBuilderArena();
+
+        /**
+         * Returns a block of at least 'size' bytes, or NULL if out of memory.  '*capacity' is
+         * set to the usable size of the block, which must be passed back to reallocate() and
+         * release().
+         */
+        void* allocate(size_t size, size_t* capacity);
+
+        /**
+         * Moves the first 'oldCapacity' bytes of 'p' to a block of at least 'size' bytes and
+         * returns 'p' to the free lists.  Returns NULL if out of memory, in which case 'p' is
+         * still valid.
+         */
+        void* reallocate(void* p, size_t oldCapacity, size_t size, size_t* capacity);
+
+        /**
+         * Takes back a block obtained from this arena.
+         */
+        void release(void* p, size_t capacity);
+
+        const Stats& stats() const { return _stats; }
+
+        /**
+         * The arena of the operation running on this thread, or NULL; see Scope.
+         */
+        static BufBuilderArena* current();
+
+        /**
+         * Makes 'arena' the current arena of this thread for the lifetime of the Scope.  Scopes
+         * nest; one which ends out of order simply drops out, and never leaves a destroyed
+         * arena current.  A Scope must be destroyed on the thread that created it.
+         */
+        class MONGO_CLIENT_API Scope {
+            MONGO_DISALLOW_COPYING(Scope);
+        public:
+            explicit Scope(BufBuilderArena* arena);
+            ~Scope();
+
+        private:
+            friend class BufBuilderArena;
+
+            BufBuilderArena* const _arena;
+            Scope* _enclosing;
+        };
+
+    private:
+        struct FreeList {
+            FreeList() : count(0) { }
+
+            void* blocks[kMaxCachedPerSizeClass];
+            int count;
+        };
+
+        FreeList _freeLists[kNumSizeClasses];
+        Stats _stats;
+    };
+
+} // namespace mongo
@@ -30,6 +30,7 @@
 #include "mongo/unittest/unittest.h"
 
 #include "mongo/bson/util/builder.h"
+#include "mongo/db/jsobj.h"
 
 namespace mongo {
     TEST( Builder, String1 ) {
@@ -67,4 +68,78 @@ namespace mongo {
         sb << nullPtr;
         ASSERT_EQUALS("0x0", sb.str());
     }
+
+    TEST(Builder, ArenaRecyclesBuffers) {
+        BufBuilderArena arena;
+        const void* first;
+        {
+            BufBuilder bb(&arena, 100);
+            bb.appendStr("hello");
+            first = bb.buf();
+        }
+        {
+            BufBuilder bb(&arena, 200);
+            ASSERT_EQUALS(first, static_cast<const void*>(bb.buf()));
+            bb.appendStr("world");
+            ASSERT_EQUALS(0, strcmp(bb.buf(), "world"));
+        }
+        ASSERT_EQUALS(2, arena.stats().allocations);
+        ASSERT_EQUALS(1, arena.stats().reused);
+    }
+
+    TEST(Builder, ArenaGrow) {
+        BufBuilderArena arena;
+        BufBuilder bb(&arena, 16);
+        for (int i = 0; i < 100000; i++) {
+            bb.appendNum(i);
+        }
+        for (int i = 0; i < 100000; i++) {
+            ASSERT_EQUALS(i, ConstDataView(bb.buf() + i * sizeof(int)).readLE<int>());
+        }
+    }
+
+    TEST(Builder, ArenaBSONObjEscapes) {
+        BufBuilderArena arena;
+        BSONObj escaped;
+        {
+            BSONObjBuilder b(&arena);
+            b.append("a", 1);
+            escaped = b.obj();
+        }
+        {
+            // The escaped buffer belongs to 'escaped' now, and must not be handed out again.
+            BSONObjBuilder b(&arena);
+            ASSERT_NOT_EQUALS(static_cast<const void*>(escaped.objdata()),
+                              static_cast<const void*>(b.bb().buf() + sizeof(BSONObj::Holder)));
+            b.append("b", 2);
+            ASSERT_EQUALS(BSON("b" << 2), b.done());
+        }
+        ASSERT_EQUALS(BSON("a" << 1), escaped);
+        ASSERT_EQUALS(0, arena.stats().reused);
+    }
+
+    TEST(Builder, ArenaScope) {
+        ASSERT(!BufBuilderArena::current());
+        BufBuilderArena outer;
+        BufBuilderArena inner;
+        {
+            BufBuilderArena::Scope outerScope(&outer);
+            ASSERT_EQUALS(&outer, BufBuilderArena::current());
+            {
+                BufBuilderArena::Scope innerScope(&inner);
+                ASSERT_EQUALS(&inner, BufBuilderArena::current());
+            }
+            ASSERT_EQUALS(&outer, BufBuilderArena::current());
+        }
+        ASSERT(!BufBuilderArena::current());
+
+        // Out of order: ending the outer scope first leaves the inner one current, and ending
+        // that leaves no arena at all.
+        BufBuilderArena::Scope* outerScope = new BufBuilderArena::Scope(&outer);
+        BufBuilderArena::Scope* innerScope = new BufBuilderArena::Scope(&inner);
+        delete outerScope;
+        ASSERT_EQUALS(&inner, BufBuilderArena::current());
+        delete innerScope;
+        ASSERT(!BufBuilderArena::current());
+    }
 }
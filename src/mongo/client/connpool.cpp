@@ -180,6 +180,17 @@ namespace mongo {
         _created++;
     }
 
+    int PoolForHost::numToWarm() const {
+        if ( _created == 0 || _minIdlePoolSize <= 0 )
+            return 0;
+
+        int target = _minIdlePoolSize;
+        if ( _maxPoolSize >= 0 )
+            target = std::min( target, _maxPoolSize );
+
+        return std::max( 0, target - numAvailable() );
+    }
+
     void PoolForHost::initializeHostName(const std::string& hostName) {
         if (_hostName.empty()) {
             _hostName = hostName;
@@ -193,29 +204,51 @@ namespace mongo {
     const int PoolForHost::kPoolSizeUnlimited(-1);
 
     DBConnectionPool::DBConnectionPool()
-        : _mutex("DBConnectionPool") , 
-          _name( "dbconnectionpool" ) , 
+        : _name( "dbconnectionpool" ) , 
           _maxPoolSize(PoolForHost::kPoolSizeUnlimited) ,
+          _minIdlePoolSize(0) ,
           _hooks( new list<DBConnectionHook*>() ) {
     }
 
-    DBClientBase* DBConnectionPool::_get(const string& ident , double socketTimeout ) {
+    DBConnectionPool::Stripe& DBConnectionPool::_getStripe( const string& ident ) {
+        // hash only what serverNameCompare compares, so that equal hosts share a stripe
+        unsigned hash = 0;
+        for ( const char* p = ident.c_str(); *p != '\0' && *p != '/'; ++p )
+            hash = hash * 31 + static_cast<unsigned char>( *p );
+        return _stripes[hash % kNumStripes];
+    }
+
+    DBClientBase* DBConnectionPool::_get(const string& ident,
+                                         double socketTimeout,
+                                         const Timer& waited) {
         uassert(17382, "Can't use connection pool during shutdown",
                 !inShutdown());
-        scoped_lock L(_mutex);
-        PoolForHost& p = _pools[PoolKey(ident,socketTimeout)];
+        Stripe& stripe = _getStripe(ident);
+        scoped_lock L(stripe.mutex);
+        PoolForHost& p = stripe.pools[PoolKey(ident,socketTimeout)];
         p.setMaxPoolSize(_maxPoolSize);
+        p.setMinIdlePoolSize(_minIdlePoolSize);
         p.initializeHostName(ident);
-        return p.get( this , socketTimeout );
+
+        DBClientBase* c = p.get( this , socketTimeout );
+        if ( c )
+            p.checkedOut( waited.micros() );
+        return c;
     }
 
-    DBClientBase* DBConnectionPool::_finishCreate( const string& host , double socketTimeout , DBClientBase* conn ) {
+    DBClientBase* DBConnectionPool::_finishCreate( const string& host,
+                                                   double socketTimeout,
+                                                   DBClientBase* conn,
+                                                   const Timer& waited ) {
         {
-            scoped_lock L(_mutex);
-            PoolForHost& p = _pools[PoolKey(host,socketTimeout)];
+            Stripe& stripe = _getStripe(host);
+            scoped_lock L(stripe.mutex);
+            PoolForHost& p = stripe.pools[PoolKey(host,socketTimeout)];
             p.setMaxPoolSize(_maxPoolSize);
+            p.setMinIdlePoolSize(_minIdlePoolSize);
             p.initializeHostName(host);
             p.createdOne( conn );
+            p.checkedOut( waited.micros() );
         }
         
         try {
@@ -231,7 +264,8 @@ namespace mongo {
     }
 
     DBClientBase* DBConnectionPool::get(const ConnectionString& url, double socketTimeout) {
-        DBClientBase * c = _get( url.toString() , socketTimeout );
+        Timer waited;
+        DBClientBase * c = _get( url.toString() , socketTimeout, waited );
         if ( c ) {
             try {
                 onHandedOut( c );
@@ -247,11 +281,12 @@ namespace mongo {
         c = url.connect( errmsg, socketTimeout );
         uassert( 13328 ,  _name + ": connect failed " + url.toString() + " : " + errmsg , c );
 
-        return _finishCreate( url.toString() , socketTimeout , c );
+        return _finishCreate( url.toString() , socketTimeout , c, waited );
     }
 
     DBClientBase* DBConnectionPool::get(const string& host, double socketTimeout) {
-        DBClientBase * c = _get( host , socketTimeout );
+        Timer waited;
+        DBClientBase * c = _get( host , socketTimeout, waited );
         if ( c ) {
             try {
                 onHandedOut( c );
@@ -270,7 +305,7 @@ namespace mongo {
         c = cs.connect( errmsg, socketTimeout );
         if ( ! c )
             throw SocketException( SocketException::CONNECT_ERROR , host , 11002 , str::stream() << _name << " error: " << errmsg );
-        return _finishCreate( host , socketTimeout , c );
+        return _finishCreate( host , socketTimeout , c, waited );
     }
 
     void DBConnectionPool::onRelease(DBClientBase* conn) {
@@ -286,8 +321,9 @@ namespace mongo {
     void DBConnectionPool::release(const string& host, DBClientBase *c) {
         onRelease(c);
 
-        scoped_lock L(_mutex);
-        _pools[PoolKey(host,c->getSoTimeout())].done(this,c);
+        Stripe& stripe = _getStripe(host);
+        scoped_lock L(stripe.mutex);
+        stripe.pools[PoolKey(host,c->getSoTimeout())].done(this,c);
     }
 
 
@@ -296,25 +332,32 @@ namespace mongo {
     }
 
     void DBConnectionPool::flush() {
-        scoped_lock L(_mutex);
-        for ( PoolMap::iterator i = _pools.begin(); i != _pools.end(); i++ ) {
-            PoolForHost& p = i->second;
-            p.flush();
+        for ( int s = 0; s < kNumStripes; s++ ) {
+            scoped_lock L(_stripes[s].mutex);
+            PoolMap& pools = _stripes[s].pools;
+            for ( PoolMap::iterator i = pools.begin(); i != pools.end(); i++ ) {
+                PoolForHost& p = i->second;
+                p.flush();
+            }
         }
     }
 
     void DBConnectionPool::clear() {
-        scoped_lock L(_mutex);
         LOG(2) << "Removing connections on all pools owned by " << _name  << endl;
-        for (PoolMap::iterator iter = _pools.begin(); iter != _pools.end(); ++iter) {
-            iter->second.clear();
+        for ( int s = 0; s < kNumStripes; s++ ) {
+            scoped_lock L(_stripes[s].mutex);
+            PoolMap& pools = _stripes[s].pools;
+            for (PoolMap::iterator iter = pools.begin(); iter != pools.end(); ++iter) {
+                iter->second.clear();
+            }
         }
     }
 
     void DBConnectionPool::removeHost( const string& host ) {
-        scoped_lock L(_mutex);
         LOG(2) << "Removing connections from all pools for host: " << host << endl;
-        for ( PoolMap::iterator i = _pools.begin(); i != _pools.end(); ++i ) {
+        Stripe& stripe = _getStripe(host);
+        scoped_lock L(stripe.mutex);
+        for ( PoolMap::iterator i = stripe.pools.begin(); i != stripe.pools.end(); ++i ) {
             const string& poolHost = i->first.ident;
             if ( !serverNameCompare()(host, poolHost) && !serverNameCompare()(poolHost, host) ) {
                 // hosts are the same
@@ -358,14 +401,17 @@ namespace mongo {
 
         int avail = 0;
         long long created = 0;
+        long long checkouts = 0;
+        long long checkoutWaitMicros = 0;
 
 
         map<ConnectionString::ConnectionType,long long> createdByType;
         
         BSONObjBuilder bb( b.subobjStart( "hosts" ) );
-        {
-            scoped_lock lk( _mutex );
-            for ( PoolMap::iterator i=_pools.begin(); i!=_pools.end(); ++i ) {
+        for ( int stripe = 0; stripe < kNumStripes; stripe++ ) {
+            scoped_lock lk( _stripes[stripe].mutex );
+            PoolMap& pools = _stripes[stripe].pools;
+            for ( PoolMap::iterator i=pools.begin(); i!=pools.end(); ++i ) {
                 if ( i->second.numCreated() == 0 )
                     continue;
 
@@ -374,10 +420,14 @@ namespace mongo {
                 BSONObjBuilder temp( bb.subobjStart( s ) );
                 temp.append( "available" , i->second.numAvailable() );
                 temp.appendNumber( "created" , i->second.numCreated() );
+                temp.appendNumber( "checkouts" , i->second.numCheckouts() );
+                temp.appendNumber( "checkoutWaitMicros" , i->second.checkoutWaitMicros() );
                 temp.done();
 
                 avail += i->second.numAvailable();
                 created += i->second.numCreated();
+                checkouts += i->second.numCheckouts();
+                checkoutWaitMicros += i->second.checkoutWaitMicros();
 
                 long long& x = createdByType[i->second.type()];
                 x += i->second.numCreated();
@@ -413,6 +463,8 @@ namespace mongo {
 
         b.append( "totalAvailable" , avail );
         b.appendNumber( "totalCreated" , created );
+        b.appendNumber( "totalCheckouts" , checkouts );
+        b.appendNumber( "totalCheckoutWaitMicros" , checkoutWaitMicros );
     }
 
     bool DBConnectionPool::serverNameCompare::operator()( const string& a , const string& b ) const{
@@ -461,8 +513,9 @@ namespace mongo {
         }
 
         {
-            scoped_lock sl(_mutex);
-            PoolForHost& pool = _pools[PoolKey(hostName, conn->getSoTimeout())];
+            Stripe& stripe = _getStripe(hostName);
+            scoped_lock sl(stripe.mutex);
+            PoolForHost& pool = stripe.pools[PoolKey(hostName, conn->getSoTimeout())];
             if (pool.isBadSocketCreationTime(conn->getSockCreationMicroSec())) {
                 return false;
             }
@@ -473,13 +526,19 @@ namespace mongo {
 
     void DBConnectionPool::taskDoWork() { 
         vector<DBClientBase*> toDelete;
+        vector< pair<PoolKey, int> > toWarm;
         
-        {
+        for ( int s = 0; s < kNumStripes; s++ ) {
             // we need to get the connections inside the lock
             // but we can actually delete them outside
-            scoped_lock lk( _mutex );
-            for ( PoolMap::iterator i=_pools.begin(); i!=_pools.end(); ++i ) {
+            scoped_lock lk( _stripes[s].mutex );
+            PoolMap& pools = _stripes[s].pools;
+            for ( PoolMap::iterator i=pools.begin(); i!=pools.end(); ++i ) {
                 i->second.getStaleConnections( toDelete );
+
+                int needed = i->second.numToWarm();
+                if ( needed > 0 )
+                    toWarm.push_back( make_pair( i->first, needed ) );
             }
         }
 
@@ -492,6 +551,43 @@ namespace mongo {
                 // we don't care if there was a socket error
             }
         }
+
+        // connecting is slow, so the idle pools are topped up outside the locks
+        for ( size_t i = 0; i < toWarm.size() && ! inShutdown(); i++ ) {
+            _warmHost( toWarm[i].first.ident, toWarm[i].first.timeout, toWarm[i].second );
+        }
+    }
+
+    void DBConnectionPool::_warmHost( const string& ident, double socketTimeout, int count ) {
+        string errmsg;
+        ConnectionString cs = ConnectionString::parse( ident, errmsg );
+        if ( ! cs.isValid() )
+            return;
+
+        for ( int i = 0; i < count && ! inShutdown(); i++ ) {
+            DBClientBase* conn = NULL;
+            try {
+                conn = cs.connect( errmsg, socketTimeout );
+                if ( ! conn ) {
+                    LOG(1) << _name << ": could not warm connection to " << ident
+                           << causedBy( errmsg ) << endl;
+                    return;
+                }
+                onCreate( conn );
+            }
+            catch ( const std::exception& e ) {
+                LOG(1) << _name << ": could not warm connection to " << ident
+                       << causedBy( e ) << endl;
+                delete conn;
+                return;
+            }
+
+            Stripe& stripe = _getStripe( ident );
+            scoped_lock L( stripe.mutex );
+            PoolForHost& p = stripe.pools[PoolKey( ident, socketTimeout )];
+            p.createdOne( conn );
+            p.done( this, conn );
+        }
     }
 
     // ------ ScopedDbConnection ------
@@ -36,6 +36,7 @@
 #include "mongo/platform/atomic_word.h"
 #include "mongo/platform/cstdint.h"
 #include "mongo/util/background.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -56,14 +57,20 @@ namespace mongo {
             _created(0),
             _minValidCreationTimeMicroSec(0),
             _type(ConnectionString::INVALID),
-            _maxPoolSize(kPoolSizeUnlimited) {
+            _maxPoolSize(kPoolSizeUnlimited),
+            _minIdlePoolSize(0),
+            _checkouts(0),
+            _checkoutWaitMicros(0) {
         }
 
         PoolForHost(const PoolForHost& other) :
             _created(other._created),
             _minValidCreationTimeMicroSec(other._minValidCreationTimeMicroSec),
             _type(other._type),
-            _maxPoolSize(other._maxPoolSize) {
+            _maxPoolSize(other._maxPoolSize),
+            _minIdlePoolSize(other._minIdlePoolSize),
+            _checkouts(other._checkouts),
+            _checkoutWaitMicros(other._checkoutWaitMicros) {
             verify(_created == 0);
             verify(other._pool.size() == 0);
         }
@@ -80,11 +87,34 @@ namespace mongo {
          */
         void setMaxPoolSize( int maxPoolSize ) { _maxPoolSize = maxPoolSize; }
 
+        /**
+         * Sets the number of idle connections the background task keeps in the pool
+         */
+        void setMinIdlePoolSize( int minIdlePoolSize ) { _minIdlePoolSize = minIdlePoolSize; }
+
         int numAvailable() const { return (int)_pool.size(); }
 
         void createdOne( DBClientBase * base );
         long long numCreated() const { return _created; }
 
+        /**
+         * @return how many connections must be created to bring the idle connections up to the
+         *     minimum, capped by the maximum pool size.  Hosts we never connected to are not
+         *     warmed.
+         */
+        int numToWarm() const;
+
+        /**
+         * Records a connection handed out 'waitMicros' after it was asked for, including the
+         * connect time if a new connection was needed.
+         */
+        void checkedOut( long long waitMicros ) {
+            _checkouts++;
+            _checkoutWaitMicros += waitMicros;
+        }
+        long long numCheckouts() const { return _checkouts; }
+        long long checkoutWaitMicros() const { return _checkoutWaitMicros; }
+
         ConnectionString::ConnectionType type() const { verify(_created); return _type; }
 
         /**
@@ -138,6 +168,12 @@ namespace mongo {
 
         // The maximum number of connections we'll save in the pool
         int _maxPoolSize;
+
+        // The number of idle connections the background task tops the pool up to
+        int _minIdlePoolSize;
+
+        long long _checkouts;
+        long long _checkoutWaitMicros;
     };
 
     class DBConnectionHook {
@@ -190,6 +226,13 @@ namespace mongo {
          */
         void setMaxPoolSize( int maxPoolSize ) { _maxPoolSize = maxPoolSize; }
 
+        /**
+         * Sets the number of idle connections kept per-host.  Once a host has been connected to,
+         * the periodic task creates connections in the background until this many are idle, so
+         * checkouts after a burst don't pay for the connect.  0, the default, disables this.
+         */
+        void setMinIdlePoolSize( int minIdlePoolSize ) { _minIdlePoolSize = minIdlePoolSize; }
+
         void onCreate( DBClientBase * conn );
         void onHandedOut( DBClientBase * conn );
         void onDestroy( DBClientBase * conn );
@@ -235,9 +278,17 @@ namespace mongo {
     private:
         DBConnectionPool( DBConnectionPool& p );
 
-        DBClientBase* _get( const std::string& ident , double socketTimeout );
+        DBClientBase* _get( const std::string& ident , double socketTimeout, const Timer& waited );
 
-        DBClientBase* _finishCreate( const std::string& ident , double socketTimeout, DBClientBase* conn );
+        DBClientBase* _finishCreate( const std::string& ident,
+                                     double socketTimeout,
+                                     DBClientBase* conn,
+                                     const Timer& waited );
+
+        /**
+         * Connects up to 'count' new connections to 'ident' and adds them to its idle pool.
+         */
+        void _warmHost( const std::string& ident, double socketTimeout, int count );
 
         struct PoolKey {
             PoolKey( const std::string& i , double t ) : ident( i ) , timeout( t ) {}
@@ -251,7 +302,21 @@ namespace mongo {
 
         typedef std::map<PoolKey,PoolForHost,poolKeyCompare> PoolMap; // servername -> pool
 
-        mongo::mutex _mutex;
+        /**
+         * The host pools are striped by host name so that checkouts and releases for different
+         * hosts don't contend on one mutex.  A host always maps to the same stripe.
+         */
+        struct Stripe {
+            Stripe() : mutex("DBConnectionPool::Stripe") {}
+
+            mongo::mutex mutex;
+            PoolMap pools;
+        };
+
+        static const int kNumStripes = 16;
+
+        Stripe& _getStripe( const std::string& ident );
+
         std::string _name;
 
         // The maximum number of connections we'll save in the pool per-host
@@ -259,7 +324,10 @@ namespace mongo {
         // 0 effectively disables the pool
         int _maxPoolSize;
 
-        PoolMap _pools;
+        // The number of idle connections per-host the background task maintains, 0 for none
+        int _minIdlePoolSize;
+
+        Stripe _stripes[kNumStripes];
 
         // pointers owned by me, right now they leak on shutdown
         // _hooks itself also leaks because it creates a shutdown race condition
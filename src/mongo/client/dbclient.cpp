@@ -45,6 +45,7 @@
 #include "mongo/s/stale_exception.h"  // for RecvStaleConfigException
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/net/ssl_options.h"
 #include "mongo/util/password_digest.h"
@@ -1047,10 +1048,32 @@ namespace mongo {
         int sslModeVal = sslGlobalParams.sslMode.load();
         if (sslModeVal == SSLGlobalParams::SSLMode_preferSSL ||
             sslModeVal == SSLGlobalParams::SSLMode_requireSSL) {
-            return p->secure( sslManager(), _server.host() );
+            if ( !p->secure( sslManager(), _server.host() ) ) {
+                return false;
+            }
         }
 #endif
 
+        if ( isMessageCompressionEnabled() ) {
+            // Servers which don't know about compression ignore the request, and we carry on
+            // uncompressed.
+            BSONObjBuilder cmd;
+            cmd.append( "isMaster", 1 );
+            appendMessageCompressionRequest( &cmd );
+            BSONObj reply;
+            try {
+                if ( runCommand( "admin", cmd.obj(), reply ) ) {
+                    finishMessageCompressionNegotiation( reply, p.get() );
+                }
+            }
+            catch ( const DBException& e ) {
+                errmsg = str::stream() << "couldn't connect to server " << toString()
+                                       << ", isMaster failed: " << e.toString();
+                _failed = true;
+                return false;
+            }
+        }
+
         return true;
     }
 
@@ -40,12 +40,56 @@
 #include "mongo/client/sasl_client_authenticate.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/s/stale_exception.h"  // for RecvStaleConfigException
 #include "mongo/util/log.h"
+#include "mongo/util/net/socket_poll.h"
 
 namespace mongo {
 
 namespace {
 
+    /**
+     * Waits up to 'millis' (forever if negative) for a reply to arrive on any of the 'n'
+     * connections. Returns the index of a connection with a reply, or -1 if there is none.
+     */
+    int waitForReply(DBClientConnection** conns, int n, int millis) {
+        pollfd fds[2];
+        verify(n <= 2);
+        for (int i = 0; i < n; i++) {
+            fds[i].fd = conns[i]->port().psock->rawFD();
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        if (socketPoll(fds, n, millis) <= 0)
+            return -1;
+
+        for (int i = 0; i < n; i++) {
+            if (fds[i].revents)
+                return i;
+        }
+        return -1;
+    }
+
+    /**
+     * Receives the reply of a findOne started with DBClientCursor::initLazy(), with the same
+     * semantics as DBClientInterface::findOne().
+     */
+    BSONObj finishFindOne(DBClientCursor* cursor, const string& ns) {
+        bool retry = false;
+        uassert(10276, str::stream() << "DBClientBase::findN: transport error: "
+                                     << cursor->originalHost() << " ns: " << ns,
+                cursor->initLazyFinish(retry));
+
+        if (cursor->hasResultFlag(ResultFlag_ShardConfigStale)) {
+            BSONObj error;
+            cursor->peekError(&error);
+            throw RecvStaleConfigException("findN stale config", error);
+        }
+
+        return cursor->more() ? cursor->nextSafe().copy() : BSONObj();
+    }
+
     /*
      * Set of commands that can be used with $readPreference
      */
@@ -163,6 +207,7 @@ namespace {
 
     const size_t DBClientReplicaSet::MAX_RETRY = 3;
     bool DBClientReplicaSet::_authPooledSecondaryConn = true;
+    int DBClientReplicaSet::_hedgedReadDelayMillis = -1;
 
     DBClientReplicaSet::DBClientReplicaSet( const string& name , const vector<HostAndPort>& servers, double so_timeout )
         : _setName( name ), _so_timeout( so_timeout ) {
@@ -602,6 +647,12 @@ namespace {
                         break;
                     }
 
+                    if (_hedgedReadDelayMillis >= 0 && conn != _master.get() &&
+                            isPollSupported()) {
+                        return _hedgedFindOne(conn, *readPref, ns, query, fieldsToReturn,
+                                              queryOptions);
+                    }
+
                     return conn->findOne(ns,query,fieldsToReturn,queryOptions);
                 }
                 catch ( const DBException &dbExcep ) {
@@ -720,33 +771,101 @@ namespace {
             return _master.get();
         }
 
+        _lastSlaveOkConn.reset(_getPooledSecondaryConn(_lastSlaveOkHost));
+
+        LOG( 3 ) << "dbclient_rs selecting node " << _lastSlaveOkHost << endl;
+
+        return _lastSlaveOkConn.get();
+    }
+
+    DBClientConnection* DBClientReplicaSet::_getPooledSecondaryConn(const HostAndPort& host) {
         // Needs to perform a dynamic_cast because we need to set the replSet
         // callback. We should eventually not need this after we remove the
         // callback.
         DBClientConnection* newConn = dynamic_cast<DBClientConnection*>(
-                pool.get(_lastSlaveOkHost.toString(), _so_timeout));
+                pool.get(host.toString(), _so_timeout));
 
-        // Assert here instead of returning NULL since the contract of this method is such
-        // that returning NULL means none of the nodes were good, which is not the case here.
-        uassert(16532, str::stream() << "Failed to connect to " << _lastSlaveOkHost.toString(),
+        // Assert here instead of returning NULL since the contract of selectNodeUsingTags is
+        // such that returning NULL means none of the nodes were good, which is not the case here.
+        uassert(16532, str::stream() << "Failed to connect to " << host.toString(),
                 newConn != NULL);
 
-        _lastSlaveOkConn.reset(newConn);
-        _lastSlaveOkConn->setReplSetClientCallback(this);
-        _lastSlaveOkConn->setRunCommandHook(_runCommandHook);
-        _lastSlaveOkConn->setPostRunCommandHook(_postRunCommandHook);
+        newConn->setReplSetClientCallback(this);
+        newConn->setRunCommandHook(_runCommandHook);
+        newConn->setPostRunCommandHook(_postRunCommandHook);
 
         if (_authPooledSecondaryConn) {
-            _auth(_lastSlaveOkConn.get());
+            _auth(newConn);
         }
         else {
             // Mongos pooled connections are authenticated through
             // ShardingConnectionHook::onCreate().
         }
 
-        LOG( 3 ) << "dbclient_rs selecting node " << _lastSlaveOkHost << endl;
+        return newConn;
+    }
 
-        return _lastSlaveOkConn.get();
+    BSONObj DBClientReplicaSet::_hedgedFindOne(DBClientConnection* conn,
+                                               const ReadPreferenceSetting& readPref,
+                                               const string& ns,
+                                               const Query& query,
+                                               const BSONObj* fieldsToReturn,
+                                               int queryOptions) {
+        verify(conn == _lastSlaveOkConn.get());
+
+        // nToReturn of 1 gets a single batch, so neither reply leaves a cursor open that the
+        // loser would have to kill.
+        std::auto_ptr<DBClientCursor> first(new DBClientCursor(conn, ns, query.obj, 1, 0,
+                                                               fieldsToReturn, queryOptions, 0));
+        first->initLazy();
+
+        DBClientConnection* conns[2] = { conn, NULL };
+        if (waitForReply(conns, 1, _hedgedReadDelayMillis) == 0)
+            return finishFindOne(first.get(), ns);
+
+        // Look for another member to also ask. Selection is randomized, so try a few times.
+        HostAndPort hedgeHost;
+        ReplicaSetMonitorPtr monitor = _getMonitor();
+        for (int attempt = 0; attempt < 3 && hedgeHost.empty(); attempt++) {
+            HostAndPort candidate = monitor->getHostOrRefresh(readPref);
+            if (!candidate.empty() && candidate != _lastSlaveOkHost &&
+                    !monitor->isPrimary(candidate)) {
+                hedgeHost = candidate;
+            }
+        }
+        if (hedgeHost.empty())
+            return finishFindOne(first.get(), ns);
+
+        std::auto_ptr<DBClientConnection> hedgeConn;
+        std::auto_ptr<DBClientCursor> hedge;
+        try {
+            hedgeConn.reset(_getPooledSecondaryConn(hedgeHost));
+            hedge.reset(new DBClientCursor(hedgeConn.get(), ns, query.obj, 1, 0, fieldsToReturn,
+                                           queryOptions, 0));
+            hedge->initLazy();
+        }
+        catch (const DBException& e) {
+            LOG(1) << "dbclient_rs couldn't hedge read on " << hedgeHost << causedBy(e);
+            return finishFindOne(first.get(), ns);
+        }
+
+        LOG(3) << "dbclient_rs hedging read to " << _lastSlaveOkHost << " on " << hedgeHost;
+
+        conns[1] = hedgeConn.get();
+        if (waitForReply(conns, 2, _so_timeout > 0 ? int(_so_timeout * 1000) : -1) != 1) {
+            // The hedge's reply is still outstanding, so its connection can't go back to the
+            // pool. Closing it makes the member drop the reply.
+            return finishFindOne(first.get(), ns);
+        }
+
+        // Likewise, the slow member's reply is outstanding: close that connection rather than
+        // return it to the pool, and read from the hedge from now on.
+        first.reset();
+        delete _lastSlaveOkConn.release();
+        _lastSlaveOkHost = hedgeHost;
+        _lastSlaveOkConn.reset(hedgeConn.release());
+
+        return finishFindOne(hedge.get(), ns);
     }
 
     void DBClientReplicaSet::say(Message& toSend, bool isRetry, string* actualServer) {
@@ -1025,6 +1144,10 @@ namespace {
         _authPooledSecondaryConn = setting;
     }
 
+    void DBClientReplicaSet::setHedgedReadDelayMillis(int millis) {
+        _hedgedReadDelayMillis = millis;
+    }
+
     void DBClientReplicaSet::resetMaster() {
         if (_master.get() == _lastSlaveOkConn.get()) {
             _lastSlaveOkConn.release();
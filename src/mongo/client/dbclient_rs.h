@@ -181,6 +181,13 @@ namespace mongo {
          */
         static void setAuthPooledSecondaryConn(bool setting);
 
+        /**
+         * @param millis if >= 0, a findOne sent to a secondary that hasn't been answered after
+         *    this many milliseconds is also sent to another eligible secondary, and the first
+         *    reply wins. The loser's connection is closed. Negative, the default, disables this.
+         */
+        static void setHedgedReadDelayMillis(int millis);
+
     protected:
         /** Authorize.  Authorizes all nodes as needed
         */
@@ -214,6 +221,24 @@ namespace mongo {
          */
         DBClientConnection* selectNodeUsingTags(shared_ptr<ReadPreferenceSetting> readPref);
 
+        /**
+         * Gets a pooled connection to a non-primary member, set up and authenticated for use
+         * by this object. The caller owns the returned connection, which is never NULL.
+         */
+        DBClientConnection* _getPooledSecondaryConn(const HostAndPort& host);
+
+        /**
+         * findOne on 'conn', which must be _lastSlaveOkConn and not the primary, hedged on a
+         * second member matching 'readPref' if 'conn' is slow to reply. If the second member
+         * wins, its connection becomes _lastSlaveOkConn.
+         */
+        BSONObj _hedgedFindOne(DBClientConnection* conn,
+                               const ReadPreferenceSetting& readPref,
+                               const std::string& ns,
+                               const Query& query,
+                               const BSONObj* fieldsToReturn,
+                               int queryOptions);
+
         /**
          * @return true if the last host used in the last slaveOk query is still in the
          * set and can be used for the given read preference.
@@ -252,6 +277,9 @@ namespace mongo {
         // TODO: remove this when processes other than mongos uses the driver version.
         static bool _authPooledSecondaryConn;
 
+        // Milliseconds before a secondary findOne is hedged, negative to never hedge.
+        static int _hedgedReadDelayMillis;
+
         // Throws a DBException if the monitor doesn't exist and there isn't a cached seed to use.
         ReplicaSetMonitorPtr _getMonitor() const;
 
@@ -148,20 +148,26 @@ namespace mongo {
     }
 
     void DBClientCursor::requestMore() {
+        if ( exhaust() ) {
+            // the server sends the next batch on its own
+            exhaustReceiveMore();
+            return;
+        }
+
         verify( cursorId && batch.pos == batch.nReturned );
 
+        if ( _lazyMorePending ) {
+            requestMoreLazyFinish();
+            return;
+        }
+
         if (haveLimit) {
             nToReturn -= batch.nReturned;
             verify(nToReturn > 0);
         }
-        BufBuilder b;
-        b.appendNum(opts);
-        b.appendStr(ns);
-        b.appendNum(nextBatchSize());
-        b.appendNum(cursorId);
 
         Message toSend;
-        toSend.setData(dbGetMore, b.buf(), b.len());
+        _assembleGetMore( toSend );
         auto_ptr<Message> response(new Message());
 
         if ( _client ) {
@@ -181,6 +187,95 @@ namespace mongo {
         }
     }
 
+    void DBClientCursor::_assembleGetMore( Message& toSend ) {
+        BufBuilder b;
+        b.appendNum(opts);
+        b.appendStr(ns);
+        b.appendNum(nextBatchSize());
+        b.appendNum(cursorId);
+        toSend.setData(dbGetMore, b.buf(), b.len());
+    }
+
+    bool DBClientCursor::requestMoreLazy() {
+        if ( _lazyMorePending )
+            return true;
+
+        // a limit is accounted for when a batch is used up, see requestMore()
+        if ( !cursorId || haveLimit || tailable() || exhaust() )
+            return false;
+
+        if ( _client && !_client->lazySupported() )
+            return false;
+
+        Message toSend;
+        _assembleGetMore( toSend );
+
+        if ( _client ) {
+            _client->say( toSend );
+        }
+        else {
+            verify( _scopedHost.size() );
+            auto_ptr<ScopedDbConnection> conn( new ScopedDbConnection( _scopedHost ) );
+            if ( !conn->get()->lazySupported() ) {
+                conn->done();
+                return false;
+            }
+            conn->get()->say( toSend );
+            _lazyMoreConn = conn.release();
+        }
+
+        _lazyMorePending = true;
+        return true;
+    }
+
+    void DBClientCursor::requestMoreLazyFinish() {
+        verify( _lazyMorePending );
+        _lazyMorePending = false;
+
+        auto_ptr<Message> response(new Message());
+
+        if ( !_lazyMoreConn ) {
+            if ( !_client->recv( *response ) ) {
+                uasserted( 28622, "recv failed for a lazy getMore" );
+            }
+            batch.m = response;
+            dataReceived();
+            return;
+        }
+
+        // a connection which fails is not returned to the pool
+        scoped_ptr<ScopedDbConnection> conn( _lazyMoreConn );
+        _lazyMoreConn = NULL;
+        if ( !conn->get()->recv( *response ) ) {
+            uasserted( 28622, "recv failed for a lazy getMore" );
+        }
+        _client = conn->get();
+        this->batch.m = response;
+        dataReceived();
+        _client = 0;
+        conn->done();
+    }
+
+    void DBClientCursor::cancelRequestMoreLazy() {
+        if ( !_lazyMorePending )
+            return;
+        _lazyMorePending = false;
+
+        // the server may still have the cursor open, the destructor kills it
+        scoped_ptr<ScopedDbConnection> conn( _lazyMoreConn );
+        _lazyMoreConn = NULL;
+        DBClientBase* client = conn ? conn->get() : _client;
+
+        Message response;
+        if ( !client->recv( response ) ) {
+            warning() << "recv failed while canceling a lazy getMore on " << ns << endl;
+            return;
+        }
+        if ( conn ) {
+            conn->done();
+        }
+    }
+
     /** with QueryOption_Exhaust, the server just blasts data at us (marked at end with cursorid==0). */
     void DBClientCursor::exhaustReceiveMore() {
         verify( cursorId && batch.pos == batch.nReturned );
@@ -211,9 +306,10 @@ namespace mongo {
                 throw UserException( 13127 , "getMore: cursor didn't exist on server, possible restart or timeout?" );
         }
 
-        if ( cursorId == 0 || ! ( opts & QueryOption_CursorTailable ) ) {
+        if ( cursorId == 0 || ! ( opts & QueryOption_CursorTailable ) || exhaust() ) {
             // only set initially: we don't want to kill it on end of data
-            // if it's a tailable cursor
+            // if it's a tailable cursor.  an exhaust stream ends when the server
+            // sends a 0 cursor id, so that one is always kept.
             cursorId = qr.getCursorId();
         }
 
@@ -328,6 +424,7 @@ namespace mongo {
 
     void DBClientCursor::attach( AScopedConnection * conn ) {
         verify( _scopedHost.size() == 0 );
+        verify( !_lazyMorePending );
         verify( conn );
         verify( conn->get() );
 
@@ -352,6 +449,10 @@ namespace mongo {
     DBClientCursor::~DBClientCursor() {
         DESTRUCTOR_GUARD (
 
+        if ( _lazyMorePending && ! inShutdown() ) {
+            cancelRequestMoreLazy();
+        }
+
         if ( cursorId && _ownCursor && ! inShutdown() ) {
             BufBuilder b;
             b.appendNum( (int)0 ); // reserved
@@ -40,6 +40,7 @@
 namespace mongo {
 
     class AScopedConnection;
+    class ScopedDbConnection;
 
     /** for mock purposes only -- do not create variants of DBClientCursor, nor hang code here
         @see DBClientMockCursor
@@ -123,6 +124,9 @@ namespace mongo {
 
         bool tailable() const { return (opts & QueryOption_CursorTailable) != 0; }
 
+        /** the server streams the batches of an exhaust cursor without getMore requests */
+        bool exhaust() const { return (opts & QueryOption_Exhaust) != 0; }
+
         /** see ResultFlagType (constants.h) for flag values
             mostly these flags are for internal purposes -
             ResultFlag_ErrSet is the possible exception to that
@@ -135,6 +139,32 @@ namespace mongo {
         /// Change batchSize after construction. Can change after requesting first batch.
         void setBatchSize(int newBatchSize) { batchSize = newBatchSize; }
 
+        /**
+         * Sends the getMore for the next batch without waiting for the reply, which more()
+         * receives once the current batch is used up, so that the server produces the next
+         * batch while this one is consumed.  Does nothing if a getMore is already pending, the
+         * server has no more results, or the cursor has a limit, is tailable or exhaust.
+         *
+         * A cursor attached to a scoped connection holds a connection from the pool until the
+         * reply is read.  Otherwise its own connection must not be used for anything else, nor the
+         * cursor attached, while a getMore is pending.
+         *
+         * @return true if a getMore is pending
+         */
+        bool requestMoreLazy();
+
+        /**
+         * Reads the reply of a pending lazy getMore, if any, so that the connection can be used
+         * again.  The results of that reply are discarded.
+         */
+        void cancelRequestMoreLazy();
+
+        /** @return whether a getMore sent by requestMoreLazy() has not been received yet */
+        bool lazyMorePending() const { return _lazyMorePending; }
+
+        /** @return the size in bytes of the reply holding the current batch */
+        int currentBatchBytes() const { return batch.m->empty() ? 0 : batch.m->size(); }
+
         DBClientCursor( DBClientBase* client, const std::string &_ns, BSONObj _query, int _nToReturn,
                         int _nToSkip, const BSONObj *_fieldsToReturn, int queryOptions , int bs ) :
             _client(client),
@@ -149,7 +179,9 @@ namespace mongo {
             resultFlags(0),
             cursorId(),
             _ownCursor( true ),
-            wasError( false ) {
+            wasError( false ),
+            _lazyMorePending( false ),
+            _lazyMoreConn( NULL ) {
             _finishConsInit();
         }
 
@@ -165,7 +197,9 @@ namespace mongo {
             resultFlags(0),
             cursorId(_cursorId),
             _ownCursor(true),
-            wasError(false) {
+            wasError(false),
+            _lazyMorePending(false),
+            _lazyMoreConn(NULL) {
             _finishConsInit();
         }
 
@@ -239,10 +273,13 @@ namespace mongo {
         std::string _scopedHost;
         std::string _lazyHost;
         bool wasError;
+        bool _lazyMorePending; // see requestMoreLazy()
+        ScopedDbConnection* _lazyMoreConn; // owned, the connection of a pending lazy getMore
 
         void dataReceived() { bool retry; std::string lazyHost; dataReceived( retry, lazyHost ); }
         void dataReceived( bool& retry, std::string& lazyHost );
         void requestMore();
+        void requestMoreLazyFinish();
         void exhaustReceiveMore(); // for exhaust
 
         // Don't call from a virtual function
@@ -254,6 +291,7 @@ namespace mongo {
 
         // init pieces
         void _assembleInit( Message& toSend );
+        void _assembleGetMore( Message& toSend );
     };
 
     /** iterate over objects in current batch only - will not cause a network call
@@ -42,6 +42,7 @@
 #endif
 
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/util/md5.hpp"
 
 #ifndef MIN
 #define MIN(a,b) ( (a) < (b) ? (a) : (b) )
@@ -52,6 +53,25 @@ namespace mongo {
 
     const unsigned DEFAULT_CHUNK_SIZE = 255 * 1024;
 
+    // Chunks are sent in multi-document inserts of about this many bytes
+    const int CHUNK_BATCH_BYTES = 8 * 1024 * 1024;
+
+    namespace {
+
+        /**
+         * Sends the chunks accumulated in 'batch' as one insert and empties it.
+         */
+        void flushChunks( DBClientBase& client , const string& ns ,
+                          vector<BSONObj>* batch , int* batchBytes ) {
+            if ( batch->empty() )
+                return;
+            client.insert( ns , *batch );
+            batch->clear();
+            *batchBytes = 0;
+        }
+
+    }
+
     GridFSChunk::GridFSChunk( BSONObj o ) {
         _data = o;
     }
@@ -94,17 +114,31 @@ namespace mongo {
         id.init();
         BSONObj idObj = BSON("_id" << id);
 
+        md5_state_t md5;
+        md5_init(&md5);
+
+        vector<BSONObj> batch;
+        int batchBytes = 0;
+
         int chunkNumber = 0;
         while (data < end) {
             int chunkLen = MIN(_chunkSize, (unsigned)(end-data));
+            md5_append(&md5, reinterpret_cast<const md5_byte_t*>(data), chunkLen);
+
             GridFSChunk c(idObj, chunkNumber, data, chunkLen);
-            _client.insert( _chunksNS.c_str() , c._data );
+            batch.push_back( c._data );
+            batchBytes += c._data.objsize();
+            if ( batchBytes >= CHUNK_BATCH_BYTES )
+                flushChunks( _client , _chunksNS , &batch , &batchBytes );
 
             chunkNumber++;
             data += chunkLen;
         }
+        flushChunks( _client , _chunksNS , &batch , &batchBytes );
 
-        return insertFile(remoteName, id, length, contentType);
+        md5digest digest;
+        md5_finish(&md5, digest);
+        return insertFile(remoteName, id, length, digestToString(digest), contentType);
     }
 
 
@@ -122,6 +156,12 @@ namespace mongo {
         id.init();
         BSONObj idObj = BSON("_id" << id);
 
+        md5_state_t md5;
+        md5_init(&md5);
+
+        vector<BSONObj> batch;
+        int batchBytes = 0;
+
         int chunkNumber = 0;
         gridfs_offset length = 0;
         while (!feof(fd)) {
@@ -137,21 +177,31 @@ namespace mongo {
                 verify(chunkLen <= _chunkSize);
             }
 
+            md5_append(&md5, reinterpret_cast<const md5_byte_t*>(buf), chunkLen);
+
             GridFSChunk c(idObj, chunkNumber, buf, chunkLen);
-            _client.insert( _chunksNS.c_str() , c._data );
+            batch.push_back( c._data );
+            batchBytes += c._data.objsize();
+            if ( batchBytes >= CHUNK_BATCH_BYTES )
+                flushChunks( _client , _chunksNS , &batch , &batchBytes );
 
             length += chunkLen;
             chunkNumber++;
             delete[] buf;
         }
+        flushChunks( _client , _chunksNS , &batch , &batchBytes );
 
         if (fd != stdin)
             fclose( fd );
 
-        return insertFile((remoteName.empty() ? fileName : remoteName), id, length, contentType);
+        md5digest digest;
+        md5_finish(&md5, digest);
+        return insertFile((remoteName.empty() ? fileName : remoteName), id, length,
+                          digestToString(digest), contentType);
     }
 
-    BSONObj GridFS::insertFile(const string& name, const OID& id, gridfs_offset length, const string& contentType) {
+    BSONObj GridFS::insertFile(const string& name, const OID& id, gridfs_offset length,
+                               const string& md5, const string& contentType) {
         // Wait for any pending writebacks to finish
         BSONObj errObj = _client.getLastErrorDetailed();
         uassert( 16428,
@@ -159,16 +209,12 @@ namespace mongo {
                                << ", error: " << errObj,
                  DBClientWithCommands::getLastErrorString(errObj) == "" );
 
-        BSONObj res;
-        if ( ! _client.runCommand( _dbName.c_str() , BSON( "filemd5" << id << "root" << _prefix ) , res ) )
-            throw UserException( 9008 , "filemd5 failed" );
-
         BSONObjBuilder file;
         file << "_id" << id
              << "filename" << name
              << "chunkSize" << _chunkSize
              << "uploadDate" << DATENOW
-             << "md5" << res["md5"]
+             << "md5" << md5
              ;
 
         if (length < 1024*1024*1024) { // 2^30
@@ -244,8 +290,20 @@ namespace mongo {
 
         const int num = getNumChunks();
 
+        // One cursor over the chunks in order, rather than a query per chunk, so that the chunks
+        // stream in batches.
+        BSONObjBuilder b;
+        b.appendAs( _obj["_id"] , "files_id" );
+        auto_ptr<DBClientCursor> chunks =
+            _grid->_client.query( _grid->_chunksNS , Query( b.obj() ).sort( "n" ) );
+        uassert( 28624 , "couldn't query chunks of file: " + getFilename() , chunks.get() );
+
         for ( int i=0; i<num; i++ ) {
-            GridFSChunk c = getChunk( i );
+            uassert( 10014 ,  "chunk is empty!" , chunks->more() );
+            GridFSChunk c( chunks->next() );
+            uassert( 28625 , str::stream() << "missing chunk " << i << " of file: "
+                                           << getFilename() ,
+                     c._data["n"].numberInt() == i );
 
             int len;
             const char * data = c.data( len );
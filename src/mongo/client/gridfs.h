@@ -59,6 +59,7 @@ namespace mongo {
     private:
         BSONObj _data;
         friend class GridFS;
+        friend class GridFile;
     };
 
 
@@ -141,7 +142,11 @@ namespace mongo {
         unsigned int _chunkSize;
 
         // insert fileobject. All chunks must be in DB.
-        BSONObj insertFile(const std::string& name, const OID& id, gridfs_offset length, const std::string& contentType);
+        BSONObj insertFile(const std::string& name,
+                           const OID& id,
+                           gridfs_offset length,
+                           const std::string& md5,
+                           const std::string& contentType);
 
         friend class GridFile;
     };
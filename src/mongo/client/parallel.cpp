@@ -37,6 +37,7 @@
 #include "mongo/client/connpool.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/dbmessage.h"
+#include "mongo/db/hasher.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/s/chunk.h"
 #include "mongo/s/chunk_version.h"
@@ -252,6 +253,7 @@ namespace mongo {
         _numServers = _servers.size();
         _lastFrom = 0;
         _cursors = 0;
+        _readAheadBudgetBytes = -1;
 
         if( ! _qSpec.isEmpty() ){
             _needToSkip = _qSpec.ntoskip();
@@ -494,6 +496,144 @@ namespace mongo {
 
     }
 
+    /**
+     * Adds the shard version to a query, as { $query : ..., $shardVersion : [ ts, epoch ] }.
+     */
+    static BSONObj attachShardVersion( const BSONObj& query, const ChunkVersion& version ) {
+        BSONObjBuilder b;
+        if ( Query::isComplex( query ) ) {
+            b.appendElements( query );
+        }
+        else {
+            b.append( "$query", query );
+        }
+        b.appendArray( "$shardVersion", version.toBSON() );
+        return b.obj();
+    }
+
+    /**
+     * Returns 'query' with its filter replaced by 'filter', keeping any $query wrapper.
+     */
+    static BSONObj replaceFilter( const BSONObj& query, const BSONObj& filter ) {
+        bool hasDollar;
+        if ( ! Query::isComplex( query, &hasDollar ) ) {
+            return filter;
+        }
+
+        const StringData filterField = hasDollar ? "$query" : "query";
+        BSONObjBuilder b;
+        BSONObjIterator it( query );
+        while ( it.more() ) {
+            BSONElement e = it.next();
+            if ( e.fieldNameStringData() == filterField ) {
+                b.append( filterField, filter );
+            }
+            else {
+                b.append( e );
+            }
+        }
+        return b.obj();
+    }
+
+    /**
+     * If 'filter' matches a single-field shard key against a plain { $in : [ ... ] } list, fills
+     * 'shardFilters' with a copy of 'filter' per shard, with the $in narrowed to the values whose
+     * chunks live on that shard.  Leaves 'shardFilters' empty when the filter can't be split, in
+     * which case every shard gets the full filter.
+     */
+    static void splitInFilterByShard( const ChunkManager& manager,
+                                      const BSONObj& filter,
+                                      map<Shard, BSONObj>* shardFilters ) {
+
+        const ShardKeyPattern& keyPattern = manager.getShardKeyPattern();
+        if ( keyPattern.toBSON().nFields() != 1 ) return;
+
+        const BSONElement patternEl = keyPattern.toBSON().firstElement();
+        const BSONElement keyEl = filter[ patternEl.fieldNameStringData() ];
+        if ( keyEl.type() != Object ) return;
+
+        const BSONObj predicate = keyEl.embeddedObject();
+        if ( predicate.nFields() != 1 ) return;
+
+        const BSONElement inEl = predicate.firstElement();
+        if ( inEl.fieldNameStringData() != "$in" || inEl.type() != Array ) return;
+
+        // Only plain values route to exactly one chunk; arrays, regexes and nulls can match
+        // documents whose shard key differs from the value itself
+        vector<BSONElement> values;
+        BSONObjIterator valueIt( inEl.embeddedObject() );
+        while ( valueIt.more() ) {
+            BSONElement value = valueIt.next();
+            if ( value.type() == Array || value.type() == RegEx || value.type() == jstNULL
+                 || value.type() == Undefined
+                 || ( value.type() == Object && ! value.embeddedObject().okForStorage() ) ) {
+                return;
+            }
+            values.push_back( value );
+        }
+        if ( values.size() < 2 ) return;
+
+        // A second predicate on the shard key would be lost when rewriting the first
+        int keyPredicates = 0;
+        BSONObjIterator keyIt( filter );
+        while ( keyIt.more() ) {
+            if ( keyIt.next().fieldNameStringData() == patternEl.fieldNameStringData() ) {
+                keyPredicates++;
+            }
+        }
+        if ( keyPredicates != 1 ) return;
+
+        vector<BSONObj> shardKeys;
+        shardKeys.reserve( values.size() );
+        if ( keyPattern.isHashedPattern() ) {
+            vector<long long> hashes;
+            BSONElementHasher::hash64Batch( values, BSONElementHasher::DEFAULT_HASH_SEED,
+                                            &hashes );
+            for ( size_t i = 0; i < hashes.size(); ++i ) {
+                shardKeys.push_back( BSON( patternEl.fieldName() << hashes[i] ) );
+            }
+        }
+        else {
+            for ( size_t i = 0; i < values.size(); ++i ) {
+                BSONObjBuilder keyB;
+                keyB.appendAs( values[i], patternEl.fieldName() );
+                shardKeys.push_back( keyB.obj() );
+            }
+        }
+
+        vector<ChunkPtr> chunks;
+        manager.findIntersectingChunks( shardKeys, &chunks );
+
+        map<Shard, vector<BSONElement> > shardValues;
+        for ( size_t i = 0; i < values.size(); ++i ) {
+            if ( ! chunks[i] ) return;
+            shardValues[ chunks[i]->getShard() ].push_back( values[i] );
+        }
+
+        for ( map<Shard, vector<BSONElement> >::const_iterator it = shardValues.begin();
+              it != shardValues.end(); ++it ) {
+
+            BSONObjBuilder b;
+            BSONObjIterator filterIt( filter );
+            while ( filterIt.more() ) {
+                BSONElement e = filterIt.next();
+                if ( e.fieldNameStringData() != patternEl.fieldNameStringData() ) {
+                    b.append( e );
+                    continue;
+                }
+
+                BSONObjBuilder predicateB( b.subobjStart( e.fieldName() ) );
+                BSONArrayBuilder inB( predicateB.subarrayStart( "$in" ) );
+                for ( size_t i = 0; i < it->second.size(); ++i ) {
+                    inB.append( it->second[i] );
+                }
+                inB.done();
+                predicateB.done();
+            }
+            (*shardFilters)[ it->first ] = b.obj();
+        }
+    }
+
     void ParallelSortClusteredCursor::setupVersionAndHandleSlaveOk(
         PCStatePtr state,
         const Shard& shard,
@@ -537,6 +677,17 @@ namespace mongo {
                           << " The local replica set view and targeting may be stale." << endl;
             }
         }
+        else if ( manager && ! isCommand()
+                  && _staleNSMap.find( ns ) == _staleNSMap.end()
+                  && state->conn->attachVersion( &state->attachedVersion ) ) {
+
+            // The connection was versioned for this namespace before, so the shard can check
+            // the version sent with the query rather than have us set it first.  If it is
+            // stale the query fails, and the retry sets the version on the connection.
+            state->versionAttached = true;
+            LOG( pc ) << "attaching shard version " << state->attachedVersion
+                      << " to query, compatible with " << vinfo << endl;
+        }
         else {
             try {
                 if ( state->conn->setVersion() ) {
@@ -632,6 +783,12 @@ namespace mongo {
         _totalTries++;
         uassert( 15986, "too many retries in total", _totalTries < 10 );
 
+        // Send each shard only the $in values it owns, rather than the whole list
+        map<Shard, BSONObj> shardFilters;
+        if ( manager && todo.size() > 1 && _cInfo.isEmpty() && ! isCommand() ) {
+            splitInFilterByShard( *manager, _qSpec.filter(), &shardFilters );
+        }
+
         for( set<Shard>::iterator i = todo.begin(), end = todo.end(); i != end; ++i ){
 
             const Shard& shard = *i;
@@ -689,6 +846,14 @@ namespace mongo {
                 // Setup cursor
                 if( ! state->cursor ){
 
+                    map<Shard, BSONObj>::const_iterator shardFilter = shardFilters.find( shard );
+                    const BSONObj shardQuery = shardFilter == shardFilters.end() ?
+                        _qSpec.query() : replaceFilter( _qSpec.query(), shardFilter->second );
+
+                    const BSONObj query = state->versionAttached ?
+                        attachShardVersion( shardQuery, state->attachedVersion ) :
+                        shardQuery;
+
                     //
                     // Here we decide whether to split the query limits up for multiple shards.
                     // NOTE: There's a subtle issue here, in that it's possible we target a single
@@ -701,7 +866,7 @@ namespace mongo {
 
                         // Query limits split for multiple shards
 
-                        state->cursor.reset( new DBClientCursor( state->conn->get(), ns, _qSpec.query(),
+                        state->cursor.reset( new DBClientCursor( state->conn->get(), ns, query,
                                                                  isCommand() ? 1 : 0, // nToReturn (0 if query indicates multi)
                                                                  0, // nToSkip
                                                                  // Does this need to be a ptr?
@@ -725,7 +890,7 @@ namespace mongo {
 
                         // Single shard query
 
-                        state->cursor.reset( new DBClientCursor( state->conn->get(), ns, _qSpec.query(),
+                        state->cursor.reset( new DBClientCursor( state->conn->get(), ns, query,
                                                                  _qSpec.ntoreturn(), // nToReturn
                                                                  _qSpec.ntoskip(), // nToSkip
                                                                  // Does this need to be a ptr?
@@ -1478,6 +1643,12 @@ namespace mongo {
         uassert(10019, "no more elements", bestFrom >= 0);
         _cursors[bestFrom].get()->next();
 
+        // Have the shard produce its next batch while we merge this one, rather than waiting for
+        // it once this batch is used up.
+        if (!_cursors[bestFrom].get()->lazyMorePending() && _readAheadAllowed(bestFrom)) {
+            _cursors[bestFrom].get()->requestMoreLazy();
+        }
+
         // Make sure the result data won't go away after the next call to more()
         if (!_cursors[bestFrom].get()->moreInCurrentBatch()) {
             best = best.getOwned();
@@ -1489,6 +1660,22 @@ namespace mongo {
         return best;
     }
 
+    bool ParallelSortClusteredCursor::_readAheadAllowed(int from) const {
+        if (_readAheadBudgetBytes < 0)
+            return true;
+        if (_readAheadBudgetBytes == 0)
+            return false;
+
+        // A pending reply is assumed to be about as large as the batch before it
+        long long inFlight = _cursors[from].get()->currentBatchBytes();
+        for (int i = 0; i < _numServers && inFlight <= _readAheadBudgetBytes; i++) {
+            if (i != from && _cursors[i].get() && _cursors[i].get()->lazyMorePending()) {
+                inFlight += _cursors[i].get()->currentBatchBytes();
+            }
+        }
+        return inFlight <= _readAheadBudgetBytes;
+    }
+
     void ParallelSortClusteredCursor::_explain( map< string,list<BSONObj> >& out ) {
 
         set<Shard> shards;
@@ -37,6 +37,7 @@
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/matcher/matcher.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/s/chunk_version.h"
 #include "mongo/s/shard.h"
 #include "mongo/util/concurrency/mvar.h"
 
@@ -108,7 +109,7 @@ namespace mongo {
     public:
 
         ParallelConnectionState() :
-            count( 0 ), done( false ) { }
+            versionAttached( false ), count( 0 ), done( false ) { }
 
         // Please do not reorder. cursor destructor can use conn.
         // On a related note, never attempt to cleanup these pointers manually.
@@ -119,6 +120,10 @@ namespace mongo {
         ChunkManagerPtr manager;
         ShardPtr primary;
 
+        // Whether the query carries its shard version rather than the connection, and which
+        bool versionAttached;
+        ChunkVersion attachedVersion;
+
         // Cursor status information
         long long count;
         bool done;
@@ -239,9 +244,19 @@ namespace mongo {
 
         void explain(BSONObjBuilder& b);
 
+        /**
+         * Bounds the read-ahead of the shard cursors.  next() only asks a shard for its next
+         * batch early while the replies requested that way, estimated by the size of each
+         * shard's current batch, fit in 'bytes'.  0 disables read-ahead, a negative value, the
+         * default, means no limit.
+         */
+        void setReadAheadBudget(long long bytes) { _readAheadBudgetBytes = bytes; }
+
     private:
         void _finishCons();
 
+        bool _readAheadAllowed(int from) const;
+
         void _explain( std::map< std::string,std::list<BSONObj> >& out );
 
         void _markStaleNS( const NamespaceString& staleNS, const StaleConfigException& e, bool& forceReload, bool& fullReload );
@@ -268,6 +283,8 @@ namespace mongo {
         DBClientCursorHolder * _cursors;
         int _needToSkip;
 
+        long long _readAheadBudgetBytes;
+
         /**
          * Setups the shard version of the connection. When using a replica
          * set connection and the primary cannot be reached, the version
@@ -39,6 +39,7 @@
 #include "mongo/client/connpool.h"
 #include "mongo/client/replica_set_monitor_internal.h"
 #include "mongo/util/concurrency/mutex.h" // for StaticObserver
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/background.h"
 #include "mongo/util/log.h"
 #include "mongo/util/string_map.h"
@@ -69,6 +70,15 @@ namespace {
 
     const double socketTimeoutSecs = 5;
 
+    /**
+     * Contacts the hosts of all scans. Threads are started on demand and exit when idle. It is
+     * never destroyed, so that a thread still waiting on a host can't hold up process exit.
+     */
+    ThreadPool* scanPool() {
+        static ThreadPool* pool = new ThreadPool(0, 64, "ReplicaSetMonitorScan");
+        return pool;
+    }
+
     /*  Replica Set Monitor shared state:
      *      If a program (such as one built with the C++ driver) exits (by either calling exit()
      *      or by returning from main()), static objects will be destroyed in the reverse order
@@ -750,37 +760,45 @@ namespace {
                 _set->cv.wait(lk);
                 continue;
 
-            case NextStep::CONTACT_HOST: {
-                BSONObj reply; // empty on error
-                int64_t pingMicros = 0;
-
+            case NextStep::CONTACT_HOST:
+                // Rather than waiting for this host before asking for the next one, every host
+                // is contacted from the scan pool while we wait for replies. This way one slow
+                // host doesn't delay the others, and we return as soon as any reply matches.
                 DEV _set->checkInvariants();
-                lk.unlock(); // relocked after attempting to call isMaster
-                try {
-                    ScopedDbConnection conn(ConnectionString(ns.host), socketTimeoutSecs);
-                    bool ignoredOutParam = false;
-                    Timer timer;
-                    conn->isMaster(ignoredOutParam, &reply);
-                    pingMicros = timer.micros();
-                    conn.done(); // return to pool on success.
-                }
-                catch (...) {
-                    reply = BSONObj(); // should be a no-op but want to be sure
-                }
-                lk.lock();
+                scanPool()->schedule(&Refresher::_contactHostForScan, _set, _scan, ns.host);
+                continue;
+            }
+        }
+    }
 
-                // Ignore the reply and return if we are no longer the current scan. This might
-                // happen if it was decided that the host we were contacting isn't part of the set.
-                if (_scan != _set->currentScan)
-                    return criteria ? _set->getMatchingHost(*criteria) : HostAndPort();
+    void Refresher::_contactHostForScan(SetStatePtr set, ScanStatePtr scan, HostAndPort host) {
+        BSONObj reply; // empty on error
+        int64_t pingMicros = 0;
 
-                if (reply.isEmpty())
-                    failedHost(ns.host);
-                else
-                    receivedIsMaster(ns.host, pingMicros, reply);
-            }
-            }
+        try {
+            ScopedDbConnection conn(ConnectionString(host), socketTimeoutSecs);
+            bool ignoredOutParam = false;
+            Timer timer;
+            conn->isMaster(ignoredOutParam, &reply);
+            pingMicros = timer.micros();
+            conn.done(); // return to pool on success.
+        }
+        catch (...) {
+            reply = BSONObj(); // should be a no-op but want to be sure
         }
+
+        boost::mutex::scoped_lock lk(set->mutex);
+
+        // Ignore the reply if this is no longer the current scan. This might happen if it was
+        // decided that the host we were contacting isn't part of the set.
+        if (scan != set->currentScan)
+            return;
+
+        Refresher refresher(set); // joins the current scan
+        if (reply.isEmpty())
+            refresher.failedHost(host);
+        else
+            refresher.receivedIsMaster(host, pingMicros, reply);
     }
 
     void IsMasterReply::parse(const BSONObj& obj) {
@@ -326,6 +326,13 @@ namespace mongo {
          */
         HostAndPort _refreshUntilMatches(const ReadPreferenceSetting* criteria);
 
+        /**
+         * Sends isMaster to a host handed out by getNextStep for 'scan' and reports the reply
+         * to 'scan', unless it is no longer the current scan of 'set'. Runs on the scan pool,
+         * so all hosts of a scan are contacted concurrently.
+         */
+        static void _contactHostForScan(SetStatePtr set, ScanStatePtr scan, HostAndPort host);
+
         // Both pointers are never NULL
         SetStatePtr _set;
         ScanStatePtr _scan; // May differ from _set->currentScan if a new scan has started.
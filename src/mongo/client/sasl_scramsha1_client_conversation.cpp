@@ -31,16 +31,77 @@
 #include "mongo/client/sasl_scramsha1_client_conversation.h"
 
 #include <boost/algorithm/string/replace.hpp>
+#include <map>
 
 #include "mongo/base/parse_number.h"
 #include "mongo/client/sasl_client_session.h"
 #include "mongo/platform/random.h"
 #include "mongo/util/base64.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/password_digest.h"
 #include "mongo/util/text.h"
 
 namespace mongo {
+namespace {
+
+    /**
+     * Remembers the SaltedPassword of recent authentications. The salt and iteration count
+     * only change when the user's credentials do, so a client which opens many connections
+     * with the same credentials runs the PBKDF2 derivation once rather than per connection.
+     */
+    class SaltedPasswordCache {
+    public:
+        SaltedPasswordCache() : _mutex("SaltedPasswordCache") {}
+
+        void get(const std::string& hashedPassword,
+                 const std::string& salt,
+                 int iterationCount,
+                 unsigned char saltedPassword[scram::hashSize]) {
+            const std::string key = _makeKey(hashedPassword, salt, iterationCount);
+            {
+                SimpleMutex::scoped_lock lk(_mutex);
+                Entries::const_iterator it = _entries.find(key);
+                if (it != _entries.end()) {
+                    memcpy(saltedPassword, it->second.data(), scram::hashSize);
+                    return;
+                }
+            }
+
+            scram::generateSaltedPassword(hashedPassword,
+                                          reinterpret_cast<const unsigned char*>(salt.c_str()),
+                                          salt.size(),
+                                          iterationCount,
+                                          saltedPassword);
+
+            SimpleMutex::scoped_lock lk(_mutex);
+            if (_entries.size() >= kMaxEntries) {
+                _entries.clear();
+            }
+            _entries[key].assign(reinterpret_cast<const char*>(saltedPassword), scram::hashSize);
+        }
+
+    private:
+        static const size_t kMaxEntries = 64;
+
+        typedef std::map<std::string, std::string> Entries;
+
+        static std::string _makeKey(const std::string& hashedPassword,
+                                    const std::string& salt,
+                                    int iterationCount) {
+            // length prefixed, so that the key stays unambiguous whatever the password contains
+            return mongoutils::str::stream() << hashedPassword.size() << ':' << hashedPassword
+                                             << ':' << iterationCount << ':' << salt;
+        }
+
+        SimpleMutex _mutex;
+        Entries _entries;
+    };
+
+    SaltedPasswordCache saltedPasswordCache;
+
+} // namespace
+
     SaslSCRAMSHA1ClientConversation::SaslSCRAMSHA1ClientConversation(
                                                     SaslClientSession* saslClientSession) :
         SaslClientConversation(saslClientSession),
@@ -172,10 +233,10 @@ namespace mongo {
             return StatusWith<bool>(ex.toStatus());
         }
 
-        scram::generateSaltedPassword(
-                            _saslClientSession->getParameter(SaslClientSession::parameterPassword),
-                            reinterpret_cast<const unsigned char*>(decodedSalt.c_str()),
-                            decodedSalt.size(),
+        saltedPasswordCache.get(
+                            _saslClientSession->getParameter(SaslClientSession::parameterPassword)
+                                                                                .toString(),
+                            decodedSalt,
                             iterationCount,
                             _saltedPassword);
 
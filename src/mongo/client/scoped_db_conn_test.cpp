@@ -242,6 +242,7 @@ namespace mongo_test {
             delete _dummyServer;
 
             mongo::pool.setMaxPoolSize(_maxPoolSizePerHost);
+            mongo::pool.setMinIdlePoolSize(0);
         }
 
     protected:
@@ -400,6 +401,23 @@ namespace mongo_test {
         checkNewConns(assertGreaterThan, badCreationTime, 2);
     }
 
+    TEST_F(DummyServerFixture, WarmIdleConnsToMinimum) {
+        mongo::pool.setMinIdlePoolSize(3);
+
+        ScopedDbConnection conn1(TARGET_HOST);
+        conn1.done();
+
+        // the background task tops the idle pool up to the minimum
+        mongo::pool.taskDoWork();
+
+        mongo::BSONObjBuilder infoBuilder;
+        mongo::pool.appendInfo(infoBuilder);
+        mongo::BSONObj info = infoBuilder.obj();
+
+        ASSERT_EQUALS(3, info["totalAvailable"].numberInt());
+        ASSERT_GREATER_THAN_OR_EQUALS(info["totalCheckouts"].numberLong(), 1LL);
+    }
+
     TEST_F(DummyServerFixture, DontReturnConnGoneBadToPool) {
         ScopedDbConnection conn1(TARGET_HOST);
 
@@ -658,6 +658,12 @@ namespace mongo {
             return;
         }
 
+        // Dropping a reference other than the last one can't free the user, so sessions going
+        // away don't need the cache mutex unless they held the only reference.
+        if (user->decrementRefCountIfNotLast()) {
+            return;
+        }
+
         CacheGuard guard(this, CacheGuard::fetchSynchronizationManual);
         user->decrementRefCount();
         if (user->getRefCount() == 0) {
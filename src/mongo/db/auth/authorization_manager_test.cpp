@@ -215,5 +215,38 @@ namespace {
         authzManager->releaseUser(v2cluster);
     }
 
+    TEST_F(AuthorizationManagerTest, ReleaseSharedUserKeepsItCached) {
+        OperationContextNoop txn;
+
+        ASSERT_OK(externalState->insertPrivilegeDocument(
+                &txn,
+                "admin",
+                BSON("_id" << "admin.v2read" <<
+                     "user" << "v2read" <<
+                     "db" << "test" <<
+                     "credentials" << BSON("MONGODB-CR" << "password") <<
+                     "roles" << BSON_ARRAY(BSON("role" << "read" << "db" << "test"))),
+                BSONObj()));
+
+        User* first;
+        ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &first));
+        User* second;
+        ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &second));
+        ASSERT_EQUALS(first, second);
+        ASSERT_EQUALS(2U, first->getRefCount());
+
+        authzManager->releaseUser(second);
+        ASSERT_EQUALS(1U, first->getRefCount());
+        ASSERT(first->isValid());
+
+        // The remaining reference is still served from the cache
+        User* third;
+        ASSERT_OK(authzManager->acquireUser(&txn, UserName("v2read", "test"), &third));
+        ASSERT_EQUALS(first, third);
+
+        authzManager->releaseUser(third);
+        authzManager->releaseUser(first);
+    }
+
 }  // namespace
 }  // namespace mongo
@@ -34,17 +34,72 @@
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <map>
 
 #include "mongo/crypto/crypto.h"
 #include "mongo/crypto/mechanism_scram.h"
 #include "mongo/platform/random.h"
 #include "mongo/util/base64.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/password_digest.h"
 #include "mongo/util/text.h"
 
 namespace mongo {
+namespace {
+
+    // Use a default value of 5000 for the scramIterationCount when in mixed mode,
+    // overriding the default value (10000) used for SCRAM mode or the user-given value.
+    const int mixedModeScramIterationCount = 5000;
+
+    /**
+     * SCRAM credentials generated on the fly for users which only have MONGODB-CR credentials.
+     * Generating them runs PBKDF2, so they are kept per user and password digest rather than
+     * regenerated for every authentication. A password change yields a different digest, so a
+     * stale entry is never used.
+     */
+    class MixedModeCredentialsCache {
+    public:
+        MixedModeCredentialsCache() : _mutex("MixedModeCredentialsCache") {}
+
+        BSONObj get(const UserName& user, const std::string& password) {
+            const Key key(user.getFullName(), password);
+            {
+                SimpleMutex::scoped_lock lk(_mutex);
+                Entries::const_iterator it = _entries.find(key);
+                if (it != _entries.end()) {
+                    return it->second;
+                }
+            }
+
+            BSONObj scramCreds = scram::generateCredentials(password,
+                                                            mixedModeScramIterationCount);
+
+            SimpleMutex::scoped_lock lk(_mutex);
+            if (_entries.size() >= kMaxEntries) {
+                _entries.clear();
+            }
+            // Another thread may have raced us, keep its credentials so all agree on the salt.
+            std::pair<Entries::iterator, bool> inserted =
+                _entries.insert(std::make_pair(key, scramCreds));
+            return inserted.first->second;
+        }
+
+    private:
+        static const size_t kMaxEntries = 1024;
+
+        typedef std::pair<std::string, std::string> Key;
+        typedef std::map<Key, BSONObj> Entries;
+
+        SimpleMutex _mutex;
+        Entries _entries;
+    };
+
+    MixedModeCredentialsCache mixedModeCredentialsCache;
+
+} // namespace
+
     SaslSCRAMSHA1ServerConversation::SaslSCRAMSHA1ServerConversation(
                                                     SaslAuthenticationSession* saslAuthSession) :
         SaslServerConversation(saslAuthSession),
@@ -160,11 +215,9 @@ namespace mongo {
 
         // Generate SCRAM credentials on the fly for mixed MONGODB-CR/SCRAM mode.
         if (_creds.scram.salt.empty() && !_creds.password.empty()) {
-            // Use a default value of 5000 for the scramIterationCount when in mixed mode,
-            // overriding the default value (10000) used for SCRAM mode or the user-given value.
-            const int mixedModeScramIterationCount = 5000;
-            BSONObj scramCreds = scram::generateCredentials(_creds.password,
-                                                            mixedModeScramIterationCount);
+            BSONObj scramCreds = mixedModeCredentialsCache.get(
+                    UserName(_user, _saslAuthSession->getAuthenticationDatabase()),
+                    _creds.password);
             _creds.scram.iterationCount = scramCreds[scram::iterationCountFieldName].Int();
             _creds.scram.salt = scramCreds[scram::saltFieldName].String();
             _creds.scram.storedKey = scramCreds[scram::storedKeyFieldName].String();
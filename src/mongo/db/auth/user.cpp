@@ -47,7 +47,7 @@ namespace mongo {
         _isValid(1) {}
 
     User::~User() {
-        dassert(_refCount == 0);
+        dassert(_refCount.load() == 0);
     }
 
     const UserName& User::getName() const {
@@ -75,7 +75,7 @@ namespace mongo {
     }
 
     uint32_t User::getRefCount() const {
-        return _refCount;
+        return _refCount.load();
     }
 
     const ActionSet User::getActionsForResource(const ResourcePattern& resource) const {
@@ -153,11 +153,22 @@ namespace mongo {
     }
 
     void User::incrementRefCount() {
-        ++_refCount;
+        _refCount.fetchAndAdd(1);
     }
 
     void User::decrementRefCount() {
-        dassert(_refCount > 0);
-        --_refCount;
+        dassert(_refCount.load() > 0);
+        _refCount.fetchAndSubtract(1);
+    }
+
+    bool User::decrementRefCountIfNotLast() {
+        uint32_t count = _refCount.load();
+        while (count > 1) {
+            const uint32_t seen = _refCount.compareAndSwap(count, count - 1);
+            if (seen == count)
+                return true;
+            count = seen;
+        }
+        return false;
     }
 } // namespace mongo
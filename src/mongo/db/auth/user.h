@@ -196,6 +196,16 @@ namespace mongo {
          */
         void decrementRefCount();
 
+        /**
+         * Decrements the reference count unless this is the last reference, in which case it
+         * returns false and leaves the count alone.  Unlike the other two, this may be called
+         * without holding the AuthorizationManager's lock, since it can never make the User
+         * eligible for destruction.
+         *
+         * This method should *only* be called by the AuthorizationManager.
+         */
+        bool decrementRefCountIfNotLast();
+
     private:
 
         UserName _name;
@@ -214,8 +224,9 @@ namespace mongo {
 
         // _refCount and _isInvalidated are modified exclusively by the AuthorizationManager
         // _isInvalidated can be read by any consumer of User, but _refCount can only be
-        // meaningfully read by the AuthorizationManager, as _refCount is guarded by the AM's _lock
-        uint32_t _refCount;
+        // meaningfully read by the AuthorizationManager.  _refCount only goes to or from zero
+        // under the AM's _lock, other decrements may happen outside it.
+        AtomicUInt32 _refCount;
         AtomicUInt32 _isValid; // Using as a boolean
     };
 
@@ -0,0 +1,339 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/catalog/background_validate.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <third_party/murmurhash3/MurmurHash3.h>
+#include <vector>
+
+#include "mongo/bson/bson_validate.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/client.h"
+#include "mongo/db/exec/index_scan.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/global_environment_experiment.h"
+#include "mongo/db/index/btree_based_access_method.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/internal_plans.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    // The most indexes scanned at once by a background validate
+    MONGO_EXPORT_SERVER_PARAMETER(internalValidateBackgroundThreads, int, 4);
+
+namespace {
+
+    /**
+     * Hashes a (key, DiskLoc) entry of an index.  An index may keep numbers as another numeric
+     * type than the document has them, so they are hashed by value.
+     */
+    unsigned long long hashIndexEntry(const BSONObj& key, const DiskLoc& loc) {
+        BSONObjBuilder b;
+        for (BSONObjIterator it(key); it.more();) {
+            const BSONElement elem = it.next();
+            if (elem.isNumber())
+                b.append("", elem.numberDouble());
+            else
+                b.appendAs(elem, "");
+        }
+        b.append("", (static_cast<long long>(loc.a()) << 32) |
+                     static_cast<unsigned>(loc.getOfs()));
+        const BSONObj entry = b.done();
+
+        unsigned long long hash[2];
+        MurmurHash3_x64_128(entry.objdata(), entry.objsize(), 0, hash);
+        return hash[0];
+    }
+
+    /**
+     * The number of entries of an index and the sum of their hashes, which does not depend on
+     * the order they are added in.
+     */
+    struct IndexEntrySummary {
+        IndexEntrySummary() : count(0), hashSum(0) { }
+
+        void add(const BSONObj& key, const DiskLoc& loc) {
+            count++;
+            hashSum += hashIndexEntry(key, loc);
+        }
+
+        long long count;
+        unsigned long long hashSum;
+    };
+
+    /**
+     * Checks that each document of 'collection' is valid BSON and adds the keys it has in each
+     * of 'indexes' to the matching element of 'summaries'.
+     */
+    Status summarizeRecords(OperationContext* txn,
+                            Collection* collection,
+                            const std::vector<BtreeBasedAccessMethod*>& indexes,
+                            PlanExecutor::YieldPolicy yieldPolicy,
+                            std::vector<IndexEntrySummary>* summaries,
+                            long long* numRecords,
+                            ValidateResults* results) {
+        boost::scoped_ptr<PlanExecutor> exec(
+            InternalPlanner::collectionScan(txn, collection->ns().ns(), collection));
+        if (yieldPolicy == PlanExecutor::YIELD_AUTO) {
+            // Dropping an index kills the executor, so the access methods stay valid.
+            exec->setYieldPolicy(PlanExecutor::YIELD_AUTO);
+        }
+
+        BSONObj obj;
+        DiskLoc loc;
+        BSONObjSet keys;
+        PlanExecutor::ExecState state;
+        while (PlanExecutor::ADVANCED == (state = exec->getNext(&obj, &loc))) {
+            ++*numRecords;
+
+            const Status status = validateBSON(obj.objdata(), obj.objsize());
+            if (!status.isOK()) {
+                results->valid = false;
+                results->errors.push_back(str::stream() << "invalid BSON in the document at "
+                                                        << loc.toString() << ": "
+                                                        << status.reason());
+                continue;
+            }
+
+            for (size_t i = 0; i < indexes.size(); i++) {
+                keys.clear();
+                indexes[i]->getKeysForDocument(obj, &keys);
+                for (BSONObjSet::const_iterator key = keys.begin(); key != keys.end(); ++key) {
+                    (*summaries)[i].add(*key, loc);
+                }
+            }
+        }
+
+        if (PlanExecutor::IS_EOF != state) {
+            return Status(ErrorCodes::OperationFailed,
+                          str::stream() << "scan of " << collection->ns().ns() << " stopped: "
+                                        << PlanExecutor::statestr(state)
+                                        << ", was it or one of its indexes dropped?");
+        }
+        return Status::OK();
+    }
+
+    /**
+     * Adds each entry of the index 'indexName' of 'collection' to 'summary'.
+     */
+    Status summarizeIndex(OperationContext* txn,
+                          Collection* collection,
+                          const std::string& indexName,
+                          PlanExecutor::YieldPolicy yieldPolicy,
+                          IndexEntrySummary* summary) {
+        const IndexDescriptor* descriptor =
+            collection->getIndexCatalog()->findIndexByName(txn, indexName);
+        if (!descriptor) {
+            return Status(ErrorCodes::IndexNotFound,
+                          str::stream() << "index " << indexName << " of "
+                                        << collection->ns().ns() << " was dropped");
+        }
+
+        IndexScanParams params;
+        params.descriptor = descriptor;
+        params.bounds.isSimpleRange = true;
+        // Multikey indexes have an entry per key of a document, so all of them are needed.
+        params.doNotDedup = true;
+
+        WorkingSet* ws = new WorkingSet();
+        IndexScan* root = new IndexScan(txn, params, ws, NULL);
+
+        PlanExecutor* rawExec;
+        // Takes ownership of 'ws' and 'root'.
+        Status status = PlanExecutor::make(txn, ws, root, collection, yieldPolicy, &rawExec);
+        if (!status.isOK())
+            return status;
+        boost::scoped_ptr<PlanExecutor> exec(rawExec);
+
+        BSONObj key;
+        DiskLoc loc;
+        PlanExecutor::ExecState state;
+        while (PlanExecutor::ADVANCED == (state = exec->getNext(&key, &loc))) {
+            summary->add(key, loc);
+        }
+
+        if (PlanExecutor::IS_EOF != state) {
+            return Status(ErrorCodes::OperationFailed,
+                          str::stream() << "scan of index " << indexName << " of "
+                                        << collection->ns().ns() << " stopped: "
+                                        << PlanExecutor::statestr(state));
+        }
+        return Status::OK();
+    }
+
+    void summarizeIndexTask(const NamespaceString* ns,
+                            const std::string* indexName,
+                            IndexEntrySummary* summary,
+                            Status* status) {
+        Client::initThreadIfNotAlready("validate");
+        try {
+            OperationContextImpl txn;
+            AutoGetCollectionForRead ctx(&txn, *ns);
+            Collection* collection = ctx.getCollection();
+            if (!collection) {
+                *status = Status(ErrorCodes::NamespaceNotFound,
+                                 str::stream() << ns->ns() << " was dropped");
+                return;
+            }
+            *status = summarizeIndex(&txn, collection, *indexName, PlanExecutor::YIELD_AUTO,
+                                     summary);
+        }
+        catch (const DBException& e) {
+            *status = e.toStatus();
+        }
+    }
+
+} // namespace
+
+    Status validateCollectionInBackground(OperationContext* txn,
+                                          const NamespaceString& ns,
+                                          ValidateResults* results,
+                                          BSONObjBuilder* output) {
+        // With snapshots, the intent locks held throughout do not keep writers out, and the
+        // documents and the indexes are read as of the same point in time.
+        const bool oneSnapshot = readsFromSnapshots();
+
+        boost::scoped_ptr<AutoGetCollectionForRead> ctx(new AutoGetCollectionForRead(txn, ns));
+        Collection* collection = ctx->getCollection();
+        if (!collection)
+            return Status(ErrorCodes::NamespaceNotFound, "ns not found");
+
+        const unsigned long long writesBefore = collection->getWriteCount();
+
+        std::vector<std::string> indexNames;
+        std::vector<std::string> indexNamespaces;
+        std::vector<BtreeBasedAccessMethod*> indexes;
+        {
+            IndexCatalog* catalog = collection->getIndexCatalog();
+            IndexCatalog::IndexIterator ii = catalog->getIndexIterator(txn, false);
+            while (ii.more()) {
+                IndexDescriptor* descriptor = ii.next();
+                indexNames.push_back(descriptor->indexName());
+                indexNamespaces.push_back(descriptor->indexNamespace());
+                indexes.push_back(
+                    static_cast<BtreeBasedAccessMethod*>(catalog->getIndex(descriptor)));
+            }
+        }
+
+        long long numRecords = 0;
+        std::vector<IndexEntrySummary> expected(indexes.size());
+        Status status = summarizeRecords(txn,
+                                         collection,
+                                         indexes,
+                                         oneSnapshot ? PlanExecutor::YIELD_MANUAL
+                                                     : PlanExecutor::YIELD_AUTO,
+                                         &expected,
+                                         &numRecords,
+                                         results);
+        if (!status.isOK())
+            return status;
+        indexes.clear();
+
+        std::vector<IndexEntrySummary> found(indexNames.size());
+        bool conclusive = true;
+        if (oneSnapshot) {
+            for (size_t i = 0; i < indexNames.size(); i++) {
+                status = summarizeIndex(txn, collection, indexNames[i],
+                                        PlanExecutor::YIELD_MANUAL, &found[i]);
+                if (!status.isOK())
+                    return status;
+            }
+        }
+        else if (!indexNames.empty()) {
+            // The scans take their own locks, so none may be held while waiting for them.
+            ctx.reset();
+
+            std::vector<Status> statuses(indexNames.size(), Status::OK());
+            {
+                const int numThreads =
+                    std::max(1, std::min(static_cast<int>(internalValidateBackgroundThreads),
+                                         static_cast<int>(indexNames.size())));
+                threadpool::ThreadPool pool(numThreads, "validate");
+                for (size_t i = 0; i < indexNames.size(); i++) {
+                    pool.schedule(summarizeIndexTask, &ns, &indexNames[i], &found[i],
+                                  &statuses[i]);
+                }
+                pool.join();
+            }
+            for (size_t i = 0; i < statuses.size(); i++) {
+                if (!statuses[i].isOK())
+                    return statuses[i];
+            }
+
+            ctx.reset(new AutoGetCollectionForRead(txn, ns));
+            collection = ctx->getCollection();
+            if (!collection)
+                return Status(ErrorCodes::NamespaceNotFound, "ns was dropped");
+            conclusive = collection->getWriteCount() == writesBefore;
+        }
+
+        output->appendNumber("nrecords", numRecords);
+        output->append("nIndexes", static_cast<int>(indexNames.size()));
+        BSONObjBuilder keysPerIndex;
+        for (size_t i = 0; i < indexNames.size(); i++) {
+            keysPerIndex.appendNumber(indexNamespaces[i], found[i].count);
+        }
+        output->append("keysPerIndex", keysPerIndex.obj());
+
+        if (!conclusive) {
+            output->append("warning", "the collection was written to during the background "
+                                      "validation, so its indexes were not checked against its "
+                                      "documents");
+            return Status::OK();
+        }
+
+        for (size_t i = 0; i < indexNames.size(); i++) {
+            if (found[i].count != expected[i].count) {
+                results->valid = false;
+                results->errors.push_back(str::stream() << "index " << indexNamespaces[i]
+                                                        << " has " << found[i].count
+                                                        << " entries but the documents have "
+                                                        << expected[i].count << " keys in it");
+            }
+            else if (found[i].hashSum != expected[i].hashSum) {
+                results->valid = false;
+                results->errors.push_back(str::stream() << "the entries of index "
+                                                        << indexNamespaces[i]
+                                                        << " do not match the keys of the"
+                                                        << " documents");
+            }
+        }
+
+        return Status::OK();
+    }
+
+} // namespace mongo
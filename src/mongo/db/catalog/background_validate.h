@@ -0,0 +1,59 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/status.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+    class NamespaceString;
+    class OperationContext;
+    struct ValidateResults;
+
+    /**
+     * Validates the collection 'ns' without keeping writers out of it for long, as the validate
+     * command does with background: true.
+     *
+     * Each document is checked to be valid BSON, and each ready index is checked to hold exactly
+     * the keys the documents have in it, by comparing a count and an order independent hash of
+     * its (key, DiskLoc) entries with those computed from the documents.  On storage engines
+     * which read from snapshots all of this reads one snapshot.  Elsewhere the scans yield, and
+     * the indexes are scanned in parallel; if the collection is written to meanwhile the index
+     * check is inconclusive, which 'output' reports in "warning" without making the collection
+     * invalid.
+     *
+     * Returns a non-OK status if the collection or one of its indexes is dropped meanwhile.
+     */
+    Status validateCollectionInBackground(OperationContext* txn,
+                                          const NamespaceString& ns,
+                                          ValidateResults* results,
+                                          BSONObjBuilder* output);
+
+} // namespace mongo
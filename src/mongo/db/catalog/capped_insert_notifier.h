@@ -0,0 +1,85 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/base/disallow_copying.h"
+
+namespace mongo {
+
+    /**
+     * Lets tailable cursors on a capped collection wait for an insert into it, rather than poll.
+     *
+     * A waiter reads the version before it looks for new documents, and if it finds none, waits
+     * for the version to move past the one it read.  Inserts bump the version when their unit of
+     * work commits, which is when the documents become visible to the waiter.
+     *
+     * Held by a shared_ptr, so that the waiters which hold no lock while they wait can outlive the
+     * Collection.  The Collection kills it when it is destroyed.
+     */
+    class CappedInsertNotifier {
+        MONGO_DISALLOW_COPYING(CappedInsertNotifier);
+    public:
+        CappedInsertNotifier();
+
+        /**
+         * Wakes the waiters.  Called when an insert into the collection commits.
+         */
+        void notifyOfInsert();
+
+        /**
+         * The number of notifyOfInsert() calls so far.
+         */
+        unsigned long long getVersion() const;
+
+        /**
+         * Waits until the version is past 'referenceVersion', the notifier is killed, or
+         * 'timeoutMillis' passed.
+         */
+        void waitForInsert(unsigned long long referenceVersion, int timeoutMillis) const;
+
+        /**
+         * Wakes the waiters for good: the collection is gone.
+         */
+        void kill();
+
+        bool isDead() const;
+
+    private:
+        mutable boost::mutex _mutex;
+        mutable boost::condition_variable _notifier;
+
+        // Guarded by _mutex
+        unsigned long long _version;
+        bool _dead;
+    };
+
+} // namespace mongo
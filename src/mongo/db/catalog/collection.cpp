@@ -72,9 +72,27 @@ namespace mongo {
 
         ss << " validateDocuments: " << validateDocuments;
 
+        if ( online )
+            ss << " online maxExtents: " << maxExtents;
+
         return ss.str();
     }
 
+    namespace {
+        class NotifyCappedInsertChange : public RecoveryUnit::Change {
+        public:
+            explicit NotifyCappedInsertChange( const boost::shared_ptr<CappedInsertNotifier>& n )
+                : _notifier( n ) {
+            }
+
+            virtual void commit() { _notifier->notifyOfInsert(); }
+            virtual void rollback() { }
+
+        private:
+            const boost::shared_ptr<CappedInsertNotifier> _notifier;
+        };
+    }
+
     // ----
 
     Collection::Collection( OperationContext* txn,
@@ -91,15 +109,24 @@ namespace mongo {
           _cursorCache( fullNS ) {
         _magic = 1357924;
         _indexCatalog.init(txn);
-        if ( isCapped() )
+        if ( isCapped() ) {
             _recordStore->setCappedDeleteCallback( this );
+            _cappedNotifier.reset( new CappedInsertNotifier() );
+        }
     }
 
     Collection::~Collection() {
         verify( ok() );
+        if ( _cappedNotifier )
+            _cappedNotifier->kill();
         _magic = 0;
     }
 
+    void Collection::_notifyOfCappedInsert( OperationContext* txn ) {
+        if ( _cappedNotifier )
+            txn->recoveryUnit()->registerChange( new NotifyCappedInsertChange( _cappedNotifier ) );
+    }
+
     bool Collection::requiresIdIndex() const {
 
         if ( _ns.ns().find( '$' ) != string::npos ) {
@@ -173,15 +200,31 @@ namespace mongo {
                                                     bool enforceQuota ) {
         invariant( !_indexCatalog.haveAnyIndexes() ); // eventually can implement, just not done
 
+        _notifyOfWrite();
         StatusWith<DiskLoc> loc = _recordStore->insertRecord( txn,
                                                               doc,
                                                               _enforceQuota( enforceQuota ) );
         if ( !loc.isOK() )
             return loc;
 
+        _notifyOfCappedInsert( txn );
         return StatusWith<DiskLoc>( loc );
     }
 
+    Status Collection::insertDocuments( OperationContext* txn,
+                                        const std::vector<const DocWriter*>& docs,
+                                        std::vector<DiskLoc>* locsOut,
+                                        bool enforceQuota ) {
+        invariant( !_indexCatalog.haveAnyIndexes() ); // eventually can implement, just not done
+
+        _notifyOfWrite();
+        Status status = _recordStore->insertRecords( txn, docs, locsOut,
+                                                     _enforceQuota( enforceQuota ) );
+        if ( status.isOK() )
+            _notifyOfCappedInsert( txn );
+        return status;
+    }
+
     StatusWith<DiskLoc> Collection::insertDocument( OperationContext* txn,
                                                     const BSONObj& docToInsert,
                                                     bool enforceQuota ) {
@@ -200,6 +243,7 @@ namespace mongo {
                                                     const BSONObj& doc,
                                                     MultiIndexBlock* indexBlock,
                                                     bool enforceQuota ) {
+        _notifyOfWrite();
         StatusWith<DiskLoc> loc = _recordStore->insertRecord( txn,
                                                               doc.objdata(),
                                                               doc.objsize(),
@@ -212,6 +256,7 @@ namespace mongo {
         if ( !status.isOK() )
             return StatusWith<DiskLoc>( status );
 
+        _notifyOfCappedInsert( txn );
         return loc;
     }
 
@@ -220,6 +265,15 @@ namespace mongo {
         return _recordStore->recordNeedsFetch( txn, loc );
     }
 
+    void Collection::prefetchDocuments( OperationContext* txn,
+                                        const std::vector<DiskLoc>& locs ) const {
+        _recordStore->prefetchRecords( txn, locs );
+    }
+
+    void Collection::touchDocument( OperationContext* txn, const DiskLoc& loc ) const {
+        _recordStore->touchRecord( txn, loc );
+    }
+
 
     StatusWith<DiskLoc> Collection::_insertDocument( OperationContext* txn,
                                                      const BSONObj& docToInsert,
@@ -229,6 +283,7 @@ namespace mongo {
         //       under the RecordStore, this feels broken since that should be a
         //       collection access method probably
 
+        _notifyOfWrite();
         StatusWith<DiskLoc> loc = _recordStore->insertRecord( txn,
                                                               docToInsert.objdata(),
                                                               docToInsert.objsize(),
@@ -245,15 +300,18 @@ namespace mongo {
         if (!s.isOK())
             return StatusWith<DiskLoc>(s);
 
+        _notifyOfCappedInsert( txn );
         return loc;
     }
 
     Status Collection::aboutToDeleteCapped( OperationContext* txn, const DiskLoc& loc ) {
 
+        _notifyOfWrite();
         BSONObj doc = docFor( txn, loc );
 
         /* check if any cursors point to us.  if so, advance them. */
         _cursorCache.invalidateDocument(loc, INVALIDATION_DELETION);
+        _infoCache.getIdLookupCache()->invalidate(loc);
 
         _indexCatalog.unindexRecord(txn, doc, loc, false);
 
@@ -271,6 +329,7 @@ namespace mongo {
             return;
         }
 
+        _notifyOfWrite();
         BSONObj doc = docFor( txn, loc );
 
         if ( deletedId ) {
@@ -282,6 +341,7 @@ namespace mongo {
 
         /* check if any cursors point to us.  if so, advance them. */
         _cursorCache.invalidateDocument(loc, INVALIDATION_DELETION);
+        _infoCache.getIdLookupCache()->invalidate(loc);
 
         _indexCatalog.unindexRecord(txn, doc, loc, noWarn);
 
@@ -290,6 +350,41 @@ namespace mongo {
         _infoCache.notifyOfWriteOp();
     }
 
+    void Collection::deleteDocuments( OperationContext* txn,
+                                      const std::vector<DiskLoc>& locs,
+                                      bool cappedOK,
+                                      std::vector<BSONObj>* deletedIds ) {
+        if ( isCapped() && !cappedOK ) {
+            log() << "failing remove on a capped ns " << _ns << endl;
+            uasserted( 10089,  "cannot remove from a capped collection" );
+            return;
+        }
+
+        _notifyOfWrite();
+        std::vector<BSONObj> docs;
+        docs.reserve( locs.size() );
+        for ( size_t i = 0; i < locs.size(); ++i ) {
+            docs.push_back( docFor( txn, locs[i] ) );
+
+            if ( deletedIds ) {
+                BSONElement e = docs.back()["_id"];
+                deletedIds->push_back( e.type() ? e.wrap() : BSONObj() );
+            }
+
+            /* check if any cursors point to us.  if so, advance them. */
+            _cursorCache.invalidateDocument(locs[i], INVALIDATION_DELETION);
+            _infoCache.getIdLookupCache()->invalidate(locs[i]);
+        }
+
+        _indexCatalog.unindexRecords(txn, docs, locs, false);
+
+        for ( size_t i = 0; i < locs.size(); ++i ) {
+            _recordStore->deleteRecord( txn, locs[i] );
+        }
+
+        _infoCache.notifyOfWriteOp();
+    }
+
     Counter64 moveCounter;
     ServerStatusMetricField<Counter64> moveCounterDisplay( "record.moves", &moveCounter );
 
@@ -297,8 +392,10 @@ namespace mongo {
                                                     const DiskLoc& oldLocation,
                                                     const BSONObj& objNew,
                                                     bool enforceQuota,
-                                                    OpDebug* debug ) {
+                                                    OpDebug* debug,
+                                                    bool indexesAffected ) {
 
+        _notifyOfWrite();
         BSONObj objOld = _recordStore->dataFor( txn, oldLocation ).toBson();
 
         if ( objOld.hasElement( "_id" ) ) {
@@ -317,9 +414,12 @@ namespace mongo {
         // At the end of this step, we will have a map of UpdateTickets, one per index, which
         // represent the index updates needed to be done, based on the changes between objOld and
         // objNew.
+        //
+        // When no indexed path changed there is nothing to compute: the keys stay the same
+        // unless the document moves, and then they are rebuilt from scratch anyway.
         OwnedPointerMap<IndexDescriptor*,UpdateTicket> updateTickets;
         IndexCatalog::IndexIterator ii = _indexCatalog.getIndexIterator( txn, true );
-        while ( ii.more() ) {
+        while ( indexesAffected && ii.more() ) {
             IndexDescriptor* descriptor = ii.next();
             IndexAccessMethod* iam = _indexCatalog.getIndex( descriptor );
 
@@ -377,7 +477,7 @@ namespace mongo {
             debug->keyUpdates = 0;
 
         ii = _indexCatalog.getIndexIterator( txn, true );
-        while ( ii.more() ) {
+        while ( indexesAffected && ii.more() ) {
             IndexDescriptor* descriptor = ii.next();
             IndexAccessMethod* iam = _indexCatalog.getIndex( descriptor );
 
@@ -401,6 +501,7 @@ namespace mongo {
                                                size_t oldSize ) {
         moveCounter.increment();
         _cursorCache.invalidateDocument(oldLocation, INVALIDATION_DELETION);
+        _infoCache.getIdLookupCache()->invalidate(oldLocation);
         _indexCatalog.unindexRecord(txn, BSONObj(oldBuffer), oldLocation, true);
         return Status::OK();
     }
@@ -414,6 +515,7 @@ namespace mongo {
 
         // Broadcast the mutation so that query results stay correct.
         _cursorCache.invalidateDocument(loc, INVALIDATION_MUTATION);
+        _notifyOfWrite();
 
         return _recordStore->updateWithDamages( txn, loc, oldRec, damageSource, damages );
     }
@@ -480,6 +582,7 @@ namespace mongo {
      */
     Status Collection::truncate(OperationContext* txn) {
         massert( 17445, "index build in progress", _indexCatalog.numIndexesInProgress( txn ) == 0 );
+        _notifyOfWrite();
 
         // 1) store index specs
         vector<BSONObj> indexSpecs;
@@ -517,6 +620,8 @@ namespace mongo {
                                               DiskLoc end,
                                               bool inclusive) {
         invariant( isCapped() );
+        _notifyOfWrite();
+        _infoCache.getIdLookupCache()->clear();
         reinterpret_cast<CappedRecordStoreV1*>(
                            _recordStore)->temp_cappedTruncateAfter( txn, end, inclusive );
     }
@@ -30,10 +30,12 @@
 
 #pragma once
 
+#include <boost/shared_ptr.hpp>
 #include <string>
 
 #include "mongo/base/string_data.h"
 #include "mongo/bson/mutable/damage_vector.h"
+#include "mongo/db/catalog/capped_insert_notifier.h"
 #include "mongo/db/catalog/collection_cursor_cache.h"
 #include "mongo/db/catalog/collection_info_cache.h"
 #include "mongo/db/catalog/index_catalog.h"
@@ -42,6 +44,7 @@
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/storage/capped_callback.h"
 #include "mongo/db/storage/record_store.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/platform/cstdint.h"
 
 namespace mongo {
@@ -65,6 +68,8 @@ namespace mongo {
             validateDocuments = true;
             paddingFactor = 1;
             paddingBytes = 0;
+            online = false;
+            maxExtents = 0;
         }
 
         // padding
@@ -84,15 +89,27 @@ namespace mongo {
         // other
         bool validateDocuments;
 
+        // online compacts keep the indexes and move the records of at most maxExtents extents
+        // per call (0 for no limit), so that the caller can yield between calls
+        bool online;
+        int maxExtents;
+
         std::string toString() const;
     };
 
     struct CompactStats {
         CompactStats() {
             corruptDocuments = 0;
+            extentsCompacted = 0;
+            extentsLeft = 0;
         }
 
         long long corruptDocuments;
+
+        // for online compacts: the extents emptied and freed by the call, and how many of the
+        // extents there were when it started are still left to compact
+        long long extentsCompacted;
+        long long extentsLeft;
     };
 
     /**
@@ -166,6 +183,16 @@ namespace mongo {
                              bool noWarn = false,
                              BSONObj* deletedId = 0 );
 
+        /**
+         * Deletes the documents at 'locs', which the caller should pass in DiskLoc order. All
+         * the index keys of the batch are removed first, one index at a time, and then the
+         * records. If not NULL, the _id of each deleted document is appended to 'deletedIds'.
+         */
+        void deleteDocuments( OperationContext* txn,
+                              const std::vector<DiskLoc>& locs,
+                              bool cappedOK = false,
+                              std::vector<BSONObj>* deletedIds = 0 );
+
         /**
          * this does NOT modify the doc before inserting
          * i.e. will not add an _id field for documents that are missing it
@@ -180,6 +207,15 @@ namespace mongo {
                                             const DocWriter* doc,
                                             bool enforceQuota );
 
+        /**
+         * Inserts the documents with one RecordStore::insertRecords call. Like the DocWriter
+         * insertDocument, only for collections without indexes.
+         */
+        Status insertDocuments( OperationContext* txn,
+                                const std::vector<const DocWriter*>& docs,
+                                std::vector<DiskLoc>* locsOut,
+                                bool enforceQuota );
+
         StatusWith<DiskLoc> insertDocument( OperationContext* txn,
                                             const BSONObj& doc,
                                             MultiIndexBlock* indexBlock,
@@ -197,17 +233,32 @@ namespace mongo {
         RecordFetcher* documentNeedsFetch( OperationContext* txn,
                                            const DiskLoc& loc ) const;
 
+        /**
+         * Hints to the storage engine that the documents at 'locs', sorted in DiskLoc order,
+         * are about to be read.  See RecordStore::prefetchRecords.
+         */
+        void prefetchDocuments( OperationContext* txn, const std::vector<DiskLoc>& locs ) const;
+
+        /**
+         * Brings the document at 'loc' into memory.  See RecordStore::touchRecord.
+         */
+        void touchDocument( OperationContext* txn, const DiskLoc& loc ) const;
+
         /**
          * updates the document @ oldLocation with newDoc
          * if the document fits in the old space, it is put there
          * if not, it is moved
+         * @param indexesAffected false if the caller knows the update changed no indexed path
+         *        (see CollectionInfoCache::indexKeys), in which case the index keys of the
+         *        document aren't recomputed unless it moves
          * @return the post update location of the doc (may or may not be the same as oldLocation)
          */
         StatusWith<DiskLoc> updateDocument( OperationContext* txn,
                                             const DiskLoc& oldLocation,
                                             const BSONObj& newDoc,
                                             bool enforceQuota,
-                                            OpDebug* debug );
+                                            OpDebug* debug,
+                                            bool indexesAffected = true );
 
         /**
          * right now not allowed to modify indexes
@@ -279,6 +330,20 @@ namespace mongo {
                               BSONObjBuilder* details = NULL,
                               int scale = 1);
 
+        /**
+         * The number of writes to the documents so far, including those rolled back, so that a
+         * reader which yields can tell whether the collection changed meanwhile.
+         */
+        unsigned long long getWriteCount() const { return _writeCount.load(); }
+
+        /**
+         * Notified of every committed insert, for tailable cursors to wait on.  NULL if the
+         * collection is not capped.
+         */
+        boost::shared_ptr<CappedInsertNotifier> getCappedInsertNotifier() const {
+            return _cappedNotifier;
+        }
+
         // --- end suspect things
 
     private:
@@ -301,6 +366,13 @@ namespace mongo {
 
         bool _enforceQuota( bool userEnforeQuota ) const;
 
+        void _notifyOfWrite() { _writeCount.fetchAndAdd(1); }
+
+        /**
+         * Notifies the waiters on _cappedNotifier once the unit of work of 'txn' commits.
+         */
+        void _notifyOfCappedInsert( OperationContext* txn );
+
         int _magic;
 
         NamespaceString _ns;
@@ -315,6 +387,11 @@ namespace mongo {
         // should be about the data.
         mutable CollectionCursorCache _cursorCache;
 
+        AtomicUInt64 _writeCount;
+
+        // Only set for capped collections
+        boost::shared_ptr<CappedInsertNotifier> _cappedNotifier;
+
         friend class Database;
         friend class IndexCatalog;
         friend class NamespaceDetails;
@@ -95,6 +95,44 @@ namespace mongo {
             MultiIndexBlock* _multiIndexBlock;
         };
 
+        /**
+         * Keeps the indexes up to date as the records move, the way updates which move a
+         * document do.
+         */
+        class OnlineCompactAdaptor : public RecordStoreCompactAdaptor {
+        public:
+            OnlineCompactAdaptor(OperationContext* txn,
+                                 IndexCatalog* indexCatalog,
+                                 UpdateMoveNotifier* notifier)
+                : _txn( txn ),
+                  _indexCatalog( indexCatalog ),
+                  _notifier( notifier ) {
+            }
+
+            virtual bool isDataValid( const RecordData& recData ) {
+                return recData.toBson().valid();
+            }
+
+            virtual size_t dataSize( const RecordData& recData ) {
+                return recData.toBson().objsize();
+            }
+
+            virtual void inserted( const RecordData& recData, const DiskLoc& newLocation ) {
+                uassertStatusOK( _indexCatalog->indexRecord( _txn,
+                                                             recData.toBson(),
+                                                             newLocation ) );
+            }
+
+            virtual UpdateMoveNotifier* moveNotifier() {
+                return _notifier;
+            }
+
+        private:
+            OperationContext* _txn;
+            IndexCatalog* _indexCatalog;
+            UpdateMoveNotifier* _notifier;
+        };
+
     }
 
 
@@ -110,6 +148,16 @@ namespace mongo {
             return StatusWith<CompactStats>( ErrorCodes::BadValue,
                                              "cannot compact when indexes in progress" );
 
+        if ( compactOptions->online ) {
+            // The records move with the indexes in place, so there is nothing to rebuild.
+            CompactStats stats;
+            OnlineCompactAdaptor adaptor( txn, &_indexCatalog, this );
+            Status status = _recordStore->compact( txn, &adaptor, compactOptions, &stats );
+            if ( !status.isOK() )
+                return StatusWith<CompactStats>( status );
+            return StatusWith<CompactStats>( stats );
+        }
+
 
         // same data, but might perform a little different after compact?
         _infoCache.reset( txn );
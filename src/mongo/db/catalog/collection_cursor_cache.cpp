@@ -267,7 +267,8 @@ namespace mongo {
 
     CollectionCursorCache::CollectionCursorCache( const StringData& ns )
         : _nss( ns ),
-          _mutex( "CollectionCursorCache" ) {
+          _randomMutex( "CollectionCursorCacheRandom" ),
+          _executorsMutex( "CollectionCursorCacheExecutors" ) {
         _collectionCacheRuntimeId = _globalCursorIdCache.created( _nss.ns() );
         _random.reset( new PseudoRandom( _globalCursorIdCache.nextSeed() ) );
     }
@@ -277,72 +278,90 @@ namespace mongo {
         _globalCursorIdCache.destroyed( _collectionCacheRuntimeId, _nss.ns() );
     }
 
+    CollectionCursorCache::CursorShard& CollectionCursorCache::_shardFor( CursorId id ) {
+        // the low part of the id is random
+        return _cursorShards[static_cast<unsigned>( id ) % kNumCursorShards];
+    }
+
     void CollectionCursorCache::invalidateAll( bool collectionGoingAway ) {
-        SimpleMutex::scoped_lock lk( _mutex );
+        {
+            SimpleMutex::scoped_lock lk( _executorsMutex );
 
-        for ( ExecSet::iterator it = _nonCachedExecutors.begin();
-              it != _nonCachedExecutors.end();
-              ++it ) {
+            for ( ExecSet::iterator it = _nonCachedExecutors.begin();
+                  it != _nonCachedExecutors.end();
+                  ++it ) {
 
-            // we kill the executor, but it deletes itself
-            PlanExecutor* exec = *it;
-            exec->kill();
-            invariant( exec->collection() == NULL );
+                // we kill the executor, but it deletes itself
+                PlanExecutor* exec = *it;
+                exec->kill();
+                invariant( exec->collection() == NULL );
+            }
+            _nonCachedExecutors.clear();
         }
-        _nonCachedExecutors.clear();
 
-        if ( collectionGoingAway ) {
-            // we're going to wipe out the world
-            for ( CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i ) {
-                ClientCursor* cc = i->second;
+        for ( int shardIdx = 0; shardIdx < kNumCursorShards; shardIdx++ ) {
+            CursorShard& shard = _cursorShards[shardIdx];
+            SimpleMutex::scoped_lock lk( shard.mutex );
 
-                cc->kill();
+            if ( collectionGoingAway ) {
+                // we're going to wipe out the world
+                for ( CursorMap::const_iterator i = shard.cursors.begin();
+                      i != shard.cursors.end();
+                      ++i ) {
+                    ClientCursor* cc = i->second;
 
-                invariant( cc->getExecutor() == NULL || cc->getExecutor()->collection() == NULL );
+                    cc->kill();
+
+                    invariant( cc->getExecutor() == NULL ||
+                               cc->getExecutor()->collection() == NULL );
 
-                // If there is a pinValue >= 100, somebody is actively using the CC and we do
-                // not delete it.  Instead we notify the holder that we killed it.  The holder
-                // will then delete the CC.
-                // pinvalue is <100, so there is nobody actively holding the CC.  We can
-                // safely delete it as nobody is holding the CC.
+                    // If there is a pinValue >= 100, somebody is actively using the CC and we do
+                    // not delete it.  Instead we notify the holder that we killed it.  The holder
+                    // will then delete the CC.
+                    // pinvalue is <100, so there is nobody actively holding the CC.  We can
+                    // safely delete it as nobody is holding the CC.
 
-                if (cc->pinValue() < 100) {
-                    delete cc;
+                    if (cc->pinValue() < 100) {
+                        delete cc;
+                    }
                 }
             }
-        }
-        else {
-            CursorMap newMap;
+            else {
+                CursorMap newMap;
+
+                // collection will still be around, just all PlanExecutors are invalid
+                for ( CursorMap::const_iterator i = shard.cursors.begin();
+                      i != shard.cursors.end();
+                      ++i ) {
+                    ClientCursor* cc = i->second;
+
+                    // Note that a valid ClientCursor state is "no cursor no executor."  This is
+                    // because the set of active cursor IDs in ClientCursor is used as
+                    // representation of query state.  See sharding_block.h.  TODO(greg,hk): Move
+                    // this out.
+                    if (NULL == cc->getExecutor() ) {
+                        newMap.insert( *i );
+                        continue;
+                    }
+
+                    if (cc->pinValue() >= 100 || cc->isAggCursor) {
+                        // Pinned cursors need to stay alive, so we leave them around.
+                        // Aggregation cursors also can stay alive (since they don't have their
+                        // lifetime bound to the underlying collection).  However, if they have an
+                        // associated executor, we need to kill it, because it's now invalid.
+                        if ( cc->getExecutor() )
+                            cc->getExecutor()->kill();
+                        newMap.insert( *i );
+                    }
+                    else {
+                        cc->kill();
+                        delete cc;
+                    }
 
-            // collection will still be around, just all PlanExecutors are invalid
-            for ( CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i ) {
-                ClientCursor* cc = i->second;
-
-                // Note that a valid ClientCursor state is "no cursor no executor."  This is because
-                // the set of active cursor IDs in ClientCursor is used as representation of query
-                // state.  See sharding_block.h.  TODO(greg,hk): Move this out.
-                if (NULL == cc->getExecutor() ) {
-                    newMap.insert( *i );
-                    continue;
-                }
-
-                if (cc->pinValue() >= 100 || cc->isAggCursor) {
-                    // Pinned cursors need to stay alive, so we leave them around.  Aggregation
-                    // cursors also can stay alive (since they don't have their lifetime bound to
-                    // the underlying collection).  However, if they have an associated executor, we
-                    // need to kill it, because it's now invalid.
-                    if ( cc->getExecutor() )
-                        cc->getExecutor()->kill();
-                    newMap.insert( *i );
-                }
-                else {
-                    cc->kill();
-                    delete cc;
                 }
 
+                shard.cursors.swap( newMap );
             }
-
-            _cursors = newMap;
         }
     }
 
@@ -354,61 +373,80 @@ namespace mongo {
             return;
         }
 
-        SimpleMutex::scoped_lock lk( _mutex );
+        {
+            SimpleMutex::scoped_lock lk( _executorsMutex );
 
-        for ( ExecSet::iterator it = _nonCachedExecutors.begin();
-              it != _nonCachedExecutors.end();
-              ++it ) {
+            for ( ExecSet::iterator it = _nonCachedExecutors.begin();
+                  it != _nonCachedExecutors.end();
+                  ++it ) {
 
-            PlanExecutor* exec = *it;
-            exec->invalidate(dl, type);
+                PlanExecutor* exec = *it;
+                exec->invalidate(dl, type);
+            }
         }
 
-        for ( CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i ) {
-            PlanExecutor* exec = i->second->getExecutor();
-            if ( exec ) {
-                exec->invalidate(dl, type);
+        for ( int shardIdx = 0; shardIdx < kNumCursorShards; shardIdx++ ) {
+            CursorShard& shard = _cursorShards[shardIdx];
+            SimpleMutex::scoped_lock lk( shard.mutex );
+
+            for ( CursorMap::const_iterator i = shard.cursors.begin();
+                  i != shard.cursors.end();
+                  ++i ) {
+                PlanExecutor* exec = i->second->getExecutor();
+                if ( exec ) {
+                    exec->invalidate(dl, type);
+                }
             }
         }
     }
 
     std::size_t CollectionCursorCache::timeoutCursors( int millisSinceLastCall ) {
-        SimpleMutex::scoped_lock lk( _mutex );
+        size_t totalTimedOut = 0;
 
-        vector<ClientCursor*> toDelete;
+        for ( int shardIdx = 0; shardIdx < kNumCursorShards; shardIdx++ ) {
+            CursorShard& shard = _cursorShards[shardIdx];
+            SimpleMutex::scoped_lock lk( shard.mutex );
 
-        for ( CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i ) {
-            ClientCursor* cc = i->second;
-            if ( cc->shouldTimeout( millisSinceLastCall ) )
-                toDelete.push_back( cc );
-        }
+            vector<ClientCursor*> toDelete;
 
-        for ( vector<ClientCursor*>::const_iterator i = toDelete.begin();
-                i != toDelete.end(); ++i ) {
-            ClientCursor* cc = *i;
-            _deregisterCursor_inlock( cc );
-            cc->kill();
-            delete cc;
+            for ( CursorMap::const_iterator i = shard.cursors.begin();
+                  i != shard.cursors.end();
+                  ++i ) {
+                ClientCursor* cc = i->second;
+                if ( cc->shouldTimeout( millisSinceLastCall ) )
+                    toDelete.push_back( cc );
+            }
+
+            for ( vector<ClientCursor*>::const_iterator i = toDelete.begin();
+                    i != toDelete.end(); ++i ) {
+                ClientCursor* cc = *i;
+                _deregisterCursor_inlock( shard, cc );
+                cc->kill();
+                delete cc;
+            }
+
+            totalTimedOut += toDelete.size();
         }
 
-        return toDelete.size();
+        return totalTimedOut;
     }
 
     void CollectionCursorCache::registerExecutor( PlanExecutor* exec ) {
-        SimpleMutex::scoped_lock lk(_mutex);
+        SimpleMutex::scoped_lock lk(_executorsMutex);
         const std::pair<ExecSet::iterator, bool> result = _nonCachedExecutors.insert(exec);
         invariant(result.second); // make sure this was inserted
     }
 
     void CollectionCursorCache::deregisterExecutor( PlanExecutor* exec ) {
-        SimpleMutex::scoped_lock lk(_mutex);
+        SimpleMutex::scoped_lock lk(_executorsMutex);
         _nonCachedExecutors.erase(exec);
     }
 
     ClientCursor* CollectionCursorCache::find( CursorId id, bool pin ) {
-        SimpleMutex::scoped_lock lk( _mutex );
-        CursorMap::const_iterator it = _cursors.find( id );
-        if ( it == _cursors.end() )
+        CursorShard& shard = _shardFor( id );
+        SimpleMutex::scoped_lock lk( shard.mutex );
+        CursorMap::const_iterator it = shard.cursors.find( id );
+        if ( it == shard.cursors.end() )
             return NULL;
 
         ClientCursor* cursor = it->second;
@@ -423,54 +461,68 @@ namespace mongo {
     }
 
     void CollectionCursorCache::unpin( ClientCursor* cursor ) {
-        SimpleMutex::scoped_lock lk( _mutex );
+        CursorShard& shard = _shardFor( cursor->cursorid() );
+        SimpleMutex::scoped_lock lk( shard.mutex );
 
         invariant( cursor->_pinValue >= 100 );
         cursor->_pinValue -= 100;
     }
 
     void CollectionCursorCache::getCursorIds( std::set<CursorId>* openCursors ) {
-        SimpleMutex::scoped_lock lk( _mutex );
+        for ( int shardIdx = 0; shardIdx < kNumCursorShards; shardIdx++ ) {
+            CursorShard& shard = _cursorShards[shardIdx];
+            SimpleMutex::scoped_lock lk( shard.mutex );
 
-        for ( CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i ) {
-            ClientCursor* cc = i->second;
-            openCursors->insert( cc->cursorid() );
+            for ( CursorMap::const_iterator i = shard.cursors.begin();
+                  i != shard.cursors.end();
+                  ++i ) {
+                ClientCursor* cc = i->second;
+                openCursors->insert( cc->cursorid() );
+            }
         }
     }
 
     size_t CollectionCursorCache::numCursors(){
-        SimpleMutex::scoped_lock lk( _mutex );
-        return _cursors.size();
+        size_t total = 0;
+        for ( int shardIdx = 0; shardIdx < kNumCursorShards; shardIdx++ ) {
+            CursorShard& shard = _cursorShards[shardIdx];
+            SimpleMutex::scoped_lock lk( shard.mutex );
+            total += shard.cursors.size();
+        }
+        return total;
     }
 
-    CursorId CollectionCursorCache::_allocateCursorId_inlock() {
+    CursorId CollectionCursorCache::registerCursor( ClientCursor* cc ) {
+        invariant( cc );
         for ( int i = 0; i < 10000; i++ ) {
-            unsigned mypart = static_cast<unsigned>( _random->nextInt32() );
+            unsigned mypart;
+            {
+                SimpleMutex::scoped_lock lk( _randomMutex );
+                mypart = static_cast<unsigned>( _random->nextInt32() );
+            }
+
             CursorId id = cursorIdFromParts( _collectionCacheRuntimeId, mypart );
-            if ( _cursors.count( id ) == 0 )
+
+            CursorShard& shard = _shardFor( id );
+            SimpleMutex::scoped_lock lk( shard.mutex );
+            if ( shard.cursors.insert( std::make_pair( id, cc ) ).second )
                 return id;
         }
         fassertFailed( 17360 );
     }
 
-    CursorId CollectionCursorCache::registerCursor( ClientCursor* cc ) {
-        invariant( cc );
-        SimpleMutex::scoped_lock lk( _mutex );
-        CursorId id = _allocateCursorId_inlock();
-        _cursors[id] = cc;
-        return id;
-    }
-
     void CollectionCursorCache::deregisterCursor( ClientCursor* cc ) {
-        SimpleMutex::scoped_lock lk( _mutex );
-        _deregisterCursor_inlock( cc );
+        CursorShard& shard = _shardFor( cc->cursorid() );
+        SimpleMutex::scoped_lock lk( shard.mutex );
+        _deregisterCursor_inlock( shard, cc );
     }
 
     bool CollectionCursorCache::eraseCursor(OperationContext* txn, CursorId id, bool checkAuth) {
-        SimpleMutex::scoped_lock lk( _mutex );
+        CursorShard& shard = _shardFor( id );
+        SimpleMutex::scoped_lock lk( shard.mutex );
 
-        CursorMap::iterator it = _cursors.find( id );
-        if ( it == _cursors.end() ) {
+        CursorMap::iterator it = shard.cursors.find( id );
+        if ( it == shard.cursors.end() ) {
             if ( checkAuth )
                 audit::logKillCursorsAuthzCheck( txn->getClient(),
                                                  _nss,
@@ -492,15 +544,15 @@ namespace mongo {
                  cursor->pinValue() < 100 );
 
         cursor->kill();
-        _deregisterCursor_inlock( cursor );
+        _deregisterCursor_inlock( shard, cursor );
         delete cursor;
         return true;
     }
 
-    void CollectionCursorCache::_deregisterCursor_inlock( ClientCursor* cc ) {
+    void CollectionCursorCache::_deregisterCursor_inlock( CursorShard& shard, ClientCursor* cc ) {
         invariant( cc );
         CursorId id = cc->cursorid();
-        _cursors.erase( id );
+        shard.cursors.erase( id );
     }
 
 }
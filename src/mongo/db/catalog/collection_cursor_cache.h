@@ -122,20 +122,38 @@ namespace mongo {
         static std::size_t timeoutCursorsGlobal(OperationContext* txn, int millisSinceLastCall);
 
     private:
-        CursorId _allocateCursorId_inlock();
-        void _deregisterCursor_inlock( ClientCursor* cc );
+        typedef std::map<CursorId,ClientCursor*> CursorMap;
+
+        /**
+         * The cursors are split by id over shards, each with its own mutex, so that getMore and
+         * pinning on different cursors of the same collection do not contend.
+         */
+        struct CursorShard {
+            CursorShard() : mutex( "CollectionCursorCache" ) { }
+
+            SimpleMutex mutex;
+            CursorMap cursors;
+        };
+
+        enum { kNumCursorShards = 16 };
+
+        CursorShard& _shardFor( CursorId id );
+
+        void _deregisterCursor_inlock( CursorShard& shard, ClientCursor* cc );
 
         NamespaceString _nss;
         unsigned _collectionCacheRuntimeId;
+
+        // protects only _random, never held with any other mutex
+        SimpleMutex _randomMutex;
         scoped_ptr<PseudoRandom> _random;
 
-        SimpleMutex _mutex;
+        SimpleMutex _executorsMutex;
 
         typedef unordered_set<PlanExecutor*> ExecSet;
         ExecSet _nonCachedExecutors;
 
-        typedef std::map<CursorId,ClientCursor*> CursorMap;
-        CursorMap _cursors;
+        CursorShard _cursorShards[kNumCursorShards];
     };
 
 }
@@ -35,10 +35,12 @@
 #include "mongo/db/catalog/collection_info_cache.h"
 
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/index_catalog_entry.h"
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/fts/fts_spec.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/index_legacy.h"
+#include "mongo/db/matcher/expression.h"
 #include "mongo/db/query/plan_cache.h"
 #include "mongo/util/debug_util.h"
 #include "mongo/util/log.h"
@@ -50,17 +52,30 @@ namespace mongo {
         : _collection( collection ),
           _keysComputed( false ),
           _planCache(new PlanCache(collection->ns().ns())),
-          _querySettings(new QuerySettings()) { }
+          _querySettings(new QuerySettings()),
+          _indexStats(new IndexStatsCache()),
+          _idLookupCache(new IdLookupCache()),
+          _queryShapeStats(new QueryShapeStats()) { }
 
     void CollectionInfoCache::reset( OperationContext* txn ) {
         LOG(1) << _collection->ns().ns() << ": clearing plan cache - collection info cache reset";
         clearQueryCache();
+        _idLookupCache->clear();
         _keysComputed = false;
         computeIndexKeys( txn );
         // query settings is not affected by info cache reset.
         // index filters should persist throughout life of collection
     }
 
+    namespace {
+        void addFilterPaths( const MatchExpression* expression, UpdateIndexData* paths ) {
+            if ( !expression->path().empty() )
+                paths->addPath( expression->path() );
+            for ( size_t i = 0; i < expression->numChildren(); i++ )
+                addFilterPaths( expression->getChild( i ), paths );
+        }
+    }
+
     void CollectionInfoCache::computeIndexKeys( OperationContext* txn ) {
         _indexedPaths.clear();
 
@@ -99,6 +114,14 @@ namespace mongo {
                     _indexedPaths.addPathComponent(ftsSpec.languageOverrideField());
                 }
             }
+
+            // Changing a field of a partial index's filter can add the document to the index
+            // or take it out.
+            const MatchExpression* filter =
+                _collection->getIndexCatalog()->getEntry(descriptor)->getFilterExpression();
+            if (filter) {
+                addFilterPaths(filter, &_indexedPaths);
+            }
         }
 
         _keysComputed = true;
@@ -109,6 +132,9 @@ namespace mongo {
         if (NULL != _planCache.get()) {
             _planCache->notifyOfWriteOp();
         }
+        if (NULL != _indexStats.get()) {
+            _indexStats->notifyOfWriteOp();
+        }
     }
 
     void CollectionInfoCache::clearQueryCache() {
@@ -125,4 +151,16 @@ namespace mongo {
         return _querySettings.get();
     }
 
+    IndexStatsCache* CollectionInfoCache::getIndexStats() const {
+        return _indexStats.get();
+    }
+
+    IdLookupCache* CollectionInfoCache::getIdLookupCache() const {
+        return _idLookupCache.get();
+    }
+
+    QueryShapeStats* CollectionInfoCache::getQueryShapeStats() const {
+        return _queryShapeStats.get();
+    }
+
 }
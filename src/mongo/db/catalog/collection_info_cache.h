@@ -32,8 +32,11 @@
 
 #include <boost/scoped_ptr.hpp>
 
+#include "mongo/db/query/id_lookup_cache.h"
+#include "mongo/db/query/index_stats.h"
 #include "mongo/db/query/plan_cache.h"
 #include "mongo/db/query/query_settings.h"
+#include "mongo/db/query/query_shape_stats.h"
 #include "mongo/db/update_index_data.h"
 
 namespace mongo {
@@ -68,6 +71,21 @@ namespace mongo {
          */
         QuerySettings* getQuerySettings() const;
 
+        /**
+         * Get the statistics gathered by the analyze command on this collection's indexes.
+         */
+        IndexStatsCache* getIndexStats() const;
+
+        /**
+         * Get the cache of where documents are by _id, used by the IDHACK stage.
+         */
+        IdLookupCache* getIdLookupCache() const;
+
+        /**
+         * Get the execution statistics of this collection's queries by shape.
+         */
+        QueryShapeStats* getQueryShapeStats() const;
+
         // -------------------
 
         /* get set of index keys for this namespace.  handy to quickly check if a given
@@ -106,6 +124,15 @@ namespace mongo {
         // Includes index filters.
         boost::scoped_ptr<QuerySettings> _querySettings;
 
+        // Index statistics for cost-based planning.
+        boost::scoped_ptr<IndexStatsCache> _indexStats;
+
+        // Where recently looked up documents are, by _id.
+        boost::scoped_ptr<IdLookupCache> _idLookupCache;
+
+        // Execution statistics by query shape.
+        boost::scoped_ptr<QueryShapeStats> _queryShapeStats;
+
         /**
          * Must be called under exclusive DB lock.
          */
@@ -30,6 +30,7 @@
 
 #include "mongo/db/catalog/collection_options.h"
 
+#include "mongo/db/storage/table_storage_options.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
@@ -122,12 +123,14 @@ namespace mongo {
                 temp = e.trueValue();
             }
             else if (fieldName == "storageEngine") {
-                // Storage engine-specific collection options.
-                // Every field under "storageEngine" is an object.
+                // Storage options for the collection's table.
+                // Objects under "storageEngine" hold the options for one storage engine, the
+                // other fields are the engine neutral options of TableStorageOptions.
                 // Format:
                 // {
                 //     ...
                 //     storageEngine: {
+                //         compressor: "zlib",
                 //         storageEngine1: {
                 //             ...
                 //         },
@@ -140,14 +143,10 @@ namespace mongo {
                 if (e.type() != mongo::Object) {
                     return Status(ErrorCodes::BadValue, "storageEngine has to be an object");
                 }
-                BSONObjIterator j(e.Obj());
-                while (j.more()) {
-                    BSONElement storageEngineElement = j.next();
-                    if (storageEngineElement.type() != mongo::Object) {
-                        return Status(ErrorCodes::BadValue, str::stream()
-                             << "storageEngine." << storageEngineElement.fieldNameStringData()
-                             << " has to be an object");
-                    }
+                StatusWith<TableStorageOptions> tableOptions =
+                    TableStorageOptions::parse(e.Obj());
+                if (!tableOptions.isOK()) {
+                    return tableOptions.getStatus();
                 }
                 storageEngine = e.Obj().getOwned();
             }
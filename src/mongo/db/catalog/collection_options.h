@@ -73,7 +73,7 @@ namespace mongo {
 
         bool temp;
 
-        // Storage engine collection options. Always owned or empty.
+        // Storage engine collection options, see TableStorageOptions. Always owned or empty.
         BSONObj storageEngine;
     };
 
@@ -119,6 +119,28 @@ namespace mongo {
         ASSERT_EQUALS(3, storageEngine2.getIntField("z"));
     }
 
+    TEST(CollectionOptions, ParseTableStorageOptions) {
+        CollectionOptions opts;
+        ASSERT_OK(opts.parse(fromjson("{storageEngine: {compressor: 'zlib', blockSize: 4096, "
+            "leafPageSize: 32768, prefixCompression: false, storageEngine1: {x: 1}}}")));
+        checkRoundTrip(opts);
+
+        ASSERT_NOT_OK(CollectionOptions().parse(fromjson(
+            "{storageEngine: {compressor: 'lz4'}}")));
+        ASSERT_NOT_OK(CollectionOptions().parse(fromjson(
+            "{storageEngine: {compressor: 1}}")));
+        ASSERT_NOT_OK(CollectionOptions().parse(fromjson(
+            "{storageEngine: {blockSize: 1000}}")));
+        ASSERT_NOT_OK(CollectionOptions().parse(fromjson(
+            "{storageEngine: {blockSize: 256}}")));
+        ASSERT_NOT_OK(CollectionOptions().parse(fromjson(
+            "{storageEngine: {blockSize: 4096, leafPageSize: 6144}}")));
+        ASSERT_NOT_OK(CollectionOptions().parse(fromjson(
+            "{storageEngine: {leafPageSize: 'big'}}")));
+        ASSERT_NOT_OK(CollectionOptions().parse(fromjson(
+            "{storageEngine: {prefixCompression: 1}}")));
+    }
+
     TEST(CollectionOptions, ResetStorageEngineField) {
         CollectionOptions opts;
         ASSERT_OK(opts.parse(fromjson(
@@ -54,10 +54,13 @@
 #include "mongo/db/index_names.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/keypattern.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/storage/table_storage_options.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 
@@ -505,6 +508,38 @@ namespace {
     }
 
 
+    /**
+     * A partial index filter may be a conjunction of equalities, ranges, $exists and $type,
+     * which is what the planner can tell a query implies.
+     */
+    static Status checkPartialFilterExpression( const MatchExpression* expression, int depth ) {
+        switch ( expression->matchType() ) {
+        case MatchExpression::AND:
+            if ( depth > 0 )
+                return Status( ErrorCodes::CannotCreateIndex,
+                               "partialFilterExpression only supports $and at the top level" );
+            for ( size_t i = 0; i < expression->numChildren(); i++ ) {
+                Status status = checkPartialFilterExpression( expression->getChild( i ),
+                                                              depth + 1 );
+                if ( !status.isOK() )
+                    return status;
+            }
+            return Status::OK();
+        case MatchExpression::EQ:
+        case MatchExpression::LT:
+        case MatchExpression::LTE:
+        case MatchExpression::GT:
+        case MatchExpression::GTE:
+        case MatchExpression::EXISTS:
+        case MatchExpression::TYPE_OPERATOR:
+            return Status::OK();
+        default:
+            return Status( ErrorCodes::CannotCreateIndex,
+                           str::stream() << "unsupported expression in partialFilterExpression: "
+                                         << expression->toString() );
+        }
+    }
+
     Status IndexCatalog::_isSpecOk( const BSONObj& spec ) const {
 
         const NamespaceString& nss = _collection->ns();
@@ -518,11 +553,18 @@ namespace {
             double v = vElt.Number();
             // note (one day) we may be able to fresh build less versions than we can use
             // isASupportedIndexVersionNumber() is what we can use
-            if ( v != 0 && v != 1 ) {
+            if ( v != 0 && v != 1 && v != 2 ) {
                 return Status( ErrorCodes::CannotCreateIndex,
                                str::stream() << "this version of mongod cannot build new indexes "
                                              << "of version number " << v );
             }
+            // v:2 only changes how btree buckets are laid out, the special index types
+            // still read their keys as v:1 ones
+            if ( v == 2 && !IndexNames::findPluginName( spec.getObjectField("key") ).empty() ) {
+                return Status( ErrorCodes::CannotCreateIndex,
+                               str::stream() << "index version 2 is only supported for plain "
+                                             << "btree indexes: " << spec );
+            }
         }
 
         if ( nss.isSystemDotIndexes() )
@@ -566,6 +608,46 @@ namespace {
                                          << keyStatus.reason() );
         }
 
+        const BSONElement filterElt = spec["partialFilterExpression"];
+        if ( !filterElt.eoo() ) {
+            if ( filterElt.type() != Object ) {
+                return Status( ErrorCodes::CannotCreateIndex,
+                               "partialFilterExpression must be an object" );
+            }
+            if ( spec["sparse"].trueValue() ) {
+                return Status( ErrorCodes::CannotCreateIndex,
+                               "an index cannot be both sparse and partial" );
+            }
+            if ( IndexDescriptor::isIdIndexPattern( key ) ) {
+                return Status( ErrorCodes::CannotCreateIndex, "_id index cannot be partial" );
+            }
+
+            StatusWithMatchExpression filter = MatchExpressionParser::parse( filterElt.Obj() );
+            if ( !filter.isOK() ) {
+                return Status( ErrorCodes::CannotCreateIndex,
+                               str::stream() << "bad partialFilterExpression: "
+                                             << filter.getStatus().reason() );
+            }
+            boost::scoped_ptr<MatchExpression> filterExpression( filter.getValue() );
+            Status filterStatus = checkPartialFilterExpression( filterExpression.get(), 0 );
+            if ( !filterStatus.isOK() )
+                return filterStatus;
+        }
+
+        const BSONElement storageEngineElt = spec["storageEngine"];
+        if ( !storageEngineElt.eoo() ) {
+            if ( storageEngineElt.type() != Object ) {
+                return Status( ErrorCodes::CannotCreateIndex,
+                               "storageEngine must be an object" );
+            }
+            StatusWith<TableStorageOptions> tableOptions =
+                TableStorageOptions::parse( storageEngineElt.Obj() );
+            if ( !tableOptions.isOK() ) {
+                return Status( ErrorCodes::CannotCreateIndex,
+                               tableOptions.getStatus().reason() );
+            }
+        }
+
         if ( IndexDescriptor::isIdIndexPattern( key ) ) {
             BSONElement uniqueElt = spec["unique"];
             if ( !uniqueElt.eoo() && !uniqueElt.trueValue() ) {
@@ -865,6 +947,13 @@ namespace {
         return entry->isMultikey( txn );
     }
 
+    std::set<std::string> IndexCatalog::getMultikeyPaths( OperationContext* txn,
+                                                          const IndexDescriptor* idx ) {
+        IndexCatalogEntry* entry = _entries.find( idx );
+        invariant( entry );
+        return entry->getMultikeyPaths();
+    }
+
 
     // ---------------------------
 
@@ -1097,6 +1186,32 @@ namespace {
         }
     }
 
+    void IndexCatalog::unindexRecords(OperationContext* txn,
+                                      const std::vector<BSONObj>& objs,
+                                      const std::vector<DiskLoc>& locs,
+                                      bool noWarn) {
+
+        for ( IndexCatalogEntryContainer::const_iterator i = _entries.begin();
+              i != _entries.end();
+              ++i ) {
+
+            IndexCatalogEntry* entry = *i;
+
+            InsertDeleteOptions options;
+            options.logIfError = entry->isReady(txn) ? !noWarn : false;
+            options.dupsAllowed = isDupsAllowed( entry->descriptor() );
+
+            int64_t removed;
+            Status status = entry->accessMethod()->removeMany(txn, objs, locs, options, &removed);
+
+            if ( !status.isOK() ) {
+                log() << "Couldn't unindex " << objs.size() << " records"
+                      << " from collection " << _collection->ns()
+                      << ". Status: " << status.toString();
+            }
+        }
+    }
+
     BSONObj IndexCatalog::fixIndexKey( const BSONObj& key ) {
         if ( IndexDescriptor::isIdIndexPattern( key ) ) {
             return _idObj;
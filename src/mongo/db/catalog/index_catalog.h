@@ -215,6 +215,9 @@ namespace mongo {
 
         bool isMultikey( OperationContext* txn, const IndexDescriptor* idex );
 
+        std::set<std::string> getMultikeyPaths( OperationContext* txn,
+                                                const IndexDescriptor* idex );
+
         // --- these probably become private?
 
 
@@ -279,6 +282,15 @@ namespace mongo {
                            const DiskLoc& loc,
                            bool noWarn);
 
+        /**
+         * As unindexRecord, for the documents 'objs' at 'locs'. Each index removes the keys of
+         * the whole batch at once.
+         */
+        void unindexRecords(OperationContext* txn,
+                            const std::vector<BSONObj>& objs,
+                            const std::vector<DiskLoc>& locs,
+                            bool noWarn);
+
         // ------- temp internal -------
 
         std::string getAccessMethodName(OperationContext* txn, const BSONObj& keyPattern) {
@@ -34,10 +34,14 @@
 
 #include "mongo/db/catalog/index_catalog_entry.h"
 
+#include <boost/thread/locks.hpp>
+
 #include "mongo/db/catalog/collection_catalog_entry.h"
 #include "mongo/db/catalog/head_manager.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/util/file_allocator.h"
 #include "mongo/util/log.h"
@@ -74,8 +78,19 @@ namespace mongo {
           _headManager(new HeadManagerImpl(this)),
           _ordering( Ordering::make( descriptor->keyPattern() ) ),
           _isReady( false ),
-          _wantToSetIsMultikey( false ) {
+          _wantToSetIsMultikey( false ),
+          _multikeyPathsKnown( true ) {
         _descriptor->_cachedEntry = this;
+
+        BSONElement filterElement = _descriptor->infoObj()["partialFilterExpression"];
+        if ( filterElement.type() ) {
+            // The spec was checked when the index was created.
+            invariant( filterElement.isABSONObj() );
+            StatusWithMatchExpression filter =
+                MatchExpressionParser::parse( filterElement.Obj() );
+            invariant( filter.isOK() );
+            _filterExpression.reset( filter.getValue() );
+        }
     }
 
     IndexCatalogEntry::~IndexCatalogEntry() {
@@ -83,6 +98,7 @@ namespace mongo {
 
         delete _headManager;
         delete _accessMethod;
+        _filterExpression.reset(); // refers into the descriptor's spec
         delete _descriptor;
     }
 
@@ -94,6 +110,7 @@ namespace mongo {
         _isReady = _catalogIsReady( txn );
         _head = _catalogHead( txn );
         _isMultikey = _catalogIsMultikey( txn );
+        _multikeyPathsKnown = !_isMultikey;
     }
 
     const DiskLoc& IndexCatalogEntry::head( OperationContext* txn ) const {
@@ -124,7 +141,46 @@ namespace mongo {
         _head = newHead;
     }
 
+    std::set<std::string> IndexCatalogEntry::getMultikeyPaths() const {
+        boost::lock_guard<boost::mutex> lk( _multikeyPathsMutex );
+        if ( !_multikeyPathsKnown )
+            return std::set<std::string>();
+        return _multikeyPaths;
+    }
+
     void IndexCatalogEntry::setMultikey( OperationContext* txn ) {
+        {
+            boost::lock_guard<boost::mutex> lk( _multikeyPathsMutex );
+            _multikeyPathsKnown = false;
+            _multikeyPaths.clear();
+        }
+        _setMultikey( txn );
+    }
+
+    void IndexCatalogEntry::setMultikey( OperationContext* txn,
+                                         const std::set<std::string>& paths ) {
+        bool newPath = false;
+        {
+            boost::lock_guard<boost::mutex> lk( _multikeyPathsMutex );
+            if ( _multikeyPathsKnown ) {
+                for ( std::set<std::string>::const_iterator it = paths.begin();
+                      it != paths.end(); ++it ) {
+                    newPath = _multikeyPaths.insert( *it ).second || newPath;
+                }
+            }
+        }
+
+        // A cached plan may be covered by a field which has just become multikey.
+        if ( newPath && isMultikey( txn ) && _infoCache ) {
+            LOG(1) << _ns << ": clearing plan cache - index "
+                   << _descriptor->keyPattern() << " has new multi key paths.";
+            _infoCache->clearQueryCache();
+        }
+
+        _setMultikey( txn );
+    }
+
+    void IndexCatalogEntry::_setMultikey( OperationContext* txn ) {
         if ( isMultikey( txn ) )
             return;
 
@@ -30,6 +30,9 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <set>
 #include <string>
 
 #include "mongo/base/owned_pointer_vector.h"
@@ -43,6 +46,7 @@ namespace mongo {
     class HeadManager;
     class IndexAccessMethod;
     class IndexDescriptor;
+    class MatchExpression;
     class OperationContext;
 
     class IndexCatalogEntry {
@@ -68,6 +72,12 @@ namespace mongo {
 
         const Ordering& ordering() const { return _ordering; }
 
+        /**
+         * The partialFilterExpression of a partial index, which only holds the documents
+         * matching it, or NULL for an index of every document.
+         */
+        const MatchExpression* getFilterExpression() const { return _filterExpression.get(); }
+
         /// ---------------------
 
         const DiskLoc& head( OperationContext* txn ) const;
@@ -82,8 +92,25 @@ namespace mongo {
 
         bool isMultikey( OperationContext* txn ) const;
 
+        /**
+         * Marks the index multikey without saying along which key fields, so that every field
+         * is treated as multikey from now on.
+         */
         void setMultikey( OperationContext* txn );
 
+        /**
+         * Marks the index multikey along the key fields in 'paths', those along which a
+         * document that made several keys has an array.
+         */
+        void setMultikey( OperationContext* txn, const std::set<std::string>& paths );
+
+        /**
+         * The key fields along which the index is multikey, or an empty set if the index is
+         * not multikey or if they are not known.  Paths are only tracked in memory, so they
+         * are not known for an index that was already multikey when it was loaded.
+         */
+        std::set<std::string> getMultikeyPaths() const;
+
         // if this ready is ready for queries
         bool isReady( OperationContext* txn ) const;
 
@@ -95,6 +122,8 @@ namespace mongo {
         DiskLoc _catalogHead( OperationContext* txn ) const;
         bool _catalogIsMultikey( OperationContext* txn ) const;
 
+        void _setMultikey( OperationContext* txn );
+
         // -----
 
         string _ns;
@@ -113,11 +142,17 @@ namespace mongo {
         // cached stuff
 
         Ordering _ordering; // TODO: this might be b-tree specific
+        boost::scoped_ptr<MatchExpression> _filterExpression; // parsed from the descriptor
         bool _isReady; // cache of NamespaceDetails info
         DiskLoc _head; // cache of IndexDetails
         bool _isMultikey; // cache of NamespaceDetails info
 
         bool _wantToSetIsMultikey; // see ::setMultikey
+
+        // Writers may only hold an intent lock, so the multikey paths have their own mutex.
+        mutable boost::mutex _multikeyPathsMutex;
+        std::set<std::string> _multikeyPaths;
+        bool _multikeyPathsKnown;
     };
 
     class IndexCatalogEntryContainer {
@@ -34,23 +34,166 @@
 
 #include "mongo/db/catalog/index_create.h"
 
+#include <algorithm>
+
 #include "mongo/base/error_codes.h"
+#include "mongo/base/owned_pointer_vector.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/audit.h"
 #include "mongo/db/background.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/curop.h"
+#include "mongo/db/index/btree_based_bulk_access_method.h"
+#include "mongo/db/index/index_side_writes.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/log.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/progress_meter.h"
 
 namespace mongo {
 
+    // Foreground builds of btree and hashed indexes read the collection and generate its keys on
+    // up to this many threads, if the collection splits into several ranges.
+    MONGO_EXPORT_SERVER_PARAMETER(internalIndexBuildParallelThreads, int, 1);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalIndexBuildBackgroundBulk, bool, true);
+
+namespace {
+
+    // How many records one task scans from its range in a round.
+    const size_t kRecordsPerTask = 4096;
+
+    // Once no more than this many writes were recorded for an index loaded in bulk while the
+    // previous ones were applied, the rest are left for commit() to apply under the exclusive
+    // lock.
+    const size_t kSideWritesLeftForCommit = 1000;
+
+    /**
+     * Inserts the documents of several ranges of a collection into bulk index builders.
+     *
+     * Each call to runRound() scans up to kRecordsPerTask records from each of the first
+     * unfinished ranges, one per thread, on a thread pool, and waits for all of them.  Task
+     * number i inserts with its builders' thread i, so no two concurrent tasks share a sorter.
+     * Like ParallelCollectionScanStage, nothing is read outside of runRound(), so the caller can
+     * check for interruption between rounds.
+     */
+    class ParallelBulkInserter {
+    public:
+        ParallelBulkInserter(const std::vector<BtreeBasedBulkAccessMethod*>& bulks,
+                             const std::vector<RecordIterator*>& ranges,
+                             size_t numThreads,
+                             int numKeyFields)
+            : _bulks(bulks),
+              _ranges(ranges),
+              _rangeDone(ranges.size(), false),
+              _numThreads(numThreads),
+              _numKeyFields(numKeyFields),
+              _pool(numThreads, "indexBuild") {
+        }
+
+        bool isEOF() const {
+            return std::find(_rangeDone.begin(), _rangeDone.end(), false) == _rangeDone.end();
+        }
+
+        /**
+         * Scans the next records of a number of unfinished ranges in parallel.  Adds how many to
+         * 'numScanned'.  Returns the first error any of them hit.
+         */
+        Status runRound(unsigned long long* numScanned) {
+            _tasks.clear();
+            for (size_t i = 0; i < _ranges.size() && _tasks.size() < _numThreads; i++) {
+                if (!_rangeDone[i])
+                    _tasks.push_back(Task(i));
+            }
+
+            for (size_t i = 0; i < _tasks.size(); i++) {
+                _pool.schedule(&ParallelBulkInserter::scan, this, i);
+            }
+            _pool.join();
+
+            for (size_t i = 0; i < _tasks.size(); i++) {
+                *numScanned += _tasks[i].numScanned;
+                if (!_tasks[i].status.isOK())
+                    return _tasks[i].status;
+            }
+            return Status::OK();
+        }
+
+    private:
+        struct Task {
+            explicit Task(size_t range) : range(range), numScanned(0), status(Status::OK()) {}
+
+            size_t range;
+            unsigned long long numScanned;
+            Status status;
+        };
+
+        /**
+         * Runs on the thread pool: scans up to kRecordsPerTask records of the range of
+         * _tasks[task].
+         */
+        void scan(size_t task) {
+            Task& t = _tasks[task];
+            RecordIterator* iter = _ranges[t.range];
+            BSONFieldIndex fieldIndex;
+
+            try {
+                for (size_t n = 0; n < kRecordsPerTask; n++) {
+                    DiskLoc loc;
+                    if (iter->isEOF() || (loc = iter->getNext()).isNull()) {
+                        _rangeDone[t.range] = true;
+                        break;
+                    }
+
+                    const BSONObj obj = iter->dataFor(loc).toBson();
+                    fieldIndex.reset();
+                    fieldIndex.expectProbes(obj, _numKeyFields);
+                    for (size_t i = 0; i < _bulks.size(); i++) {
+                        Status status = _bulks[i]->insertFromThread(task, obj, loc, &fieldIndex);
+                        if (!status.isOK()) {
+                            t.status = status;
+                            _rangeDone[t.range] = true;
+                            return;
+                        }
+                    }
+                    t.numScanned++;
+                }
+            }
+            catch (const DBException& e) {
+                t.status = e.toStatus();
+                _rangeDone[t.range] = true;
+            }
+            catch (const std::exception& e) {
+                t.status = Status(ErrorCodes::InternalError, e.what());
+                _rangeDone[t.range] = true;
+            }
+        }
+
+        const std::vector<BtreeBasedBulkAccessMethod*>& _bulks;
+        const std::vector<RecordIterator*>& _ranges;
+
+        // Only written by the one task a round which scans the range.  Not a vector<bool>, whose
+        // elements share words, so that tasks can set theirs concurrently.
+        std::vector<char> _rangeDone;
+
+        const size_t _numThreads;
+
+        // How many key fields the indexes have between them.
+        const int _numKeyFields;
+
+        std::vector<Task> _tasks;
+        ThreadPool _pool;
+    };
+
+}  // namespace
+
     /**
      * On rollback sets MultiIndexBlock::_needToCleanup to true.
      */
@@ -71,7 +214,8 @@ namespace mongo {
           _buildInBackground(false),
           _allowInterruption(false),
           _ignoreUnique(false),
-          _needToCleanup(true) {
+          _needToCleanup(true),
+          _numSharedKeyFields(0) {
     }
 
     MultiIndexBlock::~MultiIndexBlock() {
@@ -154,12 +298,6 @@ namespace mongo {
             if ( !status.isOK() )
                 return status;
 
-            if (!_buildInBackground) {
-                // Bulk build process requires foreground building as it assumes nothing is changing
-                // under it.
-                index.bulk.reset(index.real->initiateBulk(_txn));
-            }
-
             const IndexDescriptor* descriptor = index.block->getEntry()->descriptor();
 
             index.options.logIfError = false; // logging happens elsewhere if needed.
@@ -168,6 +306,28 @@ namespace mongo {
                                      || repl::getGlobalReplicationCoordinator()
                                                     ->shouldIgnoreUniqueIndex(descriptor);
 
+            if (!_buildInBackground) {
+                // Bulk build process requires foreground building as it assumes nothing is changing
+                // under it.
+                index.bulk.reset(index.real->initiateBulk(_txn));
+            }
+            else if (internalIndexBuildBackgroundBulk && index.options.dupsAllowed) {
+                // So does a background build which has the index's writers record their keys on
+                // the side until it's loaded.  Not for unique indexes, where a key briefly in two
+                // documents as the collection scan goes by would fail the bulk load.
+                BtreeBasedAccessMethod* btree = dynamic_cast<BtreeBasedAccessMethod*>(index.real);
+                if (btree)
+                    index.bulk.reset(btree->initiateBulk(_txn));
+                if (index.bulk) {
+                    index.sideWrites.reset(new IndexSideWrites());
+                    btree->setSideWrites(index.sideWrites);
+                }
+            }
+
+            index.btreeBulk = dynamic_cast<BtreeBasedBulkAccessMethod*>(index.bulk.get());
+            if (index.btreeBulk)
+                _numSharedKeyFields += descriptor->getNumFields();
+
             log() << "build index on: " << ns << " properties: " << descriptor->toString();
             if (index.bulk)
                 log() << "\t building index using bulk method";
@@ -213,50 +373,59 @@ namespace mongo {
 
         unsigned long long n = 0;
 
-        scoped_ptr<PlanExecutor> exec(InternalPlanner::collectionScan(_txn,
-                                                                      _collection->ns().ns(),
-                                                                      _collection));
-        if (_buildInBackground) {
-            invariant(_allowInterruption);
-            exec->setYieldPolicy(PlanExecutor::YIELD_AUTO);
+        std::vector<BtreeBasedBulkAccessMethod*> bulks;
+        OwnedPointerVector<RecordIterator> ranges;
+        if (canInsertInParallel(&bulks, &ranges.mutableVector())) {
+            Status ret = insertInParallel(bulks, ranges.vector(), progress, &n);
+            if (!ret.isOK())
+                return ret;
         }
+        else {
+            scoped_ptr<PlanExecutor> exec(InternalPlanner::collectionScan(_txn,
+                                                                          _collection->ns().ns(),
+                                                                          _collection));
+            if (_buildInBackground) {
+                invariant(_allowInterruption);
+                exec->setYieldPolicy(PlanExecutor::YIELD_AUTO);
+            }
 
-        BSONObj objToIndex;
-        DiskLoc loc;
-        PlanExecutor::ExecState state;
-        while (PlanExecutor::ADVANCED == (state = exec->getNext(&objToIndex, &loc))) {
-            {
-                if (_allowInterruption)
-                    _txn->checkForInterrupt();
-
-                bool shouldCommitWUnit = true;
-                WriteUnitOfWork wunit(_txn);
-                Status ret = insert(objToIndex, loc);
-                if (!ret.isOK()) {
-                    if (dupsOut && ret.code() == ErrorCodes::DuplicateKey) {
-                        // If dupsOut is non-null, we should only fail the specific insert that
-                        // led to a DuplicateKey rather than the whole index build.
-                        dupsOut->insert(loc);
-                        shouldCommitWUnit = false;
-                    }
-                    else {
-                        return ret;
+            BSONObj objToIndex;
+            DiskLoc loc;
+            PlanExecutor::ExecState state;
+            while (PlanExecutor::ADVANCED == (state = exec->getNext(&objToIndex, &loc))) {
+                {
+                    if (_allowInterruption)
+                        _txn->checkForInterrupt();
+
+                    bool shouldCommitWUnit = true;
+                    WriteUnitOfWork wunit(_txn);
+                    Status ret = insert(objToIndex, loc);
+                    if (!ret.isOK()) {
+                        if (dupsOut && ret.code() == ErrorCodes::DuplicateKey) {
+                            // If dupsOut is non-null, we should only fail the specific insert
+                            // that led to a DuplicateKey rather than the whole index build.
+                            dupsOut->insert(loc);
+                            shouldCommitWUnit = false;
+                        }
+                        else {
+                            return ret;
+                        }
                     }
-                }
 
-                if (shouldCommitWUnit)
-                    wunit.commit();
-            }
+                    if (shouldCommitWUnit)
+                        wunit.commit();
+                }
 
-            n++;
-            progress->hit();
+                n++;
+                progress->hit();
 
-            progress->setTotalWhileRunning( _collection->numRecords(_txn) );
-        }
+                progress->setTotalWhileRunning( _collection->numRecords(_txn) );
+            }
 
-        if (state != PlanExecutor::IS_EOF) {
-            uasserted(28550, 
-                      "Unable to complete index build as the collection is no longer readable");
+            if (state != PlanExecutor::IS_EOF) {
+                uasserted(28550,
+                          "Unable to complete index build as the collection is no longer readable");
+            }
         }
 
         progress->finished();
@@ -271,8 +440,71 @@ namespace mongo {
         return Status::OK();
     }
 
+    bool MultiIndexBlock::canInsertInParallel(std::vector<BtreeBasedBulkAccessMethod*>* bulks,
+                                              std::vector<RecordIterator*>* ranges) {
+        if (_buildInBackground || internalIndexBuildParallelThreads <= 1)
+            return false;
+
+        for (size_t i = 0; i < _indexes.size(); i++) {
+            BtreeBasedBulkAccessMethod* bulk =
+                dynamic_cast<BtreeBasedBulkAccessMethod*>(_indexes[i].bulk.get());
+            if (!bulk || !bulk->canInsertFromThreads())
+                return false;
+            bulks->push_back(bulk);
+        }
+
+        *ranges = _collection->getManyIterators(_txn);
+        return ranges->size() > 1;
+    }
+
+    Status MultiIndexBlock::insertInParallel(const std::vector<BtreeBasedBulkAccessMethod*>& bulks,
+                                             const std::vector<RecordIterator*>& ranges,
+                                             ProgressMeter* progress,
+                                             unsigned long long* numScanned) {
+        const size_t numThreads = std::min(ranges.size(),
+                                           static_cast<size_t>(internalIndexBuildParallelThreads));
+        for (size_t i = 0; i < bulks.size(); i++) {
+            bulks[i]->setInsertThreads(numThreads);
+        }
+
+        log() << "\t scanning " << ranges.size() << " ranges on " << numThreads << " threads";
+
+        ParallelBulkInserter inserter(bulks, ranges, numThreads, _numSharedKeyFields);
+        while (!inserter.isEOF()) {
+            if (_allowInterruption)
+                _txn->checkForInterrupt();
+
+            unsigned long long scanned = 0;
+            Status status = inserter.runRound(&scanned);
+            if (!status.isOK())
+                return status;
+
+            *numScanned += scanned;
+            progress->hit(scanned);
+            progress->setTotalWhileRunning( _collection->numRecords(_txn) );
+        }
+
+        return Status::OK();
+    }
+
     Status MultiIndexBlock::insert(const BSONObj& doc, const DiskLoc& loc) {
+        // A wide document's fields are found in one walk for the keys of all the indexes, rather
+        // than in one walk per field.
+        _fieldIndex.reset();
+        if (_numSharedKeyFields > 0)
+            _fieldIndex.expectProbes(doc, _numSharedKeyFields);
+
         for ( size_t i = 0; i < _indexes.size(); i++ ) {
+            if (_indexes[i].btreeBulk) {
+                Status idxStatus = _indexes[i].btreeBulk->insertFromThread(0,
+                                                                           doc,
+                                                                           loc,
+                                                                           &_fieldIndex);
+                if ( !idxStatus.isOK() )
+                    return idxStatus;
+                continue;
+            }
+
             int64_t unused;
             Status idxStatus = _indexes[i].forInsert()->insert( _txn,
                                                                doc,
@@ -300,6 +532,29 @@ namespace mongo {
             }
         }
 
+        return applySideWrites(false);
+    }
+
+    Status MultiIndexBlock::applySideWrites(bool final) {
+        for ( size_t i = 0; i < _indexes.size(); i++ ) {
+            if (!_indexes[i].sideWrites)
+                continue;
+
+            BtreeBasedAccessMethod* btree = static_cast<BtreeBasedAccessMethod*>(_indexes[i].real);
+            size_t numApplied;
+            do {
+                Status status = btree->applySideWrites(_txn,
+                                                       _indexes[i].sideWrites.get(),
+                                                       !final && _allowInterruption,
+                                                       &numApplied);
+                if (!status.isOK())
+                    return status;
+
+                LOG(1) << "\t applied " << numApplied << " writes made during the build of index: "
+                       << _indexes[i].block->getEntry()->descriptor()->indexName();
+            } while (!final && numApplied > kSideWritesLeftForCommit);
+        }
+
         return Status::OK();
     }
 
@@ -312,7 +567,14 @@ namespace mongo {
     }
 
     void MultiIndexBlock::commit() {
+        // Nobody else can write under the exclusive lock, so this applies the last of them.
+        uassertStatusOK(applySideWrites(true));
+
         for ( size_t i = 0; i < _indexes.size(); i++ ) {
+            if (_indexes[i].sideWrites) {
+                static_cast<BtreeBasedAccessMethod*>(_indexes[i].real)->setSideWrites(
+                    boost::shared_ptr<IndexSideWrites>());
+            }
             _indexes[i].block->success();
         }
 
@@ -36,6 +36,7 @@
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/base/status.h"
+#include "mongo/bson/bson_field_index.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/index/index_access_method.h"
 
@@ -43,8 +44,19 @@ namespace mongo {
 
     class BackgroundOperation;
     class BSONObj;
+    class BtreeBasedBulkAccessMethod;
     class Collection;
+    class IndexSideWrites;
     class OperationContext;
+    class ProgressMeter;
+    class RecordIterator;
+
+    // How many threads foreground index builds may read the collection on, when they can.
+    extern int internalIndexBuildParallelThreads;
+
+    // Whether background builds of non-unique indexes load a snapshot of the collection in bulk
+    // and apply the concurrent writes afterwards, rather than inserting each document's keys.
+    extern bool internalIndexBuildBackgroundBulk;
 
     /**
      * Builds one or more indexes.
@@ -160,6 +172,9 @@ namespace mongo {
          * the set. Documents added to this set are not indexed, so callers MUST either fail this
          * index build or delete the documents from the collection.
          *
+         * Background builds which were loaded in bulk also apply the writes made meanwhile, until
+         * few enough are left for commit().
+         *
          * Should not be called inside of a WriteUnitOfWork.
          */
         Status doneInserting(std::set<DiskLoc>* dupsOut = NULL);
@@ -171,7 +186,8 @@ namespace mongo {
          * Should be called inside of a WriteUnitOfWork. If the index building is to be logOp'd,
          * logOp() should be called from the same unit of work as commit().
          *
-         * Requires holding an exclusive database lock.
+         * Requires holding an exclusive database lock.  Applies the last of the writes made during
+         * a background build loaded in bulk, and throws if one of them can't be.
          */
         void commit();
 
@@ -196,8 +212,34 @@ namespace mongo {
     private:
         class SetNeedToCleanupOnRollback;
 
+        /**
+         * Returns true if insertAllDocumentsInCollection() can scan on several threads: the build
+         * is in the foreground, every index has a bulk builder whose keys can be generated
+         * concurrently, and the collection splits into more than one range.  If so, fills in
+         * 'bulks' and 'ranges', which caller owns.
+         */
+        bool canInsertInParallel(std::vector<BtreeBasedBulkAccessMethod*>* bulks,
+                                 std::vector<RecordIterator*>* ranges);
+
+        /**
+         * Inserts the documents of 'ranges' into 'bulks', scanning the ranges and generating the
+         * keys on a pool of threads, each with its own sorters.  Adds the number of documents to
+         * 'numScanned'.
+         */
+        Status insertInParallel(const std::vector<BtreeBasedBulkAccessMethod*>& bulks,
+                                const std::vector<RecordIterator*>& ranges,
+                                ProgressMeter* progress,
+                                unsigned long long* numScanned);
+
+        /**
+         * Applies the writes recorded for the indexes loaded in bulk during a background build.
+         * If 'final', applies all of them, without checking for interrupts; otherwise repeats
+         * while more than a few arrive meanwhile.
+         */
+        Status applySideWrites(bool final);
+
         struct IndexToBuild {
-            IndexToBuild() : real(NULL) {}
+            IndexToBuild() : real(NULL), btreeBulk(NULL) {}
 
             IndexAccessMethod* forInsert() { return bulk ? bulk.get() : real; }
 
@@ -206,6 +248,12 @@ namespace mongo {
             IndexAccessMethod* real; // owned elsewhere
             boost::shared_ptr<IndexAccessMethod> bulk;
 
+            // 'bulk' if it is one, which can share the lookup of a document's fields.
+            BtreeBasedBulkAccessMethod* btreeBulk;
+
+            // Set for background builds loaded in bulk, while real writes to it instead.
+            boost::shared_ptr<IndexSideWrites> sideWrites;
+
             InsertDeleteOptions options;
         };
 
@@ -213,6 +261,11 @@ namespace mongo {
 
         boost::scoped_ptr<BackgroundOperation> _backgroundOperation;
 
+        // Finds the top level fields of each document passed to insert() for all the indexes
+        // with a btreeBulk, which generate keys from _numSharedKeyFields fields between them.
+        BSONFieldIndex _fieldIndex;
+        int _numSharedKeyFields;
+
 
         // Pointers not owned here and must outlive 'this'
         Collection* _collection;
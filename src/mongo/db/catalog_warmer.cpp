@@ -0,0 +1,156 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/catalog_warmer.h"
+
+#include <list>
+#include <set>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_catalog_entry.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/concurrency/d_concurrency.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/background.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    // The most collections opened before the warmer releases its locks.  0 turns it off, and
+    // the collections are then only opened by the first operation which uses them.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(catalogWarmerBatchSize, int, 100);
+
+    // How long the warmer sleeps between two batches.
+    MONGO_EXPORT_SERVER_PARAMETER(catalogWarmerSleepMillis, int, 10);
+
+namespace {
+
+    Counter64 collectionsWarmed;
+    ServerStatusMetricField<Counter64> collectionsWarmedDisplay("catalogWarmer.collections",
+                                                                &collectionsWarmed);
+
+    /**
+     * The storage engines only read the names of the collections when the server starts, and
+     * open the collections, their record stores and their indexes, when they are first used.
+     * This job opens the rest in the background, in batches which hold intent locks only.
+     */
+    class CatalogWarmer : public BackgroundJob {
+    public:
+        CatalogWarmer() : BackgroundJob(true /* selfDelete */) { }
+        virtual ~CatalogWarmer() { }
+
+        virtual std::string name() const { return "CatalogWarmer"; }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            Timer timer;
+            std::set<std::string> dbNames;
+            dbHolder().getAllShortNames(dbNames);
+
+            for (std::set<std::string>::const_iterator it = dbNames.begin();
+                 it != dbNames.end() && !inShutdown();
+                 ++it) {
+                warmDatabase(*it);
+            }
+
+            LOG(1) << "catalog warmer visited " << collectionsWarmed.get() << " collections in "
+                   << timer.millis() << "ms";
+        }
+
+    private:
+        void warmDatabase(const std::string& dbName) {
+            OperationContextImpl txn;
+
+            std::list<std::string> namespaces;
+            {
+                Lock::DBLock dbLock(txn.lockState(), dbName, MODE_IS);
+                Database* db = dbHolder().get(&txn, dbName);
+                if (!db) {
+                    return;
+                }
+                db->getDatabaseCatalogEntry()->getCollectionNamespaces(&namespaces);
+            }
+
+            std::list<std::string>::const_iterator ns = namespaces.begin();
+            while (ns != namespaces.end()) {
+                if (inShutdown()) {
+                    return;
+                }
+
+                {
+                    Lock::DBLock dbLock(txn.lockState(), dbName, MODE_IS);
+                    Database* db = dbHolder().get(&txn, dbName);
+                    if (!db) {
+                        // Dropped since the namespaces were read.
+                        return;
+                    }
+
+                    const int batchSize = std::max(1, int(catalogWarmerBatchSize));
+                    for (int i = 0; i < batchSize && ns != namespaces.end(); ++i, ++ns) {
+                        Lock::CollectionLock collLock(txn.lockState(), *ns, MODE_IS);
+                        try {
+                            // Collections dropped since the namespaces were read are NULL.
+                            if (db->getCollection(&txn, *ns)) {
+                                collectionsWarmed.increment();
+                            }
+                        }
+                        catch (const DBException& e) {
+                            warning() << "catalog warmer could not open " << *ns << ": "
+                                      << e.toString();
+                        }
+                    }
+                }
+
+                sleepmillis(std::max(0, int(catalogWarmerSleepMillis)));
+            }
+        }
+    };
+
+} // namespace
+
+    void startCatalogWarmerBackgroundJob() {
+        if (catalogWarmerBatchSize <= 0) {
+            return;
+        }
+        CatalogWarmer* warmer = new CatalogWarmer();
+        warmer->go();
+    }
+
+} // namespace mongo
@@ -62,6 +62,7 @@
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/d_state.h"
 #include "mongo/scripting/engine.h"
+#include "mongo/util/concurrency/sharded_registry.h"
 #include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/file_allocator.h"
 #include "mongo/util/mongoutils/str.h"
@@ -72,8 +73,26 @@ namespace mongo {
 
     using logger::LogComponent;
 
-    mongo::mutex& Client::clientsMutex = *(new mutex("clientsMutex"));
-    set<Client*>& Client::clients = *(new set<Client*>); // always be in clientsMutex when manipulating this
+    namespace {
+        // Never deleted, as clients may still unregister during shutdown
+        ShardedRegistry<Client>& clientRegistry = *(new ShardedRegistry<Client>());
+
+        struct ProcessClient {
+            ProcessClient(Client::ClientProcessor* processor) : processor(processor) { }
+            void operator()(Client* client) const { processor->processClient(client); }
+
+            Client::ClientProcessor* const processor;
+        };
+    } // namespace
+
+    void Client::forEachClient(ClientProcessor* processor) {
+        ProcessClient function(processor);
+        clientRegistry.forEach(function);
+    }
+
+    mongo::mutex& Client::registryMutex() const {
+        return clientRegistry.mutexFor(this);
+    }
 
     TSP_DEFINE(Client, currentClient)
 
@@ -112,8 +131,7 @@ namespace mongo {
         temp << hex << showbase << pthread_self();
         _threadId = temp.str();
 #endif
-        scoped_lock bl(clientsMutex);
-        clients.insert(this);
+        clientRegistry.add(this);
     }
 
     Client::~Client() {
@@ -137,11 +155,8 @@ namespace mongo {
 
         if ( ! inShutdown() ) {
             // we can't clean up safely once we're in shutdown
-            {
-                scoped_lock bl(clientsMutex);
-                if ( ! _shutdown )
-                    clients.erase(this);
-            }
+            if ( ! _shutdown )
+                clientRegistry.remove(this);
 
             CurOp* last;
             do {
@@ -156,10 +171,7 @@ namespace mongo {
         _shutdown = true;
         if ( inShutdown() )
             return false;
-        {
-            scoped_lock bl(clientsMutex);
-            clients.erase(this);
-        }
+        clientRegistry.remove(this);
 
         return false;
     }
@@ -416,6 +428,16 @@ namespace mongo {
         fastmodinsert = false;
         upsert = false;
         keyUpdates = 0;  // unsigned, so -1 not possible
+        builderAllocs = -1;
+        builderAllocsReused = -1;
+        writeConflicts = -1;
+        evictionWaitMicros = -1;
+        lockWaitMicros = -1;
+        ticketWaitMicros = -1;
+        yieldMicros = -1;
+        fetches = -1;
+        fetchMicros = -1;
+        writeConcernMicros = -1;
         planSummary = "";
         execStats.reset();
         
@@ -486,6 +508,16 @@ namespace mongo {
         OPDEBUG_TOSTRING_HELP_BOOL( fastmodinsert );
         OPDEBUG_TOSTRING_HELP_BOOL( upsert );
         OPDEBUG_TOSTRING_HELP( keyUpdates );
+        OPDEBUG_TOSTRING_HELP( builderAllocs );
+        OPDEBUG_TOSTRING_HELP( builderAllocsReused );
+        OPDEBUG_TOSTRING_HELP( writeConflicts );
+        OPDEBUG_TOSTRING_HELP( evictionWaitMicros );
+        OPDEBUG_TOSTRING_HELP( lockWaitMicros );
+        OPDEBUG_TOSTRING_HELP( ticketWaitMicros );
+        OPDEBUG_TOSTRING_HELP( yieldMicros );
+        OPDEBUG_TOSTRING_HELP( fetches );
+        OPDEBUG_TOSTRING_HELP( fetchMicros );
+        OPDEBUG_TOSTRING_HELP( writeConcernMicros );
         
         if ( extra.len() )
             s << " " << extra.str();
@@ -579,6 +611,16 @@ namespace mongo {
         OPDEBUG_APPEND_BOOL( fastmodinsert );
         OPDEBUG_APPEND_BOOL( upsert );
         OPDEBUG_APPEND_NUMBER( keyUpdates );
+        OPDEBUG_APPEND_NUMBER( builderAllocs );
+        OPDEBUG_APPEND_NUMBER( builderAllocsReused );
+        OPDEBUG_APPEND_NUMBER( writeConflicts );
+        OPDEBUG_APPEND_NUMBER( evictionWaitMicros );
+        OPDEBUG_APPEND_NUMBER( lockWaitMicros );
+        OPDEBUG_APPEND_NUMBER( ticketWaitMicros );
+        OPDEBUG_APPEND_NUMBER( yieldMicros );
+        OPDEBUG_APPEND_NUMBER( fetches );
+        OPDEBUG_APPEND_NUMBER( fetchMicros );
+        OPDEBUG_APPEND_NUMBER( writeConcernMicros );
 
         b.appendNumber( "numYield" , curop.numYields() );
 
@@ -594,6 +636,14 @@ namespace mongo {
         return true;
     }
 
+    void OpDebug::appendWaits(BSONObjBuilder& b) const {
+        OPDEBUG_APPEND_NUMBER( evictionWaitMicros );
+        OPDEBUG_APPEND_NUMBER( yieldMicros );
+        OPDEBUG_APPEND_NUMBER( fetches );
+        OPDEBUG_APPEND_NUMBER( fetchMicros );
+        OPDEBUG_APPEND_NUMBER( writeConcernMicros );
+    }
+
     void saveGLEStats(const BSONObj& result, const std::string& conn) {
         // This can be called in mongod, which is unfortunate.  To fix this,
         // we can redesign how connection pooling works on mongod for sharded operations.
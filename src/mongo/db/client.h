@@ -154,9 +154,28 @@ namespace mongo {
     /** the database's concept of an outside "client" */
     class Client : public ClientBasic {
     public:
-        // always be in clientsMutex when manipulating this. killop stuff uses these.
-        static std::set<Client*>& clients;
-        static mongo::mutex& clientsMutex;
+        /**
+         * Callback for forEachClient, invoked with the registry shard of the client locked, which
+         * keeps the client and its CurOp chain from going away. Should do as little work as
+         * possible and must not create or destroy clients.
+         */
+        class ClientProcessor {
+        public:
+            virtual ~ClientProcessor() { }
+            virtual void processClient(Client* client) = 0;
+        };
+
+        /**
+         * Calls the processor for every registered client. The registry is sharded and only one
+         * shard is locked at a time, so new connections are not held up by the whole walk.
+         */
+        static void forEachClient(ClientProcessor* processor);
+
+        /**
+         * The mutex held by forEachClient while it visits this client. Hold it when changing the
+         * CurOp chain of the client in a way which may free a CurOp.
+         */
+        mongo::mutex& registryMutex() const;
 
         ~Client();
 
@@ -104,6 +104,11 @@ namespace mongo {
         _pinValue = 0;
         _pos = 0;
 
+        _readAhead = false;
+        _readAheadBytes = 0;
+        _hasReadAheadEnd = false;
+        _readAheadEndState = PlanExecutor::IS_EOF;
+
         if (_queryOptions & QueryOption_NoCursorTimeout) {
             // cursors normally timeout after an inactivity period to prevent excess memory use
             // setting this prevents timeout of the cursor in question.
@@ -202,6 +207,35 @@ namespace mongo {
         return _ownedRU.release();
     }
 
+    void ClientCursor::pushReadAheadResult(const BSONObj& obj) {
+        invariant(obj.isOwned());
+        _readAheadResults.push_back(obj);
+        _readAheadBytes += obj.objsize();
+    }
+
+    void ClientCursor::setReadAheadEnd(PlanExecutor::ExecState state, const BSONObj& obj) {
+        _hasReadAheadEnd = true;
+        _readAheadEndState = state;
+        _readAheadEndObj = obj.getOwned();
+    }
+
+    PlanExecutor::ExecState ClientCursor::getNext(BSONObj* objOut) {
+        if (!_readAheadResults.empty()) {
+            *objOut = _readAheadResults.front();
+            _readAheadResults.pop_front();
+            _readAheadBytes -= objOut->objsize();
+            return PlanExecutor::ADVANCED;
+        }
+
+        if (_hasReadAheadEnd) {
+            _hasReadAheadEnd = false;
+            *objOut = _readAheadEndObj;
+            return _readAheadEndState;
+        }
+
+        return _exec->getNext(objOut, NULL);
+    }
+
     //
     // Pin methods
     // TODO: Simplify when we kill Cursor.  In particular, once we've pinned a CC, it won't be
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <boost/thread/recursive_mutex.hpp>
+#include <deque>
 
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobj.h"
@@ -135,6 +136,36 @@ namespace mongo {
         void incPos(int n) { _pos += n; }
         void setPos(int n) { _pos = n; }
 
+        //
+        // Read-ahead of the next batch between getMores.  See readAheadCursor in new_find.h.
+        //
+
+        bool readAhead() const { return _readAhead; }
+        void setReadAhead(bool readAhead) { _readAhead = readAhead; }
+
+        /**
+         * Buffers a result read ahead from the executor.  'obj' must be owned.
+         */
+        void pushReadAheadResult(const BSONObj& obj);
+
+        /**
+         * Records that reading ahead ended the executor with 'state' (DEAD or EXEC_ERROR) and
+         * 'obj', to be returned once the buffered results are gone.
+         */
+        void setReadAheadEnd(PlanExecutor::ExecState state, const BSONObj& obj);
+
+        /**
+         * The bytes of results buffered by read-ahead.
+         */
+        size_t readAheadBytes() const { return _readAheadBytes; }
+
+        /**
+         * Returns the results buffered by read-ahead, then the state it ended with if any, and
+         * after that the results of the executor.  Like PlanExecutor::getNext without a
+         * DiskLoc.
+         */
+        PlanExecutor::ExecState getNext(BSONObj* objOut);
+
         /**
          * Is this ClientCursor backed by an aggregation pipeline. Defaults to false.
          *
@@ -240,6 +271,15 @@ namespace mongo {
         // TODO: Document.
         uint64_t _leftoverMaxTimeMicros;
 
+        // Results of _exec computed ahead of the next getMore, and their total size.  If
+        // _hasReadAheadEnd, the executor came to the end with _readAheadEndState.
+        bool _readAhead;
+        std::deque<BSONObj> _readAheadResults;
+        size_t _readAheadBytes;
+        bool _hasReadAheadEnd;
+        PlanExecutor::ExecState _readAheadEndState;
+        BSONObj _readAheadEndObj;
+
         // For chunks that are being migrated, there is a period of time when that chunks data is in
         // two shards, the donor and the receiver one. That data is picked up by a cursor on the
         // receiver side, even before the migration was decided.  The CollectionMetadata allow one
@@ -34,15 +34,19 @@
 
 #include "mongo/db/cloner.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/base/status.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
+#include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/internal_user_auth.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database_holder.h"
 #include "mongo/db/catalog/index_create.h"
+#include "mongo/db/client.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/commands/copydb.h"
 #include "mongo/db/commands/rename_collection.h"
@@ -51,16 +55,30 @@
 #include "mongo/db/index_builder.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/operation_context_impl.h"
 #include "mongo/db/repl/isself.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/log.h"
+#include "mongo/util/queue.h"
 
 namespace mongo {
 
     MONGO_EXPORT_SERVER_PARAMETER(skipCorruptDocumentsWhenCloning, bool, false);
 
+    // The documents of a clone are inserted in units of work of about this many bytes.
+    MONGO_EXPORT_SERVER_PARAMETER(cloneBytesPerUnitOfWork, int, 1024 * 1024);
+
+    // The most batches of documents read from the source ahead of the ones being inserted.
+    // 0 reads each batch only once the previous one is inserted.
+    MONGO_EXPORT_SERVER_PARAMETER(cloneReadAheadBatches, int, 4);
+
+    // The most collections of a database cloned at the same time, each on its own thread and
+    // connection to the source.
+    MONGO_EXPORT_SERVER_PARAMETER(cloneCollectionThreads, int, 4);
+
     BSONElement getErrField(const BSONObj& o);
 
     /* for index info object:
@@ -98,7 +116,125 @@ namespace mongo {
         return res;
     }
 
-    Cloner::Cloner() { }
+    Cloner::Cloner() : _canConnect(false), _authenticateInternalUser(false) { }
+
+namespace {
+
+    /**
+     * Reads a collection from the source on a thread of its own, into batches of owned
+     * documents which wait in a bounded queue for the thread that inserts them.
+     */
+    class CloneReadAhead {
+        MONGO_DISALLOW_COPYING(CloneReadAhead);
+    public:
+        struct Batch {
+            Batch() : last(false) { }
+
+            std::vector<BSONObj> docs;
+            // Set on the empty batch which follows the last one read
+            bool last;
+        };
+
+        CloneReadAhead(DBClientBase* conn,
+                       const NamespaceString& ns,
+                       const Query& query,
+                       int queryOptions,
+                       int maxBatches)
+            : _conn(conn),
+              _ns(ns),
+              _query(query),
+              _queryOptions(queryOptions),
+              // The queue is full one item before its max size.
+              _queue(maxBatches + 1),
+              _status(Status::OK()) {
+        }
+
+        /**
+         * Body of the reader thread.
+         */
+        void run() {
+            try {
+                _conn->query(stdx::function<void(DBClientCursorBatchIterator&)>(
+                                 stdx::bind(&CloneReadAhead::_readBatch,
+                                            this,
+                                            stdx::placeholders::_1)),
+                             _ns.ns(), _query, 0, _queryOptions);
+            }
+            catch (const DBException& e) {
+                _status = e.toStatus();
+            }
+
+            // Popping this batch is what makes _status visible to the inserting thread.
+            Batch last;
+            last.last = true;
+            _queue.push(last);
+        }
+
+        Batch next() {
+            return _queue.blockingPop();
+        }
+
+        /**
+         * Stops the reader at the next batch it reads, and waits for it to get there.  The
+         * connection is left in the middle of the query's reply, so it can not be used again.
+         */
+        void abandon() {
+            _abandoned.store(1);
+            while (!next().last) {
+            }
+        }
+
+        /**
+         * Why the reader failed.  Only valid once the last batch is popped.
+         */
+        const Status& status() const {
+            return _status;
+        }
+
+    private:
+        void _readBatch(DBClientCursorBatchIterator& it) {
+            uassert(28635, "clone abandoned by the inserting thread", !_abandoned.load());
+
+            Batch batch;
+            while (it.moreInCurrentBatch()) {
+                batch.docs.push_back(it.nextSafe().getOwned());
+            }
+            _queue.push(batch);
+        }
+
+        DBClientBase* const _conn;
+        const NamespaceString _ns;
+        const Query _query;
+        const int _queryOptions;
+
+        BlockingQueue<Batch> _queue;
+        AtomicUInt32 _abandoned;
+        Status _status;
+    };
+
+    /**
+     * Iterates a batch read ahead, as DBClientCursorBatchIterator iterates a batch of a cursor.
+     */
+    class BufferedBatchIterator {
+    public:
+        explicit BufferedBatchIterator(const std::vector<BSONObj>& docs)
+            : _docs(docs), _next(0) {
+        }
+
+        bool moreInCurrentBatch() const {
+            return _next < _docs.size();
+        }
+
+        BSONObj nextSafe() {
+            return _docs[_next++];
+        }
+
+    private:
+        const std::vector<BSONObj>& _docs;
+        size_t _next;
+    };
+
+} // namespace
 
     struct Cloner::Fun {
         Fun(OperationContext* txn, const string& dbName)
@@ -108,18 +244,38 @@ namespace mongo {
         {}
 
         void operator()( DBClientCursorBatchIterator &i ) {
+            insertBatch(i);
+        }
+
+        template <typename BatchIterator>
+        void insertBatch( BatchIterator &i ) {
             invariant(from_collection.coll() != "system.indexes");
 
-            // XXX: can probably take dblock instead
-            Lock::GlobalWrite lk(txn->lockState());
+            // Intent locks if the collection exists, as the write commands take them, so that
+            // the collections of a database can be cloned at the same time.
+            scoped_ptr<Lock::DBLock> dbLock(new Lock::DBLock(txn->lockState(), _dbName, MODE_IX));
+            scoped_ptr<Lock::CollectionLock> collLock;
+            Collection* collection = NULL;
+            if ( Database* existingDb = dbHolder().get(txn, _dbName) ) {
+                collLock.reset(new Lock::CollectionLock(txn->lockState(),
+                                                        to_collection.ns(),
+                                                        MODE_IX));
+                collection = existingDb->getCollection( txn, to_collection );
+            }
 
-            // Make sure database still exists after we resume from the temp release
-            Database* db = dbHolder().openDb(txn, _dbName);
+            Database* db = NULL;
+            if ( !collection ) {
+                collLock.reset();
+                dbLock.reset();
+                dbLock.reset(new Lock::DBLock(txn->lockState(), _dbName, MODE_X));
+
+                // Make sure database still exists after we resume from the temp release
+                db = dbHolder().openDb(txn, _dbName);
+                collection = db->getCollection( txn, to_collection );
+            }
 
             bool createdCollection = false;
-            Collection* collection = NULL;
 
-            collection = db->getCollection( txn, to_collection );
             if ( !collection ) {
                 massert( 17321,
                          str::stream()
@@ -140,51 +296,60 @@ namespace mongo {
             }
 
             while( i.moreInCurrentBatch() ) {
-                if ( numSeen % 128 == 127 ) {
-                    time_t now = time(0);
-                    if( now - lastLog >= 60 ) {
-                        // report progress
-                        if( lastLog )
-                            log() << "clone " << to_collection << ' ' << numSeen << endl;
-                        lastLog = now;
+                // One unit of work for many documents: a commit per document is what made
+                // cloning slow on engines whose commits aren't free.
+                WriteUnitOfWork wunit(txn);
+                int bytesInUnitOfWork = 0;
+
+                while( i.moreInCurrentBatch() &&
+                       bytesInUnitOfWork < cloneBytesPerUnitOfWork ) {
+                    if ( numSeen % 128 == 127 ) {
+                        time_t now = time(0);
+                        if( now - lastLog >= 60 ) {
+                            // report progress
+                            if( lastLog )
+                                log() << "clone " << to_collection << ' ' << numSeen << endl;
+                            lastLog = now;
+                        }
                     }
-                }
-
-                BSONObj tmp = i.nextSafe();
 
-                /* assure object is valid.  note this will slow us down a little. */
-                const Status status = validateBSON(tmp.objdata(), tmp.objsize());
-                if (!status.isOK()) {
-                    str::stream ss;
-                    ss << "Cloner: found corrupt document in " << from_collection.toString()
-                          << ": " << status.reason();
-                    if (skipCorruptDocumentsWhenCloning) {
-                        warning() << ss.ss.str() << "; skipping";
-                        continue;
+                    BSONObj tmp = i.nextSafe();
+
+                    /* assure object is valid.  note this will slow us down a little. */
+                    const Status status = validateBSON(tmp.objdata(), tmp.objsize());
+                    if (!status.isOK()) {
+                        str::stream ss;
+                        ss << "Cloner: found corrupt document in " << from_collection.toString()
+                              << ": " << status.reason();
+                        if (skipCorruptDocumentsWhenCloning) {
+                            warning() << ss.ss.str() << "; skipping";
+                            continue;
+                        }
+                        msgasserted(28531, ss);
                     }
-                    msgasserted(28531, ss);
-                }
 
-                ++numSeen;
-                WriteUnitOfWork wunit(txn);
+                    ++numSeen;
 
-                BSONObj js = tmp;
+                    BSONObj js = tmp;
 
-                StatusWith<DiskLoc> loc = collection->insertDocument( txn, js, true );
-                if ( !loc.isOK() ) {
-                    error() << "error: exception cloning object in " << from_collection
-                            << ' ' << loc.toString() << " obj:" << js;
-                }
-                uassertStatusOK( loc.getStatus() );
-                if (logForRepl)
-                    repl::logOp(txn, "i", to_collection.ns().c_str(), js);
+                    StatusWith<DiskLoc> loc = collection->insertDocument( txn, js, true );
+                    if ( !loc.isOK() ) {
+                        error() << "error: exception cloning object in " << from_collection
+                                << ' ' << loc.toString() << " obj:" << js;
+                    }
+                    uassertStatusOK( loc.getStatus() );
+                    if (logForRepl)
+                        repl::logOp(txn, "i", to_collection.ns().c_str(), js);
 
-                wunit.commit();
+                    bytesInUnitOfWork += js.objsize();
 
-                RARELY if ( time( 0 ) - saveLast > 60 ) {
-                    log() << numSeen << " objects cloned so far from collection " << from_collection;
-                    saveLast = time( 0 );
+                    RARELY if ( time( 0 ) - saveLast > 60 ) {
+                        log() << numSeen << " objects cloned so far from collection " << from_collection;
+                        saveLast = time( 0 );
+                    }
                 }
+
+                wunit.commit();
             }
         }
 
@@ -204,6 +369,7 @@ namespace mongo {
     /* copy the specified collection
     */
     void Cloner::copy(OperationContext* txn,
+                      DBClientBase* conn,
                       const string& toDBName,
                       const NamespaceString& from_collection,
                       const NamespaceString& to_collection,
@@ -213,7 +379,7 @@ namespace mongo {
                       bool mayYield,
                       bool mayBeInterrupted,
                       Query query) {
-        LOG(2) << "\t\tcloning collection " << from_collection << " to " << to_collection << " on " << _conn->getServerAddress() << " with filter " << query.toString() << endl;
+        LOG(2) << "\t\tcloning collection " << from_collection << " to " << to_collection << " on " << conn->getServerAddress() << " with filter " << query.toString() << endl;
 
         Fun f(txn, toDBName);
         f.numSeen = 0;
@@ -225,13 +391,217 @@ namespace mongo {
         f._mayBeInterrupted = mayBeInterrupted;
 
         int options = QueryOption_NoCursorTimeout | ( slaveOk ? QueryOption_SlaveOk : 0 );
-        {
-            Lock::TempRelease tempRelease(txn->lockState());
-            _conn->query(stdx::function<void(DBClientCursorBatchIterator &)>(f), from_collection,
-                         query, 0, options);
+        Lock::TempRelease tempRelease(txn->lockState());
+
+        // A DBDirectClient runs the query on this thread's operation, so it is only read inline.
+        const int readAheadBatches = cloneReadAheadBatches;
+        if ( masterSameProcess || readAheadBatches <= 0 ||
+             dynamic_cast<DBDirectClient*>(conn) ) {
+            conn->query(stdx::function<void(DBClientCursorBatchIterator &)>(f), from_collection,
+                        query, 0, options);
+            return;
+        }
+
+        // Read the next batches from the network while this thread inserts the current one.
+        CloneReadAhead readAhead(conn, from_collection, query, options, readAheadBatches);
+        boost::thread reader(stdx::bind(&CloneReadAhead::run, &readAhead));
+        try {
+            for ( CloneReadAhead::Batch batch = readAhead.next();
+                  !batch.last;
+                  batch = readAhead.next() ) {
+                BufferedBatchIterator it(batch.docs);
+                f.insertBatch(it);
+            }
+        }
+        catch (...) {
+            readAhead.abandon();
+            reader.join();
+            throw;
         }
+        reader.join();
+        uassertStatusOK(readAhead.status());
     }
 
+    void Cloner::copyCollectionData(OperationContext* txn,
+                                    DBClientBase* conn,
+                                    const string& toDBName,
+                                    const NamespaceString& from_name,
+                                    const NamespaceString& to_name,
+                                    const CloneOptions& opts,
+                                    bool masterSameProcess) {
+        LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
+        Query q;
+        if( opts.snapshot )
+            q.snapshot();
+
+        copy(txn,
+             conn,
+             toDBName,
+             from_name,
+             to_name,
+             opts.logForRepl,
+             masterSameProcess,
+             opts.slaveOk,
+             opts.mayYield,
+             opts.mayBeInterrupted,
+             q);
+
+        Database* db = dbHolder().get(txn, toDBName);
+        uassert(18645,
+                str::stream() << "database " << toDBName << " dropped during clone",
+                db);
+
+        Collection* c = db->getCollection( txn, to_name );
+        if ( c && !c->getIndexCatalog()->haveIdIndex( txn ) ) {
+            // We need to drop objects with duplicate _ids because we didn't do a true
+            // snapshot and this is before applying oplog operations that occur during the
+            // initial sync.
+            set<DiskLoc> dups;
+
+            MultiIndexBlock indexer(txn, c);
+            if (opts.mayBeInterrupted)
+                indexer.allowInterruption();
+
+            uassertStatusOK(indexer.init(c->getIndexCatalog()->getDefaultIdIndexSpec()));
+            uassertStatusOK(indexer.insertAllDocumentsInCollection(&dups));
+
+            for (set<DiskLoc>::const_iterator it = dups.begin(); it != dups.end(); ++it) {
+                WriteUnitOfWork wunit(txn);
+                BSONObj id;
+
+                c->deleteDocument(txn, *it, true, true, opts.logForRepl ? &id : NULL);
+                if (opts.logForRepl)
+                    repl::logOp(txn, "d", c->ns().ns().c_str(), id);
+                wunit.commit();
+            }
+
+            if (!dups.empty()) {
+                log() << "index build dropped: " << dups.size() << " dups";
+            }
+
+            WriteUnitOfWork wunit(txn);
+            indexer.commit();
+            if (opts.logForRepl) {
+                repl::logOp(txn,
+                            "i",
+                            c->ns().getSystemIndexesCollection().c_str(),
+                            c->getIndexCatalog()->getDefaultIdIndexSpec());
+            }
+            wunit.commit();
+        }
+    }
+
+    DBClientBase* Cloner::connectToSource(string& errmsg) const {
+        invariant(_canConnect);
+        auto_ptr<DBClientBase> con( _source.connect( errmsg ) );
+        if ( !con.get() )
+            return NULL;
+        if (_authenticateInternalUser &&
+            getGlobalAuthorizationManager()->isAuthEnabled() &&
+            !authenticateInternalUser(con.get())) {
+
+            errmsg = "could not authenticate to " + _source.toString();
+            return NULL;
+        }
+        return con.release();
+    }
+
+    /**
+     * Copies the data of the collections of a database on several threads.  Each thread has
+     * its own connection to the source and operation, and copies one collection at a time.
+     */
+    class Cloner::ParallelCollectionClone {
+        MONGO_DISALLOW_COPYING(ParallelCollectionClone);
+    public:
+        ParallelCollectionClone(const Cloner* cloner,
+                                const std::string& toDBName,
+                                const list<BSONObj>& collections,
+                                const CloneOptions& opts)
+            : _cloner(cloner),
+              _toDBName(toDBName),
+              _collections(collections.begin(), collections.end()),
+              _opts(opts),
+              _mutex("ParallelCollectionClone"),
+              _next(0),
+              _status(Status::OK()) {
+        }
+
+        // Body of each cloner thread
+        void run(int threadNumber) {
+            const std::string threadName = str::stream() << "cloner " << threadNumber;
+            Client::initThread(threadName.c_str());
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            try {
+                std::string errmsg;
+                Cloner cloner;
+                DBClientBase* conn = _cloner->connectToSource(errmsg);
+                if (!conn) {
+                    _fail(Status(ErrorCodes::HostUnreachable, errmsg));
+                }
+                else {
+                    cloner.setConnection(conn);
+
+                    OperationContextImpl txn;
+                    size_t i;
+                    while (_nextCollection(&i)) {
+                        const char* collectionName = _collections[i]["name"].valuestr();
+
+                        // Copying starts with releasing the lock it is called with.
+                        Lock::DBLock dbWrite(txn.lockState(), _toDBName, MODE_X);
+                        cloner.copyCollectionData(&txn,
+                                                  conn,
+                                                  _toDBName,
+                                                  NamespaceString(_opts.fromDB, collectionName),
+                                                  NamespaceString(_toDBName, collectionName),
+                                                  _opts,
+                                                  false);
+                    }
+                }
+            }
+            catch (const DBException& e) {
+                _fail(e.toStatus());
+            }
+
+            cc().shutdown();
+        }
+
+        /**
+         * The first error of the cloner threads, after they are joined.
+         */
+        Status status() const {
+            mutex::scoped_lock lk(_mutex);
+            return _status;
+        }
+
+    private:
+        bool _nextCollection(size_t* i) {
+            mutex::scoped_lock lk(_mutex);
+            if (!_status.isOK() || _next == _collections.size()) {
+                return false;
+            }
+            *i = _next++;
+            return true;
+        }
+
+        void _fail(const Status& status) {
+            mutex::scoped_lock lk(_mutex);
+            if (_status.isOK()) {
+                _status = status;
+            }
+        }
+
+        const Cloner* const _cloner;
+        const std::string _toDBName;
+        const std::vector<BSONObj> _collections;
+        const CloneOptions& _opts;
+
+        mutable mutex _mutex;
+        // Guarded by _mutex
+        size_t _next;
+        Status _status;
+    };
+
     void Cloner::copyIndexes(OperationContext* txn,
                              const string& toDBName,
                              const NamespaceString& from_collection,
@@ -339,7 +709,7 @@ namespace mongo {
         }
 
         // main data
-        copy(txn, dbname,
+        copy(txn, _conn.get(), dbname,
              nss, nss,
              logForRepl, false, true, mayYield, mayBeInterrupted,
              Query(query).snapshot());
@@ -405,16 +775,14 @@ namespace mongo {
                 // nothing to do
             }
             else if ( !masterSameProcess ) {
-                auto_ptr<DBClientBase> con( cs.connect( errmsg ));
+                _source = cs;
+                _authenticateInternalUser = true;
+                auto_ptr<DBClientBase> con( connectToSource( errmsg ) );
                 if ( !con.get() )
                     return false;
-                if (getGlobalAuthorizationManager()->isAuthEnabled() &&
-                    !authenticateInternalUser(con.get())) {
-
-                    return false;
-                }
 
                 _conn = con;
+                _canConnect = true;
             }
             else {
                 _conn.reset(new DBDirectClient(txn));
@@ -488,88 +856,66 @@ namespace mongo {
                 const char* collectionName = collection["name"].valuestr();
                 BSONObj options = collection.getObjectField("options");
 
-                NamespaceString from_name( opts.fromDB, collectionName );
                 NamespaceString to_name( toDBName, collectionName );
 
-                Database* db;
-                {
-                    WriteUnitOfWork wunit(txn);
-                    // Copy releases the lock, so we need to re-load the database. This should
-                    // probably throw if the database has changed in between, but for now preserve
-                    // the existing behaviour.
-                    db = dbHolder().openDb(txn, toDBName);
-
-                    // we defer building id index for performance - building it in batch is much
-                    // faster
-                    Status createStatus = userCreateNS( txn, db, to_name.ns(), options,
-                                                        opts.logForRepl, false );
-                    if ( !createStatus.isOK() ) {
-                        errmsg = str::stream() << "failed to create collection \""
-                                               << to_name.ns() << "\": "
-                                               << createStatus.reason();
-                        return false;
-                    }
-                    wunit.commit();
+                WriteUnitOfWork wunit(txn);
+                // Copy releases the lock, so we need to re-load the database. This should
+                // probably throw if the database has changed in between, but for now preserve
+                // the existing behaviour.
+                Database* db = dbHolder().openDb(txn, toDBName);
+
+                // we defer building id index for performance - building it in batch is much
+                // faster
+                Status createStatus = userCreateNS( txn, db, to_name.ns(), options,
+                                                    opts.logForRepl, false );
+                if ( !createStatus.isOK() ) {
+                    errmsg = str::stream() << "failed to create collection \""
+                                           << to_name.ns() << "\": "
+                                           << createStatus.reason();
+                    return false;
                 }
+                wunit.commit();
+            }
 
-                LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
-                Query q;
-                if( opts.snapshot )
-                    q.snapshot();
-
-                copy(txn,
-                     toDBName,
-                     from_name,
-                     to_name,
-                     opts.logForRepl,
-                     masterSameProcess,
-                     opts.slaveOk,
-                     opts.mayYield,
-                     opts.mayBeInterrupted,
-                     q);
-
-                db = dbHolder().get(txn, toDBName);
-                uassert(18645,
-                        str::stream() << "database " << toDBName << " dropped during clone",
-                        db);
-
-                Collection* c = db->getCollection( txn, to_name );
-                if ( c && !c->getIndexCatalog()->haveIdIndex( txn ) ) {
-                    // We need to drop objects with duplicate _ids because we didn't do a true
-                    // snapshot and this is before applying oplog operations that occur during the
-                    // initial sync.
-                    set<DiskLoc> dups;
-
-                    MultiIndexBlock indexer(txn, c);
-                    if (opts.mayBeInterrupted)
-                        indexer.allowInterruption();
-
-                    uassertStatusOK(indexer.init(c->getIndexCatalog()->getDefaultIdIndexSpec()));
-                    uassertStatusOK(indexer.insertAllDocumentsInCollection(&dups));
-
-                    for (set<DiskLoc>::const_iterator it = dups.begin(); it != dups.end(); ++it) {
-                        WriteUnitOfWork wunit(txn);
-                        BSONObj id;
-
-                        c->deleteDocument(txn, *it, true, true, opts.logForRepl ? &id : NULL);
-                        if (opts.logForRepl)
-                            repl::logOp(txn, "d", c->ns().ns().c_str(), id);
-                        wunit.commit();
-                    }
+            const size_t numThreads =
+                std::min(static_cast<size_t>(std::max(int(cloneCollectionThreads), 1)),
+                         toClone.size());
 
-                    if (!dups.empty()) {
-                        log() << "index build dropped: " << dups.size() << " dups";
-                    }
+            // The other threads need connections of their own, and the locks of this thread
+            // released while they run.
+            if ( numThreads > 1 && _canConnect && !txn->lockState()->isRecursive() ) {
+                log() << "cloning " << toClone.size() << " collections of " << opts.fromDB
+                      << " on " << numThreads << " threads";
 
-                    WriteUnitOfWork wunit(txn);
-                    indexer.commit();
-                    if (opts.logForRepl) {
-                        repl::logOp(txn,
-                                    "i",
-                                    c->ns().getSystemIndexesCollection().c_str(),
-                                    c->getIndexCatalog()->getDefaultIdIndexSpec());
+                ParallelCollectionClone parallelClone(this, toDBName, toClone, opts);
+                {
+                    Lock::TempRelease tempRelease(txn->lockState());
+                    boost::thread_group threads;
+                    for ( size_t i = 0; i < numThreads; i++ ) {
+                        threads.create_thread(stdx::bind(&ParallelCollectionClone::run,
+                                                         &parallelClone,
+                                                         static_cast<int>(i)));
                     }
-                    wunit.commit();
+                    threads.join_all();
+                }
+                const Status status = parallelClone.status();
+                if ( !status.isOK() ) {
+                    if ( errCode )
+                        *errCode = status.code();
+                    errmsg = status.reason();
+                    return false;
+                }
+            }
+            else {
+                for ( list<BSONObj>::iterator i=toClone.begin(); i != toClone.end(); i++ ) {
+                    const char* collectionName = (*i)["name"].valuestr();
+                    copyCollectionData(txn,
+                                       _conn.get(),
+                                       toDBName,
+                                       NamespaceString( opts.fromDB, collectionName ),
+                                       NamespaceString( toDBName, collectionName ),
+                                       opts,
+                                       masterSameProcess);
                 }
             }
         }
@@ -48,6 +48,18 @@ namespace mongo {
 
         void setConnection(DBClientBase* c) {
             _conn.reset(c);
+            _canConnect = false;
+        }
+
+        /**
+         * Like setConnection(), for a connection made by cs.connect() and not authenticated, so
+         * that go() may open more of them to clone several collections at once.
+         */
+        void setConnection(DBClientBase* c, const ConnectionString& cs) {
+            _conn.reset(c);
+            _source = cs;
+            _canConnect = true;
+            _authenticateInternalUser = false;
         }
 
         /** copy the entire database */
@@ -69,7 +81,10 @@ namespace mongo {
                             bool logForRepl = true );
 
     private:
+        class ParallelCollectionClone;
+
         void copy(OperationContext* txn,
+                  DBClientBase* conn,
                   const std::string& toDBName,
                   const NamespaceString& from_ns,
                   const NamespaceString& to_ns,
@@ -80,6 +95,24 @@ namespace mongo {
                   bool mayBeInterrupted,
                   Query q);
 
+        /**
+         * Copies the documents of a collection which go() created and builds its _id index,
+         * dropping the documents with duplicate _ids.
+         */
+        void copyCollectionData(OperationContext* txn,
+                                DBClientBase* conn,
+                                const std::string& toDBName,
+                                const NamespaceString& from_name,
+                                const NamespaceString& to_name,
+                                const CloneOptions& opts,
+                                bool masterSameProcess);
+
+        /**
+         * Opens another connection to _source, as the connection of the cloner was made.
+         * Returns NULL and sets errmsg on failure.
+         */
+        DBClientBase* connectToSource(std::string& errmsg) const;
+
         void copyIndexes(OperationContext* txn,
                          const string& toDBName,
                          const NamespaceString& from_ns,
@@ -92,6 +125,11 @@ namespace mongo {
 
         struct Fun;
         std::auto_ptr<DBClientBase> _conn;
+
+        // Whether connectToSource() may open connections to _source, and how to authenticate them
+        bool _canConnect;
+        ConnectionString _source;
+        bool _authenticateInternalUser;
     };
 
     /**
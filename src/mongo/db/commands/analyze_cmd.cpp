@@ -0,0 +1,172 @@
+// analyze_cmd.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/query/index_stats.h"
+#include "mongo/db/query/internal_plans.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+    /**
+     * Gathers the statistics used by cost-based planning (see IndexStats) by scanning each
+     * index of a collection, or one of them, while holding the collection's read lock.
+     *
+     * { analyze: <collection>, [index: <name>], [buckets: <n>], [verbose: <bool>] }
+     */
+    class AnalyzeCmd : public Command {
+    public:
+        AnalyzeCmd() : Command("analyze") { }
+
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+
+        virtual bool slaveOk() const { return true; }
+
+        virtual void help(stringstream& help) const {
+            help << "gather index statistics for cost-based query planning\n"
+                "{ analyze : <collection_name>, [index : <name>], [buckets : <n>],"
+                " [verbose : true] }\n"
+                " analyzes every index unless one is named; verbose returns the histograms";
+        }
+
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::planCacheWrite);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual bool run(OperationContext* txn,
+                         const string& dbname,
+                         BSONObj& cmdObj,
+                         int,
+                         string& errmsg,
+                         BSONObjBuilder& result,
+                         bool fromRepl) {
+            const NamespaceString nss(parseNs(dbname, cmdObj));
+            if (!nss.isValid()) {
+                errmsg = "bad namespace name";
+                return false;
+            }
+
+            long long buckets = kDefaultBuckets;
+            if (cmdObj.hasField("buckets")) {
+                BSONElement e = cmdObj["buckets"];
+                if (!e.isNumber() || e.numberLong() < 1 || e.numberLong() > kMaxBuckets) {
+                    errmsg = str::stream() << "buckets must be a number between 1 and "
+                                           << kMaxBuckets;
+                    return false;
+                }
+                buckets = e.numberLong();
+            }
+
+            const bool verbose = cmdObj["verbose"].trueValue();
+
+            AutoGetCollectionForRead ctx(txn, nss);
+            Collection* collection = ctx.getCollection();
+            if (!collection) {
+                errmsg = "collection not found";
+                return false;
+            }
+
+            IndexCatalog* catalog = collection->getIndexCatalog();
+            std::vector<IndexDescriptor*> indexes;
+            if (cmdObj.hasField("index")) {
+                IndexDescriptor* desc = catalog->findIndexByName(txn, cmdObj["index"].str());
+                if (NULL == desc) {
+                    errmsg = "index not found";
+                    return false;
+                }
+                indexes.push_back(desc);
+            }
+            else {
+                IndexCatalog::IndexIterator ii = catalog->getIndexIterator(txn, false);
+                while (ii.more()) {
+                    indexes.push_back(ii.next());
+                }
+            }
+
+            IndexStatsCache* statsCache = collection->infoCache()->getIndexStats();
+            BSONObjBuilder indexesBob(result.subobjStart("indexes"));
+            for (size_t i = 0; i < indexes.size(); ++i) {
+                IndexDescriptor* desc = indexes[i];
+
+                // The scan does not yield, so the catalog cannot change underneath it.
+                auto_ptr<PlanExecutor> exec(InternalPlanner::indexScan(txn, collection, desc,
+                                                                       BSONObj(), BSONObj(),
+                                                                       false));
+
+                IndexStats::Builder builder(desc->keyPattern(), buckets);
+                BSONObj key;
+                PlanExecutor::ExecState state;
+                while (PlanExecutor::ADVANCED == (state = exec->getNext(&key, NULL))) {
+                    builder.addKey(key);
+                }
+                if (PlanExecutor::IS_EOF != state) {
+                    errmsg = str::stream() << "scan of index " << desc->indexName()
+                                           << " failed: " << PlanExecutor::statestr(state);
+                    return false;
+                }
+
+                IndexStats* stats = builder.done();
+                indexesBob.append(desc->indexName(), stats->toBSON(verbose));
+                statsCache->set(desc->keyPattern(), stats);
+            }
+            indexesBob.doneFast();
+
+            // Cached plans were chosen without the new statistics.
+            collection->infoCache()->clearQueryCache();
+
+            LOG(1) << nss.ns() << ": analyzed " << indexes.size() << " index(es)";
+            return true;
+        }
+
+    private:
+        static const long long kDefaultBuckets = 100;
+        static const long long kMaxBuckets = 10000;
+
+    } analyzeCmd;
+
+}  // namespace mongo
@@ -67,12 +67,66 @@ namespace mongo {
             help << "compact collection\n"
                 "warning: this operation locks the database and is slow. you can cancel with killOp()\n"
                 "{ compact : <collection_name>, [force:<bool>], [validate:<bool>],\n"
-                "  [paddingFactor:<num>], [paddingBytes:<num>] }\n"
+                "  [paddingFactor:<num>], [paddingBytes:<num>], [online:<bool>],\n"
+                "  [extentsPerBatch:<num>] }\n"
                 "  force - allows to run on a replica set primary\n"
+                "  online - keeps the indexes and moves a few extents at a time, releasing the lock\n"
+                "           in between. fine on a primary\n"
+                "  extentsPerBatch - how many extents an online compact moves at a time (default 4)\n"
                 "  validate - check records are noncorrupt before adding to newly compacting extents. slower but safer (defaults to true in this version)\n";
         }
         CompactCmd() : Command("compact") { }
 
+        /**
+         * compacts a few extents at a time, locking the database for each batch only, until the
+         * extents there were at the start are done.
+         */
+        bool runOnline(OperationContext* txn,
+                       const NamespaceString& ns,
+                       CompactOptions compactOptions,
+                       string& errmsg,
+                       BSONObjBuilder& result) {
+            log() << "compact " << ns << " begin, options: " << compactOptions.toString();
+
+            const int extentsPerBatch = compactOptions.maxExtents;
+            long long extentsToGo = -1; // known after the first batch
+            long long extentsCompacted = 0;
+            while ( extentsToGo != 0 ) {
+                txn->checkForInterrupt();
+                if ( extentsToGo > 0 )
+                    compactOptions.maxExtents = std::min<long long>( extentsPerBatch, extentsToGo );
+
+                CompactStats stats;
+                {
+                    Lock::DBLock lk(txn->lockState(), ns.db(), MODE_X);
+                    BackgroundOperation::assertNoBgOpInProgForNs(ns.ns());
+                    Client::Context ctx(txn, ns);
+
+                    Collection* collection = ctx.db()->getCollection(txn, ns.ns());
+                    if ( !collection ) {
+                        errmsg = "namespace does not exist";
+                        return false;
+                    }
+
+                    StatusWith<CompactStats> status = collection->compact( txn, &compactOptions );
+                    if ( !status.isOK() )
+                        return appendCommandStatus( result, status.getStatus() );
+                    stats = status.getValue();
+                }
+
+                extentsCompacted += stats.extentsCompacted;
+                if ( stats.extentsCompacted == 0 )
+                    break; // nothing to do, or no extents to speak of in this record store
+                if ( extentsToGo < 0 )
+                    extentsToGo = stats.extentsCompacted + stats.extentsLeft;
+                extentsToGo -= stats.extentsCompacted;
+            }
+
+            result.append( "extentsCompacted", extentsCompacted );
+            log() << "compact " << ns << " end";
+            return true;
+        }
+
         virtual std::vector<BSONObj> stopIndexBuilds(OperationContext* opCtx,
                                                      Database* db,
                                                      const BSONObj& cmdObj) {
@@ -91,9 +145,12 @@ namespace mongo {
                 return false;
             }
 
+            const bool online = cmdObj["online"].trueValue();
+
             repl::ReplicationCoordinator* replCoord = repl::getGlobalReplicationCoordinator();
             if (replCoord->getReplicationMode() == repl::ReplicationCoordinator::modeReplSet
                     && replCoord->getCurrentMemberState().primary()
+                    && !online
                     && !cmdObj["force"].trueValue()) {
                 errmsg = "will not run compact on an active replica set primary as this is a slow blocking operation. use force:true to force";
                 return false;
@@ -145,6 +202,23 @@ namespace mongo {
             if ( cmdObj.hasElement("validate") )
                 compactOptions.validateDocuments = cmdObj["validate"].trueValue();
 
+            if ( online ) {
+                compactOptions.online = true;
+                compactOptions.maxExtents = 4;
+                if ( cmdObj.hasElement("extentsPerBatch") ) {
+                    compactOptions.maxExtents = cmdObj["extentsPerBatch"].numberInt();
+                    if ( compactOptions.maxExtents < 1 ) {
+                        errmsg = "invalid extentsPerBatch";
+                        return false;
+                    }
+                }
+                return runOnline( txn, ns, compactOptions, errmsg, result );
+            }
+            else if ( cmdObj.hasElement("extentsPerBatch") ) {
+                errmsg = "extentsPerBatch is only for an online compact";
+                return false;
+            }
+
 
             Lock::DBLock lk(txn->lockState(), db, MODE_X);
             BackgroundOperation::assertNoBgOpInProgForNs(ns.ns());
@@ -210,7 +210,7 @@ namespace mongo {
                 if (!conn) {
                     return false;
                 }
-                cloner.setConnection(conn);
+                cloner.setConnection(conn, cs);
             }
 
             if (fromSelf) {
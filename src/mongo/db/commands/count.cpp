@@ -193,6 +193,14 @@ namespace mongo {
                 hintObj = BSON("$hint" << hint);
             }
 
+            bool approximate = false;
+            if (Bool == cmdObj["approx"].type()) {
+                approximate = cmdObj["approx"].boolean();
+            }
+            else if (cmdObj["approx"].ok()) {
+                return Status(ErrorCodes::BadValue, "approx value is not a boolean");
+            }
+
             std::string ns = parseNs(dbname, cmdObj);
 
             if (!nsIsFull(ns)) {
@@ -205,6 +213,7 @@ namespace mongo {
             request->hint = hintObj;
             request->limit = limit;
             request->skip = skip;
+            request->approximate = approximate;
 
             // By default, count requests are regular count not explain of count.
             request->explain = false;
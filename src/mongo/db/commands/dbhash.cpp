@@ -32,11 +32,19 @@
 
 #include "mongo/db/commands/dbhash.h"
 
+#include <cstring>
+
 #include "mongo/db/client.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/database_catalog_entry.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/operation_context_impl.h"
 #include "mongo/db/query/internal_plans.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/hex.h"
 #include "mongo/util/log.h"
 #include "mongo/util/md5.hpp"
 #include "mongo/util/timer.h"
@@ -45,6 +53,26 @@ namespace mongo {
 
     DBHashCmd dbhashCmd;
 
+    // The most collections hashed at once by a dbHash with unordered: true
+    MONGO_EXPORT_SERVER_PARAMETER(internalDbHashThreads, int, 4);
+
+    namespace {
+
+        void hashCollectionUnorderedTask( const std::string* fullCollectionName,
+                                          std::string* hash ) {
+            Client::initThreadIfNotAlready( "dbHash" );
+            try {
+                OperationContextImpl txn;
+                *hash = DBHashCmd::hashCollectionUnordered( &txn, *fullCollectionName );
+            }
+            catch ( const DBException& e ) {
+                warning() << "error while hashing ns=" << *fullCollectionName << ": " << e.what();
+                *hash = str::stream() << "error: " << e.toString();
+            }
+        }
+
+    } // namespace
+
 
     void logOpForDbHash(const char* ns) {
         dbhashCmd.wipeCacheForCollection( ns );
@@ -130,6 +158,62 @@ namespace mongo {
         return hash;
     }
 
+    string DBHashCmd::hashCollectionUnordered( OperationContext* opCtx,
+                                               const string& fullCollectionName ) {
+        // The collection lock stops writes to it while it is hashed, and only to it.
+        Lock::DBLock dbLock( opCtx->lockState(), nsToDatabaseSubstring( fullCollectionName ),
+                             MODE_IS );
+        Lock::CollectionLock collLock( opCtx->lockState(), fullCollectionName, MODE_S );
+
+        Database* db = dbHolder().get( opCtx, nsToDatabaseSubstring( fullCollectionName ) );
+        if ( !db )
+            return "";
+        Collection* collection = db->getCollection( opCtx, fullCollectionName );
+        if ( !collection )
+            return "";
+
+        // Sums of the two halves of the md5s, which are the same whatever order the documents
+        // are read in.
+        unsigned long long sums[2] = { 0, 0 };
+
+        std::vector<RecordIterator*> iterators = collection->getManyIterators( opCtx );
+        for ( size_t i = 0; i < iterators.size(); i++ ) {
+            boost::scoped_ptr<RecordIterator> it( iterators[i] );
+            iterators[i] = NULL;
+
+            while ( !it->isEOF() ) {
+                const DiskLoc loc = it->getNext();
+                const RecordData data = it->dataFor( loc );
+                const BSONObj obj( data.data() );
+
+                md5digest d;
+                md5( obj.objdata(), obj.objsize(), d );
+
+                unsigned long long halves[2];
+                memcpy( halves, d, sizeof(halves) );
+                sums[0] += halves[0];
+                sums[1] += halves[1];
+            }
+        }
+
+        return toHexLower( sums, sizeof(sums) );
+    }
+
+    void DBHashCmd::hashCollectionsUnordered( const vector<string>& fullCollectionNames,
+                                              vector<string>* hashes ) {
+        hashes->assign( fullCollectionNames.size(), string() );
+        if ( fullCollectionNames.empty() )
+            return;
+
+        const int numThreads = std::max( 1, std::min( static_cast<int>( internalDbHashThreads ),
+                                         static_cast<int>( fullCollectionNames.size() ) ) );
+        threadpool::ThreadPool pool( numThreads, "dbHash" );
+        for ( size_t i = 0; i < fullCollectionNames.size(); i++ ) {
+            pool.schedule( hashCollectionUnorderedTask, &fullCollectionNames[i], &(*hashes)[i] );
+        }
+        pool.join();
+    }
+
     bool DBHashCmd::run(OperationContext* txn, const string& dbname , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
         Timer timer;
 
@@ -146,13 +230,17 @@ namespace mongo {
             }
         }
 
+        // An unordered hash hashes each of the collections by itself, in parallel, so it does
+        // not hold any lock for them all.  Its hashes differ from those of the ordered hash.
+        const bool unordered = cmdObj["unordered"].trueValue();
+
         list<string> colls;
         const string ns = parseNs(dbname, cmdObj);
 
         // We lock the entire database in S-mode in order to ensure that the contents will not
         // change for the snapshot.
-        AutoGetDb autoDb(txn, ns, MODE_S);
-        Database* db = autoDb.getDb();
+        scoped_ptr<AutoGetDb> autoDb(new AutoGetDb(txn, ns, unordered ? MODE_IS : MODE_S));
+        Database* db = autoDb->getDb();
         if (db) {
             db->getDatabaseCatalogEntry()->getCollectionNamespaces(&colls);
             colls.sort();
@@ -166,7 +254,7 @@ namespace mongo {
 
         vector<string> cached;
 
-        BSONObjBuilder bb( result.subobjStart( "collections" ) );
+        vector<string> hashedCollections;
         for ( list<string>::iterator i=colls.begin(); i != colls.end(); i++ ) {
             string fullCollectionName = *i;
             if ( fullCollectionName.size() -1 <= dbname.size() ) {
@@ -182,14 +270,28 @@ namespace mongo {
                  desiredCollections.count( shortCollectionName ) == 0 )
                 continue;
 
-            bool fromCache = false;
-            string hash = hashCollection( txn, db, fullCollectionName, &fromCache );
+            hashedCollections.push_back( fullCollectionName );
+        }
 
-            bb.append( shortCollectionName, hash );
+        vector<string> hashes;
+        if ( unordered ) {
+            autoDb.reset();
+            hashCollectionsUnordered( hashedCollections, &hashes );
+        }
+        else {
+            for ( size_t i = 0; i < hashedCollections.size(); i++ ) {
+                bool fromCache = false;
+                hashes.push_back( hashCollection( txn, db, hashedCollections[i], &fromCache ) );
+                if ( fromCache )
+                    cached.push_back( hashedCollections[i] );
+            }
+        }
 
+        BSONObjBuilder bb( result.subobjStart( "collections" ) );
+        for ( size_t i = 0; i < hashedCollections.size(); i++ ) {
+            const string& hash = hashes[i];
+            bb.append( hashedCollections[i].substr( dbname.size() + 1 ), hash );
             md5_append( &globalState , (const md5_byte_t*)hash.c_str() , hash.size() );
-            if ( fromCache )
-                cached.push_back( fullCollectionName );
         }
         bb.done();
 
@@ -198,6 +300,8 @@ namespace mongo {
         string hash = digestToString( d );
 
         result.append( "md5" , hash );
+        if ( unordered )
+            result.append( "unordered", true );
         result.appendNumber( "timeMillis", timer.millis() );
 
         result.append( "fromCache", cached );
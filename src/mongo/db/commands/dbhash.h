@@ -50,12 +50,26 @@ namespace mongo {
 
         void wipeCacheForCollection( const StringData& ns );
 
+        /**
+         * Hashes the documents of a collection in storage order, under its own lock, into a
+         * hash which does not depend on their order: the sum of the md5 of each document.
+         */
+        static std::string hashCollectionUnordered( OperationContext* opCtx,
+                                                    const std::string& fullCollectionName );
+
     private:
 
         bool isCachable( const StringData& ns ) const;
 
         std::string hashCollection( OperationContext* opCtx, Database* db, const std::string& fullCollectionName, bool* fromCache );
 
+        /**
+         * Hashes the collections 'fullCollectionNames' with hashCollectionUnordered() on up to
+         * internalDbHashThreads threads, leaving the hashes in 'hashes' in the same order.
+         */
+        static void hashCollectionsUnordered( const std::vector<std::string>& fullCollectionNames,
+                                              std::vector<std::string>* hashes );
+
         std::map<std::string,std::string> _cachedHashed;
         mutex _cachedHashedMutex;
 
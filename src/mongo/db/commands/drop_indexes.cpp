@@ -40,6 +40,7 @@
 #include "mongo/db/commands.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/index_builder.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/collection_catalog_entry.h"
@@ -212,7 +213,10 @@ namespace mongo {
         virtual bool slaveOk() const { return true; }    // can reindex on a secondary
         virtual bool isWriteCommandForConfigServer() const { return true; }
         virtual void help( stringstream& help ) const {
-            help << "re-index a collection";
+            help << "re-index a collection\n"
+                    "{ reIndex : <collection>, [indexVersion : <v>] }\n"
+                    "indexVersion rebuilds the btree indexes in that format, 2 being the one with "
+                    "shared key prefixes";
         }
         virtual void addRequiredPrivileges(const std::string& dbname,
                                            const BSONObj& cmdObj,
@@ -250,6 +254,15 @@ namespace mongo {
                 return false;
             }
 
+            BSONElement versionElt = jsobj["indexVersion"];
+            if ( !versionElt.eoo() ) {
+                if ( !versionElt.isNumber() ||
+                     versionElt.numberInt() < 0 || versionElt.numberInt() > 2 ) {
+                    errmsg = str::stream() << "invalid indexVersion: " << versionElt;
+                    return false;
+                }
+            }
+
             BackgroundOperation::assertNoBgOpInProgForNs( toDeleteNs );
 
             std::vector<BSONObj> indexesInProg = stopIndexBuilds(txn, ctx.db(), jsobj);
@@ -261,7 +274,16 @@ namespace mongo {
                 for ( size_t i = 0; i < indexNames.size(); i++ ) {
                     const string& name = indexNames[i];
                     BSONObj spec = collection->getCatalogEntry()->getIndexSpec( txn, name );
-                    all.push_back(spec.removeField("v").getOwned());
+                    BSONObj rebuilt = spec.removeField("v");
+                    // only the plain btree indexes change format, the others get the default
+                    if ( !versionElt.eoo() &&
+                         IndexNames::findPluginName( spec.getObjectField("key") ).empty() ) {
+                        BSONObjBuilder b;
+                        b.append( "v", versionElt.numberInt() );
+                        b.appendElements( rebuilt );
+                        rebuilt = b.obj();
+                    }
+                    all.push_back(rebuilt.getOwned());
 
                     const BSONObj key = spec.getObjectField("key");
                     const Status keyStatus = validateKeyPattern(key);
@@ -111,10 +111,7 @@ namespace mongo {
                     break;
                 }
                 catch ( const WriteConflictException& ex ) {
-                    if ( attempt++ > 1 ) {
-                        log() << "got WriteConflictException on findAndModify for " << ns
-                              <<  " retrying attempt: " << attempt;
-                    }
+                    WriteConflictException::logAndBackoff( txn, ++attempt, "findAndModify", ns );
                 }
             }
 
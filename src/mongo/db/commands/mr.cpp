@@ -34,6 +34,8 @@
 
 #include "mongo/db/commands/mr.h"
 
+#include <pcrecpp.h>
+
 #include "mongo/client/connpool.h"
 #include "mongo/client/parallel.h"
 #include "mongo/db/auth/authorization_session.h"
@@ -52,6 +54,7 @@
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/range_preserver.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/storage_options.h"
@@ -66,6 +69,18 @@
 
 namespace mongo {
 
+    // Whether to run common map and reduce functions natively, see NativeMapper.
+    MONGO_EXPORT_SERVER_PARAMETER(internalMapReduceUseNativeFunctions, bool, true);
+
+    // Whether to spill tuples into a Sorter rather than a collection indexed on their key.
+    MONGO_EXPORT_SERVER_PARAMETER(internalMapReduceSpillToSorter, bool, true);
+
+    // Memory the spill Sorter may use before writing a sorted file to the _tmp directory.
+    MONGO_EXPORT_SERVER_PARAMETER(internalMapReduceSpillMaxMemoryMegabytes, int, 64);
+
+    // Number of scopes and threads running a js map function, see ParallelJSMapper.
+    MONGO_EXPORT_SERVER_PARAMETER(internalMapReduceMapThreads, int, 1);
+
     namespace mr {
 
         AtomicUInt32 Config::JOB_NUMBER;
@@ -247,6 +262,362 @@ namespace mongo {
             _reduce( x , key , endSizeEstimate );
         }
 
+        namespace {
+
+            const char* kIdentifier = "[A-Za-z_][A-Za-z0-9_]*";
+
+            bool isPlainCode( const BSONElement& code ) {
+                // CodeWScope could rebind the names the native implementations rely on
+                return code.type() == Code || code.type() == String;
+            }
+
+            /**
+             * Appends 'e' the way it would be after a round trip through javascript, if that is
+             * simple to do.
+             * @return false if it isn't
+             */
+            bool appendAsFromJS( BSONObjBuilder& b , const StringData& name , const BSONElement& e ) {
+                switch ( e.type() ) {
+                case NumberInt:
+                    b.append( name , static_cast<double>( e._numberInt() ) );
+                    return true;
+                case NumberDouble:
+                case String:
+                case jstOID:
+                case Bool:
+                case jstNULL:
+                    b.appendAs( e , name );
+                    return true;
+                case Date: {
+                    // the range of javascript dates
+                    const long long millis = e.date().asInt64();
+                    if ( millis > 8640000000000000LL || millis < -8640000000000000LL )
+                        return false;
+                    b.appendAs( e , name );
+                    return true;
+                }
+                default:
+                    return false;
+                }
+            }
+
+            /**
+             * @return the tuple for the (key, value) arguments of an emit() call
+             */
+            BSONObj emittedTuple( const BSONObj& args ) {
+                uassert( 10077 , "fast_emit takes 2 args" , args.nFields() == 2 );
+                uassert( 13069 , "an emit can't be more than half max bson size" ,
+                         args.objsize() < ( BSONObjMaxUserSize / 2 ) );
+
+                if ( args.firstElement().type() != Undefined )
+                    return args;
+
+                BSONObjBuilder b( args.objsize() );
+                b.appendNull( "" );
+                BSONObjIterator i( args );
+                i.next();
+                b.append( i.next() );
+                return b.obj();
+            }
+
+            // documents each worker of a ParallelJSMapper maps per round, at most
+            const size_t kMapDocumentsPerWorker = 256;
+            // bytes of documents queued for a round of a ParallelJSMapper, at most
+            const long long kMapBytesPerRound = 16 * 1024 * 1024;
+
+            // sorted files the spill Sorter keeps before merging them
+            const size_t kMaxSpillFiles = 64;
+
+        } // namespace
+
+        /**
+         * Orders spilled tuples by key, like the index on "0" of the incremental collection.
+         */
+        class SpilledTupleComparator {
+        public:
+            typedef std::pair<BSONObj, SpilledTupleValue> Data;
+            int operator()( const Data& l , const Data& r ) const {
+                return l.first.firstElement().woCompare( r.first.firstElement() , false );
+            }
+        };
+
+        NativeMapper* NativeMapper::create( const BSONElement& code ) {
+            if ( !isPlainCode( code ) )
+                return NULL;
+
+            const std::string field = str::stream() << "this\\.(" << kIdentifier << ")";
+            const pcrecpp::RE literalValue( str::stream()
+                << "\\s*function\\s*\\(\\s*\\)\\s*\\{\\s*emit\\s*\\(\\s*" << field
+                << "\\s*,\\s*(-?[0-9]+(?:\\.[0-9]+)?)\\s*\\)\\s*;?\\s*\\}\\s*" );
+            const pcrecpp::RE fieldValue( str::stream()
+                << "\\s*function\\s*\\(\\s*\\)\\s*\\{\\s*emit\\s*\\(\\s*" << field
+                << "\\s*,\\s*" << field << "\\s*\\)\\s*;?\\s*\\}\\s*" );
+
+            const std::string source = code._asCode();
+            std::string keyField;
+            std::string value;
+            if ( literalValue.FullMatch( source , &keyField , &value ) ) {
+                NativeMapper* mapper = new NativeMapper( code );
+                mapper->_keyField = keyField;
+                mapper->_valueNumber = strtod( value.c_str() , NULL );
+                return mapper;
+            }
+            if ( fieldValue.FullMatch( source , &keyField , &value ) ) {
+                NativeMapper* mapper = new NativeMapper( code );
+                mapper->_keyField = keyField;
+                mapper->_valueField = value;
+                mapper->_valueNumber = 0;
+                return mapper;
+            }
+            return NULL;
+        }
+
+        void NativeMapper::init( State * state ) {
+            _state = state;
+            _fallback.init( state );
+        }
+
+        void NativeMapper::map( const BSONObj& o ) {
+            BSONObjBuilder b( 64 );
+
+            const BSONElement key = o.getField( _keyField );
+            if ( key.eoo() || key.type() == Undefined ) {
+                // see fast_emit()
+                b.appendNull( "" );
+            }
+            else if ( !appendAsFromJS( b , "0" , key ) ) {
+                _fallback.map( o );
+                return;
+            }
+
+            if ( _valueField.empty() ) {
+                b.append( "1" , _valueNumber );
+            }
+            else {
+                const BSONElement value = o.getField( _valueField );
+                if ( value.type() != NumberDouble && value.type() != NumberInt ) {
+                    _fallback.map( o );
+                    return;
+                }
+                b.append( "1" , value.numberDouble() );
+            }
+
+            BSONObj emitted = b.obj();
+            uassert( 13069 , "an emit can't be more than half max bson size" ,
+                     emitted.objsize() < ( BSONObjMaxUserSize / 2 ) );
+            _state->emit( emitted );
+        }
+
+        NativeSumReducer* NativeSumReducer::create( const BSONElement& code ) {
+            if ( !isPlainCode( code ) )
+                return NULL;
+
+            const std::string id = str::stream() << "(" << kIdentifier << ")";
+            const std::string start = str::stream()
+                << "\\s*function\\s*\\(\\s*" << kIdentifier << "\\s*,\\s*" << id
+                << "\\s*\\)\\s*\\{\\s*";
+            const std::string end = "\\s*;?\\s*\\}\\s*";
+
+            // \\1 is the values, \\2 the sum, \\3 the index or value
+            const pcrecpp::RE arraySum( start + "return\\s+Array\\.sum\\s*\\(\\s*\\1\\s*\\)" + end );
+            const pcrecpp::RE forLoop( start
+                + "var\\s+" + id + "\\s*=\\s*0\\s*;\\s*"
+                + "for\\s*\\(\\s*var\\s+" + id + "\\s*=\\s*0\\s*;\\s*\\3\\s*<\\s*\\1\\.length\\s*;"
+                + "\\s*(?:\\3\\s*\\+\\+|\\+\\+\\s*\\3)\\s*\\)\\s*"
+                + "(?:\\{\\s*\\2\\s*\\+=\\s*\\1\\s*\\[\\s*\\3\\s*\\]\\s*;?\\s*\\}|\\2\\s*\\+=\\s*\\1\\s*\\[\\s*\\3\\s*\\]\\s*;)"
+                + "\\s*return\\s+\\2" + end );
+            const pcrecpp::RE forEach( start
+                + "var\\s+" + id + "\\s*=\\s*0\\s*;\\s*"
+                + "\\1\\.forEach\\s*\\(\\s*function\\s*\\(\\s*" + id + "\\s*\\)\\s*"
+                + "\\{\\s*\\2\\s*\\+=\\s*\\3\\s*;?\\s*\\}\\s*\\)\\s*;"
+                + "\\s*return\\s+\\2" + end );
+
+            const std::string source = code._asCode();
+            if ( arraySum.FullMatch( source ) )
+                return new NativeSumReducer( code , false );
+
+            // one name shadowing another changes what the loop does
+            std::string values, sum, item;
+            if ( forLoop.FullMatch( source , &values , &sum , &item ) ||
+                 forEach.FullMatch( source , &values , &sum , &item ) ) {
+                if ( values != sum && values != item && sum != item )
+                    return new NativeSumReducer( code , true );
+            }
+            return NULL;
+        }
+
+        bool NativeSumReducer::_sum( const BSONList& tuples , double* sum ) const {
+            double total = 0;
+            for ( size_t i = 0; i < tuples.size(); ++i ) {
+                BSONObjIterator it( tuples[i] );
+                it.next();
+                const BSONElement value = it.next();
+                if ( value.type() != NumberDouble && value.type() != NumberInt )
+                    return false;
+                total = ( i == 0 && !_startsFromZero ) ? value.numberDouble()
+                                                       : total + value.numberDouble();
+            }
+            *sum = total;
+            return true;
+        }
+
+        BSONObj NativeSumReducer::reduce( const BSONList& tuples ) {
+            if (tuples.size() <= 1)
+                return tuples[0];
+
+            double sum;
+            if ( !_sum( tuples , &sum ) ) {
+                const long long before = _fallback.numReduces;
+                BSONObj res = _fallback.reduce( tuples );
+                numReduces += _fallback.numReduces - before;
+                return res;
+            }
+            ++numReduces;
+
+            BSONObjBuilder b;
+            b.appendAs( tuples[0].firstElement() , "0" );
+            b.append( "1" , sum );
+            return b.obj();
+        }
+
+        BSONObj NativeSumReducer::finalReduce( const BSONList& tuples , Finalizer * finalizer ) {
+            double sum;
+            if ( tuples.size() == 1 || !_sum( tuples , &sum ) ) {
+                const long long before = _fallback.numReduces;
+                BSONObj res = _fallback.finalReduce( tuples , finalizer );
+                numReduces += _fallback.numReduces - before;
+                return res;
+            }
+            ++numReduces;
+
+            BSONObjBuilder b;
+            b.appendAs( tuples[0].firstElement() , "_id" );
+            b.append( "value" , sum );
+            BSONObj res = b.obj();
+
+            if ( finalizer ) {
+                res = finalizer->finalize( res );
+            }
+            return res;
+        }
+
+        ParallelJSMapper* ParallelJSMapper::create( OperationContext* txn ,
+                                                    State* state ,
+                                                    int numThreads ) {
+            if ( numThreads <= 1 || state->jsMode() )
+                return NULL;
+
+            // native mappers are cheaper than handing documents to other threads
+            const JSMapper* mapper = dynamic_cast<const JSMapper*>( state->config().mapper.get() );
+            if ( !mapper )
+                return NULL;
+
+            const Config& config = state->config();
+            auto_ptr<ParallelJSMapper> parallel( new ParallelJSMapper( state , numThreads ) );
+            parallel->_params = mapper->params();
+            for ( int i = 0; i < numThreads; i++ ) {
+                Worker* worker = new Worker();
+                parallel->_workers.push_back( worker );
+
+                // created on this thread, so that killOp interrupts the scopes of the operation
+                worker->scope.reset( globalScriptEngine->newScope() );
+                Scope* s = worker->scope.get();
+                s->setLocalDB( config.dbname );
+                s->loadStored( txn , true );
+                if ( ! config.scopeSetup.isEmpty() )
+                    s->init( &config.scopeSetup );
+                s->init( &mapper->func().wantedScope() );
+
+                worker->func = s->createFunction( mapper->func().code().c_str() );
+                uassert( 13598 , "couldn't compile code for: _map" , worker->func );
+                s->injectNative( "emit" , _emit , worker );
+            }
+            return parallel.release();
+        }
+
+        ParallelJSMapper::ParallelJSMapper( State* state , int numThreads )
+            : _state( state ),
+              _pool( numThreads , "mrMap" ),
+              _queueBytes( 0 ) {
+        }
+
+        ParallelJSMapper::~ParallelJSMapper() {
+            _pool.join();
+            for ( size_t i = 0; i < _workers.size(); i++ )
+                delete _workers[i];
+        }
+
+        void ParallelJSMapper::map( const BSONObj& o ) {
+            // the documents are mapped after the read lock of the caller has been yielded
+            _queue.push_back( o.getOwned() );
+            _queueBytes += o.objsize();
+            if ( _queue.size() >= kMapDocumentsPerWorker * _workers.size() ||
+                 _queueBytes >= kMapBytesPerRound ) {
+                flush();
+            }
+        }
+
+        void ParallelJSMapper::flush() {
+            if ( _queue.empty() )
+                return;
+
+            for ( size_t i = 0; i < _workers.size(); i++ ) {
+                _pool.schedule( &ParallelJSMapper::_mapSlice , this , i );
+            }
+            _pool.join();
+            _queue.clear();
+            _queueBytes = 0;
+
+            Status status = Status::OK();
+            for ( size_t i = 0; i < _workers.size(); i++ ) {
+                Worker* worker = _workers[i];
+                if ( status.isOK() && !worker->status.isOK() )
+                    status = worker->status;
+
+                if ( status.isOK() ) {
+                    for ( BSONList::const_iterator it = worker->emits.begin();
+                          it != worker->emits.end(); ++it ) {
+                        _state->emit( *it );
+                    }
+                }
+                worker->emits.clear();
+                worker->status = Status::OK();
+            }
+            uassertStatusOK( status );
+        }
+
+        /**
+         * Runs on the thread pool: maps the worker's slice of the queued documents.
+         */
+        void ParallelJSMapper::_mapSlice( size_t worker ) {
+            Worker* w = _workers[worker];
+            const size_t begin = _queue.size() * worker / _workers.size();
+            const size_t end = _queue.size() * ( worker + 1 ) / _workers.size();
+            try {
+                for ( size_t i = begin; i < end; i++ ) {
+                    if ( w->scope->invoke( w->func , &_params , &_queue[i] , 0 , true ) ) {
+                        uasserted( 9014 , str::stream() << "map invoke failed: "
+                                                        << w->scope->getError() );
+                    }
+                }
+            }
+            catch ( const DBException& e ) {
+                w->status = e.toStatus();
+            }
+            catch ( const std::exception& e ) {
+                w->status = Status( ErrorCodes::InternalError , e.what() );
+            }
+        }
+
+        /**
+         * emit() of the worker scopes, buffering the tuples until the round is over
+         */
+        BSONObj ParallelJSMapper::_emit( const BSONObj& args , void* data ) {
+            Worker* worker = static_cast<Worker*>( data );
+            worker->emits.push_back( emittedTuple( args ) );
+            return BSONObj();
+        }
+
         Config::Config( const string& _dbname , const BSONObj& cmdObj )
         {
             dbname = _dbname;
@@ -290,8 +661,17 @@ namespace mongo {
                 if ( cmdObj["scope"].type() == Object )
                     scopeSetup = cmdObj["scope"].embeddedObjectUserCheck();
 
-                mapper.reset( new JSMapper( cmdObj["map"] ) );
-                reducer.reset( new JSReducer( cmdObj["reduce"] ) );
+                // js mode runs the functions in the js scope, where native ones aren't
+                if ( internalMapReduceUseNativeFunctions && !jsMode ) {
+                    mapper.reset( NativeMapper::create( cmdObj["map"] ) );
+                    reducer.reset( NativeSumReducer::create( cmdObj["reduce"] ) );
+                }
+                nativeMapper = mapper.get() != NULL;
+                nativeReducer = reducer.get() != NULL;
+                if ( !mapper )
+                    mapper.reset( new JSMapper( cmdObj["map"] ) );
+                if ( !reducer )
+                    reducer.reset( new JSReducer( cmdObj["reduce"] ) );
                 if ( cmdObj["finalize"].type() && cmdObj["finalize"].trueValue() )
                     finalizer.reset( new JSFinalizer( cmdObj["finalize"] ) );
 
@@ -688,6 +1068,23 @@ namespace mongo {
         void State::_insertToInc( BSONObj& o ) {
             verify( _onDisk );
 
+            if ( _spillToSorter ) {
+                if ( !_spill ) {
+                    const size_t maxMemory =
+                        std::max( internalMapReduceSpillMaxMemoryMegabytes , 1 ) * size_t( 1024 * 1024 );
+                    _spill.reset( TupleSorter::make(
+                                    SortOptions().TempDir( storageGlobalParams.dbpath + "/_tmp" )
+                                                 .ExtSortAllowed()
+                                                 .MaxMemoryUsageBytes( maxMemory )
+                                                 .MaxSpillFiles( kMaxSpillFiles )
+                                                 .MemoryTracker( _txn->memoryTracker() ),
+                                    SpilledTupleComparator() ) );
+                }
+                _spill->add( o.getOwned() , SpilledTupleValue() );
+                _numSpilled++;
+                return;
+            }
+
             Client::WriteContext ctx(_txn,  _config.incLong );
             WriteUnitOfWork wuow(_txn);
             Collection* coll = getCollectionOrUassert(ctx.db(), _config.incLong);
@@ -698,10 +1095,12 @@ namespace mongo {
         State::State(OperationContext* txn, const Config& c) :
                 _config(c),
                 _db(txn),
-                _useIncremental(true),
+                _useIncremental(!internalMapReduceSpillToSorter),
+                _spillToSorter(internalMapReduceSpillToSorter),
                 _txn(txn),
                 _size(0),
                 _dupCount(0),
+                _numSpilled(0),
                 _numEmits(0) {
             _temp.reset( new InMemory() );
             _onDisk = _config.outputOptions.outType != Config::INMEMORY;
@@ -963,6 +1362,11 @@ namespace mongo {
                 return;
             }
 
+            if ( _spillToSorter ) {
+                _finalReduceSpilled( op , pm );
+                return;
+            }
+
             // use index on "0" to pull sorted data
             verify( _temp->size() == 0 );
             BSONObj sortKey = BSON( "0" << 1 );
@@ -1063,6 +1467,52 @@ namespace mongo {
             pm.finished();
         }
 
+        void State::_finalReduceSpilled( CurOp * op , ProgressMeterHolder& pm ) {
+            verify( _temp->size() == 0 );
+
+            verify(pm == op->setMessage("m/r: (3/3) final reduce to collection",
+                                        "M/R: (3/3) Final Reduce Progress",
+                                        _numSpilled));
+            if ( !_spill ) {
+                pm.finished();
+                return;
+            }
+
+            scoped_ptr<TupleSorter::Iterator> it( _spill->done() );
+
+            BSONObj prev;
+            BSONList all;
+            while ( it->more() ) {
+                // spilled tuples are only valid until the next one is read back
+                BSONObj o = it->next().first.getOwned();
+                pm.hit();
+
+                if ( !all.empty() &&
+                     o.firstElement().woCompare( prev.firstElement() , false ) == 0 ) {
+                    // same key as previous, add to array
+                    all.push_back( o );
+                    if ( pm->hits() % 100 == 0 ) {
+                        _txn->checkForInterrupt();
+                    }
+                    continue;
+                }
+
+                // reduce a finalize array
+                finalReduce( all );
+
+                all.clear();
+                prev = o;
+                all.push_back( o );
+
+                _txn->checkForInterrupt();
+            }
+
+            // reduce and finalize last array
+            finalReduce( all );
+
+            pm.finished();
+        }
+
         /**
          * Attempts to reduce objects in the memory map.
          * A new memory map will be created to hold the results.
@@ -1192,21 +1642,8 @@ namespace mongo {
          * emit that will be called by js function
          */
         BSONObj fast_emit( const BSONObj& args, void* data ) {
-            uassert( 10077 , "fast_emit takes 2 args" , args.nFields() == 2 );
-            uassert( 13069 , "an emit can't be more than half max bson size" , args.objsize() < ( BSONObjMaxUserSize / 2 ) );
-            
             State* state = (State*) data;
-            if ( args.firstElement().type() == Undefined ) {
-                BSONObjBuilder b( args.objsize() );
-                b.appendNull( "" );
-                BSONObjIterator i( args );
-                i.next();
-                b.append( i.next() );
-                state->emit( b.obj() );
-            }
-            else {
-                state->emit( args );
-            }
+            state->emit( emittedTuple( args ) );
             return BSONObj();
         }
 
@@ -1328,6 +1765,11 @@ namespace mongo {
                     long long mapTime = 0;
                     long long reduceTime = 0;
                     long long numInputs = 0;
+
+                    // created before taking the read lock, as the worker scopes load system.js
+                    const int mapThreads = internalMapReduceMapThreads;
+                    scoped_ptr<ParallelJSMapper> parallelMapper(
+                        ParallelJSMapper::create(txn, &state, mapThreads));
                     {
                         // We've got a cursor preventing migrations off, now re-establish our useful cursor
 
@@ -1384,7 +1826,10 @@ namespace mongo {
 
                             // do map
                             if ( config.verbose ) mt.reset();
-                            config.mapper->map( o );
+                            if ( parallelMapper )
+                                parallelMapper->map( o );
+                            else
+                                config.mapper->map( o );
                             if ( config.verbose ) mapTime += mt.micros();
 
                             // Check if the state accumulated so far needs to be written to a
@@ -1424,6 +1869,12 @@ namespace mongo {
                             if (config.limit && numInputs >= config.limit)
                                 break;
                         }
+
+                        if ( parallelMapper ) {
+                            if ( config.verbose ) mt.reset();
+                            parallelMapper->flush();
+                            if ( config.verbose ) mapTime += mt.micros();
+                        }
                     }
                     pm.finished();
 
@@ -1452,6 +1903,9 @@ namespace mongo {
                     countsBuilder.appendNumber( "reduce" , state.numReduces() );
                     timingBuilder.appendNumber("reduceTime", reduceTime / 1000);
                     timingBuilder.append( "mode" , state.jsMode() ? "js" : "mixed" );
+                    timingBuilder.appendBool( "nativeMap" , config.nativeMapper );
+                    timingBuilder.appendBool( "nativeReduce" , config.nativeReducer );
+                    timingBuilder.appendNumber( "mapThreads" , parallelMapper ? mapThreads : 1 );
 
                     long long finalCount = state.postProcessCollection(txn, op, pm);
                     state.appendResults( result );
@@ -1665,3 +2119,5 @@ namespace mongo {
 
 }
 
+#include "mongo/db/sorter/sorter.cpp"
+MONGO_CREATE_SORTER(mongo::BSONObj, mongo::mr::SpilledTupleValue, mongo::mr::SpilledTupleComparator);
@@ -38,8 +38,10 @@
 #include "mongo/db/curop.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/sorter/sorter.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/scripting/engine.h"
+#include "mongo/util/concurrency/thread_pool.h"
 
 namespace mongo {
 
@@ -106,6 +108,9 @@ namespace mongo {
             Scope * scope() const { return _scope; }
             ScriptingFunction func() const { return _func; }
 
+            const std::string& code() const { return _code; }
+            const BSONObj& wantedScope() const { return _wantedScope; }
+
         private:
             std::string _type;
             std::string _code; // actual javascript code
@@ -121,6 +126,9 @@ namespace mongo {
             virtual void map( const BSONObj& o );
             virtual void init( State * state );
 
+            const JSFunction& func() const { return _func; }
+            const BSONObj& params() const { return _params; }
+
         private:
             JSFunction _func;
             BSONObj _params;
@@ -156,6 +164,135 @@ namespace mongo {
 
         };
 
+        // ------------  native implementations of common js functions -----------
+
+        /**
+         * Runs map functions of the form
+         *
+         *     function() { emit(this.<field>, <number>); }
+         *     function() { emit(this.<field>, this.<field>); }
+         *
+         * without converting documents to javascript.  Emits what the js function would, so
+         * NumberInt keys and values become doubles and missing keys become null.  Documents with
+         * field types whose conversion isn't so simple are passed to the js function.
+         */
+        class NativeMapper : public Mapper {
+        public:
+            /**
+             * @return a NativeMapper if 'code' is of a form it runs, NULL otherwise
+             */
+            static NativeMapper* create( const BSONElement& code );
+
+            virtual void map( const BSONObj& o );
+            virtual void init( State * state );
+
+        private:
+            NativeMapper( const BSONElement& code ) : _fallback( code ) {}
+
+            JSMapper _fallback;
+            State* _state;
+
+            std::string _keyField;
+            // when empty, emit _valueNumber
+            std::string _valueField;
+            double _valueNumber;
+        };
+
+        /**
+         * Runs reduce functions which sum their values, of the forms
+         *
+         *     function(key, values) { return Array.sum(values); }
+         *     function(key, values) {
+         *         var sum = 0; for (var i = 0; i < values.length; i++) { sum += values[i]; }
+         *         return sum; }
+         *     function(key, values) {
+         *         var sum = 0; values.forEach(function(v) { sum += v; }); return sum; }
+         *
+         * adding doubles in the same order as the js function.  Lists with values other than
+         * numbers are passed to the js function.
+         */
+        class NativeSumReducer : public Reducer {
+        public:
+            /**
+             * @return a NativeSumReducer if 'code' is of a form it runs, NULL otherwise
+             */
+            static NativeSumReducer* create( const BSONElement& code );
+
+            virtual void init( State * state ) { _fallback.init( state ); }
+
+            virtual BSONObj reduce( const BSONList& tuples );
+            virtual BSONObj finalReduce( const BSONList& tuples , Finalizer * finalizer );
+
+        private:
+            NativeSumReducer( const BSONElement& code , bool startsFromZero )
+                : _fallback( code ), _startsFromZero( startsFromZero ) {}
+
+            /**
+             * @return false if the values can't be summed natively
+             */
+            bool _sum( const BSONList& tuples , double* sum ) const;
+
+            JSReducer _fallback;
+            // Array.sum() starts from the first value, the loops from 0, which differ for -0
+            const bool _startsFromZero;
+        };
+
+        // -----------------
+
+        /**
+         * Runs a js map function in several scopes at once, one per thread of a pool.  Documents
+         * are queued and mapped in rounds, each worker taking a contiguous slice of the round.
+         * A worker's emits are buffered and handed to the State in worker order once the
+         * round is over, so the State sees them in the same order as a single scope would.
+         *
+         * The worker scopes aren't connected to the database, so the map function can only use
+         * its document, the scope and params of the job and system.js functions.
+         */
+        class ParallelJSMapper : boost::noncopyable {
+        public:
+            /**
+             * @return a ParallelJSMapper running the map function of 'state' in 'numThreads'
+             * scopes, or NULL if it has to run in the state's own scope
+             */
+            static ParallelJSMapper* create( OperationContext* txn, State* state, int numThreads );
+
+            ~ParallelJSMapper();
+
+            /**
+             * Queues a document, which is mapped once the round it's in is full.
+             */
+            void map( const BSONObj& o );
+
+            /**
+             * Maps the queued documents and emits their results into the State.  Throws the
+             * first error of the round's workers, if any.
+             */
+            void flush();
+
+        private:
+            struct Worker {
+                Worker() : status( Status::OK() ) {}
+                scoped_ptr<Scope> scope;
+                ScriptingFunction func;
+                BSONList emits;
+                Status status;
+            };
+
+            ParallelJSMapper( State* state, int numThreads );
+
+            void _mapSlice( size_t worker );
+
+            static BSONObj _emit( const BSONObj& args, void* data );
+
+            State* _state;
+            BSONObj _params;
+            std::vector<Worker*> _workers; // owned
+            ThreadPool _pool;
+
+            BSONList _queue;
+            long long _queueBytes;
+        };
+
         // -----------------
 
 
@@ -169,6 +306,22 @@ namespace mongo {
 
         typedef std::map< BSONObj,BSONList,TupleKeyCmp > InMemory; // from key to list of tuples
 
+        /**
+         * Tuples spilled to a Sorter are its keys, so this is the empty value they're paired with.
+         */
+        struct SpilledTupleValue {
+            struct SorterDeserializeSettings {};
+            void serializeForSorter( BufBuilder& buf ) const {}
+            static SpilledTupleValue deserializeForSorter( BufReader& buf,
+                                                           const SorterDeserializeSettings& ) {
+                return SpilledTupleValue();
+            }
+            int memUsageForSorter() const { return 0; }
+            SpilledTupleValue getOwned() const { return *this; }
+        };
+
+        typedef Sorter<BSONObj, SpilledTupleValue> TupleSorter;
+
         /**
          * holds map/reduce config information
          */
@@ -199,6 +352,10 @@ namespace mongo {
             BSONObj mapParams;
             BSONObj scopeSetup;
 
+            // true when the function is run natively, see NativeMapper and NativeSumReducer
+            bool nativeMapper;
+            bool nativeReducer;
+
             // output tables
             std::string incLong;
             std::string tempNamespace;
@@ -275,7 +432,7 @@ namespace mongo {
             void reduceInMemory();
 
             /**
-             * transfers in memory storage to temp collection
+             * transfers in memory storage to temp collection, or to the spill sorter
              */
             void dumpToInc();
             void insertToInc( BSONObj& o );
@@ -339,6 +496,7 @@ namespace mongo {
             const Config& _config;
             DBDirectClient _db;
             bool _useIncremental;   // use an incremental collection
+            bool _spillToSorter;    // spill into _spill rather than an incremental collection
 
         protected:
 
@@ -350,6 +508,11 @@ namespace mongo {
              */
             int _add(InMemory* im , const BSONObj& a);
 
+            /**
+             * Reduces and finalizes the tuples spilled to _spill, which come out sorted by key.
+             */
+            void _finalReduceSpilled( CurOp * op , ProgressMeterHolder& pm );
+
             OperationContext* _txn;
             scoped_ptr<Scope> _scope;
             bool _onDisk; // if the end result of this map reduce is disk or not
@@ -358,6 +521,9 @@ namespace mongo {
             long _size; // bytes in _temp
             long _dupCount; // number of duplicate key entries
 
+            scoped_ptr<TupleSorter> _spill; // created on the first spill
+            long long _numSpilled;
+
             long long _numEmits;
 
             bool _jsMode;
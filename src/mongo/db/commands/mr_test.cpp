@@ -158,4 +158,65 @@ namespace {
                                       "mydb2", "", "", false, mr::Config::INMEMORY);
     }
 
+    /**
+     * Returns a mapReduce command with map and reduce code, other options from 'options'.
+     */
+    BSONObj _makeMapReduce(const std::string& map, const std::string& reduce,
+                           const std::string& options = "{}") {
+        BSONObjBuilder b;
+        b.append("mapreduce", "mycoll");
+        b.appendCode("map", map);
+        b.appendCode("reduce", reduce);
+        b.append("out", BSON("inline" << 1));
+        b.appendElements(fromjson(options));
+        return b.obj();
+    }
+
+    bool _isNativeMapper(const std::string& map) {
+        return mr::Config("mydb", _makeMapReduce(map, "function(k, v) {}")).nativeMapper;
+    }
+
+    bool _isNativeReducer(const std::string& reduce) {
+        return mr::Config("mydb", _makeMapReduce("function() {}", reduce)).nativeReducer;
+    }
+
+    TEST(ConfigTest, NativeMapper) {
+        ASSERT_TRUE(_isNativeMapper("function() { emit(this.k, 1); }"));
+        ASSERT_TRUE(_isNativeMapper("function(){emit(this.k,-2.5)}"));
+        ASSERT_TRUE(_isNativeMapper("function() {\n    emit(this.k, this.v);\n}"));
+
+        ASSERT_FALSE(_isNativeMapper("function() { emit(this.k, 1); emit(this.j, 1); }"));
+        ASSERT_FALSE(_isNativeMapper("function() { emit(this.a.b, 1); }"));
+        ASSERT_FALSE(_isNativeMapper("function() { emit(this.k, 1 + 1); }"));
+        ASSERT_FALSE(_isNativeMapper("function() { emit(this.k, 1); } // comment"));
+    }
+
+    TEST(ConfigTest, NativeSumReducer) {
+        ASSERT_TRUE(_isNativeReducer("function(key, values) { return Array.sum(values); }"));
+        ASSERT_TRUE(_isNativeReducer(
+            "function(key, values) { var total = 0; "
+            "for (var i = 0; i < values.length; i++) { total += values[i]; } return total; }"));
+        ASSERT_TRUE(_isNativeReducer(
+            "function(k, v) { var s = 0; for (var j = 0; j < v.length; ++j) s += v[j]; "
+            "return s; }"));
+        ASSERT_TRUE(_isNativeReducer(
+            "function(key, values) { var sum = 0; "
+            "values.forEach(function(v) { sum += v; }); return sum; }"));
+
+        ASSERT_FALSE(_isNativeReducer("function(key, values) { return Array.sum(other); }"));
+        ASSERT_FALSE(_isNativeReducer("function(key, values) { return Array.avg(values); }"));
+        // The forEach callback's argument shadows the sum
+        ASSERT_FALSE(_isNativeReducer(
+            "function(key, values) { var v = 0; "
+            "values.forEach(function(v) { v += v; }); return v; }"));
+    }
+
+    TEST(ConfigTest, NoNativeFunctionsInJSMode) {
+        mr::Config config("mydb", _makeMapReduce("function() { emit(this.k, 1); }",
+                                                 "function(k, v) { return Array.sum(v); }",
+                                                 "{jsMode: true}"));
+        ASSERT_FALSE(config.nativeMapper);
+        ASSERT_FALSE(config.nativeReducer);
+    }
+
 }  // namespace
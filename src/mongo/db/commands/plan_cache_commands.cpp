@@ -391,8 +391,11 @@ namespace mongo {
 
         BSONArrayBuilder plansBuilder(bob->subarrayStart("plans"));
         size_t numPlans = entry->plannerData.size();
-        invariant(numPlans == entry->decision->stats.size());
-        invariant(numPlans == entry->decision->scores.size());
+        // Entries restored from persisted plan cache data (see PlanCache::restore) carry no
+        // ranking decision.
+        const bool restored = entry->decision->stats.empty();
+        invariant(restored || numPlans == entry->decision->stats.size());
+        invariant(restored || numPlans == entry->decision->scores.size());
         for (size_t i = 0; i < numPlans; ++i) {
             BSONObjBuilder planBob(plansBuilder.subobjStart());
 
@@ -408,13 +411,18 @@ namespace mongo {
             // reason is comprised of score and initial stats provided by
             // multi plan runner.
             BSONObjBuilder reasonBob(planBob.subobjStart("reason"));
-            reasonBob.append("score", entry->decision->scores[i]);
-            BSONObjBuilder statsBob(reasonBob.subobjStart("stats"));
-            PlanStageStats* stats = entry->decision->stats.vector()[i];
-            if (stats) {
-                Explain::statsToBSON(*stats, &statsBob);
+            if (restored) {
+                reasonBob.append("restored", true);
+            }
+            else {
+                reasonBob.append("score", entry->decision->scores[i]);
+                BSONObjBuilder statsBob(reasonBob.subobjStart("stats"));
+                PlanStageStats* stats = entry->decision->stats.vector()[i];
+                if (stats) {
+                    Explain::statsToBSON(*stats, &statsBob);
+                }
+                statsBob.doneFast();
             }
-            statsBob.doneFast();
             reasonBob.doneFast();
 
             // BSON object for 'feedback' field is created from query executions
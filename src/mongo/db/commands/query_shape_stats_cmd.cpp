@@ -0,0 +1,111 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/query/query_shape_stats.h"
+
+namespace mongo {
+
+    /**
+     * Lists the execution statistics of a collection's queries by shape, most total execution
+     * time first.
+     *
+     * { queryShapeStats: <collection>, [clear: <bool>] }
+     */
+    class QueryShapeStatsCmd : public Command {
+    public:
+        QueryShapeStatsCmd() : Command("queryShapeStats") { }
+
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+
+        virtual bool slaveOk() const { return true; }
+
+        virtual void help(stringstream& help) const {
+            help << "list the execution statistics of a collection's queries by shape\n"
+                "{ queryShapeStats : <collection_name>, [clear : true] }\n"
+                " most total execution time first; clear starts over after listing them";
+        }
+
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::planCacheRead);
+            if (cmdObj["clear"].trueValue()) {
+                actions.addAction(ActionType::planCacheWrite);
+            }
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual bool run(OperationContext* txn,
+                         const string& dbname,
+                         BSONObj& cmdObj,
+                         int,
+                         string& errmsg,
+                         BSONObjBuilder& result,
+                         bool fromRepl) {
+            const NamespaceString nss(parseNs(dbname, cmdObj));
+            if (!nss.isValid()) {
+                errmsg = "bad namespace name";
+                return false;
+            }
+
+            AutoGetCollectionForRead ctx(txn, nss);
+            Collection* collection = ctx.getCollection();
+
+            // A collection without queries yet, maybe not even created on this shard
+            std::vector<QueryShapeStatsEntry> entries;
+            if (collection) {
+                QueryShapeStats* stats = collection->infoCache()->getQueryShapeStats();
+                stats->getAll(&entries);
+                if (cmdObj["clear"].trueValue()) {
+                    stats->clear();
+                }
+            }
+
+            BSONArrayBuilder shapesBob(result.subarrayStart("shapes"));
+            for (size_t i = 0; i < entries.size(); ++i) {
+                shapesBob.append(entries[i].toBSON());
+            }
+            shapesBob.doneFast();
+            return true;
+        }
+
+    } queryShapeStatsCmd;
+
+}  // namespace mongo
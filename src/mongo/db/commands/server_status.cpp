@@ -46,6 +46,8 @@
 #include "mongo/platform/process_id.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/listen.h"
+#include "mongo/util/net/message_buffer_pool.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
@@ -256,6 +258,12 @@ namespace mongo {
             BSONObj generateSection(const BSONElement& configElement) const {
                 BSONObjBuilder b;
                 networkCounter.append( b );
+                BSONObjBuilder pool( b.subobjStart( "receiveBufferPool" ) );
+                MessageBufferPool::appendStats( pool );
+                pool.done();
+                BSONObjBuilder compression( b.subobjStart( "compression" ) );
+                appendMessageCompressionStats( compression );
+                compression.done();
                 return b.obj();
             }
                 
@@ -35,6 +35,7 @@
 #include "mongo/db/commands.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/catalog/background_validate.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/util/log.h"
 
@@ -49,7 +50,8 @@ namespace mongo {
         }
 
         virtual void help(stringstream& h) const { h << "Validate contents of a namespace by scanning its data structures for correctness.  Slow.\n"
-                                                        "Add full:true option to do a more thorough check"; }
+                                                        "Add full:true option to do a more thorough check.\n"
+                                                        "Add background:true to check the indexes against the documents without blocking writes for long"; }
 
         virtual bool isWriteCommandForConfigServer() const { return false; }
         virtual void addRequiredPrivileges(const std::string& dbname,
@@ -59,7 +61,7 @@ namespace mongo {
             actions.addAction(ActionType::validate);
             out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
         }
-        //{ validate: "collectionnamewithoutthedbpart" [, scandata: <bool>] [, full: <bool> } */
+        //{ validate: "collectionnamewithoutthedbpart" [, scandata: <bool>] [, full: <bool>] [, background: <bool>] } */
 
         bool run(OperationContext* txn, const string& dbname , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
             string ns = dbname + "." + cmdObj.firstElement().valuestrsafe();
@@ -67,16 +69,40 @@ namespace mongo {
             NamespaceString ns_string(ns);
             const bool full = cmdObj["full"].trueValue();
             const bool scanData = full || cmdObj["scandata"].trueValue();
+            const bool background = cmdObj["background"].trueValue();
 
             if ( !ns_string.isNormal() && full ) {
                 errmsg = "Can only run full validate on a regular collection";
                 return false;
             }
 
+            if ( background && full ) {
+                errmsg = "Can not run a full validate in the background";
+                return false;
+            }
+
             if (!serverGlobalParams.quiet) {
                 LOG(0) << "CMD: validate " << ns << endl;
             }
 
+            if ( background ) {
+                result.append( "ns", ns );
+
+                ValidateResults results;
+                Status status = validateCollectionInBackground( txn, ns_string, &results, &result );
+                if ( !status.isOK() )
+                    return appendCommandStatus( result, status );
+
+                result.appendBool("valid", results.valid);
+                result.append("errors", results.errors);
+
+                if ( !results.valid ) {
+                    result.append("advice", "ns corrupt. See http://dochub.mongodb.org/core/data-recovery");
+                }
+
+                return true;
+            }
+
             AutoGetCollectionForRead ctx(txn, ns_string.ns());
 
             Collection* collection = ctx.getCollection();
@@ -56,8 +56,10 @@
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/op_sampler.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/s/collection_metadata.h"
+#include "mongo/s/d_auto_split.h"
 #include "mongo/s/d_state.h"
 #include "mongo/s/shard_key_pattern.h"
 #include "mongo/s/write_ops/batched_upsert_detail.h"
@@ -94,6 +96,9 @@ namespace mongo {
     // TODO: Determine queueing behavior we want here
     MONGO_EXPORT_SERVER_PARAMETER( queueForMigrationCommit, bool, true );
 
+    // How many documents of an insert batch to write in one unit of work, 1 inserts one by one
+    MONGO_EXPORT_SERVER_PARAMETER( insertGroupSize, int, 64 );
+
     using mongoutils::str::stream;
 
     WriteBatchExecutor::WriteBatchExecutor( OperationContext* txn,
@@ -639,6 +644,8 @@ namespace mongo {
         if ( currentOp->shouldDBProfile( executionTime ) ) {
             profile( txn, *txn->getClient(), currentOp->getOp(), *currentOp );
         }
+
+        sampleOp( txn, *txn->getClient(), *currentOp );
     }
 
     // END HELPERS
@@ -840,11 +847,20 @@ namespace mongo {
         // particularly on operation interruption.  These kinds of errors necessarily prevent
         // further insertOne calls, and stop the batch.  As a result, the only expected source of
         // such exceptions are interruptions.
+        //
+        // Documents are first tried in groups of insertGroupSize, each in one unit of work, which
+        // saves a commit per document. A group stops short of the first document which failed
+        // normalization. If any insert of a group fails, the whole group is rolled back and its
+        // documents are inserted one at a time, so errors are reported exactly as without
+        // grouping.
         ExecInsertsState state(_txn, &request);
         normalizeInserts(request, &state.normalizedInserts);
 
         ElapsedTracker elapsedTracker(128, 10); // 128 hits or 10 ms, matching RunnerYieldPolicy's
 
+        // Inserts before this index are done one by one, after their group failed
+        size_t singleInsertsUntil = 0;
+
         for (state.currIndex = 0;
              state.currIndex < state.request->sizeWriteOps();
              ++state.currIndex) {
@@ -856,6 +872,16 @@ namespace mongo {
                 elapsedTracker.resetLastTime();
             }
 
+            if (state.currIndex >= singleInsertsUntil) {
+                const size_t numInserted = execInsertGroup(&state);
+                if (numInserted > 0) {
+                    state.currIndex += numInserted - 1;
+                    continue;
+                }
+
+                singleInsertsUntil = state.currIndex + std::max(insertGroupSize, 1);
+            }
+
             WriteErrorDetail* error = NULL;
             execOneInsert(&state, &error);
             if (error) {
@@ -1077,6 +1103,78 @@ namespace mongo {
         }
     }
 
+    size_t WriteBatchExecutor::execInsertGroup(ExecInsertsState* state) {
+        if (insertGroupSize <= 1 || state->request->isInsertIndexRequest())
+            return 0;
+
+        const size_t begin = state->currIndex;
+        size_t end = std::min(begin + insertGroupSize, state->normalizedInserts.size());
+        for (size_t i = begin; i < end; ++i) {
+            if (!state->normalizedInserts[i].isOK()) {
+                end = i;
+                break;
+            }
+        }
+
+        if (end - begin < 2)
+            return 0;
+
+        // The group is reported as the child operation of its first insert
+        BatchItemRef firstInsertItem(state->request, begin);
+        scoped_ptr<CurOp> currentOp(beginCurrentOp(_txn->getClient(), firstInsertItem));
+
+        WriteOpResult lockResult;
+        if (!state->lockAndCheck(&lockResult))
+            return 0;
+
+        Collection* collection = state->getCollection();
+        const string& insertNS = collection->ns().ns();
+
+        try {
+            WriteUnitOfWork wunit(_txn);
+            std::vector<BSONObj> insertedDocs;
+            insertedDocs.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) {
+                const BSONObj& insertDoc = state->normalizedInserts[i].getValue().isEmpty() ?
+                    state->request->getInsertRequest()->getDocumentsAt(i) :
+                    state->normalizedInserts[i].getValue();
+
+                StatusWith<DiskLoc> status = collection->insertDocument(_txn, insertDoc, true);
+                if (!status.isOK())
+                    return 0;
+
+                insertedDocs.push_back(insertDoc);
+            }
+
+            // The oplog entries of the group are written together
+            repl::logOps(_txn, "i", insertNS.c_str(), insertedDocs);
+            wunit.commit();
+
+            shardAutoSplitter.noteInserts(_txn, collection, insertedDocs);
+        }
+        catch (const DBException& ex) {
+            if (ErrorCodes::isInterruption(ex.toStatus().code()))
+                throw;
+            return 0;
+        }
+
+        WriteOpStats stats;
+        stats.n = 1;
+
+        for (size_t i = begin; i < end; ++i) {
+            BatchItemRef insertItem(state->request, i);
+            if (i != begin)
+                currentOp.reset(beginCurrentOp(_txn->getClient(), insertItem));
+
+            incOpStats(insertItem);
+            incWriteStats(insertItem, stats, NULL, currentOp.get());
+            finishCurrentOp(_txn, currentOp.get(), NULL);
+            currentOp.reset();
+        }
+
+        return end - begin;
+    }
+
     /**
      * Perform a single insert into a collection.  Requires the insert be preprocessed and the
      * collection already has been created.
@@ -1102,6 +1200,8 @@ namespace mongo {
             repl::logOp( txn, "i", insertNS.c_str(), docToInsert );
             result->getStats().n = 1;
             wunit.commit();
+
+            shardAutoSplitter.noteInserts(txn, collection, std::vector<BSONObj>(1, docToInsert));
         }
     }
 
@@ -1208,7 +1308,8 @@ namespace mongo {
             Lock::DBLock dbLock(txn->lockState(), nsString.db(), MODE_IX);
             Lock::CollectionLock colLock(txn->lockState(),
                                          nsString.ns(),
-                                         MODE_IX);
+                                         WriteConflictException::shouldEscalate(attempt - 1) ?
+                                             MODE_X : MODE_IX);
             ///////////////////////////////////////////
 
             if (!checkShardVersion(txn, &shardingState, *updateItem.getRequest(), result))
@@ -1274,18 +1375,23 @@ namespace mongo {
                 result->getStats().nModified = didInsert ? 0 : numDocsModified;
                 result->getStats().n = didInsert ? 1 : numMatched;
                 result->getStats().upsertedID = resUpsertedID;
+
+                if (!isMulti && (didInsert || numDocsModified > 0)) {
+                    // The size of the update stands for the bytes it wrote
+                    shardAutoSplitter.noteUpdate(txn,
+                                                 db->getCollection(txn, nsString.ns()),
+                                                 request.getQuery(),
+                                                 request.getUpdates().objsize());
+                }
             }
             catch ( const WriteConflictException& dle ) {
                 if ( isMulti ) {
                     log() << "Had WriteConflict during multi update, aborting";
                     throw;
                 }
-                else if ( attempt++ > 1 ) {
-                    log() << "Had WriteConflict doing update on " << nsString
-                          << ", attempt: " << attempt << " retrying";
-                    createCollection = false;
-                    fakeLoop = -1;
-                }
+                WriteConflictException::logAndBackoff(txn, attempt++, "update", nsString.ns());
+                createCollection = false;
+                fakeLoop = -1;
             }
             catch (const DBException& ex) {
                 Status status = ex.toStatus();
@@ -1331,7 +1437,10 @@ namespace mongo {
                 AutoGetDb autoDb(txn, nss.db(), MODE_IX);
                 if (!autoDb.getDb()) break;
 
-                Lock::CollectionLock collLock(txn->lockState(), nss.ns(), MODE_IX);
+                Lock::CollectionLock collLock(txn->lockState(),
+                                              nss.ns(),
+                                              WriteConflictException::shouldEscalate(attempt - 1) ?
+                                                  MODE_X : MODE_IX);
 
                 // Check version once we're locked
 
@@ -1349,10 +1458,7 @@ namespace mongo {
                 break;
             }
             catch ( const WriteConflictException& dle ) {
-                if ( attempt++ > 1 ) {
-                    log() << "Had WriteConflict doing delete on " << nss
-                          << ", attempt: " << attempt << " retrying";
-                }
+                WriteConflictException::logAndBackoff(txn, attempt++, "delete", nss.ns());
             }
             catch ( const DBException& ex ) {
                 Status status = ex.toStatus();
@@ -102,6 +102,14 @@ namespace mongo {
          */
         void execOneInsert( ExecInsertsState* state, WriteErrorDetail** error );
 
+        /**
+         * Tries to insert a group of documents from a batch, starting at the current one of the
+         * "state", in a single unit of work. Returns how many were inserted, which is either all
+         * of the group or zero, in which case nothing was written and the caller must insert the
+         * documents one by one in order to report their errors.
+         */
+        size_t execInsertGroup( ExecInsertsState* state );
+
         /**
          * Executes an update item (which may update many documents or upsert), and returns the
          * upserted _id on upsert or error on failure.
@@ -30,6 +30,7 @@
 
 #include "mongo/db/concurrency/d_concurrency.h"
 
+#include "mongo/db/concurrency/lock_stats.h"
 #include "mongo/db/concurrency/locker.h"
 #include "mongo/db/global_environment_experiment.h"
 #include "mongo/db/namespace_string.h"
@@ -37,6 +38,7 @@
 #include "mongo/util/assert_util.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/stacktrace.h"
+#include "mongo/util/time_support.h"
 
 // oplog locking
 // no top level read locks
@@ -52,6 +54,36 @@ namespace mongo {
     DBTryLockTimeoutException::DBTryLockTimeoutException() {}
     DBTryLockTimeoutException::~DBTryLockTimeoutException() throw() { }
 
+namespace {
+    /**
+     * How long an acquisition may wait, given the deadline of the locker (see
+     * Locker::setWaitDeadline) and the timeout asked for by the caller. Sets *deadlineBound if
+     * the deadline is the tighter of the two.
+     */
+    unsigned waitTimeoutMs(const Locker* locker, unsigned timeoutMs, bool* deadlineBound) {
+        *deadlineBound = false;
+
+        const uint64_t deadline = locker->getWaitDeadline();
+        if (deadline == 0) {
+            return timeoutMs;
+        }
+
+        const uint64_t now = curTimeMicros64();
+        const uint64_t remainingMs = (now < deadline) ? (deadline - now + 999) / 1000 : 0;
+        if (remainingMs >= timeoutMs) {
+            return timeoutMs;
+        }
+
+        *deadlineBound = true;
+        return static_cast<unsigned>(remainingMs);
+    }
+
+    MONGO_COMPILER_NORETURN void failLockWaitDeadline(const std::string& lockName) {
+        uasserted(ErrorCodes::ExceededTimeLimit,
+                  str::stream() << "operation exceeded time limit waiting for " << lockName);
+    }
+} // namespace
+
     class AcquiringParallelWriter {
     public:
 
@@ -70,30 +102,38 @@ namespace mongo {
     };
 
 
-    RWLockRecursive &Lock::ParallelBatchWriterMode::_batchLock = *(new RWLockRecursive("special"));
+    FairRWLock &Lock::ParallelBatchWriterMode::_batchLock = getParallelBatchWriterLock();
     void Lock::ParallelBatchWriterMode::iAmABatchParticipant(Locker* lockState) {
         lockState->setIsBatchWriter(true);
     }
 
-    Lock::ScopedLock::ParallelBatchWriterSupport::ParallelBatchWriterSupport(Locker* lockState)
-        : _lockState(lockState) {
+    Lock::ScopedLock::ParallelBatchWriterSupport::ParallelBatchWriterSupport(Locker* lockState,
+                                                                             bool snapshotRead)
+        : _lockState(lockState),
+          _snapshotRead(snapshotRead) {
         relock();
     }
 
     void Lock::ScopedLock::ParallelBatchWriterSupport::tempRelease() {
         _lk.reset( 0 );
+        _snapshotReadLk.reset( 0 );
     }
 
     void Lock::ScopedLock::ParallelBatchWriterSupport::relock() {
         if (!_lockState->isBatchWriter()) {
             AcquiringParallelWriter a(_lockState);
-            _lk.reset( new RWLockRecursive::Shared(ParallelBatchWriterMode::_batchLock) );
+            if (_snapshotRead) {
+                _snapshotReadLk.reset( new ParallelBatchSnapshotReadLock() );
+            }
+            else {
+                _lk.reset( new FairRWLock::Shared(ParallelBatchWriterMode::_batchLock) );
+            }
         }
     }
 
 
-    Lock::ScopedLock::ScopedLock(Locker* lockState, char type)
-        : _lockState(lockState), _pbws_lk(lockState), _type(type) {
+    Lock::ScopedLock::ScopedLock(Locker* lockState, char type, bool snapshotRead)
+        : _lockState(lockState), _pbws_lk(lockState, snapshotRead), _type(type) {
 
         _lockState->enterScopedLock(this);
     }
@@ -176,8 +216,13 @@ namespace mongo {
     Lock::GlobalWrite::GlobalWrite(Locker* lockState, unsigned timeoutms)
         : ScopedLock(lockState, 'W') {
 
-        LockResult result = _lockState->lockGlobal(MODE_X, timeoutms);
+        bool deadlineBound;
+        LockResult result =
+            _lockState->lockGlobal(MODE_X, waitTimeoutMs(_lockState, timeoutms, &deadlineBound));
         if (result == LOCK_TIMEOUT) {
+            if (deadlineBound) {
+                failLockWaitDeadline("the global lock");
+            }
             throw DBTryLockTimeoutException();
         }
 
@@ -195,8 +240,13 @@ namespace mongo {
     Lock::GlobalRead::GlobalRead(Locker* lockState, unsigned timeoutms)
         : ScopedLock(lockState, 'R') {
 
-        LockResult result = _lockState->lockGlobal(MODE_S, timeoutms);
+        bool deadlineBound;
+        LockResult result =
+            _lockState->lockGlobal(MODE_S, waitTimeoutMs(_lockState, timeoutms, &deadlineBound));
         if (result == LOCK_TIMEOUT) {
+            if (deadlineBound) {
+                failLockWaitDeadline("the global lock");
+            }
             throw DBTryLockTimeoutException();
         }
 
@@ -209,11 +259,16 @@ namespace mongo {
     }
 
     Lock::DBLock::DBLock(Locker* lockState, const StringData& db, const LockMode mode)
-        : ScopedLock(lockState, mode == MODE_S || mode == MODE_IS ? 'r' : 'w'),
+        : ScopedLock(lockState,
+                     mode == MODE_S || mode == MODE_IS ? 'r' : 'w',
+                     (mode == MODE_S || mode == MODE_IS) && readsFromSnapshots()),
           _id(RESOURCE_DATABASE, db),
           _mode(mode) {
         massert(28539, "need a valid database name", !db.empty() && !nsIsFull(db));
         lockDB();
+
+        // Resource ids are hashes, so give the lock wait statistics the name
+        getLockWaitProfiler().nameResource(_id, db);
     }
 
     Lock::DBLock::~DBLock() {
@@ -223,12 +278,23 @@ namespace mongo {
     void Lock::DBLock::lockDB() {
         const bool isRead = (_mode == MODE_S || _mode == MODE_IS);
 
-        _lockState->lockGlobal(isRead ? MODE_IS : MODE_IX);
-        if (supportsDocLocking() || enableCollectionLocking) {
-            _lockState->lock(_id, _mode);
+        // Without a wait deadline, these waits do not time out
+        bool deadlineBound;
+        LockResult result =
+            _lockState->lockGlobal(isRead ? MODE_IS : MODE_IX,
+                                   waitTimeoutMs(_lockState, UINT_MAX, &deadlineBound));
+        if (result != LOCK_OK) {
+            invariant(result == LOCK_TIMEOUT && deadlineBound);
+            failLockWaitDeadline("the global lock");
         }
-        else {
-            _lockState->lock(_id, isRead ? MODE_S : MODE_X);
+
+        const LockMode dbMode = (supportsDocLocking() || enableCollectionLocking) ?
+                                    _mode : (isRead ? MODE_S : MODE_X);
+        result = _lockState->lock(_id, dbMode, waitTimeoutMs(_lockState, UINT_MAX, &deadlineBound));
+        if (result != LOCK_OK) {
+            invariant(result == LOCK_TIMEOUT && deadlineBound);
+            _lockState->unlockAll();
+            failLockWaitDeadline(_id.toString());
         }
 
         resetTime();
@@ -273,11 +339,19 @@ namespace mongo {
         massert(28538, "need a non-empty collection name", nsIsFull(ns));
         dassert(_lockState->isDbLockedForMode(nsToDatabaseSubstring(ns),
                                               isRead ? MODE_IS : MODE_IX));
-        if (supportsDocLocking()) {
-            _lockState->lock(_id, mode);
-        } else if (enableCollectionLocking) {
-            _lockState->lock(_id, isRead ? MODE_S : MODE_X);
+        if (supportsDocLocking() || enableCollectionLocking) {
+            const LockMode collMode = supportsDocLocking() ? mode : (isRead ? MODE_S : MODE_X);
+
+            bool deadlineBound;
+            const unsigned timeoutMs = waitTimeoutMs(_lockState, UINT_MAX, &deadlineBound);
+            const LockResult result = _lockState->lock(_id, collMode, timeoutMs);
+            if (result != LOCK_OK) {
+                invariant(result == LOCK_TIMEOUT && deadlineBound);
+                failLockWaitDeadline(_id.toString());
+            }
         }
+
+        getLockWaitProfiler().nameResource(_id, ns);
     }
 
     Lock::CollectionLock::~CollectionLock() {
@@ -36,6 +36,7 @@
 
 #include "mongo/base/string_data.h"
 #include "mongo/db/concurrency/lock_mgr_defs.h"
+#include "mongo/db/concurrency/parallel_batch_lock.h"
 #include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/concurrency/rwlock.h"
 #include "mongo/util/timer.h"
@@ -64,13 +65,17 @@ namespace mongo {
             by default. note only one thread creates a ParallelBatchWriterMode object; the rest just
             call iAmABatchParticipant().  Note that this lock is not released on a temprelease, just
             the normal lock things below.
+
+            On storage engines, which read from snapshots, database readers only block the batch
+            until they have established their snapshot (see ParallelBatchSnapshotReadLock), so
+            reads which are under way carry on while the batch applies.
             */
         class ParallelBatchWriterMode : boost::noncopyable {
-            RWLockRecursive::Exclusive _lk;
+            FairRWLock::Exclusive _lk;
         public:
             ParallelBatchWriterMode() : _lk(_batchLock) {}
             static void iAmABatchParticipant(Locker* lockState);
-            static RWLockRecursive &_batchLock;
+            static FairRWLock &_batchLock;
         };
 
     public:
@@ -85,7 +90,11 @@ namespace mongo {
             void recordTime();
 
         protected:
-            explicit ScopedLock(Locker* lockState, char type );
+            /**
+             * @param snapshotRead - only blocks replication batches until the storage engine
+             *          has established a read snapshot, see ParallelBatchWriterMode
+             */
+            explicit ScopedLock(Locker* lockState, char type, bool snapshotRead = false);
 
         private:
             friend struct TempRelease;
@@ -104,14 +113,16 @@ namespace mongo {
 
             class ParallelBatchWriterSupport : boost::noncopyable {
             public:
-                ParallelBatchWriterSupport(Locker* lockState);
+                ParallelBatchWriterSupport(Locker* lockState, bool snapshotRead);
 
             private:
                 void tempRelease();
                 void relock();
 
                 Locker* _lockState;
-                boost::scoped_ptr<RWLockRecursive::Shared> _lk;
+                const bool _snapshotRead;
+                boost::scoped_ptr<FairRWLock::Shared> _lk;
+                boost::scoped_ptr<ParallelBatchSnapshotReadLock> _snapshotReadLk;
                 friend class ScopedLock;
             };
 
@@ -33,6 +33,7 @@
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/concurrency/lock_mgr_test_help.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/time_support.h"
 
 
 // Most of the tests here will be removed once we move everything over to using LockManager
@@ -263,4 +264,57 @@ namespace mongo {
         }
     }
 
+    TEST(DConcurrency, SnapshotReadReleasesParallelBatchLock) {
+        FairRWLock& batchLock = getParallelBatchWriterLock();
+
+        {
+            ParallelBatchSnapshotReadLock outer;
+            ParallelBatchSnapshotReadLock inner;
+            ASSERT(batchLock.isHeldByThisThread());
+
+            parallelBatchSnapshotEstablished();
+            ASSERT(!batchLock.isHeldByThisThread());
+        }
+
+        {
+            // Holds other than for snapshot reads are not affected
+            FairRWLock::Shared shared(batchLock);
+            ParallelBatchSnapshotReadLock snapshotRead;
+
+            parallelBatchSnapshotEstablished();
+            ASSERT(batchLock.isHeldByThisThread());
+        }
+
+        ASSERT(!batchLock.isHeldByThisThread());
+    }
+
+    TEST(DConcurrency, DBLockFailsAtWaitDeadline) {
+        MMAPV1LockerImpl holder(1);
+        Lock::DBLock holderLock(&holder, "db", MODE_X);
+
+        MMAPV1LockerImpl waiter(2);
+        waiter.setWaitDeadline(curTimeMicros64() + 10 * 1000);
+
+        ASSERT_THROWS(Lock::DBLock(&waiter, "db", MODE_S), UserException);
+        ASSERT(!waiter.isLocked());
+
+        // Uncontended acquisitions succeed even past the deadline
+        Lock::DBLock otherLock(&waiter, "otherdb", MODE_X);
+        ASSERT(waiter.isDbLockedForMode("otherdb", MODE_X));
+    }
+
+    TEST(DConcurrency, CollectionLockFailsAtWaitDeadline) {
+        MMAPV1LockerImpl holder(1);
+        Lock::DBLock holderDbLock(&holder, "db", MODE_IX);
+        Lock::CollectionLock holderCollLock(&holder, "db.coll", MODE_X);
+
+        MMAPV1LockerImpl waiter(2);
+        waiter.setWaitDeadline(curTimeMicros64() + 10 * 1000);
+
+        Lock::DBLock dbLock(&waiter, "db", MODE_IX);
+        ASSERT_THROWS(Lock::CollectionLock(&waiter, "db.coll", MODE_IX), UserException);
+        ASSERT(waiter.isDbLockedForMode("db", MODE_IX));
+        ASSERT(!waiter.isCollectionLockedForMode("db.coll", MODE_IS));
+    }
+
 } // namespace mongo
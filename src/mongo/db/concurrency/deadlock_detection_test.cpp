@@ -26,6 +26,9 @@
  *    it in the license file.
  */
 
+#include <algorithm>
+#include <vector>
+
 #include "mongo/db/concurrency/lock_mgr_test_help.h"
 #include "mongo/unittest/unittest.h"
 
@@ -188,4 +191,32 @@ namespace mongo {
         writer.unlock(resIdFlush);
     }
 
+    TEST(Deadlock, InitialLockerBlockers) {
+        const ResourceId resId(RESOURCE_DATABASE, std::string("A"));
+
+        LockerForTests holder1(1);
+        LockerForTests holder2(2);
+        LockerForTests waiter(3);
+
+        ASSERT_EQUALS(LOCK_OK, holder1.lockImpl(resId, MODE_S));
+        ASSERT_EQUALS(LOCK_OK, holder2.lockImpl(resId, MODE_S));
+        ASSERT_EQUALS(LOCK_WAITING, waiter.lockImpl(resId, MODE_X));
+
+        // The holders are not waiting themselves, but still block the waiter
+        DeadlockDetector wfg(*getGlobalLockManager(), &waiter);
+        ASSERT(!wfg.check().hasCycle());
+
+        std::vector<LockerId> blockers = wfg.getInitialLockerBlockers();
+        std::sort(blockers.begin(), blockers.end());
+
+        ASSERT_EQUALS(2U, blockers.size());
+        ASSERT_EQUALS(1U, blockers[0]);
+        ASSERT_EQUALS(2U, blockers[1]);
+
+        // Cleanup, so that LockerImpl doesn't complain about leaked locks
+        waiter.unlock(resId);
+        holder1.unlock(resId);
+        holder2.unlock(resId);
+    }
+
 } // namespace mongo
@@ -93,6 +93,12 @@ namespace {
         return 1 << mode;
     }
 
+    // The modes, which may be granted on a partition
+    const uint32_t intentModes = (1 << MODE_IS) | (1 << MODE_IX);
+
+    // Have more partitions than CPUs, so that lockers with consecutive ids seldom share one
+    const unsigned kNumPartitions = 32;
+
 
     /**
      * Maps the resource id to a human-readable string.
@@ -145,6 +151,9 @@ namespace {
         void addToConflictQueue(LockRequest* request);
         void removeFromConflictQueue(LockRequest* request);
 
+        // Whether any partitions have requests granted for this lock
+        bool partitioned() const { return !partitions.empty(); }
+
 
         // Id of the resource which this lock protects
         const ResourceId resourceId;
@@ -198,6 +207,34 @@ namespace {
         // check the granted queue for requests in STATUS_CONVERTING if this count is zero. This
         // saves cycles in the regular case and only burdens the less-frequent lock upgrade case.
         uint32_t conversionsCount;
+
+
+        //
+        // Partitions
+        //
+
+        // Partitions on which there is a PartitionedLockHead for this resource. As long as this
+        // is not empty, no modes conflicting with the intent modes are granted or waiting. Only
+        // changed under the bucket lock and, for the respective partition, its mutex.
+        std::vector<LockManager::Partition*> partitions;
+    };
+
+
+    /**
+     * Keeps the intent requests for a resource, which were granted on a particular partition of
+     * the lock manager. The granted modes are not tracked, because they do not conflict with each
+     * other, but the requests need to be known, so they can be migrated to the LockHead.
+     *
+     * Not thread-safe and should only be accessed under the mutex of its partition.
+     */
+    struct PartitionedLockHead {
+        PartitionedLockHead() : grantedListBegin(NULL) { }
+
+        void addRequest(LockRequest* request);
+        void removeRequest(LockRequest* request);
+
+        // Doubly-linked list of the granted requests, using the same links as the LockHead queues
+        LockRequest* grantedListBegin;
     };
 
 
@@ -359,6 +396,39 @@ namespace {
     }
 
 
+    //
+    // PartitionedLockHead
+    //
+
+    void PartitionedLockHead::addRequest(LockRequest* request) {
+        invariant(request->next == NULL);
+        invariant(request->prev == NULL);
+
+        request->next = grantedListBegin;
+        if (grantedListBegin != NULL) {
+            grantedListBegin->prev = request;
+        }
+
+        grantedListBegin = request;
+    }
+
+    void PartitionedLockHead::removeRequest(LockRequest* request) {
+        if (request->prev != NULL) {
+            request->prev->next = request->next;
+        }
+        else {
+            grantedListBegin = request->next;
+        }
+
+        if (request->next != NULL) {
+            request->next->prev = request->prev;
+        }
+
+        request->prev = NULL;
+        request->next = NULL;
+    }
+
+
     //
     // LockManager
     //
@@ -367,6 +437,9 @@ namespace {
         //  Have more buckets than CPUs to reduce contention on lock and caches
         _numLockBuckets = 128;
         _lockBuckets = new LockBucket[_numLockBuckets];
+
+        _numPartitions = kNumPartitions;
+        _partitions = new Partition[_numPartitions];
     }
 
     LockManager::~LockManager() {
@@ -379,7 +452,12 @@ namespace {
             invariant(bucket->data.empty());
         }
 
+        for (unsigned i = 0; i < _numPartitions; i++) {
+            invariant(_partitions[i].data.empty());
+        }
+
         delete[] _lockBuckets;
+        delete[] _partitions;
     }
 
     LockResult LockManager::lock(const ResourceId& resId, LockRequest* request, LockMode mode) {
@@ -401,6 +479,46 @@ namespace {
         invariant((LockConflictsTable[request->mode] | LockConflictsTable[mode]) == 
                 LockConflictsTable[mode]);
 
+        const bool partitionable = _isPartitionable(resId, mode);
+
+        // Fast path for intent modes on the global and database resources. It is safe to grant the
+        // request under just the partition mutex when there is a partitioned lock head for the
+        // resource, because no conflicting mode can be granted or queued without first migrating
+        // it, which needs the same mutex.
+        if (partitionable &&
+                (request->status == LockRequest::STATUS_NEW || request->partitioned)) {
+
+            Partition* partition = _getPartition(request);
+            SimpleMutex::scoped_lock scopedLock(partition->mutex);
+
+            if (request->status == LockRequest::STATUS_NEW) {
+                PartitionedLockHeadMap::iterator it = partition->data.find(resId);
+                if (it != partition->data.end()) {
+                    request->partitioned = true;
+                    request->partitionedLock = it->second;
+                    request->status = LockRequest::STATUS_GRANTED;
+                    request->mode = mode;
+                    request->convertMode = MODE_NONE;
+                    request->recursiveCount++;
+                    invariant(request->recursiveCount == 1);
+
+                    it->second->addRequest(request);
+                    return LOCK_OK;
+                }
+            }
+            else if (request->partitionedLock != NULL) {
+                // Intent conversion (IS -> IX) while still partitioned, which cannot conflict
+                invariant(request->status == LockRequest::STATUS_GRANTED);
+                request->mode = mode;
+                request->recursiveCount++;
+                return LOCK_OK;
+            }
+
+            // The partitioned lock head for the resource does not exist yet or the request was
+            // migrated to the LockHead, so continue on the regular path. Releasing the partition
+            // mutex in between is benign, because the lock bucket decides whether to partition.
+        }
+
         LockBucket* bucket = _getBucket(resId);
         SimpleMutex::scoped_lock scopedLock(bucket->mutex);
 
@@ -419,6 +537,36 @@ namespace {
             lock = it->second;
         }
 
+        if (partitionable && (request->status == LockRequest::STATUS_NEW) &&
+                ((lock->grantedModes & ~intentModes) == 0) && (lock->conflictModes == 0)) {
+
+            // Nothing conflicts with intent modes, so start or continue partitioning the lock
+            Partition* partition = _getPartition(request);
+            SimpleMutex::scoped_lock scopedPartitionLock(partition->mutex);
+
+            PartitionedLockHead*& partitionedLock = partition->data[resId];
+            if (partitionedLock == NULL) {
+                partitionedLock = new PartitionedLockHead();
+                lock->partitions.push_back(partition);
+            }
+
+            request->partitioned = true;
+            request->partitionedLock = partitionedLock;
+            request->status = LockRequest::STATUS_GRANTED;
+            request->mode = mode;
+            request->convertMode = MODE_NONE;
+            request->recursiveCount++;
+            invariant(request->recursiveCount == 1);
+
+            partitionedLock->addRequest(request);
+            return LOCK_OK;
+        }
+
+        // Requests, which conflict with the intent modes must see all of the granted requests
+        if (lock->partitioned() && conflicts(mode, intentModes)) {
+            _migratePartitionedLockHeads(lock);
+        }
+
         // Sanity check if requests are being reused
         invariant(request->lock == NULL || request->lock == lock);
 
@@ -504,7 +652,7 @@ namespace {
     }
 
     bool LockManager::unlock(LockRequest* request) {
-        invariant(request->lock);
+        invariant(request->lock || request->partitioned);
 
         // Fast path for decrementing multiple references of the same lock. It is safe to do this
         // without locking, because 1) all calls for the same lock request must be done on the same
@@ -515,6 +663,22 @@ namespace {
             return false;
         }
 
+        if (request->partitioned) {
+            // The request may have been migrated to the LockHead since it was granted, which can
+            // only be found out under the partition mutex.
+            Partition* partition = _getPartition(request);
+            SimpleMutex::scoped_lock scopedLock(partition->mutex);
+
+            if (request->partitionedLock != NULL) {
+                invariant(request->status == LockRequest::STATUS_GRANTED);
+
+                request->partitionedLock->removeRequest(request);
+                request->partitionedLock = NULL;
+                return true;
+            }
+        }
+
+        invariant(request->lock);
         LockHead* lock = request->lock;
 
         LockBucket* bucket = _getBucket(lock->resourceId);
@@ -566,7 +730,7 @@ namespace {
     }
 
     void LockManager::downgrade(LockRequest* request, LockMode newMode) {
-        invariant(request->lock);
+        invariant(request->lock || request->partitioned);
         invariant(request->status == LockRequest::STATUS_GRANTED);
         invariant(request->recursiveCount > 0);
 
@@ -575,6 +739,18 @@ namespace {
         invariant((LockConflictsTable[request->mode] | LockConflictsTable[newMode]) 
                                 == LockConflictsTable[request->mode]);
 
+        if (request->partitioned) {
+            Partition* partition = _getPartition(request);
+            SimpleMutex::scoped_lock scopedLock(partition->mutex);
+
+            // Nobody can be blocked on a partitioned request, so there is nothing to grant
+            if (request->partitionedLock != NULL) {
+                request->mode = newMode;
+                return;
+            }
+        }
+
+        invariant(request->lock);
         LockHead* lock = request->lock;
 
         LockBucket* bucket = _getBucket(lock->resourceId);
@@ -591,6 +767,29 @@ namespace {
         _onLockModeChanged(lock, true);
     }
 
+    bool LockManager::hasWaiters(const LockRequest* request) const {
+        invariant(request->lock || request->partitioned);
+        invariant(request->status == LockRequest::STATUS_GRANTED);
+
+        if (request->partitioned) {
+            Partition* partition = _getPartition(request);
+            SimpleMutex::scoped_lock scopedLock(partition->mutex);
+
+            // Waiting in a conflicting mode would have migrated the request to the LockHead
+            if (request->partitionedLock != NULL) {
+                return false;
+            }
+        }
+
+        invariant(request->lock);
+        LockHead* lock = request->lock;
+
+        LockBucket* bucket = _getBucket(lock->resourceId);
+        SimpleMutex::scoped_lock scopedLock(bucket->mutex);
+
+        return (lock->conflictModes != 0) || (lock->conversionsCount != 0);
+    }
+
     void LockManager::cleanupUnusedLocks() {
         for (unsigned i = 0; i < _numLockBuckets; i++) {
             LockBucket* bucket = &_lockBuckets[i];
@@ -599,7 +798,11 @@ namespace {
             LockHeadMap::iterator it = bucket->data.begin();
             while (it != bucket->data.end()) {
                 LockHead* lock = it->second;
-                if (lock->grantedModes == 0) {
+                if (lock->partitioned()) {
+                    _cleanupPartitionedLockHeads(lock);
+                }
+
+                if ((lock->grantedModes == 0) && !lock->partitioned()) {
                     invariant(lock->grantedModes == 0);
                     invariant(lock->grantedQueueBegin == NULL);
                     invariant(lock->grantedQueueEnd == NULL);
@@ -694,10 +897,73 @@ namespace {
         invariant((lock->conflictModes == 0) ^ (lock->conflictQueueBegin != NULL));
     }
 
+    void LockManager::_migratePartitionedLockHeads(LockHead* lock) {
+        // There can be no conflicting modes while the lock is partitioned
+        invariant((lock->grantedModes & ~intentModes) == 0);
+        invariant(lock->conflictModes == 0);
+
+        while (lock->partitioned()) {
+            Partition* partition = lock->partitions.back();
+            SimpleMutex::scoped_lock scopedLock(partition->mutex);
+
+            PartitionedLockHeadMap::iterator it = partition->data.find(lock->resourceId);
+            invariant(it != partition->data.end());
+
+            PartitionedLockHead* partitionedLock = it->second;
+            while (partitionedLock->grantedListBegin != NULL) {
+                LockRequest* request = partitionedLock->grantedListBegin;
+                invariant(request->status == LockRequest::STATUS_GRANTED);
+
+                // The list links are shared, so remove first. The recursive count and mode of the
+                // request are retained.
+                partitionedLock->removeRequest(request);
+                request->partitionedLock = NULL;
+                request->lock = lock;
+
+                lock->addToGrantedQueue(request);
+                lock->changeGrantedModeCount(request->mode, LockHead::Increment);
+            }
+
+            partition->data.erase(it);
+            delete partitionedLock;
+
+            lock->partitions.pop_back();
+        }
+    }
+
+    void LockManager::_cleanupPartitionedLockHeads(LockHead* lock) {
+        std::vector<Partition*>::iterator it = lock->partitions.begin();
+        while (it != lock->partitions.end()) {
+            Partition* partition = *it;
+            SimpleMutex::scoped_lock scopedLock(partition->mutex);
+
+            PartitionedLockHeadMap::iterator itLock = partition->data.find(lock->resourceId);
+            invariant(itLock != partition->data.end());
+
+            if (itLock->second->grantedListBegin == NULL) {
+                delete itLock->second;
+                partition->data.erase(itLock);
+                it = lock->partitions.erase(it);
+            }
+            else {
+                it++;
+            }
+        }
+    }
+
     LockManager::LockBucket* LockManager::_getBucket(const ResourceId& resId) const {
         return &_lockBuckets[resId % _numLockBuckets];
     }
 
+    LockManager::Partition* LockManager::_getPartition(const LockRequest* request) const {
+        return &_partitions[request->locker->getId() % _numPartitions];
+    }
+
+    bool LockManager::_isPartitionable(const ResourceId& resId, LockMode mode) {
+        return ((mode == MODE_IS) || (mode == MODE_IX)) &&
+               ((resId.getType() == RESOURCE_GLOBAL) || (resId.getType() == RESOURCE_DATABASE));
+    }
+
     void LockManager::dump() const {
         log() << "Dumping LockManager @ " << static_cast<const void*>(this) << '\n';
 
@@ -718,7 +984,7 @@ namespace {
 
             const LockHead* lock = it->second;
 
-            if (lock->grantedQueueBegin == NULL) {
+            if ((lock->grantedQueueBegin == NULL) && !lock->partitioned()) {
                 // If there are no granted requests, this lock is empty
                 continue;
             }
@@ -726,6 +992,31 @@ namespace {
             StringBuilder sb;
             sb << "Lock @ " << lock << ": " << lock->resourceId.toString() << '\n';
 
+            if (lock->partitioned()) {
+                sb << "PARTITIONED:\n";
+                for (std::vector<Partition*>::const_iterator it = lock->partitions.begin();
+                     it != lock->partitions.end();
+                     it++) {
+
+                    SimpleMutex::scoped_lock scopedLock((*it)->mutex);
+
+                    const PartitionedLockHead* partitionedLock =
+                                                    (*it)->data.find(lock->resourceId)->second;
+
+                    for (const LockRequest* iter = partitionedLock->grantedListBegin;
+                         iter != NULL;
+                         iter = iter->next) {
+
+                        sb << '\t'
+                            << "LockRequest " << iter->locker->getId() << " @ " << iter->locker
+                            << ": " << "Mode = " << modeName(iter->mode) << "; "
+                            << '\n';
+                    }
+                }
+
+                sb << '\n';
+            }
+
             sb << "GRANTED:\n";
             for (const LockRequest* iter = lock->grantedQueueBegin;
                  iter != NULL;
@@ -859,13 +1150,7 @@ namespace {
                 if (conflicts(request->mode, modeMask(it->mode)) ||
                     conflicts(request->mode, modeMask(it->convertMode))) {
 
-                    const LockerId lockerId = it->locker->getId();
-                    const ResourceId waitResId = it->locker->getWaitingResource();
-
-                    if (waitResId.isValid()) {
-                        _queue.push_front(UnprocessedNode(lockerId, waitResId));
-                        edges.owners.push_back(lockerId);
-                    }
+                    _addConflict(node, &edges, it->locker);
                 }
 
                 continue;
@@ -878,13 +1163,7 @@ namespace {
             if (conflicts(request->convertMode, modeMask(it->mode)) ||
                 (seen && conflicts(request->convertMode, modeMask(it->convertMode)))) {
 
-                const LockerId lockerId = it->locker->getId();
-                const ResourceId waitResId = it->locker->getWaitingResource();
-
-                if (waitResId.isValid()) {
-                    _queue.push_front(UnprocessedNode(lockerId, waitResId));
-                    edges.owners.push_back(lockerId);
-                }
+                _addConflict(node, &edges, it->locker);
             }
         }
 
@@ -897,17 +1176,29 @@ namespace {
             invariant(it != request);
 
             if (conflicts(request->mode, modeMask(it->mode))) {
-                const LockerId lockerId = it->locker->getId();
-                const ResourceId waitResId = it->locker->getWaitingResource();
-
-                if (waitResId.isValid()) {
-                    _queue.push_front(UnprocessedNode(lockerId, waitResId));
-                    edges.owners.push_back(lockerId);
-                }
+                _addConflict(node, &edges, it->locker);
             }
         }
     }
 
+    void DeadlockDetector::_addConflict(const UnprocessedNode& node,
+                                        Edges* edges,
+                                        const Locker* owner) {
+
+        const LockerId lockerId = owner->getId();
+        const ResourceId waitResId = owner->getWaitingResource();
+
+        if (node.lockerId == _initialLockerId) {
+            _initialLockerBlockers.push_back(lockerId);
+        }
+
+        if (waitResId.isValid()) {
+            _queue.push_front(UnprocessedNode(lockerId, waitResId));
+            edges->owners.push_back(lockerId);
+        }
+    }
+
+
 
     //
     // ResourceId
@@ -962,6 +1253,8 @@ namespace {
         this->notify = notify;
 
         lock = NULL;
+        partitionedLock = NULL;
+        partitioned = false;
         prev = NULL;
         next = NULL;
         status = STATUS_NEW;
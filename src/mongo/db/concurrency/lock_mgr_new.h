@@ -29,6 +29,7 @@
 #pragma once
 
 #include <deque>
+#include <vector>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 
@@ -44,6 +45,7 @@ namespace mongo {
 
     class Locker;
     struct LockHead;
+    struct PartitionedLockHead;
 
     /**
      * Interface on which granted lock requests will be notified. See the contract for the notify
@@ -121,6 +123,16 @@ namespace mongo {
         // on it, so it is safe to have this pointer hanging around.
         LockHead* lock;
 
+        // Pointer to the partitioned lock to which this request belongs, if it was granted through
+        // the intent lock fast path and has not been migrated to the LockHead since. Only read or
+        // written under the mutex of the request's partition.
+        PartitionedLockHead* partitionedLock;
+
+        // Whether this request was ever granted on a partition. If true, partitionedLock must be
+        // checked under the partition mutex before touching the lock, because a conflicting
+        // request may have migrated it to the LockHead in the mean time.
+        bool partitioned;
+
         // The reason intrusive linked list is used instead of the std::list class is to allow
         // for entries to be removed from the middle of the list in O(1) time, if they are known
         // instead of having to search for them and we cannot persist iterators, because the list
@@ -209,6 +221,16 @@ namespace mongo {
          */
         void downgrade(LockRequest* request, LockMode newMode);
 
+        /**
+         * Returns whether any other request is blocked behind the lock on which 'request' is
+         * held, either waiting on its conflict queue or converting on its granted queue. Used by
+         * operations which periodically yield their locks, so they can avoid the cost of yielding
+         * when nobody would get to run.
+         *
+         * @param request A request, already in granted mode through a previous call to lock.
+         */
+        bool hasWaiters(const LockRequest* request) const;
+
         /**
          * Iterates through all buckets and deletes all locks, which have no requests on them. This
          * call is kind of expensive and should only be used for reducing the memory footprint of
@@ -233,6 +255,9 @@ namespace mongo {
         // The deadlock detector needs to access the buckets and locks directly
         friend class DeadlockDetector;
 
+        // The lock heads keep track of the partitions on which they have granted requests
+        friend struct LockHead;
+
         // These types describe the locks hash table
         typedef unordered_map<ResourceId, LockHead*> LockHeadMap;
         typedef LockHeadMap::value_type LockHeadPair;
@@ -243,6 +268,25 @@ namespace mongo {
             LockHeadMap data;
         };
 
+        /**
+         * Intent requests (IS and IX) on the global and database resources are granted on one of
+         * several partitions, chosen by the locker, instead of on the LockHead. This way the
+         * uncontended case, which is nearly all of the traffic, only takes the mutex of the
+         * partition and doesn't serialize on the bucket of the global resource.
+         *
+         * A resource's LockHead knows on which partitions it has a PartitionedLockHead. A request
+         * in a mode which conflicts with the intent modes (S or X) first migrates all partitioned
+         * requests back to the LockHead, after which the usual queueing rules apply. The lock
+         * order is bucket mutex, then partition mutex.
+         */
+        typedef unordered_map<ResourceId, PartitionedLockHead*> PartitionedLockHeadMap;
+
+        struct Partition {
+            Partition() : mutex("LockManagerPartition") { }
+            SimpleMutex mutex;
+            PartitionedLockHeadMap data;
+        };
+
 
         /**
          * Retrieves the bucket in which the particular resource must reside. There is no need to
@@ -250,6 +294,31 @@ namespace mongo {
          */
         LockBucket* _getBucket(const ResourceId& resId) const;
 
+        /**
+         * Retrieves the partition on which the intent requests of the request's locker go.
+         */
+        Partition* _getPartition(const LockRequest* request) const;
+
+        /**
+         * Whether a request for the given resource and mode may be granted on a partition.
+         */
+        static bool _isPartitionable(const ResourceId& resId, LockMode mode);
+
+        /**
+         * Moves all requests granted on partitions for this lock to its granted queue and deletes
+         * the partitioned lock heads.
+         *
+         * MUST be called under the lock bucket's spin lock.
+         */
+        void _migratePartitionedLockHeads(LockHead* lock);
+
+        /**
+         * Deletes the partitioned lock heads of the lock, which have no requests on them.
+         *
+         * MUST be called under the lock bucket's spin lock.
+         */
+        void _cleanupPartitionedLockHeads(LockHead* lock);
+
         /**
          * Prints the contents of a bucket to the log.
          */
@@ -271,6 +340,9 @@ namespace mongo {
 
         unsigned _numLockBuckets;
         LockBucket* _lockBuckets;
+
+        unsigned _numPartitions;
+        Partition* _partitions;
     };
 
 
@@ -321,6 +393,15 @@ namespace mongo {
          */
         std::string toString() const;
 
+        /**
+         * Returns the lockers, which hold or are queued ahead of the initial locker with a
+         * conflicting mode, whether they are waiting themselves or not. This is filled in by the
+         * first call to next().
+         */
+        const std::vector<LockerId>& getInitialLockerBlockers() const {
+            return _initialLockerBlockers;
+        }
+
     private:
 
         // An entry in the owners list below means that some locker L is blocked on some resource
@@ -364,6 +445,12 @@ namespace mongo {
 
         void _processNextNode(const UnprocessedNode& node);
 
+        /**
+         * Records that the locker of the node conflicts with the request of the given owner and
+         * queues up the owner, if it is waiting itself.
+         */
+        void _addConflict(const UnprocessedNode& node, Edges* edges, const Locker* owner);
+
 
         // Not owned. Lifetime must be longer than that of the graph builder.
         const LockManager& _lockMgr;
@@ -372,6 +459,8 @@ namespace mongo {
         UnprocessedNodesQueue _queue;
         WaitForGraph _graph;
 
+        std::vector<LockerId> _initialLockerBlockers;
+
         bool _foundCycle;
     };
 
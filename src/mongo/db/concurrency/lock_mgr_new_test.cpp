@@ -460,6 +460,48 @@ namespace mongo {
         lockMgr.unlock(&request2);
     }
 
+    TEST(LockManager, HasWaiters) {
+        LockManager lockMgr;
+        const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.collection"));
+
+        MMAPV1LockerImpl locker1(1);
+        TrackingLockGrantNotification notify1;
+
+        MMAPV1LockerImpl locker2(2);
+        TrackingLockGrantNotification notify2;
+
+        LockRequest request1;
+        request1.initNew(&locker1, &notify1);
+
+        LockRequest request2;
+        request2.initNew(&locker2, &notify2);
+
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_S));
+        ASSERT(!lockMgr.hasWaiters(&request1));
+
+        // A compatible request is granted and does not wait
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request2, MODE_S));
+        ASSERT(!lockMgr.hasWaiters(&request1));
+
+        // A conflicting conversion waits on the granted queue
+        ASSERT(LOCK_WAITING == lockMgr.lock(resId, &request2, MODE_X));
+        ASSERT(lockMgr.hasWaiters(&request1));
+
+        lockMgr.unlock(&request2);
+        ASSERT(!lockMgr.hasWaiters(&request1));
+        lockMgr.unlock(&request2);
+
+        // A conflicting request waits on the conflict queue
+        request2.initNew(&locker2, &notify2);
+        ASSERT(LOCK_WAITING == lockMgr.lock(resId, &request2, MODE_X));
+        ASSERT(lockMgr.hasWaiters(&request1));
+
+        lockMgr.unlock(&request2);
+        ASSERT(!lockMgr.hasWaiters(&request1));
+
+        lockMgr.unlock(&request1);
+    }
+
     TEST(LockManager, ConflictingConversion) {
         LockManager lockMgr;
         const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.collection"));
@@ -587,6 +629,105 @@ namespace mongo {
         ASSERT(request2.recursiveCount == 0);
     }
 
+    TEST(LockManager, PartitionedIntentThenExclusive) {
+        LockManager lockMgr;
+        const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+        MMAPV1LockerImpl locker1(1);
+        TrackingLockGrantNotification notify1;
+        LockRequest request1;
+        request1.initNew(&locker1, &notify1);
+
+        MMAPV1LockerImpl locker2(2);
+        TrackingLockGrantNotification notify2;
+        LockRequest request2;
+        request2.initNew(&locker2, &notify2);
+
+        MMAPV1LockerImpl locker3(3);
+        TrackingLockGrantNotification notify3;
+        LockRequest request3;
+        request3.initNew(&locker3, &notify3);
+
+        // Intent requests on a database go to the partitions
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IX));
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request2, MODE_IS));
+        ASSERT(request1.partitioned);
+        ASSERT(request2.partitioned);
+        ASSERT(!lockMgr.hasWaiters(&request1));
+
+        // An exclusive request migrates them and waits for both
+        ASSERT(LOCK_WAITING == lockMgr.lock(resId, &request3, MODE_X));
+        ASSERT(request1.partitionedLock == NULL);
+        ASSERT(request2.partitionedLock == NULL);
+        ASSERT(lockMgr.hasWaiters(&request1));
+        ASSERT(lockMgr.hasWaiters(&request2));
+
+        ASSERT(lockMgr.unlock(&request1));
+        ASSERT(notify3.numNotifies == 0);
+
+        ASSERT(lockMgr.unlock(&request2));
+        ASSERT(notify3.numNotifies == 1);
+        ASSERT(notify3.lastResult == LOCK_OK);
+        ASSERT(request3.mode == MODE_X);
+
+        // While the exclusive lock is held, intent requests queue up behind it
+        request1.initNew(&locker1, &notify1);
+        ASSERT(LOCK_WAITING == lockMgr.lock(resId, &request1, MODE_IS));
+        ASSERT(!request1.partitioned);
+
+        ASSERT(lockMgr.unlock(&request3));
+        ASSERT(notify1.numNotifies == 1);
+        ASSERT(notify1.lastResult == LOCK_OK);
+
+        // Once nothing conflicts, new intent requests are partitioned again
+        request2.initNew(&locker2, &notify2);
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request2, MODE_IX));
+        ASSERT(request2.partitioned);
+
+        ASSERT(lockMgr.unlock(&request1));
+        ASSERT(lockMgr.unlock(&request2));
+    }
+
+    TEST(LockManager, PartitionedConversion) {
+        LockManager lockMgr;
+        const ResourceId resId(RESOURCE_GLOBAL, 1ULL);
+
+        MMAPV1LockerImpl locker1(1);
+        TrackingLockGrantNotification notify1;
+        LockRequest request1;
+        request1.initNew(&locker1, &notify1);
+
+        MMAPV1LockerImpl locker2(2);
+        TrackingLockGrantNotification notify2;
+        LockRequest request2;
+        request2.initNew(&locker2, &notify2);
+
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IS));
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request2, MODE_IS));
+
+        // Intent conversion stays on the partition
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IX));
+        ASSERT(request1.partitionedLock != NULL);
+        ASSERT(request1.mode == MODE_IX);
+        ASSERT(request1.recursiveCount == 2);
+
+        // Conversion to a conflicting mode migrates and waits for the other intent holder
+        ASSERT(LOCK_WAITING == lockMgr.lock(resId, &request2, MODE_X));
+        ASSERT(request2.partitionedLock == NULL);
+        ASSERT(lockMgr.hasWaiters(&request1));
+
+        ASSERT(!lockMgr.unlock(&request1));
+        ASSERT(notify2.numNotifies == 0);
+        ASSERT(lockMgr.unlock(&request1));
+        ASSERT(notify2.numNotifies == 1);
+        ASSERT(request2.mode == MODE_X);
+
+        lockMgr.downgrade(&request2, MODE_IX);
+        ASSERT(request2.mode == MODE_IX);
+
+        ASSERT(!lockMgr.unlock(&request2));
+        ASSERT(lockMgr.unlock(&request2));
+    }
 
 
     static void checkConflict(LockMode existingMode, LockMode newMode, bool hasConflict) {
@@ -32,12 +32,18 @@
 
 #include "mongo/db/concurrency/lock_state.h"
 
+#include <algorithm>
+
 #include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/db/global_environment_experiment.h"
+#include "mongo/db/concurrency/lock_stats.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/stacktrace.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -60,6 +66,78 @@ namespace mongo {
         // How often (in millis) to check for deadlock if a lock has not been granted for some time
         const unsigned DeadlockTimeoutMs = 100;
 
+        // Lock acquisitions, which wait for longer than this are logged once, together with the
+        // operations they are waiting behind. Zero disables the logging.
+        MONGO_EXPORT_SERVER_PARAMETER(slowLockWaitMS, int, 1000);
+
+        /**
+         * Collects the ids of the operations, whose lockers are among the given ones.
+         */
+        class OpIdsOfLockers : public GlobalEnvironmentExperiment::ProcessOperationContext {
+        public:
+            OpIdsOfLockers(const std::vector<LockerId>& lockerIds) : _lockerIds(lockerIds) { }
+
+            virtual void processOpContext(OperationContext* txn) {
+                const LockerId lockerId = txn->lockState()->getId();
+                if (std::find(_lockerIds.begin(), _lockerIds.end(), lockerId) != _lockerIds.end()) {
+                    opIds.push_back(txn->getOpID());
+                }
+            }
+
+            std::vector<unsigned int> opIds;
+
+        private:
+            const std::vector<LockerId>& _lockerIds;
+        };
+
+        // Adaptive admission control in front of the global lock. Disabled by default; when
+        // enabled, the number of concurrent readers and writers is tuned between the min and max
+        // tickets from the measured latency and throughput (see AdmissionController).
+        MONGO_EXPORT_STARTUP_SERVER_PARAMETER(admissionControlEnabled, bool, false);
+
+        AdmissionController readAdmission("read", AdmissionController::Options());
+        AdmissionController writeAdmission("write", AdmissionController::Options());
+
+        class AdmissionTicketsParameter : public ExportedServerParameter<int> {
+        public:
+            AdmissionTicketsParameter(const std::string& name, int* value)
+                : ExportedServerParameter<int>(ServerParameterSet::getGlobal(),
+                                               name, value, true, true) {}
+
+            virtual Status set(const int& newValue) {
+                Status status = ExportedServerParameter<int>::set(newValue);
+                if (status.isOK()) {
+                    applyAdmissionLimits();
+                }
+                return status;
+            }
+
+        protected:
+            virtual Status validate(const int& potentialNewValue) {
+                if (potentialNewValue < 1) {
+                    return Status(ErrorCodes::BadValue, str::stream() << name()
+                                  << " must be at least 1");
+                }
+                return Status::OK();
+            }
+
+        private:
+            static void applyAdmissionLimits();
+        };
+
+        int admissionControlMinTickets = AdmissionController::Options().minTickets;
+        int admissionControlMaxTickets = AdmissionController::Options().maxTickets;
+
+        AdmissionTicketsParameter admissionControlMinTicketsParameter(
+                "admissionControlMinTickets", &admissionControlMinTickets);
+        AdmissionTicketsParameter admissionControlMaxTicketsParameter(
+                "admissionControlMaxTickets", &admissionControlMaxTickets);
+
+        void AdmissionTicketsParameter::applyAdmissionLimits() {
+            readAdmission.setLimits(admissionControlMinTickets, admissionControlMaxTickets);
+            writeAdmission.setLimits(admissionControlMinTickets, admissionControlMaxTickets);
+        }
+
         /**
          * Used to sort locks by granularity when snapshotting lock state. We must report and
          * reacquire locks in the same granularity in which they are acquired (i.e. global, flush,
@@ -292,6 +370,14 @@ namespace mongo {
     LockerImpl<IsForMMAPV1>::LockerImpl(LockerId id)
         : _id(id),
           _wuowNestingLevel(0),
+          _admissionPriority(AdmissionController::kPriorityNormal),
+          _admission(NULL),
+          _admittedMicros(0),
+          _waitDeadlineMicros(0),
+          _waitCount(0),
+          _waitMicros(0),
+          _longestWaitMicros(0),
+          _admissionWaitMicros(0),
           _batchWriter(false),
           _lockPendingParallelWriter(false),
           _recursive(0),
@@ -307,6 +393,7 @@ namespace mongo {
         invariant(!inAWriteUnitOfWork());
         invariant(_resourcesToUnlockAtEndOfUnitOfWork.empty());
         invariant(_requests.empty());
+        invariant(!_admission);
     }
 
     template<bool IsForMMAPV1>
@@ -319,6 +406,22 @@ namespace mongo {
             // Start counting time since first global lock acquisition (that's when effectively
             // any timing for the locker counts from).
             _timer.reset();
+
+            // The ticket is held until the global lock is released (see _unlockImpl).
+            AdmissionController* admission = getAdmissionController(mode);
+            if (admission) {
+                const bool admitted = admission->acquire(_admissionPriority, timeoutMs);
+                {
+                    scoped_spinlock scopedLock(_lock);
+                    _admissionWaitMicros += _timer.micros();
+                }
+                if (!admitted) {
+                    return LOCK_TIMEOUT;
+                }
+
+                _admission = admission;
+                _admittedMicros = curTimeMicros64();
+            }
         }
         else {
             // No upgrades on the GlobalLock are currently necessary. Should not be used until we
@@ -326,10 +429,21 @@ namespace mongo {
             invariant(it->mode >= mode);
         }
 
-        LockResult globalLockResult = lock(resourceIdGlobal, mode, timeoutMs);
+        // Waiting for admission counts against the timeout
+        unsigned globalTimeoutMs = timeoutMs;
+        if (timeoutMs != UINT_MAX && _admission && !it) {
+            const unsigned elapsedTimeMs = _timer.millis();
+            globalTimeoutMs = elapsedTimeMs < timeoutMs ? (timeoutMs - elapsedTimeMs) : 0;
+        }
+
+        LockResult globalLockResult = lock(resourceIdGlobal, mode, globalTimeoutMs);
         if (globalLockResult != LOCK_OK) {
             invariant(globalLockResult == LOCK_TIMEOUT);
 
+            if (!it) {
+                _releaseAdmission();
+            }
+
             return globalLockResult;
         }
 
@@ -451,6 +565,7 @@ namespace mongo {
         // Don't go sleeping without bound in order to be able to report long waits or wake up for
         // deadlock detection.
         unsigned waitTimeMs = std::min(timeoutMs, DeadlockTimeoutMs);
+        bool loggedSlowWait = false;
         while (true) {
             result = _notify.wait(waitTimeMs);
 
@@ -474,6 +589,12 @@ namespace mongo {
                 break;
             }
 
+            const int slowMs = slowLockWaitMS;
+            if (!loggedSlowWait && slowMs > 0 && elapsedTimeMs >= static_cast<unsigned>(slowMs)) {
+                _logSlowWait(resId, mode, elapsedTimeMs);
+                loggedSlowWait = true;
+            }
+
             // This will occasionally dump the global lock manager in case lock acquisition is
             // taking too long.
             if (elapsedTimeMs > 30000U) {
@@ -481,6 +602,8 @@ namespace mongo {
             }
         }
 
+        _recordWait(resId, mode, timer.micros());
+
         // Cleanup the state, since this is an unused lock now
         if (result != LOCK_OK) {
             LockRequestsMap::Iterator it = _requests.find(resId);
@@ -586,6 +709,21 @@ namespace mongo {
         return ResourceId();
     }
 
+    template<bool IsForMMAPV1>
+    bool LockerImpl<IsForMMAPV1>::hasLockWaiters() const {
+        // Only the owning thread modifies the requests map, so it needs no spin lock here.
+        LockRequestsMap::ConstIterator it = _requests.begin();
+        while (!it.finished()) {
+            if (it->status == LockRequest::STATUS_GRANTED && globalLockManager.hasWaiters(&*it)) {
+                return true;
+            }
+
+            it.next();
+        }
+
+        return (NULL != _admission) && (_admission->waiting() > 0);
+    }
+
     template<bool IsForMMAPV1>
     void LockerImpl<IsForMMAPV1>::getLockerInfo(LockerInfo* lockerInfo) const {
         invariant(lockerInfo);
@@ -594,6 +732,15 @@ namespace mongo {
         lockerInfo->locks.clear();
         lockerInfo->waitingResource = ResourceId();
 
+        {
+            scoped_spinlock scopedLock(_lock);
+            lockerInfo->waitCount = _waitCount;
+            lockerInfo->waitMicros = _waitMicros;
+            lockerInfo->longestWaitResource = _longestWaitResource;
+            lockerInfo->longestWaitMicros = _longestWaitMicros;
+            lockerInfo->admissionWaitMicros = _admissionWaitMicros;
+        }
+
         if (!isLocked()) return;
 
         _lock.lock();
@@ -711,8 +858,15 @@ namespace mongo {
         }
 
         if (globalLockManager.unlock(it.objAddr())) {
-            scoped_spinlock scopedLock(_lock);
-            it.remove();
+            const bool isGlobal = (it.key() == resourceIdGlobal);
+            {
+                scoped_spinlock scopedLock(_lock);
+                it.remove();
+            }
+
+            if (isGlobal) {
+                _releaseAdmission();
+            }
 
             return true;
         }
@@ -720,6 +874,65 @@ namespace mongo {
         return false;
     }
 
+    template<bool IsForMMAPV1>
+    void LockerImpl<IsForMMAPV1>::_releaseAdmission() {
+        if (_admission) {
+            _admission->release(_admittedMicros, curTimeMicros64());
+            _admission = NULL;
+        }
+    }
+
+    template<bool IsForMMAPV1>
+    void LockerImpl<IsForMMAPV1>::_recordWait(const ResourceId& resId,
+                                              LockMode mode,
+                                              uint64_t waitMicros) {
+
+        getLockWaitProfiler().recordWait(resId, mode, waitMicros);
+
+        scoped_spinlock scopedLock(_lock);
+        _waitCount++;
+        _waitMicros += waitMicros;
+        if (waitMicros > _longestWaitMicros) {
+            _longestWaitResource = resId;
+            _longestWaitMicros = waitMicros;
+        }
+    }
+
+    template<bool IsForMMAPV1>
+    void LockerImpl<IsForMMAPV1>::_logSlowWait(const ResourceId& resId,
+                                               LockMode mode,
+                                               unsigned elapsedMs) const {
+
+        // Only the first step of the wait-for graph walk is needed, which finds the lockers the
+        // request is queued behind
+        DeadlockDetector wfg(globalLockManager, this);
+        wfg.next();
+
+        const std::vector<LockerId>& blockers = wfg.getInitialLockerBlockers();
+
+        OpIdsOfLockers opIdsOfBlockers(blockers);
+        if (hasGlobalEnvironment()) {
+            getGlobalEnvironment()->forEachOperationContext(&opIdsOfBlockers);
+        }
+
+        StringBuilder sb;
+        sb << "Lock acquisition of " << getLockWaitProfiler().getResourceName(resId)
+           << " in mode " << modeName(mode) << " by locker " << _id
+           << " has been waiting for " << elapsedMs << "ms behind lockers [";
+        for (size_t i = 0; i < blockers.size(); i++) {
+            sb << (i ? ", " : "") << blockers[i];
+        }
+
+        sb << "], opids [";
+        for (size_t i = 0; i < opIdsOfBlockers.opIds.size(); i++) {
+            sb << (i ? ", " : "") << opIdsOfBlockers.opIds[i];
+        }
+
+        sb << "]";
+
+        log() << sb.str();
+    }
+
     template<bool IsForMMAPV1>
     LockMode LockerImpl<IsForMMAPV1>::_getModeForMMAPV1FlushLock() const {
         invariant(IsForMMAPV1);
@@ -798,6 +1011,14 @@ namespace mongo {
         return &globalLockManager;
     }
 
+    AdmissionController* getAdmissionController(LockMode mode) {
+        if (!admissionControlEnabled) {
+            return NULL;
+        }
+
+        return isSharedMode(mode) ? &readAdmission : &writeAdmission;
+    }
+
     
     // Ensures that there are two instances compiled for LockerImpl for the two values of the
     // template argument.
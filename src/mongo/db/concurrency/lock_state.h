@@ -97,6 +97,13 @@ namespace mongo {
 
         virtual LockResult lockGlobal(LockMode mode, unsigned timeoutMs = UINT_MAX);
         virtual void downgradeGlobalXtoSForMMAPV1();
+        virtual void setAdmissionPriority(AdmissionController::Priority priority) {
+            _admissionPriority = priority;
+        }
+        virtual void setWaitDeadline(uint64_t deadlineMicros) {
+            _waitDeadlineMicros = deadlineMicros;
+        }
+        virtual uint64_t getWaitDeadline() const { return _waitDeadlineMicros; }
         virtual bool unlockAll();
 
         virtual void beginWriteUnitOfWork();
@@ -120,6 +127,8 @@ namespace mongo {
 
         virtual ResourceId getWaitingResource() const;
 
+        virtual bool hasLockWaiters() const;
+
         virtual void getLockerInfo(LockerInfo* lockerInfo) const;
 
         virtual bool saveLockStateAndUnlock(LockSnapshot* stateOut);
@@ -155,6 +164,23 @@ namespace mongo {
          */
         LockMode _getModeForMMAPV1FlushLock() const;
 
+        /**
+         * Gives back the admission ticket taken by the first lockGlobal call, if there is one.
+         */
+        void _releaseAdmission();
+
+        /**
+         * Accounts for a lock acquisition, which had to wait, in the statistics of this locker
+         * and in the process-wide lock wait profiler.
+         */
+        void _recordWait(const ResourceId& resId, LockMode mode, uint64_t waitMicros);
+
+        /**
+         * Logs that the acquisition of resId has been waiting for longer than slowLockWaitMS,
+         * along with the operations it is waiting behind.
+         */
+        void _logSlowWait(const ResourceId& resId, LockMode mode, unsigned elapsedMs) const;
+
 
         // Used to disambiguate different lockers
         const LockerId _id;
@@ -179,6 +205,22 @@ namespace mongo {
         // For maintaining locking timing statistics
         Timer _timer;
 
+        // The admission controller we hold a ticket from while the global lock is held, if any,
+        // and when we got it (for its latency sampling).
+        AdmissionController::Priority _admissionPriority;
+        AdmissionController* _admission;
+        long long _admittedMicros;
+
+        // See setWaitDeadline, 0 if none
+        uint64_t _waitDeadlineMicros;
+
+        // Lock wait statistics of this locker, reported by getLockerInfo. Protected by _lock.
+        uint64_t _waitCount;
+        uint64_t _waitMicros;
+        ResourceId _longestWaitResource;
+        uint64_t _longestWaitMicros;
+        uint64_t _admissionWaitMicros;
+
 
         //////////////////////////////////////////////////////////////////////////////////////////
         //
@@ -275,7 +317,8 @@ namespace mongo {
      * Once the S lock is granted, the flush thread writes the journal entries to disk (it is
      * guaranteed that there will not be any modifications) and applies them to the shared view.
      *
-     * After that, it upgrades the S lock to X and remaps the private view.
+     * After that, it remaps the private view, upgrading the S lock to X first on the platforms
+     * where remapping a view isn't atomic.
      *
      * NOTE: There should be only one usage of this class and this should be in dur.cpp
      */
@@ -285,7 +328,8 @@ namespace mongo {
         ~AutoAcquireFlushLockForMMAPV1Commit();
 
         /**
-         * We need the exclusive lock in order to do the shared view remap.
+         * We need the exclusive lock in order to do the shared view remap where remapping a view
+         * isn't atomic.
          */
         void upgradeFlushLockToExclusive();
 
@@ -307,4 +351,11 @@ namespace mongo {
      */
     LockManager* getGlobalLockManager();
 
+    /**
+     * Returns the admission controller which operations taking the global lock in 'mode' must
+     * get a ticket from, or NULL if admission control is disabled.  Readers (IS, S) and writers
+     * (IX, X) are admitted separately.
+     */
+    AdmissionController* getAdmissionController(LockMode mode);
+
 } // namespace mongo
@@ -31,6 +31,7 @@
 #include <vector>
 
 #include "mongo/db/concurrency/lock_mgr_test_help.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/unittest/unittest.h"
 
 
@@ -109,6 +110,30 @@ namespace mongo {
         locker2.unlockAll();
     }
 
+    TEST(LockerImpl, HasLockWaiters) {
+        const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.collection"));
+
+        MMAPV1LockerImpl locker1(1);
+        ASSERT(LOCK_OK == locker1.lockGlobal(MODE_IS));
+        ASSERT(LOCK_OK == locker1.lock(resId, MODE_S));
+        ASSERT(!locker1.hasLockWaiters());
+
+        MMAPV1LockerImpl locker2(2);
+        ASSERT(LOCK_OK == locker2.lockGlobal(MODE_IX));
+        ASSERT(!locker1.hasLockWaiters());
+
+        // Post a conflicting request without blocking on it
+        ASSERT(LOCK_WAITING == locker2.lockImpl(resId, MODE_X));
+        ASSERT(locker1.hasLockWaiters());
+        ASSERT(!locker2.hasLockWaiters());
+
+        ASSERT(locker2.unlock(resId));
+        ASSERT(!locker1.hasLockWaiters());
+
+        locker1.unlockAll();
+        locker2.unlockAll();
+    }
+
     TEST(LockerImpl, ReadTransaction) {
         MMAPV1LockerImpl locker(1);
 
@@ -208,4 +233,73 @@ namespace mongo {
         locker.unlockAll();
     }
 
+    namespace {
+
+        void setAdmissionControlEnabled(bool enabled) {
+            ServerParameter* parameter =
+                ServerParameterSet::getGlobal()->getMap().find("admissionControlEnabled")->second;
+            ASSERT_OK(parameter->set(BSON("" << enabled).firstElement()));
+        }
+
+    } // namespace
+
+    TEST(LockerImpl, AdmissionTicketHeldWithGlobalLock) {
+        setAdmissionControlEnabled(true);
+
+        AdmissionController* read = getAdmissionController(MODE_IS);
+        AdmissionController* write = getAdmissionController(MODE_IX);
+        ASSERT(read && write && read != write);
+
+        Locker::LockSnapshot lockInfo;
+        MMAPV1LockerImpl locker(1);
+
+        ASSERT(LOCK_OK == locker.lockGlobal(MODE_IX));
+        ASSERT(LOCK_OK == locker.lockGlobal(MODE_IX));
+        ASSERT_EQUALS(1, write->used());
+        ASSERT_EQUALS(0, read->used());
+
+        ASSERT(!locker.unlockAll());
+        ASSERT_EQUALS(1, write->used());
+        ASSERT(locker.unlockAll());
+        ASSERT_EQUALS(0, write->used());
+
+        // Yielding gives the ticket back.
+        ASSERT(LOCK_OK == locker.lockGlobal(MODE_IS));
+        ASSERT_EQUALS(1, read->used());
+        ASSERT(locker.saveLockStateAndUnlock(&lockInfo));
+        ASSERT_EQUALS(0, read->used());
+        locker.restoreLockState(lockInfo);
+        ASSERT_EQUALS(1, read->used());
+        locker.unlockAll();
+        ASSERT_EQUALS(0, read->used());
+
+        setAdmissionControlEnabled(false);
+    }
+
+    TEST(LockerImpl, AdmissionTimeout) {
+        setAdmissionControlEnabled(true);
+        AdmissionController* write = getAdmissionController(MODE_IX);
+        write->setLimits(1, 1);
+
+        MMAPV1LockerImpl locker1(1);
+        MMAPV1LockerImpl locker2(2);
+        ASSERT(LOCK_OK == locker1.lockGlobal(MODE_IX));
+        ASSERT(LOCK_TIMEOUT == locker2.lockGlobal(MODE_IX, 10));
+        ASSERT(!locker2.isLocked());
+        ASSERT_EQUALS(1, write->used());
+
+        // The wait for the ticket is accounted for, unlike a lock wait
+        Locker::LockerInfo info;
+        locker2.getLockerInfo(&info);
+        ASSERT_GREATER_THAN_OR_EQUALS(info.admissionWaitMicros, 10 * 1000U);
+        ASSERT_EQUALS(0U, info.waitCount);
+
+        locker1.unlockAll();
+        ASSERT_EQUALS(0, write->used());
+
+        write->setLimits(AdmissionController::Options().minTickets,
+                         AdmissionController::Options().maxTickets);
+        setAdmissionControlEnabled(false);
+    }
+
 } // namespace mongo
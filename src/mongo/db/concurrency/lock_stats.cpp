@@ -0,0 +1,285 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/concurrency/lock_stats.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Every how many-th lock wait is recorded against its individual resource. The histograms
+        // per resource type and mode always count every wait. Zero disables the tracking of
+        // individual resources.
+        MONGO_EXPORT_SERVER_PARAMETER(lockWaitProfilerSampleRate, int, 1);
+
+        // Upper bounds of all but the last histogram bucket
+        const uint64_t HistogramBoundsMicros[LockWaitProfiler::kHistogramBuckets - 1] = {
+            100ULL, 1000ULL, 10 * 1000ULL, 100 * 1000ULL, 1000 * 1000ULL, 10 * 1000 * 1000ULL
+        };
+
+        LockWaitProfiler lockWaitProfiler;
+
+        struct ByTotalWait {
+            template <typename Entry>
+            bool operator()(const Entry& lhs, const Entry& rhs) const {
+                return lhs.second.totalMicros > rhs.second.totalMicros;
+            }
+        };
+
+        void appendHistogram(BSONArrayBuilder* builder, const uint64_t* histogram) {
+            for (int i = 0; i < LockWaitProfiler::kHistogramBuckets; i++) {
+                builder->append(static_cast<long long>(histogram[i]));
+            }
+        }
+
+    } // namespace
+
+
+    LockWaitProfiler::ResourceWaits::ResourceWaits()
+        : type(RESOURCE_INVALID),
+          count(0),
+          totalMicros(0),
+          maxMicros(0) {
+
+        std::fill(histogram, histogram + kHistogramBuckets, 0);
+    }
+
+    LockWaitProfiler::LockWaitProfiler() : _mutex("LockWaitProfiler") {
+
+    }
+
+    void LockWaitProfiler::recordWait(const ResourceId& resId,
+                                      LockMode mode,
+                                      uint64_t waitMicros) {
+
+        const ResourceType type = resId.getType();
+        const int bucket = histogramBucket(waitMicros);
+
+        _count[type][mode].fetchAndAdd(1);
+        _totalMicros[type][mode].fetchAndAdd(waitMicros);
+        _histogram[type][mode][bucket].fetchAndAdd(1);
+
+        const int sampleRate = lockWaitProfilerSampleRate;
+        if (sampleRate <= 0) return;
+        if (sampleRate > 1 && (_sampleCounter.fetchAndAdd(1) % sampleRate) != 0) return;
+
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        ResourceWaitsMap::iterator it = _resources.find(resId);
+        if (it == _resources.end()) {
+            if (_resources.size() >= kMaxTrackedResources) {
+                _evictLeastContended_inlock();
+            }
+
+            it = _resources.insert(ResourceWaitsMap::value_type(resId, ResourceWaits())).first;
+            it->second.type = type;
+
+            if (_needsName(type)) {
+                _unnamed.fetchAndAdd(1);
+            }
+            else if (type == RESOURCE_GLOBAL || type == RESOURCE_MMAPV1_FLUSH) {
+                // There is only one of each of these
+                it->second.name = resourceTypeName(type);
+            }
+        }
+
+        ResourceWaits& waits = it->second;
+        waits.count++;
+        waits.totalMicros += waitMicros;
+        waits.maxMicros = std::max(waits.maxMicros, waitMicros);
+        waits.histogram[bucket]++;
+    }
+
+    void LockWaitProfiler::nameResource(const ResourceId& resId, const StringData& name) {
+        if (_unnamed.load() == 0) return;
+
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        ResourceWaitsMap::iterator it = _resources.find(resId);
+        if (it == _resources.end() || !it->second.name.empty()) return;
+
+        it->second.name = name.toString();
+        _unnamed.fetchAndSubtract(1);
+    }
+
+    std::string LockWaitProfiler::getResourceName(const ResourceId& resId) const {
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+
+            ResourceWaitsMap::const_iterator it = _resources.find(resId);
+            if (it != _resources.end() && !it->second.name.empty()) {
+                return it->second.name;
+            }
+        }
+
+        return resId.toString();
+    }
+
+    void LockWaitProfiler::appendStats(BSONObjBuilder* builder) const {
+        for (int type = RESOURCE_GLOBAL; type < ResourceTypesCount; type++) {
+            bool any = false;
+            for (int mode = MODE_IS; mode < LockModesCount; mode++) {
+                any = any || (_count[type][mode].loadRelaxed() > 0);
+            }
+
+            if (!any) continue;
+
+            BSONObjBuilder typeBuilder(
+                builder->subobjStart(resourceTypeName(static_cast<ResourceType>(type))));
+
+            BSONObjBuilder countBuilder(typeBuilder.subobjStart("acquireWaitCount"));
+            for (int mode = MODE_IS; mode < LockModesCount; mode++) {
+                const uint64_t count = _count[type][mode].loadRelaxed();
+                if (count == 0) continue;
+
+                countBuilder.append(legacyModeName(static_cast<LockMode>(mode)),
+                                    static_cast<long long>(count));
+            }
+            countBuilder.done();
+
+            BSONObjBuilder timeBuilder(typeBuilder.subobjStart("timeAcquiringMicros"));
+            for (int mode = MODE_IS; mode < LockModesCount; mode++) {
+                if (_count[type][mode].loadRelaxed() == 0) continue;
+
+                timeBuilder.append(legacyModeName(static_cast<LockMode>(mode)),
+                                   static_cast<long long>(_totalMicros[type][mode].loadRelaxed()));
+            }
+            timeBuilder.done();
+
+            BSONObjBuilder histogramBuilder(typeBuilder.subobjStart("waitHistogram"));
+            for (int mode = MODE_IS; mode < LockModesCount; mode++) {
+                if (_count[type][mode].loadRelaxed() == 0) continue;
+
+                uint64_t histogram[kHistogramBuckets];
+                for (int i = 0; i < kHistogramBuckets; i++) {
+                    histogram[i] = _histogram[type][mode][i].loadRelaxed();
+                }
+
+                BSONArrayBuilder modeHistogram(
+                    histogramBuilder.subarrayStart(legacyModeName(static_cast<LockMode>(mode))));
+                appendHistogram(&modeHistogram, histogram);
+                modeHistogram.done();
+            }
+            histogramBuilder.done();
+
+            typeBuilder.done();
+        }
+
+        BSONArrayBuilder boundsBuilder(builder->subarrayStart("waitHistogramBoundsMicros"));
+        for (int i = 0; i < kHistogramBuckets - 1; i++) {
+            boundsBuilder.append(static_cast<long long>(HistogramBoundsMicros[i]));
+        }
+        boundsBuilder.done();
+    }
+
+    void LockWaitProfiler::appendMostContended(BSONArrayBuilder* builder, size_t limit) const {
+        std::vector<std::pair<ResourceId, ResourceWaits> > entries;
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+            entries.assign(_resources.begin(), _resources.end());
+        }
+
+        limit = std::min(limit, entries.size());
+        std::partial_sort(entries.begin(), entries.begin() + limit, entries.end(), ByTotalWait());
+
+        for (size_t i = 0; i < limit; i++) {
+            const ResourceWaits& waits = entries[i].second;
+
+            BSONObjBuilder entryBuilder(builder->subobjStart());
+            entryBuilder.append("resource",
+                                waits.name.empty() ? entries[i].first.toString() : waits.name);
+            entryBuilder.append("type", resourceTypeName(waits.type));
+            entryBuilder.append("waits", static_cast<long long>(waits.count));
+            entryBuilder.append("totalWaitMicros", static_cast<long long>(waits.totalMicros));
+            entryBuilder.append("maxWaitMicros", static_cast<long long>(waits.maxMicros));
+
+            BSONArrayBuilder histogramBuilder(entryBuilder.subarrayStart("waitHistogram"));
+            appendHistogram(&histogramBuilder, waits.histogram);
+            histogramBuilder.done();
+
+            entryBuilder.done();
+        }
+    }
+
+    void LockWaitProfiler::reset() {
+        for (int type = 0; type < ResourceTypesCount; type++) {
+            for (int mode = 0; mode < LockModesCount; mode++) {
+                _count[type][mode].store(0);
+                _totalMicros[type][mode].store(0);
+                for (int i = 0; i < kHistogramBuckets; i++) {
+                    _histogram[type][mode][i].store(0);
+                }
+            }
+        }
+
+        SimpleMutex::scoped_lock lk(_mutex);
+        _resources.clear();
+        _unnamed.store(0);
+    }
+
+    int LockWaitProfiler::histogramBucket(uint64_t waitMicros) {
+        int bucket = 0;
+        while (bucket < kHistogramBuckets - 1 && waitMicros >= HistogramBoundsMicros[bucket]) {
+            bucket++;
+        }
+
+        return bucket;
+    }
+
+    bool LockWaitProfiler::_needsName(ResourceType type) {
+        return type == RESOURCE_DATABASE || type == RESOURCE_COLLECTION;
+    }
+
+    void LockWaitProfiler::_evictLeastContended_inlock() {
+        ResourceWaitsMap::iterator victim = _resources.begin();
+        for (ResourceWaitsMap::iterator it = _resources.begin(); it != _resources.end(); ++it) {
+            if (it->second.totalMicros < victim->second.totalMicros) {
+                victim = it;
+            }
+        }
+
+        if (_needsName(victim->second.type) && victim->second.name.empty()) {
+            _unnamed.fetchAndSubtract(1);
+        }
+
+        _resources.erase(victim);
+    }
+
+    LockWaitProfiler& getLockWaitProfiler() {
+        return lockWaitProfiler;
+    }
+
+} // namespace mongo
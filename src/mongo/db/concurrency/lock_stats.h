@@ -0,0 +1,138 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/db/concurrency/lock_mgr_defs.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    class BSONArrayBuilder;
+    class BSONObjBuilder;
+
+    /**
+     * Collects how long lock acquisitions had to wait, as histograms per resource type and mode
+     * and, sampled, per individual resource, so that the most contended databases and
+     * collections can be reported. Only acquisitions which were not granted right away are
+     * recorded, so none of this is on the uncontended path.
+     *
+     * Resource ids are just hashes, so the names of the databases and collections are supplied
+     * by the callers which know them, through nameResource.
+     */
+    class LockWaitProfiler {
+        MONGO_DISALLOW_COPYING(LockWaitProfiler);
+    public:
+
+        // Wait time histogram buckets: under 100us, 1ms, 10ms, 100ms, 1s, 10s and the rest
+        enum { kHistogramBuckets = 7 };
+
+        // How many individual resources are tracked at most. When this is exceeded, the resource
+        // with the least total wait time is forgotten.
+        enum { kMaxTrackedResources = 1000 };
+
+        LockWaitProfiler();
+
+        /**
+         * Records that an acquisition of resId in the given mode waited for waitMicros before it
+         * was granted, timed out or was found to deadlock.
+         */
+        void recordWait(const ResourceId& resId, LockMode mode, uint64_t waitMicros);
+
+        /**
+         * Names a tracked resource, which has no name yet. Returns right away while no tracked
+         * resource is missing a name, so it can be called on every database or collection lock.
+         */
+        void nameResource(const ResourceId& resId, const StringData& name);
+
+        /**
+         * Returns the name of the resource if it is tracked and has one, or else its id.
+         */
+        std::string getResourceName(const ResourceId& resId) const;
+
+        /**
+         * Appends the wait counts, total wait times, and histograms per resource type and mode of
+         * all resource types with waits, for serverStatus.
+         */
+        void appendStats(BSONObjBuilder* builder) const;
+
+        /**
+         * Appends the tracked resources with the most total wait time, most contended first.
+         */
+        void appendMostContended(BSONArrayBuilder* builder, size_t limit) const;
+
+        /**
+         * Forgets all statistics. Only intended for tests.
+         */
+        void reset();
+
+        static int histogramBucket(uint64_t waitMicros);
+
+    private:
+
+        struct ResourceWaits {
+            ResourceWaits();
+
+            ResourceType type;
+            std::string name;
+            uint64_t count;
+            uint64_t totalMicros;
+            uint64_t maxMicros;
+            uint64_t histogram[kHistogramBuckets];
+        };
+
+        typedef unordered_map<ResourceId, ResourceWaits> ResourceWaitsMap;
+
+        static bool _needsName(ResourceType type);
+
+        void _evictLeastContended_inlock();
+
+        // Unsampled, per resource type and mode
+        AtomicUInt64 _count[ResourceTypesCount][LockModesCount];
+        AtomicUInt64 _totalMicros[ResourceTypesCount][LockModesCount];
+        AtomicUInt64 _histogram[ResourceTypesCount][LockModesCount][kHistogramBuckets];
+
+        // Sampled, per resource
+        AtomicUInt64 _sampleCounter;
+        AtomicUInt32 _unnamed;
+        mutable SimpleMutex _mutex; // protects _resources
+        ResourceWaitsMap _resources;
+    };
+
+    /**
+     * The process-wide lock wait profiler, fed by LockerImpl.
+     */
+    LockWaitProfiler& getLockWaitProfiler();
+
+} // namespace mongo
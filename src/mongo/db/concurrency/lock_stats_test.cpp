@@ -0,0 +1,132 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/concurrency/lock_state.h"
+#include "mongo/db/concurrency/lock_stats.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    TEST(LockWaitProfiler, HistogramBuckets) {
+        ASSERT_EQUALS(0, LockWaitProfiler::histogramBucket(0));
+        ASSERT_EQUALS(0, LockWaitProfiler::histogramBucket(99));
+        ASSERT_EQUALS(1, LockWaitProfiler::histogramBucket(100));
+        ASSERT_EQUALS(2, LockWaitProfiler::histogramBucket(1000));
+        ASSERT_EQUALS(5, LockWaitProfiler::histogramBucket(9999999));
+        ASSERT_EQUALS(6, LockWaitProfiler::histogramBucket(10000000));
+        ASSERT_EQUALS(6, LockWaitProfiler::histogramBucket(1ULL << 40));
+    }
+
+    TEST(LockWaitProfiler, MostContended) {
+        LockWaitProfiler profiler;
+
+        const ResourceId resIdA(RESOURCE_COLLECTION, std::string("TestDB.A"));
+        const ResourceId resIdB(RESOURCE_COLLECTION, std::string("TestDB.B"));
+
+        profiler.recordWait(resIdA, MODE_IX, 50);
+        profiler.recordWait(resIdB, MODE_X, 5000);
+        profiler.recordWait(resIdB, MODE_X, 3000);
+
+        profiler.nameResource(resIdB, "TestDB.B");
+
+        BSONArrayBuilder arrayBuilder;
+        profiler.appendMostContended(&arrayBuilder, 1);
+        const BSONArray mostContended = arrayBuilder.arr();
+
+        ASSERT_EQUALS(1, mostContended.nFields());
+        const BSONObj entry = mostContended["0"].Obj();
+        ASSERT_EQUALS("TestDB.B", entry["resource"].String());
+        ASSERT_EQUALS(2, entry["waits"].numberLong());
+        ASSERT_EQUALS(8000, entry["totalWaitMicros"].numberLong());
+        ASSERT_EQUALS(5000, entry["maxWaitMicros"].numberLong());
+        ASSERT_EQUALS(2, entry["waitHistogram"].Array()[2].numberLong());
+
+        BSONObjBuilder statsBuilder;
+        profiler.appendStats(&statsBuilder);
+        const BSONObj stats = statsBuilder.obj();
+
+        const BSONObj collection = stats["Collection"].Obj();
+        ASSERT_EQUALS(1, collection["acquireWaitCount"]["w"].numberLong());
+        ASSERT_EQUALS(2, collection["acquireWaitCount"]["W"].numberLong());
+        ASSERT_EQUALS(8000, collection["timeAcquiringMicros"]["W"].numberLong());
+        ASSERT(stats["Global"].eoo());
+    }
+
+    TEST(LockWaitProfiler, EvictsLeastContended) {
+        LockWaitProfiler profiler;
+
+        for (int i = 0; i < LockWaitProfiler::kMaxTrackedResources; i++) {
+            profiler.recordWait(ResourceId(RESOURCE_DOCUMENT, 1000 + i), MODE_X, 1000 + i);
+        }
+
+        // Pushes out the resource with the least wait time
+        profiler.recordWait(ResourceId(RESOURCE_DOCUMENT, 1ULL), MODE_X, 5000);
+
+        BSONArrayBuilder arrayBuilder;
+        profiler.appendMostContended(&arrayBuilder, LockWaitProfiler::kMaxTrackedResources + 1);
+        const BSONArray mostContended = arrayBuilder.arr();
+
+        ASSERT_EQUALS(LockWaitProfiler::kMaxTrackedResources, mostContended.nFields());
+        ASSERT_EQUALS(ResourceId(RESOURCE_DOCUMENT, 1ULL).toString(),
+                      mostContended["0"]["resource"].String());
+        ASSERT_EQUALS(1001,
+                      mostContended[LockWaitProfiler::kMaxTrackedResources - 1]["totalWaitMicros"]
+                                   .numberLong());
+    }
+
+    TEST(LockWaitProfiler, LockerWaitStats) {
+        const ResourceId resId(RESOURCE_COLLECTION, std::string("TestDB.collection"));
+
+        MMAPV1LockerImpl locker1(1);
+        ASSERT(LOCK_OK == locker1.lockGlobal(MODE_IX));
+        ASSERT(LOCK_OK == locker1.lock(resId, MODE_X));
+
+        MMAPV1LockerImpl locker2(2);
+        ASSERT(LOCK_OK == locker2.lockGlobal(MODE_IX));
+        ASSERT(LOCK_TIMEOUT == locker2.lock(resId, MODE_S, 10));
+
+        Locker::LockerInfo info;
+        locker2.getLockerInfo(&info);
+        ASSERT_EQUALS(1U, info.waitCount);
+        ASSERT_GREATER_THAN_OR_EQUALS(info.waitMicros, 10000U);
+        ASSERT(resId == info.longestWaitResource);
+        ASSERT_EQUALS(info.waitMicros, info.longestWaitMicros);
+
+        locker1.getLockerInfo(&info);
+        ASSERT_EQUALS(0U, info.waitCount);
+
+        ASSERT(locker1.unlock(resId));
+
+        ASSERT(locker1.unlockAll());
+        ASSERT(locker2.unlockAll());
+    }
+
+} // namespace mongo
@@ -35,6 +35,7 @@
 #include "mongo/bson/bsonobj.h"
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/concurrency/lock_mgr_new.h"
+#include "mongo/util/concurrency/admission_controller.h"
 
 namespace mongo {
     
@@ -76,6 +77,24 @@ namespace mongo {
          */
         virtual LockResult lockGlobal(LockMode mode, unsigned timeoutMs = UINT_MAX) = 0;
 
+        /**
+         * Sets the priority with which the first lockGlobal call waits for admission, when
+         * admission control is enabled (see getAdmissionController).  Internal operations, such
+         * as replication, should be kPriorityHigh.
+         */
+        virtual void setAdmissionPriority(AdmissionController::Priority priority) = 0;
+
+        /**
+         * Sets the point in time, in microseconds since the epoch, past which the Lock:: scoped
+         * types (DBLock, CollectionLock, GlobalRead, GlobalWrite) stop waiting and fail with
+         * ExceededTimeLimit, so operations which have run out of maxTimeMS do not hold up the
+         * requests queued behind them. 0 means no deadline.
+         *
+         * Reacquiring locks after a yield or a temporary release does not obey the deadline.
+         */
+        virtual void setWaitDeadline(uint64_t deadlineMicros) = 0;
+        virtual uint64_t getWaitDeadline() const = 0;
+
         /**
          * Decrements the reference count on the global lock.  If the reference count on the
          * global lock hits zero, the transaction is over, and unlockAll unlocks all other locks.
@@ -169,6 +188,13 @@ namespace mongo {
          */
         virtual ResourceId getWaitingResource() const = 0;
 
+        /**
+         * Returns whether any other operation is blocked, either on one of the locks held by
+         * this locker or on the admission ticket it holds, and so would be able to make progress
+         * if this locker yielded.
+         */
+        virtual bool hasLockWaiters() const = 0;
+
         /**
          * Describes a single lock acquisition for reporting/serialization purposes.
          */
@@ -193,6 +219,16 @@ namespace mongo {
 
             // If isValid(), then what lock this particular locker is sleeping on
             ResourceId waitingResource;
+
+            // How many of the lock acquisitions of this locker had to wait and for how long in
+            // total, and which resource it waited for the longest
+            uint64_t waitCount;
+            uint64_t waitMicros;
+            ResourceId longestWaitResource;
+            uint64_t longestWaitMicros;
+
+            // How long this locker waited for admission tickets before taking the global lock
+            uint64_t admissionWaitMicros;
         };
 
         virtual void getLockerInfo(LockerInfo* lockerInfo) const = 0;
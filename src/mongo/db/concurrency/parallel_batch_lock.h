@@ -0,0 +1,73 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/util/concurrency/fair_rwlock.h"
+
+namespace mongo {
+
+    /**
+     * The lock, which secondaries hold exclusively while applying a batch of replicated
+     * operations (see Lock::ParallelBatchWriterMode) and everybody else holds shared, so that no
+     * reader observes a partially applied batch.
+     */
+    FairRWLock& getParallelBatchWriterLock();
+
+    /**
+     * Shared hold of the parallel batch writer lock by a reader on a storage engine, which reads
+     * from point-in-time snapshots. Such a reader only needs the lock until it has established
+     * its snapshot, as from there on it does not observe the batches applied after it. The engine
+     * signals this through parallelBatchSnapshotEstablished, which drops all the holds of the
+     * thread, so the next batch does not have to wait for the reader to finish.
+     */
+    class ParallelBatchSnapshotReadLock {
+        MONGO_DISALLOW_COPYING(ParallelBatchSnapshotReadLock);
+    public:
+        ParallelBatchSnapshotReadLock();
+        ~ParallelBatchSnapshotReadLock();
+
+    private:
+        friend void parallelBatchSnapshotEstablished();
+
+        boost::scoped_ptr<FairRWLock::Shared> _lk;
+
+        // Next older hold of the same thread
+        ParallelBatchSnapshotReadLock* _next;
+    };
+
+    /**
+     * Called by storage engines, which read from snapshots, after they have established a new
+     * snapshot. Releases the ParallelBatchSnapshotReadLocks of the calling thread, if any.
+     */
+    void parallelBatchSnapshotEstablished();
+
+} // namespace mongo
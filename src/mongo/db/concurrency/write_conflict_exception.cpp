@@ -0,0 +1,162 @@
+// write_conflict_exception.cpp
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kWrites
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/concurrency/write_conflict_exception.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/random.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    // A write retries this many conflicts at once; after that it sleeps first, for a time which
+    // doubles every attempt up to writeConflictMaxBackoffMillis.
+    MONGO_EXPORT_SERVER_PARAMETER(writeConflictRetriesWithoutBackoff, int, 3);
+    MONGO_EXPORT_SERVER_PARAMETER(writeConflictMaxBackoffMillis, int, 100);
+
+    // After this many conflicts a write which can retries under an exclusive collection lock.
+    // 0 never escalates.
+    MONGO_EXPORT_SERVER_PARAMETER(writeConflictEscalateAfter, int, 0);
+
+namespace {
+
+    AtomicUInt64 totalConflicts;
+    AtomicUInt64 totalEscalations;
+
+    // Namespaces past the first kMaxNamespaces to conflict are counted together.
+    const size_t kMaxNamespaces = 1000;
+
+    SimpleMutex namespaceConflictsMutex( "writeConflicts" );
+    typedef std::map<std::string, long long> NamespaceConflicts;
+    NamespaceConflicts namespaceConflicts;
+    long long otherNamespaceConflicts = 0;
+
+    void countConflict( const StringData& ns ) {
+        totalConflicts.fetchAndAdd( 1 );
+
+        SimpleMutex::scoped_lock lk( namespaceConflictsMutex );
+        const std::string nsString = ns.toString();
+        NamespaceConflicts::iterator it = namespaceConflicts.find( nsString );
+        if ( it != namespaceConflicts.end() )
+            it->second++;
+        else if ( namespaceConflicts.size() < kMaxNamespaces )
+            namespaceConflicts[nsString] = 1;
+        else
+            otherNamespaceConflicts++;
+    }
+
+    class WriteConflictServerStatusSection : public ServerStatusSection {
+    public:
+        WriteConflictServerStatusSection() : ServerStatusSection( "writeConflicts" ) { }
+
+        virtual bool includeByDefault() const { return true; }
+
+        BSONObj generateSection( const BSONElement& configElement ) const {
+            BSONObjBuilder b;
+            b.appendNumber( "total", static_cast<long long>( totalConflicts.load() ) );
+            b.appendNumber( "escalations", static_cast<long long>( totalEscalations.load() ) );
+
+            BSONObjBuilder namespaces( b.subobjStart( "namespaces" ) );
+            SimpleMutex::scoped_lock lk( namespaceConflictsMutex );
+            for ( NamespaceConflicts::const_iterator it = namespaceConflicts.begin();
+                  it != namespaceConflicts.end(); ++it ) {
+                namespaces.appendNumber( it->first, it->second );
+            }
+            if ( otherNamespaceConflicts )
+                namespaces.appendNumber( "<other>", otherNamespaceConflicts );
+            namespaces.done();
+
+            return b.obj();
+        }
+
+    } writeConflictServerStatusSection;
+
+} // namespace
+
+    // static
+    void WriteConflictException::logAndBackoff( OperationContext* txn,
+                                                int attempt,
+                                                const StringData& operation,
+                                                const StringData& ns ) {
+        countConflict( ns );
+
+        if ( txn && txn->getCurOp() ) {
+            OpDebug& debug = txn->getCurOp()->debug();
+            debug.writeConflicts = std::max( debug.writeConflicts, 0 ) + 1;
+        }
+
+        // Every power of two, so that a write which keeps conflicting doesn't flood the log.
+        if ( attempt > 1 && ( attempt & ( attempt - 1 ) ) == 0 ) {
+            log() << "Had WriteConflict doing " << operation << " on " << ns
+                  << ", attempt: " << attempt << " retrying";
+        }
+
+        const int backoffs = attempt - writeConflictRetriesWithoutBackoff;
+        if ( backoffs <= 0 )
+            return;
+
+        const long long maxMicros = writeConflictMaxBackoffMillis * 1000LL;
+        const long long micros = std::min( 1000LL << std::min( backoffs - 1, 20 ), maxMicros );
+        if ( micros <= 0 )
+            return;
+
+        // Sleep somewhere between half and all of the backoff, so that writers which conflicted
+        // with each other don't all wake up together.
+        PseudoRandom random( static_cast<int64_t>( curTimeMicros64() ^
+                                                   reinterpret_cast<uintptr_t>( txn ) ) );
+        const uint64_t jitter = static_cast<uint64_t>( random.nextInt64() ) % ( micros / 2 + 1 );
+        sleepmicros( micros / 2 + jitter );
+    }
+
+    // static
+    bool WriteConflictException::shouldEscalate( int attempt ) {
+        const int escalateAfter = writeConflictEscalateAfter;
+        if ( escalateAfter <= 0 || attempt < escalateAfter )
+            return false;
+        if ( attempt == escalateAfter )
+            totalEscalations.fetchAndAdd( 1 );
+        return true;
+    }
+
+} // namespace mongo
@@ -32,10 +32,13 @@
 
 #include <exception>
 
+#include "mongo/base/string_data.h"
 #include "mongo/util/assert_util.h"
 
 namespace mongo {
 
+    class OperationContext;
+
     /**
      * This is thrown if during a write, two or more operations conflict with each other.
      * For example if two operations get the same version of a document, and then both try to
@@ -44,6 +47,25 @@ namespace mongo {
     class WriteConflictException : public DBException {
     public:
         WriteConflictException() : DBException( "WriteConflict", ErrorCodes::WriteConflict ){}
+
+        /**
+         * A write which caught a WriteConflictException calls this before it retries.  The
+         * conflict is counted against the operation and its namespace, and the write sleeps for
+         * a backoff which doubles with every attempt, with jitter, so that the writers of a hot
+         * document stop colliding in lockstep.
+         *
+         * @param attempt how many times this write has conflicted, counting from 1
+         */
+        static void logAndBackoff( OperationContext* txn,
+                                   int attempt,
+                                   const StringData& operation,
+                                   const StringData& ns );
+
+        /**
+         * @return true if a write which has conflicted attempt times should retry holding its
+         *         collection exclusively, so that no other write can conflict with it.
+         */
+        static bool shouldEscalate( int attempt );
     };
 
 }
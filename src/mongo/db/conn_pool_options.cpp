@@ -37,6 +37,8 @@ namespace mongo {
 
     int ConnPoolOptions::maxConnsPerHost(200);
     int ConnPoolOptions::maxShardedConnsPerHost(200);
+    int ConnPoolOptions::minIdleConnsPerHost(0);
+    int ConnPoolOptions::minIdleShardedConnsPerHost(0);
 
     namespace {
 
@@ -54,6 +56,20 @@ namespace mongo {
                                         true,
                                         false /* can't change at runtime */);
 
+        ExportedServerParameter<int> //
+        minIdleConnsPerHostParameter(ServerParameterSet::getGlobal(),
+                                     "connPoolMinIdleConnsPerHost",
+                                     &ConnPoolOptions::minIdleConnsPerHost,
+                                     true,
+                                     false /* can't change at runtime */);
+
+        ExportedServerParameter<int> //
+        minIdleShardedConnsPerHostParameter(ServerParameterSet::getGlobal(),
+                                            "connPoolMinIdleShardedConnsPerHost",
+                                            &ConnPoolOptions::minIdleShardedConnsPerHost,
+                                            true,
+                                            false /* can't change at runtime */);
+
         MONGO_INITIALIZER(InitializeConnectionPools)(InitializerContext* context) {
 
             // Initialize the sharded and unsharded outgoing connection pools
@@ -64,9 +80,11 @@ namespace mongo {
 
             pool.setName("connection pool");
             pool.setMaxPoolSize(ConnPoolOptions::maxConnsPerHost);
+            pool.setMinIdlePoolSize(ConnPoolOptions::minIdleConnsPerHost);
 
             shardConnectionPool.setName("sharded connection pool");
             shardConnectionPool.setMaxPoolSize(ConnPoolOptions::maxShardedConnsPerHost);
+            shardConnectionPool.setMinIdlePoolSize(ConnPoolOptions::minIdleShardedConnsPerHost);
 
             return Status::OK();
         }
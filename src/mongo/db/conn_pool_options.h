@@ -49,6 +49,16 @@ namespace mongo {
          * Maximum connections per host the sharded conn pool should use
          */
         static int maxShardedConnsPerHost;
+
+        /**
+         * Idle connections per host the connection pool keeps warm, 0 for none
+         */
+        static int minIdleConnsPerHost;
+
+        /**
+         * Idle connections per host the sharded conn pool keeps warm, 0 for none
+         */
+        static int minIdleShardedConnsPerHost;
     };
 
 }
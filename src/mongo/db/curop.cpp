@@ -57,7 +57,9 @@ namespace mongo {
 
     CurOp::CurOp( Client * client , CurOp * wrapped ) :
         _client(client),
-        _wrapped(wrapped)
+        _wrapped(wrapped),
+        _memoryTracker(wrapped ? &wrapped->_memoryTracker : NULL,
+                       OperationMemoryTracker::kOperation)
     {
         if ( _wrapped )
             _client->_curOp = this;
@@ -77,6 +79,8 @@ namespace mongo {
         _maxTimeTracker.reset();
         _message = "";
         _progressMeter.finished();
+        _externalSortStats.reset();
+        _memoryTracker.reset();
         _killPending.store(0);
         _numYields = 0;
         _expectedLatencyMs = 0;
@@ -121,7 +125,7 @@ namespace mongo {
 
     CurOp::~CurOp() {
         if ( _wrapped ) {
-            scoped_lock bl(Client::clientsMutex);
+            scoped_lock bl(_client->registryMutex());
             _client->_curOp = _wrapped;
         }
         _client = 0;
@@ -202,10 +206,26 @@ namespace mongo {
             }
         }
 
+        if ( _externalSortStats.have() ) {
+            _externalSortStats.append( *builder , "externalSort" );
+        }
+
         if( killPending() )
             builder->append("killPending", true);
 
         builder->append( "numYields" , _numYields );
+
+        if ( _memoryTracker.peakBytes() ) {
+            BSONObjBuilder memoryBuilder( builder->subobjStart( "memory" ) );
+            memoryBuilder.appendNumber( "bytes" , _memoryTracker.bytes() );
+            memoryBuilder.appendNumber( "peakBytes" , _memoryTracker.peakBytes() );
+            memoryBuilder.done();
+        }
+
+        // Lock and ticket waits are reported by the operation's locker
+        BSONObjBuilder waitsBuilder( builder->subobjStart( "waits" ) );
+        _debug.appendWaits( waitsBuilder );
+        waitsBuilder.done();
     }
 
     BSONObj CurOp::description() {
@@ -264,6 +284,13 @@ namespace mongo {
         return _maxTimeTracker.getRemainingMicros();
     }
 
+    uint64_t CurOp::getMaxTimeDeadlineMicros() {
+        if (_maxTimeMicros == 0 || MONGO_FAIL_POINT(maxTimeNeverTimeOut)) {
+            return 0;
+        }
+        return (isStarted() ? startTime() : curTimeMicros64()) + _maxTimeMicros;
+    }
+
     AtomicUInt32 CurOp::_nextOpNum;
 
     static Counter64 returnedCounter;
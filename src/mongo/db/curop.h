@@ -31,7 +31,10 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include "mongo/db/client.h"
+#include "mongo/db/operation_memory_tracker.h"
 #include "mongo/db/server_options.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/util/concurrency/spin_lock.h"
@@ -143,6 +146,17 @@ namespace mongo {
          */
         bool append(const CurOp& curop, BSONObjBuilder& builder, size_t maxSize) const;
 
+        /**
+         * Appends the wait counters which the operation updates while it runs, for currentOp.
+         */
+        void appendWaits(BSONObjBuilder& builder) const;
+
+        /**
+         * Adds 'amount' to one of the counters below which are -1 until something is counted.
+         */
+        template <typename T>
+        static void addTo(T* counter, T amount) { *counter = std::max(*counter, T(0)) + amount; }
+
         // -------------------
         
         StringBuilder extra; // weird things we need to fix later
@@ -174,6 +188,16 @@ namespace mongo {
         bool fastmodinsert;  // upsert of an $operation. builds a default object
         bool upsert;         // true if the update actually did an insert
         int keyUpdates;
+        long long builderAllocs; // buffers drawn from the operation's BufBuilderArena
+        long long builderAllocsReused; // of those, recycled rather than malloc'd
+        int writeConflicts;  // times the write conflicted and was retried
+        long long evictionWaitMicros; // writes held back for the storage cache to be evicted
+        long long lockWaitMicros;     // waiting to acquire locks
+        long long ticketWaitMicros;   // waiting for an admission ticket before the global lock
+        long long yieldMicros;        // spent yielded, locks released, see CurOp::numYields
+        int fetches;                  // records paged in while yielded (RecordFetcher)
+        long long fetchMicros;        // of the yielded time, spent paging them in
+        long long writeConcernMicros; // waiting for the write concern to be satisfied
         ThreadSafeString planSummary; // a brief std::string describing the query solution
 
         // New Query Framework debugging/profiling info
@@ -250,6 +274,13 @@ namespace mongo {
          */
         uint64_t getRemainingMaxTimeMicros() const;
 
+        /**
+         * Returns when this operation's time limit is hit, in microseconds since the epoch, or 0
+         * if it has no time limit. Counts from now if the operation has not started yet. Used as
+         * the deadline for lock waits (see Locker::setWaitDeadline).
+         */
+        uint64_t getMaxTimeDeadlineMicros();
+
         //
         // Methods for getting/setting elapsed time.
         //
@@ -301,6 +332,18 @@ namespace mongo {
                                   int secondsBetween = 3);
         std::string getMessage() const { return _message.toString(); }
         ProgressMeter& getProgressMeter() { return _progressMeter; }
+
+        /**
+         * Sets what the external sorts of this operation have spilled to disk so far, reported
+         * as "externalSort" by currentOp.
+         */
+        void setExternalSortStats(const BSONObj& stats) { _externalSortStats.set(stats); }
+
+        /**
+         * What the stages of this operation buffer, reported as "memory" by currentOp.  It
+         * counts towards the tracker of the operation this one is nested in, if any.
+         */
+        OperationMemoryTracker& memoryTracker() { return _memoryTracker; }
         CurOp *parent() const { return _wrapped; }
         void kill(); 
         bool killPendingStrict() const { return _killPending.load(); }
@@ -341,6 +384,8 @@ namespace mongo {
         OpDebug _debug;
         ThreadSafeString _message;
         ProgressMeter _progressMeter;
+        CachedBSONObj<256> _externalSortStats;
+        OperationMemoryTracker _memoryTracker;
         AtomicInt32 _killPending;
         int _numYields;
         
@@ -39,6 +39,7 @@
 #include "mongo/db/client.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/commands/fsync.h"
+#include "mongo/db/concurrency/lock_stats.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/global_environment_experiment.h"
@@ -65,6 +66,9 @@ namespace {
         }
 
         virtual void processOpContext(OperationContext* txn) {
+            // Keeps the CurOp from being destroyed from underneath, see ~CurOp
+            scoped_lock bl(txn->getClient()->registryMutex());
+
             if (!txn->getCurOp() || !txn->getCurOp()->active()) {
                 return;
             }
@@ -93,6 +97,39 @@ namespace {
         BSONArrayBuilder& _builder;
     };
 
+    /**
+     * Populates the BSON array with information about all clients on the server, whether they
+     * have an operation running or not.
+     */
+    class ClientInfoPopulator : public Client::ClientProcessor {
+    public:
+
+        ClientInfoPopulator(Client* self, BSONArrayBuilder& builder)
+            : _self(self),
+              _builder(builder) {
+
+        }
+
+        virtual void processClient(Client* client) {
+            invariant(client);
+
+            CurOp* curop = client->curop();
+            if ((client == _self) && !curop) {
+                return;
+            }
+
+            BSONObjBuilder infoBuilder;
+            client->reportState(infoBuilder);
+            infoBuilder.done();
+
+            _builder.append(infoBuilder.obj());
+        }
+
+    private:
+        Client* const _self;
+        BSONArrayBuilder& _builder;
+    };
+
 
     void inProgCmd(OperationContext* txn, Message &message, DbResponse &dbresponse) {
         DbMessage d(message);
@@ -116,33 +153,12 @@ namespace {
 
         BSONArrayBuilder inprogBuilder(retVal.subarrayStart("inprog"));
 
-        // This lock is acquired for both cases (whether we iterate through the clients list or
-        // through the OperationContexts), because we want the CurOp to not be destroyed from
-        // underneath and ~CurOp synchronizes on the clients mutex.
-        //
-        // TODO: This is a legacy from 2.6, which needs to be fixed.
-        scoped_lock bl(Client::clientsMutex);
-
+        // Neither walk blocks clients from connecting or disconnecting for its whole duration.
+        // The CurOps reported are kept alive by holding the registry mutex of their client.
         const bool all = q.query["$all"].trueValue();
         if (all) {
-            for (std::set<Client*>::const_iterator i = Client::clients.begin();
-                 i != Client::clients.end();
-                 i++) {
-
-                Client* client = *i;
-                invariant(client);
-
-                CurOp* curop = client->curop();
-                if ((client == txn->getClient()) && !curop) {
-                    continue;
-                }
-
-                BSONObjBuilder infoBuilder;
-                client->reportState(infoBuilder);
-                infoBuilder.done();
-
-                inprogBuilder.append(infoBuilder.obj());
-            }
+            ClientInfoPopulator allClients(txn->getClient(), inprogBuilder);
+            Client::forEachClient(&allClients);
         }
         else {
 
@@ -172,6 +188,11 @@ namespace {
 
         inprogBuilder.done();
 
+        // The resources with the most lock wait time since startup
+        BSONArrayBuilder contendedBuilder(retVal.subarrayStart("contendedLocks"));
+        getLockWaitProfiler().appendMostContended(&contendedBuilder, 10);
+        contendedBuilder.done();
+
         if (lockedForWriting()) {
             retVal.append("fsyncLock", true);
             retVal.append("info",
@@ -203,7 +224,18 @@ namespace {
 
         // "lockStats" section
         BSONObjBuilder lockStats(infoBuilder.subobjStart("lockStats"));
-        // TODO: When we implement lock stats tracking
+        lockStats.append("acquireWaitCount", static_cast<long long>(lockerInfo.waitCount));
+        lockStats.append("timeAcquiringMicros", static_cast<long long>(lockerInfo.waitMicros));
+        lockStats.append("timeAcquiringTicketMicros",
+                         static_cast<long long>(lockerInfo.admissionWaitMicros));
+        if (lockerInfo.longestWaitResource.isValid()) {
+            BSONObjBuilder longestWait(lockStats.subobjStart("longestWait"));
+            longestWait.append("resource",
+                               getLockWaitProfiler().getResourceName(
+                                                        lockerInfo.longestWaitResource));
+            longestWait.append("micros", static_cast<long long>(lockerInfo.longestWaitMicros));
+            longestWait.done();
+        }
         lockStats.done();
     }
 
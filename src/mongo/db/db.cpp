@@ -44,18 +44,23 @@
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
 #include "mongo/db/auth/authz_manager_external_state_d.h"
+#include "mongo/db/catalog/collection_catalog_entry.h"
 #include "mongo/db/catalog/database_catalog_entry.h"
 #include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/catalog/index_key_validate.h"
+#include "mongo/db/catalog_warmer.h"
 #include "mongo/db/client.h"
 #include "mongo/db/clientcursor.h"
+#include "mongo/db/commands/copydb_start_commands.h"
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/db.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/dbwebserver.h"
+#include "mongo/db/ftdc/ftdc_controller.h"
 #include "mongo/db/global_environment_d.h"
 #include "mongo/db/global_environment_experiment.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/index_names.h"
 #include "mongo/db/index_rebuilder.h"
 #include "mongo/db/initialize_server_global_state.h"
@@ -65,7 +70,10 @@
 #include "mongo/db/log_process_details.h"
 #include "mongo/db/mongod_options.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/op_sampler.h"
+#include "mongo/db/plan_cache_persister.h"
 #include "mongo/db/query/internal_plans.h"
+#include "mongo/db/query/new_find.h"
 #include "mongo/db/range_deleter_service.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/repl/repl_settings.h"
@@ -79,6 +87,7 @@
 #include "mongo/db/storage_options.h"
 #include "mongo/db/ttl.h"
 #include "mongo/platform/process_id.h"
+#include "mongo/s/d_state.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/cmdline_utils/censor_cmdline.h"
 #include "mongo/util/concurrency/task.h"
@@ -89,6 +98,7 @@
 #include "mongo/util/net/message_server.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/ntservice.h"
+#include "mongo/util/numa_placement.h"
 #include "mongo/util/options_parser/startup_options.h"
 #include "mongo/util/quick_exit.h"
 #include "mongo/util/ramlog.h"
@@ -122,6 +132,9 @@ namespace mongo {
 
     Timer startupSrandTimer;
 
+    // Bind threads to NUMA nodes and interleave shared memory; see NumaPlacement.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(numaPlacement, bool, false);
+
     QueryResult::View emptyMoreResult(long long);
 
 
@@ -165,6 +178,33 @@ namespace mongo {
     };
 #endif
 
+    /**
+     * The thread-local objects which belong to a client connection rather than to the thread
+     * servicing it, held while the connection waits for its next request.
+     */
+    class ConnectionThreadState : public MessageHandler::ThreadState {
+    public:
+        /** Takes the objects away from the calling thread. */
+        ConnectionThreadState()
+            : _client(currentClient.release()),
+              _shardedConnectionInfo(ShardedConnectionInfo::release()),
+              _authConn(authConn_.release()) {
+        }
+
+        /** Gives the objects to the calling thread. */
+        void attach() {
+            invariant(!currentClient.get());
+            currentClient.reset(_client.release());
+            ShardedConnectionInfo::attach(_shardedConnectionInfo.release());
+            authConn_.reset(_authConn.release());
+        }
+
+    private:
+        std::auto_ptr<Client> _client;
+        std::auto_ptr<ShardedConnectionInfo> _shardedConnectionInfo;
+        std::auto_ptr<DBClientBase> _authConn;
+    };
+
     class MyMessageHandler : public MessageHandler {
     public:
         virtual void connected( AbstractMessagingPort* p ) {
@@ -209,6 +249,15 @@ namespace mongo {
                             continue; // this goes back to top loop
                         }
                     }
+                    else if ( !dbresponse.readAheadNS.empty() ) {
+                        // The client is busy with the reply; get its next batch ready.
+                        QueryResult::View qr = dbresponse.response->header().view2ptr();
+                        long long cursorid = qr.getCursorId();
+                        if ( cursorid ) {
+                            readAheadCursor( txn.get(), port->remote(),
+                                             dbresponse.readAheadNS, cursorid );
+                        }
+                    }
                 }
                 break;
             }
@@ -219,6 +268,17 @@ namespace mongo {
             if( c ) c->shutdown();
         }
 
+        virtual bool canDetach() const { return true; }
+
+        virtual ThreadState* detach( AbstractMessagingPort* p ) {
+            return new ConnectionThreadState();
+        }
+
+        virtual void attach( AbstractMessagingPort* p , ThreadState* state ) {
+            boost::scoped_ptr<ThreadState> holder( state );
+            static_cast<ConnectionThreadState*>( state )->attach();
+        }
+
     };
 
     static void logStartup() {
@@ -252,6 +312,25 @@ namespace mongo {
         c.insert( name, o);
     }
 
+    /**
+     * Reads the index specs from the catalog rather than opening the collections, which is left
+     * to their first use and to the catalog warmer.
+     */
+    static bool hasIdIndex(OperationContext* txn, const CollectionCatalogEntry* coll) {
+        std::vector<std::string> indexNames;
+        coll->getAllIndexes(txn, &indexNames);
+        for (size_t i = 0; i < indexNames.size(); i++) {
+            if (!coll->isIndexReady(txn, indexNames[i])) {
+                continue;
+            }
+            const BSONObj spec = coll->getIndexSpec(txn, indexNames[i]);
+            if (IndexDescriptor::isIdIndexPattern(spec.getObjectField("key"))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     static void checkForIdIndexes(OperationContext* txn, Database* db) {
         if ( db->name() == "local") {
             // we do not need an _id index on anything in the local database
@@ -268,11 +347,12 @@ namespace mongo {
             if ( ns.isSystem() )
                 continue;
 
-            Collection* coll = db->getCollection( txn, collectionName );
+            const CollectionCatalogEntry* coll =
+                db->getDatabaseCatalogEntry()->getCollectionCatalogEntry( txn, collectionName );
             if ( !coll )
                 continue;
 
-            if ( coll->getIndexCatalog()->findIdIndex( txn ) )
+            if ( hasIdIndex( txn, coll ) )
                 continue;
 
             log() << "WARNING: the collection '" << *i
@@ -423,6 +503,12 @@ namespace mongo {
         }
 
         DEV log(LogComponent::kControl) << "_DEBUG build (which is slower)" << endl;
+
+        // Before the storage engine allocates its caches, so that they are interleaved.
+        if (numaPlacement) {
+            NumaPlacement::enable();
+        }
+
         logMongodStartupWarnings();
 
 #if defined(_WIN32)
@@ -549,6 +635,11 @@ namespace mongo {
                 startTTLBackgroundJob();
             }
 
+            startPlanCachePersisterBackgroundJob();
+            startCatalogWarmerBackgroundJob();
+            startOpSampleFlusherBackgroundJob();
+            startDiagnosticDataCaptureBackgroundJob();
+
 #ifndef _WIN32
         mongo::signalForkSuccess();
 #endif
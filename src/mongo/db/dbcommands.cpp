@@ -1356,6 +1356,7 @@ namespace mongo {
 
         txn->getCurOp()->setMaxTimeMicros(static_cast<unsigned long long>(maxTimeMS.getValue())
                                           * 1000);
+        txn->lockState()->setWaitDeadline(txn->getCurOp()->getMaxTimeDeadlineMicros());
         try {
             txn->checkForInterrupt(); // May trigger maxTimeAlwaysTimeOut fail point.
         }
@@ -36,6 +36,7 @@
 
 #include <boost/filesystem/convenience.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <algorithm>
 #include <fstream>
 
 #include "mongo/client/dbclientinterface.h"
@@ -55,6 +56,7 @@
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/db/write_concern_options.h"
 #include "mongo/db/operation_context_impl.h"
@@ -70,6 +72,14 @@ namespace mongo {
 
     const BSONObj reverseNaturalObj = BSON( "$natural" << -1 );
 
+    // Number of documents removeRange deletes per write lock acquisition. Their index keys
+    // are removed in sorted batches, one index at a time.
+    MONGO_EXPORT_SERVER_PARAMETER(rangeDeleterBatchSize, int, 128);
+
+    // Upper bound on the rate at which removeRange deletes documents, 0 for no limit. Lets
+    // migration cleanup run in the background without starving user writes.
+    MONGO_EXPORT_SERVER_PARAMETER(rangeDeleterMaxDocsPerSecond, int, 0);
+
     void Helpers::ensureIndex(OperationContext* txn,
                               Collection* collection,
                               BSONObj keyPattern,
@@ -369,7 +379,13 @@ namespace mongo {
         
         long long millisWaitingForReplication = 0;
 
-        while ( 1 ) {
+        const size_t batchSize = std::max(1, rangeDeleterBatchSize);
+
+        bool done = false;
+        while ( !done ) {
+            Timer batchTimer;
+            size_t batchDeleted = 0;
+
             // Scoping for write lock.
             {
                 Client::WriteContext ctx(txn, ns);
@@ -381,86 +397,105 @@ namespace mongo {
                     collection->getIndexCatalog()->findIndexByKeyPattern( txn,
                                                                           indexKeyPattern.toBSON() );
 
+                // The batch is collected without yielding, so that the locations stay valid
+                // until they are deleted below.
                 auto_ptr<PlanExecutor> exec(InternalPlanner::indexScan(txn, collection, desc,
                                                                        min, max,
                                                                        maxInclusive,
                                                                        InternalPlanner::FORWARD,
                                                                        InternalPlanner::IXSCAN_FETCH));
-                exec->setYieldPolicy(PlanExecutor::YIELD_AUTO);
-
-                DiskLoc rloc;
-                BSONObj obj;
-                PlanExecutor::ExecState state;
-                // This may yield so we cannot touch nsd after this.
-                state = exec->getNext(&obj, &rloc);
-                exec.reset();
-                if (PlanExecutor::IS_EOF == state) { break; }
-
-                if (PlanExecutor::DEAD == state) {
-                    warning(LogComponent::kSharding) << "cursor died: aborting deletion for "
-                              << min << " to " << max << " in " << ns
-                              << endl;
-                    break;
-                }
-
-                if (PlanExecutor::EXEC_ERROR == state) {
-                    warning(LogComponent::kSharding) << "cursor error while trying to delete "
-                              << min << " to " << max
-                              << " in " << ns << ": "
-                              << WorkingSetCommon::toStatusString(obj) << endl;
-                    break;
-                }
-
-                verify(PlanExecutor::ADVANCED == state);
-
-                WriteUnitOfWork wuow(txn);
 
+                // In write lock, so will be the most up-to-date version
+                CollectionMetadataPtr metadataNow;
                 if ( onlyRemoveOrphanedDocs ) {
-                    // Do a final check in the write lock to make absolutely sure that our
-                    // collection hasn't been modified in a way that invalidates our migration
-                    // cleanup.
-
                     // We should never be able to turn off the sharding state once enabled, but
                     // in the future we might want to.
                     verify(shardingState.enabled());
+                    metadataNow = shardingState.getCollectionMetadata( ns );
+                }
 
-                    // In write lock, so will be the most up-to-date version
-                    CollectionMetadataPtr metadataNow = shardingState.getCollectionMetadata( ns );
-
-                    bool docIsOrphan;
-                    if ( metadataNow ) {
-                        ShardKeyPattern kp( metadataNow->getKeyPattern() );
-                        BSONObj key = kp.extractShardKeyFromDoc(obj);
-                        docIsOrphan = !metadataNow->keyBelongsToMe( key )
-                            && !metadataNow->keyIsPending( key );
+                vector<DiskLoc> locs;
+                while ( locs.size() < batchSize ) {
+                    DiskLoc rloc;
+                    BSONObj obj;
+                    PlanExecutor::ExecState state = exec->getNext(&obj, &rloc);
+                    if (PlanExecutor::IS_EOF == state) {
+                        done = true;
+                        break;
                     }
-                    else {
-                        docIsOrphan = false;
+
+                    if (PlanExecutor::DEAD == state) {
+                        warning(LogComponent::kSharding) << "cursor died: aborting deletion for "
+                                  << min << " to " << max << " in " << ns
+                                  << endl;
+                        done = true;
+                        break;
                     }
 
-                    if ( !docIsOrphan ) {
-                        warning(LogComponent::kSharding)
-                                  << "aborting migration cleanup for chunk " << min << " to " << max
-                                  << ( metadataNow ? (string) " at document " + obj.toString() : "" )
-                                  << ", collection " << ns << " has changed " << endl;
+                    if (PlanExecutor::EXEC_ERROR == state) {
+                        warning(LogComponent::kSharding) << "cursor error while trying to delete "
+                                  << min << " to " << max
+                                  << " in " << ns << ": "
+                                  << WorkingSetCommon::toStatusString(obj) << endl;
+                        done = true;
                         break;
                     }
+
+                    verify(PlanExecutor::ADVANCED == state);
+
+                    if ( onlyRemoveOrphanedDocs ) {
+                        // Do a final check in the write lock to make absolutely sure that our
+                        // collection hasn't been modified in a way that invalidates our migration
+                        // cleanup.
+                        bool docIsOrphan;
+                        if ( metadataNow ) {
+                            ShardKeyPattern kp( metadataNow->getKeyPattern() );
+                            BSONObj key = kp.extractShardKeyFromDoc(obj);
+                            docIsOrphan = !metadataNow->keyBelongsToMe( key )
+                                && !metadataNow->keyIsPending( key );
+                        }
+                        else {
+                            docIsOrphan = false;
+                        }
+
+                        if ( !docIsOrphan ) {
+                            warning(LogComponent::kSharding)
+                                      << "aborting migration cleanup for chunk " << min << " to " << max
+                                      << ( metadataNow ? (string) " at document " + obj.toString() : "" )
+                                      << ", collection " << ns << " has changed " << endl;
+                            done = true;
+                            break;
+                        }
+                    }
+                    if ( callback )
+                        callback->goingToDelete( obj );
+
+                    locs.push_back( rloc );
+                }
+                exec.reset();
+
+                if ( !locs.empty() ) {
+                    // Delete in record order rather than shard key order, so that the record
+                    // store is written sequentially.
+                    std::sort( locs.begin(), locs.end() );
+
+                    WriteUnitOfWork wuow(txn);
+                    vector<BSONObj> deletedIds;
+                    collection->deleteDocuments( txn, locs, false, &deletedIds );
+                    // The above throws on failure, and so is not logged
+                    for ( size_t i = 0; i < deletedIds.size(); ++i ) {
+                        repl::logOp(txn, "d", ns.c_str(), deletedIds[i], 0, 0, fromMigrate);
+                    }
+                    wuow.commit();
+                    batchDeleted = locs.size();
+                    numDeleted += batchDeleted;
                 }
-                if ( callback )
-                    callback->goingToDelete( obj );
-
-                BSONObj deletedId;
-                collection->deleteDocument( txn, rloc, false, false, &deletedId );
-                // The above throws on failure, and so is not logged
-                repl::logOp(txn, "d", ns.c_str(), deletedId, 0, 0, fromMigrate);
-                wuow.commit();
-                numDeleted++;
             }
 
-            // TODO remove once the yielding below that references this timer has been removed
-            Timer secondaryThrottleTime;
+            if ( batchDeleted == 0 )
+                break;
 
-            if (writeConcern.shouldWaitForOtherNodes() && numDeleted > 0) {
+            if (writeConcern.shouldWaitForOtherNodes()) {
                 repl::ReplicationCoordinator::StatusAndDuration replStatus =
                         repl::getGlobalReplicationCoordinator()->awaitReplication(txn,
                                                                                   txn->getClient()->getLastOp(),
@@ -475,6 +510,17 @@ namespace mongo {
                 }
                 millisWaitingForReplication += replStatus.duration.total_milliseconds();
             }
+
+            // Stay under the configured delete rate, sleeping outside of the lock so that
+            // user operations get the time instead.
+            const int maxDocsPerSecond = rangeDeleterMaxDocsPerSecond;
+            if ( !done && maxDocsPerSecond > 0 ) {
+                const long long budgetMillis = batchDeleted * 1000LL / maxDocsPerSecond;
+                const long long elapsedMillis = batchTimer.millis();
+                if ( elapsedMillis < budgetMillis ) {
+                    sleepmillis( budgetMillis - elapsedMillis );
+                }
+            }
         }
         
         if (writeConcern.shouldWaitForOtherNodes())
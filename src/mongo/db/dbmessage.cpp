@@ -173,18 +173,19 @@ namespace mongo {
                       int nReturned, int startingFrom,
                       long long cursorId 
                       ) {
-        BufBuilder b(32768);
-        b.skip(sizeof(QueryResult::Value));
-        b.appendBuf(data, size);
-        QueryResult::View qr = b.buf();
-        qr.setResultFlags(queryResultFlags);
-        qr.msgdata().setLen(b.len());
+        // The reply is sent before we return, so send the header and the caller's documents
+        // straight from where they are, rather than copying them in after the header.
+        QueryResult::Value header;
+        QueryResult::View qr = header.view();
         qr.msgdata().setOperation(opReply);
+        qr.setResultFlags(queryResultFlags);
         qr.setCursorId(cursorId);
         qr.setStartingFrom(startingFrom);
         qr.setNReturned(nReturned);
-        b.decouple();
-        Message resp(qr.view2ptr(), true);
+
+        Message resp;
+        resp.appendUnownedData(qr.view2ptr(), sizeof(QueryResult::Value));
+        resp.appendUnownedData(static_cast<char*>(data), size);
         p->reply(requestMsg, resp, requestMsg.header().getId());
     }
 
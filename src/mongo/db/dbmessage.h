@@ -309,6 +309,7 @@ namespace mongo {
         Message *response;
         MSGID responseTo;
         std::string exhaustNS; /* points to ns if exhaust mode. 0=normal mode*/
+        std::string readAheadNS; /* if set, read the reply's cursor ahead after replying */
         DbResponse(Message *r, MSGID rt) : response(r), responseTo(rt){ }
         DbResponse() {
             response = 0;
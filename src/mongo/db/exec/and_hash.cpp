@@ -30,9 +30,11 @@
 
 #include "mongo/db/exec/and_common-inl.h"
 #include "mongo/db/exec/filter.h"
+#include "mongo/db/exec/index_scan.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace {
@@ -41,6 +43,43 @@ namespace {
     // Stage execution will fail once size of all buffered data exceeds this threshold.
     const size_t kDefaultMaxMemUsageBytes = 32 * 1024 * 1024;
 
+    /**
+     * Orders the spilled data by DiskLoc.
+     */
+    class SpillComparator {
+    public:
+        typedef std::pair<mongo::DiskLoc, mongo::SpilledWorkingSetMember> Data;
+
+        int operator()(const Data& lhs, const Data& rhs) const {
+            if (lhs.first.a() != rhs.first.a()) {
+                return lhs.first.a() < rhs.first.a() ? -1 : 1;
+            }
+            if (lhs.first.getOfs() != rhs.first.getOfs()) {
+                return lhs.first.getOfs() < rhs.first.getOfs() ? -1 : 1;
+            }
+            return 0;
+        }
+    };
+
+    /**
+     * Returns the index scan which 'stage' reads from directly, if any: either 'stage' itself
+     * or the child of a fetch.
+     */
+    mongo::IndexScan* getIndexScan(mongo::PlanStage* stage) {
+        if (mongo::STAGE_FETCH == stage->stageType()) {
+            std::vector<mongo::PlanStage*> children = stage->getChildren();
+            if (1 != children.size()) {
+                return NULL;
+            }
+            stage = children[0];
+        }
+
+        if (mongo::STAGE_IXSCAN != stage->stageType()) {
+            return NULL;
+        }
+        return static_cast<mongo::IndexScan*>(stage);
+    }
+
 } // namespace
 
 namespace mongo {
@@ -64,7 +103,9 @@ namespace mongo {
           _currentChild(0),
           _commonStats(kStageType),
           _memUsage(0),
-          _maxMemUsage(kDefaultMaxMemUsageBytes) {}
+          _maxMemUsage(kDefaultMaxMemUsageBytes),
+          _allowDiskUse(false),
+          _hasSpillNext(false) {}
 
     AndHashStage::AndHashStage(OperationContext* txn,
                                WorkingSet* ws, 
@@ -79,7 +120,9 @@ namespace mongo {
           _currentChild(0),
           _commonStats(kStageType),
           _memUsage(0),
-          _maxMemUsage(maxMemUsage) {}
+          _maxMemUsage(maxMemUsage),
+          _allowDiskUse(false),
+          _hasSpillNext(false) {}
 
     AndHashStage::~AndHashStage() {
         for (size_t i = 0; i < _children.size(); ++i) { delete _children[i]; }
@@ -87,8 +130,39 @@ namespace mongo {
 
     void AndHashStage::addChild(PlanStage* child) { _children.push_back(child); }
 
+    void AndHashStage::allowDiskUse(const std::string& tempDir) {
+        _allowDiskUse = true;
+        _tempDir = tempDir;
+    }
+
     size_t AndHashStage::getMemUsage() const {
-        return _memUsage;
+        // A hash table entry costs about two pointers besides its key and value.
+        const size_t dataMapEntrySize = sizeof(DataMap::value_type) + 2 * sizeof(void*);
+        size_t memUsage = _memUsage + _dataMap.size() * dataMapEntrySize
+                          + _seenMap.getMemUsage() + _spillCandidates.getMemUsage();
+        if (NULL != _bloomFilter.get()) {
+            memUsage += _bloomFilter->getMemUsage();
+        }
+        return memUsage;
+    }
+
+    void AndHashStage::buildBloomFilter() {
+        _bloomFilter.reset(new DiskLocBloomFilter(_dataMap.size()));
+        for (DataMap::const_iterator it = _dataMap.begin(); it != _dataMap.end(); ++it) {
+            _bloomFilter->insert(it->first);
+        }
+
+        for (size_t i = 1; i < _children.size(); ++i) {
+            IndexScan* scan = getIndexScan(_children[i]);
+            if (NULL != scan) {
+                scan->setDiskLocFilter(_bloomFilter.get());
+            }
+        }
+    }
+
+    size_t AndHashStage::numCandidates() const {
+        return (NULL != _spillSorter.get() || NULL != _spillIterator.get())
+               ? _spillCandidates.size() : _dataMap.size();
     }
 
     bool AndHashStage::isEOF() {
@@ -98,10 +172,13 @@ namespace mongo {
         // Either we're busy hashing children, in which case we're not done yet.
         if (_hashingChildren) { return false; }
 
-        // Or we're streaming in results from the last child.
+        // Or we're streaming in results from the last child, or from the spilled data.
 
         // If there's nothing to probe against, we're EOF.
-        if (_dataMap.empty()) { return true; }
+        if (0 == numCandidates()) { return true; }
+
+        // Otherwise the spilled data is read until everything in the intersection is output.
+        if (NULL != _spillIterator.get()) { return false; }
 
         // Otherwise, we're done when the last child is done.
         invariant(_children.size() >= 2);
@@ -113,7 +190,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (isEOF()) { return PlanStage::IS_EOF; }
 
@@ -182,11 +259,19 @@ namespace mongo {
 
         // We read the first child into our hash table.
         if (_hashingChildren) {
-            // Check memory usage of previously hashed results.
-            if (_memUsage > _maxMemUsage) {
+            // Check memory usage of previously hashed results.  If we may, go to disk.
+            if (_allowDiskUse && NULL == _spillSorter.get() && getMemUsage() > _maxMemUsage) {
+                Status status = startSpilling();
+                if (!status.isOK()) {
+                    *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+                    return PlanStage::FAILURE;
+                }
+            }
+
+            if (getMemUsage() > _maxMemUsage) {
                 mongoutils::str::stream ss;
-                ss << "hashed AND stage buffered data usage of " << _memUsage
-                   << " bytes exceeds internal limit of " << kDefaultMaxMemUsageBytes << " bytes";
+                ss << "hashed AND stage buffered data usage of " << getMemUsage()
+                   << " bytes exceeds internal limit of " << _maxMemUsage << " bytes";
                 Status status(ErrorCodes::Overflow, ss);
                 *out = WorkingSetCommon::allocateStatusMember( _ws, status);
                 return PlanStage::FAILURE;
@@ -195,7 +280,9 @@ namespace mongo {
             if (0 == _currentChild) {
                 return readFirstChild(out);
             }
-            else if (_currentChild < _children.size() - 1) {
+            else if (_currentChild < _children.size() - 1 || NULL != _spillSorter.get()) {
+                // Once we're on disk, there's no table to probe, so the last child is read like
+                // the others.
                 return hashOtherChildren(out);
             }
             else {
@@ -206,6 +293,10 @@ namespace mongo {
             }
         }
 
+        if (NULL != _spillIterator.get()) {
+            return readSpilledResults(out);
+        }
+
         // Returning results.  We read from the last child and return the results that are in our
         // hash map.
 
@@ -291,6 +382,20 @@ namespace mongo {
             }
 
             verify(member->hasLoc());
+
+            if (NULL != _spillSorter.get()) {
+                _spillCandidates.insert(member->loc);
+                Status status = addToSpill(*member);
+                _ws->free(id);
+                if (!status.isOK()) {
+                    *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+                    return PlanStage::FAILURE;
+                }
+
+                ++_commonStats.needTime;
+                return PlanStage::NEED_TIME;
+            }
+
             verify(_dataMap.end() == _dataMap.find(member->loc));
 
             _dataMap[member->loc] = id;
@@ -306,13 +411,20 @@ namespace mongo {
             _currentChild = 1;
 
             // If our first child was empty, don't scan any others, no possible results.
-            if (_dataMap.empty()) {
+            if (0 == numCandidates()) {
                 _hashingChildren = false;
                 return PlanStage::IS_EOF;
             }
 
             ++_commonStats.needTime;
-            _specificStats.mapAfterChild.push_back(_dataMap.size());
+            _specificStats.mapAfterChild.push_back(numCandidates());
+
+            // Our other children only contribute DiskLocs in _dataMap, so let their index
+            // scans skip the others before producing anything.  Invalidations only shrink
+            // _dataMap, so the filter stays a superset of it.
+            if (internalQueryExecAndHashBloomFilter && NULL == _spillSorter.get()) {
+                buildBloomFilter();
+            }
 
             return PlanStage::NEED_TIME;
         }
@@ -359,7 +471,19 @@ namespace mongo {
             }
 
             verify(member->hasLoc());
-            if (_dataMap.end() == _dataMap.find(member->loc)) {
+            if (NULL != _spillSorter.get()) {
+                if (_spillCandidates.contains(member->loc)) {
+                    // We have a hit.  Its data is merged with the other children's on output.
+                    _seenMap.insert(member->loc);
+                    Status status = addToSpill(*member);
+                    if (!status.isOK()) {
+                        _ws->free(id);
+                        *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+                        return PlanStage::FAILURE;
+                    }
+                }
+            }
+            else if (_dataMap.end() == _dataMap.find(member->loc)) {
                 // Ignore.  It's not in any previous child.
             }
             else {
@@ -381,10 +505,16 @@ namespace mongo {
             // Finished with a child.
             ++_currentChild;
 
+            // On disk, every DiskLoc we put in _seenMap was a candidate, so it holds exactly
+            // those still in the intersection.
+            if (NULL != _spillSorter.get()) {
+                _spillCandidates.swap(_seenMap);
+            }
+
             // Keep elements of _dataMap that are in _seenMap.
             DataMap::iterator it = _dataMap.begin();
             while (it != _dataMap.end()) {
-                if (_seenMap.end() == _seenMap.find(it->first)) {
+                if (!_seenMap.contains(it->first)) {
                     DataMap::iterator toErase = it;
                     ++it;
 
@@ -398,21 +528,37 @@ namespace mongo {
                 else { ++it; }
             }
 
-            _specificStats.mapAfterChild.push_back(_dataMap.size());
+            _specificStats.mapAfterChild.push_back(numCandidates());
 
             _seenMap.clear();
 
             // _dataMap is now the intersection of the first _currentChild nodes.
 
             // If we have nothing to AND with after finishing any child, stop.
-            if (_dataMap.empty()) {
+            if (0 == numCandidates()) {
                 _hashingChildren = false;
+                _spillSorter.reset();
                 return PlanStage::IS_EOF;
             }
 
             // We've finished scanning all children.  Return results with the next call to work().
             if (_currentChild == _children.size()) {
                 _hashingChildren = false;
+
+                if (NULL != _spillSorter.get()) {
+                    try {
+                        _spillIterator.reset(_spillSorter->done());
+                    }
+                    catch (const DBException& e) {
+                        *out = WorkingSetCommon::allocateStatusMember(_ws, e.toStatus());
+                        _spillSorter.reset();
+                        _spillCandidates.clear();
+                        return PlanStage::FAILURE;
+                    }
+                    _specificStats.spillFiles = _spillSorter->numFiles();
+                    _specificStats.spillBytes = _spillSorter->spilledBytes();
+                    _spillSorter.reset();
+                }
             }
 
             ++_commonStats.needTime;
@@ -515,6 +661,113 @@ namespace mongo {
             // And don't return it from this stage.
             _dataMap.erase(it);
         }
+        else if (_spillCandidates.erase(dl)) {
+            // The data is on disk.  Fetch the object into a new WSM and flag that the same way.
+            if (_hashingChildren) {
+                ++_specificStats.flaggedInProgress;
+            }
+            else {
+                ++_specificStats.flaggedButPassed;
+            }
+            _seenMap.erase(dl);
+
+            WorkingSetID id = _ws->allocate();
+            WorkingSetMember* member = _ws->get(id);
+            member->loc = dl;
+            member->state = WorkingSetMember::LOC_AND_IDX;
+            WorkingSetCommon::fetchAndInvalidateLoc(_txn, member, _collection);
+            _ws->flagForReview(id);
+        }
+    }
+
+    Status AndHashStage::startSpilling() {
+        SortOptions opts;
+        opts.maxMemoryUsageBytes = _maxMemUsage;
+        opts.extSortAllowed = true;
+        opts.tempDir = _tempDir;
+
+        try {
+            _spillSorter.reset(SpillSorter::make(opts, SpillComparator()));
+        }
+        catch (const DBException& e) {
+            return e.toStatus();
+        }
+
+        // Our hashed members all go to disk.  The DiskLocs the current child has seen already
+        // stay in _seenMap.
+        Status status = Status::OK();
+        for (DataMap::const_iterator it = _dataMap.begin(); it != _dataMap.end(); ++it) {
+            if (status.isOK()) {
+                _spillCandidates.insert(it->first);
+                status = addToSpill(*_ws->get(it->second));
+            }
+            _ws->free(it->second);
+        }
+        _dataMap.clear();
+        _memUsage = 0;
+
+        return status;
+    }
+
+    Status AndHashStage::addToSpill(const WorkingSetMember& member) {
+        try {
+            _spillSorter->add(member.loc, SpilledWorkingSetMember(member));
+        }
+        catch (const DBException& e) {
+            return e.toStatus();
+        }
+        return Status::OK();
+    }
+
+    PlanStage::StageState AndHashStage::readSpilledResults(WorkingSetID* out) {
+        if (!_hasSpillNext) {
+            if (!_spillIterator->more()) {
+                // Anything left was invalidated after it was read.
+                _spillCandidates.clear();
+                return PlanStage::IS_EOF;
+            }
+            _spillNext = _spillIterator->next();
+        }
+
+        // All the data for one DiskLoc is next to each other.  Merge it if the DiskLoc is in the
+        // intersection, and skip it if not.
+        const DiskLoc loc = _spillNext.first;
+        const bool intersected = _spillCandidates.erase(loc);
+
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        WorkingSetMember* member = NULL;
+        if (intersected) {
+            id = _ws->allocate();
+            member = _ws->get(id);
+            _spillNext.second.toMember(member, false);
+        }
+
+        _hasSpillNext = false;
+        while (_spillIterator->more()) {
+            _spillNext = _spillIterator->next();
+            if (_spillNext.first != loc) {
+                _hasSpillNext = true;
+                break;
+            }
+
+            if (intersected) {
+                WorkingSetMember childMember;
+                _spillNext.second.toMember(&childMember, false);
+                AndCommon::mergeFrom(member, childMember);
+            }
+        }
+
+        if (intersected && Filter::passes(member, _filter)) {
+            *out = id;
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
+        if (intersected) {
+            _ws->free(id);
+        }
+        ++_commonStats.needTime;
+        return PlanStage::NEED_TIME;
     }
 
     vector<PlanStage*> AndHashStage::getChildren() const {
@@ -525,7 +778,7 @@ namespace mongo {
         _commonStats.isEOF = isEOF();
 
         _specificStats.memLimit = _maxMemUsage;
-        _specificStats.memUsage = _memUsage;
+        _specificStats.memUsage = getMemUsage();
 
         // Add a BSON representation of the filter to the stats tree, if there is one.
         if (NULL != _filter) {
@@ -552,3 +805,6 @@ namespace mongo {
     }
 
 }  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+// Explicit instantiation unneeded since we aren't exposing Sorter outside of this file.
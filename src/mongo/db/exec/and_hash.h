@@ -33,9 +33,12 @@
 
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/exec/disk_loc_bloom_filter.h"
+#include "mongo/db/exec/disk_loc_set.h"
 #include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/exec/working_set_spill.h"
 #include "mongo/db/matcher/expression.h"
-#include "mongo/platform/unordered_set.h"
+#include "mongo/db/sorter/sorter.h"
 
 namespace mongo {
 
@@ -49,6 +52,12 @@ namespace mongo {
      * is fetched and added to the WorkingSet as "flagged for further review."  Because this stage
      * operates with DiskLocs, we are unable to evaluate the AND for the invalidated DiskLoc, and it
      * must be fully matched later.
+     *
+     * The buffered data may use at most a fixed amount of memory, past which the stage fails.
+     * If disk use is allowed it instead stops hashing: every child from then on is read into a
+     * Sorter, keeping only the DiskLocs which can still be in the intersection, and the
+     * intersection is merged from the data sorted by DiskLoc once the last child is done.  The
+     * results are then output in DiskLoc order rather than in the order of the last child.
      */
     class AndHashStage : public PlanStage {
     public:
@@ -71,8 +80,13 @@ namespace mongo {
         void addChild(PlanStage* child);
 
         /**
-         * Returns memory usage.
-         * For testing only.
+         * Lets the stage finish an intersection which exceeds its memory limit on disk, writing
+         * temporary files to 'tempDir'.  Must be called before work().
+         */
+        void allowDiskUse(const std::string& tempDir);
+
+        /**
+         * Returns the memory used by the buffered data and the tables of DiskLocs.
          */
         size_t getMemUsage() const;
 
@@ -102,6 +116,33 @@ namespace mongo {
         StageState hashOtherChildren(WorkingSetID* out);
         StageState workChild(size_t childNo, WorkingSetID* out);
 
+        /**
+         * Moves the members buffered in _dataMap into a new _spillSorter.
+         */
+        Status startSpilling();
+
+        /**
+         * Copies 'member' into _spillSorter.
+         */
+        Status addToSpill(const WorkingSetMember& member);
+
+        /**
+         * Merges the spilled data of the next DiskLoc in _spillIterator and returns it, if the
+         * DiskLoc is in the intersection.
+         */
+        StageState readSpilledResults(WorkingSetID* out);
+
+        /**
+         * Summarizes the DiskLocs read from the first child in _bloomFilter, and has the index
+         * scans of the other children skip keys not in it.
+         */
+        void buildBloomFilter();
+
+        /**
+         * How many DiskLocs may still be in the intersection?
+         */
+        size_t numCandidates() const;
+
         // Not owned by us.
         OperationContext* _txn;
         const Collection* _collection;
@@ -127,8 +168,11 @@ namespace mongo {
 
         // Keeps track of what elements from _dataMap subsequent children have seen.
         // Only used while _hashingChildren.
-        typedef unordered_set<DiskLoc, DiskLoc::Hasher> SeenMap;
-        SeenMap _seenMap;
+        DiskLocSet _seenMap;
+
+        // The DiskLocs output by the first child, if we've given our other children's index
+        // scans a filter.  Must outlive those scans, which point at it.
+        boost::scoped_ptr<DiskLocBloomFilter> _bloomFilter;
 
         // True if we're still intersecting _children[0..._children.size()-1].
         bool _hashingChildren;
@@ -148,6 +192,23 @@ namespace mongo {
         // Upper limit for buffered data memory usage.
         // Defaults to 32 MB (See kMaxBytes in and_hash.cpp).
         size_t _maxMemUsage;
+
+        // May we go to disk past _maxMemUsage, and if so where?
+        bool _allowDiskUse;
+        std::string _tempDir;
+
+        // Once we've gone to disk, the data of each child is added to the sorter rather than
+        // to _dataMap.  _spillCandidates takes the place of _dataMap's keys; _seenMap still
+        // tracks which of them the current child has seen.  Once all children are read, the
+        // sorted data is read back through _spillIterator.
+        typedef Sorter<DiskLoc, SpilledWorkingSetMember> SpillSorter;
+        boost::scoped_ptr<SpillSorter> _spillSorter;
+        boost::scoped_ptr<SpillSorter::Iterator> _spillIterator;
+        DiskLocSet _spillCandidates;
+
+        // The next data read from _spillIterator, if _hasSpillNext.
+        bool _hasSpillNext;
+        std::pair<DiskLoc, SpilledWorkingSetMember> _spillNext;
     };
 
 }  // namespace mongo
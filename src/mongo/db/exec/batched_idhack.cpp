@@ -0,0 +1,314 @@
+// batched_idhack.cpp
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/batched_idhack.h"
+
+#include <algorithm>
+
+#include "mongo/db/exec/scoped_timer.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/exec/working_set_computed_data.h"
+#include "mongo/db/index/btree_access_method.h"
+#include "mongo/db/matcher/expression_leaf.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/storage/record_fetcher.h"
+
+namespace mongo {
+
+    // static
+    const char* BatchedIdHackStage::kStageType = "BATCHED_IDHACK";
+
+    BatchedIdHackStage::BatchedIdHackStage(OperationContext* txn, const Collection* collection,
+                                           CanonicalQuery* query, WorkingSet* ws)
+        : _txn(txn),
+          _collection(collection),
+          _workingSet(ws),
+          _nextKey(0),
+          _batchSize(std::max(1, internalQueryExecBatchedIdHackBatchSize)),
+          _idBeingPagedIn(WorkingSet::INVALID_ID),
+          _commonStats(kStageType) {
+        invariant(MatchExpression::MATCH_IN == query->root()->matchType());
+        const InMatchExpression* in = static_cast<const InMatchExpression*>(query->root());
+
+        // The equalities are ordered as the index orders keys, and 5 and 5.0 are one of them.
+        const BSONElementSet& equalities = in->getData().equalities();
+        _keys.reserve(equalities.size());
+        for (BSONElementSet::const_iterator it = equalities.begin();
+             it != equalities.end();
+             ++it) {
+            BSONObjBuilder bob;
+            bob.appendAs(*it, "");
+            _keys.push_back(bob.obj());
+        }
+
+        if (NULL != query->getProj()) {
+            _addKeyMetadata = query->getProj()->wantIndexKey();
+        }
+        else {
+            _addKeyMetadata = false;
+        }
+    }
+
+    BatchedIdHackStage::~BatchedIdHackStage() { }
+
+    bool BatchedIdHackStage::isEOF() {
+        if (WorkingSet::INVALID_ID != _idBeingPagedIn) {
+            return false;
+        }
+
+        return _batch.empty() && _nextKey == _keys.size();
+    }
+
+    PlanStage::StageState BatchedIdHackStage::work(WorkingSetID* out) {
+        ++_commonStats.works;
+
+        // Adds the amount of time taken by work() to executionTimeMillis.
+        ScopedTimer timer(&_commonStats);
+
+        if (WorkingSet::INVALID_ID != _idBeingPagedIn) {
+            WorkingSetID id = _idBeingPagedIn;
+            _idBeingPagedIn = WorkingSet::INVALID_ID;
+            WorkingSetMember* member = _workingSet->get(id);
+
+            WorkingSetCommon::completeFetch(_txn, member, _collection);
+            _commonStats.docBytesExamined += member->obj.objsize();
+
+            return advance(id, member, out);
+        }
+
+        if (_batch.empty()) {
+            if (_nextKey == _keys.size()) {
+                return PlanStage::IS_EOF;
+            }
+
+            lookUpBatch();
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+
+        WorkingSetID id = _batch.front();
+        _batch.pop_front();
+        WorkingSetMember* member = _workingSet->get(id);
+
+        ++_specificStats.docsExamined;
+
+        // An invalidation may have fetched the document already.
+        if (member->hasObj()) {
+            return advance(id, member, out);
+        }
+
+        // We may need to request a yield while we fetch the document.
+        std::auto_ptr<RecordFetcher> fetcher(_collection->documentNeedsFetch(_txn, member->loc));
+        if (NULL != fetcher.get()) {
+            // There's something to fetch. Hand the fetcher off to the WSM, and pass up a
+            // fetch request.
+            _idBeingPagedIn = id;
+            member->setFetcher(fetcher.release());
+            *out = id;
+            _commonStats.needFetch++;
+            return NEED_FETCH;
+        }
+
+        // The doc was already in memory, so we go ahead and return it.
+        member->obj = _collection->docFor(_txn, member->loc);
+        member->keyData.clear();
+        member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+        _commonStats.docBytesExamined += member->obj.objsize();
+        return advance(id, member, out);
+    }
+
+    void BatchedIdHackStage::lookUpBatch() {
+        const size_t batchEnd = std::min(_keys.size(), _nextKey + _batchSize);
+        std::vector<BSONObj> keys(_keys.begin() + _nextKey, _keys.begin() + batchEnd);
+        _nextKey = batchEnd;
+
+        // The _id index may have gone away while we yielded, in which case nothing is found.
+        const IndexCatalog* catalog = _collection->getIndexCatalog();
+        IndexDescriptor* idDesc = catalog->findIdIndex(_txn);
+        if (NULL == idDesc) {
+            _nextKey = _keys.size();
+            return;
+        }
+
+        // This may not be valid always.  See SERVER-12397.
+        const BtreeBasedAccessMethod* accessMethod =
+            static_cast<const BtreeBasedAccessMethod*>(catalog->getIndex(idDesc));
+
+        std::vector<DiskLoc> locs;
+        accessMethod->findMany(_txn, keys, &locs);
+
+        std::vector<DiskLoc> sortedLocs;
+        for (size_t i = 0; i < locs.size(); ++i) {
+            if (locs[i].isNull()) {
+                continue;
+            }
+
+            ++_specificStats.keysExamined;
+
+            WorkingSetID id = _workingSet->allocate();
+            WorkingSetMember* member = _workingSet->get(id);
+            member->loc = locs[i];
+            member->keyData.push_back(IndexKeyDatum(idDesc->keyPattern(), keys[i]));
+            member->state = WorkingSetMember::LOC_AND_IDX;
+            _batch.push_back(id);
+
+            sortedLocs.push_back(locs[i]);
+        }
+
+        if (sortedLocs.empty()) {
+            return;
+        }
+
+        std::sort(sortedLocs.begin(), sortedLocs.end());
+        _collection->prefetchDocuments(_txn, sortedLocs);
+        ++_specificStats.batchesPrefetched;
+    }
+
+    PlanStage::StageState BatchedIdHackStage::advance(WorkingSetID id,
+                                                      WorkingSetMember* member,
+                                                      WorkingSetID* out) {
+        invariant(member->hasObj());
+
+        if (_addKeyMetadata) {
+            BSONObjBuilder bob;
+            BSONObj ownedKeyObj = member->obj["_id"].wrap().getOwned();
+            bob.appendKeys(BSON("_id" << 1), ownedKeyObj);
+            member->addComputed(new IndexKeyComputedData(bob.obj()));
+        }
+
+        ++_commonStats.advanced;
+        *out = id;
+        return PlanStage::ADVANCED;
+    }
+
+    void BatchedIdHackStage::saveState() {
+        ++_commonStats.yields;
+    }
+
+    void BatchedIdHackStage::restoreState(OperationContext* opCtx) {
+        _txn = opCtx;
+        ++_commonStats.unyields;
+    }
+
+    void BatchedIdHackStage::invalidate(const DiskLoc& dl, InvalidationType type) {
+        ++_commonStats.invalidates;
+
+        // If the loc getting invalidated is one we're about to return, we do a "forced fetch"
+        // and put the WSM in owned object state.
+        if (WorkingSet::INVALID_ID != _idBeingPagedIn) {
+            WorkingSetMember* member = _workingSet->get(_idBeingPagedIn);
+            if (member->hasLoc() && (member->loc == dl)) {
+                WorkingSetCommon::fetchAndInvalidateLoc(_txn, member, _collection);
+            }
+        }
+
+        for (size_t i = 0; i < _batch.size(); ++i) {
+            WorkingSetMember* member = _workingSet->get(_batch[i]);
+            if (member->hasLoc() && (member->loc == dl)) {
+                WorkingSetCommon::fetchAndInvalidateLoc(_txn, member, _collection);
+            }
+        }
+    }
+
+    // static
+    bool BatchedIdHackStage::supportsQuery(const CanonicalQuery& query) {
+        if (internalQueryExecBatchedIdHackBatchSize <= 0) {
+            return false;
+        }
+
+        const LiteParsedQuery& parsed = query.getParsed();
+        if (parsed.showDiskLoc()
+            || !parsed.getHint().isEmpty()
+            || !parsed.getMin().isEmpty()
+            || !parsed.getMax().isEmpty()
+            || 0 != parsed.getSkip()
+            || parsed.getOptions().tailable) {
+            return false;
+        }
+
+        // We return documents in ascending _id order.
+        if (!parsed.getSort().isEmpty() && 0 != parsed.getSort().woCompare(BSON("_id" << 1))) {
+            return false;
+        }
+
+        const MatchExpression* root = query.root();
+        if (MatchExpression::MATCH_IN != root->matchType() || "_id" != root->path()) {
+            return false;
+        }
+
+        // As for the idhack, each value must be a literal an _id can equal.
+        const ArrayFilterEntries& entries = static_cast<const InMatchExpression*>(root)->getData();
+        if (0 != entries.numRegexes()) {
+            return false;
+        }
+
+        const BSONElementSet& equalities = entries.equalities();
+        for (BSONElementSet::const_iterator it = equalities.begin();
+             it != equalities.end();
+             ++it) {
+            if (Object != it->type() && BinData != it->type() && !it->isSimpleType()) {
+                return false;
+            }
+        }
+
+        const ParsedProjection* proj = query.getProj();
+        if (NULL != proj && !proj->requiresDocument()) {
+            const std::vector<std::string>& fields = proj->getRequiredFields();
+            if (fields.size() == 1 && "_id" == fields[0]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    vector<PlanStage*> BatchedIdHackStage::getChildren() const {
+        vector<PlanStage*> empty;
+        return empty;
+    }
+
+    PlanStageStats* BatchedIdHackStage::getStats() {
+        _commonStats.isEOF = isEOF();
+        auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_BATCHED_IDHACK));
+        ret->specific.reset(new BatchedIdHackStats(_specificStats));
+        return ret.release();
+    }
+
+    const CommonStats* BatchedIdHackStage::getCommonStats() {
+        return &_commonStats;
+    }
+
+    const SpecificStats* BatchedIdHackStage::getSpecificStats() {
+        return &_specificStats;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,131 @@
+// batched_idhack.h
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/query/canonical_query.h"
+
+namespace mongo {
+
+    /**
+     * A standalone stage implementing the fast path for queries of the form
+     * {_id: {$in: [...]}}, which drivers use to fetch many documents by _id.
+     *
+     * Rather than scanning one point interval of the _id index after another, the _id values are
+     * looked up a batch at a time with a single cursor sweeping forward through the index.  The
+     * documents of each batch are prefetched in DiskLoc order, and then fetched and returned in
+     * _id order, which is the order an index scan of the _id index would return them in.
+     */
+    class BatchedIdHackStage : public PlanStage {
+    public:
+        BatchedIdHackStage(OperationContext* txn, const Collection* collection,
+                           CanonicalQuery* query, WorkingSet* ws);
+
+        virtual ~BatchedIdHackStage();
+
+        virtual bool isEOF();
+        virtual StageState work(WorkingSetID* out);
+
+        virtual void saveState();
+        virtual void restoreState(OperationContext* opCtx);
+        virtual void invalidate(const DiskLoc& dl, InvalidationType type);
+
+        /**
+         * Like the idhack, supports only queries on _id and nothing else, and only when
+         * internalQueryExecBatchedIdHackBatchSize is set.  Queries whose projection the _id index
+         * covers are left to the planner, as a covered plan reads no documents at all.
+         */
+        static bool supportsQuery(const CanonicalQuery& query);
+
+        virtual std::vector<PlanStage*> getChildren() const;
+
+        virtual StageType stageType() const { return STAGE_BATCHED_IDHACK; }
+
+        PlanStageStats* getStats();
+
+        virtual const CommonStats* getCommonStats();
+
+        virtual const SpecificStats* getSpecificStats();
+
+        static const char* kStageType;
+
+    private:
+        /**
+         * Looks up the next batch of our keys in the _id index, adds a WSM for each one found to
+         * _batch, and prefetches their documents.
+         */
+        void lookUpBatch();
+
+        /**
+         * Optionally adds key metadata, and returns PlanStage::ADVANCED.
+         *
+         * Called whenever we have a WSM containing the matching obj.
+         */
+        StageState advance(WorkingSetID id, WorkingSetMember* member, WorkingSetID* out);
+
+        // transactional context for read locks. Not owned by us
+        OperationContext* _txn;
+
+        // Not owned here.
+        const Collection* _collection;
+
+        // The WorkingSet we annotate with results.  Not owned by us.
+        WorkingSet* _workingSet;
+
+        // The _id values to look up as index keys, in ascending order and without duplicates.
+        std::vector<BSONObj> _keys;
+
+        // The position in _keys of the first key not yet looked up.
+        size_t _nextKey;
+
+        // How many keys to look up at a time.
+        const size_t _batchSize;
+
+        // The WSMs of the documents found for the last batch of keys, in _id order.
+        std::deque<WorkingSetID> _batch;
+
+        // Do we need to add index key metadata for $returnKey?
+        bool _addKeyMetadata;
+
+        // If a document isn't in memory we return a "please page this in" result, as the idhack
+        // does.  This is the WSM we'll return once it's paged in.
+        WorkingSetID _idBeingPagedIn;
+
+        CommonStats _commonStats;
+        BatchedIdHackStats _specificStats;
+    };
+
+}  // namespace mongo
@@ -36,6 +36,7 @@
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/record_fetcher.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -61,6 +62,10 @@ namespace mongo {
         // Explain reports the direction of the collection scan.
         _specificStats.direction = params.direction;
 
+        if (NULL != _filter && internalQueryExecCompileFilters) {
+            _compiledFilter.reset(CompiledMatcher::compile(_filter));
+        }
+
         // We pre-allocate a WSM and use it to pass up fetch requests. This should never be used
         // for anything other than passing up NEED_FETCH. We use the loc and unowned obj state, but
         // the loc isn't really pointing at any obj. The obj field of the WSM should never be used.
@@ -72,8 +77,37 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
+
+        return doWork(out);
+    }
+
+    PlanStage::StageState CollectionScan::workBatch(size_t maxWorks,
+                                                    std::vector<WorkingSetID>* results,
+                                                    size_t* worksDone,
+                                                    WorkingSetID* out) {
+        // One timer for the whole batch rather than one per document.
+        ScopedTimer timer(&_commonStats);
+
+        const size_t numResults = results->size();
+        for (*worksDone = 0; *worksDone < maxWorks; ) {
+            ++_commonStats.works;
+            ++*worksDone;
+
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            StageState state = doWork(&id);
+            if (PlanStage::ADVANCED == state) {
+                results->push_back(id);
+            }
+            else if (PlanStage::NEED_TIME != state) {
+                *out = id;
+                return state;
+            }
+        }
+        return results->size() > numResults ? PlanStage::ADVANCED : PlanStage::NEED_TIME;
+    }
 
+    PlanStage::StageState CollectionScan::doWork(WorkingSetID* out) {
         if (_isDead) { return PlanStage::DEAD; }
 
         // Do some init if we haven't already.
@@ -112,6 +146,15 @@ namespace mongo {
         if (isEOF())
             return PlanStage::IS_EOF;
 
+        // Once the scan has gone on for a while, let the storage engine read ahead of it.  Tailable
+        // scans are left alone, since they spend their time waiting at the end of the collection.
+        if (!_params.tailable
+            && internalQueryExecCollScanReadAheadDocs > 0
+            && _specificStats.docsTested
+                   == static_cast<size_t>(internalQueryExecCollScanReadAheadDocs)) {
+            _iter->setSequentialScanHint();
+        }
+
         // See if the record we're about to access is in memory. If not, pass a fetch request up.
         // Note that curr() returns the same thing as getNext() will, except without advancing the
         // iterator or touching the DiskLoc. This means that we can use curr() to check whether we
@@ -149,6 +192,7 @@ namespace mongo {
         member->loc = nextLoc;
         member->obj = _iter->dataFor(member->loc).toBson();
         member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+        _commonStats.docBytesExamined += member->obj.objsize();
 
         return returnIfMatches(member, id, out);
     }
@@ -158,7 +202,7 @@ namespace mongo {
                                                           WorkingSetID* out) {
         ++_specificStats.docsTested;
 
-        if (Filter::passes(member, _filter)) {
+        if (Filter::passes(member, _filter, _compiledFilter.get())) {
             *out = memberID;
             ++_commonStats.advanced;
             return PlanStage::ADVANCED;
@@ -236,6 +280,10 @@ namespace mongo {
             _commonStats.filter = bob.obj();
         }
 
+        if (NULL != _iter) {
+            _specificStats.readAheads = _iter->readAheadCount();
+        }
+
         auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_COLLSCAN));
         ret->specific.reset(new CollectionScanStats(_specificStats));
         return ret.release();
@@ -246,6 +294,9 @@ namespace mongo {
     }
 
     const SpecificStats* CollectionScan::getSpecificStats() {
+        if (NULL != _iter) {
+            _specificStats.readAheads = _iter->readAheadCount();
+        }
         return &_specificStats;
     }
 
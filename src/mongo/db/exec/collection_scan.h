@@ -31,6 +31,7 @@
 #include "mongo/db/diskloc.h"
 #include "mongo/db/exec/collection_scan_common.h"
 #include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/matcher/compiled_matcher.h"
 #include "mongo/db/matcher/expression.h"
 
 namespace mongo {
@@ -53,6 +54,10 @@ namespace mongo {
                        const MatchExpression* filter);
 
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t maxWorks,
+                                     std::vector<WorkingSetID>* results,
+                                     size_t* worksDone,
+                                     WorkingSetID* out);
         virtual bool isEOF();
 
         virtual void invalidate(const DiskLoc& dl, InvalidationType type);
@@ -72,6 +77,11 @@ namespace mongo {
         static const char* kStageType;
 
     private:
+        /**
+         * The body of work(), less the works counter and timer that work() and workBatch() keep.
+         */
+        StageState doWork(WorkingSetID* out);
+
         /**
          * If the member (with id memberID) passes our filter, set *out to memberID and return that
          * ADVANCED.  Otherwise, free memberID and return NEED_TIME.
@@ -89,6 +99,9 @@ namespace mongo {
         // The filter is not owned by us.
         const MatchExpression* _filter;
 
+        // '_filter' compiled for faster evaluation, or NULL to interpret it.
+        scoped_ptr<CompiledMatcher> _compiledFilter;
+
         scoped_ptr<RecordIterator> _iter;
 
         CollectionScanParams _params;
@@ -31,6 +31,7 @@
 #include "mongo/db/exec/count.h"
 
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/exec/count_scan.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set_common.h"
 
@@ -48,6 +49,7 @@ namespace mongo {
           _collection(collection),
           _request(request),
           _leftToSkip(request.skip),
+          _triedIndexRange(false),
           _ws(ws),
           _child(child),
           _commonStats(kStageType) { }
@@ -68,7 +70,28 @@ namespace mongo {
 
     void CountStage::trivialCount() {
         invariant(_collection);
-        long long nCounted = _collection->numRecords(_txn);
+        countMatched(_collection->numRecords(_txn));
+        _specificStats.trivialCount = true;
+    }
+
+    bool CountStage::countIndexRange() {
+        if (NULL == _child.get() || STAGE_COUNT_SCAN != _child->stageType()) {
+            return false;
+        }
+
+        CountScan* countScan = static_cast<CountScan*>(_child.get());
+        long long nKeys;
+        if (!countScan->countKeysInRange(_request.approximate, &nKeys)) {
+            return false;
+        }
+
+        countMatched(nKeys);
+        _specificStats.approximate = _request.approximate;
+        return true;
+    }
+
+    void CountStage::countMatched(long long nMatched) {
+        long long nCounted = nMatched;
 
         if (0 != _request.skip) {
             nCounted -= _request.skip;
@@ -88,14 +111,13 @@ namespace mongo {
 
         _specificStats.nCounted = nCounted;
         _specificStats.nSkipped = _request.skip;
-        _specificStats.trivialCount = true;
     }
 
     PlanStage::StageState CountStage::work(WorkingSetID* out) {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         // This stage never returns a working set member.
         *out = WorkingSet::INVALID_ID;
@@ -107,6 +129,16 @@ namespace mongo {
             return PlanStage::IS_EOF;
         }
 
+        // A count of a single index range may be answered by the index itself, before the
+        // child has done any work.
+        if (!_triedIndexRange) {
+            _triedIndexRange = true;
+            if (countIndexRange()) {
+                _commonStats.isEOF = true;
+                return PlanStage::IS_EOF;
+            }
+        }
+
         if (isEOF()) {
             _commonStats.isEOF = true;
             return PlanStage::IS_EOF;
@@ -36,6 +36,8 @@ namespace mongo {
      * A description of a request for a count operation. Copyable.
      */
     struct CountRequest {
+        CountRequest() : limit(0), skip(0), explain(false), approximate(false) { }
+
         // Namespace to operate on (e.g. "foo.bar").
         std::string ns;
 
@@ -60,6 +62,10 @@ namespace mongo {
 
         // Whether this is an explain of a count.
         bool explain;
+
+        // Whether an estimate of the count is acceptable.  Lets a count over a single index
+        // range be answered from the structure of the index without walking the range.
+        bool approximate;
     };
 
     /**
@@ -109,6 +115,18 @@ namespace mongo {
          */
         void trivialCount();
 
+        /**
+         * Asks the index to count the range of a COUNT_SCAN child without walking it.  Returns
+         * true, with the result stored in '_specificStats', if the index could.
+         */
+        bool countIndexRange();
+
+        /**
+         * Stores in '_specificStats' the count of 'nMatched' matching documents after
+         * applying the skip and limit.
+         */
+        void countMatched(long long nMatched);
+
         // Transactional context for read locks. Not owned by us.
         OperationContext* _txn;
 
@@ -120,6 +138,9 @@ namespace mongo {
         // The number of documents that we still need to skip.
         long long _leftToSkip;
 
+        // Whether we have asked the index to count a COUNT_SCAN child's range.
+        bool _triedIndexRange;
+
         // The working set used to pass intermediate results between stages. Not owned
         // by us.
         WorkingSet* _ws;
@@ -105,9 +105,9 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
-        if (NULL == _btreeCursor.get()) {
+        if (NULL == _btreeCursor.get() && !_hitEnd) {
             // First call to work().  Perform cursor init.
             initIndexCursor();
             checkEnd();
@@ -138,13 +138,41 @@ namespace mongo {
         return PlanStage::ADVANCED;
     }
 
+    bool CountScan::countKeysInRange(bool approximate, long long* countOut) {
+        invariant(NULL == _btreeCursor.get());
+
+        // A multikey index may have several keys for one document.
+        if (_shouldDedup && !approximate) {
+            return false;
+        }
+
+        if (!_iam->countKeysInRange(_txn,
+                                    _params.startKey,
+                                    _params.startKeyInclusive,
+                                    _params.endKey,
+                                    _params.endKeyInclusive,
+                                    approximate,
+                                    countOut)) {
+            return false;
+        }
+
+        _specificStats.rangeCounted = true;
+        _hitEnd = true;
+        return true;
+    }
+
     bool CountScan::isEOF() {
+        if (_hitEnd) {
+            // We reached the end of the range, or the index counted it for us.
+            return true;
+        }
+
         if (NULL == _btreeCursor.get()) {
             // Have to call work() at least once.
             return false;
         }
 
-        return _hitEnd || _btreeCursor->isEOF();
+        return _btreeCursor->isEOF();
     }
 
     void CountScan::saveState() {
@@ -87,6 +87,16 @@ namespace mongo {
 
         virtual const SpecificStats* getSpecificStats();
 
+        /**
+         * Asks the index for the number of keys in the scan's range instead of walking them.
+         * Must be called before the first call to work(); if it succeeds the scan is EOF.
+         *
+         * Returns false if the index can't count the range, or can only estimate it and
+         * 'approximate' is false.  Keys of a multikey index aren't deduplicated, so its count
+         * is always treated as approximate.
+         */
+        bool countKeysInRange(bool approximate, long long* countOut);
+
         static const char* kStageType;
 
     private:
@@ -0,0 +1,87 @@
+// disk_loc_bloom_filter.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/disk_loc_bloom_filter.h"
+
+#include <algorithm>
+
+namespace mongo {
+
+    // static
+    const int DiskLocBloomFilter::kNumHashes = 7;
+    // static
+    const size_t DiskLocBloomFilter::kBitsPerEntry = 10;
+
+    DiskLocBloomFilter::DiskLocBloomFilter(size_t expectedSize) {
+        const size_t numWords = std::max(size_t(1), (expectedSize * kBitsPerEntry + 63) / 64);
+        _bits.assign(numWords, 0);
+        _numBits = numWords * 64;
+    }
+
+    // static
+    uint64_t DiskLocBloomFilter::hash(const DiskLoc& loc) {
+        // The 64-bit finalizer of MurmurHash3, which mixes every input bit into every output bit.
+        uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(loc.a())) << 32)
+                     | static_cast<uint32_t>(loc.getOfs());
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    void DiskLocBloomFilter::insert(const DiskLoc& loc) {
+        // Double hashing: the i-th bit is h1 + i * h2, with h2 odd so the bits differ.
+        const uint64_t h = hash(loc);
+        const uint64_t h1 = h & 0xFFFFFFFF;
+        const uint64_t h2 = (h >> 32) | 1;
+        for (int i = 0; i < kNumHashes; ++i) {
+            const uint64_t bit = (h1 + i * h2) % _numBits;
+            _bits[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+
+    bool DiskLocBloomFilter::mayContain(const DiskLoc& loc) const {
+        const uint64_t h = hash(loc);
+        const uint64_t h1 = h & 0xFFFFFFFF;
+        const uint64_t h2 = (h >> 32) | 1;
+        for (int i = 0; i < kNumHashes; ++i) {
+            const uint64_t bit = (h1 + i * h2) % _numBits;
+            if (!(_bits[bit / 64] & (1ULL << (bit % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,76 @@
+// disk_loc_bloom_filter.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    /**
+     * A Bloom filter of DiskLocs: a compact summary of a set of DiskLocs which answers whether
+     * a DiskLoc may be in the set.  There are no false negatives, and for a filter sized for
+     * the number of DiskLocs inserted about 1% of the DiskLocs not in the set are false
+     * positives.
+     *
+     * Used by a hashed AND to let its later children skip index keys whose DiskLocs weren't
+     * output by its first child.
+     */
+    class DiskLocBloomFilter {
+    public:
+        /**
+         * Sizes the filter for 'expectedSize' DiskLocs.
+         */
+        explicit DiskLocBloomFilter(size_t expectedSize);
+
+        void insert(const DiskLoc& loc);
+
+        /**
+         * Returns false if 'loc' was definitely not inserted.
+         */
+        bool mayContain(const DiskLoc& loc) const;
+
+        size_t getMemUsage() const { return _bits.capacity() * sizeof(uint64_t); }
+
+    private:
+        // Each DiskLoc sets this many bits, which with kBitsPerEntry gives the 1% rate.
+        static const int kNumHashes;
+        static const size_t kBitsPerEntry;
+
+        static uint64_t hash(const DiskLoc& loc);
+
+        std::vector<uint64_t> _bits;
+        uint64_t _numBits;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,88 @@
+// disk_loc_bloom_filter_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+/**
+ * This file contains tests for mongo/db/exec/disk_loc_bloom_filter.cpp
+ */
+
+#include "mongo/db/exec/disk_loc_bloom_filter.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    TEST(DiskLocBloomFilterTest, Empty) {
+        DiskLocBloomFilter filter(0);
+        ASSERT_FALSE(filter.mayContain(DiskLoc(0, 0)));
+        ASSERT_FALSE(filter.mayContain(DiskLoc(1, 8)));
+    }
+
+    TEST(DiskLocBloomFilterTest, NoFalseNegatives) {
+        const int numLocs = 10000;
+        DiskLocBloomFilter filter(numLocs);
+        for (int i = 0; i < numLocs; ++i) {
+            filter.insert(DiskLoc(i % 4, i * 64));
+        }
+        for (int i = 0; i < numLocs; ++i) {
+            ASSERT_TRUE(filter.mayContain(DiskLoc(i % 4, i * 64)));
+        }
+    }
+
+    TEST(DiskLocBloomFilterTest, FewFalsePositives) {
+        const int numLocs = 10000;
+        DiskLocBloomFilter filter(numLocs);
+        for (int i = 0; i < numLocs; ++i) {
+            filter.insert(DiskLoc(0, i * 64));
+        }
+
+        // Different offsets in the same file, and the same offsets in another file.
+        int falsePositives = 0;
+        for (int i = 0; i < numLocs; ++i) {
+            if (filter.mayContain(DiskLoc(0, i * 64 + 32))) {
+                ++falsePositives;
+            }
+            if (filter.mayContain(DiskLoc(1, i * 64))) {
+                ++falsePositives;
+            }
+        }
+
+        // About 1% are expected.
+        ASSERT_LESS_THAN(falsePositives, 2 * numLocs / 50);
+    }
+
+    TEST(DiskLocBloomFilterTest, MemUsage) {
+        // About ten bits per DiskLoc.
+        DiskLocBloomFilter filter(1000);
+        ASSERT_GREATER_THAN_OR_EQUALS(filter.getMemUsage(), 1000U * 10 / 8);
+        ASSERT_LESS_THAN(filter.getMemUsage(), 1000U * 10 / 8 + 16);
+    }
+
+}  // namespace
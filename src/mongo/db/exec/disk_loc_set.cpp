@@ -0,0 +1,174 @@
+// disk_loc_set.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/disk_loc_set.h"
+
+#include <algorithm>
+
+namespace mongo {
+
+    namespace {
+
+        const size_t kBitmapWords = (1 << 16) / 64;
+
+        bool bitmapTest(const std::vector<uint64_t>& bitmap, uint16_t offset) {
+            return bitmap[offset / 64] & (1ULL << (offset % 64));
+        }
+
+    } // namespace
+
+    // static
+    const size_t DiskLocSet::kMaxArrayEntries = 4096;
+
+    DiskLocSet::DiskLocSet() : _size(0), _memUsage(0) { }
+
+    // static
+    uint64_t DiskLocSet::chunkKey(const DiskLoc& loc) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(loc.a())) << 16)
+               | (static_cast<uint32_t>(loc.getOfs()) >> 16);
+    }
+
+    // static
+    uint16_t DiskLocSet::chunkOffset(const DiskLoc& loc) {
+        return static_cast<uint16_t>(static_cast<uint32_t>(loc.getOfs()) & 0xFFFF);
+    }
+
+    // static
+    size_t DiskLocSet::chunkMemUsage(const Chunk& chunk) {
+        // The chunk, its key and roughly what the hash table spends per entry.
+        return sizeof(Chunk) + sizeof(uint64_t) + 2 * sizeof(void*)
+               + chunk.entries.capacity() * sizeof(uint16_t)
+               + chunk.bitmap.capacity() * sizeof(uint64_t);
+    }
+
+    // static
+    void DiskLocSet::convertToBitmap(Chunk* chunk) {
+        chunk->bitmap.assign(kBitmapWords, 0);
+        for (size_t i = 0; i < chunk->entries.size(); ++i) {
+            const uint16_t offset = chunk->entries[i];
+            chunk->bitmap[offset / 64] |= 1ULL << (offset % 64);
+        }
+        std::vector<uint16_t>().swap(chunk->entries);
+    }
+
+    bool DiskLocSet::insert(const DiskLoc& loc) {
+        std::pair<ChunkMap::iterator, bool> inserted = _chunks.insert(
+            std::make_pair(chunkKey(loc), Chunk()));
+        Chunk& chunk = inserted.first->second;
+        const size_t memUsageBefore = inserted.second ? 0 : chunkMemUsage(chunk);
+        const uint16_t offset = chunkOffset(loc);
+
+        if (chunk.bitmap.empty()) {
+            std::vector<uint16_t>::iterator it = std::lower_bound(chunk.entries.begin(),
+                                                                  chunk.entries.end(),
+                                                                  offset);
+            if (chunk.entries.end() != it && *it == offset) {
+                return false;
+            }
+            chunk.entries.insert(it, offset);
+            if (chunk.entries.size() > kMaxArrayEntries) {
+                convertToBitmap(&chunk);
+            }
+        }
+        else {
+            if (bitmapTest(chunk.bitmap, offset)) {
+                return false;
+            }
+            chunk.bitmap[offset / 64] |= 1ULL << (offset % 64);
+        }
+
+        ++chunk.count;
+        ++_size;
+        _memUsage += chunkMemUsage(chunk) - memUsageBefore;
+        return true;
+    }
+
+    bool DiskLocSet::contains(const DiskLoc& loc) const {
+        ChunkMap::const_iterator it = _chunks.find(chunkKey(loc));
+        if (_chunks.end() == it) {
+            return false;
+        }
+
+        const Chunk& chunk = it->second;
+        const uint16_t offset = chunkOffset(loc);
+        if (chunk.bitmap.empty()) {
+            return std::binary_search(chunk.entries.begin(), chunk.entries.end(), offset);
+        }
+        return bitmapTest(chunk.bitmap, offset);
+    }
+
+    bool DiskLocSet::erase(const DiskLoc& loc) {
+        ChunkMap::iterator chunkIt = _chunks.find(chunkKey(loc));
+        if (_chunks.end() == chunkIt) {
+            return false;
+        }
+
+        Chunk& chunk = chunkIt->second;
+        const uint16_t offset = chunkOffset(loc);
+        if (chunk.bitmap.empty()) {
+            std::vector<uint16_t>::iterator it = std::lower_bound(chunk.entries.begin(),
+                                                                  chunk.entries.end(),
+                                                                  offset);
+            if (chunk.entries.end() == it || *it != offset) {
+                return false;
+            }
+            chunk.entries.erase(it);
+        }
+        else {
+            if (!bitmapTest(chunk.bitmap, offset)) {
+                return false;
+            }
+            chunk.bitmap[offset / 64] &= ~(1ULL << (offset % 64));
+        }
+
+        --chunk.count;
+        --_size;
+        if (0 == chunk.count) {
+            _memUsage -= chunkMemUsage(chunk);
+            _chunks.erase(chunkIt);
+        }
+        return true;
+    }
+
+    void DiskLocSet::clear() {
+        _chunks.clear();
+        _size = 0;
+        _memUsage = 0;
+    }
+
+    void DiskLocSet::swap(DiskLocSet& other) {
+        _chunks.swap(other._chunks);
+        std::swap(_size, other._size);
+        std::swap(_memUsage, other._memUsage);
+    }
+
+}  // namespace mongo
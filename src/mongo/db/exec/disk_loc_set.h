@@ -0,0 +1,116 @@
+// disk_loc_set.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/platform/cstdint.h"
+#include "mongo/platform/unordered_map.h"
+
+namespace mongo {
+
+    /**
+     * A set of DiskLocs, for the stages that dedup or intersect their results by DiskLoc.  It
+     * is much smaller than an unordered_set<DiskLoc>, whose nodes cost 30-40 bytes each.
+     *
+     * DiskLocs are grouped into chunks by their file and the high 16 bits of their offset.  A
+     * chunk keeps the low 16 bits of its members' offsets in a sorted array while it has at
+     * most kMaxArrayEntries members, and in a 64K-bit bitmap once it has more.  So a member
+     * costs at most two bytes, plus its share of the chunk's fixed overhead.
+     */
+    class DiskLocSet {
+    public:
+        DiskLocSet();
+
+        /**
+         * Adds 'loc'.  Returns false if it was already in the set.
+         */
+        bool insert(const DiskLoc& loc);
+
+        bool contains(const DiskLoc& loc) const;
+
+        /**
+         * Removes 'loc'.  Returns false if it wasn't in the set.
+         */
+        bool erase(const DiskLoc& loc);
+
+        void clear();
+
+        void swap(DiskLocSet& other);
+
+        size_t size() const { return _size; }
+
+        bool empty() const { return 0 == _size; }
+
+        /**
+         * Returns the approximate number of bytes the set uses.
+         */
+        size_t getMemUsage() const { return _memUsage; }
+
+        // A chunk holding more members than this switches from a sorted array to a bitmap,
+        // which is then the smaller of the two.
+        static const size_t kMaxArrayEntries;
+
+    private:
+        struct Chunk {
+            Chunk() : count(0) { }
+
+            size_t count;
+
+            // Only one of these is in use: 'entries' while count <= kMaxArrayEntries, and
+            // 'bitmap' after.
+            std::vector<uint16_t> entries;
+            std::vector<uint64_t> bitmap;
+        };
+
+        typedef unordered_map<uint64_t, Chunk> ChunkMap;
+
+        static uint64_t chunkKey(const DiskLoc& loc);
+
+        static uint16_t chunkOffset(const DiskLoc& loc);
+
+        static size_t chunkMemUsage(const Chunk& chunk);
+
+        /**
+         * Moves the entries of 'chunk' into a bitmap.
+         */
+        static void convertToBitmap(Chunk* chunk);
+
+        ChunkMap _chunks;
+
+        // The number of DiskLocs in the set.
+        size_t _size;
+
+        size_t _memUsage;
+    };
+
+}  // namespace mongo
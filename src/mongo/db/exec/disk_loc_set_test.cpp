@@ -0,0 +1,140 @@
+// disk_loc_set_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+/**
+ * This file contains tests for mongo/db/exec/disk_loc_set.cpp
+ */
+
+#include "mongo/db/exec/disk_loc_set.h"
+#include "mongo/platform/unordered_set.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    TEST(DiskLocSetTest, InsertContainsErase) {
+        DiskLocSet set;
+        ASSERT_TRUE(set.empty());
+        ASSERT_FALSE(set.contains(DiskLoc(0, 8)));
+
+        ASSERT_TRUE(set.insert(DiskLoc(0, 8)));
+        ASSERT_FALSE(set.insert(DiskLoc(0, 8)));
+        ASSERT_TRUE(set.insert(DiskLoc(1, 8)));
+        ASSERT_TRUE(set.insert(DiskLoc(0, 8 + (1 << 16))));
+        ASSERT_EQUALS(3U, set.size());
+
+        ASSERT_TRUE(set.contains(DiskLoc(0, 8)));
+        ASSERT_TRUE(set.contains(DiskLoc(1, 8)));
+        ASSERT_TRUE(set.contains(DiskLoc(0, 8 + (1 << 16))));
+        ASSERT_FALSE(set.contains(DiskLoc(0, 9)));
+
+        ASSERT_TRUE(set.erase(DiskLoc(0, 8)));
+        ASSERT_FALSE(set.erase(DiskLoc(0, 8)));
+        ASSERT_FALSE(set.contains(DiskLoc(0, 8)));
+        ASSERT_TRUE(set.contains(DiskLoc(1, 8)));
+        ASSERT_EQUALS(2U, set.size());
+
+        set.clear();
+        ASSERT_TRUE(set.empty());
+        ASSERT_EQUALS(0U, set.getMemUsage());
+        ASSERT_FALSE(set.contains(DiskLoc(1, 8)));
+    }
+
+    TEST(DiskLocSetTest, NegativeFileAndOffset) {
+        DiskLocSet set;
+        ASSERT_TRUE(set.insert(DiskLoc(-2, -1)));
+        ASSERT_TRUE(set.insert(DiskLoc(-1, 0)));
+        ASSERT_TRUE(set.contains(DiskLoc(-2, -1)));
+        ASSERT_TRUE(set.contains(DiskLoc(-1, 0)));
+        ASSERT_FALSE(set.contains(DiskLoc(-1, -1)));
+    }
+
+    // Enough DiskLocs in one chunk to move it from a sorted array to a bitmap, and back out.
+    TEST(DiskLocSetTest, DenseChunk) {
+        DiskLocSet set;
+        const int numLocs = 3 * DiskLocSet::kMaxArrayEntries;
+        for (int i = 0; i < numLocs; ++i) {
+            ASSERT_TRUE(set.insert(DiskLoc(3, (i * 7919) % (1 << 16))));
+        }
+        ASSERT_EQUALS(static_cast<size_t>(numLocs), set.size());
+
+        // About one bit per possible offset.
+        ASSERT_LESS_THAN(set.getMemUsage(), 9000U);
+
+        for (int i = 0; i < numLocs; ++i) {
+            ASSERT_TRUE(set.contains(DiskLoc(3, (i * 7919) % (1 << 16))));
+            ASSERT_FALSE(set.insert(DiskLoc(3, (i * 7919) % (1 << 16))));
+        }
+        ASSERT_FALSE(set.contains(DiskLoc(3, (numLocs * 7919) % (1 << 16))));
+
+        for (int i = 0; i < numLocs; ++i) {
+            ASSERT_TRUE(set.erase(DiskLoc(3, (i * 7919) % (1 << 16))));
+        }
+        ASSERT_TRUE(set.empty());
+        ASSERT_EQUALS(0U, set.getMemUsage());
+    }
+
+    // Agrees with an unordered_set over a mix of sparse and dense chunks.
+    TEST(DiskLocSetTest, MatchesUnorderedSet) {
+        DiskLocSet set;
+        unordered_set<DiskLoc, DiskLoc::Hasher> expected;
+        for (int i = 0; i < 100000; ++i) {
+            DiskLoc loc(i % 3, static_cast<int>((i * 104729LL) % (1 << 20)));
+            ASSERT_EQUALS(expected.insert(loc).second, set.insert(loc));
+            if (0 == i % 5) {
+                DiskLoc toErase(i % 7, (i * 31) % (1 << 20));
+                ASSERT_EQUALS(expected.erase(toErase) > 0, set.erase(toErase));
+            }
+        }
+        ASSERT_EQUALS(expected.size(), set.size());
+        for (int i = 0; i < 100000; ++i) {
+            DiskLoc loc(i % 3, static_cast<int>((i * 104729LL) % (1 << 20)));
+            ASSERT_EQUALS(expected.count(loc) > 0, set.contains(loc));
+        }
+    }
+
+    TEST(DiskLocSetTest, Swap) {
+        DiskLocSet a;
+        DiskLocSet b;
+        a.insert(DiskLoc(0, 1));
+        a.insert(DiskLoc(0, 2));
+        b.insert(DiskLoc(0, 3));
+
+        const size_t aMemUsage = a.getMemUsage();
+        a.swap(b);
+        ASSERT_EQUALS(1U, a.size());
+        ASSERT_EQUALS(2U, b.size());
+        ASSERT_TRUE(a.contains(DiskLoc(0, 3)));
+        ASSERT_TRUE(b.contains(DiskLoc(0, 1)));
+        ASSERT_EQUALS(aMemUsage, b.getMemUsage());
+    }
+
+}  // namespace
@@ -108,7 +108,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (INITIALIZING == _scanState) {
             invariant(NULL == _btreeCursor.get());
@@ -128,6 +128,7 @@ namespace mongo {
             // Grab the next (key, value) from the index.
             BSONObj ownedKeyObj = _btreeCursor->getKey().getOwned();
             DiskLoc loc = _btreeCursor->getValue();
+            _commonStats.keyBytesExamined += ownedKeyObj.objsize();
 
             // The underlying IndexCursor points at the *next* thing we want to return.  We do this
             // so that if we're scanning an index looking for docs to delete we don't continually
@@ -28,10 +28,13 @@
 
 #include "mongo/db/exec/fetch.h"
 
+#include <algorithm>
+
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/record_fetcher.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/mongoutils/str.h"
@@ -52,7 +55,13 @@ namespace mongo {
           _child(child),
           _filter(filter),
           _idBeingPagedIn(WorkingSet::INVALID_ID),
-          _commonStats(kStageType) { }
+          _batchSize(std::max(0, internalQueryExecFetchBatchSize)),
+          _batchPrefetched(false),
+          _commonStats(kStageType) {
+        if (NULL != _filter && internalQueryExecCompileFilters) {
+            _compiledFilter.reset(CompiledMatcher::compile(_filter));
+        }
+    }
 
     FetchStage::~FetchStage() { }
 
@@ -63,6 +72,10 @@ namespace mongo {
             return false;
         }
 
+        if (!_batch.empty()) {
+            return false;
+        }
+
         return _child->isEOF();
     }
 
@@ -70,7 +83,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (isEOF()) { return PlanStage::IS_EOF; }
 
@@ -81,51 +94,47 @@ namespace mongo {
             WorkingSetMember* member = _ws->get(id);
 
             WorkingSetCommon::completeFetch(_txn, member, _collection);
+            _commonStats.docBytesExamined += member->obj.objsize();
 
             return returnIfMatches(member, id, out);
         }
 
+        // Return the next buffered result once the batch is full or there's nothing more to
+        // add to it.
+        if (!_batch.empty()
+            && (_batchPrefetched || _batch.size() >= _batchSize || _child->isEOF())) {
+            if (!_batchPrefetched) {
+                prefetchBatch();
+                _batchPrefetched = true;
+            }
+
+            WorkingSetID id = _batch.front();
+            _batch.pop_front();
+            if (_batch.empty()) {
+                _batchPrefetched = false;
+            }
+
+            return fetch(id, out);
+        }
+
         // If we're here, we're not waiting for a DiskLoc to be fetched.  Get another to-be-fetched
         // result from our child.
         WorkingSetID id = WorkingSet::INVALID_ID;
         StageState status = _child->work(&id);
 
         if (PlanStage::ADVANCED == status) {
-            WorkingSetMember* member = _ws->get(id);
-
-            // If there's an obj there, there is no fetching to perform.
-            if (member->hasObj()) {
-                ++_specificStats.alreadyHasObj;
-            }
-            else {
-                // We need a valid loc to fetch from and this is the only state that has one.
-                verify(WorkingSetMember::LOC_AND_IDX == member->state);
-                verify(member->hasLoc());
-
-                // We might need to retrieve 'nextLoc' from secondary storage, in which case we send
-                // a NEED_FETCH request up to the PlanExecutor.
-                if (!member->loc.isNull()) {
-                    std::auto_ptr<RecordFetcher> fetcher(
-                        _collection->documentNeedsFetch(_txn, member->loc));
-                    if (NULL != fetcher.get()) {
-                        // There's something to fetch. Hand the fetcher off to the WSM, and pass up
-                        // a fetch request.
-                        _idBeingPagedIn = id;
-                        member->setFetcher(fetcher.release());
-                        *out = id;
-                        _commonStats.needFetch++;
-                        return NEED_FETCH;
-                    }
-                }
-
-                // The doc is already in memory, so go ahead and grab it. Now we have a DiskLoc
-                // as well as an unowned object
-                member->obj = _collection->docFor(_txn, member->loc);
-                member->keyData.clear();
-                member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+            if (0 != _batchSize) {
+                _batch.push_back(id);
+                ++_commonStats.needTime;
+                return PlanStage::NEED_TIME;
             }
 
-            return returnIfMatches(member, id, out);
+            return fetch(id, out);
+        }
+        else if (PlanStage::IS_EOF == status && !_batch.empty()) {
+            // The rest of the batch is returned from the next call.
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
         }
         else if (PlanStage::FAILURE == status) {
             *out = id;
@@ -151,6 +160,65 @@ namespace mongo {
         return status;
     }
 
+    PlanStage::StageState FetchStage::fetch(WorkingSetID id, WorkingSetID* out) {
+        WorkingSetMember* member = _ws->get(id);
+
+        // If there's an obj there, there is no fetching to perform.
+        if (member->hasObj()) {
+            ++_specificStats.alreadyHasObj;
+        }
+        else {
+            // We need a valid loc to fetch from and this is the only state that has one.
+            verify(WorkingSetMember::LOC_AND_IDX == member->state);
+            verify(member->hasLoc());
+
+            // We might need to retrieve 'nextLoc' from secondary storage, in which case we send
+            // a NEED_FETCH request up to the PlanExecutor.
+            if (!member->loc.isNull()) {
+                std::auto_ptr<RecordFetcher> fetcher(
+                    _collection->documentNeedsFetch(_txn, member->loc));
+                if (NULL != fetcher.get()) {
+                    // There's something to fetch. Hand the fetcher off to the WSM, and pass up
+                    // a fetch request.
+                    _idBeingPagedIn = id;
+                    member->setFetcher(fetcher.release());
+                    *out = id;
+                    _commonStats.needFetch++;
+                    return NEED_FETCH;
+                }
+            }
+
+            // The doc is already in memory, so go ahead and grab it. Now we have a DiskLoc
+            // as well as an unowned object
+            member->obj = _collection->docFor(_txn, member->loc);
+            member->keyData.clear();
+            member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+            _commonStats.docBytesExamined += member->obj.objsize();
+        }
+
+        return returnIfMatches(member, id, out);
+    }
+
+    void FetchStage::prefetchBatch() {
+        std::vector<DiskLoc> locs;
+        for (size_t i = 0; i < _batch.size(); ++i) {
+            WorkingSetMember* member = _ws->get(_batch[i]);
+            if (!member->hasObj() && member->hasLoc() && !member->loc.isNull()) {
+                locs.push_back(member->loc);
+            }
+        }
+
+        if (locs.empty()) {
+            return;
+        }
+
+        std::sort(locs.begin(), locs.end());
+        _collection->prefetchDocuments(_txn, locs);
+
+        ++_specificStats.batchesPrefetched;
+        _specificStats.docsPrefetched += locs.size();
+    }
+
     void FetchStage::saveState() {
         ++_commonStats.yields;
         _child->saveState();
@@ -176,6 +244,15 @@ namespace mongo {
                 WorkingSetCommon::fetchAndInvalidateLoc(_txn, member, _collection);
             }
         }
+
+        // The same goes for the results we've buffered.
+        for (size_t i = 0; i < _batch.size(); ++i) {
+            WorkingSetMember* member = _ws->get(_batch[i]);
+            if (member->hasLoc() && (member->loc == dl)) {
+                WorkingSetCommon::fetchAndInvalidateLoc(_txn, member, _collection);
+                ++_specificStats.forcedFetches;
+            }
+        }
     }
 
     PlanStage::StageState FetchStage::returnIfMatches(WorkingSetMember* member,
@@ -183,7 +260,7 @@ namespace mongo {
                                                       WorkingSetID* out) {
         ++_specificStats.docsExamined;
 
-        if (Filter::passes(member, _filter)) {
+        if (Filter::passes(member, _filter, _compiledFilter.get())) {
             if (NULL != _filter) {
                 ++_specificStats.matchTested;
             }
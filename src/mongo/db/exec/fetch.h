@@ -28,8 +28,11 @@
 
 #pragma once
 
+#include <deque>
+
 #include "mongo/db/diskloc.h"
 #include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/matcher/compiled_matcher.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/expression.h"
 
@@ -41,6 +44,11 @@ namespace mongo {
      * In WorkingSetMember terms, it transitions from LOC_AND_IDX to LOC_AND_UNOWNED_OBJ by reading
      * the record at the provided loc.  Returns verbatim any data that already has an object.
      *
+     * If internalQueryExecFetchBatchSize is set, the child's results are buffered a batch at a
+     * time, and the documents of the whole batch are prefetched in DiskLoc order before they are
+     * fetched and returned in the child's order.  This turns the random reads of a fetch in index
+     * order into a more sequential pattern for data much larger than memory.
+     *
      * Preconditions: Valid DiskLoc.
      */
     class FetchStage : public PlanStage {
@@ -74,6 +82,18 @@ namespace mongo {
 
     private:
 
+        /**
+         * Fetches the document of the member with id 'id' from the child, unless it already has
+         * one, and returns it if it passes our filter.
+         */
+        StageState fetch(WorkingSetID id, WorkingSetID* out);
+
+        /**
+         * Hints to the storage engine that the documents of the members in _batch are about to
+         * be fetched.
+         */
+        void prefetchBatch();
+
         /**
          * If the member (with id memberID) passes our filter, set *out to memberID and return that
          * ADVANCED.  Otherwise, free memberID and return NEED_TIME.
@@ -94,6 +114,9 @@ namespace mongo {
         // The filter is not owned by us.
         const MatchExpression* _filter;
 
+        // '_filter' compiled for faster evaluation, or NULL to interpret it.
+        scoped_ptr<CompiledMatcher> _compiledFilter;
+
         // If we want to return a DiskLoc and it points to something that's not in memory,
         // we return a "please page this in" result. We add a RecordFetcher given back to us by the
         // storage engine to the WSM. The RecordFetcher is used by the PlanExecutor when it handles
@@ -108,6 +131,14 @@ namespace mongo {
         // CollectionScan for when '_idBeingPagedIn' is invalidated before it can be returned.
         WorkingSetID _idBeingPagedIn;
 
+        // How many of the child's results to buffer before fetching them; 0 if we don't batch.
+        const size_t _batchSize;
+
+        // The child's buffered results, in the child's order.  Once _batchPrefetched, they are
+        // being fetched and returned and we don't work the child until they are all gone.
+        std::deque<WorkingSetID> _batch;
+        bool _batchPrefetched;
+
         // Stats
         CommonStats _commonStats;
         FetchStats _specificStats;
@@ -29,6 +29,7 @@
 #pragma once
 
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/matcher/compiled_matcher.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/matcher/matchable.h"
 
@@ -55,7 +56,7 @@ namespace mongo {
             // BSONElementIterator does some interesting things with arrays that I don't think
             // SimpleArrayElementIterator does.
             if (_wsm->hasObj()) {
-                return new BSONElementIterator(path, _wsm->obj);
+                return new BSONElementIterator(path, _wsm->obj, &_wsm->fieldIndex);
             }
 
             // NOTE: This (kind of) duplicates code in WorkingSetMember::getFieldDotted.
@@ -158,6 +159,21 @@ namespace mongo {
             return filter->matches(&doc, NULL);
         }
 
+        /**
+         * As above, but uses 'compiled', if not NULL, for members which have an object.
+         * 'compiled' must have been compiled from 'filter'.
+         */
+        static bool passes(WorkingSetMember* wsm,
+                           const MatchExpression* filter,
+                           const CompiledMatcher* compiled) {
+            if (NULL == filter) { return true; }
+            WorkingSetMatchableDocument doc(wsm);
+            if (NULL != compiled && wsm->hasObj()) {
+                return compiled->matches(wsm->obj, &doc, &wsm->fieldIndex);
+            }
+            return filter->matches(&doc, NULL);
+        }
+
         static bool passes(const BSONObj& keyData,
                            const BSONObj& keyPattern,
                            const MatchExpression* filter) {
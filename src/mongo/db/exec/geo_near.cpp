@@ -47,6 +47,7 @@
 #include "mongo/util/log.h"
 
 #include <algorithm>
+#include <cmath>
 
 namespace mongo {
 
@@ -60,6 +61,79 @@ namespace mongo {
 
     namespace {
 
+        // The number of results a search annulus should buffer.  Annuli buffering fewer than
+        // the minimum grow, those buffering more than the maximum shrink.
+        const long long kMinResultsPerInterval = 300;
+        const long long kMaxResultsPerInterval = 600;
+        const long long kTargetResultsPerInterval =
+            (kMinResultsPerInterval + kMaxResultsPerInterval) / 2;
+
+        // How much the width of one annulus may differ from the last one's.
+        const double kMaxBoundsIncrementGrowth = 8;
+
+        /**
+         * Returns the area between distances 'inner' and 'outer' from a point, in the plane or,
+         * for distances in meters, on the sphere of the earth.
+         */
+        double annulusArea(double inner, double outer, bool onSphere) {
+            if (!onSphere) {
+                return M_PI * (outer * outer - inner * inner);
+            }
+            const double r = kRadiusOfEarthInMeters;
+            return 2 * M_PI * r * r * (cos(inner / r) - cos(outer / r));
+        }
+
+        /**
+         * Returns the distance from the center at which the annulus starting at 'inner' covers
+         * 'area'.  See annulusArea() above.
+         */
+        double outerDistanceForArea(double inner, double area, bool onSphere) {
+            if (!onSphere) {
+                return sqrt(inner * inner + area / M_PI);
+            }
+            const double r = kRadiusOfEarthInMeters;
+            const double cosOuter = cos(inner / r) - area / (2 * M_PI * r * r);
+            if (cosOuter <= -1) {
+                return kMaxEarthDistanceInMeters;
+            }
+            return r * acos(cosOuter);
+        }
+
+        /**
+         * Returns the width of the annulus to search after the one described by 'lastInterval',
+         * which was 'lastIncrement' wide.
+         *
+         * Annuli that buffered too few or too many results are resized so that, if results are
+         * as dense in the next annulus as they were in the last one, the next one buffers
+         * kTargetResultsPerInterval of them.
+         */
+        double nextBoundsIncrement(const IntervalStats& lastInterval,
+                                   double lastIncrement,
+                                   bool onSphere) {
+            const long long numResults = lastInterval.numResultsBuffered;
+            if (numResults >= kMinResultsPerInterval && numResults <= kMaxResultsPerInterval) {
+                return lastIncrement;
+            }
+
+            if (!internalGeoNearQueryDensityGrowth || 0 == numResults) {
+                return numResults < kMinResultsPerInterval ? lastIncrement * 2
+                                                           : lastIncrement / 2;
+            }
+
+            const double inner = max(0.0, lastInterval.minDistanceAllowed);
+            const double outer = lastInterval.maxDistanceAllowed;
+            const double area = annulusArea(inner, outer, onSphere);
+            if (!(area > 0)) {
+                return numResults < kMinResultsPerInterval ? lastIncrement * 2
+                                                           : lastIncrement / 2;
+            }
+
+            const double targetArea = area * kTargetResultsPerInterval / numResults;
+            const double increment = outerDistanceForArea(outer, targetArea, onSphere) - outer;
+            return min(max(increment, lastIncrement / kMaxBoundsIncrementGrowth),
+                       lastIncrement * kMaxBoundsIncrementGrowth);
+        }
+
         /**
          * Structure that holds BSON addresses (BSONElements) and the corresponding geometry parsed
          * at those locations.
@@ -652,10 +726,7 @@ namespace mongo {
             const IntervalStats& lastIntervalStats = stats->intervalStats.back();
 
             // TODO: Generally we want small numbers of results fast, then larger numbers later
-            if (lastIntervalStats.numResultsBuffered < 300)
-                _boundsIncrement *= 2;
-            else if (lastIntervalStats.numResultsBuffered > 600)
-                _boundsIncrement /= 2;
+            _boundsIncrement = nextBoundsIncrement(lastIntervalStats, _boundsIncrement, false);
         }
 
         _boundsIncrement = max(_boundsIncrement,
@@ -1112,10 +1183,7 @@ namespace mongo {
             const IntervalStats& lastIntervalStats = stats->intervalStats.back();
 
             // TODO: Generally we want small numbers of results fast, then larger numbers later
-            if (lastIntervalStats.numResultsBuffered < 300)
-                _boundsIncrement *= 2;
-            else if (lastIntervalStats.numResultsBuffered > 600)
-                _boundsIncrement /= 2;
+            _boundsIncrement = nextBoundsIncrement(lastIntervalStats, _boundsIncrement, true);
         }
 
         invariant(_boundsIncrement > 0.0);
@@ -175,7 +175,7 @@ namespace mongo {
     PlanStage::StageState GroupStage::work(WorkingSetID* out) {
         ++_commonStats.works;
 
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (isEOF()) { return PlanStage::IS_EOF; }
 
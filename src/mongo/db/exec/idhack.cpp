@@ -35,8 +35,12 @@
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/exec/working_set_computed_data.h"
+#include "mongo/db/global_environment_experiment.h"
 #include "mongo/db/index/btree_access_method.h"
+#include "mongo/db/query/id_lookup_cache.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/record_fetcher.h"
+#include "mongo/db/storage/record_store.h"
 #include "mongo/s/d_state.h"
 
 namespace mongo {
@@ -90,7 +94,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (_killed) { return PlanStage::DEAD; }
         if (_done) { return PlanStage::IS_EOF; }
@@ -101,34 +105,51 @@ namespace mongo {
             WorkingSetMember* member = _workingSet->get(id);
 
             WorkingSetCommon::completeFetch(_txn, member, _collection);
+            _commonStats.docBytesExamined += member->obj.objsize();
 
             return advance(id, member, out);
         }
 
-        // Use the index catalog to get the id index.
-        const IndexCatalog* catalog = _collection->getIndexCatalog();
+        DiskLoc loc;
+        BSONObj cachedDoc;
+        const bool useIdCache = internalQueryIdLookupCacheSize > 0;
 
-        // Find the index we use.
-        IndexDescriptor* idDesc = catalog->findIdIndex(_txn);
-        if (NULL == idDesc) {
-            _done = true;
-            return PlanStage::IS_EOF;
+        if (useIdCache && findCachedLoc(&loc, &cachedDoc)) {
+            _specificStats.locFromCache = true;
         }
+        else {
+            // Use the index catalog to get the id index.
+            const IndexCatalog* catalog = _collection->getIndexCatalog();
+
+            // Find the index we use.
+            IndexDescriptor* idDesc = catalog->findIdIndex(_txn);
+            if (NULL == idDesc) {
+                _done = true;
+                return PlanStage::IS_EOF;
+            }
+
+            // This may not be valid always.  See SERVER-12397.
+            const BtreeBasedAccessMethod* accessMethod =
+                static_cast<const BtreeBasedAccessMethod*>(catalog->getIndex(idDesc));
 
-        // This may not be valid always.  See SERVER-12397.
-        const BtreeBasedAccessMethod* accessMethod =
-            static_cast<const BtreeBasedAccessMethod*>(catalog->getIndex(idDesc));
+            // Look up the key by going directly to the Btree.
+            loc = accessMethod->findSingle(_txn, _key);
 
-        // Look up the key by going directly to the Btree.
-        DiskLoc loc = accessMethod->findSingle(_txn, _key);
+            // Key not found.
+            if (loc.isNull()) {
+                _done = true;
+                return PlanStage::IS_EOF;
+            }
+
+            ++_specificStats.keysExamined;
 
-        // Key not found.
-        if (loc.isNull()) {
-            _done = true;
-            return PlanStage::IS_EOF;
+            // Don't remember where a document is from inside a write, which may yet roll back.
+            if (useIdCache && !_txn->lockState()->isWriteLocked()) {
+                _collection->infoCache()->getIdLookupCache()->add(
+                    _key, loc, internalQueryIdLookupCacheSize);
+            }
         }
 
-        ++_specificStats.keysExamined;
         ++_specificStats.docsExamined;
 
         // Create a new WSM for the result document.
@@ -137,6 +158,13 @@ namespace mongo {
         member->loc = loc;
         member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
 
+        if (!cachedDoc.isEmpty()) {
+            // Checking the cache entry already read the document.
+            member->obj = cachedDoc;
+            _commonStats.docBytesExamined += member->obj.objsize();
+            return advance(id, member, out);
+        }
+
         // We may need to request a yield while we fetch the document.
         std::auto_ptr<RecordFetcher> fetcher(_collection->documentNeedsFetch(_txn, loc));
         if (NULL != fetcher.get()) {
@@ -151,9 +179,41 @@ namespace mongo {
 
         // The doc was already in memory, so we go ahead and return it.
         member->obj = _collection->docFor(_txn, member->loc);
+        _commonStats.docBytesExamined += member->obj.objsize();
         return advance(id, member, out);
     }
 
+    bool IDHackStage::findCachedLoc(DiskLoc* locOut, BSONObj* docOut) {
+        IdLookupCache* idCache = _collection->infoCache()->getIdLookupCache();
+
+        DiskLoc loc;
+        if (!idCache->find(_key, &loc)) {
+            return false;
+        }
+
+        if (supportsDocLocking()) {
+            // Writes don't exclude us, so the entry may be for a document deleted or not yet
+            // visible in our snapshot.  DiskLocs aren't reused by these engines, so the document
+            // is ours if our snapshot has it there with the right _id.
+            RecordData data;
+            if (!_collection->getRecordStore()->findRecord(_txn, loc, &data)) {
+                idCache->invalidate(loc);
+                return false;
+            }
+
+            BSONObj doc = data.toBson();
+            if (0 != doc["_id"].woCompare(_key.firstElement(), false)) {
+                idCache->invalidate(loc);
+                return false;
+            }
+
+            *docOut = doc;
+        }
+
+        *locOut = loc;
+        return true;
+    }
+
     PlanStage::StageState IDHackStage::advance(WorkingSetID id,
                                                WorkingSetMember* member,
                                                WorkingSetID* out) {
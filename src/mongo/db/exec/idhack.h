@@ -75,6 +75,13 @@ namespace mongo {
         static const char* kStageType;
 
     private:
+        /**
+         * Looks up where the document with our _id is in the collection's IdLookupCache.  With
+         * a storage engine which locks documents the entry is checked against the record store,
+         * and the document found there is stored in 'docOut'; otherwise 'docOut' is untouched.
+         */
+        bool findCachedLoc(DiskLoc* locOut, BSONObj* docOut);
+
         /**
          * Marks this stage as done, optionally adds key metadata, and returns PlanStage::ADVANCED.
          *
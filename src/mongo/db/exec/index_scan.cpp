@@ -30,6 +30,7 @@
 
 #include "mongo/db/exec/index_scan.h"
 
+#include "mongo/db/exec/disk_loc_bloom_filter.h"
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set_computed_data.h"
@@ -63,6 +64,7 @@ namespace mongo {
           _scanState(INITIALIZING),
           _filter(filter),
           _shouldDedup(true),
+          _locFilter(NULL),
           _params(params),
           _btreeCursor(NULL),
           _commonStats(kStageType) {
@@ -150,7 +152,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (INITIALIZING == _scanState) {
             invariant(NULL == _indexCursor.get());
@@ -170,6 +172,17 @@ namespace mongo {
             // Grab the next (key, value) from the index.
             BSONObj keyObj = _indexCursor->getKey();
             DiskLoc loc = _indexCursor->getValue();
+            _commonStats.keyBytesExamined += keyObj.objsize();
+
+            if (NULL != _locFilter && !_locFilter->mayContain(loc)) {
+                // Whoever set the filter has no use for this DiskLoc; skip it without looking
+                // at or copying the key.
+                _indexCursor->next();
+                _scanState = CHECKING_END;
+                ++_specificStats.locsFiltered;
+                ++_commonStats.needTime;
+                return PlanStage::NEED_TIME;
+            }
 
             bool filterPasses = Filter::passes(keyObj, _keyPattern, _filter);
             if ( filterPasses ) {
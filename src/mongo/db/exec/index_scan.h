@@ -39,6 +39,7 @@
 
 namespace mongo {
 
+    class DiskLocBloomFilter;
     class IndexAccessMethod;
     class IndexCursor;
     class IndexDescriptor;
@@ -116,6 +117,13 @@ namespace mongo {
 
         virtual StageType stageType() const { return STAGE_IXSCAN; }
 
+        /**
+         * Skip index keys whose DiskLoc 'filter' says is definitely not wanted, before the key
+         * filter is applied or a WorkingSetMember is allocated.  'filter' is not owned and must
+         * outlive the scan, or be replaced with NULL.
+         */
+        void setDiskLocFilter(const DiskLocBloomFilter* filter) { _locFilter = filter; }
+
         virtual PlanStageStats* getStats();
 
         virtual const CommonStats* getCommonStats();
@@ -156,6 +164,9 @@ namespace mongo {
         bool _shouldDedup;
         unordered_set<DiskLoc, DiskLoc::Hasher> _returned;
 
+        // If non-NULL, keys whose DiskLoc this doesn't contain are skipped.  Not owned by us.
+        const DiskLocBloomFilter* _locFilter;
+
         // For yielding.
         BSONObj _savedKey;
         DiskLoc _savedLoc;
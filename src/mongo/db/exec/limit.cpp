@@ -28,6 +28,8 @@
 
 #include "mongo/db/exec/limit.h"
 
+#include <algorithm>
+
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/util/mongoutils/str.h"
@@ -48,7 +50,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (0 == _numToReturn) {
             // We've returned as many results as we're limited to.
@@ -88,6 +90,53 @@ namespace mongo {
         return status;
     }
 
+    PlanStage::StageState LimitStage::workBatch(size_t maxWorks,
+                                                std::vector<WorkingSetID>* results,
+                                                size_t* worksDone,
+                                                WorkingSetID* out) {
+        // Adds the amount of time taken by workBatch() to executionTimeMillis.
+        ScopedTimer timer(&_commonStats);
+
+        if (0 == _numToReturn) {
+            ++_commonStats.works;
+            *worksDone = 1;
+            return PlanStage::IS_EOF;
+        }
+
+        // Each unit of work produces at most one result, so capping the child's works at the
+        // number of results left means we never overshoot the limit.
+        const size_t numResults = results->size();
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        StageState status = _child->workBatch(std::min(maxWorks,
+                                                       static_cast<size_t>(_numToReturn)),
+                                              results,
+                                              worksDone,
+                                              &id);
+
+        const size_t produced = results->size() - numResults;
+        const bool stopped = (PlanStage::ADVANCED != status && PlanStage::NEED_TIME != status);
+        _numToReturn -= produced;
+        _commonStats.works += *worksDone;
+        _commonStats.advanced += produced;
+        _commonStats.needTime += *worksDone - produced - (stopped ? 1 : 0);
+
+        if (PlanStage::FAILURE == status) {
+            *out = id;
+            if (WorkingSet::INVALID_ID == id) {
+                mongoutils::str::stream ss;
+                ss << "limit stage failed to read in results from child";
+                Status status(ErrorCodes::InternalError, ss);
+                *out = WorkingSetCommon::allocateStatusMember( _ws, status);
+            }
+        }
+        else if (PlanStage::NEED_FETCH == status) {
+            ++_commonStats.needFetch;
+            *out = id;
+        }
+
+        return status;
+    }
+
     void LimitStage::saveState() {
         ++_commonStats.yields;
         _child->saveState();
@@ -48,6 +48,10 @@ namespace mongo {
 
         virtual bool isEOF();
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t maxWorks,
+                                     std::vector<WorkingSetID>* results,
+                                     size_t* worksDone,
+                                     WorkingSetID* out);
 
         virtual void saveState();
         virtual void restoreState(OperationContext* opCtx);
@@ -55,7 +55,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (isEOF()) { return PlanStage::IS_EOF; }
 
@@ -73,18 +73,14 @@ namespace mongo {
             if (_dedup && member->hasLoc()) {
                 ++_specificStats.dupsTested;
 
-                // ...and we've seen the DiskLoc before
-                if (_seen.end() != _seen.find(member->loc)) {
+                // ...and we've seen the DiskLoc before (otherwise, note that we've seen it)
+                if (!_seen.insert(member->loc)) {
                     // ...drop it.
                     ++_specificStats.dupsDropped;
                     _ws->free(id);
                     ++_commonStats.needTime;
                     return PlanStage::NEED_TIME;
                 }
-                else {
-                    // Otherwise, note that we've seen it.
-                    _seen.insert(member->loc);
-                }
             }
 
             if (Filter::passes(member, _filter)) {
@@ -167,10 +163,8 @@ namespace mongo {
         // If we see DL again it is not the same record as it once was so we still want to
         // return it.
         if (_dedup && INVALIDATION_DELETION == type) {
-            unordered_set<DiskLoc, DiskLoc::Hasher>::iterator it = _seen.find(dl);
-            if (_seen.end() != it) {
+            if (_seen.erase(dl)) {
                 ++_specificStats.locsForgotten;
-                _seen.erase(dl);
             }
         }
     }
@@ -181,6 +175,7 @@ namespace mongo {
 
     PlanStageStats* OrStage::getStats() {
         _commonStats.isEOF = isEOF();
+        _specificStats.memUsage = _seen.getMemUsage();
 
         // Add a BSON representation of the filter to the stats tree, if there is one.
         if (NULL != _filter) {
@@ -29,10 +29,10 @@
 #pragma once
 
 #include "mongo/db/diskloc.h"
+#include "mongo/db/exec/disk_loc_set.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/expression.h"
-#include "mongo/platform/unordered_set.h"
 
 namespace mongo {
 
@@ -87,7 +87,7 @@ namespace mongo {
         bool _dedup;
 
         // Which DiskLocs have we returned?
-        unordered_set<DiskLoc, DiskLoc::Hasher> _seen;
+        DiskLocSet _seen;
 
         // Stats
         CommonStats _commonStats;
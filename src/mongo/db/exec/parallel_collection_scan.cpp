@@ -0,0 +1,353 @@
+// parallel_collection_scan.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/parallel_collection_scan.h"
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/exec/scoped_timer.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace {
+
+        // How many records one task scans from its range in a round.
+        const size_t kRecordsPerTask = 1024;
+
+        // When returning results in order, a range that isn't being returned from yet stops
+        // scanning once it has this many matches waiting.
+        const size_t kMaxBufferedPerRange = 4 * kRecordsPerTask;
+
+    }  // namespace
+
+    // static
+    const char* ParallelCollectionScanStage::kStageType = "PARALLEL_COLLSCAN";
+
+    ParallelCollectionScanStage::ParallelCollectionScanStage(OperationContext* txn,
+                                                             const Collection* collection,
+                                                             WorkingSet* ws,
+                                                             const MatchExpression* filter,
+                                                             bool ordered,
+                                                             int numThreads)
+        : _txn(txn),
+          _collection(collection),
+          _ws(ws),
+          _filter(filter),
+          _ordered(ordered),
+          _numThreads(std::max(1, numThreads)),
+          _initialized(false),
+          _isDead(false),
+          _nextRange(0),
+          _tasksRemaining(0),
+          _commonStats(kStageType) {
+        _specificStats.direction = 1;
+    }
+
+    ParallelCollectionScanStage::~ParallelCollectionScanStage() { }
+
+    // static
+    bool ParallelCollectionScanStage::canParallelize(const MatchExpression* filter) {
+        if (NULL == filter) {
+            return true;
+        }
+        if (MatchExpression::WHERE == filter->matchType()) {
+            return false;
+        }
+        for (size_t i = 0; i < filter->numChildren(); ++i) {
+            if (!canParallelize(filter->getChild(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    PlanStage::StageState ParallelCollectionScanStage::work(WorkingSetID* out) {
+        ++_commonStats.works;
+
+        // Adds the amount of time taken by work() to executionTimeMillis.
+        ScopedTimer timer(&_commonStats);
+
+        if (_isDead) { return PlanStage::DEAD; }
+
+        if (!_initialized) {
+            if (NULL == _collection) {
+                _isDead = true;
+                return PlanStage::DEAD;
+            }
+
+            _iterators.mutableVector() = _collection->getManyIterators(_txn);
+            _ranges.resize(_iterators.size());
+            for (size_t i = 0; i < _iterators.size(); ++i) {
+                _ranges[i].iter = _iterators[i];
+            }
+
+            const int numThreads = std::min(_numThreads, static_cast<int>(_ranges.size()));
+            if (numThreads > 1) {
+                _pool.reset(new ThreadPool(numThreads, "parallelCollScan"));
+            }
+
+            _initialized = true;
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+
+        DiskLoc loc;
+        if (nextMatch(&loc)) {
+            WorkingSetID id = _ws->allocate();
+            WorkingSetMember* member = _ws->get(id);
+            member->loc = loc;
+            member->obj = _collection->docFor(_txn, loc);
+            member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+            _commonStats.docBytesExamined += member->obj.objsize();
+
+            *out = id;
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
+        if (isEOF()) {
+            return PlanStage::IS_EOF;
+        }
+
+        Status status = runRound();
+        if (!status.isOK()) {
+            *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+            return PlanStage::FAILURE;
+        }
+
+        ++_commonStats.needTime;
+        return PlanStage::NEED_TIME;
+    }
+
+    bool ParallelCollectionScanStage::nextMatch(DiskLoc* out) {
+        if (_ordered) {
+            for (; _nextRange < _ranges.size(); ++_nextRange) {
+                Range& range = _ranges[_nextRange];
+                if (!range.matches.empty()) {
+                    *out = range.matches.front();
+                    range.matches.pop_front();
+                    return true;
+                }
+                if (!range.done) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        for (size_t n = 0; n < _ranges.size(); ++n) {
+            Range& range = _ranges[(_nextRange + n) % _ranges.size()];
+            if (!range.matches.empty()) {
+                *out = range.matches.front();
+                range.matches.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Status ParallelCollectionScanStage::runRound() {
+        // Pick the ranges to scan this round.
+        std::vector<size_t> toScan;
+        for (size_t n = 0; n < _ranges.size() && toScan.size() < size_t(_numThreads); ++n) {
+            const size_t i = _ordered ? _nextRange + n : (_nextRange + n) % _ranges.size();
+            if (i >= _ranges.size()) {
+                break;
+            }
+            const Range& range = _ranges[i];
+            if (range.done) {
+                continue;
+            }
+            if (_ordered && i != _nextRange && range.matches.size() >= kMaxBufferedPerRange) {
+                continue;
+            }
+            toScan.push_back(i);
+        }
+
+        if (!_ordered && !_ranges.empty()) {
+            _nextRange = (_nextRange + 1) % _ranges.size();
+        }
+
+        if (NULL == _pool.get() || toScan.size() == 1) {
+            for (size_t n = 0; n < toScan.size(); ++n) {
+                scanRange(toScan[n]);
+            }
+        }
+        else {
+            {
+                boost::lock_guard<boost::mutex> lk(_roundMutex);
+                _tasksRemaining = toScan.size();
+            }
+            for (size_t n = 0; n < toScan.size(); ++n) {
+                _pool->schedule(&ParallelCollectionScanStage::scanRange, this, toScan[n]);
+            }
+
+            boost::unique_lock<boost::mutex> lk(_roundMutex);
+            while (_tasksRemaining > 0) {
+                _roundDone.wait(lk);
+            }
+        }
+
+        for (size_t n = 0; n < toScan.size(); ++n) {
+            const Range& range = _ranges[toScan[n]];
+            if (!range.status.isOK()) {
+                return range.status;
+            }
+        }
+        return Status::OK();
+    }
+
+    void ParallelCollectionScanStage::scanRange(size_t i) {
+        Range& range = _ranges[i];
+
+        try {
+            for (size_t n = 0; n < kRecordsPerTask; ++n) {
+                if (range.iter->isEOF()) {
+                    range.done = true;
+                    break;
+                }
+
+                DiskLoc loc = range.iter->getNext();
+                if (loc.isNull()) {
+                    range.done = true;
+                    break;
+                }
+
+                ++range.docsTested;
+                BSONObj obj = range.iter->dataFor(loc).toBson();
+                if (NULL == _filter || _filter->matchesBSON(obj, NULL)) {
+                    range.matches.push_back(loc);
+                }
+            }
+        }
+        catch (const DBException& e) {
+            range.status = e.toStatus();
+            range.done = true;
+        }
+        catch (const std::exception& e) {
+            range.status = Status(ErrorCodes::InternalError, e.what());
+            range.done = true;
+        }
+
+        if (NULL != _pool.get()) {
+            boost::lock_guard<boost::mutex> lk(_roundMutex);
+            if (--_tasksRemaining == 0) {
+                _roundDone.notify_one();
+            }
+        }
+    }
+
+    bool ParallelCollectionScanStage::isEOF() {
+        if (_isDead) { return true; }
+        if (!_initialized) { return false; }
+        for (size_t i = 0; i < _ranges.size(); ++i) {
+            if (!_ranges[i].done || !_ranges[i].matches.empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void ParallelCollectionScanStage::saveState() {
+        ++_commonStats.yields;
+        for (size_t i = 0; i < _iterators.size(); ++i) {
+            _iterators[i]->saveState();
+        }
+    }
+
+    void ParallelCollectionScanStage::restoreState(OperationContext* opCtx) {
+        ++_commonStats.unyields;
+        _txn = opCtx;
+        for (size_t i = 0; i < _iterators.size(); ++i) {
+            if (!_iterators[i]->restoreState(opCtx)) {
+                _isDead = true;
+            }
+        }
+    }
+
+    void ParallelCollectionScanStage::invalidate(const DiskLoc& dl, InvalidationType type) {
+        ++_commonStats.invalidates;
+
+        // Deleted records must not be returned.  For a mutated one we would have to match the
+        // filter again; dropping it is allowed too, as it was modified during a yield.
+        for (size_t i = 0; i < _ranges.size(); ++i) {
+            Range& range = _ranges[i];
+            if (INVALIDATION_DELETION == type) {
+                range.iter->invalidate(dl);
+            }
+            range.matches.erase(std::remove(range.matches.begin(), range.matches.end(), dl),
+                                range.matches.end());
+        }
+    }
+
+    std::vector<PlanStage*> ParallelCollectionScanStage::getChildren() const {
+        std::vector<PlanStage*> empty;
+        return empty;
+    }
+
+    PlanStageStats* ParallelCollectionScanStage::getStats() {
+        _commonStats.isEOF = isEOF();
+
+        // Add a BSON representation of the filter to the stats tree, if there is one.
+        if (NULL != _filter) {
+            BSONObjBuilder bob;
+            _filter->toBSON(&bob);
+            _commonStats.filter = bob.obj();
+        }
+
+        getSpecificStats();
+        std::auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats,
+                                                             STAGE_PARALLEL_COLLSCAN));
+        ret->specific.reset(_specificStats.clone());
+        return ret.release();
+    }
+
+    const CommonStats* ParallelCollectionScanStage::getCommonStats() {
+        return &_commonStats;
+    }
+
+    const SpecificStats* ParallelCollectionScanStage::getSpecificStats() {
+        _specificStats.docsTested = 0;
+        for (size_t i = 0; i < _ranges.size(); ++i) {
+            _specificStats.docsTested += _ranges[i].docsTested;
+        }
+        return &_specificStats;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,170 @@
+// parallel_collection_scan.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <vector>
+
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/base/status.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/matcher/expression.h"
+
+namespace mongo {
+
+    class Collection;
+    class OperationContext;
+    class RecordIterator;
+    class WorkingSet;
+
+    namespace threadpool {
+        class ThreadPool;
+    }
+
+    /**
+     * Scans a whole collection forwards like CollectionScan, but reads and filters the records
+     * on several threads at once.
+     *
+     * The record store is split into ranges with RecordStore::getManyIterators().  Each call to
+     * work() either returns a matching document found earlier or runs one round of scanning:
+     * up to 'numThreads' ranges are each advanced by a fixed number of records on a thread pool,
+     * and work() waits for all of them.  No scanning happens outside of work(), so the usual
+     * yielding and invalidation rules apply unchanged.  The matches are returned from the shared
+     * WorkingSet by the calling thread.
+     *
+     * If 'ordered' is true the results come out in the order of the ranges, which is natural
+     * order; later ranges stop scanning ahead once they have a set number of matches buffered.
+     * Otherwise results are returned from whichever range has them.
+     *
+     * Only useful when getManyIterators() returns more than one iterator, and only safe with a
+     * filter that can be evaluated concurrently; see canParallelize().
+     */
+    class ParallelCollectionScanStage : public PlanStage {
+    public:
+        ParallelCollectionScanStage(OperationContext* txn,
+                                    const Collection* collection,
+                                    WorkingSet* ws,
+                                    const MatchExpression* filter,
+                                    bool ordered,
+                                    int numThreads);
+
+        virtual ~ParallelCollectionScanStage();
+
+        /**
+         * Returns true if 'filter' (which may be NULL) can be matched from several threads at
+         * once.  $where cannot, as it runs in the operation's JavaScript scope.
+         */
+        static bool canParallelize(const MatchExpression* filter);
+
+        virtual StageState work(WorkingSetID* out);
+        virtual bool isEOF();
+
+        virtual void saveState();
+        virtual void restoreState(OperationContext* opCtx);
+        virtual void invalidate(const DiskLoc& dl, InvalidationType type);
+
+        virtual std::vector<PlanStage*> getChildren() const;
+
+        virtual StageType stageType() const { return STAGE_PARALLEL_COLLSCAN; }
+
+        virtual PlanStageStats* getStats();
+
+        virtual const CommonStats* getCommonStats();
+
+        virtual const SpecificStats* getSpecificStats();
+
+        static const char* kStageType;
+
+    private:
+        struct Range {
+            Range() : iter(NULL), done(false), docsTested(0), status(Status::OK()) { }
+
+            RecordIterator* iter; // owned by _iterators
+            std::deque<DiskLoc> matches;
+            bool done;
+            size_t docsTested;
+            Status status;
+        };
+
+        /**
+         * Takes the next buffered match, if any, respecting the order of ranges if required.
+         */
+        bool nextMatch(DiskLoc* out);
+
+        /**
+         * Scans the next records of a number of unfinished ranges in parallel.  Returns the
+         * first error any of them hit.
+         */
+        Status runRound();
+
+        /**
+         * Runs on the thread pool: scans up to a fixed number of records of _ranges[i].
+         */
+        void scanRange(size_t i);
+
+        // Transactional context for read locks. Not owned by us.
+        OperationContext* _txn;
+
+        // Not owned by us.
+        const Collection* _collection;
+        WorkingSet* _ws;
+        const MatchExpression* _filter;
+
+        const bool _ordered;
+        const int _numThreads;
+
+        bool _initialized;
+        bool _isDead;
+
+        OwnedPointerVector<RecordIterator> _iterators;
+        std::vector<Range> _ranges;
+
+        // Ordered: the range we are returning results from.  Unordered: the range to look at
+        // first, for both returning and scanning, so that all ranges make progress.
+        size_t _nextRange;
+
+        boost::scoped_ptr<threadpool::ThreadPool> _pool;
+
+        // Counts down the tasks of the current round.
+        boost::mutex _roundMutex;
+        boost::condition_variable _roundDone;
+        int _tasksRemaining; // guarded by _roundMutex
+
+        // Stats
+        CommonStats _commonStats;
+        CollectionScanStats _specificStats;
+    };
+
+}  // namespace mongo
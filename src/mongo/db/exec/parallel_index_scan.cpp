@@ -0,0 +1,337 @@
+// parallel_index_scan.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/parallel_index_scan.h"
+
+#include <boost/thread/locks.hpp>
+
+#include "mongo/db/exec/scoped_timer.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/util/concurrency/thread_pool.h"
+
+namespace mongo {
+
+    namespace {
+
+        // How many times one task works its scan in a round.
+        const size_t kWorksPerTask = 1024;
+
+        // When returning results in order, a range that isn't being returned from yet stops
+        // scanning once it has this many results waiting.
+        const size_t kMaxBufferedPerRange = 4 * kWorksPerTask;
+
+    }  // namespace
+
+    // static
+    const char* ParallelIndexScanStage::kStageType = "PARALLEL_IXSCAN";
+
+    ParallelIndexScanStage::ParallelIndexScanStage(OperationContext* txn,
+                                                   const IndexScanParams& params,
+                                                   const std::vector<IndexBounds>& ranges,
+                                                   WorkingSet* ws,
+                                                   const MatchExpression* filter,
+                                                   bool ordered)
+        : _ws(ws),
+          _ordered(ordered),
+          _dedup(!params.doNotDedup && params.descriptor->isMultikey(txn)),
+          _ranges(ranges.size()),
+          _nextRange(0),
+          _tasksRemaining(0),
+          _commonStats(kStageType) {
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            IndexScanParams rangeParams = params;
+            rangeParams.bounds = ranges[i];
+
+            WorkingSet* rangeWs = new WorkingSet();
+            _workingSets.push_back(rangeWs);
+            _scans.push_back(new IndexScan(txn, rangeParams, rangeWs, filter));
+        }
+
+        if (ranges.size() > 1) {
+            _pool.reset(new ThreadPool(ranges.size(), "parallelIndexScan"));
+        }
+    }
+
+    ParallelIndexScanStage::~ParallelIndexScanStage() { }
+
+    PlanStage::StageState ParallelIndexScanStage::work(WorkingSetID* out) {
+        ++_commonStats.works;
+
+        // Adds the amount of time taken by work() to executionTimeMillis.
+        ScopedTimer timer(&_commonStats);
+
+        Result result;
+        while (nextResult(&result)) {
+            if (_dedup) {
+                ++_specificStats.dupsTested;
+                if (!_returned.insert(result.loc).second) {
+                    ++_specificStats.dupsDropped;
+                    continue;
+                }
+            }
+
+            WorkingSetID id = _ws->allocate();
+            WorkingSetMember* member = _ws->get(id);
+            member->loc = result.loc;
+            member->keyData.swap(result.keyData);
+            member->state = WorkingSetMember::LOC_AND_IDX;
+
+            *out = id;
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
+        for (size_t i = 0; i < _ranges.size(); ++i) {
+            if (_ranges[i].dead) {
+                if (!_ranges[i].status.isOK()) {
+                    *out = WorkingSetCommon::allocateStatusMember(_ws, _ranges[i].status);
+                    return PlanStage::FAILURE;
+                }
+                return PlanStage::DEAD;
+            }
+        }
+
+        if (isEOF()) {
+            return PlanStage::IS_EOF;
+        }
+
+        Status status = runRound();
+        if (!status.isOK()) {
+            *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+            return PlanStage::FAILURE;
+        }
+
+        ++_commonStats.needTime;
+        return PlanStage::NEED_TIME;
+    }
+
+    bool ParallelIndexScanStage::nextResult(Result* out) {
+        if (_ordered) {
+            for (; _nextRange < _ranges.size(); ++_nextRange) {
+                Range& range = _ranges[_nextRange];
+                if (!range.results.empty()) {
+                    *out = range.results.front();
+                    range.results.pop_front();
+                    return true;
+                }
+                if (!range.done) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        for (size_t n = 0; n < _ranges.size(); ++n) {
+            Range& range = _ranges[(_nextRange + n) % _ranges.size()];
+            if (!range.results.empty()) {
+                *out = range.results.front();
+                range.results.pop_front();
+                _nextRange = (_nextRange + n + 1) % _ranges.size();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Status ParallelIndexScanStage::runRound() {
+        std::vector<size_t> toWork;
+        for (size_t i = 0; i < _ranges.size(); ++i) {
+            const Range& range = _ranges[i];
+            if (range.done) {
+                continue;
+            }
+            if (_ordered && i != _nextRange && range.results.size() >= kMaxBufferedPerRange) {
+                continue;
+            }
+            toWork.push_back(i);
+        }
+
+        if (NULL == _pool.get() || toWork.size() == 1) {
+            for (size_t n = 0; n < toWork.size(); ++n) {
+                workRange(toWork[n]);
+            }
+        }
+        else {
+            {
+                boost::lock_guard<boost::mutex> lk(_roundMutex);
+                _tasksRemaining = toWork.size();
+            }
+            for (size_t n = 0; n < toWork.size(); ++n) {
+                _pool->schedule(&ParallelIndexScanStage::workRange, this, toWork[n]);
+            }
+
+            boost::unique_lock<boost::mutex> lk(_roundMutex);
+            while (_tasksRemaining > 0) {
+                _roundDone.wait(lk);
+            }
+        }
+
+        return Status::OK();
+    }
+
+    void ParallelIndexScanStage::workRange(size_t i) {
+        WorkingSet* ws = _workingSets[i];
+        PlanStage* scan = _scans[i];
+        Range& range = _ranges[i];
+
+        try {
+            for (size_t n = 0; n < kWorksPerTask; ++n) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                StageState state = scan->work(&id);
+
+                if (PlanStage::ADVANCED == state) {
+                    // The keys point into the index, so they have to be copied before the
+                    // next unit of work.
+                    WorkingSetMember* member = ws->get(id);
+                    range.results.push_back(Result());
+                    Result& result = range.results.back();
+                    result.loc = member->loc;
+                    for (size_t k = 0; k < member->keyData.size(); ++k) {
+                        const IndexKeyDatum& datum = member->keyData[k];
+                        result.keyData.push_back(IndexKeyDatum(datum.indexKeyPattern,
+                                                               datum.keyData.getOwned()));
+                    }
+                    ws->free(id);
+                }
+                else if (PlanStage::IS_EOF == state) {
+                    range.done = true;
+                    break;
+                }
+                else if (PlanStage::NEED_TIME != state) {
+                    range.done = true;
+                    range.dead = true;
+                    if (PlanStage::FAILURE == state) {
+                        range.status = Status(ErrorCodes::InternalError,
+                                              "parallel index scan: scan of a range failed");
+                        if (WorkingSet::INVALID_ID != id) {
+                            range.status = WorkingSetCommon::getMemberStatus(*ws->get(id));
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+        catch (const DBException& e) {
+            range.status = e.toStatus();
+            range.done = true;
+            range.dead = true;
+        }
+        catch (const std::exception& e) {
+            range.status = Status(ErrorCodes::InternalError, e.what());
+            range.done = true;
+            range.dead = true;
+        }
+
+        if (NULL != _pool.get()) {
+            boost::lock_guard<boost::mutex> lk(_roundMutex);
+            if (--_tasksRemaining == 0) {
+                _roundDone.notify_one();
+            }
+        }
+    }
+
+    bool ParallelIndexScanStage::isEOF() {
+        for (size_t i = 0; i < _ranges.size(); ++i) {
+            if (!_ranges[i].done || !_ranges[i].results.empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void ParallelIndexScanStage::saveState() {
+        ++_commonStats.yields;
+        for (size_t i = 0; i < _scans.size(); ++i) {
+            _scans[i]->saveState();
+        }
+    }
+
+    void ParallelIndexScanStage::restoreState(OperationContext* opCtx) {
+        ++_commonStats.unyields;
+        for (size_t i = 0; i < _scans.size(); ++i) {
+            _scans[i]->restoreState(opCtx);
+        }
+    }
+
+    void ParallelIndexScanStage::invalidate(const DiskLoc& dl, InvalidationType type) {
+        ++_commonStats.invalidates;
+
+        for (size_t i = 0; i < _scans.size(); ++i) {
+            _scans[i]->invalidate(dl, type);
+        }
+
+        // Buffered keys for 'dl' may no longer be in the index.
+        for (size_t i = 0; i < _ranges.size(); ++i) {
+            std::deque<Result>& results = _ranges[i].results;
+            for (std::deque<Result>::iterator it = results.begin(); it != results.end(); ) {
+                if (it->loc == dl) {
+                    it = results.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+
+        // If we see this DiskLoc again, it may not be the same document it was before.
+        if (INVALIDATION_DELETION == type) {
+            _returned.erase(dl);
+        }
+    }
+
+    std::vector<PlanStage*> ParallelIndexScanStage::getChildren() const {
+        return _scans.vector();
+    }
+
+    PlanStageStats* ParallelIndexScanStage::getStats() {
+        _commonStats.isEOF = isEOF();
+
+        std::auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats,
+                                                             STAGE_PARALLEL_IXSCAN));
+        ret->specific.reset(new ParallelIndexScanStats(_specificStats));
+        for (size_t i = 0; i < _scans.size(); ++i) {
+            ret->children.push_back(_scans[i]->getStats());
+        }
+        return ret.release();
+    }
+
+    const CommonStats* ParallelIndexScanStage::getCommonStats() {
+        return &_commonStats;
+    }
+
+    const SpecificStats* ParallelIndexScanStage::getSpecificStats() {
+        return &_specificStats;
+    }
+
+}  // namespace mongo
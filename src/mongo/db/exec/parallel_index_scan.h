@@ -0,0 +1,165 @@
+// parallel_index_scan.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <vector>
+
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/base/status.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/exec/index_scan.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/platform/unordered_set.h"
+
+namespace mongo {
+
+    class OperationContext;
+
+    namespace threadpool {
+        class ThreadPool;
+    }
+
+    /**
+     * Scans an index over bounds which have been split into consecutive ranges (see
+     * IndexBoundsBuilder::splitRange()), running one IndexScan per range on its own thread.
+     *
+     * Every IndexScan works on a private WorkingSet.  Each call to work() either returns a key
+     * found earlier, copied into the shared WorkingSet, or runs one round: all the unfinished
+     * scans are worked a fixed number of times on a thread pool, and work() waits for them.
+     * Since nothing runs outside of work(), yielding and invalidation work as for any stage.
+     *
+     * The ranges are consecutive in scan order, so when 'ordered' is true results are returned
+     * range by range, which is the order a single IndexScan would have produced; ranges ahead
+     * of the current one stop once they have a set number of keys buffered.  Otherwise results
+     * are returned from whichever range has them.  Results are deduplicated across ranges when
+     * the index is multikey.
+     */
+    class ParallelIndexScanStage : public PlanStage {
+    public:
+        /**
+         * 'params' describes the whole scan; 'ranges' are its bounds, split up.
+         */
+        ParallelIndexScanStage(OperationContext* txn,
+                               const IndexScanParams& params,
+                               const std::vector<IndexBounds>& ranges,
+                               WorkingSet* ws,
+                               const MatchExpression* filter,
+                               bool ordered);
+
+        virtual ~ParallelIndexScanStage();
+
+        virtual StageState work(WorkingSetID* out);
+        virtual bool isEOF();
+
+        virtual void saveState();
+        virtual void restoreState(OperationContext* opCtx);
+        virtual void invalidate(const DiskLoc& dl, InvalidationType type);
+
+        virtual std::vector<PlanStage*> getChildren() const;
+
+        virtual StageType stageType() const { return STAGE_PARALLEL_IXSCAN; }
+
+        virtual PlanStageStats* getStats();
+
+        virtual const CommonStats* getCommonStats();
+
+        virtual const SpecificStats* getSpecificStats();
+
+        static const char* kStageType;
+
+    private:
+        // A key and its DiskLoc, owned, found by one of the scans.
+        struct Result {
+            DiskLoc loc;
+            std::vector<IndexKeyDatum> keyData;
+        };
+
+        struct Range {
+            Range() : done(false), dead(false), status(Status::OK()) { }
+
+            std::deque<Result> results;
+            bool done;
+
+            // Did the scan die, or fail with 'status'?
+            bool dead;
+            Status status;
+        };
+
+        /**
+         * Takes the next buffered result, if any, respecting the order of ranges if required.
+         */
+        bool nextResult(Result* out);
+
+        /**
+         * Works each unfinished scan in parallel.  Returns the first error any of them hit.
+         */
+        Status runRound();
+
+        /**
+         * Runs on the thread pool: works _scans[i] a fixed number of times.
+         */
+        void workRange(size_t i);
+
+        // Not owned by us.
+        WorkingSet* _ws;
+
+        const bool _ordered;
+
+        // Do we have to drop DiskLocs we've already returned?
+        bool _dedup;
+        unordered_set<DiskLoc, DiskLoc::Hasher> _returned;
+
+        // One scan, WorkingSet and Range for each of the ranges.
+        OwnedPointerVector<WorkingSet> _workingSets;
+        OwnedPointerVector<PlanStage> _scans;
+        std::vector<Range> _ranges;
+
+        // Ordered: the range we are returning results from.  Unordered: the range to look at
+        // first, so that all ranges get returned from.
+        size_t _nextRange;
+
+        boost::scoped_ptr<threadpool::ThreadPool> _pool;
+
+        // Counts down the tasks of the current round.
+        boost::mutex _roundMutex;
+        boost::condition_variable _roundDone;
+        int _tasksRemaining; // guarded by _roundMutex
+
+        // Stats
+        CommonStats _commonStats;
+        ParallelIndexScanStats _specificStats;
+    };
+
+}  // namespace mongo
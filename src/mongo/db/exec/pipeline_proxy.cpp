@@ -90,10 +90,12 @@ namespace mongo {
 
     void PipelineProxyStage::saveState() {
         _pipeline->getContext()->opCtx = NULL;
+        _pipeline->getContext()->memoryTracker.setParent(NULL);
     }
 
     void PipelineProxyStage::restoreState(OperationContext* opCtx) {
         _pipeline->getContext()->opCtx = opCtx;
+        _pipeline->getContext()->memoryTracker.setParent(opCtx->memoryTracker());
     }
 
     void PipelineProxyStage::pushBack(const BSONObj& obj) {
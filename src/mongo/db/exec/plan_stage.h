@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "mongo/db/exec/plan_stats.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/invalidation_type.h"
@@ -171,6 +173,40 @@ namespace mongo {
          */
         virtual StageState work(WorkingSetID* out) = 0;
 
+        /**
+         * Perform up to 'maxWorks' units of work, exactly as that many calls to work() would,
+         * appending the id of each result to 'results'.  Sets '*worksDone' to the number of
+         * units of work performed.
+         *
+         * Stops early as soon as a unit of work returns something other than ADVANCED or
+         * NEED_TIME, in which case that state is returned and *out is set as work() would have
+         * set it; results produced before it are still appended.  Otherwise returns ADVANCED
+         * if any results were appended and NEED_TIME if none were.
+         *
+         * The default implementation calls work() in a loop.  Stages that produce many results
+         * cheaply override it to avoid paying for a virtual call (and a timer) per result.
+         */
+        virtual StageState workBatch(size_t maxWorks,
+                                     std::vector<WorkingSetID>* results,
+                                     size_t* worksDone,
+                                     WorkingSetID* out) {
+            const size_t numResults = results->size();
+            for (*worksDone = 0; *worksDone < maxWorks; ) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                StageState state = work(&id);
+                ++*worksDone;
+
+                if (ADVANCED == state) {
+                    results->push_back(id);
+                }
+                else if (NEED_TIME != state) {
+                    *out = id;
+                    return state;
+                }
+            }
+            return results->size() > numResults ? ADVANCED : NEED_TIME;
+        }
+
         /**
          * Returns true if no more work can be done on the query / out of results.
          */
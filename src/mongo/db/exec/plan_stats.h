@@ -66,6 +66,10 @@ namespace mongo {
                         needTime(0),
                         needFetch(0),
                         executionTimeMillis(0),
+                        executionTimeTicks(0),
+                        cpuTimeNanos(0),
+                        docBytesExamined(0),
+                        keyBytesExamined(0),
                         isEOF(false) { }
         // String giving the type of the stage. Not owned.
         const char* stageTypeStr;
@@ -88,6 +92,15 @@ namespace mongo {
         // Time elapsed while working inside this stage.
         long long executionTimeMillis;
 
+        // With internalQueryExecStageTiming, the finer measures of the time spent working inside
+        // this stage, including its children: CycleClock ticks of wall clock time, and CPU time.
+        unsigned long long executionTimeTicks;
+        long long cpuTimeNanos;
+
+        // The sizes of the documents and index keys this stage itself read.
+        size_t docBytesExamined;
+        size_t keyBytesExamined;
+
         // TODO: have some way of tracking WSM sizes (or really any series of #s).  We can measure
         // the size of our inputs and the size of our outputs.  We can do a lot with the WS here.
 
@@ -147,7 +160,9 @@ namespace mongo {
         AndHashStats() : flaggedButPassed(0),
                          flaggedInProgress(0),
                          memUsage(0),
-                         memLimit(0) { }
+                         memLimit(0),
+                         spillFiles(0),
+                         spillBytes(0) { }
 
         virtual ~AndHashStats() { }
 
@@ -176,6 +191,11 @@ namespace mongo {
 
         // What's our memory limit?
         size_t memLimit;
+
+        // If the intersection went over the memory limit and was finished on disk, how many
+        // temporary files and bytes did it write?
+        size_t spillFiles;
+        unsigned long long spillBytes;
     };
 
     struct AndSortedStats : public SpecificStats {
@@ -208,7 +228,7 @@ namespace mongo {
     };
 
     struct CollectionScanStats : public SpecificStats {
-        CollectionScanStats() : docsTested(0), direction(1) { }
+        CollectionScanStats() : docsTested(0), direction(1), readAheads(0) { }
 
         virtual SpecificStats* clone() const {
             CollectionScanStats* specific = new CollectionScanStats(*this);
@@ -221,10 +241,14 @@ namespace mongo {
         // >0 if we're traversing the collection forwards. <0 if we're traversing it
         // backwards.
         int direction;
+
+        // How many read-aheads did the storage engine start once the scan was found to be
+        // sequential?
+        long long readAheads;
     };
 
     struct CountStats : public SpecificStats {
-        CountStats() : nCounted(0), nSkipped(0), trivialCount(false) { }
+        CountStats() : nCounted(0), nSkipped(0), trivialCount(false), approximate(false) { }
 
         virtual SpecificStats* clone() const {
             CountStats* specific = new CountStats(*this);
@@ -240,11 +264,15 @@ namespace mongo {
         // A "trivial count" is one that we can answer by calling numRecords() on the
         // collection, without actually going through any query logic.
         bool trivialCount;
+
+        // Whether 'nCounted' is an estimate made by the index, rather than an exact count.
+        bool approximate;
     };
 
     struct CountScanStats : public SpecificStats {
         CountScanStats() : isMultiKey(false),
-                           keysExamined(0) { }
+                           keysExamined(0),
+                           rangeCounted(false) { }
 
         virtual ~CountScanStats() { }
 
@@ -261,6 +289,8 @@ namespace mongo {
 
         size_t keysExamined;
 
+        // Whether the index counted the keys in the range instead of the scan walking them.
+        bool rangeCounted;
     };
 
     struct DeleteStats : public SpecificStats {
@@ -292,7 +322,9 @@ namespace mongo {
         FetchStats() : alreadyHasObj(0),
                        forcedFetches(0),
                        matchTested(0),
-                       docsExamined(0) { }
+                       docsExamined(0),
+                       batchesPrefetched(0),
+                       docsPrefetched(0) { }
 
         virtual ~FetchStats() { }
 
@@ -316,6 +348,11 @@ namespace mongo {
 
         // The total number of full documents touched by the fetch stage.
         size_t docsExamined;
+
+        // How many batches of the child's results were prefetched, and how many documents
+        // they asked for.
+        size_t batchesPrefetched;
+        size_t docsPrefetched;
     };
 
     struct GroupStats : public SpecificStats {
@@ -334,7 +371,8 @@ namespace mongo {
 
     struct IDHackStats : public SpecificStats {
         IDHackStats() : keysExamined(0),
-                        docsExamined(0) { }
+                        docsExamined(0),
+                        locFromCache(false) { }
 
         virtual ~IDHackStats() { }
 
@@ -349,6 +387,31 @@ namespace mongo {
         // Number of documents retrieved from the collection while executing the idhack.
         size_t docsExamined;
 
+        // Whether the document was found through the collection's IdLookupCache rather than
+        // the _id index.
+        bool locFromCache;
+    };
+
+    struct BatchedIdHackStats : public SpecificStats {
+        BatchedIdHackStats() : keysExamined(0),
+                               docsExamined(0),
+                               batchesPrefetched(0) { }
+
+        virtual ~BatchedIdHackStats() { }
+
+        virtual SpecificStats* clone() const {
+            BatchedIdHackStats* specific = new BatchedIdHackStats(*this);
+            return specific;
+        }
+
+        // Number of entries retrieved from the _id index.
+        size_t keysExamined;
+
+        // Number of documents retrieved from the collection.
+        size_t docsExamined;
+
+        // How many batches of lookups had their documents prefetched.
+        size_t batchesPrefetched;
     };
 
     struct IndexScanStats : public SpecificStats {
@@ -358,7 +421,8 @@ namespace mongo {
                            dupsDropped(0),
                            seenInvalidated(0),
                            matchTested(0),
-                           keysExamined(0) { }
+                           keysExamined(0),
+                           locsFiltered(0) { }
 
         virtual ~IndexScanStats() { }
 
@@ -402,6 +466,9 @@ namespace mongo {
         // Number of entries retrieved from the index during the scan.
         size_t keysExamined;
 
+        // Number of entries skipped because their DiskLoc failed the DiskLoc filter.
+        size_t locsFiltered;
+
     };
 
     struct LimitStats : public SpecificStats {
@@ -434,7 +501,8 @@ namespace mongo {
     struct OrStats : public SpecificStats {
         OrStats() : dupsTested(0),
                     dupsDropped(0),
-                    locsForgotten(0) { }
+                    locsForgotten(0),
+                    memUsage(0) { }
 
         virtual ~OrStats() { }
 
@@ -449,10 +517,26 @@ namespace mongo {
         // How many calls to invalidate(...) actually removed a DiskLoc from our deduping map?
         size_t locsForgotten;
 
+        // How many bytes does the deduping set use?
+        size_t memUsage;
+
         // We know how many passed (it's the # of advanced) and therefore how many failed.
         std::vector<size_t> matchTested;
     };
 
+    struct ParallelIndexScanStats : public SpecificStats {
+        ParallelIndexScanStats() : dupsTested(0), dupsDropped(0) { }
+
+        virtual SpecificStats* clone() const {
+            ParallelIndexScanStats* specific = new ParallelIndexScanStats(*this);
+            return specific;
+        }
+
+        // Results from a multikey index are deduplicated across ranges.
+        size_t dupsTested;
+        size_t dupsDropped;
+    };
+
     struct ProjectionStats : public SpecificStats {
         ProjectionStats() { }
 
@@ -466,7 +550,8 @@ namespace mongo {
     };
 
     struct SortStats : public SpecificStats {
-        SortStats() : forcedFetches(0), memUsage(0), memLimit(0) { }
+        SortStats() : forcedFetches(0), memUsage(0), memLimit(0), spillFiles(0),
+                      spillBytes(0) { }
 
         virtual ~SortStats() { }
 
@@ -484,6 +569,11 @@ namespace mongo {
         // What's our memory limit?
         size_t memLimit;
 
+        // How many temporary files did we write once over the memory limit, and how many bytes
+        // in them?  Only non-zero if the query allows the sort to use disk.
+        size_t spillFiles;
+        unsigned long long spillBytes;
+
         // The number of results to return from the sort.
         size_t limit;
 
@@ -620,7 +710,7 @@ namespace mongo {
     };
 
     struct TextStats : public SpecificStats {
-        TextStats() : keysExamined(0), fetches(0), parsedTextQuery() { }
+        TextStats() : keysExamined(0), fetches(0), parsedTextQuery(), topK(0) { }
 
         virtual SpecificStats* clone() const {
             TextStats* specific = new TextStats(*this);
@@ -636,6 +726,9 @@ namespace mongo {
 
         // Index keys that precede the "text" index key.
         BSONObj indexPrefix;
+
+        // Number of best scoring documents the stage was limited to, 0 if unlimited.
+        size_t topK;
     };
 
 }  // namespace mongo
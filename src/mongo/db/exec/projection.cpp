@@ -202,7 +202,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         WorkingSetID id = WorkingSet::INVALID_ID;
         StageState status = _child->work(&id);
@@ -246,6 +246,57 @@ namespace mongo {
         return status;
     }
 
+    PlanStage::StageState ProjectionStage::workBatch(size_t maxWorks,
+                                                     std::vector<WorkingSetID>* results,
+                                                     size_t* worksDone,
+                                                     WorkingSetID* out) {
+        // Adds the amount of time taken by workBatch() to executionTimeMillis.
+        ScopedTimer timer(&_commonStats);
+
+        const size_t numResults = results->size();
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        StageState status = _child->workBatch(maxWorks, results, worksDone, &id);
+
+        const size_t produced = results->size() - numResults;
+        const bool stopped = (PlanStage::ADVANCED != status && PlanStage::NEED_TIME != status);
+        _commonStats.works += *worksDone;
+        _commonStats.needTime += *worksDone - produced - (stopped ? 1 : 0);
+
+        for (size_t i = numResults; i < results->size(); ++i) {
+            Status projStatus = transform(_ws->get((*results)[i]));
+            if (!projStatus.isOK()) {
+                warning() << "Couldn't execute projection, status = "
+                          << projStatus.toString() << endl;
+
+                // The results after the one we failed on would not have been produced yet.
+                for (size_t j = i; j < results->size(); ++j) {
+                    _ws->free((*results)[j]);
+                }
+                results->resize(i);
+
+                *out = WorkingSetCommon::allocateStatusMember(_ws, projStatus);
+                return PlanStage::FAILURE;
+            }
+            ++_commonStats.advanced;
+        }
+
+        if (PlanStage::FAILURE == status) {
+            *out = id;
+            if (WorkingSet::INVALID_ID == id) {
+                mongoutils::str::stream ss;
+                ss << "projection stage failed to read in results from child";
+                Status status(ErrorCodes::InternalError, ss);
+                *out = WorkingSetCommon::allocateStatusMember( _ws, status);
+            }
+        }
+        else if (PlanStage::NEED_FETCH == status) {
+            _commonStats.needFetch++;
+            *out = id;
+        }
+
+        return status;
+    }
+
     void ProjectionStage::saveState() {
         ++_commonStats.yields;
         _child->saveState();
@@ -28,6 +28,8 @@
 
 #include "mongo/db/exec/projection_exec.h"
 
+#include <algorithm>
+
 #include "mongo/db/exec/working_set_computed_data.h"
 #include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/matcher/expression.h"
@@ -36,9 +38,62 @@
 
 namespace mongo {
 
+namespace {
+
+    // Orders elements of one object by their position in it.
+    struct ElementPositionLess {
+        bool operator()(const BSONElement& lhs, const BSONElement& rhs) const {
+            return lhs.rawdata() < rhs.rawdata();
+        }
+    };
+
+    // Picks the bit of ProjectionExec::_nameFilter for a field name, from its length and its
+    // first and last characters, which tell apart most fields of a document without hashing.
+    unsigned long long fieldNameBit(const char* name, size_t len) {
+        if (0 == len) {
+            return 1;
+        }
+        const unsigned char first = static_cast<unsigned char>(name[0]);
+        const unsigned char last = static_cast<unsigned char>(name[len - 1]);
+        return 1ULL << ((len * 31 + first + last * 7) & 63);
+    }
+
+    /**
+     * Gathers elements which follow one another in the same object, so that they are copied into
+     * a builder with one append, rather than with one per element.  flush() must be called before
+     * anything else is appended to the builder.
+     */
+    class ElementRun {
+    public:
+        explicit ElementRun(BSONObjBuilder* bob) : _bob(bob), _begin(NULL), _end(NULL) { }
+
+        void add(const BSONElement& elt) {
+            if (elt.rawdata() != _end) {
+                flush();
+                _begin = elt.rawdata();
+            }
+            _end = elt.rawdata() + elt.size();
+        }
+
+        void flush() {
+            if (_begin != _end) {
+                _bob->bb().appendBuf(_begin, _end - _begin);
+            }
+            _begin = _end = NULL;
+        }
+
+    private:
+        BSONObjBuilder* _bob;
+        const char* _begin;
+        const char* _end;
+    };
+
+} // namespace
+
     ProjectionExec::ProjectionExec()
         : _include(true),
           _special(false),
+          _nameFilter(~0ULL),
           _includeID(true),
           _skip(0),
           _limit(-1),
@@ -54,6 +109,7 @@ namespace mongo {
                                    const MatchExpressionParser::WhereCallback& whereCallback)
         : _include(true),
           _special(false),
+          _nameFilter(~0ULL),
           _source(spec),
           _includeID(true),
           _skip(0),
@@ -175,6 +231,8 @@ namespace mongo {
                 _arrayOpType = ARRAY_OP_POSITIONAL;
             }
         }
+
+        compile(true);
     }
 
     ProjectionExec::~ProjectionExec() {
@@ -230,6 +288,30 @@ namespace mongo {
         }
     }
 
+    void ProjectionExec::compile(bool isRoot) {
+        _nameFilter = 0;
+        for (FieldMap::const_iterator it = _fields.begin(); it != _fields.end(); ++it) {
+            _nameFilter |= fieldNameBit(it->first.c_str(), it->first.size());
+            it->second->compile(false);
+        }
+
+        if (!isRoot) {
+            return;
+        }
+
+        _nameFilter |= fieldNameBit("_id", 3);
+        for (Matchers::const_iterator it = _matchers.begin(); it != _matchers.end(); ++it) {
+            _nameFilter |= fieldNameBit(it->first.c_str(), it->first.size());
+        }
+        for (MetaMap::const_iterator it = _meta.begin(); it != _meta.end(); ++it) {
+            _nameFilter |= fieldNameBit(it->first.c_str(), it->first.size());
+        }
+    }
+
+    bool ProjectionExec::mayBeNamed(const BSONElement& elt) const {
+        return _nameFilter & fieldNameBit(elt.fieldName(), elt.fieldNameSize() - 1);
+    }
+
     //
     // Execution
     //
@@ -262,7 +344,9 @@ namespace mongo {
                 verify(_queryExpression->matchesBSON(member->obj, &matchDetails));
             }
 
-            Status projStatus = transform(member->obj, &bob, &matchDetails);
+            Status projStatus = canTransformIndexed(*member)
+                ? transformIndexed(*member, &bob, &matchDetails)
+                : transform(member->obj, &bob, &matchDetails);
             if (!projStatus.isOK()) {
                 return projStatus;
             }
@@ -373,10 +457,20 @@ namespace mongo {
 
         const ArrayOpType& arrayOpType = _arrayOpType;
 
+        ElementRun run(bob);
         BSONObjIterator it(in);
         while (it.more()) {
             BSONElement elt = it.next();
 
+            // Case 0: a field the projection doesn't name.  Runs of them are copied whole.
+            if (!mayBeNamed(elt)) {
+                if (_include) {
+                    run.add(elt);
+                }
+                continue;
+            }
+            run.flush();
+
             // Case 1: _id
             if (mongoutils::str::equals("_id", elt.fieldName())) {
                 if (_includeID) {
@@ -412,7 +506,7 @@ namespace mongo {
                 }
 
                 BSONArrayBuilder arrBuilder;
-                BSONObjBuilder subBob;
+                BSONObjBuilder subBob(BufBuilderArena::current());
 
                 if (in.getField(elt.fieldName()).eoo()) {
                     return Status(ErrorCodes::InternalError,
@@ -433,10 +527,83 @@ namespace mongo {
                 }
             }
         }
+        run.flush();
 
         return Status::OK();
     }
 
+    bool ProjectionExec::canTransformIndexed(const WorkingSetMember& member) const {
+        // Only an inclusion projection can go by the fields it names rather than by the fields
+        // of the document.  The _id is one more probe.
+        if (_include || !_matchers.empty() || ARRAY_OP_NORMAL != _arrayOpType) {
+            return false;
+        }
+        return member.fieldIndex.expectProbes(member.obj, _fields.size() + 1)
+            && !member.fieldIndex.hasDuplicateFields();
+    }
+
+    Status ProjectionExec::transformIndexed(const WorkingSetMember& member,
+                                            BSONObjBuilder* bob,
+                                            const MatchDetails* details) const {
+        std::vector<BSONElement> elts;
+        elts.reserve(_fields.size() + 1);
+
+        BSONElement idElt;
+        if (_includeID) {
+            idElt = member.fieldIndex.getField(member.obj, "_id");
+            if (!idElt.eoo()) {
+                elts.push_back(idElt);
+            }
+        }
+
+        for (FieldMap::const_iterator it = _fields.begin(); it != _fields.end(); ++it) {
+            // transform() deals with the _id before looking at the projected fields.
+            if (mongoutils::str::equals("_id", it->first.c_str())) {
+                continue;
+            }
+            BSONElement elt = member.fieldIndex.getField(member.obj, it->first);
+            if (!elt.eoo()) {
+                elts.push_back(elt);
+            }
+        }
+
+        // Keep the fields in the order of the document, as transform() would.
+        std::sort(elts.begin(), elts.end(), ElementPositionLess());
+
+        for (size_t i = 0; i < elts.size(); i++) {
+            if (elts[i].rawdata() == idElt.rawdata()) {
+                bob->append(elts[i]);
+                continue;
+            }
+            Status status = append(bob, elts[i], details, _arrayOpType);
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+
+        return Status::OK();
+    }
+
+    void ProjectionExec::appendFields(BSONObjBuilder* bob,
+                                      const BSONObj& obj,
+                                      const MatchDetails* details,
+                                      const ArrayOpType arrayOpType) const {
+        ElementRun run(bob);
+        BSONObjIterator it(obj);
+        while (it.more()) {
+            BSONElement elt = it.next();
+            if (!mayBeNamed(elt)) {
+                if (_include) {
+                    run.add(elt);
+                }
+                continue;
+            }
+            run.flush();
+            append(bob, elt, details, arrayOpType);
+        }
+        run.flush();
+    }
+
     void ProjectionExec::appendArray(BSONObjBuilder* bob, const BSONObj& array, bool nested) const {
         int skip  = nested ?  0 : _skip;
         int limit = nested ? -1 : _limit;
@@ -445,6 +612,8 @@ namespace mongo {
             skip = max(0, skip + array.nFields());
         }
 
+        // Scalars which keep their index in the projected array are copied in runs.
+        ElementRun run(bob);
         int index = 0;
         BSONObjIterator it(array);
         while (it.more()) {
@@ -459,28 +628,40 @@ namespace mongo {
                 break;
             }
 
+            if (elt.type() != Array && elt.type() != Object) {
+                if (!_include) {
+                    continue;
+                }
+                const std::string name = bob->numStr(index++);
+                if (mongoutils::str::equals(elt.fieldName(), name.c_str())) {
+                    run.add(elt);
+                }
+                else {
+                    run.flush();
+                    bob->appendAs(elt, name);
+                }
+                continue;
+            }
+            run.flush();
+
             switch(elt.type()) {
             case Array: {
-                BSONObjBuilder subBob;
+                BSONObjBuilder subBob(BufBuilderArena::current());
                 appendArray(&subBob, elt.embeddedObject(), true);
-                bob->appendArray(bob->numStr(index++), subBob.obj());
+                bob->appendArray(bob->numStr(index++), subBob.done());
                 break;
             }
             case Object: {
-                BSONObjBuilder subBob;
-                BSONObjIterator jt(elt.embeddedObject());
-                while (jt.more()) {
-                    append(&subBob, jt.next());
-                }
-                bob->append(bob->numStr(index++), subBob.obj());
+                BSONObjBuilder subBob(BufBuilderArena::current());
+                appendFields(&subBob, elt.embeddedObject());
+                bob->append(bob->numStr(index++), subBob.done());
                 break;
             }
             default:
-                if (_include) {
-                    bob->appendAs(elt, bob->numStr(index++));
-                }
+                invariant(false);
             }
         }
+        run.flush();
     }
 
     Status ProjectionExec::append(BSONObjBuilder* bob,
@@ -513,16 +694,15 @@ namespace mongo {
             }
         }
         else if (elt.type() == Object) {
-            BSONObjBuilder subBob;
-            BSONObjIterator it(elt.embeddedObject());
-            while (it.more()) {
-                subfm.append(&subBob, it.next(), details, arrayOpType);
-            }
-            bob->append(elt.fieldName(), subBob.obj());
+            // Sub-objects are copied into 'bob' straight away, so build them in recycled
+            // buffers.
+            BSONObjBuilder subBob(BufBuilderArena::current());
+            subfm.appendFields(&subBob, elt.embeddedObject(), details, arrayOpType);
+            bob->append(elt.fieldName(), subBob.done());
         }
         else {
             // Array
-            BSONObjBuilder matchedBuilder;
+            BSONObjBuilder matchedBuilder(BufBuilderArena::current());
             if (details && arrayOpType == ARRAY_OP_POSITIONAL) {
                 // $ positional operator specified
                 if (!details->hasElemMatchKey()) {
@@ -545,7 +725,7 @@ namespace mongo {
                 // append exact array; no subarray matcher specified
                 subfm.appendArray(&matchedBuilder, elt.embeddedObject());
             }
-            bob->appendArray(elt.fieldName(), matchedBuilder.obj());
+            bob->appendArray(elt.fieldName(), matchedBuilder.done());
         }
 
         return Status::OK();
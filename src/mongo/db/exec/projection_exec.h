@@ -103,6 +103,19 @@ namespace mongo {
          */
         void add(const std::string& field, int skip, int limit);
 
+        /**
+         * Once the projection is parsed, summarizes the field names named at this level and the
+         * levels below in their _nameFilter.  'isRoot' if this is the top level, where the _id,
+         * $elemMatch and $meta fields are looked up as well.
+         */
+        void compile(bool isRoot);
+
+        /**
+         * False if 'elt' surely isn't named at this level, in which case it is included or not
+         * according to _include, without looking it up.
+         */
+        bool mayBeNamed(const BSONElement& elt) const;
+
         //
         // Execution
         //
@@ -120,6 +133,19 @@ namespace mongo {
                          BSONObjBuilder* bob,
                          const MatchDetails* details = NULL) const;
 
+        /**
+         * Whether the projection of 'member' can be computed by transformIndexed(), which
+         * looks up the fields projected in member.fieldIndex rather than walking the document.
+         */
+        bool canTransformIndexed(const WorkingSetMember& member) const;
+
+        /**
+         * Same as transform(member.obj, bob, details), if canTransformIndexed(member).
+         */
+        Status transformIndexed(const WorkingSetMember& member,
+                                BSONObjBuilder* bob,
+                                const MatchDetails* details) const;
+
         /**
          * See transform(...) above.
          */
@@ -143,6 +169,14 @@ namespace mongo {
                       const MatchDetails* details = NULL,
                       const ArrayOpType arrayOpType = ARRAY_OP_NORMAL) const;
 
+        /**
+         * Appends the projection of the fields of 'obj' at this level to 'bob'.
+         */
+        void appendFields(BSONObjBuilder* bob,
+                          const BSONObj& obj,
+                          const MatchDetails* details = NULL,
+                          const ArrayOpType arrayOpType = ARRAY_OP_NORMAL) const;
+
         /**
          * Like append, but for arrays.
          * Deals with slice and calls appendArray to preserve the array-ness.
@@ -155,6 +189,10 @@ namespace mongo {
         // True if this level can't be skipped or included without recursing.
         bool _special; 
 
+        // A bit for each field name looked up at this level, set by compile().  A field whose
+        // bit isn't set isn't looked up; see mayBeNamed().
+        unsigned long long _nameFilter;
+
         // We must group projections with common prefixes together.
         // TODO: benchmark std::vector<pair> vs map
         //
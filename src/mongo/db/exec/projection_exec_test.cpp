@@ -200,6 +200,71 @@ namespace {
         testTransform("{a: {$slice: [10, 10]}}", "{}", "{a: [4, 6, 8]}", true, "{a: []}");
     }
 
+    TEST(ProjectionExecTest, TransformSliceNested) {
+        // Elements keep their position names when the slice starts at the front, and are
+        // renamed otherwise.
+        testTransform("{a: {$slice: 2}}", "{}", "{a: [1, {b: 2, c: 3}, 4]}", true,
+                      "{a: [1, {b: 2, c: 3}]}");
+        testTransform("{a: {$slice: [1, 3]}}", "{}", "{a: [1, 2, [3, 4], 5, 6]}", true,
+                      "{a: [2, [3, 4], 5]}");
+        testTransform("{'a.b': {$slice: 1}}", "{}", "{a: {b: [1, 2], c: 3}, d: 4}", true,
+                      "{a: {b: [1], c: 3}, d: 4}");
+        testTransform("{'a.b': {$slice: -1}, d: 0}", "{}", "{a: {b: [1, 2], c: 3}, d: 4, e: 5}",
+                      true, "{a: {b: [2], c: 3}, e: 5}");
+    }
+
+    //
+    // Inclusion and exclusion
+    //
+
+    TEST(ProjectionExecTest, TransformDottedInclusion) {
+        const char* s = "{_id: 1, a: {b: 1, c: 2, d: {e: 3, f: 4}}, b: 5, ab: 6, ba: 7, a1: 8}";
+        testTransform("{'a.b': 1}", "{}", s, true, "{_id: 1, a: {b: 1}}");
+        testTransform("{'a.d.f': 1, b: 1}", "{}", s, true, "{_id: 1, a: {d: {f: 4}}, b: 5}");
+        testTransform("{'a.c': 1, _id: 0}", "{}", s, true, "{a: {c: 2}}");
+        testTransform("{'a.z': 1, b: 1}", "{}", s, true, "{_id: 1, a: {}, b: 5}");
+
+        // Inclusion through arrays of subdocuments.
+        testTransform("{'a.b': 1}", "{}", "{a: [{b: 1, c: 2}, {c: 3}, 4, {b: 5}]}", true,
+                      "{a: [{b: 1}, {}, {b: 5}]}");
+    }
+
+    TEST(ProjectionExecTest, TransformDottedExclusion) {
+        const char* s = "{_id: 1, a: {b: 1, c: 2, d: {e: 3, f: 4}}, b: 5, ab: 6, ba: 7, a1: 8}";
+        testTransform("{'a.b': 0}", "{}", s, true,
+                      "{_id: 1, a: {c: 2, d: {e: 3, f: 4}}, b: 5, ab: 6, ba: 7, a1: 8}");
+        testTransform("{'a.d.e': 0, ab: 0}", "{}", s, true,
+                      "{_id: 1, a: {b: 1, c: 2, d: {f: 4}}, b: 5, ba: 7, a1: 8}");
+        testTransform("{b: 0, _id: 0}", "{}", s, true,
+                      "{a: {b: 1, c: 2, d: {e: 3, f: 4}}, ab: 6, ba: 7, a1: 8}");
+    }
+
+    TEST(ProjectionExecTest, TransformWideDocument) {
+        // Fields whose names look alike to the projection are still told apart.
+        mongoutils::str::stream doc;
+        doc << "{_id: 0";
+        for (int i = 0; i < 200; i++) {
+            doc << ", f" << i << ": " << i;
+        }
+        doc << ", sub: {f1: 1, f10: 10, f100: 100}}";
+        const std::string s = doc;
+
+        testTransform("{f1: 1, f10: 1, 'sub.f100': 1}", "{}", s.c_str(), true,
+                      "{_id: 0, f1: 1, f10: 10, sub: {f100: 100}}");
+        testTransform("{f199: 1, f0: 1, _id: 0}", "{}", s.c_str(), true, "{f0: 0, f199: 199}");
+
+        mongoutils::str::stream expected;
+        expected << "{_id: 0";
+        for (int i = 0; i < 200; i++) {
+            if (i != 1 && i != 100) {
+                expected << ", f" << i << ": " << i;
+            }
+        }
+        expected << ", sub: {f1: 1, f10: 10}}";
+        const std::string e = expected;
+        testTransform("{f1: 0, f100: 0, 'sub.f100': 0}", "{}", s.c_str(), true, e.c_str());
+    }
+
     //
     // $meta
     // $meta projections add computed values to the projected object.
@@ -30,18 +30,33 @@
 
 #include "mongo/db/exec/scoped_timer.h"
 
+#include "mongo/db/exec/plan_stats.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/util/cycle_clock.h"
 #include "mongo/util/net/listen.h"
 
 namespace mongo {
 
-    ScopedTimer::ScopedTimer(long long* counter) :
-        _counter(counter),
-        _start(Listener::getElapsedTimeMillis()) {
+    ScopedTimer::ScopedTimer(CommonStats* stats) :
+        _stats(stats),
+        _start(Listener::getElapsedTimeMillis()),
+        _fine(internalQueryExecStageTiming),
+        _startTicks(0),
+        _startCpuNanos(0) {
+        if (_fine) {
+            _startTicks = CycleClock::now();
+            _startCpuNanos = CycleClock::threadCpuNanos();
+        }
     }
 
     ScopedTimer::~ScopedTimer() {
         long long elapsed = Listener::getElapsedTimeMillis() - _start;
-        *_counter += elapsed;
+        _stats->executionTimeMillis += elapsed;
+
+        if (_fine) {
+            _stats->executionTimeTicks += CycleClock::now() - _startTicks;
+            _stats->cpuTimeNanos += CycleClock::threadCpuNanos() - _startCpuNanos;
+        }
     }
 
 }  // namespace mongo
@@ -32,14 +32,17 @@
 
 namespace mongo {
 
+    struct CommonStats;
+
     /**
-     * This class increments a counter by a rough estimate of the time elapsed since its
-     * construction when it goes out of scope.
+     * This class increments a stage's executionTimeMillis by a rough estimate of the time elapsed
+     * since its construction when it goes out of scope.  With internalQueryExecStageTiming it also
+     * adds the CycleClock ticks and thread CPU time elapsed.
      */
     class ScopedTimer {
         MONGO_DISALLOW_COPYING(ScopedTimer);
     public:
-        ScopedTimer(long long* counter);
+        ScopedTimer(CommonStats* stats);
 
         ~ScopedTimer();
 
@@ -47,11 +50,16 @@ namespace mongo {
         // Default constructor disallowed.
         ScopedTimer();
 
-        // Reference to the counter that we are incrementing with the elapsed time.
-        long long* _counter;
+        // The stats we are adding the elapsed time to.
+        CommonStats* _stats;
 
         // Time at which the timer was constructed.
         long long _start;
+
+        // Whether we're also taking the finer measures, and their readings at construction.
+        const bool _fine;
+        unsigned long long _startTicks;
+        long long _startCpuNanos;
     };
 
 }  // namespace mongo
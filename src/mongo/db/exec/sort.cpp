@@ -38,13 +38,38 @@
 #include "mongo/db/index/btree_key_generator.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/query/qlog.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner.h"
 
 namespace mongo {
 
     using std::vector;
 
-    const size_t kMaxBytes = 32 * 1024 * 1024;
+namespace {
+
+    /**
+     * Orders the data of an external sort the same way as WorkingSetComparator.
+     */
+    class ExternalSortComparator {
+    public:
+        typedef std::pair<BSONObj, SpilledWorkingSetMember> Data;
+
+        explicit ExternalSortComparator(const BSONObj& pattern) : _pattern(pattern) { }
+
+        int operator()(const Data& lhs, const Data& rhs) const {
+            // False means ignore field names.
+            int result = lhs.first.woCompare(rhs.first, _pattern, false);
+            if (0 != result) {
+                return result;
+            }
+            return lhs.second.getLoc().compare(rhs.second.getLoc());
+        }
+
+    private:
+        BSONObj _pattern;
+    };
+
+}  // namespace
 
     // static
     const char* SortStage::kStageType = "SORT";
@@ -125,7 +150,7 @@ namespace mongo {
                                              BSONObj* objOut) const {
         BSONObj btreeKeyToUse;
 
-        Status btreeStatus = getBtreeKey(member.obj, &btreeKeyToUse);
+        Status btreeStatus = getBtreeKey(member.obj, &member.fieldIndex, &btreeKeyToUse);
         if (!btreeStatus.isOK()) {
             return btreeStatus;
         }
@@ -163,7 +188,9 @@ namespace mongo {
         return Status::OK();
     }
 
-    Status SortStageKeyGenerator::getBtreeKey(const BSONObj& memberObj, BSONObj* objOut) const {
+    Status SortStageKeyGenerator::getBtreeKey(const BSONObj& memberObj,
+                                              const BSONFieldIndex* fieldIndex,
+                                              BSONObj* objOut) const {
         // Not sorting by anything in the key, just bail out early.
         if (_btreeObj.isEmpty()) {
             *objOut = BSONObj();
@@ -177,7 +204,7 @@ namespace mongo {
         BSONObjSet keys(patternCmp);
 
         try {
-            _keyGen->getKeys(memberObj, &keys);
+            _keyGen->getKeys(memberObj, &keys, fieldIndex);
         }
         catch (const UserException& e) {
             // Probably a parallel array.
@@ -292,8 +319,12 @@ namespace mongo {
           _pattern(params.pattern),
           _query(params.query),
           _limit(params.limit),
+          _maxBytes(std::max(0, internalQueryExecMaxBlockingSortBytes)),
+          _allowDiskUse(params.allowDiskUse),
+          _tempDir(params.tempDir),
           _sorted(false),
           _resultIterator(_data.end()),
+          _memoryTracker(txn->memoryTracker()),
           _commonStats(kStageType),
           _memUsage(0) {
     }
@@ -303,14 +334,20 @@ namespace mongo {
     bool SortStage::isEOF() {
         // We're done when our child has no more results, we've sorted the child's results, and
         // we've returned all sorted results.
-        return _child->isEOF() && _sorted && (_data.end() == _resultIterator);
+        if (!_child->isEOF() || !_sorted) {
+            return false;
+        }
+        if (NULL != _externalIterator.get()) {
+            return !_externalIterator->more();
+        }
+        return _data.end() == _resultIterator;
     }
 
     PlanStage::StageState SortStage::work(WorkingSetID* out) {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (NULL == _sortKeyGen) {
             // This is heavy and should be done as part of work().
@@ -325,15 +362,23 @@ namespace mongo {
             return PlanStage::NEED_TIME;
         }
 
-        if (_memUsage > kMaxBytes) {
+        if (_memUsage > _maxBytes) {
             mongoutils::str::stream ss;
             ss << "sort stage buffered data usage of " << _memUsage
-               << " bytes exceeds internal limit of " << kMaxBytes << " bytes";
+               << " bytes exceeds internal limit of " << _maxBytes << " bytes";
             Status status(ErrorCodes::Overflow, ss);
             *out = WorkingSetCommon::allocateStatusMember( _ws, status);
             return PlanStage::FAILURE;
         }
 
+        if (!_sorted) {
+            Status memoryStatus = _memoryTracker.checkLimits();
+            if (!memoryStatus.isOK()) {
+                *out = WorkingSetCommon::allocateStatusMember(_ws, memoryStatus);
+                return PlanStage::FAILURE;
+            }
+        }
+
         if (isEOF()) { return PlanStage::IS_EOF; }
 
         // Still reading in results to sort.
@@ -358,17 +403,36 @@ namespace mongo {
                 // The data remains in the WorkingSet and we wrap the WSID with the sort key.
                 SortableDataItem item;
                 Status sortKeyStatus = _sortKeyGen->getSortKey(*member, &item.sortKey);
-                if (!_sortKeyGen->getSortKey(*member, &item.sortKey).isOK()) {
+                if (!sortKeyStatus.isOK()) {
                     *out = WorkingSetCommon::allocateStatusMember(_ws, sortKeyStatus);
                     return PlanStage::FAILURE;
                 }
+
+                // The member may sit in the buffer for a long time, and the buffer's limit
+                // doesn't account for field indexes.
+                member->fieldIndex.release();
                 item.wsid = id;
                 if (member->hasLoc()) {
                     // The DiskLoc breaks ties when sorting two WSMs with the same sort key.
                     item.loc = member->loc;
                 }
 
-                addToBuffer(item);
+                Status status = Status::OK();
+                if (NULL != _externalSorter.get()) {
+                    status = addToExternalSort(item);
+                }
+                else {
+                    addToBuffer(item);
+                    _memoryTracker.set(_memUsage);
+                    if (_allowDiskUse && (_memUsage > _maxBytes
+                                          || !_memoryTracker.checkLimits().isOK())) {
+                        status = startExternalSort();
+                    }
+                }
+                if (!status.isOK()) {
+                    *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+                    return PlanStage::FAILURE;
+                }
 
                 ++_commonStats.needTime;
                 return PlanStage::NEED_TIME;
@@ -376,8 +440,22 @@ namespace mongo {
             else if (PlanStage::IS_EOF == code) {
                 // TODO: We don't need the lock for this.  We could ask for a yield and do this work
                 // unlocked.  Also, this is performing a lot of work for one call to work(...)
-                sortBuffer();
-                _resultIterator = _data.begin();
+                if (NULL != _externalSorter.get()) {
+                    try {
+                        _externalIterator.reset(_externalSorter->done());
+                    }
+                    catch (const DBException& e) {
+                        *out = WorkingSetCommon::allocateStatusMember(_ws, e.toStatus());
+                        return PlanStage::FAILURE;
+                    }
+                    _specificStats.spillFiles = _externalSorter->numFiles();
+                    _specificStats.spillBytes = _externalSorter->spilledBytes();
+                    _externalSorter.reset();
+                }
+                else {
+                    sortBuffer();
+                    _resultIterator = _data.begin();
+                }
                 _sorted = true;
                 ++_commonStats.needTime;
                 return PlanStage::NEED_TIME;
@@ -407,8 +485,27 @@ namespace mongo {
         }
 
         // Returning results.
-        verify(_resultIterator != _data.end());
         verify(_sorted);
+        if (NULL != _externalIterator.get()) {
+            WorkingSetID id = _ws->allocate();
+            try {
+                ExternalSorter::Data data = _externalIterator->next();
+                const DiskLoc& loc = data.second.getLoc();
+                const bool invalidated = !loc.isNull() && _externalInvalidations.count(loc) > 0;
+                data.second.getOwned().toMember(_ws->get(id), invalidated);
+            }
+            catch (const DBException& e) {
+                _ws->free(id);
+                *out = WorkingSetCommon::allocateStatusMember(_ws, e.toStatus());
+                return PlanStage::FAILURE;
+            }
+
+            *out = id;
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
+        verify(_resultIterator != _data.end());
         *out = _resultIterator->wsid;
         _resultIterator++;
 
@@ -426,12 +523,14 @@ namespace mongo {
     void SortStage::saveState() {
         ++_commonStats.yields;
         _child->saveState();
+        _memoryTracker.setParent(NULL);
     }
 
     void SortStage::restoreState(OperationContext* opCtx) {
         _txn = opCtx;
         ++_commonStats.unyields;
         _child->restoreState(opCtx);
+        _memoryTracker.setParent(opCtx->memoryTracker());
     }
 
     void SortStage::invalidate(const DiskLoc& dl, InvalidationType type) {
@@ -459,6 +558,10 @@ namespace mongo {
             _wsidByDiskLoc.erase(it);
             ++_specificStats.forcedFetches;
         }
+        else if (NULL != _externalSorter.get() || NULL != _externalIterator.get()) {
+            // The data may be in the external sort, which has a copy of the document already.
+            _externalInvalidations.insert(dl);
+        }
     }
 
     vector<PlanStage*> SortStage::getChildren() const {
@@ -469,8 +572,13 @@ namespace mongo {
 
     PlanStageStats* SortStage::getStats() {
         _commonStats.isEOF = isEOF();
-        _specificStats.memLimit = kMaxBytes;
+        _specificStats.memLimit = _maxBytes;
         _specificStats.memUsage = _memUsage;
+        if (NULL != _externalSorter.get()) {
+            _specificStats.memUsage = _externalSorter->memUsed();
+            _specificStats.spillFiles = _externalSorter->numFiles();
+            _specificStats.spillBytes = _externalSorter->spilledBytes();
+        }
         _specificStats.limit = _limit;
         _specificStats.sortPattern = _pattern.getOwned();
 
@@ -571,6 +679,61 @@ namespace mongo {
         }
     }
 
+    Status SortStage::startExternalSort() {
+        SortOptions opts;
+        opts.limit = _limit;
+        opts.maxMemoryUsageBytes = _maxBytes;
+        opts.extSortAllowed = true;
+        opts.tempDir = _tempDir;
+        opts.memoryTracker = &_memoryTracker;
+
+        try {
+            _externalSorter.reset(ExternalSorter::make(
+                opts, ExternalSortComparator(_sortKeyGen->getSortComparator())));
+        }
+        catch (const DBException& e) {
+            return e.toStatus();
+        }
+
+        vector<SortableDataItem> buffered;
+        if (NULL != _dataSet.get()) {
+            buffered.assign(_dataSet->begin(), _dataSet->end());
+            _dataSet->clear();
+        }
+        else {
+            buffered.swap(_data);
+        }
+        _memUsage = 0;
+        _memoryTracker.set(0);
+
+        for (size_t i = 0; i < buffered.size(); ++i) {
+            Status status = addToExternalSort(buffered[i]);
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+
+        return Status::OK();
+    }
+
+    Status SortStage::addToExternalSort(const SortableDataItem& item) {
+        WorkingSetMember* member = _ws->get(item.wsid);
+
+        Status status = Status::OK();
+        try {
+            _externalSorter->add(item.sortKey, SpilledWorkingSetMember(*member));
+        }
+        catch (const DBException& e) {
+            status = e.toStatus();
+        }
+
+        if (member->hasLoc()) {
+            _wsidByDiskLoc.erase(member->loc);
+        }
+        _ws->free(item.wsid);
+        return status;
+    }
+
     void SortStage::sortBuffer() {
         if (_limit == 0) {
             const WorkingSetComparator& cmp = *_sortKeyComparator;
@@ -591,3 +754,6 @@ namespace mongo {
     }
 
 }  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+// Explicit instantiation unneeded since we aren't exposing Sorter outside of this file.
@@ -36,8 +36,12 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_spill.h"
+#include "mongo/db/operation_memory_tracker.h"
 #include "mongo/db/query/index_bounds.h"
+#include "mongo/db/sorter/sorter.h"
 #include "mongo/platform/unordered_map.h"
+#include "mongo/platform/unordered_set.h"
 
 
 namespace mongo {
@@ -47,7 +51,7 @@ namespace mongo {
     // Parameters that must be provided to a SortStage
     class SortStageParams {
     public:
-        SortStageParams() : collection(NULL), limit(0) { }
+        SortStageParams() : collection(NULL), limit(0), allowDiskUse(false) { }
 
         // Used for resolving DiskLocs to BSON
         const Collection* collection;
@@ -60,6 +64,11 @@ namespace mongo {
 
         // Equal to 0 for no limit.
         size_t limit;
+
+        // If true, data beyond the memory limit is sorted externally, in files in 'tempDir',
+        // rather than failing the sort.
+        bool allowDiskUse;
+        std::string tempDir;
     };
 
     /**
@@ -92,7 +101,9 @@ namespace mongo {
         const BSONObj& getSortComparator() const { return _comparatorObj; }
 
     private:
-        Status getBtreeKey(const BSONObj& memberObj, BSONObj* objOut) const;
+        Status getBtreeKey(const BSONObj& memberObj,
+                           const BSONFieldIndex* fieldIndex,
+                           BSONObj* objOut) const;
 
         /**
          * In order to emulate the existing sort behavior we must make unindexed sort behavior as
@@ -139,6 +150,12 @@ namespace mongo {
      *
      * Preconditions: For each field in 'pattern', all inputs in the child must handle a
      * getFieldDotted for that field.
+     *
+     * Data is buffered as WorkingSetMembers until it exceeds
+     * internalQueryExecMaxBlockingSortBytes.  The sort then fails, unless disk use is allowed,
+     * in which case the buffered data and all further input are copied into a Sorter.  It
+     * spills sorted runs to temporary files and merges them once the input is exhausted.  With
+     * a limit it is a TopKSorter, so only the best 'limit' results are kept at any point.
      */
     class SortStage : public PlanStage {
     public:
@@ -193,6 +210,13 @@ namespace mongo {
         // Equal to 0 for no limit.
         size_t _limit;
 
+        // How many bytes we may buffer.
+        size_t _maxBytes;
+
+        // May we sort externally once over '_maxBytes', and where do the files go?
+        bool _allowDiskUse;
+        std::string _tempDir;
+
         //
         // Sort key generation
         //
@@ -242,6 +266,16 @@ namespace mongo {
          */
         void sortBuffer();
 
+        /**
+         * Moves the buffered data into a new external sorter, which all further input goes to.
+         */
+        Status startExternalSort();
+
+        /**
+         * Copies the WSM of 'item' into the external sorter and frees it.
+         */
+        Status addToExternalSort(const SortableDataItem& item);
+
         // Comparator for data buffer
         // Initialization follows sort key generator
         scoped_ptr<WorkingSetComparator> _sortKeyComparator;
@@ -264,6 +298,27 @@ namespace mongo {
         typedef unordered_map<DiskLoc, WorkingSetID, DiskLoc::Hasher> DataMap;
         DataMap _wsidByDiskLoc;
 
+        // Counts '_memUsage', and the external sorter's usage as a child, towards the tracker of
+        // the operation.  Detached while the stage is saved.  Once it says so the buffered data
+        // is sorted externally, if disk use is allowed, or the stage fails.
+        OperationMemoryTracker _memoryTracker;
+
+        //
+        // External sort
+        //
+
+        typedef Sorter<BSONObj, SpilledWorkingSetMember> ExternalSorter;
+
+        // Set once the buffered data exceeds '_maxBytes', or '_memoryTracker' wants it back, and
+        // disk use is allowed; all data is
+        // added here from then on.  Replaced by '_externalIterator' once the data is sorted.
+        boost::scoped_ptr<ExternalSorter> _externalSorter;
+        boost::scoped_ptr<ExternalSorter::Iterator> _externalIterator;
+
+        // The DiskLocs invalidated since the external sort started.  The data of such a DiskLoc
+        // is copied into the sorter, so it is returned as an owned object without the DiskLoc.
+        unordered_set<DiskLoc, DiskLoc::Hasher> _externalInvalidations;
+
         //
         // Stats
         //
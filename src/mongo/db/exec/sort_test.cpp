@@ -34,6 +34,8 @@
 
 #include "mongo/db/json.h"
 #include "mongo/db/exec/mock_stage.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/unittest/temp_dir.h"
 #include "mongo/unittest/unittest.h"
 
 using namespace mongo;
@@ -238,4 +240,115 @@ namespace {
                  "{output: [{a: 3}]}");
     }
 
+    //
+    // External sort
+    // With a memory limit that only a few documents fit into, and disk use allowed, the data
+    // is sorted externally.  Without disk use it fails.
+    //
+
+    const int kNumExternalSortDocs = 1000;
+
+    /**
+     * Pushes {a: <a permutation of 0 .. kNumExternalSortDocs - 1>} documents onto 'ms', the
+     * i-th document with the DiskLoc (0, i).
+     */
+    void pushExternalSortDocs(MockStage* ms) {
+        for (int i = 0; i < kNumExternalSortDocs; ++i) {
+            WorkingSetMember wsm;
+            wsm.state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+            wsm.loc = DiskLoc(0, i);
+            wsm.obj = BSON("a" << (i * 7919) % kNumExternalSortDocs);
+            ms->pushBack(wsm);
+        }
+    }
+
+    void testExternalSort(size_t limit) {
+        unittest::TempDir tempDir("sort_stage_test");
+        int oldMaxBytes = internalQueryExecMaxBlockingSortBytes;
+        internalQueryExecMaxBlockingSortBytes = 1024;
+
+        WorkingSet ws;
+        MockStage* ms = new MockStage(&ws);
+        pushExternalSortDocs(ms);
+
+        SortStageParams params;
+        params.pattern = fromjson("{a: 1}");
+        params.limit = limit;
+        params.allowDiskUse = true;
+        params.tempDir = tempDir.path();
+        SortStage sort(NULL, params, &ws, ms);
+
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        PlanStage::StageState state = PlanStage::NEED_TIME;
+        while (state == PlanStage::NEED_TIME) {
+            state = sort.work(&id);
+        }
+        ASSERT_TRUE(ms->isEOF());
+
+        // All the data is in the external sort by now, which already has a copy of the
+        // document of an invalidated DiskLoc.
+        const DiskLoc invalidated(0, 5);
+        sort.invalidate(invalidated, INVALIDATION_DELETION);
+
+        int numResults = 0;
+        while (state == PlanStage::ADVANCED) {
+            WorkingSetMember* member = ws.get(id);
+            ASSERT_EQUALS(numResults, member->obj["a"].numberInt());
+            if (member->hasLoc()) {
+                ASSERT_EQUALS(WorkingSetMember::LOC_AND_UNOWNED_OBJ, member->state);
+                ASSERT_NOT_EQUALS(invalidated, member->loc);
+                ASSERT_EQUALS(numResults, (member->loc.getOfs() * 7919) % kNumExternalSortDocs);
+            }
+            else {
+                ASSERT_EQUALS(WorkingSetMember::OWNED_OBJ, member->state);
+                ASSERT_EQUALS(numResults, (invalidated.getOfs() * 7919) % kNumExternalSortDocs);
+            }
+
+            ++numResults;
+            ws.free(id);
+            state = sort.work(&id);
+        }
+        ASSERT_EQUALS(PlanStage::IS_EOF, state);
+
+        const size_t expected = (0 == limit) ? kNumExternalSortDocs : limit;
+        ASSERT_EQUALS(expected, static_cast<size_t>(numResults));
+
+        scoped_ptr<PlanStageStats> stats(sort.getStats());
+        const SortStats* sortStats = static_cast<const SortStats*>(stats->specific.get());
+        ASSERT_GREATER_THAN(sortStats->spillFiles, 0U);
+        ASSERT_GREATER_THAN(sortStats->spillBytes, 0ULL);
+
+        internalQueryExecMaxBlockingSortBytes = oldMaxBytes;
+    }
+
+    TEST(SortStageTest, SortExternal) {
+        testExternalSort(0);
+    }
+
+    TEST(SortStageTest, SortExternalWithLimit) {
+        testExternalSort(500);
+    }
+
+    TEST(SortStageTest, SortExceedsMemoryLimit) {
+        int oldMaxBytes = internalQueryExecMaxBlockingSortBytes;
+        internalQueryExecMaxBlockingSortBytes = 1024;
+
+        WorkingSet ws;
+        MockStage* ms = new MockStage(&ws);
+        pushExternalSortDocs(ms);
+
+        SortStageParams params;
+        params.pattern = fromjson("{a: 1}");
+        SortStage sort(NULL, params, &ws, ms);
+
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        PlanStage::StageState state = PlanStage::NEED_TIME;
+        while (state == PlanStage::NEED_TIME) {
+            state = sort.work(&id);
+        }
+        ASSERT_EQUALS(PlanStage::FAILURE, state);
+
+        internalQueryExecMaxBlockingSortBytes = oldMaxBytes;
+    }
+
 }  // namespace
@@ -0,0 +1,389 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * Microbenchmarks for trees of query execution stages.  The leaves are MockStages holding
+ * generated documents, so what is measured is the stages above them, the WorkingSet and the
+ * matcher and projection code they call.  Each benchmark logs a line of JSON starting with
+ * "STAGE_BENCH" giving the time and the allocations per document read from the leaves:
+ *
+ *   STAGE_BENCH { "benchmark" : "SORT.limit100", "docs" : 100000, "results" : 100,
+ *                 "micros" : 23110, "nsPerDoc" : 231.1, "allocsPerDoc" : 1.02 }
+ *
+ * The index scans, fetches and text index reads of the real trees need a collection, so the
+ * leaves stand in for them: they return what an index scan returns, or what a fetch returns.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+#include "mongo/db/exec/and_hash.h"
+#include "mongo/db/exec/fetch.h"
+#include "mongo/db/exec/merge_sort.h"
+#include "mongo/db/exec/mock_stage.h"
+#include "mongo/db/exec/projection.h"
+#include "mongo/db/exec/sort.h"
+#include "mongo/db/fts/fts_index_format.h"
+#include "mongo/db/fts/fts_matcher.h"
+#include "mongo/db/fts/fts_query.h"
+#include "mongo/db/fts/fts_spec.h"
+#include "mongo/db/json.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/allocation_counter.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
+
+using namespace mongo;
+
+namespace {
+
+    const size_t kNumDocs = 100 * 1000;
+
+    const char* const kWords[] = { "coffee", "roast", "dark", "espresso", "milk", "sugar",
+                                   "cup", "morning", "bean", "grinder", "kettle", "filter",
+                                   "decaf", "latte", "brew", "aroma" };
+    const size_t kNumWords = sizeof(kWords) / sizeof(kWords[0]);
+
+    /**
+     * The generated documents, { _id: i, a: <distinct, in random order>, b: i % 100,
+     * c: <string>, text: <words> }, held here so that members can point into them.
+     */
+    class BenchData {
+    public:
+        BenchData() {
+            PseudoRandom random(12345);
+
+            std::vector<int> a;
+            for (size_t i = 0; i < kNumDocs; i++) {
+                a.push_back(static_cast<int>(i));
+            }
+            std::random_shuffle(a.begin(), a.end(), random);
+
+            for (size_t i = 0; i < kNumDocs; i++) {
+                std::string text;
+                for (int w = 0; w < 12; w++) {
+                    text += kWords[random.nextInt32(kNumWords)];
+                    text += ' ';
+                }
+
+                BSONObjBuilder doc;
+                doc.append("_id", static_cast<int>(i));
+                doc.append("a", a[i]);
+                doc.append("b", static_cast<int>(i % 100));
+                doc.append("c", "abcdefghijklmnopqrstuvwxyz");
+                doc.append("text", text);
+                _docs.push_back(doc.obj());
+            }
+        }
+
+        const BSONObj& doc(size_t i) const { return _docs[i]; }
+
+        /**
+         * Has 'stage' return the 'i'th document as a fetch would, from file 'locFile'.
+         */
+        void pushFetched(MockStage* stage, size_t i, int locFile = 0) const {
+            WorkingSetMember member;
+            member.state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+            member.loc = DiskLoc(locFile, static_cast<int>(i));
+            member.obj = _docs[i];
+            stage->pushBack(member);
+        }
+
+    private:
+        std::vector<BSONObj> _docs;
+    };
+
+    const BenchData& benchData() {
+        static const BenchData data;
+        return data;
+    }
+
+    void reportStageBenchmark(const std::string& name,
+                              size_t docs,
+                              size_t results,
+                              long long micros,
+                              unsigned long long allocations) {
+        BSONObjBuilder result;
+        result.append("benchmark", name);
+        result.appendNumber("docs", static_cast<long long>(docs));
+        result.appendNumber("results", static_cast<long long>(results));
+        result.appendNumber("micros", micros);
+        result.append("nsPerDoc", micros * 1000.0 / docs);
+        result.append("allocsPerDoc", static_cast<double>(allocations) / docs);
+        log() << "STAGE_BENCH " << result.obj().jsonString();
+    }
+
+    /**
+     * Works 'root' to EOF and frees each result like PlanExecutor does, then reports the time
+     * and allocations per each of the 'docs' documents its leaves hold.  Returns the number of
+     * results.
+     */
+    size_t runStageBenchmark(const std::string& name,
+                             PlanStage* root,
+                             WorkingSet* ws,
+                             size_t docs) {
+        size_t results = 0;
+        const unsigned long long allocationsBefore = AllocationCounter::get();
+        Timer timer;
+
+        for (;;) {
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            PlanStage::StageState state = root->work(&id);
+            if (PlanStage::ADVANCED == state) {
+                ++results;
+                ws->free(id);
+            }
+            else if (PlanStage::IS_EOF == state) {
+                break;
+            }
+            else {
+                ASSERT_EQUALS(PlanStage::NEED_TIME, state);
+            }
+        }
+
+        const long long micros = timer.micros();
+        reportStageBenchmark(name, docs, results, micros,
+                             AllocationCounter::get() - allocationsBefore);
+        return results;
+    }
+
+    /**
+     * The leaves read the documents in order of _id unless 'sortedByA', when they read them in
+     * order of 'a' as they would from an index on it.
+     */
+    std::vector<size_t> docOrder(bool sortedByA) {
+        std::vector<std::pair<int, size_t> > order;
+        for (size_t i = 0; i < kNumDocs; i++) {
+            int key = sortedByA ? benchData().doc(i)["a"].numberInt() : static_cast<int>(i);
+            order.push_back(std::make_pair(key, i));
+        }
+        std::sort(order.begin(), order.end());
+
+        std::vector<size_t> docs;
+        for (size_t i = 0; i < order.size(); i++) {
+            docs.push_back(order[i].second);
+        }
+        return docs;
+    }
+
+    /**
+     * IXSCAN -> FETCH -> PROJECTION, where FETCH filters out half the documents.  The leaf
+     * returns fetched documents, so FETCH only applies its filter.
+     */
+    void runFetchProjection(const std::string& name,
+                            ProjectionStageParams::ProjectionImplementation projImpl) {
+        WorkingSet ws;
+        MockStage* scan = new MockStage(&ws);
+        std::vector<size_t> order = docOrder(true);
+        for (size_t i = 0; i < order.size(); i++) {
+            benchData().pushFetched(scan, order[i]);
+        }
+
+        // The expression points into the query, which must outlive it.
+        const BSONObj query = fromjson("{b: {$lt: 50}}");
+        StatusWithMatchExpression filter = MatchExpressionParser::parse(query);
+        ASSERT_OK(filter.getStatus());
+        boost::scoped_ptr<MatchExpression> filterExpr(filter.getValue());
+        FetchStage* fetch = new FetchStage(NULL, &ws, scan, filterExpr.get(), NULL);
+
+        WhereCallbackNoop whereCallback;
+        ProjectionStageParams params(whereCallback);
+        params.projImpl = projImpl;
+        params.projObj = fromjson("{_id: 0, a: 1, c: 1}");
+        ProjectionStage projection(params, &ws, fetch);
+
+        ASSERT_EQUALS(kNumDocs / 2, runStageBenchmark(name, &projection, &ws, kNumDocs));
+    }
+
+    TEST(StageBench, IxscanFetchProjection) {
+        runFetchProjection("IXSCAN_FETCH_PROJECTION", ProjectionStageParams::SIMPLE_DOC);
+    }
+
+    TEST(StageBench, IxscanFetchProjectionExec) {
+        runFetchProjection("IXSCAN_FETCH_PROJECTION.projectionExec",
+                           ProjectionStageParams::NO_FAST_PATH);
+    }
+
+    /**
+     * IXSCAN -> PROJECTION covered by the index { a: 1, b: 1 }.
+     */
+    TEST(StageBench, IxscanCoveredProjection) {
+        const BSONObj keyPattern = BSON("a" << 1 << "b" << 1);
+        std::vector<BSONObj> keys;
+
+        WorkingSet ws;
+        MockStage* scan = new MockStage(&ws);
+        std::vector<size_t> order = docOrder(true);
+        for (size_t i = 0; i < order.size(); i++) {
+            const BSONObj& doc = benchData().doc(order[i]);
+            keys.push_back(BSON("" << doc["a"].numberInt() << "" << doc["b"].numberInt()));
+
+            WorkingSetMember member;
+            member.state = WorkingSetMember::LOC_AND_IDX;
+            member.loc = DiskLoc(0, static_cast<int>(order[i]));
+            member.keyData.push_back(IndexKeyDatum(keyPattern, keys.back()));
+            scan->pushBack(member);
+        }
+
+        WhereCallbackNoop whereCallback;
+        ProjectionStageParams params(whereCallback);
+        params.projImpl = ProjectionStageParams::COVERED_ONE_INDEX;
+        params.projObj = fromjson("{_id: 0, a: 1, b: 1}");
+        params.coveredKeyObj = keyPattern;
+        ProjectionStage projection(params, &ws, scan);
+
+        ASSERT_EQUALS(kNumDocs, runStageBenchmark("IXSCAN_PROJECTION.covered",
+                                                  &projection, &ws, kNumDocs));
+    }
+
+    /**
+     * AND_HASH of two children, the second holding every other document of the first and as
+     * many which are not in the first.
+     */
+    TEST(StageBench, AndHash) {
+        WorkingSet ws;
+        AndHashStage andHash(NULL, &ws, NULL, NULL);
+
+        MockStage* first = new MockStage(&ws);
+        MockStage* second = new MockStage(&ws);
+        std::vector<size_t> order = docOrder(true);
+        for (size_t i = 0; i < order.size(); i++) {
+            benchData().pushFetched(first, order[i]);
+        }
+        for (size_t i = 0; i < order.size(); i++) {
+            benchData().pushFetched(second, order[i], i % 2);
+        }
+        andHash.addChild(first);
+        andHash.addChild(second);
+
+        ASSERT_EQUALS(kNumDocs / 2, runStageBenchmark("AND_HASH", &andHash, &ws, 2 * kNumDocs));
+    }
+
+    void runSort(const std::string& name, size_t limit) {
+        WorkingSet ws;
+        MockStage* scan = new MockStage(&ws);
+        for (size_t i = 0; i < kNumDocs; i++) {
+            benchData().pushFetched(scan, i);
+        }
+
+        SortStageParams params;
+        params.pattern = BSON("a" << 1);
+        params.limit = limit;
+        SortStage sort(NULL, params, &ws, scan);
+
+        ASSERT_EQUALS(limit ? limit : kNumDocs, runStageBenchmark(name, &sort, &ws, kNumDocs));
+    }
+
+    TEST(StageBench, Sort) {
+        runSort("SORT", 0);
+    }
+
+    TEST(StageBench, SortWithLimit) {
+        runSort("SORT.limit100", 100);
+    }
+
+    /**
+     * MERGE_SORT of four children, each sorted on 'a' as an index scan of { x: 1, a: 1 } would
+     * return them for its own value of 'x'.
+     */
+    TEST(StageBench, MergeSort) {
+        const size_t numChildren = 4;
+
+        WorkingSet ws;
+        MergeSortStageParams params;
+        params.pattern = BSON("a" << 1);
+        MergeSortStage mergeSort(NULL, params, &ws, NULL);
+
+        std::vector<MockStage*> children;
+        for (size_t i = 0; i < numChildren; i++) {
+            children.push_back(new MockStage(&ws));
+            mergeSort.addChild(children.back());
+        }
+        std::vector<size_t> order = docOrder(true);
+        for (size_t i = 0; i < order.size(); i++) {
+            benchData().pushFetched(children[order[i] % numChildren], order[i]);
+        }
+
+        ASSERT_EQUALS(kNumDocs, runStageBenchmark("MERGE_SORT", &mergeSort, &ws, kNumDocs));
+    }
+
+    /**
+     * The work TEXT does for each document a top-K search reads: it checks the negated terms and
+     * scores the document against the query terms.  Reading the terms from the text index needs
+     * a collection, so it is left out.
+     */
+    TEST(StageBench, Text) {
+        using namespace fts;
+
+        FTSSpec spec(FTSSpec::fixSpec(BSON("key" << BSON("text" << "text"))));
+        FTSQuery query;
+        ASSERT_OK(query.parse("coffee roast -decaf", "english", TEXT_INDEX_VERSION_2));
+        FTSMatcher matcher(query, spec);
+
+        const std::vector<std::string>& terms = query.getTerms();
+        size_t results = 0;
+        double scores = 0;
+        const unsigned long long allocationsBefore = AllocationCounter::get();
+        Timer timer;
+
+        for (size_t i = 0; i < kNumDocs; i++) {
+            const BSONObj& obj = benchData().doc(i);
+            if (!matcher.matchesNonTerm(obj)) {
+                continue;
+            }
+
+            TermFrequencyMap termScores;
+            spec.scoreDocument(obj, &termScores);
+            double score = 0;
+            for (size_t t = 0; t < terms.size(); t++) {
+                TermFrequencyMap::const_iterator it = termScores.find(terms[t]);
+                if (it != termScores.end()) {
+                    score += FTSIndexFormat::quantizeScore(it->second,
+                                                           spec.getTextIndexVersion());
+                }
+            }
+            if (score > 0) {
+                ++results;
+                scores += score;
+            }
+        }
+
+        const long long micros = timer.micros();
+        reportStageBenchmark("TEXT.scoreDocument", kNumDocs, results, micros,
+                             AllocationCounter::get() - allocationsBefore);
+        ASSERT_GREATER_THAN(scores, 0);
+    }
+
+} // namespace
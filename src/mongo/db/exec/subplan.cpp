@@ -127,7 +127,7 @@ namespace mongo {
     Status SubplanStage::planSubqueries() {
         // Adds the amount of time taken by planSubqueries() to executionTimeMillis. There's lots of
         // work that happens here, so this is needed for the time accounting to make sense.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         MatchExpression* theOr = _query->root();
 
@@ -433,7 +433,7 @@ namespace mongo {
     Status SubplanStage::pickBestPlan(PlanYieldPolicy* yieldPolicy) {
         // Adds the amount of time taken by pickBestPlan() to executionTimeMillis. There's lots of
         // work that happens here, so this is needed for the time accounting to make sense.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         // Plan each branch of the $or.
         Status subplanningStatus = planSubqueries();
@@ -465,7 +465,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (_killed) {
             return PlanStage::DEAD;
@@ -36,12 +36,27 @@
 #include "mongo/db/exec/working_set_computed_data.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/query/internal_plans.h"
+#include "mongo/db/query/query_knobs.h"
 
 namespace mongo {
 
     // static
     const char* TextStage::kStageType = "TEXT";
 
+    /**
+     * Returns the score within a possibly compound text index key: {prefix,term,score,suffix}.
+     */
+    static double getTermScore(const FTSSpec& spec, const BSONObj& key) {
+        BSONObjIterator keyIt(key);
+        for (unsigned i = 0; i < spec.numExtraBefore(); i++) {
+            keyIt.next();
+        }
+
+        keyIt.next(); // Skip past 'term'.
+
+        return FTSIndexFormat::decodeScore(keyIt.next(), spec.getTextIndexVersion());
+    }
+
     TextStage::TextStage(OperationContext* txn,
                          const TextStageParams& params,
                          WorkingSet* ws,
@@ -53,9 +68,13 @@ namespace mongo {
           _filter(filter),
           _commonStats(kStageType),
           _internalState(INIT_SCANS),
-          _currentIndexScanner(0) {
+          _currentIndexScanner(0),
+          _scannersLeft(0),
+          _currentNegatedScanner(0),
+          _negationFromIndex(false) {
         _scoreIterator = _scores.end();
         _specificStats.indexPrefix = _params.indexPrefix;
+        _specificStats.topK = _params.topK;
     }
 
     TextStage::~TextStage() { }
@@ -68,7 +87,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (isEOF()) { return PlanStage::IS_EOF; }
         invariant(_internalState != DONE);
@@ -79,8 +98,12 @@ namespace mongo {
         case INIT_SCANS:
             stageState = initScans(out);
             break;
+        case READING_NEGATED_TERMS:
+            stageState = readNegatedTerms(out);
+            break;
         case READING_TERMS:
-            stageState = readFromSubScanners(out);
+            stageState = 0 == _params.topK ? readFromSubScanners(out)
+                                           : readTopKFromSubScanners(out);
             break;
         case RETURNING_RESULTS:
             stageState = returnResults(out);
@@ -114,6 +137,9 @@ namespace mongo {
         for (size_t i = 0; i < _scanners.size(); ++i) {
             _scanners.mutableVector()[i]->saveState();
         }
+        for (size_t i = 0; i < _negatedScanners.size(); ++i) {
+            _negatedScanners.mutableVector()[i]->saveState();
+        }
     }
 
     void TextStage::restoreState(OperationContext* opCtx) {
@@ -123,6 +149,9 @@ namespace mongo {
         for (size_t i = 0; i < _scanners.size(); ++i) {
             _scanners.mutableVector()[i]->restoreState(opCtx);
         }
+        for (size_t i = 0; i < _negatedScanners.size(); ++i) {
+            _negatedScanners.mutableVector()[i]->restoreState(opCtx);
+        }
     }
 
     void TextStage::invalidate(const DiskLoc& dl, InvalidationType type) {
@@ -132,17 +161,32 @@ namespace mongo {
         for (size_t i = 0; i < _scanners.size(); ++i) {
             _scanners.mutableVector()[i]->invalidate(dl, type);
         }
+        for (size_t i = 0; i < _negatedScanners.size(); ++i) {
+            _negatedScanners.mutableVector()[i]->invalidate(dl, type);
+        }
+
+        // The negated term keys read so far say nothing about the changed document.
+        if (_negationFromIndex) {
+            _negatedLocs.erase(dl);
+            _recheckNegation.insert(dl);
+        }
 
         // We store the score keyed by DiskLoc.  We have to toss out our state when the DiskLoc
         // changes.
         // TODO: If we're RETURNING_RESULTS we could somehow buffer the object.
         ScoreMap::iterator scoreIt = _scores.find(dl);
         if (scoreIt != _scores.end()) {
+            _topK.erase(std::make_pair(scoreIt->second, dl));
             if (scoreIt == _scoreIterator) {
                 _scoreIterator++;
             }
             _scores.erase(scoreIt);
         }
+
+        // A changed document has to be scored again if a term finds it later.
+        if (INVALIDATION_MUTATION == type) {
+            _seen.erase(dl);
+        }
     }
 
     vector<PlanStage*> TextStage::getChildren() const {
@@ -180,21 +224,7 @@ namespace mongo {
 
         // Get all the index scans for each term in our query.
         for (size_t i = 0; i < _params.query.getTerms().size(); i++) {
-            const string& term = _params.query.getTerms()[i];
-            IndexScanParams params;
-            params.bounds.startKey = FTSIndexFormat::getIndexKey(MAX_WEIGHT,
-                                                                 term,
-                                                                 _params.indexPrefix,
-                                                                 _params.spec.getTextIndexVersion());
-            params.bounds.endKey = FTSIndexFormat::getIndexKey(0,
-                                                               term,
-                                                                _params.indexPrefix,
-                                                               _params.spec.getTextIndexVersion());
-            params.bounds.endKeyInclusive = true;
-            params.bounds.isSimpleRange = true;
-            params.descriptor = _params.index;
-            params.direction = -1;
-            _scanners.mutableVector().push_back(new IndexScan(_txn, params, _ws, NULL));
+            _scanners.mutableVector().push_back(makeTermScan(_params.query.getTerms()[i]));
         }
 
         // If we have no terms we go right to EOF.
@@ -203,11 +233,86 @@ namespace mongo {
             return PlanStage::IS_EOF;
         }
 
+        // No key of a term scores more than the scan's start key.
+        _termUpperBounds.assign(_scanners.size(), MAX_WEIGHT);
+        _scannerEOF.assign(_scanners.size(), false);
+        _scannersLeft = _scanners.size();
+
+        // A document has a key for a term exactly when the term is in one of its indexed
+        // strings.  Version 1 indexes keep stop words out of the keys differently from the
+        // matcher, so they are left to the matcher.
+        const std::set<string>& negatedTerms = _params.query.getNegatedTerms();
+        if (internalQueryTextNegatedTermsFromIndex
+            && !negatedTerms.empty()
+            && fts::TEXT_INDEX_VERSION_1 != _params.spec.getTextIndexVersion()) {
+            for (std::set<string>::const_iterator it = negatedTerms.begin();
+                 it != negatedTerms.end();
+                 ++it) {
+                _negatedScanners.mutableVector().push_back(makeTermScan(*it));
+            }
+            _negationFromIndex = true;
+            _internalState = READING_NEGATED_TERMS;
+            return PlanStage::NEED_TIME;
+        }
+
         // Transition to the next state.
         _internalState = READING_TERMS;
         return PlanStage::NEED_TIME;
     }
 
+    PlanStage* TextStage::makeTermScan(const string& term) {
+        IndexScanParams params;
+        params.bounds.startKey = FTSIndexFormat::getIndexKey(MAX_WEIGHT,
+                                                             term,
+                                                             _params.indexPrefix,
+                                                             _params.spec.getTextIndexVersion());
+        params.bounds.endKey = FTSIndexFormat::getIndexKey(0,
+                                                           term,
+                                                           _params.indexPrefix,
+                                                           _params.spec.getTextIndexVersion());
+        params.bounds.endKeyInclusive = true;
+        params.bounds.isSimpleRange = true;
+        params.descriptor = _params.index;
+        params.direction = -1;
+        return new IndexScan(_txn, params, _ws, NULL);
+    }
+
+    PlanStage::StageState TextStage::readNegatedTerms(WorkingSetID* out) {
+        invariant(_currentNegatedScanner < _negatedScanners.size());
+
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        PlanStage::StageState childState =
+            _negatedScanners.vector()[_currentNegatedScanner]->work(&id);
+
+        if (PlanStage::ADVANCED == childState) {
+            WorkingSetMember* wsm = _ws->get(id);
+            invariant(wsm->hasLoc());
+            ++_specificStats.keysExamined;
+            _negatedLocs.insert(wsm->loc);
+            _ws->free(id);
+            return PlanStage::NEED_TIME;
+        }
+        else if (PlanStage::IS_EOF == childState) {
+            if (++_currentNegatedScanner == _negatedScanners.size()) {
+                _negatedScanners.clear();
+                _internalState = READING_TERMS;
+            }
+            return PlanStage::NEED_TIME;
+        }
+        else {
+            if (PlanStage::FAILURE == childState) {
+                *out = id;
+                if (WorkingSet::INVALID_ID == id) {
+                    mongoutils::str::stream ss;
+                    ss << "text stage failed to read negated terms from child";
+                    Status status(ErrorCodes::InternalError, ss);
+                    *out = WorkingSetCommon::allocateStatusMember( _ws, status);
+                }
+            }
+            return childState;
+        }
+    }
+
     PlanStage::StageState TextStage::readFromSubScanners(WorkingSetID* out) {
         // This should be checked before we get here.
         invariant(_currentIndexScanner < _scanners.size());
@@ -235,11 +340,7 @@ namespace mongo {
             }
 
             // If we're here we are done reading results.  Move to the next state.
-            _scoreIterator = _scores.begin();
-            _internalState = RETURNING_RESULTS;
-
-            // Don't need to keep these around.
-            _scanners.clear();
+            finishReadingTerms();
             return PlanStage::NEED_TIME;
         }
         else {
@@ -260,6 +361,130 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState TextStage::readTopKFromSubScanners(WorkingSetID* out) {
+        // This should be checked before we get here.
+        invariant(_currentIndexScanner < _scanners.size());
+        invariant(!_scannerEOF[_currentIndexScanner]);
+
+        // Read the next result from our current scanner.
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        PlanStage::StageState childState = _scanners.vector()[_currentIndexScanner]->work(&id);
+
+        if (PlanStage::ADVANCED == childState) {
+            WorkingSetMember* wsm = _ws->get(id);
+            invariant(1 == wsm->keyData.size());
+            invariant(wsm->hasLoc());
+            ++_specificStats.keysExamined;
+            _termUpperBounds[_currentIndexScanner] =
+                getTermScore(_params.spec, wsm->keyData.back().keyData);
+            const DiskLoc loc = wsm->loc;
+            _ws->free(id);
+
+            if (_seen.insert(loc).second) {
+                addTopKCandidate(loc);
+            }
+        }
+        else if (PlanStage::IS_EOF == childState) {
+            // Done with this scan.
+            _scannerEOF[_currentIndexScanner] = true;
+            _termUpperBounds[_currentIndexScanner] = 0;
+
+            if (0 == --_scannersLeft) {
+                finishReadingTerms();
+                return PlanStage::NEED_TIME;
+            }
+        }
+        else {
+            if (PlanStage::FAILURE == childState) {
+                // Propagate failure from below.
+                *out = id;
+                if (WorkingSet::INVALID_ID == id) {
+                    mongoutils::str::stream ss;
+                    ss << "text stage failed to read in results from child";
+                    Status status(ErrorCodes::InternalError, ss);
+                    *out = WorkingSetCommon::allocateStatusMember( _ws, status);
+                }
+            }
+            return childState;
+        }
+
+        // Once the worst of the top K scores at least as much as a document matching every term
+        // with its bound, no document we haven't seen can make it in.
+        if (_topK.size() == _params.topK) {
+            double unseenBound = 0;
+            for (size_t i = 0; i < _termUpperBounds.size(); ++i) {
+                unseenBound += _termUpperBounds[i];
+            }
+
+            if (_topK.begin()->first >= unseenBound) {
+                finishReadingTerms();
+                return PlanStage::NEED_TIME;
+            }
+        }
+
+        // Move on to the next term with keys left.
+        do {
+            _currentIndexScanner = (_currentIndexScanner + 1) % _scanners.size();
+        } while (_scannerEOF[_currentIndexScanner]);
+
+        return PlanStage::NEED_TIME;
+    }
+
+    void TextStage::addTopKCandidate(const DiskLoc& loc) {
+        if (_negatedLocs.count(loc)) {
+            return;
+        }
+
+        BSONObj obj = _params.index->getCollection()->docFor(_txn, loc);
+        ++_specificStats.fetches;
+
+        if (_filter && !_filter->matchesBSON(obj)) {
+            return;
+        }
+
+        if (!matchesNonTerm(loc, obj)) {
+            return;
+        }
+
+        // This is the sum of the document's keys for the query terms, which the other terms'
+        // scans would only find later.
+        fts::TermFrequencyMap termScores;
+        _params.spec.scoreDocument(obj, &termScores);
+
+        double score = 0;
+        const vector<string>& terms = _params.query.getTerms();
+        for (size_t i = 0; i < terms.size(); ++i) {
+            fts::TermFrequencyMap::const_iterator it = termScores.find(terms[i]);
+            if (it != termScores.end()) {
+                // Match what the term's index key would contribute.
+                score += FTSIndexFormat::quantizeScore(it->second,
+                                                       _params.spec.getTextIndexVersion());
+            }
+        }
+
+        if (_topK.size() == _params.topK) {
+            if (score <= _topK.begin()->first) {
+                return;
+            }
+            _scores.erase(_topK.begin()->second);
+            _topK.erase(_topK.begin());
+        }
+
+        _topK.insert(std::make_pair(score, loc));
+        _scores[loc] = score;
+    }
+
+    void TextStage::finishReadingTerms() {
+        _scoreIterator = _scores.begin();
+        _internalState = RETURNING_RESULTS;
+
+        // Don't need to keep these around.
+        _scanners.clear();
+        _topK.clear();
+        _seen.clear();
+        _negatedLocs.clear();
+    }
+
     PlanStage::StageState TextStage::returnResults(WorkingSetID* out) {
         if (_scoreIterator == _scores.end()) {
             _internalState = DONE;
@@ -276,18 +501,19 @@ namespace mongo {
             return PlanStage::NEED_TIME;
         }
 
-        // Filter for phrases and negated terms
-        if (_params.query.hasNonTermPieces()) {
-            if (!_ftsMatcher.matchesNonTerm(_params.index->getCollection()->docFor(_txn, loc))) {
-                return PlanStage::NEED_TIME;
-            }
+        BSONObj obj = _params.index->getCollection()->docFor(_txn, loc);
+
+        // Filter for phrases and negated terms, which top-K candidates already passed
+        if (0 == _params.topK && !matchesNonTerm(loc, obj)) {
+            return PlanStage::NEED_TIME;
         }
 
         *out = _ws->allocate();
         WorkingSetMember* member = _ws->get(*out);
         member->loc = loc;
-        member->obj = _params.index->getCollection()->docFor(_txn, member->loc);
+        member->obj = obj;
         member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+        _commonStats.docBytesExamined += member->obj.objsize();
         member->addComputed(new TextScoreComputedData(score));
         return PlanStage::ADVANCED;
     }
@@ -355,17 +581,8 @@ namespace mongo {
 
         ++_specificStats.keysExamined;
 
-        // Locate score within possibly compound key: {prefix,term,score,suffix}.
-        BSONObjIterator keyIt(key);
-        for (unsigned i = 0; i < _params.spec.numExtraBefore(); i++) {
-            keyIt.next();
-        }
-
-        keyIt.next(); // Skip past 'term'.
+        double documentTermScore = getTermScore(_params.spec, key);
 
-        BSONElement scoreElement = keyIt.next();
-        double documentTermScore = scoreElement.number();
-        
         // Handle filtering.
         if (*documentAggregateScore < 0) {
             // We have already rejected this document.
@@ -373,6 +590,12 @@ namespace mongo {
         }
 
         if (*documentAggregateScore == 0) {
+            if (_negatedLocs.count(loc)) {
+                // The document has a negated term.
+                *documentAggregateScore = -1;
+                return;
+            }
+
             if (_filter) {
                 // We have not seen this document before and need to apply a filter.
                 bool fetched = false;
@@ -402,4 +625,12 @@ namespace mongo {
         *documentAggregateScore += documentTermScore;
     }
 
+    bool TextStage::matchesNonTerm(const DiskLoc& loc, const BSONObj& obj) const {
+        if (_negationFromIndex && !_recheckNegation.count(loc)) {
+            // The document has no key for any negated term.
+            return _ftsMatcher.phrasesMatch(obj);
+        }
+        return !_params.query.hasNonTermPieces() || _ftsMatcher.matchesNonTerm(obj);
+    }
+
 }  // namespace mongo
@@ -39,9 +39,11 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/platform/unordered_map.h"
+#include "mongo/platform/unordered_set.h"
 
 #include <map>
 #include <queue>
+#include <set>
 #include <vector>
 
 namespace mongo {
@@ -55,7 +57,7 @@ namespace mongo {
     class OperationContext;
 
     struct TextStageParams {
-        TextStageParams(const FTSSpec& s) : spec(s) {}
+        TextStageParams(const FTSSpec& s) : spec(s), topK(0) {}
 
         // Text index descriptor.  IndexCatalog owns this.
         IndexDescriptor* index;
@@ -68,6 +70,9 @@ namespace mongo {
 
         // The text query.
         FTSQuery query;
+
+        // If non-zero, only the 'topK' highest scoring documents have to be returned.
+        size_t topK;
     };
 
     /**
@@ -76,6 +81,11 @@ namespace mongo {
      * Prerequisites: None; is a leaf node.
      * Output type: LOC_AND_OBJ_UNOWNED.
      *
+     * With a top-K limit the stage reads the terms' postings, which the index orders by
+     * descending score, in turns.  It scores each new document in full from the document itself
+     * and stops once the K-th best score is at least the sum of the scores last read for each
+     * term, which no document not yet seen can exceed.
+     *
      * TODO: Should the TextStage ever generate NEED_FETCH requests? Right now this stage could
      * reduce concurrency by failing to request a yield during fetch.
      */
@@ -88,13 +98,16 @@ namespace mongo {
             // 1. Initialize the index scans we use to retrieve term/score info.
             INIT_SCANS,
 
-            // 2. Read the terms/scores from the text index.
+            // 2. Read the documents holding negated terms from the text index.
+            READING_NEGATED_TERMS,
+
+            // 3. Read the terms/scores from the text index.
             READING_TERMS,
 
-            // 3. Return results to our parent.
+            // 4. Return results to our parent.
             RETURNING_RESULTS,
 
-            // 4. Done.
+            // 5. Done.
             DONE,
         };
 
@@ -130,12 +143,37 @@ namespace mongo {
          */
         StageState initScans(WorkingSetID* out);
 
+        /**
+         * Returns a scan over the keys of 'term', from the highest score down.
+         */
+        PlanStage* makeTermScan(const std::string& term);
+
+        StageState readNegatedTerms(WorkingSetID* out);
+
         /**
          * Helper for buffering results array.  Returns NEED_TIME (if any results were produced),
          * IS_EOF, or FAILURE.
          */
         StageState readFromSubScanners(WorkingSetID* out);
 
+        /**
+         * Same as readFromSubScanners() with a top-K limit, reading one key of each term in turn
+         * and stopping early once no document not yet seen can enter the top K.
+         */
+        StageState readTopKFromSubScanners(WorkingSetID* out);
+
+        /**
+         * Helper called from readTopKFromSubScanners for a document read for the first time.
+         * Scores it against all query terms and keeps it if it matches and is among the best
+         * 'topK' documents seen so far.
+         */
+        void addTopKCandidate(const DiskLoc& loc);
+
+        /**
+         * Moves to RETURNING_RESULTS once the terms have been read.
+         */
+        void finishReadingTerms();
+
         /**
          * Helper called from readFromSubScanners to update aggregate score with a new-found (term,
          * score) pair for this document.  Also rejects documents that don't match this stage's
@@ -143,6 +181,12 @@ namespace mongo {
          */
         void addTerm(const BSONObj& key, const DiskLoc& loc);
 
+        /**
+         * Returns whether the document 'obj' at 'loc' passes the query's phrases and negated
+         * terms, leaving out the negated terms when their index keys have already been checked.
+         */
+        bool matchesNonTerm(const DiskLoc& loc, const BSONObj& obj) const;
+
         /**
          * Possibly return a result.  FYI, this may perform a fetch directly if it is needed to
          * evaluate all filters.
@@ -184,6 +228,31 @@ namespace mongo {
         typedef unordered_map<DiskLoc, double, DiskLoc::Hasher> ScoreMap;
         ScoreMap _scores;
         ScoreMap::const_iterator _scoreIterator;
+
+        // Only used with a top-K limit, in READING_TERMS.  With it '_scores' holds just the best
+        // documents so far, which '_topK' orders by ascending score.
+        typedef std::set<std::pair<double, DiskLoc> > TopKSet;
+        TopKSet _topK;
+
+        // Documents read from any term so far.
+        unordered_set<DiskLoc, DiskLoc::Hasher> _seen;
+
+        // For each scanner, the score of the last key it returned, which bounds the score of the
+        // keys it has yet to return; 0 once the scanner is exhausted.
+        std::vector<double> _termUpperBounds;
+        std::vector<bool> _scannerEOF;
+        size_t _scannersLeft;
+
+        // Only used in READING_NEGATED_TERMS.  The index scans over the negated terms.
+        OwnedPointerVector<PlanStage> _negatedScanners;
+        size_t _currentNegatedScanner;
+
+        // Whether the negated terms are checked from the index rather than from documents.  If
+        // so, '_negatedLocs' holds the documents that have a key for some negated term, and
+        // '_recheckNegation' those that changed since, whose documents have to be checked.
+        bool _negationFromIndex;
+        unordered_set<DiskLoc, DiskLoc::Hasher> _negatedLocs;
+        unordered_set<DiskLoc, DiskLoc::Hasher> _recheckNegation;
     };
 
 } // namespace mongo
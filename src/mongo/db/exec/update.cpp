@@ -421,74 +421,82 @@ namespace mongo {
         // place", that is, some values of the old document just get adjusted without any
         // change to the binary layout on the bson layer. It may be that a whole new
         // document is needed to accomodate the new bson layout of the resulting document.
-        _doc.reset(oldObj, mutablebson::Document::kInPlaceEnabled);
+        //
+        // Simple $set and $inc updates are first offered to the driver directly, which
+        // computes the damages from the old document without building a mutable one.
+        const std::vector<FieldRef*>* immutableFields = NULL;
+        if (lifecycle)
+            immutableFields = lifecycle->getImmutableFields();
+
         BSONObj logObj;
+        const char* source = NULL;
+        bool inPlace = driver->updateInPlace(oldObj, immutableFields, &_damages, &source, &logObj);
 
-        FieldRefSet updatedFields;
+        if (!inPlace) {
+            _doc.reset(oldObj, mutablebson::Document::kInPlaceEnabled);
 
-        Status status = Status::OK();
-        if (!driver->needMatchDetails()) {
-            // If we don't need match details, avoid doing the rematch
-            status = driver->update(StringData(), &_doc, &logObj, &updatedFields);
-        }
-        else {
-            // If there was a matched field, obtain it.
-            MatchDetails matchDetails;
-            matchDetails.requestElemMatchKey();
+            FieldRefSet updatedFields;
 
-            dassert(cq);
-            verify(cq->root()->matchesBSON(oldObj, &matchDetails));
+            Status status = Status::OK();
+            if (!driver->needMatchDetails()) {
+                // If we don't need match details, avoid doing the rematch
+                status = driver->update(StringData(), &_doc, &logObj, &updatedFields);
+            }
+            else {
+                // If there was a matched field, obtain it.
+                MatchDetails matchDetails;
+                matchDetails.requestElemMatchKey();
 
-            string matchedField;
-            if (matchDetails.hasElemMatchKey())
-                matchedField = matchDetails.elemMatchKey();
+                dassert(cq);
+                verify(cq->root()->matchesBSON(oldObj, &matchDetails));
 
-            // TODO: Right now, each mod checks in 'prepare' that if it needs positional
-            // data, that a non-empty StringData() was provided. In principle, we could do
-            // that check here in an else clause to the above conditional and remove the
-            // checks from the mods.
+                string matchedField;
+                if (matchDetails.hasElemMatchKey())
+                    matchedField = matchDetails.elemMatchKey();
 
-            status = driver->update(matchedField, &_doc, &logObj, &updatedFields);
-        }
+                // TODO: Right now, each mod checks in 'prepare' that if it needs positional
+                // data, that a non-empty StringData() was provided. In principle, we could do
+                // that check here in an else clause to the above conditional and remove the
+                // checks from the mods.
 
-        if (!status.isOK()) {
-            uasserted(16837, status.reason());
-        }
+                status = driver->update(matchedField, &_doc, &logObj, &updatedFields);
+            }
 
-        // Ensure _id exists and is first
-        uassertStatusOK(ensureIdAndFirst(_doc));
+            if (!status.isOK()) {
+                uasserted(16837, status.reason());
+            }
 
-        // If the driver applied the mods in place, we can ask the mutable for what
-        // changed. We call those changes "damages". :) We use the damages to inform the
-        // journal what was changed, and then apply them to the original document
-        // ourselves. If, however, the driver applied the mods out of place, we ask it to
-        // generate a new, modified document for us. In that case, the file manager will
-        // take care of the journaling details for us.
-        //
-        // This code flow is admittedly odd. But, right now, journaling is baked in the file
-        // manager. And if we aren't using the file manager, we have to do jounaling
-        // ourselves.
-        bool docWasModified = false;
-        BSONObj newObj;
-        const char* source = NULL;
-        bool inPlace = _doc.getInPlaceUpdates(&_damages, &source);
-
-        // If something changed in the document, verify that no immutable fields were changed
-        // and data is valid for storage.
-        if ((!inPlace || !_damages.empty()) ) {
-            if (!(request->isFromReplication() || request->isFromMigration())) {
-                const std::vector<FieldRef*>* immutableFields = NULL;
-                if (lifecycle)
-                    immutableFields = lifecycle->getImmutableFields();
-
-                uassertStatusOK(validate(oldObj,
-                                         updatedFields,
-                                         _doc,
-                                         immutableFields,
-                                         driver->modOptions()) );
+            // Ensure _id exists and is first
+            uassertStatusOK(ensureIdAndFirst(_doc));
+
+            // If the driver applied the mods in place, we can ask the mutable for what
+            // changed. We call those changes "damages". :) We use the damages to inform the
+            // journal what was changed, and then apply them to the original document
+            // ourselves. If, however, the driver applied the mods out of place, we ask it to
+            // generate a new, modified document for us. In that case, the file manager will
+            // take care of the journaling details for us.
+            //
+            // This code flow is admittedly odd. But, right now, journaling is baked in the
+            // file manager. And if we aren't using the file manager, we have to do jounaling
+            // ourselves.
+            inPlace = _doc.getInPlaceUpdates(&_damages, &source);
+
+            // If something changed in the document, verify that no immutable fields were
+            // changed and data is valid for storage.
+            if ((!inPlace || !_damages.empty()) ) {
+                if (!(request->isFromReplication() || request->isFromMigration())) {
+                    uassertStatusOK(validate(oldObj,
+                                             updatedFields,
+                                             _doc,
+                                             immutableFields,
+                                             driver->modOptions()) );
+                }
             }
         }
 
+        bool docWasModified = false;
+        BSONObj newObj;
+
         {
             WriteUnitOfWork wunit(request->getOpCtx());
 
@@ -522,11 +530,17 @@ namespace mongo {
                 // Don't actually do the write if this is an explain.
                 if (!request->isExplain()) {
                     invariant(_collection);
+                    // The driver only knows which paths are indexed if it has a lifecycle,
+                    // and a replacement can change any of them.
+                    const bool indexesAffected = !lifecycle
+                                                 || driver->isDocReplacement()
+                                                 || driver->modsAffectIndices();
                     StatusWith<DiskLoc> res = _collection->updateDocument(request->getOpCtx(),
                                                                           loc,
                                                                           newObj,
                                                                           true,
-                                                                          _params.opDebug);
+                                                                          _params.opDebug,
+                                                                          indexesAffected);
                     uassertStatusOK(res.getStatus());
                     DiskLoc newLoc = res.getValue();
 
@@ -684,7 +698,7 @@ namespace mongo {
         ++_commonStats.works;
 
         // Adds the amount of time taken by work() to executionTimeMillis.
-        ScopedTimer timer(&_commonStats.executionTimeMillis);
+        ScopedTimer timer(&_commonStats);
 
         if (isEOF()) { return PlanStage::IS_EOF; }
 
@@ -747,6 +761,7 @@ namespace mongo {
 
             // Do the update and return.
             BSONObj reFetched;
+            int attempt = 1;
             while ( 1 ) {
                 try {
                     transformAndUpdate(reFetched.isEmpty() ? oldObj : reFetched , loc);
@@ -758,8 +773,9 @@ namespace mongo {
                         throw;
                     }
 
-                    log() << "Had WriteConflict in the middle of a multi-update, redoing the doc";
                     OperationContext* txn = _params.request->getOpCtx();
+                    WriteConflictException::logAndBackoff( txn, attempt++, "multi-update",
+                                                           _collection->ns().ns() );
                     txn->recoveryUnit()->commitAndRestart();
                     if ( !_collection->findDoc( txn, loc, &reFetched ) ) {
                         // document was deleted, we're done here
@@ -113,6 +113,7 @@ namespace mongo {
 
         keyData.clear();
         obj = BSONObj();
+        fieldIndex.reset();
         state = WorkingSetMember::INVALID;
     }
 
@@ -161,7 +162,7 @@ namespace mongo {
     bool WorkingSetMember::getFieldDotted(const string& field, BSONElement* out) const {
         // If our state is such that we have an object, use it.
         if (hasObj()) {
-            *out = obj.getFieldDotted(field);
+            *out = fieldIndex.getFieldDotted(obj, field);
             return true;
         }
 
@@ -32,6 +32,7 @@
 #include <vector>
 
 #include "mongo/base/disallow_copying.h"
+#include "mongo/bson/bson_field_index.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/platform/unordered_map.h"
@@ -236,6 +237,11 @@ namespace mongo {
         bool hasOwnedObj() const;
         bool hasUnownedObj() const;
 
+        // Finds the top level fields of 'obj' for the filter, projection and sort of a query,
+        // once enough of them have asked.  Follows 'obj' by identity, so assigning a new object
+        // needs no bookkeeping.
+        BSONFieldIndex fieldIndex;
+
         //
         // Computed data
         //
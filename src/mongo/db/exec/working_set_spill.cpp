@@ -0,0 +1,197 @@
+// working_set_spill.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/working_set_spill.h"
+
+#include "mongo/db/exec/working_set_computed_data.h"
+#include "mongo/util/bufreader.h"
+
+namespace mongo {
+
+    SpilledWorkingSetMember::SpilledWorkingSetMember(const WorkingSetMember& member)
+        : _flags(0),
+          _textScore(0),
+          _geoDistance(0) {
+        invariant(member.hasLoc() || member.hasObj());
+        if (member.hasLoc()) {
+            _loc = member.loc;
+        }
+
+        if (member.hasObj()) {
+            _flags |= kObj;
+            _obj = member.obj.getOwned();
+        }
+        else {
+            for (size_t i = 0; i < member.keyData.size(); ++i) {
+                const IndexKeyDatum& datum = member.keyData[i];
+                _keyData.push_back(IndexKeyDatum(datum.indexKeyPattern.getOwned(),
+                                                 datum.keyData.getOwned()));
+            }
+        }
+
+        if (member.hasComputed(WSM_COMPUTED_TEXT_SCORE)) {
+            _flags |= kTextScore;
+            _textScore = static_cast<const TextScoreComputedData*>(
+                member.getComputed(WSM_COMPUTED_TEXT_SCORE))->getScore();
+        }
+        if (member.hasComputed(WSM_COMPUTED_GEO_DISTANCE)) {
+            _flags |= kGeoDistance;
+            _geoDistance = static_cast<const GeoDistanceComputedData*>(
+                member.getComputed(WSM_COMPUTED_GEO_DISTANCE))->getDist();
+        }
+        if (member.hasComputed(WSM_GEO_NEAR_POINT)) {
+            _flags |= kGeoNearPoint;
+            _geoNearPoint = static_cast<const GeoNearPointComputedData*>(
+                member.getComputed(WSM_GEO_NEAR_POINT))->getPoint();
+        }
+        if (member.hasComputed(WSM_INDEX_KEY)) {
+            _flags |= kIndexKey;
+            _indexKey = static_cast<const IndexKeyComputedData*>(
+                member.getComputed(WSM_INDEX_KEY))->getKey();
+        }
+    }
+
+    void SpilledWorkingSetMember::toMember(WorkingSetMember* member,
+                                           bool locInvalidated) const {
+        if (_flags & kObj) {
+            member->obj = _obj;
+        }
+
+        if (_loc.isNull() || locInvalidated) {
+            invariant(_flags & kObj);
+            member->state = WorkingSetMember::OWNED_OBJ;
+        }
+        else if (_flags & kObj) {
+            member->loc = _loc;
+            member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+        }
+        else {
+            member->loc = _loc;
+            member->keyData = _keyData;
+            member->state = WorkingSetMember::LOC_AND_IDX;
+        }
+
+        if (_flags & kTextScore) {
+            member->addComputed(new TextScoreComputedData(_textScore));
+        }
+        if (_flags & kGeoDistance) {
+            member->addComputed(new GeoDistanceComputedData(_geoDistance));
+        }
+        if (_flags & kGeoNearPoint) {
+            member->addComputed(new GeoNearPointComputedData(_geoNearPoint));
+        }
+        if (_flags & kIndexKey) {
+            member->addComputed(new IndexKeyComputedData(_indexKey));
+        }
+    }
+
+    void SpilledWorkingSetMember::serializeForSorter(BufBuilder& buf) const {
+        _loc.serializeForSorter(buf);
+        buf.appendNum(_flags);
+        if (_flags & kObj) {
+            _obj.serializeForSorter(buf);
+        }
+        buf.appendNum(static_cast<int>(_keyData.size()));
+        for (size_t i = 0; i < _keyData.size(); ++i) {
+            _keyData[i].indexKeyPattern.serializeForSorter(buf);
+            _keyData[i].keyData.serializeForSorter(buf);
+        }
+        if (_flags & kTextScore) {
+            buf.appendNum(_textScore);
+        }
+        if (_flags & kGeoDistance) {
+            buf.appendNum(_geoDistance);
+        }
+        if (_flags & kGeoNearPoint) {
+            _geoNearPoint.serializeForSorter(buf);
+        }
+        if (_flags & kIndexKey) {
+            _indexKey.serializeForSorter(buf);
+        }
+    }
+
+    // static
+    SpilledWorkingSetMember SpilledWorkingSetMember::deserializeForSorter(
+            BufReader& buf, const SorterDeserializeSettings&) {
+        const BSONObj::SorterDeserializeSettings objSettings;
+
+        SpilledWorkingSetMember value;
+        value._loc = DiskLoc::deserializeForSorter(buf, DiskLoc::SorterDeserializeSettings());
+        buf.read(value._flags);
+        if (value._flags & kObj) {
+            value._obj = BSONObj::deserializeForSorter(buf, objSettings);
+        }
+        int numKeyData;
+        buf.read(numKeyData);
+        for (int i = 0; i < numKeyData; ++i) {
+            BSONObj keyPattern = BSONObj::deserializeForSorter(buf, objSettings);
+            BSONObj key = BSONObj::deserializeForSorter(buf, objSettings);
+            value._keyData.push_back(IndexKeyDatum(keyPattern, key));
+        }
+        if (value._flags & kTextScore) {
+            buf.read(value._textScore);
+        }
+        if (value._flags & kGeoDistance) {
+            buf.read(value._geoDistance);
+        }
+        if (value._flags & kGeoNearPoint) {
+            value._geoNearPoint = BSONObj::deserializeForSorter(buf, objSettings);
+        }
+        if (value._flags & kIndexKey) {
+            value._indexKey = BSONObj::deserializeForSorter(buf, objSettings);
+        }
+        return value;
+    }
+
+    int SpilledWorkingSetMember::memUsageForSorter() const {
+        int memUsage = sizeof(SpilledWorkingSetMember) + _obj.objsize()
+                       + _geoNearPoint.objsize() + _indexKey.objsize();
+        for (size_t i = 0; i < _keyData.size(); ++i) {
+            memUsage += sizeof(IndexKeyDatum) + _keyData[i].indexKeyPattern.objsize()
+                        + _keyData[i].keyData.objsize();
+        }
+        return memUsage;
+    }
+
+    SpilledWorkingSetMember SpilledWorkingSetMember::getOwned() const {
+        SpilledWorkingSetMember value(*this);
+        value._obj = _obj.getOwned();
+        for (size_t i = 0; i < value._keyData.size(); ++i) {
+            value._keyData[i].indexKeyPattern = _keyData[i].indexKeyPattern.getOwned();
+            value._keyData[i].keyData = _keyData[i].keyData.getOwned();
+        }
+        value._geoNearPoint = _geoNearPoint.getOwned();
+        value._indexKey = _indexKey.getOwned();
+        return value;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,98 @@
+// working_set_spill.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    class BufReader;
+
+    /**
+     * A copy of a WorkingSetMember in a form which a Sorter can write to disk: the DiskLoc,
+     * the document or index key data, and any computed data.  Used by the stages which spill
+     * buffered results to temporary files.
+     */
+    class SpilledWorkingSetMember {
+    public:
+        SpilledWorkingSetMember() : _flags(0), _textScore(0), _geoDistance(0) { }
+
+        /**
+         * Copies the contents of 'member', which must have a DiskLoc, an object or both.
+         */
+        explicit SpilledWorkingSetMember(const WorkingSetMember& member);
+
+        /**
+         * Fills the clear 'member' with the copied contents.  If 'locInvalidated', the DiskLoc
+         * was invalidated while the data was spilled and 'member' is given only the object,
+         * which must be present.
+         */
+        void toMember(WorkingSetMember* member, bool locInvalidated) const;
+
+        const DiskLoc& getLoc() const { return _loc; }
+
+        // Members for Sorter.
+        struct SorterDeserializeSettings {}; // unused
+        void serializeForSorter(BufBuilder& buf) const;
+        static SpilledWorkingSetMember deserializeForSorter(BufReader& buf,
+                                                            const SorterDeserializeSettings&);
+        int memUsageForSorter() const;
+        SpilledWorkingSetMember getOwned() const;
+
+    private:
+        // Bits recording which of the optional data is present.
+        enum Flags {
+            kObj = 1 << 0,
+            kTextScore = 1 << 1,
+            kGeoDistance = 1 << 2,
+            kGeoNearPoint = 1 << 3,
+            kIndexKey = 1 << 4,
+        };
+
+        DiskLoc _loc;
+        BSONObj _obj;
+
+        // Key data is only kept without an object.  The key patterns are owned copies, so
+        // they compare equal to, but are not the same objects as, the IndexDescriptor's.
+        std::vector<IndexKeyDatum> _keyData;
+
+        int _flags;
+        double _textScore;
+        double _geoDistance;
+        BSONObj _geoNearPoint;
+        BSONObj _indexKey;
+    };
+
+}  // namespace mongo
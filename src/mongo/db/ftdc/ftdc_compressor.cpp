@@ -0,0 +1,371 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/ftdc/ftdc_compressor.h"
+
+#include <limits>
+
+#include "mongo/base/data_view.h"
+#include "mongo/bson/bson_validate.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/compress.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using std::string;
+    using std::vector;
+
+    namespace {
+
+        // Refuse to decompress chunks which would expand beyond this many values
+        const unsigned long long kMaxDecompressedValues = 64ULL * 1024 * 1024;
+
+        bool isMetric(BSONType type) {
+            switch (type) {
+            case NumberDouble:
+            case NumberInt:
+            case NumberLong:
+            case Bool:
+            case Date:
+            case Timestamp:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        long long metricValue(const BSONElement& e) {
+            switch (e.type()) {
+            case NumberDouble: {
+                const double d = e._numberDouble();
+                if (d != d)
+                    return 0;
+                if (d >= static_cast<double>(std::numeric_limits<long long>::max()))
+                    return std::numeric_limits<long long>::max();
+                if (d <= static_cast<double>(std::numeric_limits<long long>::min()))
+                    return std::numeric_limits<long long>::min();
+                return static_cast<long long>(d);
+            }
+            case NumberInt:
+                return e._numberInt();
+            case NumberLong:
+                return e._numberLong();
+            case Bool:
+                return e.boolean() ? 1 : 0;
+            case Date:
+                return static_cast<long long>(e.date().millis);
+            case Timestamp:
+                return static_cast<long long>(e.timestampValue());
+            default:
+                invariant(false);
+                return 0;
+            }
+        }
+
+        void extractMetrics(const BSONObj& obj, vector<long long>* metrics) {
+            BSONObjIterator it(obj);
+            while (it.more()) {
+                const BSONElement e = it.next();
+                if (e.type() == Object || e.type() == Array) {
+                    extractMetrics(e.embeddedObject(), metrics);
+                }
+                else if (isMetric(e.type())) {
+                    metrics->push_back(metricValue(e));
+                }
+            }
+        }
+
+        /**
+         * True if 'a' and 'b' have the same field names and types, in the same order, at every
+         * level.
+         */
+        bool sameSchema(const BSONObj& a, const BSONObj& b) {
+            BSONObjIterator itA(a);
+            BSONObjIterator itB(b);
+            while (itA.more()) {
+                if (!itB.more())
+                    return false;
+                const BSONElement eA = itA.next();
+                const BSONElement eB = itB.next();
+                if (eA.type() != eB.type())
+                    return false;
+                if (strcmp(eA.fieldName(), eB.fieldName()) != 0)
+                    return false;
+                if (eA.type() == Object || eA.type() == Array) {
+                    if (!sameSchema(eA.embeddedObject(), eB.embeddedObject()))
+                        return false;
+                }
+            }
+            return !itB.more();
+        }
+
+        /**
+         * Copies 'reference' into 'b' with its metrics replaced by the values at 'metrics',
+         * advancing 'metrics' past them.
+         */
+        void rebuildSample(const BSONObj& reference,
+                           const long long*& metrics,
+                           BSONObjBuilder* b) {
+            BSONObjIterator it(reference);
+            while (it.more()) {
+                const BSONElement e = it.next();
+                const StringData name = e.fieldNameStringData();
+                switch (e.type()) {
+                case Object: {
+                    BSONObjBuilder sub(b->subobjStart(name));
+                    rebuildSample(e.Obj(), metrics, &sub);
+                    sub.done();
+                    break;
+                }
+                case Array: {
+                    BSONObjBuilder sub(b->subarrayStart(name));
+                    rebuildSample(e.Obj(), metrics, &sub);
+                    sub.done();
+                    break;
+                }
+                case NumberDouble:
+                    b->append(name, static_cast<double>(*metrics++));
+                    break;
+                case NumberInt:
+                    b->append(name, static_cast<int>(*metrics++));
+                    break;
+                case NumberLong:
+                    b->append(name, *metrics++);
+                    break;
+                case Bool:
+                    b->appendBool(name, *metrics++ != 0);
+                    break;
+                case Date:
+                    b->appendDate(name, Date_t(static_cast<unsigned long long>(*metrics++)));
+                    break;
+                case Timestamp:
+                    b->appendTimestamp(name, static_cast<unsigned long long>(*metrics++));
+                    break;
+                default:
+                    b->append(e);
+                    break;
+                }
+            }
+        }
+
+        void appendUInt32(string* out, unsigned int value) {
+            char buf[sizeof(value)];
+            DataView(buf).writeLE(value);
+            out->append(buf, sizeof(buf));
+        }
+
+        void appendVarint(string* out, unsigned long long value) {
+            while (value >= 0x80) {
+                out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out->push_back(static_cast<char>(value));
+        }
+
+        bool readVarint(const char*& pos, const char* end, unsigned long long* value) {
+            unsigned long long result = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (pos == end)
+                    return false;
+                const unsigned char byte = static_cast<unsigned char>(*pos++);
+                result |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    *value = result;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        unsigned long long zigzagEncode(long long value) {
+            const unsigned long long u = static_cast<unsigned long long>(value);
+            return (u << 1) ^ (0 - (u >> 63));
+        }
+
+        long long zigzagDecode(unsigned long long value) {
+            return static_cast<long long>((value >> 1) ^ (0 - (value & 1)));
+        }
+
+        Status badChunk(const string& why) {
+            return Status(ErrorCodes::FailedToParse,
+                          str::stream() << "invalid diagnostic data chunk: " << why);
+        }
+
+    } // namespace
+
+    FTDCCompressor::FTDCCompressor(size_t maxSamplesPerChunk)
+        : _maxSamplesPerChunk(maxSamplesPerChunk),
+          _numDeltas(0) {
+        invariant(_maxSamplesPerChunk > 0);
+    }
+
+    bool FTDCCompressor::addSample(const BSONObj& sample, string* finishedChunk) {
+        if (_reference.isEmpty()) {
+            _reference = sample.getOwned();
+            _previous.clear();
+            extractMetrics(_reference, &_previous);
+            return false;
+        }
+
+        if (numSamples() >= _maxSamplesPerChunk || !sameSchema(_reference, sample)) {
+            *finishedChunk = finishChunk();
+            addSample(sample, finishedChunk);
+            return true;
+        }
+
+        vector<long long> current;
+        current.reserve(_previous.size());
+        extractMetrics(sample, &current);
+        invariant(current.size() == _previous.size());
+
+        for (size_t i = 0; i < current.size(); ++i) {
+            // Differences of unsigned values wrap instead of overflowing
+            const unsigned long long delta = static_cast<unsigned long long>(current[i]) -
+                                             static_cast<unsigned long long>(_previous[i]);
+            _deltas.push_back(static_cast<long long>(delta));
+        }
+        _previous.swap(current);
+        _numDeltas++;
+        return false;
+    }
+
+    string FTDCCompressor::getCompressedChunk() const {
+        if (_reference.isEmpty())
+            return string();
+
+        const size_t numMetrics = _previous.size();
+
+        string raw(_reference.objdata(), _reference.objsize());
+        appendUInt32(&raw, numMetrics);
+        appendUInt32(&raw, _numDeltas);
+
+        // A metric at a time, so that an unchanging metric is a single run of zeros
+        for (size_t m = 0; m < numMetrics; ++m) {
+            size_t zeros = 0;
+            for (size_t s = 0; s < _numDeltas; ++s) {
+                const long long delta = _deltas[s * numMetrics + m];
+                if (delta == 0) {
+                    zeros++;
+                    continue;
+                }
+                if (zeros) {
+                    appendVarint(&raw, 0);
+                    appendVarint(&raw, zeros - 1);
+                    zeros = 0;
+                }
+                appendVarint(&raw, zigzagEncode(delta));
+            }
+            if (zeros) {
+                appendVarint(&raw, 0);
+                appendVarint(&raw, zeros - 1);
+            }
+        }
+
+        string compressed;
+        compress(raw.data(), raw.size(), &compressed);
+        return compressed;
+    }
+
+    string FTDCCompressor::finishChunk() {
+        string chunk = getCompressedChunk();
+        _reference = BSONObj();
+        _previous.clear();
+        _deltas.clear();
+        _numDeltas = 0;
+        return chunk;
+    }
+
+    Status decompressFTDCChunk(const char* data, size_t size, vector<BSONObj>* samples) {
+        string raw;
+        if (!uncompress(data, size, &raw))
+            return badChunk("snappy decompression failed");
+
+        Status status = validateBSON(raw.data(), raw.size());
+        if (!status.isOK())
+            return badChunk(status.reason());
+
+        const BSONObj reference = BSONObj(raw.data()).getOwned();
+        const char* pos = raw.data() + reference.objsize();
+        const char* const end = raw.data() + raw.size();
+
+        if (end - pos < static_cast<ptrdiff_t>(2 * sizeof(unsigned int)))
+            return badChunk("truncated header");
+        const unsigned int numMetrics = ConstDataView(pos).readLE<unsigned int>();
+        const unsigned int numDeltas = ConstDataView(pos + sizeof(unsigned int))
+                                           .readLE<unsigned int>();
+        pos += 2 * sizeof(unsigned int);
+
+        vector<long long> metrics;
+        extractMetrics(reference, &metrics);
+        if (metrics.size() != numMetrics)
+            return badChunk("metric count doesn't match the reference document");
+        if (static_cast<unsigned long long>(numMetrics) * numDeltas > kMaxDecompressedValues)
+            return badChunk("too many values");
+
+        // Decoded back to the layout FTDCCompressor keeps them in, a sample after another
+        vector<long long> deltas(static_cast<size_t>(numMetrics) * numDeltas);
+        for (size_t m = 0; m < numMetrics; ++m) {
+            size_t s = 0;
+            while (s < numDeltas) {
+                unsigned long long value;
+                if (!readVarint(pos, end, &value))
+                    return badChunk("truncated deltas");
+                if (value != 0) {
+                    deltas[s++ * numMetrics + m] = zigzagDecode(value);
+                    continue;
+                }
+                unsigned long long moreZeros;
+                if (!readVarint(pos, end, &moreZeros))
+                    return badChunk("truncated run of zeros");
+                if (moreZeros >= numDeltas - s)
+                    return badChunk("run of zeros past the end of a metric");
+                s += moreZeros + 1;
+            }
+        }
+        if (pos != end)
+            return badChunk("trailing data");
+
+        samples->reserve(samples->size() + numDeltas + 1);
+        samples->push_back(reference);
+        for (size_t s = 0; s < numDeltas; ++s) {
+            for (size_t m = 0; m < numMetrics; ++m) {
+                metrics[m] = static_cast<long long>(static_cast<unsigned long long>(metrics[m]) +
+                    static_cast<unsigned long long>(deltas[s * numMetrics + m]));
+            }
+            const long long* next = metrics.empty() ? NULL : &metrics[0];
+            BSONObjBuilder b;
+            rebuildSample(reference, next, &b);
+            samples->push_back(b.obj());
+        }
+        return Status::OK();
+    }
+
+} // namespace mongo
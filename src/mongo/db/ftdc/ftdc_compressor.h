@@ -0,0 +1,106 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * Compresses a series of diagnostic data samples, documents with the same fields as each
+     * other such as successive serverStatus outputs, into chunks.
+     *
+     * A chunk holds its first sample whole, as the reference, and the numeric fields (numbers,
+     * booleans, dates and timestamps) of the samples after it as the differences from the
+     * previous sample.  The differences are stored a metric at a time, so that a counter which
+     * doesn't move is a run of zeros, as zigzag varints with runs of zeros collapsed to a
+     * count, and the whole is compressed with snappy.
+     *
+     * Doubles are stored as 64 bit integers, truncating them.  The other fields aren't
+     * stored after the reference, so a decompressed sample has the reference's strings.  A
+     * sample with different fields or field types from the reference starts a new chunk.
+     */
+    class FTDCCompressor {
+        MONGO_DISALLOW_COPYING(FTDCCompressor);
+    public:
+        /**
+         * @param maxSamplesPerChunk - the chunk is finished once it has this many samples
+         */
+        explicit FTDCCompressor(size_t maxSamplesPerChunk);
+
+        /**
+         * Adds 'sample' to the chunk in progress.  If that chunk has to be finished first,
+         * because it is full or because 'sample' doesn't have its reference's fields, puts the
+         * compressed chunk in 'finishedChunk', starts a new chunk with 'sample' and returns
+         * true.
+         */
+        bool addSample(const BSONObj& sample, std::string* finishedChunk);
+
+        /**
+         * Returns the chunk in progress compressed, without finishing it.  Empty if the chunk
+         * has no samples.
+         */
+        std::string getCompressedChunk() const;
+
+        /**
+         * Returns the chunk in progress compressed and starts a new one.  Empty if the chunk has
+         * no samples.
+         */
+        std::string finishChunk();
+
+        /**
+         * The number of samples in the chunk in progress.
+         */
+        size_t numSamples() const { return _reference.isEmpty() ? 0 : _numDeltas + 1; }
+
+    private:
+        const size_t _maxSamplesPerChunk;
+
+        BSONObj _reference;
+
+        // The metrics of the last sample added
+        std::vector<long long> _previous;
+
+        // The differences of each sample after the reference from the one before, a sample
+        // after another
+        std::vector<long long> _deltas;
+        size_t _numDeltas;
+    };
+
+    /**
+     * Decompresses a chunk made by FTDCCompressor into 'samples'.
+     */
+    Status decompressFTDCChunk(const char* data, size_t size, std::vector<BSONObj>* samples);
+
+} // namespace mongo
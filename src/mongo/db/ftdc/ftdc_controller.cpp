@@ -0,0 +1,302 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/ftdc/ftdc_controller.h"
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/client.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/ftdc/ftdc_compressor.h"
+#include "mongo/db/ftdc/ftdc_file.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/repl/repl_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage_options.h"
+#include "mongo/util/background.h"
+#include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    // Whether to capture diagnostic data at all.
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionEnabled, bool, true);
+
+    // How often to take a sample.
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionPeriodMillis, int, 1000);
+
+    // How many samples to compress together.  Only read at startup.
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionSamplesPerChunk, int, 300);
+
+    // How often, in samples, to save the chunk in progress to the interim file.
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionSamplesPerInterimUpdate, int, 10);
+
+    // The size at which to move on to a new file.
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionFileSizeMB, int, 10);
+
+    // The size above which the oldest files are deleted.
+    MONGO_EXPORT_SERVER_PARAMETER(diagnosticDataCollectionDirectorySizeMB, int, 100);
+
+namespace {
+
+    namespace fs = boost::filesystem;
+
+    const char kDirectoryName[] = "diagnostic.data";
+    const char kFilePrefix[] = "metrics.";
+    const char kInterimFileName[] = "metrics.interim";
+
+    const int kMinPeriodMillis = 100;
+
+    size_t knobAsSize(int value) {
+        return value > 0 ? static_cast<size_t>(value) : 1;
+    }
+
+    /**
+     * Appends a sample to a file of diagnostic.data as the chunk it is in fills, and keeps the
+     * chunk filling in metrics.interim so that a crash loses only the last few samples.
+     */
+    class DiagnosticDataCapture : public BackgroundJob {
+    public:
+        DiagnosticDataCapture()
+            : _directory(fs::path(storageGlobalParams.dbpath) / kDirectoryName),
+              _compressor(knobAsSize(diagnosticDataCollectionSamplesPerChunk)) { }
+
+        virtual ~DiagnosticDataCapture() { }
+
+        virtual std::string name() const { return "DiagnosticDataCapture"; }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            try {
+                fs::create_directories(_directory);
+                recoverInterimFile();
+                _metadata = makeFTDCMetadataDocument(jsTime(), collectMetadata());
+            }
+            catch (const std::exception& ex) {
+                warning() << "diagnostic data capture disabled, could not set up "
+                          << _directory.string() << ": " << ex.what();
+                return;
+            }
+
+            while (!inShutdown()) {
+                sleepmillis(std::max(static_cast<int>(diagnosticDataCollectionPeriodMillis),
+                                     kMinPeriodMillis));
+                if (!diagnosticDataCollectionEnabled) {
+                    continue;
+                }
+
+                try {
+                    addSample(collectSample());
+                }
+                catch (const std::exception& ex) {
+                    LOG(1) << "diagnostic data capture: " << ex.what();
+                }
+            }
+
+            try {
+                if (_compressor.numSamples()) {
+                    writeChunk(_compressor.finishChunk());
+                }
+                _writer.close();
+            }
+            catch (const std::exception& ex) {
+                LOG(1) << "diagnostic data capture: " << ex.what();
+            }
+        }
+
+    private:
+        BSONObj collectSample() {
+            OperationContextImpl txn;
+            DBDirectClient client(&txn);
+
+            BSONObjBuilder sample;
+            sample.appendDate("start", jsTime());
+
+            BSONObj serverStatus;
+            client.runCommand("admin", BSON("serverStatus" << 1), serverStatus);
+            sample.append("serverStatus", serverStatus);
+
+            if (repl::getGlobalReplicationCoordinator()->getReplicationMode() ==
+                    repl::ReplicationCoordinator::modeReplSet) {
+                BSONObj replSetStatus;
+                if (client.runCommand("admin", BSON("replSetGetStatus" << 1), replSetStatus)) {
+                    sample.append("replSetGetStatus", replSetStatus);
+                }
+            }
+
+            sample.appendDate("end", jsTime());
+            return sample.obj();
+        }
+
+        BSONObj collectMetadata() {
+            OperationContextImpl txn;
+            DBDirectClient client(&txn);
+
+            BSONObjBuilder metadata;
+            BSONObj result;
+            client.runCommand("admin", BSON("buildInfo" << 1), result);
+            metadata.append("buildInfo", result);
+            client.runCommand("admin", BSON("getCmdLineOpts" << 1), result);
+            metadata.append("getCmdLineOpts", result);
+            return metadata.obj();
+        }
+
+        void addSample(const BSONObj& sample) {
+            const Date_t start = sample["start"].date();
+            if (_compressor.numSamples() == 0) {
+                _chunkStart = start;
+            }
+
+            std::string finishedChunk;
+            if (_compressor.addSample(sample, &finishedChunk)) {
+                writeChunk(finishedChunk);
+                _chunkStart = start;
+            }
+
+            const size_t numSamples = _compressor.numSamples();
+            if (numSamples >= knobAsSize(diagnosticDataCollectionSamplesPerChunk)) {
+                writeChunk(_compressor.finishChunk());
+            }
+            else if (numSamples % knobAsSize(diagnosticDataCollectionSamplesPerInterimUpdate)
+                         == 0) {
+                std::vector<BSONObj> docs;
+                docs.push_back(_metadata);
+                docs.push_back(makeFTDCChunkDocument(_chunkStart,
+                                                     _compressor.getCompressedChunk()));
+                uassertStatusOK(writeFTDCFileAtomically(interimPath().string(), docs));
+            }
+        }
+
+        void writeChunk(const std::string& chunk) {
+            if (!_writer.isOpen()) {
+                _currentFile = newFilePath();
+                uassertStatusOK(_writer.open(_currentFile.string()));
+                uassertStatusOK(_writer.writeDocument(_metadata));
+            }
+            uassertStatusOK(_writer.writeDocument(makeFTDCChunkDocument(_chunkStart, chunk)));
+
+            // The chunk is in its file now
+            fs::remove(interimPath());
+
+            const size_t maxFileSize =
+                knobAsSize(diagnosticDataCollectionFileSizeMB) * 1024 * 1024;
+            if (_writer.size() >= maxFileSize) {
+                _writer.close();
+                removeOldFiles();
+            }
+        }
+
+        /**
+         * Deletes the oldest files, by name, while the directory is over its size limit.
+         * Leaves the file being written and the interim file.
+         */
+        void removeOldFiles() {
+            std::vector<fs::path> files;
+            unsigned long long totalSize = 0;
+            for (fs::directory_iterator it(_directory); it != fs::directory_iterator(); ++it) {
+                const fs::path path = it->path();
+                const std::string fileName = path.filename().string();
+                if (fileName.compare(0, strlen(kFilePrefix), kFilePrefix) != 0) {
+                    continue;
+                }
+                totalSize += fs::file_size(path);
+                if (fileName != kInterimFileName && path != _currentFile) {
+                    files.push_back(path);
+                }
+            }
+            std::sort(files.begin(), files.end());
+
+            const unsigned long long maxSize =
+                knobAsSize(diagnosticDataCollectionDirectorySizeMB) * 1024ULL * 1024;
+            for (size_t i = 0; i < files.size() && totalSize > maxSize; ++i) {
+                const unsigned long long size = fs::file_size(files[i]);
+                LOG(1) << "removing diagnostic data file " << files[i].string();
+                fs::remove(files[i]);
+                totalSize -= size;
+            }
+        }
+
+        /**
+         * A chunk left in the interim file by a server that didn't shut down cleanly is moved
+         * to a file of its own, so that it is kept with the others.
+         */
+        void recoverInterimFile() {
+            if (fs::exists(interimPath())) {
+                const fs::path recovered = newFilePath();
+                log() << "recovering diagnostic data file " << interimPath().string()
+                      << " as " << recovered.string();
+                fs::rename(interimPath(), recovered);
+            }
+        }
+
+        /**
+         * Files are named by the time they are started, so that they sort oldest first.
+         */
+        fs::path newFilePath() const {
+            std::string name = kFilePrefix + dateToISOStringUTC(jsTime());
+            std::replace(name.begin(), name.end(), ':', '-');
+
+            fs::path path = _directory / name;
+            for (int suffix = 1; fs::exists(path); ++suffix) {
+                path = _directory / (name + "-" + BSONObjBuilder::numStr(suffix));
+            }
+            return path;
+        }
+
+        fs::path interimPath() const {
+            return _directory / kInterimFileName;
+        }
+
+        const fs::path _directory;
+        FTDCCompressor _compressor;
+        FTDCFileWriter _writer;
+
+        // Written at the start of each file, including the interim one
+        BSONObj _metadata;
+        fs::path _currentFile;
+        Date_t _chunkStart;
+    };
+
+} // namespace
+
+    void startDiagnosticDataCaptureBackgroundJob() {
+        DiagnosticDataCapture* capture = new DiagnosticDataCapture();
+        capture->go();
+    }
+
+} // namespace mongo
@@ -0,0 +1,193 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/ftdc/ftdc_file.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include "mongo/bson/bson_validate.h"
+#include "mongo/db/ftdc/ftdc_compressor.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using std::string;
+    using std::vector;
+
+    BSONObj makeFTDCMetadataDocument(Date_t date, const BSONObj& doc) {
+        BSONObjBuilder b;
+        b.appendDate("_id", date);
+        b.append("type", static_cast<int>(kFTDCMetadataDocument));
+        b.append("doc", doc);
+        return b.obj();
+    }
+
+    BSONObj makeFTDCChunkDocument(Date_t date, const string& chunk) {
+        BSONObjBuilder b;
+        b.appendDate("_id", date);
+        b.append("type", static_cast<int>(kFTDCChunkDocument));
+        b.appendBinData("data", chunk.size(), BinDataGeneral, chunk.data());
+        return b.obj();
+    }
+
+    Status extractFTDCSamples(const BSONObj& doc, vector<BSONObj>* samples) {
+        const BSONElement type = doc["type"];
+        if (!type.isNumber()) {
+            return Status(ErrorCodes::FailedToParse,
+                          "diagnostic data document without a numeric type");
+        }
+
+        switch (type.numberInt()) {
+        case kFTDCMetadataDocument:
+            samples->push_back(doc);
+            return Status::OK();
+        case kFTDCChunkDocument: {
+            const BSONElement data = doc["data"];
+            if (data.type() != BinData) {
+                return Status(ErrorCodes::FailedToParse,
+                              "diagnostic data chunk without BinData data");
+            }
+            int len;
+            const char* chunk = data.binData(len);
+            return decompressFTDCChunk(chunk, len, samples);
+        }
+        default:
+            return Status(ErrorCodes::FailedToParse,
+                          str::stream() << "unknown diagnostic data document type "
+                                        << type.numberInt());
+        }
+    }
+
+    FTDCFileWriter::FTDCFileWriter() : _size(0) {
+
+    }
+
+    Status FTDCFileWriter::open(const string& path) {
+        invariant(!_out.is_open());
+
+        _size = 0;
+        if (boost::filesystem::exists(path)) {
+            _size = boost::filesystem::file_size(path);
+        }
+
+        _out.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+        if (!_out.good()) {
+            return Status(ErrorCodes::FileNotOpen,
+                          str::stream() << "could not open diagnostic data file " << path);
+        }
+        return Status::OK();
+    }
+
+    Status FTDCFileWriter::writeDocument(const BSONObj& doc) {
+        invariant(_out.is_open());
+        _out.write(doc.objdata(), doc.objsize());
+        // Keep whole documents on disk in case the server doesn't shut down cleanly
+        _out.flush();
+        if (!_out.good()) {
+            return Status(ErrorCodes::FileStreamFailed, "failed writing diagnostic data file");
+        }
+        _size += doc.objsize();
+        return Status::OK();
+    }
+
+    void FTDCFileWriter::close() {
+        if (_out.is_open()) {
+            _out.close();
+        }
+        _size = 0;
+    }
+
+    Status writeFTDCFileAtomically(const string& path, const vector<BSONObj>& docs) {
+        const string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath.c_str(),
+                              std::ios::out | std::ios::binary | std::ios::trunc);
+            for (size_t i = 0; i < docs.size() && out.good(); ++i) {
+                out.write(docs[i].objdata(), docs[i].objsize());
+            }
+            out.flush();
+            if (!out.good()) {
+                return Status(ErrorCodes::FileStreamFailed,
+                              str::stream() << "failed writing diagnostic data file "
+                                            << tempPath);
+            }
+        }
+
+        try {
+            boost::filesystem::rename(tempPath, path);
+        }
+        catch (const boost::filesystem::filesystem_error& e) {
+            return Status(ErrorCodes::FileRenameFailed,
+                          str::stream() << "could not rename " << tempPath << " to " << path
+                                        << ": " << e.what());
+        }
+        return Status::OK();
+    }
+
+    Status readFTDCFile(const string& path, vector<BSONObj>* docs) {
+        std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+        if (!in.good()) {
+            return Status(ErrorCodes::FileNotOpen,
+                          str::stream() << "could not open diagnostic data file " << path);
+        }
+
+        char lenBuf[sizeof(int)];
+        while (in.read(lenBuf, sizeof(lenBuf))) {
+            const int len = ConstDataView(lenBuf).readLE<int>();
+            if (len < 5 || len > BSONObjMaxInternalSize) {
+                return Status(ErrorCodes::FailedToParse,
+                              str::stream() << "invalid document length " << len
+                                            << " in diagnostic data file " << path);
+            }
+
+            string buf(len, '\0');
+            memcpy(&buf[0], lenBuf, sizeof(lenBuf));
+            if (!in.read(&buf[sizeof(lenBuf)], len - sizeof(lenBuf))) {
+                return Status(ErrorCodes::FileStreamFailed,
+                              str::stream() << "truncated diagnostic data file " << path);
+            }
+
+            Status status = validateBSON(buf.data(), len);
+            if (!status.isOK()) {
+                return Status(ErrorCodes::FailedToParse,
+                              str::stream() << "invalid document in diagnostic data file "
+                                            << path << ": " << status.reason());
+            }
+            docs->push_back(BSONObj(buf.data()).getOwned());
+        }
+
+        if (in.gcount() != 0) {
+            return Status(ErrorCodes::FileStreamFailed,
+                          str::stream() << "truncated diagnostic data file " << path);
+        }
+        return Status::OK();
+    }
+
+} // namespace mongo
@@ -0,0 +1,107 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * A diagnostic data file is a series of BSON documents, each one of
+     *
+     *     { _id: <Date>, type: 0, doc: <document> }  - metadata, such as buildInfo
+     *     { _id: <Date>, type: 1, data: <BinData> }  - a chunk made by FTDCCompressor
+     *
+     * where _id is when the document, or the first sample of the chunk, was taken.
+     */
+    enum FTDCDocumentType {
+        kFTDCMetadataDocument = 0,
+        kFTDCChunkDocument = 1,
+    };
+
+    BSONObj makeFTDCMetadataDocument(Date_t date, const BSONObj& doc);
+
+    BSONObj makeFTDCChunkDocument(Date_t date, const std::string& chunk);
+
+    /**
+     * Appends the samples held by the diagnostic data document 'doc' to 'samples', or the
+     * metadata document itself for a metadata document.
+     */
+    Status extractFTDCSamples(const BSONObj& doc, std::vector<BSONObj>* samples);
+
+    /**
+     * Appends documents to a diagnostic data file.  Not thread safe.
+     */
+    class FTDCFileWriter {
+        MONGO_DISALLOW_COPYING(FTDCFileWriter);
+    public:
+        FTDCFileWriter();
+
+        /**
+         * Opens the file at 'path', creating it if needed, to append to it.
+         */
+        Status open(const std::string& path);
+
+        Status writeDocument(const BSONObj& doc);
+
+        /**
+         * The size of the file in bytes.
+         */
+        size_t size() const { return _size; }
+
+        bool isOpen() const { return _out.is_open(); }
+
+        void close();
+
+    private:
+        std::ofstream _out;
+        size_t _size;
+    };
+
+    /**
+     * Replaces the file at 'path' with one holding 'docs', through a temporary file so that
+     * the file is either the old one or the new one whole.
+     */
+    Status writeFTDCFileAtomically(const std::string& path, const std::vector<BSONObj>& docs);
+
+    /**
+     * Reads the documents of the diagnostic data file at 'path' into 'docs'.
+     *
+     * A file that was being written when the server stopped may end in part of a document.  An
+     * error is returned for it, after the whole documents before it are put in 'docs'.
+     */
+    Status readFTDCFile(const std::string& path, std::vector<BSONObj>* docs);
+
+} // namespace mongo
@@ -0,0 +1,244 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/ftdc/ftdc_compressor.h"
+
+#include <fstream>
+#include <limits>
+
+#include "mongo/db/ftdc/ftdc_file.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using namespace mongo;
+    using std::string;
+    using std::vector;
+
+    BSONObj makeSample(long long i) {
+        return BSON("start" << Date_t(1000000 + i * 1000)
+                    << "host" << "example"
+                    << "uptime" << static_cast<double>(i)
+                    << "connections" << BSON("current" << static_cast<int>(i % 3)
+                                             << "available" << 800)
+                    << "opcounters" << BSON("insert" << i * i << "query" << 0LL)
+                    << "ok" << true
+                    << "ts" << OpTime(static_cast<unsigned>(i), 1)
+                    << "list" << BSON_ARRAY(-i << 5));
+    }
+
+    vector<BSONObj> roundTrip(const string& chunk) {
+        vector<BSONObj> samples;
+        ASSERT_OK(decompressFTDCChunk(chunk.data(), chunk.size(), &samples));
+        return samples;
+    }
+
+    TEST(FTDCCompressor, RoundTrip) {
+        FTDCCompressor compressor(100);
+        string finished;
+        for (int i = 0; i < 50; ++i) {
+            ASSERT_FALSE(compressor.addSample(makeSample(i), &finished));
+        }
+        ASSERT_EQUALS(50U, compressor.numSamples());
+
+        const vector<BSONObj> samples = roundTrip(compressor.finishChunk());
+        ASSERT_EQUALS(0U, compressor.numSamples());
+        ASSERT_EQUALS(50U, samples.size());
+        for (int i = 0; i < 50; ++i) {
+            ASSERT_EQUALS(makeSample(i), samples[i]);
+        }
+    }
+
+    TEST(FTDCCompressor, GetCompressedChunkKeepsChunk) {
+        FTDCCompressor compressor(100);
+        string finished;
+        compressor.addSample(makeSample(0), &finished);
+        compressor.addSample(makeSample(1), &finished);
+
+        ASSERT_EQUALS(2U, roundTrip(compressor.getCompressedChunk()).size());
+        compressor.addSample(makeSample(2), &finished);
+        ASSERT_EQUALS(3U, roundTrip(compressor.getCompressedChunk()).size());
+    }
+
+    TEST(FTDCCompressor, FullChunk) {
+        FTDCCompressor compressor(10);
+        string finished;
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_FALSE(compressor.addSample(makeSample(i), &finished));
+        }
+        ASSERT_TRUE(compressor.addSample(makeSample(10), &finished));
+        ASSERT_EQUALS(1U, compressor.numSamples());
+
+        const vector<BSONObj> samples = roundTrip(finished);
+        ASSERT_EQUALS(10U, samples.size());
+        ASSERT_EQUALS(makeSample(9), samples[9]);
+    }
+
+    TEST(FTDCCompressor, SchemaChangeStartsChunk) {
+        FTDCCompressor compressor(100);
+        string finished;
+        compressor.addSample(BSON("a" << 1 << "b" << 2), &finished);
+        compressor.addSample(BSON("a" << 2 << "b" << 3), &finished);
+
+        // Added field, then a changed type
+        ASSERT_TRUE(compressor.addSample(BSON("a" << 3 << "b" << 4 << "c" << 5), &finished));
+        ASSERT_EQUALS(2U, roundTrip(finished).size());
+        ASSERT_TRUE(compressor.addSample(BSON("a" << 3 << "b" << 4LL << "c" << 5), &finished));
+        ASSERT_EQUALS(1U, roundTrip(finished).size());
+        ASSERT_EQUALS(BSON("a" << 3 << "b" << 4 << "c" << 5), roundTrip(finished)[0]);
+    }
+
+    TEST(FTDCCompressor, StringsComeFromReference) {
+        FTDCCompressor compressor(100);
+        string finished;
+        compressor.addSample(BSON("s" << "first" << "n" << 1.5), &finished);
+        compressor.addSample(BSON("s" << "second" << "n" << 2.5), &finished);
+
+        const vector<BSONObj> samples = roundTrip(compressor.finishChunk());
+        ASSERT_EQUALS(BSON("s" << "first" << "n" << 1.5), samples[0]);
+        ASSERT_EQUALS(BSON("s" << "first" << "n" << 2.0), samples[1]);
+    }
+
+    TEST(FTDCCompressor, ExtremeDeltas) {
+        const long long big = std::numeric_limits<long long>::max();
+        const long long small = std::numeric_limits<long long>::min();
+        FTDCCompressor compressor(100);
+        string finished;
+        compressor.addSample(BSON("n" << small), &finished);
+        compressor.addSample(BSON("n" << big), &finished);
+        compressor.addSample(BSON("n" << small), &finished);
+        compressor.addSample(BSON("n" << small), &finished);
+
+        const vector<BSONObj> samples = roundTrip(compressor.finishChunk());
+        ASSERT_EQUALS(4U, samples.size());
+        ASSERT_EQUALS(big, samples[1]["n"].numberLong());
+        ASSERT_EQUALS(small, samples[3]["n"].numberLong());
+    }
+
+    TEST(FTDCCompressor, UnchangingMetricsAreSmall) {
+        BSONObjBuilder b;
+        for (int i = 0; i < 1000; ++i) {
+            b.append(BSONObjBuilder::numStr(i), static_cast<long long>(i));
+        }
+        const BSONObj sample = b.obj();
+
+        FTDCCompressor compressor(300);
+        string finished;
+        for (int i = 0; i < 300; ++i) {
+            compressor.addSample(sample, &finished);
+        }
+        const string chunk = compressor.finishChunk();
+
+        // The reference whole, then a run of zeros a metric
+        ASSERT_LESS_THAN(chunk.size(), static_cast<size_t>(sample.objsize()));
+        ASSERT_EQUALS(300U, roundTrip(chunk).size());
+    }
+
+    TEST(FTDCCompressor, CorruptChunk) {
+        FTDCCompressor compressor(100);
+        string finished;
+        for (int i = 0; i < 5; ++i) {
+            compressor.addSample(makeSample(i), &finished);
+        }
+        const string chunk = compressor.finishChunk();
+
+        vector<BSONObj> samples;
+        ASSERT_NOT_OK(decompressFTDCChunk(chunk.data(), chunk.size() / 2, &samples));
+        ASSERT_NOT_OK(decompressFTDCChunk("garbage", 7, &samples));
+    }
+
+    TEST(FTDCFile, RoundTrip) {
+        unittest::TempDir tempDir("ftdc_test");
+        const string path = tempDir.path() + "/metrics";
+
+        FTDCCompressor compressor(100);
+        string finished;
+        for (int i = 0; i < 20; ++i) {
+            compressor.addSample(makeSample(i), &finished);
+        }
+
+        {
+            FTDCFileWriter writer;
+            ASSERT_OK(writer.open(path));
+            ASSERT_OK(writer.writeDocument(makeFTDCMetadataDocument(Date_t(1),
+                                                                    BSON("version" << "x"))));
+            ASSERT_OK(writer.writeDocument(makeFTDCChunkDocument(Date_t(2),
+                                                                 compressor.finishChunk())));
+            writer.close();
+        }
+
+        {
+            // Appends to the file
+            FTDCFileWriter writer;
+            ASSERT_OK(writer.open(path));
+            ASSERT_GREATER_THAN(writer.size(), 0U);
+            compressor.addSample(makeSample(20), &finished);
+            ASSERT_OK(writer.writeDocument(makeFTDCChunkDocument(Date_t(3),
+                                                                 compressor.finishChunk())));
+        }
+
+        vector<BSONObj> docs;
+        ASSERT_OK(readFTDCFile(path, &docs));
+        ASSERT_EQUALS(3U, docs.size());
+
+        vector<BSONObj> samples;
+        ASSERT_OK(extractFTDCSamples(docs[0], &samples));
+        ASSERT_EQUALS(1U, samples.size());
+        ASSERT_EQUALS("x", samples[0]["doc"]["version"].String());
+
+        samples.clear();
+        ASSERT_OK(extractFTDCSamples(docs[1], &samples));
+        ASSERT_OK(extractFTDCSamples(docs[2], &samples));
+        ASSERT_EQUALS(21U, samples.size());
+        ASSERT_EQUALS(makeSample(20), samples[20]);
+    }
+
+    TEST(FTDCFile, TruncatedFile) {
+        unittest::TempDir tempDir("ftdc_test");
+        const string path = tempDir.path() + "/metrics";
+
+        vector<BSONObj> docs;
+        docs.push_back(makeFTDCMetadataDocument(Date_t(1), BSON("a" << 1)));
+        docs.push_back(makeFTDCMetadataDocument(Date_t(2), BSON("a" << 2)));
+        ASSERT_OK(writeFTDCFileAtomically(path, docs));
+
+        {
+            std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+            out.write(docs[0].objdata(), docs[0].objsize() / 2);
+        }
+
+        vector<BSONObj> read;
+        ASSERT_NOT_OK(readFTDCFile(path, &read));
+        ASSERT_EQUALS(2U, read.size());
+        ASSERT_EQUALS(docs[1], read[1]);
+    }
+
+} // namespace
@@ -30,6 +30,9 @@
 
 #include "mongo/pch.h"
 
+#include <cmath>
+#include <limits>
+
 #include <third_party/murmurhash3/MurmurHash3.h>
 
 #include "mongo/base/init.h"
@@ -60,7 +63,7 @@ namespace mongo {
             /**
              * Returns size of buffer required to store term in index key.
              * In version 1, terms are stored verbatim in key.
-             * In version 2, terms longer than 32 characters are hashed and combined
+             * In versions 2 and 3, terms longer than 32 characters are hashed and combined
              * with a prefix.
              */
             int guessTermSize( const std::string& term, TextIndexVersion textIndexVersion ) {
@@ -68,13 +71,32 @@ namespace mongo {
                     return term.size();
                 }
                 else {
-                    invariant( TEXT_INDEX_VERSION_2 == textIndexVersion );
+                    invariant( TEXT_INDEX_VERSION_2 == textIndexVersion ||
+                               TEXT_INDEX_VERSION_3 == textIndexVersion );
                     if ( term.size() <= termKeyPrefixLength ) {
                         return term.size();
                     }
                     return termKeyLength;
                 }
             }
+
+            // New in textIndexVersion 3.
+            // The score is stored as the bit pattern of a 32-bit float in a NumberInt
+            // rather than as a double, which takes 4 bytes off every key.  Scores are
+            // never negative, and the bit patterns of non-negative floats order the same
+            // way as the floats themselves, so keys sort by score as in version 2.
+            union FloatBits {
+                float f;
+                int32_t i;
+            };
+
+            float roundUpToFloat( double weight ) {
+                float f = static_cast<float>( weight );
+                if ( f < weight ) {
+                    f = nextafterf( f, std::numeric_limits<float>::max() );
+                }
+                return f;
+            }
         }
 
         MONGO_INITIALIZER( FTSIndexFormat )( InitializerContext* context ) {
@@ -188,9 +210,11 @@ namespace mongo {
                 b.append( "", weight );
             }
             // See comments at the top of file for termKeyPrefixLength.
-            // Apply hash for text index version 2 to long terms (longer than 32 characters).
+            // Apply hash for text index versions 2 and 3 to long terms (longer than 32
+            // characters).
             else {
-                invariant( TEXT_INDEX_VERSION_2 == textIndexVersion );
+                invariant( TEXT_INDEX_VERSION_2 == textIndexVersion ||
+                           TEXT_INDEX_VERSION_3 == textIndexVersion );
                 if ( term.size() <= termKeyPrefixLength ) {
                     b.append( "", term );
                 }
@@ -206,8 +230,33 @@ namespace mongo {
                     b.append( "", term.substr( 0, termKeyPrefixLength ) +
                               keySuffix );
                 }
-                b.append( "", weight );
+                if ( TEXT_INDEX_VERSION_3 == textIndexVersion ) {
+                    FloatBits bits;
+                    bits.f = roundUpToFloat( weight );
+                    b.append( "", static_cast<int>( bits.i ) );
+                }
+                else {
+                    b.append( "", weight );
+                }
+            }
+        }
+
+        double FTSIndexFormat::quantizeScore( double weight, TextIndexVersion textIndexVersion ) {
+            if ( TEXT_INDEX_VERSION_3 != textIndexVersion ) {
+                return weight;
+            }
+            return roundUpToFloat( weight );
+        }
+
+        double FTSIndexFormat::decodeScore( const BSONElement& e,
+                                            TextIndexVersion textIndexVersion ) {
+            if ( TEXT_INDEX_VERSION_3 != textIndexVersion ) {
+                return e.number();
             }
+            invariant( NumberInt == e.type() );
+            FloatBits bits;
+            bits.i = e._numberInt();
+            return bits.f;
         }
     }
 }
@@ -55,6 +55,19 @@ namespace mongo {
                                         const BSONObj& indexPrefix,
                                         TextIndexVersion textIndexVersion );
 
+            /*
+             * Returns the score that an index of the given version stores for 'weight'.
+             * Version 3 keeps scores as 32-bit floats, rounded up so that a stored score never
+             * falls below the exact one; earlier versions store 'weight' unchanged.
+             */
+            static double quantizeScore( double weight, TextIndexVersion textIndexVersion );
+
+            /*
+             * Returns the score held in the score element 'e' of an index key.
+             * @param textIndexVersion, index version. affects key format.
+             */
+            static double decodeScore( const BSONElement& e, TextIndexVersion textIndexVersion );
+
         private:
             /*
              * Helper method to get return entry from the FTSIndex as a BSONObj
@@ -201,5 +201,62 @@ namespace mongo {
             assertEqualsIndexKeys( expectedKeys, keys);
         }
 
+        /**
+         * Tests keys using text index version 3.
+         * Terms are keyed as in version 2, but the score is stored as the bits of a 32-bit
+         * float in a NumberInt, rounded up from the exact score.
+         */
+        TEST( FTSIndexFormat, QuantizedScoreTextIndexVersion3 ) {
+            FTSSpec spec( FTSSpec::fixSpec( BSON( "key" << BSON( "data" << "text" ) <<
+                                                  "textIndexVersion" << 3 ) ) );
+            ASSERT_EQUALS( TEXT_INDEX_VERSION_3, spec.getTextIndexVersion() );
+
+            BSONObjSet keys;
+            string longWord = string( 1024U, 'a' ) + "cat";
+            FTSIndexFormat::getKeys( spec, BSON( "data" << longWord + " sat sat" ), &keys );
+
+            TermFrequencyMap scores;
+            spec.scoreDocument( BSON( "data" << longWord + " sat sat" ), &scores );
+
+            std::set<string> expectedKeys;
+            expectedKeys.insert( "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaf2d6f58bb3b81b97e611ae7ccac6dea7" );
+            expectedKeys.insert( "sat" );
+            assertEqualsIndexKeys( expectedKeys, keys );
+
+            for ( BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i ) {
+                BSONObjIterator it( *i );
+                string term = it.next().String();
+                BSONElement scoreElt = it.next();
+                ASSERT_EQUALS( NumberInt, scoreElt.type() );
+
+                double exact = ( "sat" == term ) ? scores["sat"] : scores[longWord];
+                double stored = FTSIndexFormat::decodeScore( scoreElt, TEXT_INDEX_VERSION_3 );
+                ASSERT_EQUALS( FTSIndexFormat::quantizeScore( exact, TEXT_INDEX_VERSION_3 ),
+                               stored );
+                ASSERT_GREATER_THAN_OR_EQUALS( stored, exact );
+                ASSERT_LESS_THAN( stored - exact, exact * 1e-6 );
+            }
+        }
+
+        /**
+         * Version 3 keys must order by score the same way as the exact scores do.
+         */
+        TEST( FTSIndexFormat, QuantizedScoreOrderTextIndexVersion3 ) {
+            const double weights[] = { 0, 1e-9, 0.3, 0.30000001, 1.0 / 3, 1, 2.5, 1e6, MAX_WEIGHT };
+            const size_t numWeights = sizeof( weights ) / sizeof( weights[0] );
+            for ( size_t i = 1; i < numWeights; ++i ) {
+                BSONObj lower = FTSIndexFormat::getIndexKey( weights[i - 1], "t", BSONObj(),
+                                                             TEXT_INDEX_VERSION_3 );
+                BSONObj higher = FTSIndexFormat::getIndexKey( weights[i], "t", BSONObj(),
+                                                              TEXT_INDEX_VERSION_3 );
+                ASSERT_LESS_THAN_OR_EQUALS( lower.woCompare( higher ), 0 );
+
+                // The score takes 4 bytes instead of the 8 of a double.
+                BSONObj lowerV2 = FTSIndexFormat::getIndexKey( weights[i - 1], "t", BSONObj(),
+                                                               TEXT_INDEX_VERSION_2 );
+                ASSERT_EQUALS( lowerV2.objsize() - 4, lower.objsize() );
+            }
+        }
+
     }
 }
@@ -199,6 +199,9 @@ namespace mongo {
                 verify( languageMapV1.find( languageName ) == languageMapV1.end() );
                 languageMapV1[ languageName ] = language;
                 return;
+            case TEXT_INDEX_VERSION_3:
+                // TEXT_INDEX_VERSION_3 looks up the TEXT_INDEX_VERSION_2 languages.
+                break;
             }
             verify( false );
         }
@@ -216,6 +219,8 @@ namespace mongo {
                 verify( languageMapV1.find( alias ) == languageMapV1.end() );
                 languageMapV1[ alias ] = language;
                 return;
+            case TEXT_INDEX_VERSION_3:
+                break;
             }
             verify( false );
         }
@@ -232,6 +237,8 @@ namespace mongo {
         StatusWithFTSLanguage FTSLanguage::make( const StringData& langName,
                                                  TextIndexVersion textIndexVersion ) {
             switch ( textIndexVersion ) {
+                // TEXT_INDEX_VERSION_3 only changes the key format.
+                case TEXT_INDEX_VERSION_3:
                 case TEXT_INDEX_VERSION_2: {
                     LanguageMapV2::const_iterator it = languageMapV2.find( langName );
                     if ( it == languageMapV2.end() ) {
@@ -76,7 +76,7 @@ namespace mongo {
                                                   const string& raw ) const {
 
             Tokenizer i( *language, raw );
-            Stemmer stemmer( *language );
+            const Stemmer& stemmer = Stemmer::getThreadStemmer( *language );
             while ( i.more() ) {
                 Token t = i.next();
                 if ( t.type != Token::TEXT )
@@ -73,17 +73,19 @@ namespace mongo {
                      "found invalid spec for text index, expected number for textIndexVersion",
                      textIndexVersionElt.isNumber() );
 
-            // We currently support TEXT_INDEX_VERSION_1 (deprecated) and TEXT_INDEX_VERSION_2.
-            // Reject all other values.
+            // We currently support TEXT_INDEX_VERSION_1 (deprecated), TEXT_INDEX_VERSION_2 and
+            // TEXT_INDEX_VERSION_3.  Reject all other values.
             massert( 17364,
                      str::stream() << "attempt to use unsupported textIndexVersion " <<
                          textIndexVersionElt.numberInt() << "; versions supported: " <<
-                         TEXT_INDEX_VERSION_2 << ", " << TEXT_INDEX_VERSION_1,
-                     textIndexVersionElt.numberInt() == TEXT_INDEX_VERSION_2 ||
+                         TEXT_INDEX_VERSION_3 << ", " << TEXT_INDEX_VERSION_2 << ", " <<
+                         TEXT_INDEX_VERSION_1,
+                     textIndexVersionElt.numberInt() == TEXT_INDEX_VERSION_3 ||
+                         textIndexVersionElt.numberInt() == TEXT_INDEX_VERSION_2 ||
                          textIndexVersionElt.numberInt() == TEXT_INDEX_VERSION_1 );
 
-            _textIndexVersion = ( textIndexVersionElt.numberInt() == TEXT_INDEX_VERSION_2 ) ?
-                                TEXT_INDEX_VERSION_2 : TEXT_INDEX_VERSION_1;
+            _textIndexVersion =
+                static_cast<TextIndexVersion>( textIndexVersionElt.numberInt() );
 
             // Initialize _defaultLanguage.  Note that the FTSLanguage constructor requires
             // textIndexVersion, since language parsing is version-specific.
@@ -165,8 +167,9 @@ namespace mongo {
 
             while ( it.more() ) {
                 FTSIteratorValue val = it.next();
-                Stemmer stemmer( *val._language );
-                Tools tools( *val._language, &stemmer, StopWords::getStopWords( *val._language ) );
+                Tools tools( *val._language,
+                             &Stemmer::getThreadStemmer( *val._language ),
+                             StopWords::getStopWords( *val._language ) );
                 _scoreStringV2( tools, val._text, term_freqs, val._weight );
             }
         }
@@ -180,13 +183,16 @@ namespace mongo {
 
             unsigned numTokens = 0;
 
+            // Reused across tokens so that lowering a token does not allocate.
+            string term;
+
             Tokenizer i( tools.language, raw );
             while ( i.more() ) {
                 Token t = i.next();
                 if ( t.type != Token::TEXT )
                     continue;
 
-                string term = t.data.toString();
+                term.assign( t.data.rawData(), t.data.size() );
                 makeLower( &term );
                 if ( tools.stopwords->isStopWord( term ) ) {
                     continue;
@@ -466,7 +472,8 @@ namespace mongo {
                     textIndexVersion = e.numberInt();
                     uassert( 16730,
                              str::stream() << "bad textIndexVersion: " << textIndexVersion,
-                             textIndexVersion == TEXT_INDEX_VERSION_2 );
+                             textIndexVersion == TEXT_INDEX_VERSION_2 ||
+                                 textIndexVersion == TEXT_INDEX_VERSION_3 );
                 }
                 else {
                     b.append( e );
@@ -45,7 +45,8 @@ namespace mongo {
 
         enum TextIndexVersion {
             TEXT_INDEX_VERSION_1 = 1, // Legacy index format.  Deprecated.
-            TEXT_INDEX_VERSION_2 = 2 // Current index format.
+            TEXT_INDEX_VERSION_2 = 2, // Current index format.
+            TEXT_INDEX_VERSION_3 = 3 // Version 2 with scores quantized to 32 bits.  Opt-in.
         };
 
 
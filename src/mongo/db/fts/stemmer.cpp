@@ -28,7 +28,9 @@
 *    it in the license file.
 */
 
+#include <boost/thread/tss.hpp>
 #include <cstdlib>
+#include <map>
 #include <string>
 
 #include "mongo/db/fts/stemmer.h"
@@ -38,12 +40,42 @@ namespace mongo {
 
     namespace fts {
 
+        namespace {
+            // Number of stems each thread stemmer remembers.
+            const size_t kThreadStemCacheSize = 10000;
+
+            // The calling thread's stemmers, keyed by language.  Languages are registered
+            // once at startup and never freed, so their addresses are stable keys.
+            class ThreadStemmers {
+            public:
+                typedef std::map<const FTSLanguage*, Stemmer*> Map;
+
+                ~ThreadStemmers() {
+                    for ( Map::iterator i = stemmers.begin(); i != stemmers.end(); ++i ) {
+                        delete i->second;
+                    }
+                }
+
+                Map stemmers;
+            };
+
+            boost::thread_specific_ptr<ThreadStemmers> threadStemmers;
+        }
+
         Stemmer::Stemmer( const FTSLanguage& language ) {
             _stemmer = NULL;
             if ( language.str() != "none" )
                 _stemmer = sb_stemmer_new(language.str().c_str(), "UTF_8");
         }
 
+        Stemmer::Stemmer( const FTSLanguage& language, size_t cacheSize ) {
+            _stemmer = NULL;
+            if ( language.str() != "none" ) {
+                _stemmer = sb_stemmer_new(language.str().c_str(), "UTF_8");
+                _cache.reset( new StemCache( cacheSize ) );
+            }
+        }
+
         Stemmer::~Stemmer() {
             if ( _stemmer ) {
                 sb_stemmer_delete(_stemmer);
@@ -51,10 +83,41 @@ namespace mongo {
             }
         }
 
+        // static
+        const Stemmer& Stemmer::getThreadStemmer( const FTSLanguage& language ) {
+            ThreadStemmers* mine = threadStemmers.get();
+            if ( !mine ) {
+                mine = new ThreadStemmers();
+                threadStemmers.reset( mine );
+            }
+
+            Stemmer*& stemmer = mine->stemmers[&language];
+            if ( !stemmer ) {
+                stemmer = new Stemmer( language, kThreadStemCacheSize );
+            }
+            return *stemmer;
+        }
+
         string Stemmer::stem( const StringData& word ) const {
             if ( !_stemmer )
                 return word.toString();
 
+            if ( !_cache )
+                return _stem( word );
+
+            string key = word.toString();
+            string* cached;
+            if ( _cache->get( key, &cached ).isOK() )
+                return *cached;
+
+            string* stemmed = new string( _stem( word ) );
+            // Dropping the returned pointer frees the evicted stem, if any.
+            _cache->add( key, stemmed );
+            return *stemmed;
+        }
+
+        string Stemmer::_stem( const StringData& word ) const {
+
             const sb_symbol* sb_sym = sb_stemmer_stem( _stemmer,
                                                        (const sb_symbol*)word.rawData(),
                                                        word.size() );
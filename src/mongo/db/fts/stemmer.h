@@ -31,10 +31,12 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
 #include <string>
 
 #include "mongo/base/string_data.h"
 #include "mongo/db/fts/fts_language.h"
+#include "mongo/db/query/lru_key_value.h"
 #include "third_party/libstemmer_c/include/libstemmer.h"
 
 namespace mongo {
@@ -52,8 +54,25 @@ namespace mongo {
             ~Stemmer();
 
             std::string stem( const StringData& word ) const;
+
+            /**
+             * Returns a stemmer for 'language' that belongs to the calling thread and lives
+             * until the thread exits, so that scoring a document does not set up libstemmer
+             * for every string in it.  The stemmer remembers its most recently used stems.
+             */
+            static const Stemmer& getThreadStemmer( const FTSLanguage& language );
+
         private:
+            typedef LRUKeyValue<std::string, std::string> StemCache;
+
+            Stemmer( const FTSLanguage& language, size_t cacheSize );
+
+            std::string _stem( const StringData& word ) const;
+
             struct sb_stemmer* _stemmer;
+
+            // Maps a word to its stem.  NULL for stemmers created by the public constructor.
+            boost::scoped_ptr<StemCache> _cache;
         };
     }
 }
@@ -49,5 +49,24 @@ namespace mongo {
             ASSERT_EQUALS( "Unite", s.stem( "United" ) );
         }
 
+        TEST( English, ThreadStemmer ) {
+            const Stemmer& s = Stemmer::getThreadStemmer( languageEnglishV2 );
+            ASSERT_EQUALS( &s, &Stemmer::getThreadStemmer( languageEnglishV2 ) );
+            ASSERT_NOT_EQUALS( &s, &Stemmer::getThreadStemmer( languagePorterV1 ) );
+
+            // Cached stems match the uncached ones.
+            for ( int i = 0; i < 2; i++ ) {
+                ASSERT_EQUALS( "run", s.stem( "running" ) );
+                ASSERT_EQUALS( "Run", s.stem( "Running" ) );
+            }
+        }
+
+        TEST( English, ThreadStemmerNone ) {
+            StatusWithFTSLanguage swl = FTSLanguage::make( "none", TEXT_INDEX_VERSION_2 );
+            ASSERT_OK( swl.getStatus() );
+            const Stemmer& s = Stemmer::getThreadStemmer( *swl.getValue() );
+            ASSERT_EQUALS( "running", s.stem( "running" ) );
+        }
+
     }
 }
@@ -28,6 +28,8 @@
 
 #include "mongo/db/geo/geometry_container.h"
 
+#include "third_party/s2/s2regioncoverer.h"
+
 #include "mongo/db/geo/geoconstants.h"
 #include "mongo/db/geo/geoparser.h"
 #include "mongo/util/mongoutils/str.h"
@@ -368,6 +370,38 @@ namespace mongo {
         return false;
     }
 
+    // The number of cells in each covering of a prepared polygon.
+    static const int kPreparedPolygonMaxCells = 64;
+
+    void GeometryContainer::prepareForContains() {
+        if (NULL == _polygon || NULL == _polygon->s2Polygon) {
+            return;
+        }
+
+        const S2Polygon& poly = *_polygon->s2Polygon;
+        S2RegionCoverer coverer;
+        coverer.set_max_cells(kPreparedPolygonMaxCells);
+
+        vector<S2CellId> cells;
+        coverer.GetCovering(poly, &cells);
+        _polygonExteriorCells.reset(new S2CellUnion());
+        _polygonExteriorCells->InitSwap(&cells);
+
+        // A point whose cell only touches the covering may still touch the polygon, so add a
+        // rim of cells.  Finer rim cells would prune more, but a rim on the coarsest level
+        // takes few cells.
+        int coarsestLevel = S2CellId::kMaxLevel;
+        for (int i = 0; i < _polygonExteriorCells->num_cells(); ++i) {
+            coarsestLevel = min(coarsestLevel, _polygonExteriorCells->cell_id(i).level());
+        }
+        _polygonExteriorCells->Expand(coarsestLevel);
+
+        cells.clear();
+        coverer.GetInteriorCovering(poly, &cells);
+        _polygonInteriorCells.reset(new S2CellUnion());
+        _polygonInteriorCells->InitSwap(&cells);
+    }
+
     bool containsPoint(const S2Polygon& poly, const S2Cell& otherCell, const S2Point& otherPoint) {
         // This is much faster for actual containment checking.
         if (poly.Contains(otherPoint)) { return true; }
@@ -377,6 +411,10 @@ namespace mongo {
 
     bool GeometryContainer::contains(const S2Cell& otherCell, const S2Point& otherPoint) const {
         if (NULL != _polygon && (NULL != _polygon->s2Polygon)) {
+            if (NULL != _polygonExteriorCells) {
+                if (!_polygonExteriorCells->Contains(otherCell.id())) { return false; }
+                if (_polygonInteriorCells->Contains(otherCell.id())) { return true; }
+            }
             return containsPoint(*_polygon->s2Polygon, otherCell, otherPoint);
         }
 
@@ -32,6 +32,7 @@
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/db/geo/shapes.h"
+#include "third_party/s2/s2cellunion.h"
 #include "third_party/s2/s2regionunion.h"
 
 namespace mongo {
@@ -96,6 +97,13 @@ namespace mongo {
          */
         bool contains(const GeometryContainer& otherContainer) const;
 
+        /**
+         * Precomputes cell coverings of a polygon so that checking whether it contains a point
+         * mostly needs no edge tests.  Meant for query geometries that are checked against many
+         * documents; does nothing for other geometries.
+         */
+        void prepareForContains();
+
         /**
          * To check intersection, we iterate over the otherContainer's geometries, checking each
          * geometry to see if we intersect it.  If we intersect one geometry, we intersect the
@@ -156,6 +164,11 @@ namespace mongo {
         // TODO: _s2Region is currently generated immediately - don't necessarily need to do this
         scoped_ptr<S2RegionUnion> _s2Region;
         scoped_ptr<R2Region> _r2Region;
+
+        // Only set by prepareForContains() for an S2 polygon.  The exterior cells cover the
+        // polygon and a rim of cells around it, the interior cells lie inside the polygon.
+        scoped_ptr<S2CellUnion> _polygonExteriorCells;
+        scoped_ptr<S2CellUnion> _polygonInteriorCells;
     };
 
 } // namespace mongo
@@ -50,11 +50,11 @@ namespace mongo {
 
     GlobalEnvironmentMongoD::GlobalEnvironmentMongoD()
         : _globalKill(false),
-          _registeredOpContextsMutex("RegisteredOpContextsMutex"),
+          _killOpListenersMutex("KillOpListenersMutex"),
           _storageEngine(NULL) { }
 
     GlobalEnvironmentMongoD::~GlobalEnvironmentMongoD() {
-        if (!_registeredOpContexts.empty()) {
+        if (_registeredOpContexts.size() != 0) {
             warning() << "Terminating with outstanding operation contexts." << endl;
         }
     }
@@ -96,7 +96,7 @@ namespace mongo {
     }
 
     void GlobalEnvironmentMongoD::setKillAllOperations() {
-        scoped_lock clientLock(Client::clientsMutex);
+        scoped_lock listenersLock(_killOpListenersMutex);
         _globalKill = true;
         for (size_t i = 0; i < _killOpListeners.size(); i++) {
             try {
@@ -112,31 +112,42 @@ namespace mongo {
         return _globalKill;
     }
 
-    bool GlobalEnvironmentMongoD::killOperation(unsigned int opId) {
-        scoped_lock clientLock(Client::clientsMutex);
-        bool found = false;
+namespace {
+    /**
+     * Kills the CurOp chain of the client, which runs the operation with the given opId.
+     */
+    class OperationKiller : public Client::ClientProcessor {
+    public:
+        explicit OperationKiller(unsigned int opId) : found(false), _opId(opId) { }
+
+        virtual void processClient(Client* client) {
+            for (CurOp* k = client->curop(); !found && k; k = k->parent()) {
+                if (k->opNum() != _opId)
+                    continue;
+
+                k->kill();
+                for (CurOp* l = client->curop(); l; l = l->parent()) {
+                    l->kill();
+                }
 
-        // XXX clean up
-        {
-            for( set< Client* >::const_iterator j = Client::clients.begin();
-                 !found && j != Client::clients.end();
-                 ++j ) {
+                found = true;
+            }
+        }
 
-                for( CurOp *k = ( *j )->curop(); !found && k; k = k->parent() ) {
-                    if ( k->opNum() != opId )
-                        continue;
+        bool found;
 
-                    k->kill();
-                    for( CurOp *l = ( *j )->curop(); l; l = l->parent() ) {
-                        l->kill();
-                    }
+    private:
+        const unsigned int _opId;
+    };
+} // namespace
 
-                    found = true;
-                }
-            }
-        }
+    bool GlobalEnvironmentMongoD::killOperation(unsigned int opId) {
+        OperationKiller killer(opId);
+        Client::forEachClient(&killer);
+        const bool found = killer.found;
 
         if (found) {
+            scoped_lock listenersLock(_killOpListenersMutex);
             for (size_t i = 0; i < _killOpListeners.size(); i++) {
                 try {
                     _killOpListeners[i]->interrupt(opId);
@@ -154,36 +165,35 @@ namespace mongo {
     }
 
     void GlobalEnvironmentMongoD::registerKillOpListener(KillOpListenerInterface* listener) {
-        scoped_lock clientLock(Client::clientsMutex);
+        scoped_lock listenersLock(_killOpListenersMutex);
         _killOpListeners.push_back(listener);
     }
 
     void GlobalEnvironmentMongoD::registerOperationContext(OperationContext* txn) {
-        scoped_lock lock(_registeredOpContextsMutex);
-
         // It is an error to register twice
-        pair<OperationContextSet::const_iterator, bool> inserted 
-                    = _registeredOpContexts.insert(txn);
-        invariant(inserted.second);
+        _registeredOpContexts.add(txn);
     }
 
     void GlobalEnvironmentMongoD::unregisterOperationContext(OperationContext* txn) {
-        scoped_lock lock(_registeredOpContextsMutex);
-
         // It is an error to unregister twice or to unregister something that's not been registered
-        OperationContextSet::const_iterator it = _registeredOpContexts.find(txn);
-        invariant(it != _registeredOpContexts.end());
-
-        _registeredOpContexts.erase(it);
+        const bool removed = _registeredOpContexts.remove(txn);
+        invariant(removed);
     }
 
-    void GlobalEnvironmentMongoD::forEachOperationContext(ProcessOperationContext* procOpCtx) {
-        scoped_lock lock(_registeredOpContextsMutex);
+namespace {
+    struct ProcessOpContext {
+        explicit ProcessOpContext(GlobalEnvironmentExperiment::ProcessOperationContext* procOpCtx)
+            : procOpCtx(procOpCtx) { }
 
-        OperationContextSet::const_iterator it;
-        for (it = _registeredOpContexts.begin(); it != _registeredOpContexts.end(); ++it) {
-            procOpCtx->processOpContext(*it);
-        }
+        void operator()(OperationContext* txn) const { procOpCtx->processOpContext(txn); }
+
+        GlobalEnvironmentExperiment::ProcessOperationContext* const procOpCtx;
+    };
+} // namespace
+
+    void GlobalEnvironmentMongoD::forEachOperationContext(ProcessOperationContext* procOpCtx) {
+        ProcessOpContext function(procOpCtx);
+        _registeredOpContexts.forEach(function);
     }
 
     OperationContext* GlobalEnvironmentMongoD::newOpCtx() {
@@ -28,11 +28,11 @@
 
 #pragma once
 
-#include <set>
 #include <vector>
 
 #include "mongo/db/global_environment_experiment.h"
 #include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/sharded_registry.h"
 
 
 namespace mongo {
@@ -73,12 +73,10 @@ namespace mongo {
     private:
         bool _globalKill;
 
-        typedef std::set<OperationContext*> OperationContextSet;
+        // Sharded, because every operation registers and unregisters its context
+        ShardedRegistry<OperationContext> _registeredOpContexts;
 
-        mongo::mutex _registeredOpContextsMutex;
-        OperationContextSet _registeredOpContexts;
-
-        // protected by Client::clientsMutex
+        mongo::mutex _killOpListenersMutex;
         std::vector<KillOpListenerInterface*> _killOpListeners;
 
         // logically owned here, but never deleted by anyone.
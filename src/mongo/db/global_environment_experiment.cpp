@@ -70,6 +70,17 @@ namespace mongo {
         return false;
     }
 
+    bool readsFromSnapshots() {
+        if (hasGlobalEnvironment()) {
+            StorageEngine* globalStorageEngine = getGlobalEnvironment()->getGlobalStorageEngine();
+            if (globalStorageEngine != NULL) {
+                return globalStorageEngine->readsFromSnapshots();
+            }
+        }
+
+        return false;
+    }
+
     bool isMMAPV1() {
         if (hasGlobalEnvironment()) {
             StorageEngine* globalStorageEngine = getGlobalEnvironment()->getGlobalStorageEngine();
@@ -201,6 +201,12 @@ namespace mongo {
      */
     bool supportsDocLocking();
 
+    /**
+     * Shortcut for querying the storage engine about whether its reads see a point-in-time
+     * snapshot.
+     */
+    bool readsFromSnapshots();
+
     /**
      * Returns true if the storage engine in use is MMAPV1.
      */
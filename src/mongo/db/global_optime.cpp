@@ -59,22 +59,32 @@ namespace mongo {
     }
 
     OpTime getNextGlobalOptime() {
+        return getNextGlobalOptimes(1);
+    }
+
+    OpTime getNextGlobalOptimes(unsigned count) {
+        invariant(count > 0);
         mutex::scoped_lock lk(globalOptimeMutex);
 
         const unsigned now = (unsigned) time(0);
         const unsigned globalSecs = globalOpTime.getSecs();
+        OpTime first;
         if ( globalSecs == now ) {
-            globalOpTime = OpTime(globalSecs, globalOpTime.getInc() + 1);
+            first = OpTime(globalSecs, globalOpTime.getInc() + 1);
         }
         else if ( now < globalSecs ) {
-            globalOpTime = OpTime(globalSecs, globalOpTime.getInc() + 1);
-            // separate function to keep out of the hot code path
-            fassert(17449, !skewed(globalOpTime));
+            first = OpTime(globalSecs, globalOpTime.getInc() + 1);
         }
         else {
-            globalOpTime = OpTime(now, 1);
+            first = OpTime(now, 1);
         }
 
-        return globalOpTime;
+        globalOpTime = OpTime(first.getSecs(), first.getInc() + count - 1);
+        if ( now < globalSecs ) {
+            // separate function to keep out of the hot code path
+            fassert(17449, !skewed(globalOpTime));
+        }
+
+        return first;
     }
 }
@@ -42,4 +42,10 @@ namespace mongo {
      * Generates a new and unique OpTime.
      */
     OpTime getNextGlobalOptime();
+
+    /**
+     * Reserves 'count' new and unique OpTimes, which share the seconds of the returned first one
+     * and have consecutive increments. The last one becomes the global OpTime.
+     */
+    OpTime getNextGlobalOptimes(unsigned count);
 }
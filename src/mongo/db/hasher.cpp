@@ -33,7 +33,11 @@
 */
 
 #include "mongo/db/hasher.h"
+
+#include <boost/scoped_array.hpp>
+
 #include "mongo/db/jsobj.h"
+#include "mongo/util/md5_multibuffer.h"
 #include "mongo/util/startup_test.h"
 
 namespace mongo {
@@ -51,6 +55,69 @@ namespace mongo {
         md5_finish( &_md5State , out );
     }
 
+    namespace {
+
+        /* Takes the bytes recursiveHash would feed a Hasher, seed first, and keeps
+         * them to be hashed later together with those of other elements.
+         */
+        class HashInputBuffer {
+        public:
+            HashInputBuffer( BufBuilder* buf , HashSeed seed ) : _buf( buf ) {
+                addData( &seed , sizeof( seed ) );
+            }
+
+            void addData( const void * keyData , size_t numBytes ) {
+                _buf->appendBuf( keyData , numBytes );
+            }
+
+        private:
+            BufBuilder* _buf;
+        };
+
+        template< typename Sink >
+        void recursiveHashInto( Sink* h , const BSONElement& e , bool includeFieldName ) {
+
+            int canonicalType = e.canonicalType();
+            h->addData( &canonicalType , sizeof( canonicalType ) );
+
+            if ( includeFieldName ){
+                h->addData( e.fieldName() , e.fieldNameSize() );
+            }
+
+            if ( !e.mayEncapsulate() ){
+                //if there are no embedded objects (subobjects or arrays),
+                //compute the hash, squashing numeric types to 64-bit ints
+                if ( e.isNumber() ){
+                    long long int i = e.safeNumberLong(); //well-defined for troublesome doubles
+                    h->addData( &i , sizeof( i ) );
+                }
+                else {
+                    h->addData( e.value() , e.valuesize() );
+                }
+            }
+            else {
+                //else identify the subobject.
+                //hash any preceding stuff (in the case of codeWscope)
+                //then each sub-element
+                //then finish with the EOO element.
+                BSONObj b;
+                if ( e.type() == CodeWScope ) {
+                    h->addData( e.codeWScopeCode() , e.codeWScopeCodeLen() );
+                    b = e.codeWScopeObject();
+                }
+                else {
+                    b = e.embeddedObject();
+                }
+                BSONObjIterator i(b);
+                while( i.moreWithEOO() ) {
+                    BSONElement el = i.next();
+                    recursiveHashInto( h , el ,  true );
+                }
+            }
+        }
+
+    } // namespace
+
     long long int BSONElementHasher::hash64( const BSONElement& e , HashSeed seed ){
         scoped_ptr<Hasher> h( HasherFactory::createHasher( seed ) );
         recursiveHash( h.get() , e , false );
@@ -61,49 +128,45 @@ namespace mongo {
         return *reinterpret_cast< long long int * >( d );
     }
 
-    void BSONElementHasher::recursiveHash( Hasher* h ,
-                                           const BSONElement& e ,
-                                           bool includeFieldName ) {
+    void BSONElementHasher::hash64Batch( const std::vector<BSONElement>& elements ,
+                                         HashSeed seed ,
+                                         std::vector<long long int>* hashes ) {
+        const size_t n = elements.size();
+        hashes->resize( n );
+        if ( n == 0 )
+            return;
 
-        int canonicalType = e.canonicalType();
-        h->addData( &canonicalType , sizeof( canonicalType ) );
-
-        if ( includeFieldName ){
-            h->addData( e.fieldName() , e.fieldNameSize() );
+        BufBuilder buf;
+        std::vector<size_t> ends( n );
+        for ( size_t i = 0; i < n; i++ ) {
+            HashInputBuffer h( &buf , seed );
+            recursiveHashInto( &h , elements[i] , false );
+            ends[i] = buf.len();
         }
 
-        if ( !e.mayEncapsulate() ){
-            //if there are no embedded objects (subobjects or arrays),
-            //compute the hash, squashing numeric types to 64-bit ints
-            if ( e.isNumber() ){
-                long long int i = e.safeNumberLong(); //well-defined for troublesome doubles
-                h->addData( &i , sizeof( i ) );
-            }
-            else {
-                h->addData( e.value() , e.valuesize() );
-            }
+        // The buffer has stopped moving, so the inputs can be pointed at now.
+        std::vector<const md5_byte_t*> inputs( n );
+        std::vector<size_t> lengths( n );
+        for ( size_t i = 0; i < n; i++ ) {
+            const size_t begin = i ? ends[i - 1] : 0;
+            inputs[i] = reinterpret_cast< const md5_byte_t * >( buf.buf() ) + begin;
+            lengths[i] = ends[i] - begin;
         }
-        else {
-            //else identify the subobject.
-            //hash any preceding stuff (in the case of codeWscope)
-            //then each sub-element
-            //then finish with the EOO element.
-            BSONObj b;
-            if ( e.type() == CodeWScope ) {
-                h->addData( e.codeWScopeCode() , e.codeWScopeCodeLen() );
-                b = e.codeWScopeObject();
-            }
-            else {
-                b = e.embeddedObject();
-            }
-            BSONObjIterator i(b);
-            while( i.moreWithEOO() ) {
-                BSONElement el = i.next();
-                recursiveHash( h , el ,  true );
-            }
+
+        boost::scoped_array<md5digest> digests( new md5digest[n] );
+        md5MultiBuffer( &inputs[0] , &lengths[0] , n , digests.get() );
+        for ( size_t i = 0; i < n; i++ ) {
+            // same truncation as hash64
+            (*hashes)[i] = *reinterpret_cast< long long int * >( digests[i] );
         }
     }
 
+    void BSONElementHasher::recursiveHash( Hasher* h ,
+                                           const BSONElement& e ,
+                                           bool includeFieldName ) {
+        recursiveHashInto( h , e , includeFieldName );
+    }
+
     struct HasherUnitTest : public StartupTest {
         void run() {
             // Hard-coded check to ensure the hash function is consistent across platforms
@@ -34,6 +34,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "mongo/pch.h"
 #include "mongo/bson/bsonelement.h"
 #include "mongo/util/md5.hpp"
@@ -100,6 +102,14 @@ namespace mongo {
          */
         static long long int hash64( const BSONElement& e , HashSeed seed );
 
+        /* Same as hash64 on each of "elements", into "hashes" in the same order.
+         * The MD5 of the whole batch is computed several inputs at a time, which
+         * is what the batch insert paths for hashed indexes and hashed shard keys use.
+         */
+        static void hash64Batch( const std::vector<BSONElement>& elements ,
+                                 HashSeed seed ,
+                                 std::vector<long long int>* hashes );
+
         /* This incrementally computes the hash of BSONElement "e"
          * using hash function "h".  If "includeFieldName" is true,
          * then the name of the field is hashed in between the type of
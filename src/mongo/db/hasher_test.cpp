@@ -381,5 +381,35 @@ namespace {
         ASSERT_EQUALS( hashIt( o ), 501342939894575968LL );
     }
 
+    // Test the batch version gives the same hashes as hash64, whatever the batch size and the
+    // lengths of the inputs, which go through MD5 several at a time
+    TEST( BSONElementHasher, HashBatchMatchesHash64 ) {
+        BSONObjBuilder builder;
+        for ( int i = 0; i < 23; i++ ) {
+            switch ( i % 5 ) {
+            case 0: builder.append( "", i ); break;
+            case 1: builder.append( "", string( i * 7, 'x' ) ); break;
+            case 2: builder.append( "", BSON( "a" << i << "b" << string( 60, 'y' ) ) ); break;
+            case 3: builder.appendNull( "" ); break;
+            default: builder.append( "", i + 0.5 ); break;
+            }
+        }
+        BSONObj values = builder.obj();
+
+        vector<BSONElement> elements;
+        values.elems( elements );
+        for ( size_t n = 0; n <= elements.size(); n++ ) {
+            vector<BSONElement> batch( elements.begin(), elements.begin() + n );
+            for ( int seed = 0; seed < 2; seed++ ) {
+                vector<long long int> hashes;
+                BSONElementHasher::hash64Batch( batch, seed, &hashes );
+                ASSERT_EQUALS( n, hashes.size() );
+                for ( size_t i = 0; i < n; i++ ) {
+                    ASSERT_EQUALS( BSONElementHasher::hash64( batch[i], seed ), hashes[i] );
+                }
+            }
+        }
+    }
+
 } // namespace
 } // namespace mongo
@@ -55,7 +55,8 @@ namespace mongo {
         if (0 == _descriptor->version()) {
             _keyGenerator.reset(new BtreeKeyGeneratorV0(fieldNames, fixed,
                 _descriptor->isSparse()));
-        } else if (1 == _descriptor->version()) {
+        } else if (1 == _descriptor->version() || 2 == _descriptor->version()) {
+            // v:2 keys are v:1 keys, only stored with their common prefixes shared.
             _keyGenerator.reset(new BtreeKeyGeneratorV1(fieldNames, fixed,
                 _descriptor->isSparse()));
         } else {
@@ -67,4 +68,10 @@ namespace mongo {
         _keyGenerator->getKeys(obj, keys);
     }
 
+    void BtreeAccessMethod::getKeys(const BSONObj& obj,
+                                    BSONObjSet* keys,
+                                    const BSONFieldIndex* fieldIndex) {
+        _keyGenerator->getKeys(obj, keys, fieldIndex);
+    }
+
 }  // namespace mongo
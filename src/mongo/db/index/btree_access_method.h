@@ -58,6 +58,10 @@ namespace mongo {
     private:
         virtual void getKeys(const BSONObj& obj, BSONObjSet* keys);
 
+        virtual void getKeys(const BSONObj& obj,
+                             BSONObjSet* keys,
+                             const BSONFieldIndex* fieldIndex);
+
         // Our keys differ for V0 and V1.
         scoped_ptr<BtreeKeyGenerator> _keyGenerator;
     };
@@ -30,15 +30,19 @@
 
 #include "mongo/db/index/btree_access_method.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "mongo/base/error_codes.h"
 #include "mongo/base/status.h"
+#include "mongo/bson/bson_field_index.h"
+#include "mongo/db/catalog/index_catalog_entry.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/index/btree_based_bulk_access_method.h"
 #include "mongo/db/index/btree_index_cursor.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/keypattern.h"
+#include "mongo/db/matcher/expression.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/util/log.h"
@@ -56,12 +60,48 @@ namespace mongo {
 
     BtreeBasedAccessMethod::InvalidateCursorsNotification BtreeBasedAccessMethod::invalidateCursors;
 
+    namespace {
+
+        bool hasArrayAlongPath(const BSONObj& obj,
+                               const StringData& path,
+                               const BSONFieldIndex* fieldIndex) {
+            size_t dot = path.find('.');
+            const StringData first = dot == string::npos ? path : path.substr(0, dot);
+            BSONElement elt = fieldIndex ? fieldIndex->getField(obj, first) : obj.getField(first);
+            if (Array == elt.type()) {
+                return true;
+            }
+            if (dot != string::npos && Object == elt.type()) {
+                return hasArrayAlongPath(elt.embeddedObject(), path.substr(dot + 1), NULL);
+            }
+            return false;
+        }
+
+    } // namespace
+
+    void BtreeBasedAccessMethod::getMultikeyPaths(const BSONObj& obj,
+                                                  std::set<std::string>* paths,
+                                                  const BSONFieldIndex* fieldIndex) const {
+        BSONObjIterator it(_descriptor->keyPattern());
+        while (it.more()) {
+            const char* field = it.next().fieldName();
+            if (hasArrayAlongPath(obj, field, fieldIndex)) {
+                paths->insert(field);
+            }
+        }
+    }
+
     BtreeBasedAccessMethod::BtreeBasedAccessMethod(IndexCatalogEntry* btreeState,
                                                    SortedDataInterface* btree)
         : _btreeState(btreeState),
           _descriptor(btreeState->descriptor()),
           _newInterface(btree) {
-        verify(0 == _descriptor->version() || 1 == _descriptor->version());
+        verify(0 <= _descriptor->version() && _descriptor->version() <= 2);
+    }
+
+    bool BtreeBasedAccessMethod::indexesDocument(const BSONObj& obj) const {
+        const MatchExpression* filter = _btreeState->getFilterExpression();
+        return !filter || filter->matchesBSON(obj);
     }
 
     // Find the keys for obj, put them in the tree pointing to loc
@@ -74,11 +114,13 @@ namespace mongo {
 
         BSONObjSet keys;
         // Delegate to the subclass.
-        getKeys(obj, &keys);
+        if (indexesDocument(obj)) {
+            getKeys(obj, &keys);
+        }
 
         Status ret = Status::OK();
         for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
-            Status status = _newInterface->insert(txn, *i, loc, options.dupsAllowed);
+            Status status = insertOneKey(txn, *i, loc, options.dupsAllowed);
 
             // Everything's OK, carry on.
             if (status.isOK()) {
@@ -88,25 +130,8 @@ namespace mongo {
 
             // Error cases.
 
-            if (ErrorCodes::KeyTooLong == status.code()) {
-                // Ignore this error if we're on a secondary.
-                if (!txn->isPrimaryFor(_btreeState->ns())) {
-                    continue;
-                }
-
-                // The user set a parameter to ignore key too long errors.
-                if (!failIndexKeyTooLong) {
-                    continue;
-                }
-            }
-
-            if (ErrorCodes::DuplicateKeyValue == status.code()) {
-                // A document might be indexed multiple times during a background index build
-                // if it moves ahead of the collection scan cursor (e.g. via an update).
-                if (!_btreeState->isReady(txn)) {
-                    LOG(3) << "key " << *i << " already in index during background indexing (ok)";
-                    continue;
-                }
+            if (canIgnoreInsertError(txn, status, *i)) {
+                continue;
             }
 
             // Clean up after ourselves.
@@ -119,16 +144,61 @@ namespace mongo {
         }
 
         if (*numInserted > 1) {
-            _btreeState->setMultikey( txn );
+            std::set<std::string> paths;
+            getMultikeyPaths(obj, &paths);
+            _btreeState->setMultikey( txn, paths );
         }
 
         return ret;
     }
 
+    bool BtreeBasedAccessMethod::canIgnoreInsertError(OperationContext* txn,
+                                                      const Status& status,
+                                                      const BSONObj& key) const {
+        if (ErrorCodes::KeyTooLong == status.code()) {
+            // Ignore this error if we're on a secondary.
+            if (!txn->isPrimaryFor(_btreeState->ns())) {
+                return true;
+            }
+
+            // The user set a parameter to ignore key too long errors.
+            if (!failIndexKeyTooLong) {
+                return true;
+            }
+        }
+
+        if (ErrorCodes::DuplicateKeyValue == status.code()) {
+            // A document might be indexed multiple times during a background index build
+            // if it moves ahead of the collection scan cursor (e.g. via an update).
+            if (!_btreeState->isReady(txn)) {
+                LOG(3) << "key " << key << " already in index during background indexing (ok)";
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    Status BtreeBasedAccessMethod::insertOneKey(OperationContext* txn,
+                                                const BSONObj& key,
+                                                const DiskLoc& loc,
+                                                bool dupsAllowed) {
+        if (_sideWrites) {
+            _sideWrites->recordInsert(txn, key, loc);
+            return Status::OK();
+        }
+        return _newInterface->insert(txn, key, loc, dupsAllowed);
+    }
+
     void BtreeBasedAccessMethod::removeOneKey(OperationContext* txn,
                                               const BSONObj& key,
                                               const DiskLoc& loc,
                                               bool dupsAllowed) {
+        if (_sideWrites) {
+            _sideWrites->recordRemove(txn, key, loc);
+            return;
+        }
+
         try {
             _newInterface->unindex(txn, key, loc, dupsAllowed);
         } catch (AssertionException& e) {
@@ -141,6 +211,42 @@ namespace mongo {
         }
     }
 
+    Status BtreeBasedAccessMethod::insertKeys(OperationContext* txn,
+                                              const std::vector<BSONObj>& keys,
+                                              const DiskLoc& loc,
+                                              bool dupsAllowed) {
+        if (_sideWrites) {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                _sideWrites->recordInsert(txn, keys[i], loc);
+            }
+            return Status::OK();
+        }
+        size_t numInserted;
+        return _newInterface->insertKeys(txn, keys, loc, dupsAllowed, &numInserted);
+    }
+
+    void BtreeBasedAccessMethod::removeKeys(OperationContext* txn,
+                                            const std::vector<BSONObj>& keys,
+                                            const DiskLoc& loc,
+                                            bool dupsAllowed) {
+        if (_sideWrites) {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                _sideWrites->recordRemove(txn, keys[i], loc);
+            }
+            return;
+        }
+
+        try {
+            _newInterface->unindexKeys(txn, keys, loc, dupsAllowed);
+        } catch (AssertionException&) {
+            // Go over the keys one at a time, so that the one which failed is logged and the
+            // others are still removed.
+            for (size_t i = 0; i < keys.size(); ++i) {
+                removeOneKey(txn, keys[i], loc, dupsAllowed);
+            }
+        }
+    }
+
     Status BtreeBasedAccessMethod::newCursor(OperationContext* txn, const CursorOptions& opts, IndexCursor** out) const {
         *out = new BtreeIndexCursor(_newInterface->newCursor(txn, opts.direction));
         return Status::OK();
@@ -154,20 +260,72 @@ namespace mongo {
                                           int64_t* numDeleted) {
 
         BSONObjSet keys;
-        getKeys(obj, &keys);
-        *numDeleted = 0;
+        if (indexesDocument(obj)) {
+            getKeys(obj, &keys);
+        }
+        removeKeys(txn, std::vector<BSONObj>(keys.begin(), keys.end()), loc, options.dupsAllowed);
+        *numDeleted = keys.size();
 
-        for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
-            removeOneKey(txn, *i, loc, options.dupsAllowed);
-            ++*numDeleted;
+        return Status::OK();
+    }
+
+    namespace {
+        typedef std::pair<BSONObj, DiskLoc> KeyAndLoc;
+
+        // Orders (key, loc) pairs the way the index itself stores them.
+        class KeyAndLocLessThan {
+        public:
+            explicit KeyAndLocLessThan(const Ordering& ordering) : _ordering(ordering) { }
+
+            bool operator()(const KeyAndLoc& lhs, const KeyAndLoc& rhs) const {
+                int cmp = lhs.first.woCompare(rhs.first, _ordering, false);
+                if (cmp != 0) {
+                    return cmp < 0;
+                }
+                return lhs.second < rhs.second;
+            }
+
+        private:
+            Ordering _ordering;
+        };
+    } // namespace
+
+    Status BtreeBasedAccessMethod::removeMany(OperationContext* txn,
+                                              const std::vector<BSONObj>& objs,
+                                              const std::vector<DiskLoc>& locs,
+                                              const InsertDeleteOptions& options,
+                                              int64_t* numDeleted) {
+        invariant(objs.size() == locs.size());
+
+        std::vector<KeyAndLoc> entries;
+        for (size_t i = 0; i < objs.size(); ++i) {
+            if (!indexesDocument(objs[i])) {
+                continue;
+            }
+            BSONObjSet keys;
+            getKeys(objs[i], &keys);
+            for (BSONObjSet::const_iterator j = keys.begin(); j != keys.end(); ++j) {
+                entries.push_back(KeyAndLoc(*j, locs[i]));
+            }
+        }
+
+        std::sort(entries.begin(),
+                  entries.end(),
+                  KeyAndLocLessThan(Ordering::make(_descriptor->keyPattern())));
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            removeOneKey(txn, entries[i].first, entries[i].second, options.dupsAllowed);
         }
 
+        if (numDeleted) {
+            *numDeleted = entries.size();
+        }
         return Status::OK();
     }
 
     // Return keys in l that are not in r.
     // Lifted basically verbatim from elsewhere.
-    static void setDifference(const BSONObjSet &l, const BSONObjSet &r, vector<BSONObj*> *diff) {
+    static void setDifference(const BSONObjSet &l, const BSONObjSet &r, vector<BSONObj> *diff) {
         // l and r must use the same ordering spec.
         verify(l.key_comp().order() == r.key_comp().order());
         BSONObjSet::const_iterator i = l.begin();
@@ -178,8 +336,7 @@ namespace mongo {
             while ( j != r.end() && j->woCompare( *i ) < 0 )
                 j++;
             if ( j == r.end() || i->woCompare(*j) != 0  ) {
-                const BSONObj *jo = &*i;
-                diff->push_back( (BSONObj *) jo );
+                diff->push_back( *i );
             }
             i++;
         }
@@ -191,11 +348,12 @@ namespace mongo {
 
     Status BtreeBasedAccessMethod::touch(OperationContext* txn, const BSONObj& obj) {
         BSONObjSet keys;
-        getKeys(obj, &keys);
+        if (indexesDocument(obj)) {
+            getKeys(obj, &keys);
+        }
 
-        boost::scoped_ptr<SortedDataInterface::Cursor> cursor(_newInterface->newCursor(txn, 1));
         for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
-            cursor->locate(*i, DiskLoc());
+            _newInterface->touchKey(txn, *i);
         }
 
         return Status::OK();
@@ -225,6 +383,28 @@ namespace mongo {
         return cursor->getDiskLoc();
     }
 
+    void BtreeBasedAccessMethod::findMany(OperationContext* txn,
+                                          const std::vector<BSONObj>& keys,
+                                          std::vector<DiskLoc>* locsOut) const {
+        locsOut->assign(keys.size(), DiskLoc());
+
+        boost::scoped_ptr<SortedDataInterface::Cursor> cursor(_newInterface->newCursor(txn, 1));
+        for (size_t i = 0; i < keys.size(); ++i) {
+            dassert(0 == i || keys[i - 1].woCompare(keys[i], BSONObj(), false) <= 0);
+
+            cursor->locate(keys[i], minDiskLoc);
+
+            // As the keys ascend, once we run off the end of the index none of the rest is there.
+            if (cursor->isEOF()) {
+                return;
+            }
+
+            if (0 == keys[i].woCompare(cursor->getKey(), BSONObj(), false)) {
+                (*locsOut)[i] = cursor->getDiskLoc();
+            }
+        }
+    }
+
     Status BtreeBasedAccessMethod::validate(OperationContext* txn, bool full, int64_t* numKeys,
                                             BSONObjBuilder* output) {
         // XXX: long long vs int64_t
@@ -238,6 +418,22 @@ namespace mongo {
         return _newInterface->getSpaceUsedBytes( txn );
     }
 
+    bool BtreeBasedAccessMethod::countKeysInRange(OperationContext* txn,
+                                                  const BSONObj& startKey,
+                                                  bool startKeyInclusive,
+                                                  const BSONObj& endKey,
+                                                  bool endKeyInclusive,
+                                                  bool approximate,
+                                                  long long* countOut) const {
+        return _newInterface->countKeysInRange(txn,
+                                               startKey,
+                                               startKeyInclusive,
+                                               endKey,
+                                               endKeyInclusive,
+                                               approximate,
+                                               countOut);
+    }
+
     Status BtreeBasedAccessMethod::validateUpdate(OperationContext* txn,
                                                   const BSONObj &from,
                                                   const BSONObj &to,
@@ -248,8 +444,17 @@ namespace mongo {
         BtreeBasedPrivateUpdateData *data = new BtreeBasedPrivateUpdateData();
         status->_indexSpecificUpdateData.reset(data);
 
-        getKeys(from, &data->oldKeys);
-        getKeys(to, &data->newKeys);
+        // A partial index gains or loses the document when the update changes whether it
+        // matches the filter.
+        if (indexesDocument(from)) {
+            getKeys(from, &data->oldKeys);
+        }
+        if (indexesDocument(to)) {
+            getKeys(to, &data->newKeys);
+        }
+        if (data->newKeys.size() > 1) {
+            getMultikeyPaths(to, &data->multikeyPaths);
+        }
         data->loc = record;
         data->dupsAllowed = options.dupsAllowed;
 
@@ -272,21 +477,17 @@ namespace mongo {
             static_cast<BtreeBasedPrivateUpdateData*>(ticket._indexSpecificUpdateData.get());
 
         if (data->oldKeys.size() + data->added.size() - data->removed.size() > 1) {
-            _btreeState->setMultikey( txn );
+            _btreeState->setMultikey( txn, data->multikeyPaths );
         }
 
-        for (size_t i = 0; i < data->removed.size(); ++i) {
-            _newInterface->unindex(txn,
-                                   *data->removed[i],
-                                   data->loc,
-                                   data->dupsAllowed);
+        // The removed and the added keys each go to the index as one sorted batch, which the
+        // storage engine can apply without starting over for every key.
+        if (!data->removed.empty()) {
+            removeKeys(txn, data->removed, data->loc, data->dupsAllowed);
         }
 
-        for (size_t i = 0; i < data->added.size(); ++i) {
-            Status status = _newInterface->insert(txn,
-                                                  *data->added[i],
-                                                  data->loc,
-                                                  data->dupsAllowed);
+        if (!data->added.empty()) {
+            Status status = insertKeys(txn, data->added, data->loc, data->dupsAllowed);
             if ( !status.isOK() ) {
                 return status;
             }
@@ -297,6 +498,48 @@ namespace mongo {
         return Status::OK();
     }
 
+    void BtreeBasedAccessMethod::setSideWrites(
+            const boost::shared_ptr<IndexSideWrites>& sideWrites) {
+        _sideWrites = sideWrites;
+    }
+
+    Status BtreeBasedAccessMethod::applySideWrites(OperationContext* txn,
+                                                   IndexSideWrites* sideWrites,
+                                                   bool mayInterrupt,
+                                                   size_t* numApplied) {
+        // How many writes to apply in one unit of work.
+        const size_t batchSize = 1000;
+
+        std::vector<IndexSideWrites::Write> writes;
+        sideWrites->takeWrites(&writes);
+        *numApplied = writes.size();
+
+        for (size_t begin = 0; begin < writes.size(); begin += batchSize) {
+            if (mayInterrupt)
+                txn->checkForInterrupt();
+
+            WriteUnitOfWork wunit(txn);
+            const size_t end = std::min(writes.size(), begin + batchSize);
+            for (size_t i = begin; i < end; i++) {
+                const IndexSideWrites::Write& write = writes[i];
+                if (!write.isInsert) {
+                    // Removing a key which isn't there, because the collection scan came after
+                    // the document was removed, does nothing.
+                    _newInterface->unindex(txn, write.key, write.loc, true);
+                    continue;
+                }
+
+                // The key may already be there, if the collection scan saw the document too.
+                Status status = _newInterface->insert(txn, write.key, write.loc, true);
+                if (!status.isOK() && !canIgnoreInsertError(txn, status, write.key))
+                    return status;
+            }
+            wunit.commit();
+        }
+
+        return Status::OK();
+    }
+
     IndexAccessMethod* BtreeBasedAccessMethod::initiateBulk(OperationContext* txn) {
         // If there's already data in the index, don't do anything.
         if (!_newInterface->isEmpty(txn)) {
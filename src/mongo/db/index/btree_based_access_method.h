@@ -28,6 +28,9 @@
 
 #pragma once
 
+#include <boost/shared_ptr.hpp>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "mongo/base/disallow_copying.h"
@@ -36,11 +39,13 @@
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_cursor.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/index/index_side_writes.h"
 #include "mongo/db/storage/sorted_data_interface.h"
 #include "mongo/db/storage/mmap_v1/btree/bucket_deletion_notification.h"  // XXX HK this can go away
 
 namespace mongo {
 
+    class BSONFieldIndex;
     class ExternalSortComparison;
 
     /**
@@ -74,6 +79,16 @@ namespace mongo {
                               const InsertDeleteOptions& options,
                               int64_t* numDeleted);
 
+        /**
+         * Removes the keys of all the documents in a single pass over the index, in key order,
+         * so that neighbouring keys are deleted while their pages are still in cache.
+         */
+        virtual Status removeMany(OperationContext* txn,
+                                  const std::vector<BSONObj>& objs,
+                                  const std::vector<DiskLoc>& locs,
+                                  const InsertDeleteOptions& options,
+                                  int64_t* numDeleted);
+
         virtual Status validateUpdate(OperationContext* txn,
                                       const BSONObj& from,
                                       const BSONObj& to,
@@ -107,9 +122,49 @@ namespace mongo {
 
         virtual long long getSpaceUsedBytes( OperationContext* txn ) const;
 
+        virtual bool countKeysInRange(OperationContext* txn,
+                                      const BSONObj& startKey,
+                                      bool startKeyInclusive,
+                                      const BSONObj& endKey,
+                                      bool endKeyInclusive,
+                                      bool approximate,
+                                      long long* countOut) const;
+
         // XXX: consider migrating callers to use IndexCursor instead
         virtual DiskLoc findSingle( OperationContext* txn, const BSONObj& key ) const;
 
+        /**
+         * Looks up each of 'keys', which must be in ascending order, with one cursor that sweeps
+         * forward through the index.  The DiskLoc of the first entry for keys[i], or a null
+         * DiskLoc if there is none, is stored in (*locsOut)[i].
+         */
+        void findMany( OperationContext* txn,
+                       const std::vector<BSONObj>& keys,
+                       std::vector<DiskLoc>* locsOut ) const;
+
+        /**
+         * Adds the keys 'obj' has in this index to 'keys'.
+         */
+        void getKeysForDocument(const BSONObj& obj, BSONObjSet* keys) { getKeys(obj, keys); }
+
+        /**
+         * While 'sideWrites' is set, insert(), remove() and update() record the keys they would
+         * change in it rather than changing the index, so that a background build can load the
+         * index in bulk.  Pass an empty pointer to go back to writing the index.
+         */
+        void setSideWrites(const boost::shared_ptr<IndexSideWrites>& sideWrites);
+
+        /**
+         * Applies the writes recorded in 'sideWrites' so far to the index, in units of work of a
+         * bounded size, checking for interrupts between them if 'mayInterrupt'.  Sets
+         * '*numApplied' to how many there were.  Must only be called by the build which set
+         * 'sideWrites', while writers still record into it or once they no longer can.
+         */
+        Status applySideWrites(OperationContext* txn,
+                               IndexSideWrites* sideWrites,
+                               bool mayInterrupt,
+                               size_t* numApplied);
+
         /**
          * Invalidates all active cursors, which point at the bucket being deleted.
          * TODO see if there is a better place to put this.
@@ -129,16 +184,69 @@ namespace mongo {
 
         virtual void getKeys(const BSONObj &obj, BSONObjSet *keys) = 0;
 
+        /**
+         * Same as getKeys(obj, keys), but may look up the top level fields of 'obj' through
+         * 'fieldIndex', which the keys of other indexes for the same document can share.  By
+         * default 'fieldIndex' isn't used.
+         */
+        virtual void getKeys(const BSONObj& obj,
+                             BSONObjSet* keys,
+                             const BSONFieldIndex* fieldIndex) {
+            getKeys(obj, keys);
+        }
+
+        /**
+         * Adds to 'paths' each field of the key pattern along which 'obj' has an array.  If
+         * 'fieldIndex' is not NULL, the top level fields are looked up through it.
+         */
+        void getMultikeyPaths(const BSONObj& obj,
+                              std::set<std::string>* paths,
+                              const BSONFieldIndex* fieldIndex = NULL) const;
+
+        /**
+         * Whether 'obj' has keys in this index at all.  A partial index only holds the
+         * documents matching its filter expression; the others are left out as if they had
+         * no keys.
+         */
+        bool indexesDocument(const BSONObj& obj) const;
+
         IndexCatalogEntry* _btreeState; // owned by IndexCatalogEntry
         const IndexDescriptor* _descriptor;
 
     private:
+        Status insertOneKey(OperationContext* txn,
+                            const BSONObj& key,
+                            const DiskLoc& loc,
+                            bool dupsAllowed);
+
         void removeOneKey(OperationContext* txn,
                           const BSONObj& key,
                           const DiskLoc& loc,
                           bool dupsAllowed);
 
+        // As insertOneKey and removeOneKey, for keys sorted by the same order as a BSONObjSet.
+        Status insertKeys(OperationContext* txn,
+                          const std::vector<BSONObj>& keys,
+                          const DiskLoc& loc,
+                          bool dupsAllowed);
+
+        void removeKeys(OperationContext* txn,
+                        const std::vector<BSONObj>& keys,
+                        const DiskLoc& loc,
+                        bool dupsAllowed);
+
+        /**
+         * Whether a failure to insert a key may be ignored: the key is too long but such keys
+         * are skipped, or it is already there during a background build.
+         */
+        bool canIgnoreInsertError(OperationContext* txn,
+                                  const Status& status,
+                                  const BSONObj& key) const;
+
         scoped_ptr<SortedDataInterface> _newInterface;
+
+        // Set while a background build loads the index in bulk.
+        boost::shared_ptr<IndexSideWrites> _sideWrites;
     };
 
     /**
@@ -151,8 +259,11 @@ namespace mongo {
 
         BSONObjSet oldKeys, newKeys;
 
-        // These point into the sets oldKeys and newKeys.
-        std::vector<BSONObj*> removed, added;
+        // The keys of oldKeys which aren't in newKeys and the other way around, in order.
+        std::vector<BSONObj> removed, added;
+
+        // Set if the new document makes several keys.
+        std::set<std::string> multikeyPaths;
 
         DiskLoc loc;
         bool dupsAllowed;
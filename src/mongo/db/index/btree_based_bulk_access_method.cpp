@@ -33,7 +33,9 @@
 #include "mongo/db/index/btree_based_bulk_access_method.h"
 
 #include "mongo/db/curop.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/util/log.h"
 #include "mongo/util/progress_meter.h"
@@ -53,13 +55,13 @@ namespace mongo {
         BtreeExternalSortComparison(const BSONObj& ordering, int version)
             : _ordering(Ordering::make(ordering)),
               _version(version) {
-            invariant(version == 1 || version == 0);
+            invariant(version >= 0 && version <= 2);
         }
 
         typedef std::pair<BSONObj, DiskLoc> Data;
 
         int operator() (const Data& l, const Data& r) const {
-            int x = (_version == 1
+            int x = (_version >= 1
                         ? l.first.woCompare(r.first, _ordering, /*considerfieldname*/false)
                         : oldCompare(l.first, r.first, _ordering));
             if (x) { return x; }
@@ -70,23 +72,64 @@ namespace mongo {
         const int _version;
     };
 
+    // The memory shared by the key sorters of all the index builds running at once.
+    MONGO_EXPORT_SERVER_PARAMETER(maxIndexBuildMemoryUsageMegabytes, int, 100);
+
+    // Beyond this many spilled files, a key sorter merges its files into one.
+    MONGO_EXPORT_SERVER_PARAMETER(internalIndexBuildMaxSpillFiles, int, 64);
+
+    // Most threads sorting the keys of a key sorter before each spill.
+    MONGO_EXPORT_SERVER_PARAMETER(internalIndexBuildSortThreads, int, 4);
+
+    namespace {
+        SorterMemoryBudget indexBuildMemoryBudget(100 * 1024 * 1024);
+    }
+
     BtreeBasedBulkAccessMethod::BtreeBasedBulkAccessMethod(OperationContext* txn,
                                                            BtreeBasedAccessMethod* real,
                                                            SortedDataInterface* interface,
                                                            const IndexDescriptor* descriptor) {
         _real = real;
         _interface = interface;
+        _descriptor = descriptor;
         _txn = txn;
+        _reportedSpills = 0;
+
+        setInsertThreads(1);
+    }
 
-        _docsInserted = 0;
-        _keysInserted = 0;
-        _isMultiKey = false;
+    BtreeBasedBulkAccessMethod::BSONObjExternalSorter*
+    BtreeBasedBulkAccessMethod::_makeSorter() const {
+        indexBuildMemoryBudget.setTotalBytes(
+            std::max(maxIndexBuildMemoryUsageMegabytes, 1) * size_t(1024 * 1024));
 
-        _sorter.reset(BSONObjExternalSorter::make(
+        return BSONObjExternalSorter::make(
                     SortOptions().TempDir(storageGlobalParams.dbpath + "/_tmp")
                                  .ExtSortAllowed()
-                                 .MaxMemoryUsageBytes(100*1024*1024),
-                    BtreeExternalSortComparison(descriptor->keyPattern(), descriptor->version())));
+                                 .MemoryBudget(&indexBuildMemoryBudget)
+                                 .MaxSpillFiles(std::max(internalIndexBuildMaxSpillFiles, 0))
+                                 .SortThreads(std::max(internalIndexBuildSortThreads, 1))
+                                 .MemoryTracker(_txn->memoryTracker()),
+                    BtreeExternalSortComparison(_descriptor->keyPattern(),
+                                                _descriptor->version()));
+    }
+
+    bool BtreeBasedBulkAccessMethod::canInsertFromThreads() const {
+        // The key generators of these only read the document and their own settings.
+        const std::string& type = _descriptor->getAccessMethodName();
+        return type == IndexNames::BTREE || type == IndexNames::HASHED;
+    }
+
+    void BtreeBasedBulkAccessMethod::setInsertThreads(size_t numThreads) {
+        invariant(numThreads >= 1);
+        invariant(_threadKeys.empty() || _threadKeys[0]->docsInserted == 0);
+
+        _threadKeys.clear();
+        for (size_t i = 0; i < numThreads; i++) {
+            boost::shared_ptr<ThreadKeys> keys(new ThreadKeys());
+            keys->sorter.reset(_makeSorter());
+            _threadKeys.push_back(keys);
+        }
     }
 
     Status BtreeBasedBulkAccessMethod::insert(OperationContext* txn,
@@ -94,37 +137,111 @@ namespace mongo {
                                               const DiskLoc& loc,
                                               const InsertDeleteOptions& options,
                                               int64_t* numInserted) {
+        const unsigned long long keysBefore = _threadKeys[0]->keysInserted;
+        Status status = insertFromThread(0, obj, loc);
+
+        if (NULL != numInserted) {
+            *numInserted += _threadKeys[0]->keysInserted - keysBefore;
+        }
+
+        return status;
+    }
+
+    Status BtreeBasedBulkAccessMethod::insertFromThread(size_t thread,
+                                                        const BSONObj& obj,
+                                                        const DiskLoc& loc,
+                                                        const BSONFieldIndex* fieldIndex) {
+        ThreadKeys& threadKeys = *_threadKeys[thread];
+
         BSONObjSet keys;
-        _real->getKeys(obj, &keys);
+        if (_real->indexesDocument(obj)) {
+            _real->getKeys(obj, &keys, fieldIndex);
+        }
 
-        _isMultiKey = _isMultiKey || (keys.size() > 1);
+        if (keys.size() > 1) {
+            threadKeys.isMultiKey = true;
+            _real->getMultikeyPaths(obj, &threadKeys.multikeyPaths, fieldIndex);
+        }
 
         for (BSONObjSet::iterator it = keys.begin(); it != keys.end(); ++it) {
             // False is for mayInterrupt.
-            _sorter->add(*it, loc);
-            _keysInserted++;
+            threadKeys.sorter->add(*it, loc);
+            threadKeys.keysInserted++;
         }
 
-        _docsInserted++;
+        threadKeys.docsInserted++;
 
-        if (NULL != numInserted) {
-            *numInserted += keys.size();
+        const BSONObjExternalSorter& sorter = *threadKeys.sorter;
+        if (sorter.numSpills() != threadKeys.numSpills.loadRelaxed()) {
+            threadKeys.spilledBytes.store(sorter.spilledBytes());
+            threadKeys.numSpills.store(sorter.numSpills());
+        }
+
+        if (thread == 0) {
+            _reportSpills();
         }
 
         return Status::OK();
     }
 
+    void BtreeBasedBulkAccessMethod::_reportSpills() {
+        unsigned long long numSpills = 0;
+        unsigned long long spilledBytes = 0;
+        for (size_t i = 0; i < _threadKeys.size(); i++) {
+            numSpills += _threadKeys[i]->numSpills.load();
+            spilledBytes += _threadKeys[i]->spilledBytes.load();
+        }
+
+        if (numSpills == _reportedSpills)
+            return;
+
+        _reportedSpills = numSpills;
+        _txn->getCurOp()->setExternalSortStats(
+            BSON("index" << _descriptor->indexName()
+              << "spills" << static_cast<long long>(numSpills)
+              << "spilledBytes" << static_cast<long long>(spilledBytes)
+              << "memoryLimitBytes"
+              << static_cast<long long>(indexBuildMemoryBudget.shareBytes())));
+    }
+
     Status BtreeBasedBulkAccessMethod::commit(set<DiskLoc>* dupsToDrop,
                                               bool mayInterrupt,
                                               bool dupsAllowed) {
         Timer timer;
 
-        scoped_ptr<BSONObjExternalSorter::Iterator> i(_sorter->done());
+        unsigned long long keysInserted = 0;
+        bool isMultiKey = false;
+        std::set<std::string> multikeyPaths;
+        std::vector<boost::shared_ptr<BSONObjExternalSorter::Iterator> > sortedKeys;
+        for (size_t i = 0; i < _threadKeys.size(); i++) {
+            ThreadKeys& threadKeys = *_threadKeys[i];
+            keysInserted += threadKeys.keysInserted;
+            isMultiKey = isMultiKey || threadKeys.isMultiKey;
+            multikeyPaths.insert(threadKeys.multikeyPaths.begin(),
+                                 threadKeys.multikeyPaths.end());
+            sortedKeys.push_back(
+                boost::shared_ptr<BSONObjExternalSorter::Iterator>(threadKeys.sorter->done()));
+
+            // done() spills what was left in memory if anything was spilled before.
+            threadKeys.spilledBytes.store(threadKeys.sorter->spilledBytes());
+            threadKeys.numSpills.store(threadKeys.sorter->numSpills());
+        }
+        _reportSpills();
+
+        // The builder needs the keys of all the threads in one order.
+        boost::shared_ptr<BSONObjExternalSorter::Iterator> i = sortedKeys[0];
+        if (sortedKeys.size() > 1) {
+            i.reset(BSONObjExternalSorter::Iterator::merge(
+                        sortedKeys,
+                        SortOptions(),
+                        BtreeExternalSortComparison(_descriptor->keyPattern(),
+                                                    _descriptor->version())));
+        }
 
         // verifies that pm and op refer to the same ProgressMeter
         ProgressMeter& pm = _txn->getCurOp()->setMessage("Index Bulk Build: (2/3) btree bottom up",
                                                          "Index: (2/3) BTree Bottom Up Progress",
-                                                         _keysInserted,
+                                                         keysInserted,
                                                          10);
 
         scoped_ptr<SortedDataBuilderInterface> builder;
@@ -132,8 +249,8 @@ namespace mongo {
         {
             WriteUnitOfWork wunit(_txn);
 
-            if (_isMultiKey) {
-                _real->_btreeState->setMultikey( _txn );
+            if (isMultiKey) {
+                _real->_btreeState->setMultikey( _txn, multikeyPaths );
             }
 
             builder.reset(_interface->getBulkBuilder(_txn, dupsAllowed));
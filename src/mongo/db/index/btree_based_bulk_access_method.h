@@ -26,7 +26,9 @@
 *    it in the license file.
 */
 
+#include <boost/shared_ptr.hpp>
 #include <set>
+#include <string>
 #include <vector>
 
 #include "mongo/base/error_codes.h"
@@ -37,6 +39,7 @@
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/storage/sorted_data_interface.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
 
@@ -59,6 +62,34 @@ namespace mongo {
                               const InsertDeleteOptions& options,
                               int64_t* numInserted);
 
+        /**
+         * Whether insertFromThread() may be called for this index: true if its keys can be
+         * generated on several threads at once.
+         */
+        bool canInsertFromThreads() const;
+
+        /**
+         * Gives each of 'numThreads' threads its own sorter, so that they can all call
+         * insertFromThread() at once.  Must be called before inserting anything.  Each sorter
+         * gets an equal share of the memory budget of all the index builds running.
+         */
+        void setInsertThreads(size_t numThreads);
+
+        /**
+         * Like insert(), but only touches the state of thread number 'thread', which must be less
+         * than the number given to setInsertThreads().  Calls with different numbers may run
+         * concurrently.  If 'fieldIndex' is not NULL the top level fields of 'obj' are looked up
+         * through it, so that it can be shared with the other indexes being built; it must not be
+         * shared across threads.
+         */
+        Status insertFromThread(size_t thread,
+                                const BSONObj& obj,
+                                const DiskLoc& loc,
+                                const BSONFieldIndex* fieldIndex = NULL);
+
+        /**
+         * Adds the sorted keys to the index, merging those of each inserting thread.
+         */
         Status commit(std::set<DiskLoc>* dupsToDrop, bool mayInterrupt, bool dupsAllowed);
 
         // Exposed for testing.
@@ -134,27 +165,62 @@ namespace mongo {
     private:
         typedef Sorter<BSONObj, DiskLoc> BSONObjExternalSorter;
 
+        /**
+         * What one inserting thread has collected.
+         */
+        struct ThreadKeys {
+            ThreadKeys() : docsInserted(0), keysInserted(0), isMultiKey(false) {}
+
+            // The external sorter.
+            boost::scoped_ptr<BSONObjExternalSorter> sorter;
+
+            // How many docs are we indexing?
+            unsigned long long docsInserted;
+
+            // And how many keys?
+            unsigned long long keysInserted;
+
+            // Does any document have >1 key?
+            bool isMultiKey;
+
+            // The key fields along which those documents have arrays.
+            std::set<std::string> multikeyPaths;
+
+            // What the sorter has spilled so far, for the thread reporting to currentOp.
+            AtomicUInt64 numSpills;
+            AtomicUInt64 spilledBytes;
+        };
+
         Status _notAllowed() const {
             return Status(ErrorCodes::InternalError, "cannot use bulk for this yet");
         }
 
+        /**
+         * Returns an external sorter for the keys of this index, which counts against the memory
+         * budget of all index builds.  Caller owns it.
+         */
+        BSONObjExternalSorter* _makeSorter() const;
+
+        /**
+         * Shows how much the sorters of all the threads have spilled in currentOp.  Only called
+         * by thread 0, which runs on the thread of the operation.
+         */
+        void _reportSpills();
+
+        // The total of ThreadKeys::numSpills last shown in currentOp.
+        unsigned long long _reportedSpills;
+
         // Not owned here.
         BtreeBasedAccessMethod* _real;
 
         // Not owned here.
         SortedDataInterface* _interface;
 
-        // The external sorter.
-        boost::scoped_ptr<BSONObjExternalSorter> _sorter;
-
-        // How many docs are we indexing?
-        unsigned long long _docsInserted;
-
-        // And how many keys?
-        unsigned long long _keysInserted;
+        // Not owned here.
+        const IndexDescriptor* _descriptor;
 
-        // Does any document have >1 key?
-        bool _isMultiKey;
+        // One per inserting thread, in the same order.
+        std::vector<boost::shared_ptr<ThreadKeys> > _threadKeys;
 
         OperationContext* _txn;
     };
@@ -27,6 +27,9 @@
 */
 
 #include "mongo/db/index/btree_key_generator.h"
+
+#include <cstring>
+
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
@@ -50,11 +53,15 @@ namespace mongo {
         _nullElt = _nullObj.firstElement();
     }
 
-    void BtreeKeyGenerator::getKeys(const BSONObj &obj, BSONObjSet *keys) const {
-        // These are mutated as part of the getKeys call.  :|
-        vector<const char*> fieldNames(_fieldNames);
-        vector<BSONElement> fixed(_fixed);
-        getKeysImpl(fieldNames, fixed, obj, keys);
+    void BtreeKeyGenerator::getKeys(const BSONObj &obj,
+                                    BSONObjSet *keys,
+                                    const BSONFieldIndex* fieldIndex) const {
+        if (!getKeysFast(obj, keys, fieldIndex)) {
+            // These are mutated as part of the getKeys call.  :|
+            vector<const char*> fieldNames(_fieldNames);
+            vector<BSONElement> fixed(_fixed);
+            getKeysImpl(fieldNames, fixed, obj, keys, fieldIndex);
+        }
         if (keys->empty() && ! _isSparse) {
             keys->insert(_nullKey);
         }
@@ -71,7 +78,8 @@ namespace mongo {
             : BtreeKeyGenerator(fieldNames, fixed, isSparse) { }
         
     void BtreeKeyGeneratorV0::getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                          const BSONObj &obj, BSONObjSet *keys) const {
+                                          const BSONObj &obj, BSONObjSet *keys,
+                                          const BSONFieldIndex* fieldIndex) const {
         BSONElement arrElt;
         unsigned arrIdx = ~0;
         unsigned numNotFound = 0;
@@ -159,7 +167,7 @@ namespace mongo {
                 while( i.more() ) {
                     BSONElement e = i.next();
                     if ( e.type() == Object ) {
-                        getKeysImpl( fieldNames, fixed, e.embeddedObject(), keys );
+                        getKeysImpl( fieldNames, fixed, e.embeddedObject(), keys, NULL );
                     }
                 }
             }
@@ -189,19 +197,78 @@ namespace mongo {
 
     BtreeKeyGeneratorV1::BtreeKeyGeneratorV1(vector<const char*> fieldNames,
                                              vector<BSONElement> fixed, bool isSparse)
-        : BtreeKeyGenerator(fieldNames, fixed, isSparse) {
+        : BtreeKeyGenerator(fieldNames, fixed, isSparse),
+          _numSimpleFields(0) {
 
         BSONObjBuilder b;
         b.appendUndefined( "" );
         _undefinedObj = b.obj();
         _undefinedElt = _undefinedObj.firstElement();
+
+        // Patterns of one or two top level fields, with nothing fixed in advance, are the
+        // common case and are worth generating without the general recursion.
+        if ( fieldNames.size() > 2 ) {
+            return;
+        }
+        for ( size_t i = 0; i < fieldNames.size(); ++i ) {
+            if ( !fixed[ i ].eoo() || strchr( fieldNames[ i ], '.' ) ) {
+                return;
+            }
+        }
+        _numSimpleFields = fieldNames.size();
+    }
+
+    template <size_t NumFields>
+    bool BtreeKeyGeneratorV1::getSimpleKeys(const BSONObj &obj, BSONObjSet *keys,
+                                            const BSONFieldIndex* fieldIndex) const {
+        BSONElement elts[ NumFields ];
+        size_t numNotFound = 0;
+        // The size of the object around the elements, which each have an empty field name.
+        int keySize = sizeof( int ) + 1;
+        for ( size_t i = 0; i < NumFields; ++i ) {
+            elts[ i ] = fieldIndex ? fieldIndex->getField( obj, _fieldNames[ i ] )
+                                   : obj.getField( _fieldNames[ i ] );
+            if ( elts[ i ].eoo() ) {
+                elts[ i ] = _nullElt;
+                numNotFound++;
+            }
+            else if ( elts[ i ].type() == Array ) {
+                return false;
+            }
+            keySize += 2 + elts[ i ].valuesize();
+        }
+
+        if ( _isSparse && numNotFound == NumFields ) {
+            return true;
+        }
+
+        BSONObjBuilder b( keySize );
+        for ( size_t i = 0; i < NumFields; ++i ) {
+            b.appendAs( elts[ i ], "" );
+        }
+        keys->insert( b.obj() );
+        return true;
+    }
+
+    bool BtreeKeyGeneratorV1::getKeysFast(const BSONObj &obj, BSONObjSet *keys,
+                                          const BSONFieldIndex* fieldIndex) const {
+        switch ( _numSimpleFields ) {
+        case 1:
+            return getSimpleKeys<1>( obj, keys, fieldIndex );
+        case 2:
+            return getSimpleKeys<2>( obj, keys, fieldIndex );
+        default:
+            return false;
+        }
     }
 
     BSONElement BtreeKeyGeneratorV1::extractNextElement(const BSONObj &obj, const BSONObj &arr,
                                                         const char *&field,
-                                                        bool &arrayNestedArray) const {
+                                                        bool &arrayNestedArray,
+                                                        const BSONFieldIndex* fieldIndex) const {
         string firstField = mongoutils::str::before( field, '.' );
-        bool haveObjField = !obj.getField( firstField ).eoo();
+        bool haveObjField = fieldIndex ? !fieldIndex->getField( obj, firstField ).eoo()
+                                       : !obj.getField( firstField ).eoo();
         BSONElement arrField = arr.getField( firstField );
         bool haveArrField = !arrField.eoo();
 
@@ -216,7 +283,8 @@ namespace mongo {
 
         arrayNestedArray = false;
         if ( haveObjField ) {
-            return obj.getFieldDottedOrArray( field );
+            return fieldIndex ? fieldIndex->getFieldDottedOrArray( obj, field )
+                              : obj.getFieldDottedOrArray( field );
         }
         else if ( haveArrField ) {
             if ( arrField.type() == Array ) {
@@ -250,14 +318,16 @@ namespace mongo {
     }
 
     void BtreeKeyGeneratorV1::getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                          const BSONObj &obj, BSONObjSet *keys) const {
-        getKeysImplWithArray(fieldNames, fixed, obj, keys, 0, BSONObj());
+                                          const BSONObj &obj, BSONObjSet *keys,
+                                          const BSONFieldIndex* fieldIndex) const {
+        getKeysImplWithArray(fieldNames, fixed, obj, keys, 0, BSONObj(), fieldIndex);
     }
 
     void BtreeKeyGeneratorV1::getKeysImplWithArray(vector<const char*> fieldNames,
                                                    vector<BSONElement> fixed, const BSONObj &obj,
                                                    BSONObjSet *keys, unsigned numNotFound,
-                                                   const BSONObj &array) const {
+                                                   const BSONObj &array,
+                                                   const BSONFieldIndex* fieldIndex) const {
         BSONElement arrElt;
         set<unsigned> arrIdxs;
         bool mayExpandArrayUnembedded = true;
@@ -268,7 +338,8 @@ namespace mongo {
 
             bool arrayNestedArray;
             // Extract element matching fieldName[ i ] from object xor array.
-            BSONElement e = extractNextElement( obj, array, fieldNames[ i ], arrayNestedArray );
+            BSONElement e = extractNextElement( obj, array, fieldNames[ i ], arrayNestedArray,
+                                                fieldIndex );
 
             if ( e.eoo() ) {
                 // if field not present, set to null
@@ -302,6 +373,18 @@ namespace mongo {
             if ( _isSparse && numNotFound == fieldNames.size()) {
                 return;
             }            
+            BufBuilderArena* arena = BufBuilderArena::current();
+            if ( arena ) {
+                // Build the key in a recycled buffer and keep an exactly sized copy, rather
+                // than holding on to a buffer of the size tracker's (at least 512 byte) guess.
+                BSONObjBuilder b(arena);
+                for( vector< BSONElement >::iterator i = fixed.begin(); i != fixed.end(); ++i ) {
+                    b.appendAs( *i, "" );
+                }
+                keys->insert( b.done().getOwned() );
+                return;
+            }
+
             BSONObjBuilder b(_sizeTracker);
             for( vector< BSONElement >::iterator i = fixed.begin(); i != fixed.end(); ++i ) {
                 b.appendAs( *i, "" );
@@ -30,6 +30,7 @@
 
 #include <vector>
 #include <set>
+#include "mongo/bson/bson_field_index.h"
 #include "mongo/db/jsobj.h"
 
 namespace mongo {
@@ -43,7 +44,13 @@ namespace mongo {
         BtreeKeyGenerator(std::vector<const char*> fieldNames, std::vector<BSONElement> fixed, bool isSparse);
         virtual ~BtreeKeyGenerator() { }
 
-        void getKeys(const BSONObj &obj, BSONObjSet *keys) const;
+        /**
+         * @param fieldIndex if not NULL, finds the top level fields of 'obj'; see
+         *        BSONFieldIndex.
+         */
+        void getKeys(const BSONObj &obj,
+                     BSONObjSet *keys,
+                     const BSONFieldIndex* fieldIndex = NULL) const;
 
         static const int ParallelArraysCode;
 
@@ -58,7 +65,18 @@ namespace mongo {
     private:
         // We have V0 and V1.  Sigh.
         virtual void getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                 const BSONObj &obj, BSONObjSet *keys) const = 0;
+                                 const BSONObj &obj, BSONObjSet *keys,
+                                 const BSONFieldIndex* fieldIndex) const = 0;
+
+        /**
+         * Generates the keys of 'obj' without going through getKeysImpl, if the subclass can.
+         * @return false, having generated nothing, if obj needs getKeysImpl
+         */
+        virtual bool getKeysFast(const BSONObj &obj, BSONObjSet *keys,
+                                 const BSONFieldIndex* fieldIndex) const {
+            return false;
+        }
+
         vector<BSONElement> _fixed;
     };
 
@@ -70,7 +88,8 @@ namespace mongo {
 
     private:
         virtual void getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                 const BSONObj &obj, BSONObjSet *keys) const;
+                                 const BSONObj &obj, BSONObjSet *keys,
+                                 const BSONFieldIndex* fieldIndex) const;
     };
 
     class BtreeKeyGeneratorV1 : public BtreeKeyGenerator {
@@ -90,18 +109,33 @@ namespace mongo {
          *        If obj and array are both nonempty, obj will be one of the elements of array.
          */        
         virtual void getKeysImpl(vector<const char*> fieldNames, vector<BSONElement> fixed,
-                                 const BSONObj &obj, BSONObjSet *keys) const;
+                                 const BSONObj &obj, BSONObjSet *keys,
+                                 const BSONFieldIndex* fieldIndex) const;
+
+        virtual bool getKeysFast(const BSONObj &obj, BSONObjSet *keys,
+                                 const BSONFieldIndex* fieldIndex) const;
+
+        /**
+         * The key of a document with none of the NumFields top level fields of the pattern an
+         * array, built in a buffer of exactly its size.  @return false if one is an array.
+         */
+        template <size_t NumFields>
+        bool getSimpleKeys(const BSONObj &obj, BSONObjSet *keys,
+                           const BSONFieldIndex* fieldIndex) const;
 
         // These guys are called by getKeysImpl.
         void getKeysImplWithArray(vector<const char*> fieldNames, vector<BSONElement> fixed,
                                   const BSONObj &obj, BSONObjSet *keys, unsigned numNotFound,
-                                  const BSONObj &array) const;
+                                  const BSONObj &array,
+                                  const BSONFieldIndex* fieldIndex = NULL) const;
         /**
          * @param arrayNestedArray - set if the returned element is an array nested directly
                                      within arr.
+         * @param fieldIndex - if not NULL, finds the top level fields of obj.
          */
         BSONElement extractNextElement(const BSONObj &obj, const BSONObj &arr, const char *&field,
-                                       bool &arrayNestedArray ) const;
+                                       bool &arrayNestedArray,
+                                       const BSONFieldIndex* fieldIndex ) const;
         void _getKeysArrEltFixed(vector<const char*> &fieldNames, vector<BSONElement> &fixed,
                                  const BSONElement &arrEntry, BSONObjSet *keys,
                                  unsigned numNotFound, const BSONElement &arrObjElt,
@@ -109,6 +143,9 @@ namespace mongo {
 
         BSONObj _undefinedObj;
         BSONElement _undefinedElt;
+
+        // The number of fields of a pattern getSimpleKeys handles, 0 for any other pattern.
+        size_t _numSimpleFields;
     };
 
 }  // namespace mongo
@@ -30,6 +30,7 @@
 
 #include "mongo/db/json.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
 
 using namespace mongo;
 
@@ -586,4 +587,105 @@ namespace {
         ASSERT(testKeygen(keyPattern, genKeysFrom, expectedKeys));
     }
 
+
+    TEST(BtreeKeyGeneratorTest, GetKeysWithFieldIndex) {
+        BSONObj keyPattern = fromjson("{'a.b.c': 1, x: 1, 'y.z': 1}");
+        BSONObjBuilder b;
+        for (int i = 0; i < 200; i++) {
+            b.append(std::string(mongoutils::str::stream() << "pad" << i), i);
+        }
+        b.appendElements(fromjson("{a: [{b: {c: 1}}, {b: {c: 2}}], x: 3, y: {z: 4}}"));
+        BSONObj genKeysFrom = b.obj();
+
+        vector<const char*> fieldNames;
+        vector<BSONElement> fixed;
+        BSONObjIterator it(keyPattern);
+        while (it.more()) {
+            fieldNames.push_back(it.next().fieldName());
+            fixed.push_back(BSONElement());
+        }
+        BtreeKeyGeneratorV1 keyGen(fieldNames, fixed, false);
+
+        BSONFieldIndex fieldIndex;
+        ASSERT(fieldIndex.expectProbes(genKeysFrom, BSONFieldIndex::kMinProbes));
+
+        BSONObjSet expectedKeys;
+        expectedKeys.insert(fromjson("{'': 1, '': 3, '': 4}"));
+        expectedKeys.insert(fromjson("{'': 2, '': 3, '': 4}"));
+        BSONObjSet actualKeys;
+        keyGen.getKeys(genKeysFrom, &actualKeys, &fieldIndex);
+        ASSERT(keysetsMatch(expectedKeys, actualKeys));
+    }
+
+    TEST(BtreeKeyGeneratorTest, GetKeysWithSharedFieldIndex) {
+        BSONObjBuilder b;
+        for (int i = 0; i < 200; i++) {
+            b.append(std::string(mongoutils::str::stream() << "pad" << i), i);
+        }
+        b.appendElements(fromjson("{a: [1, 2], x: 3, y: {z: 4}}"));
+        BSONObj genKeysFrom = b.obj();
+
+        vector<const char*> aFields(1, "a");
+        vector<const char*> xyFields;
+        xyFields.push_back("x");
+        xyFields.push_back("y.z");
+        BtreeKeyGeneratorV1 aKeyGen(aFields, vector<BSONElement>(1), false);
+        BtreeKeyGeneratorV1 xyKeyGen(xyFields, vector<BSONElement>(2), false);
+
+        // Indexed up front for the three fields of both key patterns.
+        BSONFieldIndex fieldIndex;
+        ASSERT(fieldIndex.expectProbes(genKeysFrom, 3));
+
+        BSONObjSet aKeys;
+        aKeyGen.getKeys(genKeysFrom, &aKeys, &fieldIndex);
+        BSONObjSet expectedAKeys;
+        expectedAKeys.insert(fromjson("{'': 1}"));
+        expectedAKeys.insert(fromjson("{'': 2}"));
+        ASSERT(keysetsMatch(expectedAKeys, aKeys));
+
+        BSONObjSet xyKeys;
+        xyKeyGen.getKeys(genKeysFrom, &xyKeys, &fieldIndex);
+        BSONObjSet expectedXYKeys;
+        expectedXYKeys.insert(fromjson("{'': 3, '': 4}"));
+        ASSERT(keysetsMatch(expectedXYKeys, xyKeys));
+    }
+
+    // Patterns of one or two top level fields take a faster path for documents without arrays
+    // on them; these check it agrees with the general one.
+
+    TEST(BtreeKeyGeneratorTest, GetKeysSimpleCompoundMissingField) {
+        BSONObj keyPattern = fromjson("{a: 1, b: 1}");
+        BSONObj genKeysFrom = fromjson("{b: 'x', c: 3}");
+        BSONObjSet expectedKeys;
+        expectedKeys.insert(fromjson("{'': null, '': 'x'}"));
+        ASSERT(testKeygen(keyPattern, genKeysFrom, expectedKeys));
+    }
+
+    TEST(BtreeKeyGeneratorTest, GetKeysSimpleSparse) {
+        BSONObj keyPattern = fromjson("{a: 1, b: 1}");
+        BSONObjSet expectedKeys;
+        // true means sparse
+        ASSERT(testKeygen(keyPattern, fromjson("{c: 1}"), expectedKeys, true));
+
+        expectedKeys.insert(fromjson("{'': null, '': 2}"));
+        ASSERT(testKeygen(keyPattern, fromjson("{b: 2}"), expectedKeys, true));
+    }
+
+    TEST(BtreeKeyGeneratorTest, GetKeysSimpleSubobjectValue) {
+        BSONObj keyPattern = fromjson("{a: -1}");
+        BSONObj genKeysFrom = fromjson("{a: {b: [1, 2], c: 'foo'}}");
+        BSONObjSet expectedKeys;
+        expectedKeys.insert(fromjson("{'': {b: [1, 2], c: 'foo'}}"));
+        ASSERT(testKeygen(keyPattern, genKeysFrom, expectedKeys));
+    }
+
+    TEST(BtreeKeyGeneratorTest, GetKeysSimpleCompoundWithArray) {
+        BSONObj keyPattern = fromjson("{a: 1, b: 1}");
+        BSONObj genKeysFrom = fromjson("{a: 1, b: [2, 3]}");
+        BSONObjSet expectedKeys;
+        expectedKeys.insert(fromjson("{'': 1, '': 2}"));
+        expectedKeys.insert(fromjson("{'': 1, '': 3}"));
+        ASSERT(testKeygen(keyPattern, genKeysFrom, expectedKeys));
+    }
+
 } // namespace
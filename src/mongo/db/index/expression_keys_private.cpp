@@ -32,6 +32,7 @@
 
 #include <utility>
 
+#include "mongo/bson/bson_field_index.h"
 #include "mongo/db/fts/fts_index_format.h"
 #include "mongo/db/geo/geoconstants.h"
 #include "mongo/db/geo/geometry_container.h"
@@ -85,9 +86,61 @@ namespace {
     }
 
 
+    /**
+     * Gets the key for the most common geometry, a GeoJSON point without a "crs" field or a
+     * legacy coordinate pair, whose longitude and latitude are valid.  The covering of a
+     * point is the one cell on the finest indexed level holding it, so there is no need to
+     * build a GeometryContainer or a covering.
+     *
+     * Returns false, leaving 'out' alone, for anything else.
+     */
+    bool S2GetKeysForSimplePoint(const BSONElement& element,
+                                 const S2IndexingParams& params,
+                                 vector<string>* out) {
+        if (!element.isABSONObj()) {
+            return false;
+        }
+
+        BSONObj obj = element.Obj();
+        BSONElement coordinates;
+        if (Array == element.type() || obj.firstElement().isNumber()) {
+            // Like all legacy points in storage, may have more than two elements.
+            coordinates = element;
+        }
+        else {
+            BSONElement type = obj["type"];
+            if (String != type.type() || !str::equals(type.valuestr(), "Point")
+                || !obj["crs"].eoo()) {
+                return false;
+            }
+            coordinates = obj["coordinates"];
+            if (Array != coordinates.type() || coordinates.Obj().nFields() != 2) {
+                return false;
+            }
+        }
+
+        BSONObjIterator it(coordinates.Obj());
+        if (!it.more()) return false;
+        BSONElement lng = it.next();
+        if (!it.more()) return false;
+        BSONElement lat = it.next();
+        if (!lng.isNumber() || !lat.isNumber()) return false;
+        if (!isValidLngLat(lng.number(), lat.number())) return false;
+
+        // Matches the projection of a point into SPHERE.
+        S2LatLng latLng = S2LatLng::FromDegrees(lat.number(), lng.number()).Normalized();
+        S2CellId cell = S2CellId::FromPoint(latLng.ToPoint());
+        out->push_back(cell.parent(params.finestIndexedLevel).toString());
+        return true;
+    }
+
     Status S2GetKeysForElement(const BSONElement& element,
                             const S2IndexingParams& params,
                             vector<string>* out) {
+        if (S2GetKeysForSimplePoint(element, params, out)) {
+            return Status::OK();
+        }
+
         GeometryContainer geoContainer;
         Status status = geoContainer.parseFromStorage(element);
         if (!status.isOK()) return status;
@@ -327,10 +380,12 @@ namespace mongo {
                                             HashSeed seed,
                                             int hashVersion,
                                             bool isSparse,
-                                            BSONObjSet* keys) {
+                                            BSONObjSet* keys,
+                                            const BSONFieldIndex* fieldIndex) {
 
         const char* cstr = hashedField.c_str();
-        BSONElement fieldVal = obj.getFieldDottedOrArray(cstr);
+        BSONElement fieldVal = fieldIndex ? fieldIndex->getFieldDottedOrArray(obj, cstr)
+                                          : obj.getFieldDottedOrArray(cstr);
         uassert(16766, "Error: hashed indexes do not currently support array values",
                 fieldVal.type() != Array );
 
@@ -515,4 +570,17 @@ namespace mongo {
         *keys = keysToAdd;
     }
 
+    // static
+    bool ExpressionKeysPrivate::getS2PointKey(const BSONElement& element,
+                                              const S2IndexingParams& params,
+                                              string* key) {
+        vector<string> cells;
+        if (!S2GetKeysForSimplePoint(element, params, &cells)) {
+            return false;
+        }
+        invariant(1U == cells.size());
+        *key = cells.front();
+        return true;
+    }
+
 }  // namespace mongo
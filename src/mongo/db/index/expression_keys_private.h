@@ -36,6 +36,7 @@
 
 namespace mongo {
 
+    class BSONFieldIndex;
     struct TwoDIndexingParams;
     struct S2IndexingParams;
 
@@ -73,14 +74,16 @@ namespace mongo {
         //
 
         /**
-         * Generates keys for hash access method.
+         * Generates keys for hash access method.  If 'fieldIndex' is not NULL, the top level
+         * field of 'hashedField' is looked up through it.
          */
         static void getHashKeys(const BSONObj& obj,
                                 const std::string& hashedField,
                                 HashSeed seed,
                                 int hashVersion,
                                 bool isSparse,
-                                BSONObjSet* keys);
+                                BSONObjSet* keys,
+                                const BSONFieldIndex* fieldIndex = NULL);
 
         /**
          * Hashing function used by both getHashKeys and the cursors we create.
@@ -125,6 +128,16 @@ namespace mongo {
                               const BSONObj& keyPattern,
                               const S2IndexingParams& params,
                               BSONObjSet* keys);
+
+        /**
+         * Gets into 'key' the one S2 key of a GeoJSON point without a "crs" field or a legacy
+         * coordinate pair, the same key getS2Keys generates for it.  Returns false if 'element'
+         * is not such a point with a valid longitude and latitude.
+         * Used by geo shard keys.
+         */
+        static bool getS2PointKey(const BSONElement& element,
+                                  const S2IndexingParams& params,
+                                  std::string* key);
     };
 
 }  // namespace mongo
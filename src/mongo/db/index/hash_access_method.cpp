@@ -52,7 +52,14 @@ namespace mongo {
     }
 
     void HashAccessMethod::getKeys(const BSONObj& obj, BSONObjSet* keys) {
-        ExpressionKeysPrivate::getHashKeys(obj, _hashedField, _seed, _hashVersion, _descriptor->isSparse(), keys);
+        getKeys(obj, keys, NULL);
+    }
+
+    void HashAccessMethod::getKeys(const BSONObj& obj,
+                                   BSONObjSet* keys,
+                                   const BSONFieldIndex* fieldIndex) {
+        ExpressionKeysPrivate::getHashKeys(obj, _hashedField, _seed, _hashVersion,
+                                           _descriptor->isSparse(), keys, fieldIndex);
     }
 
 }  // namespace mongo
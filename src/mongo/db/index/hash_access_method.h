@@ -51,6 +51,10 @@ namespace mongo {
     private:
         virtual void getKeys(const BSONObj& obj, BSONObjSet* keys);
 
+        virtual void getKeys(const BSONObj& obj,
+                             BSONObjSet* keys,
+                             const BSONFieldIndex* fieldIndex);
+
         // Only one of our fields is hashed.  This is the field name for it.
         std::string _hashedField;
 
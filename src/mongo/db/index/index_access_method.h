@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "mongo/db/diskloc.h"
 #include "mongo/db/index/index_cursor.h"
 #include "mongo/db/index/index_descriptor.h"
@@ -82,6 +84,31 @@ namespace mongo {
                               const InsertDeleteOptions& options,
                               int64_t* numDeleted) = 0;
 
+        /**
+         * As remove(), for the documents 'objs' at the matching locations 'locs'. Access methods
+         * which can remove a batch of keys more cheaply than one document at a time override
+         * this. If not NULL, numDeleted will be set to the total number of keys removed.
+         */
+        virtual Status removeMany(OperationContext* txn,
+                                  const std::vector<BSONObj>& objs,
+                                  const std::vector<DiskLoc>& locs,
+                                  const InsertDeleteOptions& options,
+                                  int64_t* numDeleted) {
+            int64_t total = 0;
+            for (size_t i = 0; i < objs.size(); ++i) {
+                int64_t removed = 0;
+                Status status = remove(txn, objs[i], locs[i], options, &removed);
+                if (!status.isOK()) {
+                    return status;
+                }
+                total += removed;
+            }
+            if (numDeleted) {
+                *numDeleted = total;
+            }
+            return Status::OK();
+        }
+
         /**
          * Checks whether the index entries for the document 'from', which is placed at location
          * 'loc' on disk, can be changed to the index entries for the doc 'to'. Provides a ticket
@@ -161,6 +188,24 @@ namespace mongo {
          */
         virtual long long getSpaceUsedBytes( OperationContext* txn ) const = 0;
 
+        /**
+         * Count the keys between 'startKey' and 'endKey' without walking them, if the index can.
+         * If 'approximate' is true an estimate is acceptable.
+         *
+         * @return true if the count was stored in 'countOut', and false otherwise.
+         *
+         * @see SortedDataInterface::countKeysInRange
+         */
+        virtual bool countKeysInRange(OperationContext* txn,
+                                      const BSONObj& startKey,
+                                      bool startKeyInclusive,
+                                      const BSONObj& endKey,
+                                      bool endKeyInclusive,
+                                      bool approximate,
+                                      long long* countOut) const {
+            return false;
+        }
+
         //
         // Bulk operations support
         //
@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include <set>
 #include <string>
 
 #include "mongo/db/jsobj.h"
@@ -132,6 +133,12 @@ namespace mongo {
             return _collection->getIndexCatalog()->isMultikey( txn, this );
         }
 
+        // Along which key fields is this index multikey?  See IndexCatalogEntry.
+        std::set<std::string> getMultikeyPaths( OperationContext* txn ) const {
+            _checkOk();
+            return _collection->getIndexCatalog()->getMultikeyPaths( txn, this );
+        }
+
         bool isIdIndex() const { _checkOk(); return _isIdIndex; }
 
         //
@@ -0,0 +1,91 @@
+/**
+*    Copyright (C) 2014 MongoDB Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/index/index_side_writes.h"
+
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/recovery_unit.h"
+
+namespace mongo {
+
+    /**
+     * Adds a write to the IndexSideWrites when the unit of work it was made in commits.
+     */
+    class IndexSideWrites::AddOnCommit : public RecoveryUnit::Change {
+    public:
+        AddOnCommit(IndexSideWrites* sideWrites, const Write& write)
+            : _sideWrites(sideWrites), _write(write) {}
+
+        virtual void commit() {
+            SimpleMutex::scoped_lock lk(_sideWrites->_mutex);
+            _sideWrites->_writes.push_back(_write);
+        }
+
+        virtual void rollback() {}
+
+    private:
+        IndexSideWrites* const _sideWrites;
+        const Write _write;
+    };
+
+    IndexSideWrites::IndexSideWrites() : _mutex("IndexSideWrites") {}
+
+    void IndexSideWrites::recordInsert(OperationContext* txn,
+                                       const BSONObj& key,
+                                       const DiskLoc& loc) {
+        _record(txn, true, key, loc);
+    }
+
+    void IndexSideWrites::recordRemove(OperationContext* txn,
+                                       const BSONObj& key,
+                                       const DiskLoc& loc) {
+        _record(txn, false, key, loc);
+    }
+
+    void IndexSideWrites::_record(OperationContext* txn,
+                                  bool isInsert,
+                                  const BSONObj& key,
+                                  const DiskLoc& loc) {
+        txn->recoveryUnit()->registerChange(new AddOnCommit(this,
+                                                            Write(isInsert, key.getOwned(), loc)));
+    }
+
+    void IndexSideWrites::takeWrites(std::vector<Write>* out) {
+        invariant(out->empty());
+        SimpleMutex::scoped_lock lk(_mutex);
+        _writes.swap(*out);
+    }
+
+    size_t IndexSideWrites::size() const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _writes.size();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,92 @@
+/**
+*    Copyright (C) 2014 MongoDB Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    class OperationContext;
+
+    /**
+     * The changes made to the keys of an index while a background build loads it in bulk.
+     *
+     * Writers record each key they would have inserted or removed, and it is added here when
+     * their unit of work commits, so that rolled back writes are never seen.  The build applies
+     * them to the index, in the order they were committed, once the bulk load is done.
+     *
+     * Thread safe.
+     */
+    class IndexSideWrites {
+        MONGO_DISALLOW_COPYING(IndexSideWrites);
+    public:
+        struct Write {
+            Write(bool isInsert, const BSONObj& key, const DiskLoc& loc)
+                : isInsert(isInsert), key(key), loc(loc) {}
+
+            bool isInsert;
+            BSONObj key;
+            DiskLoc loc;
+        };
+
+        IndexSideWrites();
+
+        /**
+         * Records that 'key' -> 'loc' is added to the index, if 'txn' commits its unit of work.
+         */
+        void recordInsert(OperationContext* txn, const BSONObj& key, const DiskLoc& loc);
+
+        /**
+         * Records that 'key' -> 'loc' is removed from the index, if 'txn' commits its unit of
+         * work.
+         */
+        void recordRemove(OperationContext* txn, const BSONObj& key, const DiskLoc& loc);
+
+        /**
+         * Moves the writes committed so far, oldest first, to 'out', which must be empty.
+         */
+        void takeWrites(std::vector<Write>* out);
+
+        size_t size() const;
+
+    private:
+        class AddOnCommit;
+
+        void _record(OperationContext* txn, bool isInsert, const BSONObj& key, const DiskLoc& loc);
+
+        mutable SimpleMutex _mutex;
+        std::vector<Write> _writes;
+    };
+
+}  // namespace mongo
@@ -41,6 +41,8 @@
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/background.h"
+#include "mongo/db/catalog/capped_insert_notifier.h"
+#include "mongo/db/catalog/collection.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/commands/fsync.h"
@@ -63,6 +65,7 @@
 #include "mongo/db/mongod_options.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/catalog/index_create.h"
+#include "mongo/db/op_sampler.h"
 #include "mongo/db/ops/delete_executor.h"
 #include "mongo/db/ops/delete_request.h"
 #include "mongo/db/ops/insert.h"
@@ -217,8 +220,13 @@ namespace {
                 audit::logQueryAuthzCheck(client, ns, q.query, status.code());
                 uassertStatusOK(status);
             }
-            dbresponse.exhaustNS = newRunQuery(txn, m, q, op, *resp, fromDBDirectClient);
+            bool readAhead = false;
+            dbresponse.exhaustNS = newRunQuery(txn, m, q, op, *resp, fromDBDirectClient,
+                                               &readAhead);
             verify( !resp->empty() );
+            if (readAhead) {
+                dbresponse.readAheadNS = q.ns;
+            }
         }
         catch ( SendStaleConfigException& e ){
             ex.reset( new SendStaleConfigException( e.getns(), e.getInfo().msg, e.getVersionReceived(), e.getVersionWanted() ) );
@@ -386,6 +394,12 @@ namespace {
         OpDebug& debug = currentOp.debug();
         debug.op = op;
 
+        // The arena may serve several requests (e.g. through DBDirectClient), so only report
+        // what this one used.
+        BufBuilderArena* const builderArena = BufBuilderArena::current();
+        const BufBuilderArena::Stats builderArenaStart =
+            builderArena ? builderArena->stats() : BufBuilderArena::Stats();
+
         long long logThreshold = serverGlobalParams.slowMS;
         bool shouldLog = logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(1));
 
@@ -480,6 +494,25 @@ namespace {
         currentOp.done();
         debug.executionTime = currentOp.totalTimeMillis();
 
+        // Each client request has a locker of its own, so its totals are the request's waits.
+        // Direct client requests share the locker of the operation which makes them.
+        if (!fromDBDirectClient) {
+            Locker::LockerInfo lockerInfo;
+            txn->lockState()->getLockerInfo(&lockerInfo);
+            if (lockerInfo.waitMicros > 0) {
+                debug.lockWaitMicros = static_cast<long long>(lockerInfo.waitMicros);
+            }
+            if (lockerInfo.admissionWaitMicros > 0) {
+                debug.ticketWaitMicros = static_cast<long long>(lockerInfo.admissionWaitMicros);
+            }
+        }
+
+        if ( builderArena && builderArena->stats().allocations > builderArenaStart.allocations ) {
+            const BufBuilderArena::Stats& builderArenaEnd = builderArena->stats();
+            debug.builderAllocs = builderArenaEnd.allocations - builderArenaStart.allocations;
+            debug.builderAllocsReused = builderArenaEnd.reused - builderArenaStart.reused;
+        }
+
         logThreshold += currentOp.getExpectedLatencyMs();
 
         if ( shouldLog || debug.executionTime > logThreshold ) {
@@ -502,6 +535,8 @@ namespace {
             }
         }
 
+        sampleOp(txn, c, currentOp);
+
         debug.recordStats();
         debug.reset();
     } /* assembleResponse() */
@@ -581,7 +616,10 @@ namespace {
                     //  If DB doesn't exist, don't implicitly create it in Client::Context
                     break;
                 }
-                Lock::CollectionLock colLock(txn->lockState(), ns.ns(), MODE_IX);
+                Lock::CollectionLock colLock(txn->lockState(),
+                                             ns.ns(),
+                                             WriteConflictException::shouldEscalate(attempt - 1) ?
+                                                 MODE_X : MODE_IX);
                 Client::Context ctx(txn, ns);
 
                 //  The common case: no implicit collection creation
@@ -599,10 +637,7 @@ namespace {
                     log(LogComponent::kWrites) << "Had WriteConflict during multi update, aborting";
                     throw;
                 }
-                else if ( attempt++ > 1 ) {
-                    log(LogComponent::kWrites) << "Had WriteConflict doing update on " << ns
-                                               << ", attempt: " << attempt << " retrying";
-                }
+                WriteConflictException::logAndBackoff(txn, attempt++, "update", ns.ns());
             }
         }
 
@@ -667,7 +702,10 @@ namespace {
                 AutoGetDb autoDb(txn, ns.db(), MODE_IX);
                 if (!autoDb.getDb()) break;
 
-                Lock::CollectionLock colLock(txn->lockState(), ns.ns(), MODE_IX);
+                Lock::CollectionLock colLock(txn->lockState(),
+                                             ns.ns(),
+                                             WriteConflictException::shouldEscalate(attempt - 1) ?
+                                                 MODE_X : MODE_IX);
                 Client::Context ctx(txn, ns);
 
                 long long n = executor.execute(ctx.db());
@@ -677,16 +715,27 @@ namespace {
                 break;
             }
             catch ( const WriteConflictException& dle ) {
-                if ( attempt++ > 1 ) {
-                    log(LogComponent::kWrites) << "Had WriteConflict doing delete on " << ns
-                                               << ", attempt: " << attempt << " retrying";
-                }
+                WriteConflictException::logAndBackoff(txn, attempt++, "delete", ns.ns());
             }
         }
     }
 
     QueryResult::View emptyMoreResult(long long);
 
+    /**
+     * The notifier of inserts into 'nss' if it is a capped collection, otherwise NULL.
+     */
+    static boost::shared_ptr<CappedInsertNotifier> getCappedInsertNotifier(
+            OperationContext* txn,
+            const NamespaceString& nss) {
+        AutoGetCollectionForRead ctx(txn, nss);
+        Collection* collection = ctx.getCollection();
+        if (!collection) {
+            return boost::shared_ptr<CappedInsertNotifier>();
+        }
+        return collection->getCappedInsertNotifier();
+    }
+
     bool receivedGetMore(OperationContext* txn,
                          DbResponse& dbresponse,
                          Message& m,
@@ -710,6 +759,13 @@ namespace {
         bool exhaust = false;
         QueryResult::View msgdata = 0;
         OpTime last;
+        bool readAhead = false;
+
+        // Looked up once an AwaitData getMore found nothing, so that the following passes wait
+        // for an insert to commit instead of polling.
+        bool notifierLookedUp = false;
+        boost::shared_ptr<CappedInsertNotifier> notifier;
+        unsigned long long notifierVersion = 0;
         while( 1 ) {
             bool isCursorAuthorized = false;
             try {
@@ -729,11 +785,21 @@ namespace {
                     if (pass == 0) {
                         last = getLastSetOptime();
                     }
-                    else {
+                    else if (!notifier) {
                         repl::waitUpToOneSecondForOptimeChange(last);
                     }
                 }
 
+                if (pass > 0 && !notifierLookedUp) {
+                    notifierLookedUp = true;
+                    notifier = getCappedInsertNotifier(txn, nsString);
+                }
+                if (notifier) {
+                    // Read before looking for documents, so that no insert committed after the
+                    // look goes unnoticed.
+                    notifierVersion = notifier->getVersion();
+                }
+
                 msgdata = newGetMore(txn,
                                      ns,
                                      ntoreturn,
@@ -742,7 +808,8 @@ namespace {
                                      pass,
                                      exhaust,
                                      &isCursorAuthorized,
-                                     fromDBDirectClient);
+                                     fromDBDirectClient,
+                                     &readAhead);
             }
             catch ( AssertionException& e ) {
                 if ( isCursorAuthorized ) {
@@ -773,7 +840,19 @@ namespace {
                     }
                 }
                 pass++;
-                if (debug)
+                if (notifier && notifier->isDead()) {
+                    // The collection was dropped or reopened since it was looked up.
+                    notifier.reset();
+                    notifierLookedUp = false;
+                }
+
+                if (notifier) {
+                    // Wake up at least once a second to notice shutdown and kills.
+                    const int remainingMillis = 4000 - static_cast<int>(timer->millis());
+                    notifier->waitForInsert(notifierVersion,
+                                            std::max(1, std::min(1000, remainingMillis)));
+                }
+                else if (debug)
                     sleepmillis(20);
                 else
                     sleepmillis(2);
@@ -812,6 +891,9 @@ namespace {
             curop.debug().exhaust = true;
             dbresponse.exhaustNS = ns;
         }
+        else if (readAhead) {
+            dbresponse.readAheadNS = ns;
+        }
 
         return ok;
     }
@@ -29,6 +29,10 @@
 
 #include "mongo/db/json.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "mongo/base/parse_number.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/platform/cstdint.h"
@@ -58,8 +62,8 @@ namespace mongo {
         ID_RESERVE_SIZE = 64,
         PAT_RESERVE_SIZE = 4096,
         OPT_RESERVE_SIZE = 64,
-        FIELD_RESERVE_SIZE = 4096,
-        STRINGVAL_RESERVE_SIZE = 4096,
+        FIELD_RESERVE_SIZE = 64,
+        STRINGVAL_RESERVE_SIZE = 64,
         BINDATA_RESERVE_SIZE = 4096,
         BINDATATYPE_RESERVE_SIZE = 4096,
         NS_RESERVE_SIZE = 64,
@@ -80,6 +84,69 @@ namespace mongo {
                  *SINGLEQUOTE = "'",
                  *DOUBLEQUOTE = "\"";
 
+    namespace {
+
+        /**
+         * Returns the first character in [p, end) that is one of the 'n' characters of 'set',
+         * or 'end' if there is none. With SSE2 this looks at 16 characters at a time, which
+         * pays off on the long runs of ordinary text in string values and between the
+         * structural characters of a document.
+         */
+        inline const char* findFirstOf(const char* p, const char* end, const char* set, int n) {
+#if defined(__SSE2__)
+            while (end - p >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i hits = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(set[0]));
+                for (int i = 1; i < n; i++) {
+                    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(set[i])));
+                }
+                const int mask = _mm_movemask_epi8(hits);
+                if (mask)
+                    return p + __builtin_ctz(mask);
+                p += 16;
+            }
+#endif
+            for (; p < end; ++p) {
+                if (memchr(set, *p, n))
+                    return p;
+            }
+            return end;
+        }
+
+        /**
+         * Returns the end of the run of characters starting at 'p' that a quoted string ending
+         * in 'quote' can hold as they are: anything but the quote, a backslash or a control
+         * character.
+         */
+        inline const char* findStringSpecial(const char* p, const char* end, char quote) {
+#if defined(__SSE2__)
+            const __m128i quotes = _mm_set1_epi8(quote);
+            const __m128i backslashes = _mm_set1_epi8('\\');
+            const __m128i maxControl = _mm_set1_epi8(0x1F);
+            while (end - p >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                // Unsigned chunk <= 0x1F, so that bytes of multibyte UTF-8 don't match.
+                const __m128i control =
+                    _mm_cmpeq_epi8(_mm_max_epu8(chunk, maxControl), maxControl);
+                const __m128i hits = _mm_or_si128(control,
+                                                  _mm_or_si128(_mm_cmpeq_epi8(chunk, quotes),
+                                                               _mm_cmpeq_epi8(chunk, backslashes)));
+                const int mask = _mm_movemask_epi8(hits);
+                if (mask)
+                    return p + __builtin_ctz(mask);
+                p += 16;
+            }
+#endif
+            for (; p < end; ++p) {
+                const unsigned char c = *p;
+                if (c == quote || c == '\\' || c <= 0x1F)
+                    return p;
+            }
+            return end;
+        }
+
+    } // namespace
+
     JParse::JParse(const StringData& str)
         : _buf(str.rawData())
         , _input(_buf)
@@ -1081,8 +1148,20 @@ namespace mongo {
             return parseError("Unexpected end of input");
         }
         const char* q = _input;
+
+        // Inside quotes most characters are copied as they are; take those in bulk.
+        const bool quoted = allowedSet == NULL && terminalSet[0] != '\0' && terminalSet[1] == '\0';
+
         while (q < _input_end && !match(*q, terminalSet)) {
             MONGO_JSON_DEBUG("q: " << q);
+            if (quoted) {
+                const char* run = findStringSpecial(q, _input_end, terminalSet[0]);
+                if (run != q) {
+                    result->append(q, run - q);
+                    q = run;
+                    continue;
+                }
+            }
             if (allowedSet != NULL) {
                 if (!match(*q, allowedSet)) {
                     _input = q;
@@ -1282,6 +1361,153 @@ namespace mongo {
         return fromjson( str.c_str() );
     }
 
+    JsonDocumentStream::JsonDocumentStream()
+        : _begin(0)
+        , _scanned(0)
+        , _depth(0)
+        , _closing(0)
+        , _escaped(false)
+    {}
+
+    void JsonDocumentStream::append(const StringData& data) {
+        if (_begin > 0) {
+            _buffer.erase(0, _begin);
+            _scanned -= _begin;
+            _begin = 0;
+        }
+        _buffer.append(data.rawData(), data.size());
+    }
+
+    bool JsonDocumentStream::empty() const {
+        for (size_t i = _begin; i < _buffer.size(); i++) {
+            if (!isspace(static_cast<unsigned char>(_buffer[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool JsonDocumentStream::findDocumentEnd() {
+        static const char structural[] = "{}[]\"'/";
+        const char* const begin = _buffer.data();
+        const char* const end = begin + _buffer.size();
+        const char* p = begin + _scanned;
+
+        while (p < end) {
+            if (_escaped) {
+                _escaped = false;
+                ++p;
+                continue;
+            }
+
+            if (_closing) {
+                // Inside a string or regular expression only its end and escapes matter.
+                const char set[] = { _closing, '\\' };
+                p = findFirstOf(p, end, set, 2);
+                if (p == end) {
+                    break;
+                }
+                if (*p == '\\') {
+                    _escaped = true;
+                }
+                else {
+                    _closing = 0;
+                }
+                ++p;
+                continue;
+            }
+
+            p = findFirstOf(p, end, structural, sizeof(structural) - 1);
+            if (p == end) {
+                break;
+            }
+            switch (*p) {
+            case '{':
+            case '[':
+                _depth++;
+                break;
+            case '}':
+            case ']':
+                if (--_depth == 0) {
+                    _scanned = p + 1 - begin;
+                    return true;
+                }
+                break;
+            case '/': {
+                // A regular expression literal is a value, so it follows one of these.
+                const char* prev = p;
+                while (prev > begin && isspace(static_cast<unsigned char>(prev[-1]))) {
+                    --prev;
+                }
+                if (prev > begin && strchr(":,[", prev[-1])) {
+                    _closing = '/';
+                }
+                break;
+            }
+            default:
+                _closing = *p;
+                break;
+            }
+            ++p;
+        }
+
+        _scanned = p - begin;
+        return false;
+    }
+
+    bool JsonDocumentStream::next(BSONObj* obj) {
+        if (_scanned == _begin) {
+            while (_begin < _buffer.size() &&
+                   isspace(static_cast<unsigned char>(_buffer[_begin]))) {
+                ++_begin;
+            }
+            if (_begin == _buffer.size()) {
+                return false;
+            }
+            if (_buffer[_begin] != '{') {
+                throw MsgAssertionException(28605, str::stream()
+                                            << "Expecting '{' at the start of a JSON document,"
+                                            << " found '" << _buffer[_begin] << "'");
+            }
+            _scanned = _begin;
+        }
+
+        if (!findDocumentEnd()) {
+            return false;
+        }
+
+        // fromjson() wants the document to be null terminated.
+        const size_t docEnd = _scanned;
+        const char* doc;
+        char saved = 0;
+        if (docEnd == _buffer.size()) {
+            doc = _buffer.c_str() + _begin;
+        }
+        else {
+            saved = _buffer[docEnd];
+            _buffer[docEnd] = '\0';
+            doc = _buffer.data() + _begin;
+        }
+
+        _begin = docEnd;
+        _scanned = docEnd;
+        _depth = 0;
+
+        try {
+            *obj = fromjson(doc);
+        }
+        catch (...) {
+            if (docEnd < _buffer.size()) {
+                _buffer[docEnd] = saved;
+            }
+            throw;
+        }
+        if (docEnd < _buffer.size()) {
+            _buffer[docEnd] = saved;
+        }
+        return true;
+    }
+
     std::string tojson(const BSONObj& obj, JsonStringFormat format, bool pretty) {
         return obj.jsonString(format, pretty);
     }
@@ -96,6 +96,50 @@ namespace mongo {
         bool pretty = false
     );
 
+    /**
+     * Splits a stream of JSON documents, such as an export file, into BSONObjs as it arrives,
+     * without needing all of it in memory. Input is added in pieces of any size with
+     * append(); each call to next() then parses one complete document with fromjson().
+     * Documents are objects, separated by nothing or by whitespace.
+     *
+     * Document boundaries are found by a scan for the structural characters that open and
+     * close objects, arrays, strings and regular expressions, which skips the characters in
+     * between many at a time.  The scan resumes where it stopped when more input arrives.
+     */
+    class MONGO_CLIENT_API JsonDocumentStream {
+    public:
+        JsonDocumentStream();
+
+        /** Adds the next piece of the input. */
+        void append(const StringData& data);
+
+        /**
+         * Parses the next document into '*obj'. Returns false, leaving '*obj' alone, if no
+         * complete document has been appended yet.
+         *
+         * @throws MsgAssertionException if the document doesn't parse, as fromjson() does.
+         */
+        bool next(BSONObj* obj);
+
+        /** Returns true if nothing but whitespace is left over from the input so far. */
+        bool empty() const;
+
+    private:
+        /** Looks for the end of the document at the front of _buffer. */
+        bool findDocumentEnd();
+
+        // Input from _begin on has not been returned by next() yet. The part before _begin is
+        // dropped by the next call to append(), so that it is copied only once.
+        std::string _buffer;
+        size_t _begin;
+
+        // How far into _buffer findDocumentEnd() has got, and its state at that point.
+        size_t _scanned;
+        int _depth;
+        char _closing; // the quote or '/' that ends the string or regex we are in, or 0
+        bool _escaped;
+    };
+
     /**
      * Parser class.  A BSONObj is constructed incrementally by passing a
      * BSONObjBuilder to the recursive parsing methods.  The grammar for the
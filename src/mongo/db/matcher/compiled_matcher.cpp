@@ -0,0 +1,291 @@
+// compiled_matcher.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/matcher/compiled_matcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mongo/bson/bson_field_index.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/expression_leaf.h"
+#include "mongo/db/matcher/path_internal.h"
+#include "mongo/platform/float_utils.h"
+
+namespace mongo {
+
+    namespace {
+
+        bool isSupported( const MatchExpression* expr ) {
+            switch ( expr->matchType() ) {
+            case MatchExpression::WHERE:
+            case MatchExpression::GEO:
+            case MatchExpression::GEO_NEAR:
+            case MatchExpression::TEXT:
+            case MatchExpression::INTERNAL_2DSPHERE_KEY_IN_REGION:
+            case MatchExpression::INTERNAL_2D_KEY_IN_REGION:
+            case MatchExpression::INTERNAL_2D_POINT_IN_ANNULUS:
+                return false;
+            default:
+                break;
+            }
+
+            for ( size_t i = 0; i < expr->numChildren(); i++ ) {
+                if ( !isSupported( expr->getChild( i ) ) )
+                    return false;
+            }
+            return true;
+        }
+
+        enum { kLess = 1, kEqual = 2, kGreater = 4 };
+
+        int acceptMaskFor( MatchExpression::MatchType type ) {
+            switch ( type ) {
+            case MatchExpression::LT: return kLess;
+            case MatchExpression::LTE: return kLess | kEqual;
+            case MatchExpression::EQ: return kEqual;
+            case MatchExpression::GT: return kGreater;
+            case MatchExpression::GTE: return kGreater | kEqual;
+            default:
+                invariant( false );
+                return 0;
+            }
+        }
+
+        inline int outcome( int cmp ) {
+            return cmp < 0 ? kLess : ( cmp == 0 ? kEqual : kGreater );
+        }
+
+    } // namespace
+
+    CompiledMatcher* CompiledMatcher::compile( const MatchExpression* root ) {
+        if ( !isSupported( root ) )
+            return NULL;
+
+        std::auto_ptr<CompiledMatcher> compiled( new CompiledMatcher() );
+        compiled->_entry = compiled->_compile( root, kAccept, kReject );
+
+        // Children were compiled last to first, so that each instruction's successors already
+        // existed; reverse the program so that execution runs forward through it.
+        std::vector<Instruction>& program = compiled->_program;
+        const int last = static_cast<int>( program.size() ) - 1;
+        std::reverse( program.begin(), program.end() );
+        for ( size_t i = 0; i < program.size(); i++ ) {
+            if ( program[i].ifTrue >= 0 )
+                program[i].ifTrue = last - program[i].ifTrue;
+            if ( program[i].ifFalse >= 0 )
+                program[i].ifFalse = last - program[i].ifFalse;
+        }
+        if ( compiled->_entry >= 0 )
+            compiled->_entry = last - compiled->_entry;
+
+        return compiled.release();
+    }
+
+    int CompiledMatcher::_compile( const MatchExpression* expr, int ifTrue, int ifFalse ) {
+        const size_t numChildren = expr->numChildren();
+
+        switch ( expr->matchType() ) {
+        case MatchExpression::AND: {
+            int next = ifTrue;
+            for ( size_t i = numChildren; i > 0; i-- )
+                next = _compile( expr->getChild( i - 1 ), next, ifFalse );
+            return next;
+        }
+        case MatchExpression::OR: {
+            int next = ifFalse;
+            for ( size_t i = numChildren; i > 0; i-- )
+                next = _compile( expr->getChild( i - 1 ), ifTrue, next );
+            return next;
+        }
+        case MatchExpression::NOR: {
+            int next = ifTrue;
+            for ( size_t i = numChildren; i > 0; i-- )
+                next = _compile( expr->getChild( i - 1 ), ifFalse, next );
+            return next;
+        }
+        case MatchExpression::NOT:
+            return _compile( expr->getChild( 0 ), ifFalse, ifTrue );
+        case MatchExpression::ATOMIC:
+            return ifTrue;
+        case MatchExpression::ALWAYS_FALSE:
+            return ifFalse;
+        default:
+            break;
+        }
+
+        Instruction instruction;
+        instruction.op = kInterpret;
+        instruction.ifTrue = ifTrue;
+        instruction.ifFalse = ifFalse;
+        instruction.expr = expr;
+        instruction.path = NULL;
+        instruction.rhsNumber = 0;
+        instruction.acceptMask = 0;
+
+        switch ( expr->matchType() ) {
+        case MatchExpression::LT:
+        case MatchExpression::LTE:
+        case MatchExpression::EQ:
+        case MatchExpression::GT:
+        case MatchExpression::GTE: {
+            const ComparisonMatchExpression* cmp =
+                static_cast<const ComparisonMatchExpression*>( expr );
+            const BSONElement& rhs = cmp->getData();
+
+            instruction.op = kMatchSingleElement;
+            instruction.rhs = rhs;
+            instruction.acceptMask = acceptMaskFor( expr->matchType() );
+            switch ( rhs.type() ) {
+            case NumberDouble:
+            case NumberInt:
+            case NumberLong:
+                // NaN compares unlike other numbers; leave it to the expression.
+                if ( !isNaN( rhs.number() ) ) {
+                    instruction.op = kCompareNumber;
+                    instruction.rhsNumber = rhs.number();
+                }
+                break;
+            case String:
+            case Symbol:
+                instruction.op = kCompareString;
+                break;
+            case jstOID:
+                instruction.op = kCompareOID;
+                break;
+            default:
+                break;
+            }
+            break;
+        }
+        case MatchExpression::EXISTS:
+            instruction.op = kExists;
+            break;
+        case MatchExpression::REGEX:
+        case MatchExpression::MOD:
+        case MatchExpression::MATCH_IN:
+            instruction.op = kMatchSingleElement;
+            break;
+        default:
+            break;
+        }
+
+        if ( instruction.op != kInterpret ) {
+            instruction.path =
+                &static_cast<const LeafMatchExpression*>( expr )->elementPath().fieldRef();
+        }
+
+        _program.push_back( instruction );
+        return static_cast<int>( _program.size() ) - 1;
+    }
+
+    bool CompiledMatcher::matches( const BSONObj& obj,
+                                   const MatchableDocument* doc,
+                                   const BSONFieldIndex* fieldIndex ) const {
+        int pc = _entry;
+        while ( pc >= 0 ) {
+            const Instruction& instruction = _program[pc];
+            pc = _execute( instruction, obj, doc, fieldIndex ) ? instruction.ifTrue
+                                                               : instruction.ifFalse;
+        }
+        return pc == kAccept;
+    }
+
+    bool CompiledMatcher::_execute( const Instruction& instruction,
+                                    const BSONObj& obj,
+                                    const MatchableDocument* doc,
+                                    const BSONFieldIndex* fieldIndex ) const {
+        if ( instruction.op == kInterpret )
+            return instruction.expr->matches( doc, NULL );
+
+        // Without arrays on the way, LeafMatchExpression::matches() sees exactly this element,
+        // which is EOO if the path is missing.
+        size_t idxPath = 0;
+        const BSONElement e = getFieldDottedOrArray( obj, *instruction.path, &idxPath,
+                                                     fieldIndex );
+        if ( e.type() == Array )
+            return instruction.expr->matches( doc, NULL );
+
+        switch ( instruction.op ) {
+        case kExists:
+            return !e.eoo();
+
+        case kCompareNumber: {
+            int cmp;
+            if ( e.type() == NumberLong && instruction.rhs.type() == NumberLong ) {
+                // Longs compare exactly with each other, and as doubles with anything else.
+                cmp = compareElementValues( e, instruction.rhs );
+            }
+            else if ( e.isNumber() ) {
+                const double d = e.number();
+                if ( isNaN( d ) )
+                    return false;
+                cmp = d < instruction.rhsNumber ? -1 : ( d == instruction.rhsNumber ? 0 : 1 );
+            }
+            else {
+                return false;
+            }
+            return ( outcome( cmp ) & instruction.acceptMask ) != 0;
+        }
+
+        case kCompareString: {
+            if ( e.type() != String && e.type() != Symbol )
+                return false;
+            const int lsz = e.valuestrsize();
+            const int rsz = instruction.rhs.valuestrsize();
+            int cmp = memcmp( e.valuestr(), instruction.rhs.valuestr(), std::min( lsz, rsz ) );
+            if ( cmp == 0 )
+                cmp = lsz - rsz;
+            return ( outcome( cmp ) & instruction.acceptMask ) != 0;
+        }
+
+        case kCompareOID: {
+            if ( e.type() != jstOID )
+                return false;
+            const int cmp = memcmp( e.value(), instruction.rhs.value(), OID::kOIDSize );
+            return ( outcome( cmp ) & instruction.acceptMask ) != 0;
+        }
+
+        case kMatchSingleElement:
+            return static_cast<const LeafMatchExpression*>( instruction.expr )
+                ->matchesSingleElement( e );
+
+        case kInterpret:
+            break;
+        }
+
+        invariant( false );
+        return false;
+    }
+
+} // namespace mongo
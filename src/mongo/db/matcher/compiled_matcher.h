@@ -0,0 +1,124 @@
+// compiled_matcher.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/bson/bsonelement.h"
+
+namespace mongo {
+
+    class BSONFieldIndex;
+    class BSONObj;
+    class FieldRef;
+    class MatchableDocument;
+    class MatchExpression;
+
+    /**
+     * A MatchExpression tree lowered into a flat program, for stages which test many documents
+     * against one filter.
+     *
+     * $and, $or, $nor and $not become jumps between instructions, so evaluating the tree is a
+     * loop over an array rather than a walk of virtual matches() calls.  Each leaf instruction
+     * resolves its pre-split path directly in the document, without allocating an
+     * ElementIterator, and comparisons against a number, string or ObjectId are done inline.
+     * Whenever a path runs into an array, that one leaf is handed to MatchExpression::matches()
+     * so that array semantics stay in one place; operators the program doesn't know about,
+     * such as $elemMatch, $size and $type, are always handed over.
+     *
+     * The program points into the expression it was compiled from, which must outlive it.
+     */
+    class CompiledMatcher {
+        MONGO_DISALLOW_COPYING(CompiledMatcher);
+    public:
+        /**
+         * Returns a program equivalent to 'root', or NULL if 'root' contains $where, geo or
+         * text expressions, which are left to the interpreter.  The caller owns the result.
+         */
+        static CompiledMatcher* compile( const MatchExpression* root );
+
+        /**
+         * Returns the same as root->matches( doc, NULL ), where 'obj' is the document 'doc'
+         * wraps.  'fieldIndex', if not NULL, must be an index of 'obj'.
+         */
+        bool matches( const BSONObj& obj,
+                      const MatchableDocument* doc,
+                      const BSONFieldIndex* fieldIndex = NULL ) const;
+
+        size_t numInstructions() const { return _program.size(); }
+
+    private:
+        enum Op {
+            // root->matches() on the instruction's expression.
+            kInterpret,
+
+            // The rest resolve the instruction's path first, and interpret if it hits an array.
+            kExists,
+            kCompareNumber,
+            kCompareString,
+            kCompareOID,
+            kMatchSingleElement
+        };
+
+        // Jump targets which end the program.
+        enum { kAccept = -1, kReject = -2 };
+
+        struct Instruction {
+            Op op;
+            int ifTrue;
+            int ifFalse;
+
+            const MatchExpression* expr;
+            const FieldRef* path;
+
+            // For the compare ops: the operand, and which of "less", "equal" and "greater"
+            // are true, as bits 0, 1 and 2.
+            BSONElement rhs;
+            double rhsNumber;
+            int acceptMask;
+        };
+
+        CompiledMatcher() : _entry( kAccept ) { }
+
+        /** Appends the code for 'expr' and returns the index it starts at. */
+        int _compile( const MatchExpression* expr, int ifTrue, int ifFalse );
+
+        bool _execute( const Instruction& instruction,
+                       const BSONObj& obj,
+                       const MatchableDocument* doc,
+                       const BSONFieldIndex* fieldIndex ) const;
+
+        std::vector<Instruction> _program;
+        int _entry;
+    };
+
+} // namespace mongo
@@ -0,0 +1,218 @@
+// compiled_matcher_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/db/matcher/compiled_matcher.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/bson/bson_field_index.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/matcher/matchable.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace {
+
+        MatchExpression* parse( const BSONObj& query ) {
+            StatusWithMatchExpression result =
+                MatchExpressionParser::parse( query, WhereCallbackNoop() );
+            ASSERT_OK( result.getStatus() );
+            return result.getValue();
+        }
+
+        /**
+         * Checks that the compiled form of 'query' agrees with the interpreter on each of
+         * 'docs', and returns how many of them match.
+         */
+        int countMatches( const char* query, const std::vector<BSONObj>& docs ) {
+            // The expression refers into 'queryObj'.
+            const BSONObj queryObj = fromjson( query );
+            boost::scoped_ptr<MatchExpression> expr( parse( queryObj ) );
+            boost::scoped_ptr<CompiledMatcher> compiled( CompiledMatcher::compile( expr.get() ) );
+            ASSERT( compiled );
+
+            int count = 0;
+            for ( size_t i = 0; i < docs.size(); i++ ) {
+                BSONMatchableDocument doc( docs[i] );
+                const bool expected = expr->matches( &doc, NULL );
+                ASSERT_EQUALS( expected, compiled->matches( docs[i], &doc ) )
+                    << "query: " << query << " doc: " << docs[i].toString();
+
+                BSONFieldIndex fieldIndex;
+                for ( int probe = 0; probe < BSONFieldIndex::kMinProbes; probe++ ) {
+                    ASSERT_EQUALS( expected, compiled->matches( docs[i], &doc, &fieldIndex ) );
+                }
+
+                if ( expected )
+                    count++;
+            }
+            return count;
+        }
+
+        std::vector<BSONObj> sampleDocs() {
+            const char* docs[] = {
+                "{}",
+                "{a: 1}",
+                "{a: 1.0, b: 'x'}",
+                "{a: NumberLong(1), b: 'xy'}",
+                "{a: 2, b: 'y'}",
+                "{a: -0.0}",
+                "{a: NaN}",
+                "{a: null}",
+                "{a: undefined}",
+                "{a: 'a'}",
+                "{a: 'ab'}",
+                "{a: 'a\\u0000b'}",
+                "{a: ObjectId('000000000000000000000001')}",
+                "{a: ObjectId('000000000000000000000002')}",
+                "{a: true}",
+                "{a: {$minKey: 1}}",
+                "{a: {$maxKey: 1}}",
+                "{a: [1, 2]}",
+                "{a: []}",
+                "{a: [[1]]}",
+                "{a: {b: 1}}",
+                "{a: {b: [1, 3]}}",
+                "{a: [{b: 1}, {b: 4}]}",
+                "{a: {b: {c: 'x'}}}",
+                "{a: 5, b: {c: 5}}",
+                "{a: 5, a: 6}",
+                "{a: {'0': 1}}",
+                "{a: NumberLong(9007199254740993)}",
+                "{a: NumberLong(9007199254740992)}",
+                "{a: 9007199254740992.0}",
+                "{b: 'x', c: {$date: 1000}}",
+            };
+
+            std::vector<BSONObj> result;
+            for ( size_t i = 0; i < sizeof( docs ) / sizeof( docs[0] ); i++ )
+                result.push_back( fromjson( docs[i] ) );
+
+            // A document wide enough for BSONFieldIndex to index.
+            BSONObjBuilder wide;
+            for ( int i = 0; i < 200; i++ )
+                wide.append( std::string( str::stream() << "f" << i ), i );
+            wide.append( "a", 2 );
+            wide.append( "b", "y" );
+            result.push_back( wide.obj() );
+
+            return result;
+        }
+
+    } // namespace
+
+    TEST( CompiledMatcher, Comparisons ) {
+        std::vector<BSONObj> docs = sampleDocs();
+        ASSERT_EQUALS( 4, countMatches( "{a: 1}", docs ) );
+        countMatches( "{a: {$lt: 2}}", docs );
+        countMatches( "{a: {$lte: 2}}", docs );
+        countMatches( "{a: {$gt: 1}}", docs );
+        countMatches( "{a: {$gte: 1.5}}", docs );
+        countMatches( "{a: {$gte: 0}}", docs );
+        countMatches( "{a: {$lt: NaN}}", docs );
+        countMatches( "{a: NaN}", docs );
+        countMatches( "{a: NumberLong(9007199254740993)}", docs );
+        countMatches( "{a: NumberLong(9007199254740992)}", docs );
+        countMatches( "{a: 9007199254740992.0}", docs );
+        countMatches( "{a: 'a'}", docs );
+        countMatches( "{a: {$gt: 'a'}}", docs );
+        countMatches( "{a: {$lte: 'a\\u0000'}}", docs );
+        countMatches( "{a: ObjectId('000000000000000000000001')}", docs );
+        countMatches( "{a: {$gt: ObjectId('000000000000000000000001')}}", docs );
+        countMatches( "{a: null}", docs );
+        countMatches( "{a: {$gte: null}}", docs );
+        countMatches( "{a: {$gt: {$minKey: 1}}}", docs );
+        countMatches( "{a: {$lt: {$maxKey: 1}}}", docs );
+        countMatches( "{a: true}", docs );
+        countMatches( "{a: [1, 2]}", docs );
+        countMatches( "{a: {b: 1}}", docs );
+        countMatches( "{'a.b': 1}", docs );
+        countMatches( "{'a.b': {$gt: 2}}", docs );
+        countMatches( "{'a.b.c': 'x'}", docs );
+        countMatches( "{'a.0': 1}", docs );
+        countMatches( "{'b.c': 5}", docs );
+        countMatches( "{c: {$lt: {$date: 2000}}}", docs );
+    }
+
+    TEST( CompiledMatcher, OtherLeaves ) {
+        std::vector<BSONObj> docs = sampleDocs();
+        countMatches( "{a: {$exists: true}}", docs );
+        countMatches( "{a: {$exists: false}}", docs );
+        countMatches( "{'a.b': {$exists: true}}", docs );
+        countMatches( "{a: {$in: [1, 'a', null]}}", docs );
+        countMatches( "{a: {$nin: [1, 'a']}}", docs );
+        countMatches( "{a: {$in: [/^a/]}}", docs );
+        countMatches( "{a: /b$/}", docs );
+        countMatches( "{a: {$mod: [2, 0]}}", docs );
+        countMatches( "{a: {$type: 4}}", docs );
+        countMatches( "{a: {$size: 2}}", docs );
+        countMatches( "{a: {$all: [1, 2]}}", docs );
+        countMatches( "{a: {$elemMatch: {b: {$gt: 2}}}}", docs );
+        countMatches( "{a: {$elemMatch: {$gt: 1}}}", docs );
+        countMatches( "{a: {$ne: 1}}", docs );
+        countMatches( "{a: {$not: {$gt: 1}}}", docs );
+    }
+
+    TEST( CompiledMatcher, Trees ) {
+        std::vector<BSONObj> docs = sampleDocs();
+        countMatches( "{}", docs );
+        countMatches( "{a: {$gt: 0, $lt: 2}}", docs );
+        countMatches( "{a: 1, b: 'x'}", docs );
+        countMatches( "{$or: [{a: 2}, {b: 'x'}]}", docs );
+        countMatches( "{$or: [{a: 2}, {b: 'x'}, {$and: [{a: 1}, {b: 'xy'}]}]}", docs );
+        countMatches( "{$nor: [{a: 2}, {b: 'x'}]}", docs );
+        countMatches( "{$and: [{$or: [{a: 1}, {a: 2}]}, {$nor: [{b: 'y'}]}]}", docs );
+        countMatches( "{$or: [{a: {$size: 2}}, {'a.b': 4}], b: {$exists: false}}", docs );
+        countMatches( "{$atomic: 1, a: 1}", docs );
+        countMatches( "{$or: [{$and: [{a: 1}, {a: {$ne: 1}}]}, {a: 'ab'}]}", docs );
+    }
+
+    TEST( CompiledMatcher, LeavesInterpreterForWhere ) {
+        const BSONObj query = fromjson( "{a: 1, $where: 'true'}" );
+        boost::scoped_ptr<MatchExpression> expr( parse( query ) );
+        ASSERT( NULL == CompiledMatcher::compile( expr.get() ) );
+    }
+
+    TEST( CompiledMatcher, FlattensTrees ) {
+        const BSONObj query =
+            fromjson( "{$or: [{a: 1, b: 2}, {c: {$not: {$gt: 3}}}], d: {$size: 1}}" );
+        boost::scoped_ptr<MatchExpression> expr( parse( query ) );
+        boost::scoped_ptr<CompiledMatcher> compiled( CompiledMatcher::compile( expr.get() ) );
+        ASSERT( compiled );
+
+        // Only the four leaves take an instruction.
+        ASSERT_EQUALS( 4U, compiled->numInstructions() );
+    }
+
+} // namespace mongo
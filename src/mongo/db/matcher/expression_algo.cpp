@@ -0,0 +1,210 @@
+// expression_algo.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/matcher/expression_algo.h"
+
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/expression_leaf.h"
+
+namespace mongo {
+namespace expression {
+
+    namespace {
+
+        bool isComparison(const MatchExpression* e) {
+            switch (e->matchType()) {
+            case MatchExpression::EQ:
+            case MatchExpression::LT:
+            case MatchExpression::LTE:
+            case MatchExpression::GT:
+            case MatchExpression::GTE:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool isNullish(const BSONElement& e) {
+            return e.type() == jstNULL || e.type() == Undefined;
+        }
+
+        /**
+         * Is every value which compares as 'lhsType' to 'lhsValue' also in the range of 'rhs'?
+         * Comparisons only match values of the same canonical type, so the bounds need that too.
+         */
+        bool comparisonImplies(MatchExpression::MatchType lhsType,
+                               const BSONElement& lhsValue,
+                               const ComparisonMatchExpression* rhs) {
+
+            const BSONElement& rhsValue = rhs->getData();
+            if (lhsValue.type() == Array || rhsValue.type() == Array) {
+                // Array equality also matches arrays containing the value, keep to identity.
+                return lhsType == MatchExpression::EQ
+                    && rhs->matchType() == MatchExpression::EQ
+                    && lhsValue.woCompare(rhsValue, false) == 0;
+            }
+            if (lhsValue.canonicalType() != rhsValue.canonicalType()) {
+                return false;
+            }
+
+            const int cmp = compareElementValues(lhsValue, rhsValue);
+            switch (rhs->matchType()) {
+            case MatchExpression::EQ:
+                return lhsType == MatchExpression::EQ && cmp == 0;
+            case MatchExpression::LT:
+                return (lhsType == MatchExpression::LT && cmp <= 0)
+                    || ((lhsType == MatchExpression::LTE || lhsType == MatchExpression::EQ)
+                        && cmp < 0);
+            case MatchExpression::LTE:
+                return (lhsType == MatchExpression::LT || lhsType == MatchExpression::LTE
+                        || lhsType == MatchExpression::EQ) && cmp <= 0;
+            case MatchExpression::GT:
+                return (lhsType == MatchExpression::GT && cmp >= 0)
+                    || ((lhsType == MatchExpression::GTE || lhsType == MatchExpression::EQ)
+                        && cmp > 0);
+            case MatchExpression::GTE:
+                return (lhsType == MatchExpression::GT || lhsType == MatchExpression::GTE
+                        || lhsType == MatchExpression::EQ) && cmp >= 0;
+            default:
+                return false;
+            }
+        }
+
+        /** Can 'lhs', a predicate on the same path as an $exists, only match present fields? */
+        bool impliesExists(const MatchExpression* lhs) {
+            if (isComparison(lhs)) {
+                return !isNullish(static_cast<const ComparisonMatchExpression*>(lhs)->getData());
+            }
+            switch (lhs->matchType()) {
+            case MatchExpression::MATCH_IN: {
+                const InMatchExpression* in = static_cast<const InMatchExpression*>(lhs);
+                return in->getData().size() > 0 && !in->getData().hasNull();
+            }
+            case MatchExpression::EXISTS:
+            case MatchExpression::TYPE_OPERATOR:
+            case MatchExpression::REGEX:
+            case MatchExpression::MOD:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool leafIsSubsetOf(const MatchExpression* lhs, const MatchExpression* rhs) {
+            if (lhs->path() != rhs->path()) {
+                return false;
+            }
+
+            if (rhs->matchType() == MatchExpression::EXISTS) {
+                return impliesExists(lhs);
+            }
+
+            if (isComparison(rhs)) {
+                const ComparisonMatchExpression* range =
+                    static_cast<const ComparisonMatchExpression*>(rhs);
+                if (isComparison(lhs)) {
+                    return comparisonImplies(lhs->matchType(),
+                                             static_cast<const ComparisonMatchExpression*>(
+                                                 lhs)->getData(),
+                                             range);
+                }
+                if (lhs->matchType() == MatchExpression::MATCH_IN) {
+                    const ArrayFilterEntries& entries =
+                        static_cast<const InMatchExpression*>(lhs)->getData();
+                    if (entries.numRegexes() > 0 || entries.size() == 0) {
+                        return false;
+                    }
+                    for (BSONElementSet::const_iterator it = entries.equalities().begin();
+                         it != entries.equalities().end(); ++it) {
+                        if (!comparisonImplies(MatchExpression::EQ, *it, range)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+                return false;
+            }
+
+            return lhs->equivalent(rhs);
+        }
+
+    } // namespace
+
+    bool isSubsetOf(const MatchExpression* lhs, const MatchExpression* rhs) {
+        if (lhs->equivalent(rhs)) {
+            return true;
+        }
+
+        if (rhs->matchType() == MatchExpression::AND) {
+            for (size_t i = 0; i < rhs->numChildren(); i++) {
+                if (!isSubsetOf(lhs, rhs->getChild(i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        if (lhs->matchType() == MatchExpression::AND) {
+            for (size_t i = 0; i < lhs->numChildren(); i++) {
+                if (isSubsetOf(lhs->getChild(i), rhs)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        if (lhs->matchType() == MatchExpression::OR) {
+            for (size_t i = 0; i < lhs->numChildren(); i++) {
+                if (!isSubsetOf(lhs->getChild(i), rhs)) {
+                    return false;
+                }
+            }
+            return lhs->numChildren() > 0;
+        }
+
+        if (rhs->matchType() == MatchExpression::OR) {
+            for (size_t i = 0; i < rhs->numChildren(); i++) {
+                if (isSubsetOf(lhs, rhs->getChild(i))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        if (lhs->isLeaf() && rhs->isLeaf()) {
+            return leafIsSubsetOf(lhs, rhs);
+        }
+
+        return false;
+    }
+
+} // namespace expression
+} // namespace mongo
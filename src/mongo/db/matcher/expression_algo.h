@@ -0,0 +1,53 @@
+// expression_algo.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+namespace mongo {
+
+    class MatchExpression;
+
+    namespace expression {
+
+        /**
+         * Returns true if every document 'lhs' matches is also matched by 'rhs', as far as a
+         * cheap look at the two trees can tell; false means "not known to be".
+         *
+         * This is what decides whether a partial index, which only holds the documents
+         * matching its filter, can answer a query: the query has to be a subset of the filter.
+         * Conjunctions, disjunctions of the query and equality, range, $exists and $type
+         * predicates are understood, e.g.
+         *   { a: 5, b: 1 }          is a subset of  { a: { $gt: 3 } }
+         *   { a: { $in: [4, 5] } }  is a subset of  { a: { $exists: true } }
+         *   { a: { $gt: 1 } }       is not known to be a subset of  { a: { $gt: 3 } }
+         */
+        bool isSubsetOf(const MatchExpression* lhs, const MatchExpression* rhs);
+
+    } // namespace expression
+} // namespace mongo
@@ -0,0 +1,118 @@
+// expression_algo_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+/** Unit tests for MatchExpression algorithms */
+
+#include "mongo/unittest/unittest.h"
+
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/json.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/expression_algo.h"
+#include "mongo/db/matcher/expression_parser.h"
+
+namespace mongo {
+namespace {
+
+    /** Parses the query and the filter and keeps them alive for isSubsetOf() */
+    class Subset {
+    public:
+        Subset(const char* lhs, const char* rhs)
+            : _lhsObj(fromjson(lhs)), _rhsObj(fromjson(rhs)) {
+            StatusWithMatchExpression l = MatchExpressionParser::parse(_lhsObj);
+            StatusWithMatchExpression r = MatchExpressionParser::parse(_rhsObj);
+            ASSERT_OK(l.getStatus());
+            ASSERT_OK(r.getStatus());
+            _lhs.reset(l.getValue());
+            _rhs.reset(r.getValue());
+        }
+
+        bool holds() const { return expression::isSubsetOf(_lhs.get(), _rhs.get()); }
+
+    private:
+        BSONObj _lhsObj;
+        BSONObj _rhsObj;
+        boost::scoped_ptr<MatchExpression> _lhs;
+        boost::scoped_ptr<MatchExpression> _rhs;
+    };
+
+    bool isSubset(const char* lhs, const char* rhs) {
+        return Subset(lhs, rhs).holds();
+    }
+
+    TEST(ExpressionAlgoIsSubsetOf, Equality) {
+        ASSERT_TRUE(isSubset("{a: 5}", "{a: 5}"));
+        ASSERT_TRUE(isSubset("{a: 'pending'}", "{a: 'pending'}"));
+        ASSERT_FALSE(isSubset("{a: 'done'}", "{a: 'pending'}"));
+        ASSERT_FALSE(isSubset("{b: 5}", "{a: 5}"));
+        ASSERT_FALSE(isSubset("{a: {$gt: 4}}", "{a: 5}"));
+    }
+
+    TEST(ExpressionAlgoIsSubsetOf, Ranges) {
+        ASSERT_TRUE(isSubset("{a: 5}", "{a: {$gt: 3}}"));
+        ASSERT_TRUE(isSubset("{a: {$gt: 3}}", "{a: {$gt: 3}}"));
+        ASSERT_TRUE(isSubset("{a: {$gte: 4}}", "{a: {$gt: 3}}"));
+        ASSERT_TRUE(isSubset("{a: {$lt: 3}}", "{a: {$lte: 3}}"));
+        ASSERT_FALSE(isSubset("{a: {$gte: 3}}", "{a: {$gt: 3}}"));
+        ASSERT_FALSE(isSubset("{a: {$gt: 1}}", "{a: {$gt: 3}}"));
+        ASSERT_FALSE(isSubset("{a: {$lt: 5}}", "{a: {$gt: 3}}"));
+        ASSERT_FALSE(isSubset("{a: 'x'}", "{a: {$gt: 3}}"));
+        ASSERT_FALSE(isSubset("{a: [5]}", "{a: {$gt: 3}}"));
+        ASSERT_TRUE(isSubset("{a: {$in: [4, 5]}}", "{a: {$gt: 3}}"));
+        ASSERT_FALSE(isSubset("{a: {$in: [2, 5]}}", "{a: {$gt: 3}}"));
+    }
+
+    TEST(ExpressionAlgoIsSubsetOf, Exists) {
+        ASSERT_TRUE(isSubset("{a: 5}", "{a: {$exists: true}}"));
+        ASSERT_TRUE(isSubset("{a: {$gt: 5}}", "{a: {$exists: true}}"));
+        ASSERT_TRUE(isSubset("{a: {$type: 2}}", "{a: {$exists: true}}"));
+        ASSERT_TRUE(isSubset("{a: {$in: [1, 'x']}}", "{a: {$exists: true}}"));
+        ASSERT_FALSE(isSubset("{a: null}", "{a: {$exists: true}}"));
+        ASSERT_FALSE(isSubset("{a: {$in: [1, null]}}", "{a: {$exists: true}}"));
+        ASSERT_FALSE(isSubset("{a: {$exists: false}}", "{a: {$exists: true}}"));
+        ASSERT_FALSE(isSubset("{b: 5}", "{a: {$exists: true}}"));
+    }
+
+    TEST(ExpressionAlgoIsSubsetOf, Conjunctions) {
+        ASSERT_TRUE(isSubset("{status: 'pending', updatedAt: {$gt: 5}}", "{status: 'pending'}"));
+        ASSERT_TRUE(isSubset("{a: 5, b: 6}", "{a: {$gt: 1}, b: {$exists: true}}"));
+        ASSERT_FALSE(isSubset("{a: 5}", "{a: {$gt: 1}, b: {$exists: true}}"));
+        ASSERT_TRUE(isSubset("{$and: [{a: {$gt: 5}}, {a: {$lt: 9}}]}", "{a: {$gt: 4}}"));
+    }
+
+    TEST(ExpressionAlgoIsSubsetOf, Disjunctions) {
+        ASSERT_TRUE(isSubset("{$or: [{a: 5}, {a: 6}]}", "{a: {$gte: 5}}"));
+        ASSERT_FALSE(isSubset("{$or: [{a: 5}, {b: 6}]}", "{a: {$gte: 5}}"));
+        ASSERT_TRUE(isSubset("{a: 5}", "{$or: [{a: 5}, {b: 6}]}"));
+        ASSERT_FALSE(isSubset("{a: 7}", "{$or: [{a: 5}, {b: 6}]}"));
+    }
+
+} // namespace
+} // namespace mongo
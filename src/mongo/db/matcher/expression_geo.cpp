@@ -138,6 +138,11 @@ namespace mongo {
             geoContainer->projectInto(SPHERE);
         }
 
+        // A $within geometry is checked against every candidate document.
+        if (GeoExpression::WITHIN == predicate) {
+            geoContainer->prepareForContains();
+        }
+
         return Status::OK();
     }
 
@@ -57,6 +57,27 @@ namespace mongo {
 
     }
 
+    TEST( ExpressionGeoTest, GeoWithinPolygon ) {
+        BSONObj query = fromjson("{loc:{$geoWithin:{$geometry:{type:'Polygon', coordinates:"
+                                 "[[[0,0],[10,0],[10,10],[0,10],[0,0]]]}}}}");
+
+        auto_ptr<GeoExpression> gq(new GeoExpression);
+        ASSERT_OK( gq->parseFrom( query["loc"].Obj() ) );
+
+        GeoMatchExpression ge;
+        ASSERT( ge.init("a", gq.release(), query ).isOK() );
+
+        // Inside, well inside the polygon's interior cells, and near the boundary.
+        ASSERT(ge.matchesBSON(fromjson("{a: {type: 'Point', coordinates: [5, 5]}}")));
+        ASSERT(ge.matchesBSON(fromjson("{a: {type: 'Point', coordinates: [9.9999, 0.0001]}}")));
+        // On an edge and on a vertex.
+        ASSERT(ge.matchesBSON(fromjson("{a: {type: 'Point', coordinates: [5, 0]}}")));
+        ASSERT(ge.matchesBSON(fromjson("{a: {type: 'Point', coordinates: [0, 0]}}")));
+        // Just outside and far outside.
+        ASSERT(!ge.matchesBSON(fromjson("{a: {type: 'Point', coordinates: [5, -0.0001]}}")));
+        ASSERT(!ge.matchesBSON(fromjson("{a: {type: 'Point', coordinates: [-100, 40]}}")));
+    }
+
     TEST(ExpressionGeoTest, GeoNear1) {
         BSONObj query = fromjson("{loc:{$near:{$maxDistance:100, "
                                  "$geometry:{type:\"Point\", coordinates:[0,0]}}}}");
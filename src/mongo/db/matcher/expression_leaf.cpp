@@ -30,6 +30,7 @@
 
 #include "mongo/db/matcher/expression_leaf.h"
 
+#include <limits>
 #include <pcrecpp.h>
 
 #include "mongo/bson/bsonobjiterator.h"
@@ -252,6 +253,9 @@ namespace mongo {
         _flags = options.toString();
         _re.reset( new pcrecpp::RE( _regex.c_str(), flags2options( _flags.c_str() ) ) );
 
+        // Like PCRE, the prefilter sees the pattern only up to any NUL.
+        _prefilter.init( StringData( _regex.c_str() ), _flags );
+
         return initPath( path );
     }
 
@@ -260,11 +264,9 @@ namespace mongo {
         switch (e.type()) {
         case String:
         case Symbol:
-            // TODO
-            //if (rm._prefix.empty())
-                return _re->PartialMatch(e.valuestr());
-                //else
-                //return !strncmp(e.valuestr(), rm._prefix.c_str(), rm._prefix.size());
+            if ( !_prefilter.mayMatch( StringData( e.valuestr(), e.valuestrsize() - 1 ) ) )
+                return false;
+            return _re->PartialMatch(e.valuestr());
         case RegEx:
             return _regex == e.regex() && _flags == e.regexFlags();
         default:
@@ -442,6 +444,7 @@ namespace mongo {
     ArrayFilterEntries::ArrayFilterEntries(){
         _hasNull = false;
         _hasEmptyArray = false;
+        _hashed = false;
     }
 
     ArrayFilterEntries::~ArrayFilterEntries() {
@@ -467,9 +470,89 @@ namespace mongo {
             _hasEmptyArray = true;
 
         _equalities.insert( e );
+
+        if ( _hashed ) {
+            if ( _isHashable( e ) )
+                _hashedEqualities.insert( e );
+        }
+        else if ( _equalities.size() >= kMinHashedEqualities ) {
+            _hashed = true;
+            for ( BSONElementSet::const_iterator it = _equalities.begin();
+                  it != _equalities.end(); ++it ) {
+                if ( _isHashable( *it ) )
+                    _hashedEqualities.insert( *it );
+            }
+        }
+
         return Status::OK();
     }
 
+    bool ArrayFilterEntries::contains( const BSONElement& elem ) const {
+        // Elements only compare equal to elements of the same canonical type, so for a hashable
+        // element the hash set holds every candidate.
+        if ( _hashed && _isHashable( elem ) )
+            return _hashedEqualities.count( elem ) > 0;
+        return _equalities.count( elem ) > 0;
+    }
+
+    bool ArrayFilterEntries::_isHashable( const BSONElement& e ) {
+        switch ( e.type() ) {
+        case NumberDouble:
+        case NumberInt:
+        case NumberLong:
+        case String:
+        case Symbol:
+        case jstOID:
+        case Bool:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    size_t ArrayFilterEntries::HashedElementHash::operator()( const BSONElement& e ) const {
+        // FNV-1a
+        const char* data;
+        size_t len;
+        double number;
+
+        switch ( e.type() ) {
+        case NumberDouble:
+        case NumberInt:
+        case NumberLong:
+            // Numbers of different types compare equal when their values are, and NaN equals
+            // NaN, so hash the double value with -0.0 folded into 0.0 and all NaNs into one.
+            number = e.number();
+            if ( number == 0 )
+                number = 0;
+            else if ( isNaN( number ) )
+                number = std::numeric_limits<double>::quiet_NaN();
+            data = reinterpret_cast<const char*>( &number );
+            len = sizeof( number );
+            break;
+        case String:
+        case Symbol:
+            data = e.valuestr();
+            len = e.valuestrsize();
+            break;
+        case jstOID:
+            data = e.value();
+            len = OID::kOIDSize;
+            break;
+        default:
+            data = e.value();
+            len = e.valuesize();
+            break;
+        }
+
+        unsigned int h = 2166136261U;
+        for ( size_t i = 0; i < len; i++ ) {
+            h ^= static_cast<unsigned char>( data[i] );
+            h *= 16777619U;
+        }
+        return h;
+    }
+
     Status ArrayFilterEntries::addRegex( RegexMatchExpression* expr ) {
         _regexes.push_back( expr );
         return Status::OK();
@@ -492,6 +575,8 @@ namespace mongo {
         toFillIn._hasNull = _hasNull;
         toFillIn._hasEmptyArray = _hasEmptyArray;
         toFillIn._equalities = _equalities;
+        toFillIn._hashed = _hashed;
+        toFillIn._hashedEqualities = _hashedEqualities;
         for ( unsigned i = 0; i < _regexes.size(); i++ )
             toFillIn._regexes.push_back( static_cast<RegexMatchExpression*>(_regexes[i]->shallowClone()) );
     }
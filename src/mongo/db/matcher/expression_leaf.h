@@ -35,6 +35,8 @@
 #include "mongo/bson/bsonobj.h"
 #include "mongo/bson/bsonmisc.h"
 #include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/regex_prefilter.h"
+#include "mongo/platform/unordered_set.h"
 
 namespace pcrecpp {
     class RE;
@@ -69,6 +71,8 @@ namespace mongo {
 
         virtual const StringData path() const { return _path; }
 
+        const ElementPath& elementPath() const { return _elementPath; }
+
     protected:
         Status initPath( const StringData& path );
 
@@ -222,6 +226,9 @@ namespace mongo {
         std::string _regex;
         std::string _flags;
         boost::scoped_ptr<pcrecpp::RE> _re;
+
+        // Rejects most non-matching strings before they get to _re.
+        RegexPrefilter _prefilter;
     };
 
     class ModMatchExpression : public LeafMatchExpression {
@@ -295,7 +302,7 @@ namespace mongo {
         Status addRegex( RegexMatchExpression* expr );
 
         const BSONElementSet& equalities() const { return _equalities; }
-        bool contains( const BSONElement& elem ) const { return _equalities.count(elem) > 0; }
+        bool contains( const BSONElement& elem ) const;
 
         size_t numRegexes() const { return _regexes.size(); }
         RegexMatchExpression* regex( int idx ) const { return _regexes[idx]; }
@@ -313,11 +320,39 @@ namespace mongo {
 
         void toBSON(BSONArrayBuilder* out) const;
 
+        /**
+         * Once there are this many equalities, those of a type which hashes cheaply (numbers,
+         * strings, ObjectIds and booleans) are also kept in a hash set, so that contains()
+         * costs one hash and usually one comparison instead of log(N) comparisons.
+         */
+        static const size_t kMinHashedEqualities = 32;
+
     private:
+        /**
+         * Hashes consistently with BSONElement::woCompare( other, false ): numbers hash by
+         * their double value, so 5, 5LL and 5.0 share a bucket, and strings by their bytes.
+         */
+        struct HashedElementHash {
+            size_t operator()( const BSONElement& e ) const;
+        };
+        struct HashedElementEq {
+            bool operator()( const BSONElement& l, const BSONElement& r ) const {
+                return l.woCompare( r, false ) == 0;
+            }
+        };
+        typedef unordered_set<BSONElement, HashedElementHash, HashedElementEq> HashedElementSet;
+
+        /** Whether elements of e's canonical type go in _hashedEqualities. */
+        static bool _isHashable( const BSONElement& e );
+
         bool _hasNull; // if _equalities has a jstNULL element in it
         bool _hasEmptyArray;
         BSONElementSet _equalities;
         std::vector<RegexMatchExpression*> _regexes;
+
+        // Once _equalities reaches kMinHashedEqualities, the hashable subset of _equalities.
+        bool _hashed;
+        HashedElementSet _hashedEqualities;
     };
 
     /**
@@ -35,6 +35,7 @@
 #include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/matcher/expression_leaf.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
@@ -357,6 +358,63 @@ namespace mongo {
         ASSERT_EQUALS( "1", details.elemMatchKey() );
     }
 
+    TEST( InMatchExpression, MatchesLargeList ) {
+        const OID oid = OID::gen();
+        BSONArrayBuilder operandBuilder;
+        for ( size_t i = 0; i < ArrayFilterEntries::kMinHashedEqualities; i++ ) {
+            operandBuilder.append( static_cast<int>( i ) * 2 );
+            operandBuilder.append( std::string( str::stream() << "s" << i ) );
+        }
+        operandBuilder.append( oid );
+        operandBuilder.append( true );
+        operandBuilder.append( -0.0 );
+        operandBuilder.append( std::numeric_limits<double>::quiet_NaN() );
+        operandBuilder.append( BSON( "x" << 1 ) );
+        BSONArray operand = operandBuilder.arr();
+
+        InMatchExpression in;
+        in.init( "a" );
+        BSONObjIterator it( operand );
+        while ( it.more() )
+            ASSERT_OK( in.getArrayFilterEntries()->addEquality( it.next() ) );
+
+        // Numbers match across types.
+        ASSERT( in.matchesBSON( BSON( "a" << 4 ), NULL ) );
+        ASSERT( in.matchesBSON( BSON( "a" << 4LL ), NULL ) );
+        ASSERT( in.matchesBSON( BSON( "a" << 4.0 ), NULL ) );
+        ASSERT( !in.matchesBSON( BSON( "a" << 4.5 ), NULL ) );
+        ASSERT( !in.matchesBSON( BSON( "a" << 5 ), NULL ) );
+        ASSERT( in.matchesBSON( BSON( "a" << 0.0 ), NULL ) );
+        ASSERT( in.matchesBSON( BSON( "a" << -0.0 ), NULL ) );
+        ASSERT( in.matchesBSON( BSON( "a" << std::numeric_limits<double>::quiet_NaN() ),
+                                NULL ) );
+
+        // Strings compare bytewise, with no collation.
+        ASSERT( in.matchesBSON( BSON( "a" << "s7" ), NULL ) );
+        ASSERT( !in.matchesBSON( BSON( "a" << "S7" ), NULL ) );
+        ASSERT( !in.matchesBSON( BSON( "a" << "s7 " ), NULL ) );
+
+        ASSERT( in.matchesBSON( BSON( "a" << oid ), NULL ) );
+        ASSERT( !in.matchesBSON( BSON( "a" << OID::gen() ), NULL ) );
+        ASSERT( in.matchesBSON( BSON( "a" << true ), NULL ) );
+        ASSERT( !in.matchesBSON( BSON( "a" << false ), NULL ) );
+
+        // Types which aren't hashed are still found.
+        ASSERT( in.matchesBSON( BSON( "a" << BSON( "x" << 1 ) ), NULL ) );
+        ASSERT( !in.matchesBSON( BSON( "a" << BSON( "x" << 2 ) ), NULL ) );
+
+        // Array elements are looked up too.
+        ASSERT( in.matchesBSON( BSON( "a" << BSON_ARRAY( 1 << 3 << 62LL ) ), NULL ) );
+        ASSERT( !in.matchesBSON( BSON( "a" << BSON_ARRAY( 1 << 3 << 64LL ) ), NULL ) );
+
+        // A copy keeps matching the same way.
+        boost::scoped_ptr<LeafMatchExpression> clone( in.shallowClone() );
+        ASSERT( clone->matchesBSON( BSON( "a" << 10.0 ), NULL ) );
+        ASSERT( clone->matchesBSON( BSON( "a" << "s3" ), NULL ) );
+        ASSERT( !clone->matchesBSON( BSON( "a" << "s" ), NULL ) );
+        ASSERT( clone->equivalent( &in ) );
+    }
+
     /**
        TEST( LtOp, MatchesIndexKeyScalar ) {
        BSONObj operand = BSON( "$lt" << 6 );
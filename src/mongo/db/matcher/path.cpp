@@ -88,10 +88,13 @@ namespace mongo {
     // ------
     BSONElementIterator::BSONElementIterator() {
         _path = NULL;
+        _fieldIndex = NULL;
     }
 
-    BSONElementIterator::BSONElementIterator( const ElementPath* path, const BSONObj& context )
-        : _path( path ), _context( context ) {
+    BSONElementIterator::BSONElementIterator( const ElementPath* path,
+                                              const BSONObj& context,
+                                              const BSONFieldIndex* fieldIndex )
+        : _path( path ), _context( context ), _fieldIndex( fieldIndex ) {
         _state = BEGIN;
         //log() << "path: " << path.fieldRef().dottedField() << " context: " << context << endl;
     }
@@ -102,6 +105,7 @@ namespace mongo {
     void BSONElementIterator::reset( const ElementPath* path, const BSONObj& context ) {
         _path = path;
         _context = context;
+        _fieldIndex = NULL;
         _state = BEGIN;
         _next.reset();
 
@@ -183,7 +187,8 @@ namespace mongo {
 
         if ( _state == BEGIN ) {
             size_t idxPath = 0;
-            BSONElement e = getFieldDottedOrArray( _context, _path->fieldRef(), &idxPath );
+            BSONElement e = getFieldDottedOrArray( _context, _path->fieldRef(), &idxPath,
+                                                   _fieldIndex );
 
             if ( e.type() != Array ) {
                 _next.reset( e, BSONElement(), false );
@@ -40,6 +40,8 @@
 
 namespace mongo {
 
+    class BSONFieldIndex;
+
     class ElementPath {
     public:
         Status init( const StringData& path );
@@ -119,7 +121,14 @@ namespace mongo {
     class BSONElementIterator : public ElementIterator {
     public:
         BSONElementIterator();
-        BSONElementIterator( const ElementPath* path, const BSONObj& context );
+
+        /**
+         * @param fieldIndex if not NULL, finds the top level fields of 'context'; see
+         *        BSONFieldIndex.  Must outlive the iterator.
+         */
+        BSONElementIterator( const ElementPath* path,
+                             const BSONObj& context,
+                             const BSONFieldIndex* fieldIndex = NULL );
 
         virtual ~BSONElementIterator();
 
@@ -131,6 +140,7 @@ namespace mongo {
     private:
         const ElementPath* _path;
         BSONObj _context;
+        const BSONFieldIndex* _fieldIndex;
 
         enum State { BEGIN, IN_ARRAY, DONE } _state;
         Context _next;
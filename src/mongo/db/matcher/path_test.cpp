@@ -32,7 +32,9 @@
 #include "mongo/unittest/unittest.h"
 
 #include "mongo/db/jsobj.h"
+#include "mongo/bson/bson_field_index.h"
 #include "mongo/db/matcher/path.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
@@ -73,6 +75,28 @@ namespace mongo {
         ASSERT( !cursor.more() );
     }
 
+    TEST( Path, FieldIndex ) {
+        ElementPath p;
+        ASSERT( p.init( "a.b" ).isOK() );
+
+        BSONObjBuilder b;
+        for ( int i = 0; i < 200; i++ ) {
+            b.append( string( mongoutils::str::stream() << "x" << i ), i );
+        }
+        b.append( "a", BSON_ARRAY( BSON( "b" << 5 ) << BSON( "b" << 6 ) ) );
+        BSONObj doc = b.obj();
+
+        BSONFieldIndex fieldIndex;
+        ASSERT( fieldIndex.expectProbes( doc, BSONFieldIndex::kMinProbes ) );
+
+        BSONElementIterator cursor( &p, doc, &fieldIndex );
+        ASSERT( cursor.more() );
+        ASSERT_EQUALS( 5, cursor.next().element().numberInt() );
+        ASSERT( cursor.more() );
+        ASSERT_EQUALS( 6, cursor.next().element().numberInt() );
+        ASSERT( !cursor.more() );
+    }
+
     TEST( Path, RootArray2 ) {
         ElementPath p;
         ASSERT( p.init( "a" ).isOK() );
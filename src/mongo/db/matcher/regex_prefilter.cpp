@@ -0,0 +1,318 @@
+// regex_prefilter.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/matcher/regex_prefilter.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace mongo {
+
+    namespace {
+
+        bool isAsciiAlnum( char c ) {
+            return ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' );
+        }
+
+        char asciiToLower( char c ) {
+            return ( c >= 'A' && c <= 'Z' ) ? c - 'A' + 'a' : c;
+        }
+
+        bool hasNonAscii( const StringData& str ) {
+            for ( size_t i = 0; i < str.size(); i++ ) {
+                if ( static_cast<unsigned char>( str[i] ) >= 0x80 )
+                    return true;
+            }
+            return false;
+        }
+
+        bool isContinuationByte( char c ) {
+            return ( static_cast<unsigned char>( c ) & 0xC0 ) == 0x80;
+        }
+
+        /** Removes the last UTF-8 character of 'run'. */
+        void dropLastChar( std::string* run ) {
+            while ( !run->empty() && isContinuationByte( (*run)[run->size() - 1] ) )
+                run->erase( run->size() - 1 );
+            if ( !run->empty() )
+                run->erase( run->size() - 1 );
+        }
+
+        /**
+         * Returns the index just past the character class starting at 'regex[start]', which is
+         * '[', or std::string::npos if it isn't closed.
+         */
+        size_t skipClass( const StringData& regex, size_t start ) {
+            size_t i = start + 1;
+            if ( i < regex.size() && regex[i] == '^' )
+                i++;
+            // A ']' first in the class is a literal.
+            if ( i < regex.size() && regex[i] == ']' )
+                i++;
+            while ( i < regex.size() ) {
+                if ( regex[i] == '\\' )
+                    i += 2;
+                else if ( regex[i] == '[' && i + 1 < regex.size() && regex[i + 1] == ':' ) {
+                    // POSIX class such as [:alpha:]
+                    i += 2;
+                    while ( i + 1 < regex.size() && !( regex[i] == ':' && regex[i + 1] == ']' ) )
+                        i++;
+                    if ( i + 1 >= regex.size() )
+                        return std::string::npos;
+                    i += 2;
+                }
+                else if ( regex[i] == ']' )
+                    return i + 1;
+                else
+                    i++;
+            }
+            return std::string::npos;
+        }
+
+        /**
+         * Returns the index just past the group starting at 'regex[start]', which is '(', or
+         * std::string::npos if it isn't closed.  Alternation inside a group doesn't matter, as
+         * the group ends a run anyway.
+         */
+        size_t skipGroup( const StringData& regex, size_t start ) {
+            int depth = 0;
+            size_t i = start;
+            while ( i < regex.size() ) {
+                const char c = regex[i];
+                if ( c == '\\' ) {
+                    i += 2;
+                }
+                else if ( c == '[' ) {
+                    i = skipClass( regex, i );
+                    if ( i == std::string::npos )
+                        return i;
+                }
+                else {
+                    if ( c == '(' )
+                        depth++;
+                    else if ( c == ')' && --depth == 0 )
+                        return i + 1;
+                    i++;
+                }
+            }
+            return std::string::npos;
+        }
+
+        /** Whether the group at 'regex[start]' can be skipped without changing what follows. */
+        bool isOpaqueGroup( const StringData& regex, size_t start ) {
+            if ( start + 1 >= regex.size() )
+                return false;
+            const char next = regex[start + 1];
+            if ( next == '*' )
+                return false; // a verb such as (*UTF8)
+            if ( next != '?' )
+                return true;  // a capturing group
+
+            // Non-capturing, atomic and lookaround groups; reject inline options and the rest.
+            if ( start + 2 >= regex.size() )
+                return false;
+            const char kind = regex[start + 2];
+            if ( kind == ':' || kind == '=' || kind == '!' || kind == '>' )
+                return true;
+            if ( kind == '<' && start + 3 < regex.size() )
+                return regex[start + 3] == '=' || regex[start + 3] == '!';
+            return false;
+        }
+
+        /** Finds 'literal' in 'str' at or after 'from'; returns npos if absent. */
+        size_t findLiteral( const StringData& str, const std::string& literal, size_t from,
+                            bool caseInsensitive ) {
+            const size_t n = literal.size();
+            if ( n > str.size() )
+                return std::string::npos;
+            const size_t last = str.size() - n;
+
+            if ( !caseInsensitive ) {
+                const char* const begin = str.rawData();
+                size_t i = from;
+                while ( i <= last ) {
+                    const void* hit = memchr( begin + i, literal[0], last - i + 1 );
+                    if ( hit == NULL )
+                        return std::string::npos;
+                    i = static_cast<const char*>( hit ) - begin;
+                    if ( memcmp( begin + i + 1, literal.data() + 1, n - 1 ) == 0 )
+                        return i;
+                    i++;
+                }
+                return std::string::npos;
+            }
+
+            for ( size_t i = from; i <= last; i++ ) {
+                size_t j = 0;
+                while ( j < n && asciiToLower( str[i + j] ) == literal[j] )
+                    j++;
+                if ( j == n )
+                    return i;
+            }
+            return std::string::npos;
+        }
+
+    } // namespace
+
+    RegexPrefilter::RegexPrefilter() : _caseInsensitive( false ) { }
+
+    void RegexPrefilter::init( const StringData& regex, const StringData& flags ) {
+        _literals.clear();
+        _caseInsensitive = flags.find( 'i' ) != std::string::npos;
+
+        // Whitespace and comments are ignored in extended mode.
+        if ( flags.find( 'x' ) != std::string::npos )
+            return;
+
+        std::vector<std::string> literals;
+        std::string run;
+
+        size_t i = 0;
+        while ( i < regex.size() ) {
+            const char c = regex[i];
+            switch ( c ) {
+            case '|':
+                // Nothing is required of only one branch.
+                return;
+
+            case '*':
+            case '?':
+                // The previous character may be absent.
+                dropLastChar( &run );
+                // fall through
+            case '+':
+                if ( !run.empty() )
+                    literals.push_back( run );
+                run.clear();
+                i++;
+                break;
+
+            case '{': {
+                // {n,m} may allow none of the previous character; if this isn't a quantifier,
+                // the brace is a literal, and leaving it out is safe.
+                dropLastChar( &run );
+                if ( !run.empty() )
+                    literals.push_back( run );
+                run.clear();
+                const size_t end = regex.find( '}', i );
+                i = ( end == std::string::npos ) ? i + 1 : end + 1;
+                break;
+            }
+
+            case '\\':
+                if ( i + 1 >= regex.size() )
+                    return;
+                if ( isAsciiAlnum( regex[i + 1] ) ) {
+                    // Escapes taking arguments, such as \x41, \p{L} and back references, and
+                    // \Q...\E, are too much trouble.
+                    if ( !strchr( "dDwWsSbBAzZGhHvVRXNtnrfea", regex[i + 1] ) )
+                        return;
+
+                    // A class, an assertion or a control character.
+                    if ( !run.empty() )
+                        literals.push_back( run );
+                    run.clear();
+                }
+                else {
+                    run.push_back( regex[i + 1] );
+                }
+                i += 2;
+                break;
+
+            case '[':
+                if ( !run.empty() )
+                    literals.push_back( run );
+                run.clear();
+                i = skipClass( regex, i );
+                if ( i == std::string::npos )
+                    return;
+                break;
+
+            case '(':
+                if ( !isOpaqueGroup( regex, i ) )
+                    return;
+                if ( !run.empty() )
+                    literals.push_back( run );
+                run.clear();
+                i = skipGroup( regex, i );
+                if ( i == std::string::npos )
+                    return;
+                break;
+
+            case ')':
+                return;
+
+            case '.':
+            case '^':
+            case '$':
+                if ( !run.empty() )
+                    literals.push_back( run );
+                run.clear();
+                i++;
+                break;
+
+            default:
+                run.push_back( c );
+                i++;
+                break;
+            }
+        }
+        if ( !run.empty() )
+            literals.push_back( run );
+
+        for ( size_t j = 0; j < literals.size(); j++ ) {
+            if ( _caseInsensitive ) {
+                // Non-ASCII characters have case folds we don't know about.
+                if ( hasNonAscii( literals[j] ) )
+                    continue;
+                for ( size_t k = 0; k < literals[j].size(); k++ )
+                    literals[j][k] = asciiToLower( literals[j][k] );
+            }
+            _literals.push_back( literals[j] );
+        }
+    }
+
+    bool RegexPrefilter::mayMatch( const StringData& str ) const {
+        size_t from = 0;
+        for ( size_t i = 0; i < _literals.size(); i++ ) {
+            const size_t pos = findLiteral( str, _literals[i], from, _caseInsensitive );
+            if ( pos == std::string::npos ) {
+                // Caseless matching folds some non-ASCII characters into ASCII ones, such as
+                // the Kelvin sign into 'k'; leave those strings to PCRE.
+                return _caseInsensitive && hasNonAscii( str );
+            }
+            from = pos + _literals[i].size();
+        }
+        return true;
+    }
+
+} // namespace mongo
@@ -0,0 +1,68 @@
+// regex_prefilter.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/string_data.h"
+
+namespace mongo {
+
+    /**
+     * A cheap test which rejects most strings a regular expression can't match, so that PCRE
+     * only runs on plausible candidates.
+     *
+     * init() collects the literal runs which every match must contain, in order: for /error.*
+     * timeout/i these are "error" and "timeout".  Only the top level sequence of the pattern is
+     * considered; groups, classes and escapes like \d end a run, and a quantifier takes back the
+     * character it applies to.  Patterns with alternation, inline options, \Q...\E or the
+     * extended flag have no required literals, so everything passes.
+     */
+    class RegexPrefilter {
+    public:
+        /** Accepts every string until init() is called. */
+        RegexPrefilter();
+
+        void init( const StringData& regex, const StringData& flags );
+
+        /** False only if 'str' can't match the regex. */
+        bool mayMatch( const StringData& str ) const;
+
+        const std::vector<std::string>& requiredLiterals() const { return _literals; }
+
+    private:
+        // Lower case when _caseInsensitive.
+        std::vector<std::string> _literals;
+        bool _caseInsensitive;
+    };
+
+} // namespace mongo
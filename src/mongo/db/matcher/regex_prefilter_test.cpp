@@ -0,0 +1,148 @@
+// regex_prefilter_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/db/matcher/regex_prefilter.h"
+
+#include <pcrecpp.h>
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    namespace {
+
+        std::string literalsOf( const char* regex, const char* flags = "" ) {
+            RegexPrefilter prefilter;
+            prefilter.init( regex, flags );
+            std::string result;
+            for ( size_t i = 0; i < prefilter.requiredLiterals().size(); i++ ) {
+                if ( i > 0 )
+                    result += ",";
+                result += prefilter.requiredLiterals()[i];
+            }
+            return result;
+        }
+
+        /** Checks that the prefilter never rejects a string PCRE matches. */
+        void assertSound( const char* regex, const char* flags, const char* str ) {
+            pcrecpp::RE_Options options;
+            options.set_utf8( true );
+            options.set_caseless( strchr( flags, 'i' ) != NULL );
+            options.set_extended( strchr( flags, 'x' ) != NULL );
+            pcrecpp::RE re( regex, options );
+
+            RegexPrefilter prefilter;
+            prefilter.init( regex, flags );
+            if ( re.PartialMatch( str ) ) {
+                ASSERT( prefilter.mayMatch( str ) ) << "/" << regex << "/" << flags << " on "
+                                                    << str;
+            }
+        }
+
+    } // namespace
+
+    TEST( RegexPrefilter, RequiredLiterals ) {
+        ASSERT_EQUALS( "error,timeout", literalsOf( "error.*timeout", "i" ) );
+        ASSERT_EQUALS( "abc", literalsOf( "^abc" ) );
+        ASSERT_EQUALS( "ab,d", literalsOf( "abc?d" ) );
+        ASSERT_EQUALS( "abc,d", literalsOf( "abc+d" ) );
+        ASSERT_EQUALS( "ab,d", literalsOf( "abc*?d" ) );
+        ASSERT_EQUALS( "ab,d", literalsOf( "abc{2,3}d" ) );
+        ASSERT_EQUALS( "a.b", literalsOf( "a\\.b" ) );
+        ASSERT_EQUALS( "a,b", literalsOf( "a\\db" ) );
+        ASSERT_EQUALS( "x,y", literalsOf( "x[a-z]y" ) );
+        ASSERT_EQUALS( "x,y", literalsOf( "x[]|)]y" ) );
+        ASSERT_EQUALS( "x,y", literalsOf( "x[[:alpha:]]y" ) );
+        ASSERT_EQUALS( "x,y", literalsOf( "x(a|b)*y" ) );
+        ASSERT_EQUALS( "x,y", literalsOf( "x(?:a(b)c)y" ) );
+        ASSERT_EQUALS( "x,y", literalsOf( "x(?<=a)y" ) );
+        ASSERT_EQUALS( "caf", literalsOf( "caf\xc3\xa9?" ) );
+        ASSERT_EQUALS( "ab,c", literalsOf( "AB\\.?C", "i" ) );
+        ASSERT_EQUALS( "c", literalsOf( "AB\xc3\xa9.C", "i" ) );
+
+        // Nothing is required.
+        ASSERT_EQUALS( "", literalsOf( "" ) );
+        ASSERT_EQUALS( "", literalsOf( "abc|def" ) );
+        ASSERT_EQUALS( "", literalsOf( "a(?i)bc" ) );
+        ASSERT_EQUALS( "", literalsOf( "(*UTF8)abc" ) );
+        ASSERT_EQUALS( "", literalsOf( "\\Qa.b\\E" ) );
+        ASSERT_EQUALS( "", literalsOf( "\\x41B" ) );
+        ASSERT_EQUALS( "", literalsOf( "(a)\\1b" ) );
+        ASSERT_EQUALS( "", literalsOf( "abc", "x" ) );
+        ASSERT_EQUALS( "", literalsOf( "ab(c" ) );
+        ASSERT_EQUALS( "", literalsOf( "ab[c" ) );
+        ASSERT_EQUALS( "", literalsOf( "abc)" ) );
+    }
+
+    TEST( RegexPrefilter, MayMatch ) {
+        RegexPrefilter prefilter;
+        ASSERT( prefilter.mayMatch( "anything" ) );
+
+        prefilter.init( "error.*timeout", "" );
+        ASSERT( prefilter.mayMatch( "error: read timeout" ) );
+        ASSERT( !prefilter.mayMatch( "timeout error" ) );
+        ASSERT( !prefilter.mayMatch( "errortimeou" ) );
+        ASSERT( !prefilter.mayMatch( "ERROR: read TIMEOUT" ) );
+        ASSERT( !prefilter.mayMatch( "" ) );
+
+        prefilter.init( "error.*timeout", "i" );
+        ASSERT( prefilter.mayMatch( "ERROR: read TimeOut" ) );
+        ASSERT( !prefilter.mayMatch( "ERROR: read TIMEUOT" ) );
+
+        // Non-ASCII strings are left to PCRE when caseless.
+        ASSERT( prefilter.mayMatch( "ERROR: read TIME\xe2\x84\xaaOUT" ) );
+
+        // Literals don't overlap.
+        prefilter.init( "aba.*bab", "" );
+        ASSERT( !prefilter.mayMatch( "abab" ) );
+        ASSERT( prefilter.mayMatch( "ababab" ) );
+    }
+
+    TEST( RegexPrefilter, AgreesWithPCRE ) {
+        const char* regexes[] = {
+            "error.*timeout", "^abc", "abc?d", "abc+d", "ab{0}d", "x[]a]y", "a\\.b", "a\\db",
+            "x(a|b)*y", "(?:ab)+cd", "ab(?=c)", "a b", "k", "caf\xc3\xa9?", "\\x41B", "a\\Bb",
+        };
+        const char* flags[] = { "", "i", "x", "m", "s" };
+        const char* strs[] = {
+            "", "error timeout", "ERROR TIMEOUT", "abc", "xabd", "abd", "abcd", "abccd", "ad",
+            "x]y", "xay", "a.b", "a5b", "xy", "xababy", "ababcd", "abc", "a b", "ab",
+            "K", "\xe2\x84\xaa", "caf", "caf\xc3\xa9", "AB", "aBb",
+        };
+        for ( size_t r = 0; r < sizeof( regexes ) / sizeof( regexes[0] ); r++ ) {
+            for ( size_t f = 0; f < sizeof( flags ) / sizeof( flags[0] ); f++ ) {
+                for ( size_t s = 0; s < sizeof( strs ) / sizeof( strs[0] ); s++ ) {
+                    assertSound( regexes[r], flags[f], strs[s] );
+                }
+            }
+        }
+    }
+
+} // namespace mongo
@@ -42,6 +42,7 @@ namespace mongo {
         if ( ns == "admin.system.version" ) return true;
         if ( ns == "admin.system.new_users" ) return true;
         if ( ns == "admin.system.backup_users" ) return true;
+        if ( ns == "admin.system.plancache" ) return true;
 
         if ( ns.find( ".system.js" ) != string::npos ) return true;
 
@@ -0,0 +1,290 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kCommands
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/op_sampler.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/fsync.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/op_sample_buffer.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/background.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+    // Sample one in this many operations, none if 0.
+    MONGO_EXPORT_SERVER_PARAMETER(opSampleRate, int, 0);
+
+    // How many sampled documents to keep in memory until they are flushed.
+    MONGO_EXPORT_SERVER_PARAMETER(opSampleBufferSize, int, 1000);
+
+    // How many query shapes to keep totals for.
+    MONGO_EXPORT_SERVER_PARAMETER(opSampleMaxShapes, int, 1000);
+
+    // How often to flush sampled documents to local.system.opsamples, never if 0.
+    MONGO_EXPORT_SERVER_PARAMETER(opSampleFlushIntervalSecs, int, 10);
+
+namespace {
+
+    const char* kOpSamplesNamespace = "local.system.opsamples";
+    const long long kOpSamplesCappedSize = 16 * 1024 * 1024;
+
+    // Larger queries are abbreviated in the kept documents and never kept as examples.
+    const size_t kMaxSampleQuerySize = 4 * 1024;
+
+    AtomicUInt64 numOps;
+    AtomicUInt64 numFlushed;
+    OpSampleBuffer sampleBuffer;
+
+    size_t knobAsSize(int value) {
+        return value > 0 ? static_cast<size_t>(value) : 0;
+    }
+
+    /**
+     * Sets 'filter' and 'sort' from a query which may be wrapped, as in
+     * { $query : { a : 1 }, $orderby : { b : 1 } }.
+     */
+    void unwrapQuery(const BSONObj& query, BSONObj* filter, BSONObj* sort) {
+        BSONElement wrapped = query["$query"];
+        if (wrapped.eoo()) {
+            wrapped = query["query"];
+        }
+        if (Object != wrapped.type()) {
+            *filter = query;
+            return;
+        }
+
+        *filter = wrapped.Obj();
+        BSONElement orderby = query["$orderby"];
+        if (orderby.eoo()) {
+            orderby = query["orderby"];
+        }
+        if (Object == orderby.type()) {
+            *sort = orderby.Obj();
+        }
+    }
+
+    /**
+     * The shape of queries, updates and removes is the plan cache key of their filter and sort,
+     * which is the same for queries differing only by their constants.  That of commands is
+     * their name.  Other operations, or queries which don't parse, have no shape.
+     */
+    void computeShape(CurOp& currentOp, OpSampleBuffer::Sample* sample) {
+        const OpDebug& debug = currentOp.debug();
+
+        if (debug.iscommand) {
+            if (!debug.query.isEmpty()) {
+                sample->shape = debug.query.firstElementFieldName();
+            }
+            return;
+        }
+
+        if ((dbQuery != debug.op && dbUpdate != debug.op && dbDelete != debug.op) ||
+                debug.query.isEmpty()) {
+            return;
+        }
+
+        BSONObj filter;
+        BSONObj sort;
+        unwrapQuery(debug.query, &filter, &sort);
+
+        CanonicalQuery* cqRaw;
+        const Status status = CanonicalQuery::canonicalize(sample->ns, filter, sort, BSONObj(),
+                                                            &cqRaw, WhereCallbackNoop());
+        if (!status.isOK()) {
+            return;
+        }
+        boost::scoped_ptr<CanonicalQuery> cq(cqRaw);
+
+        sample->shape = cq->getPlanCacheKey();
+        if (static_cast<size_t>(debug.query.objsize()) <= kMaxSampleQuerySize) {
+            sample->example = debug.query.getOwned();
+        }
+    }
+
+    /**
+     * Moves the sampled documents to local.system.opsamples, which is capped so that it keeps
+     * the most recent ones, and isn't replicated.  Inserting them in the background keeps the
+     * sampled operations from waiting on locks or on the storage engine.
+     */
+    class OpSampleFlusher : public BackgroundJob {
+    public:
+        OpSampleFlusher() { }
+        virtual ~OpSampleFlusher() { }
+
+        virtual std::string name() const { return "OpSampleFlusher"; }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            unsigned long long lastFlushed = 0;
+
+            while (!inShutdown()) {
+                sleepsecs(1);
+
+                const int intervalSecs = opSampleFlushIntervalSecs;
+                if (intervalSecs <= 0 || lockedForWriting()) {
+                    continue;
+                }
+
+                const unsigned long long now = curTimeMillis64();
+                if (now - lastFlushed < static_cast<unsigned long long>(intervalSecs) * 1000) {
+                    continue;
+                }
+                lastFlushed = now;
+
+                std::vector<BSONObj> docs;
+                sampleBuffer.drain(&docs);
+                if (docs.empty()) {
+                    continue;
+                }
+
+                try {
+                    flush(docs);
+                }
+                catch (const DBException& ex) {
+                    warning() << "op sample flusher: " << ex.toString();
+                }
+            }
+        }
+
+    private:
+        void flush(const std::vector<BSONObj>& docs) {
+            OperationContextImpl txn;
+            AutoGetOrCreateDb autoDb(&txn, kOpSamplesNamespace, MODE_X);
+            Database* db = autoDb.getDb();
+
+            Collection* collection = db->getCollection(&txn, kOpSamplesNamespace);
+            if (!collection) {
+                log() << "creating op samples collection: " << kOpSamplesNamespace;
+
+                CollectionOptions collectionOptions;
+                collectionOptions.capped = true;
+                collectionOptions.cappedSize = kOpSamplesCappedSize;
+
+                WriteUnitOfWork wunit(&txn);
+                collection = db->createCollection(&txn, kOpSamplesNamespace, collectionOptions);
+                invariant(collection);
+                wunit.commit();
+            }
+            else if (!collection->isCapped()) {
+                warning() << kOpSamplesNamespace << " exists but isn't capped, dropping "
+                          << docs.size() << " sampled operations";
+                return;
+            }
+
+            WriteUnitOfWork wunit(&txn);
+            for (std::vector<BSONObj>::const_iterator it = docs.begin(); it != docs.end(); ++it) {
+                StatusWith<DiskLoc> loc = collection->insertDocument(&txn, *it, false);
+                uassertStatusOK(loc.getStatus());
+            }
+            wunit.commit();
+
+            numFlushed.fetchAndAdd(docs.size());
+        }
+    };
+
+    /**
+     * The totals of the shapes with the most total time of the sampled operations.
+     * { serverStatus : 1 , opSamples : { shapes : <n> } } returns the first n, 20 by default.
+     */
+    class OpSamplesServerStatusSection : public ServerStatusSection {
+    public:
+        OpSamplesServerStatusSection() : ServerStatusSection( "opSamples" ) {}
+        virtual bool includeByDefault() const { return false; }
+
+        virtual BSONObj generateSection(const BSONElement& configElement) const {
+            size_t numShapes = 20;
+            if (configElement.type() == Object && configElement.Obj()["shapes"].isNumber()) {
+                numShapes = knobAsSize(configElement.Obj()["shapes"].numberInt());
+            }
+
+            BSONObjBuilder b;
+            b.append("sampleRate", opSampleRate);
+            sampleBuffer.appendStats(&b);
+            b.appendNumber("flushed", static_cast<long long>(numFlushed.load()));
+
+            BSONArrayBuilder shapesBuilder(b.subarrayStart("queryShapes"));
+            sampleBuffer.appendShapes(&shapesBuilder, numShapes);
+            shapesBuilder.doneFast();
+            return b.obj();
+        }
+
+    } opSamplesServerStatusSection;
+
+} // namespace
+
+    void sampleOp(OperationContext* txn, const Client& c, CurOp& currentOp) {
+        const int rate = opSampleRate;
+        if (rate <= 0 || numOps.fetchAndAdd(1) % rate != 0) {
+            return;
+        }
+
+        const OpDebug& debug = currentOp.debug();
+
+        OpSampleBuffer::Sample sample;
+        sample.op = debug.iscommand ? "command" : opToString(debug.op);
+        sample.ns = debug.ns.toString();
+        sample.millis = debug.executionTime;
+        sample.nscanned = debug.nscanned;
+        sample.nscannedObjects = debug.nscannedObjects;
+        sample.nreturned = debug.nreturned;
+
+        BSONObjBuilder b;
+        debug.append(currentOp, b, kMaxSampleQuerySize);
+        b.appendDate("ts", jsTime());
+        b.append("client", c.clientAddress());
+        sample.doc = b.obj();
+
+        computeShape(currentOp, &sample);
+
+        sampleBuffer.add(sample, knobAsSize(opSampleBufferSize), knobAsSize(opSampleMaxShapes));
+    }
+
+    void startOpSampleFlusherBackgroundJob() {
+        OpSampleFlusher* flusher = new OpSampleFlusher();
+        flusher->go();
+    }
+
+} // namespace mongo
@@ -41,6 +41,7 @@ namespace mongo {
 
     class Client;
     class CurOp;
+    class OperationMemoryTracker;
     class ProgressMeter;
 
     /**
@@ -129,6 +130,12 @@ namespace mongo {
          */
         virtual CurOp* getCurOp() const = 0;
 
+        /**
+         * Returns the tracker which the memory buffered for this operation counts towards, or
+         * NULL if there is none.  Delegates to CurOp.  Caller does not own pointer.
+         */
+        virtual OperationMemoryTracker* memoryTracker() const = 0;
+
         /**
          * Returns the operation ID associated with this operation.
          * WARNING: Due to SERVER-14995, this OpID is not guaranteed to stay the same for the
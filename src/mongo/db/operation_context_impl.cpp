@@ -32,6 +32,8 @@
 
 #include "mongo/db/operation_context_impl.h"
 
+#include "mongo/db/auth/authorization_manager.h"
+#include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/client.h"
 #include "mongo/db/concurrency/lock_state.h"
 #include "mongo/db/curop.h"
@@ -47,9 +49,30 @@ namespace mongo {
 namespace {
     // Dispenses unique OperationContext identifiers
     AtomicUInt64 idCounter(0);
+
+    /**
+     * Internal operations are those of the server's own threads (replication, TTL, etc) and,
+     * when auth is enabled, those of other cluster members.
+     */
+    bool isInternalOperation(Client* client) {
+        if (!client->hasRemote()) {
+            return true;
+        }
+
+        if (!client->hasAuthorizationSession()) {
+            return false;
+        }
+
+        AuthorizationSession* authSession = client->getAuthorizationSession();
+        return authSession->getAuthorizationManager().isAuthEnabled() &&
+            authSession->isAuthorizedForActionsOnResource(ResourcePattern::forClusterResource(),
+                                                          ActionType::internal);
+    }
 }
 
-    OperationContextImpl::OperationContextImpl() : _client(currentClient.get()) {
+    OperationContextImpl::OperationContextImpl()
+        : _bufBuilderArenaScope(&_bufBuilderArena),
+          _client(currentClient.get()) {
         invariant(_client);
 
         StorageEngine* storageEngine = getGlobalEnvironment()->getGlobalStorageEngine();
@@ -63,6 +86,10 @@ namespace {
             _locker.reset(new LockerImpl<false>(idCounter.addAndFetch(1)));
         }
 
+        if (getAdmissionController(MODE_IS) && isInternalOperation(_client)) {
+            _locker->setAdmissionPriority(AdmissionController::kPriorityHigh);
+        }
+
         getGlobalEnvironment()->registerOperationContext(this);
     }
 
@@ -113,6 +140,10 @@ namespace {
         return getClient()->curop();
     }
 
+    OperationMemoryTracker* OperationContextImpl::memoryTracker() const {
+        return &getCurOp()->memoryTracker();
+    }
+
     unsigned int OperationContextImpl::getOpID() const {
         return getCurOp()->opNum();
     }
@@ -30,6 +30,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <string>
 
+#include "mongo/bson/util/builder_arena.h"
 #include "mongo/db/operation_context.h"
 
 
@@ -62,6 +63,8 @@ namespace mongo {
 
         virtual CurOp* getCurOp() const;
 
+        virtual OperationMemoryTracker* memoryTracker() const;
+
         virtual unsigned int getOpID() const;
 
         virtual void checkForInterrupt(bool heedMutex = true) const;
@@ -71,6 +74,11 @@ namespace mongo {
         virtual bool isPrimaryFor( const StringData& ns );
 
     private:
+        // Declared first, so it outlives anything else the operation owns.  The operation's
+        // temporary BSON builders recycle their buffers through it.
+        BufBuilderArena _bufBuilderArena;
+        BufBuilderArena::Scope _bufBuilderArenaScope;
+
         std::auto_ptr<RecoveryUnit> _recovery;
         std::auto_ptr<Locker> _locker;
         Client* const _client; // cached, not owned
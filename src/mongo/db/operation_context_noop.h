@@ -57,6 +57,10 @@ namespace mongo {
             return NULL;
         }
 
+        virtual OperationMemoryTracker* memoryTracker() const {
+            return NULL;
+        }
+
         virtual RecoveryUnit* recoveryUnit() const {
             return _recoveryUnit.get();
         }
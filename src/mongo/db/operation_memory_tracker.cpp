@@ -0,0 +1,260 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/operation_memory_tracker.h"
+
+#include <set>
+
+#include "mongo/base/error_codes.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    // The memory that one operation's consumers may use in all before they are made to spill to
+    // disk, or the operation fails if they can't.  0 for no limit.
+    MONGO_EXPORT_SERVER_PARAMETER(internalOperationMaxMemoryMegabytes, int, 0);
+
+    // The memory that all operations may use in all before the one using the most is made to
+    // give some back.  Includes what idle cursors hold.  0 for no limit.
+    MONGO_EXPORT_SERVER_PARAMETER(internalOperationsMemoryBudgetMegabytes, int, 0);
+
+    const long long OperationMemoryTracker::kReportGranularityBytes;
+    const long long OperationMemoryTracker::kMinReleaseBytes;
+
+    namespace {
+
+        const long long kMB = 1024 * 1024;
+
+        AtomicInt64 totalBytesUsed;
+
+        // Guards the registry of the outermost operations which have used memory, and which of
+        // them is the largest.
+        SimpleMutex registryMutex("operationMemoryTracker");
+        std::set<OperationMemoryTracker*> registeredOperations;
+        OperationMemoryTracker* largestOperation = NULL;
+        AtomicUInt32 haveLargestOperation;
+
+    }  // namespace
+
+    OperationMemoryTracker::OperationMemoryTracker(OperationMemoryTracker* parent, Kind kind)
+        : _parent(parent),
+          _kind(kind),
+          _ownBytes(0),
+          _reportedBytes(0) {
+    }
+
+    OperationMemoryTracker::~OperationMemoryTracker() {
+        const long long bytes = _bytes.load();
+        if (bytes) {
+            _add(_parent, -bytes);
+        }
+        _unregisterOperation();
+    }
+
+    void OperationMemoryTracker::set(long long bytes) {
+        _ownBytes = bytes;
+
+        const long long delta = bytes - _reportedBytes;
+        if (delta == 0) {
+            return;
+        }
+        if (bytes != 0 && delta < kReportGranularityBytes && delta > -kReportGranularityBytes) {
+            return;
+        }
+
+        _reportedBytes = bytes;
+        _add(this, delta);
+    }
+
+    void OperationMemoryTracker::setParent(OperationMemoryTracker* parent) {
+        if (parent == _parent) {
+            return;
+        }
+
+        const long long bytes = _bytes.load();
+        if (bytes) {
+            _add(_parent, -bytes);
+        }
+        _parent = parent;
+        if (bytes) {
+            _add(_parent, bytes);
+        }
+    }
+
+    Status OperationMemoryTracker::checkLimits() const {
+        if (_ownBytes < kMinReleaseBytes) {
+            return Status::OK();
+        }
+
+        const OperationMemoryTracker* operation = _outermost();
+        if (operation->_kind != kOperation) {
+            // Not running for any operation at the moment.
+            return Status::OK();
+        }
+
+        const long long operationBytes = operation->bytes();
+        const long long maxBytes = internalOperationMaxMemoryMegabytes * kMB;
+        if (maxBytes > 0 && operationBytes > maxBytes) {
+            return Status(ErrorCodes::ExceededMemoryLimit,
+                          str::stream() << "operation is using " << operationBytes
+                                        << " bytes of memory, more than the "
+                                        << maxBytes << " bytes that"
+                                        << " internalOperationMaxMemoryMegabytes allows");
+        }
+
+        if (operation->_largest.loadRelaxed()) {
+            const long long budget = internalOperationsMemoryBudgetMegabytes * kMB;
+            const long long total = totalBytes();
+            if (budget > 0 && total > budget) {
+                return Status(ErrorCodes::ExceededMemoryLimit,
+                              str::stream() << "operations are using " << total
+                                            << " bytes of memory, more than the " << budget
+                                            << " bytes that internalOperationsMemoryBudgetMegabytes"
+                                            << " allows, and this one the most, "
+                                            << operationBytes << " bytes");
+            }
+        }
+
+        return Status::OK();
+    }
+
+    void OperationMemoryTracker::reset() {
+        const long long bytes = _bytes.load();
+        if (bytes) {
+            _add(_parent, -bytes);
+        }
+        _bytes.store(0);
+        _peakBytes.store(0);
+        _ownBytes = 0;
+        _reportedBytes = 0;
+        _unregisterOperation();
+    }
+
+    long long OperationMemoryTracker::totalBytes() {
+        return totalBytesUsed.loadRelaxed();
+    }
+
+    void OperationMemoryTracker::_add(OperationMemoryTracker* tracker, long long delta) {
+        OperationMemoryTracker* outermost = NULL;
+        for ( ; tracker; tracker = tracker->_parent) {
+            const long long bytes = tracker->_bytes.addAndFetch(delta);
+            long long peak = tracker->_peakBytes.loadRelaxed();
+            while (bytes > peak) {
+                const long long previous = tracker->_peakBytes.compareAndSwap(peak, bytes);
+                if (previous == peak) {
+                    break;
+                }
+                peak = previous;
+            }
+            outermost = tracker;
+        }
+
+        const long long total = totalBytesUsed.addAndFetch(delta);
+
+        if (outermost && outermost->_kind == kOperation && delta > 0) {
+            outermost->_registerOperation();
+        }
+
+        const long long budget = internalOperationsMemoryBudgetMegabytes * kMB;
+        if (budget > 0 && total > budget) {
+            _updateLargestOperation(true);
+        }
+        else if (haveLargestOperation.loadRelaxed()) {
+            _updateLargestOperation(false);
+        }
+    }
+
+    const OperationMemoryTracker* OperationMemoryTracker::_outermost() const {
+        const OperationMemoryTracker* tracker = this;
+        while (tracker->_parent) {
+            tracker = tracker->_parent;
+        }
+        return tracker;
+    }
+
+    void OperationMemoryTracker::_registerOperation() {
+        if (_registered.loadRelaxed()) {
+            return;
+        }
+
+        SimpleMutex::scoped_lock lk(registryMutex);
+        if (_registered.load()) {
+            return;
+        }
+        registeredOperations.insert(this);
+        _registered.store(1);
+    }
+
+    void OperationMemoryTracker::_unregisterOperation() {
+        if (!_registered.load()) {
+            return;
+        }
+
+        SimpleMutex::scoped_lock lk(registryMutex);
+        registeredOperations.erase(this);
+        if (largestOperation == this) {
+            largestOperation = NULL;
+            haveLargestOperation.store(0);
+        }
+        _largest.store(0);
+        _registered.store(0);
+    }
+
+    void OperationMemoryTracker::_updateLargestOperation(bool overBudget) {
+        SimpleMutex::scoped_lock lk(registryMutex);
+
+        OperationMemoryTracker* largest = NULL;
+        if (overBudget) {
+            for (std::set<OperationMemoryTracker*>::const_iterator it =
+                     registeredOperations.begin();
+                 it != registeredOperations.end();
+                 ++it) {
+                if (!largest || (*it)->bytes() > largest->bytes()) {
+                    largest = *it;
+                }
+            }
+        }
+
+        if (largest == largestOperation) {
+            return;
+        }
+        if (largestOperation) {
+            largestOperation->_largest.store(0);
+        }
+        if (largest) {
+            largest->_largest.store(1);
+        }
+        largestOperation = largest;
+        haveLargestOperation.store(largest ? 1 : 0);
+    }
+
+}  // namespace mongo
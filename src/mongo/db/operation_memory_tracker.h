@@ -0,0 +1,152 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    // The memory one operation may use, and that all may use, before being made to give some
+    // back, in megabytes.  0 for no limit; see OperationMemoryTracker.
+    extern int internalOperationMaxMemoryMegabytes;
+    extern int internalOperationsMemoryBudgetMegabytes;
+
+    /**
+     * Accounts for the memory that an operation buffers: the data its sorts, groups and other
+     * blocking stages hold on to, as opposed to what it merely passes on.  Trackers form a tree.
+     * The CurOp of each operation has one, of kind kOperation, and each memory-hungry consumer
+     * in it, such as a SortStage, a $group or a Sorter, has one of its own whose parent is the
+     * operation's, or that of the consumer which contains it.  A consumer set()s how much it is
+     * using, which counts towards all of its ancestors.
+     *
+     * Two limits apply to the outermost operation of a tree:
+     *   - internalOperationMaxMemoryMegabytes bounds what any one operation may use, and
+     *   - internalOperationsMemoryBudgetMegabytes bounds what all trackers use in all, and when it
+     *     is exceeded the operation using the most is made to give memory back.
+     * A consumer asks checkLimits() whether it should, and then spills to disk if it can, or
+     * fails the operation with the error otherwise.  Both limits are off when 0.
+     *
+     * A consumer which outlives an operation, as the stages of a query stashed in a ClientCursor
+     * between getMores do, must setParent(NULL) when it is saved and setParent() to the tracker
+     * of the next operation when it is restored.  In between its memory still counts towards
+     * the total, but no operation is charged for it.
+     *
+     * set() and setParent() are for the thread running the consumer.  The trackers of
+     * consumers running on other threads, such as the partitions of a parallel $group, may
+     * share a parent.
+     */
+    class OperationMemoryTracker {
+        MONGO_DISALLOW_COPYING(OperationMemoryTracker);
+    public:
+        enum Kind { kConsumer, kOperation };
+
+        /**
+         * Consumers report their usage in steps of this many bytes rather than at every change,
+         * so that their ancestors and the total are not updated for each document.
+         */
+        static const long long kReportGranularityBytes = 64 * 1024;
+
+        /**
+         * checkLimits() doesn't ask a consumer using less than this to give memory back, as it
+         * would have to spill for every few documents and would gain next to nothing.
+         */
+        static const long long kMinReleaseBytes = 1024 * 1024;
+
+        /**
+         * @param parent - the tracker this one's memory counts towards, if not NULL
+         */
+        explicit OperationMemoryTracker(OperationMemoryTracker* parent = NULL,
+                                        Kind kind = kConsumer);
+
+        ~OperationMemoryTracker();
+
+        /**
+         * Sets how many bytes the consumer of this tracker itself uses, not counting its
+         * children.
+         */
+        void set(long long bytes);
+
+        /**
+         * Moves this tracker's memory, including its children's, to count towards 'parent'.
+         */
+        void setParent(OperationMemoryTracker* parent);
+
+        /**
+         * Returns ExceededMemoryLimit if the outermost operation that this tracker counts towards
+         * is over one of the limits and this tracker should give memory back.
+         */
+        Status checkLimits() const;
+
+        /**
+         * Forgets all memory used, for a CurOp starting a new operation.  Every consumer must
+         * have been detached by then.
+         */
+        void reset();
+
+        /** The bytes used by this tracker and its children, as last reported. */
+        long long bytes() const { return _bytes.loadRelaxed(); }
+
+        /** The most bytes() has been since the last reset(). */
+        long long peakBytes() const { return _peakBytes.loadRelaxed(); }
+
+        /** The bytes used by all trackers, whether or not an operation is charged for them. */
+        static long long totalBytes();
+
+    private:
+        /**
+         * Adds 'delta' to 'tracker' and to its ancestors, and to the total above the outermost,
+         * which is all there is to add to if 'tracker' is NULL.
+         */
+        static void _add(OperationMemoryTracker* tracker, long long delta);
+
+        const OperationMemoryTracker* _outermost() const;
+
+        void _registerOperation();
+        void _unregisterOperation();
+
+        /** Marks the operation using the most as the one to give memory back, or none. */
+        static void _updateLargestOperation(bool overBudget);
+
+        OperationMemoryTracker* _parent; // not owned, might be NULL
+        const Kind _kind;
+
+        long long _ownBytes;      // set() by the consumer
+        long long _reportedBytes; // of _ownBytes, what has been added to _bytes
+
+        AtomicInt64 _bytes;
+        AtomicInt64 _peakBytes;
+
+        // Only used by outermost operations
+        AtomicUInt32 _registered; // 1 if in the registry, changed under its mutex
+        AtomicUInt32 _largest;    // 1 if using the most while over the budget
+    };
+
+}  // namespace mongo
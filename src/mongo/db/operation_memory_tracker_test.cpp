@@ -0,0 +1,195 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/operation_memory_tracker.h"
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    namespace {
+
+        const long long kMB = 1024 * 1024;
+
+        /** Sets a limit for the duration of a test. */
+        class LimitSetting {
+        public:
+            LimitSetting(int* limit, int value) : _limit(limit), _old(*limit) {
+                *_limit = value;
+            }
+            ~LimitSetting() { *_limit = _old; }
+
+        private:
+            int* const _limit;
+            const int _old;
+        };
+
+        TEST(OperationMemoryTracker, ConsumersCountTowardsOperations) {
+            const long long totalBefore = OperationMemoryTracker::totalBytes();
+            OperationMemoryTracker outer(NULL, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker nested(&outer, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker sort(&nested);
+            OperationMemoryTracker sorter(&sort);
+
+            sort.set(2 * kMB);
+            sorter.set(3 * kMB);
+            ASSERT_EQUALS(3 * kMB, sorter.bytes());
+            ASSERT_EQUALS(5 * kMB, sort.bytes());
+            ASSERT_EQUALS(5 * kMB, nested.bytes());
+            ASSERT_EQUALS(5 * kMB, outer.bytes());
+            ASSERT_EQUALS(totalBefore + 5 * kMB, OperationMemoryTracker::totalBytes());
+
+            sort.set(0);
+            ASSERT_EQUALS(3 * kMB, outer.bytes());
+            ASSERT_EQUALS(5 * kMB, outer.peakBytes());
+            ASSERT_EQUALS(totalBefore + 3 * kMB, OperationMemoryTracker::totalBytes());
+        }
+
+        TEST(OperationMemoryTracker, DestroyingAConsumerGivesItsMemoryBack) {
+            const long long totalBefore = OperationMemoryTracker::totalBytes();
+            OperationMemoryTracker operation(NULL, OperationMemoryTracker::kOperation);
+            {
+                OperationMemoryTracker group(&operation);
+                group.set(4 * kMB);
+                ASSERT_EQUALS(4 * kMB, operation.bytes());
+            }
+            ASSERT_EQUALS(0, operation.bytes());
+            ASSERT_EQUALS(4 * kMB, operation.peakBytes());
+            ASSERT_EQUALS(totalBefore, OperationMemoryTracker::totalBytes());
+
+            operation.reset();
+            ASSERT_EQUALS(0, operation.peakBytes());
+        }
+
+        TEST(OperationMemoryTracker, SmallChangesAreReportedInSteps) {
+            OperationMemoryTracker operation(NULL, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker sort(&operation);
+
+            sort.set(1000);
+            ASSERT_EQUALS(0, operation.bytes());
+            sort.set(OperationMemoryTracker::kReportGranularityBytes + 1000);
+            ASSERT_EQUALS(OperationMemoryTracker::kReportGranularityBytes + 1000,
+                          operation.bytes());
+            sort.set(OperationMemoryTracker::kReportGranularityBytes);
+            ASSERT_EQUALS(OperationMemoryTracker::kReportGranularityBytes + 1000,
+                          operation.bytes());
+
+            // Going back to nothing is always reported
+            sort.set(0);
+            ASSERT_EQUALS(0, operation.bytes());
+        }
+
+        TEST(OperationMemoryTracker, SetParentMovesTheMemory) {
+            const long long totalBefore = OperationMemoryTracker::totalBytes();
+            OperationMemoryTracker first(NULL, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker second(NULL, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker pipeline(&first);
+            OperationMemoryTracker group(&pipeline);
+            group.set(2 * kMB);
+            ASSERT_EQUALS(2 * kMB, first.bytes());
+
+            // Saved in a cursor between two operations
+            pipeline.setParent(NULL);
+            ASSERT_EQUALS(0, first.bytes());
+            ASSERT_EQUALS(2 * kMB, pipeline.bytes());
+            ASSERT_EQUALS(totalBefore + 2 * kMB, OperationMemoryTracker::totalBytes());
+
+            pipeline.setParent(&second);
+            ASSERT_EQUALS(2 * kMB, second.bytes());
+            ASSERT_EQUALS(totalBefore + 2 * kMB, OperationMemoryTracker::totalBytes());
+        }
+
+        TEST(OperationMemoryTracker, NoLimitsByDefault) {
+            OperationMemoryTracker operation(NULL, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker sort(&operation);
+            sort.set(64 * kMB);
+            ASSERT_OK(sort.checkLimits());
+        }
+
+        TEST(OperationMemoryTracker, OperationLimit) {
+            LimitSetting limit(&internalOperationMaxMemoryMegabytes, 10);
+            OperationMemoryTracker operation(NULL, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker sort(&operation);
+            OperationMemoryTracker group(&operation);
+
+            sort.set(6 * kMB);
+            group.set(3 * kMB);
+            ASSERT_OK(sort.checkLimits());
+            ASSERT_OK(group.checkLimits());
+
+            group.set(5 * kMB);
+            ASSERT_EQUALS(ErrorCodes::ExceededMemoryLimit, sort.checkLimits().code());
+            ASSERT_EQUALS(ErrorCodes::ExceededMemoryLimit, group.checkLimits().code());
+
+            // Too little to be worth giving back
+            OperationMemoryTracker project(&operation);
+            project.set(kMB / 2);
+            ASSERT_OK(project.checkLimits());
+
+            // Not used by any operation at the moment
+            sort.setParent(NULL);
+            ASSERT_OK(sort.checkLimits());
+            ASSERT_OK(group.checkLimits());
+        }
+
+        TEST(OperationMemoryTracker, BudgetIsTakenFromTheLargestOperation) {
+            OperationMemoryTracker small(NULL, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker large(NULL, OperationMemoryTracker::kOperation);
+            OperationMemoryTracker smallSort(&small);
+            OperationMemoryTracker largeSort(&large);
+            OperationMemoryTracker idleSort(NULL);
+            smallSort.set(4 * kMB);
+            largeSort.set(8 * kMB);
+            idleSort.set(2 * kMB);
+
+            LimitSetting budget(&internalOperationsMemoryBudgetMegabytes,
+                                OperationMemoryTracker::totalBytes() / kMB + 1);
+            ASSERT_OK(smallSort.checkLimits());
+            ASSERT_OK(largeSort.checkLimits());
+
+            // Over the budget
+            idleSort.set(4 * kMB);
+            ASSERT_OK(smallSort.checkLimits());
+            ASSERT_OK(idleSort.checkLimits());
+            ASSERT_EQUALS(ErrorCodes::ExceededMemoryLimit, largeSort.checkLimits().code());
+
+            // The small one becomes the largest
+            smallSort.set(12 * kMB);
+            ASSERT_EQUALS(ErrorCodes::ExceededMemoryLimit, smallSort.checkLimits().code());
+            ASSERT_OK(largeSort.checkLimits());
+
+            // Back under the budget
+            smallSort.set(0);
+            ASSERT_OK(largeSort.checkLimits());
+        }
+
+    }  // namespace
+
+}  // namespace mongo
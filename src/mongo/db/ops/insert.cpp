@@ -175,6 +175,7 @@ namespace mongo {
                 if ( coll == "system.roles" ) return Status::OK();
                 if ( coll == "system.new_users" ) return Status::OK();
                 if ( coll == "system.backup_users" ) return Status::OK();
+                if ( coll == "system.plancache" ) return Status::OK();
             }
             if ( db == "local" ) {
                 if ( coll == "system.replset" ) return Status::OK();
@@ -28,6 +28,8 @@
 
 #include "mongo/db/ops/update_driver.h"
 
+#include <limits>
+
 #include "mongo/base/error_codes.h"
 #include "mongo/base/string_data.h"
 #include "mongo/bson/mutable/algorithm.h"
@@ -54,7 +56,10 @@ namespace mongo {
         , _logOp(opts.logOp)
         , _modOptions(opts.modOptions)
         , _affectIndices(false)
-        , _positional(false) {
+        , _positional(false)
+        , _inPlaceCandidate(false)
+        , _analyzable(true)
+        , _modsAnalyzed(false) {
     }
 
     UpdateDriver::~UpdateDriver() {
@@ -92,6 +97,8 @@ namespace mongo {
 
         // The update expression is made of mod operators, that is
         // { <$mod>: {...}, <$mod>: {...}, ...  }
+        BSONObjBuilder inPlaceArgs;
+        bool inPlaceCandidate = true;
         BSONObjIterator outerIter(updateExpr);
         while (outerIter.more()) {
             BSONElement outerModElem = outerIter.next();
@@ -128,6 +135,20 @@ namespace mongo {
                 if (!status.isOK()) {
                     return status;
                 }
+
+                if (modType == modifiertable::MOD_SET || modType == modifiertable::MOD_INC) {
+                    inPlaceArgs.append(innerModElem);
+                    _inPlaceTypes.push_back(modType);
+                }
+                else {
+                    inPlaceCandidate = false;
+                }
+
+                // A $rename names no fields when its source is missing, so what it touches
+                // depends on the document.
+                if (modType == modifiertable::MOD_RENAME) {
+                    _analyzable = false;
+                }
             }
         }
 
@@ -135,6 +156,23 @@ namespace mongo {
         // replacement.
         _replacementMode = false;
 
+        // Work out whether updateInPlace() may apply. Conflicting mods are left for update()
+        // to report.
+        _inPlaceArgs = inPlaceArgs.obj();
+        _inPlaceCandidate = inPlaceCandidate && !_positional;
+        if (_inPlaceCandidate) {
+            FieldRefSet paths;
+            BSONForEach(arg, _inPlaceArgs) {
+                FieldRef* path = new FieldRef(arg.fieldNameStringData());
+                _inPlacePaths.mutableVector().push_back(path);
+
+                const FieldRef* conflict;
+                if (!paths.insert(path, &conflict)) {
+                    _inPlaceCandidate = false;
+                }
+            }
+        }
+
         return Status::OK();
     }
 
@@ -232,11 +270,19 @@ namespace mongo {
             targetFields = targetFieldScopedPtr.get();
         }
 
+        if (_modsAnalyzed) {
+            return updateAnalyzed(matchedField, doc, logOpRec, updatedFields);
+        }
+
         _affectIndices = false;
 
         _logDoc.reset();
         LogBuilder logBuilder(_logDoc.root());
 
+        // Recorded as we go, for the documents after this one; see _modsAnalyzed.
+        std::vector<ModAnalysis> analysis;
+        std::vector<FieldRef*> analyzedFields;
+
         // Ask each of the mods to type check whether they can operate over the current document
         // and, if so, to change that document accordingly.
         for (vector<ModifierInterface*>::iterator it = _mods.begin(); it != _mods.end(); ++it) {
@@ -252,8 +298,13 @@ namespace mongo {
             const bool validContext = (execInfo.context == ModifierInterface::ExecInfo::ANY_CONTEXT ||
                                        execInfo.context == _context);
 
+            ModAnalysis modAnalysis;
+            modAnalysis.validContext = validContext;
+            modAnalysis.mightAffectIndices = false;
+
             // Nothing to do if not in a valid context.
             if (!validContext) {
+                analysis.push_back(modAnalysis);
                 continue;
             }
 
@@ -283,14 +334,17 @@ namespace mongo {
                 // non-in-place mode.
                 //
                 // TODO: make mightBeIndexed and fieldRef like each other.
-                if (!_affectIndices &&
-                    !execInfo.noOp &&
-                    _indexedFields &&
+                analyzedFields.push_back(execInfo.fieldRef[i]);
+                if (_indexedFields &&
                     _indexedFields->mightBeIndexed(execInfo.fieldRef[i]->dottedField())) {
+                    modAnalysis.mightAffectIndices = true;
+                }
+                if (!_affectIndices && !execInfo.noOp && modAnalysis.mightAffectIndices) {
                     _affectIndices = true;
                     doc->disableInPlaceUpdates();
                 }
             }
+            analysis.push_back(modAnalysis);
 
             if (!execInfo.noOp) {
                 status = (*it)->apply();
@@ -309,12 +363,276 @@ namespace mongo {
 
         }
 
+        if (_logOp && logOpRec)
+            *logOpRec = _logDoc.getObject();
+
+        if (_analyzable && !_positional) {
+            _modAnalysis.swap(analysis);
+            _modFields.swap(analyzedFields);
+            _modsAnalyzed = true;
+        }
+
+        return Status::OK();
+    }
+
+    Status UpdateDriver::updateAnalyzed(const StringData& matchedField,
+                                        mutablebson::Document* doc,
+                                        BSONObj* logOpRec,
+                                        FieldRefSet* updatedFields) {
+        dassert(_modAnalysis.size() == _mods.size());
+
+        _affectIndices = false;
+
+        _logDoc.reset();
+        LogBuilder logBuilder(_logDoc.root());
+
+        for (size_t i = 0; i < _mods.size(); ++i) {
+            ModifierInterface::ExecInfo execInfo;
+            Status status = _mods[i]->prepare(doc->root(), matchedField, &execInfo);
+            if (!status.isOK()) {
+                return status;
+            }
+
+            if (!_modAnalysis[i].validContext || execInfo.noOp) {
+                continue;
+            }
+
+            if (!_affectIndices && _modAnalysis[i].mightAffectIndices) {
+                _affectIndices = true;
+                doc->disableInPlaceUpdates();
+            }
+
+            status = _mods[i]->apply();
+            if (!status.isOK()) {
+                return status;
+            }
+
+            if (_logOp && logOpRec) {
+                status = _mods[i]->log(&logBuilder);
+                if (!status.isOK()) {
+                    return status;
+                }
+            }
+        }
+
+        if (updatedFields) {
+            updatedFields->fillFrom(_modFields);
+        }
+
         if (_logOp && logOpRec)
             *logOpRec = _logDoc.getObject();
 
         return Status::OK();
     }
 
+    namespace {
+
+        /** Types whose values can be overwritten in place by another value of the same type. */
+        bool isFixedWidth(BSONType type) {
+            switch (type) {
+            case NumberDouble:
+            case NumberInt:
+            case NumberLong:
+            case Bool:
+            case Date:
+            case Timestamp:
+            case jstOID:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * Finds the value 'path' names in 'obj', going through embedded objects only. Returns
+         * EOO if the path isn't there or goes through anything else, such as an array.
+         */
+        BSONElement findInPlaceTarget(const BSONObj& obj, const FieldRef& path) {
+            BSONObj parent = obj;
+            for (size_t i = 0; i + 1 < path.numParts(); i++) {
+                const BSONElement child = parent[path.getPart(i)];
+                if (child.type() != Object) {
+                    return BSONElement();
+                }
+                parent = child.embeddedObject();
+            }
+            return parent[path.getPart(path.numParts() - 1)];
+        }
+
+        /**
+         * Appends 'current' + 'inc' to 'logBuilder' and its value to 'buffer', following the
+         * SafeNum promotion rules that ModifierInc uses. Returns false if the sum wouldn't have
+         * the type of 'current', or is invalid. Sets '*noOp' and appends nothing if the sum is
+         * identical to 'current'.
+         */
+        bool appendIncrement(const BSONElement& current,
+                             const BSONElement& inc,
+                             const StringData& fieldName,
+                             BufBuilder* buffer,
+                             BSONObjBuilder* logBuilder,
+                             bool* noOp) {
+            *noOp = false;
+            switch (current.type()) {
+            case NumberInt: {
+                if (inc.type() != NumberInt) {
+                    return false; // promoted to long or double
+                }
+                const long long sum = static_cast<long long>(current._numberInt()) +
+                                      inc._numberInt();
+                if (sum > std::numeric_limits<int>::max() ||
+                    sum < std::numeric_limits<int>::min()) {
+                    return false; // promoted to long
+                }
+                const int value = static_cast<int>(sum);
+                if (value == current._numberInt()) {
+                    *noOp = true;
+                    return true;
+                }
+                buffer->appendNum(value);
+                if (logBuilder) {
+                    logBuilder->append(fieldName, value);
+                }
+                return true;
+            }
+            case NumberLong: {
+                if (inc.type() != NumberInt && inc.type() != NumberLong) {
+                    return false; // promoted to double
+                }
+                const long long lhs = current._numberLong();
+                const long long rhs = inc.numberLong();
+                if ((rhs > 0 && lhs > std::numeric_limits<long long>::max() - rhs) ||
+                    (rhs < 0 && lhs < std::numeric_limits<long long>::min() - rhs)) {
+                    return false; // overflow, which $inc reports as an error
+                }
+                const long long value = lhs + rhs;
+                if (value == lhs) {
+                    *noOp = true;
+                    return true;
+                }
+                buffer->appendNum(value);
+                if (logBuilder) {
+                    logBuilder->append(fieldName, value);
+                }
+                return true;
+            }
+            case NumberDouble: {
+                const double value = inc.numberDouble() + current._numberDouble();
+                if (value == current._numberDouble()) {
+                    *noOp = true;
+                    return true;
+                }
+                buffer->appendNum(value);
+                if (logBuilder) {
+                    logBuilder->append(fieldName, value);
+                }
+                return true;
+            }
+            default:
+                return false; // update() reports the type mismatch
+            }
+        }
+
+    } // namespace
+
+    bool UpdateDriver::updateInPlace(const BSONObj& obj,
+                                     const std::vector<FieldRef*>* immutableFields,
+                                     mutablebson::DamageVector* damages,
+                                     const char** source,
+                                     BSONObj* logOpRec) {
+        if (!_inPlaceCandidate || _context != ModifierInterface::ExecInfo::UPDATE_CONTEXT)
+            return false;
+
+        // Otherwise the caller would have to add _id or move it to the front.
+        if (!str::equals(obj.firstElementFieldName(), "_id"))
+            return false;
+
+        if (_inPlaceIndexed.empty()) {
+            for (size_t i = 0; i < _inPlacePaths.size(); ++i) {
+                const FieldRef& path = *_inPlacePaths[i];
+                _inPlaceIndexed.push_back(_indexedFields &&
+                                          _indexedFields->mightBeIndexed(path.dottedField()));
+            }
+        }
+
+        damages->clear();
+        _inPlaceBuffer.reset();
+
+        const bool shouldLog = _logOp && logOpRec;
+        BSONObjBuilder setsBuilder;
+
+        BSONObjIterator argIt(_inPlaceArgs);
+        for (size_t i = 0; i < _inPlaceTypes.size(); ++i) {
+            const BSONElement arg = argIt.next();
+            const FieldRef& path = *_inPlacePaths[i];
+
+            // Leave anything that needs index maintenance or immutability checks to update().
+            if (path.getPart(0) == "_id")
+                return false;
+
+            if (immutableFields) {
+                for (size_t j = 0; j < immutableFields->size(); ++j) {
+                    const FieldRef& immutable = *(*immutableFields)[j];
+                    if (path.commonPrefixSize(immutable) ==
+                            std::min(path.numParts(), immutable.numParts())) {
+                        return false;
+                    }
+                }
+            }
+
+            if (_inPlaceIndexed[i])
+                return false;
+
+            const BSONElement current = findInPlaceTarget(obj, path);
+            if (current.eoo() || !isFixedWidth(current.type()))
+                return false;
+
+            const int sourceOffset = _inPlaceBuffer.len();
+            if (_inPlaceTypes[i] == modifiertable::MOD_SET) {
+                // A value that compares equal is a no-op, as in ModifierSet::prepare().
+                if (current.woCompare(arg, false) == 0)
+                    continue;
+
+                if (current.type() != arg.type())
+                    return false;
+
+                _inPlaceBuffer.appendBuf(arg.value(), arg.valuesize());
+                if (shouldLog) {
+                    setsBuilder.appendAs(arg, path.dottedField());
+                }
+            }
+            else {
+                bool noOp;
+                if (!appendIncrement(current,
+                                     arg,
+                                     path.dottedField(),
+                                     &_inPlaceBuffer,
+                                     shouldLog ? &setsBuilder : NULL,
+                                     &noOp)) {
+                    return false;
+                }
+                if (noOp)
+                    continue;
+            }
+
+            mutablebson::DamageEvent damage;
+            damage.sourceOffset = sourceOffset;
+            damage.targetOffset = current.value() - obj.objdata();
+            damage.size = _inPlaceBuffer.len() - sourceOffset;
+            damages->push_back(damage);
+        }
+
+        _affectIndices = false;
+        *source = _inPlaceBuffer.buf();
+
+        if (shouldLog) {
+            // Both $set and $inc log the values they wrote under $set; see LogBuilder.
+            const BSONObj sets = setsBuilder.obj();
+            *logOpRec = sets.isEmpty() ? BSONObj() : BSON("$set" << sets);
+        }
+
+        return true;
+    }
+
     size_t UpdateDriver::numMods() const {
         return _mods.size();
     }
@@ -329,6 +647,8 @@ namespace mongo {
 
     void UpdateDriver::refreshIndexKeys(const UpdateIndexData* indexedFields) {
         _indexedFields = indexedFields;
+        _inPlaceIndexed.clear();
+        _modsAnalyzed = false;
     }
 
     bool UpdateDriver::logOp() const {
@@ -353,18 +673,21 @@ namespace mongo {
 
     void UpdateDriver::setContext(ModifierInterface::ExecInfo::UpdateContext context) {
         _context = context;
+        _modsAnalyzed = false;
     }
 
     BSONObj UpdateDriver::makeOplogEntryQuery(const BSONObj& doc, bool multi) const {
-        BSONObjBuilder idPattern;
         BSONElement id;
         // NOTE: If the matching object lacks an id, we'll log
         // with the original pattern.  This isn't replay-safe.
         // It might make sense to suppress the log instead
         // if there's no id.
         if ( doc.getObjectID( id ) ) {
+           // This is built for every document a multi-update touches; an exactly sized copy
+           // out of a recycled buffer beats a fresh 512 byte builder each time.
+           BSONObjBuilder idPattern( BufBuilderArena::current() );
            idPattern.append( id );
-           return idPattern.obj();
+           return idPattern.done().getOwned();
         }
         else {
            uassert( 16980,
@@ -382,6 +705,15 @@ namespace mongo {
         _indexedFields = NULL;
         _replacementMode = false;
         _positional = false;
+        _inPlaceCandidate = false;
+        _inPlaceTypes.clear();
+        _inPlacePaths.clear();
+        _inPlaceArgs = BSONObj();
+        _inPlaceIndexed.clear();
+        _analyzable = true;
+        _modsAnalyzed = false;
+        _modAnalysis.clear();
+        _modFields.clear();
     }
 
 } // namespace mongo
@@ -33,6 +33,7 @@
 
 #include "mongo/base/owned_pointer_vector.h"
 #include "mongo/base/status.h"
+#include "mongo/bson/mutable/damage_vector.h"
 #include "mongo/bson/mutable/document.h"
 #include "mongo/db/field_ref_set.h"
 #include "mongo/db/jsobj.h"
@@ -100,6 +101,24 @@ namespace mongo {
                       BSONObj* logOpRec = NULL,
                       FieldRefSet* updatedFields = NULL);
 
+        /**
+         * Applies the update to 'obj' without building a mutablebson::Document. This is only
+         * possible when every mod is a non-positional $set or $inc that overwrites an existing
+         * value with one of the same fixed-width type (an $inc must not change the field's
+         * type), _id is the first field, and no mod touches _id, an 'immutableFields' path or
+         * an indexed field. Returns false, having done nothing, otherwise; the caller should
+         * then go through update().
+         *
+         * On success fills 'damages' with the changes to make to 'obj', whose new bytes are at
+         * the given offsets in '*source'; that buffer stays valid until the next call. The
+         * oplog entry is produced as by update(), and is empty if every mod was a no-op.
+         */
+        bool updateInPlace(const BSONObj& obj,
+                           const std::vector<FieldRef*>* immutableFields,
+                           mutablebson::DamageVector* damages,
+                           const char** source,
+                           BSONObj* logOpRec = NULL);
+
         //
         // Accessors
         //
@@ -141,6 +160,21 @@ namespace mongo {
         inline Status addAndParse(const modifiertable::ModifierType type,
                                   const BSONElement& elem);
 
+        /**
+         * Does the work of update() once _modsAnalyzed is set, relying on the recorded
+         * analysis instead of checking each mod's fields again.
+         */
+        Status updateAnalyzed(const StringData& matchedField,
+                              mutablebson::Document* doc,
+                              BSONObj* logOpRec,
+                              FieldRefSet* updatedFields);
+
+        /** What update() learned about a mod that holds for every document; see below. */
+        struct ModAnalysis {
+            bool validContext;
+            bool mightAffectIndices;
+        };
+
         //
         // immutable properties after parsing
         //
@@ -177,6 +211,33 @@ namespace mongo {
         // Is this update going to be an upsert?
         ModifierInterface::ExecInfo::UpdateContext _context;
 
+        // Set by parse() if every mod is a non-positional $set or $inc and no two mods
+        // conflict, so that updateInPlace() is worth trying. The mods' types and paths are kept
+        // in parallel with their arguments, which are the elements of _inPlaceArgs.
+        bool _inPlaceCandidate;
+        std::vector<modifiertable::ModifierType> _inPlaceTypes;
+        OwnedPointerVector<FieldRef> _inPlacePaths;
+        BSONObj _inPlaceArgs;
+
+        // Whether each of _inPlacePaths might be indexed, filled in by the first call to
+        // updateInPlace() after parsing or refreshIndexKeys().
+        std::vector<bool> _inPlaceIndexed;
+
+        // Holds the new values written by updateInPlace().
+        BufBuilder _inPlaceBuffer;
+
+        // A multi-document update runs the same mods over many documents. Unless the mods are
+        // positional, the fields each mod touches are its own and the same for every document,
+        // so once update() has applied them cleanly, the context check, the conflict check
+        // and the index check come out the same each time. _modAnalysis then holds the first
+        // and last of those per mod, parallel to _mods, and _modFields the fields that passed
+        // the conflict check. Reset by parse(), refreshIndexKeys() and setContext().
+        // parse() clears _analyzable if a mod's fields can vary anyway, as a $rename's do.
+        bool _analyzable;
+        bool _modsAnalyzed;
+        std::vector<ModAnalysis> _modAnalysis;
+        std::vector<FieldRef*> _modFields; // not owned here
+
         // The document used to represent or store the object being updated.
         mutablebson::Document _objDoc;
 
@@ -34,9 +34,11 @@
 
 #include "mongo/base/owned_pointer_vector.h"
 #include "mongo/base/string_data.h"
+#include "mongo/bson/mutable/damage_vector.h"
 #include "mongo/bson/mutable/document.h"
 #include "mongo/bson/mutable/mutable_bson_test_utils.h"
 #include "mongo/db/field_ref.h"
+#include "mongo/db/field_ref_set.h"
 #include "mongo/db/json.h"
 #include "mongo/db/update_index_data.h"
 #include "mongo/unittest/unittest.h"
@@ -47,9 +49,12 @@ namespace {
     using mongo::BSONElement;
     using mongo::BSONObjIterator;
     using mongo::FieldRef;
+    using mongo::FieldRefSet;
     using mongo::fromjson;
     using mongo::OwnedPointerVector;
+    using mongo::ModifierInterface;
     using mongo::UpdateIndexData;
+    using mongo::mutablebson::DamageVector;
     using mongo::mutablebson::Document;
     using mongo::StringData;
     using mongo::UpdateDriver;
@@ -401,4 +406,279 @@ namespace {
                                                                    doc()));
     }
 
+    //
+    // Tests of applying the same update to several documents, as a multi update does
+    //
+
+    class ManyDocs : public mongo::unittest::Test {
+    public:
+        ManyDocs() : _driver(UpdateDriver::Options()) {
+            _driver.setContext(ModifierInterface::ExecInfo::UPDATE_CONTEXT);
+        }
+
+        UpdateDriver& driver() {
+            return _driver;
+        }
+
+        void parse(const BSONObj& mods) {
+            _mods = mods;
+            ASSERT_OK(_driver.parse(_mods));
+        }
+
+        /** Runs the update over 'obj' and returns the result. */
+        BSONObj update(const BSONObj& obj, FieldRefSet* updatedFields = NULL) {
+            _doc.reset(obj, Document::kInPlaceEnabled);
+            ASSERT_OK(_driver.update(StringData(), &_doc, NULL, updatedFields));
+            return _doc.getObject();
+        }
+
+    private:
+        UpdateDriver _driver;
+        BSONObj _mods;
+        Document _doc;
+    };
+
+    TEST_F(ManyDocs, SameResults) {
+        parse(fromjson("{$set:{a:5}, $inc:{'b.c':1}, $setOnInsert:{d:1}, $unset:{e:1}}"));
+        ASSERT_EQUALS(fromjson("{a:5, b:{c:2}}"), update(fromjson("{a:1, b:{c:1}, e:1}")));
+        ASSERT_EQUALS(fromjson("{a:5, b:{c:1}}"), update(fromjson("{}")));
+        ASSERT_EQUALS(fromjson("{b:{c:3}, f:1, a:5}"), update(fromjson("{b:{c:2}, f:1}")));
+    }
+
+    TEST_F(ManyDocs, UpdatedFields) {
+        parse(fromjson("{$set:{a:5, 'b.c':1}, $setOnInsert:{d:1}}"));
+        for (int i = 0; i < 3; i++) {
+            FieldRefSet updatedFields;
+            update(BSON("a" << i), &updatedFields);
+            ASSERT_EQUALS(std::string("Fields:[ a,b.c,]"), updatedFields.toString());
+        }
+    }
+
+    TEST_F(ManyDocs, AffectIndices) {
+        UpdateIndexData indexedFields;
+        indexedFields.addPath("a");
+        parse(fromjson("{$set:{a:5, b:1}}"));
+        driver().refreshIndexKeys(&indexedFields);
+
+        update(fromjson("{a:1, b:1}"));
+        ASSERT_TRUE(driver().modsAffectIndices());
+
+        // Only a mod that does something can affect an index.
+        update(fromjson("{a:5, b:2}"));
+        ASSERT_FALSE(driver().modsAffectIndices());
+
+        update(fromjson("{a:2, b:2}"));
+        ASSERT_TRUE(driver().modsAffectIndices());
+    }
+
+    TEST_F(ManyDocs, RefreshIndexKeys) {
+        parse(fromjson("{$set:{a:5}}"));
+        update(fromjson("{a:1}"));
+        ASSERT_FALSE(driver().modsAffectIndices());
+
+        UpdateIndexData indexedFields;
+        indexedFields.addPath("a");
+        driver().refreshIndexKeys(&indexedFields);
+        update(fromjson("{a:2}"));
+        ASSERT_TRUE(driver().modsAffectIndices());
+    }
+
+    TEST_F(ManyDocs, Positional) {
+        parse(fromjson("{$set:{'a.$':5}}"));
+        Document doc(fromjson("{a:[1, 2]}"));
+        ASSERT_OK(driver().update("0", &doc));
+        ASSERT_OK(driver().update("1", &doc));
+        ASSERT_EQUALS(fromjson("{a:[5, 5]}"), doc.getObject());
+    }
+
+    TEST_F(ManyDocs, Rename) {
+        parse(fromjson("{$rename:{a:'b'}, $set:{'b.c':1}}"));
+        update(fromjson("{x:1}"));
+        Document doc(fromjson("{a:1}"));
+        ASSERT_NOT_OK(driver().update(StringData(), &doc));
+    }
+
+    //
+    // Tests of updating a document in place, without a mutable document
+    //
+
+    class InPlace : public mongo::unittest::Test {
+    public:
+        InPlace() : _driver(opts()) {
+            _driver.setContext(ModifierInterface::ExecInfo::UPDATE_CONTEXT);
+        }
+
+        UpdateDriver& driver() {
+            return _driver;
+        }
+
+        /** Parses 'mods', which the driver's mods refer to, and keeps it alive. */
+        void parse(const BSONObj& mods) {
+            _mods = mods;
+            ASSERT_OK(_driver.parse(_mods));
+        }
+
+        /**
+         * Runs updateInPlace() on 'obj' and, if it succeeds, returns a copy of 'obj' with the
+         * damages applied through '*result'.
+         */
+        bool updateInPlace(const BSONObj& obj,
+                           BSONObj* result,
+                           BSONObj* logOpRec = NULL,
+                           const std::vector<FieldRef*>* immutableFields = NULL) {
+            DamageVector damages;
+            const char* source = NULL;
+            if (!_driver.updateInPlace(obj, immutableFields, &damages, &source, logOpRec))
+                return false;
+
+            BSONObj copy = obj.copy();
+            char* data = const_cast<char*>(copy.objdata());
+            for (size_t i = 0; i < damages.size(); i++) {
+                memcpy(data + damages[i].targetOffset,
+                       source + damages[i].sourceOffset,
+                       damages[i].size);
+            }
+            *result = copy;
+            return true;
+        }
+
+        /** Checks that the in place result matches what update() would have produced. */
+        void assertMatchesUpdate(const BSONObj& obj, const BSONObj& result) {
+            Document doc(obj);
+            ASSERT_OK(_driver.update(StringData(), &doc));
+            ASSERT_EQUALS(doc.getObject(), result);
+        }
+
+    private:
+        static UpdateDriver::Options opts() {
+            UpdateDriver::Options opts;
+            opts.logOp = true;
+            return opts;
+        }
+
+        UpdateDriver _driver;
+        BSONObj _mods;
+    };
+
+    TEST_F(InPlace, SetSameType) {
+        parse(fromjson("{$set:{a:2, 'b.c':true}}"));
+        BSONObj obj = fromjson("{_id:1, a:1, b:{c:false}}");
+        BSONObj result;
+        BSONObj logOp;
+        ASSERT_TRUE(updateInPlace(obj, &result, &logOp));
+        ASSERT_EQUALS(fromjson("{_id:1, a:2, b:{c:true}}"), result);
+        ASSERT_EQUALS(fromjson("{$set:{a:2, 'b.c':true}}"), logOp);
+        ASSERT_FALSE(driver().modsAffectIndices());
+        assertMatchesUpdate(obj, result);
+    }
+
+    TEST_F(InPlace, IncStaysInt) {
+        parse(fromjson("{$inc:{a:1, b:-2}}"));
+        BSONObj obj = BSON("_id" << 1 << "a" << 1 << "b" << 10LL);
+        BSONObj result;
+        BSONObj logOp;
+        ASSERT_TRUE(updateInPlace(obj, &result, &logOp));
+        ASSERT_EQUALS(BSON("_id" << 1 << "a" << 2 << "b" << 8LL), result);
+        ASSERT_EQUALS(BSON("$set" << BSON("a" << 2 << "b" << 8LL)), logOp);
+        assertMatchesUpdate(obj, result);
+    }
+
+    TEST_F(InPlace, IncDouble) {
+        parse(fromjson("{$inc:{a:1}}"));
+        BSONObj obj = fromjson("{_id:1, a:1.5}");
+        BSONObj result;
+        ASSERT_TRUE(updateInPlace(obj, &result));
+        ASSERT_EQUALS(fromjson("{_id:1, a:2.5}"), result);
+        assertMatchesUpdate(obj, result);
+    }
+
+    TEST_F(InPlace, NoOps) {
+        parse(fromjson("{$set:{a:1}, $inc:{b:0}}"));
+        BSONObj obj = fromjson("{_id:1, a:1, b:2}");
+        BSONObj result;
+        BSONObj logOp = fromjson("{x:1}");
+        ASSERT_TRUE(updateInPlace(obj, &result, &logOp));
+        ASSERT_EQUALS(obj, result);
+        ASSERT_TRUE(logOp.isEmpty());
+    }
+
+    TEST_F(InPlace, IntOverflowPromotes) {
+        parse(BSON("$inc" << BSON("a" << 1)));
+        BSONObj obj = BSON("_id" << 1 << "a" << std::numeric_limits<int>::max());
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(obj, &result));
+    }
+
+    TEST_F(InPlace, IncByLongPromotes) {
+        parse(BSON("$inc" << BSON("a" << 1LL)));
+        BSONObj obj = fromjson("{_id:1, a:1}");
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(obj, &result));
+    }
+
+    TEST_F(InPlace, SetDifferentType) {
+        parse(fromjson("{$set:{a:1.5}}"));
+        BSONObj obj = fromjson("{_id:1, a:1}");
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(obj, &result));
+    }
+
+    TEST_F(InPlace, SetVariableWidth) {
+        parse(fromjson("{$set:{a:'xyz'}}"));
+        BSONObj obj = fromjson("{_id:1, a:'abc'}");
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(obj, &result));
+    }
+
+    TEST_F(InPlace, MissingField) {
+        parse(fromjson("{$set:{'a.b':1}}"));
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(fromjson("{_id:1}"), &result));
+        ASSERT_FALSE(updateInPlace(fromjson("{_id:1, a:{}}"), &result));
+        ASSERT_FALSE(updateInPlace(fromjson("{_id:1, a:[{b:2}]}"), &result));
+    }
+
+    TEST_F(InPlace, IdNotFirst) {
+        parse(fromjson("{$set:{a:2}}"));
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(fromjson("{a:1, _id:1}"), &result));
+    }
+
+    TEST_F(InPlace, IdOrImmutableField) {
+        parse(fromjson("{$set:{'a.b':2}}"));
+        BSONObj obj = fromjson("{_id:1, a:{b:1}}");
+        OwnedPointerVector<FieldRef> immutablePaths;
+        immutablePaths.push_back(new FieldRef("a"));
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(obj, &result, NULL, &immutablePaths.vector()));
+
+        parse(fromjson("{$set:{_id:2}}"));
+        ASSERT_FALSE(updateInPlace(fromjson("{_id:1}"), &result));
+    }
+
+    TEST_F(InPlace, IndexedField) {
+        parse(fromjson("{$inc:{a:1}}"));
+        UpdateIndexData indexedFields;
+        indexedFields.addPath("a");
+        driver().refreshIndexKeys(&indexedFields);
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(fromjson("{_id:1, a:1}"), &result));
+    }
+
+    TEST_F(InPlace, OtherModsAndPositional) {
+        BSONObj result;
+        parse(fromjson("{$set:{a:2}, $unset:{b:1}}"));
+        ASSERT_FALSE(updateInPlace(fromjson("{_id:1, a:1, b:1}"), &result));
+
+        parse(fromjson("{$set:{'a.$':2}}"));
+        ASSERT_FALSE(updateInPlace(fromjson("{_id:1, a:[1]}"), &result));
+    }
+
+    TEST_F(InPlace, NotUpdateContext) {
+        driver().setContext(ModifierInterface::ExecInfo::INSERT_CONTEXT);
+        parse(fromjson("{$set:{a:2}}"));
+        BSONObj result;
+        ASSERT_FALSE(updateInPlace(fromjson("{_id:1, a:1}"), &result));
+    }
+
 } // unnamed namespace
@@ -33,6 +33,7 @@
 #include <boost/unordered_set.hpp>
 
 #include "mongo/bson/bsontypes.h"
+#include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/value.h"
 
 namespace mongo {
@@ -53,6 +54,14 @@ namespace mongo {
         /// The name of the op as used in a serialization of the pipeline.
         virtual const char* getOpName() const = 0;
 
+        /**
+         * Serializes this accumulator applied to 'argument', the serialized expression it
+         * accumulates.  Accumulators which take options besides their input override this.
+         */
+        virtual Value serialize(const Value& argument) const {
+            return Value(DOC(getOpName() << argument));
+        }
+
         int memUsageForSorter() const {
             dassert(_memUsageBytes != 0); // This would mean subclass didn't set it
             return _memUsageBytes;
@@ -172,6 +181,94 @@ namespace mongo {
     };
 
 
+    /**
+     * Estimates the number of distinct values with a HyperLogLog sketch, in fixed memory.
+     *
+     * Until it has seen kMaxExactHashes distinct values it keeps their hashes and the count is
+     * exact, apart from hash collisions.  After that it keeps 2^kPrecision registers, for a
+     * standard error of about 1.6%.  Values are hashed like group keys, so 1, 1.0 and
+     * NumberLong(1) are the same value.
+     */
+    class AccumulatorApproxCountDistinct : public Accumulator {
+    public:
+        virtual void processInternal(const Value& input, bool merging);
+        virtual Value getValue(bool toBeMerged) const;
+        virtual const char* getOpName() const;
+        virtual void reset();
+
+        static intrusive_ptr<Accumulator> create();
+
+        static const int kPrecision = 12;
+        static const size_t kNumRegisters = 1 << kPrecision;
+        static const size_t kMaxExactHashes = kNumRegisters / sizeof(unsigned long long);
+
+    private:
+        AccumulatorApproxCountDistinct();
+
+        void addHash(unsigned long long hash);
+        void addToRegisters(unsigned long long hash);
+        void switchToRegisters();
+        long long estimate() const;
+
+        std::vector<unsigned long long> _hashes; // sorted; only until there are _registers
+        std::vector<unsigned char> _registers; // empty until there are too many hashes
+    };
+
+
+    /**
+     * Estimates percentiles of the numeric inputs with a t-digest, which keeps the inputs
+     * compressed into a bounded number of weighted centroids, most finely near the extremes.
+     * Non-numeric inputs are ignored, as by $avg.
+     */
+    class AccumulatorPercentile : public Accumulator {
+    public:
+        virtual void processInternal(const Value& input, bool merging);
+        virtual Value getValue(bool toBeMerged) const;
+        virtual const char* getOpName() const;
+        virtual Value serialize(const Value& argument) const;
+        virtual void reset();
+
+        /**
+         * @param percentiles the fractions to estimate, each in [0, 1]
+         * @param asArray whether to output an array of estimates rather than a single one; only
+         *                false if there is exactly one percentile
+         */
+        static intrusive_ptr<Accumulator> create(const std::vector<double>& percentiles,
+                                                 bool asArray);
+
+        // More centroids mean better estimates; there are at most about this many.
+        static const int kCompression = 100;
+
+    private:
+        struct Centroid {
+            Centroid(double mean, double weight) : mean(mean), weight(weight) {}
+            bool operator<(const Centroid& other) const { return mean < other.mean; }
+
+            double mean;
+            double weight;
+        };
+
+        AccumulatorPercentile(const std::vector<double>& percentiles, bool asArray);
+
+        void add(const Centroid& centroid);
+
+        /** Sets 'out' to _centroids merged with _buffer, sorted by mean. */
+        void compress(std::vector<Centroid>* out) const;
+
+        static double quantile(const std::vector<Centroid>& centroids, double totalWeight,
+                               double min, double max, double fraction);
+
+        const std::vector<double> _percentiles;
+        const bool _asArray;
+
+        std::vector<Centroid> _centroids; // compressed, sorted by mean
+        std::vector<Centroid> _buffer; // added since the last compression
+        double _totalWeight;
+        double _min;
+        double _max;
+    };
+
+
     class AccumulatorAvg : public Accumulator {
     public:
         virtual void processInternal(const Value& input, bool merging);
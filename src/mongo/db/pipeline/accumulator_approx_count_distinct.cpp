@@ -0,0 +1,205 @@
+/**
+ * Copyright (c) 2011 10gen Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+    const int AccumulatorApproxCountDistinct::kPrecision;
+    const size_t AccumulatorApproxCountDistinct::kNumRegisters;
+    const size_t AccumulatorApproxCountDistinct::kMaxExactHashes;
+
+namespace {
+    const char hashesName[] = "hashes";
+    const char registersName[] = "registers";
+
+    /**
+     * Value::hash_combine gives equal values equal hashes, but its low bits are poorly mixed for
+     * small numbers, so the result is passed through the MurmurHash3 finalizer.
+     */
+    unsigned long long hashValue(const Value& value) {
+        size_t seed = 0xcbf29ce4;
+        value.hash_combine(seed);
+
+        unsigned long long hash = seed;
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+}
+
+    void AccumulatorApproxCountDistinct::processInternal(const Value& input, bool merging) {
+        if (!merging) {
+            // like $addToSet, missing values aren't counted
+            if (!input.missing())
+                addHash(hashValue(input));
+            return;
+        }
+
+        // We expect what getValue(true) produced below: either the exact hashes or the
+        // registers of another sketch.
+        verify(input.getType() == Object);
+        const Value hashes = input[hashesName];
+        if (!hashes.missing()) {
+            const vector<Value>& array = hashes.getArray();
+            for (size_t i = 0; i < array.size(); i++) {
+                addHash(static_cast<unsigned long long>(array[i].getLong()));
+            }
+            return;
+        }
+
+        // Value doesn't expose BinData contents, so read them through BSON.
+        BSONObjBuilder builder;
+        builder << registersName << input[registersName];
+        const BSONObj registersObj = builder.done();
+        int length = 0;
+        const char* registers = registersObj.firstElement().binData(length);
+        verify(static_cast<size_t>(length) == kNumRegisters);
+
+        switchToRegisters();
+        for (size_t i = 0; i < kNumRegisters; i++) {
+            _registers[i] = std::max(_registers[i], static_cast<unsigned char>(registers[i]));
+        }
+    }
+
+    void AccumulatorApproxCountDistinct::addHash(unsigned long long hash) {
+        if (!_registers.empty()) {
+            addToRegisters(hash);
+            return;
+        }
+
+        vector<unsigned long long>::iterator it = std::lower_bound(_hashes.begin(),
+                                                                   _hashes.end(),
+                                                                   hash);
+        if (it != _hashes.end() && *it == hash)
+            return;
+
+        _hashes.insert(it, hash);
+        _memUsageBytes += sizeof(hash);
+
+        if (_hashes.size() > kMaxExactHashes)
+            switchToRegisters();
+    }
+
+    void AccumulatorApproxCountDistinct::addToRegisters(unsigned long long hash) {
+        // The top bits pick the register, which keeps the highest position of the first set bit
+        // among the rest.
+        const size_t index = hash >> (64 - kPrecision);
+        unsigned long long rest = hash << kPrecision;
+        unsigned char rank = 1;
+        while (rank <= 64 - kPrecision && !(rest & (1ULL << 63))) {
+            rest <<= 1;
+            rank++;
+        }
+        _registers[index] = std::max(_registers[index], rank);
+    }
+
+    void AccumulatorApproxCountDistinct::switchToRegisters() {
+        if (!_registers.empty())
+            return;
+
+        _registers.resize(kNumRegisters, 0);
+        for (size_t i = 0; i < _hashes.size(); i++) {
+            addToRegisters(_hashes[i]);
+        }
+        vector<unsigned long long>().swap(_hashes);
+        _memUsageBytes = sizeof(*this) + kNumRegisters;
+    }
+
+    long long AccumulatorApproxCountDistinct::estimate() const {
+        if (_registers.empty())
+            return _hashes.size();
+
+        const double m = kNumRegisters;
+        double sum = 0;
+        size_t zeros = 0;
+        for (size_t i = 0; i < kNumRegisters; i++) {
+            sum += std::ldexp(1.0, -_registers[i]);
+            if (_registers[i] == 0)
+                zeros++;
+        }
+
+        const double alpha = 0.7213 / (1 + 1.079 / m);
+        double estimate = alpha * m * m / sum;
+
+        // The raw estimate is biased for small cardinalities, where counting the empty registers
+        // does better.
+        if (estimate <= 2.5 * m && zeros != 0)
+            estimate = m * std::log(m / zeros);
+
+        return static_cast<long long>(estimate + 0.5);
+    }
+
+    Value AccumulatorApproxCountDistinct::getValue(bool toBeMerged) const {
+        if (!toBeMerged)
+            return Value::createIntOrLong(estimate());
+
+        if (_registers.empty()) {
+            vector<Value> hashes;
+            hashes.reserve(_hashes.size());
+            for (size_t i = 0; i < _hashes.size(); i++) {
+                hashes.push_back(Value(static_cast<long long>(_hashes[i])));
+            }
+            return Value(DOC(hashesName << Value::consume(hashes)));
+        }
+
+        return Value(DOC(registersName << Value(BSONBinData(&_registers[0],
+                                                            _registers.size(),
+                                                            BinDataGeneral))));
+    }
+
+    AccumulatorApproxCountDistinct::AccumulatorApproxCountDistinct() {
+        _memUsageBytes = sizeof(*this);
+    }
+
+    void AccumulatorApproxCountDistinct::reset() {
+        vector<unsigned long long>().swap(_hashes);
+        vector<unsigned char>().swap(_registers);
+        _memUsageBytes = sizeof(*this);
+    }
+
+    intrusive_ptr<Accumulator> AccumulatorApproxCountDistinct::create() {
+        return new AccumulatorApproxCountDistinct();
+    }
+
+    const char *AccumulatorApproxCountDistinct::getOpName() const {
+        return "$approxCountDistinct";
+    }
+}
@@ -0,0 +1,249 @@
+/**
+ * Copyright (c) 2011 10gen Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/platform/float_utils.h"
+
+namespace mongo {
+
+    const int AccumulatorPercentile::kCompression;
+
+namespace {
+    const char meansName[] = "means";
+    const char weightsName[] = "weights";
+    const char minName[] = "min";
+    const char maxName[] = "max";
+
+    // Inputs are buffered and compressed in batches of this many.
+    const size_t kBufferSize = 5 * AccumulatorPercentile::kCompression;
+
+    const double kPi = 3.14159265358979323846;
+
+    /**
+     * The t-digest scale function: each centroid may span at most one unit of k, which makes
+     * them smallest near q = 0 and q = 1, where the percentiles need the most resolution.
+     */
+    double scale(double q) {
+        return AccumulatorPercentile::kCompression / (2 * kPi) * std::asin(2 * q - 1);
+    }
+
+    double inverseScale(double k) {
+        const double angle = k * 2 * kPi / AccumulatorPercentile::kCompression;
+        if (angle >= kPi / 2)
+            return 1;
+        return (std::sin(angle) + 1) / 2;
+    }
+}
+
+    void AccumulatorPercentile::processInternal(const Value& input, bool merging) {
+        if (!merging) {
+            // Non-numeric types, and NaNs, which have no order, have no impact on percentiles.
+            if (!input.numeric())
+                return;
+
+            const double value = input.getDouble();
+            if (isNaN(value))
+                return;
+
+            _min = std::min(_min, value);
+            _max = std::max(_max, value);
+            add(Centroid(value, 1));
+            return;
+        }
+
+        // We expect the centroids of another digest, which is what getValue(true) produced below.
+        verify(input.getType() == Object);
+        const vector<Value>& means = input[meansName].getArray();
+        const vector<Value>& weights = input[weightsName].getArray();
+        verify(means.size() == weights.size());
+        if (means.empty())
+            return;
+
+        _min = std::min(_min, input[minName].getDouble());
+        _max = std::max(_max, input[maxName].getDouble());
+        for (size_t i = 0; i < means.size(); i++) {
+            add(Centroid(means[i].getDouble(), weights[i].getDouble()));
+        }
+    }
+
+    void AccumulatorPercentile::add(const Centroid& centroid) {
+        _buffer.push_back(centroid);
+        _totalWeight += centroid.weight;
+
+        if (_buffer.size() >= kBufferSize) {
+            vector<Centroid> compressed;
+            compress(&compressed);
+            _centroids.swap(compressed);
+            _buffer.clear();
+        }
+
+        _memUsageBytes = sizeof(*this)
+                       + _percentiles.size() * sizeof(double)
+                       + (_centroids.size() + _buffer.size()) * sizeof(Centroid);
+    }
+
+    void AccumulatorPercentile::compress(vector<Centroid>* out) const {
+        vector<Centroid> all(_centroids);
+        all.insert(all.end(), _buffer.begin(), _buffer.end());
+        std::sort(all.begin(), all.end());
+
+        out->clear();
+        if (all.empty())
+            return;
+
+        // Merge neighbours while the merged centroid stays within one unit of scale.
+        Centroid current = all[0];
+        double weightBefore = 0;
+        double limit = inverseScale(scale(0) + 1) * _totalWeight;
+        for (size_t i = 1; i < all.size(); i++) {
+            const double merged = current.weight + all[i].weight;
+            if (weightBefore + merged <= limit) {
+                current.mean += (all[i].mean - current.mean) * all[i].weight / merged;
+                current.weight = merged;
+            }
+            else {
+                out->push_back(current);
+                weightBefore += current.weight;
+                limit = inverseScale(scale(weightBefore / _totalWeight) + 1) * _totalWeight;
+                current = all[i];
+            }
+        }
+        out->push_back(current);
+    }
+
+    double AccumulatorPercentile::quantile(const vector<Centroid>& centroids, double totalWeight,
+                                           double min, double max, double fraction) {
+        // Each centroid's mean is taken to sit at the middle of its weight, with the extremes
+        // at either end, and the percentiles between them are interpolated linearly.
+        const double target = fraction * totalWeight;
+        double previousPosition = 0;
+        double previousValue = min;
+        double weightBefore = 0;
+        for (size_t i = 0; i < centroids.size(); i++) {
+            const double position = weightBefore + centroids[i].weight / 2;
+            if (target < position) {
+                const double width = position - previousPosition;
+                return previousValue
+                     + (centroids[i].mean - previousValue) * (target - previousPosition) / width;
+            }
+            previousPosition = position;
+            previousValue = centroids[i].mean;
+            weightBefore += centroids[i].weight;
+        }
+
+        const double width = totalWeight - previousPosition;
+        if (width <= 0)
+            return max;
+        return previousValue + (max - previousValue) * (target - previousPosition) / width;
+    }
+
+    Value AccumulatorPercentile::getValue(bool toBeMerged) const {
+        vector<Centroid> centroids;
+        compress(&centroids);
+
+        if (toBeMerged) {
+            vector<Value> means;
+            vector<Value> weights;
+            for (size_t i = 0; i < centroids.size(); i++) {
+                means.push_back(Value(centroids[i].mean));
+                weights.push_back(Value(centroids[i].weight));
+            }
+            return Value(DOC(minName << _min
+                          << maxName << _max
+                          << meansName << Value::consume(means)
+                          << weightsName << Value::consume(weights)));
+        }
+
+        if (centroids.empty())
+            return Value(BSONNULL);
+
+        vector<Value> estimates;
+        for (size_t i = 0; i < _percentiles.size(); i++) {
+            estimates.push_back(Value(quantile(centroids, _totalWeight, _min, _max,
+                                               _percentiles[i])));
+        }
+
+        if (!_asArray)
+            return estimates[0];
+        return Value::consume(estimates);
+    }
+
+    Value AccumulatorPercentile::serialize(const Value& argument) const {
+        Value percentiles;
+        if (_asArray) {
+            vector<Value> array;
+            for (size_t i = 0; i < _percentiles.size(); i++) {
+                array.push_back(Value(_percentiles[i]));
+            }
+            percentiles = Value::consume(array);
+        }
+        else {
+            percentiles = Value(_percentiles[0]);
+        }
+        return Value(DOC(getOpName() << DOC("input" << argument << "p" << percentiles)));
+    }
+
+    AccumulatorPercentile::AccumulatorPercentile(const vector<double>& percentiles, bool asArray)
+        : _percentiles(percentiles)
+        , _asArray(asArray)
+        , _totalWeight(0)
+        , _min(std::numeric_limits<double>::infinity())
+        , _max(-std::numeric_limits<double>::infinity())
+    {
+        verify(!_percentiles.empty());
+        verify(_asArray || _percentiles.size() == 1);
+        _memUsageBytes = sizeof(*this) + _percentiles.size() * sizeof(double);
+    }
+
+    void AccumulatorPercentile::reset() {
+        vector<Centroid>().swap(_centroids);
+        vector<Centroid>().swap(_buffer);
+        _totalWeight = 0;
+        _min = std::numeric_limits<double>::infinity();
+        _max = -std::numeric_limits<double>::infinity();
+        _memUsageBytes = sizeof(*this) + _percentiles.size() * sizeof(double);
+    }
+
+    intrusive_ptr<Accumulator> AccumulatorPercentile::create(const vector<double>& percentiles,
+                                                             bool asArray) {
+        return new AccumulatorPercentile(percentiles, asArray);
+    }
+
+    const char *AccumulatorPercentile::getOpName() const {
+        return "$percentile";
+    }
+}
@@ -58,7 +58,7 @@ namespace mongo {
             }
         }
         else { // linear scan
-            for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+            for (DocumentStorageIterator it = loadedIteratorAll(); !it.atEnd(); it.advance()) {
                 if (it->nameLen == reqSize
                     && memcmp(requested.rawData(), it->_name, reqSize) == 0) {
                     return it.position();
@@ -66,10 +66,48 @@ namespace mongo {
             }
         }
 
-        // if we got here, there's no such field
+        // if we got here, there's no such field unless it hasn't been converted yet
+        return _bsonNext ? loadFieldsUntil(requested) : Position();
+    }
+
+    Position DocumentStorage::loadFieldsUntil(StringData name) const {
+        DocumentStorage* const self = const_cast<DocumentStorage*>(this);
+        while (_bsonNext) {
+            const BSONElement elem(_bsonNext);
+            if (elem.eoo()) {
+                self->_bsonNext = NULL;
+                break;
+            }
+            self->_bsonNext += elem.size();
+
+            const StringData fieldName = elem.fieldNameStringData();
+            if (_bsonHasMetaData && fieldName == Document::metaFieldTextScore)
+                continue; // already taken by wrapBson()
+
+            const Position pos = getNextPosition();
+            self->appendField(fieldName) = Value(elem);
+            if (fieldName == name)
+                return pos;
+        }
         return Position();
     }
 
+    void DocumentStorage::wrapBson(const BSONObj& bson) {
+        verify(bson.isOwned());
+        verify(!_buffer);
+
+        BSONForEach(elem, bson) {
+            if (elem.fieldName()[0] == '$'
+                    && elem.fieldNameStringData() == Document::metaFieldTextScore) {
+                setTextScore(elem.Double());
+                _bsonHasMetaData = true;
+            }
+        }
+
+        _bson = bson;
+        _bsonNext = bson.objdata() + 4; // skip the size
+    }
+
     Value& DocumentStorage::appendField(StringData name) {
         Position pos = getNextPosition();
         const int nameSize = name.size();
@@ -182,6 +220,9 @@ namespace mongo {
     }
 
     intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
+        // The clone is about to be changed, so it needs all of our fields in its buffer.
+        loadAllFields();
+
         intrusive_ptr<DocumentStorage> out (new DocumentStorage());
 
         // Make a copy of the buffer.
@@ -209,7 +250,7 @@ namespace mongo {
     DocumentStorage::~DocumentStorage() {
         boost::scoped_array<char> deleteBufferAtScopeEnd (_buffer);
 
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+        for (DocumentStorageIterator it = loadedIteratorAll(); !it.atEnd(); it.advance()) {
             it->val.~Value(); // explicit destructor call
         }
     }
@@ -234,12 +275,20 @@ namespace mongo {
     }
 
     void Document::toBson(BSONObjBuilder* pBuilder) const {
+        if (const BSONObj* bson = storage().wrappedBson()) {
+            pBuilder->appendElements(*bson);
+            return;
+        }
+
         for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
             *pBuilder << it->nameSD() << it->val;
         }
     }
 
     BSONObj Document::toBson() const {
+        if (const BSONObj* bson = storage().wrappedBson())
+            return *bson;
+
         BSONObjBuilder bb;
         toBson(&bb);
         return bb.obj();
@@ -275,6 +324,12 @@ namespace mongo {
         return md.freeze();
     }
 
+    Document Document::wrapBsonWithMetaData(const BSONObj& bson) {
+        intrusive_ptr<DocumentStorage> storage(new DocumentStorage());
+        storage->wrapBson(bson);
+        return Document(storage.get());
+    }
+
     MutableDocument::MutableDocument(size_t expectedFields)
         : _storageHolder(NULL)
         , _storage(_storageHolder)
@@ -351,9 +406,9 @@ namespace mongo {
             return 0; // we've allocated no memory
 
         size_t size = sizeof(DocumentStorage);
-        size += storage().allocatedBytes();
+        size += storage().allocatedBytes(); // includes any BSON not converted yet
 
-        for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
+        for (DocumentStorageIterator it = storage().loadedIterator(); !it.atEnd(); it.advance()) {
             size += it->val.getApproximateSize();
             size -= sizeof(Value); // already accounted for above
         }
@@ -155,6 +155,16 @@ namespace mongo {
          */
         static Document fromBsonWithMetaData(const BSONObj& bson);
 
+        /**
+         * Like fromBsonWithMetaData, but keeps 'bson', which must be owned, and only converts a
+         * field to a Value when it is read. Until a MutableDocument changes it, toBson() returns
+         * 'bson' itself if it had no metadata.
+         *
+         * Reading a field can change the Document's storage, so one made this way must not be
+         * read by more than one thread at a time.
+         */
+        static Document wrapBsonWithMetaData(const BSONObj& bson);
+
         // Support BSONObjBuilder and BSONArrayBuilder "stream" API
         friend BSONObjBuilder& operator << (BSONObjBuilderValueStream& builder, const Document& d);
 
@@ -424,7 +434,11 @@ namespace mongo {
                 return clonedStorage();
 
             // This function exists to ensure this is safe
-            return const_cast<DocumentStorage&>(*storagePtr());
+            DocumentStorage& storage = const_cast<DocumentStorage&>(*storagePtr());
+            if (MONGO_unlikely( storage.isBsonWrapped() ))
+                storage.unwrapBson();
+
+            return storage;
         }
         DocumentStorage& newStorage() {
             reset(new DocumentStorage);
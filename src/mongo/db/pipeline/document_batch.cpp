@@ -0,0 +1,111 @@
+// document_batch.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/document_batch.h"
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    const size_t DocumentBatch::kMaxRows;
+
+    DocumentBatch::DocumentBatch(const std::vector<std::string>& fields)
+        : _fields(fields)
+        , _columns(fields.size())
+        , _size(0) {
+        for (size_t i = 0; i < _columns.size(); i++) {
+            _columns[i].reserve(kMaxRows);
+        }
+    }
+
+    size_t DocumentBatch::appendRow(const BSONObj& obj) {
+        verify(!full());
+
+        for (size_t i = 0; i < _columns.size(); i++) {
+            _columns[i].push_back(Value());
+        }
+
+        size_t bytes = sizeof(Value) * _columns.size();
+        size_t numFound = 0;
+        BSONObjIterator it(obj);
+        while (numFound < _fields.size() && it.more()) {
+            const BSONElement elem = it.next();
+            const StringData name = elem.fieldNameStringData();
+            for (size_t i = 0; i < _fields.size(); i++) {
+                Value& slot = _columns[i][_size];
+                if (slot.missing() && name == _fields[i]) {
+                    slot = Value(elem);
+                    bytes += slot.getApproximateSize() - sizeof(Value);
+                    numFound++;
+                    break;
+                }
+            }
+        }
+
+        _size++;
+        return bytes;
+    }
+
+    void DocumentBatch::appendRow(const DocumentBatch& other, size_t row) {
+        verify(!full());
+        dassert(other._fields == _fields);
+        dassert(row < other._size);
+
+        for (size_t i = 0; i < _columns.size(); i++) {
+            _columns[i].push_back(other._columns[i][row]);
+        }
+        _size++;
+    }
+
+    void DocumentBatch::copyColumns(const DocumentBatch& other,
+                                    const std::vector<int>& sourceColumns) {
+        verify(sourceColumns.size() == _columns.size());
+
+        for (size_t i = 0; i < _columns.size(); i++) {
+            if (sourceColumns[i] >= 0) {
+                _columns[i] = other._columns[sourceColumns[i]];
+            }
+            else {
+                _columns[i].assign(other._size, Value());
+            }
+        }
+        _size = other._size;
+    }
+
+    void DocumentBatch::clear() {
+        for (size_t i = 0; i < _columns.size(); i++) {
+            _columns[i].clear();
+        }
+        _size = 0;
+    }
+
+} // namespace mongo
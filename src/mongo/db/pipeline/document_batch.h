@@ -0,0 +1,101 @@
+// document_batch.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+    class BSONObj;
+
+    /**
+     * A column-oriented block of up to kMaxRows input documents, holding only the top-level
+     * fields its consumer asked for.
+     *
+     * A stage which only reads a few top-level fields of each input, such as a $group over field
+     * paths, can ask its source for batches rather than Documents (see
+     * DocumentSource::enableBatches()).  The producer then copies each input's requested fields
+     * straight out of BSON into one Value vector per field, instead of building a DocumentStorage
+     * for every input, and the consumer reads them back by row and column.  A field which is
+     * absent from an input is a missing Value in that row.
+     */
+    class DocumentBatch {
+        MONGO_DISALLOW_COPYING(DocumentBatch);
+    public:
+        static const size_t kMaxRows = 1024;
+
+        /** @param fields the top-level field held by each column; must not repeat. */
+        explicit DocumentBatch(const std::vector<std::string>& fields);
+
+        const std::vector<std::string>& fields() const { return _fields; }
+        size_t numColumns() const { return _fields.size(); }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        bool full() const { return _size == kMaxRows; }
+
+        const Value& get(size_t row, size_t column) const {
+            dassert(row < _size);
+            return _columns[column][row];
+        }
+
+        /**
+         * Appends a row holding the first occurrence of each requested field of 'obj'.  Returns
+         * the approximate number of bytes added.  Must not be called on a full batch.
+         */
+        size_t appendRow(const BSONObj& obj);
+
+        /**
+         * Appends a copy of row 'row' of 'other', which must have the same columns.  Must not be
+         * called on a full batch.
+         */
+        void appendRow(const DocumentBatch& other, size_t row);
+
+        /**
+         * Replaces the contents of this batch with the rows of 'other': column i is filled from
+         * column sourceColumns[i] of 'other', or with missing Values if that is -1.
+         */
+        void copyColumns(const DocumentBatch& other, const std::vector<int>& sourceColumns);
+
+        /** Removes all rows, keeping the columns. */
+        void clear();
+
+    private:
+        const std::vector<std::string> _fields;
+        std::vector<std::vector<Value> > _columns;
+        size_t _size;
+    };
+
+} // namespace mongo
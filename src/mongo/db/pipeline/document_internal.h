@@ -168,6 +168,8 @@ namespace mongo {
                           , _hashTabMask(0)
                           , _hasTextScore(false)
                           , _textScore(0)
+                          , _bsonNext(NULL)
+                          , _bsonHasMetaData(false)
         {}
         ~DocumentStorage();
 
@@ -176,6 +178,36 @@ namespace mongo {
             return *reinterpret_cast<const DocumentStorage*>(emptyBytes);
         }
 
+        /**
+         * Makes the fields of 'bson', which must be owned, the fields of this empty storage
+         * without converting them: each becomes a Value when it is first looked up, or when all
+         * of them are needed, as to iterate. Top-level fields with special names are metadata,
+         * as for Document::fromBsonWithMetaData().
+         *
+         * Looking up a field may add it to our buffer, so unlike others this storage must not
+         * be read from more than one thread at a time.
+         */
+        void wrapBson(const BSONObj& bson);
+
+        /**
+         * Returns the BSON given to wrapBson() if our fields are still exactly its fields, or
+         * NULL if they may not be or it had metadata.
+         */
+        const BSONObj* wrappedBson() const {
+            return _bson.isOwned() && !_bsonHasMetaData ? &_bson : NULL;
+        }
+
+        /**
+         * Converts any fields still in the BSON given to wrapBson() and stops using it. Must be
+         * called before our fields are changed.
+         */
+        void unwrapBson() {
+            loadAllFields();
+            _bson = BSONObj();
+        }
+
+        bool isBsonWrapped() const { return _bson.isOwned(); }
+
         size_t size() const {
             // can't use _numFields because it includes removed Fields
             size_t count = 0;
@@ -224,19 +256,27 @@ namespace mongo {
 
         /// This skips missing values
         DocumentStorageIterator iterator() const {
+            loadAllFields();
             return DocumentStorageIterator(_firstElement, end(), false);
         }
 
         /// This includes missing values
         DocumentStorageIterator iteratorAll() const {
+            loadAllFields();
             return DocumentStorageIterator(_firstElement, end(), true);
         }
 
-        /// Shallow copy of this. Caller owns memory.
+        /// Like iterator(), but skips any fields not yet converted from the wrapped BSON.
+        DocumentStorageIterator loadedIterator() const {
+            return DocumentStorageIterator(_firstElement, end(), false);
+        }
+
+        /// Shallow copy of this, which doesn't wrap any BSON. Caller owns memory.
         intrusive_ptr<DocumentStorage> clone() const;
 
         size_t allocatedBytes() const {
-            return !_buffer ? 0 : (_bufferEnd - _buffer + hashTabBytes());
+            return (!_buffer ? 0 : (_bufferEnd - _buffer + hashTabBytes()))
+                 + (_bson.isOwned() ? _bson.objsize() : 0);
         }
 
         /**
@@ -261,6 +301,25 @@ namespace mongo {
         /// Same as lastElement->next() or firstElement() if empty.
         const ValueElement* end() const { return _firstElement->plusBytes(_usedBytes); }
 
+        /// Like iteratorAll(), but doesn't convert any fields from the wrapped BSON.
+        DocumentStorageIterator loadedIteratorAll() const {
+            return DocumentStorageIterator(_firstElement, end(), true);
+        }
+
+        /**
+         * Converts the fields of the wrapped BSON not yet converted, in order, up to the first
+         * named 'name'. Returns its position, or Position() if there is none.
+         *
+         * Only changes what is cached, so is logically const.
+         */
+        Position loadFieldsUntil(StringData name) const;
+
+        void loadAllFields() const {
+            while (_bsonNext) {
+                loadFieldsUntil(StringData());
+            }
+        }
+
         /// Allocates space in _buffer. Copies existing data if there is any.
         void alloc(unsigned newSize);
 
@@ -291,7 +350,7 @@ namespace mongo {
         /// Adds all fields to the hash table
         void rehash() {
             hashTabInit();
-            for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance())
+            for (DocumentStorageIterator it = loadedIteratorAll(); !it.atEnd(); it.advance())
                 addFieldToHashTable(it.position());
         }
 
@@ -327,6 +386,12 @@ namespace mongo {
 
         bool _hasTextScore; // When adding more metadata fields, this should become a bitvector
         double _textScore;
+
+        // Set by wrapBson(). Dropped by unwrapBson() once our fields may change.
+        BSONObj _bson;
+        const char* _bsonNext; // the first field not yet converted, or NULL if there are none
+        bool _bsonHasMetaData;
+
         // When adding a field, make sure to update clone() method
     };
 }
@@ -63,6 +63,12 @@ namespace mongo {
         }
     }
 
+    bool DocumentSource::getNextBatch(DocumentBatch* batch) {
+        // Only sources which accept enableBatches() may be asked for batches.
+        verify(false);
+        return false;
+    }
+
     void DocumentSource::serializeToArray(vector<Value>& array, bool explain) const {
         Value entry = serialize(explain);
         if (!entry.missing()) {
@@ -38,6 +38,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/matcher.h"
 #include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/document_batch.h"
 #include "mongo/db/pipeline/dependencies.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/expression.h"
@@ -45,6 +46,7 @@
 #include "mongo/db/sorter/sorter.h"
 #include "mongo/s/shard.h"
 #include "mongo/s/strategy.h"
+#include "mongo/stdx/functional.h"
 #include "mongo/util/intrusive_counter.h"
 
 
@@ -155,6 +157,22 @@ namespace mongo {
         /// Returns true if doesn't require an input source (most DocumentSources do).
         virtual bool isValidInitialSource() const { return false; }
 
+        /**
+         * Asks this source to produce its output as DocumentBatches holding only the given
+         * top-level fields.  Returns false, and changes nothing, if this source can't.
+         *
+         * Must be called before the first call to getNext().  If this returns true the consumer
+         * should read through getNextBatch(), although getNext() still works.
+         */
+        virtual bool enableBatches(const std::vector<std::string>& fields) { return false; }
+
+        /**
+         * Replaces the contents of 'batch', whose columns are the fields passed to
+         * enableBatches(), with the next rows of output.  Returns false, leaving 'batch' empty,
+         * at EOF.
+         */
+        virtual bool getNextBatch(DocumentBatch* batch);
+
     protected:
         /**
            Base constructor.
@@ -351,6 +369,8 @@ namespace mongo {
         virtual bool coalesce(const intrusive_ptr<DocumentSource>& nextSource);
         virtual bool isValidInitialSource() const { return true; }
         virtual void dispose();
+        virtual bool enableBatches(const std::vector<std::string>& fields);
+        virtual bool getNextBatch(DocumentBatch* batch);
 
         /**
          * Create a document source based on a passed-in PlanExecutor.
@@ -407,7 +427,11 @@ namespace mongo {
             const boost::shared_ptr<PlanExecutor>& exec,
             const intrusive_ptr<ExpressionContext> &pExpCtx);
 
-        void loadBatch();
+        /**
+         * Reads the next run of results from the executor, into 'batch' if it is given and into
+         * _currentBatch otherwise.
+         */
+        void loadBatch(DocumentBatch* batch = NULL);
 
         std::deque<Document> _currentBatch;
 
@@ -424,9 +448,17 @@ namespace mongo {
     };
 
 
+    // Server parameters for $group, defined in document_source_group.cpp.
+    extern bool internalAggregationGroupStreamingMerge;
+    extern int internalAggregationGroupParallelism;
+    extern int internalDocumentSourceGroupMaxMemoryBytes;
+
     class DocumentSourceGroup : public DocumentSource
                               , public SplittableDocumentSource {
     public:
+        /// Makes a fresh accumulator, which may be bound to the options it was given.
+        typedef stdx::function<intrusive_ptr<Accumulator> ()> AccumulatorFactory;
+
         // virtuals from DocumentSource
         virtual boost::optional<Document> getNext();
         virtual const char *getSourceName() const;
@@ -457,12 +489,44 @@ namespace mongo {
                 group field
          */
         void addAccumulator(const std::string& fieldName,
-                            intrusive_ptr<Accumulator> (*pAccumulatorFactory)(),
+                            const AccumulatorFactory& pAccumulatorFactory,
                             const intrusive_ptr<Expression> &pExpression);
 
         /// Tell this source if it is doing a merge from shards. Defaults to false.
         void setDoingMerge(bool doingMerge) { _doingMerge = doingMerge; }
 
+        /**
+         * Tell this source to output its groups in order of their internal key, so that a merger
+         * created with getMergeSource() can stream them. Defaults to false.
+         */
+        void setSortedOutput(bool sortedOutput) { _sortedOutput = sortedOutput; }
+
+        /**
+         * Returns true if input sorted by 'sortPattern', a $sort key pattern such as {a: 1, b: -1},
+         * always has the inputs of each group next to each other: if its first fields are just
+         * the fields our _id is made of, in any order and direction.
+         */
+        bool canStreamSortedBy(const BSONObj& sortPattern) const;
+
+        /**
+         * Tell this source that its input comes sorted as canStreamSortedBy() requires, so that it
+         * can output each group as soon as the input moves on to the next one, rather than
+         * reading all of it first. Defaults to false.
+         */
+        void setStreaming(bool streaming) { _streaming = streaming; }
+        bool isStreaming() const { return _streaming; }
+
+        /** Returns true if the _id is made of more than one expression. */
+        bool hasCompoundId() const { return _idExpressions.size() > 1; }
+
+        /**
+         * The most memory the groups have held at once, going by the accumulators' and keys'
+         * getApproximateSize(), and the bytes written to spill files so far.  When grouping in
+         * parallel these are summed over the partitions.
+         */
+        long long getPeakMemoryUsageBytes() const;
+        unsigned long long getSpilledBytes() const;
+
         /**
           Create a grouping DocumentSource from BSON.
 
@@ -493,6 +557,14 @@ namespace mongo {
         // Only used by spill. Would be function-local if that were legal in C++03.
         class SpillSTLComparator;
 
+        /**
+         * Streams the groups coming from each shard's cursor into a k-way merge, combining the
+         * accumulators of equal keys as they come out instead of building a GroupsMap. Only used
+         * when _mergePresorted, which tells us every shard sends its groups in key order.
+         */
+        void populateFromCursors(const std::vector<DBClientCursor*>& cursors);
+        class IteratorFromCursor;
+
         /*
           Before returning anything, this source must fetch everything from
           the underlying source and group it.  populate() is used to do that
@@ -502,15 +574,67 @@ namespace mongo {
         void populate();
         bool populated;
 
+        /**
+         * Adds one input to its group for populate(): row 'row' of 'batch', or the ROOT document
+         * of _variables if 'batch' is NULL.  Spills the groups to 'sortedFiles' once
+         * 'memoryUsageBytes' is over our limit.
+         */
+        void processInput(const DocumentBatch* batch,
+                          size_t row,
+                          std::vector<boost::shared_ptr<Sorter<Value, Value>::Iterator> >* sortedFiles,
+                          int* memoryUsageBytes);
+
+        /** Gets ready to output the groups once all input has been processed. */
+        void finishPopulate(
+            std::vector<boost::shared_ptr<Sorter<Value, Value>::Iterator> >* sortedFiles);
+
+        /**
+         * Groups the input read into 'batch' on several threads, if
+         * internalAggregationGroupParallelism asks for it.  Each thread owns the groups of the
+         * keys which hash to its partition, in a DocumentSourceGroup of its own that spills
+         * separately, so a key's group is complete when its partition finishes and the output is
+         * just the partitions' outputs one after another (merged by key if _sortedOutput).
+         *
+         * Returns false, having read nothing, if the input should be grouped on this thread.
+         */
+        bool populateInParallel(DocumentBatch* batch);
+        struct Partition;
+        class IteratorFromPartition;
+
+        /** Ends the input of every partition that has a thread and waits for them. */
+        void stopPartitions();
+
+        /** Makes a group with our specification to hold one partition of our groups. */
+        intrusive_ptr<DocumentSourceGroup> makePartitionGroup(size_t numPartitions) const;
+
+        /** The body of a partition's thread: groups its input until it reads a NULL batch. */
+        void populatePartition(Partition* partition);
+
+        /**
+         * getNext() when _streaming: accumulates a group until the input moves on to another key,
+         * then outputs it.  Only keys which sort the same way everywhere are streamed like this.
+         * Null, missing and undefined parts, which sorts interleave although only null and
+         * missing are grouped together, and arrays, which a query's sort orders by one of their
+         * elements, are grouped in the usual way and output at the end.
+         */
+        boost::optional<Document> getNextStreaming();
+
+        /**
+         * Returns true if the group of the current input, whose key is in _idParts, can't be
+         * streamed.  See getNextStreaming().
+         */
+        bool keepAsideForStreaming() const;
+
         /**
          * Parses the raw id expression into _idExpressions and possibly _idFieldNames.
          */
         void parseIdExpression(BSONElement groupField, const VariablesParseState& vps);
 
         /**
-         * Computes the internal representation of the group key.
+         * Computes the i'th _id expression for the current input: row 'row' of 'batch', or the
+         * ROOT document of _variables if 'batch' is NULL.
          */
-        Value computeId(Variables* vars);
+        Value computeIdPart(size_t i, const DocumentBatch* batch, size_t row);
 
         /**
          * Converts the internal representation of the group key to the _id shape specified by the
@@ -518,11 +642,60 @@ namespace mongo {
          */
         Value expandId(const Value& val);
 
+        /**
+         * An input to the group key or to an accumulator which doesn't need a whole Document:
+         * either a column of the input batch or, if column is -1, a constant.
+         */
+        struct BatchOperand {
+            int column;
+            Value constant;
+        };
+
+        /**
+         * If every _id and accumulator expression is a constant or a top-level field path, and
+         * pSource supports batches of the fields they read, fills in _batchIdOperands and
+         * _batchOperands and returns a batch to read input into.  Returns NULL otherwise.
+         */
+        DocumentBatch* enableBatchInput();
+
+        /**
+         * Sets 'operand' up to read 'expr' without evaluating it, if it is a constant or a
+         * top-level field path.  The latter's field is added to 'fields' if it isn't there yet.
+         */
+        static bool makeBatchOperand(const intrusive_ptr<Expression>& expr,
+                                     std::vector<std::string>* fields,
+                                     BatchOperand* operand);
+
+        static Value getBatchOperand(const BatchOperand& operand,
+                                     const DocumentBatch& batch,
+                                     size_t row) {
+            return operand.column < 0 ? operand.constant : batch.get(row, operand.column);
+        }
+
 
         typedef std::vector<intrusive_ptr<Accumulator> > Accumulators;
         typedef boost::unordered_map<Value, Accumulators, Value::Hash> GroupsMap;
         GroupsMap groups;
 
+        /**
+         * Returns the accumulators of the group the current input (as for computeIdPart())
+         * belongs to, adding an empty group if it is new.  The key is stored in its internal
+         * representation: the single _id value, or an Array of one value per _id expression.
+         *
+         * A compound key is looked up from its parts in _idParts, so that its Array is only
+         * allocated when it starts a new group.
+         */
+        Accumulators& findGroup(const DocumentBatch* batch,
+                                size_t row,
+                                bool* inserted,
+                                int* memoryUsageBytes);
+
+        /** Compares the parts of a compound key with a key already in groups. */
+        struct IdPartsEqual {
+            bool operator()(const std::vector<Value>& parts, const Value& id) const;
+        };
+        std::vector<Value> _idParts;
+
         /*
           The field names for the result documents and the accumulator
           factories for the result documents.  The Expressions are the
@@ -536,28 +709,57 @@ namespace mongo {
           These three vectors parallel each other.
         */
         std::vector<std::string> vFieldName;
-        std::vector<intrusive_ptr<Accumulator> (*)()> vpAccumulatorFactory;
+        std::vector<AccumulatorFactory> vpAccumulatorFactory;
         std::vector<intrusive_ptr<Expression> > vpExpression;
 
 
         Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
 
         bool _doingMerge;
+        bool _sortedOutput;
+        bool _mergePresorted;
+        bool _streaming;
         bool _spilled;
         const bool _extSortAllowed;
-        const int _maxMemoryUsageBytes;
+        int _maxMemoryUsageBytes; // split between the partitions when grouping in parallel
+        long long _peakMemoryUsageBytes; // includes the partitions' once they are disposed
+        unsigned long long _spilledBytes; // likewise
+        OperationMemoryTracker _memoryTracker; // what the groups use, counts towards pExpCtx's
         boost::scoped_ptr<Variables> _variables;
         std::vector<std::string> _idFieldNames; // used when id is a document
         std::vector<intrusive_ptr<Expression> > _idExpressions;
 
+        // parallel to _idExpressions and vpExpression, only used with batch input
+        std::vector<BatchOperand> _batchIdOperands;
+        std::vector<BatchOperand> _batchOperands;
+
         // only used when !_spilled
         GroupsMap::iterator groupsIterator;
 
-        // only used when _spilled
+        // only used when !_spilled and _sortedOutput, in place of groupsIterator
+        std::vector<const GroupsMap::value_type*> _sortedGroups;
+        size_t _sortedGroupsPosition;
+
+        // only used when _spilled, which also covers merging presorted input from the shards
         scoped_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
         std::pair<Value, Value> _firstPartOfNextGroup;
-        Value _currentId;
         Accumulators _currentAccumulators;
+
+        // The key of the group getNext() last returned, when _spilled or _sortedOutput.
+        Value _currentId;
+
+        // only used when _streaming, along with _currentId and _currentAccumulators for the group
+        // in progress, and groups for the keys kept aside until the end of the input
+        scoped_ptr<DocumentBatch> _streamingBatch;
+        size_t _streamingRow;
+        int _streamingMemoryUsageBytes;
+        bool _streamingInProgress; // _currentId and _currentAccumulators hold a group
+        bool _streamingDone; // outputting the groups kept aside
+
+        // only used when grouping in parallel, in place of all of the above
+        std::vector<boost::shared_ptr<Partition> > _partitions;
+        size_t _outputPartition;
+        scoped_ptr<Sorter<Value, Document>::Iterator> _partitionsMerger; // if _sortedOutput
     };
 
 
@@ -688,6 +890,23 @@ namespace mongo {
 
         const NamespaceString& getOutputNs() const { return _outputNs; }
 
+        /** How the results are written to the output collection. */
+        enum Mode {
+            // Write a new collection and rename it over the old one once it is complete.
+            REPLACE_COLLECTION,
+
+            // Upsert each result by its _id into the collection as it is, leaving the
+            // documents that aren't in the results alone.  Results already written stay there
+            // if the aggregation fails part way through.
+            REPLACE_DOCUMENTS,
+        };
+
+        /**
+         * Parses the argument of $out: the name of the output collection, which is replaced, or
+         * {to: <name>, mode: <"replaceCollection" or "replaceDocuments">}.
+         */
+        static void parseSpec(BSONElement elem, std::string* outputColl, Mode* mode);
+
         /**
           Create a document source for output and pass-through.
 
@@ -706,16 +925,26 @@ namespace mongo {
 
     private:
         DocumentSourceOut(const NamespaceString& outputNs,
+                          Mode mode,
                           const intrusive_ptr<ExpressionContext> &pExpCtx);
 
+        // Fails if the output collection is of a kind $out can't write to.
+        void checkOutputNs();
+
         // Sets _tempsNs and prepares it to receive data.
         void prepTempCollection();
 
-        void spill(DBClientBase* conn, const std::vector<BSONObj>& toInsert);
+        /**
+         * Writes 'toWrite' with a single write command: documents to insert into _tempNs when
+         * replacing the collection, or statements to run against _outputNs when replacing
+         * documents.
+         */
+        void spill(DBClientBase* conn, const std::vector<BSONObj>& toWrite);
 
         bool _done;
 
-        NamespaceString _tempNs; // output goes here as it is being processed.
+        const Mode _mode;
+        NamespaceString _tempNs; // output goes here as it is being processed, if replacing it.
         const NamespaceString _outputNs; // output will go here after all data is processed.
     };
 
@@ -730,6 +959,13 @@ namespace mongo {
 
         virtual GetDepsReturn getDependencies(DepsTracker* deps) const;
 
+        /**
+         * Batches are supported when every field of the projection is a plain top-level inclusion
+         * or rename, such as {_id: 0, a: 1, b: "$c"}, and the source supports them too.
+         */
+        virtual bool enableBatches(const std::vector<std::string>& fields);
+        virtual bool getNextBatch(DocumentBatch* batch);
+
         /**
           Create a new projection DocumentSource from BSON.
 
@@ -757,6 +993,11 @@ namespace mongo {
         boost::scoped_ptr<Variables> _variables;
         intrusive_ptr<ExpressionObject> pEO;
         BSONObj _raw;
+
+        // Only used once enableBatches() has succeeded.  Column i of our output is column
+        // _batchSourceColumns[i] of _inputBatch, or always missing if that is -1.
+        boost::scoped_ptr<DocumentBatch> _inputBatch;
+        std::vector<int> _batchSourceColumns;
     };
 
     class DocumentSourceRedact :
@@ -787,6 +1028,9 @@ namespace mongo {
         intrusive_ptr<Expression> _expression;
     };
 
+    // Server parameter for $sort, defined in document_source_sort.cpp.
+    extern int internalDocumentSourceSortMaxMemoryBytes;
+
     class DocumentSourceSort : public DocumentSource
                              , public SplittableDocumentSource {
     public:
@@ -802,6 +1046,9 @@ namespace mongo {
         virtual intrusive_ptr<DocumentSource> getShardSource();
         virtual intrusive_ptr<DocumentSource> getMergeSource();
 
+        /// True if this merges the sorted output of each shard rather than sorting its input.
+        bool isMergingPresorted() const { return _mergingPresorted; }
+
         /**
           Add sort key field.
 
@@ -843,6 +1090,13 @@ namespace mongo {
 
         intrusive_ptr<DocumentSourceLimit> getLimitSrc() const { return limitSrc; }
 
+        /**
+         * The most memory the sorter has held at once, going by the documents'
+         * getApproximateSize(), and the bytes it wrote to spill files.
+         */
+        long long getPeakMemoryUsageBytes() const { return _peakMemoryUsageBytes; }
+        unsigned long long getSpilledBytes() const { return _spilledBytes; }
+
         static const char sortName[];
 
     private:
@@ -900,6 +1154,8 @@ namespace mongo {
         bool _done;
         bool _mergingPresorted;
         scoped_ptr<MySorter::Iterator> _output;
+        long long _peakMemoryUsageBytes;
+        unsigned long long _spilledBytes;
     };
 
     class DocumentSourceLimit : public DocumentSource
@@ -1023,6 +1279,13 @@ namespace mongo {
 
         virtual GetDepsReturn getDependencies(DepsTracker* deps) const;
 
+        /**
+         * Leaves out of the output the top-level fields which 'deps', the needs of the later
+         * stages, show are unused, so that each unwound document copies fewer of them.  Does
+         * nothing if the later stages need the whole document.
+         */
+        void setOutputDependencies(const DepsTracker& deps);
+
         /**
           Create a new projection DocumentSource from BSON.
 
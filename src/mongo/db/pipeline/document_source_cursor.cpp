@@ -65,6 +65,19 @@ namespace mongo {
         return out;
     }
 
+    bool DocumentSourceCursor::enableBatches(const vector<string>& fields) {
+        // Documents already loaded by getNext() can't be handed out as batch rows.
+        return _currentBatch.empty();
+    }
+
+    bool DocumentSourceCursor::getNextBatch(DocumentBatch* batch) {
+        pExpCtx->checkForInterrupt();
+
+        batch->clear();
+        loadBatch(batch);
+        return !batch->empty();
+    }
+
     void DocumentSourceCursor::dispose() {
         // Can't call in to PlanExecutor or ClientCursor registries from this function since it
         // will be called when an agg cursor is killed which would cause a deadlock.
@@ -72,7 +85,7 @@ namespace mongo {
         _currentBatch.clear();
     }
 
-    void DocumentSourceCursor::loadBatch() {
+    void DocumentSourceCursor::loadBatch(DocumentBatch* batch) {
         if (!_exec) {
             dispose();
             return;
@@ -89,11 +102,20 @@ namespace mongo {
         BSONObj obj;
         PlanExecutor::ExecState state;
         while ((state = _exec->getNext(&obj, NULL)) == PlanExecutor::ADVANCED) {
-            if (_dependencies) {
+            if (batch) {
+                // Only the batch's fields are copied out, so there is no need to apply
+                // _dependencies first.
+                memUsageBytes += batch->appendRow(obj);
+            }
+            else if (_dependencies) {
                 _currentBatch.push_back(_dependencies->extractFields(obj));
+                memUsageBytes += _currentBatch.back().getApproximateSize();
             }
             else {
-                _currentBatch.push_back(Document::fromBsonWithMetaData(obj));
+                // Fields are only converted when a later stage reads them. The copy keeps the
+                // record's data valid once the executor yields.
+                _currentBatch.push_back(Document::wrapBsonWithMetaData(obj.getOwned()));
+                memUsageBytes += _currentBatch.back().getApproximateSize();
             }
 
             if (_limit) {
@@ -103,9 +125,7 @@ namespace mongo {
                 verify(_docsAddedToBatches < _limit->getLimit());
             }
 
-            memUsageBytes += _currentBatch.back().getApproximateSize();
-
-            if (memUsageBytes > MaxBytesToReturnToClientAtOnce) {
+            if (memUsageBytes > MaxBytesToReturnToClientAtOnce || (batch && batch->full())) {
                 // End this batch and prepare PlanExecutor for yielding.
                 _exec->saveState();
                 return;
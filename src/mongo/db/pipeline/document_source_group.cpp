@@ -26,18 +26,63 @@
 *    it in the license file.
 */
 
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
 #include "mongo/pch.h"
 
+#include <boost/thread/thread.hpp>
 
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_compiled.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/log.h"
+#include "mongo/util/queue.h"
 
 namespace mongo {
+    // Whether sharded $group sorts its groups on the shards so they can be merged as a stream.
+    // Both sides must understand the $sortedOutput and $mergePresorted flags, so this should be
+    // turned off on the mongos while shards older than it are still running.
+    MONGO_EXPORT_SERVER_PARAMETER(internalAggregationGroupStreamingMerge, bool, true);
+
+    // How many threads a $group on a mongod spreads its groups over, by hash of their key.  Only
+    // groups whose _id and accumulators read top-level fields or constants can be parallel.  The
+    // memory limit is split between the threads.  1 groups everything on the operation's thread.
+    MONGO_EXPORT_SERVER_PARAMETER(internalAggregationGroupParallelism, int, 1);
+
+    // The memory a $group's groups may use before it spills them to disk, or fails if it may not.
+    MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceGroupMaxMemoryBytes, int, 100*1024*1024);
+
+    namespace {
+        // How many full batches the reading thread may queue up for each partition's thread.
+        const size_t kPartitionQueueDepth = 4;
+    }
+
+    struct DocumentSourceGroup::Partition {
+        Partition() : input(kPartitionQueueDepth), status(Status::OK()) {}
+
+        intrusive_ptr<DocumentSourceGroup> group;
+
+        // Batches of this partition's rows, ending with a NULL batch.
+        BlockingQueue<boost::shared_ptr<DocumentBatch> > input;
+
+        // The batch the reading thread is filling, only used by that thread.
+        boost::shared_ptr<DocumentBatch> pending;
+
+        scoped_ptr<boost::thread> thread;
+
+        // Set by the partition's thread if grouping failed.  Only read once it has been joined,
+        // apart from 'failed' which lets the reading thread stop early.
+        Status status;
+        AtomicUInt32 failed;
+    };
+
     const char DocumentSourceGroup::groupName[] = "$group";
 
     const char *DocumentSourceGroup::getSourceName() const {
@@ -47,9 +92,31 @@ namespace mongo {
     boost::optional<Document> DocumentSourceGroup::getNext() {
         pExpCtx->checkForInterrupt();
 
+        if (_streaming)
+            return getNextStreaming();
+
         if (!populated)
             populate();
 
+        if (!_partitions.empty()) {
+            if (_partitionsMerger) {
+                if (_partitionsMerger->more())
+                    return _partitionsMerger->next().second;
+            }
+            else {
+                // Every key is in exactly one partition, so their groups don't need combining.
+                for (; _outputPartition < _partitions.size(); _outputPartition++) {
+                    if (boost::optional<Document> out =
+                            _partitions[_outputPartition]->group->getNext()) {
+                        return out;
+                    }
+                }
+            }
+
+            dispose();
+            return boost::none;
+        }
+
         if (_spilled) {
             if (!_sorterIterator)
                 return boost::none;
@@ -94,6 +161,19 @@ namespace mongo {
 
             return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
 
+        } else if (_sortedOutput) {
+            if (_sortedGroupsPosition == _sortedGroups.size())
+                return boost::none;
+
+            const GroupsMap::value_type* group = _sortedGroups[_sortedGroupsPosition];
+            Document out = makeDocument(group->first, group->second, pExpCtx->inShard);
+            _currentId = group->first;
+
+            if (++_sortedGroupsPosition == _sortedGroups.size())
+                dispose();
+
+            return out;
+
         } else {
             if (groups.empty())
                 return boost::none;
@@ -109,16 +189,45 @@ namespace mongo {
         }
     }
 
+    long long DocumentSourceGroup::getPeakMemoryUsageBytes() const {
+        long long peak = _peakMemoryUsageBytes;
+        for (size_t i = 0; i < _partitions.size(); i++) {
+            peak += _partitions[i]->group->getPeakMemoryUsageBytes();
+        }
+        return peak;
+    }
+
+    unsigned long long DocumentSourceGroup::getSpilledBytes() const {
+        unsigned long long spilled = _spilledBytes;
+        for (size_t i = 0; i < _partitions.size(); i++) {
+            spilled += _partitions[i]->group->getSpilledBytes();
+        }
+        return spilled;
+    }
+
     void DocumentSourceGroup::dispose() {
+        // keep the partitions' stats
+        _peakMemoryUsageBytes = getPeakMemoryUsageBytes();
+        _spilledBytes = getSpilledBytes();
+
         // free our resources
         GroupsMap().swap(groups);
+        _memoryTracker.set(0);
         _sorterIterator.reset();
+        std::vector<const GroupsMap::value_type*>().swap(_sortedGroups);
+
+        _partitionsMerger.reset();
+        _partitions.clear();
+        _streamingBatch.reset();
 
         // make us look done
         groupsIterator = groups.end();
+        _sortedGroupsPosition = 0;
+        _streamingDone = true;
 
-        // free our source's resources
-        pSource->dispose();
+        // free our source's resources; a partition of a parallel group has no source
+        if (pSource)
+            pSource->dispose();
     }
 
     void DocumentSourceGroup::optimize() {
@@ -126,11 +235,11 @@ namespace mongo {
         // will only be one group. We should take advantage of that to avoid going through the hash
         // table.
         for (size_t i = 0; i < _idExpressions.size(); i++) {
-            _idExpressions[i] = _idExpressions[i]->optimize();
+            _idExpressions[i] = ExpressionCompiled::compile(_idExpressions[i]->optimize());
         }
 
         for (size_t i = 0; i < vFieldName.size(); i++) {
-             vpExpression[i] = vpExpression[i]->optimize();
+             vpExpression[i] = ExpressionCompiled::compile(vpExpression[i]->optimize());
         }
     }
 
@@ -156,8 +265,7 @@ namespace mongo {
         const size_t n = vFieldName.size();
         for(size_t i = 0; i < n; ++i) {
             intrusive_ptr<Accumulator> accum = vpAccumulatorFactory[i]();
-            insides[vFieldName[i]] =
-                Value(DOC(accum->getOpName() << vpExpression[i]->serialize(explain)));
+            insides[vFieldName[i]] = accum->serialize(vpExpression[i]->serialize(explain));
         }
 
         if (_doingMerge) {
@@ -167,6 +275,22 @@ namespace mongo {
             insides["$doingMerge"] = Value(true);
         }
 
+        if (_sortedOutput) {
+            // Like $doingMerge, this is only sent to shards when every process it could reach
+            // understands it. See internalAggregationGroupStreamingMerge.
+            insides["$sortedOutput"] = Value(true);
+        }
+
+        if (_mergePresorted) {
+            insides["$mergePresorted"] = Value(true);
+        }
+
+        if (explain && _streaming) {
+            // Not needed by anything we send this to, since it is set on sorted input by
+            // Pipeline::Optimizations::Local::streamGroupOnSortedInput when parsing.
+            insides["$streaming"] = Value(true);
+        }
+
         return Value(DOC(getSourceName() << insides.freeze()));
     }
 
@@ -196,14 +320,26 @@ namespace mongo {
         : DocumentSource(pExpCtx)
         , populated(false)
         , _doingMerge(false)
+        , _sortedOutput(false)
+        , _mergePresorted(false)
+        , _streaming(false)
         , _spilled(false)
         , _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter)
-        , _maxMemoryUsageBytes(100*1024*1024)
+        , _maxMemoryUsageBytes(internalDocumentSourceGroupMaxMemoryBytes)
+        , _peakMemoryUsageBytes(0)
+        , _spilledBytes(0)
+        , _memoryTracker(&pExpCtx->memoryTracker)
+        , _sortedGroupsPosition(0)
+        , _streamingRow(0)
+        , _streamingMemoryUsageBytes(0)
+        , _streamingInProgress(false)
+        , _streamingDone(false)
+        , _outputPartition(0)
     {}
 
     void DocumentSourceGroup::addAccumulator(
             const std::string& fieldName,
-            intrusive_ptr<Accumulator> (*pAccumulatorFactory)(),
+            const AccumulatorFactory& pAccumulatorFactory,
             const intrusive_ptr<Expression> &pExpression) {
         vFieldName.push_back(fieldName);
         vpAccumulatorFactory.push_back(pAccumulatorFactory);
@@ -214,8 +350,62 @@ namespace mongo {
     struct GroupOpDesc {
         const char* name;
         intrusive_ptr<Accumulator> (*factory)();
+
+        // For operators with options besides their input: if not NULL, parses the operator's
+        // argument, sets the input expression, and returns the factory to use.
+        DocumentSourceGroup::AccumulatorFactory (*parse)(BSONElement elem,
+                                                         const VariablesParseState& vps,
+                                                         intrusive_ptr<Expression>* input);
     };
 
+    /**
+     * Parses {$percentile: {input: <expression>, p: <fraction or array of fractions>}}.  The
+     * fractions must be constants, since they size the output.
+     */
+    static DocumentSourceGroup::AccumulatorFactory parsePercentile(
+            BSONElement elem,
+            const VariablesParseState& vps,
+            intrusive_ptr<Expression>* input) {
+        uassert(28613, "$percentile takes an object: {input: <expression>, p: <fraction(s)>}",
+                elem.type() == Object);
+
+        BSONElement percentilesElem;
+        BSONForEach(arg, elem.Obj()) {
+            if (str::equals(arg.fieldName(), "input")) {
+                *input = Expression::parseOperand(arg, vps);
+            }
+            else if (str::equals(arg.fieldName(), "p")) {
+                percentilesElem = arg;
+            }
+            else {
+                uasserted(28614, str::stream() << "unrecognized option to $percentile: "
+                                               << arg.fieldName());
+            }
+        }
+        uassert(28615, "$percentile needs an 'input'", *input);
+
+        vector<double> percentiles;
+        const bool asArray = percentilesElem.type() == Array;
+        if (asArray) {
+            BSONForEach(fraction, percentilesElem.Obj()) {
+                percentiles.push_back(fraction.isNumber() ? fraction.numberDouble() : -1);
+            }
+        }
+        else if (percentilesElem.isNumber()) {
+            percentiles.push_back(percentilesElem.numberDouble());
+        }
+
+        bool valid = !percentiles.empty();
+        for (size_t i = 0; i < percentiles.size(); i++) {
+            valid = valid && percentiles[i] >= 0 && percentiles[i] <= 1;
+        }
+        uassert(28616, "$percentile's 'p' must be a number or a non-empty array of numbers,"
+                       " each between 0 and 1",
+                valid);
+
+        return stdx::bind(AccumulatorPercentile::create, percentiles, asArray);
+    }
+
     static int GroupOpDescCmp(const void *pL, const void *pR) {
         return strcmp(((const GroupOpDesc *)pL)->name,
                       ((const GroupOpDesc *)pR)->name);
@@ -227,11 +417,13 @@ namespace mongo {
     */
     static const GroupOpDesc GroupOpTable[] = {
         {"$addToSet", AccumulatorAddToSet::create},
+        {"$approxCountDistinct", AccumulatorApproxCountDistinct::create},
         {"$avg", AccumulatorAvg::create},
         {"$first", AccumulatorFirst::create},
         {"$last", AccumulatorLast::create},
         {"$max", AccumulatorMinMax::createMax},
         {"$min", AccumulatorMinMax::createMin},
+        {"$percentile", NULL, parsePercentile},
         {"$push", AccumulatorPush::create},
         {"$sum", AccumulatorSum::create},
     };
@@ -267,6 +459,18 @@ namespace mongo {
 
                 pGroup->setDoingMerge(true);
             }
+            else if (str::equals(pFieldName, "$sortedOutput")) {
+                massert(28606, "$sortedOutput should be true if present",
+                        groupField.Bool());
+
+                pGroup->setSortedOutput(true);
+            }
+            else if (str::equals(pFieldName, "$mergePresorted")) {
+                massert(28607, "$mergePresorted should be true if present",
+                        groupField.Bool());
+
+                pGroup->_mergePresorted = true;
+            }
             else {
                 /*
                   Treat as a projection field with the additional ability to
@@ -305,9 +509,13 @@ namespace mongo {
                             pOp);
 
                     intrusive_ptr<Expression> pGroupExpr;
+                    AccumulatorFactory factory = pOp->factory;
 
                     BSONType elementType = subElement.type();
-                    if (elementType == Object) {
+                    if (pOp->parse) {
+                        factory = pOp->parse(subElement, vps, &pGroupExpr);
+                    }
+                    else if (elementType == Object) {
                         Expression::ObjectCtx oCtx(Expression::ObjectCtx::DOCUMENT_OK);
                         pGroupExpr = Expression::parseObject(subElement.Obj(), &oCtx, vps);
                     }
@@ -319,7 +527,7 @@ namespace mongo {
                         pGroupExpr = Expression::parseOperand(subElement, vps);
                     }
 
-                    pGroup->addAccumulator(pFieldName, pOp->factory, pGroupExpr);
+                    pGroup->addAccumulator(pFieldName, factory, pGroupExpr);
                 }
 
                 uassert(15954, str::stream() <<
@@ -347,91 +555,151 @@ namespace mongo {
         };
     }
 
+    class DocumentSourceGroup::SpillSTLComparator {
+    public:
+        bool operator() (const GroupsMap::value_type* lhs, const GroupsMap::value_type* rhs) const {
+            return Value::compare(lhs->first, rhs->first) < 0;
+        }
+    };
+
     void DocumentSourceGroup::populate() {
-        const size_t numAccumulators = vpAccumulatorFactory.size();
-        dassert(numAccumulators == vpExpression.size());
+        dassert(vpAccumulatorFactory.size() == vpExpression.size());
+
+        if (_mergePresorted) {
+            if (DocumentSourceMergeCursors* cursors =
+                    dynamic_cast<DocumentSourceMergeCursors*>(pSource)) {
+                populateFromCursors(cursors->getCursors());
+                populated = true;
+                return;
+            }
+
+            // Any other source, such as DocumentSourceCommandShards, is merged below. That
+            // doesn't depend on the order of the input, so it gives the same results.
+        }
 
         // pushed to on spill()
         vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
         int memoryUsageBytes = 0;
 
+        // Input is read a batch at a time if pSource can produce the fields we need that way.
+        const scoped_ptr<DocumentBatch> batch(enableBatchInput());
+        if (batch && populateInParallel(batch.get())) {
+            populated = true;
+            return;
+        }
+        size_t row = 0;
+
         // This loop consumes all input from pSource and buckets it based on pIdExpression.
-        while (boost::optional<Document> input = pSource->getNext()) {
-            if (memoryUsageBytes > _maxMemoryUsageBytes) {
-                uassert(16945, "Exceeded memory limit for $group, but didn't allow external sort."
-                               " Pass allowDiskUse:true to opt in.",
-                        _extSortAllowed);
-                sortedFiles.push_back(spill());
-                memoryUsageBytes = 0;
+        while (true) {
+            if (batch) {
+                if (row == batch->size()) {
+                    if (!pSource->getNextBatch(batch.get()))
+                        break;
+                    row = 0;
+                }
+            }
+            else {
+                boost::optional<Document> input = pSource->getNext();
+                if (!input)
+                    break;
+                _variables->setRoot(*input);
             }
 
-            _variables->setRoot(*input);
+            processInput(batch.get(), row, &sortedFiles, &memoryUsageBytes);
 
-            /* get the _id value */
-            Value id = computeId(_variables.get());
+            if (batch) {
+                row++;
+            }
+            else {
+                // We are done with the ROOT document so release it.
+                _variables->clearRoot();
+            }
+        }
 
-            /* treat missing values the same as NULL SERVER-4674 */
-            if (id.missing())
-                id = Value(BSONNULL);
+        finishPopulate(&sortedFiles);
+    }
 
-            /*
-              Look for the _id value in the map; if it's not there, add a
-              new entry with a blank accumulator.
-            */
-            const size_t oldSize = groups.size();
-            vector<intrusive_ptr<Accumulator> >& group = groups[id];
-            const bool inserted = groups.size() != oldSize;
+    void DocumentSourceGroup::processInput(const DocumentBatch* batch,
+                                           size_t row,
+                                           vector<shared_ptr<Sorter<Value, Value>::Iterator> >*
+                                               sortedFiles,
+                                           int* memoryUsageBytes) {
+        const size_t numAccumulators = vpAccumulatorFactory.size();
 
-            if (inserted) {
-                memoryUsageBytes += id.getApproximateSize();
+        _memoryTracker.set(*memoryUsageBytes);
+        const Status memoryStatus = _memoryTracker.checkLimits();
+        if (*memoryUsageBytes > _maxMemoryUsageBytes || !memoryStatus.isOK()) {
+            if (!_extSortAllowed)
+                uassertStatusOK(memoryStatus);
+            uassert(16945, "Exceeded memory limit for $group, but didn't allow external sort."
+                           " Pass allowDiskUse:true to opt in.",
+                    _extSortAllowed);
+            sortedFiles->push_back(spill());
+            *memoryUsageBytes = 0;
+            _memoryTracker.set(0);
+        }
 
-                // Add the accumulators
-                group.reserve(numAccumulators);
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    group.push_back(vpAccumulatorFactory[i]());
-                }
-            } else {
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    // subtract old mem usage. New usage added back after processing.
-                    memoryUsageBytes -= group[i]->memUsageForSorter();
-                }
-            }
+        /*
+          Look for the _id value in the map; if it's not there, add a
+          new entry with a blank accumulator.
+        */
+        bool inserted;
+        Accumulators& group = findGroup(batch, row, &inserted, memoryUsageBytes);
 
-            /* tickle all the accumulators for the group we found */
-            dassert(numAccumulators == group.size());
+        if (inserted) {
+            // Add the accumulators
+            group.reserve(numAccumulators);
             for (size_t i = 0; i < numAccumulators; i++) {
-                group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
-                memoryUsageBytes += group[i]->memUsageForSorter();
+                group.push_back(vpAccumulatorFactory[i]());
             }
+        } else {
+            for (size_t i = 0; i < numAccumulators; i++) {
+                // subtract old mem usage. New usage added back after processing.
+                *memoryUsageBytes -= group[i]->memUsageForSorter();
+            }
+        }
 
-            // We are done with the ROOT document so release it.
-            _variables->clearRoot();
-
-            DEV {
-                // In debug mode, spill every time we have a duplicate id to stress merge logic.
-                if (!inserted // is a dup
-                        && !pExpCtx->inRouter // can't spill to disk in router
-                        && !_extSortAllowed // don't change behavior when testing external sort
-                        && sortedFiles.size() < 20 // don't open too many FDs
-                        ) {
-                    sortedFiles.push_back(spill());
-                }
+        /* tickle all the accumulators for the group we found */
+        dassert(numAccumulators == group.size());
+        for (size_t i = 0; i < numAccumulators; i++) {
+            group[i]->process(batch ? getBatchOperand(_batchOperands[i], *batch, row)
+                                    : vpExpression[i]->evaluate(_variables.get()),
+                              _doingMerge);
+            *memoryUsageBytes += group[i]->memUsageForSorter();
+        }
+        _peakMemoryUsageBytes = std::max(_peakMemoryUsageBytes,
+                                         static_cast<long long>(*memoryUsageBytes));
+
+        DEV {
+            // In debug mode, spill every time we have a duplicate id to stress merge logic.
+            if (!inserted // is a dup
+                    && !pExpCtx->inRouter // can't spill to disk in router
+                    && !_extSortAllowed // don't change behavior when testing external sort
+                    && sortedFiles->size() < 20 // don't open too many FDs
+                    ) {
+                sortedFiles->push_back(spill());
             }
         }
+    }
+
+    void DocumentSourceGroup::finishPopulate(
+            vector<shared_ptr<Sorter<Value, Value>::Iterator> >* sortedFiles) {
+        const size_t numAccumulators = vpAccumulatorFactory.size();
 
         // These blocks do any final steps necessary to prepare to output results.
-        if (!sortedFiles.empty()) {
+        if (!sortedFiles->empty()) {
             _spilled = true;
             if (!groups.empty()) {
-                sortedFiles.push_back(spill());
+                sortedFiles->push_back(spill());
             }
 
             // We won't be using groups again so free its memory.
             GroupsMap().swap(groups);
+            _memoryTracker.set(0);
 
             _sorterIterator.reset(
                     Sorter<Value,Value>::Iterator::merge(
-                        sortedFiles, SortOptions(), SorterComparator()));
+                        *sortedFiles, SortOptions(), SorterComparator()));
 
             // prepare current to accumulate data
             _currentAccumulators.reserve(numAccumulators);
@@ -441,6 +709,14 @@ namespace mongo {
 
             verify(_sorterIterator->more()); // we put data in, we should get something out.
             _firstPartOfNextGroup = _sorterIterator->next();
+        } else if (_sortedOutput) {
+            // Spilled output is already in key order; the in-memory groups need sorting.
+            _sortedGroups.reserve(groups.size());
+            for (GroupsMap::const_iterator it=groups.begin(), end=groups.end(); it != end; ++it) {
+                _sortedGroups.push_back(&*it);
+            }
+            std::sort(_sortedGroups.begin(), _sortedGroups.end(), SpillSTLComparator());
+            _sortedGroupsPosition = 0;
         } else {
             // start the group iterator
             groupsIterator = groups.begin();
@@ -449,13 +725,484 @@ namespace mongo {
         populated = true;
     }
 
-    class DocumentSourceGroup::SpillSTLComparator {
+    bool DocumentSourceGroup::canStreamSortedBy(const BSONObj& sortPattern) const {
+        // Our output order and merging don't depend on the input, so only a plain group streams.
+        if (_doingMerge || _sortedOutput || _mergePresorted)
+            return false;
+
+        set<string> idFields;
+        for (size_t i = 0; i < _idExpressions.size(); i++) {
+            if (dynamic_cast<ExpressionConstant*>(_idExpressions[i].get()))
+                continue;
+
+            ExpressionFieldPath* fieldPath =
+                dynamic_cast<ExpressionFieldPath*>(_idExpressions[i].get());
+            if (!fieldPath
+                    || fieldPath->getVariableId() != Variables::ROOT_ID
+                    || fieldPath->getFieldPath().getPathLength() < 2) {
+                return false;
+            }
+            idFields.insert(fieldPath->getFieldPath().tail().getPath(false));
+        }
+
+        size_t sortFieldsMatched = 0;
+        BSONForEach(sortField, sortPattern) {
+            if (sortFieldsMatched == idFields.size())
+                break;
+
+            // A {$meta: ...} sort doesn't order by a field.
+            if (!sortField.isNumber() || !idFields.count(sortField.fieldName()))
+                return false;
+
+            sortFieldsMatched++;
+        }
+
+        return sortFieldsMatched == idFields.size();
+    }
+
+    bool DocumentSourceGroup::keepAsideForStreaming() const {
+        for (size_t i = 0; i < _idParts.size(); i++) {
+            if (_idParts[i].nullish() || _idParts[i].getType() == Array)
+                return true;
+        }
+        return false;
+    }
+
+    namespace {
+        int accumulatorsMemUsage(const vector<intrusive_ptr<Accumulator> >& accumulators) {
+            int memUsageBytes = 0;
+            for (size_t i = 0; i < accumulators.size(); i++) {
+                memUsageBytes += accumulators[i]->memUsageForSorter();
+            }
+            return memUsageBytes;
+        }
+    }
+
+    boost::optional<Document> DocumentSourceGroup::getNextStreaming() {
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+
+        if (!populated) {
+            _streamingBatch.reset(enableBatchInput());
+            _streamingRow = 0;
+            _currentAccumulators.reserve(numAccumulators);
+            for (size_t i = 0; i < numAccumulators; i++) {
+                _currentAccumulators.push_back(vpAccumulatorFactory[i]());
+            }
+            populated = true;
+        }
+
+        while (!_streamingDone) {
+            DocumentBatch* const batch = _streamingBatch.get();
+            if (batch) {
+                if (_streamingRow == batch->size()) {
+                    if (!pSource->getNextBatch(batch))
+                        break;
+                    _streamingRow = 0;
+                }
+            }
+            else {
+                boost::optional<Document> input = pSource->getNext();
+                if (!input)
+                    break;
+                _variables->setRoot(*input);
+            }
+            const size_t row = _streamingRow;
+
+            if (_streamingMemoryUsageBytes > _maxMemoryUsageBytes) {
+                // Too much to hold while streaming, so group the rest of the input as populate()
+                // would, with the group in progress. Those already output are complete, since
+                // their keys can't come up again.
+                if (_streamingInProgress) {
+                    groups[_currentId].swap(_currentAccumulators);
+                    _streamingInProgress = false;
+                }
+                _currentAccumulators.clear();
+                _streaming = false;
+
+                vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
+                int memoryUsageBytes = _streamingMemoryUsageBytes;
+                while (true) {
+                    processInput(batch, _streamingRow, &sortedFiles, &memoryUsageBytes);
+
+                    if (batch) {
+                        if (++_streamingRow == batch->size()) {
+                            if (!pSource->getNextBatch(batch))
+                                break;
+                            _streamingRow = 0;
+                        }
+                    }
+                    else {
+                        _variables->clearRoot();
+                        boost::optional<Document> input = pSource->getNext();
+                        if (!input)
+                            break;
+                        _variables->setRoot(*input);
+                    }
+                }
+                _streamingBatch.reset();
+
+                finishPopulate(&sortedFiles);
+                return getNext();
+            }
+
+            _idParts.clear();
+            for (size_t i = 0; i < _idExpressions.size(); i++) {
+                _idParts.push_back(computeIdPart(i, batch, row));
+            }
+
+            Accumulators* group;
+            boost::optional<Document> out;
+            if (keepAsideForStreaming()) {
+                bool inserted;
+                group = &findGroup(batch, row, &inserted, &_streamingMemoryUsageBytes);
+                if (inserted) {
+                    group->reserve(numAccumulators);
+                    for (size_t i = 0; i < numAccumulators; i++) {
+                        group->push_back(vpAccumulatorFactory[i]());
+                    }
+                    _streamingMemoryUsageBytes += accumulatorsMemUsage(*group);
+                }
+            }
+            else {
+                const bool sameGroup = _streamingInProgress
+                    && (_idParts.size() == 1 ? Value::compare(_idParts[0], _currentId) == 0
+                                             : IdPartsEqual()(_idParts, _currentId));
+                if (!sameGroup) {
+                    if (_streamingInProgress) {
+                        out = makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
+                        _streamingMemoryUsageBytes -= _currentId.getApproximateSize()
+                                                    + accumulatorsMemUsage(_currentAccumulators);
+                        for (size_t i = 0; i < numAccumulators; i++) {
+                            _currentAccumulators[i]->reset();
+                        }
+                    }
+
+                    _currentId = _idParts.size() == 1 ? _idParts[0] : Value::consume(_idParts);
+                    _streamingMemoryUsageBytes += _currentId.getApproximateSize()
+                                                + accumulatorsMemUsage(_currentAccumulators);
+                    _streamingInProgress = true;
+                }
+                group = &_currentAccumulators;
+            }
+
+            _streamingMemoryUsageBytes -= accumulatorsMemUsage(*group);
+            for (size_t i = 0; i < numAccumulators; i++) {
+                (*group)[i]->process(batch ? getBatchOperand(_batchOperands[i], *batch, row)
+                                           : vpExpression[i]->evaluate(_variables.get()),
+                                     _doingMerge);
+            }
+            _streamingMemoryUsageBytes += accumulatorsMemUsage(*group);
+
+            if (batch) {
+                _streamingRow++;
+            }
+            else {
+                _variables->clearRoot();
+            }
+
+            if (out)
+                return out;
+        }
+
+        if (!_streamingDone) {
+            // End of input: the group in progress, then those kept aside.
+            _streamingDone = true;
+            groupsIterator = groups.begin();
+            if (groups.empty())
+                dispose();
+
+            if (_streamingInProgress) {
+                _streamingInProgress = false;
+                return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
+            }
+        }
+
+        if (groupsIterator == groups.end())
+            return boost::none;
+
+        Document out = makeDocument(groupsIterator->first,
+                                    groupsIterator->second,
+                                    pExpCtx->inShard);
+
+        if (++groupsIterator == groups.end())
+            dispose();
+
+        return out;
+    }
+
+    namespace {
+        class PartitionOutputComparator {
+        public:
+            typedef pair<Value, Document> Data;
+            int operator() (const Data& lhs, const Data& rhs) const {
+                return Value::compare(lhs.first, rhs.first);
+            }
+        };
+    }
+
+    /** Returns a partition's groups along with their keys, for merging in key order. */
+    class DocumentSourceGroup::IteratorFromPartition : public Sorter<Value, Document>::Iterator {
     public:
-        bool operator() (const GroupsMap::value_type* lhs, const GroupsMap::value_type* rhs) const {
-            return Value::compare(lhs->first, rhs->first) < 0;
+        explicit IteratorFromPartition(DocumentSourceGroup* group)
+            : _group(group)
+            , _next(group->getNext())
+        {}
+
+        bool more() { return bool(_next); }
+
+        Data next() {
+            const Data out = make_pair(_group->_currentId, *_next);
+            _next = _group->getNext();
+            return out;
+        }
+
+    private:
+        DocumentSourceGroup* _group;
+        boost::optional<Document> _next;
+    };
+
+    bool DocumentSourceGroup::populateInParallel(DocumentBatch* batch) {
+        const int parallelism = internalAggregationGroupParallelism;
+        if (parallelism <= 1 || pExpCtx->inRouter)
+            return false;
+
+        const size_t numPartitions = parallelism;
+        try {
+            // Start every thread before reading anything, so that we can still group on this
+            // thread if we can't have them.
+            for (size_t i = 0; i < numPartitions; i++) {
+                _partitions.push_back(boost::make_shared<Partition>());
+                Partition* partition = _partitions.back().get();
+                partition->group = makePartitionGroup(numPartitions);
+                partition->pending = boost::make_shared<DocumentBatch>(batch->fields());
+
+                try {
+                    partition->thread.reset(new boost::thread(
+                        stdx::bind(&DocumentSourceGroup::populatePartition,
+                                   partition->group.get(),
+                                   partition)));
+                }
+                catch (const boost::thread_resource_error&) {
+                    warning() << "can't start a thread for a parallel $group, grouping on one"
+                              << " thread instead" << endl;
+                    stopPartitions();
+                    _partitions.clear();
+                    return false;
+                }
+            }
+
+            // Deal the rows out to the partitions by the hash of their key, normalized as in
+            // findGroup() so that equal keys always meet in the same partition.
+            vector<Value> idParts;
+            bool failed = false;
+            while (!failed && pSource->getNextBatch(batch)) {
+                for (size_t row = 0; row < batch->size(); row++) {
+                    size_t hash;
+                    if (_batchIdOperands.size() == 1) {
+                        Value id = getBatchOperand(_batchIdOperands[0], *batch, row);
+                        if (id.missing())
+                            id = Value(BSONNULL);
+                        hash = Value::Hash()(id);
+                    }
+                    else {
+                        idParts.clear();
+                        for (size_t i = 0; i < _batchIdOperands.size(); i++) {
+                            idParts.push_back(getBatchOperand(_batchIdOperands[i], *batch, row));
+                        }
+                        hash = Value::Hash()(idParts);
+                    }
+
+                    Partition& partition = *_partitions[hash % numPartitions];
+                    partition.pending->appendRow(*batch, row);
+                    if (partition.pending->full()) {
+                        partition.input.push(partition.pending);
+                        partition.pending = boost::make_shared<DocumentBatch>(batch->fields());
+                    }
+                }
+
+                for (size_t i = 0; i < numPartitions; i++) {
+                    if (_partitions[i]->failed.load())
+                        failed = true;
+                }
+            }
+
+            for (size_t i = 0; i < numPartitions; i++) {
+                Partition& partition = *_partitions[i];
+                if (!partition.pending->empty())
+                    partition.input.push(partition.pending);
+                partition.pending.reset();
+            }
+        }
+        catch (...) {
+            stopPartitions();
+            throw;
+        }
+
+        stopPartitions();
+        for (size_t i = 0; i < numPartitions; i++) {
+            uassertStatusOK(_partitions[i]->status);
+        }
+
+        if (_sortedOutput) {
+            vector<boost::shared_ptr<Sorter<Value, Document>::Iterator> > iterators;
+            for (size_t i = 0; i < numPartitions; i++) {
+                iterators.push_back(
+                    boost::make_shared<IteratorFromPartition>(_partitions[i]->group.get()));
+            }
+            _partitionsMerger.reset(Sorter<Value, Document>::Iterator::merge(
+                iterators, SortOptions(), PartitionOutputComparator()));
+        }
+
+        _outputPartition = 0;
+        return true;
+    }
+
+    void DocumentSourceGroup::stopPartitions() {
+        for (size_t i = 0; i < _partitions.size(); i++) {
+            if (_partitions[i]->thread)
+                _partitions[i]->input.push(boost::shared_ptr<DocumentBatch>());
+        }
+
+        for (size_t i = 0; i < _partitions.size(); i++) {
+            if (_partitions[i]->thread) {
+                _partitions[i]->thread->join();
+                _partitions[i]->thread.reset();
+            }
+        }
+    }
+
+    intrusive_ptr<DocumentSourceGroup> DocumentSourceGroup::makePartitionGroup(
+            size_t numPartitions) const {
+        intrusive_ptr<DocumentSourceGroup> group(new DocumentSourceGroup(pExpCtx));
+        group->_doingMerge = _doingMerge;
+        group->_sortedOutput = _sortedOutput;
+        group->_maxMemoryUsageBytes = _maxMemoryUsageBytes / numPartitions;
+        group->vFieldName = vFieldName;
+        group->vpAccumulatorFactory = vpAccumulatorFactory;
+        group->vpExpression = vpExpression;
+        group->_idFieldNames = _idFieldNames;
+        group->_idExpressions = _idExpressions;
+        group->_batchIdOperands = _batchIdOperands;
+        group->_batchOperands = _batchOperands;
+        return group;
+    }
+
+    void DocumentSourceGroup::populatePartition(Partition* partition) {
+        try {
+            vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
+            int memoryUsageBytes = 0;
+            while (const boost::shared_ptr<DocumentBatch> batch = partition->input.blockingPop()) {
+                for (size_t row = 0; row < batch->size(); row++) {
+                    processInput(batch.get(), row, &sortedFiles, &memoryUsageBytes);
+                }
+            }
+
+            finishPopulate(&sortedFiles);
+            return;
+        }
+        catch (const DBException& e) {
+            partition->status = e.toStatus();
         }
+        catch (const std::exception& e) {
+            partition->status = Status(ErrorCodes::InternalError, e.what());
+        }
+
+        partition->failed.store(1);
+
+        // Keep taking batches until the NULL one, so that the reading thread never waits on us.
+        while (partition->input.blockingPop()) {
+        }
+    }
+
+    class DocumentSourceGroup::IteratorFromCursor : public Sorter<Value, Value>::Iterator {
+    public:
+        IteratorFromCursor(DocumentSourceGroup* group, DBClientCursor* cursor)
+            : _group(group)
+            , _cursor(cursor)
+        {}
+
+        bool more() { return _cursor->more(); }
+
+        /**
+         * Returns a shard's group in the form spill() writes: its internal key, and the
+         * accumulator states to merge.
+         */
+        Data next() {
+            const Document doc = DocumentSourceMergeCursors::nextSafeFrom(_cursor);
+            Variables* variables = _group->_variables.get();
+            variables->setRoot(doc);
+
+            Value id;
+            if (_group->_idExpressions.size() == 1) {
+                id = _group->computeIdPart(0, NULL, 0);
+                if (id.missing())
+                    id = Value(BSONNULL); // as in findGroup()
+            }
+            else {
+                vector<Value> parts;
+                parts.reserve(_group->_idExpressions.size());
+                for (size_t i = 0; i < _group->_idExpressions.size(); i++) {
+                    parts.push_back(_group->computeIdPart(i, NULL, 0));
+                }
+                id = Value::consume(parts);
+            }
+
+            Value accumulatorStates;
+            const size_t numAccumulators = _group->vpExpression.size();
+            switch (numAccumulators) { // mirrors switch in spill()
+            case 0:
+                break;
+
+            case 1:
+                accumulatorStates = _group->vpExpression[0]->evaluate(variables);
+                break;
+
+            default: {
+                vector<Value> states;
+                states.reserve(numAccumulators);
+                for (size_t i = 0; i < numAccumulators; i++) {
+                    states.push_back(_group->vpExpression[i]->evaluate(variables));
+                }
+                accumulatorStates = Value::consume(states);
+                break;
+            }
+            }
+
+            variables->clearRoot();
+            return make_pair(id, accumulatorStates);
+        }
+
+    private:
+        DocumentSourceGroup* _group;
+        DBClientCursor* _cursor;
     };
 
+    void DocumentSourceGroup::populateFromCursors(const vector<DBClientCursor*>& cursors) {
+        vector<shared_ptr<Sorter<Value, Value>::Iterator> > iterators;
+        for (size_t i = 0; i < cursors.size(); i++) {
+            iterators.push_back(boost::make_shared<IteratorFromCursor>(this, cursors[i]));
+        }
+
+        // From here on this looks the same as merging our own spilled files.
+        _spilled = true;
+        _sorterIterator.reset(
+                Sorter<Value,Value>::Iterator::merge(iterators, SortOptions(), SorterComparator()));
+
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+        _currentAccumulators.reserve(numAccumulators);
+        for (size_t i = 0; i < numAccumulators; i++) {
+            _currentAccumulators.push_back(vpAccumulatorFactory[i]());
+        }
+
+        if (!_sorterIterator->more()) {
+            // No shard had any groups.
+            _sorterIterator.reset();
+            return;
+        }
+
+        _firstPartOfNextGroup = _sorterIterator->next();
+    }
+
     shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
         vector<const GroupsMap::value_type*> ptrs; // using pointers to speed sorting
         ptrs.reserve(groups.size());
@@ -493,7 +1240,9 @@ namespace mongo {
 
         groups.clear();
 
-        return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
+        shared_ptr<Sorter<Value, Value>::Iterator> iterator(writer.done());
+        _spilledBytes += writer.bytesWritten();
+        return iterator;
     }
 
     void DocumentSourceGroup::parseIdExpression(BSONElement groupField,
@@ -530,18 +1279,105 @@ namespace mongo {
         }
     }
 
-    Value DocumentSourceGroup::computeId(Variables* vars) {
-        // If only one expression return result directly
-        if (_idExpressions.size() == 1)
-            return _idExpressions[0]->evaluate(vars);
+    Value DocumentSourceGroup::computeIdPart(size_t i, const DocumentBatch* batch, size_t row) {
+        return batch ? getBatchOperand(_batchIdOperands[i], *batch, row)
+                     : _idExpressions[i]->evaluate(_variables.get());
+    }
+
+    bool DocumentSourceGroup::IdPartsEqual::operator()(const vector<Value>& parts,
+                                                       const Value& id) const {
+        // Mirrors Value::compare() for Arrays.
+        const vector<Value>& idParts = id.getArray();
+        if (parts.size() != idParts.size())
+            return false;
+
+        for (size_t i = 0; i < parts.size(); i++) {
+            if (Value::compare(parts[i], idParts[i]) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    DocumentSourceGroup::Accumulators& DocumentSourceGroup::findGroup(const DocumentBatch* batch,
+                                                                      size_t row,
+                                                                      bool* inserted,
+                                                                      int* memoryUsageBytes) {
+        if (_idExpressions.size() == 1) {
+            Value id = computeIdPart(0, batch, row);
+
+            /* treat missing values the same as NULL SERVER-4674 */
+            if (id.missing())
+                id = Value(BSONNULL);
+
+            const size_t oldSize = groups.size();
+            Accumulators& group = groups[id];
+            *inserted = groups.size() != oldSize;
+            if (*inserted)
+                *memoryUsageBytes += id.getApproximateSize();
+            return group;
+        }
 
         // Multiple expressions get results wrapped in a vector
-        vector<Value> vals;
-        vals.reserve(_idExpressions.size());
+        _idParts.clear();
+        for (size_t i = 0; i < _idExpressions.size(); i++) {
+            _idParts.push_back(computeIdPart(i, batch, row));
+        }
+
+        const GroupsMap::iterator it = groups.find(_idParts, Value::Hash(), IdPartsEqual());
+        *inserted = it == groups.end();
+        if (!*inserted)
+            return it->second;
+
+        const Value id = Value::consume(_idParts);
+        *memoryUsageBytes += id.getApproximateSize();
+        return groups[id];
+    }
+
+    bool DocumentSourceGroup::makeBatchOperand(const intrusive_ptr<Expression>& expr,
+                                               vector<string>* fields,
+                                               BatchOperand* operand) {
+        if (ExpressionConstant* constant = dynamic_cast<ExpressionConstant*>(expr.get())) {
+            operand->column = -1;
+            operand->constant = constant->getValue();
+            return true;
+        }
+
+        ExpressionFieldPath* fieldPath = dynamic_cast<ExpressionFieldPath*>(expr.get());
+        if (!fieldPath
+                || fieldPath->getVariableId() != Variables::ROOT_ID
+                || fieldPath->getFieldPath().getPathLength() != 2) {
+            return false;
+        }
+
+        const string& field = fieldPath->getFieldPath().getFieldName(1);
+        const vector<string>::iterator it = std::find(fields->begin(), fields->end(), field);
+        operand->column = it - fields->begin();
+        if (it == fields->end()) {
+            fields->push_back(field);
+        }
+        return true;
+    }
+
+    DocumentBatch* DocumentSourceGroup::enableBatchInput() {
+        vector<string> fields;
+        vector<BatchOperand> idOperands(_idExpressions.size());
         for (size_t i = 0; i < _idExpressions.size(); i++) {
-            vals.push_back(_idExpressions[i]->evaluate(vars));
+            if (!makeBatchOperand(_idExpressions[i], &fields, &idOperands[i]))
+                return NULL;
         }
-        return Value::consume(vals);
+
+        vector<BatchOperand> operands(vpExpression.size());
+        for (size_t i = 0; i < vpExpression.size(); i++) {
+            if (!makeBatchOperand(vpExpression[i], &fields, &operands[i]))
+                return NULL;
+        }
+
+        if (!pSource->enableBatches(fields))
+            return NULL;
+
+        _batchIdOperands.swap(idOperands);
+        _batchOperands.swap(operands);
+        return new DocumentBatch(fields);
     }
 
     Value DocumentSourceGroup::expandId(const Value& val) {
@@ -588,7 +1424,17 @@ namespace mongo {
     }
 
     intrusive_ptr<DocumentSource> DocumentSourceGroup::getShardSource() {
-        return this; // No modifications necessary when on shard
+        // The merger can only rebuild our internal key from the output _id if every part of it
+        // is a plain top-level field there.
+        bool canStream = internalAggregationGroupStreamingMerge;
+        for (size_t i = 0; i < _idFieldNames.size(); i++) {
+            const string& name = _idFieldNames[i];
+            if (name.empty() || name[0] == '$' || str::contains(name, '.'))
+                canStream = false;
+        }
+
+        setSortedOutput(canStream);
+        return this;
     }
 
     intrusive_ptr<DocumentSource> DocumentSourceGroup::getMergeSource() {
@@ -597,8 +1443,22 @@ namespace mongo {
 
         VariablesIdGenerator idGenerator;
         VariablesParseState vps(&idGenerator);
-        /* the merger will use the same grouping key */
-        pMerger->_idExpressions.push_back(ExpressionFieldPath::parse("$$ROOT._id", vps));
+        if (_sortedOutput) {
+            // getShardSource() has told the shards to send their groups in order.  To stream
+            // them the merger needs the shards' internal key, which for a compound _id means
+            // grouping on its parts rather than on the document made from them.
+            pMerger->_mergePresorted = true;
+            pMerger->_idFieldNames = _idFieldNames;
+            for (size_t i = 0; i < _idFieldNames.size(); i++) {
+                pMerger->_idExpressions.push_back(
+                    ExpressionFieldPath::parse("$$ROOT._id." + _idFieldNames[i], vps));
+            }
+        }
+
+        if (pMerger->_idExpressions.empty()) {
+            /* the merger will use the same grouping key */
+            pMerger->_idExpressions.push_back(ExpressionFieldPath::parse("$$ROOT._id", vps));
+        }
 
         const size_t n = vFieldName.size();
         for(size_t i = 0; i < n; ++i) {
@@ -31,6 +31,14 @@
 #include "mongo/db/pipeline/document_source.h"
 
 namespace mongo {
+    namespace {
+        const char kModeReplaceCollection[] = "replaceCollection";
+        const char kModeReplaceDocuments[] = "replaceDocuments";
+
+        // The most operations a write command accepts (kMaxWriteBatchSize).
+        const size_t kMaxWriteBatchSize = 1000;
+    }
+
     const char DocumentSourceOut::outName[] = "$out";
 
     DocumentSourceOut::~DocumentSourceOut() {
@@ -47,14 +55,9 @@ namespace mongo {
         return outName;
     }
 
-    static AtomicUInt32 aggOutCounter;
-    void DocumentSourceOut::prepTempCollection() {
+    void DocumentSourceOut::checkOutputNs() {
         verify(_mongod);
-        verify(_tempNs.size() == 0);
 
-        DBClientBase* conn = _mongod->directClient();
-
-        // Fail early by checking before we do any work.
         uassert(17017, str::stream() << "namespace '" << _outputNs.ns()
                                      << "' is sharded so it can't be used for $out'",
                 !_mongod->isSharded(_outputNs));
@@ -63,6 +66,14 @@ namespace mongo {
         uassert(17152, str::stream() << "namespace '" << _outputNs.ns()
                                      << "' is capped so it can't be used for $out",
                 !_mongod->isCapped(_outputNs));
+    }
+
+    static AtomicUInt32 aggOutCounter;
+    void DocumentSourceOut::prepTempCollection() {
+        verify(_mongod);
+        verify(_tempNs.size() == 0);
+
+        DBClientBase* conn = _mongod->directClient();
 
         _tempNs = NamespaceString(StringData(str::stream() << _outputNs.db()
                                              << ".tmp.agg_out."
@@ -96,11 +107,29 @@ namespace mongo {
         }
     }
 
-    void DocumentSourceOut::spill(DBClientBase* conn, const vector<BSONObj>& toInsert) {
-        conn->insert(_tempNs.ns(), toInsert);
-        BSONObj err = conn->getLastErrorDetailed();
-        uassert(16996, str::stream() << "insert for $out failed: " << err,
-                DBClientWithCommands::getLastErrorString(err).empty());
+    void DocumentSourceOut::spill(DBClientBase* conn, const vector<BSONObj>& toWrite) {
+        // A write command goes through the batch write path, which writes a whole batch
+        // without going back to the client for each document.
+        BSONObjBuilder cmd;
+        if (_mode == REPLACE_COLLECTION) {
+            cmd.append("insert", _tempNs.coll());
+            BSONArrayBuilder documents(cmd.subarrayStart("documents"));
+            for (size_t i = 0; i < toWrite.size(); i++) {
+                documents.append(toWrite[i]);
+            }
+            documents.doneFast();
+        }
+        else {
+            cmd.append("update", _outputNs.coll());
+            cmd.append("updates", toWrite);
+        }
+        cmd.append("ordered", true);
+
+        BSONObj info;
+        const bool ok = conn->runCommand(_outputNs.db().toString(), cmd.done(), info);
+        uassert(16996, str::stream() << (_mode == REPLACE_COLLECTION ? "insert" : "update")
+                                     << " for $out failed: " << info,
+                ok && !info.hasField("writeErrors") && !info.hasField("writeConcernError"));
     }
 
     boost::optional<Document> DocumentSourceOut::getNext() {
@@ -114,20 +143,37 @@ namespace mongo {
         verify(_mongod);
         DBClientBase* conn = _mongod->directClient();
 
-        prepTempCollection();
-        verify(_tempNs.size() != 0);
+        // Fail early by checking before we do any work.
+        checkOutputNs();
+
+        if (_mode == REPLACE_COLLECTION) {
+            prepTempCollection();
+            verify(_tempNs.size() != 0);
+        }
 
+        // Batches are as large as a write command allows: the command can go a little over
+        // BSONObjMaxUserSize, which leaves room for the array indexes and the other fields.
         vector<BSONObj> bufferedObjects;
         int bufferedBytes = 0;
         while (boost::optional<Document> next = pSource->getNext()) {
-            BSONObj toInsert = next->toBson();
-            bufferedBytes += toInsert.objsize();
-            if (!bufferedObjects.empty() && bufferedBytes > BSONObjMaxUserSize) {
+            BSONObj toWrite = next->toBson();
+            if (_mode == REPLACE_DOCUMENTS) {
+                const BSONElement id = toWrite["_id"];
+                uassert(28608, str::stream() << "$out with mode '" << kModeReplaceDocuments
+                                             << "' needs an _id in every document: " << toWrite,
+                        !id.eoo());
+                toWrite = BSON("q" << BSON("_id" << id) << "u" << toWrite << "upsert" << true);
+            }
+
+            bufferedBytes += toWrite.objsize();
+            if (!bufferedObjects.empty()
+                    && (bufferedBytes > BSONObjMaxUserSize
+                        || bufferedObjects.size() == kMaxWriteBatchSize)) {
                 spill(conn, bufferedObjects);
                 bufferedObjects.clear();
-                bufferedBytes = toInsert.objsize();
+                bufferedBytes = toWrite.objsize();
             }
-            bufferedObjects.push_back(toInsert);
+            bufferedObjects.push_back(toWrite);
         }
 
         if (!bufferedObjects.empty())
@@ -138,6 +184,11 @@ namespace mongo {
                                      << "' became sharded so it can't be used for $out'",
                 !_mongod->isSharded(_outputNs));
 
+        if (_mode == REPLACE_DOCUMENTS) {
+            // The results went straight into the output collection.
+            return boost::none;
+        }
+
         BSONObj rename = BSON("renameCollection" << _tempNs.ns()
                            << "to" << _outputNs.ns()
                            << "dropTarget" << true
@@ -156,31 +207,75 @@ namespace mongo {
     }
 
     DocumentSourceOut::DocumentSourceOut(const NamespaceString& outputNs,
+                                         Mode mode,
                                          const intrusive_ptr<ExpressionContext>& pExpCtx)
         : DocumentSource(pExpCtx)
         , _done(false)
+        , _mode(mode)
         , _tempNs("") // filled in by prepTempCollection
         , _outputNs(outputNs)
     {}
 
+    void DocumentSourceOut::parseSpec(BSONElement elem, string* outputColl, Mode* mode) {
+        if (elem.type() == String) {
+            *outputColl = elem.str();
+            *mode = REPLACE_COLLECTION;
+            return;
+        }
+
+        uassert(16990, str::stream() << "$out only supports a string or object argument, not "
+                                     << typeName(elem.type()),
+                elem.type() == Object);
+
+        *outputColl = "";
+        *mode = REPLACE_COLLECTION;
+        BSONForEach(field, elem.Obj()) {
+            const StringData fieldName = field.fieldNameStringData();
+            if (fieldName == "to") {
+                uassert(28609, "$out's 'to' must be a string", field.type() == String);
+                *outputColl = field.str();
+            }
+            else if (fieldName == "mode") {
+                uassert(28610, str::stream() << "$out's 'mode' must be '"
+                                             << kModeReplaceCollection << "' or '"
+                                             << kModeReplaceDocuments << "', not " << field,
+                        field.type() == String
+                            && (field.valueStringData() == kModeReplaceCollection
+                                || field.valueStringData() == kModeReplaceDocuments));
+                *mode = field.valueStringData() == kModeReplaceDocuments ? REPLACE_DOCUMENTS
+                                                                         : REPLACE_COLLECTION;
+            }
+            else {
+                uasserted(28611, str::stream() << "unknown option to $out: " << fieldName);
+            }
+        }
+        uassert(28612, "$out needs a 'to' collection", !outputColl->empty());
+    }
+
     intrusive_ptr<DocumentSource> DocumentSourceOut::createFromBson(
             BSONElement elem,
             const intrusive_ptr<ExpressionContext> &pExpCtx) {
-        uassert(16990, str::stream() << "$out only supports a string argument, not "
-                                     << typeName(elem.type()),
-                elem.type() == String);
-        
-        NamespaceString outputNs(pExpCtx->ns.db().toString() + '.' + elem.str());
-        uassert(17385, "Can't $out to special collection: " + elem.str(),
+        string outputColl;
+        Mode mode;
+        parseSpec(elem, &outputColl, &mode);
+
+        NamespaceString outputNs(pExpCtx->ns.db().toString() + '.' + outputColl);
+        uassert(17385, "Can't $out to special collection: " + outputColl,
                 !outputNs.isSpecial());
-        return new DocumentSourceOut(outputNs, pExpCtx);
+        return new DocumentSourceOut(outputNs, mode, pExpCtx);
     }
 
     Value DocumentSourceOut::serialize(bool explain) const {
         massert(17000, "$out shouldn't have different db than input",
                 _outputNs.db() == pExpCtx->ns.db());
 
-        return Value(DOC(getSourceName() << _outputNs.coll()));
+        // The original form is kept for replacing the collection, so that older versions
+        // running the merge of a sharded aggregation can parse it.
+        if (_mode == REPLACE_COLLECTION)
+            return Value(DOC(getSourceName() << _outputNs.coll()));
+
+        return Value(DOC(getSourceName() << DOC("to" << _outputNs.coll()
+                                             << "mode" << kModeReplaceDocuments)));
     }
 
     DocumentSource::GetDepsReturn DocumentSourceOut::getDependencies(DepsTracker* deps) const {
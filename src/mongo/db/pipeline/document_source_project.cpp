@@ -32,6 +32,7 @@
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_compiled.h"
 #include "mongo/db/pipeline/value.h"
 
 namespace mongo {
@@ -73,9 +74,74 @@ namespace mongo {
         return out.freeze();
     }
 
+    bool DocumentSourceProject::enableBatches(const vector<string>& fields) {
+        // Map each output field of a simple projection to the input field it comes from.
+        map<string, string> renames;
+        renames["_id"] = "_id";
+        BSONForEach(elem, _raw) {
+            const string outputField = elem.fieldName();
+            if (elem.isBoolean() || elem.isNumber()) {
+                if (elem.trueValue()) {
+                    renames[outputField] = outputField;
+                }
+                else {
+                    // Only _id may be excluded.
+                    renames.erase(outputField);
+                }
+            }
+            else if (elem.type() == String
+                     && elem.valuestr()[0] == '$'
+                     && elem.valuestr()[1] != '$'
+                     && !str::contains(elem.valuestr(), '.')) {
+                renames[outputField] = elem.valuestr() + 1;
+            }
+            else {
+                return false;
+            }
+        }
+
+        vector<string> inputFields;
+        vector<int> sourceColumns;
+        for (size_t i = 0; i < fields.size(); i++) {
+            map<string, string>::const_iterator it = renames.find(fields[i]);
+            if (it == renames.end()) {
+                sourceColumns.push_back(-1);
+                continue;
+            }
+
+            const vector<string>::const_iterator existing =
+                std::find(inputFields.begin(), inputFields.end(), it->second);
+            sourceColumns.push_back(existing - inputFields.begin());
+            if (existing == inputFields.end()) {
+                inputFields.push_back(it->second);
+            }
+        }
+
+        if (!pSource->enableBatches(inputFields))
+            return false;
+
+        _inputBatch.reset(new DocumentBatch(inputFields));
+        _batchSourceColumns.swap(sourceColumns);
+        return true;
+    }
+
+    bool DocumentSourceProject::getNextBatch(DocumentBatch* batch) {
+        pExpCtx->checkForInterrupt();
+        verify(_inputBatch);
+
+        if (!pSource->getNextBatch(_inputBatch.get())) {
+            batch->clear();
+            return false;
+        }
+
+        batch->copyColumns(*_inputBatch, _batchSourceColumns);
+        return true;
+    }
+
     void DocumentSourceProject::optimize() {
         intrusive_ptr<Expression> pE(pEO->optimize());
         pEO = dynamic_pointer_cast<ExpressionObject>(pE);
+        pEO->compileFields();
     }
 
     Value DocumentSourceProject::serialize(bool explain) const {
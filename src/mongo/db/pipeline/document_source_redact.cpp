@@ -35,6 +35,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_compiled.h"
 #include "mongo/db/pipeline/value.h"
 
 namespace mongo {
@@ -135,7 +136,7 @@ namespace mongo {
     }
 
     void DocumentSourceRedact::optimize() {
-        _expression = _expression->optimize();
+        _expression = ExpressionCompiled::compile(_expression->optimize());
     }
 
     Value DocumentSourceRedact::serialize(bool explain) const {
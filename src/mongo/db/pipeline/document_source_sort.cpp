@@ -35,8 +35,13 @@
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
+    // The memory $sort may use before it spills to disk, or fails if it may not.
+    MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceSortMaxMemoryBytes, int, 100*1024*1024);
+    MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceSortThreads, int, 4);
+
     const char DocumentSourceSort::sortName[] = "$sort";
 
     const char *DocumentSourceSort::getSourceName() const {
@@ -83,6 +88,8 @@ namespace mongo {
         : DocumentSource(pExpCtx)
         , populated(false)
         , _mergingPresorted(false)
+        , _peakMemoryUsageBytes(0)
+        , _spilledBytes(0)
     {}
 
     long long DocumentSourceSort::getLimit() const {
@@ -208,7 +215,9 @@ namespace mongo {
         if (limitSrc)
             opts.limit = limitSrc->getLimit();
 
-        opts.maxMemoryUsageBytes = 100*1024*1024;
+        opts.maxMemoryUsageBytes = internalDocumentSourceSortMaxMemoryBytes;
+        opts.sortThreads = std::max(internalDocumentSourceSortThreads, 1);
+        opts.memoryTracker = &pExpCtx->memoryTracker;
         if (pExpCtx->extSortAllowed && !pExpCtx->inRouter) {
             opts.extSortAllowed = true;
             opts.tempDir = pExpCtx->tempDir;
@@ -232,8 +241,11 @@ namespace mongo {
             scoped_ptr<MySorter> sorter (MySorter::make(makeSortOptions(), Comparator(*this)));
             while (boost::optional<Document> next = pSource->getNext()) {
                 sorter->add(extractKey(*next), *next);
+                _peakMemoryUsageBytes = std::max(_peakMemoryUsageBytes,
+                                                 static_cast<long long>(sorter->memUsed()));
             }
             _output.reset(sorter->done());
+            _spilledBytes = sorter->spilledBytes();
         }
         populated = true;
     }
@@ -44,6 +44,12 @@ namespace mongo {
         /** Reset the unwinder to unwind a new document. */
         void resetDocument(const Document& document);
 
+        /**
+         * Only keep the top-level 'fields', and the unwound one, in the unwound documents.  Each
+         * one shares the input's values but has its own copy of their names and positions.
+         */
+        void keepOnlyFields(const std::set<std::string>& fields);
+
         /**
          * @return the next document unwound from the document provided to resetDocument(), using
          * the current value in the array located at the provided unwindPath.
@@ -56,6 +62,9 @@ namespace mongo {
         // Path to the array to unwind.
         const FieldPath _unwindPath;
 
+        // If not empty, the only top-level fields to output.
+        std::set<std::string> _fieldsToKeep;
+
         Value _inputArray;
         MutableDocument _output;
 
@@ -69,7 +78,24 @@ namespace mongo {
         _unwindPath(unwindPath) {
     }
 
-    void DocumentSourceUnwind::Unwinder::resetDocument(const Document& document) {
+    void DocumentSourceUnwind::Unwinder::keepOnlyFields(const std::set<std::string>& fields) {
+        _fieldsToKeep = fields;
+        _fieldsToKeep.insert(_unwindPath.getFieldName(0));
+    }
+
+    void DocumentSourceUnwind::Unwinder::resetDocument(const Document& input) {
+        Document document = input;
+        if (!_fieldsToKeep.empty()) {
+            MutableDocument trimmed;
+            FieldIterator fields(input);
+            while (fields.more()) {
+                Document::FieldPair field = fields.next();
+                if (_fieldsToKeep.count(field.first.toString()))
+                    trimmed.addField(field.first, field.second);
+            }
+            trimmed.copyMetaDataFrom(input);
+            document = trimmed.freeze();
+        }
 
         // Reset document specific attributes.
         _inputArray = Value();
@@ -148,6 +174,18 @@ namespace mongo {
         return SEE_NEXT;
     }
 
+    void DocumentSourceUnwind::setOutputDependencies(const DepsTracker& deps) {
+        if (deps.needWholeDocument)
+            return;
+
+        std::set<std::string> topLevelFields;
+        for (std::set<std::string>::const_iterator it = deps.fields.begin();
+                it != deps.fields.end(); ++it) {
+            topLevelFields.insert(it->substr(0, it->find('.')));
+        }
+        _unwinder->keepOnlyFields(topLevelFields);
+    }
+
     void DocumentSourceUnwind::unwindPath(const FieldPath &fieldPath) {
         // Can't set more than one unwind path.
         uassert(15979, str::stream() << unwindName << "can't unwind more than one path",
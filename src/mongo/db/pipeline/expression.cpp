@@ -37,6 +37,7 @@
 #include "mongo/base/init.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression_compiled.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/stdx/functional.h"
@@ -1076,6 +1077,18 @@ namespace {
         return intrusive_ptr<Expression>(this);
     }
 
+    void ExpressionObject::compileFields() {
+        for (FieldMap::iterator it(_expressions.begin()); it!=_expressions.end(); ++it) {
+            if (!it->second)
+                continue;
+
+            if (ExpressionObject* subObj = dynamic_cast<ExpressionObject*>(it->second.get()))
+                subObj->compileFields();
+            else
+                it->second = ExpressionCompiled::compile(it->second);
+        }
+    }
+
     bool ExpressionObject::isSimple() {
         for (FieldMap::iterator it(_expressions.begin()); it!=_expressions.end(); ++it) {
             if (it->second && !it->second->isSimple())
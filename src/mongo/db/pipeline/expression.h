@@ -302,6 +302,8 @@ namespace mongo {
         */
         virtual void addOperand(const intrusive_ptr<Expression> &pExpression);
 
+        const std::vector<intrusive_ptr<Expression> >& getOperands() const { return vpOperand; }
+
         // TODO split this into two functions
         virtual bool isAssociativeAndCommutative() const { return false; }
 
@@ -406,6 +408,7 @@ namespace mongo {
         static intrusive_ptr<ExpressionCoerceToBool> create(
             const intrusive_ptr<Expression> &pExpression);
 
+        const intrusive_ptr<Expression>& getOperand() const { return pExpression; }
 
     private:
         ExpressionCoerceToBool(const intrusive_ptr<Expression> &pExpression);
@@ -441,6 +444,8 @@ namespace mongo {
 
         ExpressionCompare(CmpOp cmpOp);
 
+        CmpOp getCmpOp() const { return cmpOp; }
+
     private:
         CmpOp cmpOp;
     };
@@ -594,6 +599,7 @@ namespace mongo {
             const VariablesParseState& vps);
 
         const FieldPath& getFieldPath() const { return _fieldPath; }
+        Variables::Id getVariableId() const { return _variable; }
 
     private:
         ExpressionFieldPath(const std::string& fieldPath, Variables::Id variable);
@@ -858,6 +864,12 @@ namespace mongo {
 
         void excludeId(bool b) { _excludeId = b; }
 
+        /**
+         * Replaces each computed field's expression, here and in nested objects, by its compiled
+         * form where it has one (see ExpressionCompiled).  Call after optimize().
+         */
+        void compileFields();
+
     private:
         ExpressionObject(bool atRoot);
 
@@ -0,0 +1,648 @@
+// expression_compiled.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/pch.h"
+
+#include "mongo/db/pipeline/expression_compiled.h"
+
+#include <map>
+#include <string>
+
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    const int ExpressionCompiled::kMaxRegisters;
+
+    /** Emits the program for a tree into an ExpressionCompiled, one node at a time. */
+    class ExpressionCompiled::Compiler {
+    public:
+        explicit Compiler(ExpressionCompiled* compiled)
+            : _compiled(compiled)
+            , _nextRegister(1) // register 0 holds the result
+            , _maxRegisters(1)
+            , _overflow(false)
+        {}
+
+        /** Returns false if the program would need more than kMaxRegisters registers. */
+        bool compileRoot(Expression* expression) {
+            // A field path used more than once gets a register of its own for the whole program,
+            // so that its field is only looked up once per evaluation.
+            countFieldUses(expression);
+            for (FieldMap::iterator it = _fields.begin(); it != _fields.end(); ++it) {
+                if (it->second.uses > 1) {
+                    it->second.cacheRegister = allocate(1);
+                    it->second.leaf = _compiled->_leaves.size();
+                    _compiled->_leaves.push_back(it->second.expression);
+                }
+            }
+
+            compileNode(expression, 0);
+            _compiled->_numRegisters = _maxRegisters;
+            return !_overflow;
+        }
+
+        /** Whether 'expression' gets its own instruction rather than being a leaf. */
+        static bool isOperator(Expression* expression) {
+            return dynamic_cast<ExpressionAdd*>(expression)
+                || dynamic_cast<ExpressionMultiply*>(expression)
+                || dynamic_cast<ExpressionSubtract*>(expression)
+                || dynamic_cast<ExpressionDivide*>(expression)
+                || dynamic_cast<ExpressionCompare*>(expression)
+                || dynamic_cast<ExpressionAnd*>(expression)
+                || dynamic_cast<ExpressionOr*>(expression)
+                || dynamic_cast<ExpressionCoerceToBool*>(expression)
+                || dynamic_cast<ExpressionCond*>(expression);
+        }
+
+    private:
+        typedef std::vector<intrusive_ptr<Expression> > Operands;
+
+        struct FieldUses {
+            FieldUses() : uses(0), cacheRegister(0), leaf(0) {}
+
+            Expression* expression;
+            int uses;
+            int cacheRegister; // 0 if not cached
+            int leaf;
+        };
+
+        // Keyed by variable id and path, so that equal field paths are shared.
+        typedef std::map<std::string, FieldUses> FieldMap;
+
+        static std::string fieldKey(const ExpressionFieldPath* fieldPath) {
+            return str::stream() << fieldPath->getVariableId() << ':'
+                                 << fieldPath->getFieldPath().getPath(false);
+        }
+
+        /** Counts the field paths the program will load, i.e. those not inside a leaf. */
+        void countFieldUses(Expression* expression) {
+            if (ExpressionFieldPath* fieldPath = dynamic_cast<ExpressionFieldPath*>(expression)) {
+                FieldUses& field = _fields[fieldKey(fieldPath)];
+                field.expression = expression;
+                field.uses++;
+            }
+            else if (ExpressionCoerceToBool* coerce =
+                         dynamic_cast<ExpressionCoerceToBool*>(expression)) {
+                countFieldUses(coerce->getOperand().get());
+            }
+            else if (isOperator(expression)) {
+                const Operands& operands =
+                    static_cast<ExpressionNary*>(expression)->getOperands();
+                for (size_t i = 0; i < operands.size(); i++) {
+                    countFieldUses(operands[i].get());
+                }
+            }
+        }
+
+        /** Reserves 'count' consecutive registers and returns the first. */
+        int allocate(int count) {
+            const int first = _nextRegister;
+            _nextRegister += count;
+            _maxRegisters = std::max(_maxRegisters, _nextRegister);
+            if (_nextRegister > kMaxRegisters)
+                _overflow = true;
+            return first;
+        }
+
+        size_t emit(OpCode op, int dst, int src = 0, int arg = 0, int target2 = 0) {
+            Instruction instruction = { op, dst, src, arg, target2 };
+            _compiled->_program.push_back(instruction);
+            return _compiled->_program.size() - 1;
+        }
+
+        /** Compiles the operands into consecutive registers, then 'op' over them into 'dst'. */
+        void compileNary(OpCode op, const Operands& operands, int dst, int arg) {
+            const int first = allocate(operands.size());
+            if (_overflow)
+                return;
+            for (size_t i = 0; i < operands.size(); i++) {
+                compileNode(operands[i].get(), first + i);
+            }
+            emit(op, dst, first, arg);
+            _nextRegister = first;
+        }
+
+        void compileNode(Expression* expression, int dst) {
+            if (_overflow)
+                return;
+
+            if (ExpressionConstant* constant = dynamic_cast<ExpressionConstant*>(expression)) {
+                Register reg;
+                reg.set(constant->getValue());
+                _compiled->_constants.push_back(reg);
+                emit(LOAD_CONSTANT, dst, 0, _compiled->_constants.size() - 1);
+            }
+            else if (ExpressionFieldPath* fieldPath = dynamic_cast<ExpressionFieldPath*>(expression)) {
+                const FieldUses& field = _fields[fieldKey(fieldPath)];
+                if (field.cacheRegister) {
+                    emit(LOAD_CACHED_FIELD, dst, field.cacheRegister, field.leaf);
+                }
+                else {
+                    _compiled->_leaves.push_back(expression);
+                    emit(LOAD_FIELD, dst, 0, _compiled->_leaves.size() - 1);
+                }
+            }
+            else if (ExpressionAdd* add = dynamic_cast<ExpressionAdd*>(expression)) {
+                compileNary(ADD, add->getOperands(), dst, add->getOperands().size());
+            }
+            else if (ExpressionMultiply* mul = dynamic_cast<ExpressionMultiply*>(expression)) {
+                compileNary(MULTIPLY, mul->getOperands(), dst, mul->getOperands().size());
+            }
+            else if (ExpressionSubtract* sub = dynamic_cast<ExpressionSubtract*>(expression)) {
+                compileNary(SUBTRACT, sub->getOperands(), dst, 0);
+            }
+            else if (ExpressionDivide* div = dynamic_cast<ExpressionDivide*>(expression)) {
+                compileNary(DIVIDE, div->getOperands(), dst, 0);
+            }
+            else if (ExpressionCompare* cmp = dynamic_cast<ExpressionCompare*>(expression)) {
+                compileNary(COMPARE, cmp->getOperands(), dst, cmp->getCmpOp());
+            }
+            else if (ExpressionAnd* andExpr = dynamic_cast<ExpressionAnd*>(expression)) {
+                compileNary(AND, andExpr->getOperands(), dst, andExpr->getOperands().size());
+            }
+            else if (ExpressionOr* orExpr = dynamic_cast<ExpressionOr*>(expression)) {
+                compileNary(OR, orExpr->getOperands(), dst, orExpr->getOperands().size());
+            }
+            else if (ExpressionCoerceToBool* coerce =
+                         dynamic_cast<ExpressionCoerceToBool*>(expression)) {
+                Operands operands(1, coerce->getOperand());
+                compileNary(TO_BOOL, operands, dst, 0);
+            }
+            else if (ExpressionCond* cond = dynamic_cast<ExpressionCond*>(expression)) {
+                // The condition goes into dst, which the chosen branch then overwrites, so that
+                // only the branch the condition picks is run.
+                const Operands& operands = cond->getOperands();
+                compileNode(operands[0].get(), dst);
+                const size_t jumpUnless = emit(JUMP_UNLESS, dst, dst);
+                compileNode(operands[1].get(), dst);
+                const size_t jumpToEnd = emit(JUMP, dst);
+                _compiled->_program[jumpUnless].arg = _compiled->_program.size();
+                compileNode(operands[2].get(), dst);
+                _compiled->_program[jumpUnless].target2 = _compiled->_program.size();
+                _compiled->_program[jumpToEnd].arg = _compiled->_program.size();
+            }
+            else {
+                _compiled->_leaves.push_back(expression);
+                emit(EVALUATE, dst, 0, _compiled->_leaves.size() - 1);
+            }
+        }
+
+        ExpressionCompiled* const _compiled;
+        FieldMap _fields;
+        int _nextRegister;
+        int _maxRegisters;
+        bool _overflow;
+    };
+
+    intrusive_ptr<Expression> ExpressionCompiled::compile(
+            const intrusive_ptr<Expression>& expression) {
+        // Leaves and trees made of operators the program doesn't know gain nothing.
+        if (!Compiler::isOperator(expression.get()))
+            return expression;
+
+        intrusive_ptr<ExpressionCompiled> compiled = new ExpressionCompiled(expression);
+        Compiler compiler(compiled.get());
+        if (!compiler.compileRoot(expression.get()))
+            return expression;
+
+        return compiled;
+    }
+
+    ExpressionCompiled::ExpressionCompiled(const intrusive_ptr<Expression>& original)
+        : _original(original)
+        , _numRegisters(0)
+    {}
+
+    void ExpressionCompiled::addDependencies(DepsTracker* deps, vector<string>* path) const {
+        _original->addDependencies(deps, path);
+    }
+
+    Value ExpressionCompiled::serialize(bool explain) const {
+        return _original->serialize(explain);
+    }
+
+    Value ExpressionCompiled::evaluateInternal(Variables* vars) const {
+        // Each register holds a Value, so don't construct more of them than the program uses.
+        if (_numRegisters <= 4)
+            return evaluateWith<4>(vars);
+        if (_numRegisters <= 8)
+            return evaluateWith<8>(vars);
+        return evaluateWith<kMaxRegisters>(vars);
+    }
+
+    template <int NumRegisters>
+    Value ExpressionCompiled::evaluateWith(Variables* vars) const {
+        Register regs[NumRegisters];
+        run(regs, vars);
+
+        if (regs[0].kind == Register::DEFERRED) {
+            // Something the program doesn't handle, or an error: the tree walk knows what to do.
+            return _original->evaluateInternal(vars);
+        }
+        return regs[0].get();
+    }
+
+    void ExpressionCompiled::run(Register* regs, Variables* vars) const {
+        // The cached fields already loaded, by register.  A branch may not load a field the
+        // other one does, so they are loaded on first use.
+        unsigned loadedFields = 0;
+
+        const size_t end = _program.size();
+        size_t pc = 0;
+        while (pc < end) {
+            const Instruction& instruction = _program[pc];
+            Register& dst = regs[instruction.dst];
+            const Register* src = regs + instruction.src;
+            pc++;
+
+            switch (instruction.op) {
+            case LOAD_CONSTANT:
+                dst.copy(_constants[instruction.arg]);
+                break;
+
+            case LOAD_FIELD:
+                dst.set(_leaves[instruction.arg]->evaluateInternal(vars));
+                break;
+
+            case LOAD_CACHED_FIELD: {
+                Register& cache = regs[instruction.src];
+                const unsigned bit = 1u << instruction.src;
+                if (!(loadedFields & bit)) {
+                    cache.set(_leaves[instruction.arg]->evaluateInternal(vars));
+                    loadedFields |= bit;
+                }
+                dst.copy(cache);
+                break;
+            }
+
+            case EVALUATE:
+                // The tree walk may never have evaluated this operand, e.g. if an $add meets
+                // null first, so an error here can't be raised yet.
+                try {
+                    dst.set(_leaves[instruction.arg]->evaluateInternal(vars));
+                }
+                catch (const DBException&) {
+                    dst.kind = Register::DEFERRED;
+                }
+                break;
+
+            case ADD:
+                add(src, instruction.arg, &dst);
+                break;
+
+            case MULTIPLY:
+                multiply(src, instruction.arg, &dst);
+                break;
+
+            case SUBTRACT:
+                subtract(src[0], src[1], &dst);
+                break;
+
+            case DIVIDE:
+                divide(src[0], src[1], &dst);
+                break;
+
+            case COMPARE:
+                compare(src[0], src[1], ExpressionCompare::CmpOp(instruction.arg), &dst);
+                break;
+
+            case AND:
+            case OR:
+                andOr(src, instruction.arg, instruction.op == AND, &dst);
+                break;
+
+            case TO_BOOL:
+                toBool(src[0], &dst);
+                break;
+
+            case JUMP_UNLESS: {
+                bool truth;
+                if (!truthOf(src[0], &truth)) {
+                    dst.kind = Register::DEFERRED;
+                    pc = instruction.target2;
+                }
+                else if (!truth) {
+                    pc = instruction.arg;
+                }
+                break;
+            }
+
+            case JUMP:
+                pc = instruction.arg;
+                break;
+            }
+        }
+    }
+
+namespace {
+    // The numeric kinds are ordered INT < LONG < DOUBLE, so the wider of two is the larger, as
+    // with Value::getWidestNumeric().
+    template <typename Register>
+    inline bool isNumber(const Register& reg) {
+        return reg.kind == Register::INT || reg.kind == Register::LONG
+            || reg.kind == Register::DOUBLE;
+    }
+
+    template <typename Register>
+    inline long long toLong(const Register& reg) {
+        switch (reg.kind) {
+        case Register::INT: return reg.intValue;
+        case Register::LONG: return reg.longValue;
+        default: return static_cast<long long>(reg.doubleValue);
+        }
+    }
+
+    template <typename Register>
+    inline double toDouble(const Register& reg) {
+        switch (reg.kind) {
+        case Register::INT: return reg.intValue;
+        case Register::LONG: return static_cast<double>(reg.longValue);
+        default: return reg.doubleValue;
+        }
+    }
+
+    template <typename Register>
+    inline bool isNullish(const Register& reg) {
+        return reg.kind == Register::VALUE && reg.value.nullish();
+    }
+
+    template <typename Register>
+    inline void setNull(Register* out) {
+        out->kind = Register::VALUE;
+        out->value = Value(BSONNULL);
+    }
+
+    template <typename Register>
+    inline void setIntOrLong(long long longValue, Register* out) {
+        const int intValue = longValue;
+        if (intValue == longValue) {
+            out->kind = Register::INT;
+            out->intValue = intValue;
+        }
+        else {
+            out->kind = Register::LONG;
+            out->longValue = longValue;
+        }
+    }
+
+    /** Sets 'out' to the narrowest result of 'kind' from the two totals, as $add does. */
+    template <typename Register>
+    inline void setNumber(int kind, long long longValue, double doubleValue, Register* out) {
+        if (kind == Register::DOUBLE) {
+            out->kind = Register::DOUBLE;
+            out->doubleValue = doubleValue;
+        }
+        else if (kind == Register::LONG) {
+            out->kind = Register::LONG;
+            out->longValue = longValue;
+        }
+        else {
+            setIntOrLong(longValue, out);
+        }
+    }
+}
+
+    void ExpressionCompiled::Register::set(const Value& val) {
+        switch (val.getType()) {
+        case NumberInt:
+            kind = INT;
+            intValue = val.getInt();
+            break;
+        case NumberLong:
+            kind = LONG;
+            longValue = val.getLong();
+            break;
+        case NumberDouble:
+            kind = DOUBLE;
+            doubleValue = val.getDouble();
+            break;
+        case Bool:
+            kind = BOOL;
+            boolValue = val.getBool();
+            break;
+        default:
+            kind = VALUE;
+            value = val;
+            break;
+        }
+    }
+
+    void ExpressionCompiled::Register::copy(const Register& other) {
+        kind = other.kind;
+        if (kind == VALUE)
+            value = other.value;
+        else
+            longValue = other.longValue; // the widest member of the union
+    }
+
+    Value ExpressionCompiled::Register::get() const {
+        switch (kind) {
+        case INT: return Value(intValue);
+        case LONG: return Value(longValue);
+        case DOUBLE: return Value(doubleValue);
+        case BOOL: return Value(boolValue);
+        case VALUE: return value;
+        case DEFERRED: break;
+        }
+        verify(false);
+    }
+
+    // The arithmetic below mirrors the evaluateInternal() of the corresponding expressions for
+    // numbers and null, and defers everything else to them.
+
+    void ExpressionCompiled::add(const Register* operands, int count, Register* out) {
+        double doubleTotal = 0;
+        long long longTotal = 0;
+        int totalKind = Register::INT;
+        for (int i = 0; i < count; i++) {
+            const Register& operand = operands[i];
+            if (isNumber(operand)) {
+                totalKind = std::max(totalKind, int(operand.kind));
+                doubleTotal += toDouble(operand);
+                longTotal += toLong(operand);
+            }
+            else if (isNullish(operand)) {
+                setNull(out);
+                return;
+            }
+            else {
+                out->kind = Register::DEFERRED;
+                return;
+            }
+        }
+        setNumber(totalKind, longTotal, doubleTotal, out);
+    }
+
+    void ExpressionCompiled::multiply(const Register* operands, int count, Register* out) {
+        double doubleProduct = 1;
+        long long longProduct = 1;
+        int productKind = Register::INT;
+        for (int i = 0; i < count; i++) {
+            const Register& operand = operands[i];
+            if (isNumber(operand)) {
+                productKind = std::max(productKind, int(operand.kind));
+                doubleProduct *= toDouble(operand);
+                longProduct *= toLong(operand);
+            }
+            else if (isNullish(operand)) {
+                setNull(out);
+                return;
+            }
+            else {
+                out->kind = Register::DEFERRED;
+                return;
+            }
+        }
+        setNumber(productKind, longProduct, doubleProduct, out);
+    }
+
+    void ExpressionCompiled::subtract(const Register& left, const Register& right,
+                                      Register* out) {
+        if (isNumber(left) && isNumber(right)) {
+            const int kind = std::max(int(left.kind), int(right.kind));
+            if (kind == Register::DOUBLE) {
+                out->kind = Register::DOUBLE;
+                out->doubleValue = toDouble(left) - toDouble(right);
+            }
+            else {
+                setNumber(kind, toLong(left) - toLong(right), 0, out);
+            }
+        }
+        else if (left.kind != Register::DEFERRED && right.kind != Register::DEFERRED
+                 && (isNullish(left) || isNullish(right))) {
+            setNull(out);
+        }
+        else {
+            out->kind = Register::DEFERRED;
+        }
+    }
+
+    void ExpressionCompiled::divide(const Register& left, const Register& right, Register* out) {
+        if (isNumber(left) && isNumber(right)) {
+            const double denom = toDouble(right);
+            if (denom == 0) {
+                out->kind = Register::DEFERRED;
+                return;
+            }
+            out->kind = Register::DOUBLE;
+            out->doubleValue = toDouble(left) / denom;
+        }
+        else if (left.kind != Register::DEFERRED && right.kind != Register::DEFERRED
+                 && (isNullish(left) || isNullish(right))) {
+            setNull(out);
+        }
+        else {
+            out->kind = Register::DEFERRED;
+        }
+    }
+
+    void ExpressionCompiled::compare(const Register& left, const Register& right,
+                                     ExpressionCompare::CmpOp op, Register* out) {
+        if (left.kind == Register::DEFERRED || right.kind == Register::DEFERRED) {
+            out->kind = Register::DEFERRED;
+            return;
+        }
+
+        int cmp;
+        if ((left.kind == Register::INT || left.kind == Register::LONG)
+                && (right.kind == Register::INT || right.kind == Register::LONG)) {
+            const long long l = toLong(left);
+            const long long r = toLong(right);
+            cmp = l < r ? -1 : l > r ? 1 : 0;
+        }
+        else {
+            // Doubles need the NaN ordering of Value::compare().
+            cmp = Value::compare(left.get(), right.get());
+            cmp = cmp < 0 ? -1 : cmp > 0 ? 1 : 0;
+        }
+
+        if (op == ExpressionCompare::CMP) {
+            out->kind = Register::INT;
+            out->intValue = cmp;
+            return;
+        }
+
+        bool result = false;
+        switch (op) {
+        case ExpressionCompare::EQ: result = cmp == 0; break;
+        case ExpressionCompare::NE: result = cmp != 0; break;
+        case ExpressionCompare::GT: result = cmp > 0; break;
+        case ExpressionCompare::GTE: result = cmp >= 0; break;
+        case ExpressionCompare::LT: result = cmp < 0; break;
+        case ExpressionCompare::LTE: result = cmp <= 0; break;
+        case ExpressionCompare::CMP: break;
+        }
+        out->kind = Register::BOOL;
+        out->boolValue = result;
+    }
+
+    void ExpressionCompiled::andOr(const Register* operands, int count, bool isAnd,
+                                   Register* out) {
+        // Like the tree walk, stop at the first operand that decides the result.
+        for (int i = 0; i < count; i++) {
+            bool truth;
+            if (!truthOf(operands[i], &truth)) {
+                out->kind = Register::DEFERRED;
+                return;
+            }
+            if (truth != isAnd) {
+                out->kind = Register::BOOL;
+                out->boolValue = !isAnd;
+                return;
+            }
+        }
+        out->kind = Register::BOOL;
+        out->boolValue = isAnd;
+    }
+
+    bool ExpressionCompiled::truthOf(const Register& operand, bool* out) {
+        switch (operand.kind) {
+        case Register::INT: *out = operand.intValue != 0; return true;
+        case Register::LONG: *out = operand.longValue != 0; return true;
+        case Register::DOUBLE: *out = operand.doubleValue != 0; return true;
+        case Register::BOOL: *out = operand.boolValue; return true;
+        case Register::VALUE: *out = operand.value.coerceToBool(); return true;
+        case Register::DEFERRED: return false;
+        }
+        verify(false);
+    }
+
+    void ExpressionCompiled::toBool(const Register& operand, Register* out) {
+        bool result;
+        if (!truthOf(operand, &result)) {
+            out->kind = Register::DEFERRED;
+            return;
+        }
+        out->kind = Register::BOOL;
+        out->boolValue = result;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,148 @@
+// expression_compiled.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/pipeline/expression.h"
+
+namespace mongo {
+
+    /**
+     * An expression tree flattened into a program over typed registers.
+     *
+     * Evaluating an expression tree costs a virtual call and a returned Value for every node.  A
+     * compiled expression instead runs a flat list of instructions whose numeric and boolean
+     * intermediates stay in registers as plain ints, longs, doubles and bools.  Only the leaves
+     * (field paths, constants and any operator the compiler doesn't know) produce Values, and only
+     * the final result is turned back into one.  A field path used more than once is looked up
+     * only once per evaluation.
+     *
+     * The instructions handle the common cases of $add, $subtract, $multiply, $divide, the
+     * comparisons, $cond, $and and $or.  They never throw: when one meets anything else, such as
+     * a Date operand or a zero divisor, it marks its result as deferred, which propagates to the
+     * top, and the whole original tree is then evaluated as usual.  Results and errors are
+     * therefore always those of the tree walk.
+     */
+    class ExpressionCompiled : public Expression {
+    public:
+        /**
+         * Returns the compiled form of 'expression', or 'expression' itself if compiling it won't
+         * help, e.g. because it is a field path or a constant.  'expression' must already be
+         * optimized and may not be changed afterwards.
+         */
+        static intrusive_ptr<Expression> compile(const intrusive_ptr<Expression>& expression);
+
+        // virtuals from Expression
+        virtual void addDependencies(DepsTracker* deps, std::vector<std::string>* path=NULL) const;
+        virtual Value serialize(bool explain) const;
+        virtual Value evaluateInternal(Variables* vars) const;
+
+        const intrusive_ptr<Expression>& getOriginal() const { return _original; }
+
+        // The most registers a program may use; deeper trees aren't compiled.
+        static const int kMaxRegisters = 16;
+
+    private:
+        class Compiler;
+
+        enum OpCode {
+            LOAD_CONSTANT, // dst = constants[arg]
+            LOAD_FIELD,    // dst = leaves[arg], a field path
+            LOAD_CACHED_FIELD, // dst = src, loading field path leaves[arg] into src on first use
+            EVALUATE,      // dst = leaves[arg], deferred if it throws
+            ADD,           // dst = src[0] + ... + src[arg - 1]
+            MULTIPLY,      // dst = src[0] * ... * src[arg - 1]
+            SUBTRACT,      // dst = src[0] - src[1]
+            DIVIDE,        // dst = src[0] / src[1]
+            COMPARE,       // dst = src[0] <op> src[1], op is an ExpressionCompare::CmpOp in arg
+            AND,           // dst = src[0] && ... && src[arg - 1]
+            OR,            // dst = src[0] || ... || src[arg - 1]
+            TO_BOOL,       // dst = bool(src[0])
+            JUMP_UNLESS,   // for $cond: if src[0] is deferred, dst is too and jump to target2;
+                           // if it is false jump to arg; otherwise go on
+            JUMP,          // jump to arg
+        };
+
+        struct Instruction {
+            OpCode op;
+            int dst;
+            int src;
+            int arg;
+            int target2;
+        };
+
+        /** A register: a typed number or bool, any other Value, or a deferred result. */
+        struct Register {
+            // The numeric kinds come first, narrowest first.
+            enum Kind { INT, LONG, DOUBLE, BOOL, VALUE, DEFERRED };
+
+            Kind kind;
+            union {
+                int intValue;
+                long long longValue;
+                double doubleValue;
+                bool boolValue;
+            };
+            Value value; // only for VALUE
+
+            void set(const Value& val);
+            void copy(const Register& other); // like operator=, skips the Value when it can
+            Value get() const;
+        };
+
+        explicit ExpressionCompiled(const intrusive_ptr<Expression>& original);
+
+        template <int NumRegisters>
+        Value evaluateWith(Variables* vars) const;
+
+        void run(Register* regs, Variables* vars) const;
+
+        static void add(const Register* operands, int count, Register* out);
+        static void multiply(const Register* operands, int count, Register* out);
+        static void subtract(const Register& left, const Register& right, Register* out);
+        static void divide(const Register& left, const Register& right, Register* out);
+        static void compare(const Register& left, const Register& right,
+                            ExpressionCompare::CmpOp op, Register* out);
+        static void andOr(const Register* operands, int count, bool isAnd, Register* out);
+        static void toBool(const Register& operand, Register* out);
+
+        /** Sets '*out' to the truth of 'operand' and returns true, or returns false if deferred. */
+        static bool truthOf(const Register& operand, bool* out);
+
+        const intrusive_ptr<Expression> _original;
+        std::vector<Instruction> _program;
+        std::vector<Register> _constants;
+        std::vector<intrusive_ptr<Expression> > _leaves;
+        int _numRegisters;
+    };
+
+}  // namespace mongo
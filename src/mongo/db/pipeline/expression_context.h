@@ -32,6 +32,7 @@
 
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/operation_memory_tracker.h"
 #include "mongo/util/intrusive_counter.h"
 
 namespace mongo {
@@ -45,6 +46,7 @@ namespace mongo {
             , ns(ns)
             , opCtx(opCtx)
             , interruptCounter(interruptCheckPeriod)
+            , memoryTracker(opCtx ? opCtx->memoryTracker() : NULL)
         {}
 
         /** Used by a pipeline to check for interrupts so that killOp() works.
@@ -67,5 +69,9 @@ namespace mongo {
         OperationContext* opCtx;
         static const int interruptCheckPeriod = 128;
         int interruptCounter; // when 0, check interruptStatus
+
+        // What the pipeline's sources buffer counts towards this, and through it towards the
+        // tracker of the operation running the pipeline, which is changed along with opCtx.
+        OperationMemoryTracker memoryTracker;
     };
 }
@@ -215,6 +215,8 @@ namespace mongo {
         Optimizations::Local::coalesceAdjacent(pPipeline.get());
         Optimizations::Local::optimizeEachDocumentSource(pPipeline.get());
         Optimizations::Local::duplicateMatchBeforeInitalRedact(pPipeline.get());
+        Optimizations::Local::streamGroupOnSortedInput(pPipeline.get());
+        Optimizations::Local::limitFieldsUnwound(pPipeline.get());
 
         return pPipeline;
     }
@@ -319,6 +321,36 @@ namespace mongo {
         }
     }
 
+    void Pipeline::Optimizations::Local::streamGroupOnSortedInput(Pipeline* pipeline) {
+        SourceContainer& sources = pipeline->sources;
+        for (size_t srcn = sources.size(), srci = 1; srci < srcn; ++srci) {
+            DocumentSourceGroup* group = dynamic_cast<DocumentSourceGroup*>(sources[srci].get());
+            if (!group)
+                continue;
+
+            // A shard whose $sort ran in its query orders arrays by one of their elements, which
+            // can leave merged output out of order, so a group is never streamed on a merge.
+            DocumentSourceSort* sort = dynamic_cast<DocumentSourceSort*>(sources[srci - 1].get());
+            group->setStreaming(sort
+                                && !sort->isMergingPresorted()
+                                && group->canStreamSortedBy(
+                                       sort->serializeSortKey(false).toBson()));
+        }
+    }
+
+    void Pipeline::Optimizations::Local::limitFieldsUnwound(Pipeline* pipeline) {
+        SourceContainer& sources = pipeline->sources;
+        for (size_t srcn = sources.size(), srci = 0; srci < srcn; ++srci) {
+            DocumentSourceUnwind* unwind = dynamic_cast<DocumentSourceUnwind*>(sources[srci].get());
+            if (!unwind)
+                continue;
+
+            intrusive_ptr<Pipeline> laterStages(new Pipeline(pipeline->pCtx));
+            laterStages->sources.assign(sources.begin() + srci + 1, sources.end());
+            unwind->setOutputDependencies(laterStages->getDependencies(BSONObj()));
+        }
+    }
+
     void Pipeline::addRequiredPrivileges(Command* commandTemplate,
                                          const string& db,
                                          BSONObj cmdObj,
@@ -334,15 +366,23 @@ namespace mongo {
         BSONForEach(stageElem, pipeline) {
             BSONObj stage = stageElem.embeddedObjectUserCheck();
             if (str::equals(stage.firstElementFieldName(), "$out")) {
-                NamespaceString outputNs(db, stage.firstElement().str());
+                string outputColl;
+                DocumentSourceOut::Mode mode;
+                DocumentSourceOut::parseSpec(stage.firstElement(), &outputColl, &mode);
+                NamespaceString outputNs(db, outputColl);
                 uassert(17139,
                         mongoutils::str::stream() << "Invalid $out target namespace, " <<
                         outputNs.ns(),
                         outputNs.isValid());
 
                 ActionSet actions;
-                actions.addAction(ActionType::remove);
                 actions.addAction(ActionType::insert);
+                if (mode == DocumentSourceOut::REPLACE_DOCUMENTS) {
+                    actions.addAction(ActionType::update);
+                }
+                else {
+                    actions.addAction(ActionType::remove);
+                }
                 out->push_back(Privilege(ResourcePattern::forExactNamespace(outputNs), actions));
             }
         }
@@ -361,6 +401,9 @@ namespace mongo {
         Optimizations::Sharded::moveFinalUnwindFromShardsToMerger(shardPipeline.get(), this);
         Optimizations::Sharded::limitFieldsSentFromShardsToMerger(shardPipeline.get(), this);
 
+        // The $sort a $group was streaming from may now be merging the shards' output.
+        Optimizations::Local::streamGroupOnSortedInput(this);
+
         return shardPipeline;
     }
 
@@ -33,7 +33,10 @@
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/dbdirectclient.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/get_executor.h"
@@ -72,6 +75,44 @@ namespace {
         intrusive_ptr<ExpressionContext> _ctx;
         DBDirectClient _client;
     };
+
+    /**
+     * Returns true if some index of 'collection' holds every field of 'projection', an inclusion
+     * projection made by DepsTracker::toProjection(), so that the planner could answer a query
+     * with it without fetching any documents.
+     */
+    bool someIndexCouldCover(OperationContext* txn,
+                             const Collection* collection,
+                             const BSONObj& projection) {
+        if (!collection)
+            return false;
+
+        IndexCatalog::IndexIterator ii =
+            collection->getIndexCatalog()->getIndexIterator(txn, false);
+        while (ii.more()) {
+            const IndexDescriptor* desc = ii.next();
+
+            // Only btree keys hold the field values, and only if no document had an array there.
+            if (desc->getAccessMethodName() != IndexNames::BTREE || desc->isMultikey(txn))
+                continue;
+
+            bool covers = true;
+            BSONForEach(field, projection) {
+                if (!field.trueValue())
+                    continue;  // {_id: 0}
+
+                if (!desc->keyPattern().hasField(field.fieldNameStringData())) {
+                    covers = false;
+                    break;
+                }
+            }
+
+            if (covers)
+                return true;
+        }
+
+        return false;
+    }
 }
 
     shared_ptr<PlanExecutor> PipelineD::prepareCursorSource(
@@ -119,10 +160,20 @@ namespace {
         // Find the set of fields in the source documents depended on by this pipeline.
         const DepsTracker deps = pPipeline->getDependencies(queryObj);
 
-        // Passing query an empty projection since it is faster to use ParsedDeps::extractFields().
-        // This will need to change to support covering indexes (SERVER-12015). There is an
-        // exception for textScore since that can only be retrieved by a query projection.
-        const BSONObj projectionForQuery = deps.needTextScore ? deps.toProjection() : BSONObj();
+        // Passing query an empty projection since it is faster to use ParsedDeps::extractFields(),
+        // unless an index might let the planner cover the query, in which case its projection
+        // builds our input from the index keys and no documents are fetched (SERVER-12015).
+        // There is also an exception for textScore since that can only be retrieved by a query
+        // projection.
+        BSONObj projectionForQuery;
+        if (deps.needTextScore) {
+            projectionForQuery = deps.toProjection();
+        }
+        else if (!deps.needWholeDocument && !deps.fields.empty()) {
+            const BSONObj projection = deps.toProjection();
+            if (someIndexCouldCover(txn, collection, projection))
+                projectionForQuery = projection;
+        }
 
         /*
           Look for an initial sort; we'll try to add this to the
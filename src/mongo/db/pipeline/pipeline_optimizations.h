@@ -87,6 +87,27 @@ namespace mongo {
          * BSONObjs converted to Documents.
          */
         static void duplicateMatchBeforeInitalRedact(Pipeline* pipeline);
+
+        /**
+         * Tells a $group which directly follows a $sort on the fields of its _id to output each
+         * group as soon as its input has been read, rather than all of them at the end.
+         *
+         * This lets results flow before all the input is read, which a later $limit benefits
+         * from most, and only holds one group in memory at a time.
+         *
+         * Also turns this off again for a $group which no longer qualifies, so it can be rerun
+         * on a merger Pipeline once it has been split.
+         */
+        static void streamGroupOnSortedInput(Pipeline* pipeline);
+
+        /**
+         * Tells each $unwind which top-level fields the stages after it need, so that it can
+         * leave the others out of the documents it unwinds.
+         *
+         * Each unwound document is a copy of its input, sharing the input's values but with its
+         * own table of fields, so the fewer fields, the less each array element costs.
+         */
+        static void limitFieldsUnwound(Pipeline* pipeline);
     };
 
     /**
@@ -67,7 +67,6 @@ namespace mongo {
             break;
 
         case BinData: // TODO this should probably support short-string optimization
-        case Array: // TODO this should probably support empty-is-NULL optimization
         case DBRef:
         case CodeWScope:
             // the above types always reference external data.
@@ -76,7 +75,8 @@ namespace mongo {
             break;
 
         case Object:
-            // Objects either hold a NULL ptr or should be ref-counting
+        case Array:
+            // Objects and Arrays either hold a NULL ptr (when empty) or should be ref-counting
             verify(refCounter == bool(genericRCPtr));
             break;
         }
@@ -104,7 +104,9 @@ namespace mongo {
     }
 
     void ValueStorage::putVector(const RCVector* vec) {
-        fassert(16485, vec);
+        if (vec && vec->vec.empty())
+            return; // leave genericRCPtr NULL; the caller's RCVector will be freed
+
         putRefCountable(vec);
     }
 
@@ -120,6 +122,11 @@ namespace mongo {
         putString(StringData(buf.get(), totalLen));
     }
 
+    const vector<Value>& ValueStorage::emptyArray() {
+        static const vector<Value> empty;
+        return empty;
+    }
+
     Document ValueStorage::getDocument() const {
         if (!genericRCPtr)
             return Document();
@@ -158,6 +165,9 @@ namespace mongo {
         }
 
         case Array: {
+            if (elem.embeddedObject().isEmpty())
+                break; // empty arrays don't need an RCVector
+
             intrusive_ptr<RCVector> vec (new RCVector);
             BSONForEach(sub, elem.embeddedObject()) {
                 vec->vec.push_back(Value(sub));
@@ -218,6 +228,9 @@ namespace mongo {
     }
 
     Value::Value(const BSONArray& arr) : _storage(Array) {
+        if (arr.isEmpty())
+            return;
+
         intrusive_ptr<RCVector> vec (new RCVector);
         BSONForEach(sub, arr) {
             vec->vec.push_back(Value(sub));
@@ -676,6 +689,15 @@ namespace mongo {
         verify(false);
     }
 
+    size_t Value::Hash::operator()(const vector<Value>& array) const {
+        // Must match operator()(const Value&) and hash_combine() for an Array.
+        size_t seed = 0xf0afbeef;
+        boost::hash_combine(seed, canonicalizeBSONType(Array));
+        for (size_t i = 0; i < array.size(); i++)
+            array[i].hash_combine(seed);
+        return seed;
+    }
+
     void Value::hash_combine(size_t &seed) const {
         BSONType type = getType();
 
@@ -839,7 +861,8 @@ namespace mongo {
 
         case Array: {
             size_t size = sizeof(Value);
-            size += sizeof(RCVector);
+            if (_storage.genericRCPtr)
+                size += sizeof(RCVector);
             const size_t n = getArray().size();
             for(size_t i = 0; i < n; ++i) {
                 size += getArray()[i].getApproximateSize();
@@ -78,7 +78,8 @@ namespace mongo {
         explicit Value(const Document& doc)       : _storage(Object, doc) {}
         explicit Value(const BSONObj& obj);
         explicit Value(const BSONArray& arr);
-        explicit Value(const std::vector<Value>& vec)  : _storage(Array, new RCVector(vec)) {}
+        explicit Value(const std::vector<Value>& vec)
+            : _storage(Array, vec.empty() ? NULL : new RCVector(vec)) {}
         explicit Value(const BSONBinData& bd)     : _storage(BinData, bd) {}
         explicit Value(const BSONRegEx& re)       : _storage(RegEx, re) {}
         explicit Value(const BSONCodeWScope& cws) : _storage(CodeWScope, cws) {}
@@ -110,6 +111,9 @@ namespace mongo {
          *  In C++11 this would be spelled Value(std::move(consumed)).
          */
         static Value consume(std::vector<Value>& consumed) {
+            if (consumed.empty())
+                return Value(ValueStorage(Array));
+
             RCVector* vec = new RCVector();
             std::swap(vec->vec, consumed);
             return Value(ValueStorage(Array, vec));
@@ -245,6 +249,9 @@ namespace mongo {
         /// struct Hash is defined to enable the use of Values as keys in unordered_map.
         struct Hash : std::unary_function<const Value&, size_t> {
             size_t operator()(const Value& rV) const;
+
+            /// Hashes the elements of an array the same way as the Array Value holding them.
+            size_t operator()(const std::vector<Value>& array) const;
         };
 
         /// Call this after memcpying to update ref counts if needed
@@ -128,7 +128,7 @@ namespace mongo {
 
         /// These are only to be called during Value construction on an empty Value
         void putString(const StringData& s);
-        void putVector(const RCVector* v);
+        void putVector(const RCVector* v); // NULL means an empty array
         void putDocument(const Document& d);
         void putRegEx(const BSONRegEx& re);
         void putBinData(const BSONBinData& bd) {
@@ -168,6 +168,8 @@ namespace mongo {
         }
 
         const std::vector<Value>& getArray() const {
+            if (!genericRCPtr)
+                return emptyArray();
             dassert(typeid(*genericRCPtr) == typeid(const RCVector));
             const RCVector* arrayPtr = static_cast<const RCVector*>(genericRCPtr);
             return arrayPtr->vec;
@@ -186,6 +188,9 @@ namespace mongo {
         // Document is incomplete here so this can't be inline
         Document getDocument() const;
 
+        // Empty arrays are stored as a NULL genericRCPtr, like empty Documents.
+        static const std::vector<Value>& emptyArray();
+
         BSONType bsonType() const {
             return BSONType(type);
         }
@@ -0,0 +1,429 @@
+// plan_cache_persister.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/plan_cache_persister.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <list>
+#include <map>
+#include <set>
+
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/bson/bson_validate.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_catalog_entry.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/catalog/index_catalog_entry.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/fsync.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/repl/repl_coordinator_global.h"
+#include "mongo/util/background.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+namespace {
+
+    const char* kPlanCacheNamespace = "admin.system.plancache";
+
+    /**
+     * Appends 'obj' to 'bob' as BinData.  Filters and key patterns may have field names which
+     * can't be stored in a document, such as "$gt" or "a.b".
+     */
+    void appendAsBinData(BSONObjBuilder* bob, const StringData& fieldName, const BSONObj& obj) {
+        bob->appendBinData(fieldName, obj.objsize(), BinDataGeneral, obj.objdata());
+    }
+
+    bool readFromBinData(const BSONElement& elt, BSONObj* out) {
+        if (BinData != elt.type()) {
+            return false;
+        }
+        int len;
+        const char* data = elt.binData(len);
+        if (!validateBSON(data, len).isOK()) {
+            return false;
+        }
+        *out = BSONObj(data).getOwned();
+        return true;
+    }
+
+    /**
+     * Saves each collection's plan cache entries to admin.system.plancache, whose writes are
+     * replicated, and warms the collections' plan caches from it when shapes and winning
+     * indexes are most needed: at startup and right after this node becomes primary.
+     *
+     * Entries are stored by shape and by the index assignments of their planner data, not as
+     * query solutions, and are resolved against the catalog again when restored.  Entries
+     * whose indexes have been dropped since are skipped.  Saved entries expire, through a TTL
+     * index, internalQueryCachePersistExpireSecs after they were last saved.
+     */
+    class PlanCachePersister : public BackgroundJob {
+    public:
+        PlanCachePersister() : _indexEnsured(false) { }
+        virtual ~PlanCachePersister() { }
+
+        virtual std::string name() const { return "PlanCachePersister"; }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            bool warmed = false;
+            bool wasPrimary = false;
+            unsigned long long lastSaved = 0;
+
+            while (!inShutdown()) {
+                sleepsecs(1);
+
+                const int intervalSecs = internalQueryCachePersistIntervalSecs;
+                if (intervalSecs <= 0) {
+                    continue;
+                }
+
+                repl::ReplicationCoordinator* replCoord = repl::getGlobalReplicationCoordinator();
+                if (replCoord->getReplicationMode() ==
+                        repl::ReplicationCoordinator::modeReplSet &&
+                        !replCoord->getCurrentMemberState().readable()) {
+                    wasPrimary = false;
+                    continue;
+                }
+
+                const bool isPrimary = replCoord->canAcceptWritesForDatabase("admin");
+
+                try {
+                    if (!warmed || (isPrimary && !wasPrimary)) {
+                        warmed = true;
+                        warm();
+                    }
+                    wasPrimary = isPrimary;
+
+                    if (!isPrimary || lockedForWriting()) {
+                        continue;
+                    }
+
+                    const unsigned long long now = curTimeMillis64();
+                    if (now - lastSaved < static_cast<unsigned long long>(intervalSecs) * 1000) {
+                        continue;
+                    }
+                    lastSaved = now;
+                    save();
+                }
+                catch (const DBException& ex) {
+                    warning() << "plan cache persister: " << ex.toString();
+                }
+            }
+        }
+
+    private:
+        struct Saved {
+            BSONObj doc;
+            unsigned long long when;
+        };
+        typedef std::map<std::string, Saved> SavedMap;
+
+        /**
+         * Restores every entry in admin.system.plancache whose collection exists.
+         */
+        void warm() {
+            OperationContextImpl txn;
+            DBDirectClient client(&txn);
+
+            std::auto_ptr<DBClientCursor> cursor =
+                client.query(kPlanCacheNamespace, Query(), 0, 0, NULL, QueryOption_SlaveOk);
+            if (!cursor.get()) {
+                return;
+            }
+
+            size_t numRestored = 0;
+            while (cursor->more()) {
+                const BSONObj doc = cursor->nextSafe().getOwned();
+                if (restore(&txn, doc)) {
+                    numRestored++;
+                }
+            }
+
+            if (numRestored > 0) {
+                log() << "restored " << numRestored << " plan cache entries from "
+                      << kPlanCacheNamespace;
+            }
+        }
+
+        bool restore(OperationContext* txn, const BSONObj& doc) {
+            const std::string ns = doc["ns"].str();
+            BSONObj entry;
+            if (ns.empty() || !readFromBinData(doc["entry"], &entry)) {
+                LOG(1) << "skipping malformed plan cache document " << doc["_id"];
+                return false;
+            }
+
+            const NamespaceString nss(ns);
+            if (!nss.isValid()) {
+                return false;
+            }
+
+            AutoGetDb autoDb(txn, nss.db(), MODE_IS);
+            Database* db = autoDb.getDb();
+            if (!db) {
+                return false;
+            }
+
+            Lock::CollectionLock collLock(txn->lockState(), ns, MODE_IS);
+            Collection* collection = db->getCollection(txn, ns);
+            if (!collection) {
+                return false;
+            }
+
+            BSONObj query;
+            BSONObj sort;
+            BSONObj projection;
+            if (!readFromBinData(entry["query"], &query) ||
+                    !readFromBinData(entry["sort"], &sort) ||
+                    !readFromBinData(entry["projection"], &projection) ||
+                    Array != entry["solutions"].type()) {
+                LOG(1) << "skipping malformed plan cache document " << doc["_id"];
+                return false;
+            }
+
+            CanonicalQuery* cqRaw;
+            const WhereCallbackReal whereCallback(txn, nss.db());
+            Status status = CanonicalQuery::canonicalize(ns, query, sort, projection,
+                                                         &cqRaw, whereCallback);
+            if (!status.isOK()) {
+                LOG(1) << "skipping saved plan cache entry for " << ns << ": " << status;
+                return false;
+            }
+            boost::scoped_ptr<CanonicalQuery> cq(cqRaw);
+
+            if (!PlanCache::shouldCacheQuery(*cq)) {
+                return false;
+            }
+
+            std::vector<IndexEntry> indices;
+            IndexCatalog::IndexIterator ii =
+                collection->getIndexCatalog()->getIndexIterator(txn, false);
+            while (ii.more()) {
+                const IndexDescriptor* desc = ii.next();
+                indices.push_back(IndexEntry(desc->keyPattern(),
+                                             desc->getAccessMethodName(),
+                                             desc->isMultikey(txn),
+                                             desc->isSparse(),
+                                             desc->indexName(),
+                                             desc->infoObj()));
+                indices.back().multikeyPaths = desc->getMultikeyPaths(txn);
+                indices.back().filterExpr =
+                    collection->getIndexCatalog()->getEntry(desc)->getFilterExpression();
+            }
+
+            OwnedPointerVector<SolutionCacheData> solutions;
+            BSONObjIterator it(entry["solutions"].Obj());
+            while (it.more()) {
+                BSONObj solutionObj;
+                if (!readFromBinData(it.next(), &solutionObj)) {
+                    return false;
+                }
+                SolutionCacheData* scd;
+                status = SolutionCacheData::parse(solutionObj, indices, &scd);
+                if (!status.isOK()) {
+                    LOG(1) << "skipping saved plan cache entry for " << ns << ": " << status;
+                    return false;
+                }
+                solutions.mutableVector().push_back(scd);
+            }
+
+            boost::optional<size_t> backupSoln;
+            if (entry["backupSoln"].isNumber()) {
+                backupSoln.reset(static_cast<size_t>(entry["backupSoln"].numberInt()));
+            }
+
+            PlanCache* planCache = collection->infoCache()->getPlanCache();
+            status = planCache->restore(*cq, solutions.vector(), backupSoln);
+            if (!status.isOK()) {
+                LOG(1) << "skipping saved plan cache entry for " << ns << ": " << status;
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * Upserts a document for every cache entry which is new or has changed since we last
+         * saved it, or which was saved long enough ago to be close to expiring.
+         */
+        void save() {
+            std::vector<BSONObj> docs;
+
+            std::set<std::string> dbNames;
+            dbHolder().getAllShortNames(dbNames);
+            for (std::set<std::string>::const_iterator i = dbNames.begin();
+                    i != dbNames.end(); ++i) {
+                OperationContextImpl txn;
+                collectEntries(&txn, *i, &docs);
+            }
+
+            OperationContextImpl txn;
+            if (!_indexEnsured) {
+                DBDirectClient client(&txn);
+                client.ensureIndex(kPlanCacheNamespace, BSON("updated" << 1), false, "", false,
+                                   false, -1, internalQueryCachePersistExpireSecs);
+                _indexEnsured = true;
+            }
+
+            const unsigned long long now = curTimeMillis64();
+            const unsigned long long refreshMillis =
+                static_cast<unsigned long long>(internalQueryCachePersistExpireSecs) * 1000 / 2;
+
+            SavedMap saved;
+            size_t numSaved = 0;
+            for (std::vector<BSONObj>::const_iterator it = docs.begin(); it != docs.end(); ++it) {
+                const std::string id = (*it)["_id"].toString(false);
+
+                SavedMap::const_iterator prev = _saved.find(id);
+                if (prev != _saved.end() &&
+                        prev->second.doc.binaryEqual(*it) &&
+                        now - prev->second.when < refreshMillis) {
+                    saved.insert(*prev);
+                    continue;
+                }
+
+                BSONObjBuilder bob;
+                bob.appendElements(*it);
+                bob.appendDate("updated", Date_t(now));
+
+                Client::WriteContext ctx(&txn, kPlanCacheNamespace);
+                if (!repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(
+                            "admin")) {
+                    // Stepped down since we started; only the primary saves entries.
+                    break;
+                }
+                Helpers::upsert(&txn, kPlanCacheNamespace, bob.obj());
+
+                Saved& s = saved[id];
+                s.doc = *it;
+                s.when = now;
+                numSaved++;
+            }
+
+            _saved.swap(saved);
+            LOG(1) << "saved " << numSaved << " plan cache entries to " << kPlanCacheNamespace;
+        }
+
+        /**
+         * Appends a document, without its 'updated' field, for each plan cache entry of each
+         * collection in 'dbName'.  Entries which depend on index filters aren't saved, since
+         * the filters themselves are not.
+         */
+        void collectEntries(OperationContext* txn,
+                            const std::string& dbName,
+                            std::vector<BSONObj>* docs) {
+            AutoGetDb autoDb(txn, dbName, MODE_IS);
+            Database* db = autoDb.getDb();
+            if (!db) {
+                return;
+            }
+
+            std::list<std::string> namespaces;
+            db->getDatabaseCatalogEntry()->getCollectionNamespaces(&namespaces);
+
+            for (std::list<std::string>::const_iterator it = namespaces.begin();
+                    it != namespaces.end(); ++it) {
+                const std::string& ns = *it;
+                Lock::CollectionLock collLock(txn->lockState(), ns, MODE_IS);
+                Collection* collection = db->getCollection(txn, ns);
+                if (!collection) {
+                    continue;
+                }
+
+                typedef std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> > EntryVector;
+                EntryVector entries =
+                    collection->infoCache()->getPlanCache()->getAllEntriesWithKeys();
+
+                for (EntryVector::const_iterator ei = entries.begin();
+                        ei != entries.end(); ++ei) {
+                    boost::scoped_ptr<PlanCacheEntry> entry(ei->second);
+
+                    bool indexFilterApplied = false;
+                    BSONObjBuilder entryBob;
+                    appendAsBinData(&entryBob, "query", entry->query);
+                    appendAsBinData(&entryBob, "sort", entry->sort);
+                    appendAsBinData(&entryBob, "projection", entry->projection);
+                    BSONArrayBuilder solutionsBob(entryBob.subarrayStart("solutions"));
+                    for (size_t i = 0; i < entry->plannerData.size(); ++i) {
+                        const SolutionCacheData* scd = entry->plannerData[i];
+                        indexFilterApplied = indexFilterApplied || scd->indexFilterApplied;
+                        const BSONObj solutionObj = scd->toBSON();
+                        solutionsBob.appendBinData(solutionObj.objsize(), BinDataGeneral,
+                                                   solutionObj.objdata());
+                    }
+                    solutionsBob.doneFast();
+                    if (entry->backupSoln) {
+                        entryBob.append("backupSoln", static_cast<int>(*entry->backupSoln));
+                    }
+
+                    if (indexFilterApplied) {
+                        continue;
+                    }
+
+                    BSONObjBuilder docBob;
+                    docBob.append("_id", BSON("ns" << ns << "key" << ei->first));
+                    docBob.append("ns", ns);
+                    appendAsBinData(&docBob, "entry", entryBob.obj());
+                    docs->push_back(docBob.obj());
+                }
+            }
+        }
+
+        bool _indexEnsured;
+
+        // What we last saved for each _id, so that unchanged entries aren't rewritten (and
+        // replicated) on every pass.
+        SavedMap _saved;
+    };
+
+} // namespace
+
+    void startPlanCachePersisterBackgroundJob() {
+        PlanCachePersister* persister = new PlanCachePersister();
+        persister->go();
+    }
+
+} // namespace mongo
@@ -36,6 +36,7 @@
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/dbhelpers.h"
+#include "mongo/db/global_environment_experiment.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/repl/bgsync.h"
@@ -43,8 +44,8 @@
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/db/storage/storage_engine.h"
 #include "mongo/util/log.h"
-#include "mongo/util/mmap.h"
 
 namespace mongo {
 namespace repl {
@@ -117,10 +118,9 @@ namespace {
         }
     }
 
-    // page in the data pages for a record associated with an object
+    // bring the record associated with an object into the storage engine's memory
     void prefetchRecordPages(OperationContext* txn,
-                             Database* db,
-                             const char* ns,
+                             Collection* collection,
                              const BSONObj& obj) {
 
         BSONElement _id;
@@ -128,18 +128,10 @@ namespace {
             TimerHolder timer(&prefetchDocStats);
             BSONObjBuilder builder;
             builder.append(_id);
-            BSONObj result;
             try {
-                if (Helpers::findById(txn, db, ns, builder.done(), result)) {
-                    // do we want to use Record::touch() here?  it's pretty similar.
-                    volatile char _dummy_char = '\0';
-
-                    // Touch the first word on every page in order to fault it into memory
-                    for (int i = 0; i < result.objsize(); i += g_minOSPageSizeBytes) {
-                        _dummy_char += *(result.objdata() + i);
-                    }
-                    // hit the last page, in case we missed it above
-                    _dummy_char += *(result.objdata() + result.objsize() - 1);
+                const DiskLoc loc = Helpers::findById(txn, collection, builder.done());
+                if (!loc.isNull()) {
+                    collection->touchDocument(txn, loc);
                 }
             }
             catch(const DBException& e) {
@@ -173,10 +165,12 @@ namespace {
         BSONObj obj = op.getObjectField(opField);
         const char *ns = op.getStringField("ns");
 
-        // This will have to change for engines other than MMAP V1, because they might not have
-        // means for directly prefetching pages from the collection. For this purpose, acquire S
-        // lock on the database, instead of optimizing with IS.
-        Lock::CollectionLock collLock(txn->lockState(), ns, MODE_S);
+        // The storage engine does the prefetching through SortedDataInterface::touchKey and
+        // RecordStore::touchRecord. Engines with document-level locking read from a snapshot,
+        // so IS is enough for them; others need S to keep the records where they are.
+        const bool supportsDocLocking =
+            getGlobalEnvironment()->getGlobalStorageEngine()->supportsDocLocking();
+        Lock::CollectionLock collLock(txn->lockState(), ns, supportsDocLocking ? MODE_IS : MODE_S);
 
         Collection* collection = db->getCollection( txn, ns );
         if (!collection) {
@@ -212,7 +206,7 @@ namespace {
             // do not prefetch the data for capped collections because
             // they typically do not have an _id index for findById() to use.
             !collection->isCapped()) {
-            prefetchRecordPages(txn, db, ns, obj);
+            prefetchRecordPages(txn, collection, obj);
         }
     }
 
@@ -0,0 +1,230 @@
+// clock_key_value.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/unordered_map.hpp>
+#include <memory>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    /**
+     * A key-value store with the same interface as LRUKeyValue, but which approximates least
+     * recently used replacement with the CLOCK algorithm.
+     *
+     * Each entry has a reference bit, which get() sets and which the eviction "hand" clears as
+     * it sweeps over the entries; the first entry the hand finds unreferenced is evicted.  As
+     * get() does not reorder anything, it may be called concurrently by any number of threads
+     * provided none of them modifies the store at the same time, i.e. under a shared lock.
+     * All other operations need exclusive access.
+     *
+     * The V* pointers are owned by the kv-store.
+     */
+    template<class K, class V>
+    class ClockKeyValue {
+        MONGO_DISALLOW_COPYING(ClockKeyValue);
+    public:
+        struct Slot {
+            Slot(const K& k, V* v) : key(k), value(v) { }
+
+            K key;
+            V* value;
+
+            // Set by get(), cleared by the eviction hand.
+            mutable AtomicUInt32 referenced;
+        };
+
+        typedef typename std::vector<Slot*>::const_iterator SlotConstIt;
+
+        ClockKeyValue(size_t maxSize) : _maxSize(maxSize), _hand(0) { }
+
+        ~ClockKeyValue() {
+            clear();
+        }
+
+        /**
+         * Add an (K, V*) pair to the store, where 'key' can be used to retrieve value 'entry'
+         * from the store.  If 'key' is already present, its value is replaced (and deleted).
+         *
+         * Takes ownership of 'entry'.
+         *
+         * Returns the entry which was evicted to make room, if the store was full, or NULL.
+         */
+        std::auto_ptr<V> add(const K& key, V* entry) {
+            typename SlotMap::const_iterator i = _slotMap.find(key);
+            if (i != _slotMap.end()) {
+                Slot* slot = _slots[i->second];
+                delete slot->value;
+                slot->value = entry;
+                slot->referenced.store(1);
+                return std::auto_ptr<V>();
+            }
+
+            if (_maxSize == 0) {
+                return std::auto_ptr<V>(entry);
+            }
+
+            if (_slots.size() < _maxSize) {
+                _slotMap[key] = _slots.size();
+                _slots.push_back(new Slot(key, entry));
+                return std::auto_ptr<V>();
+            }
+
+            // Sweep until the hand finds an entry which hasn't been used since it last passed.
+            // This terminates within two turns, since the first turn clears every bit.
+            while (_slots[_hand]->referenced.swap(0)) {
+                advanceHand();
+            }
+
+            Slot* victim = _slots[_hand];
+            std::auto_ptr<V> evicted(victim->value);
+            _slotMap.erase(victim->key);
+
+            victim->key = key;
+            victim->value = entry;
+            _slotMap[key] = _hand;
+
+            // A new entry gets a full turn of the hand before it can be evicted.
+            advanceHand();
+            return evicted;
+        }
+
+        /**
+         * Retrieve the value associated with 'key' from the kv-store.  The value is returned
+         * through the out-parameter 'entryOut'; the kv-store retains ownership of it.
+         *
+         * As a side effect, marks the entry as recently used.  Safe to call concurrently with
+         * other calls to get(), see above.
+         */
+        Status get(const K& key, V** entryOut) const {
+            typename SlotMap::const_iterator i = _slotMap.find(key);
+            if (i == _slotMap.end()) {
+                return Status(ErrorCodes::NoSuchKey, "no such key in clock key-value store");
+            }
+
+            const Slot* slot = _slots[i->second];
+
+            // Avoid dirtying the cache line of a popular entry on every lookup.
+            if (0 == slot->referenced.loadRelaxed()) {
+                slot->referenced.store(1);
+            }
+
+            *entryOut = slot->value;
+            return Status::OK();
+        }
+
+        /**
+         * Remove the kv-store entry keyed by 'key'.
+         */
+        Status remove(const K& key) {
+            typename SlotMap::iterator i = _slotMap.find(key);
+            if (i == _slotMap.end()) {
+                return Status(ErrorCodes::NoSuchKey, "no such key in clock key-value store");
+            }
+
+            // Fill the hole with the last slot.
+            const size_t pos = i->second;
+            _slotMap.erase(i);
+            Slot* removed = _slots[pos];
+            if (pos != _slots.size() - 1) {
+                _slots[pos] = _slots.back();
+                _slotMap[_slots[pos]->key] = pos;
+            }
+            _slots.pop_back();
+            if (_hand >= _slots.size()) {
+                _hand = 0;
+            }
+
+            delete removed->value;
+            delete removed;
+            return Status::OK();
+        }
+
+        /**
+         * Deletes all entries in the kv-store.
+         */
+        void clear() {
+            for (SlotConstIt i = _slots.begin(); i != _slots.end(); ++i) {
+                delete (*i)->value;
+                delete *i;
+            }
+            _slots.clear();
+            _slotMap.clear();
+            _hand = 0;
+        }
+
+        /**
+         * Returns true if entry is found in the kv-store.
+         */
+        bool hasKey(const K& key) const {
+            return _slotMap.find(key) != _slotMap.end();
+        }
+
+        /**
+         * Returns the number of entries currently in the kv-store.
+         */
+        size_t size() const { return _slots.size(); }
+
+        /**
+         * Iteration over the entries, in no particular order.
+         */
+        SlotConstIt begin() const { return _slots.begin(); }
+
+        SlotConstIt end() const { return _slots.end(); }
+
+    private:
+        typedef boost::unordered_map<K, size_t> SlotMap;
+
+        void advanceHand() {
+            if (++_hand == _slots.size()) {
+                _hand = 0;
+            }
+        }
+
+        // The maximum allowable number of entries in the kv-store.
+        const size_t _maxSize;
+
+        // Owned here.
+        std::vector<Slot*> _slots;
+
+        // Maps from a key to the position of its slot in '_slots'.
+        SlotMap _slotMap;
+
+        // Position in '_slots' of the next eviction candidate.
+        size_t _hand;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,193 @@
+// clock_key_value_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/db/query/clock_key_value.h"
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/assert_util.h"
+
+using namespace mongo;
+
+namespace {
+
+    //
+    // Convenience functions
+    //
+
+    void assertInKVStore(ClockKeyValue<int, int>& cache, int key, int value) {
+        int* cachedValue = NULL;
+        ASSERT_TRUE(cache.hasKey(key));
+        Status s = cache.get(key, &cachedValue);
+        ASSERT_OK(s);
+        ASSERT_EQUALS(*cachedValue, value);
+    }
+
+    void assertNotInKVStore(ClockKeyValue<int, int>& cache, int key) {
+        int* cachedValue = NULL;
+        ASSERT_FALSE(cache.hasKey(key));
+        Status s = cache.get(key, &cachedValue);
+        ASSERT_NOT_OK(s);
+    }
+
+    TEST(ClockKeyValueTest, BasicAddGet) {
+        ClockKeyValue<int, int> cache(100);
+        cache.add(1, new int(2));
+        assertInKVStore(cache, 1, 2);
+    }
+
+    TEST(ClockKeyValueTest, SizeZeroCache) {
+        ClockKeyValue<int, int> cache(0);
+        std::auto_ptr<int> evicted = cache.add(1, new int(2));
+        ASSERT(NULL != evicted.get());
+        assertNotInKVStore(cache, 1);
+    }
+
+    TEST(ClockKeyValueTest, SizeOneCache) {
+        ClockKeyValue<int, int> cache(1);
+        cache.add(0, new int(0));
+        assertInKVStore(cache, 0, 0);
+
+        // Second entry should evict the first, even though it was used.
+        std::auto_ptr<int> evicted = cache.add(1, new int(1));
+        ASSERT(NULL != evicted.get());
+        ASSERT_EQUALS(*evicted, 0);
+        assertNotInKVStore(cache, 0);
+        assertInKVStore(cache, 1, 1);
+    }
+
+    /**
+     * Fill up a size 10 kv-store with 10 entries. Call get() on every entry except for one.
+     * Then call add() and make sure that the unused entry got evicted.
+     */
+    TEST(ClockKeyValueTest, EvictionTest) {
+        int maxSize = 10;
+        ClockKeyValue<int, int> cache(maxSize);
+        for (int i = 0; i < maxSize; ++i) {
+            std::auto_ptr<int> evicted = cache.add(i, new int(i));
+            ASSERT(NULL == evicted.get());
+        }
+        ASSERT_EQUALS(cache.size(), (size_t)maxSize);
+
+        int evictKey = 5;
+        for (int i = 0; i < maxSize; ++i) {
+            if (i == evictKey) { continue; }
+            assertInKVStore(cache, i, i);
+        }
+
+        std::auto_ptr<int> evicted = cache.add(maxSize + 1, new int(maxSize + 1));
+        ASSERT_EQUALS(cache.size(), (size_t)maxSize);
+        ASSERT(NULL != evicted.get());
+        ASSERT_EQUALS(*evicted, evictKey);
+
+        for (int i = 0; i < maxSize; ++i) {
+            if (i == evictKey) {
+                assertNotInKVStore(cache, evictKey);
+            }
+            else {
+                assertInKVStore(cache, i, i);
+            }
+        }
+        assertInKVStore(cache, maxSize + 1, maxSize + 1);
+    }
+
+    /**
+     * An entry which keeps being used survives any number of evictions.
+     */
+    TEST(ClockKeyValueTest, PromotionTest) {
+        int maxSize = 10;
+        ClockKeyValue<int, int> cache(maxSize);
+        for (int i = 0; i < maxSize; ++i) {
+            cache.add(i, new int(i));
+        }
+
+        int promoteKey = 5;
+        for (int i = maxSize; i < 5 * maxSize; ++i) {
+            assertInKVStore(cache, promoteKey, promoteKey);
+            std::auto_ptr<int> evicted = cache.add(i, new int(i));
+            ASSERT(NULL != evicted.get());
+            ASSERT_NOT_EQUALS(*evicted, promoteKey);
+        }
+        ASSERT_EQUALS(cache.size(), (size_t)maxSize);
+        assertInKVStore(cache, promoteKey, promoteKey);
+    }
+
+    TEST(ClockKeyValueTest, ReplaceKeyTest) {
+        ClockKeyValue<int, int> cache(10);
+        cache.add(4, new int(4));
+        assertInKVStore(cache, 4, 4);
+        cache.add(4, new int(5));
+        assertInKVStore(cache, 4, 5);
+        ASSERT_EQUALS(cache.size(), 1U);
+    }
+
+    TEST(ClockKeyValueTest, RemoveTest) {
+        ClockKeyValue<int, int> cache(3);
+        cache.add(1, new int(1));
+        cache.add(2, new int(2));
+        cache.add(3, new int(3));
+
+        ASSERT_OK(cache.remove(1));
+        ASSERT_NOT_OK(cache.remove(1));
+        ASSERT_EQUALS(cache.size(), 2U);
+        assertNotInKVStore(cache, 1);
+        assertInKVStore(cache, 2, 2);
+        assertInKVStore(cache, 3, 3);
+
+        // The freed slot is reused without an eviction.
+        std::auto_ptr<int> evicted = cache.add(4, new int(4));
+        ASSERT(NULL == evicted.get());
+        ASSERT_EQUALS(cache.size(), 3U);
+        assertInKVStore(cache, 2, 2);
+        assertInKVStore(cache, 3, 3);
+        assertInKVStore(cache, 4, 4);
+
+        cache.clear();
+        ASSERT_EQUALS(cache.size(), 0U);
+        assertNotInKVStore(cache, 2);
+    }
+
+    TEST(ClockKeyValueTest, IterationTest) {
+        ClockKeyValue<int, int> cache(2);
+        cache.add(1, new int(1));
+        cache.add(2, new int(2));
+
+        int sum = 0;
+        size_t count = 0;
+        typedef ClockKeyValue<int, int>::SlotConstIt CacheIterator;
+        for (CacheIterator i = cache.begin(); i != cache.end(); ++i) {
+            ASSERT_EQUALS((*i)->key, *(*i)->value);
+            sum += (*i)->key;
+            count++;
+        }
+        ASSERT_EQUALS(count, 2U);
+        ASSERT_EQUALS(sum, 3);
+    }
+
+}  // namespace
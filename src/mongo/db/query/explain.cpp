@@ -31,6 +31,7 @@
 #include "mongo/db/query/explain.h"
 
 #include "mongo/base/owned_pointer_vector.h"
+#include "mongo/db/catalog/collection.h"
 #include "mongo/db/exec/multi_plan.h"
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/plan_executor.h"
@@ -39,6 +40,7 @@
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/server_options.h"
 #include "mongo/db/server_parameters.h"
+#include "mongo/util/cycle_clock.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/version.h"
 
@@ -106,6 +108,10 @@ namespace {
             const IDHackStats* spec = static_cast<const IDHackStats*>(specific);
             return spec->keysExamined;
         }
+        else if (STAGE_BATCHED_IDHACK == type) {
+            const BatchedIdHackStats* spec = static_cast<const BatchedIdHackStats*>(specific);
+            return spec->keysExamined;
+        }
         else if (STAGE_TEXT == type) {
             const TextStats* spec = static_cast<const TextStats*>(specific);
             return spec->keysExamined;
@@ -136,6 +142,10 @@ namespace {
             const IDHackStats* spec = static_cast<const IDHackStats*>(specific);
             return spec->docsExamined;
         }
+        else if (STAGE_BATCHED_IDHACK == type) {
+            const BatchedIdHackStats* spec = static_cast<const BatchedIdHackStats*>(specific);
+            return spec->docsExamined;
+        }
         else if (STAGE_TEXT == type) {
             const TextStats* spec = static_cast<const TextStats*>(specific);
             return spec->fetches;
@@ -144,7 +154,7 @@ namespace {
             const FetchStats* spec = static_cast<const FetchStats*>(specific);
             return spec->docsExamined;
         }
-        else if (STAGE_COLLSCAN == type) {
+        else if (STAGE_COLLSCAN == type || STAGE_PARALLEL_COLLSCAN == type) {
             const CollectionScanStats* spec = static_cast<const CollectionScanStats*>(specific);
             return spec->docsTested;
         }
@@ -221,6 +231,11 @@ namespace mongo {
         if (verbosity >= ExplainCommon::EXEC_STATS) {
             bob->appendNumber("nReturned", stats.common.advanced);
             bob->appendNumber("executionTimeMillisEstimate", stats.common.executionTimeMillis);
+            if (0 != stats.common.executionTimeTicks) {
+                bob->appendNumber("executionTimeNanos",
+                                  CycleClock::toNanos(stats.common.executionTimeTicks));
+                bob->appendNumber("cpuTimeNanos", stats.common.cpuTimeNanos);
+            }
             bob->appendNumber("works", stats.common.works);
             bob->appendNumber("advanced", stats.common.advanced);
             bob->appendNumber("needTime", stats.common.needTime);
@@ -229,6 +244,12 @@ namespace mongo {
             bob->appendNumber("restoreState", stats.common.unyields);
             bob->appendNumber("isEOF", stats.common.isEOF);
             bob->appendNumber("invalidates", stats.common.invalidates);
+            if (0 != stats.common.docBytesExamined) {
+                bob->appendNumber("docBytesExamined", stats.common.docBytesExamined);
+            }
+            if (0 != stats.common.keyBytesExamined) {
+                bob->appendNumber("keyBytesExamined", stats.common.keyBytesExamined);
+            }
         }
 
         // Stage-specific stats
@@ -238,6 +259,8 @@ namespace mongo {
             if (verbosity >= ExplainCommon::EXEC_STATS) {
                 bob->appendNumber("memUsage", spec->memUsage);
                 bob->appendNumber("memLimit", spec->memLimit);
+                bob->appendNumber("spillFiles", spec->spillFiles);
+                bob->appendNumber("spillBytes", static_cast<long long>(spec->spillBytes));
 
                 bob->appendNumber("flaggedButPassed", spec->flaggedButPassed);
                 bob->appendNumber("flaggedInProgress", spec->flaggedInProgress);
@@ -259,11 +282,13 @@ namespace mongo {
                 }
             }
         }
-        else if (STAGE_COLLSCAN == stats.stageType) {
+        else if (STAGE_COLLSCAN == stats.stageType
+                 || STAGE_PARALLEL_COLLSCAN == stats.stageType) {
             CollectionScanStats* spec = static_cast<CollectionScanStats*>(stats.specific.get());
             bob->append("direction", spec->direction > 0 ? "forward" : "backward");
             if (verbosity >= ExplainCommon::EXEC_STATS) {
                 bob->appendNumber("docsExamined", spec->docsTested);
+                bob->appendNumber("readAheads", spec->readAheads);
             }
         }
         else if (STAGE_COUNT == stats.stageType) {
@@ -272,6 +297,9 @@ namespace mongo {
             if (verbosity >= ExplainCommon::EXEC_STATS) {
                 bob->appendNumber("nCounted", spec->nCounted);
                 bob->appendNumber("nSkipped", spec->nSkipped);
+                if (spec->approximate) {
+                    bob->appendBool("approximate", true);
+                }
             }
         }
         else if (STAGE_COUNT_SCAN == stats.stageType) {
@@ -279,6 +307,9 @@ namespace mongo {
 
             if (verbosity >= ExplainCommon::EXEC_STATS) {
                 bob->appendNumber("keysExamined", spec->keysExamined);
+                if (spec->rangeCounted) {
+                    bob->appendBool("rangeCounted", true);
+                }
             }
 
             bob->append("keyPattern", spec->keyPattern);
@@ -296,6 +327,10 @@ namespace mongo {
             if (verbosity >= ExplainCommon::EXEC_STATS) {
                 bob->appendNumber("docsExamined", spec->docsExamined);
                 bob->appendNumber("alreadyHasObj", spec->alreadyHasObj);
+                if (0 != spec->batchesPrefetched) {
+                    bob->appendNumber("batchesPrefetched", spec->batchesPrefetched);
+                    bob->appendNumber("docsPrefetched", spec->docsPrefetched);
+                }
             }
         }
         else if (STAGE_GEO_NEAR_2D == stats.stageType
@@ -320,11 +355,22 @@ namespace mongo {
                 bob->appendNumber("nGroups", spec->nGroups);
             }
         }
+        else if (STAGE_BATCHED_IDHACK == stats.stageType) {
+            BatchedIdHackStats* spec = static_cast<BatchedIdHackStats*>(stats.specific.get());
+            if (verbosity >= ExplainCommon::EXEC_STATS) {
+                bob->appendNumber("keysExamined", spec->keysExamined);
+                bob->appendNumber("docsExamined", spec->docsExamined);
+                bob->appendNumber("batchesPrefetched", spec->batchesPrefetched);
+            }
+        }
         else if (STAGE_IDHACK == stats.stageType) {
             IDHackStats* spec = static_cast<IDHackStats*>(stats.specific.get());
             if (verbosity >= ExplainCommon::EXEC_STATS) {
                 bob->appendNumber("keysExamined", spec->keysExamined);
                 bob->appendNumber("docsExamined", spec->docsExamined);
+                if (spec->locFromCache) {
+                    bob->appendBool("locFromCache", true);
+                }
             }
         }
         else if (STAGE_IXSCAN == stats.stageType) {
@@ -347,6 +393,7 @@ namespace mongo {
                 bob->appendNumber("dupsDropped", spec->dupsDropped);
                 bob->appendNumber("seenInvalidated", spec->seenInvalidated);
                 bob->appendNumber("matchTested", spec->matchTested);
+                bob->appendNumber("locsFiltered", spec->locsFiltered);
             }
         }
         else if (STAGE_OR == stats.stageType) {
@@ -356,6 +403,7 @@ namespace mongo {
                 bob->appendNumber("dupsTested", spec->dupsTested);
                 bob->appendNumber("dupsDropped", spec->dupsDropped);
                 bob->appendNumber("locsForgotten", spec->locsForgotten);
+                bob->appendNumber("memUsage", spec->memUsage);
                 for (size_t i = 0; i < spec->matchTested.size(); ++i) {
                     bob->appendNumber(string(stream() << "matchTested_" << i),
                                       spec->matchTested[i]);
@@ -366,6 +414,15 @@ namespace mongo {
             LimitStats* spec = static_cast<LimitStats*>(stats.specific.get());
             bob->appendNumber("limitAmount", spec->limit);
         }
+        else if (STAGE_PARALLEL_IXSCAN == stats.stageType) {
+            ParallelIndexScanStats* spec =
+                static_cast<ParallelIndexScanStats*>(stats.specific.get());
+
+            if (verbosity >= ExplainCommon::EXEC_STATS) {
+                bob->appendNumber("dupsTested", spec->dupsTested);
+                bob->appendNumber("dupsDropped", spec->dupsDropped);
+            }
+        }
         else if (STAGE_PROJECTION == stats.stageType) {
             ProjectionStats* spec = static_cast<ProjectionStats*>(stats.specific.get());
             bob->append("transformBy", spec->projObj);
@@ -388,6 +445,8 @@ namespace mongo {
             if (verbosity >= ExplainCommon::EXEC_STATS) {
                 bob->appendNumber("memUsage", spec->memUsage);
                 bob->appendNumber("memLimit", spec->memLimit);
+                bob->appendNumber("spillFiles", spec->spillFiles);
+                bob->appendNumber("spillBytes", static_cast<long long>(spec->spillBytes));
             }
 
             if (spec->limit > 0) {
@@ -413,6 +472,9 @@ namespace mongo {
 
             bob->append("indexPrefix", spec->indexPrefix);
             bob->append("parsedTextQuery", spec->parsedTextQuery);
+            if (0 != spec->topK) {
+                bob->appendNumber("topK", spec->topK);
+            }
         }
         else if (STAGE_UPDATE == stats.stageType) {
             UpdateStats* spec = static_cast<UpdateStats*>(stats.specific.get());
@@ -503,6 +565,22 @@ namespace mongo {
         plannerBob.doneFast();
     }
 
+    // static
+    void Explain::generateQueryShapeStats(CanonicalQuery* query,
+                                          const Collection* collection,
+                                          BSONObjBuilder* out) {
+        if (NULL == query || NULL == collection) {
+            return;
+        }
+
+        QueryShapeStatsEntry entry;
+        if (!collection->infoCache()->getQueryShapeStats()->get(query->getPlanCacheKey(),
+                                                                &entry)) {
+            return;
+        }
+        out->append("queryShapeStats", entry.toBSON());
+    }
+
     // static
     void Explain::generateExecStats(PlanStageStats* stats,
                                     ExplainCommon::Verbosity verbosity,
@@ -599,6 +677,7 @@ namespace mongo {
         CanonicalQuery* query = exec->getCanonicalQuery();
         if (verbosity >= ExplainCommon::QUERY_PLANNER) {
             generatePlannerInfo(query, winningStats.get(), allPlansStats.vector(), out);
+            generateQueryShapeStats(query, exec->collection(), out);
         }
 
         if (verbosity >= ExplainCommon::EXEC_STATS) {
@@ -170,6 +170,16 @@ namespace mongo {
                                         const vector<PlanStageStats*>& rejectedStats,
                                         BSONObjBuilder* out);
 
+        /**
+         * Adds the 'queryShapeStats' explain section, what the earlier executions of queries of
+         * the same shape on 'collection' have cost, if there were any.
+         *
+         * This is a helper for generating explain BSON. It is used by explainStages(...).
+         */
+        static void generateQueryShapeStats(CanonicalQuery* query,
+                                            const Collection* collection,
+                                            BSONObjBuilder* out);
+
         /**
          * Generates the execution stats section for the stats tree 'stats',
          * adding the resulting BSON to 'out'.
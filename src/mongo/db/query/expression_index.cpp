@@ -34,9 +34,24 @@
 #include "mongo/db/geo/hash.h"
 #include "mongo/db/geo/r2_region_coverer.h"
 #include "mongo/db/hasher.h"
+#include "mongo/db/query/expression_index_knobs.h"
+#include "mongo/db/query/lru_key_value.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
+    namespace {
+
+        // The most recently used 2dsphere coverings, keyed by query geometry and index level.
+        typedef LRUKeyValue<std::string, OrderedIntervalList> CoveringCache;
+
+        SimpleMutex coveringCacheMutex("geoCoveringCache");
+        // Guarded by coveringCacheMutex, as is its size.
+        CoveringCache* coveringCache = NULL;
+        int coveringCacheSize = 0;
+
+    }  // namespace
+
     BSONObj ExpressionMapping::hash(const BSONElement& value) {
         BSONObjBuilder bob;
         bob.append("", BSONElementHasher::hash64(value, BSONElementHasher::DEFAULT_HASH_SEED));
@@ -205,4 +220,56 @@ namespace mongo {
         }
     }
 
+    void ExpressionMapping::cover2dsphereCached(const BSONObj& geometry,
+                                                const S2Region& region,
+                                                const BSONObj& indexInfoObj,
+                                                OrderedIntervalList* oilOut) {
+
+        const int cacheSize = internalGeoQuery2DSphereCoveringCacheSize;
+        if (cacheSize <= 0) {
+            cover2dsphere(region, indexInfoObj, oilOut);
+            return;
+        }
+
+        // The covering only depends on the region and the index's coarsest level.
+        BSONObjBuilder keyBob;
+        keyBob.append("g", geometry);
+        BSONElement coarsestLevel = indexInfoObj["coarsestIndexedLevel"];
+        if (!coarsestLevel.eoo()) {
+            keyBob.appendAs(coarsestLevel, "l");
+        }
+        BSONObj keyObj = keyBob.obj();
+        const std::string key(keyObj.objdata(), keyObj.objsize());
+
+        {
+            SimpleMutex::scoped_lock lk(coveringCacheMutex);
+            if (coveringCacheSize != cacheSize) {
+                delete coveringCache;
+                coveringCache = new CoveringCache(cacheSize);
+                coveringCacheSize = cacheSize;
+            }
+
+            OrderedIntervalList* cached;
+            if (coveringCache->get(key, &cached).isOK()) {
+                oilOut->intervals.insert(oilOut->intervals.end(),
+                                         cached->intervals.begin(),
+                                         cached->intervals.end());
+                return;
+            }
+        }
+
+        // Computed without the lock, so concurrent queries may both compute a new covering.
+        std::auto_ptr<OrderedIntervalList> computed(new OrderedIntervalList(oilOut->name));
+        cover2dsphere(region, indexInfoObj, computed.get());
+        oilOut->intervals.insert(oilOut->intervals.end(),
+                                 computed->intervals.begin(),
+                                 computed->intervals.end());
+
+        SimpleMutex::scoped_lock lk(coveringCacheMutex);
+        if (coveringCacheSize == cacheSize) {
+            // The evicted covering, if any, is freed right away.
+            coveringCache->add(key, computed.release());
+        }
+    }
+
 }  // namespace mongo
@@ -55,6 +55,16 @@ namespace mongo {
         static void cover2dsphere(const S2Region& region,
                                   const BSONObj& indexInfoObj,
                                   OrderedIntervalList* oilOut);
+
+        /**
+         * Like cover2dsphere(), for the 'region' of the query object 'geometry'.  Reuses the
+         * intervals of an earlier query on the same geometry if the covering cache is enabled;
+         * see internalGeoQuery2DSphereCoveringCacheSize.
+         */
+        static void cover2dsphereCached(const BSONObj& geometry,
+                                        const S2Region& region,
+                                        const BSONObj& indexInfoObj,
+                                        OrderedIntervalList* oilOut);
     };
 
 }  // namespace mongo
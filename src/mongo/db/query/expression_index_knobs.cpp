@@ -36,4 +36,8 @@ namespace mongo {
 
     MONGO_EXPORT_SERVER_PARAMETER(internalGeoNearQuery2DMaxCoveringCells, int, 16);
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalGeoNearQueryDensityGrowth, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalGeoQuery2DSphereCoveringCacheSize, int, 0);
+
 }  // namespace mongo
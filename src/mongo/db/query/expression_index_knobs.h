@@ -44,4 +44,16 @@ namespace mongo {
      */
     extern int internalGeoNearQuery2DMaxCoveringCells;
 
+    /**
+     * Whether geoNear sizes each search annulus from the density of results found in the last
+     * one, rather than doubling or halving the last width
+     */
+    extern bool internalGeoNearQueryDensityGrowth;
+
+    /**
+     * The number of 2dsphere query coverings to keep for reuse by later queries on the same
+     * geometry; 0 disables the cache
+     */
+    extern int internalGeoQuery2DSphereCoveringCacheSize;
+
 }  // namespace mongo
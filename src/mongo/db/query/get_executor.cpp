@@ -36,12 +36,15 @@
 
 #include "mongo/base/parse_number.h"
 #include "mongo/client/dbclientinterface.h"
+#include "mongo/db/catalog/index_catalog_entry.h"
+#include "mongo/db/exec/batched_idhack.h"
 #include "mongo/db/exec/cached_plan.h"
 #include "mongo/db/exec/count.h"
 #include "mongo/db/exec/delete.h"
 #include "mongo/db/exec/eof.h"
 #include "mongo/db/exec/group.h"
 #include "mongo/db/exec/idhack.h"
+#include "mongo/db/exec/limit.h"
 #include "mongo/db/exec/multi_plan.h"
 #include "mongo/db/exec/projection.h"
 #include "mongo/db/exec/shard_filter.h"
@@ -53,6 +56,7 @@
 #include "mongo/db/query/index_bounds_builder.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/plan_cost.h"
 #include "mongo/db/query/plan_executor.h"
 #include "mongo/db/query/planner_analysis.h"
 #include "mongo/db/query/planner_access.h"
@@ -118,6 +122,9 @@ namespace mongo {
                                                         desc->isSparse(),
                                                         desc->indexName(),
                                                         desc->infoObj()));
+            plannerParams->indices.back().multikeyPaths = desc->getMultikeyPaths(txn);
+            plannerParams->indices.back().filterExpr =
+                collection->getIndexCatalog()->getEntry(desc)->getFilterExpression();
         }
 
         // If query supports index filters, filter params.indices by indices in query settings.
@@ -207,13 +214,20 @@ namespace mongo {
             plannerParams.options = plannerOptions;
             fillOutPlannerParams(opCtx, collection, canonicalQuery, &plannerParams);
 
-            // If we have an _id index we can use an idhack plan.
-            if (IDHackStage::supportsQuery(*canonicalQuery) &&
+            // If we have an _id index we can use an idhack plan, or a batched idhack plan for a
+            // query on a list of _id values.
+            const bool idHack = IDHackStage::supportsQuery(*canonicalQuery);
+            if ((idHack || BatchedIdHackStage::supportsQuery(*canonicalQuery)) &&
                 collection->getIndexCatalog()->findIdIndex(opCtx)) {
 
-                LOG(2) << "Using idhack: " << canonicalQuery->toStringShort();
-
-                *rootOut = new IDHackStage(opCtx, collection, canonicalQuery, ws);
+                if (idHack) {
+                    LOG(2) << "Using idhack: " << canonicalQuery->toStringShort();
+                    *rootOut = new IDHackStage(opCtx, collection, canonicalQuery, ws);
+                }
+                else {
+                    LOG(2) << "Using batched idhack: " << canonicalQuery->toStringShort();
+                    *rootOut = new BatchedIdHackStage(opCtx, collection, canonicalQuery, ws);
+                }
 
                 // Might have to filter out orphaned docs.
                 if (plannerParams.options & QueryPlannerParams::INCLUDE_SHARD_FILTER) {
@@ -222,6 +236,13 @@ namespace mongo {
                                              ws, *rootOut);
                 }
 
+                // The batched idhack may return many documents, so a hard limit is applied here
+                // as the planner would.
+                const LiteParsedQuery& parsed = canonicalQuery->getParsed();
+                if (!idHack && 0 != parsed.getNumToReturn() && !parsed.wantMore()) {
+                    *rootOut = new LimitStage(parsed.getNumToReturn(), ws, *rootOut);
+                }
+
                 // There might be a projection. The idhack stage will always fetch the full
                 // document, so we don't support covered projections. However, we might use the
                 // simple inclusion fast path.
@@ -348,6 +369,21 @@ namespace mongo {
                 }
             }
 
+            // Discard candidates which index statistics show to be far more expensive than the
+            // cheapest, rather than racing them.  Plans which can stop early at a limit are
+            // not credited for it, so limited queries are left to the trial run.
+            if (solutions.size() > 1 && internalQueryPlannerCostBasedPruning
+                && 0 == canonicalQuery->getParsed().getNumToReturn()) {
+                PlanCostModel costModel(collection->infoCache()->getIndexStats(),
+                                        collection->numRecords(opCtx));
+                size_t pruned = costModel.prune(&solutions);
+                if (pruned > 0) {
+                    LOG(2) << "Discarded " << pruned << " of " << solutions.size() + pruned
+                           << " candidate plans by estimated cost: "
+                           << canonicalQuery->toStringShort();
+                }
+            }
+
             if (1 == solutions.size()) {
                 // Only one possible plan.  Run it.  Build the stages from the solution.
                 verify(StageBuilder::build(opCtx, collection, *solutions[0], ws, rootOut));
@@ -1022,6 +1058,9 @@ namespace mongo {
                                                            desc->isSparse(),
                                                            desc->indexName(),
                                                            desc->infoObj()));
+                plannerParams.indices.back().multikeyPaths = desc->getMultikeyPaths(txn);
+                plannerParams.indices.back().filterExpr =
+                    collection->getIndexCatalog()->getEntry(desc)->getFilterExpression();
             }
         }
 
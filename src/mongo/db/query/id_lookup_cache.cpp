@@ -0,0 +1,123 @@
+// id_lookup_cache.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/query/id_lookup_cache.h"
+
+namespace mongo {
+
+    // A cache of large _id values would cost more memory than it saves in lookups.
+    const int IdLookupCache::kMaxIdSize = 1024;
+
+    IdLookupCache::IdLookupCache() : _mutex("IdLookupCache") { }
+
+    // static
+    std::string IdLookupCache::makeKey(const BSONObj& idKey) {
+        BSONElement id = idKey.firstElement();
+        std::string key(1, static_cast<char>(id.type()));
+        key.append(id.value(), id.valuesize());
+        return key;
+    }
+
+    bool IdLookupCache::find(const BSONObj& idKey, DiskLoc* locOut) {
+        const std::string key = makeKey(idKey);
+
+        SimpleMutex::scoped_lock lk(_mutex);
+        unordered_map<std::string, EntryList::iterator>::const_iterator it = _byId.find(key);
+        if (_byId.end() == it) {
+            return false;
+        }
+
+        _entries.splice(_entries.begin(), _entries, it->second);
+        *locOut = it->second->loc;
+        return true;
+    }
+
+    void IdLookupCache::add(const BSONObj& idKey, const DiskLoc& loc, size_t maxEntries) {
+        if (0 == maxEntries || idKey.firstElement().valuesize() > kMaxIdSize) {
+            return;
+        }
+
+        Entry entry;
+        entry.id = makeKey(idKey);
+        entry.loc = loc;
+
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        // _id values which compare equal may still differ in type, so the document at 'loc'
+        // may be cached under another _id.
+        unordered_map<std::string, EntryList::iterator>::iterator byId = _byId.find(entry.id);
+        if (_byId.end() != byId) {
+            _erase_inlock(byId->second);
+        }
+        unordered_map<DiskLoc, EntryList::iterator, DiskLoc::Hasher>::iterator byLoc =
+            _byLoc.find(loc);
+        if (_byLoc.end() != byLoc) {
+            _erase_inlock(byLoc->second);
+        }
+
+        _entries.push_front(entry);
+        _byId[entry.id] = _entries.begin();
+        _byLoc[loc] = _entries.begin();
+
+        while (_byId.size() > maxEntries) {
+            _erase_inlock(--_entries.end());
+        }
+    }
+
+    void IdLookupCache::invalidate(const DiskLoc& loc) {
+        SimpleMutex::scoped_lock lk(_mutex);
+        unordered_map<DiskLoc, EntryList::iterator, DiskLoc::Hasher>::iterator it =
+            _byLoc.find(loc);
+        if (_byLoc.end() != it) {
+            _erase_inlock(it->second);
+        }
+    }
+
+    void IdLookupCache::clear() {
+        SimpleMutex::scoped_lock lk(_mutex);
+        _byId.clear();
+        _byLoc.clear();
+        _entries.clear();
+    }
+
+    size_t IdLookupCache::size() const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _byId.size();
+    }
+
+    void IdLookupCache::_erase_inlock(EntryList::iterator it) {
+        _byId.erase(it->id);
+        _byLoc.erase(it->loc);
+        _entries.erase(it);
+    }
+
+}  // namespace mongo
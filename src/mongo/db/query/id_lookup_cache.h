@@ -0,0 +1,108 @@
+// id_lookup_cache.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <list>
+#include <string>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * Remembers where recently looked up documents of one collection are, by _id, so that the
+     * IDHACK stage can skip the _id index for hot documents.
+     *
+     * At most one entry refers to any DiskLoc, so invalidate() forgets everything known about a
+     * document; the collection calls it before a document is deleted or moved.  Storage engines
+     * with document-level locking don't order lookups after those writes, so with them a hit is
+     * only a hint which the caller must check against the record store.
+     *
+     * Thread safe.
+     */
+    class IdLookupCache {
+        MONGO_DISALLOW_COPYING(IdLookupCache);
+    public:
+        IdLookupCache();
+
+        /**
+         * If the DiskLoc of the document whose _id equals the first element of 'idKey' is
+         * cached, stores it in 'locOut' and returns true.  The names of the fields are ignored.
+         */
+        bool find(const BSONObj& idKey, DiskLoc* locOut);
+
+        /**
+         * Remembers that the document whose _id is the first element of 'idKey' is at 'loc',
+         * replacing any entry for either, and evicts the least recently used entries beyond
+         * 'maxEntries'.  _id values larger than kMaxIdSize bytes aren't cached.
+         */
+        void add(const BSONObj& idKey, const DiskLoc& loc, size_t maxEntries);
+
+        /**
+         * Forgets the entry referring to 'loc', if there is one.
+         */
+        void invalidate(const DiskLoc& loc);
+
+        void clear();
+
+        size_t size() const;
+
+        static const int kMaxIdSize;
+
+    private:
+        struct Entry {
+            std::string id;
+            DiskLoc loc;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        /**
+         * The cache's key for the first element of 'idKey': its type and value.
+         */
+        static std::string makeKey(const BSONObj& idKey);
+
+        void _erase_inlock(EntryList::iterator it);
+
+        mutable SimpleMutex _mutex;
+
+        // Most recently used first.
+        EntryList _entries;
+
+        unordered_map<std::string, EntryList::iterator> _byId;
+        unordered_map<DiskLoc, EntryList::iterator, DiskLoc::Hasher> _byLoc;
+    };
+
+}  // namespace mongo
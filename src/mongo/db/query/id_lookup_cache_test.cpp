@@ -0,0 +1,131 @@
+// id_lookup_cache_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/db/query/id_lookup_cache.h"
+
+#include <string>
+
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    TEST(IdLookupCacheTest, FindAfterAdd) {
+        IdLookupCache cache;
+        DiskLoc loc;
+        ASSERT_FALSE(cache.find(BSON("_id" << 1), &loc));
+
+        cache.add(BSON("_id" << 1), DiskLoc(0, 16), 10);
+        ASSERT(cache.find(BSON("_id" << 1), &loc));
+        ASSERT_EQUALS(DiskLoc(0, 16), loc);
+
+        // Field names are ignored, but the type of the _id is not.
+        ASSERT(cache.find(BSON("" << 1), &loc));
+        ASSERT_FALSE(cache.find(BSON("_id" << 1.0), &loc));
+        ASSERT_FALSE(cache.find(BSON("_id" << "1"), &loc));
+    }
+
+    TEST(IdLookupCacheTest, Invalidate) {
+        IdLookupCache cache;
+        cache.add(BSON("_id" << 1), DiskLoc(0, 16), 10);
+        cache.add(BSON("_id" << 2), DiskLoc(0, 32), 10);
+
+        cache.invalidate(DiskLoc(0, 16));
+        DiskLoc loc;
+        ASSERT_FALSE(cache.find(BSON("_id" << 1), &loc));
+        ASSERT(cache.find(BSON("_id" << 2), &loc));
+        ASSERT_EQUALS(1U, cache.size());
+
+        // Invalidating a DiskLoc which isn't cached does nothing.
+        cache.invalidate(DiskLoc(0, 48));
+        ASSERT_EQUALS(1U, cache.size());
+
+        cache.clear();
+        ASSERT_EQUALS(0U, cache.size());
+        ASSERT_FALSE(cache.find(BSON("_id" << 2), &loc));
+    }
+
+    TEST(IdLookupCacheTest, OneEntryPerDiskLoc) {
+        IdLookupCache cache;
+
+        // Equal _id values of different types may both be looked up for one document.  Only the
+        // latest is kept, so that invalidating the document forgets it.
+        cache.add(BSON("_id" << 1), DiskLoc(0, 16), 10);
+        cache.add(BSON("_id" << 1.0), DiskLoc(0, 16), 10);
+        ASSERT_EQUALS(1U, cache.size());
+
+        DiskLoc loc;
+        ASSERT_FALSE(cache.find(BSON("_id" << 1), &loc));
+        cache.invalidate(DiskLoc(0, 16));
+        ASSERT_FALSE(cache.find(BSON("_id" << 1.0), &loc));
+
+        // A document which moved replaces its old entry.
+        cache.add(BSON("_id" << 1), DiskLoc(0, 16), 10);
+        cache.add(BSON("_id" << 1), DiskLoc(0, 32), 10);
+        ASSERT_EQUALS(1U, cache.size());
+        ASSERT(cache.find(BSON("_id" << 1), &loc));
+        ASSERT_EQUALS(DiskLoc(0, 32), loc);
+        cache.invalidate(DiskLoc(0, 16));
+        ASSERT(cache.find(BSON("_id" << 1), &loc));
+    }
+
+    TEST(IdLookupCacheTest, EvictsLeastRecentlyUsed) {
+        IdLookupCache cache;
+        cache.add(BSON("_id" << 1), DiskLoc(0, 16), 2);
+        cache.add(BSON("_id" << 2), DiskLoc(0, 32), 2);
+
+        // Using the first entry makes the second the least recently used.
+        DiskLoc loc;
+        ASSERT(cache.find(BSON("_id" << 1), &loc));
+        cache.add(BSON("_id" << 3), DiskLoc(0, 48), 2);
+
+        ASSERT_EQUALS(2U, cache.size());
+        ASSERT(cache.find(BSON("_id" << 1), &loc));
+        ASSERT_FALSE(cache.find(BSON("_id" << 2), &loc));
+        ASSERT(cache.find(BSON("_id" << 3), &loc));
+
+        // The eviction forgot the DiskLoc too.
+        cache.add(BSON("_id" << 4), DiskLoc(0, 32), 2);
+        ASSERT(cache.find(BSON("_id" << 4), &loc));
+        ASSERT_EQUALS(2U, cache.size());
+    }
+
+    TEST(IdLookupCacheTest, DisabledOrLargeIdsAreNotCached) {
+        IdLookupCache cache;
+        cache.add(BSON("_id" << 1), DiskLoc(0, 16), 0);
+        ASSERT_EQUALS(0U, cache.size());
+
+        const std::string bigId(IdLookupCache::kMaxIdSize + 1, 'x');
+        cache.add(BSON("_id" << bigId), DiskLoc(0, 16), 10);
+        ASSERT_EQUALS(0U, cache.size());
+    }
+
+}  // namespace
@@ -573,7 +573,10 @@ namespace mongo {
             if (mongoutils::str::equals("2dsphere", elt.valuestrsafe())) {
                 verify(gme->getGeoExpression().getGeometry().hasS2Region());
                 const S2Region& region = gme->getGeoExpression().getGeometry().getS2Region();
-                ExpressionMapping::cover2dsphere(region, index.infoObj, oilOut);
+                ExpressionMapping::cover2dsphereCached(gme->getRawObj(),
+                                                       region,
+                                                       index.infoObj,
+                                                       oilOut);
                 *tightnessOut = IndexBoundsBuilder::INEXACT_FETCH;
             }
             else if (mongoutils::str::equals("2d", elt.valuestrsafe())) {
@@ -1032,4 +1035,85 @@ namespace mongo {
         }
     }
 
+    // static
+    bool IndexBoundsBuilder::splitRange(const IndexBounds& bounds,
+                                        size_t numRanges,
+                                        std::vector<IndexBounds>* out) {
+        if (numRanges < 2 || bounds.isSimpleRange || bounds.fields.empty()) {
+            return false;
+        }
+
+        const OrderedIntervalList& oil = bounds.fields[0];
+        if (1 != oil.intervals.size() || oil.intervals[0].isPoint()) {
+            return false;
+        }
+
+        const Interval& ival = oil.intervals[0];
+        bool isDate;
+        double start, end;
+        if (ival.start.isNumber() && ival.end.isNumber()) {
+            isDate = false;
+            start = ival.start.numberDouble();
+            end = ival.end.numberDouble();
+        }
+        else if (Date == ival.start.type() && Date == ival.end.type()) {
+            isDate = true;
+            start = static_cast<double>(ival.start.date().asInt64());
+            end = static_cast<double>(ival.end.date().asInt64());
+        }
+        else {
+            return false;
+        }
+
+        // Infinite and NaN endpoints can't be divided up; for those 'width - width' is NaN.
+        const double width = end - start;
+        if (!(width > 0 || width < 0) || width - width != 0) {
+            return false;
+        }
+
+        // The interval runs from 'start' to 'end' in scan order, which may be descending.  Each
+        // split point ends one range (exclusively) and starts the next (inclusively); we only
+        // keep points strictly between their neighbours, so no range is empty.
+        std::vector<BSONObj> points;
+        const double step = width / numRanges;
+        double prev = start;
+        for (size_t i = 1; i < numRanges; ++i) {
+            double point = start + step * i;
+            BSONObjBuilder bob;
+            if (isDate) {
+                long long millis = static_cast<long long>(point);
+                point = static_cast<double>(millis);
+                bob.appendDate("", Date_t(static_cast<unsigned long long>(millis)));
+            }
+            else {
+                bob.append("", point);
+            }
+
+            if ((point - prev) * step <= 0 || (end - point) * step <= 0) {
+                continue;
+            }
+            points.push_back(bob.obj());
+            prev = point;
+        }
+
+        if (points.empty()) {
+            return false;
+        }
+
+        for (size_t i = 0; i <= points.size(); ++i) {
+            BSONObjBuilder bob;
+            bob.append(0 == i ? ival.start : points[i - 1].firstElement());
+            bob.append(points.size() == i ? ival.end : points[i].firstElement());
+
+            IndexBounds range = bounds;
+            range.fields[0].intervals[0] = Interval(bob.obj(),
+                                                    0 == i ? ival.startInclusive : true,
+                                                    points.size() == i ? ival.endInclusive
+                                                                       : false);
+            out->push_back(range);
+        }
+
+        return true;
+    }
+
 }  // namespace mongo
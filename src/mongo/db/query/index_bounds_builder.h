@@ -191,6 +191,16 @@ namespace mongo {
                                      bool* startKeyInclusive,
                                      BSONObj* endKey,
                                      bool* endKeyInclusive);
+
+        /**
+         * Splits 'bounds' into at most 'numRanges' consecutive bounds, in scan order, which
+         * together contain exactly the same keys, by dividing up the interval of the first field.
+         * Only possible when that field has a single, finite range between two numbers or two
+         * dates.  Returns 'false', leaving 'out' untouched, if the bounds can't be split.
+         */
+        static bool splitRange(const IndexBounds& bounds,
+                               size_t numRanges,
+                               std::vector<IndexBounds>* out);
     };
 
 }  // namespace mongo
@@ -1169,4 +1169,110 @@ namespace {
         ASSERT(tightness == IndexBoundsBuilder::INEXACT_FETCH);
     }
 
+    //
+    // Splitting bounds into consecutive ranges.
+    //
+
+    TEST(IndexBoundsBuilderTest, SplitRangeNumbers) {
+        IndexBounds bounds;
+        OrderedIntervalList a("a");
+        a.intervals.push_back(Interval(BSON("" << 0 << "" << 100), true, false));
+        bounds.fields.push_back(a);
+        OrderedIntervalList b("b");
+        b.intervals.push_back(IndexBoundsBuilder::allValues());
+        bounds.fields.push_back(b);
+
+        vector<IndexBounds> ranges;
+        ASSERT(IndexBoundsBuilder::splitRange(bounds, 4, &ranges));
+        ASSERT_EQUALS(4U, ranges.size());
+
+        const double points[] = { 0, 25, 50, 75, 100 };
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            ASSERT_EQUALS(2U, ranges[i].fields.size());
+            ASSERT_EQUALS(1U, ranges[i].fields[0].intervals.size());
+            Interval expected(BSON("" << points[i] << "" << points[i + 1]), true, false);
+            ASSERT_EQUALS(Interval::INTERVAL_EQUALS,
+                          ranges[i].fields[0].intervals[0].compare(expected));
+            ASSERT_EQUALS(Interval::INTERVAL_EQUALS,
+                          ranges[i].fields[1].intervals[0].compare(b.intervals[0]));
+        }
+    }
+
+    TEST(IndexBoundsBuilderTest, SplitRangeDescending) {
+        IndexBounds bounds;
+        OrderedIntervalList a("a");
+        a.intervals.push_back(Interval(BSON("" << 10 << "" << 0), true, true));
+        bounds.fields.push_back(a);
+
+        vector<IndexBounds> ranges;
+        ASSERT(IndexBoundsBuilder::splitRange(bounds, 2, &ranges));
+        ASSERT_EQUALS(2U, ranges.size());
+
+        const Interval& first = ranges[0].fields[0].intervals[0];
+        ASSERT_EQUALS(10, first.start.numberDouble());
+        ASSERT_EQUALS(5, first.end.numberDouble());
+        ASSERT(first.startInclusive);
+        ASSERT(!first.endInclusive);
+
+        const Interval& second = ranges[1].fields[0].intervals[0];
+        ASSERT_EQUALS(5, second.start.numberDouble());
+        ASSERT_EQUALS(0, second.end.numberDouble());
+        ASSERT(second.startInclusive);
+        ASSERT(second.endInclusive);
+    }
+
+    TEST(IndexBoundsBuilderTest, SplitRangeDates) {
+        IndexBounds bounds;
+        OrderedIntervalList a("a");
+        BSONObjBuilder bob;
+        bob.appendDate("", Date_t(1000));
+        bob.appendDate("", Date_t(4000));
+        a.intervals.push_back(Interval(bob.obj(), false, true));
+        bounds.fields.push_back(a);
+
+        vector<IndexBounds> ranges;
+        ASSERT(IndexBoundsBuilder::splitRange(bounds, 3, &ranges));
+        ASSERT_EQUALS(3U, ranges.size());
+        ASSERT(!ranges[0].fields[0].intervals[0].startInclusive);
+        ASSERT(ranges[2].fields[0].intervals[0].endInclusive);
+        ASSERT_EQUALS(Date, ranges[1].fields[0].intervals[0].start.type());
+        ASSERT_EQUALS(2000LL, ranges[1].fields[0].intervals[0].start.date().asInt64());
+        ASSERT_EQUALS(3000LL, ranges[1].fields[0].intervals[0].end.date().asInt64());
+    }
+
+    TEST(IndexBoundsBuilderTest, SplitRangeNotPossible) {
+        vector<IndexBounds> ranges;
+
+        // A point.
+        IndexBounds point;
+        OrderedIntervalList a("a");
+        a.intervals.push_back(IndexBoundsBuilder::makePointInterval(5));
+        point.fields.push_back(a);
+        ASSERT(!IndexBoundsBuilder::splitRange(point, 4, &ranges));
+
+        // An unbounded range.
+        IndexBounds unbounded;
+        OrderedIntervalList b("a");
+        b.intervals.push_back(Interval(BSON("" << 5 << "" << positiveInfinity), false, true));
+        unbounded.fields.push_back(b);
+        ASSERT(!IndexBoundsBuilder::splitRange(unbounded, 4, &ranges));
+
+        // Strings.
+        IndexBounds strings;
+        OrderedIntervalList c("a");
+        c.intervals.push_back(Interval(BSON("" << "a" << "" << "z"), true, true));
+        strings.fields.push_back(c);
+        ASSERT(!IndexBoundsBuilder::splitRange(strings, 4, &ranges));
+
+        // More than one interval.
+        IndexBounds two;
+        OrderedIntervalList d("a");
+        d.intervals.push_back(Interval(BSON("" << 0 << "" << 10), true, true));
+        d.intervals.push_back(Interval(BSON("" << 20 << "" << 30), true, true));
+        two.fields.push_back(d);
+        ASSERT(!IndexBoundsBuilder::splitRange(two, 4, &ranges));
+
+        ASSERT(ranges.empty());
+    }
+
 }  // namespace
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <set>
 #include <string>
 
 #include "mongo/db/index_names.h"
@@ -36,6 +37,8 @@
 
 namespace mongo {
 
+    class MatchExpression;
+
     /**
      * This name sucks, but every name involving 'index' is used somewhere.
      */
@@ -53,7 +56,8 @@ namespace mongo {
               multikey(mk),
               sparse(sp),
               name(n),
-              infoObj(io) {
+              infoObj(io),
+              filterExpr(NULL) {
 
             type = IndexNames::nameToType(accessMethod);
         }
@@ -70,7 +74,8 @@ namespace mongo {
               multikey(mk),
               sparse(sp),
               name(n),
-              infoObj(io) {
+              infoObj(io),
+              filterExpr(NULL) {
 
             type = IndexNames::nameToType(IndexNames::findPluginName(keyPattern));
         }     
@@ -83,7 +88,8 @@ namespace mongo {
               multikey(false),
               sparse(false),
               name("test_foo"),
-              infoObj(BSONObj()) {
+              infoObj(BSONObj()),
+              filterExpr(NULL) {
 
             type = IndexNames::nameToType(IndexNames::findPluginName(keyPattern));
         }     
@@ -92,6 +98,10 @@ namespace mongo {
 
         bool multikey;
 
+        // If 'multikey', the key fields along which some document has an array, or empty if
+        // they are not known.
+        std::set<std::string> multikeyPaths;
+
         bool sparse;
 
         std::string name;
@@ -99,22 +109,45 @@ namespace mongo {
         // Geo indices have extra parameters.  We need those available to plan correctly.
         BSONObj infoObj;
 
+        // The filter of a partial index, which only holds the documents matching it, or NULL.
+        // Owned by the index catalog entry.
+        const MatchExpression* filterExpr;
+
         // What type of index is this?  (What access method can we use on the index described
         // by the keyPattern?)
         IndexType type;
 
+        /**
+         * Could the key field 'path' have been extracted from an array?  Every field of a
+         * multikey index whose multikey paths are not known could have been.
+         */
+        bool isMultikeyPath(const std::string& path) const {
+            return multikey && (multikeyPaths.empty() || multikeyPaths.count(path));
+        }
+
         std::string toString() const {
             mongoutils::str::stream ss;
             ss << "kp: "  << keyPattern.toString();
 
             if (multikey) {
                 ss << " multikey";
+                for (std::set<std::string>::const_iterator it = multikeyPaths.begin();
+                     it != multikeyPaths.end(); ++it) {
+                    ss << (it == multikeyPaths.begin() ? " (" : ", ") << *it;
+                }
+                if (!multikeyPaths.empty()) {
+                    ss << ")";
+                }
             }
 
             if (sparse) {
                 ss << " sparse";
             }
 
+            if (filterExpr) {
+                ss << " partial";
+            }
+
             if (!infoObj.isEmpty()) {
                 ss << " io: " << infoObj.toString();
             }
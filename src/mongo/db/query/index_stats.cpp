@@ -0,0 +1,301 @@
+// index_stats.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/query/index_stats.h"
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+
+#include "mongo/db/query/index_bounds.h"
+#include "mongo/db/query/interval.h"
+#include "mongo/db/query/query_knobs.h"
+
+namespace mongo {
+
+    namespace {
+
+        BSONObj wrapValue(const BSONElement& value) {
+            BSONObjBuilder bob;
+            bob.appendAs(value, "");
+            return bob.obj();
+        }
+
+        int compareValues(const BSONObj& boundary, const BSONElement& value) {
+            return boundary.firstElement().woCompare(value, false);
+        }
+
+        // Orders histogram boundaries against a value, for std::lower_bound and
+        // std::upper_bound.
+        struct BoundaryLess {
+            bool operator()(const BSONObj& boundary, const BSONElement& value) const {
+                return compareValues(boundary, value) < 0;
+            }
+            bool operator()(const BSONElement& value, const BSONObj& boundary) const {
+                return compareValues(boundary, value) > 0;
+            }
+        };
+
+        /**
+         * How far 'value' lies from 'lo' towards 'hi', between 0 and 1.  Only numbers are
+         * interpolated; anything else is assumed to lie halfway.
+         */
+        double interpolate(const BSONElement& lo, const BSONElement& hi,
+                           const BSONElement& value) {
+            if (!lo.isNumber() || !hi.isNumber() || !value.isNumber()) {
+                return 0.5;
+            }
+            const double width = hi.numberDouble() - lo.numberDouble();
+            if (width <= 0) {
+                return 0.5;
+            }
+            const double f = (value.numberDouble() - lo.numberDouble()) / width;
+            return std::max(0.0, std::min(1.0, f));
+        }
+
+    } // namespace
+
+    //
+    // IndexStats::Builder
+    //
+
+    IndexStats::Builder::Builder(const BSONObj& keyPattern, size_t maxBuckets)
+        : _descending(keyPattern.firstElement().number() < 0),
+          _maxBuckets(std::max(size_t(1), maxBuckets)),
+          _stride(1),
+          _numKeys(0),
+          _numDistinct(0) { }
+
+    void IndexStats::Builder::addKey(const BSONObj& key) {
+        const BSONElement value = key.firstElement();
+
+        if (0 == _numKeys || 0 != compareValues(_last, value)) {
+            _last = wrapValue(value);
+            ++_numDistinct;
+        }
+
+        if (0 == _numKeys % _stride) {
+            _boundaries.push_back(_last);
+            if (_boundaries.size() > _maxBuckets) {
+                // Keep the keys at ranks 0, 2 * _stride, 4 * _stride...
+                size_t kept = 0;
+                for (size_t i = 0; i < _boundaries.size(); i += 2) {
+                    _boundaries[kept++] = _boundaries[i];
+                }
+                _boundaries.resize(kept);
+                _stride *= 2;
+            }
+        }
+
+        ++_numKeys;
+    }
+
+    IndexStats* IndexStats::Builder::done() {
+        IndexStats* stats = new IndexStats();
+        stats->_numKeys = _numKeys;
+        stats->_numDistinct = _numDistinct;
+
+        if (0 == _numKeys) {
+            return stats;
+        }
+
+        // Positions of the boundaries in index order.
+        std::vector<long long> positions;
+        for (size_t i = 0; i < _boundaries.size(); ++i) {
+            positions.push_back(i * _stride);
+        }
+        stats->_boundaries.swap(_boundaries);
+
+        // The last key is always a boundary, so the histogram spans every value.
+        if (positions.back() != _numKeys - 1) {
+            positions.push_back(_numKeys - 1);
+            stats->_boundaries.push_back(_last);
+        }
+
+        if (_descending) {
+            std::reverse(stats->_boundaries.begin(), stats->_boundaries.end());
+            std::reverse(positions.begin(), positions.end());
+            for (size_t i = 0; i < positions.size(); ++i) {
+                positions[i] = _numKeys - 1 - positions[i];
+            }
+        }
+        stats->_ranks.swap(positions);
+
+        return stats;
+    }
+
+    //
+    // IndexStats
+    //
+
+    double IndexStats::_keysPerValue() const {
+        return _numDistinct ? double(_numKeys) / _numDistinct : 0;
+    }
+
+    double IndexStats::_rank(const BSONElement& value, bool inclusive) const {
+        std::vector<BSONObj>::const_iterator it = inclusive
+            ? std::upper_bound(_boundaries.begin(), _boundaries.end(), value, BoundaryLess())
+            : std::lower_bound(_boundaries.begin(), _boundaries.end(), value, BoundaryLess());
+
+        if (it == _boundaries.begin()) {
+            return 0;
+        }
+        if (it == _boundaries.end()) {
+            return _numKeys;
+        }
+
+        // 'value' lies in the bucket between boundaries i - 1 and i.
+        const size_t i = it - _boundaries.begin();
+        const double lo = _ranks[i - 1];
+        const double hi = _ranks[i];
+        double rank = lo + interpolate(_boundaries[i - 1].firstElement(),
+                                       _boundaries[i].firstElement(),
+                                       value) * (hi - lo);
+        if (inclusive) {
+            // Count the keys equal to 'value'.
+            rank = std::min(hi, rank + _keysPerValue());
+        }
+        return rank;
+    }
+
+    double IndexStats::estimateKeys(const Interval& interval) const {
+        if (_boundaries.empty()) {
+            return 0;
+        }
+
+        BSONElement start = interval.start;
+        BSONElement end = interval.end;
+        bool startInclusive = interval.startInclusive;
+        bool endInclusive = interval.endInclusive;
+        if (start.woCompare(end, false) > 0) {
+            std::swap(start, end);
+            std::swap(startInclusive, endInclusive);
+        }
+
+        if (interval.isPoint()) {
+            // A value found at several boundaries takes up the buckets between them.
+            std::pair<std::vector<BSONObj>::const_iterator,
+                      std::vector<BSONObj>::const_iterator> range =
+                std::equal_range(_boundaries.begin(), _boundaries.end(), start, BoundaryLess());
+            const size_t count = range.second - range.first;
+            if (count >= 2) {
+                const size_t first = range.first - _boundaries.begin();
+                return _ranks[first + count - 1] - _ranks[first] + 1;
+            }
+            if (0 == count && (range.first == _boundaries.begin()
+                               || range.first == _boundaries.end())) {
+                // Outside the range of values in the index.
+                return 0;
+            }
+            return _keysPerValue();
+        }
+
+        const double keys = _rank(end, endInclusive) - _rank(start, !startInclusive);
+        return std::max(0.0, keys);
+    }
+
+    double IndexStats::estimateKeys(const IndexBounds& bounds) const {
+        if (bounds.isSimpleRange) {
+            if (bounds.startKey.isEmpty() || bounds.endKey.isEmpty()) {
+                return _numKeys;
+            }
+            BSONObjBuilder bob;
+            bob.appendAs(bounds.startKey.firstElement(), "");
+            bob.appendAs(bounds.endKey.firstElement(), "");
+            return estimateKeys(Interval(bob.obj(), true, true));
+        }
+
+        if (bounds.fields.empty()) {
+            return _numKeys;
+        }
+
+        double keys = 0;
+        const std::vector<Interval>& intervals = bounds.fields[0].intervals;
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            keys += estimateKeys(intervals[i]);
+        }
+        return std::min(keys, double(_numKeys));
+    }
+
+    BSONObj IndexStats::toBSON(bool includeHistogram) const {
+        BSONObjBuilder bob;
+        bob.appendNumber("numKeys", _numKeys);
+        bob.appendNumber("numDistinct", _numDistinct);
+        bob.appendNumber("buckets", static_cast<long long>(numBuckets()));
+        if (includeHistogram) {
+            BSONArrayBuilder histogram(bob.subarrayStart("histogram"));
+            for (size_t i = 0; i < _boundaries.size(); ++i) {
+                BSONObjBuilder boundary(histogram.subobjStart());
+                boundary.appendAs(_boundaries[i].firstElement(), "value");
+                boundary.appendNumber("rank", _ranks[i]);
+                boundary.doneFast();
+            }
+            histogram.doneFast();
+        }
+        return bob.obj();
+    }
+
+    //
+    // IndexStatsCache
+    //
+
+    void IndexStatsCache::set(const BSONObj& keyPattern, IndexStats* stats) {
+        Entry entry;
+        entry.stats.reset(stats);
+        entry.writesAtAnalyze = _writeOperations.load();
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        _entries[keyPattern.getOwned()] = entry;
+    }
+
+    boost::shared_ptr<const IndexStats> IndexStatsCache::get(const BSONObj& keyPattern) const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        EntryMap::const_iterator it = _entries.find(keyPattern);
+        if (it == _entries.end()) {
+            return boost::shared_ptr<const IndexStats>();
+        }
+
+        const Entry& entry = it->second;
+        const long long writes = _writeOperations.load() - entry.writesAtAnalyze;
+        const double maxWrites = std::max(1LL, entry.stats->numKeys())
+                                 * internalQueryIndexStatsStaleWriteRatio;
+        if (writes > maxWrites) {
+            return boost::shared_ptr<const IndexStats>();
+        }
+        return entry.stats;
+    }
+
+    void IndexStatsCache::clear() {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        _entries.clear();
+    }
+
+}  // namespace mongo
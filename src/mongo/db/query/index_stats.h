@@ -0,0 +1,190 @@
+// index_stats.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    struct IndexBounds;
+    struct Interval;
+
+    /**
+     * Statistics about the values of the first field of an index, gathered by scanning the
+     * index (see the analyze command) and used to estimate how many keys an index scan over
+     * given bounds will examine.
+     *
+     * The distribution is kept as an equi-depth histogram: the first-field values found at
+     * every 'stride'-th key, plus the smallest and largest values.  Each bucket between two
+     * boundaries holds about the same number of keys, so the number of keys below a value is
+     * known to within one bucket and interpolated inside it.
+     */
+    class IndexStats {
+    public:
+        /**
+         * Builds IndexStats from every key of an index, in index order.  Memory use is bounded
+         * by 'maxBuckets' regardless of the size of the index: whenever the sample fills up,
+         * every other boundary is dropped and the stride doubles.
+         */
+        class Builder {
+            MONGO_DISALLOW_COPYING(Builder);
+        public:
+            /**
+             * 'keyPattern' is the index's key pattern; a descending first field means keys
+             * arrive in descending order.
+             */
+            Builder(const BSONObj& keyPattern, size_t maxBuckets);
+
+            /**
+             * Adds the next key of the index.  The field names of 'key' are ignored.
+             */
+            void addKey(const BSONObj& key);
+
+            /**
+             * Caller owns the returned IndexStats.  The builder may not be used afterwards.
+             */
+            IndexStats* done();
+
+        private:
+            const bool _descending;
+            const size_t _maxBuckets;
+
+            std::vector<BSONObj> _boundaries;
+            long long _stride;
+            long long _numKeys;
+            long long _numDistinct;
+
+            // First field of the previous key.
+            BSONObj _last;
+        };
+
+        /**
+         * Estimated number of keys within 'bounds', an index scan's bounds on the index these
+         * statistics describe.  Only the bounds on the first field are taken into account.
+         */
+        double estimateKeys(const IndexBounds& bounds) const;
+
+        /**
+         * Estimated number of keys whose first field lies within 'interval'.
+         */
+        double estimateKeys(const Interval& interval) const;
+
+        long long numKeys() const { return _numKeys; }
+
+        long long numDistinct() const { return _numDistinct; }
+
+        size_t numBuckets() const { return _boundaries.empty() ? 0 : _boundaries.size() - 1; }
+
+        /**
+         * {numKeys: <n>, numDistinct: <n>, buckets: <n>}, and the boundaries of the histogram
+         * as 'histogram' if 'includeHistogram' is set.
+         */
+        BSONObj toBSON(bool includeHistogram) const;
+
+    private:
+        IndexStats() : _numKeys(0), _numDistinct(0) { }
+
+        /**
+         * Estimated number of keys whose first field is less than 'value', or less than or
+         * equal to it if 'inclusive' is set.
+         */
+        double _rank(const BSONElement& value, bool inclusive) const;
+
+        double _keysPerValue() const;
+
+        // Ascending, and never empty unless the index is.  Each is an object with one,
+        // unnamed, field: the smallest value, the largest value, and in between the values of
+        // the sampled keys.
+        std::vector<BSONObj> _boundaries;
+
+        // Number of keys before the key each of _boundaries was taken from.
+        std::vector<long long> _ranks;
+
+        long long _numKeys;
+        long long _numDistinct;
+    };
+
+    /**
+     * The IndexStats of a collection's indexes, keyed by index key pattern.  Statistics of an
+     * index are no longer returned once enough writes have been made to the collection since
+     * they were gathered (see internalQueryIndexStatsStaleWriteRatio); analyzing the index
+     * again refreshes them.
+     *
+     * Thread safe.
+     */
+    class IndexStatsCache {
+        MONGO_DISALLOW_COPYING(IndexStatsCache);
+    public:
+        IndexStatsCache() { }
+
+        /**
+         * Replaces the statistics of the index with key pattern 'keyPattern'.  Takes
+         * ownership of 'stats'.
+         */
+        void set(const BSONObj& keyPattern, IndexStats* stats);
+
+        /**
+         * Returns the statistics of the index with key pattern 'keyPattern', or an empty
+         * pointer if it was never analyzed or its statistics are stale.
+         */
+        boost::shared_ptr<const IndexStats> get(const BSONObj& keyPattern) const;
+
+        void clear();
+
+        /**
+         * Called for each write to the collection.
+         */
+        void notifyOfWriteOp() { _writeOperations.addAndFetch(1); }
+
+    private:
+        struct Entry {
+            boost::shared_ptr<const IndexStats> stats;
+
+            // Value of _writeOperations when 'stats' were set.
+            long long writesAtAnalyze;
+        };
+
+        typedef std::map<BSONObj, Entry, BSONObjCmp> EntryMap;
+
+        AtomicInt64 _writeOperations;
+
+        mutable boost::mutex _mutex;
+        EntryMap _entries; // guarded by _mutex
+    };
+
+}  // namespace mongo
@@ -0,0 +1,204 @@
+// index_stats_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/db/query/index_stats.h"
+
+#include <algorithm>
+
+#include "mongo/db/query/index_bounds.h"
+#include "mongo/db/query/interval.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    //
+    // Convenience functions
+    //
+
+    IndexStats* buildStats(const BSONObj& keyPattern, const std::vector<int>& values,
+                           size_t maxBuckets) {
+        IndexStats::Builder builder(keyPattern, maxBuckets);
+        for (size_t i = 0; i < values.size(); ++i) {
+            builder.addKey(BSON("" << values[i]));
+        }
+        return builder.done();
+    }
+
+    // 0, 1, ..., n - 1.
+    std::vector<int> sequence(int n) {
+        std::vector<int> values;
+        for (int i = 0; i < n; ++i) {
+            values.push_back(i);
+        }
+        return values;
+    }
+
+    double estimate(const IndexStats& stats, int start, int end,
+                    bool startInclusive = true, bool endInclusive = true) {
+        return stats.estimateKeys(Interval(BSON("" << start << "" << end),
+                                           startInclusive, endInclusive));
+    }
+
+    TEST(IndexStatsTest, EmptyIndex) {
+        std::auto_ptr<IndexStats> stats(buildStats(BSON("a" << 1), std::vector<int>(), 10));
+        ASSERT_EQUALS(0, stats->numKeys());
+        ASSERT_EQUALS(0U, stats->numBuckets());
+        ASSERT_EQUALS(0.0, estimate(*stats, 0, 100));
+    }
+
+    TEST(IndexStatsTest, UniformValues) {
+        std::auto_ptr<IndexStats> stats(buildStats(BSON("a" << 1), sequence(10000), 100));
+        ASSERT_EQUALS(10000, stats->numKeys());
+        ASSERT_EQUALS(10000, stats->numDistinct());
+        ASSERT_LESS_THAN_OR_EQUALS(stats->numBuckets(), 100U);
+
+        ASSERT_APPROX_EQUAL(1000.0, estimate(*stats, 1000, 1999), 10.0);
+        ASSERT_APPROX_EQUAL(5000.0, estimate(*stats, 5000, 20000), 10.0);
+        ASSERT_APPROX_EQUAL(1.0, estimate(*stats, 1234, 1234), 0.01);
+        ASSERT_EQUALS(0.0, estimate(*stats, 20000, 30000));
+        ASSERT_EQUALS(0.0, estimate(*stats, -10, -10));
+
+        // Reversed intervals, as used by descending scans, are understood too.
+        ASSERT_APPROX_EQUAL(1000.0, estimate(*stats, 1999, 1000), 10.0);
+    }
+
+    TEST(IndexStatsTest, DescendingIndex) {
+        std::vector<int> values = sequence(10000);
+        std::reverse(values.begin(), values.end());
+        std::auto_ptr<IndexStats> stats(buildStats(BSON("a" << -1), values, 100));
+        ASSERT_EQUALS(10000, stats->numKeys());
+        ASSERT_APPROX_EQUAL(1000.0, estimate(*stats, 1999, 1000), 10.0);
+        ASSERT_APPROX_EQUAL(500.0, estimate(*stats, 0, 499), 10.0);
+    }
+
+    TEST(IndexStatsTest, BoundedMemory) {
+        std::auto_ptr<IndexStats> stats(buildStats(BSON("a" << 1), sequence(100000), 10));
+        ASSERT_LESS_THAN_OR_EQUALS(stats->numBuckets(), 10U);
+        ASSERT_GREATER_THAN_OR_EQUALS(stats->numBuckets(), 5U);
+        ASSERT_APPROX_EQUAL(50000.0, estimate(*stats, 0, 49999), 100.0);
+    }
+
+    TEST(IndexStatsTest, FrequentValue) {
+        // 9000 keys of 7, followed by one key each of 1000 to 1999.
+        std::vector<int> values(9000, 7);
+        for (int i = 1000; i < 2000; ++i) {
+            values.push_back(i);
+        }
+        std::auto_ptr<IndexStats> stats(buildStats(BSON("a" << 1), values, 100));
+        ASSERT_EQUALS(1001, stats->numDistinct());
+
+        ASSERT_APPROX_EQUAL(9000.0, estimate(*stats, 7, 7), 200.0);
+        ASSERT_LESS_THAN(estimate(*stats, 1500, 1500), 20.0);
+        ASSERT_APPROX_EQUAL(1000.0, estimate(*stats, 8, 5000), 200.0);
+        ASSERT_EQUALS(0.0, estimate(*stats, 5, 5));
+    }
+
+    TEST(IndexStatsTest, ExclusiveBounds) {
+        std::auto_ptr<IndexStats> stats(buildStats(BSON("a" << 1), sequence(1000), 1000));
+        ASSERT_APPROX_EQUAL(11.0, estimate(*stats, 10, 20, true, true), 0.01);
+        ASSERT_APPROX_EQUAL(9.0, estimate(*stats, 10, 20, false, false), 0.01);
+    }
+
+    TEST(IndexStatsTest, NonNumericValues) {
+        IndexStats::Builder builder(BSON("a" << 1), 10);
+        for (char c = 'a'; c <= 'z'; ++c) {
+            for (int i = 0; i < 10; ++i) {
+                builder.addKey(BSON("" << std::string(1, c)));
+            }
+        }
+        std::auto_ptr<IndexStats> stats(builder.done());
+        ASSERT_EQUALS(260, stats->numKeys());
+        ASSERT_EQUALS(26, stats->numDistinct());
+
+        BSONObjBuilder all;
+        all.appendMinKey("");
+        all.appendMaxKey("");
+        ASSERT_EQUALS(260.0, stats->estimateKeys(Interval(all.obj(), true, true)));
+
+        // Only the bucket boundaries are known, so the estimate is within a bucket or so.
+        double firstHalf = stats->estimateKeys(Interval(BSON("" << "a" << "" << "m"),
+                                                        true, true));
+        ASSERT_APPROX_EQUAL(130.0, firstHalf, 60.0);
+    }
+
+    TEST(IndexStatsTest, IndexBounds) {
+        std::auto_ptr<IndexStats> stats(buildStats(BSON("a" << 1 << "b" << 1),
+                                                   sequence(10000), 100));
+
+        // Only the bounds on the first field count.
+        IndexBounds bounds;
+        OrderedIntervalList a("a");
+        a.intervals.push_back(Interval(BSON("" << 0 << "" << 99), true, true));
+        a.intervals.push_back(Interval(BSON("" << 5000 << "" << 5199), true, true));
+        bounds.fields.push_back(a);
+        OrderedIntervalList b("b");
+        b.intervals.push_back(Interval(BSON("" << 0 << "" << 0), true, true));
+        bounds.fields.push_back(b);
+        ASSERT_APPROX_EQUAL(300.0, stats->estimateKeys(bounds), 20.0);
+
+        IndexBounds simple;
+        simple.isSimpleRange = true;
+        simple.startKey = BSON("" << 100 << "" << 0);
+        simple.endKey = BSON("" << 199 << "" << 0);
+        ASSERT_APPROX_EQUAL(100.0, stats->estimateKeys(simple), 10.0);
+
+        IndexBounds full;
+        full.isSimpleRange = true;
+        ASSERT_EQUALS(10000.0, stats->estimateKeys(full));
+    }
+
+    TEST(IndexStatsCacheTest, StatsGoStale) {
+        IndexStatsCache cache;
+        BSONObj keyPattern = BSON("a" << 1);
+        ASSERT(!cache.get(keyPattern));
+
+        // internalQueryIndexStatsStaleWriteRatio is 0.2 writes per key.
+        cache.set(keyPattern, buildStats(keyPattern, sequence(100), 10));
+        ASSERT(cache.get(keyPattern));
+        ASSERT(!cache.get(BSON("b" << 1)));
+
+        for (int i = 0; i < 20; ++i) {
+            cache.notifyOfWriteOp();
+        }
+        ASSERT(cache.get(keyPattern));
+        cache.notifyOfWriteOp();
+        ASSERT(!cache.get(keyPattern));
+
+        // Analyzing again refreshes the statistics.
+        cache.set(keyPattern, buildStats(keyPattern, sequence(100), 10));
+        ASSERT(cache.get(keyPattern));
+
+        cache.clear();
+        ASSERT(!cache.get(keyPattern));
+    }
+
+}  // namespace
@@ -31,9 +31,11 @@
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/client.h"
 #include "mongo/db/exec/collection_scan.h"
+#include "mongo/db/exec/delete.h"
 #include "mongo/db/exec/eof.h"
 #include "mongo/db/exec/fetch.h"
 #include "mongo/db/exec/index_scan.h"
+#include "mongo/db/exec/limit.h"
 #include "mongo/db/query/plan_executor.h"
 
 namespace mongo {
@@ -151,6 +153,52 @@ namespace mongo {
             invariant(execStatus.isOK());
             return exec;
         }
+
+        /**
+         * Return a delete of the documents an index scan finds, in index order, which match
+         * 'filter' if it isn't NULL.  At most 'limit' documents are deleted if it is positive.
+         * The caller owns the returned pointer and 'filter', which must outlive it.
+         */
+        static PlanExecutor* deleteWithIndexScan(OperationContext* txn,
+                                                 Collection* collection,
+                                                 const DeleteStageParams& deleteParams,
+                                                 const IndexDescriptor* descriptor,
+                                                 const BSONObj& startKey, const BSONObj& endKey,
+                                                 bool endKeyInclusive,
+                                                 const MatchExpression* filter,
+                                                 int limit,
+                                                 PlanExecutor::YieldPolicy yieldPolicy,
+                                                 Direction direction = FORWARD) {
+            invariant(collection);
+            invariant(descriptor);
+
+            IndexScanParams params;
+            params.descriptor = descriptor;
+            params.direction = direction;
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = startKey;
+            params.bounds.endKey = endKey;
+            params.bounds.endKeyInclusive = endKeyInclusive;
+
+            WorkingSet* ws = new WorkingSet();
+            PlanStage* root = new IndexScan(txn, params, ws, NULL);
+            root = new FetchStage(txn, ws, root, filter, collection);
+            if (limit > 0) {
+                root = new LimitStage(limit, ws, root);
+            }
+            root = new DeleteStage(txn, deleteParams, ws, collection, root);
+
+            PlanExecutor* exec;
+            // Takes ownership of 'ws' and 'root'.
+            Status execStatus = PlanExecutor::make(txn,
+                                                   ws,
+                                                   root,
+                                                   collection,
+                                                   yieldPolicy,
+                                                   &exec);
+            invariant(execStatus.isOK());
+            return exec;
+        }
     };
 
 }  // namespace mongo
@@ -434,6 +434,8 @@ namespace mongo {
         this->showDiskLoc = false;
         this->snapshot = false;
         this->hasReadPref = false;
+        this->allowDiskUse = false;
+        this->readAhead = false;
         this->tailable = false;
         this->slaveOk = false;
         this->oplogReplay = false;
@@ -543,6 +545,22 @@ namespace mongo {
 
                 out->snapshot = el.boolean();
             }
+            else if (mongoutils::str::equals(fieldName, "allowDiskUse")) {
+                Status status = checkFieldType(el, Bool);
+                if (!status.isOK()) {
+                    return status;
+                }
+
+                out->allowDiskUse = el.boolean();
+            }
+            else if (mongoutils::str::equals(fieldName, "readAhead")) {
+                Status status = checkFieldType(el, Bool);
+                if (!status.isOK()) {
+                    return status;
+                }
+
+                out->readAhead = el.boolean();
+            }
             else if (mongoutils::str::equals(fieldName, "tailable")) {
                 Status status = checkFieldType(el, Bool);
                 if (!status.isOK()) {
@@ -791,6 +809,14 @@ namespace mongo {
                     // Won't throw.
                     _options.maxScan = e.numberInt();
                 }
+                else if (str::equals("allowDiskUse", name)) {
+                    // Won't throw.
+                    _options.allowDiskUse = e.trueValue();
+                }
+                else if (str::equals("readAhead", name)) {
+                    // Won't throw.
+                    _options.readAhead = e.trueValue();
+                }
                 else if (str::equals("showDiskLoc", name)) {
                     // Won't throw.
                     if (e.trueValue()) {
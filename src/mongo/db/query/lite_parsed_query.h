@@ -97,6 +97,12 @@ namespace mongo {
             bool snapshot;
             bool hasReadPref;
 
+            // May a blocking sort which exceeds its memory limit write to temporary files?
+            bool allowDiskUse;
+
+            // Does the cursor compute its next batch between getMores?
+            bool readAhead;
+
             // Options that can be specified in the OP_QUERY 'flags' header.
             bool tailable;
             bool slaveOk;
@@ -191,6 +197,8 @@ namespace mongo {
         bool isSnapshot() const { return _options.snapshot; }
         bool returnKey() const { return _options.returnKey; }
         bool showDiskLoc() const { return _options.showDiskLoc; }
+        bool allowDiskUse() const { return _options.allowDiskUse; }
+        bool readAhead() const { return _options.readAhead; }
 
         const BSONObj& getMin() const { return _options.min; }
         const BSONObj& getMax() const { return _options.max; }
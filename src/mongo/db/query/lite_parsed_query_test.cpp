@@ -584,6 +584,56 @@ namespace {
         ASSERT_NOT_OK(status);
     }
 
+    TEST(LiteParsedQueryTest, ParseFromCommandAllowDiskUse) {
+        BSONObj cmdObj = fromjson("{find: 'testns',"
+                                   "sort: {a: 1},"
+                                   "options: {allowDiskUse: true}}");
+
+        LiteParsedQuery* rawLpq;
+        bool isExplain = false;
+        Status status = LiteParsedQuery::make("testns", cmdObj, isExplain, &rawLpq);
+        ASSERT_OK(status);
+        scoped_ptr<LiteParsedQuery> lpq(rawLpq);
+
+        ASSERT(lpq->allowDiskUse());
+    }
+
+    TEST(LiteParsedQueryTest, ParseFromCommandAllowDiskUseWrongType) {
+        BSONObj cmdObj = fromjson("{find: 'testns',"
+                                   "filter:  {a: 1},"
+                                   "options: {allowDiskUse: 1}}");
+
+        LiteParsedQuery* rawLpq;
+        bool isExplain = false;
+        Status status = LiteParsedQuery::make("testns", cmdObj, isExplain, &rawLpq);
+        ASSERT_NOT_OK(status);
+    }
+
+    TEST(LiteParsedQueryTest, ParseFromCommandReadAhead) {
+        BSONObj cmdObj = fromjson("{find: 'testns',"
+                                   "filter:  {a: 1},"
+                                   "options: {readAhead: true}}");
+
+        LiteParsedQuery* rawLpq;
+        bool isExplain = false;
+        Status status = LiteParsedQuery::make("testns", cmdObj, isExplain, &rawLpq);
+        ASSERT_OK(status);
+        scoped_ptr<LiteParsedQuery> lpq(rawLpq);
+
+        ASSERT(lpq->readAhead());
+    }
+
+    TEST(LiteParsedQueryTest, ParseFromCommandReadAheadWrongType) {
+        BSONObj cmdObj = fromjson("{find: 'testns',"
+                                   "filter:  {a: 1},"
+                                   "options: {readAhead: 1}}");
+
+        LiteParsedQuery* rawLpq;
+        bool isExplain = false;
+        Status status = LiteParsedQuery::make("testns", cmdObj, isExplain, &rawLpq);
+        ASSERT_NOT_OK(status);
+    }
+
     TEST(LiteParsedQueryTest, ParseFromCommandTailableWrongType) {
         BSONObj cmdObj = fromjson("{find: 'testns',"
                                    "filter:  {a: 1},"
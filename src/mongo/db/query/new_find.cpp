@@ -32,9 +32,12 @@
 
 #include "mongo/db/query/new_find.h"
 
+#include <algorithm>
+
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/catalog/collection_cursor_cache.h"
 #include "mongo/db/catalog/database_holder.h"
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/oplogstart.h"
@@ -46,6 +49,7 @@
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/qlog.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner_params.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/server_options.h"
@@ -181,7 +185,12 @@ namespace mongo {
                             int pass,
                             bool& exhaust,
                             bool* isCursorAuthorized,
-                            bool fromDBDirectClient) {
+                            bool fromDBDirectClient,
+                            bool* readAhead) {
+
+        if (NULL != readAhead) {
+            *readAhead = false;
+        }
 
         // For testing, we may want to fail if we receive a getmore.
         if (MONGO_FAIL_POINT(failReceivedGetmore)) {
@@ -269,6 +278,7 @@ namespace mongo {
             // If the operation that spawned this cursor had a time limit set, apply leftover
             // time to this getmore.
             curop.setMaxTimeMicros(cc->getLeftoverMaxTimeMicros());
+            txn->lockState()->setWaitDeadline(curop.getMaxTimeDeadlineMicros());
             txn->checkForInterrupt(); // May trigger maxTimeAlwaysTimeOut fail point.
 
             if (0 == pass) { 
@@ -297,7 +307,8 @@ namespace mongo {
 
             BSONObj obj;
             PlanExecutor::ExecState state;
-            while (PlanExecutor::ADVANCED == (state = exec->getNext(&obj, NULL))) {
+            // Results read ahead since the last getMore come first.
+            while (PlanExecutor::ADVANCED == (state = cc->getNext(&obj))) {
                 // Add result to output buffer.
                 bb.appendBuf((void*)obj.objdata(), obj.objsize());
 
@@ -394,6 +405,10 @@ namespace mongo {
                         return NULL;
                     }
                 }
+                else if (NULL != readAhead) {
+                    *readAhead = cc->readAhead() && !fromDBDirectClient && !cc->isAggCursor
+                                 && !(queryOptions & QueryOption_Exhaust);
+                }
 
                 // Possibly note slave's position in the oplog.
                 if ((queryOptions & QueryOption_OplogReplay) && !slaveReadTill.isNull()) {
@@ -420,6 +435,96 @@ namespace mongo {
         return qr;
     }
 
+    void readAheadCursor(OperationContext* txn,
+                         const HostAndPort& remote,
+                         const std::string& ns,
+                         CursorId cursorid) {
+        if (inShutdown()) {
+            return;
+        }
+
+        // Show up in currentOp like the getMore we're doing the work of.
+        CurOp& curop = *txn->getCurOp();
+        curop.reset(remote, dbGetMore);
+        curop.ensureStarted();
+        curop.debug().ns = ns;
+        curop.debug().cursorid = cursorid;
+        curop.setMessage("reading ahead");
+
+        bool eraseCursor = false;
+        try {
+            const NamespaceString nss(ns);
+            AutoGetCollectionForRead ctx(txn, nss);
+            Collection* collection = ctx.getCollection();
+            if (NULL == collection
+                || !repl::getGlobalReplicationCoordinator()->checkCanServeReadsFor(
+                        txn, nss, true).isOK()) {
+                curop.done();
+                return;
+            }
+
+            ClientCursorPin ccPin(collection, cursorid);
+            ClientCursor* cc = ccPin.c();
+            if (NULL == cc || !cc->readAhead() || cc->isAggCursor) {
+                curop.done();
+                return;
+            }
+
+            const size_t maxBytes = std::max(0, internalQueryExecReadAheadBytes);
+            if (cc->readAheadBytes() >= maxBytes) {
+                curop.done();
+                return;
+            }
+
+            // This must be destroyed before the pin; see newGetMore.
+            if (!cc->hasRecoveryUnit()) {
+                cc->setOwnedRecoveryUnit(
+                    getGlobalEnvironment()->getGlobalStorageEngine()->newRecoveryUnit(txn));
+            }
+            ScopedRecoveryUnitSwapper ruSwapper(cc, txn);
+
+            curop.setMaxTimeMicros(cc->getLeftoverMaxTimeMicros());
+            txn->lockState()->setWaitDeadline(curop.getMaxTimeDeadlineMicros());
+
+            PlanExecutor* exec = cc->getExecutor();
+            exec->restoreState(txn);
+
+            BSONObj obj;
+            PlanExecutor::ExecState state = PlanExecutor::ADVANCED;
+            while (cc->readAheadBytes() < maxBytes) {
+                state = exec->getNext(&obj, NULL);
+                if (PlanExecutor::ADVANCED != state) {
+                    break;
+                }
+                cc->pushReadAheadResult(obj.getOwned());
+            }
+
+            // A tailable cursor at EOF may have more results by the next getMore, so only the
+            // states which end the executor for good are kept.
+            if (PlanExecutor::DEAD == state || PlanExecutor::EXEC_ERROR == state) {
+                cc->setReadAheadEnd(state, obj);
+            }
+
+            exec->saveState();
+            cc->setLeftoverMaxTimeMicros(curop.getRemainingMaxTimeMicros());
+
+            QLOG() << "read ahead " << cc->readAheadBytes() << " bytes for cursorid "
+                   << cursorid << ", ended with state " << PlanExecutor::statestr(state) << endl;
+        }
+        catch (const DBException& e) {
+            LOG(1) << "read-ahead for cursorid " << cursorid << " failed: " << e.toString();
+            eraseCursor = true;
+        }
+
+        // The executor may be out of sync with what it has returned, as after a getMore which
+        // throws.
+        if (eraseCursor) {
+            CollectionCursorCache::eraseCursorGlobal(txn, cursorid);
+        }
+
+        curop.done();
+    }
+
     Status getOplogStartHack(OperationContext* txn,
                              Collection* collection,
                              CanonicalQuery* cq,
@@ -522,7 +627,12 @@ namespace mongo {
                             QueryMessage& q,
                             CurOp& curop,
                             Message &result,
-                            bool fromDBDirectClient) {
+                            bool fromDBDirectClient,
+                            bool* readAhead) {
+        if (NULL != readAhead) {
+            *readAhead = false;
+        }
+
         // Validate the namespace.
         const char *ns = q.ns;
         uassert(16332, "can't have an empty ns", ns[0]);
@@ -589,6 +699,10 @@ namespace mongo {
         // We use this a lot below.
         const LiteParsedQuery& pq = cq->getParsed();
 
+        // mongos may send the shard version with the query rather than set it on the connection
+        // first, in which case the query is checked against that version.
+        ShardRequestVersionBlock requestVersion(nss.ns(), q.query);
+
         AutoGetCollectionForRead ctx(txn, nss);
 
         const int dbProfilingLevel = (ctx.getDb() != NULL) ? ctx.getDb()->getProfilingLevel() :
@@ -665,6 +779,7 @@ namespace mongo {
 
         // Handle query option $maxTimeMS (not used with commands).
         curop.setMaxTimeMicros(static_cast<unsigned long long>(pq.getMaxTimeMS()) * 1000);
+        txn->lockState()->setWaitDeadline(curop.getMaxTimeDeadlineMicros());
         txn->checkForInterrupt(); // May trigger maxTimeAlwaysTimeOut fail point.
 
         // uassert if we are not on a primary, and not a secondary with SlaveOk query parameter set.
@@ -797,6 +912,17 @@ namespace mongo {
         curop.debug().nscannedObjects = summaryStats.totalDocsExamined;
         curop.debug().idhack = summaryStats.isIdhack;
 
+        // Account for the first batch in the statistics of the query's shape.
+        if (collection) {
+            collection->infoCache()->getQueryShapeStats()->record(
+                *cq,
+                static_cast<uint64_t>(curop.elapsedMicros()),
+                summaryStats.totalKeysExamined,
+                summaryStats.totalDocsExamined,
+                numResults,
+                curop.debug().planSummary.toString());
+        }
+
         // Set debug information for consumption by the profiler.
         if (dbProfilingLevel > 0 ||
             curop.elapsedMillis() > serverGlobalParams.slowMS ||
@@ -862,6 +988,13 @@ namespace mongo {
             cc->setCollMetadata(collMetadata);
             cc->setPos(numResults);
 
+            if (pq.readAhead() && !fromDBDirectClient && !pq.getOptions().exhaust) {
+                cc->setReadAhead(true);
+                if (NULL != readAhead) {
+                    *readAhead = (state != PlanExecutor::IS_EOF);
+                }
+            }
+
             // If the query had a time limit, remaining time is "rolled over" to the cursor (for
             // use by future getmore ops).
             cc->setLeftoverMaxTimeMicros(curop.getRemainingMaxTimeMicros());
@@ -57,6 +57,9 @@ namespace mongo {
 
     /**
      * Called from the getMore entry point in ops/query.cpp.
+     *
+     * If 'readAhead' is non-NULL, it is set to whether the caller should call readAheadCursor
+     * once it has sent the reply.
      */
     QueryResult::View newGetMore(OperationContext* txn,
                             const char* ns,
@@ -66,16 +69,35 @@ namespace mongo {
                             int pass,
                             bool& exhaust,
                             bool* isCursorAuthorized,
-                            bool fromDBDirectClient);
+                            bool fromDBDirectClient,
+                            bool* readAhead = NULL);
 
     /**
      * Run the query 'q' and place the result in 'result'.
+     *
+     * If 'readAhead' is non-NULL, it is set as by newGetMore.
      */
     std::string newRunQuery(OperationContext* txn,
                             Message& m,
                             QueryMessage& q,
                             CurOp& curop,
                             Message &result,
-                            bool fromDBDirectClient);
+                            bool fromDBDirectClient,
+                            bool* readAhead = NULL);
+
+    /**
+     * Computes up to internalQueryExecReadAheadBytes of the next results of the cursor
+     * 'cursorid' over 'ns', if it was opened with the readAhead option, and buffers them in the
+     * ClientCursor for the next getMore.  Called on the connection's thread after replying to a
+     * query or getMore, so that the work overlaps with the client consuming the reply.
+     *
+     * The read-ahead takes the same locks, yields the same way and uses the same time limit as
+     * a getMore would.  Failures are not reported; a cursor whose executor threw is erased, as
+     * after a failed getMore.
+     */
+    void readAheadCursor(OperationContext* txn,
+                         const HostAndPort& remote,
+                         const std::string& ns,
+                         CursorId cursorid);
 
 }  // namespace mongo
@@ -0,0 +1,401 @@
+// parameterized_solution.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/query/parameterized_solution.h"
+
+#include "mongo/db/index_names.h"
+#include "mongo/db/matcher/expression_tree.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/qlog.h"
+#include "mongo/db/query/query_planner_common.h"
+#include "mongo/db/query/query_planner_params.h"
+#include "mongo/db/query/query_solution.h"
+
+namespace mongo {
+
+    namespace {
+
+        /**
+         * Appends the predicates of 'root' to 'out', in order.  Returns false unless 'root' is a
+         * comparison or $in, or a conjunction of them.
+         */
+        bool getLeaves(const MatchExpression* root, std::vector<const MatchExpression*>* out) {
+            if (MatchExpression::AND != root->matchType()) {
+                out->push_back(root);
+            }
+            else {
+                for (size_t i = 0; i < root->numChildren(); ++i) {
+                    out->push_back(root->getChild(i));
+                }
+            }
+
+            for (size_t i = 0; i < out->size(); ++i) {
+                switch ((*out)[i]->matchType()) {
+                case MatchExpression::EQ:
+                case MatchExpression::LT:
+                case MatchExpression::LTE:
+                case MatchExpression::GT:
+                case MatchExpression::GTE:
+                case MatchExpression::MATCH_IN:
+                    break;
+                default:
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Options which add stages, or change them, without changing the shape of the query.
+         */
+        bool hasPlanAffectingOptions(const CanonicalQuery& query) {
+            const LiteParsedQuery& lpq = query.getParsed();
+            return 0 != lpq.getSkip()
+                || (0 != lpq.getNumToReturn() && !lpq.wantMore())
+                || 0 != lpq.getMaxScan()
+                || lpq.returnKey();
+        }
+
+        bool boundsEqual(const IndexBounds& a, const IndexBounds& b) {
+            if (a.isSimpleRange || b.isSimpleRange || a.fields.size() != b.fields.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < a.fields.size(); ++i) {
+                const std::vector<Interval>& ia = a.fields[i].intervals;
+                const std::vector<Interval>& ib = b.fields[i].intervals;
+                if (a.fields[i].name != b.fields[i].name || ia.size() != ib.size()) {
+                    return false;
+                }
+                for (size_t j = 0; j < ia.size(); ++j) {
+                    if (!ia[j].equals(ib[j])) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+    } // namespace
+
+    ParameterizedSolution::~ParameterizedSolution() { }
+
+    // static
+    ParameterizedSolution* ParameterizedSolution::make(const CanonicalQuery& query,
+                                                       const QuerySolution& soln) {
+        if (NULL == soln.root.get() || hasPlanAffectingOptions(query)) {
+            return NULL;
+        }
+
+        std::vector<const MatchExpression*> leaves;
+        if (!getLeaves(query.root(), &leaves)) {
+            return NULL;
+        }
+
+        // The solution must be a chain of stages over one index scan.
+        const IndexScanNode* ixn = NULL;
+        const FetchNode* fetch = NULL;
+        for (const QuerySolutionNode* node = soln.root.get(); NULL != node;
+             node = node->children.empty() ? NULL : node->children[0]) {
+            if (node->children.size() > 1) {
+                return NULL;
+            }
+            switch (node->getType()) {
+            case STAGE_PROJECTION:
+            case STAGE_SHARDING_FILTER:
+            case STAGE_KEEP_MUTATIONS:
+                break;
+            case STAGE_FETCH:
+                if (NULL != fetch) {
+                    return NULL;
+                }
+                fetch = static_cast<const FetchNode*>(node);
+                break;
+            case STAGE_IXSCAN:
+                ixn = static_cast<const IndexScanNode*>(node);
+                break;
+            default:
+                return NULL;
+            }
+        }
+
+        if (NULL == ixn || NULL != ixn->filter.get() || ixn->indexIsMultiKey
+            || ixn->bounds.isSimpleRange
+            || INDEX_BTREE != IndexNames::nameToType(
+                    IndexNames::findPluginName(ixn->indexKeyPattern))) {
+            return NULL;
+        }
+
+        std::auto_ptr<ParameterizedSolution> ps(new ParameterizedSolution());
+        ps->_keyPattern = ixn->indexKeyPattern.getOwned();
+        ps->_direction = ixn->direction;
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            ps->_leafTypes.push_back(leaves[i]->matchType());
+        }
+
+        // Each predicate over a field of the index is assumed to have been used for its bounds,
+        // and kept in the filter unless the bounds are exact.
+        std::vector<bool> inBounds(leaves.size(), false);
+        BSONObjIterator kpIt(ps->_keyPattern);
+        while (kpIt.more()) {
+            const StringData field = kpIt.next().fieldNameStringData();
+            std::vector<size_t> fieldLeaves;
+            for (size_t i = 0; i < leaves.size(); ++i) {
+                if (leaves[i]->path() == field) {
+                    fieldLeaves.push_back(i);
+                    inBounds[i] = true;
+                }
+            }
+            ps->_boundsLeaves.push_back(fieldLeaves);
+        }
+
+        IndexEntry index(ps->_keyPattern);
+        IndexBounds bounds;
+        if (!ps->_buildBounds(leaves, index, &bounds, &ps->_tightness)) {
+            return NULL;
+        }
+
+        std::vector<size_t> filterLeaves;
+        size_t t = 0;
+        for (size_t f = 0; f < ps->_boundsLeaves.size(); ++f) {
+            for (size_t j = 0; j < ps->_boundsLeaves[f].size(); ++j, ++t) {
+                if (IndexBoundsBuilder::INEXACT_COVERED == ps->_tightness[t]) {
+                    return NULL;
+                }
+                if (IndexBoundsBuilder::EXACT != ps->_tightness[t]) {
+                    filterLeaves.push_back(ps->_boundsLeaves[f][j]);
+                }
+            }
+        }
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            if (!inBounds[i]) {
+                filterLeaves.push_back(i);
+            }
+        }
+        std::sort(filterLeaves.begin(), filterLeaves.end());
+
+        // The planner may have reordered the filter, so take the order from it.
+        const MatchExpression* filter = fetch ? fetch->filter.get() : NULL;
+        std::vector<const MatchExpression*> filterExprs;
+        if (NULL != filter && MatchExpression::AND == filter->matchType()) {
+            for (size_t i = 0; i < filter->numChildren(); ++i) {
+                filterExprs.push_back(filter->getChild(i));
+            }
+        }
+        else if (NULL != filter) {
+            filterExprs.push_back(filter);
+        }
+
+        std::vector<bool> matched(leaves.size(), false);
+        for (size_t i = 0; i < filterExprs.size(); ++i) {
+            size_t j = 0;
+            while (j < leaves.size() && (matched[j] || !leaves[j]->equivalent(filterExprs[i]))) {
+                ++j;
+            }
+            if (j == leaves.size()) {
+                return NULL;
+            }
+            matched[j] = true;
+            ps->_filterLeaves.push_back(j);
+        }
+
+        // Check that the assumptions reproduce the planner's solution.
+        std::vector<size_t> sortedFilterLeaves(ps->_filterLeaves);
+        std::sort(sortedFilterLeaves.begin(), sortedFilterLeaves.end());
+        if (!boundsEqual(bounds, ixn->bounds) || sortedFilterLeaves != filterLeaves
+            || (1 == filterExprs.size() && filter != filterExprs[0])) {
+            QLOG() << "Solution not parameterized, unexpected bounds or filter:" << endl
+                   << soln.root->toString();
+            return NULL;
+        }
+
+        // Keep the shape of the solution, but nothing which refers to the query.
+        ps->_root.reset(soln.root->clone());
+        for (QuerySolutionNode* node = ps->_root.get(); NULL != node;
+             node = node->children.empty() ? NULL : node->children[0]) {
+            node->filter.reset();
+            if (STAGE_IXSCAN == node->getType()) {
+                IndexScanNode* scan = static_cast<IndexScanNode*>(node);
+                scan->indexKeyPattern = ps->_keyPattern;
+                scan->bounds = IndexBounds();
+            }
+            else if (STAGE_PROJECTION == node->getType()) {
+                ProjectionNode* pn = static_cast<ProjectionNode*>(node);
+                pn->fullExpression = NULL;
+                pn->projection = BSONObj();
+                pn->coveredKeyObj = pn->coveredKeyObj.getOwned();
+            }
+        }
+
+        return ps.release();
+    }
+
+    bool ParameterizedSolution::_buildBounds(
+            const std::vector<const MatchExpression*>& leaves,
+            const IndexEntry& index,
+            IndexBounds* boundsOut,
+            std::vector<IndexBoundsBuilder::BoundsTightness>* tightness) const {
+        const bool recordTightness = tightness->empty();
+        size_t t = 0;
+
+        BSONObjIterator kpIt(index.keyPattern);
+        for (size_t f = 0; f < _boundsLeaves.size(); ++f) {
+            const BSONElement kpElt = kpIt.next();
+            boundsOut->fields.push_back(OrderedIntervalList());
+            OrderedIntervalList* oil = &boundsOut->fields.back();
+
+            const std::vector<size_t>& fieldLeaves = _boundsLeaves[f];
+            if (fieldLeaves.empty()) {
+                IndexBoundsBuilder::allValuesForField(kpElt, oil);
+                continue;
+            }
+
+            for (size_t j = 0; j < fieldLeaves.size(); ++j, ++t) {
+                IndexBoundsBuilder::BoundsTightness tight;
+                if (0 == j) {
+                    IndexBoundsBuilder::translate(leaves[fieldLeaves[j]], kpElt, index,
+                                                  oil, &tight);
+                }
+                else {
+                    IndexBoundsBuilder::translateAndIntersect(leaves[fieldLeaves[j]], kpElt,
+                                                              index, oil, &tight);
+                }
+
+                if (recordTightness) {
+                    tightness->push_back(tight);
+                }
+                else if ((*tightness)[t] != tight) {
+                    return false;
+                }
+            }
+        }
+
+        IndexBoundsBuilder::alignBounds(boundsOut, index.keyPattern);
+        if (-1 == _direction) {
+            IndexScanNode reversed;
+            reversed.indexKeyPattern = index.keyPattern;
+            reversed.bounds = *boundsOut;
+            QueryPlannerCommon::reverseScans(&reversed);
+            *boundsOut = reversed.bounds;
+        }
+        return true;
+    }
+
+    MatchExpression* ParameterizedSolution::_buildFilter(
+            const std::vector<const MatchExpression*>& leaves) const {
+        if (_filterLeaves.empty()) {
+            return NULL;
+        }
+        if (1 == _filterLeaves.size()) {
+            return leaves[_filterLeaves[0]]->shallowClone();
+        }
+        std::auto_ptr<AndMatchExpression> filter(new AndMatchExpression());
+        for (size_t i = 0; i < _filterLeaves.size(); ++i) {
+            filter->add(leaves[_filterLeaves[i]]->shallowClone());
+        }
+        return filter.release();
+    }
+
+    bool ParameterizedSolution::_bindNode(const CanonicalQuery& query,
+                                          const std::vector<const MatchExpression*>& leaves,
+                                          const IndexEntry& index,
+                                          QuerySolutionNode* node) const {
+        switch (node->getType()) {
+        case STAGE_IXSCAN: {
+            IndexScanNode* scan = static_cast<IndexScanNode*>(node);
+            std::vector<IndexBoundsBuilder::BoundsTightness> tightness(_tightness);
+            return _buildBounds(leaves, index, &scan->bounds, &tightness);
+        }
+        case STAGE_FETCH:
+            node->filter.reset(_buildFilter(leaves));
+            return true;
+        case STAGE_KEEP_MUTATIONS:
+            node->filter.reset(query.root()->shallowClone());
+            return true;
+        case STAGE_PROJECTION: {
+            ProjectionNode* pn = static_cast<ProjectionNode*>(node);
+            pn->fullExpression = query.root();
+            pn->projection = query.getParsed().getProj();
+            return true;
+        }
+        default:
+            return true;
+        }
+    }
+
+    QuerySolution* ParameterizedSolution::bind(const CanonicalQuery& query,
+                                               const QueryPlannerParams& params) const {
+        if (hasPlanAffectingOptions(query)) {
+            return NULL;
+        }
+
+        std::vector<const MatchExpression*> leaves;
+        if (!getLeaves(query.root(), &leaves) || leaves.size() != _leafTypes.size()) {
+            return NULL;
+        }
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            if (leaves[i]->matchType() != _leafTypes[i]) {
+                return NULL;
+            }
+        }
+
+        // The index must still be there, and still be usable for any constants.
+        const IndexEntry* index = NULL;
+        for (size_t i = 0; i < params.indices.size(); ++i) {
+            if (params.indices[i].keyPattern.woCompare(_keyPattern) == 0) {
+                index = &params.indices[i];
+                break;
+            }
+        }
+        if (NULL == index || index->multikey || index->sparse) {
+            return NULL;
+        }
+
+        std::auto_ptr<QuerySolutionNode> root(_root->clone());
+        for (QuerySolutionNode* node = root.get(); NULL != node;
+             node = node->children.empty() ? NULL : node->children[0]) {
+            if (!_bindNode(query, leaves, *index, node)) {
+                return NULL;
+            }
+        }
+        root->computeProperties();
+
+        std::auto_ptr<QuerySolution> soln(new QuerySolution());
+        soln->filterData = query.getQueryObj();
+        soln->indexFilterApplied = params.indexFiltersApplied;
+        soln->root.reset(root.release());
+
+        QLOG() << "Planner: solution bound from parameterized cache entry:" << endl
+               << soln->toString() << endl;
+        return soln.release();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,126 @@
+// parameterized_solution.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/query/index_bounds_builder.h"
+
+namespace mongo {
+
+    class CanonicalQuery;
+    struct QueryPlannerParams;
+    struct QuerySolution;
+    struct QuerySolutionNode;
+
+    /**
+     * A cached winning solution from which the solution for another query of the same shape is
+     * made by substituting that query's constants, without tagging, access planning or
+     * analysis.
+     *
+     * Only the simplest and most common solutions are parameterized: a scan of one non-multikey
+     * btree index, optionally fetched, filtered, projected and sharding-filtered, answering a
+     * conjunction of comparisons and $in.  The index bounds on each key field are remembered as
+     * the predicates they were built from, and the fetch filter as the predicates left over.
+     * make() checks that rebuilding the solution from its own query reproduces it exactly, so a
+     * parameterized solution is never used where the planner would have planned differently.
+     */
+    class ParameterizedSolution {
+        MONGO_DISALLOW_COPYING(ParameterizedSolution);
+    public:
+        ~ParameterizedSolution();
+
+        /**
+         * Returns the parameterized form of 'soln', a solution for 'query', or NULL if it can't
+         * be parameterized.  Caller owns the result, which does not refer to either argument.
+         */
+        static ParameterizedSolution* make(const CanonicalQuery& query,
+                                           const QuerySolution& soln);
+
+        /**
+         * Returns the solution for 'query', which must have the shape of the query this was made
+         * from, or NULL if its constants would change the plan (an array where the original
+         * query had a scalar, say) and it must be planned from the cache as usual.  Caller owns
+         * the result.
+         */
+        QuerySolution* bind(const CanonicalQuery& query, const QueryPlannerParams& params) const;
+
+    private:
+        ParameterizedSolution() : _direction(1) { }
+
+        /**
+         * Builds the bounds of a scan over 'index' from 'leaves', the predicates of a query in
+         * order.  If '*tightness' is empty the tightness of the bounds made from each predicate
+         * is appended to it; otherwise returns false unless they match it.
+         */
+        bool _buildBounds(const std::vector<const MatchExpression*>& leaves,
+                          const IndexEntry& index,
+                          IndexBounds* boundsOut,
+                          std::vector<IndexBoundsBuilder::BoundsTightness>* tightness) const;
+
+        /**
+         * The fetch filter over 'leaves', or NULL if there is none.  Caller owns the result.
+         */
+        MatchExpression* _buildFilter(const std::vector<const MatchExpression*>& leaves) const;
+
+        /**
+         * Fills in everything in a copy of _root which came from the query.  Returns false if
+         * the result would not be the solution the planner would make.
+         */
+        bool _bindNode(const CanonicalQuery& query,
+                       const std::vector<const MatchExpression*>& leaves,
+                       const IndexEntry& index,
+                       QuerySolutionNode* node) const;
+
+        // The solution's nodes, with the filters and the bounds removed.
+        boost::scoped_ptr<QuerySolutionNode> _root;
+
+        // Key pattern and direction of the scanned index.
+        BSONObj _keyPattern;
+        int _direction;
+
+        // The match type of each predicate.
+        std::vector<MatchExpression::MatchType> _leafTypes;
+
+        // For each field of the key pattern, the predicates intersected to make its bounds.
+        std::vector<std::vector<size_t> > _boundsLeaves;
+
+        // Tightness of the bounds made from each of the predicates in _boundsLeaves, in order.
+        std::vector<IndexBoundsBuilder::BoundsTightness> _tightness;
+
+        // The predicates in the fetch filter.
+        std::vector<size_t> _filterLeaves;
+    };
+
+}  // namespace mongo
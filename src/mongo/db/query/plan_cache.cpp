@@ -35,9 +35,10 @@
 #include <algorithm>
 #include <math.h>
 #include <memory>
-#include "boost/thread/locks.hpp"
+#include <boost/functional/hash.hpp>
 #include "mongo/base/owned_pointer_vector.h"
 #include "mongo/client/dbclientinterface.h"   // For QueryOption_foobar
+#include "mongo/db/query/parameterized_solution.h"
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/qlog.h"
@@ -108,6 +109,7 @@ namespace mongo {
     CachedSolution::CachedSolution(const PlanCacheKey& key, const PlanCacheEntry& entry)
         : plannerData(entry.plannerData.size()),
           backupSoln(entry.backupSoln),
+          parameterized(entry.parameterized),
           key(key),
           query(entry.query.getOwned()),
           sort(entry.sort.getOwned()),
@@ -168,6 +170,7 @@ namespace mongo {
         PlanCacheEntry* entry = new PlanCacheEntry(solutions.vector(), decision->clone());
 
         entry->backupSoln = backupSoln;
+        entry->parameterized = parameterized;
 
         // Copy query shape.
         entry->query = query.getOwned();
@@ -250,6 +253,68 @@ namespace mongo {
         return ss;
     }
 
+    BSONObj PlanCacheIndexTree::toBSON() const {
+        BSONObjBuilder bob;
+        if (NULL != entry.get()) {
+            bob.append("index", entry->keyPattern);
+            bob.append("pos", static_cast<int>(index_pos));
+        }
+        BSONArrayBuilder childrenBob(bob.subarrayStart("children"));
+        for (vector<PlanCacheIndexTree*>::const_iterator it = children.begin();
+                it != children.end(); ++it) {
+            childrenBob.append((*it)->toBSON());
+        }
+        childrenBob.doneFast();
+        return bob.obj();
+    }
+
+    // static
+    Status PlanCacheIndexTree::parse(const BSONObj& obj,
+                                     const std::vector<IndexEntry>& indices,
+                                     PlanCacheIndexTree** out) {
+        std::auto_ptr<PlanCacheIndexTree> tree(new PlanCacheIndexTree());
+
+        BSONElement indexElt = obj["index"];
+        if (!indexElt.eoo()) {
+            if (Object != indexElt.type() || !obj["pos"].isNumber()) {
+                return Status(ErrorCodes::BadValue, "malformed index in plan cache index tree");
+            }
+            const BSONObj keyPattern = indexElt.Obj();
+            std::vector<IndexEntry>::const_iterator it = indices.begin();
+            while (it != indices.end() && 0 != it->keyPattern.woCompare(keyPattern)) {
+                ++it;
+            }
+            if (it == indices.end()) {
+                mongoutils::str::stream ss;
+                ss << "Did not find index with keyPattern: " << keyPattern.toString();
+                return Status(ErrorCodes::BadValue, ss);
+            }
+            tree->setIndexEntry(*it);
+            tree->index_pos = static_cast<size_t>(obj["pos"].numberInt());
+        }
+
+        BSONElement childrenElt = obj["children"];
+        if (Array != childrenElt.type()) {
+            return Status(ErrorCodes::BadValue, "plan cache index tree has no children array");
+        }
+        BSONObjIterator it(childrenElt.Obj());
+        while (it.more()) {
+            BSONElement childElt = it.next();
+            if (Object != childElt.type()) {
+                return Status(ErrorCodes::BadValue, "malformed plan cache index tree child");
+            }
+            PlanCacheIndexTree* child;
+            Status s = parse(childElt.Obj(), indices, &child);
+            if (!s.isOK()) {
+                return s;
+            }
+            tree->children.push_back(child);
+        }
+
+        *out = tree.release();
+        return Status::OK();
+    }
+
     //
     // SolutionCacheData
     //
@@ -277,6 +342,12 @@ namespace mongo {
                << "tree=" << this->tree->toString()
                << ")";
             break;
+        case SKIP_IXSCAN_SOLN:
+            verify(this->tree.get());
+            ss << "(skip index scan solution: "
+               << "tree=" << this->tree->toString()
+               << ")";
+            break;
         case COLLSCAN_SOLN:
             ss << "(collection scan)";
             break;
@@ -289,16 +360,113 @@ namespace mongo {
         return ss;
     }
 
+    namespace {
+
+        const char* solutionTypeName(SolutionCacheData::SolutionType type) {
+            switch (type) {
+            case SolutionCacheData::WHOLE_IXSCAN_SOLN: return "wholeIndexScan";
+            case SolutionCacheData::SKIP_IXSCAN_SOLN: return "skipIndexScan";
+            case SolutionCacheData::COLLSCAN_SOLN: return "collectionScan";
+            case SolutionCacheData::USE_INDEX_TAGS_SOLN: return "indexTags";
+            }
+            invariant(false);
+            return NULL;
+        }
+
+    } // namespace
+
+    BSONObj SolutionCacheData::toBSON() const {
+        BSONObjBuilder bob;
+        bob.append("type", solutionTypeName(solnType));
+        if (NULL != tree.get()) {
+            bob.append("tree", tree->toBSON());
+        }
+        bob.append("dir", wholeIXSolnDir);
+        bob.append("indexFilterApplied", indexFilterApplied);
+        return bob.obj();
+    }
+
+    // static
+    Status SolutionCacheData::parse(const BSONObj& obj,
+                                    const std::vector<IndexEntry>& indices,
+                                    SolutionCacheData** out) {
+        std::auto_ptr<SolutionCacheData> data(new SolutionCacheData());
+
+        const std::string typeName = obj["type"].str();
+        if (typeName == solutionTypeName(WHOLE_IXSCAN_SOLN)) {
+            data->solnType = WHOLE_IXSCAN_SOLN;
+        }
+        else if (typeName == solutionTypeName(SKIP_IXSCAN_SOLN)) {
+            data->solnType = SKIP_IXSCAN_SOLN;
+        }
+        else if (typeName == solutionTypeName(COLLSCAN_SOLN)) {
+            data->solnType = COLLSCAN_SOLN;
+        }
+        else if (typeName == solutionTypeName(USE_INDEX_TAGS_SOLN)) {
+            data->solnType = USE_INDEX_TAGS_SOLN;
+        }
+        else {
+            return Status(ErrorCodes::BadValue,
+                          mongoutils::str::stream() << "unknown cached solution type: " << typeName);
+        }
+
+        BSONElement treeElt = obj["tree"];
+        if (COLLSCAN_SOLN != data->solnType) {
+            if (Object != treeElt.type()) {
+                return Status(ErrorCodes::BadValue, "cached solution has no index tree");
+            }
+            PlanCacheIndexTree* tree;
+            Status s = PlanCacheIndexTree::parse(treeElt.Obj(), indices, &tree);
+            if (!s.isOK()) {
+                return s;
+            }
+            data->tree.reset(tree);
+            if (WHOLE_IXSCAN_SOLN == data->solnType && NULL == tree->entry.get()) {
+                return Status(ErrorCodes::BadValue, "whole index scan solution has no index");
+            }
+            if (SKIP_IXSCAN_SOLN == data->solnType && NULL == tree->entry.get()) {
+                return Status(ErrorCodes::BadValue, "skip index scan solution has no index");
+            }
+        }
+
+        data->wholeIXSolnDir = obj["dir"].numberInt() < 0 ? -1 : 1;
+        data->indexFilterApplied = obj["indexFilterApplied"].trueValue();
+
+        *out = data.release();
+        return Status::OK();
+    }
+
     //
     // PlanCache
     //
 
-    PlanCache::PlanCache() : _cache(internalQueryCacheSize) { }
+    namespace {
+
+        size_t perShardCacheSize(size_t numShards) {
+            size_t total = std::max(0, internalQueryCacheSize);
+            return std::max(size_t(1), (total + numShards - 1) / numShards);
+        }
 
-    PlanCache::PlanCache(const std::string& ns) : _cache(internalQueryCacheSize), _ns(ns) { }
+    } // namespace
+
+    PlanCache::PlanCache() {
+        for (size_t i = 0; i < kNumShards; ++i) {
+            _shards[i].reset(new Shard(perShardCacheSize(kNumShards)));
+        }
+    }
+
+    PlanCache::PlanCache(const std::string& ns) : _ns(ns) {
+        for (size_t i = 0; i < kNumShards; ++i) {
+            _shards[i].reset(new Shard(perShardCacheSize(kNumShards)));
+        }
+    }
 
     PlanCache::~PlanCache() { }
 
+    PlanCache::Shard& PlanCache::_shardFor(const PlanCacheKey& key) const {
+        return *_shards[boost::hash<PlanCacheKey>()(key) % kNumShards];
+    }
+
     Status PlanCache::add(const CanonicalQuery& query,
                           const std::vector<QuerySolution*>& solns,
                           PlanRankingDecision* why) {
@@ -340,8 +508,58 @@ namespace mongo {
             }
         }
 
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        std::auto_ptr<PlanCacheEntry> evictedEntry = _cache.add(query.getPlanCacheKey(), entry);
+        if (internalQueryCacheParameterizeSolutions) {
+            entry->parameterized.reset(ParameterizedSolution::make(query, *solns[0]));
+        }
+
+        Shard& shard = _shardFor(query.getPlanCacheKey());
+        rwlock lk(shard.lock, true);
+        std::auto_ptr<PlanCacheEntry> evictedEntry = shard.cache.add(query.getPlanCacheKey(),
+                                                                     entry);
+
+        if (NULL != evictedEntry.get()) {
+            LOG(1) << _ns << ": plan cache maximum size exceeded - "
+                   << "removed least recently used entry "
+                   << evictedEntry->toString();
+        }
+
+        return Status::OK();
+    }
+
+    Status PlanCache::restore(const CanonicalQuery& query,
+                              const std::vector<SolutionCacheData*>& solns,
+                              const boost::optional<size_t>& backupSoln) {
+        if (solns.empty()) {
+            return Status(ErrorCodes::BadValue, "no solutions provided");
+        }
+
+        if (backupSoln && *backupSoln >= solns.size()) {
+            return Status(ErrorCodes::BadValue, "backup solution out of range");
+        }
+
+        OwnedPointerVector<QuerySolution> solutions;
+        for (size_t i = 0; i < solns.size(); ++i) {
+            QuerySolution* qs = new QuerySolution();
+            qs->cacheData.reset(solns[i]->clone());
+            solutions.mutableVector().push_back(qs);
+        }
+
+        std::auto_ptr<PlanCacheEntry> entry(new PlanCacheEntry(solutions.vector(),
+                                                               new PlanRankingDecision()));
+        const LiteParsedQuery& pq = query.getParsed();
+        entry->query = pq.getFilter().getOwned();
+        entry->sort = pq.getSort().getOwned();
+        entry->projection = pq.getProj().getOwned();
+        entry->backupSoln = backupSoln;
+
+        Shard& shard = _shardFor(query.getPlanCacheKey());
+        rwlock lk(shard.lock, true);
+        if (shard.cache.hasKey(query.getPlanCacheKey())) {
+            return Status::OK();
+        }
+
+        std::auto_ptr<PlanCacheEntry> evictedEntry = shard.cache.add(query.getPlanCacheKey(),
+                                                                     entry.release());
 
         if (NULL != evictedEntry.get()) {
             LOG(1) << _ns << ": plan cache maximum size exceeded - "
@@ -356,9 +574,10 @@ namespace mongo {
         const PlanCacheKey& key = query.getPlanCacheKey();
         verify(crOut);
 
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        Shard& shard = _shardFor(key);
+        rwlock lk(shard.lock, false);
         PlanCacheEntry* entry;
-        Status cacheStatus = _cache.get(key, &entry);
+        Status cacheStatus = shard.cache.get(key, &entry);
         if (!cacheStatus.isOK()) {
             return cacheStatus;
         }
@@ -427,9 +646,10 @@ namespace mongo {
         std::auto_ptr<PlanCacheEntryFeedback> autoFeedback(feedback);
         const PlanCacheKey& ck = cq.getPlanCacheKey();
 
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        Shard& shard = _shardFor(ck);
+        rwlock lk(shard.lock, true);
         PlanCacheEntry* entry;
-        Status cacheStatus = _cache.get(ck, &entry);
+        Status cacheStatus = shard.cache.get(ck, &entry);
         if (!cacheStatus.isOK()) {
             return cacheStatus;
         }
@@ -441,7 +661,7 @@ namespace mongo {
             if (hasCachedPlanPerformanceDegraded(entry, autoFeedback.get())) {
                 LOG(1) << _ns << ": removing plan cache entry " << entry->toString()
                        << " - detected degradation in performance of cached solution.";
-                _cache.remove(ck);
+                shard.cache.remove(ck);
             }
         }
         else {
@@ -453,13 +673,16 @@ namespace mongo {
     }
 
     Status PlanCache::remove(const CanonicalQuery& canonicalQuery) {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        return _cache.remove(canonicalQuery.getPlanCacheKey());
+        Shard& shard = _shardFor(canonicalQuery.getPlanCacheKey());
+        rwlock lk(shard.lock, true);
+        return shard.cache.remove(canonicalQuery.getPlanCacheKey());
     }
 
     void PlanCache::clear() {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        _cache.clear();
+        for (size_t i = 0; i < kNumShards; ++i) {
+            rwlock lk(_shards[i]->lock, true);
+            _shards[i]->cache.clear();
+        }
         _writeOperations.store(0);
     }
 
@@ -467,9 +690,10 @@ namespace mongo {
         const PlanCacheKey& key = query.getPlanCacheKey();
         verify(entryOut);
 
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        Shard& shard = _shardFor(key);
+        rwlock lk(shard.lock, false);
         PlanCacheEntry* entry;
-        Status cacheStatus = _cache.get(key, &entry);
+        Status cacheStatus = shard.cache.get(key, &entry);
         if (!cacheStatus.isOK()) {
             return cacheStatus;
         }
@@ -481,25 +705,45 @@ namespace mongo {
     }
 
     std::vector<PlanCacheEntry*> PlanCache::getAllEntries() const {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
         std::vector<PlanCacheEntry*> entries;
-        typedef std::list< std::pair<PlanCacheKey, PlanCacheEntry*> >::const_iterator ConstIterator;
-        for (ConstIterator i = _cache.begin(); i != _cache.end(); i++) {
-            PlanCacheEntry* entry = i->second;
-            entries.push_back(entry->clone());
+        for (size_t s = 0; s < kNumShards; ++s) {
+            const Shard& shard = *_shards[s];
+            rwlock lk(shard.lock, false);
+            for (ShardCache::SlotConstIt i = shard.cache.begin(); i != shard.cache.end(); ++i) {
+                entries.push_back((*i)->value->clone());
+            }
+        }
+
+        return entries;
+    }
+
+    std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> >
+    PlanCache::getAllEntriesWithKeys() const {
+        std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> > entries;
+        for (size_t s = 0; s < kNumShards; ++s) {
+            const Shard& shard = *_shards[s];
+            rwlock lk(shard.lock, false);
+            for (ShardCache::SlotConstIt i = shard.cache.begin(); i != shard.cache.end(); ++i) {
+                entries.push_back(std::make_pair((*i)->key, (*i)->value->clone()));
+            }
         }
 
         return entries;
     }
 
     bool PlanCache::contains(const CanonicalQuery& cq) const {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        return _cache.hasKey(cq.getPlanCacheKey());
+        Shard& shard = _shardFor(cq.getPlanCacheKey());
+        rwlock lk(shard.lock, false);
+        return shard.cache.hasKey(cq.getPlanCacheKey());
     }
 
     size_t PlanCache::size() const {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        return _cache.size();
+        size_t total = 0;
+        for (size_t i = 0; i < kNumShards; ++i) {
+            rwlock lk(_shards[i]->lock, false);
+            total += _shards[i]->cache.size();
+        }
+        return total;
     }
 
     void PlanCache::notifyOfWriteOp() {
@@ -30,17 +30,20 @@
 
 #include <set>
 #include <boost/optional/optional.hpp>
-#include <boost/thread/mutex.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "mongo/db/exec/plan_stats.h"
 #include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/clock_key_value.h"
 #include "mongo/db/query/index_tag.h"
-#include "mongo/db/query/lru_key_value.h"
 #include "mongo/db/query/query_planner_params.h"
 #include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/rwlock.h"
 
 namespace mongo {
 
+    class ParameterizedSolution;
     struct PlanRankingDecision;
     struct QuerySolution;
     struct QuerySolutionNode;
@@ -106,6 +109,21 @@ namespace mongo {
          */
         std::string toString(int indents = 0) const;
 
+        /**
+         * Serializes the tree.  Index entries are recorded by key pattern only.
+         */
+        BSONObj toBSON() const;
+
+        /**
+         * Rebuilds a tree serialized by toBSON(), resolving each key pattern against 'indices'.
+         * Fails if the serialized form is malformed or names an index not in 'indices'.
+         *
+         * On success, the caller owns '*out'.
+         */
+        static Status parse(const BSONObj& obj,
+                            const std::vector<IndexEntry>& indices,
+                            PlanCacheIndexTree** out);
+
         // Children owned here.
         std::vector<PlanCacheIndexTree*> children;
 
@@ -135,6 +153,18 @@ namespace mongo {
         // For debugging.
         std::string toString() const;
 
+        // Serializes this data, for storage outside of the cache.
+        BSONObj toBSON() const;
+
+        /**
+         * Rebuilds data serialized by toBSON().  See PlanCacheIndexTree::parse().
+         *
+         * On success, the caller owns '*out'.
+         */
+        static Status parse(const BSONObj& obj,
+                            const std::vector<IndexEntry>& indices,
+                            SolutionCacheData** out);
+
         // Owned here. If 'wholeIXSoln' is false, then 'tree'
         // can be used to tag an isomorphic match expression. If 'wholeIXSoln'
         // is true, then 'tree' is used to store the relevant IndexEntry.
@@ -147,6 +177,10 @@ namespace mongo {
             // scan (e.g. using index to provide sort).
             WHOLE_IXSCAN_SOLN,
 
+            // The plan skip scans the index in 'tree',
+            // whose leading field is not constrained.
+            SKIP_IXSCAN_SOLN,
+
             // The cached plan is a collection scan.
             COLLSCAN_SOLN,
 
@@ -183,6 +217,10 @@ namespace mongo {
         // used to produce a backup solution in the case of a blocking sort.
         boost::optional<size_t> backupSoln;
 
+        // The winning solution with its constants taken out, if it could be parameterized.
+        // Shared with the cache entry; never modified.
+        boost::shared_ptr<const ParameterizedSolution> parameterized;
+
         // Key used to provide feedback on the entry.
         PlanCacheKey key;
 
@@ -236,6 +274,10 @@ namespace mongo {
         // used to produce a backup solution in the case of a blocking sort.
         boost::optional<size_t> backupSoln;
 
+        // The winning solution with its constants taken out, from which the solution for
+        // another query of the same shape can be made directly, if it could be parameterized.
+        boost::shared_ptr<const ParameterizedSolution> parameterized;
+
         // TODO: Do we really want to just hold a copy of the CanonicalQuery?  For now we just
         // extract the data we need.
         //
@@ -309,6 +351,18 @@ namespace mongo {
                    const std::vector<QuerySolution*>& solns,
                    PlanRankingDecision* why);
 
+        /**
+         * Adds an entry for 'query' from planner data which was cached earlier, possibly by
+         * another process, and read back with SolutionCacheData::parse().  'solns' is copied.
+         *
+         * The new entry has no ranking decision, so it is kept only as long as the feedback
+         * from the CachedPlanStage says the plan performs consistently.  An entry which is
+         * already in the cache is left alone; returns Status::OK() in that case too.
+         */
+        Status restore(const CanonicalQuery& query,
+                       const std::vector<SolutionCacheData*>& solns,
+                       const boost::optional<size_t>& backupSoln);
+
         /**
          * Look up the cached data access for the provided 'query'.  Used by the query planner
          * to shortcut planning.
@@ -368,6 +422,11 @@ namespace mongo {
          */
         std::vector<PlanCacheEntry*> getAllEntries() const;
 
+        /**
+         * As getAllEntries(), but pairs each entry with its key.  Caller owns the entries.
+         */
+        std::vector<std::pair<PlanCacheKey, PlanCacheEntry*> > getAllEntriesWithKeys() const;
+
         /**
          * Returns true if there is an entry in the cache for the 'query'.
          * Internally calls hasKey() on the LRU cache.
@@ -395,12 +454,26 @@ namespace mongo {
          */
         void _clear();
 
-        LRUKeyValue<PlanCacheKey, PlanCacheEntry> _cache;
+        typedef ClockKeyValue<PlanCacheKey, PlanCacheEntry> ShardCache;
 
         /**
-         * Protects _cache.
+         * An independently locked part of the cache; each key belongs to one shard.  Lookups
+         * take the shard's lock shared.  Everything which modifies the shard, or one of its
+         * entries as feedback() does, takes it exclusively.
          */
-        mutable boost::mutex _cacheMutex;
+        struct Shard {
+            Shard(size_t maxSize) : lock("PlanCache::Shard"), cache(maxSize) { }
+
+            RWLock lock;
+            ShardCache cache;
+        };
+
+        static const size_t kNumShards = 16;
+
+        Shard& _shardFor(const PlanCacheKey& key) const;
+
+        // Owned here.  Each shard holds an equal part of internalQueryCacheSize entries.
+        boost::scoped_ptr<Shard> _shards[kNumShards];
 
         /**
          * Counter for write notifications since initialization or last clear() invocation.
@@ -37,6 +37,7 @@
 #include <memory>
 #include "mongo/db/jsobj.h"
 #include "mongo/db/json.h"
+#include "mongo/db/query/parameterized_solution.h"
 #include "mongo/db/query/qlog.h"
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/query_knobs.h"
@@ -379,6 +380,45 @@ namespace {
         ASSERT_EQUALS(planCache.size(), 1U);
     }
 
+    TEST(PlanCacheTest, RestoreSolution) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        SolutionCacheData scd;
+        scd.solnType = SolutionCacheData::COLLSCAN_SOLN;
+        std::vector<SolutionCacheData*> solns;
+        solns.push_back(&scd);
+
+        ASSERT_NOT_OK(planCache.restore(*cq, std::vector<SolutionCacheData*>(),
+                                        boost::optional<size_t>()));
+        ASSERT_NOT_OK(planCache.restore(*cq, solns, boost::optional<size_t>(1U)));
+        ASSERT_FALSE(planCache.contains(*cq));
+
+        ASSERT_OK(planCache.restore(*cq, solns, boost::optional<size_t>()));
+        ASSERT_TRUE(planCache.contains(*cq));
+
+        PlanCacheEntry* entryRaw;
+        ASSERT_OK(planCache.getEntry(*cq, &entryRaw));
+        boost::scoped_ptr<PlanCacheEntry> entry(entryRaw);
+        ASSERT_EQUALS(entry->plannerData.size(), 1U);
+        ASSERT_EQUALS(entry->plannerData[0]->solnType, SolutionCacheData::COLLSCAN_SOLN);
+        ASSERT_EQUALS(entry->query, fromjson("{a: 1}"));
+        ASSERT_TRUE(entry->decision->stats.empty());
+
+        // An entry which is already cached is not replaced.
+        planCache.clear();
+        QuerySolution qs;
+        qs.cacheData.reset(new SolutionCacheData());
+        qs.cacheData->tree.reset(new PlanCacheIndexTree());
+        std::vector<QuerySolution*> added;
+        added.push_back(&qs);
+        ASSERT_OK(planCache.add(*cq, added, createDecision(1U)));
+        ASSERT_OK(planCache.restore(*cq, solns, boost::optional<size_t>()));
+        ASSERT_OK(planCache.getEntry(*cq, &entryRaw));
+        entry.reset(entryRaw);
+        ASSERT_EQUALS(entry->plannerData[0]->solnType, SolutionCacheData::USE_INDEX_TAGS_SOLN);
+        ASSERT_EQUALS(entry->decision->stats.size(), 1U);
+    }
+
     TEST(PlanCacheTest, NotifyOfWriteOp) {
         PlanCache planCache;
         auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
@@ -718,6 +758,25 @@ namespace {
             delete planSoln;
         }
 
+        /**
+         * As assertPlanCacheRecoversSolution(), but the cache data of the best solution is
+         * first serialized and parsed again, as it is when plan cache entries are persisted.
+         */
+        void assertPlanCacheRecoversSerializedSolution(const BSONObj& query,
+                                                       const BSONObj& sort,
+                                                       const BSONObj& proj,
+                                                       const string& solnJson) {
+            QuerySolution* bestSoln = firstMatchingSolution(solnJson);
+            SolutionCacheData* scd;
+            ASSERT_OK(SolutionCacheData::parse(bestSoln->cacheData->toBSON(),
+                                               params.indices, &scd));
+            QuerySolution parsedSoln;
+            parsedSoln.cacheData.reset(scd);
+            QuerySolution* planSoln = planQueryFromCache(query, sort, proj, parsedSoln);
+            assertSolutionMatches(planSoln, solnJson);
+            delete planSoln;
+        }
+
         /**
          * Check that the solution will not be cached. The planner will store
          * cache data inside non-cachable solutions, but will not do so for
@@ -730,6 +789,47 @@ namespace {
             ASSERT(NULL == bestSoln->cacheData.get());
         }
 
+        /**
+         * Parameterizes the solution matching 'solnJson', which was generated for the last
+         * query run, and binds it to 'query' with projection 'proj'.  Returns NULL if the
+         * solution can't be parameterized or if the constants of 'query' can't be bound.
+         */
+        QuerySolution* bindParameterized(const BSONObj& query,
+                                         const BSONObj& proj,
+                                         const string& solnJson) const {
+            QuerySolution* bestSoln = firstMatchingSolution(solnJson);
+            scoped_ptr<ParameterizedSolution> parameterized(
+                ParameterizedSolution::make(*cq, *bestSoln));
+            if (NULL == parameterized.get()) {
+                return NULL;
+            }
+
+            CanonicalQuery* boundCq;
+            Status s = CanonicalQuery::canonicalize(ns, query, BSONObj(), proj, &boundCq);
+            ASSERT_OK(s);
+            scoped_ptr<CanonicalQuery> scopedCq(boundCq);
+            return parameterized->bind(*boundCq, params);
+        }
+
+        /**
+         * Asserts that binding 'query' to the parameterized form of the solution matching
+         * 'solnJson' gives the solution 'boundJson'.
+         */
+        void assertParameterizedSolutionBinds(const BSONObj& query,
+                                              const BSONObj& proj,
+                                              const string& solnJson,
+                                              const string& boundJson) {
+            auto_ptr<QuerySolution> boundSoln(bindParameterized(query, proj, solnJson));
+            ASSERT(NULL != boundSoln.get());
+            assertSolutionMatches(boundSoln.get(), boundJson);
+        }
+
+        void assertParameterizedSolutionDoesNotBind(const BSONObj& query,
+                                                    const string& solnJson) {
+            auto_ptr<QuerySolution> boundSoln(bindParameterized(query, BSONObj(), solnJson));
+            ASSERT(NULL == boundSoln.get());
+        }
+
         static const PlanCacheKey ck;
 
         BSONObj queryObj;
@@ -937,6 +1037,77 @@ namespace {
             "{fetch: {filter: null, node: {ixscan: {filter: null, pattern: {_id: 1}}}}}");
     }
 
+    //
+    // Cache data which has been serialized and parsed again.
+    //
+
+    TEST_F(CachePlanSelectionTest, SerializedOrWithAndChild) {
+        addIndex(BSON("a" << 1));
+        BSONObj query = fromjson("{$or: [{a: 20}, {$and: [{a:1}, {b:7}]}]}");
+        runQuery(query);
+        assertPlanCacheRecoversSerializedSolution(query, BSONObj(), BSONObj(),
+            "{fetch: {filter: null, node: {or: {nodes: ["
+                "{ixscan: {filter: null, pattern: {a: 1}}}, "
+                "{fetch: {filter: {b: 7}, node: {ixscan: "
+                "{filter: null, pattern: {a: 1}}}}}]}}}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, SerializedReverseScanForSort) {
+        addIndex(BSON("_id" << 1));
+        runQuerySortProj(BSONObj(), fromjson("{_id: -1}"), BSONObj());
+        assertPlanCacheRecoversSerializedSolution(BSONObj(), fromjson("{_id: -1}"), BSONObj(),
+            "{fetch: {filter: null, node: {ixscan: {filter: null, pattern: {_id: 1}}}}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, SerializedCollscan) {
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(BSON("b" << 4));
+        assertPlanCacheRecoversSerializedSolution(BSON("b" << 4), BSONObj(), BSONObj(),
+            "{cscan: {filter: {b: 4}, dir: 1}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, SerializedSkipScan) {
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(BSON("b" << 4));
+        assertPlanCacheRecoversSerializedSolution(BSON("b" << 4), BSONObj(), BSONObj(),
+            "{fetch: {filter: {b: 4}, node: {ixscan: {pattern: {a: 1, b: 1}, "
+                "bounds: {a: [['MinKey','MaxKey',true,true]], b: [[4,4,true,true]]}}}}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, SerializedIndexNoLongerExists) {
+        addIndex(BSON("a" << 1));
+        addIndex(BSON("b" << 1));
+        runQuery(fromjson("{a: 1, b: 1}"));
+        QuerySolution* bestSoln = firstMatchingSolution(
+            "{fetch: {filter: {b: 1}, node: {ixscan: {filter: null, pattern: {a: 1}}}}}");
+        const BSONObj serialized = bestSoln->cacheData->toBSON();
+
+        // Drop {a: 1}.
+        std::vector<IndexEntry> remaining;
+        for (size_t i = 0; i < params.indices.size(); ++i) {
+            if (params.indices[i].keyPattern != BSON("a" << 1)) {
+                remaining.push_back(params.indices[i]);
+            }
+        }
+        SolutionCacheData* scd;
+        ASSERT_NOT_OK(SolutionCacheData::parse(serialized, remaining, &scd));
+        ASSERT_OK(SolutionCacheData::parse(serialized, params.indices, &scd));
+        delete scd;
+    }
+
+    //
+    // Skip scan.
+    //
+
+    TEST_F(CachePlanSelectionTest, SkipScan) {
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{b: {$gt: 4}}"));
+        assertPlanCacheRecoversSolution(fromjson("{b: {$gt: 4}}"),
+            "{fetch: {node: {ixscan: {pattern: {a: 1, b: 1}, "
+                "bounds: {a: [['MinKey','MaxKey',true,true]], "
+                         "b: [[4,Infinity,false,true]]}}}}}");
+    }
+
     //
     // Caching collection scans.
     //
@@ -1008,6 +1179,107 @@ namespace {
                             "node: {ixscan: {filter: null, pattern: {a: 1}}}}}");
     }
 
+    //
+    // Parameterized solutions.
+    //
+
+    TEST_F(CachePlanSelectionTest, ParameterizedEquality) {
+        addIndex(BSON("a" << 1));
+        runQuery(BSON("a" << 5));
+        assertParameterizedSolutionBinds(BSON("a" << 7), BSONObj(),
+                                         "{fetch: {filter: null, node: "
+                                             "{ixscan: {filter: null, pattern: {a: 1}}}}}",
+                                         "{fetch: {filter: null, node: "
+                                             "{ixscan: {filter: null, pattern: {a: 1}, "
+                                                 "bounds: {a: [[7,7,true,true]]}}}}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, ParameterizedRangeWithFetchFilter) {
+        addIndex(BSON("a" << 1));
+        runQuery(fromjson("{a: {$gt: 5}, b: 3}"));
+        assertParameterizedSolutionBinds(fromjson("{a: {$gt: 8}, b: 4}"), BSONObj(),
+                                         "{fetch: {filter: {b: 3}, node: "
+                                             "{ixscan: {filter: null, pattern: {a: 1}}}}}",
+                                         "{fetch: {filter: {b: 4}, node: "
+                                             "{ixscan: {filter: null, pattern: {a: 1}, "
+                                                 "bounds: {a: [[8,Infinity,false,true]]}}}}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, ParameterizedCompoundIn) {
+        addIndex(BSON("a" << 1 << "b" << 1));
+        runQuery(fromjson("{a: 5, b: {$in: [1, 2]}}"));
+        assertParameterizedSolutionBinds(fromjson("{a: 6, b: {$in: [3, 4, 5]}}"), BSONObj(),
+                                         "{fetch: {filter: null, node: "
+                                             "{ixscan: {filter: null, pattern: {a: 1, b: 1}}}}}",
+                                         "{fetch: {filter: null, node: "
+                                             "{ixscan: {filter: null, pattern: {a: 1, b: 1}, "
+                                                 "bounds: {a: [[6,6,true,true]], "
+                                                 "b: [[3,3,true,true],[4,4,true,true],"
+                                                     "[5,5,true,true]]}}}}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, ParameterizedDescendingIndex) {
+        addIndex(BSON("a" << -1));
+        runQuery(fromjson("{a: {$lt: 5}}"));
+        string solnJson = "{fetch: {filter: null, node: "
+                              "{ixscan: {filter: null, pattern: {a: -1}}}}}";
+        auto_ptr<QuerySolution> boundSoln(bindParameterized(fromjson("{a: {$lt: 3}}"),
+                                                            BSONObj(), solnJson));
+        ASSERT(NULL != boundSoln.get());
+
+        // The bounds run from high to low, so compare with what the planner makes.
+        runQuery(fromjson("{a: {$lt: 3}}"));
+        ASSERT_EQUALS(firstMatchingSolution(solnJson)->root->toString(),
+                      boundSoln->root->toString());
+    }
+
+    TEST_F(CachePlanSelectionTest, ParameterizedCoveredProjection) {
+        addIndex(BSON("a" << 1));
+        BSONObj proj = fromjson("{_id: 0, a: 1}");
+        runQuerySortProj(BSON("a" << 5), BSONObj(), proj);
+        assertParameterizedSolutionBinds(BSON("a" << 9), proj,
+                                         "{proj: {spec: {_id: 0, a: 1}, node: "
+                                             "{ixscan: {filter: null, pattern: {a: 1}}}}}",
+                                         "{proj: {spec: {_id: 0, a: 1}, node: "
+                                             "{ixscan: {filter: null, pattern: {a: 1}, "
+                                                 "bounds: {a: [[9,9,true,true]]}}}}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, ParameterizedConstantsChangeTightness) {
+        addIndex(BSON("a" << 1));
+        runQuery(BSON("a" << 5));
+        string solnJson = "{fetch: {filter: null, node: {ixscan: {pattern: {a: 1}}}}}";
+        assertParameterizedSolutionDoesNotBind(fromjson("{a: [1, 2]}"), solnJson);
+        assertParameterizedSolutionDoesNotBind(fromjson("{a: null}"), solnJson);
+    }
+
+    TEST_F(CachePlanSelectionTest, ParameterizedIndexBecameMultikey) {
+        addIndex(BSON("a" << 1));
+        runQuery(BSON("a" << 5));
+        params.indices.back().multikey = true;
+        assertParameterizedSolutionDoesNotBind(BSON("a" << 7),
+                                               "{fetch: {filter: null, node: "
+                                                   "{ixscan: {pattern: {a: 1}}}}}");
+    }
+
+    TEST_F(CachePlanSelectionTest, ParameterizedNotMultikeyOrOr) {
+        addIndex(BSON("a" << 1), true);
+        runQuery(BSON("a" << 5));
+        QuerySolution* bestSoln = firstMatchingSolution("{fetch: {filter: null, node: "
+                                                            "{ixscan: {pattern: {a: 1}}}}}");
+        scoped_ptr<ParameterizedSolution> parameterized(
+            ParameterizedSolution::make(*cq, *bestSoln));
+        ASSERT(NULL == parameterized.get());
+
+        addIndex(BSON("b" << 1));
+        runQuery(fromjson("{$or: [{a: 1}, {b: 1}]}"));
+        bestSoln = firstMatchingSolution("{fetch: {filter: null, node: {or: {nodes: ["
+                                             "{ixscan: {pattern: {a: 1}}}, "
+                                             "{ixscan: {pattern: {b: 1}}}]}}}}");
+        parameterized.reset(ParameterizedSolution::make(*cq, *bestSoln));
+        ASSERT(NULL == parameterized.get());
+    }
+
     //
     // Queries using '2d' indices are not cached.
     //
@@ -0,0 +1,161 @@
+// plan_cost.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/query/plan_cost.h"
+
+#include <algorithm>
+
+#include "mongo/db/query/index_stats.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/query/query_solution.h"
+
+namespace mongo {
+
+    PlanCostModel::PlanCostModel(const IndexStatsCache* stats, long long numRecords)
+        : _stats(stats),
+          _numRecords(numRecords) { }
+
+    bool PlanCostModel::estimate(const QuerySolution& soln, double* costOut) const {
+        Estimate est;
+        if (NULL == soln.root.get() || !_estimate(soln.root.get(), &est)) {
+            return false;
+        }
+        *costOut = est.cost;
+        return true;
+    }
+
+    size_t PlanCostModel::prune(std::vector<QuerySolution*>* solutions) const {
+        std::vector<double> costs(solutions->size());
+        for (size_t i = 0; i < solutions->size(); ++i) {
+            if (!estimate(*(*solutions)[i], &costs[i])) {
+                return 0;
+            }
+        }
+
+        // Estimates of a handful of keys are too rough to tell plans apart.
+        const double cheapest = std::max(1.0, *std::min_element(costs.begin(), costs.end()));
+        const double maxCost = cheapest * std::max(1.0, internalQueryPlannerCostPruneRatio);
+
+        std::vector<QuerySolution*> kept;
+        for (size_t i = 0; i < solutions->size(); ++i) {
+            if (costs[i] > maxCost) {
+                delete (*solutions)[i];
+            }
+            else {
+                kept.push_back((*solutions)[i]);
+            }
+        }
+
+        const size_t pruned = solutions->size() - kept.size();
+        solutions->swap(kept);
+        return pruned;
+    }
+
+    bool PlanCostModel::_estimate(const QuerySolutionNode* node, Estimate* out) const {
+        std::vector<Estimate> children(node->children.size());
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            if (!_estimate(node->children[i], &children[i])) {
+                return false;
+            }
+        }
+
+        switch (node->getType()) {
+        case STAGE_COLLSCAN:
+            out->cost = _numRecords;
+            out->results = _numRecords;
+            return true;
+
+        case STAGE_IXSCAN: {
+            const IndexScanNode* ixn = static_cast<const IndexScanNode*>(node);
+            boost::shared_ptr<const IndexStats> stats = _stats->get(ixn->indexKeyPattern);
+            if (!stats) {
+                return false;
+            }
+            out->cost = stats->estimateKeys(ixn->bounds);
+            out->results = out->cost;
+            return true;
+        }
+
+        case STAGE_FETCH:
+            out->cost = children[0].cost + children[0].results;
+            out->results = children[0].results;
+            return true;
+
+        case STAGE_AND_HASH:
+        case STAGE_AND_SORTED:
+            out->results = _numRecords;
+            for (size_t i = 0; i < children.size(); ++i) {
+                out->cost += children[i].cost;
+                out->results = std::min(out->results, children[i].results);
+            }
+            return true;
+
+        case STAGE_OR:
+        case STAGE_SORT_MERGE:
+            for (size_t i = 0; i < children.size(); ++i) {
+                out->cost += children[i].cost;
+                out->results += children[i].results;
+            }
+            out->results = std::min(out->results, _numRecords);
+            return true;
+
+        case STAGE_SORT: {
+            const SortNode* sn = static_cast<const SortNode*>(node);
+            // Every result is buffered before the first is returned.
+            out->cost = children[0].cost + children[0].results;
+            out->results = children[0].results;
+            if (sn->limit > 0) {
+                out->results = std::min(out->results, double(sn->limit));
+            }
+            return true;
+        }
+
+        case STAGE_LIMIT: {
+            const LimitNode* ln = static_cast<const LimitNode*>(node);
+            *out = children[0];
+            out->results = std::min(out->results, double(ln->limit));
+            return true;
+        }
+
+        case STAGE_SKIP:
+        case STAGE_PROJECTION:
+        case STAGE_SHARDING_FILTER:
+        case STAGE_KEEP_MUTATIONS:
+            *out = children[0];
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+}  // namespace mongo
@@ -0,0 +1,92 @@
+// plan_cost.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+
+namespace mongo {
+
+    class IndexStatsCache;
+    struct QuerySolution;
+    struct QuerySolutionNode;
+
+    /**
+     * Estimates how much work a query solution will do, from the statistics of the indexes it
+     * scans and the size of the collection, so that candidates which are clearly worse than
+     * the cheapest need not be raced against it.
+     *
+     * The cost of a plan is the number of index keys and documents it is expected to examine.
+     * Filters which are not index bounds are assumed to match everything, so estimates are
+     * pessimistic, and plans which stop early because of a limit are not credited for it.
+     */
+    class PlanCostModel {
+        MONGO_DISALLOW_COPYING(PlanCostModel);
+    public:
+        /**
+         * 'stats' must outlive the model.
+         */
+        PlanCostModel(const IndexStatsCache* stats, long long numRecords);
+
+        /**
+         * Sets '*costOut' to the estimated cost of 'soln'.  Returns false if the solution
+         * cannot be estimated, because it uses an index without statistics or a stage the
+         * model knows nothing about.
+         */
+        bool estimate(const QuerySolution& soln, double* costOut) const;
+
+        /**
+         * Deletes and removes from 'solutions' every candidate whose estimated cost exceeds
+         * that of the cheapest by more than internalQueryPlannerCostPruneRatio.  Does nothing
+         * unless every candidate can be estimated.  Returns how many were removed.
+         */
+        size_t prune(std::vector<QuerySolution*>* solutions) const;
+
+    private:
+        struct Estimate {
+            Estimate() : cost(0), results(0) { }
+
+            // Keys and documents examined.
+            double cost;
+
+            // Results produced.
+            double results;
+        };
+
+        bool _estimate(const QuerySolutionNode* node, Estimate* out) const;
+
+        const IndexStatsCache* const _stats;
+        const double _numRecords;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,150 @@
+// plan_cost_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+
+#include "mongo/db/query/plan_cost.h"
+
+#include "mongo/db/query/index_stats.h"
+#include "mongo/db/query/query_solution.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    const long long kNumRecords = 10000;
+
+    //
+    // Convenience functions
+    //
+
+    // Statistics of an index with one key each of 0 to kNumRecords - 1.
+    IndexStats* uniformStats(const BSONObj& keyPattern) {
+        IndexStats::Builder builder(keyPattern, 100);
+        for (int i = 0; i < kNumRecords; ++i) {
+            builder.addKey(BSON("" << i));
+        }
+        return builder.done();
+    }
+
+    // FETCH over an IXSCAN of [start, end] on the index 'keyPattern', which has one field.
+    QuerySolution* fetchIndex(const BSONObj& keyPattern, int start, int end) {
+        IndexScanNode* ixn = new IndexScanNode();
+        ixn->indexKeyPattern = keyPattern;
+        OrderedIntervalList oil(keyPattern.firstElementFieldName());
+        oil.intervals.push_back(Interval(BSON("" << start << "" << end), true, true));
+        ixn->bounds.fields.push_back(oil);
+
+        FetchNode* fetch = new FetchNode();
+        fetch->children.push_back(ixn);
+
+        QuerySolution* soln = new QuerySolution();
+        soln->root.reset(fetch);
+        return soln;
+    }
+
+    QuerySolution* collscan() {
+        QuerySolution* soln = new QuerySolution();
+        soln->root.reset(new CollectionScanNode());
+        return soln;
+    }
+
+    class PlanCostTest : public mongo::unittest::Test {
+    protected:
+        void setUp() {
+            _stats.set(BSON("a" << 1), uniformStats(BSON("a" << 1)));
+            _stats.set(BSON("b" << 1), uniformStats(BSON("b" << 1)));
+        }
+
+        void tearDown() {
+            for (size_t i = 0; i < _solutions.size(); ++i) {
+                delete _solutions[i];
+            }
+        }
+
+        IndexStatsCache _stats;
+        std::vector<QuerySolution*> _solutions;
+    };
+
+    TEST_F(PlanCostTest, CollectionScan) {
+        PlanCostModel model(&_stats, kNumRecords);
+        _solutions.push_back(collscan());
+        double cost;
+        ASSERT(model.estimate(*_solutions[0], &cost));
+        ASSERT_EQUALS(double(kNumRecords), cost);
+    }
+
+    TEST_F(PlanCostTest, FetchCountsKeysAndDocuments) {
+        PlanCostModel model(&_stats, kNumRecords);
+        _solutions.push_back(fetchIndex(BSON("a" << 1), 0, 999));
+        double cost;
+        ASSERT(model.estimate(*_solutions[0], &cost));
+        ASSERT_APPROX_EQUAL(2000.0, cost, 20.0);
+    }
+
+    TEST_F(PlanCostTest, IndexWithoutStatistics) {
+        PlanCostModel model(&_stats, kNumRecords);
+        _solutions.push_back(fetchIndex(BSON("c" << 1), 0, 10));
+        double cost;
+        ASSERT_FALSE(model.estimate(*_solutions[0], &cost));
+    }
+
+    TEST_F(PlanCostTest, PruneExpensiveCandidates) {
+        PlanCostModel model(&_stats, kNumRecords);
+        _solutions.push_back(fetchIndex(BSON("a" << 1), 0, 10000));
+        _solutions.push_back(fetchIndex(BSON("b" << 1), 100, 109));
+        _solutions.push_back(collscan());
+
+        ASSERT_EQUALS(2U, model.prune(&_solutions));
+        ASSERT_EQUALS(1U, _solutions.size());
+        IndexScanNode* ixn = static_cast<IndexScanNode*>(_solutions[0]->root->children[0]);
+        ASSERT_EQUALS(BSON("b" << 1), ixn->indexKeyPattern);
+    }
+
+    TEST_F(PlanCostTest, KeepSimilarCandidates) {
+        PlanCostModel model(&_stats, kNumRecords);
+        _solutions.push_back(fetchIndex(BSON("a" << 1), 0, 999));
+        _solutions.push_back(fetchIndex(BSON("b" << 1), 0, 1999));
+        _solutions.push_back(collscan());
+
+        ASSERT_EQUALS(0U, model.prune(&_solutions));
+        ASSERT_EQUALS(3U, _solutions.size());
+    }
+
+    TEST_F(PlanCostTest, NoPruningUnlessEveryCandidateIsEstimated) {
+        PlanCostModel model(&_stats, kNumRecords);
+        _solutions.push_back(fetchIndex(BSON("a" << 1), 0, 10));
+        _solutions.push_back(fetchIndex(BSON("c" << 1), 0, 10));
+        _solutions.push_back(collscan());
+
+        ASSERT_EQUALS(0U, model.prune(&_solutions));
+        ASSERT_EQUALS(3U, _solutions.size());
+    }
+
+}  // namespace
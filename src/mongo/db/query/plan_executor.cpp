@@ -28,6 +28,8 @@
 
 #include "mongo/db/query/plan_executor.h"
 
+#include <algorithm>
+
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/exec/multi_plan.h"
 #include "mongo/db/exec/pipeline_proxy.h"
@@ -37,6 +39,7 @@
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/query/plan_yield_policy.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/record_fetcher.h"
 
 #include "mongo/util/stacktrace.h"
@@ -146,7 +149,10 @@ namespace mongo {
           _qs(qs),
           _root(rt),
           _ns(ns),
-          _killed(false) {
+          _killed(false),
+          _batchPos(0),
+          _batchState(PlanStage::NEED_TIME),
+          _batchStateId(WorkingSet::INVALID_ID) {
         // We may still need to initialize _ns from either _collection or _cq.
         if (!_ns.empty()) {
             // We already have an _ns set, so there's nothing more to do.
@@ -233,6 +239,20 @@ namespace mongo {
     void PlanExecutor::saveState() {
         if (!_killed) {
             _root->saveState();
+
+            // Buffered results may point into records or index entries that are only valid
+            // while we hold our locks.
+            for (size_t i = _batchPos; i < _batch.size(); ++i) {
+                if (WorkingSet::INVALID_ID == _batch[i]) { continue; }
+
+                WorkingSetMember* member = _workingSet->get(_batch[i]);
+                if (member->hasObj()) {
+                    member->obj = member->obj.getOwned();
+                }
+                for (size_t j = 0; j < member->keyData.size(); ++j) {
+                    member->keyData[j].keyData = member->keyData[j].keyData.getOwned();
+                }
+            }
         }
 
         _opCtx = NULL;
@@ -252,7 +272,71 @@ namespace mongo {
     }
 
     void PlanExecutor::invalidate(const DiskLoc& dl, InvalidationType type) {
-        if (!_killed) { _root->invalidate(dl, type); }
+        if (_killed) { return; }
+
+        _root->invalidate(dl, type);
+
+        // A buffered result whose DiskLoc is invalidated keeps the copy of the object taken in
+        // saveState() and loses the DiskLoc.  Results that are only index keys have nothing to
+        // fall back on, so they are dropped.
+        for (size_t i = _batchPos; i < _batch.size(); ++i) {
+            if (WorkingSet::INVALID_ID == _batch[i]) { continue; }
+
+            WorkingSetMember* member = _workingSet->get(_batch[i]);
+            if (!member->hasLoc() || member->loc != dl) { continue; }
+
+            if (member->hasObj()) {
+                member->obj = member->obj.getOwned();
+                member->state = WorkingSetMember::OWNED_OBJ;
+                member->loc = DiskLoc();
+            }
+            else {
+                _workingSet->free(_batch[i]);
+                _batch.erase(_batch.begin() + i);
+                --i;
+            }
+        }
+    }
+
+    bool PlanExecutor::getResult(WorkingSetID id, BSONObj* objOut, DiskLoc* dlOut) {
+        // Fast count.
+        if (WorkingSet::INVALID_ID == id) {
+            invariant(NULL == objOut);
+            invariant(NULL == dlOut);
+            return true;
+        }
+
+        WorkingSetMember* member = _workingSet->get(id);
+        bool hasRequestedData = true;
+
+        if (NULL != objOut) {
+            if (WorkingSetMember::LOC_AND_IDX == member->state) {
+                if (1 != member->keyData.size()) {
+                    hasRequestedData = false;
+                }
+                else {
+                    *objOut = member->keyData[0].keyData;
+                }
+            }
+            else if (member->hasObj()) {
+                *objOut = member->obj;
+            }
+            else {
+                hasRequestedData = false;
+            }
+        }
+
+        if (NULL != dlOut) {
+            if (member->hasLoc()) {
+                *dlOut = member->loc;
+            }
+            else {
+                hasRequestedData = false;
+            }
+        }
+
+        _workingSet->free(id);
+        return hasRequestedData;
     }
 
     PlanExecutor::ExecState PlanExecutor::getNext(BSONObj* objOut, DiskLoc* dlOut) {
@@ -265,75 +349,57 @@ namespace mongo {
         boost::scoped_ptr<RecordFetcher> fetcher;
 
         for (;;) {
-            // There are two conditions which cause us to yield if we have an YIELD_AUTO
-            // policy:
-            //   1) The yield policy's timer elapsed, or
-            //   2) some stage requested a yield due to a document fetch (NEED_FETCH).
-            // In both cases, the actual yielding happens here.
-            if (NULL != _yieldPolicy.get() && (_yieldPolicy->shouldYield()
-                                               || NULL != fetcher.get())) {
-                // Here's where we yield.
-                _yieldPolicy->yield(fetcher.get());
-
-                // We're done using the fetcher, so it should be freed. We don't want to
-                // use the same RecordFetcher twice.
-                fetcher.reset();
-
-                if (_killed) {
-                    return PlanExecutor::DEAD;
-                }
-            }
-
-            WorkingSetID id = WorkingSet::INVALID_ID;
-            PlanStage::StageState code = _root->work(&id);
-
-            if (PlanStage::ADVANCED == code) {
-                // Fast count.
-                if (WorkingSet::INVALID_ID == id) {
-                    invariant(NULL == objOut);
-                    invariant(NULL == dlOut);
+            // Hand out what the last batch produced before doing any more work.
+            while (_batchPos < _batch.size()) {
+                if (getResult(_batch[_batchPos++], objOut, dlOut)) {
                     return PlanExecutor::ADVANCED;
                 }
+                // This result didn't have the data the caller wanted, try the next one.
+            }
 
-                WorkingSetMember* member = _workingSet->get(id);
-                bool hasRequestedData = true;
-
-                if (NULL != objOut) {
-                    if (WorkingSetMember::LOC_AND_IDX == member->state) {
-                        if (1 != member->keyData.size()) {
-                            _workingSet->free(id);
-                            hasRequestedData = false;
-                        }
-                        else {
-                            *objOut = member->keyData[0].keyData;
-                        }
-                    }
-                    else if (member->hasObj()) {
-                        *objOut = member->obj;
-                    }
-                    else {
-                        _workingSet->free(id);
-                        hasRequestedData = false;
+            if (PlanStage::ADVANCED == _batchState || PlanStage::NEED_TIME == _batchState) {
+                // Write stages write as they work, so they must not get ahead of the caller.
+                const StageType rootType = _root->stageType();
+                const size_t maxWorks = (STAGE_UPDATE == rootType || STAGE_DELETE == rootType)
+                                            ? 1
+                                            : std::max(1, internalQueryExecWorksPerBatch);
+
+                // There are two conditions which cause us to yield if we have an YIELD_AUTO
+                // policy:
+                //   1) The yield policy's timer elapsed, or
+                //   2) some stage requested a yield due to a document fetch (NEED_FETCH).
+                // In both cases, the actual yielding happens here.
+                if (NULL != _yieldPolicy.get() && (_yieldPolicy->shouldYield(maxWorks)
+                                                   || NULL != fetcher.get())) {
+                    // Here's where we yield.
+                    _yieldPolicy->yield(fetcher.get());
+
+                    // We're done using the fetcher, so it should be freed. We don't want to
+                    // use the same RecordFetcher twice.
+                    fetcher.reset();
+
+                    if (_killed) {
+                        return PlanExecutor::DEAD;
                     }
                 }
 
-                if (NULL != dlOut) {
-                    if (member->hasLoc()) {
-                        *dlOut = member->loc;
-                    }
-                    else {
-                        _workingSet->free(id);
-                        hasRequestedData = false;
-                    }
-                }
+                _batch.clear();
+                _batchPos = 0;
+                _batchStateId = WorkingSet::INVALID_ID;
 
-                if (hasRequestedData) {
-                    _workingSet->free(id);
-                    return PlanExecutor::ADVANCED;
-                }
-                // This result didn't have the data the caller wanted, try again.
+                size_t worksDone;
+                _batchState = _root->workBatch(maxWorks, &_batch, &worksDone, &_batchStateId);
+                continue;
             }
-            else if (PlanStage::NEED_FETCH == code) {
+
+            // The last batch stopped on something we have to act on, and everything it
+            // produced has been returned.
+            const PlanStage::StageState code = _batchState;
+            const WorkingSetID id = _batchStateId;
+            _batchState = PlanStage::NEED_TIME;
+            _batchStateId = WorkingSet::INVALID_ID;
+
+            if (PlanStage::NEED_FETCH == code) {
                 // Yielding on a NEED_FETCH is handled above, so there's not much to do here.
                 // Just verify that the NEED_FETCH gave us back a WSM that is actually fetchable.
                 WorkingSetMember* member = _workingSet->get(id);
@@ -341,9 +407,6 @@ namespace mongo {
                 // Transfer ownership of the fetcher. Next time around the loop a yield will happen.
                 fetcher.reset(member->releaseFetcher());
             }
-            else if (PlanStage::NEED_TIME == code) {
-                // Fall through to yield check at end of large conditional.
-            }
             else if (PlanStage::IS_EOF == code) {
                 return PlanExecutor::IS_EOF;
             }
@@ -361,7 +424,9 @@ namespace mongo {
     }
 
     bool PlanExecutor::isEOF() {
-        return _killed || _root->isEOF();
+        if (_killed) { return true; }
+        if (_batchPos < _batch.size()) { return false; }
+        return _root->isEOF();
     }
 
     void PlanExecutor::registerExec() {
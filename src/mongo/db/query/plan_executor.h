@@ -29,8 +29,10 @@
 #pragma once
 
 #include <boost/scoped_ptr.hpp>
+#include <vector>
 
 #include "mongo/base/status.h"
+#include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/invalidation_type.h"
 #include "mongo/db/query/query_solution.h"
 
@@ -246,6 +248,9 @@ namespace mongo {
          * For write operations, the return depends on the particulars of the write stage.
          *
          * If a YIELD_AUTO policy is set, then this method may yield.
+         *
+         * The plan is worked in batches (see PlanStage::workBatch()), so a call may produce
+         * several results; those not yet returned are kept and handed out by later calls.
          */
         ExecState getNext(BSONObj* objOut, DiskLoc* dlOut);
 
@@ -372,6 +377,12 @@ namespace mongo {
          */
         Status pickBestPlan(YieldPolicy policy);
 
+        /**
+         * Fills out 'objOut' and 'dlOut', as requested by the caller of getNext(), from the
+         * result 'id' and frees it.  Returns false if the result lacks the requested data.
+         */
+        bool getResult(WorkingSetID id, BSONObj* objOut, DiskLoc* dlOut);
+
         // The OperationContext that we're executing within.  We need this in order to release
         // locks.
         OperationContext* _opCtx;
@@ -398,6 +409,17 @@ namespace mongo {
         // If the yield policy is YIELD_AUTO, this is used to enforce automatic yielding. The plan
         // may yield on any call to getNext() if this is non-NULL.
         boost::scoped_ptr<PlanYieldPolicy> _yieldPolicy;
+
+        // Results from the last batch of work which getNext() has not yet returned, starting at
+        // _batch[_batchPos].  They are made owned on saveState() and checked against
+        // invalidations like the results a stage holds on to.
+        std::vector<WorkingSetID> _batch;
+        size_t _batchPos;
+
+        // How the last batch of work ended, and the WSID that came with it.  Anything but
+        // NEED_TIME or ADVANCED is acted on once the results before it have been returned.
+        PlanStage::StageState _batchState;
+        WorkingSetID _batchStateId;
     };
 
 }  // namespace mongo
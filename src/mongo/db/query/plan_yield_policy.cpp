@@ -31,20 +31,28 @@
 #include "mongo/db/query/plan_yield_policy.h"
 
 #include "mongo/db/global_environment_experiment.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_yield.h"
 #include "mongo/db/storage/record_fetcher.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
-    // Yield every 128 cycles or 10ms.  These values were inherited from v2.6, which just copied
-    // them from v2.4.
     PlanYieldPolicy::PlanYieldPolicy(PlanExecutor* exec)
-        : _elapsedTracker(128, 10),
+        : _lastCheckMicros(curTimeMicros64()),
+          _lastYieldMicros(_lastCheckMicros),
           _planYielding(exec) { }
 
-    bool PlanYieldPolicy::shouldYield() {
+    bool PlanYieldPolicy::shouldYield(int works) {
         invariant(!_planYielding->getOpCtx()->lockState()->inAWriteUnitOfWork());
-        return _elapsedTracker.intervalHasElapsed();
+
+        const long long now = curTimeMicros64();
+        if (now - _lastCheckMicros < internalQueryExecYieldPeriodMS * 1000LL) {
+            return false;
+        }
+
+        _lastCheckMicros = now;
+        return true;
     }
 
     bool PlanYieldPolicy::yield(RecordFetcher* fetcher) {
@@ -53,10 +61,10 @@ namespace mongo {
         OperationContext* opCtx = _planYielding->getOpCtx();
         invariant(opCtx);
 
-        // All YIELD_AUTO plans will get here eventually when the elapsed tracker triggers that it's
-        // time to yield. Whether or not we will actually yield (doc-level locking systems won't),
-        // we need to check if this operation has been interrupted. Throws if the interrupt flag is
-        // set.
+        // All YIELD_AUTO plans will get here eventually when their time slice has elapsed. Whether
+        // or not we will actually yield (doc-level locking systems won't, nor will we if nobody is
+        // waiting), we need to check if this operation has been interrupted. Throws if the
+        // interrupt flag is set.
         opCtx->checkForInterrupt();
 
         if (supportsDocLocking()) {
@@ -69,12 +77,24 @@ namespace mongo {
             return true;
         }
 
+        // Giving up the locks only helps if somebody is waiting for them. Otherwise keep them,
+        // and skip saving and restoring the plan, unless we need to fetch a record or have been
+        // holding them for too long.
+        Locker* locker = opCtx->lockState();
+        if (NULL == fetcher
+            && internalQueryExecYieldOnlyWhenContended
+            && !locker->hasLockWaiters()
+            && (_lastCheckMicros - _lastYieldMicros < internalQueryExecYieldMaxPeriodMS * 1000LL)) {
+            return true;
+        }
+
         _planYielding->saveState();
 
         // Release and reacquire locks.
         QueryYield::yieldAllLocks(opCtx, 1, fetcher);
 
-        _elapsedTracker.resetLastTime();
+        _lastCheckMicros = curTimeMicros64();
+        _lastYieldMicros = _lastCheckMicros;
 
         return _planYielding->restoreState(opCtx);
     }
@@ -30,7 +30,6 @@
 
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/query/plan_executor.h"
-#include "mongo/util/elapsed_tracker.h"
 
 namespace mongo {
 
@@ -44,13 +43,26 @@ namespace mongo {
          * Used by YIELD_AUTO plan executors in order to check whether it is time to yield.
          * PlanExecutors give up their locks periodically in order to be fair to other
          * threads.
+         *
+         * It is time to yield once the executor has worked for internalQueryExecYieldPeriodMS
+         * since the last yield, however many units of work that took, so that cheap index-only
+         * scans don't yield needlessly often and scans with expensive filters don't hold their
+         * locks for too long.
+         *
+         * 'works' is the number of units of work the executor is about to do before it next
+         * checks; executors that work in batches pass the batch size. It does not affect the
+         * decision, which is made on elapsed time alone.
          */
-        bool shouldYield();
+        bool shouldYield(int works = 1);
 
         /**
          * Used to cause a plan executor to give up locks and go to sleep. The PlanExecutor
          * must *not* be in saved state. Handles calls to save/restore state internally.
          *
+         * Unless yielding to fetch a record, the locks are kept (and the executor's state is
+         * not saved) if no other operation is waiting for them, up to a total of
+         * internalQueryExecYieldMaxPeriodMS; see internalQueryExecYieldOnlyWhenContended.
+         *
          * If 'fetcher' is non-NULL, then we are yielding because the storage engine told us
          * that we will page fault on this record. We use 'fetcher' to retrieve the record
          * after we give up our locks.
@@ -64,7 +76,11 @@ namespace mongo {
         // Default constructor disallowed in order to ensure initialization of '_planYielding'.
         PlanYieldPolicy();
 
-        ElapsedTracker _elapsedTracker;
+        // When shouldYield() last returned true, in micros.
+        long long _lastCheckMicros;
+
+        // When the locks were last given up, in micros.
+        long long _lastYieldMicros;
 
         // The plan executor which this yield policy is responsible for yielding. Must
         // not outlive the plan executor.
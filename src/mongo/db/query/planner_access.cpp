@@ -56,6 +56,20 @@ namespace {
         return STAGE_TEXT == node->getType();
     }
 
+    /**
+     * Could the key field in position 'pos' of 'index' have been extracted from an array?
+     */
+    bool isMultikeyPosition(const IndexEntry& index, size_t pos) {
+        if (!index.multikey) {
+            return false;
+        }
+        BSONObjIterator it(index.keyPattern);
+        for (size_t i = 0; i < pos && it.more(); ++i) {
+            it.next();
+        }
+        return !it.more() || index.isMultikeyPath(it.next().fieldName());
+    }
+
 } // namespace
 
 namespace mongo {
@@ -78,6 +92,7 @@ namespace mongo {
             BSONElement natural = query.getParsed().getHint().getFieldDotted("$natural");
             if (!natural.eoo()) {
                 csn->direction = natural.numberInt() >= 0 ? 1 : -1;
+                csn->naturalOrder = true;
             }
         }
 
@@ -88,6 +103,7 @@ namespace mongo {
             BSONElement natural = sortObj.getFieldDotted("$natural");
             if (!natural.eoo()) {
                 csn->direction = natural.numberInt() >= 0 ? 1 : -1;
+                csn->naturalOrder = true;
             }
         }
 
@@ -158,6 +174,7 @@ namespace mongo {
             IndexScanNode* isn = new IndexScanNode();
             isn->indexKeyPattern = index.keyPattern;
             isn->indexIsMultiKey = index.multikey;
+            isn->multikeyPaths = index.multikeyPaths;
             isn->bounds.fields.resize(index.keyPattern.nFields());
             isn->maxScan = query.getParsed().getMaxScan();
             isn->addKeyMetadata = query.getParsed().returnKey();
@@ -1093,7 +1110,7 @@ namespace mongo {
                     return soln;
                 }
                 else if (tightness == IndexBoundsBuilder::INEXACT_COVERED
-                         && !indices[tag->index].multikey) {
+                         && !isMultikeyPosition(indices[tag->index], tag->pos)) {
                     verify(NULL == soln->filter.get());
                     soln->filter.reset(autoRoot.release());
                     return soln;
@@ -1176,6 +1193,7 @@ namespace mongo {
         IndexScanNode* isn = new IndexScanNode();
         isn->indexKeyPattern = index.keyPattern;
         isn->indexIsMultiKey = index.multikey;
+        isn->multikeyPaths = index.multikeyPaths;
         isn->maxScan = query.getParsed().getMaxScan();
         isn->addKeyMetadata = query.getParsed().returnKey();
 
@@ -1205,6 +1223,106 @@ namespace mongo {
         return solnRoot;
     }
 
+    // static
+    QuerySolutionNode* QueryPlannerAccess::makeSkipScan(const IndexEntry& index,
+                                                        const CanonicalQuery& query,
+                                                        const QueryPlannerParams& params) {
+        // Documents missing from a sparse index might match.
+        if (INDEX_BTREE != index.type || index.sparse) {
+            return NULL;
+        }
+
+        // Only the comparisons directly below the root bound the scan.  Everything, including
+        // them, is checked again after the fetch.
+        vector<const MatchExpression*> leaves;
+        const MatchExpression* root = query.root();
+        if (MatchExpression::AND == root->matchType()) {
+            for (size_t i = 0; i < root->numChildren(); ++i) {
+                leaves.push_back(root->getChild(i));
+            }
+        }
+        else {
+            leaves.push_back(root);
+        }
+
+        auto_ptr<IndexScanNode> isn(new IndexScanNode());
+        isn->indexKeyPattern = index.keyPattern;
+        isn->indexIsMultiKey = index.multikey;
+        isn->multikeyPaths = index.multikeyPaths;
+        isn->maxScan = query.getParsed().getMaxScan();
+        isn->addKeyMetadata = query.getParsed().returnKey();
+        isn->bounds.fields.resize(index.keyPattern.nFields());
+
+        // The first path component of each bounded field.  A multikey index can't compound the
+        // bounds of fields inside the same array, or intersect the bounds on a field.
+        vector<StringData> boundedPrefixes;
+        bool anyBounded = false;
+
+        BSONObjIterator it(index.keyPattern);
+        for (size_t pos = 0; it.more(); ++pos) {
+            BSONElement keyElt = it.next();
+            StringData field = keyElt.fieldNameStringData();
+            StringData prefix = field.substr(0, field.find('.'));
+            OrderedIntervalList* oil = &isn->bounds.fields[pos];
+
+            bool bounded = false;
+            if (!index.multikey || boundedPrefixes.end() == std::find(boundedPrefixes.begin(),
+                                                                      boundedPrefixes.end(),
+                                                                      prefix)) {
+                for (size_t i = 0; i < leaves.size(); ++i) {
+                    const MatchExpression* leaf = leaves[i];
+                    switch (leaf->matchType()) {
+                    case MatchExpression::EQ:
+                    case MatchExpression::LT:
+                    case MatchExpression::LTE:
+                    case MatchExpression::GT:
+                    case MatchExpression::GTE:
+                    case MatchExpression::MATCH_IN:
+                        break;
+                    default:
+                        continue;
+                    }
+                    if (leaf->path() != field) {
+                        continue;
+                    }
+
+                    IndexBoundsBuilder::BoundsTightness tightness;
+                    if (!bounded) {
+                        IndexBoundsBuilder::translate(leaf, keyElt, index, oil, &tightness);
+                        bounded = true;
+                    }
+                    else if (!index.multikey) {
+                        IndexBoundsBuilder::translateAndIntersect(leaf, keyElt, index, oil,
+                                                                  &tightness);
+                    }
+                }
+            }
+
+            if (!bounded) {
+                IndexBoundsBuilder::allValuesForField(keyElt, oil);
+            }
+            else if (0 == pos) {
+                // The index can be used without skipping.
+                return NULL;
+            }
+            else {
+                boundedPrefixes.push_back(prefix);
+                anyBounded = true;
+            }
+        }
+
+        if (!anyBounded) {
+            return NULL;
+        }
+
+        IndexBoundsBuilder::alignBounds(&isn->bounds, index.keyPattern);
+
+        FetchNode* fetch = new FetchNode();
+        fetch->filter.reset(root->shallowClone());
+        fetch->children.push_back(isn.release());
+        return fetch;
+    }
+
     // static
     void QueryPlannerAccess::addFilterToSolutionNode(QuerySolutionNode* node,
                                                      MatchExpression* match,
@@ -1294,7 +1412,8 @@ namespace mongo {
             delete child;
         }
         else if (scanState->tightness == IndexBoundsBuilder::INEXACT_COVERED
-                 && (INDEX_TEXT == index.type || !index.multikey)) {
+                 && (INDEX_TEXT == index.type
+                     || !isMultikeyPosition(index, scanState->ixtag->pos))) {
             // The bounds are not exact, but the information needed to
             // evaluate the predicate is in the index key. Remove the
             // MatchExpression from its parent and attach it to the filter
@@ -1305,7 +1424,7 @@ namespace mongo {
             // {x: ["a", "b"]}. Now if we query for {x: /b/} the filter might
             // ever only be applied to the index key "a". We'd incorrectly
             // conclude that the document does not match the query :( so we
-            // gotta stick to non-multikey indices.
+            // gotta stick to fields along which the index is not multikey.
             root->getChildVector()->erase(root->getChildVector()->begin() + scanState->curChild);
 
             addFilterToSolutionNode(scanState->currentScan.get(), child, root->matchType());
@@ -1327,6 +1446,7 @@ namespace mongo {
         IndexScanNode* isn = new IndexScanNode();
         isn->indexKeyPattern = index.keyPattern;
         isn->indexIsMultiKey = index.multikey;
+        isn->multikeyPaths = index.multikeyPaths;
         isn->direction = 1;
         isn->maxScan = query.getParsed().getMaxScan();
         isn->addKeyMetadata = query.getParsed().returnKey();
@@ -203,6 +203,16 @@ namespace mongo {
                                                  const QueryPlannerParams& params,
                                                  int direction = 1);
 
+        /**
+         * Return a plan that skip scans the provided index: the query doesn't constrain its
+         * leading field but does constrain some later field, so the scan jumps from each
+         * distinct value of the leading fields to the keys within the later fields' bounds.
+         * Returns NULL if the index can't be skip scanned for the query.
+         */
+        static QuerySolutionNode* makeSkipScan(const IndexEntry& index,
+                                               const CanonicalQuery& query,
+                                               const QueryPlannerParams& params);
+
         /**
          * Return a plan that scans the provided index from [startKey to endKey).
          */
@@ -202,6 +202,7 @@ namespace mongo {
                 child->maxScan = isn->maxScan;
                 child->addKeyMetadata = isn->addKeyMetadata;
                 child->indexIsMultiKey = isn->indexIsMultiKey;
+                child->multikeyPaths = isn->multikeyPaths;
 
                 // Copy the filter, if there is one.
                 if (isn->filter.get()) {
@@ -251,6 +252,19 @@ namespace mongo {
             return false;
         }
 
+        /**
+         * Lets each hashed AND in the tree rooted at 'root' finish its intersection on disk.
+         */
+        void allowAndHashDiskUse(QuerySolutionNode* root) {
+            if (STAGE_AND_HASH == root->getType()) {
+                static_cast<AndHashNode*>(root)->allowDiskUse = true;
+            }
+
+            for (size_t i = 0; i < root->children.size(); ++i) {
+                allowAndHashDiskUse(root->children[i]);
+            }
+        }
+
     }  // namespace
 
     // static
@@ -458,6 +472,7 @@ namespace mongo {
         SortNode* sort = new SortNode();
         sort->pattern = sortObj;
         sort->query = query.getParsed().getFilter();
+        sort->allowDiskUse = query.getParsed().allowDiskUse();
         sort->children.push_back(solnRoot);
         solnRoot = sort;
         // When setting the limit on the sort, we need to consider both
@@ -512,6 +527,15 @@ namespace mongo {
             sort->limit = 0;
         }
 
+        // A text stage sorted by its score under a limit only has to produce the best
+        // 'limit' documents, and can stop reading postings once no other document could beat
+        // them.
+        if (0 != sort->limit && STAGE_TEXT == sort->children[0]->getType()
+            && 1 == sortObj.nFields()
+            && LiteParsedQuery::isTextScoreMeta(sortObj.firstElement())) {
+            static_cast<TextNode*>(sort->children[0])->topK = sort->limit;
+        }
+
         *blockingSortOut = true;
 
         return solnRoot;
@@ -572,6 +596,14 @@ namespace mongo {
         bool hasAndHashStage = hasNode(solnRoot, STAGE_AND_HASH);
         soln->hasBlockingStage = hasSortStage || hasAndHashStage;
 
+        // A hashed AND which goes to disk outputs its results in DiskLoc order, rather than
+        // in the order of its last child, so it may only do so if that order can't be
+        // providing the sort.
+        if (hasAndHashStage && query.getParsed().allowDiskUse()
+            && (query.getParsed().getSort().isEmpty() || hasSortStage)) {
+            allowAndHashDiskUse(solnRoot);
+        }
+
         // If we can (and should), add the keep mutations stage.
 
         // We cannot keep mutated documents if:
@@ -34,6 +34,7 @@
 
 #include "mongo/db/geo/hash.h"
 #include "mongo/db/index_names.h"
+#include "mongo/db/matcher/expression_algo.h"
 #include "mongo/db/matcher/expression_array.h"
 #include "mongo/db/matcher/expression_geo.h"
 #include "mongo/db/matcher/expression_text.h"
@@ -122,6 +123,12 @@ namespace mongo {
         }
     }
 
+    // static
+    bool QueryPlannerIXSelect::partialIndexUsable(const IndexEntry& index,
+                                                  const MatchExpression* root) {
+        return NULL == index.filterExpr || expression::isSubsetOf(root, index.filterExpr);
+    }
+
     // static
     bool QueryPlannerIXSelect::compatible(const BSONElement& elt,
                                           const IndexEntry& index,
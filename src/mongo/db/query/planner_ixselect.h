@@ -56,6 +56,12 @@ namespace mongo {
                                         const std::vector<IndexEntry>& indices,
                                         std::vector<IndexEntry>* out);
 
+        /**
+         * Return false if 'index' is a partial index whose filter expression the query 'root'
+         * isn't known to imply.  Such an index may be missing documents the query matches.
+         */
+        static bool partialIndexUsable(const IndexEntry& index, const MatchExpression* root);
+
         /**
          * Return true if the index key pattern field 'elt' (which belongs to 'index') can be used
          * to answer the predicate 'node'.
@@ -46,6 +46,16 @@ namespace mongo {
 
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheWriteOpsBetweenFlush, int, 1000);
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheParameterizeSolutions, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryCachePersistIntervalSecs, int, 0);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryCachePersistExpireSecs, int, 7 * 24 * 60 * 60);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryIdLookupCacheSize, int, 0);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryShapeStatsSize, int, 1000);
+
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerMaxIndexedSolutions, int, 64);
 
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryEnumerationMaxOrSolutions, int, 10);
@@ -62,4 +72,44 @@ namespace mongo {
 
     MONGO_EXPORT_SERVER_PARAMETER(internalQueryMaxScansToExplode, int, 200);
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerEnableSkipScan, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerCostBasedPruning, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerCostPruneRatio, double, 10.0);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryIndexStatsStaleWriteRatio, double, 0.2);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecCompileFilters, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecCollScanReadAheadDocs, int, 100);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecWorksPerBatch, int, 64);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecMaxBlockingSortBytes, int, 32 * 1024 * 1024);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecAndHashBloomFilter, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecFetchBatchSize, int, 0);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecBatchedIdHackBatchSize, int, 100);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecReadAheadBytes, int, 4 * 1024 * 1024);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecStageTiming, bool, false);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecYieldPeriodMS, int, 10);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecYieldOnlyWhenContended, bool, true);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecYieldMaxPeriodMS, int, 1000);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecParallelCollScanThreads, int, 1);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecParallelCollScanMinRecords, int, 100000);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecParallelIndexScanThreads, int, 1);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryTextNegatedTermsFromIndex, bool, true);
+
 }  // namespace mongo
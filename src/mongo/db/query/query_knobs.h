@@ -72,6 +72,24 @@ namespace mongo {
     // How many write ops should we allow in a collection before tossing all cache entries?
     extern int internalQueryCacheWriteOpsBetweenFlush;
 
+    // Are winning solutions cached with their constants taken out where possible, so that the
+    // solution for a query of the same shape is made without planning?
+    extern bool internalQueryCacheParameterizeSolutions;
+
+    // How often, in seconds, are plan cache entries saved to admin.system.plancache, from which
+    // the caches are warmed at startup and on becoming primary?  0 disables both.
+    extern int internalQueryCachePersistIntervalSecs;
+
+    // How long, in seconds, is a saved plan cache entry kept after it was last saved?
+    extern int internalQueryCachePersistExpireSecs;
+
+    // For how many _id values does each collection remember the DiskLoc of the document, so
+    // that an _id lookup can skip the _id index?  0 disables the cache.
+    extern int internalQueryIdLookupCacheSize;
+
+    // For how many query shapes does each collection keep execution statistics?
+    extern int internalQueryShapeStatsSize;
+
     //
     // Planning and enumeration.
     //
@@ -92,4 +110,89 @@ namespace mongo {
     // during explodeForSort?
     extern int internalQueryMaxScansToExplode;
 
+    // Is an index whose leading field the query doesn't constrain skip scanned, jumping between
+    // the distinct values of the leading field, when no index can be used otherwise?
+    extern bool internalQueryPlannerEnableSkipScan;
+
+    //
+    // Cost-based planning.
+    //
+
+    // May candidate plans be discarded before they are raced, because index statistics (see
+    // the analyze command) estimate them to be much more expensive than the cheapest one?
+    extern bool internalQueryPlannerCostBasedPruning;
+
+    // A candidate whose estimated cost exceeds that of the cheapest by this factor is
+    // discarded.  If only the cheapest is left, it is run without a trial.
+    extern double internalQueryPlannerCostPruneRatio;
+
+    // Statistics of an index are ignored once this many writes per key in the index have
+    // been made to the collection since it was analyzed.
+    extern double internalQueryIndexStatsStaleWriteRatio;
+
+    //
+    // Query execution.
+    //
+
+    // Do collection scans and fetches lower their filters into a CompiledMatcher?
+    extern bool internalQueryExecCompileFilters;
+
+    // After how many documents does a collection scan hint to the storage engine that it is
+    // reading the collection sequentially, so that records are read ahead of it?  Waiting keeps
+    // short scans, such as a findOne, from reading more than they need.  0 never hints.
+    extern int internalQueryExecCollScanReadAheadDocs;
+
+    // How many units of work does a PlanExecutor ask of its plan in one go?  Results produced
+    // ahead of the caller are buffered in the executor.
+    extern int internalQueryExecWorksPerBatch;
+
+    // How many bytes may a sort stage buffer?  Beyond this a sort fails, unless the query
+    // allows it to use disk, in which case it sorts externally.
+    extern int internalQueryExecMaxBlockingSortBytes;
+
+    // Once a hashed AND has read its first child, does it give the index scans of its other
+    // children a Bloom filter of the DiskLocs found, so they skip keys which can't intersect?
+    extern bool internalQueryExecAndHashBloomFilter;
+
+    // How many of its child's results does a fetch buffer, so it can prefetch their documents in
+    // DiskLoc order before returning them in the child's order?  0 fetches one at a time.
+    extern int internalQueryExecFetchBatchSize;
+
+    // How many of the _id values of a query {_id: {$in: [...]}} are looked up at a time, so
+    // their documents can be prefetched in DiskLoc order?  0 plans such a query like any other.
+    extern int internalQueryExecBatchedIdHackBatchSize;
+
+    // How many bytes of results may a cursor which reads ahead compute before its next getMore?
+    extern int internalQueryExecReadAheadBytes;
+
+    // Does each stage time its work with the cycle counter and the thread's CPU clock, for
+    // explain and the profiler?  This costs a clock system call per work() on most platforms.
+    extern bool internalQueryExecStageTiming;
+
+    // For how many milliseconds does a yielding PlanExecutor work between yields?
+    extern int internalQueryExecYieldPeriodMS;
+
+    // Does a PlanExecutor keep its locks when it is time to yield but no other operation is
+    // waiting for them?
+    extern bool internalQueryExecYieldOnlyWhenContended;
+
+    // For how many milliseconds at most does a PlanExecutor keep its locks when it skips yields
+    // because nobody is waiting?
+    extern int internalQueryExecYieldMaxPeriodMS;
+
+    // How many threads may a forward collection scan use to read and filter records?  1 or
+    // less disables parallel collection scans.
+    extern int internalQueryExecParallelCollScanThreads;
+
+    // Collections with fewer records than this are always scanned on one thread.
+    extern int internalQueryExecParallelCollScanMinRecords;
+
+    // Into how many ranges, each scanned on its own thread, may an index scan over a wide
+    // numeric or date range be split?  1 or less disables parallel index scans.
+    extern int internalQueryExecParallelIndexScanThreads;
+
+    // Does a text stage rule out documents with negated terms from the terms' index keys rather
+    // than by tokenizing each candidate document?
+    extern bool internalQueryTextNegatedTermsFromIndex;
+
 }  // namespace mongo
@@ -38,12 +38,14 @@
 #include "mongo/db/matcher/expression_geo.h"
 #include "mongo/db/matcher/expression_text.h"
 #include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/parameterized_solution.h"
 #include "mongo/db/query/plan_cache.h"
 #include "mongo/db/query/planner_access.h"
 #include "mongo/db/query/planner_analysis.h"
 #include "mongo/db/query/planner_ixselect.h"
 #include "mongo/db/query/plan_enumerator.h"
 #include "mongo/db/query/qlog.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner_common.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/util/log.h"
@@ -103,6 +105,45 @@ namespace mongo {
         return ss;
     }
 
+    /**
+     * If 'params' has partial indexes which can't answer 'query', fills 'eligible' with a copy
+     * of 'params' without them and returns true.
+     */
+    static bool excludeUnusablePartialIndexes(const CanonicalQuery& query,
+                                              const QueryPlannerParams& params,
+                                              QueryPlannerParams* eligible) {
+        size_t i = 0;
+        while (i < params.indices.size()
+               && QueryPlannerIXSelect::partialIndexUsable(params.indices[i], query.root())) {
+            ++i;
+        }
+        if (i == params.indices.size()) {
+            return false;
+        }
+
+        *eligible = params;
+        eligible->indices.clear();
+        for (size_t j = 0; j < params.indices.size(); ++j) {
+            if (QueryPlannerIXSelect::partialIndexUsable(params.indices[j], query.root())) {
+                eligible->indices.push_back(params.indices[j]);
+            }
+            else {
+                QLOG() << "Partial index " << params.indices[j].toString()
+                       << " is not usable for the query" << endl;
+            }
+        }
+        return true;
+    }
+
+    static bool hasIndex(const QueryPlannerParams& params, const BSONObj& keyPattern) {
+        for (size_t i = 0; i < params.indices.size(); ++i) {
+            if (0 == params.indices[i].keyPattern.woCompare(keyPattern)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     static BSONObj getKeyFromQuery(const BSONObj& keyPattern, const BSONObj& query) {
         return query.extractFieldsUnDotted(keyPattern);
     }
@@ -231,6 +272,16 @@ namespace mongo {
         return QueryPlannerAnalysis::analyzeDataAccess(query, params, solnRoot);
     }
 
+    QuerySolution* buildSkipScanSoln(const IndexEntry& index,
+                                     const CanonicalQuery& query,
+                                     const QueryPlannerParams& params) {
+        QuerySolutionNode* solnRoot = QueryPlannerAccess::makeSkipScan(index, query, params);
+        if (NULL == solnRoot) {
+            return NULL;
+        }
+        return QueryPlannerAnalysis::analyzeDataAccess(query, params, solnRoot);
+    }
+
     bool providesSort(const CanonicalQuery& query, const BSONObj& kp) {
         return query.getParsed().getSort().isPrefixOf(kp);
     }
@@ -338,6 +389,13 @@ namespace mongo {
                                        const QueryPlannerParams& params,
                                        const SolutionCacheData& cacheData,
                                        QuerySolution** out) {
+        if ((SolutionCacheData::WHOLE_IXSCAN_SOLN == cacheData.solnType
+             || SolutionCacheData::SKIP_IXSCAN_SOLN == cacheData.solnType)
+            && !hasIndex(params, cacheData.tree->entry->keyPattern)) {
+            // E.g. a partial index this query can't use.
+            return Status(ErrorCodes::BadValue, "plan cache error: index not available");
+        }
+
         if (SolutionCacheData::WHOLE_IXSCAN_SOLN == cacheData.solnType) {
             // The solution can be constructed by a scan over the entire index.
             QuerySolution* soln = buildWholeIXSoln(*cacheData.tree->entry,
@@ -353,6 +411,16 @@ namespace mongo {
                 return Status::OK();
             }
         }
+        else if (SolutionCacheData::SKIP_IXSCAN_SOLN == cacheData.solnType) {
+            QuerySolution* soln = buildSkipScanSoln(*cacheData.tree->entry, query, params);
+            if (soln == NULL) {
+                return Status(ErrorCodes::BadValue, "plan cache error: skip index scan soln");
+            }
+            else {
+                *out = soln;
+                return Status::OK();
+            }
+        }
         else if (SolutionCacheData::COLLSCAN_SOLN == cacheData.solnType) {
             // The cached solution is a collection scan. We don't cache collscans
             // with tailable==true, hence the false below.
@@ -427,10 +495,27 @@ namespace mongo {
         verify(backupOut);
         verify(PlanCache::shouldCacheQuery(query));
 
+        // The cached solution may be for a query of the same shape which could use an index
+        // this one can't.
+        QueryPlannerParams eligibleParams;
+        if (excludeUnusablePartialIndexes(query, params, &eligibleParams)) {
+            return planFromCache(query, eligibleParams, cachedSoln, out, backupOut);
+        }
+
         // If there is no backup solution, then return NULL through
         // the 'backupOut' out-parameter.
         *backupOut = NULL;
 
+        // A parameterized solution only needs the constants of this query filled in.  It never
+        // has a blocking stage, so there is no backup solution either.
+        if (cachedSoln.parameterized) {
+            QuerySolution* soln = cachedSoln.parameterized->bind(query, params);
+            if (NULL != soln) {
+                *out = soln;
+                return Status::OK();
+            }
+        }
+
         // Queries not suitable for caching are filtered
         // in multi plan runner using PlanCache::shouldCacheQuery().
 
@@ -468,6 +553,13 @@ namespace mongo {
             QLOG() << "Index " << i << " is " << params.indices[i].toString() << endl;
         }
 
+        // A partial index only holds the documents matching its filter, so a query which
+        // doesn't imply that filter is planned as if the index weren't there.
+        QueryPlannerParams eligibleParams;
+        if (excludeUnusablePartialIndexes(query, params, &eligibleParams)) {
+            return plan(query, eligibleParams, out);
+        }
+
         bool canTableScan = !(params.options & QueryPlannerParams::NO_TABLE_SCAN);
 
         // If the query requests a tailable cursor, the only solution is a collscan + filter with
@@ -795,6 +887,36 @@ namespace mongo {
 
         QLOG() << "Planner: outputted " << out->size() << " indexed solutions.\n";
 
+        // No index has its leading field constrained by the query.  An index with a later
+        // field constrained can still be used by skipping between the distinct values of the
+        // fields before it.  If an index was hinted, only it is considered.
+        if (0 == out->size() && internalQueryPlannerEnableSkipScan
+            && NULL == gnNode && NULL == textNode) {
+            for (size_t i = 0; i < params.indices.size(); ++i) {
+                if (out->size() >= params.maxIndexedSolutions) {
+                    break;
+                }
+                if (!hintIndex.isEmpty() && i != hintIndexNumber) {
+                    continue;
+                }
+
+                QuerySolution* soln = buildSkipScanSoln(params.indices[i], query, params);
+                if (NULL == soln) {
+                    continue;
+                }
+
+                PlanCacheIndexTree* indexTree = new PlanCacheIndexTree();
+                indexTree->setIndexEntry(params.indices[i]);
+                SolutionCacheData* scd = new SolutionCacheData();
+                scd->tree.reset(indexTree);
+                scd->solnType = SolutionCacheData::SKIP_IXSCAN_SOLN;
+                soln->cacheData.reset(scd);
+
+                QLOG() << "Planner: outputting skip scan soln:" << endl << soln->toString();
+                out->push_back(soln);
+            }
+        }
+
         // Produce legible error message for failed OR planning with a TEXT child.
         // TODO: support collection scan for non-TEXT children of OR.
         if (out->size() == 0 && textNode != NULL &&
@@ -34,7 +34,9 @@
 
 #include "mongo/db/query/query_planner_test_lib.h"
 
+#include <list>
 #include <ostream>
+#include "mongo/base/owned_pointer_vector.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/json.h"
 #include "mongo/db/matcher/expression_parser.h"
@@ -94,6 +96,18 @@ namespace {
             params.indices.push_back(IndexEntry(keyPattern, false, false, "foo", infoObj));
         }
 
+        // The parsed filter refers into filterObj, so the test keeps both around.
+        void addPartialIndex(BSONObj keyPattern, BSONObj filterObj) {
+            filterObjs.push_back(filterObj.getOwned());
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filterObjs.back());
+            ASSERT_OK(swme.getStatus());
+            filterExprs.mutableVector().push_back(swme.getValue());
+
+            BSONObj infoObj = BSON("partialFilterExpression" << filterObjs.back());
+            params.indices.push_back(IndexEntry(keyPattern, false, false, "partial", infoObj));
+            params.indices.back().filterExpr = swme.getValue();
+        }
+
         //
         // Execute planner.
         //
@@ -327,6 +341,8 @@ namespace {
         CanonicalQuery* cq;
         QueryPlannerParams params;
         vector<QuerySolution*> solns;
+        std::list<BSONObj> filterObjs;
+        OwnedPointerVector<MatchExpression> filterExprs;
     };
 
     //
@@ -1074,6 +1090,82 @@ namespace {
                                 "node: {ixscan: {filter: null, pattern: {'a.b': 1}}}}}");
     }
 
+    //
+    // Multikey paths
+    //
+
+    TEST_F(QueryPlannerTest, CoveredByNonMultikeyPathOfMultikeyIndex) {
+        // true means multikey
+        addIndex(BSON("a" << 1 << "b" << 1), true);
+        params.indices.back().multikeyPaths.insert("a");
+        runQuerySortProj(fromjson("{a: 5}"), BSONObj(), fromjson("{_id: 0, b: 1}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{proj: {spec: {_id: 0, b: 1}, node: {cscan: {dir: 1}}}}");
+        assertSolutionExists("{proj: {spec: {_id: 0, b: 1}, node: "
+                                "{ixscan: {filter: null, pattern: {a: 1, b: 1}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, NotCoveredByMultikeyPath) {
+        // true means multikey
+        addIndex(BSON("a" << 1 << "b" << 1), true);
+        params.indices.back().multikeyPaths.insert("b");
+        runQuerySortProj(fromjson("{a: 5}"), BSONObj(), fromjson("{_id: 0, b: 1}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{proj: {spec: {_id: 0, b: 1}, node: {cscan: {dir: 1}}}}");
+        assertSolutionExists("{proj: {spec: {_id: 0, b: 1}, node: {fetch: {filter: null, node: "
+                                "{ixscan: {filter: null, pattern: {a: 1, b: 1}}}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, NotCoveredByUnknownMultikeyPaths) {
+        // true means multikey
+        addIndex(BSON("a" << 1 << "b" << 1), true);
+        runQuerySortProj(fromjson("{a: 5}"), BSONObj(), fromjson("{_id: 0, b: 1}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{proj: {spec: {_id: 0, b: 1}, node: {cscan: {dir: 1}}}}");
+        assertSolutionExists("{proj: {spec: {_id: 0, b: 1}, node: {fetch: {filter: null, node: "
+                                "{ixscan: {filter: null, pattern: {a: 1, b: 1}}}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, InexactCoveredOnNonMultikeyPath) {
+        // true means multikey
+        addIndex(BSON("a" << 1 << "b" << 1), true);
+        params.indices.back().multikeyPaths.insert("a");
+        runQuery(fromjson("{a: 5, b: /foo/}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {filter: null, node: {ixscan: "
+                                "{filter: {b: /foo/}, pattern: {a: 1, b: 1}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, InexactCoveredOnMultikeyPath) {
+        // true means multikey
+        addIndex(BSON("a" << 1 << "b" << 1), true);
+        params.indices.back().multikeyPaths.insert("b");
+        runQuery(fromjson("{a: 5, b: /foo/}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {filter: {b: /foo/}, node: {ixscan: "
+                                "{filter: null, pattern: {a: 1, b: 1}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SingleInexactCoveredOnNonMultikeyPath) {
+        // true means multikey
+        addIndex(BSON("a" << 1 << "b" << 1), true);
+        params.indices.back().multikeyPaths.insert("b");
+        runQuerySortProj(fromjson("{a: /foo/}"), BSONObj(), fromjson("{_id: 0, a: 1}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: "
+                                "{cscan: {dir: 1, filter: {a: /foo/}}}}}");
+        assertSolutionExists("{proj: {spec: {_id: 0, a: 1}, node: {ixscan: "
+                                "{filter: {a: /foo/}, pattern: {a: 1, b: 1}}}}}");
+    }
+
     // SERVER-13960: $in with exact and inexact covered predicates.
     TEST_F(QueryPlannerTest, OrWithExactAndInexact) {
         addIndex(BSON("name" << 1));
@@ -1598,11 +1690,75 @@ namespace {
     }
 
     TEST_F(QueryPlannerTest, CantUseCompound) {
+        bool oldEnableSkipScan = internalQueryPlannerEnableSkipScan;
+        internalQueryPlannerEnableSkipScan = false;
+
         addIndex(BSON("x" << 1 << "y" << 1));
         runQuery(fromjson("{ y: 10}"));
 
         ASSERT_EQUALS(getNumSolutions(), 1U);
         assertSolutionExists("{cscan: {dir: 1, filter: {y: 10}}}");
+
+        internalQueryPlannerEnableSkipScan = oldEnableSkipScan;
+    }
+
+    //
+    // Skip scans
+    //
+
+    TEST_F(QueryPlannerTest, SkipScanCompound) {
+        addIndex(BSON("x" << 1 << "y" << 1));
+        runQuery(fromjson("{y: 10}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1, filter: {y: 10}}}");
+        assertSolutionExists("{fetch: {filter: {y: 10}, node: {ixscan: {pattern: {x: 1, y: 1}, "
+                                "bounds: {x: [['MinKey','MaxKey',true,true]], "
+                                         "y: [[10,10,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanRangeAndIn) {
+        addIndex(BSON("x" << 1 << "y" << 1 << "z" << 1));
+        runQuery(fromjson("{y: {$gt: 5, $lt: 10}, z: {$in: [1, 2]}}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {node: {ixscan: {pattern: {x: 1, y: 1, z: 1}, "
+                                "bounds: {x: [['MinKey','MaxKey',true,true]], "
+                                         "y: [[5,10,false,false]], "
+                                         "z: [[1,1,true,true],[2,2,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanHintedIndex) {
+        addIndex(BSON("x" << 1 << "y" << 1));
+        runQueryHint(fromjson("{y: 10}"), BSON("x" << 1 << "y" << 1));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{fetch: {filter: {y: 10}, node: {ixscan: {pattern: {x: 1, y: 1}, "
+                                "bounds: {x: [['MinKey','MaxKey',true,true]], "
+                                         "y: [[10,10,true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, SkipScanMultikeySharedPrefix) {
+        // true means multikey
+        addIndex(BSON("x" << 1 << "a.b" << 1 << "a.c" << 1), true);
+        runQuery(fromjson("{'a.b': 1, 'a.c': 2}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {filter: {'a.b': 1, 'a.c': 2}, node: {ixscan: "
+                                "{pattern: {x: 1, 'a.b': 1, 'a.c': 1}, "
+                                "bounds: {x: [['MinKey','MaxKey',true,true]], "
+                                         "'a.b': [[1,1,true,true]], "
+                                         "'a.c': [['MinKey','MaxKey',true,true]]}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, NoSkipScanOnSparseIndex) {
+        addIndex(BSON("x" << 1 << "y" << 1), false, true);
+        runQuery(fromjson("{y: 10}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1, filter: {y: 10}}}");
     }
 
     //
@@ -3056,6 +3212,59 @@ namespace {
                                 "{filter: null, pattern: {a: 1}}}}}");
     }
 
+    //
+    // Partial indices
+    //
+
+    TEST_F(QueryPlannerTest, PartialIndexUsedWhenQueryImpliesFilter) {
+        addPartialIndex(fromjson("{status: 1, updatedAt: 1}"), fromjson("{status: 'pending'}"));
+        runQuery(fromjson("{status: 'pending', updatedAt: {$gt: 5}}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {filter: null, node: {ixscan: "
+                                "{filter: null, pattern: {status: 1, updatedAt: 1}}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, PartialIndexNotUsedForOtherValue) {
+        addPartialIndex(fromjson("{status: 1, updatedAt: 1}"), fromjson("{status: 'pending'}"));
+        runQuery(fromjson("{status: 'done'}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+    }
+
+    TEST_F(QueryPlannerTest, PartialIndexNotUsedWithoutFilterField) {
+        addPartialIndex(fromjson("{updatedAt: 1}"), fromjson("{status: 'pending'}"));
+        runQuery(fromjson("{updatedAt: {$gt: 5}}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+    }
+
+    TEST_F(QueryPlannerTest, PartialIndexRangeFilter) {
+        addPartialIndex(fromjson("{a: 1}"), fromjson("{b: {$gt: 10}}"));
+        runQuery(fromjson("{a: 1, b: {$gte: 20}}"));
+
+        assertNumSolutions(2U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+        assertSolutionExists("{fetch: {filter: {b: {$gte: 20}}, node: {ixscan: "
+                                "{filter: null, pattern: {a: 1}}}}}");
+
+        // Not every document with b >= 5 is in the index.
+        runQuery(fromjson("{a: 1, b: {$gte: 5}}"));
+        assertNumSolutions(1U);
+        assertSolutionExists("{cscan: {dir: 1}}");
+    }
+
+    TEST_F(QueryPlannerTest, PartialIndexNotUsedForSortWithoutFilter) {
+        addPartialIndex(fromjson("{a: 1}"), fromjson("{a: {$exists: true}}"));
+        runQuerySortProj(BSONObj(), fromjson("{a: 1}"), BSONObj());
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{sort: {pattern: {a: 1}, limit: 0, node: {cscan: {dir: 1}}}}");
+    }
+
     //
     // Regex
     //
@@ -294,6 +294,13 @@ namespace mongo {
                 }
             }
 
+            BSONElement topK = textObj["topK"];
+            if (!topK.eoo()) {
+                if (!topK.isNumber() || size_t(topK.numberLong()) != node->topK) {
+                    return false;
+                }
+            }
+
             BSONElement filter = textObj["filter"];
             if (!filter.eoo()) {
                 if (filter.isNull()) {
@@ -617,4 +617,38 @@ namespace {
                                           "pattern: {other: 1}}}]}}}}");
     }
 
+    // The limit of a sort on the text score is pushed into the text stage.
+    TEST_F(QueryPlannerTest, TextScoreSortLimitSetsTopK) {
+        addIndex(BSON("_fts" << "text" << "_ftsx" << 1));
+        runQuerySortProjSkipLimit(fromjson("{$text: {$search: 'blah'}}"),
+                                  fromjson("{score: {$meta: 'textScore'}}"),
+                                  fromjson("{score: {$meta: 'textScore'}}"), 5, 20);
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{skip: {n: 5, node: "
+                                "{proj: {spec: {score: {$meta: 'textScore'}}, node: "
+                                    "{sort: {pattern: {score: {$meta: 'textScore'}}, limit: 25, "
+                                        "node: {text: {search: 'blah', topK: 25}}}}}}}}");
+    }
+
+    // Without a limit, or with another sort order, the text stage returns every match.
+    TEST_F(QueryPlannerTest, TextWithoutScoreSortLimitHasNoTopK) {
+        addIndex(BSON("_fts" << "text" << "_ftsx" << 1));
+        runQuerySortProj(fromjson("{$text: {$search: 'blah'}}"),
+                         fromjson("{score: {$meta: 'textScore'}}"),
+                         fromjson("{score: {$meta: 'textScore'}}"));
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{proj: {spec: {score: {$meta: 'textScore'}}, node: "
+                                "{sort: {pattern: {score: {$meta: 'textScore'}}, limit: 0, node: "
+                                    "{text: {search: 'blah', topK: 0}}}}}}");
+
+        runQuerySortProjSkipLimit(fromjson("{$text: {$search: 'blah'}}"),
+                                  fromjson("{a: 1}"), BSONObj(), 0, 20);
+
+        assertNumSolutions(1U);
+        assertSolutionExists("{sort: {pattern: {a: 1}, limit: 20, node: "
+                                "{text: {search: 'blah', topK: 0}}}}");
+    }
+
 }  // namespace
@@ -0,0 +1,212 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/query/query_shape_stats.h"
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+namespace {
+
+    bool moreTotalTime(const QueryShapeStatsEntry& lhs, const QueryShapeStatsEntry& rhs) {
+        return lhs.totalMicros > rhs.totalMicros;
+    }
+
+    size_t maxShapes() {
+        return internalQueryShapeStatsSize > 0
+            ? static_cast<size_t>(internalQueryShapeStatsSize) : 0;
+    }
+
+} // namespace
+
+    //
+    // QueryShapeStatsEntry
+    //
+
+    QueryShapeStatsEntry::QueryShapeStatsEntry()
+        : count(0),
+          totalMicros(0),
+          keysExamined(0),
+          docsExamined(0),
+          nreturned(0) {
+
+    }
+
+    void QueryShapeStatsEntry::record(uint64_t micros,
+                                      long long keys,
+                                      long long docs,
+                                      long long returned,
+                                      const std::string& summary) {
+        count++;
+        totalMicros += static_cast<long long>(micros);
+        latency.record(micros);
+        keysExamined += keys;
+        docsExamined += docs;
+        nreturned += returned;
+        planSummary = summary;
+    }
+
+    void QueryShapeStatsEntry::merge(const QueryShapeStatsEntry& other) {
+        if (0 == count) {
+            query = other.query;
+            sort = other.sort;
+            projection = other.projection;
+        }
+        count += other.count;
+        totalMicros += other.totalMicros;
+        latency.merge(other.latency);
+        keysExamined += other.keysExamined;
+        docsExamined += other.docsExamined;
+        nreturned += other.nreturned;
+        if (planSummary.empty()) {
+            planSummary = other.planSummary;
+        }
+        else if (!other.planSummary.empty() && planSummary != other.planSummary) {
+            // The shards, or the executions, didn't all use the same plan
+            planSummary += ", " + other.planSummary;
+        }
+    }
+
+    BSONObj QueryShapeStatsEntry::toBSON() const {
+        BSONObjBuilder bob;
+        bob.append("key", key);
+        bob.append("query", query);
+        bob.append("sort", sort);
+        bob.append("projection", projection);
+        bob.appendNumber("count", count);
+        bob.appendNumber("totalMicros", totalMicros);
+        BSONObjBuilder latencyBob(bob.subobjStart("latencyMicros"));
+        latency.append(&latencyBob, true);
+        latencyBob.doneFast();
+        bob.appendNumber("keysExamined", keysExamined);
+        bob.appendNumber("docsExamined", docsExamined);
+        bob.appendNumber("nreturned", nreturned);
+        bob.append("planSummary", planSummary);
+        return bob.obj();
+    }
+
+    // static
+    Status QueryShapeStatsEntry::parse(const BSONObj& obj, QueryShapeStatsEntry* out) {
+        if (String != obj["key"].type() ||
+                Object != obj["query"].type() ||
+                Object != obj["sort"].type() ||
+                Object != obj["projection"].type() ||
+                Object != obj["latencyMicros"].type()) {
+            return Status(ErrorCodes::BadValue,
+                          str::stream() << "malformed query shape statistics: " << obj);
+        }
+
+        out->key = obj["key"].str();
+        out->query = obj["query"].Obj().getOwned();
+        out->sort = obj["sort"].Obj().getOwned();
+        out->projection = obj["projection"].Obj().getOwned();
+        out->count = obj["count"].numberLong();
+        out->totalMicros = obj["totalMicros"].numberLong();
+        out->keysExamined = obj["keysExamined"].numberLong();
+        out->docsExamined = obj["docsExamined"].numberLong();
+        out->nreturned = obj["nreturned"].numberLong();
+        out->planSummary = obj["planSummary"].str();
+        return LatencyHistogram::parse(obj["latencyMicros"].Obj(), &out->latency);
+    }
+
+    // static
+    void QueryShapeStatsEntry::sortByTotalTime(std::vector<QueryShapeStatsEntry>* entries) {
+        std::stable_sort(entries->begin(), entries->end(), moreTotalTime);
+    }
+
+    //
+    // QueryShapeStats
+    //
+
+    QueryShapeStats::QueryShapeStats() : _entries(maxShapes()) { }
+
+    void QueryShapeStats::record(const CanonicalQuery& query,
+                                 uint64_t micros,
+                                 long long keysExamined,
+                                 long long docsExamined,
+                                 long long nreturned,
+                                 const std::string& planSummary) {
+        const PlanCacheKey& key = query.getPlanCacheKey();
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+
+        QueryShapeStatsEntry* entry;
+        if (!_entries.get(key, &entry).isOK()) {
+            const LiteParsedQuery& pq = query.getParsed();
+            entry = new QueryShapeStatsEntry();
+            entry->key = key;
+            entry->query = pq.getFilter().getOwned();
+            entry->sort = pq.getSort().getOwned();
+            entry->projection = pq.getProj().getOwned();
+            // Evicts the least recently run shape when full
+            _entries.add(key, entry);
+        }
+
+        entry->record(micros, keysExamined, docsExamined, nreturned, planSummary);
+    }
+
+    bool QueryShapeStats::get(const PlanCacheKey& key, QueryShapeStatsEntry* out) const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+
+        QueryShapeStatsEntry* entry;
+        if (!_entries.get(key, &entry).isOK()) {
+            return false;
+        }
+        *out = *entry;
+        return true;
+    }
+
+    void QueryShapeStats::getAll(std::vector<QueryShapeStatsEntry>* out) const {
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            for (EntryMap::KVListConstIt it = _entries.begin(); it != _entries.end(); ++it) {
+                out->push_back(*it->second);
+            }
+        }
+        QueryShapeStatsEntry::sortByTotalTime(out);
+    }
+
+    void QueryShapeStats::clear() {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        _entries.clear();
+    }
+
+    size_t QueryShapeStats::size() const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        return _entries.size();
+    }
+
+} // namespace mongo
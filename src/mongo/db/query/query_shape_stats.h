@@ -0,0 +1,143 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/query/lru_key_value.h"
+#include "mongo/db/query/plan_cache.h"
+#include "mongo/db/stats/latency_histogram.h"
+
+namespace mongo {
+
+    class CanonicalQuery;
+
+    /**
+     * What the executions of queries of one shape have cost so far.  The shape is the
+     * PlanCacheKey of the queries, and the query, sort and projection are those of the first
+     * query of the shape seen, as in a PlanCacheEntry.
+     */
+    struct QueryShapeStatsEntry {
+        QueryShapeStatsEntry();
+
+        /**
+         * Adds an execution which took 'micros' and examined and returned as many keys and
+         * documents.  'planSummary' replaces that of the previous executions.
+         */
+        void record(uint64_t micros,
+                    long long keysExamined,
+                    long long docsExamined,
+                    long long nreturned,
+                    const std::string& planSummary);
+
+        /**
+         * Adds the executions counted by 'other', of the same shape on another shard.
+         */
+        void merge(const QueryShapeStatsEntry& other);
+
+        /**
+         * { key, query, sort, projection, count, totalMicros,
+         *   latencyMicros: { p50, p95, p99, buckets }, keysExamined, docsExamined, nreturned,
+         *   planSummary }
+         *
+         * With the buckets, parse() reads the entry back so that mongos can merge() those of
+         * each shard.
+         */
+        BSONObj toBSON() const;
+
+        static Status parse(const BSONObj& obj, QueryShapeStatsEntry* out);
+
+        /**
+         * Orders 'entries' by total execution time, most first.
+         */
+        static void sortByTotalTime(std::vector<QueryShapeStatsEntry>* entries);
+
+        PlanCacheKey key;
+        BSONObj query;
+        BSONObj sort;
+        BSONObj projection;
+
+        long long count;
+        long long totalMicros;
+        LatencyHistogram latency;
+        long long keysExamined;
+        long long docsExamined;
+        long long nreturned;
+        std::string planSummary;
+    };
+
+    /**
+     * The execution statistics of a collection's queries by shape, for finding the shapes worth
+     * indexing.  Holds internalQueryShapeStatsSize shapes; the least recently run shape is
+     * evicted to make room for a new one.
+     *
+     * Thread safe.
+     */
+    class QueryShapeStats {
+        MONGO_DISALLOW_COPYING(QueryShapeStats);
+    public:
+        QueryShapeStats();
+
+        /**
+         * Adds an execution of 'query' to its shape's entry.
+         */
+        void record(const CanonicalQuery& query,
+                    uint64_t micros,
+                    long long keysExamined,
+                    long long docsExamined,
+                    long long nreturned,
+                    const std::string& planSummary);
+
+        /**
+         * Copies the entry of the shape 'key' to 'out'.  Returns false if there is none.
+         */
+        bool get(const PlanCacheKey& key, QueryShapeStatsEntry* out) const;
+
+        /**
+         * Copies every entry to 'out', most total execution time first.
+         */
+        void getAll(std::vector<QueryShapeStatsEntry>* out) const;
+
+        void clear();
+
+        size_t size() const;
+
+    private:
+        typedef LRUKeyValue<PlanCacheKey, QueryShapeStatsEntry> EntryMap;
+
+        mutable boost::mutex _mutex;
+        EntryMap _entries; // guarded by _mutex
+    };
+
+} // namespace mongo
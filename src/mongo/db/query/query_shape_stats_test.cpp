@@ -0,0 +1,148 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/query/query_shape_stats.h"
+
+#include "mongo/db/json.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    static const char* ns = "somebogusns";
+
+    //
+    // Convenience functions
+    //
+
+    CanonicalQuery* canonicalize(const char* queryStr, const char* sortStr = "{}") {
+        CanonicalQuery* cq;
+        Status result = CanonicalQuery::canonicalize(ns, fromjson(queryStr), fromjson(sortStr),
+                                                     BSONObj(), &cq);
+        ASSERT_OK(result);
+        return cq;
+    }
+
+    void record(QueryShapeStats* stats, const char* queryStr, uint64_t micros) {
+        std::auto_ptr<CanonicalQuery> cq(canonicalize(queryStr));
+        stats->record(*cq, micros, 10, 20, 1, "IXSCAN { a: 1 }");
+    }
+
+    TEST(QueryShapeStatsTest, SameShapeSameEntry) {
+        QueryShapeStats stats;
+        record(&stats, "{a: 1}", 100);
+        record(&stats, "{a: 5}", 300);
+        record(&stats, "{b: 1}", 50);
+        ASSERT_EQUALS(stats.size(), 2U);
+
+        std::auto_ptr<CanonicalQuery> cq(canonicalize("{a: 'x'}"));
+        QueryShapeStatsEntry entry;
+        ASSERT(stats.get(cq->getPlanCacheKey(), &entry));
+        ASSERT_EQUALS(entry.query, fromjson("{a: 1}"));
+        ASSERT_EQUALS(entry.count, 2);
+        ASSERT_EQUALS(entry.totalMicros, 400);
+        ASSERT_EQUALS(entry.keysExamined, 20);
+        ASSERT_EQUALS(entry.docsExamined, 40);
+        ASSERT_EQUALS(entry.nreturned, 2);
+        ASSERT_EQUALS(entry.latency.getCount(), 2U);
+        ASSERT_EQUALS(entry.planSummary, "IXSCAN { a: 1 }");
+
+        // A sort is part of the shape
+        std::auto_ptr<CanonicalQuery> sorted(canonicalize("{a: 1}", "{b: 1}"));
+        ASSERT_FALSE(stats.get(sorted->getPlanCacheKey(), &entry));
+    }
+
+    TEST(QueryShapeStatsTest, MostTotalTimeFirst) {
+        QueryShapeStats stats;
+        record(&stats, "{a: 1}", 100);
+        record(&stats, "{b: 1}", 500);
+        record(&stats, "{c: 1}", 200);
+
+        std::vector<QueryShapeStatsEntry> entries;
+        stats.getAll(&entries);
+        ASSERT_EQUALS(entries.size(), 3U);
+        ASSERT_EQUALS(entries[0].query, fromjson("{b: 1}"));
+        ASSERT_EQUALS(entries[1].query, fromjson("{c: 1}"));
+        ASSERT_EQUALS(entries[2].query, fromjson("{a: 1}"));
+
+        stats.clear();
+        ASSERT_EQUALS(stats.size(), 0U);
+    }
+
+    TEST(QueryShapeStatsTest, EvictsLeastRecentlyRun) {
+        const int oldSize = internalQueryShapeStatsSize;
+        internalQueryShapeStatsSize = 2;
+        QueryShapeStats stats;
+        internalQueryShapeStatsSize = oldSize;
+
+        record(&stats, "{a: 1}", 100);
+        record(&stats, "{b: 1}", 100);
+        record(&stats, "{a: 2}", 100);
+        record(&stats, "{c: 1}", 100);
+        ASSERT_EQUALS(stats.size(), 2U);
+
+        std::vector<QueryShapeStatsEntry> entries;
+        stats.getAll(&entries);
+        for (size_t i = 0; i < entries.size(); i++) {
+            ASSERT_NOT_EQUALS(entries[i].query, fromjson("{b: 1}"));
+        }
+    }
+
+    TEST(QueryShapeStatsTest, ParseAndMerge) {
+        QueryShapeStats first;
+        record(&first, "{a: 1}", 100);
+        QueryShapeStats second;
+        record(&second, "{a: 2}", 100000);
+        record(&second, "{a: 3}", 100);
+
+        std::vector<QueryShapeStatsEntry> firstEntries;
+        first.getAll(&firstEntries);
+        std::vector<QueryShapeStatsEntry> secondEntries;
+        second.getAll(&secondEntries);
+
+        QueryShapeStatsEntry merged;
+        ASSERT_OK(QueryShapeStatsEntry::parse(firstEntries[0].toBSON(), &merged));
+        QueryShapeStatsEntry parsed;
+        ASSERT_OK(QueryShapeStatsEntry::parse(secondEntries[0].toBSON(), &parsed));
+        ASSERT_EQUALS(parsed.key, firstEntries[0].key);
+        merged.merge(parsed);
+
+        ASSERT_EQUALS(merged.query, fromjson("{a: 1}"));
+        ASSERT_EQUALS(merged.count, 3);
+        ASSERT_EQUALS(merged.totalMicros, 100200);
+        ASSERT_EQUALS(merged.latency.getCount(), 3U);
+        ASSERT_GREATER_THAN_OR_EQUALS(merged.latency.getPercentileMicros(99), 100000U);
+        ASSERT_EQUALS(merged.planSummary, "IXSCAN { a: 1 }");
+
+        ASSERT_NOT_OK(QueryShapeStatsEntry::parse(fromjson("{key: 'eqa'}"), &parsed));
+    }
+
+}  // namespace
@@ -76,6 +76,10 @@ namespace mongo {
         *ss << "language = " << language << '\n';
         addIndent(ss, indent + 1);
         *ss << "indexPrefix = " << indexPrefix.toString() << '\n';
+        if (0 != topK) {
+            addIndent(ss, indent + 1);
+            *ss << "topK = " << topK << '\n';
+        }
         if (NULL != filter) {
             addIndent(ss, indent + 1);
             *ss << " filter = " << filter->toString();
@@ -92,6 +96,7 @@ namespace mongo {
         copy->query = this->query;
         copy->language = this->language;
         copy->indexPrefix = this->indexPrefix;
+        copy->topK = this->topK;
 
         return copy;
     }
@@ -100,7 +105,8 @@ namespace mongo {
     // CollectionScanNode
     //
 
-    CollectionScanNode::CollectionScanNode() : tailable(false), direction(1), maxScan(0) { }
+    CollectionScanNode::CollectionScanNode()
+        : tailable(false), direction(1), maxScan(0), naturalOrder(false) { }
 
     void CollectionScanNode::appendToString(mongoutils::str::stream* ss, int indent) const {
         addIndent(ss, indent);
@@ -123,6 +129,7 @@ namespace mongo {
         copy->tailable = this->tailable;
         copy->direction = this->direction;
         copy->maxScan = this->maxScan;
+        copy->naturalOrder = this->naturalOrder;
 
         return copy;
     }
@@ -131,7 +138,7 @@ namespace mongo {
     // AndHashNode
     //
 
-    AndHashNode::AndHashNode() { }
+    AndHashNode::AndHashNode() : allowDiskUse(false) { }
 
     AndHashNode::~AndHashNode() { }
 
@@ -142,6 +149,10 @@ namespace mongo {
             addIndent(ss, indent + 1);
             *ss << " filter = " << filter->toString() << '\n';
         }
+        if (allowDiskUse) {
+            addIndent(ss, indent + 1);
+            *ss << "allowDiskUse\n";
+        }
         addCommon(ss, indent);
         for (size_t i = 0; i < children.size(); ++i) {
             addIndent(ss, indent + 1);
@@ -177,6 +188,7 @@ namespace mongo {
         cloneBaseData(copy);
 
         copy->_sort = this->_sort;
+        copy->allowDiskUse = this->allowDiskUse;
 
         return copy;
     }
@@ -411,9 +423,11 @@ namespace mongo {
     }
 
     bool IndexScanNode::hasField(const string& field) const {
-        // There is no covering in a multikey index because you don't know whether or not the field
-        // in the key was extracted from an array in the original document.
-        if (indexIsMultiKey) { return false; }
+        // There is no covering by a multikey field because you don't know whether or not the
+        // field in the key was extracted from an array in the original document.
+        if (indexIsMultiKey && (multikeyPaths.empty() || multikeyPaths.count(field))) {
+            return false;
+        }
 
         // Custom index access methods may return non-exact key data - this function is currently
         // used for covering exact key data only.
@@ -552,6 +566,7 @@ namespace mongo {
         copy->_sorts = this->_sorts;
         copy->indexKeyPattern = this->indexKeyPattern;
         copy->indexIsMultiKey = this->indexIsMultiKey;
+        copy->multikeyPaths = this->multikeyPaths;
         copy->direction = this->direction;
         copy->maxScan = this->maxScan;
         copy->addKeyMetadata = this->addKeyMetadata;
@@ -613,6 +628,10 @@ namespace mongo {
         *ss << "query for bounds = " << query.toString() << '\n';
         addIndent(ss, indent + 1);
         *ss << "limit = " << limit << '\n';
+        if (allowDiskUse) {
+            addIndent(ss, indent + 1);
+            *ss << "allowDiskUse\n";
+        }
         addCommon(ss, indent);
         addIndent(ss, indent + 1);
         *ss << "Child:" << '\n';
@@ -627,6 +646,7 @@ namespace mongo {
         copy->pattern = this->pattern;
         copy->query = this->query;
         copy->limit = this->limit;
+        copy->allowDiskUse = this->allowDiskUse;
 
         return copy;
     }
@@ -216,7 +216,7 @@ namespace mongo {
     };
 
     struct TextNode : public QuerySolutionNode {
-        TextNode() { }
+        TextNode() : topK(0) { }
         virtual ~TextNode() { }
 
         virtual StageType getType() const { return STAGE_TEXT; }
@@ -241,6 +241,10 @@ namespace mongo {
         // text node while creating the text leaf node and convert them into a BSONObj index prefix
         // when we finish the text leaf node.
         BSONObj indexPrefix;
+
+        // If non-zero, only the 'topK' highest scoring documents are needed, as the parent is a
+        // top-K sort on the text score.
+        size_t topK;
     };
 
     struct CollectionScanNode : public QuerySolutionNode {
@@ -270,6 +274,10 @@ namespace mongo {
 
         // maxScan option to .find() limits how many docs we look at.
         int maxScan;
+
+        // Did the query ask for natural order, by sort or hint?  If not, the documents may be
+        // returned in any order.
+        bool naturalOrder;
     };
 
     struct AndHashNode : public QuerySolutionNode {
@@ -288,6 +296,11 @@ namespace mongo {
         QuerySolutionNode* clone() const;
 
         BSONObjSet _sort;
+
+        // May the intersection be finished on disk once it exceeds its memory limit?  Results
+        // are then not output in the order of the last child, so this is only set when nobody
+        // depends on that order.
+        bool allowDiskUse;
     };
 
     struct AndSortedNode : public QuerySolutionNode {
@@ -402,6 +415,10 @@ namespace mongo {
         BSONObj indexKeyPattern;
         bool indexIsMultiKey;
 
+        // If 'indexIsMultiKey', the key fields which may come from arrays; all of them if
+        // empty.  See IndexEntry::multikeyPaths.
+        std::set<std::string> multikeyPaths;
+
         int direction;
 
         // maxScan option to .find() limits how many docs we look at.
@@ -495,7 +512,7 @@ namespace mongo {
     };
 
     struct SortNode : public QuerySolutionNode {
-        SortNode() : limit(0) { }
+        SortNode() : limit(0), allowDiskUse(false) { }
         virtual ~SortNode() { }
 
         virtual StageType getType() const { return STAGE_SORT; }
@@ -526,6 +543,9 @@ namespace mongo {
 
         // Sum of both limit and skip count in the parsed query.
         size_t limit;
+
+        // May the sort write to temporary files once it exceeds its memory limit?
+        bool allowDiskUse;
     };
 
     struct LimitNode : public QuerySolutionNode {
@@ -31,6 +31,7 @@
 #include "mongo/db/curop.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/storage/record_fetcher.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 namespace {
@@ -67,8 +68,10 @@ namespace {
             return;
         }
 
-        // Track the number of yields in CurOp.
-        txn->getCurOp()->yielded();
+        // Track the number of yields in CurOp, and how long they last.
+        CurOp* curOp = txn->getCurOp();
+        curOp->yielded();
+        Timer yieldTimer;
 
         if (hadReadLock) {
             // TODO(kal): Is this still relevant?  Probably not?
@@ -101,10 +104,14 @@ namespace {
         }
 
         if (fetcher) {
+            Timer fetchTimer;
             fetcher->fetch();
+            OpDebug::addTo(&curOp->debug().fetches, 1);
+            OpDebug::addTo(&curOp->debug().fetchMicros, fetchTimer.micros());
         }
 
         locker->restoreLockState(snapshot);
+        OpDebug::addTo(&curOp->debug().yieldMicros, yieldTimer.micros());
     }
 
 } // namespace mongo
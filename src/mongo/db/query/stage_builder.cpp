@@ -43,6 +43,8 @@
 #include "mongo/db/exec/limit.h"
 #include "mongo/db/exec/merge_sort.h"
 #include "mongo/db/exec/or.h"
+#include "mongo/db/exec/parallel_collection_scan.h"
+#include "mongo/db/exec/parallel_index_scan.h"
 #include "mongo/db/exec/projection.h"
 #include "mongo/db/exec/shard_filter.h"
 #include "mongo/db/exec/sort.h"
@@ -51,6 +53,11 @@
 #include "mongo/db/index/fts_access_method.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
+#include "mongo/db/global_environment_experiment.h"
+#include "mongo/db/index_names.h"
+#include "mongo/db/query/index_bounds_builder.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/storage_options.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
@@ -68,6 +75,25 @@ namespace mongo {
             params.direction = (csn->direction == 1) ? CollectionScanParams::FORWARD
                                                      : CollectionScanParams::BACKWARD;
             params.maxScan = csn->maxScan;
+
+            // Big forward scans of a whole collection can read and filter on several threads.
+            if (internalQueryExecParallelCollScanThreads > 1
+                && NULL != collection
+                && !collection->isCapped()
+                && !params.tailable
+                && CollectionScanParams::FORWARD == params.direction
+                && 0 == params.maxScan
+                && ParallelCollectionScanStage::canParallelize(csn->filter.get())
+                && collection->numRecords(txn) >=
+                       static_cast<uint64_t>(internalQueryExecParallelCollScanMinRecords)) {
+                return new ParallelCollectionScanStage(txn,
+                                                       collection,
+                                                       ws,
+                                                       csn->filter.get(),
+                                                       csn->naturalOrder,
+                                                       internalQueryExecParallelCollScanThreads);
+            }
+
             return new CollectionScan(txn, params, ws, csn->filter.get());
         }
         else if (STAGE_IXSCAN == root->getType()) {
@@ -92,6 +118,29 @@ namespace mongo {
             params.direction = ixn->direction;
             params.maxScan = ixn->maxScan;
             params.addKeyMetadata = ixn->addKeyMetadata;
+
+            // Wide ranges over a btree index can be split up and scanned on several threads.
+            // MMAPv1 is the only engine whose cursors can be used from other threads while the
+            // operation holds its locks.  If there's a blocking stage, such as a SORT, above us
+            // then nothing depends on the order of the keys.
+            std::vector<IndexBounds> ranges;
+            if (internalQueryExecParallelIndexScanThreads > 1
+                && isMMAPV1()
+                && IndexNames::BTREE == params.descriptor->getAccessMethodName()
+                && 0 == params.maxScan
+                && !params.addKeyMetadata
+                && ParallelCollectionScanStage::canParallelize(ixn->filter.get())
+                && IndexBoundsBuilder::splitRange(params.bounds,
+                                                  internalQueryExecParallelIndexScanThreads,
+                                                  &ranges)) {
+                return new ParallelIndexScanStage(txn,
+                                                  params,
+                                                  ranges,
+                                                  ws,
+                                                  ixn->filter.get(),
+                                                  !qsol.hasBlockingStage);
+            }
+
             return new IndexScan(txn, params, ws, ixn->filter.get());
         }
         else if (STAGE_FETCH == root->getType()) {
@@ -109,6 +158,11 @@ namespace mongo {
             params.pattern = sn->pattern;
             params.query = sn->query;
             params.limit = sn->limit;
+            if (sn->allowDiskUse) {
+                // The same place that aggregation's $sort spills to.
+                params.allowDiskUse = true;
+                params.tempDir = storageGlobalParams.dbpath + "/_tmp";
+            }
             return new SortStage(txn, params, ws, childStage);
         }
         else if (STAGE_PROJECTION == root->getType()) {
@@ -151,6 +205,9 @@ namespace mongo {
         else if (STAGE_AND_HASH == root->getType()) {
             const AndHashNode* ahn = static_cast<const AndHashNode*>(root);
             auto_ptr<AndHashStage> ret(new AndHashStage(txn, ws, ahn->filter.get(), collection));
+            if (ahn->allowDiskUse) {
+                ret->allowDiskUse(storageGlobalParams.dbpath + "/_tmp");
+            }
             for (size_t i = 0; i < ahn->children.size(); ++i) {
                 PlanStage* childStage = buildStages(txn, collection, qsol, ahn->children[i], ws);
                 if (NULL == childStage) { return NULL; }
@@ -257,6 +314,7 @@ namespace mongo {
             params.index = index;
             params.spec = fam->getSpec();
             params.indexPrefix = node->indexPrefix;
+            params.topK = node->topK;
 
             const std::string& language = ("" == node->language
                                            ? fam->getSpec().defaultLanguage().str()
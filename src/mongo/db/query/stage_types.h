@@ -36,6 +36,10 @@ namespace mongo {
     enum StageType {
         STAGE_AND_HASH,
         STAGE_AND_SORTED,
+
+        // Looks up a list of _id values, as the idhack does a single one.
+        STAGE_BATCHED_IDHACK,
+
         STAGE_CACHED_PLAN,
         STAGE_COLLSCAN,
 
@@ -82,6 +86,13 @@ namespace mongo {
         STAGE_MULTI_PLAN,
         STAGE_OPLOG_START,
         STAGE_OR,
+
+        // A COLLSCAN whose records are read and filtered on several threads.
+        STAGE_PARALLEL_COLLSCAN,
+
+        // An IXSCAN split into consecutive ranges which are scanned on several threads.
+        STAGE_PARALLEL_IXSCAN,
+
         STAGE_PROJECTION,
 
         // Stage for running aggregation pipelines.
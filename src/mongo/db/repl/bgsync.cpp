@@ -45,6 +45,7 @@
 #include "mongo/db/repl/rs_rollback.h"
 #include "mongo/db/repl/rs_sync.h"
 #include "mongo/db/repl/rslog.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/timer_stats.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -61,6 +62,10 @@ namespace {
 
     MONGO_FP_DECLARE(rsBgSyncProduce);
 
+    // Tail the sync source's oplog with an exhaust cursor, so batches are pushed by the sync
+    // source instead of being requested one getMore round trip at a time
+    MONGO_EXPORT_SERVER_PARAMETER(replExhaustOplogTailing, bool, true);
+
     BackgroundSync* BackgroundSync::s_instance = 0;
     boost::mutex BackgroundSync::s_mutex;
 
@@ -245,6 +250,14 @@ namespace {
             _replCoord->signalUpstreamUpdater();
         }
 
+        int tailingQueryOptions = _syncSourceReader.getTailingQueryOptions();
+        if (replExhaustOplogTailing) {
+            tailingQueryOptions |= QueryOption_Exhaust;
+        }
+        else {
+            tailingQueryOptions &= ~QueryOption_Exhaust;
+        }
+        _syncSourceReader.setTailingQueryOptions(tailingQueryOptions);
         _syncSourceReader.tailingQueryGTE(rsoplog, lastOpTimeFetched);
 
         // if target cut connections between connecting and querying (for
@@ -409,6 +422,9 @@ namespace {
 
         if (!r.more()) {
             try {
+                uassert(ErrorCodes::HostUnreachable,
+                        "could not reconnect after closing the exhaust cursor",
+                        r.stopExhaustStream());
                 BSONObj theirLastOp = r.getLastOp(rsoplog);
                 if (theirLastOp.isEmpty()) {
                     log() << "replSet error empty query result from " << hn << " oplog" << rsLog;
@@ -439,6 +455,11 @@ namespace {
         if( ts != _lastOpTimeFetched || hash != _lastFetchedHash ) {
             log() << "replSet our last op time fetched: " << _lastOpTimeFetched.toStringPretty() << rsLog;
             log() << "replset source's GTE: " << ts.toStringPretty() << rsLog;
+            if (!r.stopExhaustStream()) {
+                log() << "replSet error reconnecting to " << hn << " for rollback" << rsLog;
+                sleepsecs(2);
+                return true;
+            }
             syncRollback(txn, _replCoord->getMyLastOptime(), &r, _replCoord);
             return true;
         }
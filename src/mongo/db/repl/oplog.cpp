@@ -99,12 +99,16 @@ namespace repl {
     }
 
     // so we can fail the same way
-    void checkOplogInsert( StatusWith<DiskLoc> result ) {
+    void checkOplogInsert( const Status& result ) {
         massert( 17322,
-                 str::stream() << "write to oplog failed: " << result.getStatus().toString(),
+                 str::stream() << "write to oplog failed: " << result.toString(),
                  result.isOK() );
     }
 
+    void checkOplogInsert( StatusWith<DiskLoc> result ) {
+        checkOplogInsert( result.getStatus() );
+    }
+
     static void _logOpUninitialized(OperationContext* txn,
                                     const char *opstr,
                                     const char *ns,
@@ -224,6 +228,16 @@ namespace repl {
 
     */
 
+    static void _initLocalOplogRS(OperationContext* txn) {
+        if ( localOplogRSCollection == 0 ) {
+            Client::Context ctx(txn, rsoplog);
+            localDB = ctx.db();
+            verify( localDB );
+            localOplogRSCollection = localDB->getCollection( txn, rsoplog );
+            massert(13347, "local.oplog.rs missing. did you drop it? if so restart server", localOplogRSCollection);
+        }
+    }
+
     // global is safe as we are in write lock. we put the static outside the function to avoid the implicit mutex 
     // the compiler would use if inside the function.  the reason this is static is to avoid a malloc/free for this
     // on every logop call.
@@ -289,13 +303,7 @@ namespace repl {
 
         DEV verify( logNS == 0 ); // check this was never a master/slave master
 
-        if ( localOplogRSCollection == 0 ) {
-            Client::Context ctx(txn, rsoplog);
-            localDB = ctx.db();
-            verify( localDB );
-            localOplogRSCollection = localDB->getCollection( txn, rsoplog );
-            massert(13347, "local.oplog.rs missing. did you drop it? if so restart server", localOplogRSCollection);
-        }
+        _initLocalOplogRS(txn);
 
         Client::Context ctx(txn, rsoplog, localDB);
         WriteUnitOfWork wunit(txn);
@@ -310,6 +318,74 @@ namespace repl {
 
     }
 
+    /**
+     * Writes one oplog entry per element of 'objs', all with the same opstr and ns, as one
+     * batch: their OpTimes are reserved together and the entries are inserted with one
+     * Collection::insertDocuments call, so newOpMutex is taken once per batch.
+     */
+    static void _logOpsRS(OperationContext* txn,
+                          const char *opstr,
+                          const char *ns,
+                          const std::vector<BSONObj>& objs,
+                          bool fromMigrate ) {
+        invariant(*opstr != 'n');
+        Lock::DBLock lk1(txn->lockState(), "local", MODE_X);
+
+        if ( strncmp(ns, "local.", 6) == 0 || objs.empty() ) {
+            return;
+        }
+        ReplicationCoordinator* replCoord = getGlobalReplicationCoordinator();
+
+        mutex::scoped_lock lk2(newOpMutex);
+
+        const OpTime first(getNextGlobalOptimes(objs.size()));
+        newOptimeNotifier.notify_all();
+
+        if (!replCoord->canAcceptWritesForDatabase(nsToDatabaseSubstring(ns))) {
+            severe() << "replSet error : logOp() but can't accept write to collection " << ns;
+            fassertFailed(17405);
+        }
+
+        long long hashNew = BackgroundSync::get()->getLastAppliedHash();
+        OpTime ts;
+
+        std::vector<OplogDocWriter> writers;
+        writers.reserve(objs.size());
+        for (size_t i = 0; i < objs.size(); i++) {
+            ts = OpTime(first.getSecs(), first.getInc() + i);
+            hashNew = (hashNew * 131 + ts.asLL()) * 17 + replCoord->getMyId();
+
+            BSONObjBuilder b;
+            b.appendTimestamp("ts", ts.asDate());
+            b.append("h", hashNew);
+            b.append("v", OPLOG_VERSION);
+            b.append("op", opstr);
+            b.append("ns", ns);
+            if (fromMigrate)
+                b.appendBool("fromMigrate", true);
+            writers.push_back(OplogDocWriter(b.obj(), objs[i]));
+        }
+
+        std::vector<const DocWriter*> docs;
+        docs.reserve(writers.size());
+        for (size_t i = 0; i < writers.size(); i++) {
+            docs.push_back(&writers[i]);
+        }
+
+        _initLocalOplogRS(txn);
+
+        Client::Context ctx(txn, rsoplog, localDB);
+        WriteUnitOfWork wunit(txn);
+        std::vector<DiskLoc> locs;
+        checkOplogInsert( localOplogRSCollection->insertDocuments( txn, docs, &locs, false ) );
+
+        BackgroundSync::get()->setLastAppliedHash(hashNew);
+        ctx.getClient()->setLastOp( ts );
+        replCoord->setMyLastOptime(txn, ts);
+
+        wunit.commit();
+    }
+
     static void _logOpOld(OperationContext* txn,
                           const char *opstr,
                           const char *ns,
@@ -379,11 +455,33 @@ namespace repl {
                           BSONObj *o2,
                           bool *bb,
                           bool fromMigrate ) = _logOpUninitialized;
+
+    // master/slave and uninitialized replication log each op on its own
+    static void _logOpsSeparately(OperationContext* txn,
+                                  const char *opstr,
+                                  const char *ns,
+                                  const std::vector<BSONObj>& objs,
+                                  bool fromMigrate ) {
+        for (size_t i = 0; i < objs.size(); i++) {
+            _logOp(txn, opstr, ns, 0, objs[i], 0, 0, fromMigrate);
+        }
+    }
+
+    static void (*_logOps)(OperationContext* txn,
+                           const char *opstr,
+                           const char *ns,
+                           const std::vector<BSONObj>& objs,
+                           bool fromMigrate ) = _logOpsSeparately;
+
     void newReplUp() {
         _logOp = _logOpRS;
+        _logOps = _logOpsRS;
     }
 
-    void oldRepl() { _logOp = _logOpOld; }
+    void oldRepl() {
+        _logOp = _logOpOld;
+        _logOps = _logOpsSeparately;
+    }
 
     void logKeepalive(OperationContext* txn) {
         _logOp(txn, "n", "", 0, BSONObj(), 0, 0, false);
@@ -395,6 +493,15 @@ namespace repl {
         _logOpRS(txn, "n", "", 0, obj, 0, 0, false);
     }
 
+    // TODO SERVER-15192 remove this once all listeners are rollback-safe.
+    class RollbackPreventer : public RecoveryUnit::Change {
+        virtual void commit() {}
+        virtual void rollback() {
+            severe() << "Rollback of logOp not currently allowed (SERVER-15192)";
+            fassertFailed(18805);
+        }
+    };
+
     /*@ @param opstr:
           c userCreateNS
           i insert
@@ -410,14 +517,6 @@ namespace repl {
                bool* b,
                bool fromMigrate) {
         try {
-            // TODO SERVER-15192 remove this once all listeners are rollback-safe.
-            class RollbackPreventer : public RecoveryUnit::Change {
-                virtual void commit() {}
-                virtual void rollback() {
-                    severe() << "Rollback of logOp not currently allowed (SERVER-15192)";
-                    fassertFailed(18805);
-                }
-            };
             txn->recoveryUnit()->registerChange(new RollbackPreventer());
 
             if ( getGlobalReplicationCoordinator()->isReplEnabled() ) {
@@ -446,6 +545,42 @@ namespace repl {
         }
     }
 
+    void logOps(OperationContext* txn,
+                const char* opstr,
+                const char* ns,
+                const std::vector<BSONObj>& objs,
+                bool fromMigrate) {
+        try {
+            txn->recoveryUnit()->registerChange(new RollbackPreventer());
+
+            if ( getGlobalReplicationCoordinator()->isReplEnabled() ) {
+                _logOps(txn, opstr, ns, objs, fromMigrate);
+            }
+
+            for (size_t i = 0; i < objs.size(); i++) {
+                logOpForSharding(txn, opstr, ns, objs[i], NULL, fromMigrate);
+                getGlobalAuthorizationManager()->logOp(opstr, ns, objs[i], NULL, NULL);
+            }
+            logOpForDbHash(ns);
+
+            if ( strstr( ns, ".system.js" ) ) {
+                Scope::storedFuncMod(); // this is terrible
+            }
+        }
+        catch (const DBException& ex) {
+            severe() << "Fatal DBException in logOps(): " << ex.toString();
+            std::terminate();
+        }
+        catch (const std::exception& ex) {
+            severe() << "Fatal std::exception in logOps(): " << ex.what();
+            std::terminate();
+        }
+        catch (...) {
+            severe() << "Fatal error in logOps()";
+            std::terminate();
+        }
+    }
+
     void createOplog(OperationContext* txn) {
         Lock::GlobalWrite lk(txn->lockState());
 
@@ -30,6 +30,7 @@
 
 #include <cstddef>
 #include <string>
+#include <vector>
 
 namespace mongo {
     class BSONObj;
@@ -81,6 +82,17 @@ namespace repl {
                 bool *b = NULL,
                 bool fromMigrate = false);
 
+    /**
+     * Logs one operation per element of 'objs', like calling logOp() for each of them, but
+     * writes the replica set oplog entries as one batch with a reserved range of OpTimes.
+     * Used for the documents of multi-document inserts.
+     */
+    void logOps( OperationContext* txn,
+                 const char *opstr,
+                 const char *ns,
+                 const std::vector<BSONObj>& objs,
+                 bool fromMigrate = false);
+
     // Log an empty no-op operation to the local oplog
     void logKeepalive(OperationContext* txn);
 
@@ -99,6 +99,9 @@ namespace repl {
                 log() << "repl: " << errmsg << endl;
                 return false;
             }
+            if ( _conn->port().compressionEnabled() ) {
+                LOG(1) << "repl: compressing messages from " << host.toString() << endl;
+            }
             _host = host;
         }
         return true;
@@ -121,6 +124,17 @@ namespace repl {
         );
     }
 
+    bool OplogReader::stopExhaustStream() {
+        if ( !cursor.get() || !cursor->exhaust() || cursor->isDead() ) {
+            resetCursor();
+            return true;
+        }
+
+        const HostAndPort host = _host;
+        resetConnection();
+        return connect(host);
+    }
+
     void OplogReader::tailingQuery(const char *ns, const BSONObj& query, const BSONObj* fields ) {
         verify( !haveCursor() );
         LOG(2) << "repl: " << ns << ".find(" << query.toString() << ')' << endl;
@@ -66,6 +66,14 @@ namespace repl {
         OplogReader();
         ~OplogReader() { }
         void resetCursor() { cursor.reset(); }
+
+        /**
+         * Makes the connection usable for other requests. While an exhaust cursor is alive the
+         * sync source keeps streaming batches on the connection, so it is reopened to the same
+         * host. Returns false if reconnecting failed.
+         */
+        bool stopExhaustStream();
+
         void resetConnection() {
             cursor.reset();
             _conn.reset();
@@ -33,6 +33,7 @@
 #include "mongo/db/repl/repl_coordinator_impl.h"
 
 #include <algorithm>
+#include <functional>
 #include <boost/thread.hpp>
 
 #include "mongo/base/status.h"
@@ -104,27 +105,40 @@ namespace {
     struct ReplicationCoordinatorImpl::WaiterInfo {
 
         /**
-         * Constructor takes the list of waiters and enqueues itself on the list, removing itself
-         * in the destructor.
+         * Constructor takes the list of waiters and enqueues itself on the list and on the queue
+         * of its write concern mode, removing itself in the destructor.
          */
         WaiterInfo(std::vector<WaiterInfo*>* _list,
+                   WaiterQueueMap* _queues,
                    unsigned int _opID,
                    const OpTime* _opTime,
                    const WriteConcernOptions* _writeConcern,
                    boost::condition_variable* _condVar) : list(_list),
+                                                          queues(_queues),
                                                           master(true),
                                                           opID(_opID),
                                                           opTime(_opTime),
                                                           writeConcern(_writeConcern),
                                                           condVar(_condVar) {
             list->push_back(this);
+            const int wNumNodes = writeConcern->wMode.empty() ? writeConcern->wNumNodes : 0;
+            queue = queues->insert(std::make_pair(std::make_pair(wNumNodes, writeConcern->wMode),
+                                                  WaiterQueue())).first;
+            position = queue->second.insert(std::make_pair(*opTime, this));
         }
 
         ~WaiterInfo() {
             list->erase(std::remove(list->begin(), list->end(), this), list->end());
+            queue->second.erase(position);
+            if (queue->second.empty()) {
+                queues->erase(queue);
+            }
         }
 
         std::vector<WaiterInfo*>* list;
+        WaiterQueueMap* queues;
+        WaiterQueueMap::iterator queue;
+        WaiterQueue::iterator position;
         bool master; // Set to false to indicate that stepDown was called while waiting
         const unsigned int opID;
         const OpTime* opTime;
@@ -877,6 +891,87 @@ namespace {
         return false;
     }
 
+    bool ReplicationCoordinatorImpl::_getWriteConcernReachedOpTime_inlock(
+            const WriteConcernOptions& writeConcern, OpTime* reached) {
+        Status status = _checkIfWriteConcernCanBeSatisfied_inlock(writeConcern);
+        if (!status.isOK()) {
+            return false;
+        }
+
+        if (!writeConcern.wMode.empty()) {
+            StringData patternName;
+            if (writeConcern.wMode == "majority") {
+                patternName = "$majority";
+            }
+            else {
+                patternName = writeConcern.wMode;
+            }
+            StatusWith<ReplicaSetTagPattern> tagPattern =
+                _rsConfig.findCustomWriteMode(patternName);
+            if (!tagPattern.isOK()) {
+                return false;
+            }
+            *reached = _getTaggedNodesReachedOpTime_inlock(tagPattern.getValue());
+        }
+        else {
+            *reached = _getNumNodesReachedOpTime_inlock(writeConcern.wNumNodes);
+        }
+        return true;
+    }
+
+    OpTime ReplicationCoordinatorImpl::_getNumNodesReachedOpTime_inlock(int numNodes) {
+        const OpTime myLastOptime = _getMyLastOptime_inlock();
+        if (numNodes < 1) {
+            return myLastOptime;
+        }
+
+        std::vector<OpTime> slaveTimes;
+        slaveTimes.reserve(_slaveInfo.size());
+        for (SlaveInfoVector::const_iterator it = _slaveInfo.begin();
+                it != _slaveInfo.end(); ++it) {
+            slaveTimes.push_back(it->opTime);
+        }
+        if (slaveTimes.size() < static_cast<size_t>(numNodes)) {
+            return OpTime();
+        }
+
+        // The numNodes-th newest optime is the newest one that numNodes nodes have reached.
+        std::nth_element(slaveTimes.begin(),
+                         slaveTimes.begin() + (numNodes - 1),
+                         slaveTimes.end(),
+                         std::greater<OpTime>());
+        // Secondaries that are for some reason ahead of us should not allow us to satisfy a
+        // write concern if we aren't caught up ourselves.
+        return std::min(slaveTimes[numNodes - 1], myLastOptime);
+    }
+
+    OpTime ReplicationCoordinatorImpl::_getTaggedNodesReachedOpTime_inlock(
+            const ReplicaSetTagPattern& tagPattern) {
+        std::vector<std::pair<OpTime, int> > slaveTimes;
+        slaveTimes.reserve(_slaveInfo.size());
+        for (SlaveInfoVector::const_iterator it = _slaveInfo.begin();
+                it != _slaveInfo.end(); ++it) {
+            slaveTimes.push_back(std::make_pair(it->opTime, it->memberID));
+        }
+        std::sort(slaveTimes.begin(), slaveTimes.end(), std::greater<std::pair<OpTime, int> >());
+
+        // The nodes that reached a given optime are a prefix of slaveTimes, so the optime of the
+        // node that completes the pattern is the newest one the pattern is satisfied at.
+        ReplicaSetTagMatch matcher(tagPattern);
+        for (std::vector<std::pair<OpTime, int> >::const_iterator it = slaveTimes.begin();
+                it != slaveTimes.end(); ++it) {
+            const MemberConfig* memberConfig = _rsConfig.findMemberByID(it->second);
+            invariant(memberConfig);
+            for (MemberConfig::TagIterator tag = memberConfig->tagsBegin();
+                    tag != memberConfig->tagsEnd(); ++tag) {
+                if (matcher.update(*tag)) {
+                    return it->first;
+                }
+            }
+        }
+        return OpTime();
+    }
+
     ReplicationCoordinator::StatusAndDuration ReplicationCoordinatorImpl::awaitReplication(
             const OperationContext* txn,
             const OpTime& opTime,
@@ -946,8 +1041,12 @@ namespace {
 
         // Must hold _mutex before constructing waitInfo as it will modify _replicationWaiterList
         boost::condition_variable condVar;
-        WaiterInfo waitInfo(
-                &_replicationWaiterList, txn->getOpID(), &opTime, &writeConcern, &condVar);
+        WaiterInfo waitInfo(&_replicationWaiterList,
+                            &_replicationWaiterQueues,
+                            txn->getOpID(),
+                            &opTime,
+                            &writeConcern,
+                            &condVar);
         while (!_doneWaitingForReplication_inlock(opTime, writeConcern)) {
             const int elapsed = timer->millis();
 
@@ -2030,11 +2129,21 @@ namespace {
      }
 
     void ReplicationCoordinatorImpl::_wakeReadyWaiters_inlock(){
-        for (std::vector<WaiterInfo*>::iterator it = _replicationWaiterList.begin();
-                it != _replicationWaiterList.end(); ++it) {
-            WaiterInfo* info = *it;
-            if (_doneWaitingForReplication_inlock(*info->opTime, *info->writeConcern)) {
-                info->condVar->notify_all();
+        for (WaiterQueueMap::iterator queueIt = _replicationWaiterQueues.begin();
+                queueIt != _replicationWaiterQueues.end(); ++queueIt) {
+            WaiterQueue& queue = queueIt->second;
+            invariant(!queue.empty());
+
+            // All the waiters of a queue share the write concern mode, so any of them tells
+            // which optime the mode has reached.
+            OpTime reached;
+            const WaiterQueue::iterator end =
+                _getWriteConcernReachedOpTime_inlock(*queue.begin()->second->writeConcern,
+                                                     &reached) ?
+                            queue.upper_bound(reached) :
+                            queue.end();
+            for (WaiterQueue::iterator it = queue.begin(); it != end; ++it) {
+                it->second->condVar->notify_all();
             }
         }
     }
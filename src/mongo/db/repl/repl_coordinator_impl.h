@@ -32,6 +32,9 @@
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "mongo/base/status.h"
@@ -292,6 +295,14 @@ namespace repl {
         // Struct that holds information about clients waiting for replication.
         struct WaiterInfo;
 
+        // Clients waiting for replication with the same write concern mode, ordered by the
+        // optime they wait for.
+        typedef std::multimap<OpTime, WaiterInfo*> WaiterQueue;
+
+        // WaiterQueues keyed by the write concern mode, which is (wNumNodes, "") for numeric
+        // write concerns and (0, wMode) for named ones.
+        typedef std::map<std::pair<int, std::string>, WaiterQueue> WaiterQueueMap;
+
         // Struct that holds information about nodes in this replication group, mainly used for
         // tracking replication progress for write concern satisfaction.
         struct SlaveInfo {
@@ -361,6 +372,8 @@ namespace repl {
 
         /**
          * Helper to wake waiters in _replicationWaiterList that are doneWaitingForReplication.
+         * Computes the optime reached by each write concern mode once, and only visits the
+         * waiters of a mode that are done.
          */
         void _wakeReadyWaiters_inlock();
 
@@ -450,6 +463,26 @@ namespace repl {
         bool _haveTaggedNodesReachedOpTime_inlock(const OpTime& opTime,
                                                   const ReplicaSetTagPattern& tagPattern);
 
+        /**
+         * Sets "reached" to the newest optime that satisfies the given writeConcern, which is
+         * null if no optime does yet.  Returns false if the writeConcern is unsatisfiable, in
+         * which case waiting for any optime is done.
+         */
+        bool _getWriteConcernReachedOpTime_inlock(const WriteConcernOptions& writeConcern,
+                                                  OpTime* reached);
+
+        /**
+         * Returns the newest optime that both this node and at least numNodes nodes have
+         * reached, or a null OpTime if there is none.
+         */
+        OpTime _getNumNodesReachedOpTime_inlock(int numNodes);
+
+        /**
+         * Returns the newest optime that nodes satisfying the tag pattern have reached, or a
+         * null OpTime if there is none.
+         */
+        OpTime _getTaggedNodesReachedOpTime_inlock(const ReplicaSetTagPattern& tagPattern);
+
         Status _checkIfWriteConcernCanBeSatisfied_inlock(
                 const WriteConcernOptions& writeConcern) const;
 
@@ -790,6 +823,11 @@ namespace repl {
         // WaiterInfos.
         std::vector<WaiterInfo*> _replicationWaiterList;                                  // (M)
 
+        // The same waiters as _replicationWaiterList, grouped by write concern mode and ordered
+        // by optime so that a replication progress update only wakes the ones it satisfies.
+        // Does *not* own the WaiterInfos.
+        WaiterQueueMap _replicationWaiterQueues;                                          // (M)
+
         // Set to true when we are in the process of shutting down replication.
         bool _inShutdown;                                                                 // (M)
 
@@ -33,6 +33,7 @@
 #include <boost/scoped_ptr.hpp>
 
 #include "mongo/client/connpool.h"
+#include "mongo/db/client_basic.h"
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/jsobj.h"
@@ -47,6 +48,7 @@
 #include "mongo/db/storage_options.h"
 #include "mongo/db/wire_version.h"
 #include "mongo/s/write_ops/batched_command_request.h"
+#include "mongo/util/net/message_compression.h"
 
 namespace mongo {
 namespace repl {
@@ -207,6 +209,7 @@ namespace repl {
             result.appendDate("localTime", jsTime());
             result.append("maxWireVersion", maxWireVersion);
             result.append("minWireVersion", minWireVersion);
+            negotiateMessageCompression(cmdObj, ClientBasic::getCurrent()->port(), &result);
             return true;
         }
     } cmdismaster;
@@ -32,6 +32,8 @@
 
 #include "mongo/db/repl/rs_initialsync.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/bson/optime.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
@@ -46,55 +48,176 @@
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
+#include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rslog.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 namespace repl {
+
+    // Number of databases an initial sync pass clones at the same time, each on its own thread
+    // and connection to the sync source
+    MONGO_EXPORT_SERVER_PARAMETER(initialSyncCloneThreads, int, 4);
+
 namespace {
 
+    bool _initialSyncCloneDatabase(OperationContext* txn,
+                                   Cloner& cloner,
+                                   const std::string& host,
+                                   const std::string& db,
+                                   bool dataPass) {
+        if ( dataPass )
+            log() << "initial sync cloning db: " << db;
+        else
+            log() << "initial sync cloning indexes for : " << db;
+
+        string err;
+        int errCode;
+        CloneOptions options;
+        options.fromDB = db;
+        options.logForRepl = false;
+        options.slaveOk = true;
+        options.useReplAuth = true;
+        options.snapshot = false;
+        options.mayYield = true;
+        options.mayBeInterrupted = false;
+        options.syncData = dataPass;
+        options.syncIndexes = ! dataPass;
+
+        // Make database stable
+        Lock::DBLock dbWrite(txn->lockState(), db, MODE_X);
+
+        if (!cloner.go(txn, db, host, options, NULL, err, &errCode)) {
+            log() << "initial sync: error while "
+                  << (dataPass ? "cloning " : "indexing ") << db
+                  << ".  " << (err.empty() ? "" : err + ".  ");
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Clones the databases of one initial sync pass on several threads. Each thread has its own
+     * Cloner, and so its own connection to the sync source, and clones one database at a time.
+     */
+    class ParallelDatabaseClone {
+        MONGO_DISALLOW_COPYING(ParallelDatabaseClone);
+    public:
+        ParallelDatabaseClone(const std::string& host,
+                              const std::vector<std::string>& dbs,
+                              bool dataPass)
+            : _host(host),
+              _dbs(dbs),
+              _dataPass(dataPass),
+              _mutex("ParallelDatabaseClone"),
+              _nextDb(0),
+              _failed(false),
+              _exceptionStatus(Status::OK()) {
+        }
+
+        // Body of each cloner thread
+        void run(int threadNumber) {
+            const std::string threadName = str::stream() << "initial sync cloner " << threadNumber;
+            Client::initThread(threadName.c_str());
+            replLocalAuth();
+
+            try {
+                OperationContextImpl txn;
+                Cloner cloner;
+                std::string db;
+                while (_nextDatabase(&db)) {
+                    if (!_initialSyncCloneDatabase(&txn, cloner, _host, db, _dataPass)) {
+                        _fail(Status::OK());
+                    }
+                }
+            }
+            catch (const DBException& e) {
+                _fail(e.toStatus());
+            }
+
+            cc().shutdown();
+        }
+
+        /**
+         * Returns false if cloning a database failed, after the threads are joined. Rethrows
+         * the first exception of a cloner thread, as the serial clone would have thrown it.
+         */
+        bool succeeded() const {
+            uassertStatusOK(_exceptionStatus);
+            return !_failed;
+        }
+
+    private:
+        bool _nextDatabase(std::string* db) {
+            mutex::scoped_lock lk(_mutex);
+            if (_failed || _nextDb == _dbs.size()) {
+                return false;
+            }
+            *db = _dbs[_nextDb++];
+            return true;
+        }
+
+        void _fail(const Status& exceptionStatus) {
+            mutex::scoped_lock lk(_mutex);
+            _failed = true;
+            if (_exceptionStatus.isOK()) {
+                _exceptionStatus = exceptionStatus;
+            }
+        }
+
+        const std::string _host;
+        const std::vector<std::string> _dbs;
+        const bool _dataPass;
+
+        mutex _mutex;
+        // Guarded by _mutex
+        size_t _nextDb;
+        bool _failed;
+        Status _exceptionStatus;
+    };
+
     bool _initialSyncClone(OperationContext* txn,
                            Cloner& cloner,
                            const std::string& host,
                            const list<string>& dbs,
                            bool dataPass) {
 
+        std::vector<std::string> toClone;
         for( list<string>::const_iterator i = dbs.begin(); i != dbs.end(); i++ ) {
-            const string db = *i;
-            if( db == "local" ) 
+            if( *i == "local" )
                 continue;
-            
-            if ( dataPass )
-                log() << "initial sync cloning db: " << db;
-            else
-                log() << "initial sync cloning indexes for : " << db;
-
-            string err;
-            int errCode;
-            CloneOptions options;
-            options.fromDB = db;
-            options.logForRepl = false;
-            options.slaveOk = true;
-            options.useReplAuth = true;
-            options.snapshot = false;
-            options.mayYield = true;
-            options.mayBeInterrupted = false;
-            options.syncData = dataPass;
-            options.syncIndexes = ! dataPass;
-
-            // Make database stable
-            Lock::DBLock dbWrite(txn->lockState(), db, MODE_X);
-
-            if (!cloner.go(txn, db, host, options, NULL, err, &errCode)) {
-                log() << "initial sync: error while "
-                      << (dataPass ? "cloning " : "indexing ") << db
-                      << ".  " << (err.empty() ? "" : err + ".  ");
-                return false;
+            toClone.push_back(*i);
+        }
+
+        const size_t maxThreads = std::max(initialSyncCloneThreads, 1);
+        const size_t numThreads = std::min(maxThreads, toClone.size());
+        if (numThreads <= 1) {
+            for (size_t i = 0; i < toClone.size(); i++) {
+                if (!_initialSyncCloneDatabase(txn, cloner, host, toClone[i], dataPass)) {
+                    return false;
+                }
             }
+            return true;
         }
 
-        return true;
+        log() << "initial sync " << (dataPass ? "cloning " : "indexing ") << toClone.size()
+              << " databases on " << numThreads << " threads";
+
+        ParallelDatabaseClone parallelClone(host, toClone, dataPass);
+        boost::thread_group threads;
+        for (size_t i = 0; i < numThreads; i++) {
+            threads.create_thread(stdx::bind(&ParallelDatabaseClone::run,
+                                             &parallelClone,
+                                             static_cast<int>(i)));
+        }
+        threads.join_all();
+
+        return parallelClone.succeeded();
     }
 
     /**
@@ -33,6 +33,8 @@
 
 #include "mongo/db/repl/rs_rollback.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
 #include "mongo/db/client.h"
@@ -52,7 +54,11 @@
 #include "mongo/db/repl/repl_coordinator.h"
 #include "mongo/db/repl/repl_coordinator_impl.h"
 #include "mongo/db/repl/rslog.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/log.h"
+#include "mongo/util/timer.h"
 
 /* Scenarios
  *
@@ -94,8 +100,20 @@
 
 namespace mongo {
 namespace repl {
+
+    // Number of connections to the sync source over which rollback refetches documents
+    MONGO_EXPORT_SERVER_PARAMETER(rollbackRefetchConnections, int, 4);
+
 namespace {
 
+    // Bounds of the _ids refetched by one query
+    const size_t kRefetchBatchMaxDocs = 1000;
+    const int kRefetchBatchMaxIdBytes = 1024 * 1024;
+
+    // How often the common point search and the refetch report their progress
+    const unsigned long long kCommonPointProgressInterval = 100000;
+    const int kRefetchProgressIntervalSecs = 10;
+
     class RSFatalException : public std::exception {
     public:
         RSFatalException(std::string m = "replica set fatal exception")
@@ -268,20 +286,35 @@ namespace {
         //auto_ptr<DBClientCursor> u = us->query(rsoplog, query, 0, 0, &fields, 0, 0);
 
         fixUpInfo.rbid = getRBID(them);
-        auto_ptr<DBClientCursor> oplogCursor = them->query(rsoplog, query, 0, 0, &fields, 0, 0);
+        OpTime ourTime = ourObj["ts"]._opTime();
 
-        if (oplogCursor.get() == NULL || !oplogCursor->more())
+        // The sync source's newest op, to judge how far apart the logs are
+        const BSONObj theirLastObj = them->findOne(rsoplog, query, &fields);
+        if (theirLastObj.isEmpty())
             throw RSFatalException("remote oplog empty or unreadable");
+        const OpTime theirLastTime = theirLastObj["ts"]._opTime();
+
+        // The common point is not newer than our newest op, so the sync source skips its newer
+        // ops itself instead of sending them all over to be stepped past one at a time.
+        BSONObjBuilder notNewerThanOurs;
+        notNewerThanOurs.appendTimestamp("$lte", ourTime.asDate());
+        const Query notNewerQuery = Query(BSON("ts" << notNewerThanOurs.obj()))
+                                        .sort(reverseNaturalObj);
+        auto_ptr<DBClientCursor> oplogCursor = them->query(rsoplog, notNewerQuery, 0, 0, &fields,
+                                                           0, 0);
+
+        if (oplogCursor.get() == NULL || !oplogCursor->more())
+            throw RSFatalException("RS100 reached beginning of remote oplog [0]");
 
-        OpTime ourTime = ourObj["ts"]._opTime();
         BSONObj theirObj = oplogCursor->nextSafe();
         OpTime theirTime = theirObj["ts"]._opTime();
 
         long long diff = static_cast<long long>(ourTime.getSecs())
-                               - static_cast<long long>(theirTime.getSecs());
+                               - static_cast<long long>(theirLastTime.getSecs());
         // diff could be positive, negative, or zero
         log() << "replSet info rollback our last optime:   " << ourTime.toStringPretty() << rsLog;
-        log() << "replSet info rollback their last optime: " << theirTime.toStringPretty() << rsLog;
+        log() << "replSet info rollback their last optime: " << theirLastTime.toStringPretty()
+              << rsLog;
         log() << "replSet info rollback diff in end of log times: " << diff << " seconds" << rsLog;
         if (diff > 1800) {
             log() << "replSet rollback too long a time period for a rollback." << rsLog;
@@ -292,6 +325,11 @@ namespace {
         unsigned long long scanned = 0;
         while (1) {
             scanned++;
+            if (scanned % kCommonPointProgressInterval == 0) {
+                log() << "replSet rollback findcommonpoint scanned " << scanned
+                      << " so far, at our " << ourTime.toStringPretty() << " and their "
+                      << theirTime.toStringPretty() << rsLog;
+            }
             // todo add code to assure no excessive scanning for too long
             if (ourTime == theirTime) {
                 if (ourObj["h"].Long() == theirObj["h"].Long()) {
@@ -360,6 +398,215 @@ namespace {
         }
     }
 
+    // The documents of one collection which one query refetches from the sync source
+    struct RefetchBatch {
+        std::string ns;
+        std::vector<DocID> docs;
+
+        // The good version of each of docs, in the same order; empty if it is gone
+        std::vector<BSONObj> goodVersions;
+    };
+
+    void makeRefetchBatches(const set<DocID>& toRefetch, std::vector<RefetchBatch>* batches) {
+        int idBytes = 0;
+        for (set<DocID>::const_iterator it = toRefetch.begin(); it != toRefetch.end(); ++it) {
+            verify(!it->_id.eoo());
+            if (batches->empty() ||
+                    batches->back().ns != it->ns ||
+                    batches->back().docs.size() >= kRefetchBatchMaxDocs ||
+                    idBytes >= kRefetchBatchMaxIdBytes) {
+                batches->push_back(RefetchBatch());
+                batches->back().ns = it->ns;
+                idBytes = 0;
+            }
+            batches->back().docs.push_back(*it);
+            idBytes += it->_id.size();
+        }
+    }
+
+    /**
+     * Fetches the current versions of the documents of 'batch' with one $in query on _id.
+     * Returns the total size of the fetched documents.
+     */
+    unsigned long long refetchBatch(DBClientBase* them, RefetchBatch* batch) {
+        unsigned long long size = 0;
+        batch->goodVersions.reserve(batch->docs.size());
+
+        BSONObjBuilder query;
+        {
+            BSONObjBuilder idCondition(query.subobjStart("_id"));
+            BSONArrayBuilder ids(idCondition.subarrayStart("$in"));
+            for (size_t i = 0; i < batch->docs.size(); i++) {
+                // $in matches a regex against the _id instead of comparing, so those documents
+                // are fetched one at a time below
+                if (batch->docs[i]._id.type() != RegEx) {
+                    ids.append(batch->docs[i]._id);
+                }
+            }
+        }
+
+        typedef std::map<BSONElement, BSONObj, BSONElementCmpWithoutField> DocsById;
+        DocsById found;
+        auto_ptr<DBClientCursor> cursor = them->query(batch->ns, query.obj(), 0, 0, NULL,
+                                                      QueryOption_SlaveOk);
+        uassert(ErrorCodes::HostUnreachable,
+                str::stream() << "rollback couldn't query " << batch->ns,
+                cursor.get());
+        while (cursor->more()) {
+            BSONObj good = cursor->nextSafe().getOwned();
+            found[good["_id"]] = good;
+        }
+
+        for (size_t i = 0; i < batch->docs.size(); i++) {
+            const DocID& doc = batch->docs[i];
+            BSONObj good;
+            if (doc._id.type() == RegEx) {
+                good = them->findOne(doc.ns, doc._id.wrap(), NULL, QueryOption_SlaveOk).getOwned();
+            }
+            else {
+                DocsById::const_iterator it = found.find(doc._id);
+                if (it != found.end()) {
+                    good = it->second;
+                }
+            }
+
+            // note good might be eoo, indicating we should delete it
+            size += good.objsize();
+            batch->goodVersions.push_back(good);
+        }
+
+        return size;
+    }
+
+    /**
+     * Refetches the batches on several threads, each with its own connection to the sync
+     * source, and reports the progress.
+     */
+    class ParallelRefetcher {
+        MONGO_DISALLOW_COPYING(ParallelRefetcher);
+    public:
+        ParallelRefetcher(const std::string& host,
+                          std::vector<RefetchBatch>* batches,
+                          size_t numDocs)
+            : _host(host),
+              _batches(batches),
+              _numDocs(numDocs),
+              _mutex("ParallelRefetcher"),
+              _nextBatch(0),
+              _numFetched(0),
+              _totalSize(0),
+              _status(Status::OK()) {
+        }
+
+        // Body of each refetch thread
+        void run(int threadNumber) {
+            const std::string threadName = str::stream() << "rollback refetch " << threadNumber;
+            Client::initThread(threadName.c_str());
+
+            try {
+                DBClientConnection conn(false, 0, OplogReader::tcp_timeout);
+                std::string errmsg;
+                uassert(ErrorCodes::HostUnreachable,
+                        str::stream() << "rollback couldn't connect to " << _host << ": "
+                                      << errmsg,
+                        conn.connect(HostAndPort(_host), errmsg) && replAuthenticate(&conn));
+
+                RefetchBatch* batch;
+                while ((batch = _takeBatch())) {
+                    _batchDone(*batch, refetchBatch(&conn, batch));
+                }
+            }
+            catch (const DBException& e) {
+                mutex::scoped_lock lk(_mutex);
+                if (_status.isOK()) {
+                    _status = e.toStatus();
+                }
+            }
+
+            cc().shutdown();
+        }
+
+        /**
+         * Called after the threads are joined. Rethrows the first exception of a refetch thread.
+         */
+        void checkSucceeded() const {
+            uassertStatusOK(_status);
+        }
+
+    private:
+        RefetchBatch* _takeBatch() {
+            mutex::scoped_lock lk(_mutex);
+            if (!_status.isOK() || _nextBatch == _batches->size()) {
+                return NULL;
+            }
+            return &(*_batches)[_nextBatch++];
+        }
+
+        void _batchDone(const RefetchBatch& batch, unsigned long long size) {
+            mutex::scoped_lock lk(_mutex);
+            _numFetched += batch.docs.size();
+            _totalSize += size;
+            uassert(13410, "replSet too much data to roll back", _totalSize < 300 * 1024 * 1024);
+
+            if (_progressTimer.seconds() >= kRefetchProgressIntervalSecs) {
+                log() << "replSet rollback refetched " << _numFetched << '/' << _numDocs
+                      << " documents" << rsLog;
+                _progressTimer.reset();
+            }
+        }
+
+        const std::string _host;
+        std::vector<RefetchBatch>* const _batches;
+        const size_t _numDocs;
+
+        mutex _mutex;
+        // Guarded by _mutex
+        size_t _nextBatch;
+        size_t _numFetched;
+        unsigned long long _totalSize;
+        Status _status;
+        Timer _progressTimer;
+    };
+
+    void refetchGoodVersions(DBClientConnection* them,
+                             const set<DocID>& toRefetch,
+                             list< pair<DocID, BSONObj> >* goodVersions) {
+        std::vector<RefetchBatch> batches;
+        makeRefetchBatches(toRefetch, &batches);
+
+        const size_t maxThreads = std::max(rollbackRefetchConnections, 1);
+        const size_t numThreads = std::min(maxThreads, batches.size());
+        log() << "replSet rollback refetching " << toRefetch.size() << " documents in "
+              << batches.size() << " batches over " << numThreads << " connections" << rsLog;
+
+        if (numThreads <= 1) {
+            unsigned long long totalSize = 0;
+            for (size_t i = 0; i < batches.size(); i++) {
+                totalSize += refetchBatch(them, &batches[i]);
+                uassert(13410, "replSet too much data to roll back",
+                        totalSize < 300 * 1024 * 1024);
+            }
+        }
+        else {
+            ParallelRefetcher refetcher(them->getServerAddress(), &batches, toRefetch.size());
+            boost::thread_group threads;
+            for (size_t i = 0; i < numThreads; i++) {
+                threads.create_thread(stdx::bind(&ParallelRefetcher::run,
+                                                 &refetcher,
+                                                 static_cast<int>(i)));
+            }
+            threads.join_all();
+            refetcher.checkSucceeded();
+        }
+
+        for (size_t i = 0; i < batches.size(); i++) {
+            for (size_t j = 0; j < batches[i].docs.size(); j++) {
+                goodVersions->push_back(make_pair(batches[i].docs[j],
+                                                  batches[i].goodVersions[j]));
+            }
+        }
+    }
+
     bool copyCollectionFromRemote(OperationContext* txn,
                                   const string& host,
                                   const string& ns,
@@ -383,36 +630,13 @@ namespace {
 
         // fetch all first so we needn't handle interruption in a fancy way
 
-        unsigned long long totalSize = 0;
-
         list< pair<DocID, BSONObj> > goodVersions;
 
         BSONObj newMinValid;
 
         // fetch all the goodVersions of each document from current primary
-        DocID doc;
-        unsigned long long numFetched = 0;
         try {
-            for (set<DocID>::iterator it = fixUpInfo.toRefetch.begin();
-                    it != fixUpInfo.toRefetch.end();
-                    it++) {
-                doc = *it;
-
-                verify(!doc._id.eoo());
-
-                {
-                    // TODO : slow.  lots of round trips.
-                    numFetched++;
-                    BSONObj good = them->findOne(doc.ns, doc._id.wrap(),
-                                                     NULL, QueryOption_SlaveOk).getOwned();
-                    totalSize += good.objsize();
-                    uassert(13410, "replSet too much data to roll back",
-                            totalSize < 300 * 1024 * 1024);
-
-                    // note good might be eoo, indicating we should delete it
-                    goodVersions.push_back(pair<DocID, BSONObj>(doc,good));
-                }
-            }
+            refetchGoodVersions(them, fixUpInfo.toRefetch, &goodVersions);
             newMinValid = oplogreader->getLastOp(rsoplog);
             if (newMinValid.isEmpty()) {
                 error() << "rollback error newMinValid empty?";
@@ -421,8 +645,8 @@ namespace {
         }
         catch (DBException& e) {
             LOG(1) << "rollback re-get objects: " << e.toString();
-            error() << "rollback couldn't re-get ns:" << doc.ns << " _id:" << doc._id << ' '
-                    << numFetched << '/' << fixUpInfo.toRefetch.size() << rsLog;
+            error() << "rollback couldn't re-get the " << fixUpInfo.toRefetch.size()
+                    << " documents to roll back" << rsLog;
             throw e;
         }
 
@@ -36,12 +36,15 @@
 #include "third_party/murmurhash3/MurmurHash3.h"
 
 #include "mongo/base/counter.h"
+#include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/global_environment_experiment.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/prefetch.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/minvalid.h"
@@ -49,23 +52,54 @@
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rslog.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
 namespace repl {
 #ifdef MONGO_PLATFORM_64
-    const int replWriterThreadCount = 16;
+    int replWriterThreadCount = 16;
     const int replPrefetcherThreadCount = 16;
 #else
-    const int replWriterThreadCount = 2;
+    int replWriterThreadCount = 2;
     const int replPrefetcherThreadCount = 2;
 #endif
 
+    const int kMaxReplWriterThreadCount = 256;
+
+    class ExportedWriterThreadCountParameter : public ExportedServerParameter<int> {
+    public:
+        ExportedWriterThreadCountParameter() :
+            ExportedServerParameter<int>(ServerParameterSet::getGlobal(),
+                                         "replWriterThreadCount",
+                                         &replWriterThreadCount,
+                                         true,
+                                         false) {}
+
+        virtual Status validate(const int& potentialNewValue) {
+            if (potentialNewValue < 1 || potentialNewValue > kMaxReplWriterThreadCount) {
+                return Status(ErrorCodes::BadValue, str::stream()
+                              << "replWriterThreadCount must be between 1 and "
+                              << kMaxReplWriterThreadCount);
+            }
+            return Status::OK();
+        }
+    } exportedWriterThreadCountParam;
+
+    // Ops are split among more writer vectors than there are writers, so that a writer which is
+    // done with a short vector picks up another one instead of idling behind a long one.
+    const int replWriterVectorsPerThread = 4;
+
     static Counter64 opsAppliedStats;
 
     //The oplog entries applied
@@ -74,11 +108,81 @@ namespace repl {
 
     MONGO_FP_DECLARE(rsSyncApplyStop);
 
+    // How long applying a batch should take, to which the number of operations in a batch is
+    // adapted. 0 keeps the limit at replBatchLimitOperations.
+    MONGO_EXPORT_SERVER_PARAMETER(replBatchApplyTargetMillis, int, 250);
+
     // Number and time of each ApplyOps worker pool round
     static TimerStats applyBatchStats;
     static ServerStatusMetricField<TimerStats> displayOpBatchesApplied(
                                                     "repl.apply.batches",
                                                     &applyBatchStats );
+
+    // CRUD ops which went to the writer of their collection rather than of their document, as
+    // the collection needs its ops applied in order (see allowsDocumentParallelism)
+    static Counter64 opsSerializedByCollectionStats;
+    static ServerStatusMetricField<Counter64> displayOpsSerializedByCollection(
+                                                    "repl.apply.opsSerializedByCollection",
+                                                    &opsSerializedByCollectionStats );
+
+namespace {
+    // Lifetime work of each writer thread, so uneven use of the writers shows
+    struct WriterStats {
+        AtomicUInt64 tasks;
+        AtomicUInt64 ops;
+        AtomicUInt64 busyMicros;
+    };
+
+    WriterStats writerStats[kMaxReplWriterThreadCount];
+
+    // Writer threads number themselves on their first task, 0 until then
+    AtomicUInt32 writerThreadsNumbered;
+    ThreadLocalValue<int> writerThreadNumber;
+
+    WriterStats& getWriterStatsForThisThread() {
+        if (writerThreadNumber.get() == 0) {
+            writerThreadNumber.set(writerThreadsNumbered.addAndFetch(1));
+        }
+        return writerStats[(writerThreadNumber.get() - 1) % kMaxReplWriterThreadCount];
+    }
+
+    class WriterStatsMetric : public ServerStatusMetric {
+    public:
+        WriterStatsMetric() : ServerStatusMetric("repl.apply.writers") { }
+
+        virtual void appendAtLeaf(BSONObjBuilder& b) const {
+            const int numWriters = std::min(static_cast<int>(writerThreadsNumbered.load()),
+                                            kMaxReplWriterThreadCount);
+
+            BSONArrayBuilder writersBuilder(b.subarrayStart(_leafName));
+            for (int i = 0; i < numWriters; i++) {
+                BSONObjBuilder writerBuilder(writersBuilder.subobjStart());
+                writerBuilder.appendNumber("tasks",
+                                           static_cast<long long>(writerStats[i].tasks.load()));
+                writerBuilder.appendNumber("ops",
+                                           static_cast<long long>(writerStats[i].ops.load()));
+                writerBuilder.appendNumber(
+                        "busyMillis",
+                        static_cast<long long>(writerStats[i].busyMicros.load() / 1000));
+                writerBuilder.done();
+            }
+            writersBuilder.done();
+        }
+    } writerStatsMetric;
+
+    // Runs on a writer thread to apply one writer vector
+    void applyWriterVector(SyncTail::MultiSyncApplyFunc applyFunc,
+                           const std::vector<BSONObj>* ops,
+                           SyncTail* st) {
+        Timer timer;
+        applyFunc(*ops, st);
+
+        WriterStats& stats = getWriterStatsForThisThread();
+        stats.tasks.fetchAndAdd(1);
+        stats.ops.fetchAndAdd(ops->size());
+        stats.busyMicros.fetchAndAdd(timer.micros());
+    }
+} // namespace
     void initializePrefetchThread() {
         if (!ClientBasic::getCurrent()) {
             Client::initThreadIfNotAlready();
@@ -185,6 +289,43 @@ namespace repl {
             return hash;
         }
 
+        /**
+         * Whether ops on different documents of the collection may be applied in any order
+         * relative to each other. They may not for capped collections, which keep documents in
+         * insertion order, nor for collections with unique secondary indexes, where an op taking
+         * a key must come after the op which freed it.
+         */
+        bool allowsDocumentParallelism(OperationContext* txn, const StringData& ns) {
+            const StringData dbName = nsToDatabaseSubstring(ns);
+            Lock::DBLock dbLock(txn->lockState(), dbName, MODE_IS);
+            Lock::CollectionLock collLock(txn->lockState(), ns, MODE_IS);
+
+            // Collections created by the batch only have the _id index, as index builds and
+            // commands are batched on their own
+            Database* db = dbHolder().get(txn, dbName);
+            if (!db) {
+                return true;
+            }
+            Collection* collection = db->getCollection(txn, ns);
+            if (!collection) {
+                return true;
+            }
+
+            if (collection->isCapped()) {
+                return false;
+            }
+
+            IndexCatalog::IndexIterator ii =
+                collection->getIndexCatalog()->getIndexIterator(txn, true);
+            while (ii.more()) {
+                const IndexDescriptor* desc = ii.next();
+                if (desc->unique() && !desc->isIdIndex()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
         size_t hashBSONObj(const BSONObj& obj) {
             size_t hash = 0;
             BSONForEach(elem, obj) {
@@ -199,6 +340,7 @@ namespace repl {
         Sync(""), 
         _networkQueue(q), 
         _applyFunc(func),
+        _batchLimitOperations(replBatchLimitOperations),
         _writerPool(replWriterThreadCount, "repl writer worker "),
         _prefetcherPool(replPrefetcherThreadCount, "repl prefetch worker ")
     {}
@@ -292,7 +434,9 @@ namespace repl {
                 // for multiple prefetches if they are for the same database.
                 OperationContextImpl txn;
                 AutoGetCollectionForRead ctx(&txn, ns);
-                prefetchPagesForReplicatedOp(&txn, ctx.getDb(), op);
+                if (ctx.getDb()) {
+                    prefetchPagesForReplicatedOp(&txn, ctx.getDb(), op);
+                }
             }
             catch (const DBException& e) {
                 LOG(2) << "ignoring exception in prefetchOp(): " << e.what() << endl;
@@ -304,38 +448,59 @@ namespace repl {
         }
     }
 
-    // Doles out all the work to the reader pool threads and waits for them to complete
-    void SyncTail::prefetchOps(const std::deque<BSONObj>& ops) {
-        for (std::deque<BSONObj>::const_iterator it = ops.begin();
-             it != ops.end();
-             ++it) {
-            _prefetcherPool.schedule(&prefetchOp, *it);
+    void SyncTail::schedulePrefetch(const BSONObj& op) {
+        _prefetcherPool.schedule(&prefetchOp, op);
+    }
+
+    void SyncTail::_adaptBatchLimitOperations(size_t numOps, long long applyMicros) {
+        const int targetMillis = replBatchApplyTargetMillis;
+        if (targetMillis <= 0) {
+            _batchLimitOperations = replBatchLimitOperations;
+            return;
         }
-        _prefetcherPool.join();
+
+        // Small batches say little about the throughput, as their fixed costs dominate
+        if (numOps < replBatchLimitOperationsMin) {
+            return;
+        }
+
+        const double opsPerMicro = static_cast<double>(numOps) / std::max(applyMicros, 1LL);
+        const double targetOps = opsPerMicro * targetMillis * 1000;
+
+        // Move a quarter of the way to the target, so one slow batch does not halve the next
+        const double limit = (3.0 * _batchLimitOperations + targetOps) / 4;
+        _batchLimitOperations = static_cast<unsigned int>(
+                std::min(std::max(limit, static_cast<double>(replBatchLimitOperationsMin)),
+                         static_cast<double>(replBatchLimitOperationsMax)));
     }
     
     // Doles out all the work to the writer pool threads and waits for them to complete
     void SyncTail::applyOps(const std::vector< std::vector<BSONObj> >& writerVectors) {
         TimerHolder timer(&applyBatchStats);
+        std::vector<threadpool::Task> tasks;
         for (std::vector< std::vector<BSONObj> >::const_iterator it = writerVectors.begin();
              it != writerVectors.end();
              ++it) {
             if (!it->empty()) {
-                _writerPool.schedule(_applyFunc, boost::cref(*it), this);
+                tasks.push_back(stdx::bind(&applyWriterVector, _applyFunc, &(*it), this));
             }
         }
+        _writerPool.scheduleBatch(tasks);
         _writerPool.join();
     }
 
     // Doles out all the work to the writer pool threads and waits for them to complete
     OpTime SyncTail::multiApply( std::deque<BSONObj>& ops) {
 
-        // Use a ThreadPool to prefetch all the operations in a batch.
-        prefetchOps(ops);
-        
-        std::vector< std::vector<BSONObj> > writerVectors(replWriterThreadCount);
+        // The ops of the batch were handed to the prefetcher pool as they were gathered (see
+        // tryPopAndWaitForMore), so only the prefetches still running are waited for.
+        _prefetcherPool.join();
+
+        std::vector< std::vector<BSONObj> > writerVectors(replWriterThreadCount *
+                                                          replWriterVectorsPerThread);
         fillWriterVectors(ops, &writerVectors);
-        LOG(2) << "replication batch size is " << ops.size() << endl;
+        LOG(2) << "replication batch size is " << ops.size()
+               << " (limit " << _batchLimitOperations << " ops)" << endl;
         // We must grab this because we're going to grab write locks later.
         // We hold this mutex the entire time we're writing; it doesn't matter
         // because all readers are blocked anyway.
@@ -352,14 +517,29 @@ namespace repl {
             fassertFailed(28527);
         }
 
+        const size_t numOps = ops.size();
+        Timer applyTimer;
+
         applyOps(writerVectors);
-        return applyOpsToOplog(&ops);
+        const OpTime lastOpTime = applyOpsToOplog(&ops);
+
+        _adaptBatchLimitOperations(numOps, applyTimer.micros());
+        return lastOpTime;
     }
 
 
     void SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops,
                                      std::vector< std::vector<BSONObj> >* writerVectors) {
 
+        const bool supportsDocLocking =
+            getGlobalEnvironment()->getGlobalStorageEngine()->supportsDocLocking();
+
+        // Without document locking the lock of the collection serializes its writers anyway, so
+        // its ops all go to one writer, also keeping the order of unique key changes
+        scoped_ptr<OperationContextImpl> txn;
+        typedef unordered_map<std::string, bool> CollectionParallelismMap;
+        CollectionParallelismMap collectionParallelism;
+
         for (std::deque<BSONObj>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
@@ -372,27 +552,42 @@ namespace repl {
 
             const char* opType = it->getField( "op" ).value();
 
-            if (getGlobalEnvironment()->getGlobalStorageEngine()->supportsDocLocking() &&
-                isCrudOpType(opType)) {
-                BSONElement id;
-                switch (opType[0]) {
-                case 'u':
-                    id = it->getField("o2").Obj()["_id"];
-                    break;
-                case 'd':
-                case 'i':
-                    id = it->getField("o").Obj()["_id"];
-                    break;
+            if (supportsDocLocking && isCrudOpType(opType)) {
+                CollectionParallelismMap::iterator parallelism = collectionParallelism.find(ns);
+                if (parallelism == collectionParallelism.end()) {
+                    if (!txn) {
+                        txn.reset(new OperationContextImpl());
+                    }
+                    parallelism = collectionParallelism.insert(
+                            std::make_pair(std::string(ns),
+                                           allowsDocumentParallelism(txn.get(), ns))).first;
                 }
 
-                size_t idHash = hashBSONElement( id );
-                boost::hash_combine(idHash, hash);
-                hash = idHash;
+                if (parallelism->second) {
+                    BSONElement id;
+                    switch (opType[0]) {
+                    case 'u':
+                        id = it->getField("o2").Obj()["_id"];
+                        break;
+                    case 'd':
+                    case 'i':
+                        id = it->getField("o").Obj()["_id"];
+                        break;
+                    }
+
+                    size_t idHash = hashBSONElement( id );
+                    boost::hash_combine(idHash, hash);
+                    hash = idHash;
+                }
+                else {
+                    opsSerializedByCollectionStats.increment();
+                }
             }
 
             (*writerVectors)[hash % writerVectors->size()].push_back(*it);
         }
     }
+
     void SyncTail::oplogApplication(OperationContext* txn, const OpTime& endOpTime) {
         _applyOplogUntil(txn, endOpTime);
     }
@@ -426,7 +621,7 @@ namespace repl {
                 // apply replication batch limits
                 if (ops.getSize() > replBatchLimitBytes)
                     break;
-                if (ops.getDeque().size() > replBatchLimitOperations)
+                if (ops.getDeque().size() > _batchLimitOperations)
                     break;
             };
 
@@ -499,7 +694,7 @@ namespace {
                 if (!ops.empty()) {
                     if (now > replBatchLimitSeconds)
                         break;
-                    if (ops.getDeque().size() > replBatchLimitOperations)
+                    if (ops.getDeque().size() > _batchLimitOperations)
                         break;
                 }
                 // occasionally check some things
@@ -645,6 +840,7 @@ namespace {
                 // apply commands one-at-a-time
                 ops->push_back(op);
                 _networkQueue->consume();
+                schedulePrefetch(op);
             }
 
             // otherwise, apply what we have so far and come back for the command
@@ -670,6 +866,9 @@ namespace {
         ops->push_back(op);
         _networkQueue->consume();
 
+        // Prefetching overlaps with waiting for the rest of the batch
+        schedulePrefetch(op);
+
         // Go back for more ops
         return false;
     }
@@ -46,8 +46,9 @@ namespace repl {
      * "Normal" replica set syncing
      */
     class SyncTail : public Sync {
-        typedef void (*MultiSyncApplyFunc)(const std::vector<BSONObj>& ops, SyncTail* st);
     public:
+        typedef void (*MultiSyncApplyFunc)(const std::vector<BSONObj>& ops, SyncTail* st);
+
         SyncTail(BackgroundSyncInterface *q, MultiSyncApplyFunc func);
         virtual ~SyncTail();
         virtual bool syncApply(OperationContext* txn,
@@ -94,7 +95,12 @@ namespace repl {
         // This works out to be 100 MB (64 bit) or 50 MB (32 bit)
         static const unsigned int replBatchLimitBytes = dur::UncommittedBytesLimit;
         static const int replBatchLimitSeconds = 1;
+
+        // The operation limit of the first batch. Later batches are sized by the apply
+        // throughput (see _adaptBatchLimitOperations), between the min and the max.
         static const unsigned int replBatchLimitOperations = 5000;
+        static const unsigned int replBatchLimitOperationsMin = 100;
+        static const unsigned int replBatchLimitOperationsMax = 50000;
 
         // Prefetch and write a deque of operations, using the supplied function.
         // Initial Sync and Sync Tail each use a different function.
@@ -121,11 +127,21 @@ namespace repl {
         // Function to use during applyOps
         MultiSyncApplyFunc _applyFunc;
 
-        // Doles out all the work to the reader pool threads and waits for them to complete
-        void prefetchOps(const std::deque<BSONObj>& ops);
+        // Hands the op to the reader pool threads, which prefetch it while the rest of the batch
+        // is gathered. multiApply waits for them to complete.
+        void schedulePrefetch(const BSONObj& op);
         // Used by the thread pool readers to prefetch an op
         static void prefetchOp(const BSONObj& op);
 
+        /**
+         * Sets the operation limit of the next batches from the time it took to apply "numOps"
+         * operations, so that a batch blocks readers for about replBatchApplyTargetMillis.
+         */
+        void _adaptBatchLimitOperations(size_t numOps, long long applyMicros);
+
+        // Current operation limit of a batch, only used by the thread applying the batches
+        unsigned int _batchLimitOperations;
+
         // Doles out all the work to the writer pool threads and waits for them to complete
         void applyOps(const std::vector< std::vector<BSONObj> >& writerVectors);
 
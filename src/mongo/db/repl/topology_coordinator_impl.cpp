@@ -53,6 +53,14 @@ namespace repl {
 
     const Seconds TopologyCoordinatorImpl::LastVote::leaseTime = Seconds(30);
 
+    // Milliseconds added to a sync source candidate's ping for each other member already
+    // syncing from it, so that chained secondaries spread over the members that are close.
+    MONGO_EXPORT_SERVER_PARAMETER(syncSourceReaderPenaltyMillis, int, 20);
+
+    // Milliseconds added to a sync source candidate's ping for each second it lags behind the
+    // most up to date member.
+    MONGO_EXPORT_SERVER_PARAMETER(syncSourceLagPenaltyMillisPerSec, int, 10);
+
 namespace {
 
     template <typename T>
@@ -216,7 +224,20 @@ namespace {
 
         OpTime oldestSyncOpTime(primaryOpTime.getSecs() - _maxSyncSourceLagSecs.total_seconds(), 0);
 
+        // Candidates are ranked by _getSyncSourceCost, which charges for lagging behind the most
+        // up to date member we know of.
+        OpTime newestOpTime;
+        for (std::vector<MemberHeartbeatData>::const_iterator it = _hbdata.begin();
+             it != _hbdata.end();
+             ++it) {
+            if (indexOfIterator(_hbdata, it) != _selfIndex && it->up() &&
+                    newestOpTime < it->getOpTime()) {
+                newestOpTime = it->getOpTime();
+            }
+        }
+
         int closestIndex = -1;
+        long long closestCost = 0;
 
         // Make two attempts.  The first attempt, we ignore those nodes with
         // slave delay higher than our own, hidden nodes, and nodes that are excessively lagged.
@@ -260,10 +281,9 @@ namespace {
                     continue;
                 }
 
-                // omit nodes that are more latent than anything we've already considered
-                if ((closestIndex != -1) &&
-                    (_getPing(itMemberConfig.getHostAndPort())
-                     > _getPing(_currentConfig.getMemberAt(closestIndex).getHostAndPort()))) {
+                // omit nodes that are more costly than anything we've already considered
+                const long long itCost = _getSyncSourceCost(itIndex, newestOpTime);
+                if ((closestIndex != -1) && (itCost > closestCost)) {
                     continue;
                 }
 
@@ -294,6 +314,7 @@ namespace {
                 }
                 // This candidate has passed all tests; set 'closestIndex'
                 closestIndex = itIndex;
+                closestCost = itCost;
             }
             if (closestIndex != -1) break; // no need for second attempt
         }
@@ -308,6 +329,9 @@ namespace {
             return _syncSource;
         }
         _syncSource = _currentConfig.getMemberAt(closestIndex).getHostAndPort();
+        LOG(2) << "chose sync source " << _syncSource << " with ping "
+               << _getPing(_syncSource) << "ms, " << _getNumDownstreamReaders(closestIndex)
+               << " downstream readers and cost " << closestCost;
         std::string msg(str::stream() << "syncing from: " << _syncSource.toString(), 0);
         log() << msg << rsLog;
         setMyHeartbeatMessage(now, msg);
@@ -1767,6 +1791,38 @@ namespace {
         return _pings[host].getMillis();
     }
 
+    int TopologyCoordinatorImpl::_getNumDownstreamReaders(int candidateIndex) const {
+        const std::string candidate =
+            _currentConfig.getMemberAt(candidateIndex).getHostAndPort().toString();
+        int numReaders = 0;
+        for (std::vector<MemberHeartbeatData>::const_iterator it = _hbdata.begin();
+             it != _hbdata.end();
+             ++it) {
+            const int itIndex = indexOfIterator(_hbdata, it);
+            if (itIndex == _selfIndex || itIndex == candidateIndex || !it->up()) {
+                continue;
+            }
+            if (it->getSyncSource() == candidate) {
+                ++numReaders;
+            }
+        }
+        return numReaders;
+    }
+
+    long long TopologyCoordinatorImpl::_getSyncSourceCost(int candidateIndex,
+                                                          const OpTime& newestOpTime) {
+        const MemberHeartbeatData& candidate = _hbdata[candidateIndex];
+        long long cost = _getPing(_currentConfig.getMemberAt(candidateIndex).getHostAndPort());
+        cost += static_cast<long long>(_getNumDownstreamReaders(candidateIndex)) *
+                syncSourceReaderPenaltyMillis;
+        if (candidate.getOpTime().getSecs() < newestOpTime.getSecs()) {
+            cost += static_cast<long long>(newestOpTime.getSecs() -
+                                           candidate.getOpTime().getSecs()) *
+                    syncSourceLagPenaltyMillisPerSec;
+        }
+        return cost;
+    }
+
     void TopologyCoordinatorImpl::_setElectionTime(const OpTime& newElectionTime) {
         _electionTime = newElectionTime;
     }
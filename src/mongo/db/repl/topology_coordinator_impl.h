@@ -236,6 +236,14 @@ namespace repl {
         // Returns the current "ping" value for the given member by their address
         int _getPing(const HostAndPort& host);
 
+        // Returns the number of other up members whose last heartbeat said they sync from the
+        // member at "candidateIndex".
+        int _getNumDownstreamReaders(int candidateIndex) const;
+
+        // Returns the cost of choosing the member at "candidateIndex" as sync source: its ping,
+        // plus penalties for its downstream readers and for how far it lags "newestOpTime".
+        long long _getSyncSourceCost(int candidateIndex, const OpTime& newestOpTime);
+
         // Determines if we will veto the member specified by "memberID", given that the last op
         // we have applied locally is "lastOpApplied".
         // If we veto, the errmsg will be filled in with a reason
@@ -148,7 +148,8 @@ namespace {
                                                     const std::string& setName,
                                                     MemberState memberState,
                                                     OpTime lastOpTimeSender,
-                                                    Milliseconds roundTripTime = Milliseconds(0)) {
+                                                    Milliseconds roundTripTime = Milliseconds(0),
+                                                    const std::string& syncingTo = "") {
             return _receiveHeartbeatHelper(Status::OK(),
                                            member,
                                            setName,
@@ -156,7 +157,8 @@ namespace {
                                            OpTime(),
                                            lastOpTimeSender,
                                            OpTime(),
-                                           roundTripTime);
+                                           roundTripTime,
+                                           syncingTo);
         }
 
     private:
@@ -168,7 +170,8 @@ namespace {
                                                         OpTime electionTime,
                                                         OpTime lastOpTimeSender,
                                                         OpTime lastOpTimeReceiver,
-                                                        Milliseconds roundTripTime) {
+                                                        Milliseconds roundTripTime,
+                                                        const std::string& syncingTo = "") {
             StatusWith<ReplSetHeartbeatResponse> hbResponse =
                     StatusWith<ReplSetHeartbeatResponse>(responseStatus);
 
@@ -178,6 +181,7 @@ namespace {
                 hb.setState(memberState);
                 hb.setOpTime(lastOpTimeSender);
                 hb.setElectionTime(electionTime);
+                hb.setSyncingTo(syncingTo);
                 hbResponse = StatusWith<ReplSetHeartbeatResponse>(hb);
             }
             getTopoCoord().prepareHeartbeatRequest(now()++,
@@ -357,6 +361,52 @@ namespace {
     }
 
 
+    TEST_F(TopoCoordTest, ChooseSyncSourceCostOfReadersAndLag) {
+        updateConfig(BSON("_id" << "rs0" <<
+                          "version" << 1 <<
+                          "members" << BSON_ARRAY(
+                              BSON("_id" << 1 << "host" << "hself") <<
+                              BSON("_id" << 10 << "host" << "h1") <<
+                              BSON("_id" << 20 << "host" << "h2") <<
+                              BSON("_id" << 30 << "host" << "h3") <<
+                              BSON("_id" << 40 << "host" << "h4") <<
+                              BSON("_id" << 50 << "host" << "hprimary"))),
+                     0);
+
+        setSelfMemberState(MemberState::RS_SECONDARY);
+        OpTime lastOpTimeWeApplied = OpTime(100,0);
+
+        // h1 is the closest, but h2, h3 and h4 all sync from it
+        for (int i = 0; i < 2; ++i) {
+            heartbeatFromMember(HostAndPort("h1"), "rs0", MemberState::RS_SECONDARY,
+                                OpTime(200, 0), Milliseconds(10), "hprimary:27017");
+            heartbeatFromMember(HostAndPort("h2"), "rs0", MemberState::RS_SECONDARY,
+                                OpTime(200, 0), Milliseconds(40), "h1:27017");
+            heartbeatFromMember(HostAndPort("h3"), "rs0", MemberState::RS_SECONDARY,
+                                OpTime(200, 0), Milliseconds(1000), "h1:27017");
+            heartbeatFromMember(HostAndPort("h4"), "rs0", MemberState::RS_SECONDARY,
+                                OpTime(200, 0), Milliseconds(1000), "h1:27017");
+            heartbeatFromMember(HostAndPort("hprimary"), "rs0", MemberState::RS_PRIMARY,
+                                OpTime(200, 0), Milliseconds(1000));
+        }
+
+        // h1 costs 10ms plus 3 * 20ms for its readers, h2 only its 40ms ping
+        getTopoCoord().chooseNewSyncSource(now()++, lastOpTimeWeApplied);
+        ASSERT_EQUALS(HostAndPort("h2"), getTopoCoord().getSyncSourceAddress());
+
+        // h3 and h4 go down, so h1 only costs 10ms plus 20ms for h2
+        receiveDownHeartbeat(HostAndPort("h3"), "rs0", OpTime());
+        receiveDownHeartbeat(HostAndPort("h4"), "rs0", OpTime());
+        getTopoCoord().chooseNewSyncSource(now()++, lastOpTimeWeApplied);
+        ASSERT_EQUALS(HostAndPort("h1"), getTopoCoord().getSyncSourceAddress());
+
+        // h1 falls 2 seconds behind the others, which costs it another 20ms
+        heartbeatFromMember(HostAndPort("h1"), "rs0", MemberState::RS_SECONDARY,
+                            OpTime(198, 0), Milliseconds(10), "hprimary:27017");
+        getTopoCoord().chooseNewSyncSource(now()++, lastOpTimeWeApplied);
+        ASSERT_EQUALS(HostAndPort("h2"), getTopoCoord().getSyncSourceAddress());
+    }
+
     TEST_F(TopoCoordTest, ChooseSyncSourceChainingNotAllowed) {
         updateConfig(BSON("_id" << "rs0" <<
                           "version" << 1 <<
@@ -47,11 +47,16 @@
 
 #include "mongo/db/sorter/sorter.h"
 
+#include <boost/bind.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
 #include <snappy.h>
 
+#include "mongo/base/status.h"
 #include "mongo/base/string_data.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/operation_memory_tracker.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/util/assert_util.h"
@@ -162,8 +167,13 @@ namespace mongo {
                 , _done(false)
                 , _fileName(fileName)
                 , _fileDeleter(fileDeleter)
-                , _file(_fileName.c_str(), std::ios::in | std::ios::binary)
+                , _readAheadBuffer(new char[ReadAheadBytes])
             {
+                // Reads several blocks per system call, as the merge reads each file in turn.
+                // Must be set before the file is opened.
+                _file.rdbuf()->pubsetbuf(_readAheadBuffer.get(), ReadAheadBytes);
+                _file.open(_fileName.c_str(), std::ios::in | std::ios::binary);
+
                 massert(16814, str::stream() << "error opening file \"" << _fileName << "\": "
                                              << myErrnoWithDescription(),
                         _file.good());
@@ -190,6 +200,8 @@ namespace mongo {
             }
 
         private:
+            enum { ReadAheadBytes = 256 * 1024 };
+
             void fillIfNeeded() {
                 verify(!_done);
 
@@ -254,10 +266,19 @@ namespace mongo {
             boost::scoped_ptr<BufReader> _reader;
             string _fileName;
             boost::shared_ptr<FileDeleter> _fileDeleter; // Must outlive _file
+            boost::scoped_array<char> _readAheadBuffer; // Must outlive _file
             std::ifstream _file;
         };
 
-        /** Merge-sorts results from 0 or more FileIterators */
+        /**
+         * Merge-sorts results from 0 or more FileIterators.
+         *
+         * The streams play a tournament in a loser tree: each inner node holds the stream which
+         * lost the match played there, and the overall winner is the next result.  Once the
+         * winner advances, it only replays the matches on its way to the root, against their
+         * losers, which takes log2(streams) comparisons per result rather than the up to twice
+         * as many of a binary heap.
+         */
         template <typename Key, typename Value, typename Comparator>
         class MergeIterator : public SortIteratorInterface<Key, Value> {
         public:
@@ -271,34 +292,33 @@ namespace mongo {
                 : _opts(opts)
                 , _remaining(opts.limit ? opts.limit : numeric_limits<unsigned long long>::max())
                 , _first(true)
-                , _greater(comp)
+                , _comp(comp)
             {
+                _streams.reserve(iters.size());
                 for (size_t i = 0; i < iters.size(); i++) {
                     if (iters[i]->more()) {
-                        _heap.push_back(
-                            boost::make_shared<Stream>(i, iters[i]->next(), iters[i]));
+                        // The streams keep the order of 'iters', which breaks ties
+                        _streams.push_back(Stream(iters[i]->next(), iters[i]));
                     }
                 }
 
-                if (_heap.empty()) {
+                _numLive = _streams.size();
+                if (_streams.empty()) {
                     _remaining = 0;
                     return;
                 }
 
-                std::make_heap(_heap.begin(), _heap.end(), _greater);
-                std::pop_heap(_heap.begin(), _heap.end(), _greater);
-                _current = _heap.back();
-                _heap.pop_back();
+                buildTree();
             }
 
             bool more() {
-                if (_remaining > 0 && (_first || !_heap.empty() || _current->more()))
+                if (_remaining > 0 && (_first || _numLive > 1 || _streams[_tree[0]].more()))
                     return true;
 
                 // We are done so clean up resources.
                 // Can't do this in next() due to lifetime guarantees of unowned Data.
-                _heap.clear();
-                _current.reset();
+                _streams.clear();
+                _tree.clear();
                 _remaining = 0;
 
                 return false;
@@ -311,75 +331,277 @@ namespace mongo {
 
                 if (_first) {
                     _first = false;
-                    return _current->current();
+                    return _streams[_tree[0]].current();
                 }
 
-                if (!_current->advance()) {
-                    verify(!_heap.empty());
+                const size_t previousWinner = _tree[0];
+                if (!_streams[previousWinner].advance())
+                    _numLive--;
+                replay(previousWinner);
 
-                    std::pop_heap(_heap.begin(), _heap.end(), _greater);
-                    _current = _heap.back();
-                    _heap.pop_back();
-                } else if (!_heap.empty() && _greater(_current, _heap.front())) {
-                    std::pop_heap(_heap.begin(), _heap.end(), _greater);
-                    std::swap(_current, _heap.back());
-                    std::push_heap(_heap.begin(), _heap.end(), _greater);
-                }
-
-                return _current->current();
+                verify(!_streams[_tree[0]].exhausted());
+                return _streams[_tree[0]].current();
             }
 
 
         private:
             class Stream { // Data + Iterator
             public:
-                Stream(size_t fileNum, const Data& first, boost::shared_ptr<Input> rest)
-                    : fileNum(fileNum)
-                    , _current(first)
+                Stream(const Data& first, boost::shared_ptr<Input> rest)
+                    : _current(first)
                     , _rest(rest)
+                    , _exhausted(false)
                 {}
 
                 const Data& current() const { return _current; }
                 bool more() { return _rest->more(); }
+                bool exhausted() const { return _exhausted; }
                 bool advance() {
-                    if (!_rest->more())
+                    if (!_rest->more()) {
+                        _exhausted = true;
                         return false;
+                    }
 
                     _current = _rest->next();
                     return true;
                 }
 
-                const size_t fileNum;
             private:
                 Data _current;
                 boost::shared_ptr<Input> _rest;
+                bool _exhausted;
             };
 
-            class STLComparator { // uses greater rather than less-than to maintain a MinHeap
-            public:
-                explicit STLComparator(const Comparator& comp) : _comp(comp) {}
-                bool operator () (ptr<const Stream> lhs, ptr<const Stream> rhs) const {
-                    // first compare data
-                    dassertCompIsSane(_comp, lhs->current(), rhs->current());
-                    int ret = _comp(lhs->current(), rhs->current());
-                    if (ret)
-                        return ret > 0;
+            /// Whether stream 'lhs' comes out before stream 'rhs'. Exhausted streams always lose.
+            bool beats(size_t lhs, size_t rhs) const {
+                if (_streams[lhs].exhausted())
+                    return false;
+                if (_streams[rhs].exhausted())
+                    return true;
 
-                    // then compare fileNums to ensure stability
-                    return lhs->fileNum > rhs->fileNum;
+                // first compare data
+                dassertCompIsSane(_comp, _streams[lhs].current(), _streams[rhs].current());
+                const int ret = _comp(_streams[lhs].current(), _streams[rhs].current());
+                if (ret)
+                    return ret < 0;
+
+                // then compare stream order to ensure stability
+                return lhs < rhs;
+            }
+
+            /**
+             * Plays all the matches.  With k streams, the tree has inner nodes 1 to k - 1, node n
+             * having children 2n and 2n + 1, and stream i is the leaf k + i.  _tree[0] holds the
+             * winner.
+             */
+            void buildTree() {
+                const size_t numStreams = _streams.size();
+                std::vector<size_t> winners(2 * numStreams);
+                for (size_t i = 0; i < numStreams; i++)
+                    winners[numStreams + i] = i;
+
+                _tree.resize(numStreams);
+                for (size_t node = numStreams - 1; node > 0; node--) {
+                    const size_t left = winners[2 * node];
+                    const size_t right = winners[2 * node + 1];
+                    const bool leftWins = beats(left, right);
+                    winners[node] = leftWins ? left : right;
+                    _tree[node] = leftWins ? right : left;
                 }
-            private:
-                const Comparator _comp;
-            };
+                _tree[0] = winners[1];
+            }
+
+            /// Replays the matches of 'stream', whose data changed, up to the root.
+            void replay(size_t stream) {
+                size_t winner = stream;
+                for (size_t node = (stream + _streams.size()) / 2; node > 0; node /= 2) {
+                    if (beats(_tree[node], winner))
+                        std::swap(_tree[node], winner);
+                }
+                _tree[0] = winner;
+            }
 
             SortOptions _opts;
             unsigned long long _remaining;
             bool _first;
-            boost::shared_ptr<Stream> _current;
-            std::vector<boost::shared_ptr<Stream> > _heap; // MinHeap
-            STLComparator _greater; // named so calls make sense
+            const Comparator _comp;
+            std::vector<Stream> _streams;
+            std::vector<size_t> _tree; // the loser tree, see buildTree()
+            size_t _numLive; // streams not exhausted
+        };
+
+        /**
+         * Counts a Sorter against SortOptions::memoryBudget, if set, while it may still be given
+         * data, and tells it how much memory it may use.  Also reports that memory to
+         * SortOptions::memoryTracker, if set, which may want it back sooner.
+         */
+        class MemoryBudgetShare {
+            MONGO_DISALLOW_COPYING(MemoryBudgetShare);
+        public:
+            explicit MemoryBudgetShare(const SortOptions& opts)
+                : _budget(opts.memoryBudget)
+                , _maxMemoryUsageBytes(opts.maxMemoryUsageBytes)
+                , _tracker(opts.memoryTracker)
+                , _trackerStatus(Status::OK())
+            {
+                if (_budget)
+                    _budget->addSorter();
+            }
+
+            ~MemoryBudgetShare() { release(); }
+
+            size_t maxMemoryUsageBytes() const {
+                return _budget ? _budget->shareBytes() : _maxMemoryUsageBytes;
+            }
+
+            /// Reports that the Sorter holds 'memUsed' bytes.
+            void setMemUsed(size_t memUsed) { _tracker.set(memUsed); }
+
+            /// Reports that the Sorter holds 'memUsed' bytes, and returns whether it should spill.
+            bool shouldSpill(size_t memUsed) {
+                setMemUsed(memUsed);
+                if (memUsed > maxMemoryUsageBytes())
+                    return true;
+                _trackerStatus = _tracker.checkLimits();
+                return !_trackerStatus.isOK();
+            }
+
+            /// Why the last shouldSpill() was true, if the tracker wanted the memory back.
+            std::string trackerReason() const {
+                return _trackerStatus.isOK() ? std::string()
+                                             : " (" + _trackerStatus.reason() + ")";
+            }
+
+            /// Called once the Sorter won't be given more data.
+            void release() {
+                if (_budget) {
+                    _budget->removeSorter();
+                    _budget = NULL;
+                }
+            }
+
+        private:
+            SorterMemoryBudget* _budget;
+            const size_t _maxMemoryUsageBytes;
+            OperationMemoryTracker _tracker;
+            Status _trackerStatus;
         };
 
+        /**
+         * Once 'iters' holds opts.maxSpillFiles spilled files, merges them into a single new one,
+         * so that no more than that many are open at once however much is sorted.  The merged
+         * file comes first, keeping the data in the order it was spilled.
+         */
+        template <typename Key, typename Value, typename Comparator>
+        void mergeSpillsIfNeeded(
+                std::vector<boost::shared_ptr<SortIteratorInterface<Key, Value> > >* iters,
+                const SortOptions& opts,
+                const Comparator& comp,
+                const typename SortedFileWriter<Key, Value>::Settings& settings,
+                unsigned long long* spilledBytes) {
+            typedef SortIteratorInterface<Key, Value> Iterator;
+
+            if (opts.maxSpillFiles == 0 || iters->size() < std::max(opts.maxSpillFiles, size_t(2)))
+                return;
+
+            SortedFileWriter<Key, Value> writer(opts, settings);
+            {
+                boost::scoped_ptr<Iterator> merged(Iterator::merge(*iters, opts, comp));
+                while (merged->more()) {
+                    const std::pair<Key, Value> data = merged->next();
+                    writer.addAlreadySorted(data.first, data.second);
+                }
+            }
+
+            // Close the merged files before opening the new one.
+            iters->clear();
+            iters->push_back(boost::shared_ptr<Iterator>(writer.done()));
+            *spilledBytes += writer.bytesWritten();
+        }
+
+        /**
+         * Runs 'tasks' on threads of their own, the first one on the calling thread, and waits
+         * for all of them.  A task whose thread can't be started runs on the calling thread.
+         */
+        inline void runInParallel(const std::vector<boost::function<void()> >& tasks) {
+            boost::thread_group threads;
+            for (size_t i = 1; i < tasks.size(); i++) {
+                try {
+                    threads.create_thread(tasks[i]);
+                }
+                catch (const boost::thread_resource_error&) {
+                    tasks[i]();
+                }
+            }
+
+            if (!tasks.empty())
+                tasks[0]();
+
+            threads.join_all();
+        }
+
+        template <typename RandomIt, typename Less>
+        void stableSortRange(RandomIt begin, RandomIt end, Less less, Status* status) {
+            try {
+                std::stable_sort(begin, end, less);
+            }
+            catch (const DBException& e) {
+                *status = e.toStatus();
+            }
+        }
+
+        template <typename RandomIt, typename Less>
+        void mergeSortedRanges(RandomIt begin, RandomIt middle, RandomIt end, Less less,
+                               Status* status) {
+            try {
+                std::inplace_merge(begin, middle, end, less);
+            }
+            catch (const DBException& e) {
+                *status = e.toStatus();
+            }
+        }
+
+        /**
+         * Same as std::stable_sort, by 'numParts' threads: each sorts a part of the range, then
+         * adjacent parts are merged pairwise, the merges of each round also running in parallel.
+         * 'less' is copied to each thread.
+         */
+        template <typename RandomIt, typename Less>
+        void parallelStableSort(RandomIt begin, RandomIt end, const Less& less, size_t numParts) {
+            const size_t size = end - begin;
+            std::vector<RandomIt> bounds;
+            for (size_t i = 0; i < numParts; i++)
+                bounds.push_back(begin + size * i / numParts);
+            bounds.push_back(end);
+
+            std::vector<Status> statuses(numParts, Status::OK());
+            std::vector<boost::function<void()> > tasks;
+            for (size_t i = 0; i < numParts; i++) {
+                tasks.push_back(boost::bind(&stableSortRange<RandomIt, Less>,
+                                            bounds[i], bounds[i + 1], less, &statuses[i]));
+            }
+            runInParallel(tasks);
+
+            for (size_t width = 1; width < numParts; width *= 2) {
+                for (size_t i = 0; i < numParts; i++)
+                    uassertStatusOK(statuses[i]);
+
+                tasks.clear();
+                for (size_t i = 0; i + width < numParts; i += 2 * width) {
+                    tasks.push_back(boost::bind(&mergeSortedRanges<RandomIt, Less>,
+                                                bounds[i],
+                                                bounds[i + width],
+                                                bounds[std::min(i + 2 * width, numParts)],
+                                                less,
+                                                &statuses[i]));
+                }
+                runInParallel(tasks);
+            }
+
+            for (size_t i = 0; i < numParts; i++)
+                uassertStatusOK(statuses[i]);
+        }
+
         template <typename Key, typename Value, typename Comparator>
         class NoLimitSorter : public Sorter<Key, Value> {
         public:
@@ -395,7 +617,10 @@ namespace mongo {
                 : _comp(comp)
                 , _settings(settings)
                 , _opts(opts)
+                , _memoryShare(opts)
                 , _memUsed(0)
+                , _spilledBytes(0)
+                , _numSpills(0)
             { verify(_opts.limit == 0); }
 
             void add(const Key& key, const Value& val) {
@@ -404,11 +629,13 @@ namespace mongo {
                 _memUsed += key.memUsageForSorter();
                 _memUsed += val.memUsageForSorter();
 
-                if (_memUsed > _opts.maxMemoryUsageBytes)
+                if (_memoryShare.shouldSpill(_memUsed))
                     spill();
             }
 
             Iterator* done() {
+                _memoryShare.release();
+
                 if (_iters.empty()) {
                     sort();
                     return new InMemIterator<Key, Value>(_data);
@@ -421,6 +648,8 @@ namespace mongo {
             // TEMP these are here for compatibility. Will be replaced with a general stats API
             int numFiles() const { return _iters.size(); }
             size_t memUsed() const { return _memUsed; }
+            unsigned long long spilledBytes() const { return _spilledBytes; }
+            unsigned long long numSpills() const { return _numSpills; }
 
         private:
             class STLComparator {
@@ -435,8 +664,17 @@ namespace mongo {
             };
 
             void sort() {
+                // Each thread sorts at least this many
+                const size_t minPerThread = 16 * 1024;
+
                 STLComparator less(_comp);
-                std::stable_sort(_data.begin(), _data.end(), less);
+                const size_t numThreads = std::min(_opts.sortThreads, _data.size() / minPerThread);
+                if (numThreads > 1) {
+                    parallelStableSort(_data.begin(), _data.end(), less, numThreads);
+                }
+                else {
+                    std::stable_sort(_data.begin(), _data.end(), less);
+                }
 
                 // Does 2x more compares than stable_sort
                 // TODO test on windows
@@ -454,7 +692,8 @@ namespace mongo {
                     // need to be revisited.
                     uasserted(16819, str::stream()
                         << "Sort exceeded memory limit of " << _opts.maxMemoryUsageBytes
-                        << " bytes, but did not opt in to external sorting. Aborting operation."
+                        << " bytes" << _memoryShare.trackerReason()
+                        << ", but did not opt in to external sorting. Aborting operation."
                         << " Pass allowDiskUse:true to opt in."
                         );
                 }
@@ -467,14 +706,21 @@ namespace mongo {
                 }
 
                 _iters.push_back(boost::shared_ptr<Iterator>(writer.done()));
+                _spilledBytes += writer.bytesWritten();
+                _numSpills++;
+                mergeSpillsIfNeeded(&_iters, _opts, _comp, _settings, &_spilledBytes);
 
                 _memUsed = 0;
+                _memoryShare.setMemUsed(0);
             }
 
             const Comparator _comp;
             const Settings _settings;
             SortOptions _opts;
+            MemoryBudgetShare _memoryShare;
             size_t _memUsed;
+            unsigned long long _spilledBytes;
+            unsigned long long _numSpills;
             std::deque<Data> _data; // the "current" data
             std::vector<boost::shared_ptr<Iterator> > _iters; // data that has already been spilled
         };
@@ -518,6 +764,8 @@ namespace mongo {
             int numFiles() const { return 0; }
             size_t memUsed() const { return _best.first.memUsageForSorter()
                                           + _best.second.memUsageForSorter(); }
+            unsigned long long spilledBytes() const { return 0; }
+            unsigned long long numSpills() const { return 0; }
 
         private:
             const Comparator _comp;
@@ -540,7 +788,10 @@ namespace mongo {
                 : _comp(comp)
                 , _settings(settings)
                 , _opts(opts)
+                , _memoryShare(opts)
                 , _memUsed(0)
+                , _spilledBytes(0)
+                , _numSpills(0)
                 , _haveCutoff(false)
                 , _worstCount(0)
                 , _medianCount(0)
@@ -572,7 +823,7 @@ namespace mongo {
                     if (_data.size() == _opts.limit)
                         std::make_heap(_data.begin(), _data.end(), less);
 
-                    if (_memUsed > _opts.maxMemoryUsageBytes)
+                    if (_memoryShare.shouldSpill(_memUsed))
                         spill();
 
                     return;
@@ -595,11 +846,13 @@ namespace mongo {
                 _data.back() = contender;
                 std::push_heap(_data.begin(), _data.end(), less);
 
-                if (_memUsed > _opts.maxMemoryUsageBytes)
+                if (_memoryShare.shouldSpill(_memUsed))
                     spill();
             }
 
             Iterator* done() {
+                _memoryShare.release();
+
                 if (_iters.empty()) {
                     sort();
                     return new InMemIterator<Key, Value>(_data);
@@ -612,6 +865,8 @@ namespace mongo {
             // TEMP these are here for compatibility. Will be replaced with a general stats API
             int numFiles() const { return _iters.size(); }
             size_t memUsed() const { return _memUsed; }
+            unsigned long long spilledBytes() const { return _spilledBytes; }
+            unsigned long long numSpills() const { return _numSpills; }
 
         private:
             class STLComparator {
@@ -725,7 +980,8 @@ namespace mongo {
                     // need to be revisited.
                     uasserted(16820, str::stream()
                         << "Sort exceeded memory limit of " << _opts.maxMemoryUsageBytes
-                        << " bytes, but did not opt in to external sorting. Aborting operation."
+                        << " bytes" << _memoryShare.trackerReason()
+                        << ", but did not opt in to external sorting. Aborting operation."
                         << " Pass allowDiskUse:true to opt in."
                         );
                 }
@@ -742,14 +998,21 @@ namespace mongo {
                 std::vector<Data>().swap(_data);
 
                 _iters.push_back(boost::shared_ptr<Iterator>(writer.done()));
+                _spilledBytes += writer.bytesWritten();
+                _numSpills++;
+                mergeSpillsIfNeeded(&_iters, _opts, _comp, _settings, &_spilledBytes);
 
                 _memUsed = 0;
+                _memoryShare.setMemUsed(0);
             }
 
             const Comparator _comp;
             const Settings _settings;
             SortOptions _opts;
+            MemoryBudgetShare _memoryShare;
             size_t _memUsed;
+            unsigned long long _spilledBytes;
+            unsigned long long _numSpills;
             std::vector<Data> _data; // the "current" data. Organized as max-heap if size == limit.
             std::vector<boost::shared_ptr<Iterator> > _iters; // data that has already been spilled
 
@@ -778,6 +1041,7 @@ namespace mongo {
     SortedFileWriter<Key, Value>::SortedFileWriter(const SortOptions& opts,
                                                    const Settings& settings)
         : _settings(settings)
+        , _bytesWritten(0)
     {
         namespace str = mongoutils::str;
 
@@ -832,10 +1096,12 @@ namespace mongo {
                 const int32_t size = -int32_t(compressed.size()); // negative means compressed
                 _file.write(reinterpret_cast<const char*>(&size), sizeof(size));
                 _file.write(compressed.data(), compressed.size());
+                _bytesWritten += sizeof(size) + compressed.size();
             } else {
                 const int32_t size = _buffer.len();
                 _file.write(reinterpret_cast<const char*>(&size), sizeof(size));
                 _file.write(_buffer.buf(), _buffer.len());
+                _bytesWritten += sizeof(size) + _buffer.len();
             }
         } catch (const std::exception&) {
             msgasserted(16821, str::stream() << "error writing to file \"" << _fileName << "\": "
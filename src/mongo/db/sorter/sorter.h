@@ -37,6 +37,7 @@
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/bson/util/builder.h"
+#include "mongo/platform/atomic_word.h"
 
 /**
  * This is the public API for the Sorter (both in-memory and external)
@@ -84,11 +85,39 @@
  */
 
 namespace mongo {
+    class OperationMemoryTracker;
+
     namespace sorter {
         // Everything in this namespace is internal to the sorter
         class FileDeleter;
     }
 
+    /**
+     * A memory limit shared by any number of Sorters, possibly of different operations: each
+     * Sorter using the budget may hold an equal share of it, which shrinks as others start and
+     * grows as they finish.  Thread safe.
+     */
+    class SorterMemoryBudget {
+        MONGO_DISALLOW_COPYING(SorterMemoryBudget);
+    public:
+        explicit SorterMemoryBudget(size_t totalBytes) : _totalBytes(totalBytes) {}
+
+        void setTotalBytes(size_t totalBytes) { _totalBytes.store(totalBytes); }
+
+        /// The memory each of the Sorters using the budget may use at the moment.
+        size_t shareBytes() const {
+            const unsigned numSorters = _numSorters.load();
+            return _totalBytes.load() / (numSorters ? numSorters : 1);
+        }
+
+        void addSorter() { _numSorters.fetchAndAdd(1); }
+        void removeSorter() { _numSorters.fetchAndSubtract(1); }
+
+    private:
+        AtomicUInt64 _totalBytes;
+        AtomicUInt32 _numSorters;
+    };
+
     /**
      * Runtime options that control the Sorter's behavior
      */
@@ -98,11 +127,25 @@ namespace mongo {
         bool extSortAllowed; /// If false, uassert if more mem needed than allowed.
         std::string tempDir; /// Directory to directly place files in.
                              /// Must be explicitly set if extSortAllowed is true.
+        size_t maxSpillFiles; /// Once this many files have been spilled, they are merged into
+                              /// one, bounding the files open at once. 0 for no limit.
+        SorterMemoryBudget* memoryBudget; /// If set, the memory used is bounded by a share of
+                                          /// it rather than by maxMemoryUsageBytes. Not owned.
+        size_t sortThreads; /// Most threads sorting a batch before it is spilled or returned,
+                            /// when there is no limit. The Comparator and the copies of Keys
+                            /// and Values must then be safe to use from several threads.
+        OperationMemoryTracker* memoryTracker; /// If set, the memory used while being given
+                                               /// data counts towards it, and the Sorter
+                                               /// spills when it says so. Not owned.
 
         SortOptions()
             : limit(0)
             , maxMemoryUsageBytes(64*1024*1024)
             , extSortAllowed(false)
+            , maxSpillFiles(0)
+            , memoryBudget(NULL)
+            , sortThreads(1)
+            , memoryTracker(NULL)
         {}
 
         /// Fluent API to support expressions like SortOptions().Limit(1000).ExtSortAllowed(true)
@@ -126,6 +169,26 @@ namespace mongo {
             tempDir = newTempDir;
             return *this;
         }
+
+        SortOptions& MaxSpillFiles(size_t newMaxSpillFiles) {
+            maxSpillFiles = newMaxSpillFiles;
+            return *this;
+        }
+
+        SortOptions& MemoryBudget(SorterMemoryBudget* newMemoryBudget) {
+            memoryBudget = newMemoryBudget;
+            return *this;
+        }
+
+        SortOptions& SortThreads(size_t newSortThreads) {
+            sortThreads = newSortThreads;
+            return *this;
+        }
+
+        SortOptions& MemoryTracker(OperationMemoryTracker* newMemoryTracker) {
+            memoryTracker = newMemoryTracker;
+            return *this;
+        }
     };
 
     /// This is the output from the sorting framework
@@ -176,6 +239,8 @@ namespace mongo {
         // TEMP these are here for compatibility. Will be replaced with a general stats API
         virtual int numFiles() const =0;
         virtual size_t memUsed() const =0;
+        virtual unsigned long long spilledBytes() const =0; /// Written to all files so far.
+        virtual unsigned long long numSpills() const =0; /// Including spills of merged files.
 
     protected:
         Sorter() {} // can only be constructed as a base
@@ -197,6 +262,9 @@ namespace mongo {
         void addAlreadySorted(const Key&, const Value&);
         Iterator* done(); /// Can't add more data after calling done()
 
+        /// Bytes written to the file so far, after compression.
+        unsigned long long bytesWritten() const { return _bytesWritten; }
+
     private:
         void spill();
 
@@ -205,6 +273,7 @@ namespace mongo {
         boost::shared_ptr<sorter::FileDeleter> _fileDeleter; // Must outlive _file
         std::ofstream _file;
         BufBuilder _buffer;
+        unsigned long long _bytesWritten;
     };
 }
 
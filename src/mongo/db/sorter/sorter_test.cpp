@@ -301,6 +301,31 @@ namespace mongo {
                         mergeIterators(iterators, ASC, SortOptions().Limit(10)),
                         make_shared<LimitIterator>(10, make_shared<IntIterator>(0,20,1)));
             }
+            { // test numbers of sources which don't fill a tree, with empty ones among them
+                const int numSources[] = {1, 3, 7, 100};
+                for (size_t i = 0; i < sizeof(numSources) / sizeof(numSources[0]); i++) {
+                    const int n = numSources[i];
+                    std::vector<boost::shared_ptr<IWIterator> > ascending;
+                    std::vector<boost::shared_ptr<IWIterator> > descending;
+                    for (int j = 0; j < n; j++) {
+                        ascending.push_back(make_shared<IntIterator>(j, 50 * n, n));
+                        descending.push_back(make_shared<IntIterator>(50 * n - 1 - j, -1, -n));
+                        if (j % 3 == 1) {
+                            ascending.push_back(make_shared<EmptyIterator>());
+                            descending.push_back(make_shared<EmptyIterator>());
+                        }
+                    }
+
+                    ASSERT_ITERATORS_EQUIVALENT(
+                        boost::shared_ptr<IWIterator>(
+                            IWIterator::merge(ascending, SortOptions(), IWComparator(ASC))),
+                        make_shared<IntIterator>(0, 50 * n));
+                    ASSERT_ITERATORS_EQUIVALENT(
+                        boost::shared_ptr<IWIterator>(
+                            IWIterator::merge(descending, SortOptions(), IWComparator(DESC))),
+                        make_shared<IntIterator>(50 * n - 1, -1, -1));
+                }
+            }
         }
     };
 
@@ -480,6 +505,7 @@ namespace mongo {
                     // don't do this check in subclasses since they may set a limit
                     ASSERT_GREATER_THAN_OR_EQUALS(static_cast<size_t>(sorter->numFiles()),
                                                   (NUM_ITEMS * sizeof(IWPair)) / MEM_LIMIT);
+                    ASSERT_GREATER_THAN(sorter->spilledBytes(), 0ULL);
                 }
             }
 
@@ -521,6 +547,130 @@ namespace mongo {
             }
             enum { MEM_LIMIT = 32*1024 };
         };
+
+        template <bool Random=true>
+        class LotsOfDataFewFiles : public LotsOfDataLittleMemory<Random> {
+            typedef LotsOfDataLittleMemory<Random> Parent;
+            SortOptions adjustSortOptions(SortOptions opts) {
+                return Parent::adjustSortOptions(opts).MaxSpillFiles(MAX_FILES);
+            }
+            void addData(ptr<IWSorter> sorter) {
+                Parent::addData(sorter);
+
+                // The spilled files keep being merged to stay under the limit.
+                ASSERT_LESS_THAN_OR_EQUALS(sorter->numFiles(), MAX_FILES);
+                ASSERT_GREATER_THAN_OR_EQUALS(
+                    sorter->numSpills(),
+                    (Parent::NUM_ITEMS * sizeof(IWPair)) / Parent::MEM_LIMIT);
+            }
+            enum { MAX_FILES = 8 };
+        };
+
+        // Batches big enough to be sorted by several threads, in memory or before each spill
+        template <int MemLimit>
+        class LotsOfDataSortThreads : public LotsOfDataLittleMemory</*random=*/true> {
+            SortOptions adjustSortOptions(SortOptions opts) {
+                return opts.MaxMemoryUsageBytes(MemLimit).ExtSortAllowed().SortThreads(4);
+            }
+        };
+
+        class SortThreadsAreStable {
+        public:
+            void run() {
+                const int numItems = 200*1000;
+                const int numKeys = 1000;
+                const Direction directions[] = {ASC, DESC};
+                for (int d = 0; d < 2; d++) {
+                    boost::scoped_ptr<IWSorter> sorter(
+                        IWSorter::make(SortOptions().SortThreads(5), IWComparator(directions[d])));
+                    for (int i = 0; i < numItems; i++)
+                        sorter->add((i * 7919) % numKeys, i);
+
+                    // Values are added in increasing order, so they must stay so for each key.
+                    boost::scoped_ptr<IWIterator> sorted(sorter->done());
+                    IWPair previous(directions[d] == ASC ? -1 : numKeys, -1);
+                    for (int i = 0; i < numItems; i++) {
+                        ASSERT(sorted->more());
+                        const IWPair current = sorted->next();
+                        if (current.first == previous.first) {
+                            ASSERT_GREATER_THAN(current.second, previous.second);
+                        }
+                        else {
+                            ASSERT_EQUALS(IWComparator(directions[d])(previous, current), -1);
+                        }
+                        previous = current;
+                    }
+                    ASSERT(!sorted->more());
+                }
+            }
+        };
+
+        class SharedMemoryBudget {
+        public:
+            void run() {
+                unittest::TempDir tempDir("sorterTests");
+                SorterMemoryBudget budget(64*1024);
+                const SortOptions opts = SortOptions().TempDir(tempDir.path())
+                                                      .ExtSortAllowed()
+                                                      .MemoryBudget(&budget);
+                ASSERT_EQUALS(budget.shareBytes(), 64U*1024);
+
+                boost::scoped_ptr<IWSorter> first(IWSorter::make(opts, IWComparator(ASC)));
+                ASSERT_EQUALS(budget.shareBytes(), 64U*1024);
+                {
+                    boost::scoped_ptr<IWSorter> second(IWSorter::make(opts, IWComparator(ASC)));
+                    ASSERT_EQUALS(budget.shareBytes(), 32U*1024);
+
+                    // Bounded by a share, 'second' spills what would fit in the whole budget.
+                    for (int i = 0; i < 40*1024 / int(sizeof(IWPair)); i++)
+                        second->add(i, -i);
+                    ASSERT_GREATER_THAN(second->numSpills(), 0ULL);
+
+                    // Done sorters don't count against the budget.
+                    boost::shared_ptr<IWIterator> sorted(second->done());
+                    ASSERT_EQUALS(budget.shareBytes(), 64U*1024);
+                    ASSERT_ITERATORS_EQUIVALENT(sorted,
+                                                make_shared<IntIterator>(0,
+                                                    40*1024 / int(sizeof(IWPair))));
+                }
+
+                first.reset();
+                ASSERT(boost::filesystem::is_empty(tempDir.path()));
+            }
+        };
+
+        class OperationMemoryLimit {
+        public:
+            void run() {
+                unittest::TempDir tempDir("sorterTests");
+                const int oldLimit = internalOperationMaxMemoryMegabytes;
+                internalOperationMaxMemoryMegabytes = 1;
+
+                OperationMemoryTracker operation(NULL, OperationMemoryTracker::kOperation);
+                OperationMemoryTracker consumer(&operation);
+                const SortOptions opts = SortOptions().TempDir(tempDir.path())
+                                                      .ExtSortAllowed()
+                                                      .MaxMemoryUsageBytes(64*1024*1024)
+                                                      .MemoryTracker(&consumer);
+                {
+                    boost::scoped_ptr<IWSorter> sorter(IWSorter::make(opts, IWComparator(ASC)));
+
+                    // Far below its own limit, the sorter still spills to keep the operation
+                    // within its one.
+                    const int n = 2*1024*1024 / int(sizeof(IWPair));
+                    for (int i = 0; i < n; i++)
+                        sorter->add(i, -i);
+                    ASSERT_GREATER_THAN(sorter->numSpills(), 0ULL);
+                    ASSERT_LESS_THAN(operation.peakBytes(), 2*1024*1024);
+
+                    boost::shared_ptr<IWIterator> sorted(sorter->done());
+                    ASSERT_ITERATORS_EQUIVALENT(sorted, make_shared<IntIterator>(0, n));
+                }
+                ASSERT_EQUALS(operation.bytes(), 0);
+
+                internalOperationMaxMemoryMegabytes = oldLimit;
+            }
+        };
     }
 
     class SorterSuite : public mongo::unittest::Suite {
@@ -544,6 +694,13 @@ namespace mongo {
             add<SorterTests::LotsOfDataWithLimit<100,/*random=*/true> >();  // fits in mem
             add<SorterTests::LotsOfDataWithLimit<5000,/*random=*/false> >(); // spills
             add<SorterTests::LotsOfDataWithLimit<5000,/*random=*/true> >(); // spills
+            add<SorterTests::LotsOfDataFewFiles</*random=*/false> >();
+            add<SorterTests::LotsOfDataFewFiles</*random=*/true> >();
+            add<SorterTests::LotsOfDataSortThreads<64*1024*1024> >(); // fits in mem
+            add<SorterTests::LotsOfDataSortThreads<1024*1024> >(); // spills
+            add<SorterTests::SortThreadsAreStable>();
+            add<SorterTests::SharedMemoryBudget>();
+            add<SorterTests::OperationMemoryLimit>();
         }
     };
 
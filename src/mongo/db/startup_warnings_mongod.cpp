@@ -38,6 +38,7 @@
 #include "mongo/db/startup_warnings_common.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/util/log.h"
+#include "mongo/util/numa_placement.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/version.h"
 
@@ -87,7 +88,7 @@ namespace mongo {
                   << "Failed to probe \"" << e.path1().string() << "\": " << e.code().message()
                   << startupWarningsLog;
         }
-        if (hasMultipleNumaNodes) {
+        if (hasMultipleNumaNodes && !NumaPlacement::isEnabled()) {
             // We are on a box with a NUMA enabled kernel and more than 1 numa node (they start at
             // node0)
             // Now we look at the first line of /proc/self/numa_maps
@@ -128,6 +129,8 @@ namespace mongo {
                               << "performance problems:" << startupWarningsLog;
                         log() << "**              numactl --interleave=all mongod [other options]"
                               << startupWarningsLog;
+                        log() << "**          or with --setParameter numaPlacement=true"
+                              << startupWarningsLog;
                         warned = true;
                     }
                 }
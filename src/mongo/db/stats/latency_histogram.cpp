@@ -0,0 +1,189 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/stats/latency_histogram.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    LatencyHistogram::LatencyHistogram() : _count(0) {
+
+    }
+
+    LatencyHistogram::LatencyHistogram(const LatencyHistogram& older,
+                                       const LatencyHistogram& newer)
+        : _count(0),
+          _buckets(newer._buckets) {
+
+        // Like Top::UsageData, a histogram which was reset in between is reported whole
+        if (older._count > newer._count || older._buckets.size() > newer._buckets.size()) {
+            _count = newer._count;
+            return;
+        }
+
+        for (size_t i = 0; i < older._buckets.size(); i++) {
+            if (older._buckets[i] > _buckets[i]) {
+                _buckets = newer._buckets;
+                _count = newer._count;
+                return;
+            }
+            _buckets[i] -= older._buckets[i];
+        }
+        _count = newer._count - older._count;
+    }
+
+    void LatencyHistogram::record(uint64_t micros) {
+        const size_t index = bucketIndex(micros);
+        if (index >= _buckets.size()) {
+            _buckets.resize(index + 1, 0);
+        }
+        _buckets[index]++;
+        _count++;
+    }
+
+    void LatencyHistogram::merge(const LatencyHistogram& other) {
+        if (other._buckets.size() > _buckets.size()) {
+            _buckets.resize(other._buckets.size(), 0);
+        }
+        for (size_t i = 0; i < other._buckets.size(); i++) {
+            _buckets[i] += other._buckets[i];
+        }
+        _count += other._count;
+    }
+
+    uint64_t LatencyHistogram::getPercentileMicros(double percent) const {
+        if (_count == 0) {
+            return 0;
+        }
+
+        // The rank of the latency, 1 based, rounded up
+        uint64_t rank = static_cast<uint64_t>(_count * percent / 100);
+        if (rank < _count * percent / 100) rank++;
+        if (rank == 0) rank = 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < _buckets.size(); i++) {
+            seen += _buckets[i];
+            if (seen >= rank) {
+                return bucketLowerBound(i + 1) - 1;
+            }
+        }
+        return bucketLowerBound(_buckets.size()) - 1;
+    }
+
+    void LatencyHistogram::append(BSONObjBuilder* builder, bool includeBuckets) const {
+        builder->appendNumber("p50", static_cast<long long>(getPercentileMicros(50)));
+        builder->appendNumber("p95", static_cast<long long>(getPercentileMicros(95)));
+        builder->appendNumber("p99", static_cast<long long>(getPercentileMicros(99)));
+
+        if (!includeBuckets) {
+            return;
+        }
+
+        BSONArrayBuilder bucketsBuilder(builder->subarrayStart("buckets"));
+        for (size_t i = 0; i < _buckets.size(); i++) {
+            if (_buckets[i] == 0) continue;
+
+            BSONArrayBuilder bucketBuilder(bucketsBuilder.subarrayStart());
+            bucketBuilder.append(static_cast<long long>(bucketLowerBound(i)));
+            bucketBuilder.append(static_cast<long long>(_buckets[i]));
+            bucketBuilder.done();
+        }
+        bucketsBuilder.done();
+    }
+
+    // static
+    Status LatencyHistogram::parse(const BSONObj& obj, LatencyHistogram* out) {
+        const BSONElement bucketsElt = obj["buckets"];
+        if (Array != bucketsElt.type()) {
+            return Status(ErrorCodes::BadValue, "latency histogram buckets must be an array");
+        }
+
+        BSONObjIterator it(bucketsElt.Obj());
+        while (it.more()) {
+            const BSONElement bucketElt = it.next();
+            BSONObj bucket;
+            if (Array == bucketElt.type()) {
+                bucket = bucketElt.Obj();
+            }
+            if (bucket.nFields() != 2 || !bucket["0"].isNumber() || !bucket["1"].isNumber() ||
+                    bucket["0"].numberLong() < 0 || bucket["1"].numberLong() < 0) {
+                return Status(ErrorCodes::BadValue, str::stream()
+                              << "latency histogram bucket must be [lower bound, count]: "
+                              << bucketElt);
+            }
+
+            const uint64_t lowerBound = static_cast<uint64_t>(bucket["0"].numberLong());
+            const size_t index = bucketIndex(lowerBound);
+            if (bucketLowerBound(index) != lowerBound) {
+                return Status(ErrorCodes::BadValue, str::stream()
+                              << "not the lower bound of a latency histogram bucket: "
+                              << lowerBound);
+            }
+
+            const uint64_t count = static_cast<uint64_t>(bucket["1"].numberLong());
+            if (index >= out->_buckets.size()) {
+                out->_buckets.resize(index + 1, 0);
+            }
+            out->_buckets[index] += count;
+            out->_count += count;
+        }
+        return Status::OK();
+    }
+
+    // static
+    size_t LatencyHistogram::bucketIndex(uint64_t micros) {
+        if (micros < kSubBuckets) {
+            return static_cast<size_t>(micros);
+        }
+
+        // The power of two, at least kSubBucketBits, and the kSubBucketBits bits below the top one
+        int magnitude = kSubBucketBits;
+        while (magnitude < 63 && (micros >> (magnitude + 1))) {
+            magnitude++;
+        }
+        const int shift = magnitude - kSubBucketBits;
+        return (shift + 1) * kSubBuckets + static_cast<size_t>((micros >> shift) - kSubBuckets);
+    }
+
+    // static
+    uint64_t LatencyHistogram::bucketLowerBound(size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+
+        const size_t group = index / kSubBuckets;
+        const uint64_t subBucket = index % kSubBuckets;
+        return (kSubBuckets + subBucket) << (group - 1);
+    }
+
+} // namespace mongo
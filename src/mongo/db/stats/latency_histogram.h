@@ -0,0 +1,101 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "mongo/base/status.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    class BSONObj;
+    class BSONObjBuilder;
+
+    /**
+     * Counts operation latencies in logarithmic buckets, HDR histogram style: every power of two
+     * of microseconds is split into kSubBuckets equal buckets, so a latency is known to within
+     * 25% of its value however large it is.  The buckets are only allocated up to the largest
+     * latency recorded, so an idle histogram is empty.
+     *
+     * Not thread safe, the owner synchronizes.
+     */
+    class LatencyHistogram {
+    public:
+        enum { kSubBucketBits = 2 };
+        enum { kSubBuckets = 1 << kSubBucketBits };
+
+        LatencyHistogram();
+
+        /**
+         * Constructs the histogram of the latencies recorded by 'newer' since 'older' was copied
+         * from it.
+         */
+        LatencyHistogram(const LatencyHistogram& older, const LatencyHistogram& newer);
+
+        void record(uint64_t micros);
+
+        /**
+         * Adds the latencies recorded by 'other', on another server for example.
+         */
+        void merge(const LatencyHistogram& other);
+
+        uint64_t getCount() const { return _count; }
+
+        /**
+         * Returns the upper bound of the bucket holding the latency below which 'percent' of the
+         * recorded latencies are, or 0 if nothing was recorded.
+         */
+        uint64_t getPercentileMicros(double percent) const;
+
+        /**
+         * Appends the 50th, 95th and 99th percentiles.  With 'includeBuckets', also appends the
+         * non-empty buckets as [ lower bound, count ] pairs under "buckets".
+         */
+        void append(BSONObjBuilder* builder, bool includeBuckets) const;
+
+        /**
+         * Reads back the buckets appended by append(builder, true) into 'out', which should be
+         * empty.  Fails if a bucket's lower bound isn't one.
+         */
+        static Status parse(const BSONObj& obj, LatencyHistogram* out);
+
+        /**
+         * Returns the bucket of a latency, and the smallest latency counted in a bucket.
+         */
+        static size_t bucketIndex(uint64_t micros);
+        static uint64_t bucketLowerBound(size_t index);
+
+    private:
+        uint64_t _count;
+        std::vector<uint64_t> _buckets;
+    };
+
+} // namespace mongo
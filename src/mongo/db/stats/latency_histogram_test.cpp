@@ -0,0 +1,153 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/stats/latency_histogram.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using namespace mongo;
+
+    TEST(LatencyHistogram, Buckets) {
+        // Exact below kSubBuckets, then kSubBuckets buckets per power of two
+        for (uint64_t micros = 0; micros < LatencyHistogram::kSubBuckets; micros++) {
+            ASSERT_EQUALS(LatencyHistogram::bucketIndex(micros), micros);
+        }
+        ASSERT_EQUALS(LatencyHistogram::bucketIndex(4), 4U);
+        ASSERT_EQUALS(LatencyHistogram::bucketIndex(7), 7U);
+        ASSERT_EQUALS(LatencyHistogram::bucketIndex(8), 8U);
+        ASSERT_EQUALS(LatencyHistogram::bucketIndex(9), 8U);
+        ASSERT_EQUALS(LatencyHistogram::bucketIndex(10), 9U);
+        ASSERT_EQUALS(LatencyHistogram::bucketIndex(16), 12U);
+
+        // Every latency is in the bucket whose bounds hold it, within 25%
+        for (uint64_t micros = 1; micros < (1ULL << 40); micros = micros * 3 / 2 + 1) {
+            const size_t index = LatencyHistogram::bucketIndex(micros);
+            const uint64_t lower = LatencyHistogram::bucketLowerBound(index);
+            const uint64_t upper = LatencyHistogram::bucketLowerBound(index + 1);
+            ASSERT_LESS_THAN_OR_EQUALS(lower, micros);
+            ASSERT_LESS_THAN(micros, upper);
+            ASSERT_LESS_THAN_OR_EQUALS(upper - lower, lower / 4 + 1);
+        }
+
+        ASSERT_EQUALS(LatencyHistogram::bucketIndex((1ULL << 63) + 1), 248U);
+    }
+
+    TEST(LatencyHistogram, Percentiles) {
+        LatencyHistogram histogram;
+        ASSERT_EQUALS(histogram.getCount(), 0U);
+        ASSERT_EQUALS(histogram.getPercentileMicros(50), 0U);
+
+        // 90 fast operations and 10 slow ones
+        for (int i = 0; i < 90; i++) {
+            histogram.record(100);
+        }
+        for (int i = 0; i < 10; i++) {
+            histogram.record(50 * 1000);
+        }
+        ASSERT_EQUALS(histogram.getCount(), 100U);
+
+        // The upper bounds of the buckets holding 100 and 50000
+        ASSERT_EQUALS(histogram.getPercentileMicros(50), 111U);
+        ASSERT_EQUALS(histogram.getPercentileMicros(90), 111U);
+        ASSERT_EQUALS(histogram.getPercentileMicros(95), 57343U);
+        ASSERT_EQUALS(histogram.getPercentileMicros(99), 57343U);
+        ASSERT_EQUALS(histogram.getPercentileMicros(100), 57343U);
+    }
+
+    TEST(LatencyHistogram, Diff) {
+        LatencyHistogram histogram;
+        histogram.record(10);
+        histogram.record(1000);
+        const LatencyHistogram older = histogram;
+
+        histogram.record(1000);
+        histogram.record(1000 * 1000);
+
+        LatencyHistogram diff(older, histogram);
+        ASSERT_EQUALS(diff.getCount(), 2U);
+        ASSERT_EQUALS(diff.getPercentileMicros(50),
+                      LatencyHistogram::bucketLowerBound(LatencyHistogram::bucketIndex(1000) + 1) - 1);
+
+        // A histogram which started over is reported whole
+        LatencyHistogram restarted;
+        restarted.record(10);
+        LatencyHistogram restartedDiff(histogram, restarted);
+        ASSERT_EQUALS(restartedDiff.getCount(), 1U);
+    }
+
+    TEST(LatencyHistogram, Append) {
+        LatencyHistogram histogram;
+        histogram.record(5);
+        histogram.record(5);
+        histogram.record(300);
+
+        BSONObjBuilder builder;
+        histogram.append(&builder, false);
+        BSONObj obj = builder.obj();
+        ASSERT_EQUALS(obj["p50"].numberLong(), 5);
+        ASSERT_EQUALS(obj["p99"].numberLong(), 319);
+        ASSERT(obj["buckets"].eoo());
+
+        BSONObjBuilder bucketsBuilder;
+        histogram.append(&bucketsBuilder, true);
+        ASSERT_EQUALS(bucketsBuilder.obj()["buckets"].Obj(),
+                      BSON_ARRAY(BSON_ARRAY(5LL << 2LL) << BSON_ARRAY(256LL << 1LL)));
+    }
+
+    TEST(LatencyHistogram, MergeAndParse) {
+        LatencyHistogram first;
+        first.record(5);
+        first.record(300);
+
+        LatencyHistogram second;
+        second.record(5);
+        second.record(100000);
+
+        BSONObjBuilder builder;
+        second.append(&builder, true);
+        LatencyHistogram parsed;
+        ASSERT_OK(LatencyHistogram::parse(builder.obj(), &parsed));
+        ASSERT_EQUALS(parsed.getCount(), 2U);
+
+        first.merge(parsed);
+        ASSERT_EQUALS(first.getCount(), 4U);
+        ASSERT_EQUALS(first.getPercentileMicros(50), 5U);
+        ASSERT_EQUALS(first.getPercentileMicros(99),
+                      LatencyHistogram::bucketLowerBound(
+                          LatencyHistogram::bucketIndex(100000) + 1) - 1);
+
+        LatencyHistogram bad;
+        ASSERT_NOT_OK(LatencyHistogram::parse(BSON("buckets" << BSON_ARRAY(BSON_ARRAY(9 << 1))),
+                                              &bad));
+        ASSERT_NOT_OK(LatencyHistogram::parse(BSON("buckets" << 1), &bad));
+    }
+
+} // namespace
@@ -29,6 +29,8 @@
 #include "mongo/platform/basic.h"
 
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/concurrency/lock_state.h"
+#include "mongo/db/concurrency/lock_stats.h"
 #include "mongo/db/global_environment_experiment.h"
 #include "mongo/db/operation_context.h"
 
@@ -129,13 +131,44 @@ namespace mongo {
         BSONObj generateSection(const BSONElement& configElement) const {
             BSONObjBuilder b;
 
-            // SERVER-14978: Need to report the global and per-DB lock stats here
-            //
-            // b.append(".", qlk.stats.report());
+            getLockWaitProfiler().appendStats(&b);
+
+            BSONArrayBuilder contendedBuilder(b.subarrayStart("mostContended"));
+            getLockWaitProfiler().appendMostContended(&contendedBuilder, 10);
+            contendedBuilder.done();
 
             return b.obj();
         }
 
     } lockStatsServerStatusSection;
 
+
+    class AdmissionControlServerStatusSection : public ServerStatusSection {
+    public:
+        AdmissionControlServerStatusSection() : ServerStatusSection("admissionControl") {}
+
+        virtual bool includeByDefault() const { return getAdmissionController(MODE_IS) != NULL; }
+
+        BSONObj generateSection(const BSONElement& configElement) const {
+            AdmissionController* read = getAdmissionController(MODE_IS);
+            AdmissionController* write = getAdmissionController(MODE_IX);
+            if (!read || !write) {
+                return BSONObj();
+            }
+
+            BSONObjBuilder b;
+
+            BSONObjBuilder readBuilder(b.subobjStart("read"));
+            read->appendStats(readBuilder);
+            readBuilder.done();
+
+            BSONObjBuilder writeBuilder(b.subobjStart("write"));
+            write->appendStats(writeBuilder);
+            writeBuilder.done();
+
+            return b.obj();
+        }
+
+    } admissionControlServerStatusSection;
+
 } // namespace mongo
@@ -0,0 +1,159 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/stats/op_sample_buffer.h"
+
+#include <algorithm>
+
+namespace mongo {
+
+namespace {
+
+    template <typename Entry>
+    bool byTotalMillis(const Entry* lhs, const Entry* rhs) {
+        return lhs->totalMillis > rhs->totalMillis;
+    }
+
+} // namespace
+
+    OpSampleBuffer::ShapeTotals::ShapeTotals()
+        : count(0),
+          totalMillis(0),
+          maxMillis(0),
+          nscanned(0),
+          nscannedObjects(0),
+          nreturned(0) {
+
+    }
+
+    OpSampleBuffer::OpSampleBuffer()
+        : _mutex("OpSampleBuffer"),
+          _numSampled(0),
+          _numOverwritten(0),
+          _numUnshaped(0) {
+
+    }
+
+    void OpSampleBuffer::add(const Sample& sample, size_t maxDocs, size_t maxShapes) {
+        std::string key;
+        key.reserve(sample.op.size() + sample.ns.size() + sample.shape.size() + 2);
+        key.append(sample.op).append(1, '\0').append(sample.ns).append(1, '\0')
+           .append(sample.shape);
+
+        SimpleMutex::scoped_lock lk(_mutex);
+        _numSampled++;
+
+        if (!sample.doc.isEmpty() && maxDocs > 0) {
+            while (_docs.size() >= maxDocs) {
+                _docs.pop_front();
+                _numOverwritten++;
+            }
+            _docs.push_back(sample.doc);
+        }
+
+        ShapeMap::iterator it = _shapes.find(key);
+        if (it == _shapes.end()) {
+            if (_shapes.size() >= maxShapes) {
+                _numUnshaped++;
+                return;
+            }
+            it = _shapes.insert(ShapeMap::value_type(key, ShapeTotals())).first;
+            it->second.op = sample.op;
+            it->second.ns = sample.ns;
+            it->second.shape = sample.shape;
+            it->second.example = sample.example;
+        }
+
+        ShapeTotals& totals = it->second;
+        totals.count++;
+        totals.totalMillis += sample.millis;
+        totals.maxMillis = std::max(totals.maxMillis, sample.millis);
+        totals.nscanned += sample.nscanned;
+        totals.nscannedObjects += sample.nscannedObjects;
+        totals.nreturned += sample.nreturned;
+    }
+
+    void OpSampleBuffer::drain(std::vector<BSONObj>* docs) {
+        SimpleMutex::scoped_lock lk(_mutex);
+        docs->insert(docs->end(), _docs.begin(), _docs.end());
+        _docs.clear();
+    }
+
+    void OpSampleBuffer::appendStats(BSONObjBuilder* builder) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        builder->appendNumber("sampled", _numSampled);
+        builder->appendNumber("buffered", static_cast<long long>(_docs.size()));
+        builder->appendNumber("overwritten", _numOverwritten);
+        builder->appendNumber("shapes", static_cast<long long>(_shapes.size()));
+        builder->appendNumber("unshaped", _numUnshaped);
+    }
+
+    void OpSampleBuffer::appendShapes(BSONArrayBuilder* builder, size_t limit) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+
+        std::vector<const ShapeTotals*> sorted;
+        sorted.reserve(_shapes.size());
+        for (ShapeMap::const_iterator it = _shapes.begin(); it != _shapes.end(); ++it) {
+            sorted.push_back(&it->second);
+        }
+
+        const size_t numShapes = std::min(limit, sorted.size());
+        std::partial_sort(sorted.begin(), sorted.begin() + numShapes, sorted.end(),
+                          byTotalMillis<ShapeTotals>);
+
+        for (size_t i = 0; i < numShapes; i++) {
+            const ShapeTotals& totals = *sorted[i];
+            BSONObjBuilder shapeBuilder(builder->subobjStart());
+            shapeBuilder.append("op", totals.op);
+            shapeBuilder.append("ns", totals.ns);
+            shapeBuilder.append("shape", totals.shape);
+            if (!totals.example.isEmpty()) {
+                shapeBuilder.append("example", totals.example);
+            }
+            shapeBuilder.appendNumber("count", totals.count);
+            shapeBuilder.appendNumber("totalMillis", totals.totalMillis);
+            shapeBuilder.appendNumber("maxMillis", totals.maxMillis);
+            shapeBuilder.appendNumber("nscanned", totals.nscanned);
+            shapeBuilder.appendNumber("nscannedObjects", totals.nscannedObjects);
+            shapeBuilder.appendNumber("nreturned", totals.nreturned);
+            shapeBuilder.doneFast();
+        }
+    }
+
+    void OpSampleBuffer::reset() {
+        SimpleMutex::scoped_lock lk(_mutex);
+        _docs.clear();
+        _shapes.clear();
+        _numSampled = 0;
+        _numOverwritten = 0;
+        _numUnshaped = 0;
+    }
+
+} // namespace mongo
@@ -0,0 +1,117 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * Holds sampled operations: the most recent ones as documents, until they are drained to be
+     * saved somewhere, and the totals of all of them by operation type, namespace and query
+     * shape, like pg_stat_statements.
+     *
+     * The number of kept documents and of shapes are bounded by the callers.  Past them, the
+     * oldest documents are overwritten, and operations of new shapes are only counted.
+     */
+    class OpSampleBuffer {
+        MONGO_DISALLOW_COPYING(OpSampleBuffer);
+    public:
+
+        struct Sample {
+            Sample() : millis(0), nscanned(0), nscannedObjects(0), nreturned(0) { }
+
+            std::string op;
+            std::string ns;
+            std::string shape;   // the PlanCacheKey of queries, if any
+            BSONObj example;     // a query of the shape, if small
+            BSONObj doc;         // the profile document, if not too big
+
+            long long millis;
+            long long nscanned;
+            long long nscannedObjects;
+            long long nreturned;
+        };
+
+        OpSampleBuffer();
+
+        void add(const Sample& sample, size_t maxDocs, size_t maxShapes);
+
+        /**
+         * Moves the kept documents, oldest first, to 'docs'.
+         */
+        void drain(std::vector<BSONObj>* docs);
+
+        /**
+         * Appends sample, overwrite and shape counts.
+         */
+        void appendStats(BSONObjBuilder* builder) const;
+
+        /**
+         * Appends the totals of the 'limit' shapes with the most total time, most first.
+         */
+        void appendShapes(BSONArrayBuilder* builder, size_t limit) const;
+
+        void reset();
+
+    private:
+
+        struct ShapeTotals {
+            ShapeTotals();
+
+            std::string op;
+            std::string ns;
+            std::string shape;
+            BSONObj example;
+            long long count;
+            long long totalMillis;
+            long long maxMillis;
+            long long nscanned;
+            long long nscannedObjects;
+            long long nreturned;
+        };
+
+        typedef unordered_map<std::string, ShapeTotals> ShapeMap;
+
+        mutable SimpleMutex _mutex;
+        std::deque<BSONObj> _docs;
+        ShapeMap _shapes;
+        long long _numSampled;
+        long long _numOverwritten;
+        long long _numUnshaped;
+    };
+
+} // namespace mongo
@@ -0,0 +1,111 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/stats/op_sample_buffer.h"
+
+#include "mongo/db/json.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using namespace mongo;
+
+    OpSampleBuffer::Sample makeSample(const char* shape, long long millis, int seq) {
+        OpSampleBuffer::Sample sample;
+        sample.op = "query";
+        sample.ns = "test.foo";
+        sample.shape = shape;
+        sample.example = BSON("a" << seq);
+        sample.doc = BSON("seq" << seq);
+        sample.millis = millis;
+        sample.nscanned = 10;
+        sample.nreturned = 1;
+        return sample;
+    }
+
+    BSONObj stats(const OpSampleBuffer& buffer) {
+        BSONObjBuilder builder;
+        buffer.appendStats(&builder);
+        return builder.obj();
+    }
+
+    TEST(OpSampleBuffer, OverwritesOldestDocs) {
+        OpSampleBuffer buffer;
+        for (int i = 0; i < 5; i++) {
+            buffer.add(makeSample("eqa", 1, i), 3, 10);
+        }
+
+        std::vector<BSONObj> docs;
+        buffer.drain(&docs);
+        ASSERT_EQUALS(docs.size(), 3U);
+        ASSERT_EQUALS(docs[0], BSON("seq" << 2));
+        ASSERT_EQUALS(docs[2], BSON("seq" << 4));
+        ASSERT_EQUALS(stats(buffer), fromjson("{sampled: 5, buffered: 0, overwritten: 2, "
+                                              "shapes: 1, unshaped: 0}"));
+
+        // Drained documents are gone, shape totals are not
+        docs.clear();
+        buffer.drain(&docs);
+        ASSERT(docs.empty());
+    }
+
+    TEST(OpSampleBuffer, ShapeTotals) {
+        OpSampleBuffer buffer;
+        buffer.add(makeSample("eqa", 5, 0), 10, 2);
+        buffer.add(makeSample("eqb", 20, 1), 10, 2);
+        buffer.add(makeSample("eqa", 30, 2), 10, 2);
+        // Past the shape limit, only counted
+        buffer.add(makeSample("eqc", 100, 3), 10, 2);
+
+        BSONArrayBuilder builder;
+        buffer.appendShapes(&builder, 10);
+        BSONArray shapes = builder.arr();
+        ASSERT_EQUALS(shapes.nFields(), 2);
+
+        BSONObj first = shapes["0"].Obj();
+        ASSERT_EQUALS(first["shape"].str(), "eqa");
+        ASSERT_EQUALS(first["example"].Obj(), BSON("a" << 0));
+        ASSERT_EQUALS(first["count"].numberLong(), 2);
+        ASSERT_EQUALS(first["totalMillis"].numberLong(), 35);
+        ASSERT_EQUALS(first["maxMillis"].numberLong(), 30);
+        ASSERT_EQUALS(first["nscanned"].numberLong(), 20);
+        ASSERT_EQUALS(first["nreturned"].numberLong(), 2);
+        ASSERT_EQUALS(shapes["1"].Obj()["shape"].str(), "eqb");
+
+        BSONArrayBuilder limitedBuilder;
+        buffer.appendShapes(&limitedBuilder, 1);
+        ASSERT_EQUALS(limitedBuilder.arr().nFields(), 1);
+
+        ASSERT_EQUALS(stats(buffer)["unshaped"].numberLong(), 1);
+
+        buffer.reset();
+        ASSERT_EQUALS(stats(buffer), fromjson("{sampled: 0, buffered: 0, overwritten: 0, "
+                                              "shapes: 0, unshaped: 0}"));
+    }
+
+} // namespace
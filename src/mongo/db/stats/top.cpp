@@ -40,6 +40,7 @@
 #include "mongo/util/log.h"
 #include "mongo/util/net/message.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/commands/server_status.h"
 
 namespace mongo {
 
@@ -47,6 +48,7 @@ namespace mongo {
         // this won't be 100% accurate on rollovers and drop(), but at least it won't be negative
         time  = (newer.time  >= older.time)  ? (newer.time  - older.time)  : newer.time;
         count = (newer.count >= older.count) ? (newer.count - older.count) : newer.count;
+        latency = LatencyHistogram( older.latency , newer.latency );
     }
 
     Top::CollectionData::CollectionData( const CollectionData& older , const CollectionData& newer )
@@ -127,17 +129,23 @@ namespace mongo {
         _lastDropped = ns.toString();
     }
 
+    Top::CollectionData Top::getGlobalData() const {
+        SimpleMutex::scoped_lock lk(_lock);
+        return _global;
+    }
+
     void Top::cloneMap(Top::UsageMap& out) const {
         SimpleMutex::scoped_lock lk(_lock);
         out = _usage;
     }
 
-    void Top::append( BSONObjBuilder& b ) {
+    void Top::append( BSONObjBuilder& b , bool includeHistograms ) {
         SimpleMutex::scoped_lock lk( _lock );
-        _appendToUsageMap( b , _usage );
+        _appendToUsageMap( b , _usage , includeHistograms );
     }
 
-    void Top::_appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ) const {
+    void Top::_appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ,
+                                 bool includeHistograms ) const {
         // pull all the names into a vector so we can sort them for the user
         
         vector<string> names;
@@ -152,26 +160,32 @@ namespace mongo {
 
             const CollectionData& coll = map.find(names[i])->second;
 
-            _appendStatsEntry( b , "total" , coll.total );
+            appendStatsEntry( b , "total" , coll.total , includeHistograms );
 
-            _appendStatsEntry( b , "readLock" , coll.readLock );
-            _appendStatsEntry( b , "writeLock" , coll.writeLock );
+            appendStatsEntry( b , "readLock" , coll.readLock , includeHistograms );
+            appendStatsEntry( b , "writeLock" , coll.writeLock , includeHistograms );
 
-            _appendStatsEntry( b , "queries" , coll.queries );
-            _appendStatsEntry( b , "getmore" , coll.getmore );
-            _appendStatsEntry( b , "insert" , coll.insert );
-            _appendStatsEntry( b , "update" , coll.update );
-            _appendStatsEntry( b , "remove" , coll.remove );
-            _appendStatsEntry( b , "commands" , coll.commands );
+            appendStatsEntry( b , "queries" , coll.queries , includeHistograms );
+            appendStatsEntry( b , "getmore" , coll.getmore , includeHistograms );
+            appendStatsEntry( b , "insert" , coll.insert , includeHistograms );
+            appendStatsEntry( b , "update" , coll.update , includeHistograms );
+            appendStatsEntry( b , "remove" , coll.remove , includeHistograms );
+            appendStatsEntry( b , "commands" , coll.commands , includeHistograms );
 
             bb.done();
         }
     }
 
-    void Top::_appendStatsEntry( BSONObjBuilder& b , const char * statsName , const UsageData& map ) const {
+    void Top::appendStatsEntry( BSONObjBuilder& b , const char * statsName , const UsageData& map ,
+                                bool includeHistograms ) {
         BSONObjBuilder bb( b.subobjStart( statsName ) );
         bb.appendNumber( "time" , map.time );
         bb.appendNumber( "count" , map.count );
+        if ( map.latency.getCount() > 0 ) {
+            BSONObjBuilder latencyBuilder( bb.subobjStart( "latency" ) );
+            map.latency.append( &latencyBuilder , includeHistograms );
+            latencyBuilder.done();
+        }
         bb.done();
     }
 
@@ -182,7 +196,10 @@ namespace mongo {
         virtual bool slaveOk() const { return true; }
         virtual bool adminOnly() const { return true; }
         virtual bool isWriteCommandForConfigServer() const { return false; }
-        virtual void help( stringstream& help ) const { help << "usage by collection, in micros "; }
+        virtual void help( stringstream& help ) const {
+            help << "usage by collection, in micros\n"
+                    "{ top : 1 , histograms : true } also returns the latency histogram buckets";
+        }
         virtual void addRequiredPrivileges(const std::string& dbname,
                                            const BSONObj& cmdObj,
                                            std::vector<Privilege>* out) {
@@ -194,7 +211,7 @@ namespace mongo {
             {
                 BSONObjBuilder b( result.subobjStart( "totals" ) );
                 b.append( "note" , "all times in microseconds" );
-                Top::global.append( b );
+                Top::global.append( b , cmdObj["histograms"].trueValue() );
                 b.done();
             }
             return true;
@@ -202,6 +219,33 @@ namespace mongo {
 
     } topCmd;
 
+    /**
+     * The latency histograms of all operations by type.
+     * { serverStatus : 1 , opLatencies : { histograms : true } } also returns the buckets.
+     */
+    class OpLatenciesServerStatusSection : public ServerStatusSection {
+    public:
+        OpLatenciesServerStatusSection() : ServerStatusSection( "opLatencies" ) {}
+        virtual bool includeByDefault() const { return true; }
+
+        virtual BSONObj generateSection(const BSONElement& configElement) const {
+            const bool includeHistograms = configElement.type() == Object &&
+                configElement.Obj()["histograms"].trueValue();
+
+            const Top::CollectionData global = Top::global.getGlobalData();
+
+            BSONObjBuilder b;
+            Top::appendStatsEntry( b , "queries" , global.queries , includeHistograms );
+            Top::appendStatsEntry( b , "getmore" , global.getmore , includeHistograms );
+            Top::appendStatsEntry( b , "insert" , global.insert , includeHistograms );
+            Top::appendStatsEntry( b , "update" , global.update , includeHistograms );
+            Top::appendStatsEntry( b , "remove" , global.remove , includeHistograms );
+            Top::appendStatsEntry( b , "commands" , global.commands , includeHistograms );
+            return b.obj();
+        }
+
+    } opLatenciesServerStatusSection;
+
     Top Top::global;
 
 }
@@ -31,6 +31,7 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include "mongo/db/stats/latency_histogram.h"
 #include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/string_map.h"
 
@@ -49,10 +50,12 @@ namespace mongo {
             UsageData( const UsageData& older , const UsageData& newer );
             long long time;
             long long count;
+            LatencyHistogram latency;
 
             void inc( long long micros ) {
                 count++;
                 time += micros;
+                latency.record( micros > 0 ? micros : 0 );
             }
         };
 
@@ -80,17 +83,26 @@ namespace mongo {
 
     public:
         void record( const StringData& ns , int op , int lockType , long long micros , bool command );
-        void append( BSONObjBuilder& b );
+        /**
+         * Appends the usage of every namespace.  With 'includeHistograms' the latency histogram
+         * buckets are appended too, not just their percentiles.
+         */
+        void append( BSONObjBuilder& b , bool includeHistograms = false );
         void cloneMap(UsageMap& out) const;
-        CollectionData getGlobalData() const { return _global; }
+        CollectionData getGlobalData() const;
         void collectionDropped( const StringData& ns );
 
+        /**
+         * Appends the time, count and latency percentiles of 'map' as 'statsName'.
+         */
+        static void appendStatsEntry( BSONObjBuilder& b , const char * statsName ,
+                                      const UsageData& map , bool includeHistograms );
+
     public: // static stuff
         static Top global;
 
     private:
-        void _appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ) const;
-        void _appendStatsEntry( BSONObjBuilder& b , const char * statsName , const UsageData& map ) const;
+        void _appendToUsageMap( BSONObjBuilder& b , const UsageMap& map , bool includeHistograms ) const;
         void _record( CollectionData& c , int op , int lockType , long long micros , bool command );
 
         mutable SimpleMutex _lock;
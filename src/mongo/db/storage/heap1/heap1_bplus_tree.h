@@ -0,0 +1,574 @@
+// heap1_bplus_tree.h
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/cstdint.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    /**
+     * An ordered container of unique keys held in a B+tree with wide nodes, for the heap1
+     * engine's indexes and record stores. The values of a leaf are kept together in one sorted
+     * array and the leaves are linked in order, so a search touches a handful of nodes rather
+     * than a red-black tree node per level, and a scan walks contiguous memory.
+     *
+     * The interface is the subset of std::set / std::map which heap1 uses. Unlike those, any
+     * insert or erase invalidates every iterator into the tree other than end(). Callers
+     * which hold iterators across modifications remember where they were, check version() and
+     * seek back when it has changed.
+     *
+     * Nodes are freed when they empty out and a leaf which drops below a quarter full is merged
+     * with its right sibling when the two fit in half a leaf; there is no other rebalancing.
+     */
+    template <typename Key, typename Value, typename KeyOfValue, typename Compare>
+    class Heap1BPlusTree {
+        MONGO_DISALLOW_COPYING(Heap1BPlusTree);
+
+        struct Leaf;
+
+    public:
+        typedef Key key_type;
+        typedef Value value_type;
+        typedef Compare key_compare;
+        typedef size_t size_type;
+
+        template <typename Reference, typename Pointer>
+        class IteratorBase {
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef Value value_type;
+            typedef ptrdiff_t difference_type;
+            typedef Pointer pointer;
+            typedef Reference reference;
+
+            IteratorBase() : _tree(NULL), _leaf(NULL), _pos(0) {}
+
+            // Allows an iterator to convert to a const_iterator.
+            template <typename R, typename P>
+            IteratorBase(const IteratorBase<R, P>& other)
+                : _tree(other._tree), _leaf(other._leaf), _pos(other._pos) {}
+
+            reference operator*() const { return _leaf->values[_pos]; }
+            pointer operator->() const { return &_leaf->values[_pos]; }
+
+            IteratorBase& operator++() {
+                if (++_pos == _leaf->values.size()) {
+                    _leaf = _leaf->next;
+                    _pos = 0;
+                }
+                return *this;
+            }
+
+            IteratorBase operator++(int) {
+                IteratorBase old = *this;
+                ++*this;
+                return old;
+            }
+
+            IteratorBase& operator--() {
+                if (!_leaf) {
+                    _leaf = _tree->_last;
+                    _pos = _leaf->values.size() - 1;
+                }
+                else if (_pos == 0) {
+                    _leaf = _leaf->prev;
+                    _pos = _leaf->values.size() - 1;
+                }
+                else {
+                    --_pos;
+                }
+                return *this;
+            }
+
+            IteratorBase operator--(int) {
+                IteratorBase old = *this;
+                --*this;
+                return old;
+            }
+
+            template <typename R, typename P>
+            bool operator==(const IteratorBase<R, P>& other) const {
+                return _leaf == other._leaf && _pos == other._pos;
+            }
+
+            template <typename R, typename P>
+            bool operator!=(const IteratorBase<R, P>& other) const {
+                return !(*this == other);
+            }
+
+        private:
+            template <typename R, typename P> friend class IteratorBase;
+            friend class Heap1BPlusTree;
+
+            IteratorBase(const Heap1BPlusTree* tree, Leaf* leaf, size_t pos)
+                : _tree(tree), _leaf(leaf), _pos(pos) {}
+
+            const Heap1BPlusTree* _tree;
+            Leaf* _leaf; // NULL at end()
+            size_t _pos;
+        };
+
+        typedef IteratorBase<Value&, Value*> iterator;
+        typedef IteratorBase<const Value&, const Value*> const_iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+        explicit Heap1BPlusTree(const Compare& comp = Compare())
+            : _comp(comp), _root(NULL), _first(NULL), _last(NULL), _size(0), _version(0) {}
+
+        ~Heap1BPlusTree() { _free(_root); }
+
+        key_compare key_comp() const { return _comp; }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        /**
+         * Changes on every insert and erase, so a caller can tell that iterators it holds have
+         * been invalidated.
+         */
+        uint64_t version() const { return _version; }
+
+        iterator begin() { return iterator(this, _first, 0); }
+        iterator end() { return iterator(this, NULL, 0); }
+        const_iterator begin() const { return const_iterator(this, _first, 0); }
+        const_iterator end() const { return const_iterator(this, NULL, 0); }
+
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        iterator lower_bound(const Key& key) { return _bound(key, false); }
+        iterator upper_bound(const Key& key) { return _bound(key, true); }
+        const_iterator lower_bound(const Key& key) const { return _bound(key, false); }
+        const_iterator upper_bound(const Key& key) const { return _bound(key, true); }
+
+        iterator find(const Key& key) {
+            const iterator it = lower_bound(key);
+            return (it == end() || _comp(key, KeyOfValue()(*it))) ? end() : it;
+        }
+
+        const_iterator find(const Key& key) const {
+            const const_iterator it = lower_bound(key);
+            return (it == end() || _comp(key, KeyOfValue()(*it))) ? end() : it;
+        }
+
+        /**
+         * Inserts value unless its key is already present.
+         * @return the position of the value with its key and whether it was inserted.
+         */
+        std::pair<iterator, bool> insert(const Value& value) {
+            if (!_root) {
+                _root = _first = _last = new Leaf();
+            }
+
+            InsertResult result;
+            Node* const split = _insert(_root, value, &result);
+            if (split) {
+                Inner* const root = new Inner();
+                root->keys.push_back(_lowKey(_root));
+                root->keys.push_back(_lowKey(split));
+                root->children.push_back(_root);
+                root->children.push_back(split);
+                _root = root;
+            }
+
+            if (result.inserted) {
+                _size++;
+                _version++;
+            }
+            return std::make_pair(iterator(this, result.leaf, result.pos), result.inserted);
+        }
+
+        /**
+         * The position is only a hint for std::set compatibility; values go where they belong.
+         */
+        iterator insert(const_iterator position, const Value& value) {
+            return insert(value).first;
+        }
+
+        /**
+         * @return the position after the erased value.
+         */
+        iterator erase(const_iterator position) {
+            invariant(position._leaf);
+
+            std::vector<std::pair<Inner*, size_t> > path;
+            Leaf* const leaf = _findLeaf(KeyOfValue()(*position), &path);
+            invariant(leaf == position._leaf);
+
+            size_t pos = position._pos;
+            leaf->values.erase(leaf->values.begin() + pos);
+            _size--;
+            _version++;
+
+            Leaf* resultLeaf = leaf;
+            if (leaf->values.empty()) {
+                resultLeaf = leaf->next;
+                pos = 0;
+                _removeLeaf(leaf, &path);
+            }
+            else if (leaf->values.size() < kLeafCapacity / 4) {
+                _mergeWithNext(leaf, &path);
+            }
+
+            if (resultLeaf && pos == resultLeaf->values.size()) {
+                resultLeaf = resultLeaf->next;
+                pos = 0;
+            }
+            return iterator(this, resultLeaf, pos);
+        }
+
+        /**
+         * @return the number of values erased, which is 0 or 1.
+         */
+        size_t erase(const Key& key) {
+            const iterator it = find(key);
+            if (it == end())
+                return 0;
+            erase(it);
+            return 1;
+        }
+
+        void clear() {
+            _free(_root);
+            _root = _first = _last = NULL;
+            _size = 0;
+            _version++;
+        }
+
+    protected:
+        // Leaves hold around a page of values, which keeps the cost of shifting values to insert
+        // in the middle of one low while a search only visits a few under a million values.
+        static const size_t kLeafCapacity = 4096 / sizeof(Value) > 128 ? 128 :
+                                            4096 / sizeof(Value) < 8 ? 8 :
+                                            4096 / sizeof(Value);
+        static const size_t kInnerCapacity = 64;
+
+    private:
+        struct Node {
+            explicit Node(bool isLeaf) : isLeaf(isLeaf) {}
+            const bool isLeaf;
+        };
+
+        struct Leaf : public Node {
+            Leaf() : Node(true), prev(NULL), next(NULL) { values.reserve(kLeafCapacity); }
+
+            std::vector<Value> values;
+            Leaf* prev;
+            Leaf* next;
+        };
+
+        /**
+         * keys[i] is at most the lowest key under children[i] and above every key under
+         * children[i - 1]. keys[0] only ever matters when the node is split.
+         */
+        struct Inner : public Node {
+            Inner() : Node(false) {
+                keys.reserve(kInnerCapacity);
+                children.reserve(kInnerCapacity);
+            }
+
+            std::vector<Key> keys;
+            std::vector<Node*> children;
+        };
+
+        struct InsertResult {
+            Leaf* leaf;
+            size_t pos;
+            bool inserted;
+        };
+
+        struct ValueBeforeKey {
+            explicit ValueBeforeKey(const Compare& comp) : comp(comp) {}
+            bool operator()(const Value& value, const Key& key) const {
+                return comp(KeyOfValue()(value), key);
+            }
+            Compare comp;
+        };
+
+        struct KeyBeforeValue {
+            explicit KeyBeforeValue(const Compare& comp) : comp(comp) {}
+            bool operator()(const Key& key, const Value& value) const {
+                return comp(key, KeyOfValue()(value));
+            }
+            Compare comp;
+        };
+
+        /**
+         * @return the index of the child of node which key belongs under.
+         */
+        size_t _childFor(const Inner* node, const Key& key) const {
+            const typename std::vector<Key>::const_iterator it =
+                std::upper_bound(node->keys.begin() + 1, node->keys.end(), key, _comp);
+            return (it - node->keys.begin()) - 1;
+        }
+
+        Leaf* _findLeaf(const Key& key, std::vector<std::pair<Inner*, size_t> >* path) const {
+            Node* node = _root;
+            while (!node->isLeaf) {
+                Inner* const inner = static_cast<Inner*>(node);
+                const size_t child = _childFor(inner, key);
+                if (path)
+                    path->push_back(std::make_pair(inner, child));
+                node = inner->children[child];
+            }
+            return static_cast<Leaf*>(node);
+        }
+
+        iterator _bound(const Key& key, bool upper) const {
+            if (!_root)
+                return iterator(this, NULL, 0);
+
+            Leaf* const leaf = _findLeaf(key, NULL);
+            const typename std::vector<Value>::const_iterator it = upper
+                ? std::upper_bound(leaf->values.begin(), leaf->values.end(), key,
+                                   KeyBeforeValue(_comp))
+                : std::lower_bound(leaf->values.begin(), leaf->values.end(), key,
+                                   ValueBeforeKey(_comp));
+
+            const size_t pos = it - leaf->values.begin();
+            if (pos == leaf->values.size()) {
+                // Leaves are never empty, so the bound is the first value of the next one.
+                return iterator(this, leaf->next, 0);
+            }
+            return iterator(this, leaf, pos);
+        }
+
+        const Key& _lowKey(const Node* node) const {
+            if (node->isLeaf)
+                return KeyOfValue()(static_cast<const Leaf*>(node)->values.front());
+            return static_cast<const Inner*>(node)->keys.front();
+        }
+
+        /**
+         * Inserts value under node, filling in result.
+         * @return the new right sibling of node if node had to be split, otherwise NULL.
+         */
+        Node* _insert(Node* node, const Value& value, InsertResult* result) {
+            const Key& key = KeyOfValue()(value);
+
+            if (node->isLeaf) {
+                Leaf* const leaf = static_cast<Leaf*>(node);
+                const typename std::vector<Value>::iterator it =
+                    std::lower_bound(leaf->values.begin(), leaf->values.end(), key,
+                                     ValueBeforeKey(_comp));
+                result->leaf = leaf;
+                result->pos = it - leaf->values.begin();
+                result->inserted = it == leaf->values.end() || _comp(key, KeyOfValue()(*it));
+                if (!result->inserted)
+                    return NULL;
+
+                leaf->values.insert(it, value);
+                if (leaf->values.size() <= kLeafCapacity)
+                    return NULL;
+
+                Leaf* const right = new Leaf();
+                const size_t half = leaf->values.size() / 2;
+                right->values.assign(leaf->values.begin() + half, leaf->values.end());
+                leaf->values.erase(leaf->values.begin() + half, leaf->values.end());
+
+                right->prev = leaf;
+                right->next = leaf->next;
+                if (leaf->next)
+                    leaf->next->prev = right;
+                else
+                    _last = right;
+                leaf->next = right;
+
+                if (result->pos >= half) {
+                    result->leaf = right;
+                    result->pos -= half;
+                }
+                return right;
+            }
+
+            Inner* const inner = static_cast<Inner*>(node);
+            const size_t child = _childFor(inner, key);
+            Node* const split = _insert(inner->children[child], value, result);
+            if (!split)
+                return NULL;
+
+            inner->keys.insert(inner->keys.begin() + child + 1, _lowKey(split));
+            inner->children.insert(inner->children.begin() + child + 1, split);
+            if (inner->children.size() <= kInnerCapacity)
+                return NULL;
+
+            Inner* const right = new Inner();
+            const size_t half = inner->children.size() / 2;
+            right->keys.assign(inner->keys.begin() + half, inner->keys.end());
+            right->children.assign(inner->children.begin() + half, inner->children.end());
+            inner->keys.erase(inner->keys.begin() + half, inner->keys.end());
+            inner->children.erase(inner->children.begin() + half, inner->children.end());
+            return right;
+        }
+
+        /**
+         * Unlinks and frees an empty leaf along with any inner nodes left without children.
+         */
+        void _removeLeaf(Leaf* leaf, std::vector<std::pair<Inner*, size_t> >* path) {
+            if (leaf->prev)
+                leaf->prev->next = leaf->next;
+            else
+                _first = leaf->next;
+            if (leaf->next)
+                leaf->next->prev = leaf->prev;
+            else
+                _last = leaf->prev;
+            delete leaf;
+
+            while (!path->empty()) {
+                Inner* const parent = path->back().first;
+                const size_t child = path->back().second;
+                path->pop_back();
+
+                parent->keys.erase(parent->keys.begin() + child);
+                parent->children.erase(parent->children.begin() + child);
+                if (!parent->children.empty()) {
+                    _collapseRoot();
+                    return;
+                }
+                delete parent;
+            }
+
+            // That was the last leaf.
+            _root = NULL;
+        }
+
+        void _mergeWithNext(Leaf* leaf, std::vector<std::pair<Inner*, size_t> >* path) {
+            if (path->empty())
+                return;
+
+            // Only merge siblings, so that the separator keys above stay right.
+            Inner* const parent = path->back().first;
+            const size_t child = path->back().second;
+            if (child + 1 == parent->children.size())
+                return;
+
+            Leaf* const next = leaf->next;
+            invariant(next == parent->children[child + 1]);
+            if (leaf->values.size() + next->values.size() > kLeafCapacity / 2)
+                return;
+
+            leaf->values.insert(leaf->values.end(), next->values.begin(), next->values.end());
+            next->values.clear();
+
+            path->back().second = child + 1;
+            _removeLeaf(next, path);
+        }
+
+        void _collapseRoot() {
+            while (!_root->isLeaf && static_cast<Inner*>(_root)->children.size() == 1) {
+                Inner* const old = static_cast<Inner*>(_root);
+                _root = old->children.front();
+                delete old;
+            }
+        }
+
+        void _free(Node* node) {
+            if (!node)
+                return;
+
+            if (node->isLeaf) {
+                delete static_cast<Leaf*>(node);
+                return;
+            }
+
+            Inner* const inner = static_cast<Inner*>(node);
+            for (size_t i = 0; i < inner->children.size(); i++) {
+                _free(inner->children[i]);
+            }
+            delete inner;
+        }
+
+        const Compare _comp;
+        Node* _root; // NULL when empty
+        Leaf* _first;
+        Leaf* _last;
+        size_t _size;
+        uint64_t _version;
+    };
+
+    template <typename T>
+    struct Heap1Identity {
+        const T& operator()(const T& value) const { return value; }
+    };
+
+    template <typename Pair>
+    struct Heap1SelectFirst {
+        const typename Pair::first_type& operator()(const Pair& value) const {
+            return value.first;
+        }
+    };
+
+    /**
+     * A Heap1BPlusTree standing in for std::set.
+     */
+    template <typename T, typename Compare>
+    class Heap1BPlusTreeSet : public Heap1BPlusTree<T, T, Heap1Identity<T>, Compare> {
+    public:
+        explicit Heap1BPlusTreeSet(const Compare& comp = Compare())
+            : Heap1BPlusTree<T, T, Heap1Identity<T>, Compare>(comp) {}
+    };
+
+    /**
+     * A Heap1BPlusTree standing in for std::map. Keys are not const in the values, but must not
+     * be changed through an iterator.
+     */
+    template <typename Key, typename T, typename Compare = std::less<Key> >
+    class Heap1BPlusTreeMap
+        : public Heap1BPlusTree<Key, std::pair<Key, T>, Heap1SelectFirst<std::pair<Key, T> >,
+                                Compare> {
+    public:
+        typedef Heap1BPlusTree<Key, std::pair<Key, T>, Heap1SelectFirst<std::pair<Key, T> >,
+                               Compare> Base;
+
+        explicit Heap1BPlusTreeMap(const Compare& comp = Compare()) : Base(comp) {}
+
+        T& operator[](const Key& key) {
+            typename Base::iterator it = this->find(key);
+            if (it == this->end())
+                it = this->insert(std::make_pair(key, T())).first;
+            return it->second;
+        }
+    };
+
+} // namespace mongo
@@ -0,0 +1,179 @@
+// heap1_bplus_tree_test.cpp
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/storage/heap1/heap1_bplus_tree.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+    typedef Heap1BPlusTreeSet<int, std::less<int> > IntTree;
+
+    void assertSame(const std::set<int>& expected, const IntTree& tree) {
+        ASSERT_EQUALS(expected.size(), tree.size());
+        ASSERT_EQUALS(expected.empty(), tree.empty());
+
+        std::set<int>::const_iterator e = expected.begin();
+        for (IntTree::const_iterator it = tree.begin(); it != tree.end(); ++it, ++e) {
+            ASSERT_EQUALS(*e, *it);
+        }
+
+        std::set<int>::const_reverse_iterator re = expected.rbegin();
+        for (IntTree::const_reverse_iterator it = tree.rbegin(); it != tree.rend(); ++it, ++re) {
+            ASSERT_EQUALS(*re, *it);
+        }
+    }
+
+    TEST(Heap1BPlusTree, Empty) {
+        IntTree tree;
+        ASSERT(tree.empty());
+        ASSERT(tree.begin() == tree.end());
+        ASSERT(tree.rbegin() == tree.rend());
+        ASSERT(tree.find(1) == tree.end());
+        ASSERT(tree.lower_bound(1) == tree.end());
+        ASSERT_EQUALS(0U, tree.erase(1));
+    }
+
+    TEST(Heap1BPlusTree, InsertIsUnique) {
+        IntTree tree;
+        ASSERT(tree.insert(5).second);
+        ASSERT(!tree.insert(5).second);
+        ASSERT_EQUALS(1U, tree.size());
+        ASSERT_EQUALS(5, *tree.insert(5).first);
+    }
+
+    TEST(Heap1BPlusTree, RandomOperationsMatchStdSet) {
+        PseudoRandom rand(12345);
+        std::set<int> expected;
+        IntTree tree;
+
+        // Grow the tree to several levels, then shrink it back to nothing.
+        for (int round = 0; round < 2; round++) {
+            for (int i = 0; i < 20000; i++) {
+                const int value = rand.nextInt32(10000);
+                const bool doInsert = round == 0 ? rand.nextInt32(4) != 0 : rand.nextInt32(4) == 0;
+                if (doInsert) {
+                    const bool inserted = expected.insert(value).second;
+                    const std::pair<IntTree::iterator, bool> res = tree.insert(value);
+                    ASSERT_EQUALS(inserted, res.second);
+                    ASSERT_EQUALS(value, *res.first);
+                }
+                else {
+                    ASSERT_EQUALS(expected.erase(value), tree.erase(value));
+                }
+            }
+            assertSame(expected, tree);
+
+            for (int value = -1; value <= 10000; value += 7) {
+                std::set<int>::const_iterator e = expected.lower_bound(value);
+                IntTree::const_iterator it = tree.lower_bound(value);
+                ASSERT_EQUALS(e == expected.end(), it == tree.end());
+                if (e != expected.end())
+                    ASSERT_EQUALS(*e, *it);
+
+                e = expected.upper_bound(value);
+                it = tree.upper_bound(value);
+                ASSERT_EQUALS(e == expected.end(), it == tree.end());
+                if (e != expected.end())
+                    ASSERT_EQUALS(*e, *it);
+
+                ASSERT_EQUALS(expected.count(value) == 1, tree.find(value) != tree.end());
+            }
+        }
+
+        while (!tree.empty()) {
+            ASSERT_EQUALS(*expected.begin(), *tree.begin());
+            expected.erase(expected.begin());
+            tree.erase(tree.begin());
+        }
+        assertSame(expected, tree);
+    }
+
+    TEST(Heap1BPlusTree, EraseReturnsNext) {
+        IntTree tree;
+        for (int i = 0; i < 5000; i++) {
+            tree.insert(i);
+        }
+
+        // Erasing every other value leaves leaves to be merged and freed along the way.
+        IntTree::iterator it = tree.begin();
+        int expectedNext = 0;
+        while (it != tree.end()) {
+            ASSERT_EQUALS(expectedNext, *it);
+            it = tree.erase(it);
+            if (it == tree.end())
+                break;
+            ASSERT_EQUALS(expectedNext + 1, *it);
+            ++it;
+            expectedNext += 2;
+        }
+
+        ASSERT_EQUALS(2500U, tree.size());
+        int value = 1;
+        for (IntTree::const_iterator cit = tree.begin(); cit != tree.end(); ++cit, value += 2) {
+            ASSERT_EQUALS(value, *cit);
+        }
+    }
+
+    TEST(Heap1BPlusTree, VersionChangesOnModification) {
+        IntTree tree;
+        const uint64_t start = tree.version();
+        tree.insert(1);
+        ASSERT_NOT_EQUALS(start, tree.version());
+
+        const uint64_t afterInsert = tree.version();
+        tree.insert(1);
+        ASSERT_EQUALS(afterInsert, tree.version());
+
+        tree.erase(1);
+        ASSERT_NOT_EQUALS(afterInsert, tree.version());
+    }
+
+    TEST(Heap1BPlusTree, Map) {
+        Heap1BPlusTreeMap<int, std::string> tree;
+        for (int i = 0; i < 1000; i++) {
+            tree[i] = "a";
+        }
+        tree[500] = "b";
+
+        ASSERT_EQUALS(1000U, tree.size());
+        ASSERT_EQUALS("b", tree.find(500)->second);
+        ASSERT_EQUALS(999, tree.rbegin()->first);
+        ASSERT_EQUALS(500, tree.upper_bound(499)->first);
+    }
+
+} // namespace
+} // namespace mongo
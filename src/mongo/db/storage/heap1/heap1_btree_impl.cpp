@@ -30,9 +30,8 @@
 
 #include "mongo/db/storage/heap1/heap1_btree_impl.h"
 
-#include <set>
-
 #include "mongo/db/catalog/index_catalog_entry.h"
+#include "mongo/db/storage/heap1/heap1_bplus_tree.h"
 #include "mongo/db/storage/heap1/heap1_recovery_unit.h"
 #include "mongo/db/storage/index_entry_comparison.h"
 #include "mongo/util/mongoutils/str.h"
@@ -61,7 +60,7 @@ namespace {
         return bb.obj();
     }
 
-    typedef std::set<IndexKeyEntry, IndexEntryComparison> IndexSet;
+    typedef Heap1BPlusTreeSet<IndexKeyEntry, IndexEntryComparison> IndexSet;
 
     // taken from btree_logic.cpp
     Status dupKeyError(const BSONObj& key) {
@@ -105,18 +104,19 @@ namespace {
 
             if (!_data->empty()) {
                 // Compare specified key with last inserted key, ignoring its DiskLoc
-                int cmp = _comparator.compare(IndexKeyEntry(key, DiskLoc()), *_last);
-                if (cmp < 0 || (_dupsAllowed && cmp == 0 && loc < _last->loc)) {
+                const IndexKeyEntry& last = *_data->rbegin();
+                int cmp = _comparator.compare(IndexKeyEntry(key, DiskLoc()), last);
+                if (cmp < 0 || (_dupsAllowed && cmp == 0 && loc < last.loc)) {
                     return Status(ErrorCodes::InternalError,
                                   "expected ascending (key, DiskLoc) order in bulk builder");
                 }
-                else if (!_dupsAllowed && cmp == 0 && loc != _last->loc) {
+                else if (!_dupsAllowed && cmp == 0 && loc != last.loc) {
                     return dupKeyError(key);
                 }
             }
 
             BSONObj owned = key.getOwned();
-            _last = _data->insert(_data->end(), IndexKeyEntry(owned, loc));
+            _data->insert(IndexKeyEntry(owned, loc));
             *_currentKeySize += key.objsize();
 
             return Status::OK();
@@ -128,7 +128,7 @@ namespace {
         const bool _dupsAllowed;
 
         IndexEntryComparison _comparator;  // used by the bulk builder to detect duplicate keys
-        IndexSet::const_iterator _last;    // or (key, DiskLoc) ordering violations
+                                           // or (key, DiskLoc) ordering violations
     };
 
     class Heap1BtreeImpl : public SortedDataInterface {
@@ -158,12 +158,26 @@ namespace {
                 return Status(ErrorCodes::KeyTooLong, msg);
             }
 
-            // TODO optimization: save the iterator from the dup-check to speed up insert
-            if (!dupsAllowed && isDup(*_data, key, loc))
-                return dupKeyError(key);
-
             IndexKeyEntry entry(key.getOwned(), loc);
-            if ( _data->insert(entry).second ) {
+
+            // The entries next to where this one goes are the only ones which can have its key
+            // when dups aren't allowed, so the dup check and the insert share one search.
+            const IndexEntryComparison comp = _data->key_comp();
+            const IndexSet::iterator next = _data->lower_bound(entry);
+            if (!dupsAllowed) {
+                const IndexKeyEntry keyOnly(key, DiskLoc());
+                if (next != _data->end() && comp.compare(keyOnly, *next) == 0 && next->loc != loc)
+                    return dupKeyError(key);
+                if (next != _data->begin()) {
+                    IndexSet::iterator prev = next;
+                    --prev;
+                    if (comp.compare(keyOnly, *prev) == 0)
+                        return dupKeyError(key);
+                }
+            }
+
+            if (next == _data->end() || comp(entry, *next)) {
+                _data->insert(entry);
                 _currentKeySize += key.objsize();
                 txn->recoveryUnit()->registerChange(new IndexChange(_data, entry, true));
             }
@@ -218,18 +232,23 @@ namespace {
             ForwardCursor(const IndexSet& data, OperationContext* txn)
                 : _txn(txn),
                   _data(data),
-                  _it(data.end())
-            {}
+                  _it(data.end()),
+                  _current(BSONObj(), DiskLoc()) {
+                _positioned();
+            }
 
             virtual int getDirection() const { return 1; }
 
             virtual bool isEOF() const {
+                _checkPosition();
                 return _it == _data.end();
             }
 
             virtual bool pointsToSamePlaceAs(const SortedDataInterface::Cursor& otherBase) const {
                 const ForwardCursor& other = static_cast<const ForwardCursor&>(otherBase);
                 invariant(&_data == &other._data); // iterators over same index
+                _checkPosition();
+                other._checkPosition();
                 return _it == other._it;
             }
 
@@ -240,6 +259,7 @@ namespace {
             virtual bool locate(const BSONObj& keyRaw, const DiskLoc& loc) {
                 const BSONObj key = stripFieldNames(keyRaw);
                 _it = _data.lower_bound(IndexKeyEntry(key, loc)); // lower_bound is >= key
+                _positioned();
                 if ( _it == _data.end() ) {
                     return false;
                 }
@@ -265,6 +285,7 @@ namespace {
                                                         keyEndInclusive,
                                                         1), // forward
                                                    DiskLoc()));
+                _positioned();
             }
 
             void advanceTo(const BSONObj &keyBegin,
@@ -277,16 +298,21 @@ namespace {
             }
 
             virtual BSONObj getKey() const {
+                _checkPosition();
                 return _it->key;
             }
 
             virtual DiskLoc getDiskLoc() const {
+                _checkPosition();
                 return _it->loc;
             }
 
             virtual void advance() {
-                if (_it != _data.end())
+                _checkPosition();
+                if (_it != _data.end()) {
                     ++_it;
+                    _positioned();
+                }
             }
 
             virtual void savePosition() {
@@ -303,6 +329,7 @@ namespace {
             virtual void restorePosition(OperationContext* txn) {
                 if (_savedAtEnd) {
                     _it = _data.end();
+                    _positioned();
                 }
                 else {
                     locate(_savedKey, _savedLoc);
@@ -310,10 +337,34 @@ namespace {
             }
 
         private:
+            /**
+             * Remembers the entry _it points to, so that the cursor can find its place again
+             * after the index is modified under it.
+             */
+            void _positioned() const {
+                _version = _data.version();
+                _atEnd = _it == _data.end();
+                if (!_atEnd)
+                    _current = *_it;
+            }
+
+            /**
+             * Moves _it back to the entry it was on, or the one after it if that was removed,
+             * when the index has been modified since it was positioned.
+             */
+            void _checkPosition() const {
+                if (_version == _data.version())
+                    return;
+                _it = _atEnd ? _data.end() : _data.lower_bound(_current);
+                _positioned();
+            }
 
             OperationContext* _txn; // not owned
             const IndexSet& _data;
-            IndexSet::const_iterator _it;
+            mutable IndexSet::const_iterator _it;
+            mutable uint64_t _version;
+            mutable bool _atEnd;
+            mutable IndexKeyEntry _current;
 
             // For save/restorePosition since _it may be invalidated durring a yield.
             bool _savedAtEnd;
@@ -328,18 +379,23 @@ namespace {
             ReverseCursor(const IndexSet& data, OperationContext* txn)
                 : _txn(txn),
                   _data(data),
-                  _it(data.rend())
-            {}
+                  _it(data.rend()),
+                  _current(BSONObj(), DiskLoc()) {
+                _positioned();
+            }
 
             virtual int getDirection() const { return -1; }
 
             virtual bool isEOF() const {
+                _checkPosition();
                 return _it == _data.rend();
             }
 
             virtual bool pointsToSamePlaceAs(const SortedDataInterface::Cursor& otherBase) const {
                 const ReverseCursor& other = static_cast<const ReverseCursor&>(otherBase);
                 invariant(&_data == &other._data); // iterators over same index
+                _checkPosition();
+                other._checkPosition();
                 return _it == other._it;
             }
 
@@ -350,6 +406,7 @@ namespace {
             virtual bool locate(const BSONObj& keyRaw, const DiskLoc& loc) {
                 const BSONObj key = stripFieldNames(keyRaw);
                 _it = lower_bound(IndexKeyEntry(key, loc)); // lower_bound is <= query
+                _positioned();
 
                 if ( _it == _data.rend() ) {
                     return false;
@@ -377,6 +434,7 @@ namespace {
                                                   keyEndInclusive,
                                                   -1), // reverse
                                              DiskLoc()));
+                _positioned();
             }
 
             void advanceTo(const BSONObj &keyBegin,
@@ -389,16 +447,21 @@ namespace {
             }
 
             virtual BSONObj getKey() const {
+                _checkPosition();
                 return _it->key;
             }
 
             virtual DiskLoc getDiskLoc() const {
+                _checkPosition();
                 return _it->loc;
             }
 
             virtual void advance() {
-                if (_it != _data.rend())
+                _checkPosition();
+                if (_it != _data.rend()) {
                     ++_it;
+                    _positioned();
+                }
             }
 
             virtual void savePosition() {
@@ -415,6 +478,7 @@ namespace {
             virtual void restorePosition(OperationContext* txn) {
                 if (_savedAtEnd) {
                     _it = _data.rend();
+                    _positioned();
                 }
                 else {
                     locate(_savedKey, _savedLoc);
@@ -437,9 +501,28 @@ namespace {
                 return IndexSet::const_reverse_iterator(it);
             }
 
+            // These work as they do in ForwardCursor, except that the entry before a removed
+            // one is next in this direction.
+            void _positioned() const {
+                _version = _data.version();
+                _atEnd = _it == _data.rend();
+                if (!_atEnd)
+                    _current = *_it;
+            }
+
+            void _checkPosition() const {
+                if (_version == _data.version())
+                    return;
+                _it = _atEnd ? _data.rend() : lower_bound(_current);
+                _positioned();
+            }
+
             OperationContext* _txn; // not owned
             const IndexSet& _data;
-            IndexSet::const_reverse_iterator _it;
+            mutable IndexSet::const_reverse_iterator _it;
+            mutable uint64_t _version;
+            mutable bool _atEnd;
+            mutable IndexKeyEntry _current;
 
             // For save/restorePosition since _it may be invalidated durring a yield.
             bool _savedAtEnd;
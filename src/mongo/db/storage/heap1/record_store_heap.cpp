@@ -299,6 +299,7 @@ namespace mongo {
         txn->recoveryUnit()->registerChange(new RemoveChange(_data, loc, *oldRecord));
         *oldRecord = newRecord;
 
+        // oldRecord may not be valid after this, but it shares the data written below.
         cappedDeleteAsNeeded(txn);
 
         char* root = newRecord.data.get();
@@ -310,8 +311,6 @@ namespace mongo {
             std::memcpy(targetPtr, sourcePtr, where->size);
         }
 
-        *oldRecord = newRecord;
-
         return Status::OK();
     }
 
@@ -353,7 +352,7 @@ namespace mongo {
         while(it != _data->records.end()) {
             txn->recoveryUnit()->registerChange(new RemoveChange(_data, it->first, it->second));
             _data->dataSize -= it->second.size;
-            _data->records.erase(it++);
+            it = _data->records.erase(it);
         }
     }
 
@@ -486,9 +485,23 @@ namespace mongo {
             _it = _records.find(start);
             invariant(_it != _records.end());
         }
+        _positioned();
+    }
+
+    void HeapRecordIterator::_positioned() {
+        _version = _records.version();
+        _currentLoc = _it == _records.end() ? DiskLoc() : _it->first;
+    }
+
+    void HeapRecordIterator::_checkPosition() {
+        if (_version == _records.version())
+            return;
+        _it = _currentLoc.isNull() ? _records.end() : _records.lower_bound(_currentLoc);
+        _positioned();
     }
 
     bool HeapRecordIterator::isEOF() {
+        _checkPosition();
         return _it == _records.end();
     }
 
@@ -513,18 +526,22 @@ namespace mongo {
             _it = _records.find(_lastLoc);
             invariant(_it != _records.end());
 
-            if (++_it == _records.end())
+            ++_it;
+            _positioned();
+            if (_it == _records.end())
                 return DiskLoc();
         }
 
         const DiskLoc out = _it->first;
         ++_it;
+        _positioned();
         if (_tailable && _it == _records.end())
             _lastLoc = out;
         return out;
     }
 
     void HeapRecordIterator::invalidate(const DiskLoc& loc) {
+        _checkPosition();
         if (_rs.isCapped()) {
             // Capped iterators die on invalidation rather than advancing.
             if (isEOF()) {
@@ -539,8 +556,10 @@ namespace mongo {
             return;
         }
 
-        if (_it != _records.end() && _it->first == loc)
+        if (_it != _records.end() && _it->first == loc) {
             ++_it;
+            _positioned();
+        }
     }
 
     void HeapRecordIterator::saveState() {
@@ -577,9 +596,26 @@ namespace mongo {
             _it = HeapRecordStore::Records::const_reverse_iterator(baseIt);
             invariant(_it != _records.rend());
         }
+        _positioned();
+    }
+
+    void HeapRecordReverseIterator::_positioned() {
+        _version = _records.version();
+        _currentLoc = _it == _records.rend() ? DiskLoc() : _it->first;
+    }
+
+    void HeapRecordReverseIterator::_checkPosition() {
+        if (_version == _records.version())
+            return;
+        _it = _currentLoc.isNull()
+            ? _records.rend()
+            : HeapRecordStore::Records::const_reverse_iterator(
+                  _records.upper_bound(_currentLoc));
+        _positioned();
     }
 
     bool HeapRecordReverseIterator::isEOF() {
+        _checkPosition();
         return _it == _records.rend();
     }
 
@@ -595,6 +631,7 @@ namespace mongo {
 
         const DiskLoc out = _it->first;
         ++_it;
+        _positioned();
         return out;
     }
 
@@ -612,6 +649,7 @@ namespace mongo {
             restoreState(_txn);
             invariant(_it->first == _savedLoc);
             ++_it;
+            _positioned();
             saveState();
         }
     }
@@ -632,6 +670,7 @@ namespace mongo {
         else {
             _it = HeapRecordStore::Records::const_reverse_iterator(++_records.find(_savedLoc));
         }
+        _positioned();
         return !_killedByInvalidate;
     }
 
@@ -32,9 +32,9 @@
 
 #include <boost/shared_array.hpp>
 #include <boost/shared_ptr.hpp>
-#include <map>
 
 #include "mongo/db/storage/capped_callback.h"
+#include "mongo/db/storage/heap1/heap1_bplus_tree.h"
 #include "mongo/db/storage/record_store.h"
 
 namespace mongo {
@@ -151,7 +151,7 @@ namespace mongo {
         // Not in RecordStore interface
         //
 
-        typedef std::map<DiskLoc, HeapRecord> Records;
+        typedef Heap1BPlusTreeMap<DiskLoc, HeapRecord> Records;
 
         bool isCapped() const { return _isCapped; }
         void setCappedDeleteCallback(CappedDocumentDeleteCallback* cb) { _cappedDeleteCallback = cb; }
@@ -210,8 +210,22 @@ namespace mongo {
         virtual RecordData dataFor( const DiskLoc& loc ) const;
 
     private:
+        /**
+         * Remembers the record _it points to, so that the iterator can find its place again
+         * after the records are modified under it.
+         */
+        void _positioned();
+
+        /**
+         * Moves _it back to the record it was on, or the next one in its direction if that was
+         * removed, when the records have been modified since it was positioned.
+         */
+        void _checkPosition();
+
         OperationContext* _txn; // not owned
         HeapRecordStore::Records::const_iterator _it;
+        uint64_t _version;
+        DiskLoc _currentLoc; // isNull at EOF
         bool _tailable;
         DiskLoc _lastLoc; // only for restarting tailable
         bool _killedByInvalidate;
@@ -242,8 +256,14 @@ namespace mongo {
         virtual RecordData dataFor( const DiskLoc& loc ) const;
 
     private:
+        // See HeapRecordIterator.
+        void _positioned();
+        void _checkPosition();
+
         OperationContext* _txn; // not owned
         HeapRecordStore::Records::const_reverse_iterator _it;
+        uint64_t _version;
+        DiskLoc _currentLoc; // isNull at EOF
         bool _killedByInvalidate;
         DiskLoc _savedLoc; // isNull if saved at EOF
 
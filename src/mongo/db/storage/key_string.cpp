@@ -0,0 +1,733 @@
+// key_string.cpp
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/storage/key_string.h"
+
+#include <cstring>
+#include <limits>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/platform/cstdint.h"
+#include "mongo/platform/float_utils.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    namespace {
+
+        // An element starts with its canonical type plus this, which keeps every type byte,
+        // inverted or not, clear of 0x00 and 0xff.
+        const int kTypeOffset = 10;
+
+        // Follows the last element of a key, before the DiskLoc.
+        const unsigned char kEnd = 0x01;
+
+        // Follows the last element of an embedded object or array.
+        const unsigned char kObjectEnd = 0x00;
+
+        // Follows an exclusive field of a seek key which should sort after all equal entries.
+        // Not inverted, and above every byte which can follow an element.
+        const unsigned char kExclusiveAfter = 0xff;
+
+        // Strings end with two zero bytes, and a zero byte within them is followed by 0xff.
+        const unsigned char kEscapedZero = 0xff;
+
+        // Follows the double of a number, saying how a NumberLong differs from it.
+        const unsigned char kNumberBelow = 0x7f;
+        const unsigned char kNumberExact = 0x80;
+        const unsigned char kNumberAbove = 0x81;
+
+        const uint64_t kSignBit64 = 1ULL << 63;
+        const uint32_t kSignBit32 = 1U << 31;
+
+        // The first bytes of the field names of makeQueryObject(), as in
+        // index_entry_comparison.cpp.
+        const char kQueryLess = 'l';
+        const char kQueryGreater = 'g';
+
+        // The type info of a number, in two bits.
+        const uint32_t kTypeDouble = 0;
+        const uint32_t kTypeInt = 1;
+        const uint32_t kTypeLong = 2;
+        const uint32_t kTypeNegativeZero = 3;
+
+        /**
+         * Packs the type info of a key as bits, least significant first, into out unless it is
+         * NULL. The zero bytes at the end are dropped, as reading past the end gives zeros back.
+         */
+        class TypeInfoWriter {
+        public:
+            explicit TypeInfoWriter(std::string* out) : _out(out), _numBits(0) {
+                if (_out) {
+                    _out->clear();
+                }
+            }
+
+            ~TypeInfoWriter() {
+                if (!_out)
+                    return;
+                size_t size = _out->size();
+                while (size > 0 && (*_out)[size - 1] == 0) {
+                    size--;
+                }
+                _out->resize(size);
+            }
+
+            void appendBits(uint32_t v, int count) {
+                if (!_out)
+                    return;
+                for (int i = 0; i < count; i++) {
+                    if (_numBits % 8 == 0) {
+                        _out->push_back(0);
+                    }
+                    if (v & (1U << i)) {
+                        (*_out)[_out->size() - 1] |= static_cast<char>(1 << (_numBits % 8));
+                    }
+                    _numBits++;
+                }
+            }
+
+            void appendBytes(const char* data, size_t len) {
+                for (size_t i = 0; i < len; i++) {
+                    appendBits(static_cast<unsigned char>(data[i]), 8);
+                }
+            }
+
+        private:
+            std::string* _out;
+            size_t _numBits;
+        };
+
+        class TypeInfoReader {
+        public:
+            explicit TypeInfoReader(const StringData& data) : _data(data), _numBits(0) { }
+
+            uint32_t readBits(int count) {
+                uint32_t v = 0;
+                for (int i = 0; i < count; i++) {
+                    const size_t byte = _numBits / 8;
+                    if (byte < _data.size() && (_data[byte] & (1 << (_numBits % 8)))) {
+                        v |= 1U << i;
+                    }
+                    _numBits++;
+                }
+                return v;
+            }
+
+            void readBytes(char* out, size_t len) {
+                for (size_t i = 0; i < len; i++) {
+                    out[i] = static_cast<char>(readBits(8));
+                }
+            }
+
+        private:
+            const StringData _data;
+            size_t _numBits;
+        };
+
+        class Encoder {
+        public:
+            Encoder(std::string* out, std::string* typeInfo)
+                : _out(out), _typeInfo(typeInfo), _invert(0) { }
+
+            void setDescending(bool descending) { _invert = descending ? 0xff : 0; }
+
+            void appendByte(unsigned char b) { _out->push_back(static_cast<char>(b ^ _invert)); }
+
+            void appendBytes(const char* data, size_t len) {
+                for (size_t i = 0; i < len; i++) {
+                    appendByte(static_cast<unsigned char>(data[i]));
+                }
+            }
+
+            void appendUInt32(uint32_t v) {
+                for (int shift = 24; shift >= 0; shift -= 8) {
+                    appendByte(static_cast<unsigned char>(v >> shift));
+                }
+            }
+
+            void appendUInt64(uint64_t v) {
+                for (int shift = 56; shift >= 0; shift -= 8) {
+                    appendByte(static_cast<unsigned char>(v >> shift));
+                }
+            }
+
+            /** For strings compared with strcmp, which can't hold a zero byte. */
+            void appendCString(const char* str) {
+                appendBytes(str, strlen(str) + 1);
+            }
+
+            /** For strings compared with memcmp and then by length. */
+            void appendString(const char* str, size_t len) {
+                for (size_t i = 0; i < len; i++) {
+                    appendByte(static_cast<unsigned char>(str[i]));
+                    if (str[i] == '\0') {
+                        appendByte(kEscapedZero);
+                    }
+                }
+                appendByte(0);
+                appendByte(0);
+            }
+
+            void appendTypeByte(const BSONElement& e) {
+                appendByte(static_cast<unsigned char>(e.canonicalType() + kTypeOffset));
+            }
+
+            /** Follows compareElementValues() for each type. */
+            void appendValue(const BSONElement& e) {
+                switch (e.type()) {
+                case MinKey:
+                case MaxKey:
+                case EOO:
+                case Undefined:
+                case jstNULL:
+                    break;
+                case NumberDouble:
+                case NumberInt:
+                case NumberLong:
+                    appendNumber(e);
+                    break;
+                case String:
+                case Symbol:
+                    _typeInfo.appendBits(e.type() == Symbol, 1);
+                    appendString(e.valuestr(), e.valuestrsize() - 1);
+                    break;
+                case Code:
+                    appendString(e.valuestr(), e.valuestrsize() - 1);
+                    break;
+                case Object:
+                case Array: {
+                    BSONObjIterator it(e.embeddedObject());
+                    while (it.more()) {
+                        const BSONElement sub = it.next();
+                        appendTypeByte(sub);
+                        appendCString(sub.fieldName());
+                        appendValue(sub);
+                    }
+                    appendByte(kObjectEnd);
+                    break;
+                }
+                case BinData:
+                    appendUInt32(e.objsize());
+                    appendBytes(e.value() + 4, e.objsize() + 1);  // subtype byte and data
+                    break;
+                case jstOID:
+                    appendBytes(e.value(), OID::kOIDSize);
+                    break;
+                case Bool:
+                    appendByte(static_cast<unsigned char>(*e.value()));
+                    break;
+                case Date:
+                    _typeInfo.appendBits(0, 1);
+                    appendUInt64(static_cast<uint64_t>(e.date().millis) ^ kSignBit64);
+                    break;
+                case Timestamp:
+                    _typeInfo.appendBits(1, 1);
+                    appendUInt64(e.date().millis);
+                    break;
+                case RegEx:
+                    appendCString(e.regex());
+                    appendCString(e.regexFlags());
+                    break;
+                case DBRef:
+                    appendUInt32(e.valuesize());
+                    appendBytes(e.value(), e.valuesize());
+                    break;
+                case CodeWScope: {
+                    appendCString(e.codeWScopeCode());
+                    appendCString(e.codeWScopeScopeDataUnsafe());
+
+                    // The scope only sorts up to its first zero byte, so it is kept whole in the
+                    // type info.
+                    const BSONObj scope = e.codeWScopeObject();
+                    _typeInfo.appendBits(scope.objsize(), 32);
+                    _typeInfo.appendBytes(scope.objdata(), scope.objsize());
+                    break;
+                }
+                default:
+                    verify(false);
+                }
+            }
+
+        private:
+            void appendNumber(const BSONElement& e) {
+                double d = e.number();
+                uint64_t bits = 0;  // NaN sorts before everything else
+                if (e.type() == NumberInt) {
+                    _typeInfo.appendBits(kTypeInt, 2);
+                }
+                else if (e.type() == NumberLong) {
+                    _typeInfo.appendBits(kTypeLong, 2);
+                }
+                else {
+                    uint64_t original;
+                    memcpy(&original, &d, sizeof(original));
+                    const bool negativeZero = d == 0 && (original & kSignBit64);
+                    _typeInfo.appendBits(negativeZero ? kTypeNegativeZero : kTypeDouble, 2);
+                }
+
+                if (!isNaN(d)) {
+                    if (d == 0) {
+                        d = 0;  // -0 is equal to 0
+                    }
+                    memcpy(&bits, &d, sizeof(bits));
+                    bits = (bits & kSignBit64) ? ~bits : bits | kSignBit64;
+                }
+                appendUInt64(bits);
+
+                long long diff = 0;
+                if (e.type() == NumberLong) {
+                    // The longs which round to d are all within 2^10 of it, so measuring them
+                    // from a common base keeps their order. 2^63 isn't a long, so the ones which
+                    // round to it are measured from the largest long.
+                    const long long base = d >= 9223372036854775808.0
+                                               ? std::numeric_limits<long long>::max()
+                                               : static_cast<long long>(d);
+                    diff = e._numberLong() - base;
+                }
+
+                if (diff == 0) {
+                    appendByte(kNumberExact);
+                }
+                else {
+                    appendByte(diff < 0 ? kNumberBelow : kNumberAbove);
+                    appendUInt32(static_cast<uint32_t>(static_cast<int32_t>(diff)) ^ kSignBit32);
+                }
+            }
+
+            std::string* _out;
+            TypeInfoWriter _typeInfo;
+            unsigned char _invert;
+        };
+
+        /**
+         * Walks the bytes of an encoding.
+         */
+        class Reader {
+        public:
+            Reader(const char* data, size_t size)
+                : _start(reinterpret_cast<const unsigned char*>(data)),
+                  _pos(_start),
+                  _end(_start + size),
+                  _invert(0) {
+            }
+
+            void setDescending(bool descending) { _invert = descending ? 0xff : 0; }
+
+            size_t consumed() const { return _pos - _start; }
+
+            bool readByte(unsigned char* b) {
+                if (_pos == _end)
+                    return false;
+                *b = *_pos++ ^ _invert;
+                return true;
+            }
+
+            bool skip(size_t len) {
+                if (static_cast<size_t>(_end - _pos) < len)
+                    return false;
+                _pos += len;
+                return true;
+            }
+
+            bool readBytes(char* out, size_t len) {
+                for (size_t i = 0; i < len; i++) {
+                    unsigned char b;
+                    if (!readByte(&b))
+                        return false;
+                    out[i] = static_cast<char>(b);
+                }
+                return true;
+            }
+
+            bool readUInt32(uint32_t* v) {
+                *v = 0;
+                for (int i = 0; i < 4; i++) {
+                    unsigned char b;
+                    if (!readByte(&b))
+                        return false;
+                    *v = (*v << 8) | b;
+                }
+                return true;
+            }
+
+            bool readUInt64(uint64_t* v) {
+                uint32_t high;
+                uint32_t low;
+                if (!readUInt32(&high) || !readUInt32(&low))
+                    return false;
+                *v = (static_cast<uint64_t>(high) << 32) | low;
+                return true;
+            }
+
+            bool readCString(std::string* out) {
+                out->clear();
+                unsigned char b;
+                for (;;) {
+                    if (!readByte(&b))
+                        return false;
+                    if (b == 0)
+                        return true;
+                    out->push_back(static_cast<char>(b));
+                }
+            }
+
+            bool readString(std::string* out) {
+                out->clear();
+                unsigned char b;
+                while (readByte(&b)) {
+                    if (b != 0) {
+                        out->push_back(static_cast<char>(b));
+                        continue;
+                    }
+                    if (!readByte(&b))
+                        return false;
+                    if (b == 0)
+                        return true;
+                    if (b != kEscapedZero)
+                        return false;
+                    out->push_back('\0');
+                }
+                return false;
+            }
+
+            bool skipCString() {
+                unsigned char b;
+                do {
+                    if (!readByte(&b))
+                        return false;
+                } while (b != 0);
+                return true;
+            }
+
+            bool skipString() {
+                unsigned char b;
+                while (readByte(&b)) {
+                    if (b != 0)
+                        continue;
+                    if (!readByte(&b))
+                        return false;
+                    if (b == 0)
+                        return true;
+                    if (b != kEscapedZero)
+                        return false;
+                }
+                return false;
+            }
+
+            /** Skips a type byte and the value after it. */
+            bool skipElement() {
+                unsigned char typeByte;
+                if (!readByte(&typeByte))
+                    return false;
+                return skipValue(static_cast<int>(typeByte) - kTypeOffset);
+            }
+
+            bool skipValue(int canonicalType) {
+                uint32_t len;
+                unsigned char b;
+                switch (canonicalType) {
+                case -1:    // MinKey
+                case 0:     // Undefined
+                case 5:     // null
+                case 127:   // MaxKey
+                    return true;
+                case 10:    // numbers
+                    if (!skip(8) || !readByte(&b))
+                        return false;
+                    return b == kNumberExact || skip(4);
+                case 15:    // String and Symbol
+                case 60:    // Code
+                    return skipString();
+                case 20:    // Object
+                case 25:    // Array
+                    for (;;) {
+                        if (!readByte(&b))
+                            return false;
+                        if (b == kObjectEnd)
+                            return true;
+                        if (!skipCString() || !skipValue(static_cast<int>(b) - kTypeOffset))
+                            return false;
+                    }
+                case 30:    // BinData
+                    return readUInt32(&len) && skip(len + 1);
+                case 35:    // OID
+                    return skip(OID::kOIDSize);
+                case 40:    // Bool
+                    return skip(1);
+                case 45:    // Date and Timestamp
+                    return skip(8);
+                case 50:    // RegEx
+                case 65:    // CodeWScope
+                    return skipCString() && skipCString();
+                case 55:    // DBRef
+                    return readUInt32(&len) && skip(len);
+                default:
+                    return false;
+                }
+            }
+
+        private:
+            const unsigned char* const _start;
+            const unsigned char* _pos;
+            const unsigned char* const _end;
+            unsigned char _invert;
+        };
+
+        double decodeDouble(uint64_t bits) {
+            if (bits == 0)
+                return std::numeric_limits<double>::quiet_NaN();
+            bits = (bits & kSignBit64) ? bits ^ kSignBit64 : ~bits;
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            return d;
+        }
+
+        /** The inverse of Encoder::appendValue(), appending the value to b as fieldName. */
+        void decodeValue(Reader* reader, TypeInfoReader* typeInfo, int canonicalType,
+                         const StringData& fieldName, BSONObjBuilder* b) {
+            std::string str;
+            uint32_t len;
+            uint64_t v;
+            unsigned char byte;
+            switch (canonicalType) {
+            case -1:    // MinKey
+                b->appendMinKey(fieldName);
+                break;
+            case 127:   // MaxKey
+                b->appendMaxKey(fieldName);
+                break;
+            case 0:     // Undefined
+                b->appendUndefined(fieldName);
+                break;
+            case 5:     // null
+                b->appendNull(fieldName);
+                break;
+            case 10: {  // numbers
+                const uint32_t type = typeInfo->readBits(2);
+                invariant(reader->readUInt64(&v) && reader->readByte(&byte));
+                const double d = decodeDouble(v);
+
+                long long diff = 0;
+                if (byte != kNumberExact) {
+                    invariant(reader->readUInt32(&len));
+                    diff = static_cast<int32_t>(len ^ kSignBit32);
+                }
+
+                if (type == kTypeInt) {
+                    b->append(fieldName, static_cast<int>(d));
+                }
+                else if (type == kTypeLong) {
+                    const long long base = d >= 9223372036854775808.0
+                                               ? std::numeric_limits<long long>::max()
+                                               : static_cast<long long>(d);
+                    b->append(fieldName, base + diff);
+                }
+                else {
+                    b->append(fieldName, type == kTypeNegativeZero ? -0.0 : d);
+                }
+                break;
+            }
+            case 15:    // String and Symbol
+                invariant(reader->readString(&str));
+                if (typeInfo->readBits(1)) {
+                    b->appendSymbol(fieldName, str);
+                }
+                else {
+                    b->append(fieldName, StringData(str));
+                }
+                break;
+            case 20:    // Object
+            case 25: {  // Array
+                BSONObjBuilder sub(canonicalType == 20 ? b->subobjStart(fieldName)
+                                                       : b->subarrayStart(fieldName));
+                for (;;) {
+                    invariant(reader->readByte(&byte));
+                    if (byte == kObjectEnd)
+                        break;
+                    std::string subFieldName;
+                    invariant(reader->readCString(&subFieldName));
+                    decodeValue(reader, typeInfo, static_cast<int>(byte) - kTypeOffset,
+                                subFieldName, &sub);
+                }
+                sub.done();
+                break;
+            }
+            case 30: {  // BinData
+                invariant(reader->readUInt32(&len) && reader->readByte(&byte));
+                str.resize(len);
+                invariant(reader->readBytes(&str[0], len));
+                b->appendBinData(fieldName, len, static_cast<BinDataType>(byte), str.data());
+                break;
+            }
+            case 35: {  // OID
+                char oid[OID::kOIDSize];
+                invariant(reader->readBytes(oid, OID::kOIDSize));
+                b->append(fieldName, OID::from(oid));
+                break;
+            }
+            case 40:    // Bool
+                invariant(reader->readByte(&byte));
+                b->appendBool(fieldName, byte != 0);
+                break;
+            case 45:    // Date and Timestamp
+                invariant(reader->readUInt64(&v));
+                if (typeInfo->readBits(1)) {
+                    b->appendTimestamp(fieldName, v);
+                }
+                else {
+                    b->appendDate(fieldName, Date_t(v ^ kSignBit64));
+                }
+                break;
+            case 50: {  // RegEx
+                std::string flags;
+                invariant(reader->readCString(&str) && reader->readCString(&flags));
+                b->appendRegex(fieldName, str, flags);
+                break;
+            }
+            case 55: {  // DBRef, as its (ns size, ns, OID) value
+                invariant(reader->readUInt32(&len));
+                str.resize(len);
+                invariant(len > 4 + OID::kOIDSize && reader->readBytes(&str[0], len));
+                const StringData ns(str.data() + 4, len - 4 - OID::kOIDSize - 1);
+                b->appendDBRef(fieldName, ns, OID::from(str.data() + len - OID::kOIDSize));
+                break;
+            }
+            case 60:    // Code
+                invariant(reader->readString(&str));
+                b->appendCode(fieldName, str);
+                break;
+            case 65: {  // CodeWScope
+                std::string scopePrefix;
+                invariant(reader->readCString(&str) && reader->readCString(&scopePrefix));
+                std::string scope(typeInfo->readBits(32), '\0');
+                invariant(scope.size() >= 5);
+                typeInfo->readBytes(&scope[0], scope.size());
+                b->appendCodeWScope(fieldName, str, BSONObj(scope.data()));
+                break;
+            }
+            default:
+                invariant(false);
+            }
+        }
+
+    } // namespace
+
+    std::string KeyString::make(const BSONObj& key, const Ordering& ord, const DiskLoc& loc,
+                                std::string* typeInfo) {
+        return _make(key, ord, loc, false, typeInfo);
+    }
+
+    std::string KeyString::makeForSeek(const BSONObj& query, const Ordering& ord,
+                                       const DiskLoc& loc) {
+        return _make(query, ord, loc, true, NULL);
+    }
+
+    std::string KeyString::_make(const BSONObj& key, const Ordering& ord, const DiskLoc& loc,
+                                 bool honourQueryFieldNames, std::string* typeInfo) {
+        std::string out;
+        out.reserve(key.objsize() + 16);
+        Encoder encoder(&out, typeInfo);
+
+        BSONObjIterator it(key);
+        for (unsigned mask = 1; it.more(); mask <<= 1) {
+            const BSONElement e = it.next();
+            encoder.setDescending(ord.descending(mask));
+            encoder.appendTypeByte(e);
+            encoder.appendValue(e);
+
+            if (!honourQueryFieldNames)
+                continue;
+
+            // An exclusive field ends the query, as IndexEntryComparison never looks past it.
+            // Stopping right after it sorts before every entry equal on it, and kExclusiveAfter
+            // sorts after them.
+            const char behavior = e.fieldName()[0];
+            if (behavior == kQueryLess) {
+                return out;
+            }
+            if (behavior == kQueryGreater) {
+                encoder.setDescending(false);
+                encoder.appendByte(kExclusiveAfter);
+                return out;
+            }
+        }
+
+        encoder.setDescending(false);
+        encoder.appendByte(kEnd);
+        if (!loc.isNull()) {
+            encoder.appendUInt32(static_cast<uint32_t>(loc.a()) ^ kSignBit32);
+            encoder.appendUInt32(static_cast<uint32_t>(loc.getOfs()) ^ kSignBit32);
+        }
+        return out;
+    }
+
+    BSONObj KeyString::toBson(const char* data, size_t size, const Ordering& ord,
+                              const StringData& typeInfo) {
+        Reader reader(data, size);
+        TypeInfoReader typeInfoReader(typeInfo);
+        BSONObjBuilder b;
+        for (unsigned mask = 1; ; mask <<= 1) {
+            // The end byte is never inverted, and no type byte is equal to it either way.
+            unsigned char typeByte;
+            reader.setDescending(false);
+            invariant(reader.readByte(&typeByte));
+            if (typeByte == kEnd)
+                break;
+
+            const bool descending = ord.descending(mask);
+            if (descending) {
+                typeByte ^= 0xff;
+            }
+            reader.setDescending(descending);
+            decodeValue(&reader, &typeInfoReader, static_cast<int>(typeByte) - kTypeOffset,
+                        StringData(), &b);
+        }
+        return b.obj();
+    }
+
+    DiskLoc KeyString::decodeDiskLoc(const char* data, size_t size) {
+        invariant(size > 8);
+        Reader reader(data + size - 8, 8);
+        uint32_t a;
+        uint32_t ofs;
+        invariant(reader.readUInt32(&a) && reader.readUInt32(&ofs));
+        return DiskLoc(static_cast<int>(a ^ kSignBit32), static_cast<int>(ofs ^ kSignBit32));
+    }
+
+    size_t KeyString::firstFieldSize(const char* data, size_t size, const Ordering& ord) {
+        Reader reader(data, size);
+        reader.setDescending(ord.descending(1));
+        if (!reader.skipElement())
+            return 0;
+        return reader.consumed();
+    }
+
+} // namespace mongo
@@ -0,0 +1,103 @@
+// key_string.h
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/ordering.h"
+#include "mongo/db/diskloc.h"
+
+namespace mongo {
+
+    /**
+     * Encodes index entries as byte strings which sort with memcmp the way IndexEntryComparison
+     * sorts the entries themselves, so that a storage engine can keep them with a plain bytewise
+     * comparator rather than decoding BSON on every comparison.
+     *
+     * Each element of a key becomes its canonical type byte followed by an order preserving
+     * encoding of its value. The encoding of every element is prefix free, which lets the bytes
+     * of an element be inverted for a descending field while the order stays right. The elements
+     * are followed by an end byte and the DiskLoc, so the entries of one key are contiguous and
+     * ordered by DiskLoc.
+     *
+     * The encoding leaves out what doesn't affect the order: the type of a number, whether a
+     * string is a Symbol, whether a date is a Timestamp, and the scope of CodeWScope. make() can
+     * put these in a separate type info string, which toBson() takes to decode the key; it is
+     * empty for keys of doubles, strings and dates only and a few bits for most others, so an
+     * engine can store it as the value of the entry. The one place the encoding is stricter
+     * than BSON comparison is a NumberLong beyond 2^53, which
+     * BSON compares exactly with other longs but only through a double with other numbers:
+     * such a long sorts after the double it rounds to if it is larger, rather than equal to it.
+     */
+    class KeyString {
+    public:
+        /**
+         * Encodes an index entry, ignoring the field names of key. A null loc makes an encoding
+         * which sorts just before all of the entries for key.
+         *
+         * @param typeInfo - if not NULL, set to what toBson() needs besides the encoding
+         */
+        static std::string make(const BSONObj& key, const Ordering& ord, const DiskLoc& loc,
+                                std::string* typeInfo = NULL);
+
+        /**
+         * Encodes a query object from IndexEntryComparison::makeQueryObject() to seek to, with
+         * its exclusive fields sorting before or after every entry which is equal on them.
+         */
+        static std::string makeForSeek(const BSONObj& query, const Ordering& ord,
+                                       const DiskLoc& loc);
+
+        /**
+         * @return the key of an entry or key encoding from make(), with empty field names, given
+         *         the typeInfo which make() set for it.
+         */
+        static BSONObj toBson(const char* data, size_t size, const Ordering& ord,
+                              const StringData& typeInfo);
+
+        /**
+         * @return the DiskLoc at the end of an entry from make().
+         */
+        static DiskLoc decodeDiskLoc(const char* data, size_t size);
+
+        /**
+         * @return the size of the encoding of the first field of the entry or seek key in data,
+         *         or 0 if data doesn't start with a whole field.
+         */
+        static size_t firstFieldSize(const char* data, size_t size, const Ordering& ord);
+
+    private:
+        static std::string _make(const BSONObj& key, const Ordering& ord, const DiskLoc& loc,
+                                 bool honourQueryFieldNames, std::string* typeInfo);
+    };
+
+} // namespace mongo
@@ -0,0 +1,306 @@
+// key_string_test.cpp
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/storage/key_string.h"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/storage/index_entry_comparison.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    namespace {
+
+        int sign(int x) {
+            return x < 0 ? -1 : (x > 0 ? 1 : 0);
+        }
+
+        int compareEncoded(const std::string& a, const std::string& b) {
+            const size_t common = std::min(a.size(), b.size());
+            if (int res = memcmp(a.data(), b.data(), common))
+                return sign(res);
+            return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+        }
+
+        /** One value of each type and some awkward ones, as single field objects. */
+        std::vector<BSONObj> sampleValues() {
+            std::vector<BSONObj> values;
+            const double inf = std::numeric_limits<double>::infinity();
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            const OID oid("0123456789abcdef01234567");
+
+            values.push_back(BSON("" << MINKEY));
+            values.push_back(BSON("" << MAXKEY));
+            values.push_back(BSON("" << BSONNULL));
+            values.push_back(BSON("" << BSONUndefined));
+            values.push_back(BSON("" << nan));
+            values.push_back(BSON("" << -inf));
+            values.push_back(BSON("" << inf));
+            values.push_back(BSON("" << -1.5));
+            values.push_back(BSON("" << -0.0));
+            values.push_back(BSON("" << 0.0));
+            values.push_back(BSON("" << 0));
+            values.push_back(BSON("" << 0LL));
+            values.push_back(BSON("" << 1));
+            values.push_back(BSON("" << 1.5));
+            values.push_back(BSON("" << 2LL));
+            values.push_back(BSON("" << -7));
+            values.push_back(BSON("" << std::numeric_limits<int>::max()));
+            values.push_back(BSON("" << std::numeric_limits<long long>::max()));
+            values.push_back(BSON("" << std::numeric_limits<long long>::min()));
+            values.push_back(BSON("" << (1LL << 60) + 1));
+            values.push_back(BSON("" << (1LL << 60) + 2));
+            values.push_back(BSON("" << -(1LL << 60) - 1));
+            values.push_back(BSON("" << ""));
+            values.push_back(BSON("" << "a"));
+            values.push_back(BSON("" << std::string("a\0", 2)));
+            values.push_back(BSON("" << std::string("a\0b", 3)));
+            values.push_back(BSON("" << "ab"));
+            values.push_back(BSON("" << "b"));
+            values.push_back(BSON("" << "\xff"));
+            BSONObjBuilder symbol;
+            symbol.appendSymbol("", "ab");
+            values.push_back(symbol.obj());
+            values.push_back(BSON("" << BSONObj()));
+            values.push_back(BSON("" << BSON("a" << 1)));
+            values.push_back(BSON("" << BSON("a" << 1 << "b" << 2)));
+            values.push_back(BSON("" << BSON("a" << 2)));
+            values.push_back(BSON("" << BSON("a" << "x")));
+            values.push_back(BSON("" << BSON("b" << 1)));
+            values.push_back(BSON("" << BSON("ab" << 1)));
+            values.push_back(BSON("" << BSON("a" << BSON("c" << 1))));
+            values.push_back(BSON("" << BSONArray()));
+            values.push_back(BSON("" << BSON_ARRAY(1 << 2)));
+            values.push_back(BSON("" << BSON_ARRAY(1 << "a")));
+            values.push_back(BSON("" << BSON_ARRAY(2)));
+            BSONObjBuilder binData;
+            binData.appendBinData("a", 2, BinDataGeneral, "ab");
+            binData.appendBinData("b", 1, BinDataGeneral, "z");
+            binData.appendBinData("c", 2, Function, "ab");
+            BSONObjIterator binDataIt(binData.done());
+            while (binDataIt.more()) {
+                values.push_back(binDataIt.next().wrap(""));
+            }
+            values.push_back(BSON("" << oid));
+            values.push_back(BSON("" << OID("0123456789abcdef01234568")));
+            values.push_back(BSON("" << false));
+            values.push_back(BSON("" << true));
+            values.push_back(BSON("" << Date_t(0)));
+            values.push_back(BSON("" << Date_t(1000)));
+            values.push_back(BSON("" << Date_t(static_cast<unsigned long long>(-1000LL))));
+            BSONObjBuilder regex;
+            regex.appendRegex("a", "^a", "");
+            regex.appendRegex("b", "^a", "i");
+            regex.appendRegex("c", "^b", "");
+            BSONObjBuilder dbRef;
+            dbRef.appendDBRef("a", "db.c", oid);
+            dbRef.appendDBRef("b", "db.cc", oid);
+            BSONObjBuilder code;
+            code.appendCode("a", "f()");
+            code.appendCode("b", "g()");
+            code.appendCodeWScope("c", "f()", BSON("x" << 1));
+            code.appendCodeWScope("d", "f()", BSON("x" << 2));
+            code.appendCodeWScope("e", "g()", BSONObj());
+            const BSONObj others[] = { regex.obj(), dbRef.obj(), code.obj() };
+            for (size_t i = 0; i < sizeof(others) / sizeof(others[0]); i++) {
+                BSONObjIterator it(others[i]);
+                while (it.more()) {
+                    values.push_back(it.next().wrap(""));
+                }
+            }
+            return values;
+        }
+
+        /**
+         * Checks that the encodings of every pair of keys made from values compare the way
+         * IndexEntryComparison compares the keys.
+         */
+        void checkOrder(const std::vector<BSONObj>& keys, const BSONObj& keyPattern) {
+            const Ordering ord = Ordering::make(keyPattern);
+            const IndexEntryComparison comparison(ord);
+            const DiskLoc loc(1, 2);
+            for (size_t i = 0; i < keys.size(); i++) {
+                const std::string left = KeyString::make(keys[i], ord, loc);
+                for (size_t j = 0; j < keys.size(); j++) {
+                    const std::string right = KeyString::make(keys[j], ord, loc);
+                    const int expected = sign(comparison.compare(IndexKeyEntry(keys[i], loc),
+                                                                 IndexKeyEntry(keys[j], loc)));
+                    ASSERT_EQUALS(expected, compareEncoded(left, right))
+                        << keys[i] << " " << keys[j] << " " << keyPattern;
+                }
+            }
+        }
+
+        std::vector<BSONObj> pairsOf(const std::vector<BSONObj>& values) {
+            std::vector<BSONObj> keys;
+            for (size_t i = 0; i < values.size(); i += 3) {
+                for (size_t j = 0; j < values.size(); j += 5) {
+                    BSONObjBuilder b;
+                    b.appendAs(values[i].firstElement(), "");
+                    b.appendAs(values[j].firstElement(), "");
+                    keys.push_back(b.obj());
+                }
+            }
+            return keys;
+        }
+
+    } // namespace
+
+    TEST(KeyStringTest, OrderOfSingleFields) {
+        const std::vector<BSONObj> values = sampleValues();
+        checkOrder(values, BSON("a" << 1));
+        checkOrder(values, BSON("a" << -1));
+    }
+
+    TEST(KeyStringTest, OrderOfCompoundKeys) {
+        const std::vector<BSONObj> keys = pairsOf(sampleValues());
+        checkOrder(keys, BSON("a" << 1 << "b" << 1));
+        checkOrder(keys, BSON("a" << 1 << "b" << -1));
+        checkOrder(keys, BSON("a" << -1 << "b" << 1));
+    }
+
+    TEST(KeyStringTest, DiskLocBreaksTies) {
+        const Ordering ord = Ordering::make(BSON("a" << -1));
+        const BSONObj key = BSON("" << 5);
+        const DiskLoc locs[] = { DiskLoc(0, 1), DiskLoc(0, 2), DiskLoc(1, -5), DiskLoc(1, 0),
+                                 DiskLoc(0x7fffffff, 0x7fffffff) };
+        for (size_t i = 0; i + 1 < sizeof(locs) / sizeof(locs[0]); i++) {
+            const std::string left = KeyString::make(key, ord, locs[i]);
+            ASSERT_LESS_THAN(compareEncoded(left, KeyString::make(key, ord, locs[i + 1])), 0);
+            ASSERT_EQUALS(locs[i], KeyString::decodeDiskLoc(left.data(), left.size()));
+
+            // The null DiskLoc sorts before all of the entries of a key.
+            ASSERT_LESS_THAN(compareEncoded(KeyString::make(key, ord, DiskLoc()), left), 0);
+        }
+    }
+
+    TEST(KeyStringTest, SeekKeysHonourExclusiveFields) {
+        const BSONObj keyPattern = BSON("a" << 1 << "b" << -1);
+        const Ordering ord = Ordering::make(keyPattern);
+        const IndexEntryComparison comparison(ord);
+
+        const std::vector<BSONObj> keys = pairsOf(sampleValues());
+        for (size_t i = 0; i < keys.size(); i += 7) {
+            BSONObjIterator it(keys[i]);
+            const BSONElement first = it.next();
+            const BSONElement second = it.next();
+            std::vector<const BSONElement*> suffix;
+            suffix.push_back(&first);
+            suffix.push_back(&second);
+
+            for (int direction = -1; direction <= 1; direction += 2) {
+                std::vector<BSONObj> queries;
+                queries.push_back(IndexEntryComparison::makeQueryObject(
+                    keys[i], 1, true, suffix, std::vector<bool>(2, true), direction));
+                std::vector<bool> inclusive(2, true);
+                inclusive[1] = false;
+                queries.push_back(IndexEntryComparison::makeQueryObject(
+                    keys[i], 0, false, suffix, inclusive, direction));
+
+                for (size_t q = 0; q < queries.size(); q++) {
+                    const std::string seek = KeyString::makeForSeek(queries[q], ord, DiskLoc());
+                    for (size_t j = 0; j < keys.size(); j++) {
+                        const DiskLoc loc(0, 1);
+                        const int expected = sign(comparison.compare(
+                            IndexKeyEntry(queries[q], minDiskLoc), IndexKeyEntry(keys[j], loc)));
+                        ASSERT_EQUALS(expected,
+                                      compareEncoded(seek, KeyString::make(keys[j], ord, loc)))
+                            << queries[q] << " " << keys[j];
+                    }
+                }
+            }
+        }
+    }
+
+    TEST(KeyStringTest, ToBsonGivesBackTheKey) {
+        std::vector<BSONObj> keys = sampleValues();
+        const std::vector<BSONObj> pairs = pairsOf(keys);
+        keys.insert(keys.end(), pairs.begin(), pairs.end());
+
+        const Ordering orderings[] = { Ordering::make(BSON("a" << 1 << "b" << 1)),
+                                       Ordering::make(BSON("a" << -1 << "b" << 1)),
+                                       Ordering::make(BSON("a" << 1 << "b" << -1)) };
+        for (size_t o = 0; o < sizeof(orderings) / sizeof(orderings[0]); o++) {
+            for (size_t i = 0; i < keys.size(); i++) {
+                const DiskLoc locs[] = { DiskLoc(), DiskLoc(3, 4) };
+                for (size_t l = 0; l < 2; l++) {
+                    std::string typeInfo;
+                    const std::string entry = KeyString::make(keys[i], orderings[o], locs[l],
+                                                              &typeInfo);
+                    const BSONObj decoded = KeyString::toBson(entry.data(), entry.size(),
+                                                              orderings[o], typeInfo);
+                    ASSERT(keys[i].binaryEqual(decoded)) << keys[i] << " " << decoded;
+
+                    // The type info doesn't change the encoding.
+                    ASSERT_EQUALS(entry, KeyString::make(keys[i], orderings[o], locs[l]));
+                }
+            }
+        }
+    }
+
+    TEST(KeyStringTest, TypeInfoIsEmptyForDoublesStringsAndDates) {
+        const Ordering ord = Ordering::make(BSON("a" << 1 << "b" << 1 << "c" << 1));
+        std::string typeInfo = "x";
+        KeyString::make(BSON("" << 1.5 << "" << "a" << "" << Date_t(5)), ord, DiskLoc(),
+                        &typeInfo);
+        ASSERT_EQUALS("", typeInfo);
+
+        KeyString::make(BSON("" << 1.5 << "" << BSON("x" << 1)), ord, DiskLoc(), &typeInfo);
+        ASSERT_EQUALS(1U, typeInfo.size());
+    }
+
+    TEST(KeyStringTest, FirstFieldSize) {
+        const std::vector<BSONObj> values = sampleValues();
+        const Ordering orderings[] = { Ordering::make(BSON("a" << 1 << "b" << 1)),
+                                       Ordering::make(BSON("a" << -1 << "b" << 1)) };
+        for (size_t o = 0; o < 2; o++) {
+            for (size_t i = 0; i < values.size(); i++) {
+                const BSONObj key = BSON("" << values[i].firstElement() << "" << "tail");
+                const std::string single = KeyString::make(values[i], orderings[o], DiskLoc());
+                const std::string entry = KeyString::make(key, orderings[o], DiskLoc(3, 4));
+
+                // The first field is everything but the end byte of a single field key.
+                const size_t size = KeyString::firstFieldSize(entry.data(), entry.size(),
+                                                               orderings[o]);
+                ASSERT_EQUALS(single.size() - 1, size) << key;
+                ASSERT_EQUALS(0, memcmp(single.data(), entry.data(), size));
+
+                // A truncated field isn't a whole one.
+                ASSERT_EQUALS(0U, KeyString::firstFieldSize(entry.data(), size - 1,
+                                                            orderings[o]));
+            }
+        }
+    }
+
+} // namespace mongo
@@ -92,6 +92,21 @@ namespace mongo {
     KVCollectionCatalogEntry::~KVCollectionCatalogEntry() {
     }
 
+    RecordStore* KVCollectionCatalogEntry::getRecordStore( OperationContext* txn ) {
+        boost::mutex::scoped_lock lk( _recordStoreLock );
+        if ( !_recordStore ) {
+            MetaData md = _getMetaData( txn );
+            _recordStore.reset( _engine->getRecordStore( txn, ns().ns(), _ident, md.options ) );
+            invariant( _recordStore );
+        }
+        return _recordStore.get();
+    }
+
+    bool KVCollectionCatalogEntry::isRecordStoreOpen() const {
+        boost::mutex::scoped_lock lk( _recordStoreLock );
+        return _recordStore.get() != NULL;
+    }
+
     bool KVCollectionCatalogEntry::setIndexIsMultikey(OperationContext* txn,
                                                       const StringData& indexName,
                                                       bool multikey ) {
@@ -30,6 +30,9 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include "mongo/db/catalog/collection_catalog_entry.h"
 #include "mongo/db/storage/bson_collection_catalog_entry.h"
 #include "mongo/db/storage/record_store.h"
@@ -41,6 +44,11 @@ namespace mongo {
 
     class KVCollectionCatalogEntry : public BSONCollectionCatalogEntry {
     public:
+        /**
+         * @param rs - the RecordStore of the collection, owned by the entry from now on.  If
+         *             NULL it is opened by the first getRecordStore(), which is how collections
+         *             that exist at startup are loaded.
+         */
         KVCollectionCatalogEntry( KVEngine* engine,
                                   KVCatalog* catalog,
                                   const StringData& ns,
@@ -76,8 +84,14 @@ namespace mongo {
                                        const StringData& idxName,
                                        long long newExpireSeconds );
 
-        RecordStore* getRecordStore() { return _recordStore.get(); }
-        const RecordStore* getRecordStore() const { return _recordStore.get(); }
+        /**
+         * Opens the RecordStore if this is the first time it is asked for.
+         */
+        RecordStore* getRecordStore( OperationContext* txn );
+
+        bool isRecordStoreOpen() const;
+
+        const std::string& ident() const { return _ident; }
 
     protected:
         virtual MetaData _getMetaData( OperationContext* txn ) const;
@@ -89,6 +103,9 @@ namespace mongo {
         KVEngine* _engine; // not owned
         KVCatalog* _catalog; // not owned
         std::string _ident;
+
+        // Guards opening _recordStore, which is only set once
+        mutable boost::mutex _recordStoreLock;
         boost::scoped_ptr<RecordStore> _recordStore; // owned
     };
 
@@ -143,10 +143,16 @@ namespace mongo {
 
         boost::mutex::scoped_lock lk( _collectionsLock );
         for ( CollectionMap::const_iterator it = _collections.begin(); it != _collections.end(); ++it ) {
-            const KVCollectionCatalogEntry* coll = it->second;
+            KVCollectionCatalogEntry* coll = it->second;
             if ( !coll )
                 continue;
-            size += coll->getRecordStore()->storageSize( opCtx );
+
+            // Asking the engine, rather than opening the RecordStore, keeps the collections
+            // which have not been used since startup unopened.
+            if ( coll->isRecordStoreOpen() )
+                size += coll->getRecordStore( opCtx )->storageSize( opCtx );
+            else
+                size += _engine->getEngine()->getIdentSize( opCtx, coll->ident() );
 
             vector<string> indexNames;
             coll->getAllIndexes( opCtx, &indexNames );
@@ -190,11 +196,17 @@ namespace mongo {
 
     RecordStore* KVDatabaseCatalogEntry::getRecordStore( OperationContext* txn,
                                                          const StringData& ns ) {
-        boost::mutex::scoped_lock lk( _collectionsLock );
-        CollectionMap::const_iterator it = _collections.find( ns.toString() );
-        if ( it == _collections.end() )
-            return NULL;
-        return it->second->getRecordStore();
+        KVCollectionCatalogEntry* entry;
+        {
+            boost::mutex::scoped_lock lk( _collectionsLock );
+            CollectionMap::const_iterator it = _collections.find( ns.toString() );
+            if ( it == _collections.end() )
+                return NULL;
+            entry = it->second;
+        }
+        // Opened outside of _collectionsLock, so that opening one collection does not hold up
+        // the lookups of the others.  The lock on the collection keeps the entry alive.
+        return entry->getRecordStore( txn );
     }
 
     IndexAccessMethod* KVDatabaseCatalogEntry::getIndex( OperationContext* txn,
@@ -273,39 +285,37 @@ namespace mongo {
     void KVDatabaseCatalogEntry::initCollection( OperationContext* opCtx,
                                                  const std::string& ns ) {
         string ident = _engine->getCatalog()->getCollectionIdent( ns );
-        BSONCollectionCatalogEntry::MetaData md = _engine->getCatalog()->getMetaData( opCtx, ns );
-
-        RecordStore* rs = _engine->getEngine()->getRecordStore( opCtx, ns, ident, md.options );
-        invariant( rs );
 
         boost::mutex::scoped_lock lk( _collectionsLock );
         invariant(!_collections.count(ns));
-        // No change registration since this is only for committed collections
+        // No change registration since this is only for committed collections.  The RecordStore
+        // is opened on first use, so that startup does not open every collection.
         _collections[ns] = new KVCollectionCatalogEntry( _engine->getEngine(),
                                                          _engine->getCatalog(),
                                                          ns,
                                                          ident,
-                                                         rs );
+                                                         NULL );
     }
 
     Status KVDatabaseCatalogEntry::renameCollection( OperationContext* txn,
                                                      const StringData& fromNS,
                                                      const StringData& toNS,
                                                      bool stayTemp ) {
-        RecordStore* originalRS = NULL;
+        KVCollectionCatalogEntry* originalEntry = NULL;
         // Note: assuming that both fromNS and toNS (or whole db) are X-locked from above.
         {
             boost::mutex::scoped_lock lk( _collectionsLock );
             CollectionMap::const_iterator it = _collections.find( fromNS.toString() );
             if ( it == _collections.end() )
                 return Status( ErrorCodes::NamespaceNotFound, "rename cannot find collection" );
-            originalRS = it->second->getRecordStore();
+            originalEntry = it->second;
 
             it = _collections.find( toNS.toString() );
             if ( it != _collections.end() )
                 return Status( ErrorCodes::NamespaceExists, "for rename to already exists" );
 
         }
+        RecordStore* originalRS = originalEntry->getRecordStore( txn );
 
         const std::string identFrom = _engine->getCatalog()->getCollectionIdent( fromNS );
 
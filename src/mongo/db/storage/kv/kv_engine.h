@@ -104,6 +104,12 @@ namespace mongo {
          */
         virtual bool supportsDocLocking() const = 0;
 
+        /**
+         * See StorageEngine::readsFromSnapshots. This must not change over the lifetime of the
+         * engine either.
+         */
+        virtual bool readsFromSnapshots() const { return false; }
+
         virtual Status okToRename( OperationContext* opCtx,
                                    const StringData& fromNS,
                                    const StringData& toNS,
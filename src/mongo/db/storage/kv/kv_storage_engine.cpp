@@ -68,7 +68,8 @@ namespace mongo {
     KVStorageEngine::KVStorageEngine( KVEngine* engine )
         : _engine( engine )
         , _initialized( false )
-        , _supportsDocLocking(_engine->supportsDocLocking()) {
+        , _supportsDocLocking(_engine->supportsDocLocking())
+        , _readsFromSnapshots(_engine->readsFromSnapshots()) {
     }
 
     void KVStorageEngine::cleanShutdown(OperationContext* txn) {
@@ -65,6 +65,8 @@ namespace mongo {
 
         virtual bool supportsDocLocking() const { return _supportsDocLocking; }
 
+        virtual bool readsFromSnapshots() const { return _readsFromSnapshots; }
+
         virtual Status closeDatabase( OperationContext* txn, const StringData& db );
 
         virtual Status dropDatabase( OperationContext* txn, const StringData& db );
@@ -94,6 +96,7 @@ namespace mongo {
         boost::scoped_ptr<KVEngine> _engine;
         bool _initialized;
         const bool _supportsDocLocking;
+        const bool _readsFromSnapshots;
 
         boost::scoped_ptr<RecordStore> _catalogRecordStore;
         boost::scoped_ptr<KVCatalog> _catalog;
@@ -102,6 +102,22 @@ namespace mongo {
             return _btree->getRecordStore()->dataSize( txn );
         }
 
+        virtual bool countKeysInRange(OperationContext* txn,
+                                      const BSONObj& startKey,
+                                      bool startKeyInclusive,
+                                      const BSONObj& endKey,
+                                      bool endKeyInclusive,
+                                      bool approximate,
+                                      long long* countOut) const {
+            return _btree->countKeysInRange(txn,
+                                            startKey,
+                                            startKeyInclusive,
+                                            endKey,
+                                            endKeyInclusive,
+                                            approximate,
+                                            countOut);
+        }
+
         virtual Status dupKeyCheck(OperationContext* txn,
                                    const BSONObj& key,
                                    const DiskLoc& loc) {
@@ -255,14 +271,21 @@ namespace mongo {
                                                          indexName,
                                                          bucketDeletion);
         }
-        else {
-            invariant(1 == version);
+        else if (1 == version) {
             return new BtreeInterfaceImpl<BtreeLayoutV1>(headManager,
                                                          recordStore,
                                                          ordering,
                                                          indexName,
                                                          bucketDeletion);
         }
+        else {
+            invariant(2 == version);
+            return new BtreeInterfaceImpl<BtreeLayoutV2>(headManager,
+                                                         recordStore,
+                                                         ordering,
+                                                         indexName,
+                                                         bucketDeletion);
+        }
     }
 
 }  // namespace mongo
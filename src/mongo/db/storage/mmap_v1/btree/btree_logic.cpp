@@ -114,7 +114,7 @@ namespace mongo {
         }
         
         BucketType* rightLeaf = _getModifiableBucket(_rightLeafLoc);
-        if (!_logic->pushBack(rightLeaf, loc, *key, DiskLoc())) {
+        if (!_pushBack(rightLeaf, _rightLeafLoc, loc, *key, DiskLoc())) {
             // bucket was full, so split and try with the new node.
             _rightLeafLoc = newBucket(rightLeaf, _rightLeafLoc);
             rightLeaf = _getModifiableBucket(_rightLeafLoc);
@@ -158,7 +158,7 @@ namespace mongo {
         KeyDataType key;
         DiskLoc val;
         _logic->popBack(leftSib, &val, &key);
-        if (!_logic->pushBack(parent, val, key, leftSibLoc)) {
+        if (!_pushBack(parent, parentLoc, val, key, leftSibLoc)) {
             // parent is full, so split it.
             parentLoc = newBucket(parent, parentLoc);
             parent = _getModifiableBucket(parentLoc);
@@ -175,6 +175,22 @@ namespace mongo {
         return newBucketLoc;
     }
 
+    template <class BtreeLayout>
+    bool BtreeLogic<BtreeLayout>::Builder::_pushBack(BucketType* bucket,
+                                                     DiskLoc bucketLoc,
+                                                     DiskLoc recordLoc,
+                                                     const KeyDataType& key,
+                                                     DiskLoc prevChild) {
+        if (_logic->pushBack(bucket, recordLoc, key, prevChild)) {
+            return true;
+        }
+
+        // The appended keys may share a prefix the bucket doesn't have yet.
+        int unused = 0;
+        _logic->_pack(_txn, bucket, bucketLoc, unused);
+        return _logic->pushBack(bucket, recordLoc, key, prevChild);
+    }
+
     template <class BtreeLayout>
     typename BtreeLogic<BtreeLayout>::BucketType*
     BtreeLogic<BtreeLayout>::Builder::_getModifiableBucket(DiskLoc loc) {
@@ -279,6 +295,12 @@ namespace mongo {
         bucket->emptySize += bytes;
     }
 
+    /**
+     * Only the prefix compressed layout has a prefix to copy, see the BtreeLayoutV2 section.
+     */
+    template <class BtreeLayout>
+    void BtreeLogic<BtreeLayout>::_copyPrefix(BucketType* bucket, const BucketType* from) { }
+
     /**
      * We allocate space from the end of the buffer for data.  The keynodes grow from the front.
      */
@@ -341,7 +363,7 @@ namespace mongo {
         FullKey kn = getFullKey(bucket, bucket->n - 1);
         *recordLocOut = kn.recordLoc;
         keyDataOut->assign(kn.data);
-        int keysize = kn.data.dataSize();
+        int keysize = BtreeLayout::keyDataSize(bucket, kn.header);
 
         // The left/prev child of the node we are popping now goes in to the nextChild slot as all
         // of its keys are greater than all remaining keys in this node.
@@ -363,7 +385,8 @@ namespace mongo {
                                            const KeyDataType& key,
                                            const DiskLoc prevChild) {
 
-        int bytesNeeded = key.dataSize() + sizeof(KeyHeaderType);
+        int keySize = BtreeLayout::keyDataSize(bucket, key);
+        int bytesNeeded = keySize + sizeof(KeyHeaderType);
         if (bytesNeeded > bucket->emptySize) {
             return false;
         }
@@ -384,10 +407,10 @@ namespace mongo {
         KeyHeaderType& kn = getKeyHeader(bucket, bucket->n++);
         kn.prevChildBucket = prevChild;
         kn.recordLoc = recordLoc;
-        kn.setKeyDataOfs((short)_alloc(bucket, key.dataSize()));
+        kn.setKeyDataOfs((short)_alloc(bucket, keySize));
         short ofs = kn.keyDataOfs();
         char *p = dataAt(bucket, ofs);
-        memcpy(p, key.data(), key.dataSize());
+        BtreeLayout::writeKey(bucket, &kn, key, p);
         return true;
     }
 
@@ -413,10 +436,12 @@ namespace mongo {
         invariant(bucket->n < 1024);
         invariant(keypos >= 0 && keypos <= bucket->n);
 
-        int bytesNeeded = key.dataSize() + sizeof(KeyHeaderType);
-        if (bytesNeeded > bucket->emptySize) {
+        int keySize = BtreeLayout::keyDataSize(bucket, key);
+        if (keySize + int(sizeof(KeyHeaderType)) > bucket->emptySize) {
             _pack(txn, bucket, bucketLoc, keypos);
-            if (bytesNeeded > bucket->emptySize) {
+            // Packing may have given the bucket a new prefix.
+            keySize = BtreeLayout::keyDataSize(bucket, key);
+            if (keySize + int(sizeof(KeyHeaderType)) > bucket->emptySize) {
                 return false;
             }
         }
@@ -447,10 +472,10 @@ namespace mongo {
         KeyHeaderType& kn = getKeyHeader(bucket, keypos);
         kn.prevChildBucket.Null();
         kn.recordLoc = recordLoc;
-        kn.setKeyDataOfs((short) _alloc(bucket, key.dataSize()));
+        kn.setKeyDataOfs((short) _alloc(bucket, keySize));
         char *p = dataAt(bucket, kn.keyDataOfs());
-        txn->recoveryUnit()->writingPtr(p, key.dataSize());
-        memcpy(p, key.data(), key.dataSize());
+        txn->recoveryUnit()->writingPtr(p, keySize);
+        BtreeLayout::writeKey(bucket, &kn, key, p);
         return true;
     }
 
@@ -459,7 +484,7 @@ namespace mongo {
      * creation of an empty bucket.
      */
     template <class BtreeLayout>
-    bool BtreeLogic<BtreeLayout>::mayDropKey(BucketType* bucket, int index, int refPos) {
+    bool BtreeLogic<BtreeLayout>::mayDropKey(const BucketType* bucket, int index, int refPos) {
         return index > 0
             && (index != refPos)
             && getKeyHeader(bucket, index).isUnused()
@@ -467,7 +492,7 @@ namespace mongo {
     }
 
     template <class BtreeLayout>
-    int BtreeLogic<BtreeLayout>::_packedDataSize(BucketType* bucket, int refPos) {
+    int BtreeLogic<BtreeLayout>::_packedDataSize(const BucketType* bucket, int refPos) {
         if (bucket->flags & Packed) {
             return BtreeLayout::BucketSize - bucket->emptySize - BucketType::HeaderSize;
         }
@@ -592,7 +617,8 @@ namespace mongo {
                            / (keypos == bucket->n ? 10 : 2);
 
         for (int i = bucket->n - 1; i > -1; --i) {
-            rightSize += getFullKey(bucket, i).data.dataSize() + sizeof(KeyHeaderType);
+            rightSize += BtreeLayout::keyDataSize(bucket, getKeyHeader(bucket, i))
+                       + sizeof(KeyHeaderType);
             if (rightSize > rightSizeLimit) {
                 split = i;
                 break;
@@ -629,10 +655,11 @@ namespace mongo {
         KeyHeaderType &kn = getKeyHeader(bucket, i);
         kn.recordLoc = recordLoc;
         kn.prevChildBucket = prevChildBucket;
-        short ofs = (short) _alloc(bucket, key.dataSize());
+        int keySize = BtreeLayout::keyDataSize(bucket, key);
+        short ofs = (short) _alloc(bucket, keySize);
         kn.setKeyDataOfs(ofs);
         char *p = dataAt(bucket, ofs);
-        memcpy(p, key.data(), key.dataSize());
+        BtreeLayout::writeKey(bucket, &kn, key, p);
     }
 
     template <class BtreeLayout>
@@ -1101,10 +1128,15 @@ namespace mongo {
     template <class BtreeLayout>
     bool BtreeLogic<BtreeLayout>::wouldCreateDup(OperationContext* txn,
                                                  const KeyDataType& key,
-                                                 const DiskLoc self) const {
+                                                 const DiskLoc self,
+                                                 bool* isPresentOut) const {
         int position;
         bool found;
 
+        if (isPresentOut) {
+            *isPresentOut = false;
+        }
+
         DiskLoc posLoc = _locate(txn, getRootLoc(txn), key, &position, &found, minDiskLoc, 1);
 
         while (!posLoc.isNull()) {
@@ -1113,6 +1145,9 @@ namespace mongo {
                 // TODO: we may not need fullKey.data until we know fullKey.header.isUsed() here
                 // and elsewhere.
                 if (fullKey.data.woEqual(key)) {
+                    if (isPresentOut) {
+                        *isPresentOut = fullKey.recordLoc == self;
+                    }
                     return fullKey.recordLoc != self;
                 }
                 break;
@@ -1182,14 +1217,13 @@ namespace mongo {
                             // This is expensive and we only want to do it once(? -- when would
                             // it happen twice).
                             dupsCheckedYet = true;
-                            if (exists(txn, key)) {
-                                if (wouldCreateDup(txn, key, genericRecordLoc)) {
-                                    return Status(ErrorCodes::DuplicateKey, dupKeyError(key), 11000);
-                                }
-                                else {
-                                    return Status(ErrorCodes::DuplicateKeyValue, 
-                                                  "key/value already in index");
-                                }
+                            bool isPresent;
+                            if (wouldCreateDup(txn, key, genericRecordLoc, &isPresent)) {
+                                return Status(ErrorCodes::DuplicateKey, dupKeyError(key), 11000);
+                            }
+                            if (isPresent) {
+                                return Status(ErrorCodes::DuplicateKeyValue,
+                                              "key/value already in index");
                             }
                         }
                     }
@@ -1492,16 +1526,25 @@ namespace mongo {
         const BucketType* r = childForPos(txn, bucket, leftIndex + 1);
 
         int KNS = sizeof(KeyHeaderType);
-        int rightSizeLimit = ( l->topSize
-                             + l->n * KNS
-                             + getFullKey(bucket, leftIndex).data.dataSize()
-                             + KNS
-                             + r->topSize
-                             + r->n * KNS ) / 2;
+        int leftSize = _packedDataSize(l, 0);
+        int rightTotal = _packedDataSize(r, 0);
+        int total = leftSize + getFullKey(bucket, leftIndex).data.dataSize() + KNS + rightTotal;
+        int rightSizeLimit = total / 2;
+
+        // A prefix compressed child may hold more than a bucket's worth of whole keys, so the
+        // child below the low water mark gets no more than it has room for.  The limit never
+        // applies to buckets storing whole keys.
+        int maxShare = BtreeLayout::BucketBodySize - BtreeLayout::KeyMax - KNS;
+        if (rightTotal < leftSize) {
+            rightSizeLimit = std::min(rightSizeLimit, maxShare);
+        }
+        else {
+            rightSizeLimit = std::max(rightSizeLimit, total - maxShare);
+        }
 
         // This constraint should be ensured by only calling this function
         // if we go below the low water mark.
-        invariant(rightSizeLimit < BtreeLayout::BucketBodySize);
+        invariant(std::min(rightSizeLimit, total - rightSizeLimit) < BtreeLayout::BucketBodySize);
 
         for (int i = r->n - 1; i > -1; --i) {
             rightSize += getFullKey(r, i).data.dataSize() + KNS;
@@ -1807,6 +1850,121 @@ namespace mongo {
         return getRoot(txn)->n == 0;
     }
 
+    template <class BtreeLayout>
+    bool BtreeLogic<BtreeLayout>::countKeysInRange(OperationContext* txn,
+                                                   const BSONObj& startKey,
+                                                   bool startKeyInclusive,
+                                                   const BSONObj& endKey,
+                                                   bool endKeyInclusive,
+                                                   bool approximate,
+                                                   long long* countOut) const {
+        KeyDataOwnedType start(startKey);
+        KeyDataOwnedType end(endKey);
+
+        // Every entry has a DiskLoc strictly between minDiskLoc and maxDiskLoc, so these place
+        // the walks on the right side of any entries equal to the bounds.
+        DiskLoc startBucket;
+        int startPos;
+        double startNumKeys;
+        double startFraction = _estimatePosition(txn,
+                                                 start,
+                                                 startKeyInclusive ? minDiskLoc : maxDiskLoc,
+                                                 &startBucket,
+                                                 &startPos,
+                                                 &startNumKeys);
+
+        DiskLoc endBucket;
+        int endPos;
+        double endNumKeys;
+        double endFraction = _estimatePosition(txn,
+                                               end,
+                                               endKeyInclusive ? maxDiskLoc : minDiskLoc,
+                                               &endBucket,
+                                               &endPos,
+                                               &endNumKeys);
+
+        if (startBucket == endBucket) {
+            // The paths only part in this bucket.  If no child hangs between the two positions,
+            // the keys in between are all there is in the range.
+            BucketType* bucket = getBucket(txn, startBucket);
+            bool exact = true;
+            for (int i = startPos + 1; i < endPos; i++) {
+                if (!childLocForPos(bucket, i).isNull()) {
+                    exact = false;
+                    break;
+                }
+            }
+
+            if (exact) {
+                long long n = 0;
+                for (int i = startPos; i < endPos; i++) {
+                    if (getKeyHeader(bucket, i).isUsed()) {
+                        n++;
+                    }
+                }
+                *countOut = n;
+                return true;
+            }
+        }
+
+        if (!approximate) {
+            return false;
+        }
+
+        double estimate = (endFraction - startFraction) * (startNumKeys + endNumKeys) / 2;
+        *countOut = estimate > 0 ? static_cast<long long>(estimate + 0.5) : 0;
+        return true;
+    }
+
+    template <class BtreeLayout>
+    double BtreeLogic<BtreeLayout>::_estimatePosition(OperationContext* txn,
+                                                      const KeyDataType& key,
+                                                      const DiskLoc& recordLoc,
+                                                      DiskLoc* bucketLocOut,
+                                                      int* posOut,
+                                                      double* numKeysOut) const {
+        // The part of the key space covered by the current bucket, as fractions of the tree.
+        double before = 0;
+        double width = 1;
+
+        // Number of keys in each bucket on the path, from the root down.
+        std::vector<int> bucketSizes;
+
+        DiskLoc bucketLoc = getRootLoc(txn);
+        int position = 0;
+        while (true) {
+            BucketType* bucket = getBucket(txn, bucketLoc);
+            bool found;
+            _find(txn, bucket, key, recordLoc, false, &position, &found);
+            bucketSizes.push_back(bucket->n);
+
+            DiskLoc childLoc = childLocForPos(bucket, position);
+            if (childLoc.isNull()) {
+                // The walk ends here; count this bucket's keys as spread evenly across it.
+                if (bucket->n > 0) {
+                    before += width * position / bucket->n;
+                }
+                break;
+            }
+
+            // Each of the n + 1 children gets an equal share; the separating keys themselves
+            // are few enough to ignore.
+            before += width * position / (bucket->n + 1);
+            width /= bucket->n + 1;
+            bucketLoc = childLoc;
+        }
+
+        double numKeys = bucketSizes.back();
+        for (int i = static_cast<int>(bucketSizes.size()) - 2; i >= 0; i--) {
+            numKeys = bucketSizes[i] + (bucketSizes[i] + 1) * numKeys;
+        }
+
+        *bucketLocOut = bucketLoc;
+        *posOut = position;
+        *numKeysOut = numKeys;
+        return before;
+    }
+
     /**
      * This can cause a lot of additional page writes when we assign buckets to different parents.
      * Maybe get rid of parent ptrs?
@@ -1926,6 +2084,8 @@ namespace mongo {
         DiskLoc rLoc = _addBucket(txn);
         BucketType* r = btreemod(txn, getBucket(txn, rLoc));
 
+        // The keys moved keep the size splitPos() counted them at.
+        _copyPrefix(r, bucket);
         for (int i = split + 1; i < bucket->n; i++) {
             FullKey kn = getFullKey(bucket, i);
             invariant(pushBack(r, kn.recordLoc, kn.data, kn.prevChildBucket));
@@ -2501,6 +2661,178 @@ namespace mongo {
         }
     }
 
+    //
+    // BtreeLayoutV2, which stores the leading elements the keys of a bucket have in common once.
+    //
+    // Keys are stored without that prefix when they start with it, and whole otherwise, so adding
+    // a key never makes the others bigger.  Packing picks the prefix again.  Whatever moves keys
+    // between buckets plans with their whole size (see _packedDataSize()), apart from split(),
+    // which gives the new bucket the prefix of the bucket it splits.
+    //
+
+    template <>
+    void BtreeLogic<BtreeLayoutV2>::_copyPrefix(BucketType* bucket, const BucketType* from) {
+        invariant(bucket->n == 0 && bucket->prefixSize == 0);
+        if (from->prefixSize == 0) {
+            return;
+        }
+
+        bucket->prefixOfs = _alloc(bucket, from->prefixSize);
+        bucket->prefixSize = from->prefixSize;
+        memcpy(dataAt(bucket, bucket->prefixOfs), from->data + from->prefixOfs, from->prefixSize);
+
+        // Until packed, the prefix may be taking room no key saves.
+        setNotPacked(bucket);
+    }
+
+    template <>
+    int BtreeLogic<BtreeLayoutV2>::_packedDataSize(const BucketType* bucket, int refPos) {
+        // Counted whole, as that is what the keys take in a bucket without the same prefix.
+        int size = 0;
+        for (int j = 0; j < bucket->n; ++j) {
+            if (mayDropKey(bucket, j, refPos)) {
+                continue;
+            }
+            size += getFullKey(bucket, j).data.dataSize() + sizeof(KeyHeaderType);
+        }
+
+        return size;
+    }
+
+    template <>
+    void BtreeLogic<BtreeLayoutV2>::_pack(OperationContext* txn,
+                                          BucketType* bucket,
+                                          const DiskLoc thisLoc,
+                                          int &refPos) {
+
+        invariant(getBucket(txn, thisLoc) == bucket);
+
+        // The keys stored whole since the last pack may share a prefix, so a bucket we need room
+        // in gets packed even if nothing was deleted.
+        BucketType* modBucket = btreemod(txn, bucket);
+        setNotPacked(modBucket);
+        _packReadyForMod(modBucket, refPos);
+    }
+
+    template <>
+    void BtreeLogic<BtreeLayoutV2>::_packReadyForMod(BucketType* bucket, int &refPos) {
+        if (bucket->flags & Packed) {
+            return;
+        }
+
+        int i = 0;
+        for (int j = 0; j < bucket->n; j++) {
+            if (mayDropKey(bucket, j, refPos)) {
+                // key is unused and has no children - drop it
+                continue;
+            }
+
+            if (i != j) {
+                if (refPos == j) {
+                    // i < j so j will never be refPos again
+                    refPos = i;
+                }
+                getKeyHeader(bucket, i) = getKeyHeader(bucket, j);
+            }
+            ++i;
+        }
+
+        if (refPos == bucket->n) {
+            refPos = i;
+        }
+
+        bucket->n = i;
+
+        // The longest prefix all the compact format keys have in common.
+        char common[BtreeLayoutV2::KeyMax];
+        int commonSize = 0;
+        KeyDataType firstKey;
+        for (int j = 0; j < bucket->n; j++) {
+            const FullKey fullKey = getFullKey(bucket, j);
+            if (!fullKey.data.isCompactFormat()) {
+                continue;
+            }
+            if (!firstKey.isValid()) {
+                firstKey.assign(fullKey.data);
+                commonSize = firstKey.commonPrefixSize(firstKey);
+            }
+            else {
+                commonSize = std::min(commonSize, firstKey.commonPrefixSize(fullKey.data));
+            }
+            if (commonSize == 0) {
+                break;
+            }
+        }
+        if (commonSize > BtreeLayoutV2::KeyMax) {
+            commonSize = 0;
+        }
+        if (commonSize) {
+            firstKey.copyTo(common, 0, commonSize);
+        }
+
+        // Keep the current prefix, take the common one or have none, whichever leaves the least
+        // data.  The current prefix may do better when some keys don't start with the common one.
+        const char* prefixes[] = { NULL, bucket->data + bucket->prefixOfs, common };
+        const int prefixSizes[] = { 0, bucket->prefixSize, commonSize };
+        int best = 0;
+        int bestDataSize = 0;
+        for (int c = 0; c < 3; c++) {
+            if (c > 0 && prefixSizes[c] == 0) {
+                continue;
+            }
+
+            int dataSize = prefixSizes[c];
+            for (int j = 0; j < bucket->n; j++) {
+                const FullKey fullKey = getFullKey(bucket, j);
+                dataSize += fullKey.data.dataSize();
+                if (prefixSizes[c] && fullKey.data.startsWith(prefixes[c], prefixSizes[c])) {
+                    dataSize -= prefixSizes[c];
+                }
+            }
+
+            if (c == 0 || dataSize < bestDataSize) {
+                best = c;
+                bestDataSize = dataSize;
+            }
+        }
+
+        int tdz = totalDataSize(bucket);
+        char temp[BtreeLayoutV2::BucketSize];
+        const int prefixSize = prefixSizes[best];
+        int ofs = tdz - prefixSize;
+        const int prefixOfs = ofs;
+        if (prefixSize) {
+            memcpy(temp + ofs, prefixes[best], prefixSize);
+        }
+
+        // The keys still read the old prefix from the bucket until it is replaced below.
+        for (int j = 0; j < bucket->n; j++) {
+            KeyHeaderType& header = getKeyHeader(bucket, j);
+            const KeyDataType key(BtreeLayoutV2::keyAt(bucket, header));
+            const int skip = (prefixSize && key.startsWith(temp + prefixOfs, prefixSize))
+                                 ? prefixSize : 0;
+            const int sz = key.dataSize() - skip;
+            ofs -= sz;
+            key.copyTo(temp + ofs, skip, sz);
+            header.setKeyDataOfs(ofs);
+            if (skip) {
+                header.setPrefixed();
+            }
+        }
+
+        int dataUsed = tdz - ofs;
+        memcpy(bucket->data + ofs, temp + ofs, dataUsed);
+
+        bucket->prefixOfs = prefixSize ? prefixOfs : 0;
+        bucket->prefixSize = prefixSize;
+        bucket->topSize = dataUsed;
+        int emptySize = tdz - dataUsed - bucket->n * sizeof(KeyHeaderType);
+        invariant(emptySize >= 0);
+        bucket->emptySize = emptySize;
+        setPacked(bucket);
+        assertValid(_indexName, bucket, _ordering);
+    }
+
     //
     // And, template stuff.
     //
@@ -2513,4 +2845,7 @@ namespace mongo {
     template struct FixedWidthKey<DiskLoc56Bit>;
     template class BtreeLogic<BtreeLayoutV1>;
 
+    // V2 format.
+    template class BtreeLogic<BtreeLayoutV2>;
+
 }  // namespace mongo
@@ -111,6 +111,16 @@ namespace mongo {
              */
             DiskLoc newBucket(BucketType* leftSib, DiskLoc leftSibLoc);
 
+            /**
+             * Adds a key to the end of the bucket at bucketLoc, packing it first if that makes
+             * the room.  Returns false if the bucket is full.
+             */
+            bool _pushBack(BucketType* bucket,
+                           DiskLoc bucketLoc,
+                           DiskLoc recordLoc,
+                           const KeyDataType& key,
+                           DiskLoc prevChild);
+
             BucketType* _getModifiableBucket(DiskLoc loc);
             BucketType* _getBucket(DiskLoc loc);
 
@@ -168,6 +178,22 @@ namespace mongo {
 
         bool isEmpty(OperationContext* txn) const;
 
+        /**
+         * Counts the keys between 'startKey' and 'endKey' from the two root-to-leaf paths which
+         * locate them, without walking the keys in between.  The count is exact if both paths
+         * end in the same bucket with no children in between; otherwise it is an estimate,
+         * made only if 'approximate' is true.
+         *
+         * @see SortedDataInterface::countKeysInRange
+         */
+        bool countKeysInRange(OperationContext* txn,
+                              const BSONObj& startKey,
+                              bool startKeyInclusive,
+                              const BSONObj& endKey,
+                              bool endKeyInclusive,
+                              bool approximate,
+                              long long* countOut) const;
+
         long long fullValidate(OperationContext*,
                                long long *unusedCount,
                                bool strict,
@@ -254,7 +280,7 @@ namespace mongo {
                 : header(getKeyHeader(bucket, i)),
                   prevChildBucket(header.prevChildBucket),
                   recordLoc(header.recordLoc),
-                  data(bucket->data + header.keyDataOfs()) { }
+                  data(BtreeLayout::keyAt(bucket, header)) { }
 
             // This is actually a reference to something on-disk.
             const KeyHeaderType& header;
@@ -291,13 +317,15 @@ namespace mongo {
 
         static void _unalloc(BucketType* bucket, int bytes);
 
+        static void _copyPrefix(BucketType* bucket, const BucketType* from);
+
         static void _delKeyAtPos(BucketType* bucket, int keypos, bool mayEmpty = false);
 
         static void popBack(BucketType* bucket, DiskLoc* recordLocOut, KeyDataType *keyDataOut);
 
-        static bool mayDropKey(BucketType* bucket, int index, int refPos);
+        static bool mayDropKey(const BucketType* bucket, int index, int refPos);
 
-        static int _packedDataSize(BucketType* bucket, int refPos);
+        static int _packedDataSize(const BucketType* bucket, int refPos);
 
         static void setPacked(BucketType* bucket);
 
@@ -383,9 +411,14 @@ namespace mongo {
                            const vector<bool>& keyEndInclusive,
                            int direction) const;
 
+        /**
+         * Returns true if the first used entry for 'key' is at a DiskLoc other than 'self'.  If
+         * 'isPresentOut' is not NULL, it is set to whether that entry is at 'self' instead.
+         */
         bool wouldCreateDup(OperationContext* txn,
                             const KeyDataType& key,
-                            const DiskLoc self) const;
+                            const DiskLoc self,
+                            bool* isPresentOut = NULL) const;
 
         bool keyIsUsed(OperationContext* txn, const DiskLoc& loc, const int& pos) const;
 
@@ -407,6 +440,21 @@ namespace mongo {
                         const DiskLoc& recordLoc,
                         const int direction) const;
 
+        /**
+         * Walks down from the root to where <key, recordLoc> would be inserted, and returns the
+         * fraction of the tree's keys estimated to sort before that position, assuming the
+         * subtrees of every bucket on the path hold equally many keys.
+         *
+         * Fills in the bucket and position where the walk ended, and an estimate of the number
+         * of keys in the tree made from the sizes of the buckets on the path.
+         */
+        double _estimatePosition(OperationContext* txn,
+                                 const KeyDataType& key,
+                                 const DiskLoc& recordLoc,
+                                 DiskLoc* bucketLocOut,
+                                 int* posOut,
+                                 double* numKeysOut) const;
+
         long long _fullValidate(OperationContext* txn,
                                 const DiskLoc bucketLoc,
                                 long long *unusedCount,
@@ -592,4 +640,21 @@ namespace mongo {
         BucketDeletionNotification* _bucketDeletion;
     };
 
+    // The prefix compression of BtreeLayoutV2 packs buckets and counts their keys its own way.
+
+    template <>
+    void BtreeLogic<BtreeLayoutV2>::_copyPrefix(BucketType* bucket, const BucketType* from);
+
+    template <>
+    int BtreeLogic<BtreeLayoutV2>::_packedDataSize(const BucketType* bucket, int refPos);
+
+    template <>
+    void BtreeLogic<BtreeLayoutV2>::_pack(OperationContext* txn,
+                                          BucketType* bucket,
+                                          const DiskLoc thisLoc,
+                                          int &refPos);
+
+    template <>
+    void BtreeLogic<BtreeLayoutV2>::_packReadyForMod(BucketType* bucket, int &refPos);
+
 }  // namespace mongo
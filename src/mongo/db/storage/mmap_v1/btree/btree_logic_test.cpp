@@ -2073,6 +2073,147 @@ namespace mongo {
         }
     };
 
+    template<class OnDiskFormat>
+    class CountKeysInRange : public BtreeLogicTestBase<OnDiskFormat> {
+    public:
+        void run() {
+            OperationContextNoop txn;
+            this->_helper.btree.initAsEmpty(&txn);
+
+            const int nKeys = 10000;
+            for (int i = 0; i < nKeys; ++i) {
+                ASSERT_OK(this->insert(BSON("" << i), this->_helper.dummyDiskLoc));
+            }
+
+            // A short range ends within one leaf and is counted exactly.
+            long long count = -1;
+            ASSERT(countKeys(BSON("" << 5000), true, BSON("" << 5002), true, false, &count));
+            ASSERT_EQUALS(3, count);
+            ASSERT(countKeys(BSON("" << 5000), false, BSON("" << 5002), false, false, &count));
+            ASSERT_EQUALS(1, count);
+            ASSERT(countKeys(BSON("" << 5002), true, BSON("" << 5000), true, false, &count));
+            ASSERT_EQUALS(0, count);
+
+            // A range spanning many buckets can only be estimated.
+            ASSERT_FALSE(countKeys(BSON("" << 1000), true, BSON("" << 9000), false, false, &count));
+            ASSERT(countKeys(BSON("" << 1000), true, BSON("" << 9000), false, true, &count));
+            ASSERT_GREATER_THAN(count, 8000 / 2);
+            ASSERT_LESS_THAN(count, 8000 * 2);
+
+            ASSERT(countKeys(BSON("" << MINKEY), true, BSON("" << MAXKEY), true, true, &count));
+            ASSERT_GREATER_THAN(count, nKeys / 2);
+            ASSERT_LESS_THAN(count, nKeys * 2);
+        }
+
+    private:
+        bool countKeys(const BSONObj& startKey, bool startKeyInclusive,
+                       const BSONObj& endKey, bool endKeyInclusive,
+                       bool approximate, long long* countOut) {
+            OperationContextNoop txn;
+            return this->_helper.btree.countKeysInRange(&txn,
+                                                        startKey,
+                                                        startKeyInclusive,
+                                                        endKey,
+                                                        endKeyInclusive,
+                                                        approximate,
+                                                        countOut);
+        }
+    };
+
+    /**
+     * Compound keys whose first field is the same long string, as the keys of an index on
+     * { tenant : 1, n : 1 } with few tenants are.
+     */
+    static BSONObj sharedPrefixKey(int n) {
+        return BSON("" << string(200, 't') << "" << n);
+    }
+
+    template<class OnDiskFormat>
+    class SharedPrefixInsertDelete : public BtreeLogicTestBase<OnDiskFormat> {
+    public:
+        void run() {
+            OperationContextNoop txn;
+            this->_helper.btree.initAsEmpty(&txn);
+
+            const int nKeys = 1000;
+            for (int i = 0; i < nKeys; ++i) {
+                ASSERT_OK(this->insert(sharedPrefixKey((i * 37) % nKeys),
+                                       this->_helper.dummyDiskLoc));
+            }
+            this->checkValidNumKeys(nKeys);
+
+            for (int i = 0; i < nKeys; ++i) {
+                ASSERT(found(sharedPrefixKey(i)));
+            }
+
+            for (int i = 0; i < nKeys; i += 2) {
+                ASSERT(this->unindex(sharedPrefixKey(i)));
+            }
+            this->checkValidNumKeys(nKeys / 2);
+
+            for (int i = 0; i < nKeys; ++i) {
+                ASSERT_EQUALS(i % 2 == 1, found(sharedPrefixKey(i)));
+            }
+        }
+
+    private:
+        bool found(const BSONObj& key) {
+            OperationContextNoop txn;
+            int pos;
+            DiskLoc loc;
+            return this->_helper.btree.locate(&txn, key, this->_helper.dummyDiskLoc, 1, &pos, &loc);
+        }
+    };
+
+    /**
+     * The V2 format stores the shared prefix once per bucket, whether the keys come one at a time
+     * or from a bulk build.
+     */
+    class PrefixCompressedBuckets {
+    public:
+        virtual ~PrefixCompressedBuckets() { }
+
+        void run() {
+            const int nKeys = 1000;
+
+            BtreeLogicTestHelper<BtreeLayoutV1> v1(BSON("a" << 1 << "b" << 1));
+            BtreeLogicTestHelper<BtreeLayoutV2> v2(BSON("a" << 1 << "b" << 1));
+            BtreeLogicTestHelper<BtreeLayoutV2> v2Bulk(BSON("a" << 1 << "b" << 1));
+            OperationContextNoop txn;
+            v1.btree.initAsEmpty(&txn);
+            v2.btree.initAsEmpty(&txn);
+            v2Bulk.btree.initAsEmpty(&txn);
+
+            for (int i = 0; i < nKeys; ++i) {
+                const BSONObj key = sharedPrefixKey((i * 37) % nKeys);
+                ASSERT_OK(v1.btree.insert(&txn, key, v1.dummyDiskLoc, true));
+                ASSERT_OK(v2.btree.insert(&txn, key, v2.dummyDiskLoc, true));
+            }
+
+            scoped_ptr<BtreeLogic<BtreeLayoutV2>::Builder> builder(
+                v2Bulk.btree.newBuilder(&txn, false));
+            for (int i = 0; i < nKeys; ++i) {
+                ASSERT_OK(builder->addKey(sharedPrefixKey(i), v2Bulk.dummyDiskLoc));
+            }
+
+            ASSERT_EQUALS(nKeys, v2.btree.fullValidate(&txn, NULL, true, false, 0));
+            ASSERT_EQUALS(nKeys, v2Bulk.btree.fullValidate(&txn, NULL, true, false, 0));
+
+            const long long v1Buckets = v1.recordStore.numRecords(&txn);
+            ASSERT_LESS_THAN(v2.recordStore.numRecords(&txn) * 4, v1Buckets);
+            ASSERT_LESS_THAN(v2Bulk.recordStore.numRecords(&txn) * 4, v1Buckets);
+
+            // A key which doesn't share the prefix is stored whole beside the others.
+            const BSONObj other = BSON("" << "other" << "" << 1);
+            ASSERT_OK(v2.btree.insert(&txn, other, v2.dummyDiskLoc, true));
+            ASSERT_EQUALS(nKeys + 1, v2.btree.fullValidate(&txn, NULL, true, false, 0));
+            int pos;
+            DiskLoc loc;
+            ASSERT(v2.btree.locate(&txn, other, v2.dummyDiskLoc, 1, &pos, &loc));
+            ASSERT_EQUALS(other, v2.btree.getKey(&txn, loc, pos));
+        }
+    };
+
 
     /* This test requires the entire server to be linked-in and it is better implemented using
        the JS framework. Disabling here and will put in jsCore.
@@ -2303,13 +2444,29 @@ namespace mongo {
             add< LocateEmptyReverse<OnDiskFormat> >();
 
             add< DuplicateKeys<OnDiskFormat> >();
+            add< CountKeysInRange<OnDiskFormat> >();
+            add< SharedPrefixInsertDelete<OnDiskFormat> >();
         }
     };
 
-    // Test suite for both V0 and V1
+    class BtreeLogicV2TestSuite : public unittest::Suite {
+    public:
+        BtreeLogicV2TestSuite() : Suite("BTreeLogicTests_V2Prefix") { }
+
+        void setupTests() {
+            add< PrefixCompressedBuckets >();
+        }
+    };
+
+    // Test suite for V0, V1 and V2
     static unittest::SuiteInstance< BtreeLogicTestSuite<BtreeLayoutV0> > SUITE_V0(
         "BTreeLogicTests_V0");
 
     static unittest::SuiteInstance< BtreeLogicTestSuite<BtreeLayoutV1> > SUITE_V1(
         "BTreeLogicTests_V1");
+
+    static unittest::SuiteInstance< BtreeLogicTestSuite<BtreeLayoutV2> > SUITE_V2(
+        "BTreeLogicTests_V2");
+
+    static unittest::SuiteInstance< BtreeLogicV2TestSuite > SUITE_V2_PREFIX;
 }
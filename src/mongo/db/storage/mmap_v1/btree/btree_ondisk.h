@@ -313,11 +313,115 @@ namespace mongo {
         sizeof(BtreeBucketV1) - sizeof(reinterpret_cast<BtreeBucketV1*>(NULL)->data) 
                 == BtreeBucketV1::HeaderSize);
 
+    /**
+     * The fixed width key of the V2 bucket type.  The top bit of the offset, which a body of
+     * BucketSize bytes never needs, tells whether the key data leaves out its bucket's prefix.
+     */
+    struct FixedWidthKeyV2 : public FixedWidthKey<DiskLoc56Bit> {
+        enum { PrefixedFlag = 0x8000 };
+
+        short keyDataOfs() const {
+            return static_cast<short>(_kdo & ~PrefixedFlag);
+        }
+
+        /** Also clears the prefixed flag: whoever moves key data says what it holds. */
+        void setKeyDataOfs(short s) {
+            _kdo = s;
+            invariant(s>=0);
+        }
+
+        void setKeyDataOfsSavingUse(short s) {
+            setKeyDataOfs(s);
+        }
+
+        bool isPrefixed() const {
+            return _kdo & PrefixedFlag;
+        }
+
+        void setPrefixed() {
+            _kdo |= PrefixedFlag;
+        }
+    };
+
+    BOOST_STATIC_ASSERT(sizeof(FixedWidthKeyV2) == sizeof(FixedWidthKey<DiskLoc56Bit>));
+
+    /**
+     * The V2 bucket is the V1 bucket plus a key prefix: the leading elements of its keys are
+     * stored once in the body, and the keys flagged as prefixed store only the rest.  Keys which
+     * don't start with the prefix are stored whole.
+     *
+     * |hhhh|kkkkkkk--------bbbbbbbbbbbuuubbbuubbbpppp|
+     * p = prefix data, allocated like the key data
+     */
+    struct BtreeBucketV2 {
+        /** Parent bucket of this bucket, which isNull() for the root bucket. */
+        DiskLoc56Bit parent;
+
+        /** Given that there are n keys, this is the n index child. */
+        DiskLoc56Bit nextChild;
+
+        unsigned short flags;
+
+        /** Size of the empty region. */
+        unsigned short emptySize;
+
+        /** Size used for key storage, including the prefix and storage of old keys. */
+        unsigned short topSize;
+
+        /* Number of keys in the bucket. */
+        unsigned short n;
+
+        /** Offset within the body of the prefix. */
+        unsigned short prefixOfs;
+
+        /** Size of the prefix, 0 if there is none. */
+        unsigned short prefixSize;
+
+        /* Beginning of the bucket's body */
+        char data[4];
+
+        // Precalculated size constants
+        enum { HeaderSize = 26 };
+    };
+
+    // BtreeBucketV2 is part of the on-disk format, so it should never be changed
+    BOOST_STATIC_ASSERT(
+        sizeof(BtreeBucketV2) - sizeof(reinterpret_cast<BtreeBucketV2*>(NULL)->data)
+                == BtreeBucketV2::HeaderSize);
+
     enum Flags {
         Packed = 1
     };
 
-    struct BtreeLayoutV0 {
+    /**
+     * How the layouts which store every key whole in the bucket body get at their keys.
+     */
+    template <class BucketType, class FixedWidthKeyType, class KeyType>
+    struct WholeKeyStorage {
+        static KeyType keyAt(const BucketType* bucket, const FixedWidthKeyType& header) {
+            return KeyType(bucket->data + header.keyDataOfs());
+        }
+
+        /** Bytes of the body 'key' would take in 'bucket'. */
+        static int keyDataSize(const BucketType* bucket, const KeyType& key) {
+            return key.dataSize();
+        }
+
+        /** Bytes of the body the key of 'header' takes. */
+        static int keyDataSize(const BucketType* bucket, const FixedWidthKeyType& header) {
+            return keyAt(bucket, header).dataSize();
+        }
+
+        /** Writes keyDataSize(bucket, key) bytes at 'dest' for the key of 'header'. */
+        static void writeKey(const BucketType* bucket,
+                             FixedWidthKeyType* header,
+                             const KeyType& key,
+                             char* dest) {
+            memcpy(dest, key.data(), key.dataSize());
+        }
+    };
+
+    struct BtreeLayoutV0 : public WholeKeyStorage<BtreeBucketV0, FixedWidthKey<DiskLoc>, KeyBson> {
         typedef FixedWidthKey<DiskLoc> FixedWidthKeyType;
         typedef DiskLoc LocType;
         typedef KeyBson KeyType;
@@ -343,7 +447,9 @@ namespace mongo {
         }
     };
 
-    struct BtreeLayoutV1 {
+    struct BtreeLayoutV1 : public WholeKeyStorage<BtreeBucketV1,
+                                                  FixedWidthKey<DiskLoc56Bit>,
+                                                  KeyV1> {
         typedef FixedWidthKey<DiskLoc56Bit> FixedWidthKeyType;
         typedef KeyV1 KeyType;
         typedef KeyV1Owned KeyOwnedType;
@@ -362,6 +468,60 @@ namespace mongo {
         static void initBucket(BucketType* bucket) { }
     };
 
+    struct BtreeLayoutV2 {
+        typedef FixedWidthKeyV2 FixedWidthKeyType;
+        typedef KeyV2 KeyType;
+        typedef KeyV2Owned KeyOwnedType;
+        typedef DiskLoc56Bit LocType;
+        typedef BtreeBucketV2 BucketType;
+
+        enum { BucketSize = 8192 - 16,  // The -16 is to leave room for the Record header
+               BucketBodySize = BucketSize - BucketType::HeaderSize
+        };
+
+        static const int KeyMax = 1024;
+
+        // A sentinel value sometimes used to identify a deallocated bucket.
+        static const unsigned short INVALID_N_SENTINEL = 0xffff;
+
+        static void initBucket(BucketType* bucket) {
+            bucket->prefixOfs = 0;
+            bucket->prefixSize = 0;
+        }
+
+        static KeyType keyAt(const BucketType* bucket, const FixedWidthKeyType& header) {
+            const char* keyData = bucket->data + header.keyDataOfs();
+            if (!header.isPrefixed()) {
+                return KeyType(keyData);
+            }
+            return KeyType(bucket->data + bucket->prefixOfs, bucket->prefixSize, keyData);
+        }
+
+        static bool sharesPrefix(const BucketType* bucket, const KeyType& key) {
+            return bucket->prefixSize
+                && key.startsWith(bucket->data + bucket->prefixOfs, bucket->prefixSize);
+        }
+
+        static int keyDataSize(const BucketType* bucket, const KeyType& key) {
+            return key.dataSize() - (sharesPrefix(bucket, key) ? bucket->prefixSize : 0);
+        }
+
+        static int keyDataSize(const BucketType* bucket, const FixedWidthKeyType& header) {
+            return KeyType(bucket->data + header.keyDataOfs()).dataSize();
+        }
+
+        static void writeKey(const BucketType* bucket,
+                             FixedWidthKeyType* header,
+                             const KeyType& key,
+                             char* dest) {
+            const int skip = sharesPrefix(bucket, key) ? bucket->prefixSize : 0;
+            key.copyTo(dest, skip, key.dataSize() - skip);
+            if (skip) {
+                header->setPrefixed();
+            }
+        }
+    };
+
 #pragma pack()
 
 }  // namespace mongo
@@ -682,6 +682,130 @@ namespace mongo {
         return true;
     }
 
+    // KeyV2 is for V2 indexes
+
+    KeyV2Owned::KeyV2Owned(const BSONObj& obj) {
+        KeyV1Owned key(obj);
+        b.appendBuf(key.data(), key.dataSize());
+        _keyData = (const unsigned char *) b.buf();
+    }
+
+    KeyV2Owned::KeyV2Owned(const KeyV2& rhs) {
+        int size = rhs.dataSize();
+        rhs.copyTo(b.skip(size), 0, size);
+        _keyData = (const unsigned char *) b.buf();
+    }
+
+    BSONObj KeyV2::toBson() const {
+        if( _prefixSize == 0 )
+            return KeyV1(data()).toBson();
+        KeyV2Owned whole(*this);
+        return KeyV1(whole.data()).toBson();
+    }
+
+    int KeyV2::dataSize() const {
+        return _prefixSize + KeyV1((const char *) _keyData).dataSize();
+    }
+
+    int KeyV2::woCompare(const KeyV2& right, const Ordering &order) const {
+        if( (_prefixSize|right._prefixSize) == 0 )
+            return KeyV1(data()).woCompare(KeyV1(right.data()), order);
+
+        const unsigned char *l = firstByte();
+        const unsigned char *r = right.firstByte();
+
+        // only one of the two, which has no prefix, can be traditional BSON
+        if( (*l|*r) == IsBSON )
+            return toBson().woCompare(right.toBson(), order, /*considerfieldname*/false);
+
+        // the prefixes are whole elements, so we only need to check for their ends between two
+        const unsigned char *lPrefixEnd = _prefixSize ? _prefix + _prefixSize : 0;
+        const unsigned char *rPrefixEnd = right._prefixSize ? right._prefix + right._prefixSize : 0;
+
+        unsigned mask = 1;
+        while( 1 ) {
+            char lval = *l;
+            char rval = *r;
+            {
+                int x = compare(l, r); // updates l and r pointers
+                if( x ) {
+                    if( order.descending(mask) )
+                        x = -x;
+                    return x;
+                }
+            }
+
+            {
+                int x = ((int)(lval & cHASMORE)) - ((int)(rval & cHASMORE));
+                if( x )
+                    return x;
+                if( (lval & cHASMORE) == 0 )
+                    break;
+            }
+
+            if( l == lPrefixEnd )
+                l = _keyData;
+            if( r == rPrefixEnd )
+                r = right._keyData;
+            mask <<= 1;
+        }
+
+        return 0;
+    }
+
+    bool KeyV2::woEqual(const KeyV2& right) const {
+        if( (_prefixSize|right._prefixSize) == 0 )
+            return KeyV1(data()).woEqual(KeyV1(right.data()));
+        KeyV2Owned l(*this);
+        KeyV2Owned r(right);
+        return KeyV1(l.data()).woEqual(KeyV1(r.data()));
+    }
+
+    bool KeyV2::startsWith(const char *prefix, int size) const {
+        if( dataSize() <= size )
+            return false;
+        int inPrefix = min(size, _prefixSize);
+        if( inPrefix && memcmp(_prefix, prefix, inPrefix) )
+            return false;
+        return memcmp(_keyData, prefix + inPrefix, size - inPrefix) == 0;
+    }
+
+    int KeyV2::commonPrefixSize(const KeyV2& right) const {
+        if( !isCompactFormat() || !right.isCompactFormat() )
+            return 0;
+
+        const unsigned char *l = firstByte();
+        const unsigned char *r = right.firstByte();
+        const unsigned char *lPrefixEnd = _prefixSize ? _prefix + _prefixSize : 0;
+        const unsigned char *rPrefixEnd = right._prefixSize ? right._prefix + right._prefixSize : 0;
+
+        int common = 0;
+        while( (*l & cHASMORE) && (*r & cHASMORE) ) {
+            unsigned sz = sizeOfElement(l);
+            if( sz != sizeOfElement(r) || memcmp(l, r, sz) )
+                break;
+            common += sz;
+            l += sz;
+            r += sz;
+            if( l == lPrefixEnd )
+                l = _keyData;
+            if( r == rPrefixEnd )
+                r = right._keyData;
+        }
+        return common;
+    }
+
+    void KeyV2::copyTo(char *dest, int offset, int size) const {
+        if( offset < _prefixSize ) {
+            int n = min(size, _prefixSize - offset);
+            memcpy(dest, _prefix + offset, n);
+            dest += n;
+            offset += n;
+            size -= n;
+        }
+        memcpy(dest, _keyData + (offset - _prefixSize), size);
+    }
+
     struct CmpUnitTest : public StartupTest {
         void run() {
             char a[2];
@@ -39,6 +39,8 @@ namespace mongo {
         KeyBson is a legacy wrapper implementation for old BSONObj style keys for v:0 indexes.
 
         KeyV1 is the new implementation.
+
+        KeyV2 is KeyV1 data whose leading elements may be shared by the keys of a bucket.
     */
     class KeyBson /* "KeyV0" */ { 
     public:
@@ -127,4 +129,92 @@ namespace mongo {
         void traditional(const BSONObj& obj); // store as traditional bson not as compact format
     };
 
+    class KeyV2Owned;
+
+    /** corresponding to BtreeData_V2.  The data is in KeyV1 format, but a bucket stores the
+        leading elements its keys have in common only once, so the first prefixSize bytes of a
+        key (always whole elements of a compact format key) may live apart from the rest.  Keys
+        from outside a bucket have no prefix.
+    */
+    class KeyV2 {
+        void operator=(const KeyV2&); // disallowed just to make people be careful as we don't own the buffer
+        KeyV2(const KeyV2Owned&);     // disallowed as this is not a great idea as KeyV2Owned likely will go out of scope
+    public:
+        KeyV2() : _prefix(0), _prefixSize(0), _keyData(0) { }
+
+        KeyV2(const KeyV2& rhs)
+            : _prefix(rhs._prefix), _prefixSize(rhs._prefixSize), _keyData(rhs._keyData) {
+            dassert( _keyData > (const unsigned char *) 1 );
+        }
+
+        // explicit version of operator= to be safe
+        void assign(const KeyV2& rhs) {
+            _prefix = rhs._prefix;
+            _prefixSize = rhs._prefixSize;
+            _keyData = rhs._keyData;
+        }
+
+        /** @param keyData a whole key, as for KeyV1 */
+        explicit KeyV2(const char *keyData)
+            : _prefix(0), _prefixSize(0), _keyData((const unsigned char *) keyData) { }
+
+        /** the key whose first prefixSize bytes are at prefix and whose other bytes are at rest */
+        KeyV2(const char *prefix, int prefixSize, const char *rest)
+            : _prefix((const unsigned char *) prefix),
+              _prefixSize(prefixSize),
+              _keyData((const unsigned char *) rest) { }
+
+        int woCompare(const KeyV2& r, const Ordering &o) const;
+        bool woEqual(const KeyV2& r) const;
+        BSONObj toBson() const;
+        std::string toString() const { return toBson().toString(); }
+
+        /** the key data of a key without prefix */
+        const char * data() const {
+            dassert( _prefixSize == 0 );
+            return (const char *) _keyData;
+        }
+
+        /** @return size of the whole key, prefix included */
+        int dataSize() const;
+
+        /** only used by geo, which always has bson keys */
+        BSONElement _firstElement() const { return KeyV1(data())._firstElement(); }
+        bool isCompactFormat() const { return *firstByte() != IsBSON; }
+
+        bool isValid() const { return _keyData > (const unsigned char*)1; }
+
+        /** @return true if the key starts with the size bytes at prefix and has more after them */
+        bool startsWith(const char *prefix, int size) const;
+
+        /** @return the size of the leading elements this key has byte for byte in common with r,
+                    leaving at least the last element of each out
+        */
+        int commonPrefixSize(const KeyV2& r) const;
+
+        /** copies size bytes of the whole key, starting offset bytes in, to dest */
+        void copyTo(char *dest, int offset, int size) const;
+
+    protected:
+        enum { IsBSON = 0xff };
+        const unsigned char *_prefix;
+        int _prefixSize;
+        const unsigned char *_keyData;
+    private:
+        const unsigned char *firstByte() const { return _prefixSize ? _prefix : _keyData; }
+    };
+
+    class KeyV2Owned : public KeyV2 {
+        void operator=(const KeyV2Owned&);
+    public:
+        /** @obj a BSON object to be translated to KeyV1 format, see KeyV1Owned */
+        KeyV2Owned(const BSONObj& obj);
+
+        /** makes a contiguous copy of the whole key */
+        KeyV2Owned(const KeyV2& rhs);
+
+    private:
+        StackBufBuilder b;
+    };
+
 };
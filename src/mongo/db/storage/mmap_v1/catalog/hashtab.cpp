@@ -38,44 +38,106 @@
 
 namespace mongo {
 
-    int NamespaceHashTable::_find(const Key& k, bool& found) {
-        found = false;
-        int h = k.hash();
-        int i = h % n;
-        int start = i;
-        int chain = 0;
-        int firstNonUsed = -1;
-        while ( 1 ) {
-            if ( !nodes(i).inUse() ) {
-                if ( firstNonUsed < 0 )
-                    firstNonUsed = i;
+    class NamespaceHashTable::BucketChange : public RecoveryUnit::Change {
+    public:
+        /**
+         * @param bucket - the bucket 'key' was in before the change, or -1 if it was not in
+         *                 the table
+         */
+        BucketChange(NamespaceHashTable* table, const std::string& key, int bucket)
+            : _table(table), _key(key), _bucket(bucket) {
+        }
+
+        virtual void commit() {}
+        virtual void rollback() {
+            boost::mutex::scoped_lock lk(_table->_bucketsMutex);
+            if (_bucket < 0) {
+                _table->_buckets.erase(_key);
+            }
+            else {
+                _table->_buckets[_key] = _bucket;
             }
+        }
+
+    private:
+        NamespaceHashTable* const _table;
+        const std::string _key;
+        const int _bucket;
+    };
+
+    NamespaceHashTable::Type* NamespaceHashTable::get(const Key& k) {
+        boost::mutex::scoped_lock lk(_bucketsMutex);
+        BucketMap::const_iterator it = _buckets.find(k.toString());
+        if (it == _buckets.end())
+            return 0;
+        return &nodes(it->second).value;
+    }
+
+    void NamespaceHashTable::kill(OperationContext* txn, const Key& k) {
+        boost::mutex::scoped_lock lk(_bucketsMutex);
+        const std::string key = k.toString();
+        BucketMap::iterator it = _buckets.find(key);
+        if (it == _buckets.end())
+            return;
+
+        const int i = it->second;
+        Node* node = txn->recoveryUnit()->writing(&nodes(i));
+        node->k.kill();
+        node->setUnused();
+
+        _buckets.erase(it);
+        txn->recoveryUnit()->registerChange(new BucketChange(this, key, i));
+    }
 
-            if ( nodes(i).hash == h && nodes(i).k == k ) {
-                if ( chain >= 200 )
-                    log() << "warning: hashtable " << name << " long chain " << std::endl;
-                found = true;
+    bool NamespaceHashTable::put(OperationContext* txn, const Key& k, const Type& value) {
+        boost::mutex::scoped_lock lk(_bucketsMutex);
+        const std::string key = k.toString();
+        BucketMap::const_iterator it = _buckets.find(key);
+        if (it != _buckets.end()) {
+            Node* node = txn->recoveryUnit()->writing(&nodes(it->second));
+            verify( node->hash == k.hash() );
+            node->value = value;
+            return true;
+        }
+
+        const int i = _findUnused(k);
+        if (i < 0)
+            return false;
+
+        Node* node = txn->recoveryUnit()->writing(&nodes(i));
+        node->k = k;
+        node->hash = k.hash();
+        node->value = value;
+
+        _buckets[key] = i;
+        txn->recoveryUnit()->registerChange(new BucketChange(this, key, -1));
+        return true;
+    }
+
+    int NamespaceHashTable::_findUnused(const Key& k) {
+        // The same bucket the probing of the table used to settle on for a namespace it did
+        // not find, so that files stay readable by older versions.
+        int i = k.hash() % n;
+        for (int chain = 0; chain < maxChain; chain++) {
+            if (!nodes(i).inUse()) {
+                if (chain >= maxChain / 2 && !_warnedNearlyFull) {
+                    _warnedNearlyFull = true;
+                    warning() << "hashtable " << name << " is nearly full, " << _buckets.size()
+                              << " of " << n << " buckets are used. Databases created with a "
+                              << "larger --nsSize can hold more collections and indexes.";
+                }
                 return i;
             }
-            chain++;
             i = (i+1) % n;
-            if ( i == start ) {
-                // shouldn't get here / defensive for infinite loops
-                log() << "error: hashtable " << name << " is full n:" << n << std::endl;
-                return -1;
-            }
-            if( chain >= maxChain ) {
-                if ( firstNonUsed >= 0 )
-                    return firstNonUsed;
-                log() << "error: hashtable " << name << " max chain reached:" << maxChain << std::endl;
-                return -1;
-            }
         }
+        log() << "error: hashtable " << name << " max chain reached:" << maxChain << std::endl;
+        return -1;
     }
 
     /* buf must be all zeroes on initialization. */
     NamespaceHashTable::NamespaceHashTable(void* buf, int buflen, const char *_name)
-        : name(_name) {
+        : name(_name),
+          _warnedNearlyFull(false) {
         int m = sizeof(Node);
         // log() << "hashtab init, buflen:" << buflen << " m:" << m << std::endl;
         n = buflen / m;
@@ -91,5 +153,10 @@ namespace mongo {
             verify( sizeof(Node) == 628 );
         }
 
+        for ( int i = 0; i < n; i++ ) {
+            if ( nodes(i).inUse() ) {
+                _buckets[nodes(i).k.toString()] = i;
+            }
+        }
     }
 }  // namespace mongo
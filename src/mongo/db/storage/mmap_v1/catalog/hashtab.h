@@ -34,30 +34,36 @@
 
 #pragma once
 
-#include <map>
+#include <boost/thread/mutex.hpp>
+#include <string>
 
 #include "mongo/db/storage/mmap_v1/catalog/namespace.h"
 #include "mongo/db/storage/mmap_v1/catalog/namespace_details.h"
 #include "mongo/db/storage/mmap_v1/dur.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/platform/unordered_map.h"
 #include "mongo/stdx/functional.h"
 
 namespace mongo {
 
-#pragma pack(1)
-
     /* you should define:
 
        int Key::hash() return > 0 always.
        Used in NamespaceIndex only.
     */
 
+    /**
+     * The fixed size, open addressing table of the .ns file.  Lookups go through an in-memory
+     * map from namespace to bucket, built when the file is opened, so that they do not probe
+     * chains which grow with the fill of the table.  The on-disk layout, and where put() places
+     * a namespace, are the same as they always were.
+     */
     class NamespaceHashTable : boost::noncopyable {
     public:
         typedef Namespace Key;
         typedef NamespaceDetails Type;
 
-        const char *name;
+#pragma pack(1)
         struct Node {
             int hash;
             Key k;
@@ -69,57 +75,17 @@ namespace mongo {
                 hash = 0;
             }
         };
-        void* _buf;
-        int n; // number of hashtable buckets
-        int maxChain;
-
-        Node& nodes(int i) {
-            Node *nodes = (Node *) _buf;
-            return nodes[i];
-        }
-
-        int _find(const Key& k, bool& found);
+#pragma pack()
 
-    public:
         /* buf must be all zeroes on initialization. */
         NamespaceHashTable(void* buf, int buflen, const char *_name);
 
-        Type* get(const Key& k) {
-            bool found;
-            int i = _find(k, found);
-            if ( found )
-                return &nodes(i).value;
-            return 0;
-        }
+        Type* get(const Key& k);
 
-        void kill(OperationContext* txn, const Key& k) {
-            bool found;
-            int i = _find(k, found);
-            if ( i >= 0 && found ) {
-                Node* n = &nodes(i);
-                n = txn->recoveryUnit()->writing(n);
-                n->k.kill();
-                n->setUnused();
-            }
-        }
+        void kill(OperationContext* txn, const Key& k);
 
         /** returns false if too full */
-        bool put(OperationContext* txn, const Key& k, const Type& value) {
-            bool found;
-            int i = _find(k, found);
-            if ( i < 0 )
-                return false;
-            Node* n = txn->recoveryUnit()->writing( &nodes(i) );
-            if ( !found ) {
-                n->k = k;
-                n->hash = k.hash();
-            }
-            else {
-                verify( n->hash == k.hash() );
-            }
-            n->value = value;
-            return true;
-        }
+        bool put(OperationContext* txn, const Key& k, const Type& value);
 
         typedef stdx::function< void ( const Key& k , Type& v ) > IteratorCallback;
         void iterAll( IteratorCallback callback ) {
@@ -130,8 +96,32 @@ namespace mongo {
             }
         }
 
-    };
+    private:
+        class BucketChange;
 
-#pragma pack()
+        typedef unordered_map<std::string, int> BucketMap;
+
+        Node& nodes(int i) {
+            Node *nodes = (Node *) _buf;
+            return nodes[i];
+        }
+
+        /**
+         * Returns the first unused bucket of the chain of 'k', which is not in the table, or -1
+         * if there is none within maxChain.
+         */
+        int _findUnused(const Key& k);
+
+        const char *name;
+        void* _buf;
+        int n; // number of hashtable buckets
+        int maxChain;
+        bool _warnedNearlyFull;
+
+        // The bucket of each namespace in the table.  put() and kill() register a BucketChange
+        // which undoes their update of it if the unit of work rolls back.
+        BucketMap _buckets;
+        boost::mutex _bucketsMutex;
+    };
 
 } // namespace mongo
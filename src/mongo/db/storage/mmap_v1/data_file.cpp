@@ -155,7 +155,7 @@ namespace mongo {
         mmf.flush( sync );
     }
 
-    DiskLoc DataFile::allocExtentArea( OperationContext* txn, int size ) {
+    DiskLoc DataFile::allocExtentArea( OperationContext* txn, int size, bool rollsBack ) {
 
         massert( 10357, "shutdown in progress", !inShutdown() );
         massert( 10359, "header==0 on new extent: 32 bit mmap space exceeded?", header() ); // null if file open failed
@@ -165,8 +165,15 @@ namespace mongo {
         int offset = header()->unused.getOfs();
 
         DataFileHeader *h = header();
-        *txn->recoveryUnit()->writing(&h->unused) = DiskLoc( fileNo, offset + size );
-        txn->recoveryUnit()->writingInt(h->unusedLength) = h->unusedLength - size;
+        if ( rollsBack ) {
+            *txn->recoveryUnit()->writing(&h->unused) = DiskLoc( fileNo, offset + size );
+            txn->recoveryUnit()->writingInt(h->unusedLength) = h->unusedLength - size;
+        }
+        else {
+            MemoryMappedFile::makeWritable(h, DataFileHeader::HeaderSize);
+            *getDur().writing(&h->unused) = DiskLoc( fileNo, offset + size );
+            getDur().writingInt(h->unusedLength) = h->unusedLength - size;
+        }
 
         return DiskLoc( fileNo, offset );
     }
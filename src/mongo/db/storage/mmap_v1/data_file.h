@@ -155,7 +155,10 @@ namespace mongo {
                   int requestedDataSize = 0,
                   bool preallocateOnly = false);
 
-        DiskLoc allocExtentArea( OperationContext* txn, int size );
+        /** @param rollsBack false if the write should be made durable on its own, and not rolled
+                   back with txn's WriteUnitOfWork, see MmapV1ExtentManager::allocateExtent()
+        */
+        DiskLoc allocExtentArea( OperationContext* txn, int size, bool rollsBack = true );
 
         DataFileHeader* getHeader() { return header(); }
         const DataFileHeader* getHeader() const { return header(); }
@@ -0,0 +1,132 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/deleted_record_coalescer.h"
+
+#include <list>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_catalog_entry.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/fsync.h"
+#include "mongo/db/concurrency/d_concurrency.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/mmap_v1/record_store_v1_simple.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+    MONGO_EXPORT_SERVER_PARAMETER(deletedRecordCoalescingEnabled, bool, true);
+
+    // The most runs of adjacent deleted records one collection gets merged in a batch.
+    MONGO_EXPORT_SERVER_PARAMETER(deletedRecordCoalescingBatchSize, int, 1000);
+
+    DeletedRecordCoalescer deletedRecordCoalescer;
+
+    void DeletedRecordCoalescer::run() {
+        Client::initThread( name().c_str() );
+
+        while ( !inShutdown() ) {
+            sleepsecs( 60 );
+
+            if ( !deletedRecordCoalescingEnabled ) {
+                LOG(1) << "DeletedRecordCoalescer is disabled" << endl;
+                continue;
+            }
+
+            if ( lockedForWriting() ) {
+                LOG(3) << " locked for writing" << endl;
+                continue;
+            }
+
+            std::set<std::string> dbs;
+            dbHolder().getAllShortNames( dbs );
+
+            for ( std::set<std::string>::const_iterator i = dbs.begin();
+                  i != dbs.end() && !inShutdown(); ++i ) {
+                try {
+                    _coalesceDatabase( *i );
+                }
+                catch ( const DBException& e ) {
+                    log() << "DeletedRecordCoalescer on " << *i << " failed: " << e.toString();
+                }
+            }
+        }
+    }
+
+    void DeletedRecordCoalescer::_coalesceDatabase(const std::string& dbName) {
+        std::list<std::string> namespaces;
+        {
+            OperationContextImpl txn;
+            AutoGetDb autoDb( &txn, dbName, MODE_IS );
+            Database* db = autoDb.getDb();
+            if ( !db ) {
+                return; // dropped meanwhile
+            }
+            db->getDatabaseCatalogEntry()->getCollectionNamespaces( &namespaces );
+        }
+
+        for ( std::list<std::string>::const_iterator it = namespaces.begin();
+              it != namespaces.end(); ++it ) {
+            OperationContextImpl txn;
+            AutoGetDb autoDb( &txn, dbName, MODE_IX );
+            Database* db = autoDb.getDb();
+            if ( !db ) {
+                return;
+            }
+
+            Lock::CollectionLock collLock( txn.lockState(), *it, MODE_X );
+            Collection* collection = db->getCollection( &txn, *it );
+            if ( !collection ) {
+                continue;
+            }
+
+            // Capped collections keep their deleted records in order of the extents instead.
+            SimpleRecordStoreV1* rs =
+                dynamic_cast<SimpleRecordStoreV1*>( collection->getRecordStore() );
+            if ( !rs ) {
+                continue;
+            }
+
+            WriteUnitOfWork wunit( &txn );
+            const int n = rs->coalesceDeletedRecords( &txn, deletedRecordCoalescingBatchSize );
+            wunit.commit();
+
+            if ( n ) {
+                LOG(1) << "DeletedRecordCoalescer merged " << n << " deleted records in " << *it;
+            }
+        }
+    }
+}
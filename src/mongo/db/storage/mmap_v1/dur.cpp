@@ -36,9 +36,8 @@
        we could be in read lock for this
        for very large objects write directly to redo log in situ?
      WRITETOJOURNAL
-       we could be unlocked (the main db lock that is...) for this, with sufficient care, but there is some complexity
-         have to handle falling behind which would use too much ram (going back into a read lock would suffice to stop that).
-         for now (1.7.5/1.8.0) we are in read lock which is not ideal.
+       done unlocked on the journal writer thread, see CommitPipeline.  falling behind is bounded by
+         the number of buffers: the dur thread waits for a free one while holding the flush lock.
      WRITETODATAFILES
        actually write to the database data files in this phase.  currently done by memcpy'ing the writes back to 
        the non-private MMF.  alternatively one could write to the files the traditional way; however the way our 
@@ -52,19 +51,28 @@
 
    mutexes:
 
-     READLOCK dbMutex (big 'R')
-     LOCK groupCommitMutex
-       PREPLOGBUFFER()
-     READLOCK mmmutex
-       commitJob.reset()
-     UNLOCK dbMutex                      // now other threads can write
+     dur thread:
+       LOCK flush lock (S)                 // waits for the writers, lets the readers go on
+       LOCK groupCommitMutex
+         PREPLOGBUFFER()                   // into a free CommitPipeline buffer
+         commitJob.committingReset()
+       UNLOCK groupCommitMutex
+       UNLOCK flush lock                   // now other threads can write
+
+     journal writer thread, commit N (while the dur thread prepares N+1):
        WRITETOJOURNAL()
-       WRITETODATAFILES()
-     UNLOCK mmmutex
-     UNLOCK groupCommitMutex
+       notify getLastError j:true waiters
+
+     data file writer thread, commit N-1:
+       READLOCK mmmutex
+         WRITETODATAFILES()
+       UNLOCK mmmutex
 
-   every Nth groupCommit, at the end, we REMAPPRIVATEVIEW() at the end of the work. because of
-   that we are in W lock for that groupCommit, which is nonideal of course.
+   every so often (see remapDue()), the dur thread keeps the flush lock after a groupCommit, waits
+   for the pipeline to apply all the commits, and REMAPPRIVATEVIEW()s a fraction of the files with
+   writers still excluded.  where mmap'ing over a view is atomic (not Windows or Solaris)
+   readers go on reading the private views meanwhile, as a remapped view holds the same data at
+   the same address.  elsewhere the flush lock is upgraded to exclusive for the remap.
 
    @see https://docs.google.com/drawings/edit?id=1TklsmZzm7ohIZkwgeK6rMvsdaR13KjtJYMsfLr175Zc
 */
@@ -73,9 +81,11 @@
 
 #include "mongo/platform/basic.h"
 
+#include <boost/bind.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <deque>
 #include <iomanip>
 
 #include "mongo/db/client.h"
@@ -83,6 +93,7 @@
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/concurrency/lock_state.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/storage_engine.h"
 #include "mongo/db/storage/mmap_v1/dur.h"
 #include "mongo/db/storage/mmap_v1/dur_commitjob.h"
@@ -119,9 +130,79 @@ namespace mongo {
         // When set, the flush thread will exit
         static AtomicUInt32 shutdownRequested(0);
 
+        // A group commit starts as soon as this many getLastError j:true waiters are pending.
+        MONGO_EXPORT_SERVER_PARAMETER(journalCommitWaitersThreshold, int, 16);
+
+        // The longest, in ms, a getLastError j:true waiter should wait for its group commit to
+        // start.  0 for a third of the commit interval.
+        MONGO_EXPORT_SERVER_PARAMETER(journalCommitLatencyTargetMs, int, 0);
+
+        // The getLastError j:true waiters which came since the last group commit began, and when
+        // the first of them came as curTimeMicros64() (0 if none did).
+        static AtomicUInt32 pendingWaiters(0);
+        static AtomicUInt64 firstWaiterMicros(0);
+
 
         CommitJob& commitJob = *(new CommitJob()); // don't destroy
 
+        /**
+         * The group commits on their way to the disk.  The dur thread prepares each commit into a
+         * free buffer while writers are held off, then a journal writer thread compresses and
+         * writes it and a data file writer thread applies it to the shared views.  So while one
+         * commit is being applied the next can be journaled and the one after that prepared.
+         * Commits go through each stage in the order they were submitted.
+         */
+        class CommitPipeline : boost::noncopyable {
+        public:
+            CommitPipeline();
+
+            /** starts the journal and data file writer threads */
+            void start();
+
+            /** waits until a buffer is free and returns it.  dur thread only. */
+            AlignedBuilder* getFreeBuffer();
+
+            /** queues the commit prepared in 'buffer' with header 'h'.  If 'buffer' is NULL there
+                is nothing to write, and only the waiters for 'commitNumber' are notified, once the
+                commits before it are journaled.  'firstWaiterMicros' is when the first j:true
+                waiter for the commit came, or 0, for the stats.
+            */
+            void submit(const JSectHeader& h,
+                        AlignedBuilder* buffer,
+                        NotifyAll::When commitNumber,
+                        unsigned long long firstWaiterMicros);
+
+            /** waits until all the commits submitted so far are in the data files */
+            void waitUntilApplied();
+
+            /** @return true if some submitted commit is not yet in the data files */
+            bool hasUnapplied();
+
+        private:
+            struct Commit {
+                JSectHeader h;
+                AlignedBuilder* buffer;
+                NotifyAll::When commitNumber;
+                unsigned long long firstWaiterMicros;
+            };
+
+            void journalWriterThread();
+            void dataFileWriterThread();
+
+            // As many commits as there are stages can be in flight.
+            enum { NumBuffers = 3 };
+
+            boost::mutex _mutex;
+            boost::condition_variable _changed;
+            std::deque<AlignedBuilder*> _freeBuffers;
+            std::deque<Commit> _toJournal;
+            std::deque<Commit> _toApply;
+            unsigned _numSubmitted; // in _toJournal or _toApply, or being applied
+            unsigned _numWithBuffer; // the part of _numSubmitted which has something to write
+        };
+
+        static CommitPipeline& commitPipeline = *(new CommitPipeline()); // don't destroy
+
         Stats stats;
 
         void Stats::S::reset() {
@@ -160,6 +241,16 @@ namespace mongo {
             return ss.str();
         }
 
+        void Stats::S::noteWaitLatency(unsigned long long micros) {
+            _commitsWithWaiters++;
+            unsigned i = 0;
+            for (unsigned long long limit = 1000; micros >= limit; limit *= 2) {
+                if (++i == NumWaitLatencyBuckets - 1)
+                    break;
+            }
+            _waitLatencyCounts[i]++;
+        }
+
         BSONObj Stats::S::_asObj() {
             BSONObjBuilder b;
             b << 
@@ -176,6 +267,17 @@ namespace mongo {
                              "writeToDataFiles" << (unsigned) (_writeToDataFilesMicros/1000) <<
                              "remapPrivateView" << (unsigned) (_remapPrivateViewMicros/1000)
                            );
+
+            BSONObjBuilder latency(b.subobjStart("waitLatencyMs"));
+            for (unsigned i = 0; i < NumWaitLatencyBuckets - 1; i++) {
+                latency << std::string(str::stream() << "lt" << (1 << i))
+                        << _waitLatencyCounts[i];
+            }
+            latency << std::string(str::stream() << "ge" << (1 << (NumWaitLatencyBuckets - 2)))
+                    << _waitLatencyCounts[NumWaitLatencyBuckets - 1];
+            latency.done();
+            b << "commitsWithWaiters" << _commitsWithWaiters;
+
             if (mmapv1GlobalOptions.journalCommitInterval != 0)
                 b << "journalCommitIntervalMs" << mmapv1GlobalOptions.journalCommitInterval;
             return b.obj();
@@ -238,11 +340,22 @@ namespace mongo {
             flushRequested.notify_one();
             commitJob._notify.waitFor(when);
 
+            // The callers go on to flush or close the data files.
+            commitPipeline.waitUntilApplied();
+
             cc().checkpointHappened();
             return true;
         }
 
         bool DurableImpl::awaitCommit() {
+            // The first waiter for the next commit starts the clock on the latency target, and
+            // enough of them start the commit right away.
+            firstWaiterMicros.compareAndSwap(0, curTimeMicros64());
+            if (pendingWaiters.addAndFetch(1) >=
+                    static_cast<unsigned>(journalCommitWaitersThreshold)) {
+                flushRequested.notify_one();
+            }
+
             commitJob._notify.awaitBeyondNow();
             return true;
         }
@@ -464,7 +577,8 @@ namespace mongo {
         }
 
         /** We need to remap the private views periodically. otherwise they would become very large.
-            Call within write lock.  See top of file for more commentary.
+            Call with writers excluded, and readers too if remapNeedsExclusiveLock.  See top of file
+            for more commentary.
         */
         static void REMAPPRIVATEVIEW() {
             Timer t;
@@ -472,18 +586,172 @@ namespace mongo {
             stats.curr->_remapPrivateViewMicros += t.micros();
         }
 
-        // this is a pseudo-local variable in the groupcommit functions 
-        // below.  however we don't truly do that so that we don't have to 
-        // reallocate, and more importantly regrow it, on every single commit.
-        static AlignedBuilder __theBuilder(4 * 1024 * 1024);
+#if defined(_WIN32) || defined(__sunos__)
+        // Views can't be remapped atomically here, see _REMAPPRIVATEVIEW().
+        static const bool remapNeedsExclusiveLock = true;
+#else
+        static const bool remapNeedsExclusiveLock = false;
+#endif
+
+        // When the views were last remapped, as curTimeMicros64().
+        static unsigned long long lastRemapMicros = 0;
+
+        /** Remapping needs every commit in the data files first, which empties the pipeline, so it
+            is only done when there's nothing in flight anyway, when a lot has been written to the
+            private views, or about every second otherwise.  _REMAPPRIVATEVIEW() remaps more files
+            the longer it has been.
+        */
+        static bool remapDue() {
+            if (mmapv1GlobalOptions.journalOptions & MMAPV1Options::JournalAlwaysRemap)
+                return true;
+            if (!commitPipeline.hasUnapplied())
+                return true;
+            if (privateMapBytes >= UncommittedBytesLimit / 10)
+                return true;
+            return curTimeMicros64() - lastRemapMicros >= 1000 * 1000;
+        }
+
+        /** abort on any exception a commit stage throws, as the data files and the journal may
+            then not agree.  'what' names the stage in the log.
+        */
+        template <typename Stage>
+        static void runCommitStage(const char* what, Stage stage) {
+            try {
+                stage();
+            }
+            catch (DBException& e) {
+                log() << "dbexception in " << what << " causing immediate shutdown: "
+                      << e.toString() << endl;
+                mongoAbort(what);
+            }
+            catch (std::exception& e) {
+                log() << "exception in " << what << " causing immediate shutdown: "
+                      << e.what() << endl;
+                mongoAbort(what);
+            }
+        }
+
+        CommitPipeline::CommitPipeline() : _numSubmitted(0), _numWithBuffer(0) {
+            for (int i = 0; i < NumBuffers; i++) {
+                _freeBuffers.push_back(new AlignedBuilder(4 * 1024 * 1024)); // don't destroy
+            }
+        }
+
+        void CommitPipeline::start() {
+            boost::thread journalWriter(boost::bind(&CommitPipeline::journalWriterThread, this));
+            boost::thread dataFileWriter(boost::bind(&CommitPipeline::dataFileWriterThread, this));
+        }
+
+        AlignedBuilder* CommitPipeline::getFreeBuffer() {
+            boost::mutex::scoped_lock lk(_mutex);
+            while (_freeBuffers.empty()) {
+                _changed.wait(lk);
+            }
+
+            AlignedBuilder* buffer = _freeBuffers.front();
+            _freeBuffers.pop_front();
+            return buffer;
+        }
+
+        void CommitPipeline::submit(const JSectHeader& h,
+                                    AlignedBuilder* buffer,
+                                    NotifyAll::When commitNumber,
+                                    unsigned long long firstWaiterMicros) {
+            Commit commit;
+            commit.h = h;
+            commit.buffer = buffer;
+            commit.commitNumber = commitNumber;
+            commit.firstWaiterMicros = firstWaiterMicros;
+
+            boost::mutex::scoped_lock lk(_mutex);
+            _toJournal.push_back(commit);
+            _numSubmitted++;
+            if (buffer) {
+                _numWithBuffer++;
+            }
+            _changed.notify_all();
+        }
 
+        void CommitPipeline::waitUntilApplied() {
+            boost::mutex::scoped_lock lk(_mutex);
+            while (_numSubmitted > 0) {
+                _changed.wait(lk);
+            }
+        }
+
+        bool CommitPipeline::hasUnapplied() {
+            boost::mutex::scoped_lock lk(_mutex);
+            return _numWithBuffer > 0;
+        }
+
+        void CommitPipeline::journalWriterThread() {
+            Client::initThread("journalWriter");
+
+            while (true) {
+                Commit commit;
+                {
+                    boost::mutex::scoped_lock lk(_mutex);
+                    while (_toJournal.empty()) {
+                        _changed.wait(lk);
+                    }
+                    commit = _toJournal.front();
+                }
+
+                if (commit.buffer) {
+                    runCommitStage("journalWriter",
+                                   boost::bind(&WRITETOJOURNAL, commit.h, boost::ref(*commit.buffer)));
+                }
+
+                // data is now in the journal, which is sufficient for acknowledging getLastError.
+                // (ok to crash after that)
+                commitJob._notify.notifyAll(commit.commitNumber);
+                if (commit.firstWaiterMicros) {
+                    stats.curr->noteWaitLatency(curTimeMicros64() - commit.firstWaiterMicros);
+                }
+
+                boost::mutex::scoped_lock lk(_mutex);
+                _toJournal.pop_front();
+                if (commit.buffer) {
+                    _toApply.push_back(commit);
+                }
+                else {
+                    _numSubmitted--;
+                }
+                _changed.notify_all();
+            }
+        }
+
+        void CommitPipeline::dataFileWriterThread() {
+            Client::initThread("dataFileWriter");
+
+            while (true) {
+                Commit commit;
+                {
+                    boost::mutex::scoped_lock lk(_mutex);
+                    while (_toApply.empty()) {
+                        _changed.wait(lk);
+                    }
+                    commit = _toApply.front();
+                }
+
+                runCommitStage("dataFileWriter",
+                               boost::bind(&WRITETODATAFILES, boost::cref(commit.h),
+                                           boost::ref(*commit.buffer)));
+                commit.buffer->reset();
+
+                boost::mutex::scoped_lock lk(_mutex);
+                _toApply.pop_front();
+                _freeBuffers.push_back(commit.buffer);
+                _numSubmitted--;
+                _numWithBuffer--;
+                _changed.notify_all();
+            }
+        }
 
         static void _groupCommit() {
             LOG(4) << "_groupCommit " << endl;
 
             {
-                AlignedBuilder &ab = __theBuilder;
-
                 // we need to make sure two group commits aren't running at the same time
                 // (and we are only read locked in the dbMutex, so it could happen -- while 
                 // there is only one dur thread, "early commits" can be done by other threads)
@@ -491,28 +759,25 @@ namespace mongo {
 
                 commitJob.commitingBegin();
 
+                // The j:true waiters so far are all for this commit.
+                pendingWaiters.store(0);
+                const unsigned long long waitingSince = firstWaiterMicros.swap(0);
+
                 if( !commitJob.hasWritten() ) {
-                    // getlasterror request could have came after the data was already committed
-                    commitJob.committingNotifyCommitted();
+                    // getlasterror request could have came after the data was already committed,
+                    // but the commits before may not be journaled yet
+                    commitPipeline.submit(JSectHeader(), NULL, commitJob.commitNumber(),
+                                          waitingSince);
                 }
                 else {
+                    AlignedBuilder* ab = commitPipeline.getFreeBuffer();
                     JSectHeader h;
-                    PREPLOGBUFFER(h,ab);
-
-                    // todo : write to the journal outside locks, as this write can be slow.
-                    //        however, be careful then about remapprivateview as that cannot be done 
-                    //        if new writes are then pending in the private maps.
-                    WRITETOJOURNAL(h, ab);
-
-                    // data is now in the journal, which is sufficient for acknowledging getLastError.
-                    // (ok to crash after that)
-                    commitJob.committingNotifyCommitted();
-
-                    WRITETODATAFILES(h, ab);
-                    debugValidateAllMapsMatch();
+                    PREPLOGBUFFER(h, *ab);
 
+                    // The write intents are in the buffer now, so the writers can start again
+                    // once the flush lock is released.
                     commitJob.committingReset();
-                    ab.reset();
+                    commitPipeline.submit(h, ab, commitJob.commitNumber(), waitingSince);
                 }
             }
         }
@@ -555,8 +820,12 @@ namespace mongo {
                 // we wouldn't see newly written data on reads.
                 //
                 invariant(!commitJob.hasWritten());
+                invariant(!commitPipeline.hasUnapplied());
 
-                stats.curr->_commitsInWriteLock++;
+                lastRemapMicros = curTimeMicros64();
+                if (remapNeedsExclusiveLock) {
+                    stats.curr->_commitsInWriteLock++;
+                }
 
                 REMAPPRIVATEVIEW();
             }
@@ -596,7 +865,7 @@ namespace mongo {
             if (!storageGlobalParams.dur)
                 return;
 
-            if (commitJob.hasWritten()) {
+            if (commitJob.hasWritten() || commitPipeline.hasUnapplied()) {
                 if (inShutdown()) {
                     log() << "journal warning files are closing outside locks with writes pending"
                           << endl;
@@ -611,6 +880,45 @@ namespace mongo {
         extern int groupCommitIntervalMs;
         boost::filesystem::path getJournalDir();
 
+        /** waits until the next group commit is due: after the commit interval, when someone
+            forces a flush, when a lot has been written, when journalCommitWaitersThreshold
+            getLastError j:true waiters are pending, or when the first of them has waited for the
+            latency target.  So a few waiters get a commit soon, and many share one right away.
+        */
+        static void waitForCommitTrigger(boost::mutex::scoped_lock& lock, unsigned intervalMs) {
+            const unsigned long long targetMicros = 1000ULL *
+                (journalCommitLatencyTargetMs > 0 ? journalCommitLatencyTargetMs
+                                                  : (intervalMs / 3) + 1); // +1 so never zero
+            const unsigned long long intervalEnd = curTimeMicros64() + 1000ULL * intervalMs;
+
+            while (true) {
+                const unsigned long long now = curTimeMicros64();
+                if (now >= intervalEnd)
+                    return;
+                if (commitJob.bytes() > UncommittedBytesLimit / 10)
+                    return;
+
+                unsigned long long deadline = intervalEnd;
+                const unsigned waiters = pendingWaiters.load();
+                if (waiters) {
+                    if (waiters >= static_cast<unsigned>(journalCommitWaitersThreshold))
+                        return;
+                    const unsigned long long since = firstWaiterMicros.load();
+                    deadline = std::min(deadline, (since ? since : now) + targetMicros);
+                    if (now >= deadline)
+                        return;
+                }
+
+                // Wake up in time for the latency target of any waiter coming meanwhile.
+                const unsigned long long sleepMicros = std::min(deadline - now, targetMicros);
+                if (flushRequested.timed_wait(lock,
+                                              boost::posix_time::microseconds(sleepMicros))) {
+                    // Someone forced a flush, or enough waiters are pending
+                    return;
+                }
+            }
+        }
+
         static void durThread() {
             Client::initThread("journal");
 
@@ -630,26 +938,12 @@ namespace mongo {
                     ms = samePartition ? 100 : 30;
                 }
 
-                unsigned oneThird = (ms / 3) + 1; // +1 so never zero
-
                 try {
                     stats.rotate();
 
                     boost::mutex::scoped_lock lock(flushMutex);
 
-                    // commit sooner if one or more getLastError j:true is pending
-                    for (unsigned i = 0; i <= 2; i++) {
-                        if (flushRequested.timed_wait(lock,
-                                                      Milliseconds(oneThird))) {
-                            // Someone forced a flush
-                            break;
-                        }
-
-                        if (commitJob._notify.nWaiting())
-                            break;
-                        if (commitJob.bytes() > UncommittedBytesLimit / 10)
-                            break;
-                    }
+                    waitForCommitTrigger(lock, ms);
 
                     OperationContextImpl txn;
 
@@ -658,9 +952,22 @@ namespace mongo {
                     AutoAcquireFlushLockForMMAPV1Commit flushLock(txn.lockState());
                     groupCommit();
 
-                    // Causes everybody to stall so that the in-memory view can be remapped.
-                    flushLock.upgradeFlushLockToExclusive();
-                    remapPrivateView();
+                    // Otherwise the commit goes on to the journal and the data files while the
+                    // writers resume.
+                    if (remapDue()) {
+                        // A remap drops what is in the private views, so all of it must be in the
+                        // data files.
+                        commitPipeline.waitUntilApplied();
+                        debugValidateAllMapsMatch();
+
+                        // Where views can't be remapped atomically, causes everybody to stall so
+                        // that the in-memory view can be remapped.  Otherwise only the writers,
+                        // which the flush lock already holds off, must wait.
+                        if (remapNeedsExclusiveLock) {
+                            flushLock.upgradeFlushLockToExclusive();
+                        }
+                        remapPrivateView();
+                    }
                 }
                 catch(std::exception& e) {
                     log() << "exception in durThread causing immediate shutdown: " << e.what() << endl;
@@ -703,6 +1010,7 @@ namespace mongo {
             preallocateFiles();
 
             DurableInterface::enableDurability();
+            commitPipeline.start();
             boost::thread t(durThread);
         }
 
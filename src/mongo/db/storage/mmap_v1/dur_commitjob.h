@@ -153,11 +153,10 @@ namespace mongo {
         public:
             /** these called by the groupCommit code as it goes along */
             void commitingBegin();
-            /** the commit code calls this when data reaches the journal (on disk) */
-            void committingNotifyCommitted() { 
-                groupCommitMutex.dassertLocked();
-                _notify.notifyAll(_commitNumber); 
-            }
+            /** the number to notify _notify with once the commit begun last reaches the journal
+                (on disk)
+            */
+            NotifyAll::When commitNumber() const { return _commitNumber; }
             /** we use the commitjob object over and over, calling reset() rather than reconstructing */
             void committingReset() {
                 groupCommitMutex.dassertLocked();
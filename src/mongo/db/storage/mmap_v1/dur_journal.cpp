@@ -100,6 +100,14 @@ namespace mongo {
 
         bool usingPreallocate = false;
 
+        /** whether old journal files go back to the prealloc.<n> files to be reused, so that the
+            journal files are a ring of files on which writes change neither the size nor the
+            blocks allocated.  also without preallocation from the start, unless --nopreallocj.
+        */
+        static bool recyclingJournalFiles() {
+            return usingPreallocate || mmapv1GlobalOptions.preallocj;
+        }
+
         void removeOldJournalFile(boost::filesystem::path p);
 
         boost::filesystem::path getJournalDir() {
@@ -438,7 +446,7 @@ namespace mongo {
         }
 
         void removeOldJournalFile(boost::filesystem::path p) { 
-            if( usingPreallocate ) {
+            if( recyclingJournalFiles() ) {
                 try {
                     for( int i = 0; i < NUM_PREALLOC_FILES; i++ ) {
                         boost::filesystem::path filepath = preallocPath(i);
@@ -453,7 +461,10 @@ namespace mongo {
                                 char buf[8192];
                                 memset(buf, 0, 8192);
                                 f.write(0, buf, 8192);
-                                f.truncate(DataLimitPerJournalFile);
+                                // the rest is left as is, recovery stops at the first section
+                                // of another file.  only a short file is extended.
+                                if( f.len() < DataLimitPerJournalFile )
+                                    f.truncate(DataLimitPerJournalFile);
                                 f.fsync();
                             }
                             boost::filesystem::rename(temppath, filepath);
@@ -699,7 +710,9 @@ namespace mongo {
                 return;
 
             if( _curLogFile ) {
-                _curLogFile->truncate();
+                // a file to be reused keeps its size and blocks
+                if( !recyclingJournalFiles() )
+                    _curLogFile->truncate();
                 closeCurrentJournalFile();
                 removeUnneededJournalFiles();
             }
@@ -741,7 +754,14 @@ namespace mongo {
 
             {
                 dassert( h.sectionLen() == (unsigned) 0xffffffff ); // we will backfill later
-                b.appendStruct(h);
+
+                // the section may have been prepared before the previous one rotated the file
+                JSectHeader hdr = h;
+                {
+                    SimpleMutex::scoped_lock lk(_curLogFileMutex);
+                    hdr.fileId = _curFileId;
+                }
+                b.appendStruct(hdr);
             }
 
             size_t compressedLength = 0;
@@ -43,6 +43,7 @@
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/db.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/storage_engine.h"
 #include "mongo/db/storage/mmap_v1/catalog/namespace.h"
 #include "mongo/db/storage/mmap_v1/dur.h"
@@ -90,6 +91,20 @@ namespace mongo {
             shared_ptr<DurOp> op;
         };
 
+        /** the writes of a run of journal entries to one data file, in journal order */
+        struct FileWrites {
+            FileWrites(DurableMappedFile* m) : mmf(m), bytes(0) { }
+
+            DurableMappedFile* mmf;
+            std::vector<const JEntry*> writes;
+            unsigned long long bytes; // written, for the stats
+        };
+
+        // Threads to recover with.  With more than one, the next journal section is uncompressed
+        // while the current one is applied, and the writes to different data files of a section
+        // are applied in parallel.  1 recovers on the calling thread only.
+        MONGO_EXPORT_STARTUP_SERVER_PARAMETER(journalRecoveryThreads, int, 4);
+
         void removeJournalFiles();
         boost::filesystem::path getJournalDir();
 
@@ -216,6 +231,34 @@ namespace mongo {
 
         };
 
+        /** a journal section checked, uncompressed and parsed by prepareSection(), to apply */
+        struct PreparedSection : boost::noncopyable {
+            PreparedSection(const JSectHeader *h_, const void *p_, unsigned len_, const JSectFooter *f_)
+                : h(h_), p(p_), len(len_), f(f_),
+                  skip(false), corrupt(false), status(Status::OK()) { }
+
+            const JSectHeader *h;
+            const void *p;
+            unsigned len;
+            const JSectFooter *f;
+
+            boost::scoped_ptr<JournalSectionIterator> i; // owns the buffer the entries point into
+            std::vector<ParsedJournalEntry> entries;
+
+            bool skip;     // already in the data files
+            bool corrupt;  // recovery ends before this section
+            Status status; // any other error
+        };
+
+        static void readEntries(JournalSectionIterator& i, std::vector<ParsedJournalEntry>* entries) {
+            // first read all entries to make sure this section is valid
+            ParsedJournalEntry e;
+            while( !i.atEof() ) {
+                i.next(e);
+                entries->push_back(e);
+            }
+        }
+
         static string fileName(const char* dbName, int fileNo) {
             stringstream ss;
             ss << dbName << '.';
@@ -376,6 +419,11 @@ namespace mongo {
             if( dump )
                 log() << "BEGIN section" << endl;
 
+            if( apply && !dump && _recovering && _applyThreads ) {
+                applyEntriesInParallel(entries);
+                return;
+            }
+
             Last last;
             for( vector<ParsedJournalEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
                 applyEntry(last, *i, apply, dump);
@@ -385,10 +433,74 @@ namespace mongo {
                 log() << "END section" << endl;
         }
 
-        void RecoveryJob::processSection(const JSectHeader *h, const void *p, unsigned len, const JSectFooter *f) {
-            LockMongoFilesShared lkFiles; // for RecoveryJob::Last
-            scoped_lock lk(_mx);
+        static void applyWritesToFile(FileWrites* file) {
+            char* view = static_cast<char*>(file->mmf->view_write());
+            const unsigned long long length = file->mmf->length();
+            for( vector<const JEntry*>::const_iterator i = file->writes.begin();
+                 i != file->writes.end(); ++i ) {
+                const JEntry* e = *i;
+                // past the end only happens when recovering, see write()
+                if (e->ofs + e->len <= length) {
+                    memcpy(view + e->ofs, e->srcData(), e->len);
+                    file->bytes += e->len;
+                }
+            }
+        }
+
+        void RecoveryJob::applyFileWrites(vector<FileWrites>& files) {
+            if( files.size() == 1 ) {
+                applyWritesToFile(&files[0]);
+            }
+            else {
+                for( size_t i = 0; i < files.size(); i++ ) {
+                    _applyThreads->schedule(&applyWritesToFile, &files[i]);
+                }
+                _applyThreads->join();
+            }
+
+            for( size_t i = 0; i < files.size(); i++ ) {
+                stats.curr->_writeToDataFilesBytes += files[i].bytes;
+            }
+            files.clear();
+        }
+
+        /** Applies the same writes as the loop in applyEntries().  Writes to any one file are
+            applied in journal order, and none is applied across a DurOp, which may create, extend
+            or remove the files; only writes to different files happen at the same time.
+        */
+        void RecoveryJob::applyEntriesInParallel(const vector<ParsedJournalEntry> &entries) {
+            Last last;
+            vector<FileWrites> files;
+            map<DurableMappedFile*, size_t> fileIndex;
+
+            for( vector<ParsedJournalEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
+                if( i->e ) {
+                    verify(i->dbName);
+                    verify((size_t)strnlen(i->dbName, MaxDatabaseNameLen) < MaxDatabaseNameLen);
+                    verify(i->e->srcData());
+
+                    // files are opened here, on this thread, under _mx
+                    DurableMappedFile* mmf = last.newEntry(*i, *this);
+                    verify(mmf->view_write());
+
+                    map<DurableMappedFile*, size_t>::const_iterator it = fileIndex.find(mmf);
+                    if( it == fileIndex.end() ) {
+                        it = fileIndex.insert(make_pair(mmf, files.size())).first;
+                        files.push_back(FileWrites(mmf));
+                    }
+                    files[it->second].writes.push_back(i->e);
+                }
+                else if( i->op ) {
+                    applyFileWrites(files);
+                    fileIndex.clear();
+                    applyEntry(last, *i, true, false);
+                }
+            }
 
+            applyFileWrites(files);
+        }
+
+        bool RecoveryJob::checkSection(const JSectHeader *h, const void *p, unsigned len, const JSectFooter *f) {
             // Check the footer checksum before doing anything else.
             if (_recovering) {
                 verify( ((const char *)h) + sizeof(JSectHeader) == p );
@@ -409,8 +521,17 @@ namespace mongo {
                     }
                     _lastSeqMentionedInConsoleLog = h->seqNumber;
                 }
-                return;
+                return false;
             }
+            return true;
+        }
+
+        void RecoveryJob::processSection(const JSectHeader *h, const void *p, unsigned len, const JSectFooter *f) {
+            LockMongoFilesShared lkFiles; // for RecoveryJob::Last
+            scoped_lock lk(_mx);
+
+            if( !checkSection(h, p, len, f) )
+                return;
 
             auto_ptr<JournalSectionIterator> i;
             if( _recovering ) {
@@ -433,22 +554,54 @@ namespace mongo {
             }
 */
 
-            // first read all entries to make sure this section is valid
-            ParsedJournalEntry e;
-            while( !i->atEof() ) {
-                i->next(e);
-                entries.push_back(e);
-            }
+            readEntries(*i, &entries);
 
             // got all the entries for one group commit.  apply them:
             applyEntries(entries);
         }
 
+        /** the first half of processSection() when recovering, which touches no data file, so it
+            can run ahead of applySection().  Errors are left in 'section' for the caller.
+        */
+        void RecoveryJob::prepareSection(PreparedSection* section) {
+            try {
+                if( !checkSection(section->h, section->p, section->len, section->f) ) {
+                    section->skip = true;
+                    return;
+                }
+                section->i.reset(new JournalSectionIterator(*section->h, section->p, section->len, true));
+                readEntries(*section->i, &section->entries);
+            }
+            catch (const JournalSectionCorruptException&) {
+                section->corrupt = true;
+            }
+            catch (const BufReader::eof&) {
+                section->corrupt = true;
+            }
+            catch (const DBException& e) {
+                section->status = e.toStatus();
+            }
+            catch (const std::exception& e) {
+                section->status = Status(ErrorCodes::InternalError, e.what());
+            }
+        }
+
+        void RecoveryJob::applySection(const PreparedSection& section) {
+            if( section.skip )
+                return;
+
+            LockMongoFilesShared lkFiles; // for RecoveryJob::Last
+            scoped_lock lk(_mx);
+            applyEntries(section.entries);
+        }
+
         /** apply a specific journal file, that is already mmap'd
             @param p start of the memory mapped file
             @return true if this is detected to be the last file (ends abruptly)
         */
         bool RecoveryJob::processFileBuffer(const void *p, unsigned len) {
+            // the section prepared on _prepareThread and not applied yet
+            boost::scoped_ptr<PreparedSection> pending;
             try {
                 unsigned long long fileId;
                 BufReader br(p,len);
@@ -491,6 +644,8 @@ namespace mongo {
                             log() << "Ending processFileBuffer at differing fileId want:" << fileId << " got:" << h.fileId << endl;
                             log() << "  sect len:" << h.sectionLen() << " seqnum:" << h.seqNumber << endl;
                         }
+                        if( pending )
+                            applySection(*pending);
                         return true;
                     }
                     unsigned slen = h.sectionLen();
@@ -498,20 +653,52 @@ namespace mongo {
                     const char *hdr = (const char *) br.skip(h.sectionLenWithPadding());
                     const char *data = hdr + sizeof(JSectHeader);
                     const char *footer = data + dataLen;
-                    processSection((const JSectHeader*) hdr, data, dataLen, (const JSectFooter*) footer);
+
+                    if( !_prepareThread ) {
+                        processSection((const JSectHeader*) hdr, data, dataLen, (const JSectFooter*) footer);
+                    }
+                    else {
+                        // uncompress this section while applying the previous one
+                        boost::scoped_ptr<PreparedSection> next(
+                            new PreparedSection((const JSectHeader*) hdr, data, dataLen, (const JSectFooter*) footer));
+                        _prepareThread->schedule(&RecoveryJob::prepareSection, this, next.get());
+                        try {
+                            if( pending )
+                                applySection(*pending);
+                        }
+                        catch (...) {
+                            _prepareThread->join(); // it writes to next
+                            throw;
+                        }
+                        _prepareThread->join();
+
+                        pending.reset();
+                        if( next->corrupt )
+                            throw JournalSectionCorruptException();
+                        uassertStatusOK(next->status);
+                        pending.swap(next);
+                    }
 
                     // ctrl c check
                     uassert(ErrorCodes::Interrupted, "interrupted during journal recovery", !inShutdown());
                 }
+
+                if( pending )
+                    applySection(*pending);
             }
             catch (const BufReader::eof&) {
                 if (mmapv1GlobalOptions.journalOptions & MMAPV1Options::JournalDumpJournal)
                     log() << "ABRUPT END" << endl;
+                // a section cut short; those before it are whole
+                if( pending )
+                    applySection(*pending);
                 return true; // abrupt end
             }
             catch (const JournalSectionCorruptException&) {
                 if (mmapv1GlobalOptions.journalOptions & MMAPV1Options::JournalDumpJournal)
                     log() << "ABRUPT END" << endl;
+                if( pending )
+                    applySection(*pending);
                 return true; // abrupt end
             }
 
@@ -548,6 +735,11 @@ namespace mongo {
             _lastDataSyncedFromLastRun = journalReadLSN();
             log() << "recover lsn: " << _lastDataSyncedFromLastRun << endl;
 
+            if( journalRecoveryThreads > 1 ) {
+                _prepareThread.reset(new ThreadPool(1, "journalRecoveryPrepare"));
+                _applyThreads.reset(new ThreadPool(journalRecoveryThreads, "journalRecoveryApply"));
+            }
+
             for( unsigned i = 0; i != files.size(); ++i ) {
                 bool abruptEnd = processFile(files[i]);
                 if( abruptEnd && i+1 < files.size() ) {
@@ -558,6 +750,8 @@ namespace mongo {
             }
 
             close();
+            _prepareThread.reset();
+            _applyThreads.reset();
 
             if (mmapv1GlobalOptions.journalOptions & MMAPV1Options::JournalScanOnly) {
                 uasserted(13545, str::stream() << "--durOptions "
@@ -31,10 +31,12 @@
 #pragma once
 
 #include <boost/filesystem/operations.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <list>
 
 #include "mongo/db/storage/mmap_v1/dur_journalformat.h"
 #include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/file.h"
 
 namespace mongo {
@@ -42,6 +44,8 @@ namespace mongo {
 
     namespace dur {
         struct ParsedJournalEntry;
+        struct PreparedSection;
+        struct FileWrites;
 
         /** call go() to execute a recovery from existing journal files.
          */
@@ -71,6 +75,12 @@ namespace mongo {
             void write(Last& last, const ParsedJournalEntry& entry); // actually writes to the file
             void applyEntry(Last& last, const ParsedJournalEntry& entry, bool apply, bool dump);
             void applyEntries(const std::vector<ParsedJournalEntry> &entries);
+            void applyEntriesInParallel(const std::vector<ParsedJournalEntry> &entries);
+            void applyFileWrites(std::vector<FileWrites>& files);
+            /** @return false if the section is already in the data files. throws if corrupt. */
+            bool checkSection(const JSectHeader *h, const void *p, unsigned len, const JSectFooter *f);
+            void prepareSection(PreparedSection* section); // on the _prepareThread
+            void applySection(const PreparedSection& section);
             bool processFileBuffer(const void *, unsigned len);
             bool processFile(boost::filesystem::path journalfile);
             void _close(); // doesn't lock
@@ -85,6 +95,12 @@ namespace mongo {
         private:
             bool _recovering; // are we in recovery or WRITETODATAFILES
 
+            // While recovering with journalRecoveryThreads > 1: the next section is uncompressed
+            // and parsed on _prepareThread while the current one is applied, and the writes to
+            // different data files are applied in parallel on _applyThreads.
+            boost::scoped_ptr<ThreadPool> _prepareThread;
+            boost::scoped_ptr<ThreadPool> _applyThreads;
+
             static RecoveryJob &_instance;
         };
 
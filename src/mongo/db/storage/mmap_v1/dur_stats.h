@@ -63,6 +63,14 @@ namespace mongo {
                 // - data being written faster than the normal group commit interval
                 unsigned _commitsInWriteLock;
 
+                // how long the getLastError j:true waiters of a commit waited, from the first of
+                // them to the commit being in the journal.  _waitLatencyCounts[i] counts the
+                // commits which took less than 2^i ms, the last one those which took longer.
+                enum { NumWaitLatencyBuckets = 11 };
+                void noteWaitLatency(unsigned long long micros);
+                unsigned _commitsWithWaiters;
+                unsigned _waitLatencyCounts[NumWaitLatencyBuckets];
+
                 int _dtMillis;
             };
             S *curr;
@@ -118,6 +118,17 @@ namespace mongo {
          */
         virtual RecordFetcher* recordNeedsFetch( const DiskLoc& loc ) const = 0;
 
+        /**
+         * Asks the OS to start paging in the records at 'locs', without waiting for them.
+         */
+        virtual void prefetchRecords( const std::vector<DiskLoc>& locs ) const = 0;
+
+        /**
+         * Asks the OS to start paging in the 'len' bytes of file start.a() from start.getOfs(),
+         * without waiting for them.
+         */
+        virtual void prefetchRange( const DiskLoc& start, int len ) const = 0;
+
         /**
          * @param loc - has to be for a specific Record (not an Extent)
          * Note(erh) see comment on recordFor
@@ -44,6 +44,7 @@
 
 #include "mongo/db/mongod_options.h"
 #include "mongo/db/storage/mmap_v1/data_file_sync.h"
+#include "mongo/db/storage/mmap_v1/deleted_record_coalescer.h"
 #include "mongo/db/storage/mmap_v1/dur.h"
 #include "mongo/db/storage/mmap_v1/dur_commitjob.h"
 #include "mongo/db/storage/mmap_v1/dur_journal.h"
@@ -305,6 +306,8 @@ namespace {
         // Replays the journal (if needed) and starts the background thread. This requires the
         // ability to create OperationContexts.
         dur::startup();
+
+        deletedRecordCoalescer.go();
     }
 
     MMAPV1Engine::~MMAPV1Engine() {
@@ -45,10 +45,12 @@
 #include "mongo/db/storage/mmap_v1/mmap_v1_options.h"
 #include "mongo/db/storage/record_fetcher.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/file.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mmap.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -59,10 +61,36 @@ namespace mongo {
     static Counter64 needsFetchFailCounter;
     MONGO_FP_DECLARE(recordNeedsFetchFail);
 
+    // Whether recordNeedsFetch() asks the OS which pages are resident, through the
+    // RecordResidencyOracle, rather than trusting the RecordAccessTracker's guesses.
+    MONGO_EXPORT_SERVER_PARAMETER(mmapv1RecordResidencyOracle, bool, false);
+
     // Used to make sure the compiler doesn't get too smart on us when we're
     // trying to touch records.
     volatile int __record_touch_dummy = 1;
 
+    // A database which adds a file within this long of adding the previous one preallocates two
+    // files ahead instead of one, so that a burst of inserts doesn't outrun the FileAllocator.
+    static const long long kFastGrowthMillis = 60 * 1000;
+
+    /**
+     * Declares a write which is made durable on its own instead of with the WriteUnitOfWork, and
+     * so isn't rolled back with it, as DataFileHeader::init() does.  allocateExtent() undoes an
+     * allocation itself, see RollbackAllocation.
+     */
+    template <typename T>
+    static T* writingDirect(T* x) {
+        MemoryMappedFile::makeWritable(x, sizeof(T));
+        return static_cast<T*>(getDur().writingPtr(x, sizeof(T)));
+    }
+
+    template <typename T>
+    T* MmapV1ExtentManager::_allocationWriting(OperationContext* txn, T* x) const {
+        if ( _allocationRollsBack )
+            return txn->recoveryUnit()->writing(x);
+        return writingDirect(x);
+    }
+
     class MmapV1RecordFetcher : public RecordFetcher {
         MONGO_DISALLOW_COPYING(MmapV1RecordFetcher);
     public:
@@ -101,7 +129,10 @@ namespace mongo {
         : _dbname(dbname.toString()),
           _path(path.toString()),
           _directoryPerDB(directoryPerDB),
-          _rid(RESOURCE_MMAPv1_EXTENT_MANAGER, dbname) {
+          _rid(RESOURCE_MMAPv1_EXTENT_MANAGER, dbname),
+          _allocationMutex("MmapV1ExtentManager::allocation"),
+          _allocationRollsBack(true),
+          _lastFileAddedMillis(0) {
     }
 
     boost::filesystem::path MmapV1ExtentManager::fileName( int n ) const {
@@ -221,12 +252,20 @@ namespace mongo {
             _files.push_back(allocFile.release());
         }
 
+        const long long now = curTimeMillis64();
+        const bool growingFast = _lastFileAddedMillis != 0
+                              && now - _lastFileAddedMillis < kFastGrowthMillis;
+        _lastFileAddedMillis = now;
+
         // Preallocate is asynchronous
         if (preallocateNextFile) {
-            auto_ptr<DataFile> nextFile(new DataFile(allocFileId + 1));
-            const string nextFileName = fileName(allocFileId + 1).string();
+            const int ahead = growingFast ? 2 : 1;
+            for (int i = 1; i <= ahead && allocFileId + i < DiskLoc::MaxFiles; i++) {
+                auto_ptr<DataFile> nextFile(new DataFile(allocFileId + i));
+                const string nextFileName = fileName(allocFileId + i).string();
 
-            nextFile->open(txn, nextFileName.c_str(), minSize, false);
+                nextFile->open(txn, nextFileName.c_str(), minSize, true);
+            }
         }
 
         // Returns the last file added
@@ -274,6 +313,15 @@ namespace mongo {
             }
         }
 
+        if ( mmapv1RecordResidencyOracle && RecordResidencyOracle::supported() ) {
+            // The whole data file is mapped, so the oracle may sample any of its pages.
+            const DataFile* df = _getOpenFile( loc.a() );
+            if ( !_recordResidencyOracle.isResident( record, df->p(), df->p() + df->length() ) ) {
+                return new MmapV1RecordFetcher( record );
+            }
+            return NULL;
+        }
+
         if ( !_recordAccessTracker.checkAccessedAndMark( record ) ) {
             return new MmapV1RecordFetcher( record );
         }
@@ -281,6 +329,32 @@ namespace mongo {
         return NULL;
     }
 
+    void MmapV1ExtentManager::prefetchRecords( const std::vector<DiskLoc>& locs ) const {
+        const char* lastPage = NULL;
+        for ( size_t i = 0; i < locs.size(); i++ ) {
+            Record* record = _recordForV1( locs[i] );
+
+            // The records aren't marked as accessed, so that recordNeedsFetch() still yields
+            // for any which haven't arrived by the time they're read.
+            //
+            // Only the page holding the record header is advised: reading the record's length
+            // would fault the page in right here.  Read-ahead brings in the rest.
+            const char* page = reinterpret_cast<const char*>( record )
+                - reinterpret_cast<size_t>( record ) % g_minOSPageSizeBytes;
+            if ( page == lastPage )
+                continue;
+            lastPage = page;
+
+            adviseWillNeed( record, Record::HeaderSize );
+        }
+    }
+
+    void MmapV1ExtentManager::prefetchRange( const DiskLoc& start, int len ) const {
+        start.assertOk();
+        const DataFile* df = _getOpenFile( start.a() );
+        adviseWillNeed( df->p() + start.getOfs(), len );
+    }
+
     DiskLoc MmapV1ExtentManager::extentLocForV1( const DiskLoc& loc ) const {
         Record* record = recordForV1( loc );
         return DiskLoc( loc.a(), record->extentOfs() );
@@ -332,15 +406,15 @@ namespace mongo {
 
         massert( 10358, "bad new extent size", size >= minSize() && size <= maxSize() );
 
-        DiskLoc loc = f->allocExtentArea( txn, size );
+        DiskLoc loc = f->allocExtentArea( txn, size, _allocationRollsBack );
         loc.assertOk();
 
         Extent *e = getExtent( loc, false );
         verify( e );
 
-        *txn->recoveryUnit()->writing(&e->magic) = Extent::extentSignature;
-        *txn->recoveryUnit()->writing(&e->myLoc) = loc;
-        *txn->recoveryUnit()->writing(&e->length) = size;
+        *_allocationWriting(txn, &e->magic) = Extent::extentSignature;
+        *_allocationWriting(txn, &e->myLoc) = loc;
+        *_allocationWriting(txn, &e->length) = size;
 
         return loc;
     }
@@ -370,7 +444,7 @@ namespace mongo {
         // no space in an existing file
         // allocate files until we either get one big enough or hit maxSize
         for ( int i = 0; i < 8; i++ ) {
-            DataFile* f = _addAFile( txn, size, false );
+            DataFile* f = _addAFile( txn, size, true );
 
             if ( f->getHeader()->unusedLength >= size ) {
                 return _createExtentInFile( txn, numFiles() - 1, f, size, enforceQuota );
@@ -456,32 +530,82 @@ namespace mongo {
 
         // remove from the free list
         if ( !best->xprev.isNull() )
-            *txn->recoveryUnit()->writing(&getExtent( best->xprev )->xnext) = best->xnext;
+            *_allocationWriting(txn, &getExtent( best->xprev )->xnext) = best->xnext;
         if ( !best->xnext.isNull() )
-            *txn->recoveryUnit()->writing(&getExtent( best->xnext )->xprev) = best->xprev;
+            *_allocationWriting(txn, &getExtent( best->xnext )->xprev) = best->xprev;
         if ( _getFreeListStart() == best->myLoc )
-            _setFreeListStart( txn, best->xnext );
+            *_allocationWriting(txn, &_files[0]->header()->freeListStart) = best->xnext;
         if ( _getFreeListEnd() == best->myLoc )
-            _setFreeListEnd( txn, best->xprev );
+            *_allocationWriting(txn, &_files[0]->header()->freeListEnd) = best->xprev;
 
         return best->myLoc;
     }
 
+    /**
+     * Puts an extent allocated in a WriteUnitOfWork which rolls back on the free list, rather
+     * than restoring the free list and data file header bytes, which other allocations may have
+     * changed since.  The WriteUnitOfWork's own writes to the extent are rolled back first.
+     */
+    class MmapV1ExtentManager::RollbackAllocation : public RecoveryUnit::Change {
+    public:
+        RollbackAllocation(MmapV1ExtentManager* em, const DiskLoc& loc) : _em(em), _loc(loc) { }
+
+        virtual void commit() { }
+
+        virtual void rollback() {
+            SimpleMutex::scoped_lock lk(_em->_allocationMutex);
+
+            Extent* e = _em->getExtent( _loc );
+            *writingDirect(&e->xprev) = DiskLoc();
+            *writingDirect(&e->firstRecord) = DiskLoc();
+            *writingDirect(&e->lastRecord) = DiskLoc();
+
+            DataFileHeader* header = _em->_files[0]->header();
+            const DiskLoc first = _em->_getFreeListStart();
+            *writingDirect(&e->xnext) = first;
+            if ( first.isNull() )
+                *writingDirect(&header->freeListEnd) = _loc;
+            else
+                *writingDirect(&_em->getExtent( first )->xprev) = _loc;
+            *writingDirect(&header->freeListStart) = _loc;
+        }
+
+    private:
+        MmapV1ExtentManager* const _em;
+        const DiskLoc _loc;
+    };
+
     DiskLoc MmapV1ExtentManager::allocateExtent(OperationContext* txn,
                                                 bool capped,
                                                 int size,
                                                 bool enforceQuota) {
-        Lock::ResourceLock rlk(txn->lockState(), _rid, MODE_X);
+        // Only an intent lock, for as long as the WriteUnitOfWork, so that the collections of a
+        // database can get extents at the same time.  It keeps out the frees, which are rolled
+        // back byte for byte and so need the free list to themselves.  A WriteUnitOfWork which
+        // has freed extents already holds MODE_X, and allocates as before, rolling back every
+        // write in order.
+        const bool exclusive = txn->lockState()->isLockHeldForMode(_rid, MODE_X);
+        Lock::ResourceLock rlk(txn->lockState(), _rid, exclusive ? MODE_X : MODE_IX);
+
         bool fromFreeList = true;
-        DiskLoc eloc = _allocFromFreeList( txn, size, capped );
-        if ( eloc.isNull() ) {
-            fromFreeList = false;
-            eloc = _createExtent( txn, size, enforceQuota );
+        DiskLoc eloc;
+        {
+            SimpleMutex::scoped_lock lk(_allocationMutex);
+            _allocationRollsBack = exclusive;
+            eloc = _allocFromFreeList( txn, size, capped );
+            if ( eloc.isNull() ) {
+                fromFreeList = false;
+                eloc = _createExtent( txn, size, enforceQuota );
+            }
         }
 
         invariant( !eloc.isNull() );
         invariant( eloc.isValid() );
 
+        if ( !exclusive ) {
+            txn->recoveryUnit()->registerChange(new RollbackAllocation(this, eloc));
+        }
+
         LOG(1) << "MmapV1ExtentManager::allocateExtent"
                << " desiredSize:" << size
                << " fromFreeList: " << fromFreeList
@@ -41,6 +41,7 @@
 #include "mongo/db/diskloc.h"
 #include "mongo/db/storage/mmap_v1/extent_manager.h"
 #include "mongo/db/storage/mmap_v1/record_access_tracker.h"
+#include "mongo/db/storage/mmap_v1/record_residency_oracle.h"
 #include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
@@ -71,6 +72,9 @@ namespace mongo {
      *    RESOURCE_MMAPv1_EXTENT_MANAGER resource from the lock-manager, which will extend life
      *    to during WriteUnitOfWorks that might need rollback. Private methods will only
      *    be called from public ones.
+     *  - The exception is allocateExtent(), which takes MODE_IX so that several collections can
+     *    allocate at once, and _allocationMutex only while it allocates.  Its writes don't wait
+     *    for the WriteUnitOfWork, which frees the extent again if it rolls back.
      */
     class MmapV1ExtentManager : public ExtentManager {
         MONGO_DISALLOW_COPYING( MmapV1ExtentManager );
@@ -126,6 +130,10 @@ namespace mongo {
 
         RecordFetcher* recordNeedsFetch( const DiskLoc& loc ) const;
 
+        void prefetchRecords( const std::vector<DiskLoc>& locs ) const;
+
+        void prefetchRange( const DiskLoc& start, int len ) const;
+
         /**
          * @param loc - has to be for a specific Record (not an Extent)
          * Note(erh) see comment on recordFor
@@ -167,6 +175,12 @@ namespace mongo {
 
         DataFile* _addAFile( OperationContext* txn, int sizeNeeded, bool preallocateNextFile );
 
+        class RollbackAllocation;
+
+        /** declares a write of the allocation in progress, see _allocationRollsBack */
+        template <typename T>
+        T* _allocationWriting( OperationContext* txn, T* x ) const;
+
 
         /**
          * Shared record retrieval logic used by the public recordForV1() and likelyInPhysicalMem()
@@ -197,6 +211,7 @@ namespace mongo {
         const bool _directoryPerDB;
         const ResourceId _rid;
         mutable RecordAccessTracker _recordAccessTracker;
+        mutable RecordResidencyOracle _recordResidencyOracle;
 
         /**
          * Simple wrapper around an array object to allow append-only modification of the array,
@@ -241,5 +256,15 @@ namespace mongo {
         };
 
         FilesArray _files;
+
+        // serializes the allocations, which only hold RESOURCE_MMAPv1_EXTENT_MANAGER in MODE_IX
+        SimpleMutex _allocationMutex;
+
+        // whether the writes of the allocation in progress are rolled back with its
+        // WriteUnitOfWork, which is when it holds RESOURCE_MMAPv1_EXTENT_MANAGER in MODE_X
+        bool _allocationRollsBack;
+
+        // when _addAFile last added a file, used to guess how fast the database grows
+        long long _lastFileAddedMillis;
     };
 }
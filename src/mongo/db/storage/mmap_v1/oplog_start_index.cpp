@@ -0,0 +1,137 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/oplog_start_index.h"
+
+#include "mongo/base/status_with.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/oplog_hack.h"
+#include "mongo/db/storage/recovery_unit.h"
+
+namespace mongo {
+
+    const int OplogStartIndex::kDefaultBytesBetweenEntries = 1024 * 1024;
+
+    /**
+     * Removes the entry of an insert that rolls back.
+     */
+    class OplogStartIndex::InsertChange : public RecoveryUnit::Change {
+    public:
+        InsertChange(OplogStartIndex* index, const DiskLoc& key, const DiskLoc& loc)
+            : _index(index), _key(key), _loc(loc) {
+        }
+
+        virtual void commit() {}
+
+        virtual void rollback() {
+            _index->_remove(_key, _loc);
+        }
+
+    private:
+        OplogStartIndex* const _index;
+        const DiskLoc _key;
+        const DiskLoc _loc;
+    };
+
+    OplogStartIndex::OplogStartIndex(int bytesBetweenEntries)
+        : _bytesBetweenEntries(bytesBetweenEntries),
+          _mutex("OplogStartIndex"),
+          _bytesSinceLastEntry(0) {
+    }
+
+    void OplogStartIndex::noteInsert(OperationContext* txn,
+                                     const DiskLoc& loc,
+                                     const char* data,
+                                     int len) {
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+            _bytesSinceLastEntry += len;
+            if (!_entries.empty() && _bytesSinceLastEntry < _bytesBetweenEntries) {
+                return;
+            }
+        }
+
+        const StatusWith<DiskLoc> key = oploghack::extractKey(data, len);
+        if (!key.isOK()) {
+            return;
+        }
+
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+            _entries[key.getValue()] = loc;
+            _bytesSinceLastEntry = 0;
+        }
+        txn->recoveryUnit()->registerChange(new InsertChange(this, key.getValue(), loc));
+    }
+
+    void OplogStartIndex::noteDelete(const DiskLoc& loc, const char* data, int len) {
+        {
+            SimpleMutex::scoped_lock lk(_mutex);
+            if (_entries.empty()) {
+                return;
+            }
+        }
+
+        const StatusWith<DiskLoc> key = oploghack::extractKey(data, len);
+        if (key.isOK()) {
+            _remove(key.getValue(), loc);
+        }
+    }
+
+    void OplogStartIndex::clear() {
+        SimpleMutex::scoped_lock lk(_mutex);
+        _entries.clear();
+        _bytesSinceLastEntry = 0;
+    }
+
+    DiskLoc OplogStartIndex::findStart(const DiskLoc& startingPosition) const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        Entries::const_iterator it = _entries.upper_bound(startingPosition);
+        if (it == _entries.begin()) {
+            return DiskLoc().setInvalid();
+        }
+        --it;
+        return it->second;
+    }
+
+    size_t OplogStartIndex::numEntries() const {
+        SimpleMutex::scoped_lock lk(_mutex);
+        return _entries.size();
+    }
+
+    void OplogStartIndex::_remove(const DiskLoc& key, const DiskLoc& loc) {
+        SimpleMutex::scoped_lock lk(_mutex);
+        Entries::iterator it = _entries.find(key);
+        if (it != _entries.end() && it->second == loc) {
+            _entries.erase(it);
+        }
+    }
+
+}
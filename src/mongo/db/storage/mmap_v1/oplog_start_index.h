@@ -0,0 +1,96 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <map>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    class OperationContext;
+
+    /**
+     * A sparse in-memory index of an oplog, from the ts of one entry every few bytes of inserts
+     * to its DiskLoc. It lets a reader find where to start scanning for a ts in O(log n) instead
+     * of hopping over the extents of the oplog.
+     *
+     * Only entries inserted since the index was created are known, so lookups of older ts fall
+     * back to the caller's own search.
+     */
+    class OplogStartIndex {
+        MONGO_DISALLOW_COPYING(OplogStartIndex);
+    public:
+        static const int kDefaultBytesBetweenEntries;
+
+        explicit OplogStartIndex(int bytesBetweenEntries = kDefaultBytesBetweenEntries);
+
+        /**
+         * Called after the oplog entry 'data' was inserted at 'loc'. If the index takes an entry
+         * for it, the entry is removed again if the unit of work of 'txn' rolls back.
+         */
+        void noteInsert(OperationContext* txn, const DiskLoc& loc, const char* data, int len);
+
+        /**
+         * Called before the oplog entry 'data' at 'loc' is deleted.
+         */
+        void noteDelete(const DiskLoc& loc, const char* data, int len);
+
+        /**
+         * Called when the oplog is emptied.
+         */
+        void clear();
+
+        /**
+         * Returns the DiskLoc of an indexed entry whose ts key is the closest one not higher than
+         * 'startingPosition', which was made with oploghack::keyForOptime. Returns an invalid
+         * DiskLoc if every indexed entry is newer, or nothing is indexed.
+         */
+        DiskLoc findStart(const DiskLoc& startingPosition) const;
+
+        size_t numEntries() const;
+
+    private:
+        class InsertChange;
+
+        // From the oploghack key of the ts of an entry to its DiskLoc
+        typedef std::map<DiskLoc, DiskLoc> Entries;
+
+        void _remove(const DiskLoc& key, const DiskLoc& loc);
+
+        const int _bytesBetweenEntries;
+
+        mutable SimpleMutex _mutex;
+        Entries _entries;
+        long long _bytesSinceLastEntry;
+    };
+
+}
@@ -0,0 +1,105 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/oplog_start_index.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/operation_context_noop.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+    BSONObj oplogEntry(unsigned secs) {
+        return BSON("ts" << OpTime(secs, 0) << "op" << "n");
+    }
+
+    TEST(OplogStartIndex, Empty) {
+        OplogStartIndex index;
+        ASSERT_FALSE(index.findStart(DiskLoc(10, 0)).isValid());
+    }
+
+    TEST(OplogStartIndex, IndexesEntriesApart) {
+        OperationContextNoop txn;
+        const BSONObj sample = oplogEntry(1);
+        // One entry every three inserts
+        OplogStartIndex index(3 * sample.objsize());
+
+        for (unsigned i = 1; i <= 9; i++) {
+            const BSONObj entry = oplogEntry(i);
+            index.noteInsert(&txn, DiskLoc(0, i * 100), entry.objdata(), entry.objsize());
+        }
+        ASSERT_EQUALS(3U, index.numEntries());
+
+        // Entries 1, 4 and 7 are indexed
+        ASSERT_EQUALS(DiskLoc(0, 100), index.findStart(DiskLoc(1, 0)));
+        ASSERT_EQUALS(DiskLoc(0, 100), index.findStart(DiskLoc(3, 0)));
+        ASSERT_EQUALS(DiskLoc(0, 400), index.findStart(DiskLoc(4, 0)));
+        ASSERT_EQUALS(DiskLoc(0, 700), index.findStart(DiskLoc(9, 5)));
+        ASSERT_FALSE(index.findStart(DiskLoc(0, 5)).isValid());
+    }
+
+    TEST(OplogStartIndex, Delete) {
+        OperationContextNoop txn;
+        OplogStartIndex index(1);
+
+        for (unsigned i = 1; i <= 3; i++) {
+            const BSONObj entry = oplogEntry(i);
+            index.noteInsert(&txn, DiskLoc(0, i * 100), entry.objdata(), entry.objsize());
+        }
+        ASSERT_EQUALS(3U, index.numEntries());
+
+        // Capped deletion of the oldest entry
+        const BSONObj oldest = oplogEntry(1);
+        index.noteDelete(DiskLoc(0, 100), oldest.objdata(), oldest.objsize());
+        ASSERT_EQUALS(2U, index.numEntries());
+        ASSERT_FALSE(index.findStart(DiskLoc(1, 0)).isValid());
+        ASSERT_EQUALS(DiskLoc(0, 200), index.findStart(DiskLoc(2, 0)));
+
+        // A record with the same ts at another DiskLoc is not indexed
+        const BSONObj newest = oplogEntry(3);
+        index.noteDelete(DiskLoc(0, 999), newest.objdata(), newest.objsize());
+        ASSERT_EQUALS(2U, index.numEntries());
+
+        index.clear();
+        ASSERT_EQUALS(0U, index.numEntries());
+        ASSERT_FALSE(index.findStart(DiskLoc(3, 0)).isValid());
+    }
+
+    TEST(OplogStartIndex, IgnoresEntriesWithoutTs) {
+        OperationContextNoop txn;
+        OplogStartIndex index(1);
+        const BSONObj entry = BSON("op" << "n");
+        index.noteInsert(&txn, DiskLoc(0, 100), entry.objdata(), entry.objsize());
+        ASSERT_EQUALS(0U, index.numEntries());
+    }
+
+} // namespace
+} // namespace mongo
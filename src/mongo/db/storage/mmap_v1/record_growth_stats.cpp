@@ -0,0 +1,146 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/record_growth_stats.h"
+
+#include <algorithm>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+namespace {
+
+    // Records are at most doubled, however much the moved ones grew
+    const double kMaxPaddingFraction = 1.0;
+
+    // The padding of moved records covers this share of the moves
+    const int kMovePercentile = 75;
+
+    // Inserts are padded once this share of them moved, by the median growth
+    const int kInsertsMovedPercent = 25;
+    const int kInsertPercentile = 50;
+
+} // namespace
+
+    RecordGrowthStats::RecordGrowthStats()
+        : _numInserts(0),
+          _numMoves(0),
+          _bytesMoved(0),
+          _recentInserts(0),
+          _movesInHistogram(0) {
+        for (int i = 0; i < NumGrowthBuckets; ++i) {
+            _growthHistogram[i].store(0);
+        }
+    }
+
+    void RecordGrowthStats::recordInsert() {
+        _numInserts.fetchAndAdd(1);
+        _recentInserts.fetchAndAdd(1);
+    }
+
+    void RecordGrowthStats::recordMove(int oldLength, int newLength) {
+        _numMoves.fetchAndAdd(1);
+        _bytesMoved.fetchAndAdd(newLength);
+
+        const long long growth = std::max(0, newLength - oldLength);
+        const long long base = std::max(1, oldLength);
+        int bucket = 0;
+        while (bucket < NumGrowthBuckets - 1 && growth * 8 > (base << bucket)) {
+            ++bucket;
+        }
+        _growthHistogram[bucket].fetchAndAdd(1);
+
+        if (_movesInHistogram.addAndFetch(1) < MaxMovesInHistogram) {
+            return;
+        }
+
+        long long movesInHistogram = 0;
+        for (int i = 0; i < NumGrowthBuckets; ++i) {
+            const long long halved = _growthHistogram[i].load() / 2;
+            _growthHistogram[i].store(halved);
+            movesInHistogram += halved;
+        }
+        _movesInHistogram.store(movesInHistogram);
+        _recentInserts.store(_recentInserts.load() / 2);
+    }
+
+    double RecordGrowthStats::_growthPercentile(int percent) const {
+        const long long target = (_movesInHistogram.load() * percent + 99) / 100;
+        long long moves = 0;
+        for (int i = 0; i < NumGrowthBuckets - 1; ++i) {
+            moves += _growthHistogram[i].load();
+            if (moves >= target) {
+                return double(1 << i) / 8;
+            }
+        }
+        return double(1 << (NumGrowthBuckets - 1)) / 8;
+    }
+
+    double RecordGrowthStats::paddingFraction(bool moving) const {
+        const long long moves = _movesInHistogram.load();
+        if (moves < MinMovesForPadding) {
+            return 0;
+        }
+
+        if (moving) {
+            return std::min(kMaxPaddingFraction, _growthPercentile(kMovePercentile));
+        }
+
+        if (moves * 100 < _recentInserts.load() * kInsertsMovedPercent) {
+            return 0;
+        }
+        return std::min(kMaxPaddingFraction, _growthPercentile(kInsertPercentile));
+    }
+
+    int RecordGrowthStats::paddedLength(int length, int maxLength, bool moving) const {
+        const double fraction = paddingFraction(moving);
+        if (fraction == 0) {
+            return length;
+        }
+
+        const long long padded = length + static_cast<long long>(length * fraction);
+        return static_cast<int>(std::max<long long>(length, std::min<long long>(padded,
+                                                                                maxLength)));
+    }
+
+    void RecordGrowthStats::appendStats(BSONObjBuilder* builder, double scale) const {
+        const long long numMoves = _numMoves.load();
+        const long long bytesMoved = _bytesMoved.load();
+
+        builder->appendNumber("inserts", _numInserts.load());
+        builder->appendNumber("moves", numMoves);
+        builder->appendNumber("bytesMoved", static_cast<long long>(bytesMoved / scale));
+        builder->appendNumber("avgBytesPerMove", numMoves ? bytesMoved / numMoves : 0);
+        builder->append("insertPadding", paddingFraction(false));
+        builder->append("movePadding", paddingFraction(true));
+    }
+
+} // namespace mongo
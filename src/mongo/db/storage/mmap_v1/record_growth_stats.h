@@ -0,0 +1,108 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Statistics of how the records of one MMAP v1 collection grow, from which the sizes of their
+     * allocations are padded.  A record which outgrows its allocation is moved, which costs a
+     * delete, an insert and an update to each index, so the records of a collection where they
+     * move often are given room to grow by as much as the moved ones grew.
+     *
+     * The growth of each move, relative to the record's old allocation, is counted in a histogram of
+     * power of 2 fractions.  Moved records are padded by the growth which covers most moves, and
+     * inserts by the median growth, once enough of the inserted records moved.  The histogram is
+     * halved now and then, so that it follows the workload.
+     *
+     * The statistics are kept in memory only.  The caller serializes the writes, as the
+     * collection lock does for MMAP v1; reads may be concurrent.
+     */
+    class RecordGrowthStats {
+        MONGO_DISALLOW_COPYING(RecordGrowthStats);
+    public:
+        RecordGrowthStats();
+
+        enum Constants {
+            // Bucket i counts the moves which grew by up to 2^i / 8 of the old size, the last
+            // one those which grew by more.
+            NumGrowthBuckets = 8,
+            // No padding until this many moves were seen
+            MinMovesForPadding = 16,
+            // The histogram is halved when it holds this many moves
+            MaxMovesInHistogram = 1 << 16
+        };
+
+        void recordInsert();
+
+        /**
+         * Records that a record moved, as it grew to 'newLength' bytes, and its allocation only
+         * had room for 'oldLength'.
+         */
+        void recordMove(int oldLength, int newLength);
+
+        /**
+         * Returns how much to allocate for a record of 'length' bytes, at least 'length', and no
+         * more than 'maxLength'.  'moving' is for the new location of a moved record.
+         */
+        int paddedLength(int length, int maxLength, bool moving) const;
+
+        /**
+         * Returns the padding given to the records allocated by paddedLength(), as a fraction
+         * of their size.
+         */
+        double paddingFraction(bool moving) const;
+
+        long long numMoves() const { return _numMoves.load(); }
+        long long bytesMoved() const { return _bytesMoved.load(); }
+
+        void appendStats(BSONObjBuilder* builder, double scale) const;
+
+    private:
+        /**
+         * Returns the fraction of growth covering 'percent' of the moves in the histogram.
+         */
+        double _growthPercentile(int percent) const;
+
+        AtomicInt64 _numInserts;
+        AtomicInt64 _numMoves;
+        AtomicInt64 _bytesMoved;
+
+        // Since the last halving
+        AtomicInt64 _recentInserts;
+        AtomicInt64 _growthHistogram[NumGrowthBuckets];
+        AtomicInt64 _movesInHistogram;
+    };
+
+} // namespace mongo
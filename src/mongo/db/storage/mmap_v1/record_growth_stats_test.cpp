@@ -0,0 +1,147 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/record_growth_stats.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    const int kMaxLength = 16 * 1024 * 1024;
+
+    TEST(RecordGrowthStats, NoPaddingWithoutMoves) {
+        RecordGrowthStats stats;
+        for (int i = 0; i < 1000; ++i) {
+            stats.recordInsert();
+        }
+        ASSERT_EQUALS(0, stats.paddingFraction(false));
+        ASSERT_EQUALS(0, stats.paddingFraction(true));
+        ASSERT_EQUALS(1000, stats.paddedLength(1000, kMaxLength, false));
+        ASSERT_EQUALS(1000, stats.paddedLength(1000, kMaxLength, true));
+    }
+
+    TEST(RecordGrowthStats, NoPaddingFromFewMoves) {
+        RecordGrowthStats stats;
+        for (int i = 0; i < RecordGrowthStats::MinMovesForPadding - 1; ++i) {
+            stats.recordInsert();
+            stats.recordMove(1000, 2000);
+        }
+        ASSERT_EQUALS(0, stats.paddingFraction(true));
+        ASSERT_EQUALS(RecordGrowthStats::MinMovesForPadding - 1, stats.numMoves());
+        ASSERT_EQUALS(2000 * (RecordGrowthStats::MinMovesForPadding - 1), stats.bytesMoved());
+    }
+
+    TEST(RecordGrowthStats, MovesArePaddedByTheirGrowth) {
+        RecordGrowthStats stats;
+        // Records growing by 10% or less, rounded up to an eighth
+        for (int i = 0; i < 100; ++i) {
+            stats.recordMove(1000, 1100);
+        }
+        ASSERT_EQUALS(0.125, stats.paddingFraction(true));
+        ASSERT_EQUALS(1125, stats.paddedLength(1000, kMaxLength, true));
+    }
+
+    TEST(RecordGrowthStats, MovesCoverMostGrowth) {
+        RecordGrowthStats stats;
+        for (int i = 0; i < 70; ++i) {
+            stats.recordMove(1000, 1100);
+        }
+        for (int i = 0; i < 30; ++i) {
+            stats.recordMove(1000, 1400);
+        }
+        ASSERT_EQUALS(0.5, stats.paddingFraction(true));
+    }
+
+    TEST(RecordGrowthStats, PaddingIsCapped) {
+        RecordGrowthStats stats;
+        for (int i = 0; i < 100; ++i) {
+            stats.recordMove(100, 10000);
+        }
+        ASSERT_EQUALS(1.0, stats.paddingFraction(true));
+        ASSERT_EQUALS(2000, stats.paddedLength(1000, kMaxLength, true));
+        ASSERT_EQUALS(1500, stats.paddedLength(1000, 1500, true));
+        ASSERT_EQUALS(1000, stats.paddedLength(1000, 1000, true));
+    }
+
+    TEST(RecordGrowthStats, InsertsArePaddedWhenManyMove) {
+        RecordGrowthStats stats;
+        for (int i = 0; i < 1000; ++i) {
+            stats.recordInsert();
+        }
+        for (int i = 0; i < 100; ++i) {
+            stats.recordMove(1000, 1200);
+        }
+        // 10% of the inserts moved
+        ASSERT_EQUALS(0, stats.paddingFraction(false));
+        ASSERT_EQUALS(0.25, stats.paddingFraction(true));
+
+        for (int i = 0; i < 200; ++i) {
+            stats.recordMove(1000, 1200);
+        }
+        // 30% of the inserts moved
+        ASSERT_EQUALS(0.25, stats.paddingFraction(false));
+        ASSERT_EQUALS(1250, stats.paddedLength(1000, kMaxLength, false));
+    }
+
+    TEST(RecordGrowthStats, HistogramFollowsTheWorkload) {
+        RecordGrowthStats stats;
+        for (int i = 0; i < RecordGrowthStats::MaxMovesInHistogram - 1; ++i) {
+            stats.recordMove(1000, 2000);
+        }
+        ASSERT_EQUALS(1.0, stats.paddingFraction(true));
+
+        // Halves the histogram, after which the small moves outnumber the large ones
+        for (int i = 0; i < RecordGrowthStats::MaxMovesInHistogram; ++i) {
+            stats.recordMove(1000, 1100);
+        }
+        ASSERT_EQUALS(0.125, stats.paddingFraction(true));
+        ASSERT_EQUALS(2LL * RecordGrowthStats::MaxMovesInHistogram - 1, stats.numMoves());
+    }
+
+    TEST(RecordGrowthStats, AppendStats) {
+        RecordGrowthStats stats;
+        stats.recordInsert();
+        stats.recordMove(1000, 1100);
+        stats.recordMove(1000, 1300);
+
+        BSONObjBuilder builder;
+        stats.appendStats(&builder, 1);
+        BSONObj obj = builder.obj();
+        ASSERT_EQUALS(1, obj["inserts"].numberLong());
+        ASSERT_EQUALS(2, obj["moves"].numberLong());
+        ASSERT_EQUALS(2400, obj["bytesMoved"].numberLong());
+        ASSERT_EQUALS(1200, obj["avgBytesPerMove"].numberLong());
+        ASSERT_EQUALS(0, obj["movePadding"].numberDouble());
+    }
+
+} // namespace
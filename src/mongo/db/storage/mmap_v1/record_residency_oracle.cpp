@@ -0,0 +1,131 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/record_residency_oracle.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mongo/util/net/listen.h"
+#include "mongo/util/processinfo.h"
+
+namespace mongo {
+
+    RecordResidencyOracle::Shard::Shard()
+        : lock("RecordResidencyOracle") {
+        memset(windows, 0, sizeof(windows));
+    }
+
+    RecordResidencyOracle::RecordResidencyOracle()
+        : _ttlMillis(DefaultTtlMillis),
+          _pageSize(ProcessInfo::getPageSize()),
+          _shards(new Shard[NumShards]) {
+    }
+
+    bool RecordResidencyOracle::supported() {
+        return ProcessInfo::blockCheckSupported();
+    }
+
+    bool RecordResidencyOracle::isResident(const void* record,
+                                           const void* spanStart,
+                                           const void* spanEnd) {
+        const size_t windowBytes = _pageSize * PagesPerWindow;
+        const size_t ptr = reinterpret_cast<size_t>(record);
+        const size_t windowStart = ptr - ptr % windowBytes;
+        const size_t page = ptr - ptr % _pageSize;
+        const unsigned long long bit = 1ULL << ((page - windowStart) / _pageSize);
+
+        // Only the pages of the window inside the span are known to be mapped.
+        const size_t spanFirst = reinterpret_cast<size_t>(spanStart);
+        const size_t spanLast = reinterpret_cast<size_t>(spanEnd) - 1;
+        const size_t first = std::max(windowStart, spanFirst - spanFirst % _pageSize);
+        const size_t last = std::min(windowStart + windowBytes - _pageSize,
+                                     spanLast - spanLast % _pageSize);
+        dassert(first <= page && page <= last);
+
+        const size_t windowNumber = windowStart / windowBytes;
+        Shard& shard = _shards[windowNumber % NumShards];
+        Window& window = shard.windows[(windowNumber / NumShards) % WindowsPerShard];
+        const long long now = Listener::getElapsedTimeMillis();
+
+        SimpleMutex::scoped_lock lk(shard.lock);
+
+        if (window.start != windowStart
+                || !(window.sampled & bit)
+                || now - window.sampledAtMillis >= _ttlMillis) {
+            _sample(&window, windowStart, first, last, now);
+        }
+
+        if (window.resident & bit) {
+            return true;
+        }
+
+        window.resident |= bit;
+        return false;
+    }
+
+    void RecordResidencyOracle::_sample(Window* window,
+                                        size_t windowStart,
+                                        size_t first,
+                                        size_t last,
+                                        long long now) {
+        const size_t firstIndex = (first - windowStart) / _pageSize;
+        const size_t numPages = (last - first) / _pageSize + 1;
+
+        window->start = windowStart;
+        window->sampled = 0;
+        window->resident = 0;
+        window->sampledAtMillis = now;
+
+        std::vector<char> pages;
+        const bool ok = ProcessInfo::pagesInMemory(reinterpret_cast<const void*>(first),
+                                                   numPages,
+                                                   &pages);
+        for (size_t i = 0; i < numPages; i++) {
+            const unsigned long long bit = 1ULL << (firstIndex + i);
+            window->sampled |= bit;
+
+            // If we can't tell, say not resident: yielding needlessly is much better than not
+            // yielding through a page fault.
+            if (ok && pages[i]) {
+                window->resident |= bit;
+            }
+        }
+    }
+
+    void RecordResidencyOracle::reset() {
+        _shards.reset(new Shard[NumShards]);
+    }
+
+    void RecordResidencyOracle::setTtlMillis(long long millis) {
+        _ttlMillis = millis;
+    }
+
+} // namespace mongo
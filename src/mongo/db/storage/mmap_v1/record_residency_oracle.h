@@ -0,0 +1,113 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/scoped_array.hpp>
+
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * An alternative to the RecordAccessTracker's guesses for the MMAP v1 storage engine: asks
+     * the OS with mincore() which pages are resident, a window of pages at a time, and remembers
+     * the answers for a short while.  One system call thus answers for the records of up to
+     * PagesPerWindow pages, and the answers are right unless a page was evicted since.
+     */
+    class RecordResidencyOracle {
+        MONGO_DISALLOW_COPYING(RecordResidencyOracle);
+    public:
+        RecordResidencyOracle();
+
+        enum Constants {
+            PagesPerWindow = 64, // one bit each in a window's bitmap
+            NumShards = 64,
+            WindowsPerShard = 32,
+            DefaultTtlMillis = 1000
+        };
+
+        /**
+         * @return whether mincore() or its equivalent is available on this platform.
+         */
+        static bool supported();
+
+        /**
+         * @return whether the page holding 'record' is resident.  Only the pages of the window
+         * around 'record' which lie in [spanStart, spanEnd) are sampled, so the span must be
+         * mapped, e.g. the record's extent.
+         *
+         * A page reported not resident is taken to be resident from then on, as the caller is
+         * about to fetch it.
+         */
+        bool isResident(const void* record, const void* spanStart, const void* spanEnd);
+
+        /**
+         * Forgets all samples.
+         */
+        void reset();
+
+        //
+        // For testing.
+        //
+
+        /**
+         * Samples older than 'millis' are taken again.  0 samples on every call.
+         */
+        void setTtlMillis(long long millis);
+
+    private:
+        struct Window {
+            size_t start;              // address of the window's first page, 0 if unused
+            unsigned long long sampled; // the pages which were asked about
+            unsigned long long resident;
+            long long sampledAtMillis;
+        };
+
+        /**
+         * a small direct mapped table of windows, with its own lock
+         */
+        struct Shard {
+            Shard();
+
+            SimpleMutex lock;
+            Window windows[WindowsPerShard];
+        };
+
+        /**
+         * Fills in 'window' with the residency of the pages from 'first' to 'last', which are
+         * page aligned addresses in the window starting at 'windowStart'.
+         */
+        void _sample(Window* window, size_t windowStart, size_t first, size_t last, long long now);
+
+        long long _ttlMillis;
+        const size_t _pageSize;
+        boost::scoped_array<Shard> _shards;
+    };
+
+} // namespace mongo
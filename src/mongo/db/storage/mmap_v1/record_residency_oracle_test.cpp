@@ -0,0 +1,131 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/mmap_v1/record_residency_oracle.h"
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/processinfo.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+using namespace mongo;
+
+namespace {
+
+#if defined(__linux__)
+
+    /**
+     * Anonymous memory whose pages are only resident once written to.
+     */
+    class Pages {
+    public:
+        explicit Pages(size_t numPages)
+            : _pageSize(ProcessInfo::getPageSize()),
+              _size(numPages * _pageSize) {
+            _data = static_cast<char*>(mmap(NULL, _size, PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            ASSERT(_data != MAP_FAILED);
+        }
+
+        ~Pages() {
+            munmap(_data, _size);
+        }
+
+        void touch(size_t page) { _data[page * _pageSize] = 1; }
+
+        const void* record(size_t page) const { return _data + page * _pageSize + 16; }
+        const void* begin() const { return _data; }
+        const void* end() const { return _data + _size; }
+
+    private:
+        const size_t _pageSize;
+        const size_t _size;
+        char* _data;
+    };
+
+    TEST(RecordResidencyOracleTest, TouchedPageIsResident) {
+        RecordResidencyOracle oracle;
+        Pages pages(2 * RecordResidencyOracle::PagesPerWindow);
+        pages.touch(3);
+
+        ASSERT_TRUE(oracle.isResident(pages.record(3), pages.begin(), pages.end()));
+        ASSERT_TRUE(oracle.isResident(pages.record(3), pages.begin(), pages.end()));
+    }
+
+    TEST(RecordResidencyOracleTest, FetchedPageIsAssumedResident) {
+        RecordResidencyOracle oracle;
+        Pages pages(2 * RecordResidencyOracle::PagesPerWindow);
+
+        ASSERT_FALSE(oracle.isResident(pages.record(5), pages.begin(), pages.end()));
+        ASSERT_TRUE(oracle.isResident(pages.record(5), pages.begin(), pages.end()));
+
+        // The other pages of the window were sampled as well.
+        ASSERT_FALSE(oracle.isResident(pages.record(6), pages.begin(), pages.end()));
+    }
+
+    TEST(RecordResidencyOracleTest, OldSamplesAreTakenAgain) {
+        RecordResidencyOracle oracle;
+        oracle.setTtlMillis(0);
+        Pages pages(2 * RecordResidencyOracle::PagesPerWindow);
+
+        ASSERT_FALSE(oracle.isResident(pages.record(5), pages.begin(), pages.end()));
+        ASSERT_FALSE(oracle.isResident(pages.record(5), pages.begin(), pages.end()));
+        pages.touch(5);
+        ASSERT_TRUE(oracle.isResident(pages.record(5), pages.begin(), pages.end()));
+    }
+
+    TEST(RecordResidencyOracleTest, SamplesOnlyTheSpan) {
+        RecordResidencyOracle oracle;
+        oracle.setTtlMillis(0);
+
+        // Far smaller than a window, so mincore() would fail outside it.
+        Pages pages(3);
+        pages.touch(0);
+        pages.touch(2);
+
+        ASSERT_TRUE(oracle.isResident(pages.record(0), pages.begin(), pages.end()));
+        ASSERT_FALSE(oracle.isResident(pages.record(1), pages.begin(), pages.end()));
+        ASSERT_TRUE(oracle.isResident(pages.record(2), pages.begin(), pages.end()));
+    }
+
+    TEST(RecordResidencyOracleTest, Reset) {
+        RecordResidencyOracle oracle;
+        Pages pages(2 * RecordResidencyOracle::PagesPerWindow);
+
+        ASSERT_FALSE(oracle.isResident(pages.record(5), pages.begin(), pages.end()));
+        oracle.reset();
+        ASSERT_FALSE(oracle.isResident(pages.record(5), pages.begin(), pages.end()));
+    }
+
+#endif
+
+} // namespace
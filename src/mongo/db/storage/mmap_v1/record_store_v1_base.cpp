@@ -34,17 +34,22 @@
 
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/mmap_v1/extent.h"
 #include "mongo/db/storage/mmap_v1/extent_manager.h"
 #include "mongo/db/storage/mmap_v1/record.h"
 #include "mongo/db/storage/mmap_v1/record_store_v1_repair_iterator.h"
 #include "mongo/util/log.h"
+#include "mongo/util/mmap.h"
 #include "mongo/util/progress_meter.h"
 #include "mongo/util/timer.h"
 #include "mongo/util/touch_pages.h"
 
 namespace mongo {
 
+    // Whether padded records also get room for the growth of the collection's moved records
+    MONGO_EXPORT_SERVER_PARAMETER(mmapv1RecordGrowthPadding, bool, true);
+
     /* Deleted list buckets are used to quickly locate free space based on size.  Each bucket
        contains records up to that size (meaning a record with a size exactly equal to
        bucketSizes[n] would go into bucket n+1).
@@ -242,6 +247,22 @@ namespace mongo {
         return _extentManager->recordNeedsFetch( loc );
     }
 
+    void RecordStoreV1Base::prefetchRecords( OperationContext* txn,
+                                             const std::vector<DiskLoc>& locs ) const {
+        _extentManager->prefetchRecords( locs );
+    }
+
+    void RecordStoreV1Base::touchRecord( OperationContext* txn, const DiskLoc& loc ) const {
+        const Record* record = recordFor( loc );
+        const char* data = record->dataNoThrowing();
+        const int len = record->netLength();
+
+        // Touch the first word on every page in order to fault it into memory, and the last
+        // byte in case the loop missed the last page
+        touch_pages( data, len, g_minOSPageSizeBytes );
+        touch_pages( data + len - 1, 1 );
+    }
+
 
     StatusWith<DiskLoc> RecordStoreV1Base::insertRecord( OperationContext* txn,
                                                          const DocWriter* doc,
@@ -257,7 +278,7 @@ namespace mongo {
                                         "record has to be <= 16.5MB" );
         }
         if (doc->addPadding() && shouldPadInserts())
-            lenWHdr = quantizeAllocationSpace( lenWHdr );
+            lenWHdr = _paddedAllocationSize( lenWHdr, false );
 
         StatusWith<DiskLoc> loc = allocRecord( txn, lenWHdr, enforceQuota );
         if ( !loc.isOK() )
@@ -273,6 +294,8 @@ namespace mongo {
 
         _details->incrementStats( txn, r->netLength(), 1 );
 
+        _growthStats.recordInsert();
+
         return loc;
     }
 
@@ -291,17 +314,27 @@ namespace mongo {
                                         "record has to be <= 16.5MB" );
         }
 
-        return _insertRecord( txn, data, len, enforceQuota );
+        StatusWith<DiskLoc> loc = _insertRecord( txn, data, len, enforceQuota, false );
+        if ( loc.isOK() )
+            _growthStats.recordInsert();
+        return loc;
+    }
+
+    int RecordStoreV1Base::_paddedAllocationSize( int lenWHdr, bool moving ) const {
+        if ( mmapv1RecordGrowthPadding )
+            lenWHdr = _growthStats.paddedLength( lenWHdr, MaxAllowedAllocation, moving );
+        return quantizeAllocationSpace( lenWHdr );
     }
 
     StatusWith<DiskLoc> RecordStoreV1Base::_insertRecord( OperationContext* txn,
                                                           const char* data,
                                                           int len,
-                                                          bool enforceQuota ) {
+                                                          bool enforceQuota,
+                                                          bool moving ) {
 
         int lenWHdr = len + Record::HeaderSize;
         if (shouldPadInserts())
-            lenWHdr = quantizeAllocationSpace( lenWHdr );
+            lenWHdr = _paddedAllocationSize( lenWHdr, moving );
         fassert( 17208, lenWHdr >= ( len + Record::HeaderSize ) );
 
         StatusWith<DiskLoc> loc = allocRecord( txn, lenWHdr, enforceQuota );
@@ -346,7 +379,8 @@ namespace mongo {
                                         "record has to be <= 16.5MB" );
         }
 
-        StatusWith<DiskLoc> newLocation = _insertRecord( txn, data, dataSize, enforceQuota );
+        const int oldLength = oldRecord->netLength();
+        StatusWith<DiskLoc> newLocation = _insertRecord( txn, data, dataSize, enforceQuota, true );
         if ( !newLocation.isOK() )
             return newLocation;
 
@@ -362,6 +396,8 @@ namespace mongo {
 
         deleteRecord( txn, oldLocation );
 
+        _growthStats.recordMove( oldLength, dataSize );
+
         return newLocation;
     }
 
@@ -817,6 +853,12 @@ namespace mongo {
             result->appendNumber( "max", _details->maxCappedDocs() );
             result->appendNumber( "maxSize", static_cast<long long>( storageSize( txn, NULL, 0 ) ) );
         }
+        else {
+            // Since the collection was opened
+            BSONObjBuilder growth( result->subobjStart( "recordGrowth" ) );
+            _growthStats.appendStats( &growth, scale );
+            growth.done();
+        }
     }
 
 
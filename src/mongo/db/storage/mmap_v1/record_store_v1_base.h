@@ -31,6 +31,7 @@
 #pragma once
 
 #include "mongo/db/diskloc.h"
+#include "mongo/db/storage/mmap_v1/record_growth_stats.h"
 #include "mongo/db/storage/record_store.h"
 
 namespace mongo {
@@ -142,6 +143,11 @@ namespace mongo {
         virtual RecordFetcher* recordNeedsFetch( OperationContext* txn,
                                                  const DiskLoc& loc ) const;
 
+        virtual void prefetchRecords( OperationContext* txn,
+                                      const std::vector<DiskLoc>& locs ) const;
+
+        virtual void touchRecord( OperationContext* txn, const DiskLoc& loc ) const;
+
         StatusWith<DiskLoc> insertRecord( OperationContext* txn,
                                           const char* data,
                                           int len,
@@ -181,6 +187,8 @@ namespace mongo {
 
         const RecordStoreV1MetaData* details() const { return _details.get(); }
 
+        const RecordGrowthStats& growthStats() const { return _growthStats; }
+
         DiskLoc getExtentLocForRecord( OperationContext* txn, const DiskLoc& loc ) const;
 
         DiskLoc getNextRecord( OperationContext* txn, const DiskLoc& loc ) const;
@@ -246,16 +254,25 @@ namespace mongo {
 
         /**
          * internal
-         * doesn't check inputs or change padding
+         * doesn't check inputs
+         * @param moving - whether this is the new location of a record which outgrew its old one
          */
         StatusWith<DiskLoc> _insertRecord( OperationContext* txn,
                                            const char* data,
                                            int len,
-                                           bool enforceQuota );
+                                           bool enforceQuota,
+                                           bool moving );
+
+        /**
+         * Returns the allocation size of a padded record of 'lenWHdr' bytes, with room for the
+         * growth seen by _growthStats if mmapv1RecordGrowthPadding is set.
+         */
+        int _paddedAllocationSize( int lenWHdr, bool moving ) const;
 
         scoped_ptr<RecordStoreV1MetaData> _details;
         ExtentManager* _extentManager;
         bool _isSystemIndexes;
+        RecordGrowthStats _growthStats;
 
         friend class RecordStoreV1RepairIterator;
     };
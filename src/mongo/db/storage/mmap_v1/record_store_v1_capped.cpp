@@ -32,6 +32,7 @@
 
 #include "mongo/db/storage/mmap_v1/record_store_v1_capped.h"
 
+#include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/storage/mmap_v1/extent.h"
 #include "mongo/db/storage/mmap_v1/extent_manager.h"
@@ -70,6 +71,10 @@ namespace mongo {
         : RecordStoreV1Base( ns, details, em, isSystemIndexes ),
           _deleteCallback( collection ) {
 
+        if ( NamespaceString::oplog( ns ) ) {
+            _oplogStartIndex.reset( new OplogStartIndex() );
+        }
+
         DiskLoc extentLoc = details->firstExtent(txn);
         while ( !extentLoc.isNull() ) {
             _extentAdvice.push_back( _extentManager->cacheHint( extentLoc,
@@ -85,6 +90,44 @@ namespace mongo {
     CappedRecordStoreV1::~CappedRecordStoreV1() {
     }
 
+    StatusWith<DiskLoc> CappedRecordStoreV1::insertRecord( OperationContext* txn,
+                                                           const char* data,
+                                                           int len,
+                                                           bool enforceQuota ) {
+        StatusWith<DiskLoc> loc = RecordStoreV1Base::insertRecord( txn, data, len, enforceQuota );
+        if ( loc.isOK() && _oplogStartIndex ) {
+            _oplogStartIndex->noteInsert( txn, loc.getValue(), data, len );
+        }
+        return loc;
+    }
+
+    StatusWith<DiskLoc> CappedRecordStoreV1::insertRecord( OperationContext* txn,
+                                                           const DocWriter* doc,
+                                                           bool enforceQuota ) {
+        StatusWith<DiskLoc> loc = RecordStoreV1Base::insertRecord( txn, doc, enforceQuota );
+        if ( loc.isOK() && _oplogStartIndex ) {
+            const Record* r = recordFor( loc.getValue() );
+            _oplogStartIndex->noteInsert( txn, loc.getValue(), r->data(), r->netLength() );
+        }
+        return loc;
+    }
+
+    void CappedRecordStoreV1::deleteRecord( OperationContext* txn, const DiskLoc& dl ) {
+        if ( _oplogStartIndex ) {
+            const Record* r = recordFor( dl );
+            _oplogStartIndex->noteDelete( dl, r->data(), r->netLength() );
+        }
+        RecordStoreV1Base::deleteRecord( txn, dl );
+    }
+
+    DiskLoc CappedRecordStoreV1::oplogStartHack( OperationContext* txn,
+                                                 const DiskLoc& startingPosition ) const {
+        if ( !_oplogStartIndex ) {
+            return DiskLoc().setInvalid();
+        }
+        return _oplogStartIndex->findStart( startingPosition );
+    }
+
     StatusWith<DiskLoc> CappedRecordStoreV1::allocRecord( OperationContext* txn,
                                                           int lenToAlloc,
                                                           bool enforceQuota ) {
@@ -219,6 +262,10 @@ namespace mongo {
     }
 
     Status CappedRecordStoreV1::truncate(OperationContext* txn) {
+        if ( _oplogStartIndex ) {
+            _oplogStartIndex->clear();
+        }
+
         setLastDelRecLastExtent( txn, DiskLoc() );
         setListOfAllDeletedRecords( txn, DiskLoc() );
 
@@ -30,10 +30,13 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
+
 #include "mongo/base/owned_pointer_vector.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/storage/capped_callback.h"
 #include "mongo/db/storage/mmap_v1/extent_manager.h"
+#include "mongo/db/storage/mmap_v1/oplog_start_index.h"
 #include "mongo/db/storage/mmap_v1/record_store_v1_base.h"
 
 namespace mongo {
@@ -53,6 +56,25 @@ namespace mongo {
 
         virtual Status truncate(OperationContext* txn);
 
+        StatusWith<DiskLoc> insertRecord( OperationContext* txn,
+                                          const char* data,
+                                          int len,
+                                          bool enforceQuota );
+
+        StatusWith<DiskLoc> insertRecord( OperationContext* txn,
+                                          const DocWriter* doc,
+                                          bool enforceQuota );
+
+        void deleteRecord( OperationContext* txn,
+                           const DiskLoc& dl );
+
+        /**
+         * For an oplog, seeks with the OplogStartIndex of the entries inserted since the
+         * collection was opened. Returns an invalid DiskLoc for older entries.
+         */
+        virtual DiskLoc oplogStartHack(OperationContext* txn,
+                                       const DiskLoc& startingPosition) const;
+
         /**
          * Truncate documents newer than the document at 'end' from the capped
          * collection.  The collection cannot be completely emptied using this
@@ -131,6 +153,9 @@ namespace mongo {
 
         CappedDocumentDeleteCallback* _deleteCallback;
 
+        // Only set for the oplog
+        boost::scoped_ptr<OplogStartIndex> _oplogStartIndex;
+
         OwnedPointerVector<ExtentManager::CacheHint> _extentAdvice;
 
         friend class CappedRecordStoreV1Iterator;
@@ -762,4 +762,40 @@ namespace {
         h.md->setCapFirstNewRecord( &h.txn, h.insert( h.md->capExtent(), 3 ) );
         h.walkAndCount(4);
     }
+
+    TEST(CappedRecordStoreV1, OplogStartHack) {
+        OperationContextNoop txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( true, 0 );
+        DummyCappedDocumentDeleteCallback cb;
+        CappedRecordStoreV1 rs( &txn, &cb, "local.oplog.rs", md, &em, false );
+        rs.increaseStorageSize( &txn, 1024, false );
+
+        vector<DiskLoc> locs;
+        for ( int i = 10; i < 13; i++ ) {
+            BSONObj entry = BSON( "ts" << OpTime( i, 0 ) );
+            StatusWith<DiskLoc> loc = rs.insertRecord( &txn, entry.objdata(), entry.objsize(),
+                                                       false );
+            ASSERT_OK( loc.getStatus() );
+            locs.push_back( loc.getValue() );
+        }
+
+        // Only the first entry is indexed, the next ones are too close to it
+        ASSERT_EQUALS( locs[0], rs.oplogStartHack( &txn, DiskLoc( 10, 0 ) ) );
+        ASSERT_EQUALS( locs[0], rs.oplogStartHack( &txn, DiskLoc( 12, 0 ) ) );
+        ASSERT_FALSE( rs.oplogStartHack( &txn, DiskLoc( 9, 0 ) ).isValid() );
+    }
+
+    TEST(CappedRecordStoreV1, OplogStartHackNotOplog) {
+        OperationContextNoop txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( true, 0 );
+        DummyCappedDocumentDeleteCallback cb;
+        CappedRecordStoreV1 rs( &txn, &cb, "test.capped", md, &em, false );
+        rs.increaseStorageSize( &txn, 1024, false );
+
+        BSONObj entry = BSON( "ts" << OpTime( 10, 0 ) );
+        ASSERT_OK( rs.insertRecord( &txn, entry.objdata(), entry.objsize(), false ).getStatus() );
+        ASSERT_FALSE( rs.oplogStartHack( &txn, DiskLoc( 10, 0 ) ).isValid() );
+    }
 }
@@ -34,6 +34,10 @@
 
 #include "mongo/db/storage/mmap_v1/record_store_v1_simple.h"
 
+#include <algorithm>
+#include <set>
+#include <vector>
+
 #include "mongo/base/counter.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/curop.h"
@@ -65,6 +69,10 @@ namespace mongo {
     static ServerStatusMetricField<Counter64> dFreelist3( "storage.freelist.search.scanned",
                                                           &freelistIterations );
 
+    static Counter64 freelistCoalesced;
+    static ServerStatusMetricField<Counter64> dFreelist4( "storage.freelist.coalesced",
+                                                          &freelistCoalesced );
+
     SimpleRecordStoreV1::SimpleRecordStoreV1( OperationContext* txn,
                                               const StringData& ns,
                                               RecordStoreV1MetaData* details,
@@ -236,6 +244,96 @@ namespace mongo {
         _details->setDeletedListEntry(txn, b, dloc);
     }
 
+    namespace {
+        struct FreeRecord {
+            DiskLoc loc;
+            int extentOfs;
+            int length;
+
+            bool operator<(const FreeRecord& rhs) const { return loc < rhs.loc; }
+
+            /** whether rhs starts right where this ends, in the same extent */
+            bool isFollowedBy(const FreeRecord& rhs) const {
+                return loc.a() == rhs.loc.a()
+                    && extentOfs == rhs.extentOfs
+                    && loc.getOfs() + length == rhs.loc.getOfs();
+            }
+        };
+    }
+
+    int SimpleRecordStoreV1::coalesceDeletedRecords( OperationContext* txn, int maxRuns ) {
+        std::vector<FreeRecord> free;
+        for ( int b = 0; b < Buckets; b++ ) {
+            for ( DiskLoc loc = _details->deletedListEntry(b); !loc.isNull(); ) {
+                const DeletedRecord* d = drec(loc);
+                FreeRecord f;
+                f.loc = loc;
+                f.extentOfs = d->extentOfs();
+                f.length = d->lengthWithHeaders();
+                free.push_back(f);
+                loc = d->nextDeleted();
+            }
+        }
+        std::sort(free.begin(), free.end());
+
+        // The first record of each run takes the space of the rest.
+        std::vector<FreeRecord> merged;
+        std::set<DiskLoc> unlink;
+        for ( size_t i = 0; i + 1 < free.size() && (int)merged.size() < maxRuns; i++ ) {
+            if ( !free[i].isFollowedBy(free[i + 1]) )
+                continue;
+
+            FreeRecord run = free[i];
+            unlink.insert(run.loc);
+            for ( ; i + 1 < free.size() && free[i].isFollowedBy(free[i + 1]); i++ ) {
+                run.length += free[i + 1].length;
+                unlink.insert(free[i + 1].loc);
+            }
+            merged.push_back(run);
+        }
+
+        if ( merged.empty() )
+            return 0;
+
+        _unlinkDeletedRecords(txn, unlink);
+
+        for ( size_t i = 0; i < merged.size(); i++ ) {
+            txn->recoveryUnit()->writingInt(drec(merged[i].loc)->lengthWithHeaders()) =
+                merged[i].length;
+            addDeletedRec(txn, merged[i].loc);
+        }
+
+        const int n = unlink.size() - merged.size();
+        freelistCoalesced.increment(n);
+        return n;
+    }
+
+    void SimpleRecordStoreV1::_unlinkDeletedRecords( OperationContext* txn,
+                                                     const std::set<DiskLoc>& locs ) {
+        // Bucket number Buckets stands for the legacy grab bag.
+        for ( int b = 0; b <= Buckets; b++ ) {
+            DiskLoc prev;
+            DiskLoc loc = b < Buckets ? _details->deletedListEntry(b)
+                                      : _details->deletedListLegacyGrabBag();
+            while ( !loc.isNull() ) {
+                const DiskLoc next = drec(loc)->nextDeleted();
+                if ( !locs.count(loc) ) {
+                    prev = loc;
+                }
+                else if ( !prev.isNull() ) {
+                    *txn->recoveryUnit()->writing(&drec(prev)->nextDeleted()) = next;
+                }
+                else if ( b < Buckets ) {
+                    _details->setDeletedListEntry(txn, b, next);
+                }
+                else {
+                    _details->setDeletedListLegacyGrabBag(txn, next);
+                }
+                loc = next;
+            }
+        }
+    }
+
     RecordIterator* SimpleRecordStoreV1::getIterator( OperationContext* txn,
                                                       const DiskLoc& start,
                                                       const CollectionScanParams::Direction& dir) const {
@@ -329,11 +427,20 @@ namespace mongo {
                 txn->checkForInterrupt();
 
                 WriteUnitOfWork wunit(txn);
-                Record* recOld = recordFor(nextSourceLoc);
+                const DiskLoc sourceLoc = nextSourceLoc;
+                Record* recOld = recordFor(sourceLoc);
                 RecordData oldData = recOld->toRecordData();
-                nextSourceLoc = getNextRecordInExtent(txn, nextSourceLoc);
+                nextSourceLoc = getNextRecordInExtent(txn, sourceLoc);
 
+                // With the indexes in place a corrupt document can't just be dropped, as its
+                // keys can't be told.
+                UpdateMoveNotifier* notifier = adaptor->moveNotifier();
                 if ( compactOptions->validateDocuments && !adaptor->isDataValid( oldData ) ) {
+                    uassert( 28621,
+                             str::stream() << "online compact found a corrupt document at "
+                                           << sourceLoc.toString() << " in " << _ns
+                                           << ", an offline compact removes it",
+                             !notifier );
                     // object is corrupt!
                     log() << "compact removing corrupt document!";
                     stats->corruptDocuments++;
@@ -370,9 +477,18 @@ namespace mongo {
                     }
                     invariant(allocationSize >= minAllocationSize);
 
+                    if ( notifier ) {
+                        // Takes the old location out of the indexes and the cursors.
+                        uassertStatusOK( notifier->recordStoreGoingToMove( txn,
+                                                                           sourceLoc,
+                                                                           oldData.data(),
+                                                                           oldData.size() ) );
+                    }
+
                     // Copy the data to a new record. Because we orphaned the record freelist at the
                     // start of the compact, this insert will allocate a record in a new extent.
-                    // See the comment in compact() for more details.
+                    // See the comment in compact() for more details.  An online compact only took
+                    // the free space of the extents being compacted off the freelist.
                     CompactDocWriter writer( recOld, rawDataSize, allocationSize );
                     StatusWith<DiskLoc> status = insertRecord( txn, &writer, false );
                     uassertStatusOK( status.getStatus() );
@@ -439,6 +555,10 @@ namespace mongo {
                                          const CompactOptions* options,
                                          CompactStats* stats ) {
 
+        if ( options->online ) {
+            return _compactOnline( txn, adaptor, options, stats );
+        }
+
         std::vector<DiskLoc> extents;
         for( DiskLoc extLocation = _details->firstExtent(txn);
              !extLocation.isNull();
@@ -489,4 +609,62 @@ namespace mongo {
         return Status::OK();
     }
 
+    Status SimpleRecordStoreV1::_compactOnline( OperationContext* txn,
+                                                RecordStoreCompactAdaptor* adaptor,
+                                                const CompactOptions* options,
+                                                CompactStats* stats ) {
+        invariant( adaptor->moveNotifier() );
+
+        // The records go to the free space of the other extents, or to new extents after the
+        // last one, so the last extent is never compacted.  As the extents are emptied from the
+        // front, a compact in several calls goes through those there were at the start once.
+        std::vector<DiskLoc> extents;
+        const DiskLoc lastExtent = _details->lastExtent(txn);
+        for( DiskLoc extLocation = _details->firstExtent(txn);
+             !extLocation.isNull() && extLocation != lastExtent;
+             extLocation = _extentManager->getExtent( extLocation )->xnext ) {
+            extents.push_back( extLocation );
+        }
+
+        const size_t before = extents.size();
+        if ( options->maxExtents > 0 && extents.size() > size_t(options->maxExtents) ) {
+            extents.resize( options->maxExtents );
+        }
+        log() << "compact online " << extents.size() << " of " << before << " extents";
+
+        {
+            // Nothing may be allocated in the extents being emptied.  Their free space stays
+            // off the free lists until they are freed, or leaks if the compact is interrupted.
+            const std::set<DiskLoc> toCompact( extents.begin(), extents.end() );
+            std::set<DiskLoc> inExtents;
+            for ( int b = 0; b <= Buckets; b++ ) {
+                DiskLoc loc = b < Buckets ? _details->deletedListEntry(b)
+                                          : _details->deletedListLegacyGrabBag();
+                while ( !loc.isNull() ) {
+                    const DeletedRecord* d = drec(loc);
+                    if ( toCompact.count( DiskLoc(loc.a(), d->extentOfs()) ) )
+                        inExtents.insert(loc);
+                    loc = d->nextDeleted();
+                }
+            }
+
+            WriteUnitOfWork wunit(txn);
+            _unlinkDeletedRecords(txn, inExtents);
+            wunit.commit();
+        }
+
+        int extentNumber = 0;
+        for( std::vector<DiskLoc>::iterator it = extents.begin(); it != extents.end(); it++ ) {
+            txn->checkForInterrupt();
+            invariant(_details->firstExtent(txn) == *it);
+            // empties and removes the first extent
+            _compactExtent(txn, *it, extentNumber++, adaptor, options, stats );
+            invariant(_details->firstExtent(txn) != *it);
+            stats->extentsCompacted++;
+        }
+
+        stats->extentsLeft = before - extents.size();
+        return Status::OK();
+    }
+
 }
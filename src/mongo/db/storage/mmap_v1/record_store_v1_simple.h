@@ -61,6 +61,16 @@ namespace mongo {
             invariant(!"cappedTruncateAfter not supported");
         }
 
+        /**
+         * Merges the deleted records which are next to each other in an extent, so that their
+         * space can take bigger records again, without moving any records.  Merges at most
+         * 'maxRuns' runs of adjacent deleted records, as the free lists are all walked under the
+         * caller's exclusive lock.  The legacy grab bag is left to drain as it does now.
+         *
+         * @return the number of deleted records merged into the one before them
+         */
+        int coalesceDeletedRecords( OperationContext* txn, int maxRuns );
+
         virtual bool compactSupported() const { return true; }
         virtual Status compact( OperationContext* txn,
                                 RecordStoreCompactAdaptor* adaptor,
@@ -88,6 +98,14 @@ namespace mongo {
                             const CompactOptions* compactOptions,
                             CompactStats* stats );
 
+        Status _compactOnline( OperationContext* txn,
+                               RecordStoreCompactAdaptor* adaptor,
+                               const CompactOptions* options,
+                               CompactStats* stats );
+
+        /** takes the deleted records at 'locs' off the free lists and the legacy grab bag */
+        void _unlinkDeletedRecords( OperationContext* txn, const std::set<DiskLoc>& locs );
+
         bool _normalCollection;
 
         friend class SimpleRecordStoreV1Iterator;
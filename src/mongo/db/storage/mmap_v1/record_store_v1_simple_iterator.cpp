@@ -28,6 +28,8 @@
 
 #include "mongo/db/storage/mmap_v1/record_store_v1_simple_iterator.h"
 
+#include <algorithm>
+
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/storage/mmap_v1/extent.h"
 #include "mongo/db/storage/mmap_v1/extent_manager.h"
@@ -35,6 +37,11 @@
 
 namespace mongo {
 
+    namespace {
+        // How far ahead of a sequential scan are records read?
+        const long long kReadAheadBytes = 1024 * 1024;
+    }
+
     //
     // Regular / non-capped collection traversal
     //
@@ -43,7 +50,15 @@ namespace mongo {
                                                              const SimpleRecordStoreV1* collection,
                                                              const DiskLoc& start,
                                                              const CollectionScanParams::Direction& dir)
-        : _txn(txn), _curr(start), _recordStore(collection), _direction(dir) {
+        : _txn(txn),
+          _curr(start),
+          _recordStore(collection),
+          _direction(dir),
+          _extentEnd(0),
+          _sequential(false),
+          _readAheads(0),
+          _readAheadBegin(0),
+          _readAheadEnd(0) {
 
         if (_curr.isNull()) {
 
@@ -56,11 +71,14 @@ namespace mongo {
             else if (CollectionScanParams::FORWARD == _direction) {
 
                 // Find a non-empty extent and start with the first record in it.
-                Extent* e = em->getExtent( _recordStore->details()->firstExtent(txn) );
+                _extentLoc = _recordStore->details()->firstExtent(txn);
+                Extent* e = em->getExtent( _extentLoc );
 
                 while (e->firstRecord.isNull() && !e->xnext.isNull()) {
-                    e = em->getExtent( e->xnext );
+                    _extentLoc = e->xnext;
+                    e = em->getExtent( _extentLoc );
                 }
+                _extentEnd = _extentLoc.getOfs() + e->length;
 
                 // _curr may be set to DiskLoc() here if e->lastRecord isNull but there is no
                 // valid e->xnext
@@ -69,13 +87,16 @@ namespace mongo {
             else {
                 // Walk backwards, skipping empty extents, and use the last record in the first
                 // non-empty extent we see.
-                Extent* e = em->getExtent( _recordStore->details()->lastExtent(txn) );
+                _extentLoc = _recordStore->details()->lastExtent(txn);
+                Extent* e = em->getExtent( _extentLoc );
 
                 // TODO ELABORATE
                 // Does one of e->lastRecord.isNull(), e.firstRecord.isNull() imply the other?
                 while (e->lastRecord.isNull() && !e->xprev.isNull()) {
-                    e = em->getExtent( e->xprev );
+                    _extentLoc = e->xprev;
+                    e = em->getExtent( _extentLoc );
                 }
+                _extentEnd = _extentLoc.getOfs() + e->length;
 
                 // _curr may be set to DiskLoc() here if e->lastRecord isNull but there is no
                 // valid e->xprev
@@ -101,6 +122,10 @@ namespace mongo {
             else {
                 _curr = _recordStore->getPrevRecord( _txn, _curr );
             }
+
+            if (_sequential) {
+                _readAhead();
+            }
         }
 
         return ret;
@@ -128,4 +153,102 @@ namespace mongo {
         return _recordStore->dataFor( _txn, loc );
     }
 
+    void SimpleRecordStoreV1Iterator::setSequentialScanHint() {
+        if (_sequential) {
+            return;
+        }
+        _sequential = true;
+        _readAhead();
+    }
+
+    void SimpleRecordStoreV1Iterator::_readAhead() {
+        if (_curr.isNull()) {
+            return;
+        }
+
+        ExtentManager* em = _recordStore->_extentManager;
+        if (!_extentHint || !_inExtent(_curr)) {
+            _extentLoc = _findExtent(_curr);
+            _extentEnd = _extentLoc.getOfs() + em->getExtent(_extentLoc)->length;
+            _readAheadBegin = _readAheadEnd = _curr.getOfs();
+
+            // The old hint goes first, in case the new one advises an overlapping range.
+            _extentHint.reset();
+            _extentHint.reset(em->cacheHint(_extentLoc, ExtentManager::Sequential));
+        }
+
+        // Records mostly follow each other through an extent, so a window of the extent ahead
+        // of _curr is read in, and the next one once _curr is half way through it.  Offsets fit
+        // in an int, but an offset plus the window might not.
+        const long long ofs = _curr.getOfs();
+        long long begin;
+        long long end;
+        if (CollectionScanParams::FORWARD == _direction) {
+            if (_readAheadEnd - ofs > kReadAheadBytes / 2) {
+                return;
+            }
+            begin = std::max(ofs, static_cast<long long>(_readAheadEnd));
+            end = std::min(ofs + kReadAheadBytes, static_cast<long long>(_extentEnd));
+        }
+        else {
+            if (ofs - _readAheadBegin > kReadAheadBytes / 2) {
+                return;
+            }
+            begin = std::max(ofs - kReadAheadBytes, static_cast<long long>(_extentLoc.getOfs()));
+            end = std::min(ofs, static_cast<long long>(_readAheadBegin));
+        }
+        if (begin >= end) {
+            return;
+        }
+
+        em->prefetchRange(DiskLoc(_curr.a(), static_cast<int>(begin)),
+                          static_cast<int>(end - begin));
+        if (CollectionScanParams::FORWARD == _direction) {
+            _readAheadEnd = static_cast<int>(end);
+        }
+        else {
+            _readAheadBegin = static_cast<int>(begin);
+        }
+        ++_readAheads;
+    }
+
+    bool SimpleRecordStoreV1Iterator::_inExtent( const DiskLoc& loc ) const {
+        return !_extentLoc.isNull()
+            && loc.a() == _extentLoc.a()
+            && loc.getOfs() >= _extentLoc.getOfs()
+            && loc.getOfs() < _extentEnd;
+    }
+
+    DiskLoc SimpleRecordStoreV1Iterator::_findExtent( const DiskLoc& loc ) const {
+        if (_inExtent(loc)) {
+            return _extentLoc;
+        }
+
+        const ExtentManager* em = _recordStore->_extentManager;
+        if (!_extentLoc.isNull()) {
+            // Leaving an extent, getNextRecord() and getPrevRecord() go on to the next extent in
+            // the direction of the scan which isn't empty.
+            const Extent* e = em->getExtent(_extentLoc);
+            while (true) {
+                DiskLoc next = CollectionScanParams::FORWARD == _direction ? e->xnext : e->xprev;
+                if (next.isNull()) {
+                    break;
+                }
+                e = em->getExtent(next);
+                if (e->firstRecord.isNull()) {
+                    continue;
+                }
+                if (loc.a() == next.a()
+                    && loc.getOfs() >= next.getOfs()
+                    && loc.getOfs() < next.getOfs() + e->length) {
+                    return next;
+                }
+                break;
+            }
+        }
+
+        // The scan didn't come from a known extent; the record's header has to be read.
+        return em->extentLocForV1(loc);
+    }
+
 }
@@ -28,6 +28,9 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/storage/mmap_v1/extent_manager.h"
 #include "mongo/db/storage/record_store.h"
 
 namespace mongo {
@@ -58,7 +61,21 @@ namespace mongo {
 
         virtual RecordData dataFor( const DiskLoc& loc ) const;
 
+        virtual void setSequentialScanHint();
+        virtual long long readAheadCount() const { return _readAheads; }
+
     private:
+        // With the sequential hint set, advises the OS to read in the next part of the extent
+        // holding _curr, and to read the extent sequentially.
+        void _readAhead();
+
+        // Returns the location of the extent holding 'loc', searching the extent list from
+        // _extentLoc so that the record itself isn't touched.
+        DiskLoc _findExtent( const DiskLoc& loc ) const;
+
+        // True if 'loc' lies within the extent at _extentLoc.
+        bool _inExtent( const DiskLoc& loc ) const;
+
          // for getNext, not owned
         OperationContext* _txn;
 
@@ -68,6 +85,19 @@ namespace mongo {
         const SimpleRecordStoreV1* _recordStore;
 
         CollectionScanParams::Direction _direction;
+
+        // An extent known to hold a recent _curr, if not null, and the offset just past its end.
+        DiskLoc _extentLoc;
+        int _extentEnd;
+
+        bool _sequential;
+        long long _readAheads;
+
+        // The offsets of the extent at _extentLoc that have been read ahead, and the hint that
+        // the extent is read sequentially.  Only set with the sequential hint.
+        int _readAheadBegin;
+        int _readAheadEnd;
+        boost::scoped_ptr<ExtentManager::CacheHint> _extentHint;
     };
 
 }  // namespace mongo
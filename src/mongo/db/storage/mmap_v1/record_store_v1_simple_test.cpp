@@ -30,6 +30,7 @@
 
 #include "mongo/db/storage/mmap_v1/record_store_v1_simple.h"
 
+#include "mongo/db/catalog/collection.h"
 #include "mongo/db/operation_context_noop.h"
 #include "mongo/db/storage/mmap_v1/extent.h"
 #include "mongo/db/storage/mmap_v1/record.h"
@@ -561,4 +562,164 @@ namespace {
             assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
         }
     }
+    /**
+     * coalesceDeletedRecords() merges runs of adjacent deleted records in an extent, and only
+     * those.
+     */
+    TEST( SimpleRecordStoreV1, CoalesceDeletedRecords ) {
+        OperationContextNoop txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( false, 0 );
+        SimpleRecordStoreV1 rs( &txn, "test.foo", md, &em, false );
+
+        {
+            LocAndSize recs[] = {
+                {DiskLoc(0, 1400), 600},
+                {}
+            };
+            LocAndSize drecs[] = {
+                {DiskLoc(0, 1000), 100},
+                {DiskLoc(0, 1300), 100},
+                {DiskLoc(0, 2000), 100},
+                {DiskLoc(1, 1100), 100},
+                {DiskLoc(1, 1000), 100},
+                {DiskLoc(0, 1100), 200},
+                {}
+            };
+            initializeV1RS(&txn, recs, drecs, NULL, &em, md);
+        }
+
+        ASSERT_EQUALS( 3, rs.coalesceDeletedRecords( &txn, 10 ) );
+
+        {
+            LocAndSize recs[] = {
+                {DiskLoc(0, 1400), 600},
+                {}
+            };
+            LocAndSize drecs[] = {
+                {DiskLoc(0, 2000), 100},
+                {DiskLoc(1, 1000), 200},
+                {DiskLoc(0, 1000), 400},
+                {}
+            };
+            assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
+        }
+
+        ASSERT_EQUALS( 0, rs.coalesceDeletedRecords( &txn, 10 ) );
+    }
+
+    /**
+     * coalesceDeletedRecords() stops after maxRuns runs.
+     */
+    TEST( SimpleRecordStoreV1, CoalesceDeletedRecordsLimit ) {
+        OperationContextNoop txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( false, 0 );
+        SimpleRecordStoreV1 rs( &txn, "test.foo", md, &em, false );
+
+        {
+            LocAndSize drecs[] = {
+                {DiskLoc(0, 1000), 100},
+                {DiskLoc(0, 1100), 100},
+                {DiskLoc(1, 1000), 100},
+                {DiskLoc(1, 1100), 100},
+                {}
+            };
+            initializeV1RS(&txn, NULL, drecs, NULL, &em, md);
+        }
+
+        ASSERT_EQUALS( 1, rs.coalesceDeletedRecords( &txn, 1 ) );
+
+        {
+            LocAndSize drecs[] = {
+                {DiskLoc(1, 1000), 100},
+                {DiskLoc(1, 1100), 100},
+                {DiskLoc(0, 1000), 200},
+                {}
+            };
+            assertStateV1RS(&txn, NULL, drecs, NULL, &em, md);
+        }
+    }
+    /**
+     * Records the moves and inserts of an online compact.
+     */
+    class RecordingCompactAdaptor : public RecordStoreCompactAdaptor, public UpdateMoveNotifier {
+    public:
+        virtual bool isDataValid( const RecordData& recData ) { return true; }
+        virtual size_t dataSize( const RecordData& recData ) { return recData.size(); }
+        virtual void inserted( const RecordData& recData, const DiskLoc& newLocation ) {
+            inserts.push_back( newLocation );
+        }
+        virtual UpdateMoveNotifier* moveNotifier() { return this; }
+        virtual Status recordStoreGoingToMove( OperationContext* txn,
+                                               const DiskLoc& oldLocation,
+                                               const char* oldBuffer,
+                                               size_t oldSize ) {
+            moves.push_back( oldLocation );
+            return Status::OK();
+        }
+
+        std::vector<DiskLoc> moves;
+        std::vector<DiskLoc> inserts;
+    };
+
+    /**
+     * An online compact empties and unlinks the first extents, telling of each move, without
+     * putting anything in the free space of the extents it empties.
+     */
+    TEST( SimpleRecordStoreV1, CompactOnline ) {
+        OperationContextNoop txn;
+        DummyExtentManager em;
+        DummyRecordStoreV1MetaData* md = new DummyRecordStoreV1MetaData( false, 0 );
+        SimpleRecordStoreV1 rs( &txn, "test.foo", md, &em, false );
+
+        {
+            LocAndSize recs[] = {
+                {DiskLoc(0, 1000), 100},
+                {DiskLoc(0, 1100), 100},
+                {DiskLoc(1, 1000), 100},
+                {}
+            };
+            LocAndSize drecs[] = {
+                {DiskLoc(0, 1200), 100},
+                {DiskLoc(1, 1100), 100},
+                {DiskLoc(2, 1000), 1000},
+                {}
+            };
+            initializeV1RS(&txn, recs, drecs, NULL, &em, md);
+        }
+
+        CompactOptions options;
+        options.online = true;
+        options.maxExtents = 1;
+        CompactStats stats;
+        RecordingCompactAdaptor adaptor;
+        ASSERT_OK( rs.compact( &txn, &adaptor, &options, &stats ) );
+
+        ASSERT_EQUALS( 1, stats.extentsCompacted );
+        ASSERT_EQUALS( 1, stats.extentsLeft );
+        ASSERT_EQUALS( DiskLoc(1, 0), md->firstExtent( &txn ) );
+
+        ASSERT_EQUALS( 2U, adaptor.moves.size() );
+        ASSERT_EQUALS( DiskLoc(0, 1000), adaptor.moves[0] );
+        ASSERT_EQUALS( DiskLoc(0, 1100), adaptor.moves[1] );
+        ASSERT_EQUALS( 2U, adaptor.inserts.size() );
+        ASSERT_EQUALS( DiskLoc(2, 1000), adaptor.inserts[0] );
+        ASSERT_EQUALS( DiskLoc(2, 1128), adaptor.inserts[1] );
+
+        {
+            LocAndSize recs[] = {
+                {DiskLoc(1, 1000), 100},
+                {DiskLoc(2, 1000), 128},
+                {DiskLoc(2, 1128), 128},
+                {}
+            };
+            LocAndSize drecs[] = {
+                {DiskLoc(1, 1100), 100},
+                {DiskLoc(2, 1256), 744},
+                {}
+            };
+            assertStateV1RS(&txn, recs, drecs, NULL, &em, md);
+        }
+    }
 }
@@ -264,6 +264,12 @@ namespace mongo {
         return NULL;
     }
 
+    void DummyExtentManager::prefetchRecords( const std::vector<DiskLoc>& locs ) const {
+    }
+
+    void DummyExtentManager::prefetchRange( const DiskLoc& start, int len ) const {
+    }
+
     Record* DummyExtentManager::recordForV1( const DiskLoc& loc ) const {
         if ( static_cast<size_t>( loc.a() ) >= _extents.size() )
             return NULL;
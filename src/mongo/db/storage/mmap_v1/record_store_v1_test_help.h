@@ -138,6 +138,10 @@ namespace mongo {
 
         virtual RecordFetcher* recordNeedsFetch( const DiskLoc& loc ) const;
 
+        virtual void prefetchRecords( const std::vector<DiskLoc>& locs ) const;
+
+        virtual void prefetchRange( const DiskLoc& start, int len ) const;
+
         virtual Extent* extentForV1( const DiskLoc& loc ) const;
 
         virtual DiskLoc extentLocForV1( const DiskLoc& loc ) const;
@@ -111,6 +111,14 @@ namespace mongo {
         // normally this will just go back to the RecordStore and convert
         // but this gives the iterator an oppurtnity to optimize
         virtual RecordData dataFor( const DiskLoc& loc ) const = 0;
+
+        // Hints that the caller is going to read on through most of the remaining records in
+        // order, so that the iterator may start bringing records into memory ahead of getNext().
+        // Calling it again has no effect.  Iterators which can't make use of it ignore it.
+        virtual void setSequentialScanHint() { }
+
+        // How many read-aheads has the iterator started since setSequentialScanHint()?
+        virtual long long readAheadCount() const { return 0; }
     };
 
 
@@ -167,6 +175,24 @@ namespace mongo {
                                                   const DocWriter* doc,
                                                   bool enforceQuota ) = 0;
 
+        /**
+         * Inserts the documents in order, appending their locations to 'locsOut'. Stops at the
+         * first failure, whose status is returned. Storage engines can override this to share
+         * the per-insert setup across the batch.
+         */
+        virtual Status insertRecords( OperationContext* txn,
+                                      const std::vector<const DocWriter*>& docs,
+                                      std::vector<DiskLoc>* locsOut,
+                                      bool enforceQuota ) {
+            for ( size_t i = 0; i < docs.size(); i++ ) {
+                StatusWith<DiskLoc> loc = insertRecord( txn, docs[i], enforceQuota );
+                if ( !loc.isOK() )
+                    return loc.getStatus();
+                locsOut->push_back( loc.getValue() );
+            }
+            return Status::OK();
+        }
+
         /**
          * @param notifier - this is called if the document is moved
          *                   it is to be called after the document has been written to new
@@ -204,6 +230,26 @@ namespace mongo {
         virtual RecordFetcher* recordNeedsFetch( OperationContext* txn,
                                                  const DiskLoc& loc ) const { return NULL; }
 
+        /**
+         * Hints that the records at 'locs', which are sorted in DiskLoc order, are about to be
+         * read, so that the storage engine can start bringing them into memory in an order that
+         * suits it.  Must not fail: DiskLocs which don't name a record may be ignored.
+         *
+         * Storage engines which can't make use of the hint need not implement this.
+         */
+        virtual void prefetchRecords( OperationContext* txn,
+                                      const std::vector<DiskLoc>& locs ) const { }
+
+        /**
+         * Brings the record at 'loc' into memory before returning, so that an operation on it
+         * soon after doesn't wait for storage.  Unlike prefetchRecords, this waits for the read.
+         *
+         * The default implementation reads the record.
+         */
+        virtual void touchRecord( OperationContext* txn, const DiskLoc& loc ) const {
+            dataFor( txn, loc );
+        }
+
         /**
          * returned iterator owned by caller
          * Default arguments return all items in record store.
@@ -311,6 +357,13 @@ namespace mongo {
         virtual bool isDataValid( const RecordData& recData ) = 0;
         virtual size_t dataSize( const RecordData& recData ) = 0;
         virtual void inserted( const RecordData& recData, const DiskLoc& newLocation ) = 0;
+
+        /**
+         * For an online compact (CompactOptions::online), where the indexes are kept, each move
+         * of a record is announced to this before the record is copied, as for an update which
+         * moves a document.  NULL for an offline compact.
+         */
+        virtual UpdateMoveNotifier* moveNotifier() { return NULL; }
     };
 
     struct ValidateResults {
@@ -0,0 +1,162 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/storage/record_store_test_harness.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/storage/record_data.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/db/storage/storage_bench.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
+
+using std::string;
+using std::vector;
+
+namespace mongo {
+
+namespace {
+
+    const size_t kOpsPerThread = 2000;
+    const size_t kScanLength = 100;
+    const string kRecord( 100, 'x' );
+
+    /**
+     * The record store and per thread state shared by the benchmarks at one thread count.
+     * Each thread works on the records it inserted.
+     */
+    class RecordStoreBench {
+    public:
+        explicit RecordStoreBench( size_t numThreads )
+            : _helper( newHarnessHelper() ),
+              _rs( _helper->newNonCappedRecordStore() ),
+              _numThreads( numThreads ),
+              _locs( numThreads ),
+              _iterators( numThreads ) {
+
+            for ( size_t i = 0; i < numThreads; i++ )
+                _txns.push_back( _helper->newOperationContext() );
+        }
+
+        ~RecordStoreBench() {
+            for ( size_t i = 0; i < _numThreads; i++ ) {
+                delete _iterators[i];
+                delete _txns[i];
+            }
+        }
+
+        void run() {
+            bench( "insert", &RecordStoreBench::insert );
+            bench( "pointRead", &RecordStoreBench::pointRead );
+            bench( "rangeScan", &RecordStoreBench::rangeScan );
+            bench( "updateInPlace", &RecordStoreBench::updateInPlace );
+            bench( "saveRestore", &RecordStoreBench::saveRestore );
+        }
+
+    private:
+        typedef void (RecordStoreBench::*Op)( size_t thread, size_t i );
+
+        void bench( const string& name, Op op ) {
+            runStorageBenchmark( str::stream() << "RecordStore." << name,
+                                 _numThreads,
+                                 kOpsPerThread,
+                                 !_helper->supportsDocLocking(),
+                                 stdx::bind( op, this, stdx::placeholders::_1,
+                                             stdx::placeholders::_2 ) );
+        }
+
+        void insert( size_t thread, size_t i ) {
+            scoped_ptr<OperationContext> txn( _helper->newOperationContext() );
+            WriteUnitOfWork uow( txn.get() );
+            StatusWith<DiskLoc> loc = _rs->insertRecord( txn.get(),
+                                                         kRecord.c_str(),
+                                                         kRecord.size() + 1,
+                                                         false );
+            ASSERT_OK( loc.getStatus() );
+            uow.commit();
+            _locs[thread].push_back( loc.getValue() );
+        }
+
+        void pointRead( size_t thread, size_t i ) {
+            RecordData record = _rs->dataFor( _txns[thread], _locs[thread][i] );
+            ASSERT_EQUALS( static_cast<int>( kRecord.size() + 1 ), record.size() );
+        }
+
+        void rangeScan( size_t thread, size_t i ) {
+            scoped_ptr<RecordIterator> it( _rs->getIterator( _txns[thread], _locs[thread][i] ) );
+            for ( size_t n = 0; n < kScanLength && !it->isEOF(); n++ )
+                it->getNext();
+        }
+
+        void updateInPlace( size_t thread, size_t i ) {
+            mutablebson::DamageVector damages( 1 );
+            damages[0].sourceOffset = 0;
+            damages[0].targetOffset = 0;
+            damages[0].size = 8;
+
+            scoped_ptr<OperationContext> txn( _helper->newOperationContext() );
+            const DiskLoc& loc = _locs[thread][i];
+            WriteUnitOfWork uow( txn.get() );
+            ASSERT_OK( _rs->updateWithDamages( txn.get(), loc, _rs->dataFor( txn.get(), loc ),
+                                               "yyyyyyyy", damages ) );
+            uow.commit();
+        }
+
+        void saveRestore( size_t thread, size_t i ) {
+            RecordIterator*& it = _iterators[thread];
+            if ( !it || it->isEOF() ) {
+                delete it;
+                it = _rs->getIterator( _txns[thread] );
+            }
+            it->saveState();
+            ASSERT_TRUE( it->restoreState( _txns[thread] ) );
+            it->getNext();
+        }
+
+        scoped_ptr<HarnessHelper> _helper;
+        scoped_ptr<RecordStore> _rs;
+        const size_t _numThreads;
+        vector<OperationContext*> _txns;
+        vector< vector<DiskLoc> > _locs;
+        vector<RecordIterator*> _iterators;
+    };
+
+} // namespace
+
+    // Measures the throughput of the basic record store operations at each thread count.
+    TEST( RecordStoreBench, Throughput ) {
+        for ( size_t i = 0; i < kNumStorageBenchThreadCounts; i++ ) {
+            RecordStoreBench bench( kStorageBenchThreadCounts[i] );
+            bench.run();
+        }
+    }
+
+} // namespace mongo
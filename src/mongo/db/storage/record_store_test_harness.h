@@ -48,6 +48,12 @@ namespace mongo {
         virtual OperationContext* newOperationContext() {
             return new OperationContextNoop( newRecoveryUnit() );
         }
+
+        /**
+         * Whether operations on different threads may use the engine at once, like they do
+         * under document level locking.
+         */
+        virtual bool supportsDocLocking() const { return false; }
     };
 
     HarnessHelper* newHarnessHelper();
@@ -38,6 +38,7 @@
 
 using std::string;
 using std::stringstream;
+using std::vector;
 
 namespace mongo {
 
@@ -179,4 +180,43 @@ namespace mongo {
         }
     }
 
+    // Insert multiple records with one insertRecords call and verify that each
+    // returned location holds the matching document.
+    TEST( RecordStoreTestHarness, InsertRecordsUsingDocWriters ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
+
+        const int nToInsert = 10;
+        OwnedPointerVector<StringDocWriter> docWriters;
+        vector<const DocWriter*> docs;
+        for ( int i = 0; i < nToInsert; i++ ) {
+            stringstream ss;
+            ss << "record " << i;
+            docWriters.push_back( new StringDocWriter( ss.str(), false ) );
+            docs.push_back( docWriters[i] );
+        }
+
+        vector<DiskLoc> locs;
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                ASSERT_OK( rs->insertRecords( opCtx.get(), docs, &locs, false ) );
+                uow.commit();
+            }
+        }
+
+        ASSERT_EQUALS( static_cast<size_t>( nToInsert ), locs.size() );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( nToInsert, rs->numRecords( opCtx.get() ) );
+            for ( int i = 0; i < nToInsert; i++ ) {
+                stringstream ss;
+                ss << "record " << i;
+                ASSERT_EQUALS( ss.str(), rs->dataFor( opCtx.get(), locs[i] ).data() );
+            }
+        }
+    }
+
 } // namespace mongo
@@ -161,4 +161,33 @@ namespace mongo {
         }
     }
 
+    // Verify that calling touchRecord() on a record leaves its contents unchanged.
+    TEST( RecordStoreTestHarness, TouchRecord ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
+
+        string data = "my record";
+        DiskLoc loc;
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                StatusWith<DiskLoc> res = rs->insertRecord( opCtx.get(),
+                                                            data.c_str(),
+                                                            data.size() + 1,
+                                                            false );
+                ASSERT_OK( res.getStatus() );
+                loc = res.getValue();
+                uow.commit();
+            }
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            // XXX does not verify the record was brought into memory
+            rs->touchRecord( opCtx.get(), loc );
+            ASSERT_EQUALS( data, rs->dataFor( opCtx.get(), loc ).data() );
+        }
+    }
+
 } // namespace mongo
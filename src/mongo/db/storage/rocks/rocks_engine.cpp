@@ -39,8 +39,11 @@
 
 #include <rocksdb/comparator.h>
 #include <rocksdb/db.h>
+#include <rocksdb/filter_policy.h>
 #include <rocksdb/slice.h>
+#include <rocksdb/slice_transform.h>
 #include <rocksdb/options.h>
+#include <rocksdb/table.h>
 #include <rocksdb/utilities/write_batch_with_index.h>
 
 #include "mongo/db/catalog/collection_options.h"
@@ -49,6 +52,7 @@
 #include "mongo/db/storage/rocks/rocks_record_store.h"
 #include "mongo/db/storage/rocks/rocks_recovery_unit.h"
 #include "mongo/db/storage/rocks/rocks_sorted_data_impl.h"
+#include "mongo/db/storage/table_storage_options.h"
 #include "mongo/util/log.h"
 
 #define ROCKS_TRACE log()
@@ -61,6 +65,27 @@ namespace mongo {
     const std::string RocksEngine::kOrderingPrefix("indexordering-");
     const std::string RocksEngine::kCollectionPrefix("collection-");
 
+    namespace {
+        // about 1% false positives
+        const int kIndexBloomBitsPerKey = 10;
+
+        const uint32_t kIndexMemtableBloomBits = 1024 * 1024;
+
+        // Every column family is opened with the same options, so there is nowhere to keep
+        // storage options for one table.
+        Status checkTableOptions(const BSONObj& storageEngine) {
+            auto options = TableStorageOptions::parse(storageEngine);
+            if (!options.isOK()) {
+                return options.getStatus();
+            }
+            if (!options.getValue().isDefault()) {
+                return Status(ErrorCodes::InvalidOptions,
+                              "rocksdb does not support storage options for a single table");
+            }
+            return Status::OK();
+        }
+    }
+
     // TODO make create/drop operations support rollback?
 
     RocksEngine::RocksEngine(const std::string& path)
@@ -127,13 +152,14 @@ namespace mongo {
             }
         }
         _db.reset(db);
+        _snapshotManager.reset(new RocksSnapshotManager(db));
     }
 
     RocksEngine::~RocksEngine() {}
 
     RecoveryUnit* RocksEngine::newRecoveryUnit() {
         // TODO  change this to false once higher level code explicitly commits every transaction
-        return new RocksRecoveryUnit(_db.get(), true);
+        return new RocksRecoveryUnit(_snapshotManager.get(), _db.get(), true);
     }
 
     Status RocksEngine::createRecordStore(OperationContext* opCtx,
@@ -143,6 +169,10 @@ namespace mongo {
         if (_existsColumnFamily(ident)) {
             return Status::OK();
         }
+        Status status = checkTableOptions(options.storageEngine);
+        if (!status.isOK()) {
+            return status;
+        }
         _db->Put(rocksdb::WriteOptions(), kCollectionPrefix + ident.toString(), rocksdb::Slice());
         return _createColumnFamily(_collectionOptions(), ident);
     }
@@ -171,6 +201,10 @@ namespace mongo {
         if (_existsColumnFamily(ident)) {
             return Status::OK();
         }
+        Status status = checkTableOptions(desc->infoObj().getObjectField("storageEngine"));
+        if (!status.isOK()) {
+            return status;
+        }
         auto keyPattern = desc->keyPattern();
 
         _db->Put(rocksdb::WriteOptions(), kOrderingPrefix + ident.toString(),
@@ -315,8 +349,14 @@ namespace mongo {
 
     rocksdb::ColumnFamilyOptions RocksEngine::_indexOptions(const Ordering& order) const {
         rocksdb::ColumnFamilyOptions options;
-        invariant( _collectionComparator.get() );
-        options.comparator = RocksSortedDataImpl::newRocksComparator(order);
+        // index keys are encoded to sort bytewise, so they keep the default comparator, and
+        // their first fields make up the bloom filters of the files and memtables
+        options.prefix_extractor.reset(RocksSortedDataImpl::newRocksPrefixExtractor(order));
+        options.memtable_prefix_bloom_bits = kIndexMemtableBloomBits;
+
+        rocksdb::BlockBasedTableOptions tableOptions;
+        tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(kIndexBloomBitsPerKey));
+        options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
         return options;
     }
 
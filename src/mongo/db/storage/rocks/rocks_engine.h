@@ -46,6 +46,7 @@
 #include "mongo/base/disallow_copying.h"
 #include "mongo/bson/ordering.h"
 #include "mongo/db/storage/kv/kv_engine.h"
+#include "mongo/db/storage/rocks/rocks_snapshot_manager.h"
 #include "mongo/util/string_map.h"
 
 namespace rocksdb {
@@ -96,6 +97,10 @@ namespace mongo {
             return true;
         }
 
+        virtual bool readsFromSnapshots() const override {
+            return true;
+        }
+
         virtual bool isDurable() const { return true; }
 
         virtual int64_t getIdentSize(OperationContext* opCtx,
@@ -114,6 +119,8 @@ namespace mongo {
         rocksdb::DB* getDB() { return _db.get(); }
         const rocksdb::DB* getDB() const { return _db.get(); }
 
+        RocksSnapshotManager* getSnapshotManager() { return _snapshotManager.get(); }
+
         /**
          * Returns a ReadOptions object that uses the snapshot contained in opCtx
          */
@@ -141,6 +148,9 @@ namespace mongo {
         boost::scoped_ptr<rocksdb::DB> _db;
         boost::scoped_ptr<rocksdb::Comparator> _collectionComparator;
 
+        // destroyed before _db, which it releases snapshots of
+        boost::scoped_ptr<RocksSnapshotManager> _snapshotManager;
+
         // Default column family is owned by the rocksdb::DB instance.
         rocksdb::ColumnFamilyHandle* _defaultHandle;
 
@@ -39,7 +39,9 @@
 #include "mongo/db/storage/kv/kv_engine.h"
 #include "mongo/db/storage/kv/kv_engine_test_harness.h"
 #include "mongo/db/storage/rocks/rocks_engine.h"
+#include "mongo/db/storage/rocks/rocks_recovery_unit.h"
 #include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
 
 namespace mongo {
     class RocksEngineHarnessHelper : public KVHarnessHelper {
@@ -66,4 +68,33 @@ namespace mongo {
     };
 
     KVHarnessHelper* KVHarnessHelper::create() { return new RocksEngineHarnessHelper(); }
+
+    TEST(RocksEngineTest, RecoveryUnitsShareSnapshotsBetweenCommits) {
+        unittest::TempDir dbpath("mongo-rocks-snapshot-test");
+        RocksEngine engine(dbpath.path());
+
+        boost::scoped_ptr<RocksRecoveryUnit> first(
+            dynamic_cast<RocksRecoveryUnit*>(engine.newRecoveryUnit()));
+        boost::scoped_ptr<RocksRecoveryUnit> second(
+            dynamic_cast<RocksRecoveryUnit*>(engine.newRecoveryUnit()));
+        ASSERT(first->snapshot() == second->snapshot());
+
+        engine.getSnapshotManager()->committed();
+        boost::scoped_ptr<RocksRecoveryUnit> third(
+            dynamic_cast<RocksRecoveryUnit*>(engine.newRecoveryUnit()));
+        ASSERT(first->snapshot() != third->snapshot());
+
+        BSONObjBuilder builder;
+        engine.getSnapshotManager()->appendStats(&builder);
+        BSONObj stats = builder.obj();
+        ASSERT_EQUALS(2, stats["open"].numberInt());
+        ASSERT_EQUALS(2, stats["taken"].numberLong());
+        ASSERT_EQUALS(1, stats["shared"].numberLong());
+
+        first->releaseSnapshot();
+        second->releaseSnapshot();
+        BSONObjBuilder afterRelease;
+        engine.getSnapshotManager()->appendStats(&afterRelease);
+        ASSERT_EQUALS(1, afterRelease.obj()["open"].numberInt());
+    }
 }
@@ -30,6 +30,7 @@
  */
 
 #include "mongo/db/storage/rocks/rocks_engine.h"
+#include "mongo/db/storage/rocks/rocks_server_status.h"
 
 #include "mongo/base/init.h"
 #include "mongo/db/global_environment_experiment.h"
@@ -43,7 +44,10 @@ namespace mongo {
         public:
             virtual ~RocksFactory(){}
             virtual StorageEngine* create( const StorageGlobalParams& params ) const {
-                return new KVStorageEngine(new RocksEngine(params.dbpath));
+                RocksEngine* engine = new RocksEngine(params.dbpath);
+                // Intentionally leaked.
+                new RocksServerStatusSection(engine);
+                return new KVStorageEngine(engine);
             }
         };
     } // namespace
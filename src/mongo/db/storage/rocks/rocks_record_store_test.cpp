@@ -62,6 +62,7 @@ namespace mongo {
             auto s = rocksdb::DB::Open(db_options, _tempDir.path(), cfs, &handles, &db);
             ASSERT(s.ok());
             _db.reset(db);
+            _snapshotManager.reset(new RocksSnapshotManager(db));
             delete handles[0];
             _cf.reset(handles[1]);
         }
@@ -70,12 +71,17 @@ namespace mongo {
             return new RocksRecordStore("foo.bar", "1", _db.get(), _cf);
         }
 
-        virtual RecoveryUnit* newRecoveryUnit() { return new RocksRecoveryUnit(_db.get(), true); }
+        virtual RecoveryUnit* newRecoveryUnit() {
+            return new RocksRecoveryUnit(_snapshotManager.get(), _db.get(), true);
+        }
+
+        virtual bool supportsDocLocking() const { return true; }
 
     private:
         string _testNamespace = "mongo-rocks-record-store-test";
         unittest::TempDir _tempDir;
         boost::scoped_ptr<rocksdb::DB> _db;
+        boost::scoped_ptr<RocksSnapshotManager> _snapshotManager;
         boost::shared_ptr<rocksdb::ColumnFamilyHandle> _cf;
     };
 
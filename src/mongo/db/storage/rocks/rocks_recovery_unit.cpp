@@ -40,17 +40,32 @@
 #include <rocksdb/write_batch.h>
 #include <rocksdb/utilities/write_batch_with_index.h>
 
+#include <boost/thread/tss.hpp>
+
+#include "mongo/db/concurrency/parallel_batch_lock.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
 
-    RocksRecoveryUnit::RocksRecoveryUnit(rocksdb::DB* db, bool defaultCommit)
-        : _db(db),
+    namespace {
+        // Each thread keeps a cleared write batch for its next unit of work, as most units of
+        // work are short and allocating a batch and its index is a large part of their cost.
+        boost::thread_specific_ptr<rocksdb::WriteBatchWithIndex> pooledWriteBatch;
+
+        // a batch which grew beyond this is freed instead, to bound what each thread holds on to
+        const size_t kMaxPooledWriteBatchBytes = 1024 * 1024;
+    }
+
+    RocksRecoveryUnit::RocksRecoveryUnit(RocksSnapshotManager* snapshotManager, rocksdb::DB* db,
+                                         bool defaultCommit)
+        : _snapshotManager(snapshotManager),
+          _db(db),
           _defaultCommit(defaultCommit),
           _writeBatch(),
-          _snapshot(NULL),
-          _destroyed(false) {}
+          _destroyed(false) {
+        invariant(_snapshotManager);
+    }
 
     RocksRecoveryUnit::~RocksRecoveryUnit() {
         if (!_destroyed) {
@@ -82,6 +97,7 @@ namespace mongo {
             log() << "uh oh: " << status.ToString();
             invariant( !"rocks write batch commit failed" );
         }
+        _snapshotManager->committed();
 
         for (auto& change : _changes) {
             change->commit();
@@ -89,11 +105,10 @@ namespace mongo {
         }
         _changes.clear();
         _deltaCounters.clear();
-        _writeBatch.reset();
+        _releaseWriteBatch();
 
         if ( _snapshot ) {
-            _db->ReleaseSnapshot( _snapshot );
-            _snapshot = _db->GetSnapshot();
+            _snapshot = _snapshotManager->getSnapshot();
         }
     }
 
@@ -116,6 +131,9 @@ namespace mongo {
     // lazily initialized because Recovery Units are sometimes initialized just for reading,
     // which does not require write batches
     rocksdb::WriteBatchWithIndex* RocksRecoveryUnit::writeBatch() {
+        if (!_writeBatch && pooledWriteBatch.get()) {
+            _writeBatch.reset(pooledWriteBatch.release());
+        }
         if (!_writeBatch) {
             // this assumes that default column family uses default comparator. change this if you
             // change default column family's comparator
@@ -126,6 +144,21 @@ namespace mongo {
         return _writeBatch.get();
     }
 
+    void RocksRecoveryUnit::_releaseWriteBatch() {
+        if (!_writeBatch) {
+            return;
+        }
+
+        if (pooledWriteBatch.get() ||
+            _writeBatch->GetWriteBatch()->GetDataSize() > kMaxPooledWriteBatchBytes) {
+            _writeBatch.reset();
+            return;
+        }
+
+        _writeBatch->Clear();
+        pooledWriteBatch.reset(_writeBatch.release());
+    }
+
     void RocksRecoveryUnit::registerChange(Change* change) { _changes.emplace_back(change); }
 
     void RocksRecoveryUnit::destroy() {
@@ -141,6 +174,7 @@ namespace mongo {
                 delete change;
             }
         }
+        _releaseWriteBatch();
 
         releaseSnapshot();
         _destroyed = true;
@@ -153,17 +187,17 @@ namespace mongo {
     // method to access the snapshot, and can initialize it before using it.
     const rocksdb::Snapshot* RocksRecoveryUnit::snapshot() {
         if ( !_snapshot ) {
-            _snapshot = _db->GetSnapshot();
+            _snapshot = _snapshotManager->getSnapshot();
+
+            // Replication batches no longer need to wait for this reader
+            parallelBatchSnapshotEstablished();
         }
 
-        return _snapshot;
+        return _snapshot.get();
     }
 
     void RocksRecoveryUnit::releaseSnapshot() {
-        if (_snapshot) {
-            _db->ReleaseSnapshot(_snapshot);
-            _snapshot = nullptr;
-        }
+        _snapshot.reset();
     }
 
     rocksdb::Status RocksRecoveryUnit::Get(rocksdb::ColumnFamilyHandle* columnFamily,
@@ -187,11 +221,13 @@ namespace mongo {
         return _db->Get(options, columnFamily, key, value);
     }
 
-    rocksdb::Iterator* RocksRecoveryUnit::NewIterator(rocksdb::ColumnFamilyHandle* columnFamily) {
+    rocksdb::Iterator* RocksRecoveryUnit::NewIterator(rocksdb::ColumnFamilyHandle* columnFamily,
+                                                      bool prefixSeek) {
         invariant(columnFamily != _db->DefaultColumnFamily());
 
         rocksdb::ReadOptions options;
         options.snapshot = snapshot();
+        options.total_order_seek = !prefixSeek;
         auto iterator = _db->NewIterator(options, columnFamily);
         if (_writeBatch && _writeBatch->GetWriteBatch()->Count() > 0) {
             iterator = _writeBatch->NewIteratorWithBase(columnFamily, iterator);
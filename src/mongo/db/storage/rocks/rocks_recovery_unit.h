@@ -32,6 +32,7 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <stack>
 #include <string>
 #include <vector>
@@ -42,6 +43,7 @@
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/db/storage/recovery_unit.h"
+#include "mongo/db/storage/rocks/rocks_snapshot_manager.h"
 
 namespace rocksdb {
     class DB;
@@ -61,7 +63,8 @@ namespace mongo {
     class RocksRecoveryUnit : public RecoveryUnit {
         MONGO_DISALLOW_COPYING(RocksRecoveryUnit);
     public:
-        RocksRecoveryUnit(rocksdb::DB* db, bool defaultCommit = false);
+        RocksRecoveryUnit(RocksSnapshotManager* snapshotManager, rocksdb::DB* db,
+                          bool defaultCommit = false);
         virtual ~RocksRecoveryUnit();
 
         virtual void beginUnitOfWork();
@@ -93,7 +96,12 @@ namespace mongo {
         rocksdb::Status Get(rocksdb::ColumnFamilyHandle* columnFamily, const rocksdb::Slice& key,
                             std::string* value);
 
-        rocksdb::Iterator* NewIterator(rocksdb::ColumnFamilyHandle* columnFamily);
+        /**
+         * An iterator which seeks in prefix mode only stays valid within the prefix of the key it
+         * seeks to, but lets RocksDB skip the files whose prefix bloom filters rule it out.
+         */
+        rocksdb::Iterator* NewIterator(rocksdb::ColumnFamilyHandle* columnFamily,
+                                       bool prefixSeek = false);
 
         void incrementCounter(const rocksdb::Slice& counterKey,
                               std::atomic<long long>* counter, long long delta);
@@ -114,13 +122,17 @@ namespace mongo {
     private:
         void _destroyInternal();
 
+        // hands the write batch back to this thread's pool, or frees it
+        void _releaseWriteBatch();
+
+        RocksSnapshotManager* _snapshotManager; // not owned
         rocksdb::DB* _db; // not owned
         bool _defaultCommit;
 
-        boost::scoped_ptr<rocksdb::WriteBatchWithIndex> _writeBatch; // owned
+        std::unique_ptr<rocksdb::WriteBatchWithIndex> _writeBatch; // owned
 
-        // bare because we need to call ReleaseSnapshot when we're done with this
-        const rocksdb::Snapshot* _snapshot; // owned
+        // possibly shared with other recovery units
+        RocksSnapshotManager::SnapshotHandle _snapshot;
 
         CounterMap _deltaCounters;
 
@@ -0,0 +1,114 @@
+// rocks_snapshot_manager.cpp
+
+/**
+*    Copyright (C) 2014 MongoDB Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/db/storage/rocks/rocks_snapshot_manager.h"
+
+#include <algorithm>
+
+#include <rocksdb/db.h>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    class RocksSnapshotManager::Releaser {
+    public:
+        explicit Releaser(RocksSnapshotManager* manager) : _manager(manager) {}
+
+        void operator()(const rocksdb::Snapshot* snapshot) const {
+            _manager->_release(snapshot);
+        }
+
+    private:
+        RocksSnapshotManager* _manager;
+    };
+
+    RocksSnapshotManager::RocksSnapshotManager(rocksdb::DB* db)
+        : _db(db), _epoch(0), _currentEpoch(0), _snapshotsTaken(0), _snapshotsShared(0) {
+        invariant(_db);
+    }
+
+    RocksSnapshotManager::~RocksSnapshotManager() {
+        invariant(_openSnapshots.empty());
+    }
+
+    RocksSnapshotManager::SnapshotHandle RocksSnapshotManager::getSnapshot() {
+        // declared before the lock so that it is let go of after it, as releasing a snapshot
+        // takes the lock
+        SnapshotHandle current;
+        boost::mutex::scoped_lock lk(_mutex);
+
+        // read before taking a snapshot, so that the snapshot sees at least what the epoch says
+        const uint64_t epoch = _epoch.load(std::memory_order_acquire);
+
+        current = _current.lock();
+        if (current && _currentEpoch == epoch) {
+            _snapshotsShared++;
+            return current;
+        }
+
+        SnapshotHandle snapshot(_db->GetSnapshot(), Releaser(this));
+        _openSnapshots[snapshot.get()] = curTimeMillis64();
+        _current = snapshot;
+        _currentEpoch = epoch;
+        _snapshotsTaken++;
+        return snapshot;
+    }
+
+    void RocksSnapshotManager::_release(const rocksdb::Snapshot* snapshot) {
+        {
+            boost::mutex::scoped_lock lk(_mutex);
+            invariant(_openSnapshots.erase(snapshot) == 1);
+        }
+        _db->ReleaseSnapshot(snapshot);
+    }
+
+    void RocksSnapshotManager::appendStats(BSONObjBuilder* builder) const {
+        boost::mutex::scoped_lock lk(_mutex);
+
+        long long oldestAgeMillis = 0;
+        if (!_openSnapshots.empty()) {
+            unsigned long long oldest = _openSnapshots.begin()->second;
+            for (auto it = _openSnapshots.begin(); it != _openSnapshots.end(); ++it) {
+                oldest = std::min(oldest, it->second);
+            }
+            const unsigned long long now = curTimeMillis64();
+            oldestAgeMillis = now > oldest ? static_cast<long long>(now - oldest) : 0;
+        }
+
+        builder->append("open", static_cast<int>(_openSnapshots.size()));
+        builder->append("oldestAgeMillis", oldestAgeMillis);
+        builder->append("taken", _snapshotsTaken);
+        builder->append("shared", _snapshotsShared);
+    }
+
+}
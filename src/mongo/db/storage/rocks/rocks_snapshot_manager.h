@@ -0,0 +1,110 @@
+// rocks_snapshot_manager.h
+
+/**
+*    Copyright (C) 2014 MongoDB Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/cstdint.h"
+
+namespace rocksdb {
+    class DB;
+    class Snapshot;
+}
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Hands out the snapshots of a rocksdb::DB. Taking a snapshot locks the DB, so rather than
+     * take one for each unit of work, readers which start between the same two commits share
+     * one: it can't miss anything that they could see. A snapshot is released when the last of
+     * the units of work using it lets go of it.
+     *
+     * Every commit must call committed() once its write is in the DB.
+     */
+    class RocksSnapshotManager {
+        MONGO_DISALLOW_COPYING(RocksSnapshotManager);
+    public:
+        typedef boost::shared_ptr<const rocksdb::Snapshot> SnapshotHandle;
+
+        explicit RocksSnapshotManager(rocksdb::DB* db);
+
+        /**
+         * Must outlive every SnapshotHandle it has handed out.
+         */
+        ~RocksSnapshotManager();
+
+        /**
+         * @return a snapshot which sees every write committed before the call.
+         */
+        SnapshotHandle getSnapshot();
+
+        /**
+         * Starts a new epoch, so that the next reader takes a new snapshot.
+         */
+        void committed() { _epoch.fetch_add(1, std::memory_order_release); }
+
+        /**
+         * Appends the number of snapshots held and the age of the oldest one, which keeps
+         * compaction from dropping the versions it can see.
+         */
+        void appendStats(BSONObjBuilder* builder) const;
+
+    private:
+        class Releaser;
+
+        void _release(const rocksdb::Snapshot* snapshot);
+
+        rocksdb::DB* const _db; // not owned
+
+        std::atomic<uint64_t> _epoch;
+
+        mutable boost::mutex _mutex;
+
+        // the most recent snapshot, and the epoch it was taken in
+        boost::weak_ptr<const rocksdb::Snapshot> _current;
+        uint64_t _currentEpoch;
+
+        // when each snapshot still held was taken, in millis
+        std::map<const rocksdb::Snapshot*, unsigned long long> _openSnapshots;
+
+        long long _snapshotsTaken;
+        long long _snapshotsShared;
+    };
+
+}
@@ -35,11 +35,12 @@
 #include <cstdlib>
 #include <string>
 
-#include <rocksdb/comparator.h>
 #include <rocksdb/db.h>
 #include <rocksdb/iterator.h>
+#include <rocksdb/slice_transform.h>
 #include <rocksdb/utilities/write_batch_with_index.h>
 
+#include "mongo/db/storage/key_string.h"
 #include "mongo/db/storage/rocks/rocks_engine.h"
 #include "mongo/db/storage/rocks/rocks_record_store.h"
 #include "mongo/db/storage/rocks/rocks_recovery_unit.h"
@@ -52,11 +53,6 @@ namespace mongo {
 
         const int kTempKeyMaxSize = 1024; // Do the same as the heap implementation
 
-        rocksdb::Slice emptyByteSlice( "" );
-        rocksdb::SliceParts emptyByteSliceParts( &emptyByteSlice, 1 );
-
-        // functions for converting between BSONObj-DiskLoc pairs and strings/rocksdb::Slices
-
         /**
          * Strips the field names from a BSON object
          */
@@ -70,31 +66,6 @@ namespace mongo {
             return b.obj();
         }
 
-        /**
-         * Constructs a string containing the bytes of key followed by the bytes of loc.
-         *
-         * @param removeFieldNames true if the field names in key should be replaced with empty
-         * strings, and false otherwise. Useful because field names are not necessary in an index
-         * key, because the ordering of the fields is already known.
-         */
-        string makeString( const BSONObj& key, const DiskLoc loc, bool removeFieldNames = true ) {
-            const BSONObj& finalKey = removeFieldNames ? stripFieldNames( key ) : key;
-            string s( finalKey.objdata(), finalKey.objsize() );
-            s.append( reinterpret_cast<const char*>( &loc ), sizeof( DiskLoc ) );
-
-            return s;
-        }
-
-        /**
-         * Constructs an IndexKeyEntry from a slice containing the bytes of a BSONObject followed
-         * by the bytes of a DiskLoc
-         */
-        IndexKeyEntry makeIndexKeyEntry( const rocksdb::Slice& slice ) {
-            BSONObj key = BSONObj( slice.data() ).getOwned();
-            DiskLoc loc = *reinterpret_cast<const DiskLoc*>( slice.data() + key.objsize() );
-            return IndexKeyEntry( key, loc );
-        }
-
         string dupKeyError(const BSONObj& key) {
             stringstream ss;
             ss << "E11000 duplicate key error ";
@@ -114,7 +85,7 @@ namespace mongo {
                   _columnFamily(columnFamily),
                   _forward(forward),
                   _isCached(false),
-                  _comparator(o) {
+                  _order(o) {
                 _resetIterator(txn);
                 _checkStatus();
             }
@@ -255,11 +226,8 @@ namespace mongo {
             bool _reverseLocate( const BSONObj& key, const DiskLoc loc ) {
                 invariant( !_forward );
 
-                const IndexKeyEntry keyEntry( key, loc );
-
                 _isCached = false;
-                // assumes fieldNames already stripped if necessary
-                const string keyData = makeString( key, loc, false );
+                const string keyData = KeyString::makeForSeek( key, _order, loc );
                 _iterator->Seek( keyData );
                 _checkStatus();
 
@@ -293,8 +261,7 @@ namespace mongo {
                 invariant(_forward);
 
                 _isCached = false;
-                // assumes fieldNames already stripped if necessary
-                const string keyData = makeString( key, loc, false );
+                const string keyData = KeyString::makeForSeek( key, _order, loc );
                 _iterator->Seek( keyData );
                 _checkStatus();
                 if ( !_iterator->Valid() )
@@ -313,7 +280,8 @@ namespace mongo {
             }
 
             /**
-             * Loads the cached key and diskloc. Do not call if isEOF() is true
+             * Loads the cached key and diskloc. Do not call if isEOF() is true. The key is decoded
+             * from the entry, whose value is its type info.
              */
             void _load() const {
                 invariant( !isEOF() );
@@ -324,9 +292,10 @@ namespace mongo {
 
                 _isCached = true;
                 rocksdb::Slice slice = _iterator->key();
-                _cachedKey = BSONObj( slice.data() ).getOwned();
-                _cachedLoc = *reinterpret_cast<const DiskLoc*>( slice.data() +
-                                                                _cachedKey.objsize() );
+                const rocksdb::Slice typeInfo = _iterator->value();
+                _cachedKey = KeyString::toBson( slice.data(), slice.size(), _order,
+                                                StringData( typeInfo.data(), typeInfo.size() ) );
+                _cachedLoc = KeyString::decodeDiskLoc( slice.data(), slice.size() );
             }
 
             rocksdb::DB* _db;                                       // not owned
@@ -343,42 +312,42 @@ namespace mongo {
             BSONObj _savePositionObj;
             DiskLoc _savePositionLoc;
 
-            // Used for comparing elements in reverse iterators. Because the rocksdb::Iterator is
-            // only a forward iterator, it is sometimes necessary to compare index keys manually
-            // when implementing a reverse iterator.
-            IndexEntryComparison _comparator;
+            // Used for encoding the keys to seek to
+            const Ordering _order;
         };
 
         /**
-         * Custom comparator for rocksdb used to compare Index Entries by BSONObj and DiskLoc
+         * Extracts the encoding of the first field of an index entry, which is the prefix the
+         * bloom filters of an index's column family are made of.
          */
-        class RocksIndexEntryComparator : public rocksdb::Comparator {
+        class RocksIndexPrefixExtractor : public rocksdb::SliceTransform {
             public:
-                RocksIndexEntryComparator( const Ordering& order ): _indexComparator( order ) { }
+                RocksIndexPrefixExtractor( const Ordering& order ): _order( order ) { }
 
-                virtual int Compare(const rocksdb::Slice& a, const rocksdb::Slice& b) const {
-                    if (a.size() == 0 || b.size() == 0) {
-                        return a.size() == b.size() ? 0 : ((a.size() == 0) ? -1 : 1);
-                    }
-                    const IndexKeyEntry lhs = makeIndexKeyEntry( a );
-                    const IndexKeyEntry rhs = makeIndexKeyEntry( b );
-                    return _indexComparator.compare( lhs, rhs );
+                virtual const char* Name() const {
+                    // the bloom filters of existing files record the name of the extractor they
+                    // were built with, and won't be used for lookups if it changes
+                    return "mongodb.RocksIndexPrefixExtractor";
                 }
 
-                virtual const char* Name() const {
-                    // changing this means that any existing mongod instances using rocks storage
-                    // engine will not be able to start up again, because the comparator's name
-                    // will not match
-                    return "mongodb.RocksIndexEntryComparator";
+                virtual rocksdb::Slice Transform( const rocksdb::Slice& key ) const {
+                    return rocksdb::Slice( key.data(), _firstFieldSize( key ) );
                 }
 
-                virtual void FindShortestSeparator( std::string* start,
-                        const rocksdb::Slice& limit ) const { }
+                virtual bool InDomain( const rocksdb::Slice& key ) const {
+                    return _firstFieldSize( key ) > 0;
+                }
 
-                virtual void FindShortSuccessor( std::string* key ) const { }
+                virtual bool InRange( const rocksdb::Slice& dst ) const {
+                    return dst.size() > 0 && _firstFieldSize( dst ) == dst.size();
+                }
 
             private:
-                const IndexEntryComparison _indexComparator;
+                size_t _firstFieldSize( const rocksdb::Slice& key ) const {
+                    return KeyString::firstFieldSize( key.data(), key.size(), _order );
+                }
+
+                const Ordering _order;
         };
 
     class WriteBufferCopyIntoHandler : public rocksdb::WriteBatch::Handler {
@@ -470,15 +439,23 @@ namespace mongo {
 
         if ( !dupsAllowed ) {
             // TODO need key locking to support unique indexes.
-            Status status = dupKeyCheck( txn, key, loc );
-            if ( !status.isOK() ) {
-                return status;
+            const DiskLoc existing = _firstLocFor(txn, key);
+
+            if (!existing.isNull()) {
+                if (existing != loc) {
+                    return Status(ErrorCodes::DuplicateKey, dupKeyError(key));
+                }
+
+                // Already indexed, so neither the entry nor the count need writing.
+                return Status::OK();
             }
         }
 
         ru->incrementCounter(_numEntriesKey, &_numEntries, 1);
 
-        ru->writeBatch()->Put(_columnFamily.get(), makeString(key, loc), emptyByteSlice);
+        string typeInfo;
+        const string keyData = KeyString::make(key, _order, loc, &typeInfo);
+        ru->writeBatch()->Put(_columnFamily.get(), keyData, typeInfo);
 
         return Status::OK();
     }
@@ -489,7 +466,7 @@ namespace mongo {
                                       bool dupsAllowed) {
         RocksRecoveryUnit* ru = RocksRecoveryUnit::getRocksRecoveryUnit(txn);
 
-        const string keyData = makeString( key, loc );
+        const string keyData = KeyString::make( key, _order, loc );
 
         string dummy;
         if (ru->Get(_columnFamily.get(), keyData, &dummy).IsNotFound()) {
@@ -504,10 +481,9 @@ namespace mongo {
     Status RocksSortedDataImpl::dupKeyCheck(OperationContext* txn,
                                             const BSONObj& key,
                                             const DiskLoc& loc) {
-        boost::scoped_ptr<SortedDataInterface::Cursor> cursor(newCursor(txn, 1));
-        cursor->locate(key, DiskLoc(0, 0));
+        const DiskLoc existing = _firstLocFor(txn, key);
 
-        if (cursor->isEOF() || cursor->getKey() != key || cursor->getDiskLoc() == loc) {
+        if (existing.isNull() || existing == loc) {
             return Status::OK();
         } else {
             return Status(ErrorCodes::DuplicateKey, dupKeyError(key));
@@ -538,7 +514,9 @@ namespace mongo {
     Status RocksSortedDataImpl::touch(OperationContext* txn) const {
         boost::scoped_ptr<rocksdb::Iterator> itr;
         // no need to use snapshot to load into memory
-        itr.reset(_db->NewIterator(rocksdb::ReadOptions(), _columnFamily.get()));
+        rocksdb::ReadOptions options;
+        options.total_order_seek = true;
+        itr.reset(_db->NewIterator(options, _columnFamily.get()));
         itr->SeekToFirst();
         for (; itr->Valid(); itr->Next()) {
             invariant(itr->status().ok());
@@ -580,9 +558,25 @@ namespace mongo {
         return spaceUsedBytes + walSpaceUsed;
     }
 
+    DiskLoc RocksSortedDataImpl::_firstLocFor(OperationContext* txn, const BSONObj& key) const {
+        // The entries for key all start with its encoding for a null DiskLoc, and share its first
+        // field, so the lookup can seek in prefix mode and use the bloom filters.
+        const string prefix = KeyString::make(key, _order, DiskLoc());
+
+        auto ru = RocksRecoveryUnit::getRocksRecoveryUnit(txn);
+        boost::scoped_ptr<rocksdb::Iterator> it(ru->NewIterator(_columnFamily.get(), true));
+        it->Seek(prefix);
+        invariant(it->status().ok());
+
+        if (!it->Valid() || !it->key().starts_with(prefix)) {
+            return DiskLoc();
+        }
+        return KeyString::decodeDiskLoc(it->key().data(), it->key().size());
+    }
+
     // ownership passes to caller
-    rocksdb::Comparator* RocksSortedDataImpl::newRocksComparator( const Ordering& order ) {
-        return new RocksIndexEntryComparator( order );
+    rocksdb::SliceTransform* RocksSortedDataImpl::newRocksPrefixExtractor(const Ordering& order) {
+        return new RocksIndexPrefixExtractor( order );
     }
 
 }
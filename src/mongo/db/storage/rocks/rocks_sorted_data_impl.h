@@ -42,6 +42,7 @@
 namespace rocksdb {
     class ColumnFamilyHandle;
     class DB;
+    class SliceTransform;
 }
 
 namespace mongo {
@@ -56,10 +57,13 @@ namespace mongo {
     /**
      * Rocks implementation of the SortedDataInterface. Each index is stored as a single column
      * family. Each mapping from a BSONObj to a DiskLoc is stored as the key of a key-value pair
-     * in the column family. Consequently, each value in the database is simply an empty string.
-     * This is done because RocksDB only supports unique keys, and because RocksDB can take a custom
-     * comparator to use when ordering keys. We use a custom comparator which orders keys based
-     * first upon the BSONObj in the key, and uses the DiskLoc as a tiebreaker.
+     * in the column family, encoded by KeyString so that RocksDB's bytewise comparator orders
+     * keys based first upon the BSONObj, and uses the DiskLoc as a tiebreaker. This is done
+     * because RocksDB only supports unique keys. The encoding can't be decoded, so the value of
+     * each pair is the BSONObj, with its field names stripped.
+     *
+     * The bloom filters of the column family are built from the first field of each key, which
+     * the lookups for unique keys use by seeking in prefix mode. Scans seek in total order.
      */
     class RocksSortedDataImpl : public SortedDataInterface {
         MONGO_DISALLOW_COPYING( RocksSortedDataImpl );
@@ -96,13 +100,17 @@ namespace mongo {
 
         //rocks specific
 
-        // ownership passes to caller. Bare because we need to pass the bare pointer to the
-        // rocksdb::Options class
-        static rocksdb::Comparator* newRocksComparator( const Ordering& order );
+        // ownership passes to caller, to be held by the shared_ptr in rocksdb::Options
+        static rocksdb::SliceTransform* newRocksPrefixExtractor( const Ordering& order );
 
     private:
         typedef DiskLoc RecordId;
 
+        /**
+         * @return the DiskLoc of the first entry for key, or a null DiskLoc if there is none.
+         */
+        DiskLoc _firstLocFor(OperationContext* txn, const BSONObj& key) const;
+
         rocksdb::DB* _db; // not owned
 
         // Each index is stored as a single column family, so this stores the handle to the
@@ -29,10 +29,10 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/filesystem/operations.hpp>
 
-#include <rocksdb/comparator.h>
 #include <rocksdb/db.h>
 #include <rocksdb/options.h>
 #include <rocksdb/slice.h>
+#include <rocksdb/slice_transform.h>
 
 #include "mongo/db/storage/rocks/rocks_engine.h"
 #include "mongo/db/storage/sorted_data_interface_test_harness.h"
@@ -51,7 +51,8 @@ namespace mongo {
             std::vector<rocksdb::ColumnFamilyDescriptor> cfs;
             cfs.emplace_back();
             cfs.emplace_back("sroted_data_impl", rocksdb::ColumnFamilyOptions());
-            cfs[1].options.comparator = RocksSortedDataImpl::newRocksComparator(_order);
+            cfs[1].options.prefix_extractor.reset(
+                RocksSortedDataImpl::newRocksPrefixExtractor(_order));
             rocksdb::DBOptions db_options;
             db_options.create_if_missing = true;
             db_options.create_missing_column_families = true;
@@ -59,6 +60,7 @@ namespace mongo {
             auto s = rocksdb::DB::Open(db_options, _tempDir.path(), cfs, &handles, &db);
             ASSERT(s.ok());
             _db.reset(db);
+            _snapshotManager.reset(new RocksSnapshotManager(db));
             _cf.reset(handles[1]);
         }
 
@@ -67,13 +69,18 @@ namespace mongo {
                                            _order);
         }
 
-        virtual RecoveryUnit* newRecoveryUnit() { return new RocksRecoveryUnit(_db.get()); }
+        virtual RecoveryUnit* newRecoveryUnit() {
+            return new RocksRecoveryUnit(_snapshotManager.get(), _db.get());
+        }
+
+        virtual bool supportsDocLocking() const { return true; }
 
     private:
         Ordering _order;
         string _testNamespace = "mongo-rocks-sorted-data-test";
         unittest::TempDir _tempDir;
         scoped_ptr<rocksdb::DB> _db;
+        scoped_ptr<RocksSnapshotManager> _snapshotManager;
         shared_ptr<rocksdb::ColumnFamilyHandle> _cf;
     };
 
@@ -26,6 +26,8 @@
  *    it in the license file.
  */
 
+#include <boost/scoped_ptr.hpp>
+
 #include "mongo/bson/ordering.h"
 #include "mongo/db/catalog/head_manager.h"
 #include "mongo/db/diskloc.h"
@@ -84,6 +86,10 @@ namespace mongo {
         /**
          * Insert an entry into the index with the specified key and DiskLoc.
          *
+         * When duplicates are not allowed this is an insert-if-absent: implementations should
+         * look for an entry with 'key' in the same search which finds where to insert, rather
+         * than calling dupKeyCheck() first.
+         *
          * @param txn the transaction under which the insert takes place
          * @param dupsAllowed true if duplicate keys are allowed, and false
          *        otherwise
@@ -110,6 +116,44 @@ namespace mongo {
                              const DiskLoc& loc,
                              bool dupsAllowed) = 0;
 
+        /**
+         * Insert entries for each of 'keys', which are sorted, all with the DiskLoc 'loc'.
+         * Stops at the first key which can't be inserted and returns its error, as insert
+         * would.
+         *
+         * The default implementation inserts the keys one at a time; implementations which
+         * can keep their position between neighbouring keys should override it.
+         *
+         * @param numInsertedOut set to the number of keys inserted
+         */
+        virtual Status insertKeys(OperationContext* txn,
+                                  const std::vector<BSONObj>& keys,
+                                  const DiskLoc& loc,
+                                  bool dupsAllowed,
+                                  size_t* numInsertedOut) {
+            for (*numInsertedOut = 0; *numInsertedOut < keys.size(); ++*numInsertedOut) {
+                Status status = insert(txn, keys[*numInsertedOut], loc, dupsAllowed);
+                if (!status.isOK()) {
+                    return status;
+                }
+            }
+            return Status::OK();
+        }
+
+        /**
+         * Remove the entries for each of 'keys', which are sorted, all with the DiskLoc 'loc'.
+         *
+         * The default implementation removes the keys one at a time.
+         */
+        virtual void unindexKeys(OperationContext* txn,
+                                 const std::vector<BSONObj>& keys,
+                                 const DiskLoc& loc,
+                                 bool dupsAllowed) {
+            for (size_t i = 0; i < keys.size(); ++i) {
+                unindex(txn, keys[i], loc, dupsAllowed);
+            }
+        }
+
         /**
          * Return ErrorCodes::DuplicateKey if 'key' already exists in 'this'
          * index at a DiskLoc other than 'loc', and Status::OK() otherwise.
@@ -159,6 +203,18 @@ namespace mongo {
          */
         virtual Status touch(OperationContext* txn) const = 0;
 
+        /**
+         * Bring the part of 'this' index which holds 'key' into memory, such as
+         * the leaf page of a btree, ahead of an operation on 'key'.
+         *
+         * The default implementation positions a cursor on 'key', which
+         * reads the pages any lookup of 'key' needs.
+         */
+        virtual void touchKey(OperationContext* txn, const BSONObj& key) const {
+            boost::scoped_ptr<Cursor> cursor(newCursor(txn, 1));
+            cursor->locate(key, DiskLoc());
+        }
+
         /**
          * Return the number of entries in 'this' index.
          *
@@ -171,6 +227,29 @@ namespace mongo {
             return x;
         }
 
+        /**
+         * Count the entries with keys between 'startKey' and 'endKey' without visiting each of
+         * them, if the implementation can: from the shape of the tree, counts kept in its
+         * internal nodes, or statistics kept by the storage engine.
+         *
+         * If 'approximate' is false the count must be exact.  Otherwise an estimate, which may
+         * be off in either direction, is acceptable.
+         *
+         * The default implementation can't count a range.
+         *
+         * @return true if the count was stored in 'countOut', and false if the caller must
+         *         count the entries itself
+         */
+        virtual bool countKeysInRange(OperationContext* txn,
+                                      const BSONObj& startKey,
+                                      bool startKeyInclusive,
+                                      const BSONObj& endKey,
+                                      bool endKeyInclusive,
+                                      bool approximate,
+                                      long long* countOut) const {
+            return false;
+        }
+
         /**
          * Navigation
          *
@@ -0,0 +1,150 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/storage/sorted_data_interface_test_harness.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/storage/sorted_data_interface.h"
+#include "mongo/db/storage/storage_bench.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
+
+using std::string;
+using std::vector;
+
+namespace mongo {
+
+namespace {
+
+    const size_t kOpsPerThread = 2000;
+    const size_t kScanLength = 100;
+
+    /**
+     * The index and per thread state shared by the benchmarks at one thread count.  Each
+     * thread works on the keys it inserted, which don't overlap with the other threads' keys.
+     */
+    class SortedDataInterfaceBench {
+    public:
+        explicit SortedDataInterfaceBench( size_t numThreads )
+            : _helper( newHarnessHelper() ),
+              _sorted( _helper->newSortedDataInterface( false ) ),
+              _numThreads( numThreads ),
+              _cursors( numThreads ) {
+
+            for ( size_t i = 0; i < numThreads; i++ )
+                _txns.push_back( _helper->newOperationContext() );
+        }
+
+        ~SortedDataInterfaceBench() {
+            for ( size_t i = 0; i < _numThreads; i++ ) {
+                delete _cursors[i];
+                delete _txns[i];
+            }
+        }
+
+        void run() {
+            bench( "insert", &SortedDataInterfaceBench::insert );
+            bench( "pointRead", &SortedDataInterfaceBench::pointRead );
+            bench( "rangeScan", &SortedDataInterfaceBench::rangeScan );
+            bench( "saveRestore", &SortedDataInterfaceBench::saveRestore );
+        }
+
+    private:
+        typedef void (SortedDataInterfaceBench::*Op)( size_t thread, size_t i );
+
+        void bench( const string& name, Op op ) {
+            runStorageBenchmark( str::stream() << "SortedDataInterface." << name,
+                                 _numThreads,
+                                 kOpsPerThread,
+                                 !_helper->supportsDocLocking(),
+                                 stdx::bind( op, this, stdx::placeholders::_1,
+                                             stdx::placeholders::_2 ) );
+        }
+
+        static BSONObj key( size_t thread, size_t i ) {
+            return BSON( "" << static_cast<long long>( thread * kOpsPerThread + i ) );
+        }
+
+        static DiskLoc loc( size_t thread, size_t i ) {
+            return DiskLoc( 42, static_cast<int>( 2 * ( thread * kOpsPerThread + i ) ) );
+        }
+
+        // The readers' cursors are only opened after the inserts, so that they see them
+        SortedDataInterface::Cursor* cursor( size_t thread ) {
+            if ( !_cursors[thread] )
+                _cursors[thread] = _sorted->newCursor( _txns[thread], 1 );
+            return _cursors[thread];
+        }
+
+        void insert( size_t thread, size_t i ) {
+            scoped_ptr<OperationContext> txn( _helper->newOperationContext() );
+            WriteUnitOfWork uow( txn.get() );
+            ASSERT_OK( _sorted->insert( txn.get(), key( thread, i ), loc( thread, i ), true ) );
+            uow.commit();
+        }
+
+        void pointRead( size_t thread, size_t i ) {
+            ASSERT_TRUE( cursor( thread )->locate( key( thread, i ), loc( thread, i ) ) );
+        }
+
+        void rangeScan( size_t thread, size_t i ) {
+            SortedDataInterface::Cursor* c = cursor( thread );
+            c->locate( key( thread, i ), minDiskLoc );
+            for ( size_t n = 0; n < kScanLength && !c->isEOF(); n++ )
+                c->advance();
+        }
+
+        void saveRestore( size_t thread, size_t i ) {
+            SortedDataInterface::Cursor* c = cursor( thread );
+            if ( i == 0 || c->isEOF() )
+                c->locate( key( thread, 0 ), minDiskLoc );
+            c->savePosition();
+            c->restorePosition( _txns[thread] );
+            c->advance();
+        }
+
+        scoped_ptr<HarnessHelper> _helper;
+        scoped_ptr<SortedDataInterface> _sorted;
+        const size_t _numThreads;
+        vector<OperationContext*> _txns;
+        vector<SortedDataInterface::Cursor*> _cursors;
+    };
+
+} // namespace
+
+    // Measures the throughput of the basic index operations at each thread count.
+    TEST( SortedDataInterfaceBench, Throughput ) {
+        for ( size_t i = 0; i < kNumStorageBenchThreadCounts; i++ ) {
+            SortedDataInterfaceBench bench( kStorageBenchThreadCounts[i] );
+            bench.run();
+        }
+    }
+
+} // namespace mongo
@@ -210,6 +210,45 @@ namespace mongo {
         }
     }
 
+    // Insert a key with a DiskLoc before that of the existing entry for it, then
+    // the existing entry again, and verify that only the first entry exists in the
+    // index when duplicates are not allowed.
+    TEST( SortedDataInterface, InsertSameKeyAtLowerDiskLoc ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<SortedDataInterface> sorted( harnessHelper->newSortedDataInterface( true ) );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                ASSERT_OK( sorted->insert( opCtx.get(), key1, loc2, false ) );
+                ASSERT_OK( sorted->insert( opCtx.get(), key2, loc1, false ) );
+                uow.commit();
+            }
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                Status status = sorted->insert( opCtx.get(), key1, loc1, false );
+                ASSERT_EQUALS( ErrorCodes::DuplicateKey, status.code() );
+                status = sorted->insert( opCtx.get(), key2, loc3, false );
+                ASSERT_EQUALS( ErrorCodes::DuplicateKey, status.code() );
+
+                // Not a duplicate of itself.
+                status = sorted->insert( opCtx.get(), key1, loc2, false );
+                ASSERT( status.isOK() || ErrorCodes::DuplicateKeyValue == status.code() );
+                uow.commit();
+            }
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( 2, sorted->numEntries( opCtx.get() ) );
+        }
+    }
+
     // Insert the same key multiple times and verify that all entries exists
     // in the index when duplicates are allowed.
     TEST( SortedDataInterface, InsertSameKeyWithDupsAllowed ) {
@@ -335,4 +374,68 @@ namespace mongo {
         }
     }
 
+    // Insert sorted keys as one batch and verify that they are all in the index.
+    TEST( SortedDataInterface, InsertKeys ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<SortedDataInterface> sorted( harnessHelper->newSortedDataInterface( false ) );
+
+        std::vector<BSONObj> keys;
+        keys.push_back( key1 );
+        keys.push_back( key2 );
+        keys.push_back( key3 );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                size_t numInserted;
+                ASSERT_OK( sorted->insertKeys( opCtx.get(), keys, loc1, true, &numInserted ) );
+                ASSERT_EQUALS( 3U, numInserted );
+                uow.commit();
+            }
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( 3, sorted->numEntries( opCtx.get() ) );
+        }
+    }
+
+    // Insert a batch whose second key is a duplicate and verify that the batch stops there.
+    TEST( SortedDataInterface, InsertKeysStopsAtDuplicate ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<SortedDataInterface> sorted( harnessHelper->newSortedDataInterface( true ) );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                ASSERT_OK( sorted->insert( opCtx.get(), key2, loc2, false ) );
+                uow.commit();
+            }
+        }
+
+        std::vector<BSONObj> keys;
+        keys.push_back( key1 );
+        keys.push_back( key2 );
+        keys.push_back( key3 );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                size_t numInserted;
+                ASSERT_NOT_OK( sorted->insertKeys( opCtx.get(), keys, loc1, false,
+                                                   &numInserted ) );
+                ASSERT_EQUALS( 1U, numInserted );
+                uow.commit();
+            }
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( 2, sorted->numEntries( opCtx.get() ) );
+        }
+    }
+
 } // namespace mongo
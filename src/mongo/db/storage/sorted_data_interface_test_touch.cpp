@@ -80,4 +80,34 @@ namespace mongo {
         }
     }
 
+    // Verify that calling touchKey() on present and absent keys leaves the index unchanged.
+    TEST( SortedDataInterface, TouchKey ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<SortedDataInterface> sorted( harnessHelper->newSortedDataInterface( false ) );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            sorted->touchKey( opCtx.get(), key1 );
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                ASSERT_OK( sorted->insert( opCtx.get(), key1, loc1, true ) );
+                ASSERT_OK( sorted->insert( opCtx.get(), key3, loc3, true ) );
+                uow.commit();
+            }
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            // XXX does not verify the key was brought into memory
+            sorted->touchKey( opCtx.get(), key1 );
+            sorted->touchKey( opCtx.get(), key2 );
+            sorted->touchKey( opCtx.get(), key3 );
+            ASSERT_EQUALS( 2, sorted->numEntries( opCtx.get() ) );
+        }
+    }
+
 } // namespace mongo
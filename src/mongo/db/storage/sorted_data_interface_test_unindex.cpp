@@ -280,4 +280,41 @@ namespace mongo {
         }
     }
 
+    // Insert several keys and verify that a sorted batch of some of them can be unindexed.
+    TEST( SortedDataInterface, UnindexKeys ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<SortedDataInterface> sorted( harnessHelper->newSortedDataInterface( false ) );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                ASSERT_OK( sorted->insert( opCtx.get(), key1, loc1, true ) );
+                ASSERT_OK( sorted->insert( opCtx.get(), key2, loc1, true ) );
+                ASSERT_OK( sorted->insert( opCtx.get(), key3, loc1, true ) );
+                ASSERT_OK( sorted->insert( opCtx.get(), key2, loc2, true ) );
+                uow.commit();
+            }
+        }
+
+        std::vector<BSONObj> keys;
+        keys.push_back( key1 );
+        keys.push_back( key2 );
+        keys.push_back( key3 );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            {
+                WriteUnitOfWork uow( opCtx.get() );
+                sorted->unindexKeys( opCtx.get(), keys, loc1, true );
+                uow.commit();
+            }
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( 1, sorted->numEntries( opCtx.get() ) );
+        }
+    }
+
 } // namespace mongo
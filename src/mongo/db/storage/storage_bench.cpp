@@ -0,0 +1,105 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/storage_bench.h"
+
+#include <algorithm>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    const size_t kStorageBenchThreadCounts[] = { 1, 2, 4, 8 };
+    const size_t kNumStorageBenchThreadCounts =
+        sizeof(kStorageBenchThreadCounts) / sizeof(kStorageBenchThreadCounts[0]);
+
+    namespace {
+
+        void runThread(size_t thread,
+                       size_t opsPerThread,
+                       boost::mutex* serializer,
+                       const StorageBenchOp* op) {
+            for (size_t i = 0; i < opsPerThread; i++) {
+                if (serializer) {
+                    boost::mutex::scoped_lock lk(*serializer);
+                    (*op)(thread, i);
+                }
+                else {
+                    (*op)(thread, i);
+                }
+            }
+        }
+
+    } // namespace
+
+    double runStorageBenchmark(const std::string& name,
+                               size_t numThreads,
+                               size_t opsPerThread,
+                               bool serialize,
+                               const StorageBenchOp& op) {
+        boost::mutex serializer;
+        std::vector<boost::thread*> threads;
+
+        Timer timer;
+        for (size_t thread = 0; thread < numThreads; thread++) {
+            threads.push_back(new boost::thread(stdx::bind(&runThread,
+                                                           thread,
+                                                           opsPerThread,
+                                                           serialize ? &serializer : NULL,
+                                                           &op)));
+        }
+        for (size_t thread = 0; thread < numThreads; thread++) {
+            threads[thread]->join();
+            delete threads[thread];
+        }
+        const long long micros = std::max(timer.micros(), 1LL);
+
+        const long long ops = numThreads * opsPerThread;
+        const double opsPerSecond = ops * 1000.0 * 1000 / micros;
+
+        BSONObjBuilder result;
+        result.append("benchmark", name);
+        result.appendNumber("threads", static_cast<long long>(numThreads));
+        result.appendNumber("ops", ops);
+        result.appendNumber("micros", micros);
+        result.append("opsPerSecond", opsPerSecond);
+        log() << "STORAGE_BENCH " << result.obj().jsonString();
+
+        return opsPerSecond;
+    }
+
+} // namespace mongo
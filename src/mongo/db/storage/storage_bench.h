@@ -0,0 +1,65 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "mongo/stdx/functional.h"
+
+namespace mongo {
+
+    /**
+     * One operation of a storage benchmark, run as the 'i'th operation of thread 'thread'.
+     */
+    typedef stdx::function<void (size_t thread, size_t i)> StorageBenchOp;
+
+    /**
+     * Runs 'op' 'opsPerThread' times on each of 'numThreads' threads at once and logs the
+     * throughput as a line of JSON starting with "STORAGE_BENCH", for regression tracking:
+     *
+     *   STORAGE_BENCH { "benchmark" : "RecordStore.insert", "threads" : 4, "ops" : 8000,
+     *                   "micros" : 41250, "opsPerSecond" : 193939.4 }
+     *
+     * With 'serialize', the operations take turns, like they do on a storage engine which
+     * relies on collection locks.  Returns the operations per second.
+     */
+    double runStorageBenchmark(const std::string& name,
+                               size_t numThreads,
+                               size_t opsPerThread,
+                               bool serialize,
+                               const StorageBenchOp& op);
+
+    /**
+     * The thread counts the storage benchmarks run at, and how many there are.
+     */
+    extern const size_t kStorageBenchThreadCounts[];
+    extern const size_t kNumStorageBenchThreadCounts;
+
+} // namespace mongo
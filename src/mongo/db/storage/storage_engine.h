@@ -107,6 +107,14 @@ namespace mongo {
          */
         virtual bool supportsDocLocking() const = 0;
 
+        /**
+         * Returns whether the reads of a recovery unit see a point-in-time snapshot of the data,
+         * which stays unchanged by the writes of others. Only such engines may call
+         * parallelBatchSnapshotEstablished (see parallel_batch_lock.h), which allows replication
+         * batches on secondaries to apply while the reads carry on.
+         */
+        virtual bool readsFromSnapshots() const { return false; }
+
         /**
          * Returns if the engine supports a journalling concept.
          * This controls whether awaitCommit gets called or fsync to ensure data is on disk.
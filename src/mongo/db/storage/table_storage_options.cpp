@@ -0,0 +1,137 @@
+// table_storage_options.cpp
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/table_storage_options.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+namespace {
+
+    const int kMinBlockSize = 512;
+    const int kMaxBlockSize = 128 * 1024 * 1024;
+    const int kMaxLeafPageSize = 512 * 1024 * 1024;
+
+    bool isPowerOf2(int n) {
+        return n > 0 && (n & (n - 1)) == 0;
+    }
+
+    Status parseSize(const BSONElement& e, int min, int max, int* out) {
+        if (!e.isNumber()) {
+            return Status(ErrorCodes::BadValue, str::stream()
+                          << "storageEngine." << e.fieldNameStringData()
+                          << " must be a number");
+        }
+
+        const long long size = e.numberLong();
+        if (size < min || size > max || size != e.numberDouble()) {
+            return Status(ErrorCodes::BadValue, str::stream()
+                          << "storageEngine." << e.fieldNameStringData()
+                          << " must be a whole number of bytes between "
+                          << min << " and " << max);
+        }
+
+        *out = static_cast<int>(size);
+        return Status::OK();
+    }
+
+} // namespace
+
+    StatusWith<TableStorageOptions> TableStorageOptions::parse(const BSONObj& storageEngine) {
+        TableStorageOptions options;
+
+        BSONForEach(e, storageEngine) {
+            if (e.type() == Object) {
+                // Options for a particular storage engine.
+                continue;
+            }
+
+            const StringData name = e.fieldNameStringData();
+            if (name == "compressor") {
+                if (e.type() != String) {
+                    return StatusWith<TableStorageOptions>(ErrorCodes::BadValue,
+                        "storageEngine.compressor must be a string");
+                }
+
+                options.compressor = e.String();
+                if (options.compressor != "none" && options.compressor != "snappy"
+                        && options.compressor != "zlib") {
+                    return StatusWith<TableStorageOptions>(ErrorCodes::BadValue, str::stream()
+                        << "unknown storageEngine.compressor '" << options.compressor
+                        << "', the compressors are 'none', 'snappy' and 'zlib'");
+                }
+            }
+            else if (name == "blockSize") {
+                Status status = parseSize(e, kMinBlockSize, kMaxBlockSize, &options.blockSize);
+                if (!status.isOK())
+                    return StatusWith<TableStorageOptions>(status);
+
+                if (!isPowerOf2(options.blockSize)) {
+                    return StatusWith<TableStorageOptions>(ErrorCodes::BadValue,
+                        "storageEngine.blockSize must be a power of 2");
+                }
+            }
+            else if (name == "leafPageSize") {
+                Status status = parseSize(e, kMinBlockSize, kMaxLeafPageSize,
+                                          &options.leafPageSize);
+                if (!status.isOK())
+                    return StatusWith<TableStorageOptions>(status);
+            }
+            else if (name == "prefixCompression") {
+                if (e.type() != Bool) {
+                    return StatusWith<TableStorageOptions>(ErrorCodes::BadValue,
+                        "storageEngine.prefixCompression must be a boolean");
+                }
+                options.prefixCompression = e.Bool() ? YES : NO;
+            }
+            else {
+                return StatusWith<TableStorageOptions>(ErrorCodes::BadValue, str::stream()
+                    << "storageEngine." << name
+                    << " is neither a storage option nor an object of options for an engine");
+            }
+        }
+
+        if (options.blockSize && options.leafPageSize % options.blockSize != 0) {
+            return StatusWith<TableStorageOptions>(ErrorCodes::BadValue,
+                "storageEngine.leafPageSize must be a multiple of storageEngine.blockSize");
+        }
+
+        return StatusWith<TableStorageOptions>(options);
+    }
+
+    bool TableStorageOptions::isDefault() const {
+        return compressor.empty() && !blockSize && !leafPageSize
+            && prefixCompression == DEFAULT;
+    }
+
+} // namespace mongo
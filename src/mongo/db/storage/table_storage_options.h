@@ -0,0 +1,86 @@
+// table_storage_options.h
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "mongo/base/status_with.h"
+#include "mongo/bson/bsonobj.h"
+
+namespace mongo {
+
+    /**
+     * Engine neutral options for how a collection or index lays out its table, taken from the
+     * non-object fields of its "storageEngine" document:
+     *
+     *     storageEngine: {
+     *         compressor: "zlib",
+     *         blockSize: 4096,
+     *         leafPageSize: 32768,
+     *         prefixCompression: true,
+     *         wiredtiger: { ... } // options for one engine, which override the ones above
+     *     }
+     *
+     * Every field is optional and leaves the engine's default in place when it is missing. The
+     * values are checked for sanity here; each engine then checks that it can honour them when
+     * the table is created and fails the create if it can't.
+     */
+    struct TableStorageOptions {
+        enum PrefixCompression { DEFAULT, YES, NO };
+
+        TableStorageOptions() : blockSize(0), leafPageSize(0), prefixCompression(DEFAULT) {}
+
+        /**
+         * @param storageEngine the "storageEngine" document of collection options or an index
+         *        spec. Its object fields are skipped; any other field must be an option below.
+         */
+        static StatusWith<TableStorageOptions> parse(const BSONObj& storageEngine);
+
+        /**
+         * @return true if every option is left at the engine's default.
+         */
+        bool isDefault() const;
+
+        // "none", "snappy" or "zlib"; empty for the engine's default.
+        std::string compressor;
+
+        // The unit in which the table is allocated on disk, a power of 2; 0 for the default.
+        int blockSize;
+
+        // The largest size of a leaf page, a multiple of blockSize if both are set; 0 for the
+        // default.
+        int leafPageSize;
+
+        // Whether keys which share a prefix with the key before them store only what differs.
+        PrefixCompression prefixCompression;
+    };
+
+} // namespace mongo
@@ -0,0 +1,284 @@
+// wiredtiger_cache_monitor.cpp
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_cache_monitor.h"
+
+#include <algorithm>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    namespace {
+        // How many writes may run at once while the cache is healthy. 0 turns throttling off.
+        MONGO_EXPORT_SERVER_PARAMETER(wiredTigerWriteThrottleTickets, int, 128);
+
+        // The longest a write waits for a ticket before it goes ahead anyway.
+        MONGO_EXPORT_SERVER_PARAMETER(wiredTigerWriteThrottleMaxWaitMillis, int, 1000);
+
+        const int kSampleMillis = 100;
+
+        // Throttling starts as the cache gets this full or dirty and reaches a single ticket at
+        // WiredTiger's defaults for eviction_trigger and eviction_dirty_target, where it starts
+        // making application threads do eviction.
+        const double kUsedThrottleStart = 0.85;
+        const double kUsedThrottleFull = 0.95;
+        const double kDirtyThrottleStart = 0.60;
+        const double kDirtyThrottleFull = 0.80;
+
+        double pressure( double fraction, double start, double full ) {
+            return std::min( 1.0, std::max( 0.0, ( fraction - start ) / ( full - start ) ) );
+        }
+    }
+
+    WiredTigerCacheMonitor::WiredTigerCacheMonitor( WT_CONNECTION* conn )
+        : _conn( conn ),
+          _shuttingDown( false ),
+          _ticketsAllowed( std::max( wiredTigerWriteThrottleTickets, 1 ) ),
+          _ticketsOut( 0 ),
+          _writesThrottled( 0 ),
+          _writesTimedOut( 0 ),
+          _throttleMicros( 0 ),
+          _usedFraction( 0 ),
+          _dirtyFraction( 0 ),
+          _evictionServerBusyFraction( 0 ),
+          _checkpointStartMillis( -1 ),
+          _checkpoints( 0 ),
+          _lastCheckpointMillis( 0 ),
+          _maxCheckpointMillis( 0 ) {
+        _thread.reset( new boost::thread( stdx::bind( &WiredTigerCacheMonitor::_run, this ) ) );
+    }
+
+    WiredTigerCacheMonitor::~WiredTigerCacheMonitor() {
+        {
+            boost::mutex::scoped_lock lk( _mutex );
+            _shuttingDown = true;
+            _shutdownCond.notify_all();
+        }
+        _thread->join();
+    }
+
+    long long WiredTigerCacheMonitor::acquireWriteTicket() {
+        boost::mutex::scoped_lock lk( _mutex );
+        if ( wiredTigerWriteThrottleTickets <= 0 || _ticketsOut < _ticketsAllowed ) {
+            _ticketsOut++;
+            return 0;
+        }
+
+        const unsigned long long start = curTimeMicros64();
+        const boost::system_time deadline = boost::get_system_time()
+            + boost::posix_time::milliseconds( wiredTigerWriteThrottleMaxWaitMillis );
+        bool timedOut = false;
+        while ( _ticketsOut >= _ticketsAllowed && !timedOut ) {
+            timedOut = !_ticketFreed.timed_wait( lk, deadline );
+        }
+
+        const long long waited = curTimeMicros64() - start;
+        _ticketsOut++;
+        _writesThrottled++;
+        if ( timedOut )
+            _writesTimedOut++;
+        _throttleMicros += waited;
+        return waited;
+    }
+
+    void WiredTigerCacheMonitor::releaseWriteTicket() {
+        boost::mutex::scoped_lock lk( _mutex );
+        invariant( _ticketsOut > 0 );
+        _ticketsOut--;
+        _ticketFreed.notify_one();
+    }
+
+    int WiredTigerCacheMonitor::targetTickets( double usedFraction,
+                                               double dirtyFraction,
+                                               int maxTickets ) {
+        const double p = std::max( pressure( usedFraction, kUsedThrottleStart, kUsedThrottleFull ),
+                                   pressure( dirtyFraction, kDirtyThrottleStart,
+                                             kDirtyThrottleFull ) );
+        const int tickets = static_cast<int>( maxTickets - p * ( maxTickets - 1 ) + 0.5 );
+        return std::max( tickets, 1 );
+    }
+
+    int WiredTigerCacheMonitor::stepTickets( int current, int target ) {
+        // A quarter of the way there every sample, so a burst doesn't swing the throttle.
+        const int step = ( target - current ) / 4;
+        if ( step != 0 )
+            return current + step;
+        if ( current < target )
+            return current + 1;
+        if ( current > target )
+            return current - 1;
+        return current;
+    }
+
+    void WiredTigerCacheMonitor::appendStats( BSONObjBuilder* b ) const {
+        boost::mutex::scoped_lock lk( _mutex );
+        const long long now = curTimeMillis64();
+
+        BSONObjBuilder cache( b->subobjStart( "cache" ) );
+        cache.append( "usedPercent", _usedFraction * 100 );
+        cache.append( "dirtyPercent", _dirtyFraction * 100 );
+        cache.append( "evictionServerBusyPercent", _evictionServerBusyFraction * 100 );
+        cache.done();
+
+        BSONObjBuilder checkpoints( b->subobjStart( "checkpoints" ) );
+        checkpoints.appendNumber( "completed", _checkpoints );
+        checkpoints.appendNumber( "lastMillis", _lastCheckpointMillis );
+        checkpoints.appendNumber( "maxMillis", _maxCheckpointMillis );
+        checkpoints.appendBool( "running", _checkpointStartMillis >= 0 );
+        if ( _checkpointStartMillis >= 0 )
+            checkpoints.appendNumber( "runningMillis", now - _checkpointStartMillis );
+        checkpoints.done();
+
+        BSONObjBuilder throttle( b->subobjStart( "writeThrottle" ) );
+        throttle.append( "enabled", wiredTigerWriteThrottleTickets > 0 );
+        throttle.append( "ticketsAllowed", _ticketsAllowed );
+        throttle.append( "ticketsOut", _ticketsOut );
+        throttle.appendNumber( "writesThrottled", _writesThrottled );
+        throttle.appendNumber( "writesTimedOut", _writesTimedOut );
+        throttle.appendNumber( "totalWaitMicros", _throttleMicros );
+        throttle.done();
+    }
+
+    void WiredTigerCacheMonitor::_run() {
+        setThreadName( "WTCacheMonitor" );
+
+        WT_SESSION* session = NULL;
+        invariantWTOK( _conn->open_session( _conn, NULL, NULL, &session ) );
+
+        while ( true ) {
+            {
+                boost::mutex::scoped_lock lk( _mutex );
+                if ( !_shuttingDown ) {
+                    _shutdownCond.timed_wait( lk,
+                                              boost::posix_time::milliseconds( kSampleMillis ) );
+                }
+                if ( _shuttingDown )
+                    break;
+            }
+
+            Sample sample;
+            if ( _takeSample( session, &sample ) )
+                _onSample( sample, curTimeMillis64() );
+        }
+
+        invariantWTOK( session->close( session, NULL ) );
+    }
+
+    bool WiredTigerCacheMonitor::_takeSample( WT_SESSION* session, Sample* out ) const {
+        WT_CURSOR* c = NULL;
+        int ret = session->open_cursor( session, "statistics:", NULL, "statistics=(fast)", &c );
+        if ( ret != 0 ) {
+            LOG(1) << "WTCacheMonitor can't read statistics: " << wiredtiger_strerror( ret );
+            return false;
+        }
+
+        struct Stat {
+            int key;
+            int64_t* value;
+        } stats[] = {
+            { WT_STAT_CONN_CACHE_BYTES_INUSE, &out->bytesInUse },
+            { WT_STAT_CONN_CACHE_BYTES_DIRTY, &out->bytesDirty },
+            { WT_STAT_CONN_CACHE_BYTES_MAX, &out->bytesMax },
+            { WT_STAT_CONN_TXN_CHECKPOINT_RUNNING, &out->checkpointRunning },
+            { WT_STAT_CONN_CACHE_EVICTION_SERVER_EVICTING, &out->evictionServerEvicting },
+            { WT_STAT_CONN_CACHE_EVICTION_SERVER_NOT_EVICTING,
+              &out->evictionServerNotEvicting },
+        };
+
+        bool ok = true;
+        for ( size_t i = 0; ok && i < sizeof( stats ) / sizeof( stats[0] ); i++ ) {
+            const char* desc;
+            const char* pvalue;
+            uint64_t value;
+            c->set_key( c, stats[i].key );
+            ok = c->search( c ) == 0 && c->get_value( c, &desc, &pvalue, &value ) == 0;
+            *stats[i].value = static_cast<int64_t>( value );
+        }
+
+        invariantWTOK( c->close( c ) );
+        return ok;
+    }
+
+    void WiredTigerCacheMonitor::_onSample( const Sample& sample, long long nowMillis ) {
+        boost::mutex::scoped_lock lk( _mutex );
+
+        if ( sample.bytesMax > 0 ) {
+            _usedFraction = double( sample.bytesInUse ) / sample.bytesMax;
+            _dirtyFraction = double( sample.bytesDirty ) / sample.bytesMax;
+        }
+
+        // The eviction server counts the passes in which it evicted pages and the ones in which
+        // it only filled its queue.
+        const int64_t evicting = sample.evictionServerEvicting - _last.evictionServerEvicting;
+        const int64_t notEvicting =
+            sample.evictionServerNotEvicting - _last.evictionServerNotEvicting;
+        if ( evicting + notEvicting > 0 )
+            _evictionServerBusyFraction = double( evicting ) / ( evicting + notEvicting );
+
+        // Sampling finds checkpoints to within kSampleMillis.
+        if ( sample.checkpointRunning && _checkpointStartMillis < 0 ) {
+            _checkpointStartMillis = nowMillis;
+        }
+        else if ( !sample.checkpointRunning && _checkpointStartMillis >= 0 ) {
+            _lastCheckpointMillis = nowMillis - _checkpointStartMillis;
+            _maxCheckpointMillis = std::max( _maxCheckpointMillis, _lastCheckpointMillis );
+            _checkpoints++;
+            _checkpointStartMillis = -1;
+            LOG(1) << "WiredTiger checkpoint took about " << _lastCheckpointMillis << "ms";
+        }
+
+        _last = sample;
+
+        const int maxTickets = std::max( wiredTigerWriteThrottleTickets, 1 );
+        const int target = targetTickets( _usedFraction, _dirtyFraction, maxTickets );
+        const int allowed = stepTickets( _ticketsAllowed, target );
+        if ( allowed > _ticketsAllowed )
+            _ticketFreed.notify_all();
+        if ( allowed == 1 && _ticketsAllowed != 1 ) {
+            log() << "WiredTiger cache is " << int( _usedFraction * 100 ) << "% full and "
+                  << int( _dirtyFraction * 100 ) << "% dirty, throttling writes to one at a time";
+        }
+        _ticketsAllowed = allowed;
+    }
+
+} // namespace mongo
@@ -0,0 +1,130 @@
+// wiredtiger_cache_monitor.h
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <wiredtiger.h>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Watches WiredTiger's cache from a background thread and holds application writes back as
+     * the cache fills, so that eviction keeps up before WiredTiger has to stall writers itself.
+     *
+     * Every sample works out how many writes may run at once from how full and how dirty the
+     * cache is, and moves the number of write tickets a step towards it. A write waits for a
+     * ticket for at most wiredTigerWriteThrottleMaxWaitMillis, so that a ticket holder waiting
+     * on a lock held by the writer can't deadlock it.
+     *
+     * The samples also time checkpoints and track how busy the eviction server is, for
+     * serverStatus.
+     */
+    class WiredTigerCacheMonitor {
+        MONGO_DISALLOW_COPYING(WiredTigerCacheMonitor);
+    public:
+        explicit WiredTigerCacheMonitor( WT_CONNECTION* conn );
+        ~WiredTigerCacheMonitor();
+
+        /**
+         * Waits until a write may go ahead. Every call must be matched by releaseWriteTicket().
+         * @return the microseconds spent waiting
+         */
+        long long acquireWriteTicket();
+        void releaseWriteTicket();
+
+        void appendStats( BSONObjBuilder* b ) const;
+
+        /**
+         * @return how many writes may run at once with the cache this full and dirty, as
+         *         fractions of its size, out of maxTickets.
+         */
+        static int targetTickets( double usedFraction, double dirtyFraction, int maxTickets );
+
+        /**
+         * @return the number of tickets which is one step from current towards target.
+         */
+        static int stepTickets( int current, int target );
+
+    private:
+        struct Sample {
+            Sample() : bytesInUse( 0 ), bytesDirty( 0 ), bytesMax( 0 ), checkpointRunning( 0 ),
+                       evictionServerEvicting( 0 ), evictionServerNotEvicting( 0 ) {}
+
+            int64_t bytesInUse;
+            int64_t bytesDirty;
+            int64_t bytesMax;
+            int64_t checkpointRunning;
+            int64_t evictionServerEvicting;
+            int64_t evictionServerNotEvicting;
+        };
+
+        void _run();
+
+        bool _takeSample( WT_SESSION* session, Sample* out ) const;
+
+        void _onSample( const Sample& sample, long long nowMillis );
+
+        WT_CONNECTION* const _conn; // not owned
+
+        mutable boost::mutex _mutex;
+        boost::condition _ticketFreed;
+        boost::condition _shutdownCond;
+        bool _shuttingDown;
+
+        // Write throttling.
+        int _ticketsAllowed;
+        int _ticketsOut;
+        long long _writesThrottled;
+        long long _writesTimedOut;
+        long long _throttleMicros;
+
+        // Derived from the samples.
+        Sample _last;
+        double _usedFraction;
+        double _dirtyFraction;
+        double _evictionServerBusyFraction;
+        long long _checkpointStartMillis; // when the running checkpoint was first seen, or -1
+        long long _checkpoints;
+        long long _lastCheckpointMillis;
+        long long _maxCheckpointMillis;
+
+        boost::scoped_ptr<boost::thread> _thread;
+    };
+
+} // namespace mongo
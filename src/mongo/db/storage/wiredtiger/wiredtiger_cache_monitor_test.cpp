@@ -0,0 +1,71 @@
+// wiredtiger_cache_monitor_test.cpp
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_cache_monitor.h"
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    TEST(WiredTigerCacheMonitor, TargetTicketsFollowsCachePressure) {
+        // A healthy cache doesn't throttle.
+        ASSERT_EQUALS(128, WiredTigerCacheMonitor::targetTickets(0.5, 0.1, 128));
+        ASSERT_EQUALS(128, WiredTigerCacheMonitor::targetTickets(0.85, 0.6, 128));
+
+        // Halfway into either range halves the tickets, and the worse of the two counts.
+        ASSERT_EQUALS(51, WiredTigerCacheMonitor::targetTickets(0.9, 0.1, 101));
+        ASSERT_EQUALS(51, WiredTigerCacheMonitor::targetTickets(0.5, 0.7, 101));
+        ASSERT_EQUALS(51, WiredTigerCacheMonitor::targetTickets(0.9, 0.65, 101));
+
+        // Never fewer than one.
+        ASSERT_EQUALS(1, WiredTigerCacheMonitor::targetTickets(1.0, 0.1, 128));
+        ASSERT_EQUALS(1, WiredTigerCacheMonitor::targetTickets(0.5, 0.95, 128));
+        ASSERT_EQUALS(1, WiredTigerCacheMonitor::targetTickets(0.5, 0.1, 1));
+    }
+
+    TEST(WiredTigerCacheMonitor, StepTicketsMovesGradually) {
+        ASSERT_EQUALS(100, WiredTigerCacheMonitor::stepTickets(128, 16));
+        ASSERT_EQUALS(44, WiredTigerCacheMonitor::stepTickets(16, 128));
+        ASSERT_EQUALS(2, WiredTigerCacheMonitor::stepTickets(3, 1));
+        ASSERT_EQUALS(2, WiredTigerCacheMonitor::stepTickets(1, 2));
+        ASSERT_EQUALS(5, WiredTigerCacheMonitor::stepTickets(5, 5));
+
+        int tickets = 128;
+        for (int i = 0; i < 40; i++) {
+            tickets = WiredTigerCacheMonitor::stepTickets(tickets, 1);
+        }
+        ASSERT_EQUALS(1, tickets);
+    }
+
+} // namespace mongo
@@ -34,11 +34,13 @@
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_index.h"
 
-#include <set>
+#include <algorithm>
+#include <vector>
 
 #include "mongo/db/json.h"
 #include "mongo/db/catalog/index_catalog_entry.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/storage/key_string.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
@@ -50,7 +52,9 @@ namespace mongo {
 namespace {
     static const int TempKeyMaxSize = 1024; // this goes away with SERVER-3372
 
-    static const WiredTigerItem emptyItem(NULL, 0);
+    // The version of the key format, in the app_metadata of the tables. Tables from before it
+    // have BSON keys sorted by the mongo_index collator.
+    static const int kKeyStringFormatVersion = 1;
 
     bool hasFieldNames(const BSONObj& obj) {
         BSONForEach(e, obj) {
@@ -72,39 +76,42 @@ namespace {
     }
 
     /**
-     * Constructs an IndexKeyEntry from a slice containing the bytes of a BSONObject followed
-     * by the bytes of a DiskLoc
+     * @return the keyStringFormatVersion in the app_metadata of the table at uri, or 0 if there
+     *         is none.
      */
-    static IndexKeyEntry makeIndexKeyEntry(const WT_ITEM *keyCols) {
-        const char* data = reinterpret_cast<const char*>( keyCols->data );
-        BSONObj key( data );
-        if ( keyCols->size == static_cast<size_t>( key.objsize() ) ) {
-            // in unique mode
-            return IndexKeyEntry( key, DiskLoc() );
-        }
-        invariant( keyCols->size == key.objsize() + sizeof(DiskLoc) );
-        DiskLoc loc = reinterpret_cast<const DiskLoc*>( data + key.objsize() )[0];
-        return IndexKeyEntry( key, loc );
-    }
+    int keyStringFormatVersion(OperationContext* ctx, const std::string& uri) {
+        WiredTigerCursor curwrap("metadata:", WiredTigerSession::kMetadataCursorId, ctx);
+        WT_CURSOR* c = curwrap.get();
+        c->set_key(c, uri.c_str());
+        int ret = c->search(c);
+        if (ret == WT_NOTFOUND)
+            return 0;
+        invariantWTOK(ret);
 
-    WiredTigerItem _toItem( const BSONObj& key, const DiskLoc& loc,
-                            boost::scoped_array<char>*out ) {
-        size_t keyLen = key.objsize() + sizeof(DiskLoc);
-        out->reset( new char[keyLen] );
-        memcpy( out->get(), key.objdata(), key.objsize() );
-        memcpy( out->get() + key.objsize(), reinterpret_cast<const char*>(&loc), sizeof(DiskLoc) );
+        const char* config = NULL;
+        c->get_value(c, &config);
+        invariant(config);
 
-        return WiredTigerItem( out->get(), keyLen );
-    }
+        WiredTigerConfigParser topParser(config);
+        WT_CONFIG_ITEM metadata;
+        if (topParser.get("app_metadata", &metadata) != 0 ||
+            metadata.type != WT_CONFIG_ITEM::WT_CONFIG_ITEM_STRUCT) {
+            return 0;
+        }
 
-    DiskLoc _toDiskLoc( const WT_ITEM& item ) {
-        DiskLoc l;
-        memcpy( &l, item.data, sizeof(DiskLoc) );
-        return l;
+        WiredTigerConfigParser parser(metadata);
+        WT_CONFIG_ITEM version;
+        if (parser.get("keyStringFormatVersion", &version) != 0 ||
+            version.type != WT_CONFIG_ITEM::WT_CONFIG_ITEM_NUM) {
+            return 0;
+        }
+        return static_cast<int>(version.val);
     }
 
     /**
-     * Custom comparator used to compare Index Entries by BSONObj and DiskLoc
+     * Custom comparator used to compare Index Entries by BSONObj and DiskLoc. Only the tables
+     * from before the KeyString format use it, and it stays registered so they can be opened to
+     * be dropped.
      */
     struct WiredTigerIndexCollator : public WT_COLLATOR {
         public:
@@ -138,6 +145,22 @@ namespace {
             }
 
         private:
+            /**
+             * Constructs an IndexKeyEntry from a slice containing the bytes of a BSONObject
+             * followed by the bytes of a DiskLoc
+             */
+            static IndexKeyEntry makeIndexKeyEntry(const WT_ITEM *keyCols) {
+                const char* data = reinterpret_cast<const char*>( keyCols->data );
+                BSONObj key( data );
+                if ( keyCols->size == static_cast<size_t>( key.objsize() ) ) {
+                    // in unique mode
+                    return IndexKeyEntry( key, DiskLoc() );
+                }
+                invariant( keyCols->size == key.objsize() + sizeof(DiskLoc) );
+                DiskLoc loc = reinterpret_cast<const DiskLoc*>( data + key.objsize() )[0];
+                return IndexKeyEntry( key, loc );
+            }
+
             const IndexEntryComparison _indexComparator;
     };
 
@@ -163,26 +186,48 @@ namespace {
     }
 } // namespace
 
-    int WiredTigerIndex::Create(OperationContext* txn,
-                                const std::string& uri,
-                                const std::string& extraConfig,
-                                const IndexDescriptor* desc ) {
-        WT_SESSION* s = WiredTigerRecoveryUnit::get( txn )->getSession()->getSession();
-
+    StatusWith<std::string> WiredTigerIndex::generateCreateString(const StringData& extraConfig,
+                                                                  const IndexDescriptor& desc) {
         // Separate out a prefix and suffix in the default string. User configuration will
         // override values in the prefix, but not values in the suffix.
-        string default_config_pfx = "type=file,leaf_page_max=16k,";
-        // Indexes need to store the metadata for collation to work as expected.
-        string default_config_sfx = ",key_format=u,value_format=u,collator=mongo_index,app_metadata=";
+        str::stream ss;
+        ss << "type=file,leaf_page_max=16k,prefix_compression=true,";
+        ss << extraConfig << ",";
+
+        StatusWith<std::string> tableConfig =
+            WiredTigerUtil::getTableCreateConfig(desc.infoObj().getObjectField("storageEngine"));
+        if (!tableConfig.isOK())
+            return tableConfig;
+        ss << tableConfig.getValue();
+
+        // The keys compare bytewise, so no collator.
+        ss << "key_format=u,value_format=u,app_metadata=(keyStringFormatVersion="
+           << kKeyStringFormatVersion << ",infoObj=" << desc.infoObj().jsonString() << ")";
+        return StatusWith<std::string>(ss);
+    }
 
-        std::string config = default_config_pfx + extraConfig + default_config_sfx + desc->infoObj().jsonString();
+    int WiredTigerIndex::Create(OperationContext* txn,
+                                const std::string& uri,
+                                const std::string& config) {
+        WT_SESSION* s = WiredTigerRecoveryUnit::get( txn )->getSession()->getSession();
         LOG(1) << "create uri: " << uri << " config: " << config;
         return s->create(s, uri.c_str(), config.c_str());
     }
 
-    WiredTigerIndex::WiredTigerIndex(const std::string &uri )
+    WiredTigerIndex::WiredTigerIndex(OperationContext* ctx,
+                                     const std::string& uri,
+                                     const IndexDescriptor* desc)
         : _uri( uri ),
-          _instanceId( WiredTigerSession::genCursorId() ) {
+          _instanceId( WiredTigerSession::genCursorId() ),
+          _ordering( Ordering::make( desc->keyPattern() ) ) {
+        const int version = keyStringFormatVersion( ctx, uri );
+        if ( version != kKeyStringFormatVersion ) {
+            severe() << "Index " << desc->indexNamespace() << " was created with key format "
+                     << version << " of an earlier development version, rather than "
+                     << kKeyStringFormatVersion << ". Drop and rebuild it, after starting with"
+                     << " another storage engine or version if need be.";
+            fassertFailedNoTrace(28636);
+        }
     }
 
     Status WiredTigerIndex::insert(OperationContext* txn,
@@ -200,6 +245,7 @@ namespace {
             return Status(ErrorCodes::KeyTooLong, msg);
         }
 
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
         WiredTigerCursor curwrap(_uri, _instanceId, txn);
         WT_CURSOR *c = curwrap.get();
 
@@ -214,6 +260,7 @@ namespace {
         invariant(loc.isValid());
         invariant(!hasFieldNames(key));
 
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
         WiredTigerCursor curwrap(_uri, _instanceId, txn);
         WT_CURSOR *c = curwrap.get();
         invariant( c );
@@ -221,6 +268,55 @@ namespace {
         _unindex( c, key, loc, dupsAllowed );
     }
 
+    Status WiredTigerIndex::insertKeys(OperationContext* txn,
+                                       const std::vector<BSONObj>& keys,
+                                       const DiskLoc& loc,
+                                       bool dupsAllowed,
+                                       size_t* numInsertedOut) {
+        invariant(!loc.isNull());
+        invariant(loc.isValid());
+
+        // One cursor for all the keys, which being sorted are near each other in the tree.
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
+        WiredTigerCursor curwrap(_uri, _instanceId, txn);
+        WT_CURSOR *c = curwrap.get();
+
+        for (*numInsertedOut = 0; *numInsertedOut < keys.size(); ++*numInsertedOut) {
+            const BSONObj& key = keys[*numInsertedOut];
+            invariant(!hasFieldNames(key));
+
+            if ( key.objsize() >= TempKeyMaxSize ) {
+                string msg = mongoutils::str::stream()
+                    << "WiredTigerIndex::insert: key too large to index, failing "
+                    << ' ' << key.objsize() << ' ' << key;
+                return Status(ErrorCodes::KeyTooLong, msg);
+            }
+
+            Status status = _insert( c, key, loc, dupsAllowed );
+            if ( !status.isOK() )
+                return status;
+        }
+        return Status::OK();
+    }
+
+    void WiredTigerIndex::unindexKeys(OperationContext* txn,
+                                      const std::vector<BSONObj>& keys,
+                                      const DiskLoc& loc,
+                                      bool dupsAllowed) {
+        invariant(!loc.isNull());
+        invariant(loc.isValid());
+
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
+        WiredTigerCursor curwrap(_uri, _instanceId, txn);
+        WT_CURSOR *c = curwrap.get();
+        invariant( c );
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            invariant(!hasFieldNames(keys[i]));
+            _unindex( c, keys[i], loc, dupsAllowed );
+        }
+    }
+
     void WiredTigerIndex::fullValidate(OperationContext* txn, bool full, long long *numKeysOut,
                                        BSONObjBuilder* output) const {
         IndexCursor cursor(*this, txn, true );
@@ -282,6 +378,26 @@ namespace {
         return Status::OK();
     }
 
+    void WiredTigerIndex::touchKey(OperationContext* txn, const BSONObj& key) const {
+        // search_near reads the leaf page which holds the key into the cache, without the
+        // positioning and copying out of the key that a full cursor locate does.
+        WiredTigerCursor curwrap(_uri, _instanceId, txn);
+        WT_CURSOR *c = curwrap.get();
+        invariant( c );
+
+        // Sorts just before the entries of the key, or is the one of a unique index.
+        const std::string keyData = KeyString::make( key, _ordering, DiskLoc() );
+        WiredTigerItem item( keyData );
+        c->set_key( c, item.Get() );
+
+        int cmp;
+        int ret = c->search_near( c, &cmp );
+        if ( ret != 0 && ret != WT_NOTFOUND ) {
+            // Only a hint; the real operation will report the error.
+            LOG(2) << "ignoring error prefetching index key: " << wiredtiger_strerror(ret);
+        }
+    }
+
     long long WiredTigerIndex::getSpaceUsedBytes( OperationContext* txn ) const {
         WiredTigerSession* session = WiredTigerRecoveryUnit::get(txn)->getSession();
         return static_cast<long long>( WiredTigerUtil::getIdentSize( session->getSession(),
@@ -291,7 +407,8 @@ namespace {
     bool WiredTigerIndex::isDup(WT_CURSOR *c, const BSONObj& key, const DiskLoc& loc ) {
         invariant( unique() );
         // First check whether the key exists.
-        WiredTigerItem item( key.objdata(), key.objsize() );
+        const std::string keyData = KeyString::make( key, _ordering, DiskLoc() );
+        WiredTigerItem item( keyData );
         c->set_key( c, item.Get() );
         int ret = c->search(c);
         if ( ret == WT_NOTFOUND )
@@ -300,8 +417,53 @@ namespace {
 
         WT_ITEM value;
         invariantWTOK( c->get_value(c,&value) );
-        DiskLoc found = _toDiskLoc( value );
-        return found != loc;
+        UniqueLocs locs;
+        parseUniqueLocs( value, &locs );
+        return locs[0].loc != loc;
+    }
+
+    void WiredTigerIndex::parseUniqueLocs(const WT_ITEM& value, UniqueLocs* out) {
+        out->clear();
+        const char* data = static_cast<const char*>( value.data );
+        const char* const end = data + value.size;
+        while ( data < end ) {
+            UniqueLoc uniqueLoc;
+            invariant( end - data > static_cast<ptrdiff_t>( sizeof(DiskLoc) ) );
+            memcpy( &uniqueLoc.loc, data, sizeof(DiskLoc) );
+            data += sizeof(DiskLoc);
+
+            size_t size = 0;
+            for ( int shift = 0; ; shift += 7 ) {
+                invariant( data < end );
+                const unsigned char b = static_cast<unsigned char>( *data++ );
+                size |= static_cast<size_t>( b & 0x7f ) << shift;
+                if ( !( b & 0x80 ) )
+                    break;
+            }
+
+            invariant( static_cast<size_t>( end - data ) >= size );
+            uniqueLoc.typeInfo.assign( data, size );
+            data += size;
+            out->push_back( uniqueLoc );
+        }
+        invariant( !out->empty() );
+    }
+
+    std::string WiredTigerIndex::serializeUniqueLocs(const UniqueLocs& locs) {
+        std::string out;
+        for ( size_t i = 0; i < locs.size(); i++ ) {
+            out.append( reinterpret_cast<const char*>( &locs[i].loc ), sizeof(DiskLoc) );
+
+            size_t size = locs[i].typeInfo.size();
+            do {
+                const unsigned char b = size & 0x7f;
+                size >>= 7;
+                out.push_back( static_cast<char>( size ? b | 0x80 : b ) );
+            } while ( size );
+
+            out.append( locs[i].typeInfo );
+        }
+        return out;
     }
 
     SortedDataInterface::Cursor* WiredTigerIndex::newCursor(OperationContext* txn,
@@ -346,12 +508,172 @@ namespace {
         unsigned long long _count;
     };
 
+    /**
+     * Loads an empty index through a WiredTiger "bulk" cursor, which builds the tree directly
+     * instead of going through a transactional insert per key.  The keys have to come in index
+     * order, as they do from the index build's sorter.  The load is not transactional: what was
+     * added is there once the cursor is closed, whether or not the build goes on to commit.
+     *
+     * The encodings of the keys sort the way the sorter does, but for NumberLongs beyond 2^53
+     * which the sorter finds equal to a double.  Such keys, coming after one whose encoding is
+     * greater, are inserted the usual way once the cursor is closed.
+     */
+    class WiredTigerBulkLoadBuilderImpl : public SortedDataBuilderInterface {
+    public:
+        WiredTigerBulkLoadBuilderImpl(WiredTigerIndex* idx,
+                                      OperationContext* txn,
+                                      WiredTigerSessionCache* sessionCache,
+                                      WiredTigerSession* session,
+                                      WT_CURSOR* cursor,
+                                      bool dupsAllowed)
+            : _idx(idx),
+              _txn(txn),
+              _sessionCache(sessionCache),
+              _session(session),
+              _cursor(cursor),
+              _dupsAllowed(dupsAllowed) {
+        }
+
+        ~WiredTigerBulkLoadBuilderImpl() {
+            _close();
+        }
+
+        Status addKey(const BSONObj& key, const DiskLoc& loc) {
+            invariant(!loc.isNull());
+            invariant(loc.isValid());
+            invariant(!hasFieldNames(key));
+
+            if ( key.objsize() >= TempKeyMaxSize ) {
+                string msg = mongoutils::str::stream()
+                    << "WiredTigerIndex::insert: key too large to index, failing "
+                    << ' ' << key.objsize() << ' ' << key;
+                return Status(ErrorCodes::KeyTooLong, msg);
+            }
+
+            WiredTigerIndex::UniqueLoc uniqueLoc;
+            uniqueLoc.loc = loc;
+            const std::string keyData =
+                KeyString::make( key, _idx->ordering(), _idx->unique() ? DiskLoc() : loc,
+                                 &uniqueLoc.typeInfo );
+
+            if ( keyData < _lastKeyData ) {
+                _deferred.push_back( IndexKeyEntry( key.getOwned(), loc ) );
+                return Status::OK();
+            }
+
+            if ( _idx->unique() )
+                return _addUniqueKey( key, keyData, uniqueLoc );
+
+            _lastKeyData = keyData;
+            WiredTigerItem keyItem( keyData );
+            WiredTigerItem valueItem( uniqueLoc.typeInfo );
+            _cursor->set_key( _cursor, keyItem.Get() );
+            _cursor->set_value( _cursor, valueItem.Get() );
+            return wtRCToStatus( _cursor->insert( _cursor ) );
+        }
+
+        void commit(bool mayInterrupt) {
+            invariantWTOK( _flushUniqueKey() );
+            _close();
+
+            for ( size_t i = 0; i < _deferred.size(); i++ ) {
+                WriteUnitOfWork uow( _txn );
+                uassertStatusOK( _idx->insert( _txn, _deferred[i].key, _deferred[i].loc,
+                                               _dupsAllowed ) );
+                uow.commit();
+            }
+            _deferred.clear();
+        }
+
+    private:
+        /**
+         * A unique index has one entry per key whose value holds all its locs, so the locs of a
+         * key are gathered until the next key comes.
+         */
+        Status _addUniqueKey(const BSONObj& key,
+                             const std::string& keyData,
+                             const WiredTigerIndex::UniqueLoc& uniqueLoc) {
+            if ( !_locs.empty() && keyData == _lastKeyData ) {
+                if ( !_dupsAllowed )
+                    return dupKeyError( key );
+                _locs.push_back( uniqueLoc );
+                return Status::OK();
+            }
+
+            Status status = wtRCToStatus( _flushUniqueKey() );
+            if ( !status.isOK() )
+                return status;
+            _lastKeyData = keyData;
+            _locs.push_back( uniqueLoc );
+            return Status::OK();
+        }
+
+        int _flushUniqueKey() {
+            if ( _locs.empty() )
+                return 0;
+            std::sort( _locs.begin(), _locs.end(), lessByLoc );
+            const std::string value = WiredTigerIndex::serializeUniqueLocs( _locs );
+            WiredTigerItem keyItem( _lastKeyData );
+            WiredTigerItem valueItem( value );
+            _cursor->set_key( _cursor, keyItem.Get() );
+            _cursor->set_value( _cursor, valueItem.Get() );
+            _locs.clear();
+            return _cursor->insert( _cursor );
+        }
+
+        static bool lessByLoc(const WiredTigerIndex::UniqueLoc& lhs,
+                              const WiredTigerIndex::UniqueLoc& rhs) {
+            return lhs.loc < rhs.loc;
+        }
+
+        void _close() {
+            if ( !_cursor )
+                return;
+            invariantWTOK( _cursor->close( _cursor ) );
+            _cursor = NULL;
+            _sessionCache->releaseSession( _session );
+            _session = NULL;
+        }
+
+        WiredTigerIndex* _idx;
+        OperationContext* _txn;
+        WiredTigerSessionCache* _sessionCache; // not owned
+        WiredTigerSession* _session; // owned until _close
+        WT_CURSOR* _cursor; // the bulk cursor, owned until _close
+        bool _dupsAllowed;
+        std::string _lastKeyData; // the greatest key inserted, or the one of _locs
+        WiredTigerIndex::UniqueLocs _locs; // of _lastKeyData
+        std::vector<IndexKeyEntry> _deferred;
+    };
+
     SortedDataBuilderInterface* WiredTigerIndex::getBulkBuilder( OperationContext* txn,
                                                                  bool dupsAllowed ) {
         if ( !dupsAllowed ) {
             // if we don't allow dups, we better be unique
             invariant( unique() );
         }
+
+        // A bulk cursor can only be opened on an empty table with no other cursors open, and not
+        // inside the transaction of the build's own session.
+        WiredTigerSessionCache* cache = WiredTigerRecoveryUnit::get(txn)->getSessionCache();
+        WiredTigerSession* session = cache->getSession();
+        WT_SESSION* s = session->getSession();
+        WT_CURSOR* c = NULL;
+        int ret = s->open_cursor( s, _uri.c_str(), NULL, "bulk", &c );
+        if ( ret == EBUSY ) {
+            // Most likely cursors which idle sessions cached when the index was created.
+            cache->releaseSession( session );
+            cache->closeAll();
+            session = cache->getSession();
+            s = session->getSession();
+            ret = s->open_cursor( s, _uri.c_str(), NULL, "bulk", &c );
+        }
+
+        if ( ret == 0 )
+            return new WiredTigerBulkLoadBuilderImpl(this, txn, cache, session, c, dupsAllowed);
+
+        LOG(1) << "not bulk loading " << _uri << ": " << wiredtiger_strerror( ret );
+        cache->releaseSession( session );
         return new WiredTigerBuilderImpl(this, txn, dupsAllowed);
     }
 
@@ -367,7 +689,9 @@ namespace {
          _idx(idx),
          _forward(forward),
          _eof(true),
-         _uniqueLen( -1 ) {
+         _entryLoaded(false),
+         _uniquePos(0),
+         _keyCached(false) {
     }
 
     bool WiredTigerIndex::IndexCursor::pointsToSamePlaceAs( const SortedDataInterface::Cursor &genother) const {
@@ -389,24 +713,57 @@ namespace {
         invariant(!"aboutToDeleteBucket should not be called");
     }
 
+    void WiredTigerIndex::IndexCursor::_moved() {
+        _entryLoaded = false;
+        _keyCached = false;
+        _uniquePos = 0;
+    }
+
+    void WiredTigerIndex::IndexCursor::_loadEntry() const {
+        invariant( !_eof );
+        if ( _entryLoaded )
+            return;
+
+        WT_CURSOR *c = _cursor.get();
+        WT_ITEM item;
+        invariantWTOK( c->get_key(c, &item) );
+        _keyData.assign( static_cast<const char*>( item.data ), item.size );
+
+        invariantWTOK( c->get_value(c, &item) );
+        if ( _idx.unique() ) {
+            parseUniqueLocs( item, &_uniqueLocs );
+        }
+        else {
+            _typeInfo.assign( static_cast<const char*>( item.data ), item.size );
+        }
+        _entryLoaded = true;
+    }
+
+    const WiredTigerIndex::UniqueLoc& WiredTigerIndex::IndexCursor::_currentUniqueLoc() const {
+        _loadEntry();
+        invariant( _uniquePos < _uniqueLocs.size() );
+        return _uniqueLocs[ _forward ? _uniquePos : _uniqueLocs.size() - 1 - _uniquePos ];
+    }
+
     bool WiredTigerIndex::IndexCursor::_locate(const BSONObj &key, const DiskLoc& loc) {
-        _uniqueLen = -1;
         WT_CURSOR *c = _cursor.get();
 
+        // The key of a unique index entry has no DiskLoc. Otherwise a null loc starts at the
+        // first entry of the key, or at the last one for a reverse cursor.
         DiskLoc searchLoc = loc;
-        // Null cursors should start at the zero key to maintain search ordering in the
-        // collator.
-        // Reverse cursors should start on the last matching key.
-        if (loc.isNull())
-            searchLoc = _forward ? DiskLoc(0, 0) : DiskLoc(INT_MAX, INT_MAX);
+        if ( _idx.unique() )
+            searchLoc = DiskLoc();
+        else if ( loc.isNull() && !_forward )
+            searchLoc = DiskLoc(INT_MAX, INT_MAX);
 
-        boost::scoped_array<char> data;
-        WiredTigerItem myKey = _toItem( key, searchLoc, &data );
+        // key might be a query object from IndexEntryComparison::makeQueryObject().
+        const std::string keyData = KeyString::makeForSeek( key, _idx.ordering(), searchLoc );
+        WiredTigerItem myKey( keyData );
 
         int cmp = -1;
         c->set_key(c, myKey.Get() );
 
-
+        _moved();
         int ret = c->search_near(c, &cmp);
         if ( ret == WT_NOTFOUND ) {
             _eof = true;
@@ -441,43 +798,21 @@ namespace {
 
         // we're looking for a specific DiskLoc, lets see if we can find
 
-        WT_ITEM item;
-        invariantWTOK( c->get_value(c, &item ) );
-        _uniqueLen = item.size / sizeof(DiskLoc);
-        invariant( _uniqueLen > 0 );
-
+        _loadEntry();
+        const size_t numLocs = _uniqueLocs.size();
         if ( _forward ) {
-            _uniquePos = 0;
-            for ( ; _uniquePos < _uniqueLen; _uniquePos++ ) {
-                DiskLoc temp;
-                memcpy( &temp,
-                        reinterpret_cast<const char*>(item.data) + ( _uniquePos * sizeof(DiskLoc) ),
-                        sizeof(DiskLoc) );
-                if ( temp == loc )
-                    break;
-
-                if ( loc < temp )
-                    break;
-            }
+            while ( _uniquePos < numLocs && _uniqueLocs[_uniquePos].loc < loc )
+                _uniquePos++;
         }
         else {
-            _uniquePos = _uniqueLen-1;
-            for ( ; _uniquePos >= 0; _uniquePos-- ) {
-                DiskLoc temp;
-                memcpy( &temp,
-                        reinterpret_cast<const char*>(item.data) + ( _uniquePos * sizeof(DiskLoc) ),
-                        sizeof(DiskLoc) );
-                if ( temp == loc )
-                    break;
-
-                if ( temp < loc )
-                    break;
-            }
-            _uniquePos = _uniqueLen - 1 - _uniquePos;
+            while ( _uniquePos < numLocs && loc < _uniqueLocs[numLocs - 1 - _uniquePos].loc )
+                _uniquePos++;
         }
+        _keyCached = false;
 
-        if ( _uniquePos == _uniqueLen ) {
+        if ( _uniquePos == numLocs ) {
             // we need to move to next slot
+            _uniquePos = numLocs - 1;
             advance();
         }
 
@@ -516,45 +851,26 @@ namespace {
     }
 
     BSONObj WiredTigerIndex::IndexCursor::getKey() const {
-        WT_CURSOR *c = _cursor.get();
-        WT_ITEM keyItem;
-        int ret = c->get_key(c, &keyItem);
-        invariantWTOK(ret);
-        return makeIndexKeyEntry(&keyItem).key;
+        if ( _keyCached )
+            return _cachedKey;
+
+        _loadEntry();
+        const std::string& typeInfo = _idx.unique() ? _currentUniqueLoc().typeInfo : _typeInfo;
+        _cachedKey = KeyString::toBson( _keyData.data(), _keyData.size(), _idx.ordering(),
+                                        typeInfo );
+        _keyCached = true;
+        return _cachedKey;
     }
 
     DiskLoc WiredTigerIndex::IndexCursor::getDiskLoc() const {
         if ( _eof )
             return DiskLoc();
 
-        WT_CURSOR *c = _cursor.get();
-        WT_ITEM item;
-        if ( _idx.unique() ) {
-            invariantWTOK( c->get_value(c, &item ) );
-            if ( _uniqueLen == -1 ) {
-                // first time at this spot
-                _uniqueLen = item.size / sizeof(DiskLoc);
-                invariant( _uniqueLen > 0 );
-                _uniquePos = 0;
-            }
-
-            DiskLoc loc;
-            int posToUse = _uniquePos;
-            if ( !_forward )
-                posToUse = _uniqueLen - 1 - _uniquePos;
-
-
-
-            memcpy( &loc,
-                    reinterpret_cast<const char*>(item.data) + ( posToUse * sizeof(DiskLoc) ),
-                    sizeof(DiskLoc) );
+        if ( _idx.unique() )
+            return _currentUniqueLoc().loc;
 
-            invariant( posToUse >= 0 && posToUse < _uniqueLen );
-
-            return loc;
-        }
-        invariantWTOK( c->get_key(c, &item) );
-        return makeIndexKeyEntry( &item ).loc;
+        _loadEntry();
+        return KeyString::decodeDiskLoc( _keyData.data(), _keyData.size() );
     }
 
     void WiredTigerIndex::IndexCursor::advance() {
@@ -563,21 +879,15 @@ namespace {
             return;
 
         if ( _idx.unique() ) {
-            if ( _uniqueLen == -1 ) {
-                // we need to investigate
-                getDiskLoc();
-            }
-
-            _uniquePos++; // advance
-
-            if ( _uniquePos < _uniqueLen ) {
+            _loadEntry();
+            if ( _uniquePos + 1 < _uniqueLocs.size() ) {
+                _uniquePos++;
+                _keyCached = false;
                 return;
             }
-
         }
 
-        _uniqueLen = -1;
-
+        _moved();
 
         WT_CURSOR *c = _cursor.get();
         int ret = _forward ? c->next(c) : c->prev(c);
@@ -613,8 +923,10 @@ namespace {
 
     // ------------------------------
 
-    WiredTigerIndexUnique::WiredTigerIndexUnique( const std::string& uri )
-        : WiredTigerIndex( uri ) {
+    WiredTigerIndexUnique::WiredTigerIndexUnique( OperationContext* ctx,
+                                                  const std::string& uri,
+                                                  const IndexDescriptor* desc )
+        : WiredTigerIndex( ctx, uri, desc ) {
     }
 
     Status WiredTigerIndexUnique::_insert( WT_CURSOR* c,
@@ -622,8 +934,13 @@ namespace {
                                            const DiskLoc& loc,
                                            bool dupsAllowed ) {
 
-        WiredTigerItem keyItem( key.objdata(), key.objsize() );
-        WiredTigerItem valueItem( &loc, sizeof(loc) );
+        UniqueLocs locs( 1 );
+        locs[0].loc = loc;
+        const std::string keyData = KeyString::make( key, _ordering, DiskLoc(),
+                                                     &locs[0].typeInfo );
+        const std::string value = serializeUniqueLocs( locs );
+        WiredTigerItem keyItem( keyData );
+        WiredTigerItem valueItem( value );
         c->set_key( c, keyItem.Get() );
         c->set_value( c, valueItem.Get() );
         int ret = c->insert( c );
@@ -639,37 +956,24 @@ namespace {
         WT_ITEM old;
         invariantWTOK( c->get_value(c, &old ) );
 
-        std::set<DiskLoc> all;
+        UniqueLocs all;
+        parseUniqueLocs( old, &all );
 
-        // see if its already in the array
-        for ( size_t i = 0; i < (old.size/sizeof(DiskLoc)); i++ ) {
-            DiskLoc temp;
-            memcpy( &temp,
-                    reinterpret_cast<const char*>( old.data ) + ( i * sizeof(DiskLoc) ),
-                    sizeof(DiskLoc) );
-            if ( loc == temp )
+        // see if its already in the array, and where it would go if not
+        UniqueLocs::iterator it = all.begin();
+        for ( ; it != all.end() && !( loc < it->loc ); ++it ) {
+            if ( loc == it->loc )
                 return Status::OK();
-            all.insert( temp );
         }
 
         if ( !dupsAllowed ) {
             return dupKeyError(key);
         }
 
-        all.insert( loc );
-
-        // not in the array, add it to the back
-        size_t newSize = all.size() * sizeof(DiskLoc);
-        boost::scoped_array<char> bigger( new char[newSize] );
-
-        size_t offset = 0;
-        for ( std::set<DiskLoc>::const_iterator it = all.begin(); it != all.end(); ++it ) {
-            DiskLoc dl = *it;
-            memcpy( bigger.get() + offset, &dl, sizeof(DiskLoc) );
-            offset += sizeof(DiskLoc);
-        }
+        all.insert( it, locs[0] );
 
-        valueItem = WiredTigerItem( bigger.get(), newSize );
+        const std::string bigger = serializeUniqueLocs( all );
+        valueItem = WiredTigerItem( bigger );
         c->set_value( c, valueItem.Get() );
         return wtRCToStatus( c->update( c ) );
     }
@@ -678,7 +982,8 @@ namespace {
                                           const BSONObj& key,
                                           const DiskLoc& loc,
                                           bool dupsAllowed ) {
-        WiredTigerItem keyItem( key.objdata(), key.objsize() );
+        const std::string keyData = KeyString::make( key, _ordering, DiskLoc() );
+        WiredTigerItem keyItem( keyData );
         c->set_key( c, keyItem.Get() );
 
         if ( !dupsAllowed ) {
@@ -701,41 +1006,36 @@ namespace {
         WT_ITEM old;
         invariantWTOK( c->get_value(c, &old ) );
 
+        UniqueLocs all;
+        parseUniqueLocs( old, &all );
+
         // see if its in the array
-        size_t num = old.size / sizeof(DiskLoc);
-        for ( size_t i = 0; i < num; i++ ) {
-            DiskLoc temp;
-            memcpy( &temp,
-                    reinterpret_cast<const char*>( old.data ) + ( i * sizeof(DiskLoc) ),
-                    sizeof(DiskLoc) );
-            if ( loc != temp )
+        for ( size_t i = 0; i < all.size(); i++ ) {
+            if ( loc != all[i].loc )
                 continue;
 
             // we found it, now lets re-save array without it
-            size_t newSize = old.size - sizeof(DiskLoc);
-
-            if ( newSize == 0 ) {
+            if ( all.size() == 1 ) {
                 // nothing left, just delete entry
                 invariantWTOK( c->remove(c) );
                 return;
             }
 
-            boost::scoped_array<char> smaller( new char[newSize] );
-            size_t offset = i * sizeof(DiskLoc);
-            memcpy( smaller.get(), old.data, offset );
-            memcpy( smaller.get() + offset,
-                    reinterpret_cast<const char*>( old.data ) + offset + sizeof(DiskLoc),
-                    old.size - sizeof(DiskLoc) - offset );
-            WiredTigerItem valueItem = WiredTigerItem( smaller.get(), newSize );
+            all.erase( all.begin() + i );
+            const std::string smaller = serializeUniqueLocs( all );
+            WiredTigerItem valueItem( smaller );
             c->set_value( c, valueItem.Get() );
             invariantWTOK( c->update( c ) );
+            return;
         }
     }
 
     // ------------------------------
 
-    WiredTigerIndexStandard::WiredTigerIndexStandard( const std::string& uri )
-        : WiredTigerIndex( uri ) {
+    WiredTigerIndexStandard::WiredTigerIndexStandard( OperationContext* ctx,
+                                                      const std::string& uri,
+                                                      const IndexDescriptor* desc )
+        : WiredTigerIndex( ctx, uri, desc ) {
     }
 
     Status WiredTigerIndexStandard::_insert( WT_CURSOR* c,
@@ -744,10 +1044,12 @@ namespace {
                                              bool dupsAllowed ) {
         invariant( dupsAllowed );
 
-        boost::scoped_array<char> data;
-        WiredTigerItem item = _toItem( key, loc, &data );
-        c->set_key(c, item.Get() );
-        c->set_value(c, &emptyItem);
+        std::string typeInfo;
+        const std::string keyData = KeyString::make( key, _ordering, loc, &typeInfo );
+        WiredTigerItem keyItem( keyData );
+        WiredTigerItem valueItem( typeInfo );
+        c->set_key(c, keyItem.Get() );
+        c->set_value(c, valueItem.Get() );
         return wtRCToStatus( c->insert(c) );
     }
 
@@ -756,8 +1058,8 @@ namespace {
                                             const DiskLoc& loc,
                                             bool dupsAllowed ) {
         invariant( dupsAllowed );
-        boost::scoped_array<char> data;
-        WiredTigerItem item = _toItem( key, loc, &data);
+        const std::string keyData = KeyString::make( key, _ordering, loc );
+        WiredTigerItem item( keyData );
         c->set_key(c, item.Get() );
         int ret = c->remove(c);
         if (ret != WT_NOTFOUND) {
@@ -31,6 +31,7 @@
 #include <boost/shared_ptr.hpp>
 #include <wiredtiger.h>
 
+#include "mongo/bson/ordering.h"
 #include "mongo/db/storage/index_entry_comparison.h"
 #include "mongo/db/storage/sorted_data_interface.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
@@ -41,19 +42,42 @@ namespace mongo {
     class IndexDescriptor;
     struct WiredTigerItem;
 
+    /**
+     * The keys of the index entries are their KeyString encoding, so that WiredTiger compares them
+     * bytewise and can prefix compress them. The entries of a standard index are (key, DiskLoc)
+     * encodings with the type info of the key as their value. A unique index has one entry per
+     * key, whose value lists its DiskLocs with the type info of each, see UniqueLoc.
+     */
     class WiredTigerIndex : public SortedDataInterface {
     public:
 
+        /**
+         * Creates a configuration string suitable for 'config' parameter in WT_SESSION::create().
+         * Configuration string is constructed from:
+         *     built-in defaults
+         *     'extraConfig'
+         *     the engine neutral storage options in the storageEngine field of the index spec
+         *     storageEngine.wiredtiger.configString in the index spec
+         *     the index spec itself, as app_metadata
+         * Returns error status if the storage options are invalid.
+         */
+        static StatusWith<std::string> generateCreateString(const StringData& extraConfig,
+                                                            const IndexDescriptor& desc);
+
+        /**
+         * Creates a WiredTiger table suitable for implementing a MongoDB index.
+         * 'config' should be created with generateCreateString().
+         */
         static int Create(OperationContext* txn,
                           const std::string& uri,
-                          const std::string& extraConfig,
-                          const IndexDescriptor* desc);
+                          const std::string& config);
 
         /**
-         * @param unique - If this is a unique index.
-         *                 Note: even if unique, it may be allowed ot be non-unique at times.
+         * Checks that the table at uri was created with the key format of this version.
          */
-        WiredTigerIndex(const std::string &uri );
+        WiredTigerIndex(OperationContext* ctx,
+                        const std::string& uri,
+                        const IndexDescriptor* desc);
 
         virtual SortedDataBuilderInterface* getBulkBuilder(OperationContext* txn, bool dupsAllowed);
 
@@ -67,6 +91,17 @@ namespace mongo {
                              const DiskLoc& loc,
                              bool dupsAllowed);
 
+        virtual Status insertKeys(OperationContext* txn,
+                                  const std::vector<BSONObj>& keys,
+                                  const DiskLoc& loc,
+                                  bool dupsAllowed,
+                                  size_t* numInsertedOut);
+
+        virtual void unindexKeys(OperationContext* txn,
+                                 const std::vector<BSONObj>& keys,
+                                 const DiskLoc& loc,
+                                 bool dupsAllowed);
+
         virtual void fullValidate(OperationContext* txn, bool full, long long *numKeysOut,
                                   BSONObjBuilder* output) const;
 
@@ -76,6 +111,8 @@ namespace mongo {
 
         virtual Status touch(OperationContext* txn) const;
 
+        virtual void touchKey(OperationContext* txn, const BSONObj& key) const;
+
         virtual long long getSpaceUsedBytes( OperationContext* txn ) const;
 
         bool isDup(WT_CURSOR *c, const BSONObj& key, const DiskLoc& loc );
@@ -89,8 +126,26 @@ namespace mongo {
 
         uint64_t instanceId() const { return _instanceId; }
 
+        const Ordering& ordering() const { return _ordering; }
+
         virtual bool unique() const = 0;
 
+        /**
+         * A DiskLoc of a unique index entry, with the type info of its key.
+         */
+        struct UniqueLoc {
+            DiskLoc loc;
+            std::string typeInfo;
+        };
+        typedef std::vector<UniqueLoc> UniqueLocs;
+
+        /**
+         * Reads the value of a unique index entry: each DiskLoc, then the size of the type info
+         * of its key as a varint, then the type info. The DiskLocs are in ascending order.
+         */
+        static void parseUniqueLocs(const WT_ITEM& value, UniqueLocs* out);
+        static std::string serializeUniqueLocs(const UniqueLocs& locs);
+
     protected:
 
         virtual Status _insert( WT_CURSOR* c,
@@ -146,14 +201,34 @@ namespace mongo {
         private:
             bool _locate(const BSONObj &key, const DiskLoc& loc);
 
+            /**
+             * Reads the entry the WiredTiger cursor is on, unless it was read already. Do not
+             * call if isEOF() is true.
+             */
+            void _loadEntry() const;
+
+            /** The cursor moved to another entry, or to another DiskLoc of a unique one. */
+            void _moved();
+
+            const UniqueLoc& _currentUniqueLoc() const;
+
             OperationContext *_txn;
             WiredTigerCursor _cursor;
             const WiredTigerIndex& _idx; // not owned
             bool _forward;
             bool _eof;
 
-            mutable int _uniquePos;
-            mutable int _uniqueLen;
+            // Of the entry the WiredTiger cursor is on, valid if _entryLoaded.
+            mutable bool _entryLoaded;
+            mutable std::string _keyData;
+            mutable std::string _typeInfo; // standard indexes
+            mutable UniqueLocs _uniqueLocs; // unique indexes
+
+            // The position in _uniqueLocs, counted in the direction of the cursor.
+            size_t _uniquePos;
+
+            mutable bool _keyCached;
+            mutable BSONObj _cachedKey;
 
             // For save/restorePosition check
             RecoveryUnit* _savedForCheck;
@@ -163,12 +238,15 @@ namespace mongo {
 
         std::string _uri;
         uint64_t _instanceId;
+        const Ordering _ordering;
     };
 
 
     class WiredTigerIndexUnique : public WiredTigerIndex {
     public:
-        WiredTigerIndexUnique( const std::string& uri );
+        WiredTigerIndexUnique( OperationContext* ctx,
+                               const std::string& uri,
+                               const IndexDescriptor* desc );
 
         virtual bool unique() const { return true; }
 
@@ -185,7 +263,9 @@ namespace mongo {
 
     class WiredTigerIndexStandard : public WiredTigerIndex {
     public:
-        WiredTigerIndexStandard( const std::string& uri );
+        WiredTigerIndexStandard( OperationContext* ctx,
+                                 const std::string& uri,
+                                 const IndexDescriptor* desc );
 
         virtual bool unique() const { return false; }
 
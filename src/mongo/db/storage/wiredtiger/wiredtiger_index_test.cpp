@@ -68,17 +68,21 @@ namespace mongo {
             IndexDescriptor desc( NULL, "", spec );
 
             string uri = "table:" + ns;
-            invariantWTOK( WiredTigerIndex::Create( &txn, uri, "", &desc ) );
+            StatusWith<std::string> result = WiredTigerIndex::generateCreateString( "", desc );
+            invariant( result.isOK() );
+            invariantWTOK( WiredTigerIndex::Create( &txn, uri, result.getValue() ) );
 
             if ( unique )
-                return new WiredTigerIndexUnique( uri );
-            return new WiredTigerIndexStandard( uri );
+                return new WiredTigerIndexUnique( &txn, uri, &desc );
+            return new WiredTigerIndexStandard( &txn, uri, &desc );
         }
 
         virtual RecoveryUnit* newRecoveryUnit() {
             return new WiredTigerRecoveryUnit( _sessionCache );
         }
 
+        virtual bool supportsDocLocking() const { return true; }
+
     private:
         unittest::TempDir _dbpath;
         WT_CONNECTION* _conn;
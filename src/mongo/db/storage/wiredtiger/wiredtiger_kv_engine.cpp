@@ -134,6 +134,7 @@ namespace mongo {
         log() << "wiredtiger_open config: " << config;
         invariantWTOK(wiredtiger_open(path.c_str(), &_eventHandler, config.c_str(), &_conn));
         _sessionCache.reset( new WiredTigerSessionCache( this ) );
+        _cacheMonitor.reset( new WiredTigerCacheMonitor( _conn ) );
 
         _sizeStorerUri = "table:sizeStorer";
         {
@@ -151,6 +152,7 @@ namespace mongo {
         _sizeStorer.reset( NULL );
 
         _sessionCache.reset( NULL );
+        _cacheMonitor.reset( NULL );
 
         if ( _conn ) {
             invariantWTOK( _conn->close(_conn, NULL) );
@@ -213,7 +215,7 @@ namespace mongo {
     }
 
     RecoveryUnit* WiredTigerKVEngine::newRecoveryUnit() {
-        return new WiredTigerRecoveryUnit( _sessionCache.get() );
+        return new WiredTigerRecoveryUnit( _sessionCache.get(), _cacheMonitor.get() );
     }
 
     void WiredTigerKVEngine::setRecordStoreExtraOptions( const std::string& options ) {
@@ -273,15 +275,20 @@ namespace mongo {
     Status WiredTigerKVEngine::createSortedDataInterface( OperationContext* opCtx,
                                                           const StringData& ident,
                                                           const IndexDescriptor* desc ) {
-        return wtRCToStatus( WiredTigerIndex::Create( opCtx, _uri( ident ), _indexOptions, desc ) );
+        StatusWith<std::string> result =
+            WiredTigerIndex::generateCreateString( _indexOptions, *desc );
+        if ( !result.isOK() )
+            return result.getStatus();
+
+        return wtRCToStatus( WiredTigerIndex::Create( opCtx, _uri( ident ), result.getValue() ) );
     }
 
     SortedDataInterface* WiredTigerKVEngine::getSortedDataInterface( OperationContext* opCtx,
                                                                      const StringData& ident,
                                                                      const IndexDescriptor* desc ) {
         if ( desc->unique() )
-            return new WiredTigerIndexUnique( _uri( ident ) );
-        return new WiredTigerIndexStandard( _uri( ident ) );
+            return new WiredTigerIndexUnique( opCtx, _uri( ident ), desc );
+        return new WiredTigerIndexStandard( opCtx, _uri( ident ), desc );
     }
 
     Status WiredTigerKVEngine::dropSortedDataInterface( OperationContext* opCtx,
@@ -40,6 +40,7 @@
 
 #include "mongo/bson/ordering.h"
 #include "mongo/db/storage/kv/kv_engine.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_cache_monitor.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/util/elapsed_tracker.h"
 
@@ -60,6 +61,8 @@ namespace mongo {
 
         virtual bool supportsDocLocking() const;
 
+        virtual bool readsFromSnapshots() const { return true; }
+
         virtual bool isDurable() const { return _durable; }
 
         virtual RecoveryUnit* newRecoveryUnit();
@@ -105,6 +108,7 @@ namespace mongo {
         // wiredtiger specific
 
         WT_CONNECTION* getConnection() { return _conn; }
+        WiredTigerCacheMonitor* getCacheMonitor() { return _cacheMonitor.get(); }
         void dropAllQueued();
         bool haveDropsQueued() const;
 
@@ -120,6 +124,7 @@ namespace mongo {
         WT_CONNECTION* _conn;
         WT_EVENT_HANDLER _eventHandler;
         boost::scoped_ptr<WiredTigerSessionCache> _sessionCache;
+        boost::scoped_ptr<WiredTigerCacheMonitor> _cacheMonitor;
         bool _durable;
 
         string _rsOptions;
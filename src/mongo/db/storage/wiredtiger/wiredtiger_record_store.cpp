@@ -31,20 +31,31 @@
 
 #define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
 
+#include <algorithm>
+#include <deque>
+
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <wiredtiger.h>
 
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/oplog_hack.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/functional.h"
 #include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/log.h"
 #include "mongo/util/scopeguard.h"
+#include "mongo/util/time_support.h"
 
 //#define RS_ITERATOR_TRACE(x) log() << "WTRS::Iterator " << x
 #define RS_ITERATOR_TRACE(x)
@@ -89,8 +100,259 @@ namespace {
 
         return false;
     }
+
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(wiredTigerOplogStones, bool, true);
+
+    // An oplog is cut into about this many stones.
+    const int64_t kNumStones = 100;
+
+    // At startup, oplogs with more records than this have their stones estimated from a random
+    // sample rather than counted.
+    const int64_t kMaxRecordsToScanForStones = 100 * 1000;
+    const int64_t kSamplesPerStone = 10;
 } // namespace
 
+    /**
+     * Cuts a capped oplog into "stones": runs of consecutive records, oldest first, of about
+     * _minBytesPerStone bytes each.  While the oplog is over its size a background thread
+     * truncates the oldest stone with a single WT_SESSION::truncate, so inserts never delete.
+     */
+    class WiredTigerRecordStore::OplogStones {
+    public:
+        struct Stone {
+            Stone( int64_t records, int64_t bytes, const DiskLoc& lastRecord )
+                : records( records ), bytes( bytes ), lastRecord( lastRecord ) { }
+            int64_t records;
+            int64_t bytes;
+            DiskLoc lastRecord; // the newest record in the stone
+        };
+
+        /**
+         * Adds an insert to the stones once its unit of work commits.
+         */
+        class InsertChange : public RecoveryUnit::Change {
+        public:
+            InsertChange( OplogStones* stones, int64_t bytes, const DiskLoc& loc )
+                : _stones( stones ), _bytes( bytes ), _loc( loc ) { }
+            virtual void commit() { _stones->onInsertCommitted( _bytes, _loc ); }
+            virtual void rollback() { }
+
+        private:
+            OplogStones* _stones;
+            int64_t _bytes;
+            DiskLoc _loc;
+        };
+
+        OplogStones( WiredTigerRecordStore* rs, WiredTigerSessionCache* sessionCache )
+            : _rs( rs ),
+              _sessionCache( sessionCache ),
+              _minBytesPerStone( std::max( rs->_cappedMaxSize / kNumStones, int64_t(1) ) ),
+              _shuttingDown( false ),
+              _currentRecords( 0 ),
+              _currentBytes( 0 ) {
+        }
+
+        ~OplogStones() {
+            {
+                boost::mutex::scoped_lock lk( _mutex );
+                _shuttingDown = true;
+                _cond.notify_all();
+            }
+            if ( _thread )
+                _thread->join();
+        }
+
+        void start() {
+            _thread.reset( new boost::thread( stdx::bind( &OplogStones::_reclaimThread, this ) ) );
+        }
+
+        /**
+         * Cuts the records already in the oplog into stones.  They are counted if there are few
+         * of them and estimated from a random sample otherwise.
+         */
+        void createInitialStones( OperationContext* txn );
+
+        void onInsertCommitted( int64_t bytes, const DiskLoc& loc ) {
+            boost::mutex::scoped_lock lk( _mutex );
+            _currentRecords++;
+            _currentBytes += bytes;
+            if ( _currentLast < loc )
+                _currentLast = loc;
+            if ( _currentBytes < _minBytesPerStone )
+                return;
+            _stones.push_back( Stone( _currentRecords, _currentBytes, _currentLast ) );
+            _currentRecords = 0;
+            _currentBytes = 0;
+            _cond.notify_all();
+        }
+
+        /**
+         * Forgets the stones of records which have been deleted other than by the background
+         * thread: everything after lastKept, which removed records and bytes in all.
+         */
+        void removeStonesAfter( const DiskLoc& lastKept, int64_t records, int64_t bytes ) {
+            boost::mutex::scoped_lock lk( _mutex );
+            while ( !_stones.empty() && lastKept < _stones.back().lastRecord ) {
+                _currentRecords += _stones.back().records;
+                _currentBytes += _stones.back().bytes;
+                _stones.pop_back();
+            }
+            _currentRecords = std::max( _currentRecords - records, int64_t(0) );
+            _currentBytes = std::max( _currentBytes - bytes, int64_t(0) );
+            _currentLast = lastKept;
+        }
+
+        size_t numStones() const {
+            boost::mutex::scoped_lock lk( _mutex );
+            return _stones.size();
+        }
+
+    private:
+        bool _hasExcess() const {
+            return !_stones.empty() && _rs->dataSize( NULL ) > _rs->_cappedMaxSize;
+        }
+
+        void _reclaimThread();
+
+        /**
+         * @return false if the truncate conflicted with another transaction.
+         */
+        bool _truncateThrough( const DiskLoc& lastRecord );
+
+        WiredTigerRecordStore* _rs; // not owned
+        WiredTigerSessionCache* _sessionCache; // not owned
+        const int64_t _minBytesPerStone;
+
+        mutable boost::mutex _mutex;
+        boost::condition _cond;
+        bool _shuttingDown;
+        std::deque<Stone> _stones; // oldest first
+        int64_t _currentRecords; // the records committed since the newest stone
+        int64_t _currentBytes;
+        DiskLoc _currentLast;
+        boost::scoped_ptr<boost::thread> _thread;
+    };
+
+    void WiredTigerRecordStore::OplogStones::createInitialStones( OperationContext* txn ) {
+        const int64_t numRecords = _rs->numRecords( txn );
+        const int64_t dataSize = _rs->dataSize( txn );
+        if ( numRecords == 0 )
+            return;
+
+        WiredTigerCursor curwrap( _rs->GetURI(), _rs->instanceId(), txn );
+        WT_CURSOR* c = curwrap.get();
+        invariant( c );
+
+        if ( numRecords <= kMaxRecordsToScanForStones ) {
+            int ret;
+            while ( ( ret = c->next( c ) ) == 0 ) {
+                uint64_t key;
+                WT_ITEM value;
+                invariantWTOK( c->get_key( c, &key ) );
+                invariantWTOK( c->get_value( c, &value ) );
+                onInsertCommitted( value.size, _fromKey( key ) );
+            }
+            if ( ret != WT_NOTFOUND )
+                invariantWTOK( ret );
+            return;
+        }
+
+        // Every stone is assumed to hold the same number of records, of the average size.
+        const double avgRecordSize = static_cast<double>( dataSize ) / numRecords;
+        const int64_t recordsPerStone =
+            std::max( static_cast<int64_t>( _minBytesPerStone / avgRecordSize ), int64_t(1) );
+        const int64_t bytesPerStone = static_cast<int64_t>( recordsPerStone * avgRecordSize );
+        const int64_t wholeStones = numRecords / recordsPerStone;
+
+        log() << "estimating the stones of " << _rs->ns() << " from "
+              << wholeStones * kSamplesPerStone << " random records";
+
+        std::vector<DiskLoc> samples;
+        {
+            WT_SESSION* s = curwrap.getWTSession();
+            WT_CURSOR* random = NULL;
+            invariantWTOK( s->open_cursor( s, _rs->GetURI().c_str(), NULL, "next_random=true",
+                                           &random ) );
+            for ( int64_t i = 0; i < wholeStones * kSamplesPerStone; i++ ) {
+                invariantWTOK( random->next( random ) );
+                uint64_t key;
+                invariantWTOK( random->get_key( random, &key ) );
+                samples.push_back( _fromKey( key ) );
+            }
+            invariantWTOK( random->close( random ) );
+        }
+        std::sort( samples.begin(), samples.end() );
+
+        boost::mutex::scoped_lock lk( _mutex );
+        for ( int64_t i = 1; i <= wholeStones; i++ ) {
+            _stones.push_back( Stone( recordsPerStone, bytesPerStone,
+                                      samples[i * kSamplesPerStone - 1] ) );
+        }
+        _currentRecords = numRecords - wholeStones * recordsPerStone;
+        _currentBytes = std::max( dataSize - wholeStones * bytesPerStone, int64_t(0) );
+
+        invariantWTOK( c->prev( c ) );
+        uint64_t key;
+        invariantWTOK( c->get_key( c, &key ) );
+        _currentLast = _fromKey( key );
+    }
+
+    void WiredTigerRecordStore::OplogStones::_reclaimThread() {
+        setThreadName( "WTOplogStones" );
+        while ( true ) {
+            DiskLoc lastRecord;
+            {
+                boost::mutex::scoped_lock lk( _mutex );
+                // Deletes from the oplog don't notify, so look again now and then.
+                while ( !_shuttingDown && !_hasExcess() )
+                    _cond.timed_wait( lk, boost::posix_time::milliseconds( 1000 ) );
+                if ( _shuttingDown )
+                    return;
+                lastRecord = _stones.front().lastRecord;
+            }
+
+            if ( !_truncateThrough( lastRecord ) ) {
+                sleepmillis( 100 );
+                continue;
+            }
+
+            boost::mutex::scoped_lock lk( _mutex );
+            if ( _stones.empty() || _stones.front().lastRecord != lastRecord ) {
+                // removeStonesAfter took it meanwhile.
+                continue;
+            }
+            const Stone& stone = _stones.front();
+            _rs->_numRecords.add( -stone.records );
+            _rs->_dataSize.add( -stone.bytes );
+            LOG(1) << "truncated " << stone.records << " records of " << _rs->ns()
+                   << " through " << lastRecord;
+            _stones.pop_front();
+        }
+    }
+
+    bool WiredTigerRecordStore::OplogStones::_truncateThrough( const DiskLoc& lastRecord ) {
+        WiredTigerSession* session = _sessionCache->getSession();
+        WT_SESSION* s = session->getSession();
+        WT_CURSOR* c = session->getCursor( _rs->GetURI(), _rs->instanceId() );
+        invariant( c );
+
+        invariantWTOK( s->begin_transaction( s, NULL ) );
+        c->set_key( c, _makeKey( lastRecord ) );
+        int ret = s->truncate( s, NULL, NULL, c, NULL );
+        if ( ret == 0 ) {
+            invariantWTOK( s->commit_transaction( s, NULL ) );
+        }
+        else {
+            if ( ret != WT_ROLLBACK )
+                invariantWTOK( ret );
+            invariantWTOK( s->rollback_transaction( s, NULL ) );
+        }
+
+        session->releaseCursor( _rs->instanceId(), c );
+        _sessionCache->releaseSession( session );
+        return ret == 0;
+    }
+
     StatusWith<std::string> WiredTigerRecordStore::generateCreateString(const StringData& ns,
                                                                         const CollectionOptions& options,
                                                                         const StringData& extraStrings) {
@@ -103,28 +365,11 @@ namespace {
 
         ss << extraStrings << ",";
 
-        // Validate configuration object.
-        // Warn about unrecognized fields that may be introduced in newer versions of this
-        // storage engine instead of raising an error.
-        // Ensure that 'configString' field is a string. Warn if this is not the case.
-        BSONForEach(elem, options.storageEngine.getObjectField("wiredtiger")) {
-            if (elem.fieldNameStringData() == "configString") {
-                if (elem.type() != String) {
-                    return StatusWith<std::string>(ErrorCodes::TypeMismatch, str::stream()
-                        << "storageEngine.wiredtiger.configString must be a string. "
-                        << "Not adding 'configString' value "
-                        << elem << " to collection configuration");
-                    continue;
-                }
-                ss << elem.valueStringData() << ",";
-            }
-            else {
-                // Return error on first unrecognized field.
-                return StatusWith<std::string>(ErrorCodes::InvalidOptions, str::stream()
-                    << '\'' << elem.fieldNameStringData() << '\''
-                    << " is not a supported option in storageEngine.wiredtiger");
-            }
-        }
+        StatusWith<std::string> tableConfig =
+            WiredTigerUtil::getTableCreateConfig(options.storageEngine);
+        if (!tableConfig.isOK())
+            return tableConfig;
+        ss << tableConfig.getValue();
 
         if ( NamespaceString::oplog(ns) ) {
             // force file for oplog
@@ -157,8 +402,7 @@ namespace {
               _cappedMaxDocs( cappedMaxDocs ),
               _cappedDeleteCallback( cappedDeleteCallback ),
               _useOplogHack(shouldUseOplogHack(ctx, _uri)),
-              _sizeStorer( sizeStorer ),
-              _sizeStorerCounter(0)
+              _sizeStorer( sizeStorer )
     {
 
         if (_isCapped) {
@@ -196,10 +440,17 @@ namespace {
             if ( _sizeStorer ) {
                 long long numRecords;
                 long long dataSize;
-                _sizeStorer->load( uri, &numRecords, &dataSize );
+                long long highestKey;
+                _sizeStorer->load( uri, &numRecords, &dataSize, &highestKey );
                 _numRecords.store( numRecords );
                 _dataSize.store( dataSize );
-                _sizeStorer->onCreate( this, numRecords, dataSize );
+                if ( numRecords >= 10000 && highestKey >= 0 &&
+                     highestKey < static_cast<long long>( max ) ) {
+                    // The sizes were stored before the last records went in, most likely
+                    // because we didn't shut down cleanly.
+                    _reconcileSizeFrom( ctx, highestKey );
+                }
+                _sizeStorer->onCreate( this, _numRecords.load(), _dataSize.load() );
             }
 
             if ( _sizeStorer == NULL || _numRecords.load() < 10000 ) {
@@ -211,33 +462,73 @@ namespace {
                 while( !iterator->isEOF() ) {
                     DiskLoc loc = iterator->getNext();
                     RecordData data = iterator->dataFor( loc );
-                    _numRecords.fetchAndAdd(1);
-                    _dataSize.fetchAndAdd(data.size());
+                    _numRecords.add(1);
+                    _dataSize.add(data.size());
                 }
 
                 if ( _sizeStorer ) {
-                    _sizeStorer->store( _uri, _numRecords.load(), _dataSize.load() );
+                    _sizeStorer->store( _uri, _numRecords.load(), _dataSize.load(),
+                                        highestKeyCounted() );
                 }
             }
 
         }
 
+        if ( _isCapped && _isOplog && _cappedMaxDocs == -1 && wiredTigerOplogStones ) {
+            _oplogStones.reset( new OplogStones( this,
+                                                 WiredTigerRecoveryUnit::get( ctx )->getSessionCache() ) );
+            _oplogStones->createInitialStones( ctx );
+            _oplogStones->start();
+        }
     }
 
     WiredTigerRecordStore::~WiredTigerRecordStore() {
         LOG(1) << "~WiredTigerRecordStore for: " << ns();
+        _oplogStones.reset( NULL );
         if ( _sizeStorer ) {
             _sizeStorer->onDestroy( this );
-            _sizeStorer->store( _uri, _numRecords.load(), _dataSize.load() );
         }
     }
 
     long long WiredTigerRecordStore::dataSize( OperationContext *txn ) const {
-        return _dataSize.load();
+        // Stored sizes which were off can take the count below zero.
+        return std::max( _dataSize.load(), 0LL );
     }
 
     long long WiredTigerRecordStore::numRecords( OperationContext *txn ) const {
-        return _numRecords.load();
+        return std::max( _numRecords.load(), 0LL );
+    }
+
+    int64_t WiredTigerRecordStore::highestKeyCounted() const {
+        if ( _useOplogHack )
+            return -1;
+        return _nextIdNum.load() - 1;
+    }
+
+    void WiredTigerRecordStore::_reconcileSizeFrom( OperationContext* txn, int64_t highestKey ) {
+        LOG(1) << "counting the records of " << ns() << " after " << highestKey;
+
+        WiredTigerCursor curwrap( _uri, _instanceId, txn );
+        WT_CURSOR* c = curwrap.get();
+        c->set_key( c, static_cast<uint64_t>( highestKey ) );
+        int cmp;
+        int ret = c->search_near( c, &cmp );
+        if ( ret == 0 && cmp <= 0 )
+            ret = c->next( c );
+
+        long long count = 0;
+        while ( ret == 0 ) {
+            WT_ITEM value;
+            invariantWTOK( c->get_value( c, &value ) );
+            _numRecords.add( 1 );
+            _dataSize.add( value.size );
+            count++;
+            ret = c->next( c );
+        }
+        if ( ret != WT_NOTFOUND )
+            invariantWTOK( ret );
+
+        log() << "added " << count << " records to the stored sizes of " << ns();
     }
 
     bool WiredTigerRecordStore::isCapped() const {
@@ -321,7 +612,37 @@ namespace {
         return true;
     }
 
+    void WiredTigerRecordStore::prefetchRecords( OperationContext* txn,
+                                                 const std::vector<DiskLoc>& locs ) const {
+        // Positioning a cursor on each record reads its page into the cache, and doing so in
+        // key order visits the pages in order, without copying out any data.
+        WiredTigerCursor curwrap( _uri, _instanceId, txn);
+        WT_CURSOR *c = curwrap.get();
+        invariant( c );
+        for ( size_t i = 0; i < locs.size(); i++ ) {
+            c->set_key(c, _makeKey(locs[i]));
+            int ret = c->search(c);
+            if ( ret != 0 && ret != WT_NOTFOUND ) {
+                // Only a hint; the real read will report the error.
+                return;
+            }
+        }
+    }
+
+    void WiredTigerRecordStore::touchRecord( OperationContext* txn, const DiskLoc& loc ) const {
+        // The search reads the record's page into the cache; the value isn't copied out.
+        WiredTigerCursor curwrap( _uri, _instanceId, txn);
+        WT_CURSOR *c = curwrap.get();
+        invariant( c );
+        c->set_key(c, _makeKey(loc));
+        int ret = c->search(c);
+        if ( ret != 0 && ret != WT_NOTFOUND ) {
+            LOG(2) << "ignoring error touching record " << loc << ": " << wiredtiger_strerror(ret);
+        }
+    }
+
     void WiredTigerRecordStore::deleteRecord( OperationContext* txn, const DiskLoc& loc ) {
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
         WiredTigerCursor cursor( _uri, _instanceId, txn );
         WT_CURSOR *c = cursor.get();
         c->set_key(c, _makeKey(loc));
@@ -337,15 +658,14 @@ namespace {
         ret = c->remove(c);
         invariantWTOK(ret);
 
-        _changeNumRecords(txn, false);
-        _increaseDataSize(txn, -old_length);
+        _changeSize(txn, -1, -old_length);
     }
 
     bool WiredTigerRecordStore::cappedAndNeedDelete(OperationContext* txn) const {
         if (!_isCapped)
             return false;
 
-        if (_dataSize.load() > _cappedMaxSize)
+        if (dataSize(txn) > _cappedMaxSize)
             return true;
 
         if ((_cappedMaxDocs != -1) && (numRecords(txn) > _cappedMaxDocs))
@@ -360,6 +680,10 @@ namespace {
 
     void WiredTigerRecordStore::cappedDeleteAsNeeded(OperationContext* txn) {
 
+        // The oldest stone is truncated in the background instead.
+        if ( _oplogStones )
+            return;
+
         bool useTruncate = false;
 
         if ( _isOplog ) {
@@ -375,7 +699,7 @@ namespace {
         int ret = c->next(c);
         DiskLoc oldest;
         while ( ret == 0 && cappedAndNeedDelete(txn) ) {
-            invariant(_numRecords.load() > 0);
+            invariant(numRecords(txn) > 0);
 
             uint64_t key;
             ret = c->get_key(c, &key);
@@ -387,10 +711,9 @@ namespace {
             }
 
             if ( useTruncate ) {
-                _changeNumRecords( txn, false );
                 WT_ITEM temp;
                 invariantWTOK( c->get_value( c, &temp ) );
-                _increaseDataSize( txn, temp.size );
+                _changeSize( txn, -1, -static_cast<int>( temp.size ) );
             }
             else {
                 deleteRecord( txn, oldest );
@@ -432,6 +755,7 @@ namespace {
                                        "object to insert exceeds cappedMaxSize" );
         }
 
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
         WiredTigerCursor curwrap( _uri, _instanceId, txn);
         WT_CURSOR *c = curwrap.get();
         invariant( c );
@@ -453,8 +777,11 @@ namespace {
         int ret = c->insert(c);
         invariantWTOK(ret);
 
-        _changeNumRecords( txn, true );
-        _increaseDataSize( txn, len );
+        _changeSize( txn, 1, len );
+
+        if ( _oplogStones )
+            txn->recoveryUnit()->registerChange( new OplogStones::InsertChange( _oplogStones.get(),
+                                                                                len, loc ) );
 
         cappedDeleteAsNeeded(txn);
 
@@ -474,6 +801,7 @@ namespace {
         boost::shared_array<char> buf( new char[len] );
         doc->writeDocument( buf.get() );
 
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
         WiredTigerCursor curwrap( _uri, _instanceId, txn);
         WT_CURSOR *c = curwrap.get();
 
@@ -494,20 +822,82 @@ namespace {
         int ret = c->insert(c);
         invariantWTOK(ret);
 
-        _changeNumRecords( txn, true );
-        _increaseDataSize( txn, len );
+        _changeSize( txn, 1, len );
+
+        if ( _oplogStones )
+            txn->recoveryUnit()->registerChange( new OplogStones::InsertChange( _oplogStones.get(),
+                                                                                len, loc ) );
 
         cappedDeleteAsNeeded( txn );
 
         return StatusWith<DiskLoc>( loc );
     }
 
+    Status WiredTigerRecordStore::insertRecords( OperationContext* txn,
+                                                 const std::vector<const DocWriter*>& docs,
+                                                 std::vector<DiskLoc>* locsOut,
+                                                 bool enforceQuota ) {
+        if ( docs.empty() )
+            return Status::OK();
+
+        size_t maxLen = 0;
+        for ( size_t i = 0; i < docs.size(); i++ ) {
+            const size_t len = docs[i]->documentSize();
+            if ( _isCapped && len > static_cast<size_t>( _cappedMaxSize ) ) {
+                return Status( ErrorCodes::BadValue, "object to insert exceeds cappedMaxSize" );
+            }
+            maxLen = std::max( maxLen, len );
+        }
+
+        // One write ticket, cursor and capped deletion pass for the whole batch
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
+        WiredTigerCursor curwrap( _uri, _instanceId, txn);
+        WT_CURSOR *c = curwrap.get();
+        invariant( c );
+
+        boost::shared_array<char> buf( new char[maxLen] );
+        for ( size_t i = 0; i < docs.size(); i++ ) {
+            const int len = docs[i]->documentSize();
+            docs[i]->writeDocument( buf.get() );
+
+            DiskLoc loc;
+            if (_useOplogHack) {
+                StatusWith<DiskLoc> status = extractAndCheckLocForOplog(buf.get(), len);
+                if (!status.isOK())
+                    return status.getStatus();
+                loc = status.getValue();
+            }
+            else {
+                loc = _nextId();
+            }
+
+            c->set_key(c, _makeKey(loc));
+            WiredTigerItem value(buf.get(), len);
+            c->set_value(c, value.Get());
+            int ret = c->insert(c);
+            invariantWTOK(ret);
+
+            _changeSize( txn, 1, len );
+
+            if ( _oplogStones )
+                txn->recoveryUnit()->registerChange(
+                        new OplogStones::InsertChange( _oplogStones.get(), len, loc ) );
+
+            locsOut->push_back( loc );
+        }
+
+        cappedDeleteAsNeeded( txn );
+
+        return Status::OK();
+    }
+
     StatusWith<DiskLoc> WiredTigerRecordStore::updateRecord( OperationContext* txn,
                                                         const DiskLoc& loc,
                                                         const char* data,
                                                         int len,
                                                         bool enforceQuota,
                                                         UpdateMoveNotifier* notifier ) {
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
         WiredTigerCursor curwrap( _uri, _instanceId, txn);
         WT_CURSOR *c = curwrap.get();
         invariant( c );
@@ -527,7 +917,7 @@ namespace {
         ret = c->update(c);
         invariantWTOK(ret);
 
-        _increaseDataSize(txn, len - old_length);
+        _changeSize(txn, 0, len - old_length);
 
         cappedDeleteAsNeeded(txn);
 
@@ -556,6 +946,7 @@ namespace {
 
         WiredTigerItem value(data);
 
+        WiredTigerRecoveryUnit::get( txn )->throttleWrite( txn );
         WiredTigerCursor curwrap( _uri, _instanceId, txn);
         WT_CURSOR *c = curwrap.get();
         c->set_key(c, _makeKey(loc));
@@ -591,12 +982,17 @@ namespace {
 
     Status WiredTigerRecordStore::truncate( OperationContext* txn ) {
         // TODO: use a WiredTiger fast truncate
+        const long long numRecordsBefore = numRecords( txn );
+        const long long dataSizeBefore = dataSize( txn );
         boost::scoped_ptr<RecordIterator> iter( getIterator( txn ) );
         while( !iter->isEOF() ) {
             DiskLoc loc = iter->getNext();
             deleteRecord( txn, loc );
         }
 
+        if ( _oplogStones )
+            _oplogStones->removeStonesAfter( DiskLoc(), numRecordsBefore, dataSizeBefore );
+
         // WiredTigerRecoveryUnit* ru = _getRecoveryUnit( txn );
 
         _highestLocForOplogHack = DiskLoc();
@@ -739,58 +1135,42 @@ namespace {
         return dynamic_cast<WiredTigerRecoveryUnit*>( txn->recoveryUnit() );
     }
 
-    class WiredTigerRecordStore::NumRecordsChange : public RecoveryUnit::Change {
-    public:
-        NumRecordsChange(WiredTigerRecordStore* rs, bool insert) :_rs(rs), _insert(insert) {}
-        virtual void commit() {}
-        virtual void rollback() {
-            _rs->_numRecords.fetchAndAdd(_insert ? -1 : 1);
-        }
-
-    private:
-        WiredTigerRecordStore* _rs;
-        bool _insert;
-    };
+    namespace {
+        AtomicUInt32 nextCounterShard(0);
+        ThreadLocalValue<int> counterShard(-1);
+    }
 
-    void WiredTigerRecordStore::_changeNumRecords( OperationContext* txn, bool insert ) {
-        txn->recoveryUnit()->registerChange(new NumRecordsChange(this, insert));
-        if ( _numRecords.fetchAndAdd(insert ? 1 : -1) < 0 ) {
-            if ( insert )
-                _numRecords.store( 1 );
-            else
-                _numRecords.store( 0 );
-        }
+    // static
+    size_t WiredTigerRecordStore::ShardedCounter::_myShard() {
+        int& shard = counterShard.getRef();
+        if ( shard < 0 )
+            shard = nextCounterShard.fetchAndAdd(1) % kNumShards;
+        return shard;
     }
 
-    class WiredTigerRecordStore::DataSizeChange : public RecoveryUnit::Change {
+    /**
+     * Takes a write's change to the sizes back out if its unit of work rolls back.
+     */
+    class WiredTigerRecordStore::SizeChange : public RecoveryUnit::Change {
     public:
-        DataSizeChange(WiredTigerRecordStore* rs, int amount) :_rs(rs), _amount(amount) {}
+        SizeChange(WiredTigerRecordStore* rs, int numRecords, int dataSize)
+            : _rs(rs), _numRecords(numRecords), _dataSize(dataSize) {}
         virtual void commit() {}
         virtual void rollback() {
-            _rs->_increaseDataSize( NULL, -_amount );
+            _rs->_numRecords.add(-_numRecords);
+            _rs->_dataSize.add(-_dataSize);
         }
 
     private:
         WiredTigerRecordStore* _rs;
-        bool _amount;
+        int _numRecords;
+        int _dataSize;
     };
 
-    void WiredTigerRecordStore::_increaseDataSize( OperationContext* txn, int amount ) {
-        if ( txn )
-            txn->recoveryUnit()->registerChange(new DataSizeChange(this, amount));
-
-        if ( _dataSize.fetchAndAdd(amount) < 0 ) {
-            if ( amount > 0 ) {
-                _dataSize.store( amount );
-            }
-            else {
-                _dataSize.store( 0 );
-            }
-        }
-
-        if ( _sizeStorer && _sizeStorerCounter++ % 1000 == 0 ) {
-            _sizeStorer->store( _uri, _numRecords.load(), _dataSize.load() );
-        }
+    void WiredTigerRecordStore::_changeSize( OperationContext* txn, int numRecords, int dataSize ) {
+        txn->recoveryUnit()->registerChange(new SizeChange(this, numRecords, dataSize));
+        _numRecords.add(numRecords);
+        _dataSize.add(dataSize);
     }
 
     uint64_t WiredTigerRecordStore::_makeKey( const DiskLoc& loc ) {
@@ -993,6 +1373,8 @@ namespace {
                                                      DiskLoc end,
                                                      bool inclusive ) {
         WriteUnitOfWork wuow(txn);
+        const long long numRecordsBefore = numRecords( txn );
+        const long long dataSizeBefore = dataSize( txn );
         boost::scoped_ptr<RecordIterator> iter( getIterator( txn, end ) );
         while( !iter->isEOF() ) {
             DiskLoc loc = iter->getNext();
@@ -1004,5 +1386,11 @@ namespace {
 
         iter.reset(getIterator(txn, DiskLoc(), CollectionScanParams::BACKWARD));
         _highestLocForOplogHack = iter->isEOF() ? DiskLoc() : iter->curr();
+
+        if ( _oplogStones ) {
+            _oplogStones->removeStonesAfter( _highestLocForOplogHack,
+                                             numRecordsBefore - numRecords( txn ),
+                                             dataSizeBefore - dataSize( txn ) );
+        }
     }
 }
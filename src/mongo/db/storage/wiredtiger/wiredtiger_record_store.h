@@ -33,6 +33,8 @@
 
 #include <string>
 
+#include <boost/scoped_ptr.hpp>
+
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/storage/record_store.h"
 #include "mongo/db/storage/capped_callback.h"
@@ -52,8 +54,9 @@ namespace mongo {
          * Creates a configuration string suitable for 'config' parameter in WT_SESSION::create().
          * Configuration string is constructed from:
          *     built-in defaults
-         *     storageEngine.wiredtiger.configString in 'options'
          *     'extraStrings'
+         *     the engine neutral storage options in options.storageEngine
+         *     storageEngine.wiredtiger.configString in 'options'
          * Performs simple validation on the supplied parameters.
          * Returns error status if validation fails.
          * Note that even if this function returns an OK status, WT_SESSION:create() may still
@@ -93,6 +96,11 @@ namespace mongo {
 
         virtual bool findRecord( OperationContext* txn, const DiskLoc& loc, RecordData* out ) const;
 
+        virtual void prefetchRecords( OperationContext* txn,
+                                      const std::vector<DiskLoc>& locs ) const;
+
+        virtual void touchRecord( OperationContext* txn, const DiskLoc& loc ) const;
+
         virtual void deleteRecord( OperationContext* txn, const DiskLoc& dl );
 
         virtual StatusWith<DiskLoc> insertRecord( OperationContext* txn,
@@ -104,6 +112,11 @@ namespace mongo {
                                                   const DocWriter* doc,
                                                   bool enforceQuota );
 
+        virtual Status insertRecords( OperationContext* txn,
+                                      const std::vector<const DocWriter*>& docs,
+                                      std::vector<DiskLoc>* locsOut,
+                                      bool enforceQuota );
+
         virtual StatusWith<DiskLoc> updateRecord( OperationContext* txn,
                                                   const DiskLoc& oldLocation,
                                                   const char* data,
@@ -168,6 +181,12 @@ namespace mongo {
 
         void setSizeStorer( WiredTigerSizeStorer* ss ) { _sizeStorer = ss; }
 
+        /**
+         * The highest record id the size counts are known to take into account, for the size
+         * storer to keep with them.  -1 if records are not numbered in insertion order.
+         */
+        int64_t highestKeyCounted() const;
+
     private:
 
         class Iterator : public RecordIterator {
@@ -206,8 +225,43 @@ namespace mongo {
             DiskLoc _lastLoc; // the last thing returned from getNext()
         };
 
-        class NumRecordsChange;
-        class DataSizeChange;
+        /**
+         * A count which writers add to without sharing a cache line: each thread adds to one of
+         * several shards, and reading adds the shards up.
+         */
+        class ShardedCounter {
+        public:
+            ShardedCounter() { store( 0 ); }
+
+            void add( long long amount ) { _shards[_myShard()].value.fetchAndAdd( amount ); }
+
+            /** Not atomic with concurrent add()s. */
+            void store( long long value ) {
+                _shards[0].value.store( value );
+                for ( size_t i = 1; i < kNumShards; i++ )
+                    _shards[i].value.store( 0 );
+            }
+
+            long long load() const {
+                long long total = 0;
+                for ( size_t i = 0; i < kNumShards; i++ )
+                    total += _shards[i].value.load();
+                return total;
+            }
+
+        private:
+            static const size_t kNumShards = 16;
+            static size_t _myShard();
+
+            struct Shard {
+                AtomicInt64 value;
+                char pad[64 - sizeof(AtomicInt64)];
+            };
+            Shard _shards[kNumShards];
+        };
+
+        class SizeChange;
+        class OplogStones;
 
         static WiredTigerRecoveryUnit* _getRecoveryUnit( OperationContext* txn );
 
@@ -218,8 +272,8 @@ namespace mongo {
         void _setId(DiskLoc loc);
         bool cappedAndNeedDelete(OperationContext* txn) const;
         void cappedDeleteAsNeeded(OperationContext* txn);
-        void _changeNumRecords(OperationContext* txn, bool insert);
-        void _increaseDataSize(OperationContext* txn, int amount);
+        void _changeSize(OperationContext* txn, int numRecords, int dataSize);
+        void _reconcileSizeFrom(OperationContext* txn, int64_t highestKey);
         RecordData _getData( const WiredTigerCursor& cursor) const;
         StatusWith<DiskLoc> extractAndCheckLocForOplog(const char* data, int len);
 
@@ -237,10 +291,13 @@ namespace mongo {
         DiskLoc _highestLocForOplogHack;
 
         AtomicUInt64 _nextIdNum;
-        AtomicInt64 _dataSize;
-        AtomicInt64 _numRecords;
+        ShardedCounter _dataSize;
+        ShardedCounter _numRecords;
 
         WiredTigerSizeStorer* _sizeStorer; // not owned, can be NULL
-        int _sizeStorerCounter;
+
+        // Only for a capped oplog: the old records are then truncated in the background rather
+        // than deleted by cappedDeleteAsNeeded.
+        boost::scoped_ptr<OplogStones> _oplogStones;
     };
 }
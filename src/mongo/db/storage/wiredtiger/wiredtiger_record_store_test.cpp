@@ -43,6 +43,7 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/unittest/temp_dir.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -91,14 +92,18 @@ namespace mongo {
 
         virtual RecordStore* newCappedRecordStore( int64_t cappedMaxSize,
                                                    int64_t cappedMaxDocs ) {
-            std::string ns = "a.b";
+            return newCappedRecordStore( "a.b", cappedMaxSize, cappedMaxDocs );
+        }
 
+        RecordStore* newCappedRecordStore( const std::string& ns,
+                                           int64_t cappedMaxSize,
+                                           int64_t cappedMaxDocs ) {
             WiredTigerRecoveryUnit* ru = new WiredTigerRecoveryUnit( _sessionCache );
             OperationContextNoop txn( ru );
-            string uri = "table:a.b";
+            string uri = "table:" + ns;
 
             StatusWith<std::string> result =
-                WiredTigerRecordStore::generateCreateString("", CollectionOptions(), "");
+                WiredTigerRecordStore::generateCreateString(ns, CollectionOptions(), "");
             ASSERT_TRUE(result.isOK());
             std::string config = result.getValue();
 
@@ -115,6 +120,8 @@ namespace mongo {
         virtual RecoveryUnit* newRecoveryUnit() {
             return new WiredTigerRecoveryUnit( _sessionCache );
         }
+
+        virtual bool supportsDocLocking() const { return true; }
     private:
         unittest::TempDir _dbpath;
         WT_CONNECTION* _conn;
@@ -143,6 +150,23 @@ namespace mongo {
         ASSERT_EQUALS(ErrorCodes::TypeMismatch, status.code());
     }
 
+    TEST(WiredTigerRecordStoreTest, GenerateCreateStringTableStorageOptions) {
+        CollectionOptions options;
+        options.storageEngine = fromjson("{compressor: 'none', blockSize: 8192, "
+                                         "wiredtiger: {configString: 'allocation_size=4k'}}");
+        StatusWith<std::string> result = WiredTigerRecordStore::generateCreateString("", options, "");
+        ASSERT_OK(result.getStatus());
+
+        // The engine specific configString comes last so that it overrides the neutral options.
+        const std::string& config = result.getValue();
+        const size_t compressor = config.find("block_compressor=,");
+        const size_t blockSize = config.find("allocation_size=8192,");
+        ASSERT_NOT_EQUALS(std::string::npos, compressor);
+        ASSERT_NOT_EQUALS(std::string::npos, blockSize);
+        ASSERT_LESS_THAN(blockSize, config.find("allocation_size=4k,"));
+        ASSERT_LESS_THAN(config.find("block_compressor=snappy,"), compressor);
+    }
+
     TEST(WiredTigerRecordStoreTest, Isolation1 ) {
         scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
         scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
@@ -329,6 +353,53 @@ namespace mongo {
         rs.reset( NULL ); // this has to be deleted before ss
     }
 
+    TEST(WiredTigerRecordStoreTest, SizeStorerReconcile ) {
+        scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
+        scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
+
+        string uri = dynamic_cast<WiredTigerRecordStore*>( rs.get() )->GetURI();
+
+        WiredTigerSizeStorer ss;
+        dynamic_cast<WiredTigerRecordStore*>( rs.get() )->setSizeStorer( &ss );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            WriteUnitOfWork uow( opCtx.get() );
+            for ( int i = 0; i < 3; i++ ) {
+                StatusWith<DiskLoc> res = rs->insertRecord( opCtx.get(), "a", 2, false );
+                ASSERT_OK( res.getStatus() );
+            }
+            uow.commit();
+        }
+
+        rs.reset( NULL );
+
+        // As if the sizes were last stored after the first insert, then we crashed.  There are
+        // too many records to count them all, so only the later two are counted.
+        ss.store( uri, 10000, 20000, 1 );
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            rs.reset( new WiredTigerRecordStore( opCtx.get(), "a.b", uri,
+                                                 false, -1, -1, NULL, &ss ) );
+        }
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( 10002, rs->numRecords( opCtx.get() ) );
+            ASSERT_EQUALS( 20004, rs->dataSize( opCtx.get() ) );
+        }
+
+        rs.reset( NULL );
+
+        long long numRecords;
+        long long dataSize;
+        long long highestKey;
+        ss.load( uri, &numRecords, &dataSize, &highestKey );
+        ASSERT_EQUALS( 10002, numRecords );
+        ASSERT_EQUALS( 3, highestKey );
+    }
+
     StatusWith<DiskLoc> insertBSON(ptr<OperationContext> opCtx, ptr<RecordStore> rs,
                                    const BSONObj& obj) {
         WriteUnitOfWork wuow(opCtx);
@@ -407,4 +478,37 @@ namespace mongo {
         ASSERT_OK(insertBSON(opCtx, rs, BSON("ts" << OpTime(2,-1))).getStatus());
         ASSERT_EQ(rs->oplogStartHack(opCtx.get(), DiskLoc(0,1)), DiskLoc().setInvalid());
     }
+
+    TEST(WiredTigerRecordStoreTest, OplogStones) {
+        WiredTigerHarnessHelper harnessHelper;
+        const int64_t cappedMaxSize = 10 * 1024;
+        scoped_ptr<RecordStore> rs(harnessHelper.newCappedRecordStore("local.oplog.stones",
+                                                                      cappedMaxSize, -1));
+        scoped_ptr<OperationContext> opCtx(harnessHelper.newOperationContext());
+
+        const std::string filler(100, 'x');
+        for (int i = 1; i <= 200; i++) {
+            ASSERT_OK(insertBSON(opCtx, rs, BSON("ts" << OpTime(1, i) << "s" << filler))
+                      .getStatus());
+        }
+
+        // The inserts don't delete: the oldest stones go in the background.
+        for (int i = 0; i < 100 && rs->dataSize(opCtx.get()) > cappedMaxSize; i++) {
+            sleepmillis(100);
+        }
+        ASSERT_LESS_THAN_OR_EQUALS(rs->dataSize(opCtx.get()), cappedMaxSize);
+        ASSERT_EQ(rs->oplogStartHack(opCtx.get(), DiskLoc(1, 1)), DiskLoc());
+        ASSERT_EQ(rs->oplogStartHack(opCtx.get(), DiskLoc(1, 200)), DiskLoc(1, 200));
+
+        long long count = 0;
+        long long size = 0;
+        scoped_ptr<RecordIterator> it(rs->getIterator(opCtx.get()));
+        while (!it->isEOF()) {
+            DiskLoc loc = it->getNext();
+            count++;
+            size += it->dataFor(loc).size();
+        }
+        ASSERT_EQUALS(count, rs->numRecords(opCtx.get()));
+        ASSERT_EQUALS(size, rs->dataSize(opCtx.get()));
+    }
 }
@@ -34,6 +34,9 @@
 #include <boost/thread/mutex.hpp>
 
 #include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/concurrency/parallel_batch_lock.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_cache_monitor.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
@@ -73,8 +76,11 @@ namespace mongo {
         } awaitCommitData;
     }
 
-    WiredTigerRecoveryUnit::WiredTigerRecoveryUnit(WiredTigerSessionCache* sc) :
+    WiredTigerRecoveryUnit::WiredTigerRecoveryUnit(WiredTigerSessionCache* sc,
+                                                   WiredTigerCacheMonitor* cacheMonitor) :
         _sessionCache( sc ),
+        _cacheMonitor( cacheMonitor ),
+        _holdingWriteTicket( false ),
         _session( NULL ),
         _depth(0),
         _active( false ),
@@ -86,6 +92,7 @@ namespace mongo {
     WiredTigerRecoveryUnit::~WiredTigerRecoveryUnit() {
         invariant( _depth == 0 );
         _abort();
+        _releaseWriteTicket();
         if ( _session ) {
             _sessionCache->releaseSession( _session );
             _session = NULL;
@@ -139,9 +146,29 @@ namespace mongo {
         _depth--;
         if ( _depth == 0 ) {
             _abort();
+            _releaseWriteTicket();
         }
     }
 
+    void WiredTigerRecoveryUnit::throttleWrite(OperationContext* txn) {
+        if ( !_cacheMonitor || _holdingWriteTicket || _depth == 0 )
+            return;
+
+        const long long waited = _cacheMonitor->acquireWriteTicket();
+        _holdingWriteTicket = true;
+        if ( waited > 0 && txn->getCurOp() ) {
+            OpDebug& debug = txn->getCurOp()->debug();
+            debug.evictionWaitMicros = std::max( debug.evictionWaitMicros, 0LL ) + waited;
+        }
+    }
+
+    void WiredTigerRecoveryUnit::_releaseWriteTicket() {
+        if ( !_holdingWriteTicket )
+            return;
+        _cacheMonitor->releaseWriteTicket();
+        _holdingWriteTicket = false;
+    }
+
     void WiredTigerRecoveryUnit::goingToAwaitCommit() {
         if ( _active ) {
             // too late, can't change config
@@ -209,6 +236,10 @@ namespace mongo {
         WT_SESSION *s = _session->getSession();
         _syncing = _syncing || awaitCommitData.numWaitingForSync.load() > 0;
         invariantWTOK( s->begin_transaction(s, _syncing ? "sync=true" : NULL) );
+
+        // The snapshot is taken at the start of the transaction, so replication batches no
+        // longer need to wait for this reader
+        parallelBatchSnapshotEstablished();
         LOG(2) << "WT begin_transaction";
         _timer.reset();
         _active = true;
@@ -44,12 +44,17 @@
 namespace mongo {
 
     class BSONObjBuilder;
+    class WiredTigerCacheMonitor;
     class WiredTigerSession;
     class WiredTigerSessionCache;
 
     class WiredTigerRecoveryUnit : public RecoveryUnit {
     public:
-        WiredTigerRecoveryUnit(WiredTigerSessionCache* sc);
+        /**
+         * @param cacheMonitor - throttles the writes of the recovery unit if not NULL
+         */
+        WiredTigerRecoveryUnit(WiredTigerSessionCache* sc,
+                               WiredTigerCacheMonitor* cacheMonitor = NULL);
 
         virtual ~WiredTigerRecoveryUnit();
 
@@ -83,6 +88,13 @@ namespace mongo {
         bool everStartedWrite() const { return _everStartedWrite; }
         int depth() const { return _depth; }
 
+        /**
+         * Called before each write. The first one in a unit of work waits for a write ticket
+         * from the cache monitor, which is held until the outermost unit of work ends, and adds
+         * the wait to the operation's OpDebug.
+         */
+        void throttleWrite(OperationContext* txn);
+
         static WiredTigerRecoveryUnit* get(OperationContext *txn);
 
     private:
@@ -93,7 +105,11 @@ namespace mongo {
         void _txnClose( bool commit );
         void _txnOpen();
 
+        void _releaseWriteTicket();
+
         WiredTigerSessionCache* _sessionCache; // not owned
+        WiredTigerCacheMonitor* _cacheMonitor; // not owned, might be NULL
+        bool _holdingWriteTicket;
         WiredTigerSession* _session; // owned, but from pool
         bool _defaultCommit;
         int _depth;
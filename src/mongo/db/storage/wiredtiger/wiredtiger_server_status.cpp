@@ -74,6 +74,11 @@ namespace mongo {
             bob.append("reason", status.reason());
         }
 
+        // Signals derived from the statistics over time.
+        BSONObjBuilder monitor(bob.subobjStart("monitor"));
+        _engine->getCacheMonitor()->appendStats(&monitor);
+        monitor.done();
+
         return bob.obj();
     }
 
@@ -33,14 +33,38 @@
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
+    namespace {
+        // 0 keeps idle sessions open forever.
+        MONGO_EXPORT_SERVER_PARAMETER(wiredTigerSessionIdleSecs, int, 300);
+
+        const unsigned long long kSweepIntervalMillis = 10 * 1000;
+
+        AtomicUInt32 nextThreadPool(0);
+        ThreadLocalValue<int> threadPool(-1);
+
+        /**
+         * The pool the current thread goes to first.  Threads are spread over the pools in the
+         * order they first ask for a session.
+         */
+        size_t myPool() {
+            int& pool = threadPool.getRef();
+            if ( pool < 0 )
+                pool = nextThreadPool.fetchAndAdd(1) % WiredTigerSessionCache::kNumPools;
+            return pool;
+        }
+    }
+
     WiredTigerSession::WiredTigerSession( WT_CONNECTION* conn, int epoch )
-        : _epoch( epoch ), _session( NULL ), _cursorsOut( 0 ) {
+        : _epoch( epoch ), _session( NULL ), _cursorsOut( 0 ), _lastReleasedMillis( 0 ) {
         int ret = conn->open_session(conn, NULL, "isolation=snapshot", &_session);
         invariantWTOK(ret);
     }
@@ -112,11 +136,13 @@ namespace mongo {
     // -----------------------
 
     WiredTigerSessionCache::WiredTigerSessionCache( WiredTigerKVEngine* engine )
-        : _engine( engine ), _conn( engine->getConnection() ) {
+        : _engine( engine ), _conn( engine->getConnection() ),
+          _lastSweepMillis( curTimeMillis64() ), _sweeping( 0 ) {
     }
 
     WiredTigerSessionCache::WiredTigerSessionCache( WT_CONNECTION* conn )
-        : _engine( NULL ), _conn( conn ) {
+        : _engine( NULL ), _conn( conn ),
+          _lastSweepMillis( curTimeMillis64() ), _sweeping( 0 ) {
     }
 
     WiredTigerSessionCache::~WiredTigerSessionCache() {
@@ -124,31 +150,100 @@ namespace mongo {
     }
 
     void WiredTigerSessionCache::closeAll() {
-        boost::mutex::scoped_lock lk( _sessionLock );
-        _closeAll();
+        for ( size_t i = 0; i < kNumPools; i++ ) {
+            SessionPool toClose;
+            {
+                boost::mutex::scoped_lock lk( _pools[i].lock );
+                toClose.swap( _pools[i].sessions );
+            }
+            for ( size_t j = 0; j < toClose.size(); j++ ) {
+                delete toClose[j];
+            }
+        }
     }
 
     void WiredTigerSessionCache::_closeAll() {
-        for ( size_t i = 0; i < _sessionPool.size(); i++ ) {
-            delete _sessionPool[i];
+        for ( size_t i = 0; i < kNumPools; i++ ) {
+            SessionPool& sessions = _pools[i].sessions;
+            for ( size_t j = 0; j < sessions.size(); j++ ) {
+                delete sessions[j];
+            }
+            sessions.clear();
         }
-        _sessionPool.clear();
     }
 
-    WiredTigerSession* WiredTigerSessionCache::getSession() {
-        {
-            boost::mutex::scoped_lock lk( _sessionLock );
-            if ( !_sessionPool.empty() ) {
-                WiredTigerSession* s = _sessionPool.back();
-                _sessionPool.pop_back();
-                {
-                    WT_SESSION* ss = s->getSession();
-                    uint64_t range;
-                    invariantWTOK( ss->transaction_pinned_range( ss, &range ) );
-                    invariant( range == 0 );
+    size_t WiredTigerSessionCache::closeIdle( unsigned long long idleMillis ) {
+        const unsigned long long now = curTimeMillis64();
+        size_t closed = 0;
+        for ( size_t i = 0; i < kNumPools; i++ ) {
+            SessionPool toClose;
+            {
+                boost::mutex::scoped_lock lk( _pools[i].lock );
+                SessionPool& sessions = _pools[i].sessions;
+                // The least recently released sessions are at the front.
+                size_t idle = 0;
+                while ( idle < sessions.size() &&
+                        now - sessions[idle]->lastReleasedMillis() >= idleMillis ) {
+                    idle++;
                 }
-                return s;
+                toClose.assign( sessions.begin(), sessions.begin() + idle );
+                sessions.erase( sessions.begin(), sessions.begin() + idle );
+            }
+            for ( size_t j = 0; j < toClose.size(); j++ ) {
+                delete toClose[j];
             }
+            closed += toClose.size();
+        }
+        return closed;
+    }
+
+    void WiredTigerSessionCache::_sweepIfDue( unsigned long long now ) {
+        const int idleSecs = wiredTigerSessionIdleSecs;
+        if ( idleSecs <= 0 )
+            return;
+        if ( now - _lastSweepMillis.load() < kSweepIntervalMillis )
+            return;
+        if ( _sweeping.compareAndSwap( 0, 1 ) != 0 )
+            return;
+        _lastSweepMillis.store( now );
+        size_t closed = closeIdle( idleSecs * 1000ULL );
+        if ( closed )
+            LOG(1) << "closed " << closed << " idle WiredTiger sessions";
+        _sweeping.store( 0 );
+    }
+
+    // static
+    WiredTigerSession* WiredTigerSessionCache::_takeLast( SessionPool* sessions ) {
+        if ( sessions->empty() )
+            return NULL;
+        WiredTigerSession* s = sessions->back();
+        sessions->pop_back();
+        return s;
+    }
+
+    WiredTigerSession* WiredTigerSessionCache::getSession() {
+        const size_t mine = myPool();
+        WiredTigerSession* s = NULL;
+        {
+            boost::mutex::scoped_lock lk( _pools[mine].lock );
+            s = _takeLast( &_pools[mine].sessions );
+        }
+
+        // Our own pool is empty, so take a session another thread released rather than open a
+        // new one, but don't wait for a pool which is busy.
+        for ( size_t i = 1; !s && i < kNumPools; i++ ) {
+            Pool& other = _pools[( mine + i ) % kNumPools];
+            boost::mutex::scoped_try_lock lk( other.lock );
+            if ( lk.owns_lock() )
+                s = _takeLast( &other.sessions );
+        }
+
+        if ( s ) {
+            WT_SESSION* ss = s->getSession();
+            uint64_t range;
+            invariantWTOK( ss->transaction_pinned_range( ss, &range ) );
+            invariant( range == 0 );
+            return s;
         }
         return new WiredTigerSession( _conn, _engine ? _engine->currentEpoch() : -1 );
     }
@@ -164,14 +259,21 @@ namespace mongo {
             invariant( range == 0 );
         }
 
-        if ( _engine && _engine->haveDropsQueued() && session->epoch() < _engine->currentEpoch() ) {
+        if ( _shouldBeClosed( session ) ) {
             delete session;
             _engine->dropAllQueued();
             return;
         }
 
-        boost::mutex::scoped_lock lk( _sessionLock );
-        _sessionPool.push_back( session );
+        const unsigned long long now = curTimeMillis64();
+        session->setLastReleasedMillis( now );
+        {
+            Pool& pool = _pools[myPool()];
+            boost::mutex::scoped_lock lk( pool.lock );
+            pool.sessions.push_back( session );
+        }
+
+        _sweepIfDue( now );
     }
 
     bool WiredTigerSessionCache::_shouldBeClosed( WiredTigerSession* session ) const {
@@ -39,6 +39,8 @@
 
 #include <wiredtiger.h>
 
+#include "mongo/platform/atomic_word.h"
+
 namespace mongo {
 
     class WiredTigerKVEngine;
@@ -64,6 +66,12 @@ namespace mongo {
 
         int epoch() const { return _epoch; }
 
+        /**
+         * When the session was last put back in a cache, in curTimeMillis64 terms.
+         */
+        unsigned long long lastReleasedMillis() const { return _lastReleasedMillis; }
+        void setLastReleasedMillis( unsigned long long millis ) { _lastReleasedMillis = millis; }
+
         static uint64_t genCursorId();
 
         /**
@@ -78,8 +86,18 @@ namespace mongo {
         typedef std::map<uint64_t, Cursors> CursorMap;
         CursorMap _curmap; // owned
         int _cursorsOut;
+        unsigned long long _lastReleasedMillis;
     };
 
+    /**
+     * Sessions are kept in several pools, each with its own lock.  A thread always goes to the
+     * same pool first, so it usually gets back a session (and the cursors cached in it) which it
+     * released itself, and threads on different pools don't contend.  When its own pool is empty
+     * a thread takes a session from any other pool it can lock without waiting.
+     *
+     * Sessions which sit in a pool for longer than wiredTigerSessionIdleSecs are closed by a sweep
+     * which at most one releasing thread runs at a time.
+     */
     class WiredTigerSessionCache {
     public:
 
@@ -92,17 +110,37 @@ namespace mongo {
 
         void closeAll();
 
+        /**
+         * Closes the sessions which have been idle in a pool longer than idleMillis.
+         * @return the number of sessions closed
+         */
+        size_t closeIdle( unsigned long long idleMillis );
+
+        static const size_t kNumPools = 16;
+
     private:
 
+        typedef std::vector<WiredTigerSession*> SessionPool;
+
+        struct Pool {
+            boost::mutex lock;
+            SessionPool sessions; // owned, most recently released last
+            char pad[64];
+        };
+
         bool _shouldBeClosed( WiredTigerSession* session ) const;
 
+        static WiredTigerSession* _takeLast( SessionPool* sessions );
+
+        void _sweepIfDue( unsigned long long now );
+
         void _closeAll(); // does not lock
 
         WiredTigerKVEngine* _engine; // not owned, might be NULL
         WT_CONNECTION* _conn; // not owned
-        typedef std::vector<WiredTigerSession*> SessionPool;
-        SessionPool _sessionPool; // owned
-        mutable boost::mutex _sessionLock;
+        Pool _pools[kNumPools];
+        AtomicUInt64 _lastSweepMillis;
+        AtomicUInt32 _sweeping;
     };
 
 }
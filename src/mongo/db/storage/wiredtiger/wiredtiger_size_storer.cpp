@@ -70,6 +70,7 @@ namespace mongo {
         entry.rs = rs;
         entry.numRecords = numRecords;
         entry.dataSize = dataSize;
+        entry.highestKey = rs->highestKeyCounted();
         entry.dirty = true;
     }
 
@@ -79,33 +80,41 @@ namespace mongo {
         Entry& entry = _entries[rs->GetURI()];
         entry.numRecords = rs->numRecords( NULL );
         entry.dataSize = rs->dataSize( NULL );
+        entry.highestKey = rs->highestKeyCounted();
         entry.dirty = true;
         entry.rs = NULL;
     }
 
 
     void WiredTigerSizeStorer::store( const StringData& uri,
-                                      long long numRecords, long long dataSize ) {
+                                      long long numRecords, long long dataSize,
+                                      long long highestKey ) {
         _checkMagic();
         boost::mutex::scoped_lock lk( _entriesMutex );
         Entry& entry = _entries[uri.toString()];
         entry.numRecords = numRecords;
         entry.dataSize = dataSize;
+        entry.highestKey = highestKey;
         entry.dirty = true;
     }
 
     void WiredTigerSizeStorer::load( const StringData& uri,
-                                     long long* numRecords, long long* dataSize ) const {
+                                     long long* numRecords, long long* dataSize,
+                                     long long* highestKey ) const {
         _checkMagic();
         boost::mutex::scoped_lock lk( _entriesMutex );
         Map::const_iterator it = _entries.find( uri.toString() );
         if ( it == _entries.end() ) {
             *numRecords = 0;
             *dataSize = 0;
+            if ( highestKey )
+                *highestKey = -1;
             return;
         }
         *numRecords = it->second.numRecords;
         *dataSize = it->second.dataSize;
+        if ( highestKey )
+            *highestKey = it->second.highestKey;
     }
 
     void WiredTigerSizeStorer::loadFrom( WiredTigerSession* session,
@@ -136,6 +145,8 @@ namespace mongo {
                 Entry& e = m[uri];
                 e.numRecords = data["numRecords"].safeNumberLong();
                 e.dataSize = data["dataSize"].safeNumberLong();
+                e.highestKey = data.hasField( "highestKey" ) ?
+                    data["highestKey"].safeNumberLong() : -1;
                 e.dirty = false;
                 e.rs = NULL;
             }
@@ -155,6 +166,12 @@ namespace mongo {
                 string uri = it->first;
                 Entry& entry = it->second;
                 if ( entry.rs ) {
+                    // Only the writes in progress while these are read can be off.
+                    const long long highestKey = entry.rs->highestKeyCounted();
+                    if ( entry.highestKey != highestKey ) {
+                        entry.highestKey = highestKey;
+                        entry.dirty = true;
+                    }
                     if ( entry.dataSize != entry.rs->dataSize( NULL ) ) {
                         entry.dataSize = entry.rs->dataSize( NULL );
                         entry.dirty = true;
@@ -189,6 +206,7 @@ namespace mongo {
                 BSONObjBuilder b;
                 b.append( "numRecords", entry.numRecords );
                 b.append( "dataSize", entry.dataSize );
+                b.append( "highestKey", entry.highestKey );
                 data = b.obj();
             }
 
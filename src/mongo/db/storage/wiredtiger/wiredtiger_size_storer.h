@@ -51,11 +51,16 @@ namespace mongo {
         void onCreate( WiredTigerRecordStore* rs, long long nr, long long ds );
         void onDestroy( WiredTigerRecordStore* rs );
 
+        /**
+         * @param highestKey the highest record id numRecords and dataSize take into account,
+         *        or -1 if unknown.
+         */
         void store( const StringData& uri,
-                    long long numRecords, long long dataSize );
+                    long long numRecords, long long dataSize, long long highestKey = -1 );
 
         void load( const StringData& uri,
-                   long long* numRecords, long long* dataSize ) const;
+                   long long* numRecords, long long* dataSize,
+                   long long* highestKey = NULL ) const;
 
         void loadFrom( WiredTigerSession* cursor, const std::string& uri );
         void storeInto( WiredTigerSession* cursor, const std::string& uri );
@@ -64,9 +69,10 @@ namespace mongo {
         void _checkMagic() const;
 
         struct Entry {
-            Entry() : numRecords(0), dataSize(0), dirty(false), rs(NULL){}
+            Entry() : numRecords(0), dataSize(0), highestKey(-1), dirty(false), rs(NULL){}
             long long numRecords;
             long long dataSize;
+            long long highestKey;
             bool dirty;
             WiredTigerRecordStore* rs; // not owned
         };
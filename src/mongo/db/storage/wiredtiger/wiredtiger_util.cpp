@@ -36,6 +36,8 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 
 #include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bson/bsonobjiterator.h"
+#include "mongo/db/storage/table_storage_options.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/scopeguard.h"
 
@@ -134,4 +136,54 @@ namespace mongo {
         return Status::OK();
     }
 
+    StatusWith<std::string> WiredTigerUtil::getTableCreateConfig(const BSONObj& storageEngine) {
+        StatusWith<TableStorageOptions> parsed = TableStorageOptions::parse(storageEngine);
+        if (!parsed.isOK())
+            return StatusWith<std::string>(parsed.getStatus());
+        const TableStorageOptions& options = parsed.getValue();
+
+        str::stream ss;
+        if (options.compressor == "none") {
+            ss << "block_compressor=,";
+        }
+        else if (!options.compressor.empty()) {
+            ss << "block_compressor=" << options.compressor << ",";
+        }
+        if (options.blockSize) {
+            ss << "allocation_size=" << options.blockSize << ",";
+        }
+        if (options.leafPageSize) {
+            ss << "leaf_page_max=" << options.leafPageSize << ",";
+        }
+        if (options.prefixCompression != TableStorageOptions::DEFAULT) {
+            ss << "prefix_compression="
+               << (options.prefixCompression == TableStorageOptions::YES ? "true" : "false")
+               << ",";
+        }
+
+        // Validate configuration object.
+        // Warn about unrecognized fields that may be introduced in newer versions of this
+        // storage engine instead of raising an error.
+        // Ensure that 'configString' field is a string. Warn if this is not the case.
+        BSONForEach(elem, storageEngine.getObjectField("wiredtiger")) {
+            if (elem.fieldNameStringData() == "configString") {
+                if (elem.type() != String) {
+                    return StatusWith<std::string>(ErrorCodes::TypeMismatch, str::stream()
+                        << "storageEngine.wiredtiger.configString must be a string. "
+                        << "Not adding 'configString' value "
+                        << elem << " to collection configuration");
+                }
+                ss << elem.valueStringData() << ",";
+            }
+            else {
+                // Return error on first unrecognized field.
+                return StatusWith<std::string>(ErrorCodes::InvalidOptions, str::stream()
+                    << '\'' << elem.fieldNameStringData() << '\''
+                    << " is not a supported option in storageEngine.wiredtiger");
+            }
+        }
+
+        return StatusWith<std::string>(ss);
+    }
+
 }  // namespace mongo
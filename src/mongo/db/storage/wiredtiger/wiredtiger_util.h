@@ -34,6 +34,7 @@
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/base/status.h"
+#include "mongo/base/status_with.h"
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/mongoutils/str.h"
@@ -41,6 +42,7 @@
 
 namespace mongo {
 
+    class BSONObj;
     class BSONObjBuilder;
 
     inline bool wt_keeptxnopen() {
@@ -105,6 +107,14 @@ namespace mongo {
 
         static int64_t getIdentSize(WT_SESSION* s,
                                     const std::string& uri );
+
+        /**
+         * Translates the "storageEngine" document of collection options or an index spec into
+         * WT_SESSION::create() configuration: the engine neutral TableStorageOptions followed
+         * by storageEngine.wiredtiger.configString, so that the latter wins.
+         * Returns an error status if the document holds options WiredTiger doesn't support.
+         */
+        static StatusWith<std::string> getTableCreateConfig(const BSONObj& storageEngine);
     };
 
     class WiredTigerConfigParser {
@@ -27,13 +27,14 @@
 *    exception statement from all source files in the program, then also delete
 *    it in the license file.
 */
-
 #define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kIndexing
 
 #include "mongo/platform/basic.h"
 
 #include "mongo/db/ttl.h"
 
+#include <boost/scoped_ptr.hpp>
+
 #include "mongo/base/counter.h"
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/user_name.h"
@@ -45,8 +46,9 @@
 #include "mongo/db/catalog/database_catalog_entry.h"
 #include "mongo/db/catalog/database_holder.h"
 #include "mongo/db/dbdirectclient.h"
+#include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/operation_context_impl.h"
-#include "mongo/db/ops/delete.h"
+#include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/util/background.h"
@@ -56,12 +58,30 @@ namespace mongo {
 
     Counter64 ttlPasses;
     Counter64 ttlDeletedDocuments;
+    Counter64 ttlDeleteBatches;
+    // The expired documents the last pass did not get to delete
+    Counter64 ttlBacklogDocuments;
 
     ServerStatusMetricField<Counter64> ttlPassesDisplay("ttl.passes", &ttlPasses);
     ServerStatusMetricField<Counter64> ttlDeletedDocumentsDisplay("ttl.deletedDocuments", &ttlDeletedDocuments);
+    ServerStatusMetricField<Counter64> ttlDeleteBatchesDisplay("ttl.deleteBatches",
+                                                               &ttlDeleteBatches);
+    ServerStatusMetricField<Counter64> ttlBacklogDocumentsDisplay("ttl.backlogDocuments",
+                                                                  &ttlBacklogDocuments);
 
     MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorEnabled, bool, true );
 
+    // How often a pass over the TTL indexes starts.  A pass that has not deleted all of the
+    // expired documents by the time the next one is due ends, and the next one starts at once.
+    MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorSleepSecs, int, 60 );
+
+    // The most documents deleted from a TTL index before the locks are released and the next
+    // TTL index gets its turn.
+    MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorBatchSize, int, 1000 );
+
+    // The most documents deleted from each collection per second, or 0 for no limit.
+    MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorMaxDeletesPerSecond, int, 0 );
+
     class TTLMonitor : public BackgroundJob {
     public:
         TTLMonitor(){}
@@ -75,10 +95,18 @@ namespace mongo {
             Client::initThread( name().c_str() );
             cc().getAuthorizationSession()->grantInternalAuthorization();
 
+            long long lastPassStart = nowMillis();
+            bool passFinished = true;
             while ( ! inShutdown() ) {
-                sleepsecs( 60 );
+                // A pass which did not finish was out of time, so the next one is already due.
+                if ( passFinished ) {
+                    const long long nextPassStart = lastPassStart + sleepMillis();
+                    sleepmillis( std::max( 1000LL, nextPassStart - nowMillis() ) );
+                }
 
                 LOG(3) << "TTLMonitor thread awake" << endl;
+                lastPassStart = nowMillis();
+                passFinished = true;
 
                 if ( !ttlMonitorEnabled ) {
                    LOG(1) << "TTLMonitor is disabled" << endl;
@@ -98,33 +126,140 @@ namespace mongo {
                         !repl::getGlobalReplicationCoordinator()->getCurrentMemberState().readable())
                     continue;
 
-                set<string> dbs;
-                dbHolder().getAllShortNames( dbs );
+                passFinished = doTTLPass( lastPassStart + sleepMillis() );
+            }
+        }
 
-                ttlPasses.increment();
+    private:
+        /**
+         * A TTL index and what the current pass has done with it.
+         */
+        struct TTLIndex {
+            TTLIndex( const string& dbName, const BSONObj& spec )
+                : dbName( dbName ), spec( spec ), done( false ) {
+            }
+
+            string dbName;
+            BSONObj spec;
+            bool done;
+        };
 
-                for ( set<string>::const_iterator i=dbs.begin(); i!=dbs.end(); ++i ) {
-                    string db = *i;
+        enum BatchResult {
+            BATCH_FULL,         // deleted a full batch, so more documents may have expired
+            BATCH_INDEX_DONE,   // no more expired documents, or the index can't be used
+            BATCH_DB_DONE,      // stop processing TTL indexes on this database
+        };
+
+        static long long nowMillis() {
+            return static_cast<long long>( curTimeMillis64() );
+        }
+
+        static long long sleepMillis() {
+            return 1000LL * std::max( 1, static_cast<int>( ttlMonitorSleepSecs ) );
+        }
 
-                    vector<BSONObj> indexes;
+        /**
+         * Deletes the expired documents of all of the TTL indexes, taking turns between the
+         * indexes a batch at a time so that none of them holds its locks for long, until the
+         * documents are all deleted or 'deadline' passes.  Sets the backlog metric to the
+         * expired documents left.
+         *
+         * @return true if all of the expired documents were deleted
+         */
+        bool doTTLPass( long long deadline ) {
+            set<string> dbs;
+            dbHolder().getAllShortNames( dbs );
+
+            ttlPasses.increment();
+
+            vector<TTLIndex> indexes;
+            for ( set<string>::const_iterator i=dbs.begin(); i!=dbs.end(); ++i ) {
+                vector<BSONObj> specs;
+                {
+                    OperationContextImpl txn;
+                    getTTLIndexesForDB( &txn, *i, &specs );
+                }
+                for ( size_t j = 0; j < specs.size(); j++ ) {
+                    indexes.push_back( TTLIndex( *i, specs[j] ) );
+                }
+            }
+
+            // When each collection may next be deleted from, if the deletes are rate limited.
+            map<string, long long> nextBatchTimes;
+
+            size_t remaining = indexes.size();
+            while ( remaining && !inShutdown() && ttlMonitorEnabled ) {
+                const long long now = nowMillis();
+                if ( now >= deadline )
+                    break;
+
+                long long wakeTime = deadline;
+                bool didBatch = false;
+                for ( size_t i = 0; i < indexes.size(); i++ ) {
+                    TTLIndex& index = indexes[i];
+                    if ( index.done )
+                        continue;
+
+                    const string ns = index.spec["ns"].String();
+                    long long& nextBatchTime = nextBatchTimes[ns];
+                    if ( nextBatchTime > nowMillis() ) {
+                        wakeTime = std::min( wakeTime, nextBatchTime );
+                        continue;
+                    }
+
+                    long long deleted = 0;
+                    BatchResult result;
                     {
                         OperationContextImpl txn;
-                        getTTLIndexesForDB( &txn, db, &indexes );
+                        result = doTTLBatchForIndex( &txn, index.dbName, index.spec, &deleted );
                     }
+                    didBatch = true;
 
-                    for ( vector<BSONObj>::const_iterator it = indexes.begin();
-                          it != indexes.end(); ++it ) {
+                    const int maxDeletesPerSecond = ttlMonitorMaxDeletesPerSecond;
+                    if ( maxDeletesPerSecond > 0 ) {
+                        nextBatchTime = std::max( nextBatchTime, nowMillis() ) +
+                                        deleted * 1000 / maxDeletesPerSecond;
+                    }
 
-                        OperationContextImpl txn;
-                        if ( !doTTLForIndex( &txn, db, *it ) ) {
-                            break;  // stop processing TTL indexes on this database
+                    if ( result == BATCH_INDEX_DONE ) {
+                        index.done = true;
+                        --remaining;
+                    }
+                    else if ( result == BATCH_DB_DONE ) {
+                        for ( size_t j = 0; j < indexes.size(); j++ ) {
+                            if ( !indexes[j].done && indexes[j].dbName == index.dbName ) {
+                                indexes[j].done = true;
+                                --remaining;
+                            }
                         }
                     }
                 }
+
+                if ( !didBatch ) {
+                    sleepmillis( std::max( 1LL, wakeTime - nowMillis() ) );
+                }
             }
+
+            long long backlog = 0;
+            for ( size_t i = 0; i < indexes.size(); i++ ) {
+                if ( !indexes[i].done ) {
+                    OperationContextImpl txn;
+                    backlog += countExpired( &txn, indexes[i].dbName, indexes[i].spec );
+                }
+            }
+            const long long lastBacklog = ttlBacklogDocuments.get();
+            if ( backlog > lastBacklog )
+                ttlBacklogDocuments.increment( backlog - lastBacklog );
+            else
+                ttlBacklogDocuments.decrement( lastBacklog - backlog );
+
+            if ( remaining ) {
+                LOG(1) << "TTL: pass ended with " << remaining << " of " << indexes.size()
+                       << " indexes holding about " << backlog << " expired documents" << endl;
+            }
+            return remaining == 0;
         }
 
-    private:
         /**
          * Acquire an IS-mode lock on the specified database and for each
          * collection in the database, append the specification of all
@@ -174,70 +309,178 @@ namespace mongo {
         }
 
         /**
-         * Remove documents from the collection using the specified TTL index
-         * after a sufficient amount of time has passed according to its expiry
-         * specification.
-         *
-         * @return true if caller should continue processing TTL indexes of collections
-         *         on the specified database, and false otherwise
+         * The bounds of the scan of a TTL index, with key pattern 'key', for the documents which
+         * expired before 'expireDate', in order of expiry.  The bounds also hold booleans, so
+         * 'filter' must be applied to what they find.
+         */
+        static void getExpiredRange( const BSONObj& key, Date_t expireDate,
+                                     BSONObj* startKey, BSONObj* endKey,
+                                     InternalPlanner::Direction* direction ) {
+            BSONObjBuilder minDate;
+            minDate.appendMinForType( "", Date );
+            *startKey = minDate.obj();
+            *endKey = BSON( "" << expireDate );
+            *direction = key.firstElement().number() < 0 ? InternalPlanner::BACKWARD
+                                                         : InternalPlanner::FORWARD;
+        }
+
+        /**
+         * The query for the documents of a TTL index which have expired, or an empty object if
+         * the index spec is not valid.
          */
-        bool doTTLForIndex( OperationContext* txn, const string& dbName, const BSONObj& idx ) {
+        static BSONObj getExpiredQuery( const BSONObj& idx, Date_t* expireDate ) {
             BSONObj key = idx["key"].Obj();
             if ( key.nFields() != 1 ) {
                 error() << "key for ttl index can only have 1 field" << endl;
-                return true;
+                return BSONObj();
             }
             if ( !idx[secondsExpireField].isNumber() ) {
                 log() << "ttl indexes require the " << secondsExpireField << " field to be "
                       << "numeric but received a type of: "
                       << typeName( idx[secondsExpireField].type() );
-                return true;
+                return BSONObj();
             }
 
-            BSONObj query;
-            {
-                BSONObjBuilder b;
-                long long expireMs = 1000 * idx[secondsExpireField].numberLong();
-                b.appendDate( "$lt", curTimeMillis64() - expireMs );
-                query = BSON( key.firstElement().fieldName() << b.obj() );
+            long long expireMs = 1000 * idx[secondsExpireField].numberLong();
+            *expireDate = Date_t( curTimeMillis64() - expireMs );
+            return BSON( key.firstElement().fieldName() << BSON( "$lt" << *expireDate ) );
+        }
+
+        /**
+         * Remove up to ttlMonitorBatchSize documents from the collection of the specified TTL
+         * index, in order of expiry, after a sufficient amount of time has passed according
+         * to its expiry specification.
+         */
+        BatchResult doTTLBatchForIndex( OperationContext* txn, const string& dbName,
+                                        const BSONObj& idx, long long* deleted ) {
+            Date_t expireDate;
+            BSONObj query = getExpiredQuery( idx, &expireDate );
+            if ( query.isEmpty() ) {
+                return BATCH_INDEX_DONE;
+            }
+            BSONObj key = idx["key"].Obj();
+
+            StatusWithMatchExpression filter = MatchExpressionParser::parse( query );
+            if ( !filter.isOK() ) {
+                error() << "ttl: bad query " << query << ": " << filter.getStatus() << endl;
+                return BATCH_INDEX_DONE;
             }
+            boost::scoped_ptr<MatchExpression> filterHolder( filter.getValue() );
 
             LOG(1) << "TTL: " << key << " \t " << query << endl;
 
+            const int batchSize = std::max( 1, static_cast<int>( ttlMonitorBatchSize ) );
             long long n = 0;
             {
                 const string ns = idx["ns"].String();
 
                 AutoGetDb autoDb(txn, dbName, MODE_IX);
                 Database* db = autoDb.getDb();
-                if (!db) return false;
+                if (!db) return BATCH_DB_DONE;
 
                 Lock::CollectionLock collLock( txn->lockState(), ns, MODE_IX );
 
                 Collection* collection = db->getCollection( txn, ns );
                 if ( !collection ) {
                     // collection was dropped
-                    return true;
+                    return BATCH_INDEX_DONE;
                 }
 
                 if (!repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(dbName)) {
                     // we've stepped down since we started this function,
                     // so we should stop working as we only do deletes on the primary
-                    return false;
+                    return BATCH_DB_DONE;
                 }
 
-                if ( collection->getIndexCatalog()->findIndexByKeyPattern( txn, key ) == NULL ) {
+                const IndexDescriptor* desc =
+                    collection->getIndexCatalog()->findIndexByKeyPattern( txn, key );
+                if ( desc == NULL ) {
                     // index not finished yet
                     LOG(1) << " skipping index because not finished";
-                    return true;
+                    return BATCH_INDEX_DONE;
                 }
 
-                n = deleteObjects( txn, db, ns, query, PlanExecutor::YIELD_AUTO, false, true );
+                BSONObj startKey;
+                BSONObj endKey;
+                InternalPlanner::Direction direction;
+                getExpiredRange( key, expireDate, &startKey, &endKey, &direction );
+
+                DeleteStageParams params;
+                params.isMulti = true;
+                params.shouldCallLogOp = true;
+
+                boost::scoped_ptr<PlanExecutor> exec(
+                    InternalPlanner::deleteWithIndexScan( txn, collection, params, desc,
+                                                          startKey, endKey, false,
+                                                          filterHolder.get(), batchSize,
+                                                          PlanExecutor::YIELD_AUTO,
+                                                          direction ) );
+                Status status = exec->executePlan();
+                if ( !status.isOK() ) {
+                    error() << "ttl: delete from " << ns << " failed: " << status << endl;
+                    return BATCH_INDEX_DONE;
+                }
+
+                const DeleteStats* stats =
+                    static_cast<const DeleteStats*>( exec->getRootStage()->getSpecificStats() );
+                n = stats->docsDeleted;
                 ttlDeletedDocuments.increment( n );
+                ttlDeleteBatches.increment();
             }
 
             LOG(1) << "\tTTL deleted: " << n << endl;
-            return true;
+            *deleted = n;
+            return n < batchSize ? BATCH_INDEX_DONE : BATCH_FULL;
+        }
+
+        /**
+         * The number of documents of the specified TTL index which have expired, counted from
+         * its keys.
+         */
+        long long countExpired( OperationContext* txn, const string& dbName, const BSONObj& idx ) {
+            Date_t expireDate;
+            BSONObj query = getExpiredQuery( idx, &expireDate );
+            if ( query.isEmpty() ) {
+                return 0;
+            }
+            BSONObj key = idx["key"].Obj();
+            const string ns = idx["ns"].String();
+
+            AutoGetDb autoDb(txn, dbName, MODE_IS);
+            Database* db = autoDb.getDb();
+            if (!db) return 0;
+
+            Lock::CollectionLock collLock( txn->lockState(), ns, MODE_IS );
+
+            Collection* collection = db->getCollection( txn, ns );
+            if ( !collection ) {
+                return 0;
+            }
+            const IndexDescriptor* desc =
+                collection->getIndexCatalog()->findIndexByKeyPattern( txn, key );
+            if ( desc == NULL ) {
+                return 0;
+            }
+
+            BSONObj startKey;
+            BSONObj endKey;
+            InternalPlanner::Direction direction;
+            getExpiredRange( key, expireDate, &startKey, &endKey, &direction );
+
+            boost::scoped_ptr<PlanExecutor> exec(
+                InternalPlanner::indexScan( txn, collection, desc, startKey, endKey, false,
+                                            direction ) );
+            exec->setYieldPolicy( PlanExecutor::YIELD_AUTO );
+
+            long long count = 0;
+            BSONObj expiredKey;
+            while ( PlanExecutor::ADVANCED == exec->getNext( &expiredKey, NULL ) ) {
+                // The scan starts at the booleans, which are not dates that expired.
+                if ( expiredKey.firstElement().type() == Date ) {
+                    count++;
+                }
+            }
+            return count;
         }
     };
 
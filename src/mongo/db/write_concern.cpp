@@ -32,6 +32,7 @@
 
 #include "mongo/base/counter.h"
 #include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/curop.h"
 #include "mongo/db/global_environment_experiment.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
@@ -137,10 +138,10 @@ namespace mongo {
         }
     }
 
-    Status waitForWriteConcern( OperationContext* txn,
-                                const WriteConcernOptions& writeConcern,
-                                const OpTime& replOpTime,
-                                WriteConcernResult* result ) {
+    static Status _waitForWriteConcern( OperationContext* txn,
+                                        const WriteConcernOptions& writeConcern,
+                                        const OpTime& replOpTime,
+                                        WriteConcernResult* result ) {
 
         // We assume all options have been validated earlier, if not, programming error
         dassert( validateWriteConcern( writeConcern ).isOK() );
@@ -204,4 +205,18 @@ namespace mongo {
         return replStatus.status;
     }
 
+    Status waitForWriteConcern( OperationContext* txn,
+                                const WriteConcernOptions& writeConcern,
+                                const OpTime& replOpTime,
+                                WriteConcernResult* result ) {
+        Timer waitTimer;
+        Status status = _waitForWriteConcern( txn, writeConcern, replOpTime, result );
+
+        // All of the wait counts against the operation
+        if ( txn->getCurOp() ) {
+            OpDebug::addTo( &txn->getCurOp()->debug().writeConcernMicros, waitTimer.micros() );
+        }
+        return status;
+    }
+
 } // namespace mongo
@@ -837,6 +837,181 @@ namespace AccumulatorTests {
         
     } // namespace Sum
 
+    namespace ApproxCountDistinct {
+
+        class Base : public AccumulatorTests::Base {
+        protected:
+            intrusive_ptr<Accumulator> create() {
+                intrusive_ptr<Accumulator> accumulator = AccumulatorApproxCountDistinct::create();
+                ASSERT_EQUALS(string("$approxCountDistinct"), accumulator->getOpName());
+                return accumulator;
+            }
+            long long count(const intrusive_ptr<Accumulator>& accumulator) {
+                return accumulator->getValue(false).coerceToLong();
+            }
+            /** Asserts the estimate is within 5% of the exact count, about three standard errors. */
+            void assertClose(long long expected, long long actual) {
+                ASSERT_LESS_THAN_OR_EQUALS(std::abs(expected - actual), expected / 20);
+            }
+        };
+
+        /** Few distinct values are counted exactly, with equal numbers of any type as one. */
+        class Exact : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> accumulator = create();
+                ASSERT_EQUALS(0, count(accumulator));
+                for (int i = 0; i < 100; i++) {
+                    accumulator->process(Value(i), false);
+                    accumulator->process(Value(static_cast<double>(i)), false);
+                    accumulator->process(Value(DOC("a" << i % 10)), false);
+                }
+                accumulator->process(Value(), false);
+                ASSERT_EQUALS(110, count(accumulator));
+                accumulator->reset();
+                ASSERT_EQUALS(0, count(accumulator));
+            }
+        };
+
+        /** Many distinct values are estimated. */
+        class Estimated : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> accumulator = create();
+                for (int i = 0; i < 100000; i++) {
+                    accumulator->process(Value(i % 50000), false);
+                }
+                assertClose(50000, count(accumulator));
+            }
+        };
+
+        /** Partial results from shards, exact or estimated, merge into the estimate of the union. */
+        class Merge : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> small = create();
+                intrusive_ptr<Accumulator> large = create();
+                intrusive_ptr<Accumulator> otherLarge = create();
+                for (int i = 0; i < 20000; i++) {
+                    if (i < 100)
+                        small->process(Value(-i), false);
+                    large->process(Value(i), false);
+                    otherLarge->process(Value(i + 10000), false);
+                }
+
+                intrusive_ptr<Accumulator> merger = create();
+                merger->process(small->getValue(true), true);
+                ASSERT_EQUALS(100, count(merger));
+                merger->process(large->getValue(true), true);
+                merger->process(otherLarge->getValue(true), true);
+                assertClose(30099, count(merger));
+            }
+        };
+
+    } // namespace ApproxCountDistinct
+
+    namespace Percentile {
+
+        class Base : public AccumulatorTests::Base {
+        protected:
+            intrusive_ptr<Accumulator> create(double percentile) {
+                return AccumulatorPercentile::create(vector<double>(1, percentile), false);
+            }
+            intrusive_ptr<Accumulator> createQuartiles() {
+                vector<double> quartiles;
+                for (int i = 0; i <= 4; i++) {
+                    quartiles.push_back(i / 4.0);
+                }
+                intrusive_ptr<Accumulator> accumulator =
+                    AccumulatorPercentile::create(quartiles, true);
+                ASSERT_EQUALS(string("$percentile"), accumulator->getOpName());
+                return accumulator;
+            }
+            /** Processes 0 to n - 1, shuffled, into one of 'accumulators' at a time. */
+            void processShuffled(int n, const vector<intrusive_ptr<Accumulator> >& accumulators) {
+                for (int i = 0; i < n; i++) {
+                    accumulators[i % accumulators.size()]->process(Value((i * 7919) % n), false);
+                }
+            }
+            /** Asserts the estimates of the quartiles of 0 to n - 1 are within 1% of n. */
+            void assertQuartiles(int n, const Value& estimates) {
+                ASSERT_EQUALS(0, estimates[0].getDouble());
+                for (int i = 1; i < 4; i++) {
+                    ASSERT_LESS_THAN_OR_EQUALS(fabs(estimates[i].getDouble() - (n - 1) * i / 4.0),
+                                               n / 100.0);
+                }
+                ASSERT_EQUALS(n - 1, estimates[4].getDouble());
+            }
+        };
+
+        /** No numeric values give null. */
+        class None : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> accumulator = create(0.5);
+                accumulator->process(Value("a"), false);
+                accumulator->process(Value(), false);
+                ASSERT_EQUALS(Value(BSONNULL), accumulator->getValue(false));
+            }
+        };
+
+        /** Any percentile of one value is that value. */
+        class One : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> accumulator = create(0.9);
+                accumulator->process(Value(7), false);
+                ASSERT_EQUALS(7, accumulator->getValue(false).getDouble());
+            }
+        };
+
+        /** Percentiles of many values are estimated, with the extremes exact. */
+        class Quartiles : public Base {
+        public:
+            void run() {
+                vector<intrusive_ptr<Accumulator> > accumulators(1, createQuartiles());
+                processShuffled(100000, accumulators);
+                assertQuartiles(100000, accumulators[0]->getValue(false));
+            }
+        };
+
+        /** Partial digests from shards merge. */
+        class Merge : public Base {
+        public:
+            void run() {
+                vector<intrusive_ptr<Accumulator> > shards;
+                for (int i = 0; i < 3; i++) {
+                    shards.push_back(createQuartiles());
+                }
+                processShuffled(30000, shards);
+
+                intrusive_ptr<Accumulator> merger = createQuartiles();
+                intrusive_ptr<Accumulator> empty = createQuartiles();
+                merger->process(empty->getValue(true), true);
+                for (int i = 0; i < 3; i++) {
+                    merger->process(shards[i]->getValue(true), true);
+                }
+                assertQuartiles(30000, merger->getValue(false));
+            }
+        };
+
+        /** The percentiles are serialized with the input. */
+        class Serialize : public Base {
+        public:
+            void run() {
+                assertBinaryEqual(BSON("" << BSON("$percentile" << BSON("input" << "$a"
+                                                                        << "p" << 0.5))),
+                                  fromValue(create(0.5)->serialize(Value("$a"))));
+                assertBinaryEqual(BSON("" << BSON("$percentile" <<
+                                                  BSON("input" << "$a"
+                                                       << "p" << BSON_ARRAY(0.0 << 0.25 << 0.5
+                                                                            << 0.75 << 1.0)))),
+                                  fromValue(createQuartiles()->serialize(Value("$a"))));
+            }
+        };
+
+    } // namespace Percentile
+
     class All : public Suite {
     public:
         All() : Suite( "accumulator" ) {
@@ -913,6 +1088,14 @@ namespace AccumulatorTests {
             add<Sum::IntNull>();
             add<Sum::IntUndefined>();
             add<Sum::NoOverflowBeforeDouble>();
+            add<ApproxCountDistinct::Exact>();
+            add<ApproxCountDistinct::Estimated>();
+            add<ApproxCountDistinct::Merge>();
+            add<Percentile::None>();
+            add<Percentile::One>();
+            add<Percentile::Quartiles>();
+            add<Percentile::Merge>();
+            add<Percentile::Serialize>();
         }
     };
 
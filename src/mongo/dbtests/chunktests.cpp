@@ -67,6 +67,7 @@ namespace mongo {
             }
             
             chunkRanges.reloadAll( chunkMap );
+            const_cast<ChunkRoutingTable&>( _routingTable ).reloadAll( chunkMap, false );
         }
     };
     
@@ -246,6 +247,45 @@ namespace ChunkTests {
             }
         };
 
+        class FindIntersectingChunks {
+        public:
+            void run() {
+                ShardKeyPattern shardKeyPattern(BSON("a" << 1));
+                ChunkManager chunkManager("", shardKeyPattern, false);
+
+                vector<BSONObj> splitPoints;
+                splitPoints.push_back(BSON("a" << "x"));
+                splitPoints.push_back(BSON("a" << "y"));
+                splitPoints.push_back(BSON("a" << "z"));
+                chunkManager.setSingleChunkForShards(splitPoints);
+
+                vector<BSONObj> shardKeys;
+                shardKeys.push_back(BSON("a" << "a"));
+                shardKeys.push_back(BSON("a" << "x"));
+                shardKeys.push_back(BSON("a" << "xa"));
+                shardKeys.push_back(BSONObj());
+                shardKeys.push_back(BSON("a" << "zz"));
+                shardKeys.push_back(BSON("a" << "y"));
+
+                vector<ChunkPtr> chunks;
+                chunkManager.findIntersectingChunks(shardKeys, &chunks);
+                ASSERT_EQUALS(shardKeys.size(), chunks.size());
+
+                ASSERT_EQUALS("0", chunks[0]->getShard().getName());
+                ASSERT_EQUALS("1", chunks[1]->getShard().getName());
+                ASSERT_EQUALS("1", chunks[2]->getShard().getName());
+                ASSERT(!chunks[3]);
+                ASSERT_EQUALS("3", chunks[4]->getShard().getName());
+                ASSERT_EQUALS("2", chunks[5]->getShard().getName());
+
+                for (size_t i = 0; i < shardKeys.size(); ++i) {
+                    if (shardKeys[i].isEmpty())
+                        continue;
+                    ASSERT(chunks[i] == chunkManager.findIntersectingChunk(shardKeys[i]));
+                }
+            }
+        };
+
     } // namespace ChunkManagerTests
     
     class All : public Suite {
@@ -273,6 +313,7 @@ namespace ChunkTests {
             add<ChunkManagerTests::InequalityThenUnsatisfiable>();
             add<ChunkManagerTests::OrEqualityUnsatisfiableInequality>();
             add<ChunkManagerTests::InMultiShard>();
+            add<ChunkManagerTests::FindIntersectingChunks>();
         }
     };
 
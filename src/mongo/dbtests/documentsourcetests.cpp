@@ -848,6 +848,64 @@ namespace DocumentSourceTests {
             }
         };
 
+        /** A shard's $group outputs its groups in key order for a streaming merge. */
+        class SortedShardOutput : public Base {
+        public:
+            void run() {
+                client.insert( ns, BSON( "a" << 2 << "b" << 1 ) );
+                client.insert( ns, BSON( "a" << 1 ) );
+                client.insert( ns, BSON( "a" << 1 << "b" << 2 ) );
+                client.insert( ns, BSON( "a" << 1 << "b" << 1 ) );
+                client.insert( ns, BSON( "a" << 2 << "b" << 1 ) );
+                createSource();
+                createGroup( fromjson( "{_id:{a:'$a',b:'$b'},n:{$sum:1}}" ), true );
+
+                SplittableDocumentSource* splittable =
+                        dynamic_cast<SplittableDocumentSource*>( group() );
+                ASSERT( splittable );
+                ASSERT_EQUALS( group(), splittable->getShardSource().get() );
+                ASSERT( toBson( group() )[ "$group" ][ "$sortedOutput" ].trueValue() );
+
+                // A missing part of the key sorts before any value.
+                BSONArrayBuilder results;
+                while ( boost::optional<Document> current = group()->getNext() ) {
+                    results << current->toBson();
+                }
+                assertExhausted( group() );
+                ASSERT_EQUALS( fromjson( "{'':[{_id:{a:1},n:1},"
+                                         "{_id:{a:1,b:1},n:1},"
+                                         "{_id:{a:1,b:2},n:1},"
+                                         "{_id:{a:2,b:1},n:2}]}" )[ "" ].Obj(),
+                               results.arr() );
+            }
+        };
+
+        /**
+         * A merger expecting presorted input still merges correctly when its source isn't a set
+         * of shard cursors.
+         */
+        class PresortedMergerFallback : public CheckResultsBase {
+        public:
+            void run() {
+                BSONObj sourceData =
+                        fromjson( "{'':[{_id:{x:0},n:1},{_id:{x:0,y:1},n:2}" // from shard 1
+                                  ",{_id:{x:0,y:1},n:3},{_id:{x:0},n:4}]}" // from shard 2
+                                  );
+                intrusive_ptr<DocumentSourceBsonArray> source =
+                        DocumentSourceBsonArray::create( sourceData.firstElement().Obj(), ctx() );
+                createGroup( fromjson( "{_id:{x:'$x',y:'$y'},n:{$sum:1}}" ) );
+                dynamic_cast<SplittableDocumentSource*>( group() )->getShardSource();
+                intrusive_ptr<DocumentSource> merger = createMerger();
+                ASSERT( toBson( merger )[ "$group" ][ "$mergePresorted" ].trueValue() );
+                merger->setSource( source.get() );
+                checkResultSet( merger );
+            }
+        private:
+            string expectedResultSetString() {
+                return "[{_id:{x:0},n:5},{_id:{x:0,y:1},n:5}]";
+            }
+        };
+
         /** Dependant field paths. */
         class Dependencies : public Base {
         public:
@@ -880,6 +938,152 @@ namespace DocumentSourceTests {
             string expectedResultSetString() { return "[{_id:'$_id...',a:['$a...']}]"; }
         };
 
+        /** Enough input for the cursor to hand $group several full batches. */
+        class ManyBatches : public CheckResultsBase {
+            void populateData() {
+                for ( int i = 0; i < 2500; ++i ) {
+                    client.insert( ns, BSON( "a" << i % 3 << "b" << i ) );
+                }
+            }
+            BSONObj groupSpec() {
+                return fromjson( "{_id:'$a',n:{$sum:1},max:{$max:'$b'},c:{$first:'$c'}}" );
+            }
+            string expectedResultSetString() {
+                return "[{_id:0,n:834,max:2499,c:null},"
+                       "{_id:1,n:833,max:2497,c:null},"
+                       "{_id:2,n:833,max:2498,c:null}]";
+            }
+        };
+
+        /** Groups spread over several threads by key give the same results. */
+        class Parallel : public CheckResultsBase {
+        public:
+            Parallel() : _oldParallelism( internalAggregationGroupParallelism ) {
+                internalAggregationGroupParallelism = 4;
+            }
+            virtual ~Parallel() {
+                internalAggregationGroupParallelism = _oldParallelism;
+            }
+            void populateData() {
+                for ( int i = 0; i < 5000; ++i ) {
+                    client.insert( ns, BSON( "a" << i % 100 << "b" << i ) );
+                }
+            }
+            BSONObj groupSpec() {
+                return fromjson( "{_id:'$a',n:{$sum:1},max:{$max:'$b'}}" );
+            }
+            BSONObj expectedResultSet() {
+                BSONArrayBuilder expected;
+                for ( int a = 0; a < 100; ++a ) {
+                    expected << BSON( "_id" << a << "n" << 50 << "max" << 4900 + a );
+                }
+                return expected.arr();
+            }
+        private:
+            const int _oldParallelism;
+        };
+
+        /** Parallel groups are merged back into key order when the output must be sorted. */
+        class ParallelSortedOutput : public Base {
+        public:
+            ParallelSortedOutput() : _oldParallelism( internalAggregationGroupParallelism ) {
+                internalAggregationGroupParallelism = 4;
+            }
+            virtual ~ParallelSortedOutput() {
+                internalAggregationGroupParallelism = _oldParallelism;
+            }
+            void run() {
+                for ( int i = 0; i < 5000; ++i ) {
+                    client.insert( ns, BSON( "a" << i % 100 << "b" << i % 3 ) );
+                }
+                createSource();
+                createGroup( fromjson( "{_id:{a:'$a',b:'$b'},n:{$sum:1}}" ), true );
+                dynamic_cast<SplittableDocumentSource*>( group() )->getShardSource();
+
+                int numGroups = 0;
+                boost::optional<Document> previous;
+                while ( boost::optional<Document> current = group()->getNext() ) {
+                    if ( previous ) {
+                        ASSERT_LESS_THAN( Value::compare( ( *previous )[ "_id" ],
+                                                          ( *current )[ "_id" ] ), 0 );
+                    }
+                    previous = current;
+                    numGroups++;
+                }
+                assertExhausted( group() );
+                ASSERT_EQUALS( 300, numGroups );
+            }
+        private:
+            const int _oldParallelism;
+        };
+
+        /**
+         * A streaming group outputs each group of sorted input in order, and those whose keys
+         * don't sort the same way everywhere at the end.
+         */
+        class Streaming : public Base {
+        public:
+            void run() {
+                BSONObj sourceData =
+                        fromjson( "{'':[{v:1},{a:null,v:2},{a:undefined,v:3},{a:1,v:4}"
+                                  ",{a:[1,2],v:5},{a:1,v:6},{a:{b:1},v:7},{a:{b:1},v:8}]}" );
+                intrusive_ptr<DocumentSourceBsonArray> source =
+                        DocumentSourceBsonArray::create( sourceData.firstElement().Obj(), ctx() );
+                createGroup( fromjson( "{_id:'$a',n:{$sum:1},v:{$push:'$v'}}" ) );
+                group()->setSource( source.get() );
+
+                DocumentSourceGroup* streamingGroup = static_cast<DocumentSourceGroup*>( group() );
+                ASSERT( streamingGroup->canStreamSortedBy( BSON( "a" << -1 << "b" << 1 ) ) );
+                ASSERT( !streamingGroup->canStreamSortedBy( BSON( "b" << 1 << "a" << 1 ) ) );
+                streamingGroup->setStreaming( true );
+
+                ASSERT_EQUALS( fromjson( "{_id:1,n:2,v:[4,6]}" ), group()->getNext()->toBson() );
+                ASSERT_EQUALS( fromjson( "{_id:{b:1},n:2,v:[7,8]}" ),
+                               group()->getNext()->toBson() );
+
+                BSONObjSet keptAside;
+                while ( boost::optional<Document> current = group()->getNext() ) {
+                    keptAside.insert( current->toBson() );
+                }
+                assertExhausted( group() );
+
+                BSONObjSet expected;
+                expected.insert( fromjson( "{_id:null,n:2,v:[1,2]}" ) );
+                expected.insert( fromjson( "{_id:undefined,n:1,v:[3]}" ) );
+                expected.insert( fromjson( "{_id:[1,2],n:1,v:[5]}" ) );
+                ASSERT( expected == keptAside );
+            }
+        };
+
+        /** A streaming compound key only needs its parts next to each other. */
+        class StreamingCompoundId : public Base {
+        public:
+            void run() {
+                for ( int i = 0; i < 100; ++i ) {
+                    client.insert( ns, BSON( "a" << i / 10 << "b" << i % 10 / 5 << "c" << i ) );
+                }
+                createSource();
+                createGroup( fromjson( "{_id:{y:'$b',x:'$a'},n:{$sum:'$c'}}" ) );
+                DocumentSourceGroup* streamingGroup = static_cast<DocumentSourceGroup*>( group() );
+                ASSERT( streamingGroup->canStreamSortedBy( BSON( "a" << 1 << "b" << 1 ) ) );
+                streamingGroup->setStreaming( true );
+
+                // Documents come out of the collection in the order they were inserted.
+                int numGroups = 0;
+                while ( boost::optional<Document> current = group()->getNext() ) {
+                    const int a = numGroups / 2;
+                    const int b = numGroups % 2;
+                    const int first = a * 10 + b * 5;
+                    ASSERT_EQUALS( BSON( "_id" << BSON( "y" << b << "x" << a )
+                                         << "n" << 5 * first + 10 ),
+                                   current->toBson() );
+                    numGroups++;
+                }
+                assertExhausted( group() );
+                ASSERT_EQUALS( 20, numGroups );
+            }
+        };
+
         /** An array constant passed to an accumulator. */
         class ArrayConstantAccumulatorExpression : public CheckResultsBase {
         public:
@@ -1023,6 +1227,33 @@ namespace DocumentSourceTests {
             }
         };
 
+        /** A simple projection passes batches through to a $group. */
+        class GroupBatches : public Base {
+        public:
+            void run() {
+                client.insert( ns, BSON( "_id" << 0 << "a" << 1 << "b" << 2 ) );
+                client.insert( ns, BSON( "_id" << 1 << "a" << 1 << "b" << 3 ) );
+                client.insert( ns, BSON( "_id" << 2 << "a" << 2 << "b" << 5 ) );
+                createSource();
+                createProject( fromjson( "{_id:0,k:'$a',b:1}" ) );
+
+                BSONObj spec = fromjson( "{$group:{_id:'$k',s:{$sum:'$b'},ids:{$push:'$_id'},"
+                                         "a:{$push:'$a'}}}" );
+                intrusive_ptr<DocumentSource> group =
+                        mongo::DocumentSourceGroup::createFromBson( spec.firstElement(), ctx() );
+                group->setSource( project() );
+
+                // Only the projected fields reach the group.
+                map<int, BSONObj> results;
+                while ( boost::optional<Document> next = group->getNext() ) {
+                    results[ next->getField( "_id" ).getInt() ] = next->toBson();
+                }
+                ASSERT_EQUALS( 2U, results.size() );
+                ASSERT_EQUALS( fromjson( "{_id:1,s:5,ids:[],a:[]}" ), results[ 1 ] );
+                ASSERT_EQUALS( fromjson( "{_id:2,s:5,ids:[],a:[]}" ), results[ 2 ] );
+            }
+        };
+
         /** List of dependent field paths. */
         class Dependencies : public Base {
         public:
@@ -1424,6 +1655,7 @@ namespace DocumentSourceTests {
                 populateData();
                 createSource();
                 createUnwind( unwindFieldPath() );
+                setOutputDependencies( static_cast<DocumentSourceUnwind*>( unwind() ) );
 
                 // Load the results from the DocumentSourceUnwind.
                 vector<Document> resultSet;
@@ -1454,6 +1686,7 @@ namespace DocumentSourceTests {
             }
             virtual string expectedResultSetString() const { return "[]"; }
             virtual string unwindFieldPath() const { return "$a"; }
+            virtual void setOutputDependencies( DocumentSourceUnwind* unwind ) {}
         };
 
         class UnexpectedTypeBase : public Base {
@@ -1629,6 +1862,37 @@ namespace DocumentSourceTests {
             }
         };
 
+        /** Only the top-level fields the later stages need, and the unwound one, are output. */
+        class LimitedOutputFields : public CheckResultsBase {
+            void populateData() {
+                client.insert( ns, fromjson( "{_id:0,a:{b:[1,2],c:3},d:{e:4,f:5},g:6}" ) );
+            }
+            void setOutputDependencies( DocumentSourceUnwind* unwind ) {
+                DepsTracker dependencies;
+                dependencies.fields.insert( "d.e" );
+                dependencies.fields.insert( "h" );
+                unwind->setOutputDependencies( dependencies );
+            }
+            string expectedResultSetString() const {
+                return "[{a:{b:1,c:3},d:{e:4,f:5}},{a:{b:2,c:3},d:{e:4,f:5}}]";
+            }
+            string unwindFieldPath() const { return "$a.b"; }
+        };
+
+        /** All fields are output if the later stages need the whole document. */
+        class WholeDocumentOutput : public CheckResultsBase {
+            void populateData() {
+                client.insert( ns, fromjson( "{_id:0,a:[1,2],b:3}" ) );
+            }
+            void setOutputDependencies( DocumentSourceUnwind* unwind ) {
+                DepsTracker dependencies;
+                dependencies.fields.insert( "a" );
+                dependencies.needWholeDocument = true;
+                unwind->setOutputDependencies( dependencies );
+            }
+            string expectedResultSetString() const { return "[{_id:0,a:1,b:3},{_id:0,a:2,b:3}]"; }
+        };
+
         /** Dependant field paths. */
         class Dependencies : public Base {
         public:
@@ -1929,9 +2193,16 @@ namespace DocumentSourceTests {
             add<DocumentSourceGroup::ComplexId>();
             add<DocumentSourceGroup::UndefinedAccumulatorValue>();
             add<DocumentSourceGroup::RouterMerger>();
+            add<DocumentSourceGroup::SortedShardOutput>();
+            add<DocumentSourceGroup::PresortedMergerFallback>();
             add<DocumentSourceGroup::Dependencies>();
             add<DocumentSourceGroup::StringConstantIdAndAccumulatorExpressions>();
             add<DocumentSourceGroup::ArrayConstantAccumulatorExpression>();
+            add<DocumentSourceGroup::ManyBatches>();
+            add<DocumentSourceGroup::Parallel>();
+            add<DocumentSourceGroup::ParallelSortedOutput>();
+            add<DocumentSourceGroup::Streaming>();
+            add<DocumentSourceGroup::StreamingCompoundId>();
 
             add<DocumentSourceProject::Inclusion>();
             add<DocumentSourceProject::Optimize>();
@@ -1940,6 +2211,7 @@ namespace DocumentSourceTests {
             add<DocumentSourceProject::TopLevelDollar>();
             add<DocumentSourceProject::InvalidSpec>();
             add<DocumentSourceProject::TwoDocuments>();
+            add<DocumentSourceProject::GroupBatches>();
             add<DocumentSourceProject::Dependencies>();
 
             add<DocumentSourceSort::Empty>();
@@ -1979,6 +2251,8 @@ namespace DocumentSourceTests {
             add<DocumentSourceUnwind::DoubleNestedArray>();
             add<DocumentSourceUnwind::SeveralDocuments>();
             add<DocumentSourceUnwind::SeveralMoreDocuments>();
+            add<DocumentSourceUnwind::LimitedOutputFields>();
+            add<DocumentSourceUnwind::WholeDocumentOutput>();
             add<DocumentSourceUnwind::Dependencies>();
 
             add<DocumentSourceGeoNear::LimitCoalesce>();
@@ -299,6 +299,67 @@ namespace DocumentTests {
             }
         };
 
+        /** A Document wrapping BSON reads its fields as they are needed. */
+        class WrapBson {
+        public:
+            void run() {
+                BSONObjBuilder bob;
+                for ( int i = 0; i < 20; ++i ) {
+                    bob.append( BSONObjBuilder::numStr( i ), i );
+                }
+                bob.append( "sub", BSON( "b" << 1 ) );
+                const BSONObj obj = bob.obj();
+
+                const Document document = Document::wrapBsonWithMetaData( obj );
+                ASSERT_EQUALS( 15, document["15"].getInt() );
+                ASSERT_EQUALS( 3, document["3"].getInt() );
+                ASSERT( document["missing"].missing() );
+                ASSERT_EQUALS( Value( 1 ), document.getNestedField( FieldPath( "sub.b" ) ) );
+                ASSERT_EQUALS( 21U, document.size() );
+                ASSERT_EQUALS( fromBson( obj ), document );
+
+                // Unchanged, it is output as the BSON it wraps.
+                ASSERT_EQUALS( obj.objdata(), document.toBson().objdata() );
+                assertRoundTrips( document );
+            }
+        };
+
+        /** Changing a Document wrapping BSON leaves the original and its BSON unchanged. */
+        class WrapBsonChange {
+        public:
+            void run() {
+                const BSONObj obj = BSON( "a" << 1 << "b" << 2 << "c" << 3 << "d" << 4 );
+                const Document document = Document::wrapBsonWithMetaData( obj );
+
+                MutableDocument shared( document );
+                shared.setField( "b", Value( 5 ) );
+                ASSERT_EQUALS( BSON( "a" << 1 << "b" << 5 << "c" << 3 << "d" << 4 ),
+                               shared.freeze().toBson() );
+                ASSERT_EQUALS( obj.objdata(), document.toBson().objdata() );
+
+                MutableDocument unshared( Document::wrapBsonWithMetaData( obj ) );
+                unshared.remove( "c" );
+                unshared.addField( "e", Value( 6 ) );
+                ASSERT_EQUALS( BSON( "a" << 1 << "b" << 2 << "d" << 4 << "e" << 6 ),
+                               unshared.freeze().toBson() );
+            }
+        };
+
+        /** A Document wrapping BSON takes metadata out of its fields. */
+        class WrapBsonWithMetaData {
+        public:
+            void run() {
+                const BSONObj obj = BSON( "a" << 1 << Document::metaFieldTextScore << 2.5
+                                          << "b" << 2 );
+                const Document document = Document::wrapBsonWithMetaData( obj );
+                ASSERT( document.hasTextScore() );
+                ASSERT_EQUALS( 2.5, document.getTextScore() );
+                ASSERT( document[ Document::metaFieldTextScore ].missing() );
+                ASSERT_EQUALS( BSON( "a" << 1 << "b" << 2 ), document.toBson() );
+                ASSERT_EQUALS( Document::fromBsonWithMetaData( obj ), document );
+            }
+        };
+
         /** FieldIterator for an empty Document. */
         class FieldIteratorEmpty {
         public:
@@ -592,6 +653,12 @@ namespace DocumentTests {
                 ASSERT_EQUALS( Array, value.getType() );
                 ASSERT_EQUALS( 0U, value.getArrayLength() );
                 assertRoundTrips( value );
+
+                // Empty arrays are stored without an RCVector however they are created.
+                vector<Value> consumed;
+                ASSERT_EQUALS( value, Value::consume( consumed ) );
+                ASSERT_EQUALS( value, Value( BSON( "a" << BSONArray() ).firstElement() ) );
+                ASSERT_EQUALS( sizeof( Value ), value.getApproximateSize() );
             }
         };
 
@@ -614,6 +681,9 @@ namespace DocumentTests {
                 ASSERT_EQUALS( mongo::Array, value.getType() );
                 ASSERT_EQUALS( 3U, value.getArrayLength() );
                 assertRoundTrips( value );
+
+                // The elements alone hash like the Array holding them.
+                ASSERT_EQUALS( Value::Hash()( value ), Value::Hash()( array ) );
             }
         };
 
@@ -1424,6 +1494,9 @@ namespace DocumentTests {
             add<Document::CompareNamedNull>();
             add<Document::Clone>();
             add<Document::CloneMultipleFields>();
+            add<Document::WrapBson>();
+            add<Document::WrapBsonChange>();
+            add<Document::WrapBsonWithMetaData>();
             add<Document::FieldIteratorEmpty>();
             add<Document::FieldIteratorSingle>();
             add<Document::FieldIteratorMultiple>();
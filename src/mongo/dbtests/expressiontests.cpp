@@ -32,6 +32,7 @@
 
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/expression_compiled.h"
 #include "mongo/dbtests/dbtests.h"
 
 namespace ExpressionTests {
@@ -880,7 +881,151 @@ namespace ExpressionTests {
         };
         
     } // namespace Compare
-    
+
+    namespace Compiled {
+
+        /** Parses and optimizes an expression and returns its compiled form. */
+        static intrusive_ptr<Expression> compile( const BSONObj& spec,
+                                                  intrusive_ptr<Expression>* tree = NULL ) {
+            VariablesIdGenerator idGenerator;
+            VariablesParseState vps( &idGenerator );
+            intrusive_ptr<Expression> expression =
+                    Expression::parseOperand( spec.firstElement(), vps )->optimize();
+            if ( tree ) {
+                *tree = expression;
+            }
+            return ExpressionCompiled::compile( expression );
+        }
+
+        /** Returns the result of an evaluation as BSON, or the code of the error it raised. */
+        static BSONObj evaluate( const intrusive_ptr<Expression>& expression,
+                                 const Document& input ) {
+            try {
+                return toBson( expression->evaluate( input ) );
+            }
+            catch ( const UserException& e ) {
+                return BSON( "error" << e.getCode() );
+            }
+        }
+
+        /** Returns whether compiling 'spec' gives something other than its tree. */
+        static bool isCompiled( const BSONObj& spec ) {
+            intrusive_ptr<Expression> tree;
+            intrusive_ptr<Expression> compiled = compile( spec, &tree );
+            return compiled != tree;
+        }
+
+        /** Field paths, constants and unknown operators aren't compiled. */
+        class Leaves {
+        public:
+            void run() {
+                ASSERT( !isCompiled( BSON( "" << "$a" ) ) );
+                ASSERT( !isCompiled( BSON( "" << 5 ) ) );
+                ASSERT( !isCompiled( fromjson( "{'': {$concat: ['$a', '$b']}}" ) ) );
+                ASSERT( isCompiled( fromjson( "{'': {$add: ['$a', 1]}}" ) ) );
+
+                // Compiling a compiled expression changes nothing.
+                intrusive_ptr<Expression> compiled =
+                        compile( fromjson( "{'': {$add: ['$a', 1]}}" ) );
+                ASSERT_EQUALS( compiled, ExpressionCompiled::compile( compiled ) );
+            }
+        };
+
+        /** A compiled expression serializes and reports dependencies like its tree. */
+        class SerializeAndDependencies {
+        public:
+            void run() {
+                intrusive_ptr<Expression> tree;
+                intrusive_ptr<Expression> compiled =
+                        compile( fromjson( "{'': {$cond: [{$gt: ['$a', 1]}, '$b', 2]}}" ),
+                                 &tree );
+                ASSERT_EQUALS( expressionToBson( tree ), expressionToBson( compiled ) );
+                DepsTracker dependencies;
+                compiled->addDependencies( &dependencies );
+                ASSERT_EQUALS( 2U, dependencies.fields.size() );
+                ASSERT_EQUALS( 1U, dependencies.fields.count( "a" ) );
+                ASSERT_EQUALS( 1U, dependencies.fields.count( "b" ) );
+            }
+        };
+
+        /** A tree too deep for the registers is left as it is. */
+        class TooManyRegisters {
+        public:
+            void run() {
+                BSONObj spec = fromjson( "{$add: ['$a', 1]}" );
+                for ( int i = 0; i < ExpressionCompiled::kMaxRegisters; i++ ) {
+                    spec = BSON( "$add" << BSON_ARRAY( spec << "$a" ) );
+                }
+                ASSERT( !isCompiled( BSON( "" << spec ) ) );
+            }
+        };
+
+        /**
+         * Each expression gives the same result or error, with the same types, compiled as
+         * evaluated as a tree, over inputs with numbers of each type, null, missing fields and
+         * values the instructions leave to the tree.
+         */
+        class SameAsTree {
+        public:
+            void run() {
+                const char* specs[] = {
+                    "{$add: ['$a', '$b']}",
+                    "{$add: ['$a', '$b', '$a', 1.5]}",
+                    "{$add: ['$d', '$b']}",
+                    "{$add: ['$n', {$concat: ['$s', 'x']}]}",
+                    "{$add: ['$s', '$n']}",
+                    "{$multiply: ['$a', '$b', '$c']}",
+                    "{$subtract: ['$a', {$multiply: ['$b', 2]}]}",
+                    "{$subtract: ['$d', '$a']}",
+                    "{$subtract: ['$s', '$n']}",
+                    "{$divide: ['$a', '$b']}",
+                    "{$divide: ['$n', '$s']}",
+                    "{$cmp: ['$a', '$b']}",
+                    "{$gte: ['$a', '$c']}",
+                    "{$ne: ['$b', '$s']}",
+                    "{$and: ['$a', {$lt: ['$b', 3]}]}",
+                    "{$or: [{$eq: ['$b', 0]}, {$divide: ['$a', '$b']}]}",
+                    "{$cond: [{$gt: ['$a', '$b']}, {$add: ['$a', 1]}, {$divide: [1, '$b']}]}",
+                    "{$cond: {if: '$s', then: '$d', else: {$subtract: ['$b', '$a']}}}",
+                    "{$add: [{$cond: ['$b', {$divide: ['$a', '$b']}, '$n']}, 1]}",
+                };
+                const char* inputs[] = {
+                    "{a: 1, b: 2, c: 3, s: 'x', d: new Date(5)}",
+                    "{a: 2000000000, b: 2000000000, c: NumberLong(3), n: null}",
+                    "{a: NumberLong(9000000000), b: 0, c: 0.5, s: 1}",
+                    "{a: 2.5, b: -1, c: NaN, d: true}",
+                    "{a: 0, b: 0}",
+                    "{b: 4}",
+                    "{a: {x: 1}, b: 'y', c: [1, 2]}",
+                };
+                for ( size_t i = 0; i < sizeof( specs ) / sizeof( specs[ 0 ] ); i++ ) {
+                    intrusive_ptr<Expression> tree;
+                    intrusive_ptr<Expression> compiled =
+                            compile( BSON( "" << fromjson( specs[ i ] ) ), &tree );
+                    ASSERT_NOT_EQUALS( tree, compiled );
+                    for ( size_t j = 0; j < sizeof( inputs ) / sizeof( inputs[ 0 ] ); j++ ) {
+                        const Document input = fromBson( fromjson( inputs[ j ] ) );
+                        assertBinaryEqual( evaluate( tree, input ), evaluate( compiled, input ) );
+                    }
+                }
+            }
+        };
+
+        /** An error from an operand the tree never evaluates isn't raised. */
+        class UnevaluatedOperandError {
+        public:
+            void run() {
+                intrusive_ptr<Expression> compiled =
+                        compile( fromjson( "{'': {$add: ['$a', {$add: ['$s', 1]}]}}" ) );
+                assertBinaryEqual( BSON( "" << BSONNULL ),
+                                   evaluate( compiled, fromBson( BSON( "s" << "x" ) ) ) );
+                const Document input = fromBson( BSON( "a" << 1 << "s" << "x" ) );
+                assertBinaryEqual( BSON( "error" << 16554 ), evaluate( compiled, input ) );
+            }
+        };
+
+    } // namespace Compiled
+
     namespace Constant {
 
         /** Create an ExpressionConstant from a Value. */
@@ -3537,6 +3682,12 @@ namespace ExpressionTests {
             add<Compare::OptimizeGte>();
             add<Compare::OptimizeGteReverse>();
 
+            add<Compiled::Leaves>();
+            add<Compiled::SerializeAndDependencies>();
+            add<Compiled::TooManyRegisters>();
+            add<Compiled::SameAsTree>();
+            add<Compiled::UnevaluatedOperandError>();
+
             add<Constant::Create>();
             add<Constant::CreateFromBsonElement>();
             add<Constant::Optimize>();
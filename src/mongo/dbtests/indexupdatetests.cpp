@@ -459,6 +459,206 @@ namespace IndexUpdateTests {
         }
     };
 
+    /**
+     * Builds indexes in the foreground on a collection of several extents, on several threads.
+     */
+    class ParallelBuildBase : public IndexBuildBase {
+    public:
+        ParallelBuildBase() : _oldThreads(internalIndexBuildParallelThreads) {
+            internalIndexBuildParallelThreads = 4;
+        }
+        ~ParallelBuildBase() {
+            internalIndexBuildParallelThreads = _oldThreads;
+        }
+    protected:
+        static const int nDocs = 20000;
+
+        /** Recreates the collection, with nDocs documents big enough to fill many extents. */
+        Collection* createCollection(bool unique) {
+            Database* db = _ctx.ctx().db();
+            {
+                WriteUnitOfWork wunit(&_txn);
+                db->dropCollection( &_txn, _ns );
+                db->createCollection( &_txn, _ns );
+                wunit.commit();
+            }
+            Collection* coll = collection();
+
+            const string filler(1000, 'x');
+            for (int i = 0; i < nDocs; i++) {
+                BSONObjBuilder doc;
+                doc.append("_id", i);
+                if (unique) {
+                    // The last ten are duplicates of the first ten.
+                    doc.append("a", i < nDocs - 10 ? i : i - (nDocs - 10));
+                }
+                else if (i % 100 == 0) {
+                    doc.append("a", BSON_ARRAY(i << -i - 1));
+                }
+                else {
+                    doc.append("a", (i * 7919) % nDocs);
+                }
+                doc.append("filler", filler);
+
+                WriteUnitOfWork wunit(&_txn);
+                ASSERT_OK(coll->insertDocument(&_txn, doc.obj(), true).getStatus());
+                wunit.commit();
+            }
+
+            ASSERT_GREATER_THAN(coll->getManyIterators(&_txn).size(), 1U);
+            return coll;
+        }
+
+        /** Returns the number of keys in the index named 'name'. */
+        long long numKeys(Collection* coll, const string& name) {
+            IndexDescriptor* descriptor = coll->getIndexCatalog()->findIndexByName(&_txn, name);
+            ASSERT(descriptor);
+            int64_t numKeys = 0;
+            ASSERT_OK(coll->getIndexCatalog()->getIndex(descriptor)->validate(&_txn,
+                                                                               false,
+                                                                               &numKeys,
+                                                                               NULL));
+            return numKeys;
+        }
+
+    private:
+        const int _oldThreads;
+    };
+
+    /** All the keys of every document get into the index, which knows it's multikey. */
+    class ParallelBuild : public ParallelBuildBase {
+    public:
+        void run() {
+            Collection* coll = createCollection(false);
+
+            MultiIndexBlock indexer(&_txn, coll);
+            const BSONObj spec = BSON("name" << "a_1"
+                                   << "ns" << coll->ns().ns()
+                                   << "key" << BSON("a" << 1));
+            ASSERT_OK(indexer.init(spec));
+            ASSERT_OK(indexer.insertAllDocumentsInCollection());
+            {
+                WriteUnitOfWork wunit(&_txn);
+                indexer.commit();
+                wunit.commit();
+            }
+
+            ASSERT_EQUALS(nDocs + nDocs / 100, numKeys(coll, "a_1"));
+            ASSERT(coll->getIndexCatalog()->findIndexByName(&_txn, "a_1")->isMultikey(&_txn));
+
+            // The keys are in order, whichever thread read them.
+            const BSONObj fields = BSON("a" << 1 << "_id" << 0);
+            auto_ptr<DBClientCursor> cursor = _client.query(_ns,
+                                                            Query().hint(BSON("a" << 1)),
+                                                            0, 0, &fields);
+            int count = 0;
+            BSONObj previous;
+            while (cursor->more()) {
+                BSONObj doc = cursor->next().getOwned();
+                if (!previous.isEmpty() && previous["a"].isNumber() && doc["a"].isNumber())
+                    ASSERT_LESS_THAN_OR_EQUALS(previous["a"].numberInt(), doc["a"].numberInt());
+                previous = doc;
+                count++;
+            }
+            ASSERT_EQUALS(nDocs, count);
+        }
+    };
+
+    /** Duplicates found by the threads are all reported. */
+    class ParallelBuildFillDups : public ParallelBuildBase {
+    public:
+        void run() {
+            Collection* coll = createCollection(true);
+
+            MultiIndexBlock indexer(&_txn, coll);
+            const BSONObj spec = BSON("name" << "a_1"
+                                   << "ns" << coll->ns().ns()
+                                   << "key" << BSON("a" << 1)
+                                   << "unique" << true);
+            ASSERT_OK(indexer.init(spec));
+
+            std::set<DiskLoc> dups;
+            ASSERT_OK(indexer.insertAllDocumentsInCollection(&dups));
+            ASSERT_EQUALS(10U, dups.size());
+        }
+    };
+
+    /**
+     * A background build loaded in bulk gets the writes made during the collection scan and
+     * after it.
+     */
+    class BackgroundBulkBuildWithWrites : public IndexBuildBase {
+    public:
+        BackgroundBulkBuildWithWrites() : _oldBulk(internalIndexBuildBackgroundBulk) {
+            internalIndexBuildBackgroundBulk = true;
+        }
+        ~BackgroundBulkBuildWithWrites() {
+            internalIndexBuildBackgroundBulk = _oldBulk;
+        }
+        void run() {
+            for (int i = 0; i < 100; i++) {
+                _client.insert(_ns, BSON("_id" << i << "a" << i));
+            }
+
+            Collection* coll = collection();
+            MultiIndexBlock indexer(&_txn, coll);
+            indexer.allowBackgroundBuilding();
+            indexer.allowInterruption();
+            const BSONObj spec = BSON("name" << "a_1"
+                                   << "ns" << coll->ns().ns()
+                                   << "key" << BSON("a" << 1)
+                                   << "background" << true);
+            ASSERT_OK(indexer.init(spec));
+
+            // Before the scan, which sees these documents too.
+            _client.insert(_ns, BSON("_id" << 100 << "a" << 100));
+            _client.remove(_ns, BSON("_id" << 0));
+            _client.update(_ns,
+                           BSON("_id" << 1),
+                           BSON("$set" << BSON("a" << BSON_ARRAY(1001 << 1002))));
+
+            ASSERT_OK(indexer.insertAllDocumentsInCollection());
+
+            // After the scan and the bulk load: only commit() sees these.
+            _client.insert(_ns, BSON("_id" << 101 << "a" << 101));
+            _client.remove(_ns, BSON("_id" << 2));
+            _client.update(_ns, BSON("_id" << 3), BSON("$set" << BSON("a" << 3000)));
+
+            {
+                WriteUnitOfWork wunit(&_txn);
+                indexer.commit();
+                wunit.commit();
+            }
+
+            IndexDescriptor* descriptor =
+                coll->getIndexCatalog()->findIndexByName(&_txn, "a_1");
+            ASSERT(descriptor);
+            ASSERT(descriptor->isMultikey(&_txn));
+            int64_t numKeys = 0;
+            ASSERT_OK(coll->getIndexCatalog()->getIndex(descriptor)->validate(&_txn,
+                                                                               false,
+                                                                               &numKeys,
+                                                                               NULL));
+            ASSERT_EQUALS(101, numKeys);
+
+            const BSONObj hint = BSON("a" << 1);
+            ASSERT_EQUALS(0, itemCount(BSON("a" << 0), hint));
+            ASSERT_EQUALS(1, itemCount(BSON("a" << 1002), hint));
+            ASSERT_EQUALS(0, itemCount(BSON("a" << 3), hint));
+            ASSERT_EQUALS(1, itemCount(BSON("a" << 3000), hint));
+            ASSERT_EQUALS(1, itemCount(BSON("a" << 101), hint));
+            ASSERT_EQUALS(0, itemCount(BSON("a" << 2), hint));
+        }
+
+    private:
+        int itemCount(const BSONObj& query, const BSONObj& hint) {
+            auto_ptr<DBClientCursor> cursor = _client.query(_ns, Query(query).hint(hint));
+            return cursor->itcount();
+        }
+
+        const bool _oldBulk;
+    };
+
     /** Index creation is killed if mayInterrupt is true. */
     class InsertBuildIndexInterrupt : public IndexBuildBase {
     public:
@@ -880,6 +1080,9 @@ namespace IndexUpdateTests {
             add<InsertBuildEnforceUnique<false> >();
             add<InsertBuildFillDups<true> >();
             add<InsertBuildFillDups<false> >();
+            add<ParallelBuild>();
+            add<ParallelBuildFillDups>();
+            add<BackgroundBulkBuildWithWrites>();
             add<InsertBuildIndexInterrupt>();
             add<InsertBuildIndexInterruptDisallowed>();
             add<InsertBuildIdIndexInterrupt>();
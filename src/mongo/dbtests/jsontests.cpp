@@ -575,6 +575,21 @@ namespace JsonTests {
             }
         };
 
+        class ReuseBuilder {
+        public:
+            void run() {
+                BSONObj a = BSON( "a" << "x/y" << "b" << BSON_ARRAY( 1.5 << BSON( "c" << true ) ) );
+                BSONObj b = BSON( "d" << 12321312312LL );
+
+                StringBuilder s;
+                a.jsonString( s, TenGen );
+                b.jsonString( s, TenGen, 1 );
+                b.firstElement().jsonString( s, Strict );
+                ASSERT_EQUALS( a.jsonString( TenGen ) + b.jsonString( TenGen, 1 ) +
+                               b.firstElement().jsonString( Strict ), s.str() );
+            }
+        };
+
     } // namespace JsonStringTests
 
     namespace FromJsonTests {
@@ -2669,6 +2684,135 @@ namespace JsonTests {
 
     } // namespace FromJsonTests
 
+    namespace JsonDocumentStreamTests {
+
+        class Base {
+        public:
+            virtual ~Base() {}
+            void run() {
+                // Feed the input whole, and one character at a time.
+                for ( int piece = 0; piece < 2; piece++ ) {
+                    JsonDocumentStream stream;
+                    std::vector<BSONObj> docs;
+                    const string input = json();
+                    if ( piece == 0 ) {
+                        stream.append( input );
+                        readAll( &stream, &docs );
+                    }
+                    else {
+                        for ( size_t i = 0; i < input.size(); i++ ) {
+                            stream.append( StringData( input.data() + i, 1 ) );
+                            readAll( &stream, &docs );
+                        }
+                    }
+                    ASSERT( stream.empty() );
+
+                    const BSONArray expected = bson();
+                    ASSERT_EQUALS( static_cast<size_t>( expected.nFields() ), docs.size() );
+                    BSONObjIterator it( expected );
+                    for ( size_t i = 0; i < docs.size(); i++ ) {
+                        ASSERT_EQUALS( it.next().embeddedObject(), docs[i] );
+                    }
+                }
+            }
+        protected:
+            virtual BSONArray bson() const = 0;
+            virtual string json() const = 0;
+        private:
+            static void readAll( JsonDocumentStream* stream, std::vector<BSONObj>* docs ) {
+                BSONObj obj;
+                while ( stream->next( &obj ) ) {
+                    docs->push_back( obj );
+                }
+            }
+        };
+
+        class Empty : public Base {
+            virtual BSONArray bson() const {
+                return BSONArray();
+            }
+            virtual string json() const {
+                return " \n\t ";
+            }
+        };
+
+        class Documents : public Base {
+            virtual BSONArray bson() const {
+                return BSON_ARRAY( BSON( "a" << 1 ) <<
+                                   BSON( "b" << BSON_ARRAY( 2 << BSON( "c" << 3 ) ) ) <<
+                                   BSONObj() );
+            }
+            virtual string json() const {
+                return "{ \"a\" : 1 }\n{b: [2, {c: 3}]}{}\n";
+            }
+        };
+
+        class StructuralInStrings : public Base {
+            virtual BSONArray bson() const {
+                return BSON_ARRAY( BSON( "a" << "}" ) <<
+                                   BSON( "b" << "'{\"" << "c" << "]\\" ) <<
+                                   BSON( "d/" << 1 ) );
+            }
+            virtual string json() const {
+                return "{a: '}'} {\"b\": \"'{\\\"\", c: ']\\\\'}\n{\"d/\": 1}";
+            }
+        };
+
+        class StructuralInRegex : public Base {
+            virtual BSONArray bson() const {
+                BSONObjBuilder b;
+                b.appendRegex( "a", "}/{", "i" );
+                BSONArrayBuilder inArray( b.subarrayStart( "b" ) );
+                inArray.appendRegex( "[" );
+                inArray.done();
+                return BSON_ARRAY( b.obj() << BSON( "c" << 1 ) );
+            }
+            virtual string json() const {
+                return "{a: /}\\/{/i, b: [/[/]} {c: 1}";
+            }
+        };
+
+        class NotAnObject {
+        public:
+            void run() {
+                JsonDocumentStream stream;
+                stream.append( "  [ 1 ]" );
+                BSONObj obj;
+                ASSERT_THROWS( stream.next( &obj ), MsgAssertionException );
+            }
+        };
+
+        class BadDocument {
+        public:
+            void run() {
+                JsonDocumentStream stream;
+                stream.append( "{a: }{b: 1}" );
+                BSONObj obj;
+                ASSERT_THROWS( stream.next( &obj ), MsgAssertionException );
+
+                // The bad document is skipped.
+                ASSERT( stream.next( &obj ) );
+                ASSERT_EQUALS( BSON( "b" << 1 ), obj );
+                ASSERT( stream.empty() );
+            }
+        };
+
+        class Incomplete {
+        public:
+            void run() {
+                JsonDocumentStream stream;
+                stream.append( "{a: {b: '}" );
+                BSONObj obj;
+                ASSERT( !stream.next( &obj ) );
+                ASSERT( !stream.empty() );
+                stream.append( "'}}" );
+                ASSERT( stream.next( &obj ) );
+                ASSERT_EQUALS( BSON( "a" << BSON( "b" << "}" ) ), obj );
+            }
+        };
+
+    } // namespace JsonDocumentStreamTests
+
     class All : public Suite {
     public:
         All() : Suite( "json" ) {
@@ -2714,6 +2858,7 @@ namespace JsonTests {
             add< JsonStringTests::TimestampTests >();
             add< JsonStringTests::NullString >();
             add< JsonStringTests::AllTypes >();
+            add< JsonStringTests::ReuseBuilder >();
 
             add< FromJsonTests::Empty >();
             add< FromJsonTests::EmptyWithSpace >();
@@ -2930,6 +3075,14 @@ namespace JsonTests {
             add< FromJsonTests::NullFieldUnquoted >();
             add< FromJsonTests::MinKey >();
             add< FromJsonTests::MaxKey >();
+
+            add< JsonDocumentStreamTests::Empty >();
+            add< JsonDocumentStreamTests::Documents >();
+            add< JsonDocumentStreamTests::StructuralInStrings >();
+            add< JsonDocumentStreamTests::StructuralInRegex >();
+            add< JsonDocumentStreamTests::NotAnObject >();
+            add< JsonDocumentStreamTests::BadDocument >();
+            add< JsonDocumentStreamTests::Incomplete >();
         }
     };
 
@@ -43,8 +43,10 @@
 #include <iomanip>
 #include <fstream>
 
+#include "mongo/bson/bson_validate.h"
 #include "mongo/db/db.h"
 #include "mongo/db/dbdirectclient.h"
+#include "mongo/db/fts/fts_spec.h"
 #include "mongo/db/json.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/operation_context_impl.h"
@@ -426,6 +428,22 @@ namespace PerfTests {
         }
     };
 
+    class BSONValidate : public NonDurTest {
+    public:
+        int n;
+        bo b;
+        string name() { return "BSONValidate"; }
+        BSONValidate() {
+            n = 0;
+            bo sub = bob().appendTimeT("t", time(0)).appendBool("abool", true).appendBinData("somebin", 3, BinDataGeneral, "abc").appendNull("anullone").obj();
+            b = BSON( "_id" << OID() << "x" << 3 << "yaaaaaa" << 3.00009 << "zz" << 1 << "q" << false << "obj" << sub << "zzzzzzz" << "a string a string" << "a_rather_longer_field_name" << BSON_ARRAY(1 << 2 << 3) );
+        }
+        void timed() {
+            if( validateBSON(b.objdata(), b.objsize()).isOK() )
+                n++;
+        }
+    };
+
     class BSONGetFields1 : public NonDurTest {
     public:
         int n;
@@ -723,6 +741,31 @@ namespace PerfTests {
         }
     };
 
+    // cost of tokenizing, stop word filtering and stemming a document for a text index
+    class FTSScoreDocument : public B {
+    public:
+        FTSScoreDocument() :
+            _spec(fts::FTSSpec::fixSpec(BSON("key" << BSON("text" << "text")))),
+            _doc(BSON("text" << "The quick brown foxes were running and jumping over the "
+                                "lazy dogs while the farmers watched their crops growing in "
+                                "the fields, hoping that the coming storms would pass them by "
+                                "and leave the harvest standing for another week")),
+            n(0) {
+        }
+        string name() { return "FTSScoreDocument"; }
+        virtual int howLongMillis() { return 3000; }
+        virtual bool showDurStats() { return false; }
+        void timed() {
+            fts::TermFrequencyMap terms;
+            _spec.scoreDocument(_doc, &terms);
+            n += terms.size();
+        }
+    private:
+        fts::FTSSpec _spec;
+        BSONObj _doc;
+        unsigned long long n;
+    };
+
     // if a test is this fast, it was optimized out
     class Dummy : public B {
     public:
@@ -1007,6 +1050,63 @@ namespace PerfTests {
         }
     };
 
+    /**
+     * $group throughput on enum-like string keys, such as country codes and statuses.  Each
+     * timed() call aggregates the whole collection; compare rps between builds.
+     */
+    class GroupBase : public B {
+    public:
+        virtual unsigned batchSize() { return 1; }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            static const char* const countries[] = { "US", "CA", "MX", "GB", "FR", "DE", "IT",
+                                                     "ES", "NL", "SE", "JP", "CN", "IN", "BR" };
+            static const char* const statuses[] = { "active", "pending", "suspended", "closed" };
+            const int numCountries = sizeof(countries) / sizeof(countries[0]);
+            const int numStatuses = sizeof(statuses) / sizeof(statuses[0]);
+            for ( int i = 0; i < 20000; i++ ) {
+                client()->insert( ns(), BSON( "country" << countries[i % numCountries]
+                                              << "status" << statuses[i % numStatuses]
+                                              << "tags" << BSONArray()
+                                              << "amount" << i ) );
+            }
+            client()->getLastError();
+
+            BSONObjBuilder group;
+            group.appendElements( idSpec() );
+            group.append( "n", BSON( "$sum" << 1 ) );
+            group.append( "total", BSON( "$sum" << "$amount" ) );
+            group.append( "tags", BSON( "$first" << "$tags" ) );
+
+            const NamespaceString nss( ns() );
+            _db = nss.db().toString();
+            _cmd = BSON( "aggregate" << nss.coll()
+                         << "pipeline" << BSON_ARRAY( BSON( "$group" << group.obj() ) ) );
+        }
+        void timed() {
+            BSONObj info;
+            ASSERT( client()->runCommand( _db, _cmd, info ) );
+        }
+    protected:
+        /** The _id field of the $group spec. */
+        virtual BSONObj idSpec() = 0;
+    private:
+        string _db;
+        BSONObj _cmd;
+    };
+
+    class GroupShortStringKey : public GroupBase {
+    public:
+        string name() { return "group-short-string-key"; }
+        BSONObj idSpec() { return BSON( "_id" << "$country" ); }
+    };
+
+    class GroupCompoundKey : public GroupBase {
+    public:
+        string name() { return "group-compound-key"; }
+        BSONObj idSpec() { return BSON( "_id" << BSON( "c" << "$country" << "s" << "$status" ) ); }
+    };
+
     class InsertBig : public B {
         BSONObj x;
         virtual int howLongMillis() {
@@ -1363,7 +1463,9 @@ namespace PerfTests {
                 add< KeyTest >();
                 add< Bldr >();
                 add< StkBldr >();
+                add< FTSScoreDocument >();
                 add< BSONIter >();
+                add< BSONValidate >();
                 add< BSONGetFields1 >();
                 add< BSONGetFields2 >();
                 //add< TaskQueueTest >();
@@ -1374,6 +1476,8 @@ namespace PerfTests {
                 add< Update1 >();
                 add< MoreIndexes<Update1> >();
                 add< InsertBig >();
+                add< GroupShortStringKey >();
+                add< GroupCompoundKey >();
                 add< FailPointTest<false, false> >();
                 add< FailPointTest<true, false> >();
                 add< FailPointTest<true, true> >();
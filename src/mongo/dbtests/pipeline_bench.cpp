@@ -0,0 +1,322 @@
+// pipeline_bench.cpp : Benchmarks of representative aggregation pipelines.
+
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * Each benchmark fills a collection with generated documents, runs a pipeline over it from a
+ * DocumentSourceCursor, and logs a line of JSON starting with "PIPELINE_BENCH" with the
+ * documents per second read from the collection, the peak memory of its $group and $sort stages
+ * going by getApproximateSize(), and the bytes they spilled to disk:
+ *
+ *   PIPELINE_BENCH { "benchmark" : "groupLowCardinality", "docs" : 50000, "results" : 100,
+ *                    "micros" : 94211, "docsPerSecond" : 530723.6, "peakMemoryBytes" : 21600,
+ *                    "spilledBytes" : 0 }
+ *
+ * The spilling benchmarks lower the memory limits of $group and $sort so that they spill with
+ * a collection which fits a test run.  Numbers from debug builds, where $group spills on every
+ * repeated key unless disk use is allowed, are not comparable.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include <vector>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/json.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/query/get_executor.h"
+#include "mongo/db/storage_options.h"
+#include "mongo/dbtests/dbtests.h"
+#include "mongo/platform/random.h"
+#include "mongo/util/timer.h"
+
+namespace PipelineBench {
+
+    static const char* const ns = "unittests.pipeline_bench";
+
+    class Base {
+    public:
+        Base() : _client(&_opCtx) { }
+        virtual ~Base() { _client.dropCollection(ns); }
+
+        void run() {
+            const int numDocs = this->numDocs();
+            insertDocs(numDocs);
+
+            ParameterOverride<int> groupMemory(&internalDocumentSourceGroupMaxMemoryBytes,
+                                               maxMemoryBytes());
+            ParameterOverride<int> sortMemory(&internalDocumentSourceSortMaxMemoryBytes,
+                                              maxMemoryBytes());
+
+            intrusive_ptr<ExpressionContext> ctx =
+                    new ExpressionContext(&_opCtx, NamespaceString(ns));
+            ctx->tempDir = storageGlobalParams.dbpath + "/_tmp";
+            ctx->extSortAllowed = allowDiskUse();
+
+            // The sources outlive the input executor, which DocumentSourceCursor does not own.
+            boost::shared_ptr<PlanExecutor> exec = makeExecutor();
+            std::vector<intrusive_ptr<DocumentSource> > sources;
+            sources.push_back(DocumentSourceCursor::create(ns, exec, ctx));
+
+            const BSONObj pipeline = this->pipeline();
+            BSONForEach(stage, pipeline) {
+                intrusive_ptr<DocumentSource> source = makeSource(stage.Obj().firstElement(), ctx);
+                source->setSource(sources.back().get());
+                sources.push_back(source);
+            }
+
+            long long results = 0;
+            Timer timer;
+            while (sources.back()->getNext()) {
+                ++results;
+            }
+            const long long micros = timer.micros();
+
+            long long peakMemoryBytes = 0;
+            unsigned long long spilledBytes = 0;
+            for (size_t i = 0; i < sources.size(); i++) {
+                if (DocumentSourceGroup* group =
+                        dynamic_cast<DocumentSourceGroup*>(sources[i].get())) {
+                    peakMemoryBytes += group->getPeakMemoryUsageBytes();
+                    spilledBytes += group->getSpilledBytes();
+                }
+                else if (DocumentSourceSort* sort =
+                             dynamic_cast<DocumentSourceSort*>(sources[i].get())) {
+                    peakMemoryBytes += sort->getPeakMemoryUsageBytes();
+                    spilledBytes += sort->getSpilledBytes();
+                }
+            }
+
+            BSONObjBuilder result;
+            result.append("benchmark", name());
+            result.appendNumber("docs", numDocs);
+            result.appendNumber("results", results);
+            result.appendNumber("micros", micros);
+            result.append("docsPerSecond", numDocs * 1000.0 * 1000.0 / std::max(micros, 1LL));
+            result.appendNumber("peakMemoryBytes", peakMemoryBytes);
+            result.appendNumber("spilledBytes", static_cast<long long>(spilledBytes));
+            mongo::unittest::log() << "PIPELINE_BENCH " << result.obj().jsonString();
+
+            ASSERT_EQUALS(expectedResults(), results);
+            ASSERT_EQUALS(expectSpill(), spilledBytes > 0);
+        }
+
+    protected:
+        virtual std::string name() const = 0;
+
+        /** The stages after the collection scan, as an array like an aggregate command's. */
+        virtual BSONObj pipeline() const = 0;
+
+        virtual long long expectedResults() const = 0;
+
+        virtual int numDocs() const { return 50 * 1000; }
+
+        /**
+         * The 'i'th document: { _id: i, a: <distinct>, b: i % 100, x: i % 1000, y: <random>,
+         * s: <string> }, or with arrayLength() elements in 'arr' if it is not 0.
+         */
+        virtual size_t arrayLength() const { return 0; }
+
+        virtual bool allowDiskUse() const { return false; }
+        virtual bool expectSpill() const { return false; }
+
+        /** The memory limit $group and $sort run with. */
+        virtual int maxMemoryBytes() const { return 100 * 1024 * 1024; }
+
+    private:
+        /** Sets a server parameter for the life of the object. */
+        template<typename T>
+        class ParameterOverride {
+        public:
+            ParameterOverride(T* parameter, T value) : _parameter(parameter), _old(*parameter) {
+                *_parameter = value;
+            }
+            ~ParameterOverride() { *_parameter = _old; }
+        private:
+            T* _parameter;
+            const T _old;
+        };
+
+        void insertDocs(int numDocs) {
+            PseudoRandom random(12345);
+            std::vector<BSONObj> batch;
+            for (int i = 0; i < numDocs; i++) {
+                BSONObjBuilder doc;
+                doc.append("_id", i);
+                doc.append("a", static_cast<int>((i * 7919LL) % numDocs));
+                doc.append("b", i % 100);
+                doc.append("x", i % 1000);
+                doc.append("y", random.nextInt32(1000 * 1000) / 1000.0);
+                doc.append("s", "abcdefghijklmnopqrstuvwxyz");
+                if (arrayLength()) {
+                    BSONArrayBuilder arr(doc.subarrayStart("arr"));
+                    for (size_t j = 0; j < arrayLength(); j++) {
+                        arr.append(static_cast<int>(j));
+                    }
+                    arr.doneFast();
+                }
+                batch.push_back(doc.obj());
+
+                if (batch.size() == 1000) {
+                    _client.insert(ns, batch);
+                    batch.clear();
+                }
+            }
+            if (!batch.empty()) {
+                _client.insert(ns, batch);
+            }
+        }
+
+        boost::shared_ptr<PlanExecutor> makeExecutor() {
+            Client::WriteContext ctx(&_opCtx, ns);
+            CanonicalQuery* cq;
+            uassertStatusOK(CanonicalQuery::canonicalize(ns, /*query=*/BSONObj(), &cq));
+            PlanExecutor* execBare;
+            uassertStatusOK(getExecutor(&_opCtx,
+                                        ctx.getCollection(),
+                                        cq,
+                                        PlanExecutor::YIELD_MANUAL,
+                                        &execBare));
+
+            boost::shared_ptr<PlanExecutor> exec(execBare);
+            exec->saveState();
+            exec->registerExec();
+            return exec;
+        }
+
+        static intrusive_ptr<DocumentSource> makeSource(
+                BSONElement stage,
+                const intrusive_ptr<ExpressionContext>& ctx) {
+            const StringData stageName = stage.fieldNameStringData();
+            if (stageName == DocumentSourceMatch::matchName) {
+                return DocumentSourceMatch::createFromBson(stage, ctx);
+            }
+            if (stageName == DocumentSourceGroup::groupName) {
+                return DocumentSourceGroup::createFromBson(stage, ctx);
+            }
+            if (stageName == DocumentSourceSort::sortName) {
+                return DocumentSourceSort::createFromBson(stage, ctx);
+            }
+            if (stageName == DocumentSourceUnwind::unwindName) {
+                return DocumentSourceUnwind::createFromBson(stage, ctx);
+            }
+            if (stageName == DocumentSourceProject::projectName) {
+                return DocumentSourceProject::createFromBson(stage, ctx);
+            }
+            FAIL(str::stream() << "no benchmark support for " << stageName);
+            return NULL;
+        }
+
+        OperationContextImpl _opCtx;
+        DBDirectClient _client;
+    };
+
+    /** $match then $group on a key which is distinct for every document. */
+    class GroupHighCardinality : public Base {
+        std::string name() const { return "groupHighCardinality"; }
+        BSONObj pipeline() const {
+            return fromjson("[{$match: {b: {$lt: 50}}},"
+                            " {$group: {_id: '$a', total: {$sum: '$x'}, avg: {$avg: '$y'}}}]");
+        }
+        long long expectedResults() const { return numDocs() / 2; }
+    };
+
+    /** $match then $group on a key with 100 values. */
+    class GroupLowCardinality : public Base {
+        std::string name() const { return "groupLowCardinality"; }
+        BSONObj pipeline() const {
+            return fromjson("[{$match: {x: {$gte: 0}}},"
+                            " {$group: {_id: '$b', total: {$sum: '$x'}, max: {$max: '$y'}}}]");
+        }
+        long long expectedResults() const { return 100; }
+    };
+
+    /** GroupHighCardinality with too little memory for its groups. */
+    class GroupSpill : public GroupHighCardinality {
+        std::string name() const { return "groupHighCardinality.spill"; }
+        bool allowDiskUse() const { return true; }
+        bool expectSpill() const { return true; }
+        int maxMemoryBytes() const { return 1024 * 1024; }
+    };
+
+    /** $unwind of a 100 element array in each document. */
+    class UnwindBigArrays : public Base {
+        std::string name() const { return "unwindBigArrays"; }
+        BSONObj pipeline() const {
+            return fromjson("[{$unwind: '$arr'}, {$match: {arr: {$lt: 10}}}]");
+        }
+        long long expectedResults() const { return numDocs() * 10LL; }
+        int numDocs() const { return 10 * 1000; }
+        size_t arrayLength() const { return 100; }
+    };
+
+    /** $sort of every document with too little memory to hold them. */
+    class SortSpill : public Base {
+        std::string name() const { return "sort.spill"; }
+        BSONObj pipeline() const { return fromjson("[{$sort: {y: 1, _id: 1}}]"); }
+        long long expectedResults() const { return numDocs(); }
+        bool allowDiskUse() const { return true; }
+        bool expectSpill() const { return true; }
+        int maxMemoryBytes() const { return 1024 * 1024; }
+    };
+
+    /** $project with arithmetic expressions. */
+    class ProjectArithmetic : public Base {
+        std::string name() const { return "projectArithmetic"; }
+        BSONObj pipeline() const {
+            return fromjson("[{$project: {_id: 0,"
+                            " total: {$add: ['$x', {$multiply: ['$y', 2]}]},"
+                            " ratio: {$divide: ['$x', {$add: ['$y', 1]}]},"
+                            " bucket: {$mod: ['$a', 16]}}}]");
+        }
+        long long expectedResults() const { return numDocs(); }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite("pipeline_bench") {
+        }
+        void setupTests() {
+            add<GroupHighCardinality>();
+            add<GroupLowCardinality>();
+            add<GroupSpill>();
+            add<UnwindBigArrays>();
+            add<SortSpill>();
+            add<ProjectArithmetic>();
+        }
+    };
+
+    SuiteInstance<All> myall;
+
+} // namespace PipelineBench
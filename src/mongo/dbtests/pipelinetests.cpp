@@ -234,6 +234,85 @@ namespace PipelineTests {
     namespace Optimizations {
         using namespace mongo;
 
+        namespace Local {
+            /** Checks whether the $group in a pipeline is set to stream, as its explain shows. */
+            class StreamGroupBase {
+            public:
+                virtual ~StreamGroupBase() {}
+                void run() {
+                    intrusive_ptr<ExpressionContext> ctx =
+                        new ExpressionContext(&_opCtx, NamespaceString("a.collection"));
+                    string errmsg;
+                    intrusive_ptr<Pipeline> pipeline = Pipeline::parseCommand(
+                            errmsg, fromjson("{pipeline: " + inputPipeJson() + "}"), ctx);
+                    ASSERT_EQUALS(errmsg, "");
+                    ASSERT(pipeline != NULL);
+                    ASSERT_EQUALS(streaming(), groupStreams(pipeline));
+
+                    // Never on a merger; see streamGroupOnSortedInput.
+                    pipeline->splitForSharded();
+                    ASSERT(!groupStreams(pipeline));
+                }
+            protected:
+                virtual string inputPipeJson() = 0;
+                virtual bool streaming() = 0;
+            private:
+                static bool groupStreams(const intrusive_ptr<Pipeline>& pipeline) {
+                    const vector<Value> ops = pipeline->writeExplainOps();
+                    for (size_t i = 0; i < ops.size(); i++) {
+                        const Document op = ops[i].getDocument();
+                        if (!op["$group"].missing())
+                            return op["$group"]["$streaming"].coerceToBool();
+                    }
+                    return false;
+                }
+                OperationContextImpl _opCtx;
+            };
+
+            class StreamGroupOnSortedId : public StreamGroupBase {
+                string inputPipeJson() {
+                    return "[{$sort: {a: -1}}, {$limit: 10}, {$group: {_id: '$a', n: {$sum: 1}}}]";
+                }
+                bool streaming() { return true; }
+            };
+
+            class StreamGroupOnSortedCompoundId : public StreamGroupBase {
+                string inputPipeJson() {
+                    return "[{$sort: {b: 1, 'a.c': -1, d: 1}},"
+                           " {$group: {_id: {x: '$a.c', y: '$b', z: 'const'}}}]";
+                }
+                bool streaming() { return true; }
+            };
+
+            class StreamGroupNeedsIdFieldsFirst : public StreamGroupBase {
+                string inputPipeJson() {
+                    return "[{$sort: {b: 1, a: 1}}, {$group: {_id: {x: '$a', y: '$c'}}}]";
+                }
+                bool streaming() { return false; }
+            };
+
+            class StreamGroupNeedsWholeIdSorted : public StreamGroupBase {
+                string inputPipeJson() {
+                    return "[{$sort: {a: 1}}, {$group: {_id: {x: '$a', y: '$b'}}}]";
+                }
+                bool streaming() { return false; }
+            };
+
+            class StreamGroupNeedsFieldPathId : public StreamGroupBase {
+                string inputPipeJson() {
+                    return "[{$sort: {a: 1}}, {$group: {_id: {$add: ['$a', 1]}}}]";
+                }
+                bool streaming() { return false; }
+            };
+
+            class StreamGroupNeedsAdjacentSort : public StreamGroupBase {
+                string inputPipeJson() {
+                    return "[{$sort: {a: 1}}, {$project: {a: 1}}, {$group: {_id: '$a'}}]";
+                }
+                bool streaming() { return false; }
+            };
+        } // namespace Local
+
         namespace Sharded {
             class Base {
             public:
@@ -421,6 +500,12 @@ namespace PipelineTests {
             add<FieldPath::Tail>();
             add<FieldPath::TailThreeFields>();
 
+            add<Optimizations::Local::StreamGroupOnSortedId>();
+            add<Optimizations::Local::StreamGroupOnSortedCompoundId>();
+            add<Optimizations::Local::StreamGroupNeedsIdFieldsFirst>();
+            add<Optimizations::Local::StreamGroupNeedsWholeIdSorted>();
+            add<Optimizations::Local::StreamGroupNeedsFieldPathId>();
+            add<Optimizations::Local::StreamGroupNeedsAdjacentSort>();
             add<Optimizations::Sharded::Empty>();
             add<Optimizations::Sharded::moveFinalUnwindFromShardsToMerger::OneUnwind>();
             add<Optimizations::Sharded::moveFinalUnwindFromShardsToMerger::TwoUnwind>();
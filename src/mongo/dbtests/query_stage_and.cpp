@@ -44,6 +44,8 @@
 #include "mongo/db/json.h"
 #include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/storage_options.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/util/mongoutils/str.h"
@@ -389,6 +391,77 @@ namespace QueryStageAnd {
         }
     };
 
+    // An AND with two index scan children: the second scan skips keys whose DiskLocs the first
+    // didn't output, unless that's turned off.
+    class QueryStageAndHashBloomFilter : public QueryStageAndBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+            Database* db = ctx.db();
+            Collection* coll = ctx.getCollection();
+            if (!coll) {
+                WriteUnitOfWork wuow(&_txn);
+                coll = db->createCollection(&_txn, ns());
+                wuow.commit();
+            }
+
+            for (int i = 0; i < 50; ++i) {
+                insert(BSON("foo" << i << "bar" << i));
+            }
+
+            addIndex(BSON("foo" << 1));
+            addIndex(BSON("bar" << 1));
+
+            // 29 of the 40 keys the second scan examines are for DiskLocs the first didn't
+            // output.  A few may be false positives.
+            size_t locsFiltered = runAnd(coll, true);
+            ASSERT_GREATER_THAN(locsFiltered, 20U);
+            ASSERT_LESS_THAN_OR_EQUALS(locsFiltered, 29U);
+
+            ASSERT_EQUALS(0U, runAnd(coll, false));
+        }
+
+    private:
+        /**
+         * Intersects foo <= 20 with bar >= 10, and returns how many keys the second index scan
+         * skipped.
+         */
+        size_t runAnd(Collection* coll, bool useBloomFilter) {
+            bool oldUseBloomFilter = internalQueryExecAndHashBloomFilter;
+            internalQueryExecAndHashBloomFilter = useBloomFilter;
+
+            WorkingSet ws;
+            scoped_ptr<AndHashStage> ah(new AndHashStage(&_txn, &ws, NULL, coll));
+
+            // Foo <= 20
+            IndexScanParams params;
+            params.descriptor = getIndex(BSON("foo" << 1), coll);
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = BSON("" << 20);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = -1;
+            ah->addChild(new IndexScan(&_txn, params, &ws, NULL));
+
+            // Bar >= 10
+            params.descriptor = getIndex(BSON("bar" << 1), coll);
+            params.bounds.startKey = BSON("" << 10);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = 1;
+            IndexScan* barScan = new IndexScan(&_txn, params, &ws, NULL);
+            ah->addChild(barScan);
+
+            ASSERT_EQUALS(11, countResults(ah.get()));
+
+            internalQueryExecAndHashBloomFilter = oldUseBloomFilter;
+
+            const IndexScanStats* stats =
+                static_cast<const IndexScanStats*>(barScan->getSpecificStats());
+            return stats->locsFiltered;
+        }
+    };
+
     // An AND with two children.
     // Add large keys (512 bytes) to index of first child to cause
     // internal buffer within hashed AND to exceed threshold (32MB)
@@ -443,6 +516,60 @@ namespace QueryStageAnd {
         }
     };
 
+    // As above, but the AND may go to disk once it is over its memory limit.
+    class QueryStageAndHashTwoLeafFirstChildLargeKeysSpills : public QueryStageAndBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+            Database* db = ctx.db();
+            Collection* coll = ctx.getCollection();
+            if (!coll) {
+                WriteUnitOfWork wuow(&_txn);
+                coll = db->createCollection(&_txn, ns());
+                wuow.commit();
+            }
+
+            std::string big(512, 'a');
+            for (int i = 0; i < 50; ++i) {
+                insert(BSON("foo" << i << "bar" << i << "big" << big));
+            }
+
+            addIndex(BSON("foo" << 1 << "big" << 1));
+            addIndex(BSON("bar" << 1));
+
+            WorkingSet ws;
+            scoped_ptr<AndHashStage> ah(new AndHashStage(&_txn, &ws, NULL, coll, 20 * big.size()));
+            ah->allowDiskUse(storageGlobalParams.dbpath + "/_tmp");
+
+            // Foo <= 20
+            IndexScanParams params;
+            params.descriptor = getIndex(BSON("foo" << 1 << "big" << 1), coll);
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = BSON("" << 20 << "" << big);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = -1;
+            ah->addChild(new IndexScan(&_txn, params, &ws, NULL));
+
+            // Bar >= 10
+            params.descriptor = getIndex(BSON("bar" << 1), coll);
+            params.bounds.startKey = BSON("" << 10);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = 1;
+            ah->addChild(new IndexScan(&_txn, params, &ws, NULL));
+
+            // foo == bar, and foo<=20, bar>=10, so our values are:
+            // foo == 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20.
+            ASSERT_EQUALS(11, countResults(ah.get()));
+
+            scoped_ptr<PlanStageStats> stats(ah->getStats());
+            const AndHashStats* andHashStats =
+                static_cast<const AndHashStats*>(stats->specific.get());
+            ASSERT_GREATER_THAN(andHashStats->spillFiles, 0U);
+        }
+    };
+
     // An AND with three children.
     // Add large keys (512 bytes) to index of last child to verify that
     // keys in last child are not buffered
@@ -1392,7 +1519,9 @@ namespace QueryStageAnd {
         void setupTests() {
             add<QueryStageAndHashInvalidation>();
             add<QueryStageAndHashTwoLeaf>();
+            add<QueryStageAndHashBloomFilter>();
             add<QueryStageAndHashTwoLeafFirstChildLargeKeys>();
+            add<QueryStageAndHashTwoLeafFirstChildLargeKeysSpills>();
             add<QueryStageAndHashTwoLeafLastChildLargeKeys>();
             add<QueryStageAndHashThreeLeaf>();
             add<QueryStageAndHashThreeLeafMiddleChildLargeKeys>();
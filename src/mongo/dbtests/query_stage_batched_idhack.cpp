@@ -0,0 +1,217 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file tests db/exec/batched_idhack.cpp.
+ */
+
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/exec/batched_idhack.h"
+#include "mongo/db/index/btree_based_access_method.h"
+#include "mongo/db/json.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace QueryStageBatchedIdHack {
+
+    class QueryStageBatchedIdHackBase {
+    public:
+        QueryStageBatchedIdHackBase()
+            : _client(&_txn),
+              _oldBatchSize(internalQueryExecBatchedIdHackBatchSize) {
+            internalQueryExecBatchedIdHackBatchSize = 2;
+        }
+
+        virtual ~QueryStageBatchedIdHackBase() {
+            internalQueryExecBatchedIdHackBatchSize = _oldBatchSize;
+            Client::WriteContext ctx(&_txn, ns());
+            _client.dropCollection(ns());
+        }
+
+        void insert(const BSONObj& doc) {
+            _client.insert(ns(), doc);
+        }
+
+        CanonicalQuery* canonicalize(const BSONObj& query,
+                                     const BSONObj& sort = BSONObj(),
+                                     const BSONObj& proj = BSONObj()) {
+            CanonicalQuery* cq;
+            ASSERT_OK(CanonicalQuery::canonicalize(ns(), query, sort, proj, &cq));
+            return cq;
+        }
+
+        bool supports(const char* query, const char* sort = "{}", const char* proj = "{}") {
+            boost::scoped_ptr<CanonicalQuery> cq(
+                canonicalize(fromjson(query), fromjson(sort), fromjson(proj)));
+            return BatchedIdHackStage::supportsQuery(*cq);
+        }
+
+        DiskLoc locOf(Collection* coll, int id) {
+            IndexCatalog* catalog = coll->getIndexCatalog();
+            const BtreeBasedAccessMethod* accessMethod = static_cast<const BtreeBasedAccessMethod*>(
+                catalog->getIndex(catalog->findIdIndex(&_txn)));
+            return accessMethod->findSingle(&_txn, BSON("" << id));
+        }
+
+        static const char* ns() { return "unittests.QueryStageBatchedIdHack"; }
+
+    protected:
+        OperationContextImpl _txn;
+        DBDirectClient _client;
+
+    private:
+        int _oldBatchSize;
+    };
+
+    //
+    // Only queries on a list of literal _id values, which need the document, are supported.
+    //
+    class QueryStageBatchedIdHackSupportsQuery : public QueryStageBatchedIdHackBase {
+    public:
+        void run() {
+            ASSERT_TRUE(supports("{_id: {$in: [1, 'a', {b: 1}]}}"));
+            ASSERT_TRUE(supports("{_id: {$in: [1, 2]}}", "{_id: 1}"));
+            ASSERT_TRUE(supports("{_id: {$in: [1, 2]}}", "{}", "{a: 1}"));
+
+            ASSERT_FALSE(supports("{_id: {$in: [1, /a/]}}"));
+            ASSERT_FALSE(supports("{_id: {$in: [1, [2]]}}"));
+            ASSERT_FALSE(supports("{_id: {$in: [1, 2]}, a: 1}"));
+            ASSERT_FALSE(supports("{a: {$in: [1, 2]}}"));
+            ASSERT_FALSE(supports("{_id: {$in: [1, 2]}}", "{_id: -1}"));
+            ASSERT_FALSE(supports("{_id: {$in: [1, 2]}}", "{a: 1}"));
+
+            // The _id index covers this projection.
+            ASSERT_FALSE(supports("{_id: {$in: [1, 2]}}", "{}", "{_id: 1}"));
+
+            internalQueryExecBatchedIdHackBatchSize = 0;
+            ASSERT_FALSE(supports("{_id: {$in: [1, 2]}}"));
+        }
+    };
+
+    //
+    // Documents are returned in _id order whatever order they are stored in, once each.
+    //
+    class QueryStageBatchedIdHackOrder : public QueryStageBatchedIdHackBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+            for (int i = 9; i >= 0; --i) {
+                insert(BSON("_id" << i << "foo" << i));
+            }
+
+            boost::scoped_ptr<CanonicalQuery> cq(
+                canonicalize(fromjson("{_id: {$in: [7, 3, 100, 5, 3.0, 1]}}")));
+            WorkingSet ws;
+            BatchedIdHackStage stage(&_txn, ctx.getCollection(), cq.get(), &ws);
+
+            vector<int> results;
+            PlanStage::StageState state = PlanStage::NEED_TIME;
+            while (PlanStage::IS_EOF != state) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                state = stage.work(&id);
+                ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+                if (PlanStage::ADVANCED == state) {
+                    results.push_back(ws.get(id)->obj["foo"].numberInt());
+                    ws.free(id);
+                }
+            }
+
+            ASSERT_EQUALS(size_t(4), results.size());
+            ASSERT_EQUALS(1, results[0]);
+            ASSERT_EQUALS(3, results[1]);
+            ASSERT_EQUALS(5, results[2]);
+            ASSERT_EQUALS(7, results[3]);
+
+            // The keys are looked up as [1, 3], [5, 7] and [100], which finds nothing.
+            const BatchedIdHackStats* stats =
+                static_cast<const BatchedIdHackStats*>(stage.getSpecificStats());
+            ASSERT_EQUALS(size_t(4), stats->keysExamined);
+            ASSERT_EQUALS(size_t(4), stats->docsExamined);
+            ASSERT_EQUALS(size_t(2), stats->batchesPrefetched);
+        }
+    };
+
+    //
+    // A document invalidated while its DiskLoc is buffered is still returned.
+    //
+    class QueryStageBatchedIdHackInvalidate : public QueryStageBatchedIdHackBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+            for (int i = 0; i < 4; ++i) {
+                insert(BSON("_id" << i << "foo" << i));
+            }
+
+            boost::scoped_ptr<CanonicalQuery> cq(
+                canonicalize(fromjson("{_id: {$in: [0, 1, 2, 3]}}")));
+            WorkingSet ws;
+            BatchedIdHackStage stage(&_txn, ctx.getCollection(), cq.get(), &ws);
+
+            // Look up the first batch, and invalidate its second document.
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            ASSERT_EQUALS(PlanStage::NEED_TIME, stage.work(&id));
+            stage.saveState();
+            stage.invalidate(locOf(ctx.getCollection(), 1), INVALIDATION_MUTATION);
+            stage.restoreState(&_txn);
+
+            ASSERT_EQUALS(PlanStage::ADVANCED, stage.work(&id));
+            ASSERT_EQUALS(0, ws.get(id)->obj["foo"].numberInt());
+            ASSERT_EQUALS(PlanStage::ADVANCED, stage.work(&id));
+            ASSERT_EQUALS(WorkingSetMember::OWNED_OBJ, ws.get(id)->state);
+            ASSERT_EQUALS(1, ws.get(id)->obj["foo"].numberInt());
+
+            // The next batch is looked up after the yield.
+            ASSERT_EQUALS(PlanStage::NEED_TIME, stage.work(&id));
+            ASSERT_EQUALS(PlanStage::ADVANCED, stage.work(&id));
+            ASSERT_EQUALS(2, ws.get(id)->obj["foo"].numberInt());
+            ASSERT_EQUALS(PlanStage::ADVANCED, stage.work(&id));
+            ASSERT_EQUALS(3, ws.get(id)->obj["foo"].numberInt());
+            ASSERT_EQUALS(PlanStage::IS_EOF, stage.work(&id));
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite("query_stage_batched_idhack") {}
+
+        void setupTests() {
+            add<QueryStageBatchedIdHackSupportsQuery>();
+            add<QueryStageBatchedIdHackOrder>();
+            add<QueryStageBatchedIdHackInvalidate>();
+        }
+    };
+
+    SuiteInstance<All> all;
+
+} // namespace QueryStageBatchedIdHack
@@ -372,6 +372,137 @@ namespace QueryStageCollectionScan {
         }
     };
 
+    //
+    // Working the scan in batches gives the same results, in the same order, for the same
+    // amount of work as working it one result at a time.
+    //
+
+    class QueryStageCollscanWorkBatch : public QueryStageCollectionScanBase {
+    public:
+        void run() {
+            AutoGetCollectionForRead ctx(&_txn, ns());
+
+            CollectionScanParams params;
+            params.collection = ctx.getCollection();
+            params.direction = CollectionScanParams::FORWARD;
+            params.tailable = false;
+
+            BSONObj filterObj = BSON("foo" << BSON("$mod" << BSON_ARRAY(3 << 0)));
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filterObj);
+            verify(swme.isOK());
+            auto_ptr<MatchExpression> filterExpr(swme.getValue());
+
+            // One at a time.
+            WorkingSet ws;
+            scoped_ptr<CollectionScan> scan(new CollectionScan(&_txn, params, &ws,
+                                                               filterExpr.get()));
+            vector<int> expected;
+            for (;;) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                PlanStage::StageState state = scan->work(&id);
+                if (PlanStage::IS_EOF == state) { break; }
+                if (PlanStage::ADVANCED == state) {
+                    expected.push_back(ws.get(id)->obj["foo"].numberInt());
+                    ws.free(id);
+                }
+            }
+            ASSERT_EQUALS(17U, expected.size());
+
+            // In batches.
+            WorkingSet batchWs;
+            scoped_ptr<CollectionScan> batchScan(new CollectionScan(&_txn, params, &batchWs,
+                                                                    filterExpr.get()));
+            vector<int> got;
+            for (;;) {
+                vector<WorkingSetID> results;
+                size_t worksDone = 0;
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                PlanStage::StageState state = batchScan->workBatch(7, &results, &worksDone, &id);
+                ASSERT_LESS_THAN_OR_EQUALS(worksDone, 7U);
+                for (size_t i = 0; i < results.size(); ++i) {
+                    got.push_back(batchWs.get(results[i])->obj["foo"].numberInt());
+                    batchWs.free(results[i]);
+                }
+                if (PlanStage::IS_EOF == state) { break; }
+                ASSERT_EQUALS(7U, worksDone);
+                ASSERT_EQUALS(results.empty(), PlanStage::NEED_TIME == state);
+            }
+
+            ASSERT(expected == got);
+
+            const CommonStats* stats = scan->getCommonStats();
+            const CommonStats* batchStats = batchScan->getCommonStats();
+            ASSERT_EQUALS(stats->works, batchStats->works);
+            ASSERT_EQUALS(stats->advanced, batchStats->advanced);
+            ASSERT_EQUALS(stats->needTime, batchStats->needTime);
+        }
+    };
+
+    //
+    // A PlanExecutor keeps results it has worked ahead for across a yield, including one whose
+    // document is deleted during the yield.
+    //
+
+    class QueryStageCollscanInvalidateBufferedResult : public QueryStageCollectionScanBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+
+            Collection* coll = ctx.getCollection();
+
+            vector<DiskLoc> locs;
+            getLocs(coll, CollectionScanParams::FORWARD, &locs);
+            vector<int> expected;
+            for (size_t i = 0; i < locs.size(); ++i) {
+                expected.push_back(coll->docFor(&_txn, locs[i])["foo"].numberInt());
+            }
+
+            CollectionScanParams params;
+            params.collection = coll;
+            params.direction = CollectionScanParams::FORWARD;
+            params.tailable = false;
+
+            WorkingSet* ws = new WorkingSet();
+            PlanStage* ps = new CollectionScan(&_txn, params, ws, NULL);
+
+            PlanExecutor* rawExec;
+            Status status = PlanExecutor::make(&_txn, ws, ps, coll,
+                                               PlanExecutor::YIELD_MANUAL, &rawExec);
+            ASSERT_OK(status);
+            boost::scoped_ptr<PlanExecutor> exec(rawExec);
+
+            size_t count = 0;
+            BSONObj obj;
+            while (count < 10) {
+                ASSERT_EQUALS(PlanExecutor::ADVANCED, exec->getNext(&obj, NULL));
+                ASSERT_EQUALS(expected[count], obj["foo"].numberInt());
+                ++count;
+            }
+
+            // Delete the next document, which the executor has most likely already read.
+            exec->saveState();
+            exec->invalidate(locs[count], INVALIDATION_DELETION);
+            remove(coll->docFor(&_txn, locs[count]));
+            ASSERT(exec->restoreState(&_txn));
+
+            // The deleted document may or may not be returned, and everything else must be.
+            ASSERT_EQUALS(PlanExecutor::ADVANCED, exec->getNext(&obj, NULL));
+            if (expected[count] == obj["foo"].numberInt()) {
+                ASSERT_EQUALS(PlanExecutor::ADVANCED, exec->getNext(&obj, NULL));
+            }
+            ++count;
+
+            for (;;) {
+                ASSERT_EQUALS(expected[count], obj["foo"].numberInt());
+                ++count;
+                if (PlanExecutor::ADVANCED != exec->getNext(&obj, NULL)) { break; }
+            }
+
+            ASSERT_EQUALS(locs.size(), count);
+            ASSERT(exec->isEOF());
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "QueryStageCollectionScan" ) {}
@@ -386,6 +517,8 @@ namespace QueryStageCollectionScan {
             add<QueryStageCollscanObjectsInOrderBackward>();
             add<QueryStageCollscanInvalidateUpcomingObject>();
             add<QueryStageCollscanInvalidateUpcomingObjectBackward>();
+            add<QueryStageCollscanWorkBatch>();
+            add<QueryStageCollscanInvalidateBufferedResult>();
         }
     };
 
@@ -41,6 +41,7 @@
 #include "mongo/db/json.h"
 #include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/dbtests/dbtests.h"
 
@@ -204,6 +205,77 @@ namespace QueryStageFetch {
         }
     };
 
+    //
+    // Test that a batched fetch returns results in its child's order, including a buffered
+    // result which is invalidated.
+    //
+    class FetchStageBatched : public QueryStageFetchBase {
+    public:
+        void run() {
+            Lock::DBLock lk(_txn.lockState(), nsToDatabaseSubstring(ns()), MODE_X);
+            Client::Context ctx(&_txn, ns());
+            Database* db = ctx.db();
+            Collection* coll = db->getCollection(&_txn, ns());
+            if (!coll) {
+                WriteUnitOfWork wuow(&_txn);
+                coll = db->createCollection(&_txn, ns());
+                wuow.commit();
+            }
+
+            WorkingSet ws;
+
+            for (int i = 0; i < 10; ++i) {
+                insert(BSON("foo" << i));
+            }
+            set<DiskLoc> locs;
+            getLocs(&locs, coll);
+            ASSERT_EQUALS(size_t(10), locs.size());
+
+            // The child returns the DiskLocs backwards.
+            auto_ptr<MockStage> mockStage(new MockStage(&ws));
+            for (set<DiskLoc>::reverse_iterator it = locs.rbegin(); it != locs.rend(); ++it) {
+                WorkingSetMember mockMember;
+                mockMember.state = WorkingSetMember::LOC_AND_IDX;
+                mockMember.loc = *it;
+                mockStage->pushBack(mockMember);
+            }
+
+            int oldBatchSize = internalQueryExecFetchBatchSize;
+            internalQueryExecFetchBatchSize = 4;
+            auto_ptr<FetchStage> fetchStage(new FetchStage(&_txn, &ws, mockStage.release(),
+                                                           NULL, coll));
+            internalQueryExecFetchBatchSize = oldBatchSize;
+
+            // Buffer two results, and invalidate the first.
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            ASSERT_EQUALS(PlanStage::NEED_TIME, fetchStage->work(&id));
+            ASSERT_EQUALS(PlanStage::NEED_TIME, fetchStage->work(&id));
+            fetchStage->invalidate(*locs.rbegin(), INVALIDATION_MUTATION);
+
+            vector<BSONObj> results;
+            PlanStage::StageState state = PlanStage::NEED_TIME;
+            while (PlanStage::IS_EOF != state) {
+                state = fetchStage->work(&id);
+                ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+                if (PlanStage::ADVANCED == state) {
+                    results.push_back(ws.get(id)->obj.getOwned());
+                    ws.free(id);
+                }
+            }
+
+            ASSERT_EQUALS(size_t(10), results.size());
+            for (int i = 0; i < 10; ++i) {
+                ASSERT_EQUALS(9 - i, results[i]["foo"].numberInt());
+            }
+
+            const FetchStats* stats =
+                static_cast<const FetchStats*>(fetchStage->getSpecificStats());
+            ASSERT_EQUALS(size_t(1), stats->forcedFetches);
+            ASSERT_EQUALS(size_t(3), stats->batchesPrefetched);
+            ASSERT_EQUALS(size_t(9), stats->docsPrefetched);
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "query_stage_fetch" ) { }
@@ -211,6 +283,7 @@ namespace QueryStageFetch {
         void setupTests() {
             add<FetchStageAlreadyFetched>();
             add<FetchStageFilter>();
+            add<FetchStageBatched>();
         }
     };
 
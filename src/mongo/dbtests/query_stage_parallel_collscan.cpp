@@ -0,0 +1,249 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+/**
+ * This file tests db/exec/parallel_collection_scan.cpp.
+ */
+
+#include <algorithm>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/exec/collection_scan.h"
+#include "mongo/db/exec/parallel_collection_scan.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace QueryStageParallelCollectionScan {
+
+    class QueryStageParallelCollscanBase {
+    public:
+        QueryStageParallelCollscanBase() : _client(&_txn) {
+            Client::WriteContext ctx(&_txn, ns());
+
+            // Big enough documents that the collection spans several extents.
+            const std::string padding(1000, 'x');
+            for (int i = 0; i < numObj(); ++i) {
+                _client.insert(ns(), BSON("foo" << i << "padding" << padding));
+            }
+        }
+
+        virtual ~QueryStageParallelCollscanBase() {
+            Client::WriteContext ctx(&_txn, ns());
+            _client.dropCollection(ns());
+        }
+
+        MatchExpression* parse(const BSONObj& filterObj) {
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filterObj);
+            verify(swme.isOK());
+            return swme.getValue();
+        }
+
+        /**
+         * Works 'stage' to EOF and returns the "foo" field of each result.
+         */
+        vector<int> run(PlanStage* stage, WorkingSet* ws) {
+            vector<int> out;
+            for (;;) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                PlanStage::StageState state = stage->work(&id);
+                if (PlanStage::IS_EOF == state) { break; }
+                ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+                ASSERT_NOT_EQUALS(PlanStage::DEAD, state);
+                if (PlanStage::ADVANCED == state) {
+                    WorkingSetMember* member = ws->get(id);
+                    ASSERT(member->hasLoc());
+                    out.push_back(member->obj["foo"].numberInt());
+                    ws->free(id);
+                }
+            }
+            return out;
+        }
+
+        /**
+         * The results of an ordinary forward collection scan with 'filter'.
+         */
+        vector<int> collscan(Collection* coll, const MatchExpression* filter) {
+            CollectionScanParams params;
+            params.collection = coll;
+            params.direction = CollectionScanParams::FORWARD;
+            params.tailable = false;
+
+            WorkingSet ws;
+            CollectionScan scan(&_txn, params, &ws, filter);
+            return run(&scan, &ws);
+        }
+
+        static int numObj() { return 5000; }
+
+        static const char* ns() { return "unittests.QueryStageParallelCollectionScan"; }
+
+    protected:
+        OperationContextImpl _txn;
+
+    private:
+        DBDirectClient _client;
+    };
+
+    //
+    // In order, we get exactly what a collection scan gets.
+    //
+
+    class QueryStageParallelCollscanOrdered : public QueryStageParallelCollscanBase {
+    public:
+        void run() {
+            AutoGetCollectionForRead ctx(&_txn, ns());
+            Collection* coll = ctx.getCollection();
+
+            BSONObj filterObj = BSON("foo" << BSON("$mod" << BSON_ARRAY(3 << 1)));
+            auto_ptr<MatchExpression> filter(parse(filterObj));
+            vector<int> expected = collscan(coll, filter.get());
+            ASSERT_EQUALS(static_cast<size_t>(numObj() / 3), expected.size());
+
+            WorkingSet ws;
+            ParallelCollectionScanStage scan(&_txn, coll, &ws, filter.get(), true, 4);
+            ASSERT(expected == QueryStageParallelCollscanBase::run(&scan, &ws));
+
+            const CollectionScanStats* stats =
+                static_cast<const CollectionScanStats*>(scan.getSpecificStats());
+            ASSERT_EQUALS(static_cast<size_t>(numObj()), stats->docsTested);
+        }
+    };
+
+    //
+    // Out of order, we get the same documents.
+    //
+
+    class QueryStageParallelCollscanUnordered : public QueryStageParallelCollscanBase {
+    public:
+        void run() {
+            AutoGetCollectionForRead ctx(&_txn, ns());
+            Collection* coll = ctx.getCollection();
+
+            auto_ptr<MatchExpression> filter(parse(BSON("foo" << BSON("$gte" << 100))));
+            vector<int> expected = collscan(coll, filter.get());
+
+            WorkingSet ws;
+            ParallelCollectionScanStage scan(&_txn, coll, &ws, filter.get(), false, 4);
+            vector<int> got = QueryStageParallelCollscanBase::run(&scan, &ws);
+
+            std::sort(expected.begin(), expected.end());
+            std::sort(got.begin(), got.end());
+            ASSERT(expected == got);
+        }
+    };
+
+    //
+    // A document deleted while its match is buffered isn't returned.
+    //
+
+    class QueryStageParallelCollscanInvalidate : public QueryStageParallelCollscanBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+            Collection* coll = ctx.getCollection();
+
+            WorkingSet ws;
+            ParallelCollectionScanStage scan(&_txn, coll, &ws, NULL, true, 4);
+
+            // Work until we get the first result; more are buffered by now.
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            while (PlanStage::ADVANCED != scan.work(&id)) { }
+            ASSERT_EQUALS(0, ws.get(id)->obj["foo"].numberInt());
+            ws.free(id);
+
+            while (PlanStage::ADVANCED != scan.work(&id)) { }
+            ASSERT_EQUALS(1, ws.get(id)->obj["foo"].numberInt());
+            ws.free(id);
+
+            // Delete the next document.
+            vector<int> expected = collscan(coll, NULL);
+            DiskLoc next;
+            for (scoped_ptr<RecordIterator> it(coll->getIterator(&_txn)); !it->isEOF(); ) {
+                DiskLoc loc = it->getNext();
+                if (2 == coll->docFor(&_txn, loc)["foo"].numberInt()) {
+                    next = loc;
+                    break;
+                }
+            }
+            ASSERT(!next.isNull());
+
+            scan.saveState();
+            scan.invalidate(next, INVALIDATION_DELETION);
+            {
+                WriteUnitOfWork wuow(&_txn);
+                coll->deleteDocument(&_txn, next, false, true, NULL);
+                wuow.commit();
+            }
+            scan.restoreState(&_txn);
+
+            vector<int> got = QueryStageParallelCollscanBase::run(&scan, &ws);
+            ASSERT(vector<int>(expected.begin() + 3, expected.end()) == got);
+        }
+    };
+
+    //
+    // $where can't be matched on several threads.
+    //
+
+    class QueryStageParallelCollscanCanParallelize : public QueryStageParallelCollscanBase {
+    public:
+        void run() {
+            ASSERT(ParallelCollectionScanStage::canParallelize(NULL));
+
+            BSONObj filterObj = BSON("foo" << 1 << "bar" << BSON("$gt" << 2));
+            auto_ptr<MatchExpression> filter(parse(filterObj));
+            ASSERT(ParallelCollectionScanStage::canParallelize(filter.get()));
+
+            BSONObj whereObj = BSON("$or" << BSON_ARRAY(BSON("foo" << 1)
+                                                        << BSON("$where" << "this.foo > 2")));
+            StatusWithMatchExpression swme =
+                MatchExpressionParser::parse(whereObj, WhereCallbackNoop());
+            ASSERT_OK(swme.getStatus());
+            auto_ptr<MatchExpression> where(swme.getValue());
+            ASSERT(!ParallelCollectionScanStage::canParallelize(where.get()));
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "QueryStageParallelCollectionScan" ) {}
+
+        void setupTests() {
+            add<QueryStageParallelCollscanOrdered>();
+            add<QueryStageParallelCollscanUnordered>();
+            add<QueryStageParallelCollscanInvalidate>();
+            add<QueryStageParallelCollscanCanParallelize>();
+        }
+    };
+
+    SuiteInstance<All> all;
+
+}
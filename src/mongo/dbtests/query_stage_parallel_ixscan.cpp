@@ -0,0 +1,213 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+/**
+ * This file tests db/exec/parallel_index_scan.cpp.
+ */
+
+#include <algorithm>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/exec/index_scan.h"
+#include "mongo/db/exec/parallel_index_scan.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/index_bounds_builder.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace QueryStageParallelIndexScan {
+
+    class QueryStageParallelIxscanBase {
+    public:
+        QueryStageParallelIxscanBase() : _client(&_txn) { }
+
+        virtual ~QueryStageParallelIxscanBase() {
+            Client::WriteContext ctx(&_txn, ns());
+            _client.dropCollection(ns());
+        }
+
+        void addIndex(const BSONObj& obj) {
+            ASSERT_OK(dbtests::createIndex(&_txn, ns(), obj));
+        }
+
+        void insert(const BSONObj& obj) {
+            _client.insert(ns(), obj);
+        }
+
+        /**
+         * Scan {foo: 1} over [start, end].
+         */
+        IndexScanParams makeParams(Collection* coll, int start, int end) {
+            IndexScanParams params;
+            params.descriptor = coll->getIndexCatalog()->findIndexByKeyPattern(&_txn,
+                                                                               BSON("foo" << 1));
+            ASSERT(params.descriptor);
+            OrderedIntervalList oil("foo");
+            oil.intervals.push_back(Interval(BSON("" << start << "" << end), true, true));
+            params.bounds.fields.push_back(oil);
+            params.direction = 1;
+            return params;
+        }
+
+        /**
+         * Works 'stage' to EOF and returns the DiskLoc of each result, checking that the key
+         * came with it.
+         */
+        vector<DiskLoc> run(PlanStage* stage, WorkingSet* ws) {
+            vector<DiskLoc> out;
+            for (;;) {
+                WorkingSetID id = WorkingSet::INVALID_ID;
+                PlanStage::StageState state = stage->work(&id);
+                if (PlanStage::IS_EOF == state) { break; }
+                ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+                ASSERT_NOT_EQUALS(PlanStage::DEAD, state);
+                if (PlanStage::ADVANCED == state) {
+                    WorkingSetMember* member = ws->get(id);
+                    ASSERT_EQUALS(WorkingSetMember::LOC_AND_IDX, member->state);
+                    ASSERT_EQUALS(1U, member->keyData.size());
+                    out.push_back(member->loc);
+                    ws->free(id);
+                }
+            }
+            return out;
+        }
+
+        static const char* ns() { return "unittests.QueryStageParallelIndexScan"; }
+
+    protected:
+        OperationContextImpl _txn;
+
+    private:
+        DBDirectClient _client;
+    };
+
+    //
+    // In order, the split scan returns exactly what one index scan returns.
+    //
+
+    class QueryStageParallelIxscanOrdered : public QueryStageParallelIxscanBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+            addIndex(BSON("foo" << 1));
+            for (int i = 0; i < 5000; ++i) {
+                insert(BSON("foo" << i % 1000));
+            }
+            Collection* coll = ctx.getCollection();
+
+            IndexScanParams params = makeParams(coll, 100, 899);
+
+            WorkingSet ws;
+            IndexScan scan(&_txn, params, &ws, NULL);
+            vector<DiskLoc> expected = QueryStageParallelIxscanBase::run(&scan, &ws);
+            ASSERT_EQUALS(4000U, expected.size());
+
+            vector<IndexBounds> ranges;
+            ASSERT(IndexBoundsBuilder::splitRange(params.bounds, 4, &ranges));
+            WorkingSet parallelWs;
+            ParallelIndexScanStage parallel(&_txn, params, ranges, &parallelWs, NULL, true);
+            ASSERT(expected == QueryStageParallelIxscanBase::run(&parallel, &parallelWs));
+        }
+    };
+
+    //
+    // Out of order, we get the same results.
+    //
+
+    class QueryStageParallelIxscanUnordered : public QueryStageParallelIxscanBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+            addIndex(BSON("foo" << 1));
+            for (int i = 0; i < 5000; ++i) {
+                insert(BSON("foo" << i));
+            }
+            Collection* coll = ctx.getCollection();
+
+            IndexScanParams params = makeParams(coll, 0, 4999);
+
+            WorkingSet ws;
+            IndexScan scan(&_txn, params, &ws, NULL);
+            vector<DiskLoc> expected = QueryStageParallelIxscanBase::run(&scan, &ws);
+
+            vector<IndexBounds> ranges;
+            ASSERT(IndexBoundsBuilder::splitRange(params.bounds, 3, &ranges));
+            WorkingSet parallelWs;
+            ParallelIndexScanStage parallel(&_txn, params, ranges, &parallelWs, NULL, false);
+            vector<DiskLoc> got = QueryStageParallelIxscanBase::run(&parallel, &parallelWs);
+
+            std::sort(expected.begin(), expected.end());
+            std::sort(got.begin(), got.end());
+            ASSERT(expected == got);
+        }
+    };
+
+    //
+    // A document of a multikey index whose keys fall in different ranges is returned once.
+    //
+
+    class QueryStageParallelIxscanMultikey : public QueryStageParallelIxscanBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(&_txn, ns());
+            addIndex(BSON("foo" << 1));
+            for (int i = 0; i < 1000; ++i) {
+                insert(BSON("foo" << BSON_ARRAY(i << i + 1000)));
+            }
+            Collection* coll = ctx.getCollection();
+
+            IndexScanParams params = makeParams(coll, 0, 1999);
+
+            vector<IndexBounds> ranges;
+            ASSERT(IndexBoundsBuilder::splitRange(params.bounds, 2, &ranges));
+            WorkingSet ws;
+            ParallelIndexScanStage parallel(&_txn, params, ranges, &ws, NULL, true);
+            vector<DiskLoc> got = QueryStageParallelIxscanBase::run(&parallel, &ws);
+            ASSERT_EQUALS(1000U, got.size());
+
+            const ParallelIndexScanStats* stats =
+                static_cast<const ParallelIndexScanStats*>(parallel.getSpecificStats());
+            ASSERT_EQUALS(1000U, stats->dupsDropped);
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "QueryStageParallelIndexScan" ) {}
+
+        void setupTests() {
+            add<QueryStageParallelIxscanOrdered>();
+            add<QueryStageParallelIxscanUnordered>();
+            add<QueryStageParallelIxscanMultikey>();
+        }
+    };
+
+    SuiteInstance<All> all;
+
+}
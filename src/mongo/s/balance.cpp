@@ -32,9 +32,13 @@
 
 #include "mongo/s/balance.h"
 
+#include <boost/thread/thread.hpp>
+#include <list>
+
 #include "mongo/base/owned_pointer_map.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/db/write_concern_options.h"
 #include "mongo/s/chunk.h"
@@ -51,6 +55,7 @@
 #include "mongo/s/type_mongos.h"
 #include "mongo/s/type_settings.h"
 #include "mongo/s/type_tags.h"
+#include "mongo/stdx/functional.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
 #include "mongo/util/timer.h"
@@ -60,6 +65,28 @@ namespace mongo {
 
     MONGO_FP_DECLARE(skipBalanceRound);
 
+    // Most chunk migrations a balancing round runs at the same time
+    MONGO_EXPORT_SERVER_PARAMETER(balancerMaxParallelMigrations, int, 4);
+
+    // A shard with more operations than this queued for locks when a round starts neither
+    // donates nor receives chunks in that round; 0 disables the check
+    MONGO_EXPORT_SERVER_PARAMETER(balancerMaxQueuedOpsPerShard, int, 100);
+
+    // Balance untagged collections by each shard's share of their data and of the cluster's
+    // operations rather than by chunk counts, see BalancerCostModel
+    MONGO_EXPORT_SERVER_PARAMETER(balancerBalanceByDataSizeAndLoad, bool, false);
+
+    // Weight of a shard's share of operations against its share of data in its cost
+    MONGO_EXPORT_SERVER_PARAMETER(balancerOpsLoadWeight, double, 1.0);
+
+    // Cost difference between donor and receiver below which a collection counts as balanced,
+    // as a fraction of the mean shard cost
+    MONGO_EXPORT_SERVER_PARAMETER(balancerCostImbalanceThreshold, double, 0.2);
+
+    // Chunks per shard and collection whose size is estimated with dataSize in a round; the
+    // others count as the shard's average chunk
+    MONGO_EXPORT_SERVER_PARAMETER(balancerChunkSizeSamplesPerShard, int, 8);
+
     Balancer balancer;
 
     Balancer::Balancer() : _balancedLastTime(0), _policy( new BalancerPolicy() ) {}
@@ -67,83 +94,189 @@ namespace mongo {
     Balancer::~Balancer() {
     }
 
+    /**
+     * Hands the candidate chunks of a round out to the threads moving them, in order, except
+     * that a migration waits while another one runs from or to one of its shards, or for its
+     * collection, as the collection's metadata lock admits one at a time anyway.
+     */
+    class MigrationScheduler : boost::noncopyable {
+    public:
+        explicit MigrationScheduler(const vector<shared_ptr<MigrateInfo> >& candidates)
+            : _mutex("MigrationScheduler") {
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                _pending.push_back(candidates[i].get());
+            }
+        }
+
+        /**
+         * @return the next migration which can start, after waiting for running ones if
+         *         needed, or NULL once all have been handed out
+         */
+        const MigrateInfo* next() {
+            scoped_lock lk(_mutex);
+            while (true) {
+                if (_pending.empty())
+                    return NULL;
+
+                for (list<const MigrateInfo*>::iterator it = _pending.begin();
+                        it != _pending.end(); ++it) {
+                    const MigrateInfo* m = *it;
+                    if (_busyShards.count(m->from) || _busyShards.count(m->to) ||
+                            _busyCollections.count(m->ns)) {
+                        continue;
+                    }
+
+                    _pending.erase(it);
+                    _busyShards.insert(m->from);
+                    _busyShards.insert(m->to);
+                    _busyCollections.insert(m->ns);
+                    return m;
+                }
+
+                // Everything pending conflicts with a running migration
+                _migrationDone.wait(lk.boost());
+            }
+        }
+
+        void done(const MigrateInfo* m) {
+            scoped_lock lk(_mutex);
+            _busyShards.erase(m->from);
+            _busyShards.erase(m->to);
+            _busyCollections.erase(m->ns);
+            _migrationDone.notify_all();
+        }
+
+    private:
+        mongo::mutex _mutex;
+        boost::condition _migrationDone;
+        list<const MigrateInfo*> _pending;
+        set<string> _busyShards;
+        set<string> _busyCollections;
+    };
+
+    void Balancer::_moveChunksWorker(MigrationScheduler* scheduler,
+                                     const WriteConcernOptions* writeConcern,
+                                     bool waitForDelete,
+                                     AtomicInt32* movedCount) {
+        while (const MigrateInfo* chunkInfo = scheduler->next()) {
+            try {
+                if (_moveChunk(*chunkInfo, writeConcern, waitForDelete)) {
+                    movedCount->fetchAndAdd(1);
+                }
+            }
+            catch (const std::exception& ex) {
+                warning() << "could not move chunk " << chunkInfo->chunk.toString()
+                          << ", continuing balancing round" << causedBy(ex) << endl;
+            }
+            scheduler->done(chunkInfo);
+        }
+    }
+
     int Balancer::_moveChunks(const vector<CandidateChunkPtr>* candidateChunks,
                               const WriteConcernOptions* writeConcern,
                               bool waitForDelete)
     {
-        int movedCount = 0;
+        const size_t numThreads = std::min(static_cast<size_t>(
+                                               std::max(balancerMaxParallelMigrations, 1)),
+                                           candidateChunks->size());
+
+        if (numThreads <= 1) {
+            int movedCount = 0;
+            for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
+                if ( _moveChunk( *it->get(), writeConcern, waitForDelete ) ) {
+                    movedCount++;
+                }
+            }
+            return movedCount;
+        }
 
-        for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
-            const CandidateChunk& chunkInfo = *it->get();
+        MigrationScheduler scheduler(*candidateChunks);
+        AtomicInt32 movedCount(0);
+
+        boost::thread_group migrators;
+        for (size_t i = 0; i < numThreads; ++i) {
+            migrators.create_thread(stdx::bind(&Balancer::_moveChunksWorker,
+                                               this,
+                                               &scheduler,
+                                               writeConcern,
+                                               waitForDelete,
+                                               &movedCount));
+        }
+        migrators.join_all();
 
-            // Changes to metadata, borked metadata, and connectivity problems should cause us to
-            // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
-            // TODO: Handle all these things more cleanly, since they're expected problems
-            try {
+        return movedCount.load();
+    }
 
-                DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
-                verify( cfg );
+    bool Balancer::_moveChunk(const CandidateChunk& chunkInfo,
+                              const WriteConcernOptions* writeConcern,
+                              bool waitForDelete)
+    {
+        // Changes to metadata, borked metadata, and connectivity problems should cause us to
+        // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
+        // TODO: Handle all these things more cleanly, since they're expected problems
+        try {
 
-                // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
-                // tried to do so once.
-                ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
-                verify( cm );
+            DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
+            verify( cfg );
 
-                ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
-                if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                    // likely a split happened somewhere
-                    cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
-                    verify( cm );
+            // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
+            // tried to do so once.
+            ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            verify( cm );
 
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
-                    if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                        log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
-                        continue;
-                    }
-                }
+            ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
+                // likely a split happened somewhere
+                cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
+                verify( cm );
 
-                BSONObj res;
-                if (c->moveAndCommit(Shard::make(chunkInfo.to),
-                                     Chunk::MaxChunkSize,
-                                     writeConcern,
-                                     waitForDelete,
-                                     0, /* maxTimeMS */
-                                     res)) {
-                    movedCount++;
-                    continue;
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+                if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
+                    log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
+                    return false;
                 }
+            }
 
-                // the move requires acquiring the collection metadata's lock, which can fail
-                log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
-                      << " chunk: " << chunkInfo.chunk << endl;
+            BSONObj res;
+            if (c->moveAndCommit(Shard::make(chunkInfo.to),
+                                 Chunk::MaxChunkSize,
+                                 writeConcern,
+                                 waitForDelete,
+                                 0, /* maxTimeMS */
+                                 res)) {
+                return true;
+            }
 
-                if ( res["chunkTooBig"].trueValue() ) {
-                    // reload just to be safe
-                    cm = cfg->getChunkManager( chunkInfo.ns );
-                    verify( cm );
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            // the move requires acquiring the collection metadata's lock, which can fail
+            log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
+                  << " chunk: " << chunkInfo.chunk << endl;
 
-                    log() << "forcing a split because migrate failed for size reasons" << endl;
+            if ( res["chunkTooBig"].trueValue() ) {
+                // reload just to be safe
+                cm = cfg->getChunkManager( chunkInfo.ns );
+                verify( cm );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
 
-                    Status status = c->split(true /* atMedian */, NULL, NULL);
-                    log() << "forced split results: " << status << endl;
+                log() << "forcing a split because migrate failed for size reasons" << endl;
 
-                    if ( !status.isOK() ) {
-                        log() << "marking chunk as jumbo: " << c->toString() << endl;
-                        c->markAsJumbo();
-                        // we increment moveCount so we do another round right away
-                        movedCount++;
-                    }
+                Status status = c->split(true /* atMedian */, NULL, NULL);
+                log() << "forced split results: " << status << endl;
 
+                if ( !status.isOK() ) {
+                    log() << "marking chunk as jumbo: " << c->toString() << endl;
+                    c->markAsJumbo();
+                    // we count it as moved so we do another round right away
+                    return true;
                 }
+
             }
-            catch( const DBException& ex ) {
-                warning() << "could not move chunk " << chunkInfo.chunk.toString()
-                          << ", continuing balancing round" << causedBy( ex ) << endl;
-            }
+        }
+        catch( const DBException& ex ) {
+            warning() << "could not move chunk " << chunkInfo.chunk.toString()
+                      << ", continuing balancing round" << causedBy( ex ) << endl;
         }
 
-        return movedCount;
+        return false;
     }
 
     void Balancer::_ping( bool waiting ) {
@@ -357,6 +490,22 @@ namespace mongo {
 
         OCCASIONALLY warnOnMultiVersion( shardInfo );
 
+        if ( balancerBalanceByDataSizeAndLoad ) {
+            _setOpRates( &shardInfo );
+        }
+
+        // Shards too busy to take part in a migration this round
+        set<string> busyShards;
+        if ( balancerMaxQueuedOpsPerShard > 0 ) {
+            for ( ShardInfoMap::const_iterator i = shardInfo.begin(); i != shardInfo.end(); ++i ) {
+                if ( i->second.getQueuedOps() > balancerMaxQueuedOpsPerShard ) {
+                    log() << "not migrating chunks from or to " << i->first << " this round, it has "
+                          << i->second.getQueuedOps() << " operations queued" << endl;
+                    busyShards.insert( i->first );
+                }
+            }
+        }
+
         //
         // 3. For each collection, check if the balancing policy recommends moving anything around.
         //
@@ -490,11 +639,90 @@ namespace mongo {
                 continue;
             }
 
-            CandidateChunk* p = _policy->balance( ns, status, _balancedLastTime );
-            if ( p ) candidateChunks->push_back( CandidateChunkPtr( p ) );
+            if ( balancerBalanceByDataSizeAndLoad && ranges.empty() ) {
+                _loadDataSizes( *cm, allShards, shardToChunksMap.map(), &status );
+            }
+
+            // Ask for a migration between each disjoint pair of shards the policy wants to use;
+            // only the counts of the shards a migration uses change, so the others stay valid
+            set<string> usedShards( busyShards );
+            while ( CandidateChunk* p = _policy->balance( ns, status, _balancedLastTime, usedShards ) ) {
+                usedShards.insert( p->from );
+                usedShards.insert( p->to );
+                candidateChunks->push_back( CandidateChunkPtr( p ) );
+            }
         }
     }
 
+    void Balancer::_setOpRates( ShardInfoMap* shardInfo ) {
+        const long long now = curTimeMillis64();
+
+        for ( ShardInfoMap::iterator i = shardInfo->begin(); i != shardInfo->end(); ++i ) {
+            const long long totalOps = i->second.getTotalOps();
+
+            map<string, OpCountSample>::const_iterator last = _lastOpCounts.find( i->first );
+            // A drop in the counters means the shard restarted
+            if ( last != _lastOpCounts.end() && now > last->second.millis
+                 && totalOps >= last->second.totalOps ) {
+                i->second.setOpsPerSec( ( totalOps - last->second.totalOps ) * 1000.0
+                                        / ( now - last->second.millis ) );
+            }
+
+            OpCountSample& sample = _lastOpCounts[i->first];
+            sample.totalOps = totalOps;
+            sample.millis = now;
+        }
+    }
+
+    void Balancer::_loadDataSizes( const ChunkManager& cm,
+                                   const vector<Shard>& allShards,
+                                   const ShardToChunksMap& shardToChunksMap,
+                                   DistributionStatus* status ) {
+        const NamespaceString nss( cm.getns() );
+
+        for ( vector<Shard>::const_iterator i = allShards.begin(); i != allShards.end(); ++i ) {
+            const Shard& shard = *i;
+            ShardToChunksMap::const_iterator chunksIt = shardToChunksMap.find( shard.getName() );
+            const vector<ChunkType*>& chunks = chunksIt->second->vector();
+
+            if ( chunks.empty() ) {
+                status->setShardDataSize( shard.getName(), 0 );
+                continue;
+            }
+
+            try {
+                BSONObj stats = shard.runCommand( nss.db().toString(),
+                                                  BSON( "collStats" << nss.coll() ) );
+                status->setShardDataSize( shard.getName(), stats["size"].numberLong() );
+
+                // Sample chunks evenly over the shard's key range
+                const size_t maxSamples = std::max( balancerChunkSizeSamplesPerShard, 0 );
+                const size_t samples = std::min( chunks.size(), maxSamples );
+                for ( size_t s = 0; s < samples; s++ ) {
+                    const ChunkType& chunk = *chunks[s * chunks.size() / samples];
+                    BSONObj cmd = BSON( "dataSize" << nss.ns()
+                                        << "keyPattern" << cm.getShardKeyPattern().toBSON()
+                                        << "min" << chunk.getMin()
+                                        << "max" << chunk.getMax()
+                                        << "estimate" << true );
+                    BSONObj size = shard.runCommand( nss.db().toString(), cmd );
+                    status->setChunkDataSize( chunk.getMin(), size["size"].numberLong() );
+                }
+            }
+            catch ( const DBException& e ) {
+                // Without this shard's size the collection is balanced by chunk counts
+                warning() << "could not get the data size of " << nss.ns() << " on "
+                          << shard.getName() << " to balance it by cost: " << e.what() << endl;
+                return;
+            }
+        }
+
+        BalancerCostModel model;
+        model.opsWeight = balancerOpsLoadWeight;
+        model.imbalanceThreshold = balancerCostImbalanceThreshold;
+        status->useCostModel( model );
+    }
+
     bool Balancer::_init() {
         try {
 
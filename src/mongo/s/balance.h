@@ -33,11 +33,13 @@
 #include "mongo/pch.h"
 
 #include "mongo/client/dbclientinterface.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/s/balancer_policy.h"
 #include "mongo/util/background.h"
 
 namespace mongo {
 
+    class MigrationScheduler;
     struct WriteConcernOptions;
 
     /**
@@ -46,8 +48,8 @@ namespace mongo {
      * uses a 'DistributedLock' for that coordination.
      *
      * The balancer does act continuously but in "rounds". At a given round, it would decide if there is an imbalance by
-     * checking the difference in chunks between the most and least loaded shards. It would issue a request for a chunk
-     * migration per round, if it found so.
+     * checking the difference in chunks between the most and least loaded shards. It would issue requests for chunk
+     * migrations between disjoint pairs of shards, several of which may run at the same time, if it found so.
      */
     class Balancer : public BackgroundJob {
     public:
@@ -75,6 +77,14 @@ namespace mongo {
 
         // decide which chunks to move; owned here.
         scoped_ptr<BalancerPolicy> _policy;
+
+        struct OpCountSample {
+            long long totalOps;
+            long long millis;
+        };
+
+        // operation counters of each shard when last polled, to derive their operation rates
+        std::map<std::string, OpCountSample> _lastOpCounts;
         
         /**
          * Checks that the balancer can connect to all servers it needs to do its job.
@@ -90,12 +100,30 @@ namespace mongo {
          * be moved.
          *
          * @param conn is the connection with the config server(s)
-         * @param candidateChunks (IN/OUT) filled with candidate chunks, one per collection, that could possibly be moved
+         * @param candidateChunks (IN/OUT) filled with candidate chunks that could possibly be moved. Within a collection
+         *        no two of them share a shard, and shards with too many queued operations are left out.
          */
         void _doBalanceRound( DBClientBase& conn, std::vector<CandidateChunkPtr>* candidateChunks );
 
         /**
-         * Issues chunk migration request, one at a time.
+         * Sets the operation rate of each shard from the change of its operation counters since the
+         * previous round.
+         */
+        void _setOpRates( ShardInfoMap* shardInfo );
+
+        /**
+         * Fetches the data size of a collection on each shard, and estimates for a sample of its
+         * chunks, so that 'status' balances it by cost. Leaves 'status' balancing by chunk counts
+         * if any shard can't be asked.
+         */
+        void _loadDataSizes( const ChunkManager& cm,
+                             const std::vector<Shard>& allShards,
+                             const ShardToChunksMap& shardToChunksMap,
+                             DistributionStatus* status );
+
+        /**
+         * Issues chunk migration requests, up to balancerMaxParallelMigrations at a time, never running two at the
+         * same time which share a shard or a collection.
          *
          * @param candidateChunks possible chunks to move
          * @param writeConcern detailed write concern. NULL means the default write concern.
@@ -106,6 +134,23 @@ namespace mongo {
                         const WriteConcernOptions* writeConcern,
                         bool waitForDelete);
 
+        /**
+         * Issues one chunk migration request.
+         *
+         * @return true if the chunk moved, or if it was marked as jumbo and another round should follow right away
+         */
+        bool _moveChunk(const CandidateChunk& chunkInfo,
+                        const WriteConcernOptions* writeConcern,
+                        bool waitForDelete);
+
+        /**
+         * Body of the threads of _moveChunks(), moving chunks until the scheduler runs out.
+         */
+        void _moveChunksWorker(MigrationScheduler* scheduler,
+                               const WriteConcernOptions* writeConcern,
+                               bool waitForDelete,
+                               AtomicInt32* movedCount);
+
         /**
          * Marks this balancer as being live on the config server(s).
          */
@@ -50,7 +50,7 @@ namespace mongo {
 
     DistributionStatus::DistributionStatus( const ShardInfoMap& shardInfo,
                                             const ShardToChunksMap& shardToChunksMap )
-        : _shardInfo( shardInfo ), _shardChunks( shardToChunksMap ) {
+        : _shardInfo( shardInfo ), _shardChunks( shardToChunksMap ), _useCostModel( false ) {
 
         for ( ShardInfoMap::const_iterator i = _shardInfo.begin(); i != _shardInfo.end(); ++i ) {
             _shards.insert( i->first );
@@ -63,6 +63,41 @@ namespace mongo {
         return i->second;
     }
 
+    void DistributionStatus::useCostModel( const BalancerCostModel& model ) {
+        _useCostModel = true;
+        _costModel = model;
+    }
+
+    void DistributionStatus::setShardDataSize( const string& shard, long long bytes ) {
+        _shardDataSizes[shard] = bytes;
+    }
+
+    void DistributionStatus::setChunkDataSize( const BSONObj& min, long long bytes ) {
+        _chunkDataSizes[min.getOwned()] = bytes;
+    }
+
+    const BalancerCostModel* DistributionStatus::costModel() const {
+        if ( ! _useCostModel || ! _allTags.empty() )
+            return NULL;
+
+        for ( set<string>::const_iterator i = _shards.begin(); i != _shards.end(); ++i ) {
+            if ( shardDataSize( *i ) < 0 )
+                return NULL;
+        }
+
+        return &_costModel;
+    }
+
+    long long DistributionStatus::shardDataSize( const string& shard ) const {
+        map<string, long long>::const_iterator i = _shardDataSizes.find( shard );
+        return i == _shardDataSizes.end() ? -1 : i->second;
+    }
+
+    long long DistributionStatus::chunkDataSize( const ChunkType& chunk ) const {
+        map<BSONObj, long long>::const_iterator i = _chunkDataSizes.find( chunk.getMin() );
+        return i == _chunkDataSizes.end() ? -1 : i->second;
+    }
+
     unsigned DistributionStatus::totalChunks() const {
         unsigned total = 0;
 
@@ -100,11 +135,17 @@ namespace mongo {
         return total;
     }
 
-    string DistributionStatus::getBestReceieverShard( const string& tag ) const {
+    string DistributionStatus::getBestReceieverShard( const string& tag,
+                                                      const set<string>* usedShards ) const {
         string best;
         unsigned minChunks = numeric_limits<unsigned>::max();
 
         for ( ShardInfoMap::const_iterator i = _shardInfo.begin(); i != _shardInfo.end(); ++i ) {
+            if ( usedShards && usedShards->count( i->first ) ) {
+                LOG(1) << i->first << " is already migrating a chunk this round." << endl;
+                continue;
+            }
+
             if ( i->second.isSizeMaxed() ) {
                 LOG(1) << i->first << " has already reached the maximum total chunk size." << endl;
                 continue;
@@ -133,11 +174,15 @@ namespace mongo {
         return best;
     }
 
-    string DistributionStatus::getMostOverloadedShard( const string& tag ) const {
+    string DistributionStatus::getMostOverloadedShard( const string& tag,
+                                                       const set<string>* usedShards ) const {
         string worst;
         unsigned maxChunks = 0;
 
         for ( ShardInfoMap::const_iterator i = _shardInfo.begin(); i != _shardInfo.end(); ++i ) {
+            if ( usedShards && usedShards->count( i->first ) )
+                continue;
+
             unsigned myChunks = numberOfChunksInShardWithTag( i->first, tag );
             if ( myChunks <= maxChunks )
                 continue;
@@ -243,7 +288,9 @@ namespace mongo {
                                                   status.mapped(),
                                                   shard.isDraining(),
                                                   shard.tags(),
-                                                  status.mongoVersion())));
+                                                  status.mongoVersion(),
+                                                  status.queuedOps(),
+                                                  status.totalOps())));
         }
     }
 
@@ -312,6 +359,13 @@ namespace mongo {
     MigrateInfo* BalancerPolicy::balance( const string& ns,
                                           const DistributionStatus& distribution,
                                           int balancedLastTime ) {
+        return balance( ns, distribution, balancedLastTime, set<string>() );
+    }
+
+    MigrateInfo* BalancerPolicy::balance( const string& ns,
+                                          const DistributionStatus& distribution,
+                                          int balancedLastTime,
+                                          const set<string>& usedShards ) {
 
 
         // 1) check for shards that policy require to us to move off of:
@@ -334,6 +388,9 @@ namespace mongo {
                 if ( distribution.numberOfChunksInShard( shard ) == 0 )
                     continue;
 
+                if ( usedShards.count( shard ) )
+                    continue;
+
                 // now we know we need to move to chunks off this shard
                 // we will if we are allowed
                 const vector<ChunkType* >& chunks = distribution.getChunks( shard );
@@ -348,7 +405,7 @@ namespace mongo {
                     }
 
                     string tag = distribution.getTagForChunk( chunkToMove );
-                    string to = distribution.getBestReceieverShard( tag );
+                    string to = distribution.getBestReceieverShard( tag, &usedShards );
 
                     if ( to.size() == 0 ) {
                         warning() << "want to move chunk: " << chunkToMove
@@ -381,6 +438,9 @@ namespace mongo {
                 string shard = *i;
                 const ShardInfo& info = distribution.shardInfo( shard );
 
+                if ( usedShards.count( shard ) )
+                    continue;
+
                 const vector<ChunkType *>& chunks = distribution.getChunks(shard);
                 for ( unsigned j = 0; j < chunks.size(); j++ ) {
                     const ChunkType& chunk = *chunks[j];
@@ -399,7 +459,7 @@ namespace mongo {
                         continue;
                     }
 
-                    string to = distribution.getBestReceieverShard( tag );
+                    string to = distribution.getBestReceieverShard( tag, &usedShards );
                     if ( to.size() == 0 ) {
                         log() << "no where to put it :(" << endl;
                         continue;
@@ -413,6 +473,10 @@ namespace mongo {
 
         // 3) for each tag balance
 
+        if ( distribution.costModel() ) {
+            return balanceByCost( ns, distribution, usedShards );
+        }
+
         int threshold = 8;
         if ( balancedLastTime || distribution.totalChunks() < 20 )
             threshold = 2;
@@ -434,7 +498,7 @@ namespace mongo {
         for ( unsigned i=0; i<tags.size(); i++ ) {
             string tag = tags[i];
 
-            string from = distribution.getMostOverloadedShard( tag );
+            string from = distribution.getMostOverloadedShard( tag, &usedShards );
             if ( from.size() == 0 )
                 continue;
 
@@ -442,7 +506,7 @@ namespace mongo {
             if ( max == 0 )
                 continue;
 
-            string to = distribution.getBestReceieverShard( tag );
+            string to = distribution.getBestReceieverShard( tag, &usedShards );
             if ( to.size() == 0 ) {
                 log() << "no available shards to take chunks for tag [" << tag << "]" << endl;
                 return NULL;
@@ -493,22 +557,154 @@ namespace mongo {
         return NULL;
     }
 
+    MigrateInfo* BalancerPolicy::balanceByCost( const string& ns,
+                                                const DistributionStatus& distribution,
+                                                const set<string>& usedShards ) {
+        const BalancerCostModel& model = *distribution.costModel();
+        const set<string>& shards = distribution.shards();
+
+        long long totalBytes = 0;
+        double totalOps = 0;
+        for ( set<string>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
+            totalBytes += distribution.shardDataSize( *i );
+            totalOps += distribution.shardInfo( *i ).getOpsPerSec();
+        }
+
+        if ( totalBytes == 0 )
+            return NULL;
+
+        // Without operation rates the data share alone decides
+        const double opsWeight = totalOps > 0 ? model.opsWeight : 0;
+
+        map<string, double> costs;
+        for ( set<string>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
+            double cost = static_cast<double>( distribution.shardDataSize( *i ) ) / totalBytes;
+            if ( opsWeight > 0 )
+                cost += opsWeight * distribution.shardInfo( *i ).getOpsPerSec() / totalOps;
+            costs[*i] = cost;
+        }
+
+        string from;
+        string to;
+        for ( set<string>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
+            if ( usedShards.count( *i ) )
+                continue;
+
+            if ( distribution.numberOfChunksInShard( *i ) > 0
+                 && ( from.empty() || costs[*i] > costs[from] ) ) {
+                from = *i;
+            }
+
+            const ShardInfo& info = distribution.shardInfo( *i );
+            if ( ! info.isSizeMaxed() && ! info.isDraining()
+                 && ( to.empty() || costs[*i] < costs[to] ) ) {
+                to = *i;
+            }
+        }
+
+        if ( from.empty() || to.empty() || from == to )
+            return NULL;
+
+        const double meanCost = ( 1 + opsWeight ) / shards.size();
+
+        LOG(1) << "collection : " << ns << endl;
+        LOG(1) << "donor      : " << from << " cost " << costs[from] << endl;
+        LOG(1) << "receiver   : " << to << " cost " << costs[to] << endl;
+        LOG(1) << "threshold  : " << model.imbalanceThreshold * meanCost << endl;
+
+        if ( costs[from] - costs[to] < model.imbalanceThreshold * meanCost )
+            return NULL;
+
+        // Chunks without a size estimate count as the donor's average chunk, and operations are
+        // assumed to spread evenly over the donor's chunks
+        const vector<ChunkType*>& chunks = distribution.getChunks( from );
+        const long long avgChunkBytes = distribution.shardDataSize( from ) / chunks.size();
+        const double chunkOpsCost = opsWeight > 0 ?
+            opsWeight * distribution.shardInfo( from ).getOpsPerSec() / totalOps / chunks.size() :
+            0;
+
+        const double halfSpread = ( costs[from] - costs[to] ) / 2;
+
+        // Best chunk which moves the receiver at most to the midpoint, and as a fallback the
+        // smallest one which still narrows the gap
+        const ChunkType* best = NULL;
+        double bestRelief = 0;
+        double bestReliefPerByte = 0;
+        const ChunkType* smallest = NULL;
+        double smallestRelief = 0;
+        for ( unsigned i = 0; i < chunks.size(); i++ ) {
+            const ChunkType& chunk = *chunks[i];
+            if ( chunk.isJumboSet() && chunk.getJumbo() )
+                continue;
+
+            long long bytes = distribution.chunkDataSize( chunk );
+            if ( bytes < 0 )
+                bytes = avgChunkBytes;
+
+            const double relief = static_cast<double>( bytes ) / totalBytes + chunkOpsCost;
+
+            // Moving it must leave the receiver below where the donor started
+            if ( costs[to] + relief >= costs[from] )
+                continue;
+
+            if ( relief > halfSpread ) {
+                if ( ! smallest || relief < smallestRelief ) {
+                    smallest = &chunk;
+                    smallestRelief = relief;
+                }
+                continue;
+            }
+
+            const double reliefPerByte = relief / std::max( bytes, 1LL );
+            if ( best && reliefPerByte < bestReliefPerByte * ( 1 - 1e-9 ) )
+                continue;
+            if ( best && reliefPerByte <= bestReliefPerByte * ( 1 + 1e-9 )
+                 && relief <= bestRelief )
+                continue;
+
+            best = &chunk;
+            bestRelief = relief;
+            bestReliefPerByte = reliefPerByte;
+        }
+
+        if ( ! best )
+            best = smallest;
+
+        if ( ! best ) {
+            LOG(1) << "no chunk of " << from << " lowers the cost imbalance of " << ns << endl;
+            return NULL;
+        }
+
+        log() << " ns: " << ns << " going to move " << *best
+              << " from: " << from << " (cost " << costs[from] << ")"
+              << " to: " << to << " (cost " << costs[to] << ")" << endl;
+        return new MigrateInfo( ns, to, from, best->toBSON() );
+    }
+
 
     ShardInfo::ShardInfo( long long maxSize, long long currSize,
                           bool draining,
                           const set<string>& tags, 
-                          const string& mongoVersion )
+                          const string& mongoVersion,
+                          long long queuedOps,
+                          long long totalOps )
         : _maxSize( maxSize ),
           _currSize( currSize ),
           _draining( draining ),
           _tags( tags ),
-          _mongoVersion( mongoVersion ) {
+          _mongoVersion( mongoVersion ),
+          _queuedOps( queuedOps ),
+          _totalOps( totalOps ),
+          _opsPerSec( 0 ) {
     }
 
     ShardInfo::ShardInfo()
         : _maxSize( 0 ),
           _currSize( 0 ),
-          _draining( false ) {
+          _draining( false ),
+          _queuedOps( 0 ),
+          _totalOps( 0 ),
+          _opsPerSec( 0 ) {
     }
 
     void ShardInfo::addTag( const string& tag ) {
@@ -540,6 +736,8 @@ namespace mongo {
                 ss << *i << ",";
         }
         ss << " version: " << _mongoVersion;
+        ss << " queuedOps: " << _queuedOps;
+        ss << " opsPerSec: " << _opsPerSec;
         return ss.str();
     }
 
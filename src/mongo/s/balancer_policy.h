@@ -74,7 +74,9 @@ namespace mongo {
         ShardInfo( long long maxSize, long long currSize, 
                    bool draining,
                    const std::set<std::string>& tags = std::set<std::string>(),
-                   const std::string& _mongoVersion = std::string("") );
+                   const std::string& _mongoVersion = std::string(""),
+                   long long queuedOps = 0,
+                   long long totalOps = 0 );
 
         void addTag( const std::string& tag );
 
@@ -100,6 +102,16 @@ namespace mongo {
 
         std::string getMongoVersion() const { return _mongoVersion; }
 
+        /** @return the number of operations queued for locks when the shard was polled */
+        long long getQueuedOps() const { return _queuedOps; }
+
+        /** @return the number of operations the shard had served when it was polled */
+        long long getTotalOps() const { return _totalOps; }
+
+        /** @return the recent operation rate of the shard, 0 if unknown */
+        double getOpsPerSec() const { return _opsPerSec; }
+        void setOpsPerSec( double opsPerSec ) { _opsPerSec = opsPerSec; }
+
         std::string toString() const;
         
     private:
@@ -108,6 +120,9 @@ namespace mongo {
         bool _draining;
         std::set<std::string> _tags;
         std::string _mongoVersion;
+        long long _queuedOps;
+        long long _totalOps;
+        double _opsPerSec;
     };
     
     struct MigrateInfo {
@@ -122,6 +137,21 @@ namespace mongo {
 
     };
 
+    /**
+     * Weights of the cost balancing mode, in which a shard's cost is its share of a collection's
+     * data plus 'opsWeight' times its share of the cluster's recent operations, and chunks move
+     * from the most to the least costly shard instead of by chunk counts.
+     */
+    struct BalancerCostModel {
+        BalancerCostModel() : opsWeight( 1.0 ), imbalanceThreshold( 0.2 ) {}
+
+        double opsWeight;
+
+        // Smallest cost difference between donor and receiver worth a migration, as a fraction
+        // of the mean shard cost
+        double imbalanceThreshold;
+    };
+
     typedef std::map< std::string,ShardInfo > ShardInfoMap;
     typedef std::map<std::string, OwnedPointerVector<ChunkType>* > ShardToChunksMap;
 
@@ -137,19 +167,35 @@ namespace mongo {
          */
         bool addTagRange( const TagRange& range );
 
+        /**
+         * Switches the collection to cost balancing, see BalancerCostModel. Only applies to
+         * collections without tags which have the data size of every shard set.
+         */
+        void useCostModel( const BalancerCostModel& model );
+
+        /** Sets the bytes of the collection stored on 'shard' */
+        void setShardDataSize( const std::string& shard, long long bytes );
+
+        /** Sets the estimated bytes of the chunk starting at 'min' */
+        void setChunkDataSize( const BSONObj& min, long long bytes );
+
         // ---- these methods might be better suiting in BalancerPolicy
         
         /**
          * @param forTag "" if you don't care, or a tag
+         * @param usedShards if not NULL, shards which can't be picked
          * @return shard best suited to receive a chunk
          */
-        std::string getBestReceieverShard( const std::string& forTag ) const;
+        std::string getBestReceieverShard( const std::string& forTag,
+                                           const std::set<std::string>* usedShards = NULL ) const;
 
         /**
+         * @param usedShards if not NULL, shards which can't be picked
          * @return the shard with the most chunks
          *         based on # of chunks with the given tag
          */
-        std::string getMostOverloadedShard( const std::string& forTag ) const;
+        std::string getMostOverloadedShard( const std::string& forTag,
+                                            const std::set<std::string>* usedShards = NULL ) const;
 
 
         // ---- basic accessors, counters, etc...
@@ -177,6 +223,15 @@ namespace mongo {
 
         /** @return the ShardInfo for the shard */
         const ShardInfo& shardInfo( const std::string& shard ) const;
+
+        /** @return the cost model if the collection is to be balanced by cost, otherwise NULL */
+        const BalancerCostModel* costModel() const;
+
+        /** @return bytes of the collection on the shard, -1 if unknown */
+        long long shardDataSize( const std::string& shard ) const;
+
+        /** @return estimated bytes of the chunk, -1 if unknown */
+        long long chunkDataSize( const ChunkType& chunk ) const;
         
         /** writes all state to log() */
         void dump() const;
@@ -206,6 +261,10 @@ namespace mongo {
         std::map<BSONObj,TagRange> _tagRanges;
         std::set<std::string> _allTags;
         std::set<std::string> _shards;
+        bool _useCostModel;
+        BalancerCostModel _costModel;
+        std::map<std::string, long long> _shardDataSizes;
+        std::map<BSONObj, long long> _chunkDataSizes;
     };
 
     class BalancerPolicy {
@@ -225,6 +284,29 @@ namespace mongo {
         static MigrateInfo* balance( const std::string& ns,
                                      const DistributionStatus& distribution,
                                      int balancedLastTime );
+
+        /**
+         * Same as above, but never suggests moving a chunk from or to one of 'usedShards', the
+         * shards which already take part in a migration of this balancing round. As their chunk
+         * counts are the only ones such a migration changes, calling this again with the shards
+         * of each suggestion added to 'usedShards' yields further migrations which may all run
+         * at the same time.
+         */
+        static MigrateInfo* balance( const std::string& ns,
+                                     const DistributionStatus& distribution,
+                                     int balancedLastTime,
+                                     const std::set<std::string>& usedShards );
+
+    private:
+        /**
+         * Suggests moving, from the shard with the highest cost to the one with the lowest, the
+         * chunk relieving the most cost per byte moved without taking the receiver past the
+         * midpoint of their costs. Returns NULL if the shards' costs are within the model's
+         * threshold.
+         */
+        static MigrateInfo* balanceByCost( const std::string& ns,
+                                           const DistributionStatus& distribution,
+                                           const std::set<std::string>& usedShards );
     };
 
 
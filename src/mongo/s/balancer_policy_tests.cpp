@@ -76,6 +76,134 @@ namespace mongo {
         }
 
 
+        TEST( BalancerPolicyTests , BalanceDisjointShardPairs ) {
+            // 2 shards with 4 chunks each and 2 empty shards
+            OwnedShardToChunksMap chunkMap;
+            for ( int s = 0; s < 2; s++ ) {
+                auto_ptr<OwnedPointerVector<ChunkType> > chunks(new OwnedPointerVector<ChunkType>());
+                for ( int i = 0; i < 4; i++ ) {
+                    auto_ptr<ChunkType> chunk(new ChunkType());
+                    chunk->setMin(BSON("x" << (s * 4 + i) * 10));
+                    chunk->setMax(BSON("x" << (s * 4 + i + 1) * 10));
+                    chunks->push_back(chunk.release());
+                }
+                chunkMap.mutableMap()[str::stream() << "shard" << s] = chunks.release();
+            }
+            chunkMap.mutableMap()["shard2"] = new OwnedPointerVector<ChunkType>();
+            chunkMap.mutableMap()["shard3"] = new OwnedPointerVector<ChunkType>();
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo(0, 4, false);
+            info["shard1"] = ShardInfo(0, 4, false);
+            info["shard2"] = ShardInfo(0, 0, false);
+            info["shard3"] = ShardInfo(0, 0, false);
+
+            DistributionStatus status(info, chunkMap.map());
+
+            set<string> usedShards;
+            boost::scoped_ptr<MigrateInfo> first(
+                    BalancerPolicy::balance( "ns", status, 1, usedShards ));
+            ASSERT( first );
+            usedShards.insert( first->from );
+            usedShards.insert( first->to );
+
+            boost::scoped_ptr<MigrateInfo> second(
+                    BalancerPolicy::balance( "ns", status, 1, usedShards ));
+            ASSERT( second );
+            ASSERT_EQUALS( 0U, usedShards.count( second->from ) );
+            ASSERT_EQUALS( 0U, usedShards.count( second->to ) );
+            usedShards.insert( second->from );
+            usedShards.insert( second->to );
+
+            // every shard is taken
+            boost::scoped_ptr<MigrateInfo> third(
+                    BalancerPolicy::balance( "ns", status, 1, usedShards ));
+            ASSERT( !third );
+        }
+
+        /**
+         * Gives each of 'numShards' shards 'chunksPerShard' consecutive chunks on { x : 1 }.
+         */
+        void makeEvenChunks( int numShards, int chunksPerShard, OwnedShardToChunksMap* chunkMap ) {
+            for ( int s = 0; s < numShards; s++ ) {
+                auto_ptr<OwnedPointerVector<ChunkType> > chunks(new OwnedPointerVector<ChunkType>());
+                for ( int i = 0; i < chunksPerShard; i++ ) {
+                    auto_ptr<ChunkType> chunk(new ChunkType());
+                    chunk->setMin(BSON("x" << (s * chunksPerShard + i) * 10));
+                    chunk->setMax(BSON("x" << (s * chunksPerShard + i + 1) * 10));
+                    chunks->push_back(chunk.release());
+                }
+                chunkMap->mutableMap()[str::stream() << "shard" << s] = chunks.release();
+            }
+        }
+
+        TEST( BalancerPolicyTests , BalanceByCostMovesOffHotShard ) {
+            // same chunks and data on both shards, but all operations on shard0
+            OwnedShardToChunksMap chunkMap;
+            makeEvenChunks( 2, 4, &chunkMap );
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo(0, 4, false);
+            info["shard0"].setOpsPerSec( 1000 );
+            info["shard1"] = ShardInfo(0, 4, false);
+
+            DistributionStatus status(info, chunkMap.map());
+            boost::scoped_ptr<MigrateInfo> byCount(BalancerPolicy::balance( "ns", status, 1 ));
+            ASSERT( !byCount );
+
+            status.setShardDataSize( "shard0", 400 );
+            status.setShardDataSize( "shard1", 400 );
+            status.useCostModel( BalancerCostModel() );
+
+            boost::scoped_ptr<MigrateInfo> c(BalancerPolicy::balance( "ns", status, 1 ));
+            ASSERT( c );
+            ASSERT_EQUALS( "shard0", c->from );
+            ASSERT_EQUALS( "shard1", c->to );
+        }
+
+        TEST( BalancerPolicyTests , BalanceByCostMovesOffLargeShard ) {
+            // same number of chunks, but shard0's chunks are much bigger; the biggest chunk which
+            // doesn't overshoot moves
+            OwnedShardToChunksMap chunkMap;
+            makeEvenChunks( 2, 4, &chunkMap );
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo(0, 4, false);
+            info["shard1"] = ShardInfo(0, 4, false);
+
+            DistributionStatus status(info, chunkMap.map());
+            status.setShardDataSize( "shard0", 1000 );
+            status.setShardDataSize( "shard1", 100 );
+            status.setChunkDataSize( BSON("x" << 0), 850 );
+            status.setChunkDataSize( BSON("x" << 10), 50 );
+            status.setChunkDataSize( BSON("x" << 20), 300 );
+            status.useCostModel( BalancerCostModel() );
+
+            boost::scoped_ptr<MigrateInfo> c(BalancerPolicy::balance( "ns", status, 1 ));
+            ASSERT( c );
+            ASSERT_EQUALS( "shard0", c->from );
+            ASSERT_EQUALS( BSON("x" << 20), c->chunk.min );
+        }
+
+        TEST( BalancerPolicyTests , BalanceByCostBalanced ) {
+            OwnedShardToChunksMap chunkMap;
+            makeEvenChunks( 2, 4, &chunkMap );
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo(0, 4, false);
+            info["shard0"].setOpsPerSec( 105 );
+            info["shard1"] = ShardInfo(0, 4, false);
+            info["shard1"].setOpsPerSec( 95 );
+
+            DistributionStatus status(info, chunkMap.map());
+            status.setShardDataSize( "shard0", 410 );
+            status.setShardDataSize( "shard1", 390 );
+            status.useCostModel( BalancerCostModel() );
+
+            boost::scoped_ptr<MigrateInfo> c(BalancerPolicy::balance( "ns", status, 1 ));
+            ASSERT( !c );
+        }
+
         TEST( BalancerPolicyTests , BalanceJumbo  ) {
             // 2 chunks and 0 chunk shards
             OwnedShardToChunksMap chunkMap;
@@ -42,6 +42,7 @@
 #include "mongo/db/lasterror.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/key_string.h"
 #include "mongo/platform/random.h"
 #include "mongo/s/balancer_policy.h"
 #include "mongo/s/chunk_diff.h"
@@ -808,9 +809,11 @@ namespace mongo {
             ChunkMap chunkMap;
             set<Shard> shards;
             ShardVersionMap shardVersions;
+            vector<ChunkPtr> changedChunks;
             Timer t;
 
-            bool success = _load(config, chunkMap, shards, shardVersions, oldManager);
+            bool success = _load(config, chunkMap, shards, shardVersions, &changedChunks,
+                                 oldManager);
 
             if( success ){
                 {
@@ -831,7 +834,21 @@ namespace mongo {
                     const_cast<ChunkMap&>(_chunkMap).swap(chunkMap);
                     const_cast<set<Shard>&>(_shards).swap(shards);
                     const_cast<ShardVersionMap&>(_shardVersions).swap(shardVersions);
-                    const_cast<ChunkRangeManager&>(_chunkRanges).reloadAll(_chunkMap);
+
+                    // When we only applied a diff over the old chunks, the old ranges remain
+                    // valid everywhere but around the chunks the diff touched
+                    ChunkRangeManager& chunkRanges = const_cast<ChunkRangeManager&>(_chunkRanges);
+                    if (oldManager && oldManager->getVersion().isSet() && !_chunkMap.empty()) {
+                        chunkRanges.reloadChanged(oldManager->_chunkRanges,
+                                                  _chunkMap,
+                                                  changedChunks);
+                    }
+                    else {
+                        chunkRanges.reloadAll(_chunkMap);
+                    }
+
+                    const_cast<ChunkRoutingTable&>(_routingTable).reloadAll(
+                            _chunkMap, _keyPattern.isHashedPattern());
 
                     return;
                 }
@@ -857,10 +874,13 @@ namespace mongo {
      * differently
      *
      * The mongos adapter here tracks all shards, and stores ranges by (max, Chunk) in the map.
+     * Every chunk built from a diff is also remembered in 'newChunks', so the chunk ranges can be
+     * updated incrementally.
      */
     class CMConfigDiffTracker : public ConfigDiffTracker<ChunkPtr, std::string> {
     public:
-        CMConfigDiffTracker( ChunkManager* manager ) : _manager( manager ) {}
+        CMConfigDiffTracker( ChunkManager* manager, vector<ChunkPtr>* newChunks )
+            : _manager( manager ), _newChunks( newChunks ) {}
 
         virtual bool isTracked( const BSONObj& chunkDoc ) const {
             // Mongos tracks all shards
@@ -875,6 +895,7 @@ namespace mongo {
 
         virtual pair<BSONObj,ChunkPtr> rangeFor( const BSONObj& chunkDoc, const BSONObj& min, const BSONObj& max ) const {
             ChunkPtr c( new Chunk( _manager, chunkDoc ) );
+            _newChunks->push_back( c );
             return make_pair( max, c );
         }
 
@@ -884,6 +905,7 @@ namespace mongo {
         }
 
         ChunkManager* _manager;
+        vector<ChunkPtr>* _newChunks;
 
     };
 
@@ -891,6 +913,7 @@ namespace mongo {
                              ChunkMap& chunkMap,
                              set<Shard>& shards,
                              ShardVersionMap& shardVersions,
+                             vector<ChunkPtr>* changedChunks,
                              const ChunkManager* oldManager)
     {
 
@@ -922,7 +945,8 @@ namespace mongo {
 
                 c->setBytesWritten( oldC->getBytesWritten() );
 
-                chunkMap.insert( make_pair( oldC->getMax(), c ) );
+                // The old map is already sorted, so hint the insert at the end
+                chunkMap.insert( chunkMap.end(), make_pair( oldC->getMax(), c ) );
             }
 
             LOG(2) << "loading chunk manager for collection " << _ns
@@ -931,7 +955,7 @@ namespace mongo {
         }
 
         // Attach a diff tracker for the versioned chunk data
-        CMConfigDiffTracker differ( this );
+        CMConfigDiffTracker differ( this, changedChunks );
         differ.attach( _ns, chunkMap, _version, shardVersions );
 
         // Diff tracker should *always* find at least one chunk if collection exists
@@ -1140,6 +1164,15 @@ namespace mongo {
     }
 
     ChunkPtr ChunkManager::findIntersectingChunk( const BSONObj& shardKey ) const {
+        {
+            ChunkPtr routed = _routingTable.findChunk( shardKey );
+            if ( routed && routed->containsKey( shardKey ) ) {
+                return routed;
+            }
+        }
+
+        // The routing table is empty, or the key compares differently as BSON than its encoding
+        // (see KeyString), so search the chunk map itself
         {
             BSONObj chunkMin;
             ChunkPtr chunk;
@@ -1172,6 +1205,22 @@ namespace mongo {
                                    << ", number of chunks: " << _chunkMap.size() );
     }
 
+    void ChunkManager::findIntersectingChunks( const vector<BSONObj>& shardKeys,
+                                               vector<ChunkPtr>* chunks ) const {
+        _routingTable.findChunks( shardKeys, chunks );
+
+        for ( size_t i = 0; i < shardKeys.size(); ++i ) {
+            if ( shardKeys[i].isEmpty() ) {
+                continue;
+            }
+
+            ChunkPtr& chunk = ( *chunks )[i];
+            if ( !chunk || !chunk->containsKey( shardKeys[i] ) ) {
+                chunk = findIntersectingChunk( shardKeys[i] );
+            }
+        }
+    }
+
     void ChunkManager::getShardsForQuery( set<Shard>& shards , const BSONObj& query ) const {
         CanonicalQuery* canonicalQuery = NULL;
         Status status = CanonicalQuery::canonicalize(
@@ -1258,13 +1307,21 @@ namespace mongo {
 
         // Consider shard key as an index
         string accessMethod = IndexNames::findPluginName(key);
-        dassert(accessMethod == IndexNames::BTREE || accessMethod == IndexNames::HASHED);
+        dassert(accessMethod == IndexNames::BTREE || accessMethod == IndexNames::HASHED
+                || accessMethod == IndexNames::GEO_2DSPHERE);
+
+        // A geo shard key is the key of a 2dsphere index, whose bounds for a geo predicate are
+        // the covering of its region
+        BSONObj infoObj;
+        if (accessMethod == IndexNames::GEO_2DSPHERE) {
+            infoObj = ShardKeyPattern(key).getGeoIndexInfo();
+        }
 
         // Use query framework to generate index bounds
         QueryPlannerParams plannerParams;
         // Must use "shard key" index
         plannerParams.options = QueryPlannerParams::NO_TABLE_SCAN;
-        IndexEntry indexEntry(key, accessMethod, false /* multiKey */, false /* sparse */, "shardkey", BSONObj());
+        IndexEntry indexEntry(key, accessMethod, false /* multiKey */, false /* sparse */, "shardkey", infoObj);
         plannerParams.indices.push_back(indexEntry);
 
         OwnedPointerVector<QuerySolution> solutions;
@@ -1479,7 +1536,7 @@ namespace mongo {
         return ss.str();
     }
 
-    void ChunkRangeManager::assertValid() const {
+    void ChunkRangeManager::assertValid(const ChunkMap& chunks) const {
         if (_ranges.empty())
             return;
 
@@ -1505,7 +1562,6 @@ namespace mongo {
             }
 
             // Make sure we match the original chunks
-            const ChunkMap chunks = _ranges.begin()->second->getManager()->_chunkMap;
             for ( ChunkMap::const_iterator i=chunks.begin(); i!=chunks.end(); ++i ) {
                 const ChunkPtr chunk = i->second;
 
@@ -1535,7 +1591,59 @@ namespace mongo {
         _ranges.clear();
         _insertRange(chunks.begin(), chunks.end());
 
-        DEV assertValid();
+        DEV assertValid(chunks);
+    }
+
+    void ChunkRangeManager::reloadChanged(const ChunkRangeManager& old,
+                                          const ChunkMap& chunks,
+                                          const vector<ChunkPtr>& changed) {
+        if (old._ranges.empty()) {
+            reloadAll(chunks);
+            return;
+        }
+
+        // Only copies the pointers, the ranges themselves are shared
+        _ranges = old._ranges;
+
+        // Find every range overlapping a changed chunk. Its neighbours are rebuilt as well, since
+        // the changed chunks may now live on the same shard and coalesce with them.
+        set<BSONObj, BSONObjCmp> dirty;
+        for (vector<ChunkPtr>::const_iterator it = changed.begin(); it != changed.end(); ++it) {
+            ChunkRangeMap::iterator first = _ranges.upper_bound((*it)->getMin());
+            ChunkRangeMap::iterator last = _ranges.lower_bound((*it)->getMax());
+            verify(first != _ranges.end());
+            verify(last != _ranges.end());
+
+            if (first != _ranges.begin())
+                --first;
+            if (++last != _ranges.end())
+                ++last;
+
+            for (; first != last; ++first) {
+                dirty.insert(first->first);
+            }
+        }
+
+        // Rebuild each run of adjacent dirty ranges from the new chunks. The ends of a run are
+        // ends of unchanged ranges, so they are chunk boundaries in both versions.
+        set<BSONObj, BSONObjCmp>::const_iterator d = dirty.begin();
+        while (d != dirty.end()) {
+            ChunkRangeMap::iterator first = _ranges.find(*d);
+            verify(first != _ranges.end());
+
+            ChunkRangeMap::iterator last = first;
+            for (++d, ++last; d != dirty.end() && last != _ranges.end() && last->first == *d;
+                 ++d, ++last) {
+            }
+
+            const BSONObj min = first->second->getMin();
+            const BSONObj max = boost::prior(last)->second->getMax();
+            _ranges.erase(first, last);
+
+            _insertRange(chunks.upper_bound(min), chunks.upper_bound(max));
+        }
+
+        DEV assertValid(chunks);
     }
 
     void ChunkRangeManager::_insertRange(ChunkMap::const_iterator begin, const ChunkMap::const_iterator end) {
@@ -1550,6 +1658,135 @@ namespace mongo {
         }
     }
 
+    void ChunkRoutingTable::clear() {
+        _chunks.clear();
+        _hashed = false;
+        _hashedMaxes.clear();
+        _encodedMaxes.clear();
+        _offsets.clear();
+    }
+
+    void ChunkRoutingTable::reloadAll(const ChunkMap& chunks, bool hashedShardKey) {
+        clear();
+        if (chunks.empty())
+            return;
+
+        _chunks.reserve(chunks.size());
+        for (ChunkMap::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+            _chunks.push_back(it->second);
+        }
+
+        // Hashes can only be compared raw if every inner boundary is one
+        _hashed = hashedShardKey;
+        if (_hashed) {
+            _hashedMaxes.reserve(chunks.size() - 1);
+            for (size_t i = 0; _hashed && i + 1 < _chunks.size(); ++i) {
+                const BSONObj& max = _chunks[i]->getMax();
+                if (max.nFields() != 1 || max.firstElement().type() != NumberLong) {
+                    _hashed = false;
+                    break;
+                }
+                _hashedMaxes.push_back(max.firstElement()._numberLong());
+            }
+
+            if (_hashed)
+                return;
+
+            _hashedMaxes.clear();
+        }
+
+        // The ChunkMap compares keys with an empty ordering, which is all ascending
+        const Ordering ord = Ordering::make(BSONObj());
+
+        _offsets.reserve(_chunks.size() + 1);
+        _offsets.push_back(0);
+        for (size_t i = 0; i < _chunks.size(); ++i) {
+            _encodedMaxes += KeyString::make(_chunks[i]->getMax(), ord, DiskLoc());
+            _offsets.push_back(_encodedMaxes.size());
+        }
+    }
+
+    bool ChunkRoutingTable::_boundGreater(size_t i, const string& key) const {
+        const size_t boundSize = _offsets[i + 1] - _offsets[i];
+        const int cmp = memcmp(_encodedMaxes.data() + _offsets[i],
+                               key.data(),
+                               std::min(boundSize, key.size()));
+        return cmp > 0 || (cmp == 0 && boundSize > key.size());
+    }
+
+    int ChunkRoutingTable::_findIndex(const BSONObj& shardKey, int hint) const {
+        if (_chunks.empty())
+            return -1;
+
+        if (_hashed) {
+            if (shardKey.nFields() != 1 || shardKey.firstElement().type() != NumberLong)
+                return -1;
+
+            const long long hash = shardKey.firstElement()._numberLong();
+
+            // The chunk containing the key is the first one whose max is greater than the key
+            if (hint >= 0
+                    && (hint == 0 || _hashedMaxes[hint - 1] <= hash)
+                    && (hint == static_cast<int>(_hashedMaxes.size())
+                        || hash < _hashedMaxes[hint])) {
+                return hint;
+            }
+
+            return std::upper_bound(_hashedMaxes.begin(), _hashedMaxes.end(), hash)
+                    - _hashedMaxes.begin();
+        }
+
+        const string key = KeyString::make(shardKey, Ordering::make(BSONObj()), DiskLoc());
+
+        if (hint >= 0
+                && (hint == 0 || !_boundGreater(hint - 1, key))
+                && _boundGreater(hint, key)) {
+            return hint;
+        }
+
+        size_t low = 0;
+        size_t high = _chunks.size();
+        while (low < high) {
+            const size_t mid = low + (high - low) / 2;
+            if (_boundGreater(mid, key)) {
+                high = mid;
+            }
+            else {
+                low = mid + 1;
+            }
+        }
+
+        // Past the MaxKey bound, which only a key the encoding orders oddly can be
+        if (low == _chunks.size())
+            return -1;
+
+        return low;
+    }
+
+    ChunkPtr ChunkRoutingTable::findChunk(const BSONObj& shardKey) const {
+        const int i = _findIndex(shardKey, -1);
+        return i < 0 ? ChunkPtr() : _chunks[i];
+    }
+
+    void ChunkRoutingTable::findChunks(const vector<BSONObj>& shardKeys,
+                                       vector<ChunkPtr>* chunks) const {
+        chunks->clear();
+        chunks->resize(shardKeys.size());
+
+        int last = -1;
+        for (size_t i = 0; i < shardKeys.size(); ++i) {
+            if (shardKeys[i].isEmpty())
+                continue;
+
+            const int found = _findIndex(shardKeys[i], last);
+            if (found < 0)
+                continue;
+
+            (*chunks)[i] = _chunks[found];
+            last = found;
+        }
+    }
+
     int ChunkManager::getCurrentDesiredChunkSize() const {
         // split faster in early chunks helps spread out an initial load better
         const int minChunkSize = 1 << 20;  // 1 MBytes
@@ -281,9 +281,12 @@ namespace mongo {
         static int mkDataWritten();
     };
 
+    /**
+     * A maximal run of adjacent chunks living on the same shard. Ranges do not reference the
+     * ChunkManager that built them, so unchanged ranges can be shared between versions.
+     */
     class ChunkRange {
     public:
-        const ChunkManager* getManager() const { return _manager; }
         Shard getShard() const { return _shard; }
 
         const BSONObj& getMin() const { return _min; }
@@ -298,14 +301,12 @@ namespace mongo {
         bool containsKey( const BSONObj& shardKey ) const;
 
         ChunkRange(ChunkMap::const_iterator begin, const ChunkMap::const_iterator end)
-            : _manager(begin->second->getManager())
-            , _shard(begin->second->getShard())
+            : _shard(begin->second->getShard())
             , _min(begin->second->getMin())
             , _max(boost::prior(end)->second->getMax()) {
             verify( begin != end );
 
             DEV while (begin != end) {
-                verify(begin->second->getManager() == _manager);
                 verify(begin->second->getShard() == _shard);
                 ++begin;
             }
@@ -313,12 +314,10 @@ namespace mongo {
 
         // Merge min and max (must be adjacent ranges)
         ChunkRange(const ChunkRange& min, const ChunkRange& max)
-            : _manager(min.getManager())
-            , _shard(min.getShard())
+            : _shard(min.getShard())
             , _min(min.getMin())
             , _max(max.getMax()) {
             verify(min.getShard() == max.getShard());
-            verify(min.getManager() == max.getManager());
             verify(min.getMax() == max.getMin());
         }
 
@@ -327,7 +326,6 @@ namespace mongo {
         }
 
     private:
-        const ChunkManager* _manager;
         const Shard _shard;
         const BSONObj _min;
         const BSONObj _max;
@@ -342,8 +340,17 @@ namespace mongo {
 
         void reloadAll(const ChunkMap& chunks);
 
+        /**
+         * Builds the ranges for 'chunks', which must be the chunks 'old' was built from with
+         * 'changed' applied on top. Only the ranges overlapping a changed chunk, and their
+         * immediate neighbours, are rebuilt; all others are shared with 'old'.
+         */
+        void reloadChanged(const ChunkRangeManager& old,
+                           const ChunkMap& chunks,
+                           const std::vector<ChunkPtr>& changed);
+
         // Slow operation -- wrap with DEV
-        void assertValid() const;
+        void assertValid(const ChunkMap& chunks) const;
 
         ChunkRangeMap::const_iterator upper_bound(const BSONObj& o) const { return _ranges.upper_bound(o); }
         ChunkRangeMap::const_iterator lower_bound(const BSONObj& o) const { return _ranges.lower_bound(o); }
@@ -355,6 +362,52 @@ namespace mongo {
         ChunkRangeMap _ranges;
     };
 
+    /**
+     * A flattened copy of the chunk boundaries, which findIntersectingChunk() binary searches
+     * instead of the ChunkMap. The max of every chunk is kept in one contiguous buffer, as a
+     * KeyString encoding or, when the shard key is hashed, as the raw hash, so that a lookup
+     * compares bytes over a few cache lines rather than BSON elements over the map's nodes.
+     */
+    class ChunkRoutingTable {
+    public:
+        ChunkRoutingTable() : _hashed(false) {}
+
+        void clear();
+
+        void reloadAll(const ChunkMap& chunks, bool hashedShardKey);
+
+        /**
+         * @return the chunk which should contain shardKey, or a NULL ChunkPtr when the table is
+         *         empty or can't route a key of this shape; the caller then uses the ChunkMap.
+         */
+        ChunkPtr findChunk(const BSONObj& shardKey) const;
+
+        /**
+         * Routes a batch of keys, where neighbouring keys often live in the same chunk. Empty
+         * keys, and those findChunk() can't route, get a NULL ChunkPtr.
+         */
+        void findChunks(const std::vector<BSONObj>& shardKeys,
+                        std::vector<ChunkPtr>* chunks) const;
+
+    private:
+        // index of the chunk for the key, or -1
+        int _findIndex(const BSONObj& shardKey, int hint) const;
+
+        bool _boundGreater(size_t i, const std::string& key) const;
+
+        // parallel to the ChunkMap, ordered by max
+        std::vector<ChunkPtr> _chunks;
+
+        bool _hashed;
+
+        // hashed shard keys: the max of every chunk but the last one, which is MaxKey
+        std::vector<long long> _hashedMaxes;
+
+        // otherwise: the encoded max of chunk i is _encodedMaxes[_offsets[i], _offsets[i+1])
+        std::string _encodedMaxes;
+        std::vector<size_t> _offsets;
+    };
+
     /* config.sharding
          { ns: 'alleyinsider.fs.chunks' ,
            key: { ts : 1 } ,
@@ -420,6 +473,13 @@ namespace mongo {
          */
         ChunkPtr findIntersectingChunk( const BSONObj& shardKey ) const;
 
+        /**
+         * Same as findIntersectingChunk() for each of a batch of shard keys; an empty key gets a
+         * NULL ChunkPtr.
+         */
+        void findIntersectingChunks( const std::vector<BSONObj>& shardKeys,
+                                     std::vector<ChunkPtr>* chunks ) const;
+
         void getShardsForQuery( std::set<Shard>& shards , const BSONObj& query ) const;
         void getAllShards( std::set<Shard>& all ) const;
         /** @param shards set to the shards covered by the interval [min, max], see SERVER-4791 */
@@ -480,6 +540,7 @@ namespace mongo {
                    ChunkMap& chunks,
                    std::set<Shard>& shards,
                    ShardVersionMap& shardVersions,
+                   std::vector<ChunkPtr>* changedChunks,
                    const ChunkManager* oldManager);
         static bool _isValid(const ChunkMap& chunks);
 
@@ -492,6 +553,7 @@ namespace mongo {
 
         const ChunkMap _chunkMap;
         const ChunkRangeManager _chunkRanges;
+        const ChunkRoutingTable _routingTable;
 
         const std::set<Shard> _shards;
 
@@ -539,7 +601,6 @@ namespace mongo {
         //
 
         friend class Chunk;
-        friend class ChunkRangeManager; // only needed for CRM::assertValid()
         static AtomicUInt32 NextSequenceNumber;
 
         friend class TestableChunkManager;
@@ -87,6 +87,43 @@ namespace mongo {
                                                ShardEndpoint** endpoint ) const {
 
         BSONObj shardKey;
+        if ( _manager ) {
+            shardKey = _manager->getShardKeyPattern().extractShardKeyFromDoc(doc);
+        }
+        return targetInsertWithShardKey( doc, shardKey, ChunkPtr(), endpoint );
+    }
+
+    void ChunkManagerTargeter::targetInserts( const std::vector<BSONObj>& docs,
+                                              std::vector<Status>* statuses,
+                                              std::vector<ShardEndpoint*>* endpoints ) const {
+
+        vector<BSONObj> shardKeys;
+        vector<ChunkPtr> chunks;
+        if ( _manager ) {
+            _manager->getShardKeyPattern().extractShardKeysFromDocs( docs, &shardKeys );
+
+            // Route the whole batch against the chunk routing table in one pass
+            _manager->findIntersectingChunks( shardKeys, &chunks );
+        }
+        else {
+            shardKeys.resize( docs.size() );
+            chunks.resize( docs.size() );
+        }
+
+        for ( size_t i = 0; i < docs.size(); ++i ) {
+            ShardEndpoint* endpoint = NULL;
+            statuses->push_back( targetInsertWithShardKey( docs[i],
+                                                           shardKeys[i],
+                                                           chunks[i],
+                                                           &endpoint ) );
+            endpoints->push_back( endpoint );
+        }
+    }
+
+    Status ChunkManagerTargeter::targetInsertWithShardKey( const BSONObj& doc,
+                                                           const BSONObj& shardKey,
+                                                           const ChunkPtr& chunk,
+                                                           ShardEndpoint** endpoint ) const {
 
         if ( _manager ) {
 
@@ -96,8 +133,6 @@ namespace mongo {
             // Inserts must contain the exact shard key.
             //
 
-            shardKey = _manager->getShardKeyPattern().extractShardKeyFromDoc(doc);
-
             // Check shard key exists
             if (shardKey.isEmpty()) {
                 return Status(ErrorCodes::ShardKeyNotFound,
@@ -114,6 +149,9 @@ namespace mongo {
 
         // Target the shard key or database primary
         if (!shardKey.isEmpty()) {
+            if (chunk) {
+                return targetChunk(chunk, doc.objsize(), endpoint);
+            }
             return targetShardKey(shardKey, doc.objsize(), endpoint);
         }
         else {
@@ -389,7 +427,13 @@ namespace mongo {
                                                 ShardEndpoint** endpoint) const {
         invariant(NULL != _manager);
 
-        ChunkPtr chunk = _manager->findIntersectingChunk(shardKey);
+        return targetChunk(_manager->findIntersectingChunk(shardKey), estDataSize, endpoint);
+    }
+
+    Status ChunkManagerTargeter::targetChunk(const ChunkPtr& chunk,
+                                             long long estDataSize,
+                                             ShardEndpoint** endpoint) const {
+        invariant(NULL != _manager);
 
         // Track autosplit stats for sharded collections
         // Note: this is only best effort accounting and is not accurate.
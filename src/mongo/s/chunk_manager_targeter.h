@@ -65,6 +65,11 @@ namespace mongo {
         // Returns ShardKeyNotFound if document does not have a full shard key.
         Status targetInsert( const BSONObj& doc, ShardEndpoint** endpoint ) const;
 
+        // Extracts the shard keys of the whole batch at once, hashing them together.
+        void targetInserts( const std::vector<BSONObj>& docs,
+                            std::vector<Status>* statuses,
+                            std::vector<ShardEndpoint*>* endpoints ) const;
+
         // Returns ShardKeyNotFound if the update can't be targeted without a shard key.
         Status targetUpdate( const BatchedUpdateDocument& updateDoc,
                              std::vector<ShardEndpoint*>* endpoints ) const;
@@ -135,10 +140,25 @@ namespace mongo {
          * Also has the side effect of updating the chunks stats with an estimate of the amount of
          * data targeted at this shard key.
          */
+        /**
+         * Returns the ShardEndpoint for an insert of 'doc', whose shard key, when the collection
+         * is sharded, has been extracted as 'shardKey'. If the chunk owning 'shardKey' is
+         * already known it is passed as 'chunk', otherwise 'chunk' is NULL.
+         */
+        Status targetInsertWithShardKey(const BSONObj& doc,
+                                        const BSONObj& shardKey,
+                                        const ChunkPtr& chunk,
+                                        ShardEndpoint** endpoint) const;
+
         Status targetShardKey(const BSONObj& doc,
                               long long estDataSize,
                               ShardEndpoint** endpoint) const;
 
+        // Same as targetShardKey(), once the chunk owning the shard key has been found
+        Status targetChunk(const ChunkPtr& chunk,
+                           long long estDataSize,
+                           ShardEndpoint** endpoint) const;
+
         NamespaceString _nss;
 
         // Zero or one of these are filled at all times
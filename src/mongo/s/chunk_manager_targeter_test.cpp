@@ -529,4 +529,41 @@ namespace {
         CheckBoundList(list, expectedList);
     }
 
+    static bool boundListContains(const BoundList& list, const BSONObj& shardKey) {
+        for (BoundList::const_iterator it = list.begin(); it != list.end(); ++it) {
+            if (it->first.woCompare(shardKey) <= 0 && shardKey.woCompare(it->second) <= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // A geo predicate on a geo shard key targets the cells of its covering
+    TEST(CMKeyBoundsTest, GeoShardKey) {
+        ShardKeyPattern skeyPattern(fromjson("{loc: '2dsphere'}"));
+        auto_ptr<CanonicalQuery> query(canonicalize("{loc: {$geoWithin: {$geometry: "
+                "{type: 'Polygon', coordinates: [[[0, 0], [0, 1], [1, 1], [1, 0], [0, 0]]]}}}}"));
+
+        IndexBounds indexBounds =
+            ChunkManager::getIndexBoundsForQuery(skeyPattern.toBSON(), query.get());
+        ASSERT_EQUALS(indexBounds.size(), 1U);
+        BoundList list = skeyPattern.flattenBounds(indexBounds);
+        ASSERT(!list.empty());
+
+        ASSERT(boundListContains(list,
+                                 skeyPattern.extractShardKeyFromDoc(fromjson("{loc: [0.5, 0.5]}"))));
+        ASSERT(boundListContains(list,
+                                 skeyPattern.extractShardKeyFromDoc(fromjson("{loc: [0.01, 0.99]}"))));
+        ASSERT(!boundListContains(list,
+                                  skeyPattern.extractShardKeyFromDoc(fromjson("{loc: [50, 50]}"))));
+        ASSERT(!boundListContains(list, skeyPattern.getKeyPattern().globalMin()));
+
+        // Without a geo predicate every shard is targeted
+        query.reset(canonicalize("{x: 1}"));
+        indexBounds = ChunkManager::getIndexBoundsForQuery(skeyPattern.toBSON(), query.get());
+        list = skeyPattern.flattenBounds(indexBounds);
+        ASSERT(boundListContains(list, skeyPattern.getKeyPattern().globalMin()));
+        ASSERT(boundListContains(list, skeyPattern.getKeyPattern().globalMax()));
+    }
+
 } // end namespace
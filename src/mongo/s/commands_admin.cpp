@@ -41,10 +41,13 @@
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/privilege.h"
+#include "mongo/db/client_basic.h"
 #include "mongo/db/commands/shutdown.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/field_parser.h"
 #include "mongo/db/hasher.h"
+#include "mongo/db/index/expression_params.h"
+#include "mongo/db/index/s2_common.h"
 #include "mongo/db/index_names.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/lasterror.h"
@@ -70,6 +73,7 @@
 #include "mongo/util/log.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
 #include "mongo/util/stringutils.h"
@@ -448,7 +452,12 @@ namespace mongo {
             virtual void help( stringstream& help ) const {
                 help
                         << "Shard a collection.  Requires key.  Optional unique. Sharding must already be enabled for the database.\n"
-                        << "  { enablesharding : \"<dbname>\" }\n";
+                        << "  { enablesharding : \"<dbname>\" }\n"
+                        << "An empty collection is split into chunks spread over the shards with\n"
+                        << "  numInitialChunks : <n> for a hashed key,\n"
+                        << "  splitPoints : [ <key>, ... ] for a range key, or\n"
+                        << "  sampleKeys : [ <key or doc>, ... ] for a range key, split into\n"
+                        << "    numInitialChunks chunks of about as many samples each\n";
             }
             virtual Status checkAuthForCommand(ClientBasic* client,
                                                const std::string& dbname,
@@ -464,6 +473,46 @@ namespace mongo {
             virtual std::string parseNs(const std::string& dbname, const BSONObj& cmdObj) const {
                 return parseNsFullyQualified(dbname, cmdObj);
             }
+
+            /**
+             * Reads the shard keys of the array 'keysElt' into 'keys', sorted and without
+             * duplicates.  With 'extract', the elements may be whole documents.
+             */
+            static Status parseShardKeys(const ShardKeyPattern& keyPattern,
+                                         const BSONElement& keysElt,
+                                         bool extract,
+                                         vector<BSONObj>* keys) {
+                if (Array != keysElt.type()) {
+                    return Status(ErrorCodes::BadValue,
+                                  str::stream() << keysElt.fieldName() << " must be an array");
+                }
+
+                BSONObjIterator it(keysElt.embeddedObject());
+                while (it.more()) {
+                    BSONElement elt = it.next();
+                    if (Object != elt.type()) {
+                        return Status(ErrorCodes::BadValue,
+                                      str::stream() << keysElt.fieldName()
+                                                    << " must only hold objects, not " << elt);
+                    }
+
+                    BSONObj key = extract
+                        ? keyPattern.extractShardKeyFromDoc(elt.embeddedObject())
+                        : keyPattern.normalizeShardKey(elt.embeddedObject());
+                    if (key.isEmpty()) {
+                        return Status(ErrorCodes::BadValue,
+                                      str::stream() << elt.embeddedObject() << " in "
+                                                    << keysElt.fieldName() << " has no shard key "
+                                                    << keyPattern.toBSON());
+                    }
+                    keys->push_back(key.getOwned());
+                }
+
+                std::sort(keys->begin(), keys->end());
+                keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+                return Status::OK();
+            }
+
             bool run(OperationContext* txn, const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
                 const string ns = parseNs(dbname, cmdObj);
                 if ( ns.size() == 0 ) {
@@ -499,8 +548,8 @@ namespace mongo {
                 ShardKeyPattern proposedKeyPattern(proposedKey);
                 if (!proposedKeyPattern.isValid()) {
                     errmsg = str::stream() << "Unsupported shard key pattern.  Pattern must"
-                                           << " either be a single hashed field, or a list"
-                                           << " of ascending fields.";
+                                           << " either be a single hashed or 2dsphere field,"
+                                           << " or a list of ascending fields.";
                     return false;
                 }
 
@@ -516,11 +565,56 @@ namespace mongo {
                     return false;
                 }
 
+                bool isGeoShardKey = proposedKeyPattern.isGeoPattern();
+
+                if (isGeoShardKey && cmdObj["unique"].trueValue()) {
+                    // many points share the cell id of a geo shard key
+                    errmsg = "2dsphere shard keys cannot be declared unique.";
+                    return false;
+                }
+
                 if ( ns.find( ".system." ) != string::npos ) {
                     errmsg = "can't shard system namespaces";
                     return false;
                 }
 
+                // Range shard keys are pre-split at the given points, or at points which split
+                // the given sample of keys evenly.
+                vector<BSONObj> rangeSplits;
+                vector<BSONObj> sampleKeys;
+                const bool hasSplitPoints = cmdObj.hasField("splitPoints");
+                const bool hasSampleKeys = cmdObj.hasField("sampleKeys");
+                if (hasSplitPoints || hasSampleKeys) {
+                    if (isHashedShardKey || isGeoShardKey) {
+                        errmsg = "splitPoints and sampleKeys are only for range shard keys, "
+                                 "use numInitialChunks to pre-split a hashed shard key";
+                        return false;
+                    }
+                    if (hasSplitPoints && hasSampleKeys) {
+                        errmsg = "can't give both splitPoints and sampleKeys";
+                        return false;
+                    }
+
+                    Status status = hasSplitPoints
+                        ? parseShardKeys(proposedKeyPattern, cmdObj["splitPoints"], false,
+                                         &rangeSplits)
+                        : parseShardKeys(proposedKeyPattern, cmdObj["sampleKeys"], true,
+                                         &sampleKeys);
+                    if (!status.isOK()) {
+                        errmsg = status.reason();
+                        return false;
+                    }
+
+                    // The ends of the key space are already chunk boundaries.
+                    const KeyPattern& keyPattern = proposedKeyPattern.getKeyPattern();
+                    if (!rangeSplits.empty()
+                        && (rangeSplits.front().woCompare(keyPattern.globalMin()) == 0
+                            || rangeSplits.back().woCompare(keyPattern.globalMax()) == 0)) {
+                        errmsg = "splitPoints can't hold the lowest or highest possible key";
+                        return false;
+                    }
+                }
+
                 if ( ! okForConfigChanges( errmsg ) )
                     return false;
 
@@ -614,10 +708,39 @@ namespace mongo {
                             return false;
                         }
 
+                        // The keys of a geo shard key index must be the geo shard keys
+                        if (isGeoShardKey) {
+                            S2IndexingParams indexParams;
+                            ExpressionParams::parse2dsphereParams(idx, &indexParams);
+                            S2IndexingParams keyParams;
+                            ExpressionParams::parse2dsphereParams(
+                                proposedKeyPattern.getGeoIndexInfo(), &keyParams);
+
+                            if (indexParams.finestIndexedLevel != keyParams.finestIndexedLevel
+                                || indexParams.coarsestIndexedLevel
+                                    != keyParams.coarsestIndexedLevel) {
+                                errmsg = str::stream()
+                                        << "can't shard collection " << ns << " with 2dsphere"
+                                        << " shard key " << proposedKey << " because the 2dsphere"
+                                        << " index uses non-default indexed levels";
+                                conn.done();
+                                return false;
+                            }
+                        }
+
                         hasUsefulIndexForKey = true;
                     }
                 }
 
+                // 2dsphere indexes leave out documents without a geometry, so an index can't
+                // show all the existing documents have a point for the shard key.
+                if (isGeoShardKey && conn->count(ns) != 0) {
+                    errmsg = str::stream() << "can't shard non-empty collection " << ns
+                                           << " with 2dsphere shard key " << proposedKey;
+                    conn.done();
+                    return false;
+                }
+
                 // 3. If proposed key is required to be unique, additionally check for exact match.
                 bool careAboutUnique = cmdObj["unique"].trueValue();
                 if ( hasUsefulIndexForKey && careAboutUnique ) {
@@ -692,10 +815,19 @@ namespace mongo {
 
                 conn.done();
 
+                if ((hasSplitPoints || hasSampleKeys) && !isEmpty) {
+                    errmsg = str::stream() << "can't pre-split non-empty collection " << ns
+                                           << ", splitPoints and sampleKeys are for "
+                                           << "collections about to be loaded";
+                    return false;
+                }
+
                 // Pre-splitting:
                 // For new collections which use hashed shard keys, we can can pre-split the
                 // range of possible hashes into a large number of chunks, and distribute them
-                // evenly at creation time. Until we design a better initialization scheme, the
+                // evenly at creation time.  Range shard keys are pre-split the same way, at the
+                // split points given, or at points taken from a sample of the keys to be loaded.
+                // Until we design a better initialization scheme, the
                 // safest way to pre-split is to
                 // 1. make one big chunk for each shard
                 // 2. move them one at a time
@@ -734,16 +866,40 @@ namespace mongo {
                         current += intervalSize;
                     }
                     sort( allSplits.begin() , allSplits.end() );
+                }
+                else if (!sampleKeys.empty()) {
+                    int numChunks = cmdObj["numInitialChunks"].numberInt();
+                    if ( numChunks <= 0 )
+                        numChunks = 2*numShards;  // default number of initial chunks
 
-                    // 1. the initial splits define the "big chunks" that we will subdivide later
-                    int lastIndex = -1;
-                    for ( int i = 1; i < numShards; i++ ){
-                        if ( lastIndex < (i*numChunks)/numShards - 1 ){
-                            lastIndex = (i*numChunks)/numShards - 1;
-                            initSplits.push_back( allSplits[ lastIndex ] );
+                    // Each chunk gets about as many of the samples.  Samples are unique, so the
+                    // points are increasing, but the first might be the lowest sample.
+                    const size_t numSamples = sampleKeys.size();
+                    for (int i = 1; i < numChunks; i++) {
+                        const BSONObj& point = sampleKeys[(i * numSamples) / numChunks];
+                        if (point.woCompare(sampleKeys.front()) == 0
+                            || (!allSplits.empty() && point.woCompare(allSplits.back()) == 0)) {
+                            continue;
                         }
+                        allSplits.push_back(point);
                     }
                 }
+                else {
+                    allSplits = rangeSplits;
+                }
+
+                // 1. the initial splits define the "big chunks" that we will subdivide later
+                const int numChunks = allSplits.size() + 1;
+                int lastIndex = -1;
+                for ( int i = 1; i < numShards; i++ ){
+                    if ( lastIndex < (i*numChunks)/numShards - 1 ){
+                        lastIndex = (i*numChunks)/numShards - 1;
+                        initSplits.push_back( allSplits[ lastIndex ] );
+                    }
+                }
+
+                // Hashed shard keys are always spread over the shards, when empty.
+                const bool distribute = isEmpty && (isHashedShardKey || !allSplits.empty());
 
                 LOG(0) << "CMD: shardcollection: " << cmdObj << endl;
 
@@ -759,8 +915,8 @@ namespace mongo {
 
                 result << "collectionsharded" << ns;
 
-                // only initially move chunks when using a hashed shard key
-                if (isHashedShardKey && isEmpty) {
+                // only initially move chunks when pre-splitting
+                if (distribute) {
 
                     // Reload the new config info.  If we created more than one initial chunk, then
                     // we need to move them around to balance.
@@ -1579,6 +1735,7 @@ namespace mongo {
                 // compiled for.
                 result.append("maxWireVersion", maxWireVersion);
                 result.append("minWireVersion", minWireVersion);
+                negotiateMessageCompression(cmdObj, ClientBasic::getCurrent()->port(), &result);
 
                 return true;
             }
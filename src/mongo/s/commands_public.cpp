@@ -52,6 +52,8 @@
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/query/lite_parsed_query.h"
+#include "mongo/db/query/query_shape_stats.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/s/client_info.h"
 #include "mongo/s/cluster_explain.h"
@@ -527,6 +529,57 @@ namespace mongo {
             }
         } validateCmd;
 
+        class QueryShapeStatsCmd : public AllShardsCollectionCommand {
+        public:
+            QueryShapeStatsCmd() :  AllShardsCollectionCommand("queryShapeStats") {}
+            virtual void addRequiredPrivileges(const std::string& dbname,
+                                               const BSONObj& cmdObj,
+                                               std::vector<Privilege>* out) {
+                ActionSet actions;
+                actions.addAction(ActionType::planCacheRead);
+                if (cmdObj["clear"].trueValue()) {
+                    actions.addAction(ActionType::planCacheWrite);
+                }
+                out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+            }
+
+            // Merges the entries of each shard for the same shape
+            virtual void aggregateResults(const vector<BSONObj>& results, BSONObjBuilder& output) {
+                std::map<PlanCacheKey, QueryShapeStatsEntry> merged;
+                for (vector<BSONObj>::const_iterator it(results.begin()), end(results.end()); it!=end; it++){
+                    BSONObjIterator shapes(it->getObjectField("shapes"));
+                    while (shapes.more()) {
+                        const BSONElement shape = shapes.next();
+                        QueryShapeStatsEntry entry;
+                        Status status = Object == shape.type()
+                            ? QueryShapeStatsEntry::parse(shape.Obj(), &entry)
+                            : Status(ErrorCodes::BadValue, "query shape statistics not an object");
+                        if (!status.isOK()) {
+                            warning() << "queryShapeStats: skipping shard entry: " << status;
+                            continue;
+                        }
+
+                        QueryShapeStatsEntry& total = merged[entry.key];
+                        total.key = entry.key;
+                        total.merge(entry);
+                    }
+                }
+
+                vector<QueryShapeStatsEntry> entries;
+                for (std::map<PlanCacheKey, QueryShapeStatsEntry>::const_iterator it = merged.begin();
+                     it != merged.end(); ++it) {
+                    entries.push_back(it->second);
+                }
+                QueryShapeStatsEntry::sortByTotalTime(&entries);
+
+                BSONArrayBuilder shapesBob(output.subarrayStart("shapes"));
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    shapesBob.append(entries[i].toBSON());
+                }
+                shapesBob.doneFast();
+            }
+        } queryShapeStatsCmd;
+
         class RepairDatabaseCmd : public RunOnAllShardsCommand {
         public:
             RepairDatabaseCmd() :  RunOnAllShardsCommand("repairDatabase") {}
@@ -926,6 +979,10 @@ namespace mongo {
                     countCmdBuilder.append(cmdObj["hint"]);
                 }
 
+                if (cmdObj.hasField("approx")) {
+                    countCmdBuilder.append(cmdObj["approx"]);
+                }
+
                 if (cmdObj.hasField("$queryOptions")) {
                     countCmdBuilder.append(cmdObj["$queryOptions"]);
                 }
@@ -2246,6 +2303,11 @@ namespace mongo {
             void uassertAllShardsSupportExplain(
                 const vector<Strategy::CommandResult>& shardResults);
 
+            Shard pickMergeShard(DBConfigPtr conf,
+                                 const string& fullns,
+                                 const vector<Strategy::CommandResult>& shardResults,
+                                 bool hasOut);
+
             void noCursorFallback(intrusive_ptr<Pipeline> shardPipeline,
                                   intrusive_ptr<Pipeline> mergePipeline,
                                   const string& dbname,
@@ -2273,6 +2335,10 @@ namespace mongo {
 
         /* -------------------- PipelineCommand ----------------------------- */
 
+        // Merge sharded aggregations on the targeted shard owning the most chunks of the
+        // collection rather than always on the database's primary shard
+        MONGO_EXPORT_SERVER_PARAMETER(aggMergeOnShardWithMostChunks, bool, false);
+
         static const PipelineCommand pipelineCommand;
 
         PipelineCommand::PipelineCommand():
@@ -2384,9 +2450,11 @@ namespace mongo {
                 outputNsOrEmpty = out->getOutputNs().ns();
             }
 
-            // Run merging command on primary shard of database. Need to use ShardConnection so
-            // that the merging mongod is sent the config servers on connection init.
-            const string mergeServer = conf->getPrimary().getConnString();
+            // Run merging command on a shard, by default the primary shard of the database. Need
+            // to use ShardConnection so that the merging mongod is sent the config servers on
+            // connection init.
+            const string mergeServer =
+                pickMergeShard(conf, fullns, shardResults, !outputNsOrEmpty.empty()).getConnString();
             ShardConnection conn(mergeServer, outputNsOrEmpty);
             BSONObj mergedResults = aggRunCommand(conn.get(),
                                                   dbName,
@@ -2412,6 +2480,46 @@ namespace mongo {
             return ok;
         }
 
+        Shard PipelineCommand::pickMergeShard(DBConfigPtr conf,
+                                              const string& fullns,
+                                              const vector<Strategy::CommandResult>& shardResults,
+                                              bool hasOut) {
+            const Shard primary = conf->getPrimary();
+
+            // $out writes to an unsharded collection, which lives on the primary shard
+            if (!aggMergeOnShardWithMostChunks || hasOut)
+                return primary;
+
+            ChunkManagerPtr manager = conf->getChunkManagerIfExists(fullns);
+            if (!manager)
+                return primary;
+
+            map<Shard, int> chunksPerShard;
+            for (size_t i = 0; i < shardResults.size(); i++) {
+                chunksPerShard[shardResults[i].shardTarget] = 0;
+            }
+
+            const ChunkMap& chunks = manager->getChunkMap();
+            for (ChunkMap::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+                map<Shard, int>::iterator count = chunksPerShard.find(it->second->getShard());
+                if (count != chunksPerShard.end())
+                    count->second++;
+            }
+
+            // Ties go to the primary, which is where the merge would otherwise run
+            Shard best = primary;
+            int bestChunks = chunksPerShard.count(primary) ? chunksPerShard[primary] : -1;
+            for (map<Shard, int>::const_iterator it = chunksPerShard.begin();
+                 it != chunksPerShard.end(); ++it) {
+                if (it->second > bestChunks) {
+                    best = it->first;
+                    bestChunks = it->second;
+                }
+            }
+
+            return best;
+        }
+
         void PipelineCommand::uassertCanMergeInMongos(intrusive_ptr<Pipeline> mergePipeline,
                                                       BSONObj cmdObj) {
             uassert(17020, "All shards must support cursors to get a cursor back from aggregation",
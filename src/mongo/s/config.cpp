@@ -360,6 +360,8 @@ namespace mongo {
         BSONObj key;
         ChunkVersion oldVersion;
         ChunkManagerPtr oldManager;
+        NSReloadStatePtr reloadState;
+        unsigned long long seenStarted;
 
         {
             scoped_lock lk( _lock );
@@ -382,9 +384,38 @@ namespace mongo {
                 oldManager = ci.getCM();
                 oldVersion = ci.getCM()->getVersion();
             }
+
+            reloadState = _getReloadState( ns );
+            seenStarted = reloadState->started;
         }
         
         verify( ! key.isEmpty() );
+
+        // Threads which find the same namespace stale at the same time queue up here, and all
+        // but the first reuse the chunk manager it loaded instead of each querying the config
+        // servers.  Only a reload begun after we looked counts, since one already in flight may
+        // have read the config servers before the change we were told about.
+        scoped_lock reloadLock( reloadState->lock );
+
+        unsigned long long myReload;
+        {
+            scoped_lock lk( _lock );
+            CollectionInfo& ci = _collections[ns];
+            uassert( 10181 ,  (string)"not sharded:" + ns , ci.isSharded() );
+
+            if ( reloadState->completed > seenStarted ) {
+                LOG(1) << "chunk manager for " << ns << " was reloaded by another thread, "
+                       << "version is now " << ci.getCM()->getVersion() << endl;
+                return ci.getCM();
+            }
+
+            myReload = ++reloadState->started;
+
+            // a reload which was already in flight when we looked may have installed a newer
+            // chunk manager which we can diff against
+            oldManager = ci.getCM();
+            oldVersion = oldManager->getVersion();
+        }
         
         // TODO: We need to keep this first one-chunk check in until we have a more efficient way of
         // creating/reusing a chunk manager, as doing so requires copying the full set of chunks currently
@@ -403,6 +434,7 @@ namespace mongo {
                     scoped_lock lk( _lock );
                     CollectionInfo& ci = _collections[ns];
                     uassert( 15885 , str::stream() << "not sharded after reloading from chunks : " << ns , ci.isSharded() );
+                    reloadState->completed = myReload;
                     return ci.getCM();
                 }
             }
@@ -418,8 +450,6 @@ namespace mongo {
         auto_ptr<ChunkManager> temp;
 
         {
-            scoped_lock lll ( _hitConfigServerLock );
-            
             if ( ! newest.isEmpty() && ! forceReload ) {
                 // if we have a target we're going for
                 // see if we've hit already
@@ -436,6 +466,7 @@ namespace mongo {
                     if( currentVersion <= ci.getCM()->getVersion() &&
                         ci.getCM()->getVersion().hasEqualEpoch( currentVersion ) )
                     {
+                        reloadState->completed = myReload;
                         return ci.getCM();
                     }
                 }
@@ -450,6 +481,10 @@ namespace mongo {
             if ( temp->numChunks() == 0 ) {
                 // maybe we're not sharded any more
                 reload(); // this is a full reload
+                {
+                    scoped_lock lk( _lock );
+                    reloadState->completed = myReload;
+                }
                 return getChunkManager( ns , false );
             }
         }
@@ -488,11 +523,19 @@ namespace mongo {
         if ( shouldReset ){
             ci.resetCM( temp.release() );
         }
+        reloadState->completed = myReload;
         
         uassert( 15883 , str::stream() << "not sharded after chunk manager reset : " << ns , ci.isSharded() );
         return ci.getCM();
     }
 
+    DBConfig::NSReloadStatePtr DBConfig::_getReloadState( const string& ns ) {
+        NSReloadStatePtr& state = _reloadStates[ns];
+        if ( ! state )
+            state.reset( new NSReloadState() );
+        return state;
+    }
+
     void DBConfig::setPrimary( const std::string& s ) {
         scoped_lock lk( _lock );
         _primary.reset( s );
@@ -109,8 +109,7 @@ namespace mongo {
                        false /* draining */,
                        BSONArray() /* tags */),
               _shardingEnabled(false),
-              _lock("DBConfig") ,
-              _hitConfigServerLock( "DBConfig::_hitConfigServerLock" ) {
+              _lock("DBConfig") {
             verify( name.size() );
         }
         virtual ~DBConfig() {}
@@ -209,8 +208,28 @@ namespace mongo {
 
         Collections _collections;
 
+        /**
+         * Single-flights chunk manager reloads of one namespace.  Only the holder of 'lock'
+         * talks to the config servers for the namespace.  'started' and 'completed' are guarded
+         * by DBConfig::_lock: 'started' counts reloads begun, and 'completed' is the 'started'
+         * value of the last reload that installed its result.  A thread which waited for 'lock'
+         * can skip its own reload if a later reload than the one it saw completed in between.
+         */
+        struct NSReloadState {
+            NSReloadState() : lock( "DBConfig::NSReloadState" ), started( 0 ), completed( 0 ) {}
+
+            mongo::mutex lock;
+            unsigned long long started;
+            unsigned long long completed;
+        };
+        typedef boost::shared_ptr<NSReloadState> NSReloadStatePtr;
+
+        // requires _lock
+        NSReloadStatePtr _getReloadState( const std::string& ns );
+
+        std::map<std::string, NSReloadStatePtr> _reloadStates;
+
         mutable mongo::mutex _lock; // TODO: change to r/w lock ??
-        mutable mongo::mutex _hitConfigServerLock;
     };
 
     class ConfigServer : public DBConfig {
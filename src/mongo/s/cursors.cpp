@@ -47,6 +47,7 @@
 #include "mongo/db/commands.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/max_time.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/concurrency/task.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/listen.h"
@@ -55,12 +56,17 @@ namespace mongo {
 
     const int ShardedClientCursor::INIT_REPLY_BUFFER_SIZE = 32768;
 
+    // Bytes of shard replies a sharded cursor may have requested ahead of the client's getMores.
+    // 0 disables read-ahead, a negative value removes the limit.
+    MONGO_EXPORT_SERVER_PARAMETER(shardedCursorReadAheadMaxBytes, int, 16 * 1024 * 1024);
+
     // --------  ShardedCursor -----------
 
     ShardedClientCursor::ShardedClientCursor( QueryMessage& q,
                                               ParallelSortClusteredCursor * cursor ) {
         verify( cursor );
         _cursor = cursor;
+        _cursor->setReadAheadBudget( shardedCursorReadAheadMaxBytes );
 
         _skip = q.ntoskip;
         _ntoreturn = q.ntoreturn;
@@ -199,7 +205,7 @@ namespace mongo {
     }
 
     CursorCache::CursorCache()
-        :_mutex( "CursorCache" ),
+        :_randomMutex( "CursorCache random" ),
          _random( getCCRandomSeed() ),
          _shardedTotal(0) {
     }
@@ -207,22 +213,30 @@ namespace mongo {
     CursorCache::~CursorCache() {
         // TODO: delete old cursors?
         bool print = logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(1));
-        if ( _cursors.size() || _refs.size() )
+        size_t numSharded = 0;
+        size_t numRefs = 0;
+        for ( int p = 0; p < kNumPartitions; p++ ) {
+            const Partition& partition = _partitions[p];
+            verify(partition.refs.size() == partition.refsNS.size());
+            numSharded += partition.cursors.size();
+            numRefs += partition.refs.size();
+        }
+        if ( numSharded || numRefs )
             print = true;
-        verify(_refs.size() == _refsNS.size());
         
         if ( print ) 
             log() << " CursorCache at shutdown - "
-                  << " sharded: " << _cursors.size()
-                  << " passthrough: " << _refs.size()
+                  << " sharded: " << numSharded
+                  << " passthrough: " << numRefs
                   << endl;
     }
 
     ShardedClientCursorPtr CursorCache::get( long long id ) const {
         LOG(_myLogLevel) << "CursorCache::get id: " << id << endl;
-        scoped_lock lk( _mutex );
-        MapSharded::const_iterator i = _cursors.find( id );
-        if ( i == _cursors.end() ) {
+        const Partition& partition = _partitionFor( id );
+        scoped_lock lk( partition.mutex );
+        MapSharded::const_iterator i = partition.cursors.find( id );
+        if ( i == partition.cursors.end() ) {
             return ShardedClientCursorPtr();
         }
         i->second->accessed();
@@ -231,9 +245,10 @@ namespace mongo {
 
     int CursorCache::getMaxTimeMS( long long id ) const {
         verify( id );
-        scoped_lock lk( _mutex );
-        MapShardedInt::const_iterator i = _cursorsMaxTimeMS.find( id );
-        return ( i != _cursorsMaxTimeMS.end() ) ? i->second : 0;
+        const Partition& partition = _partitionFor( id );
+        scoped_lock lk( partition.mutex );
+        MapShardedInt::const_iterator i = partition.cursorsMaxTimeMS.find( id );
+        return ( i != partition.cursorsMaxTimeMS.end() ) ? i->second : 0;
     }
 
     void CursorCache::store( ShardedClientCursorPtr cursor, int maxTimeMS ) {
@@ -245,10 +260,13 @@ namespace mongo {
         verify( maxTimeMS == kMaxTimeCursorTimeLimitExpired
                 || maxTimeMS == kMaxTimeCursorNoTimeLimit
                 || maxTimeMS > 0 );
-        scoped_lock lk( _mutex );
-        _cursorsMaxTimeMS[cursor->getId()] = maxTimeMS;
-        _cursors[cursor->getId()] = cursor;
-        _shardedTotal++;
+        Partition& partition = _partitionFor( cursor->getId() );
+        {
+            scoped_lock lk( partition.mutex );
+            partition.cursorsMaxTimeMS[cursor->getId()] = maxTimeMS;
+            partition.cursors[cursor->getId()] = cursor;
+        }
+        _shardedTotal.fetchAndAdd(1);
     }
 
     void CursorCache::updateMaxTimeMS( long long id, int maxTimeMS ) {
@@ -256,53 +274,65 @@ namespace mongo {
         verify( maxTimeMS == kMaxTimeCursorTimeLimitExpired
                 || maxTimeMS == kMaxTimeCursorNoTimeLimit
                 || maxTimeMS > 0 );
-        scoped_lock lk( _mutex );
-        _cursorsMaxTimeMS[id] = maxTimeMS;
+        Partition& partition = _partitionFor( id );
+        scoped_lock lk( partition.mutex );
+        partition.cursorsMaxTimeMS[id] = maxTimeMS;
     }
 
     void CursorCache::remove( long long id ) {
         verify( id );
-        scoped_lock lk( _mutex );
-        _cursorsMaxTimeMS.erase( id );
-        _cursors.erase( id );
+        // Destroyed after the lock is released, as it may have to wait for its shard cursors
+        ShardedClientCursorPtr removed;
+        Partition& partition = _partitionFor( id );
+        scoped_lock lk( partition.mutex );
+        partition.cursorsMaxTimeMS.erase( id );
+        MapSharded::iterator i = partition.cursors.find( id );
+        if ( i != partition.cursors.end() ) {
+            removed = i->second;
+            partition.cursors.erase( i );
+        }
     }
     
     void CursorCache::removeRef( long long id ) {
         verify( id );
-        scoped_lock lk( _mutex );
-        _refs.erase( id );
-        _refsNS.erase( id );
+        Partition& partition = _partitionFor( id );
+        scoped_lock lk( partition.mutex );
+        partition.refs.erase( id );
+        partition.refsNS.erase( id );
     }
 
     void CursorCache::storeRef(const std::string& server, long long id, const std::string& ns) {
         LOG(_myLogLevel) << "CursorCache::storeRef server: " << server << " id: " << id << endl;
         verify( id );
-        scoped_lock lk( _mutex );
-        _refs[id] = server;
-        _refsNS[id] = ns;
+        Partition& partition = _partitionFor( id );
+        scoped_lock lk( partition.mutex );
+        partition.refs[id] = server;
+        partition.refsNS[id] = ns;
     }
 
     string CursorCache::getRef( long long id ) const {
         verify( id );
-        scoped_lock lk( _mutex );
-        MapNormal::const_iterator i = _refs.find( id );
+        const Partition& partition = _partitionFor( id );
+        scoped_lock lk( partition.mutex );
+        MapNormal::const_iterator i = partition.refs.find( id );
 
-        LOG(_myLogLevel) << "CursorCache::getRef id: " << id << " out: " << ( i == _refs.end() ? " NONE " : i->second ) << endl;
+        LOG(_myLogLevel) << "CursorCache::getRef id: " << id << " out: " << ( i == partition.refs.end() ? " NONE " : i->second ) << endl;
 
-        if ( i == _refs.end() )
+        if ( i == partition.refs.end() )
             return "";
         return i->second;
     }
 
     std::string CursorCache::getRefNS(long long id) const {
         verify(id);
-        scoped_lock lk(_mutex);
-        MapNormal::const_iterator i = _refsNS.find(id);
+        const Partition& partition = _partitionFor(id);
+        scoped_lock lk(partition.mutex);
+        MapNormal::const_iterator i = partition.refsNS.find(id);
 
         LOG(_myLogLevel) << "CursorCache::getRefNs id: " << id
-                << " out: " << ( i == _refsNS.end() ? " NONE " : i->second ) << std::endl;
+                << " out: " << ( i == partition.refsNS.end() ? " NONE " : i->second ) << std::endl;
 
-        if ( i == _refsNS.end() )
+        if ( i == partition.refsNS.end() )
             return "";
         return i->second;
     }
@@ -310,10 +340,11 @@ namespace mongo {
 
     long long CursorCache::genId() {
         while ( true ) {
-            scoped_lock lk( _mutex );
-
             long long x = Listener::getElapsedTimeMillis() << 32;
-            x |= _random.nextInt32();
+            {
+                scoped_lock lk( _randomMutex );
+                x |= _random.nextInt32();
+            }
 
             if ( x == 0 )
                 continue;
@@ -321,12 +352,15 @@ namespace mongo {
             if ( x < 0 )
                 x *= -1;
 
-            MapSharded::iterator i = _cursors.find( x );
-            if ( i != _cursors.end() )
+            const Partition& partition = _partitionFor( x );
+            scoped_lock lk( partition.mutex );
+
+            MapSharded::const_iterator i = partition.cursors.find( x );
+            if ( i != partition.cursors.end() )
                 continue;
 
-            MapNormal::iterator j = _refs.find( x );
-            if ( j != _refs.end() )
+            MapNormal::const_iterator j = partition.refs.find( x );
+            if ( j != partition.refs.end() )
                 continue;
 
             return x;
@@ -361,11 +395,13 @@ namespace mongo {
             }
 
             string server;
+            ShardedClientCursorPtr killed;
             {
-                scoped_lock lk( _mutex );
+                Partition& partition = _partitionFor( id );
+                scoped_lock lk( partition.mutex );
 
-                MapSharded::iterator i = _cursors.find( id );
-                if ( i != _cursors.end() ) {
+                MapSharded::iterator i = partition.cursors.find( id );
+                if ( i != partition.cursors.end() ) {
                     const bool isAuthorized = authSession->isAuthorizedForActionsOnNamespace(
                             NamespaceString(i->second->getNS()), ActionType::killCursors);
                     audit::logKillCursorsAuthzCheck(
@@ -374,19 +410,20 @@ namespace mongo {
                             id,
                             isAuthorized ? ErrorCodes::OK : ErrorCodes::Unauthorized);
                     if (isAuthorized) {
-                        _cursorsMaxTimeMS.erase( i->second->getId() );
-                        _cursors.erase( i );
+                        killed = i->second;
+                        partition.cursorsMaxTimeMS.erase( i->second->getId() );
+                        partition.cursors.erase( i );
                     }
                     continue;
                 }
 
-                MapNormal::iterator refsIt = _refs.find(id);
-                MapNormal::iterator refsNSIt = _refsNS.find(id);
-                if (refsIt == _refs.end()) {
+                MapNormal::iterator refsIt = partition.refs.find(id);
+                MapNormal::iterator refsNSIt = partition.refsNS.find(id);
+                if (refsIt == partition.refs.end()) {
                     warning() << "can't find cursor: " << id << endl;
                     continue;
                 }
-                verify(refsNSIt != _refsNS.end());
+                verify(refsNSIt != partition.refsNS.end());
                 const bool isAuthorized = authSession->isAuthorizedForActionsOnNamespace(
                         NamespaceString(refsNSIt->second), ActionType::killCursors);
                 audit::logKillCursorsAuthzCheck(
@@ -398,8 +435,8 @@ namespace mongo {
                     continue;
                 }
                 server = refsIt->second;
-                _refs.erase(refsIt);
-                _refsNS.erase(refsNSIt);
+                partition.refs.erase(refsIt);
+                partition.refsNS.erase(refsNSIt);
             }
 
             LOG(_myLogLevel) << "CursorCache::found gotKillCursors id: " << id << " server: " << server << endl;
@@ -412,28 +449,42 @@ namespace mongo {
     }
 
     void CursorCache::appendInfo( BSONObjBuilder& result ) const {
-        scoped_lock lk( _mutex );
-        result.append( "sharded" , (int)_cursors.size() );
-        result.appendNumber( "shardedEver" , _shardedTotal );
-        result.append( "refs" , (int)_refs.size() );
-        result.append( "totalOpen" , (int)(_cursors.size() + _refs.size() ) );
+        int numSharded = 0;
+        int numRefs = 0;
+        for ( int p = 0; p < kNumPartitions; p++ ) {
+            const Partition& partition = _partitions[p];
+            scoped_lock lk( partition.mutex );
+            numSharded += partition.cursors.size();
+            numRefs += partition.refs.size();
+        }
+        result.append( "sharded" , numSharded );
+        result.appendNumber( "shardedEver" , _shardedTotal.load() );
+        result.append( "refs" , numRefs );
+        result.append( "totalOpen" , numSharded + numRefs );
     }
 
     void CursorCache::doTimeouts() {
         long long now = Listener::getElapsedTimeMillis();
-        scoped_lock lk( _mutex );
-        for ( MapSharded::iterator i=_cursors.begin(); i!=_cursors.end(); ++i ) {
-            // Note: cursors with no timeout will always have an idleTime of 0
-            long long idleFor = i->second->idleTime( now );
-            if ( idleFor < TIMEOUT ) {
-                continue;
+        for ( int p = 0; p < kNumPartitions; p++ ) {
+            Partition& partition = _partitions[p];
+
+            // Destroyed after the lock is released, as they may have to wait for their shard
+            // cursors
+            vector<ShardedClientCursorPtr> timedOut;
+
+            scoped_lock lk( partition.mutex );
+            for ( MapSharded::iterator i=partition.cursors.begin(); i!=partition.cursors.end(); ) {
+                // Note: cursors with no timeout will always have an idleTime of 0
+                long long idleFor = i->second->idleTime( now );
+                if ( idleFor < TIMEOUT ) {
+                    ++i;
+                    continue;
+                }
+                log() << "killing old cursor " << i->second->getId() << " idle for: " << idleFor << "ms" << endl; // TODO: make LOG(1)
+                timedOut.push_back( i->second );
+                partition.cursorsMaxTimeMS.erase( i->second->getId() );
+                partition.cursors.erase( i++ );
             }
-            log() << "killing old cursor " << i->second->getId() << " idle for: " << idleFor << "ms" << endl; // TODO: make LOG(1)
-            _cursorsMaxTimeMS.erase( i->second->getId() );
-            _cursors.erase( i );
-            i = _cursors.begin(); // possible 2nd entry will get skipped, will get on next pass
-            if ( i == _cursors.end() )
-                break;
         }
     }
 
@@ -37,6 +37,7 @@
 #include "mongo/client/parallel.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/platform/random.h"
 #include "mongo/s/request.h"
 
@@ -136,26 +137,47 @@ namespace mongo {
         void doTimeouts();
         void startTimeoutThread();
     private:
-        mutable mongo::mutex _mutex;
+        /**
+         * The cursors are spread over kNumPartitions partitions by cursor id, each with its own
+         * mutex, so that clients iterating different cursors do not contend.
+         */
+        struct Partition {
+            Partition() : mutex( "CursorCache" ) { }
 
-        PseudoRandom _random;
+            mutable mongo::mutex mutex;
 
-        // Maps sharded cursor ID to ShardedClientCursorPtr.
-        MapSharded _cursors;
+            // Maps sharded cursor ID to ShardedClientCursorPtr.
+            MapSharded cursors;
 
-        // Maps sharded cursor ID to remaining max time.  Value can be any of:
-        // - the constant "kMaxTimeCursorNoTimeLimit", or
-        // - the constant "kMaxTimeCursorTimeLimitExpired", or
-        // - a positive integer representing milliseconds of remaining time
-        MapShardedInt _cursorsMaxTimeMS;
+            // Maps sharded cursor ID to remaining max time.  Value can be any of:
+            // - the constant "kMaxTimeCursorNoTimeLimit", or
+            // - the constant "kMaxTimeCursorTimeLimitExpired", or
+            // - a positive integer representing milliseconds of remaining time
+            MapShardedInt cursorsMaxTimeMS;
 
-        // Maps passthrough cursor ID to shard name.
-        MapNormal _refs;
+            // Maps passthrough cursor ID to shard name.
+            MapNormal refs;
 
-        // Maps passthrough cursor ID to namespace.
-        MapNormal _refsNS;
-        
-        long long _shardedTotal;
+            // Maps passthrough cursor ID to namespace.
+            MapNormal refsNS;
+        };
+
+        // Client supplied ids may be negative, hence the unsigned modulo
+        static const int kNumPartitions = 16;
+
+        Partition& _partitionFor( long long id ) {
+            return _partitions[ static_cast<unsigned long long>( id ) % kNumPartitions ];
+        }
+        const Partition& _partitionFor( long long id ) const {
+            return _partitions[ static_cast<unsigned long long>( id ) % kNumPartitions ];
+        }
+
+        Partition _partitions[kNumPartitions];
+
+        mongo::mutex _randomMutex;
+        PseudoRandom _random;
+
+        AtomicInt64 _shardedTotal;
 
         static const int _myLogLevel;
     };
@@ -0,0 +1,428 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kSharding
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/s/d_auto_split.h"
+
+#include <algorithm>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "mongo/base/counter.h"
+#include "mongo/client/connpool.h"
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/s/chunk.h"
+#include "mongo/s/d_state.h"
+#include "mongo/s/range_arithmetic.h"
+#include "mongo/s/shard_key_pattern.h"
+#include "mongo/s/type_settings.h"
+#include "mongo/util/background.h"
+#include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    using std::string;
+    using std::vector;
+
+    // Whether the shard decides and runs the auto-splits of its chunks.  The mongoses should then
+    // run with --noAutoSplit.
+    MONGO_EXPORT_SERVER_PARAMETER(shardAutoSplit, bool, false);
+
+    ShardAutoSplitter shardAutoSplitter;
+
+namespace {
+
+    // The most keys sampled from the writes to a chunk
+    const size_t kMaxSampleKeys = 32;
+
+    // How often the worker rereads the chunk size setting when it has nothing to split
+    const int kRefreshSettingsSecs = 60;
+
+    Counter64 splitsQueued;
+    Counter64 splitsDone;
+    Counter64 splitsFailed;
+    Counter64 splitsFromSamples;
+    ServerStatusMetricField<Counter64> splitsQueuedDisplay("sharding.autoSplit.queued",
+                                                           &splitsQueued);
+    ServerStatusMetricField<Counter64> splitsDoneDisplay("sharding.autoSplit.splits",
+                                                         &splitsDone);
+    ServerStatusMetricField<Counter64> splitsFailedDisplay("sharding.autoSplit.failed",
+                                                           &splitsFailed);
+    ServerStatusMetricField<Counter64> splitsFromSamplesDisplay("sharding.autoSplit.fromSamples",
+                                                                &splitsFromSamples);
+
+    /**
+     * Returns the median of 'sampleKeys' which is strictly inside [min, max), or an empty
+     * object if there is none.
+     */
+    BSONObj medianSplitKey(vector<BSONObj> sampleKeys, const BSONObj& min, const BSONObj& max) {
+        std::sort(sampleKeys.begin(), sampleKeys.end(), BSONObjCmp());
+
+        const size_t median = sampleKeys.size() / 2;
+        for (size_t i = 0; i < sampleKeys.size(); ++i) {
+            // Looks at the median first, then alternately further above and below it
+            const size_t offset = (i + 1) / 2;
+            if (i % 2 ? median + offset >= sampleKeys.size() : median < offset) {
+                continue;
+            }
+            const BSONObj& key = sampleKeys[i % 2 ? median + offset : median - offset];
+            if (key.woCompare(min) > 0 && rangeContains(min, max, key)) {
+                return key;
+            }
+        }
+        return BSONObj();
+    }
+
+} // namespace
+
+    /**
+     * Runs the queued splits, one at a time, so that the writes never wait for them.
+     */
+    class ShardAutoSplitter::Worker : public BackgroundJob {
+    public:
+        explicit Worker(ShardAutoSplitter* splitter)
+            : BackgroundJob(true /* selfDelete */), _splitter(splitter) { }
+
+        virtual string name() const { return "ShardAutoSplitter"; }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+
+            _splitter->_refreshMaxChunkSize();
+
+            SplitJob job;
+            while (!inShutdown()) {
+                if (!_splitter->_nextJob(&job)) {
+                    _splitter->_refreshMaxChunkSize();
+                    continue;
+                }
+
+                OperationContextImpl txn;
+                try {
+                    _splitter->_split(&txn, job);
+                }
+                catch (const DBException& e) {
+                    warning() << "auto-split of " << job.ns << " " << job.min << " -->> "
+                              << job.max << " failed: " << e.toString();
+                    splitsFailed.increment();
+                    _splitter->_splitDone(job, BSONObj());
+                }
+            }
+        }
+
+    private:
+        ShardAutoSplitter* const _splitter;
+    };
+
+    ShardAutoSplitter::ShardAutoSplitter()
+        : _maxChunkSizeBytes(Chunk::MaxChunkSize),
+          _workerStarted(false),
+          _random(static_cast<int64_t>(curTimeMicros64())) {
+    }
+
+    void ShardAutoSplitter::noteInserts(OperationContext* txn,
+                                        const Collection* collection,
+                                        const vector<BSONObj>& docs) {
+        if (!shardAutoSplit || !shardingState.enabled()) {
+            return;
+        }
+
+        CollectionMetadataPtr metadata =
+            shardingState.getCollectionMetadata(collection->ns().ns());
+        if (!metadata) {
+            return;
+        }
+
+        const ShardKeyPattern shardKeyPattern(metadata->getKeyPattern());
+        vector<BSONObj> shardKeys;
+        shardKeyPattern.extractShardKeysFromDocs(docs, &shardKeys);
+
+        for (size_t i = 0; i < docs.size(); ++i) {
+            if (!shardKeys[i].isEmpty()) {
+                _noteWrite(txn, collection, metadata, shardKeys[i], docs[i].objsize());
+            }
+        }
+    }
+
+    void ShardAutoSplitter::noteUpdate(OperationContext* txn,
+                                       const Collection* collection,
+                                       const BSONObj& query,
+                                       long long bytes) {
+        if (!shardAutoSplit || !shardingState.enabled()) {
+            return;
+        }
+
+        CollectionMetadataPtr metadata =
+            shardingState.getCollectionMetadata(collection->ns().ns());
+        if (!metadata) {
+            return;
+        }
+
+        const ShardKeyPattern shardKeyPattern(metadata->getKeyPattern());
+        StatusWith<BSONObj> shardKey = shardKeyPattern.extractShardKeyFromQuery(query);
+        if (shardKey.isOK() && !shardKey.getValue().isEmpty()) {
+            _noteWrite(txn, collection, metadata, shardKey.getValue(), bytes);
+        }
+    }
+
+    void ShardAutoSplitter::_noteWrite(OperationContext* txn,
+                                       const Collection* collection,
+                                       const CollectionMetadataPtr& metadata,
+                                       const BSONObj& shardKey,
+                                       long long bytes) {
+        ChunkType chunk;
+        if (!metadata->getNextChunk(shardKey, &chunk) ||
+            !rangeContains(chunk.getMin(), chunk.getMax(), shardKey)) {
+            // Orphans and the documents of an incoming migration
+            return;
+        }
+
+        boost::mutex::scoped_lock lk(_mutex);
+
+        if (!_workerStarted) {
+            // Started before anything is queued, so that it reads the chunk size setting first
+            _workerStarted = true;
+            (new Worker(this))->go();
+        }
+
+        const string& ns = collection->ns().ns();
+        CollectionWrites& collWrites = _collections[ns];
+        const OID epoch = metadata->getCollVersion().epoch();
+        if (collWrites.epoch != epoch) {
+            // Dropped and sharded again
+            collWrites.chunks.clear();
+            collWrites.epoch = epoch;
+        }
+
+        ChunkWritesMap::iterator it = collWrites.chunks.find(chunk.getMin());
+        if (it == collWrites.chunks.end() || it->second.max.woCompare(chunk.getMax()) != 0) {
+            if (it != collWrites.chunks.end()) {
+                collWrites.chunks.erase(it);
+            }
+
+            // The first write seen to this chunk; until then, the chunks of the shard are
+            // assumed to hold the same amount of data.
+            ChunkWrites newChunk;
+            newChunk.max = chunk.getMax().getOwned();
+            newChunk.estimatedBytes = collection->dataSize(txn) /
+                std::max(std::size_t(1), metadata->getNumChunks());
+            it = collWrites.chunks.insert(std::make_pair(chunk.getMin().getOwned(),
+                                                         newChunk)).first;
+        }
+
+        ChunkWrites& chunkWrites = it->second;
+        chunkWrites.estimatedBytes += bytes;
+        chunkWrites.bytesWritten += bytes;
+        _sampleKey(&chunkWrites, shardKey);
+
+        if (chunkWrites.splitQueued ||
+            chunkWrites.estimatedBytes < _maxChunkSizeBytes.load() + chunkWrites.splitAfterBytes) {
+            return;
+        }
+
+        SplitJob job;
+        job.ns = ns;
+        job.keyPattern = metadata->getKeyPattern();
+        job.min = it->first;
+        job.max = chunkWrites.max;
+        job.epoch = epoch;
+        job.estimatedBytes = chunkWrites.estimatedBytes;
+        if (chunkWrites.bytesWritten * 2 >= chunkWrites.estimatedBytes) {
+            job.sampleKeys = chunkWrites.sampleKeys;
+        }
+
+        chunkWrites.splitQueued = true;
+        _jobs.push_back(job);
+        splitsQueued.increment();
+        _jobsChanged.notify_one();
+    }
+
+    void ShardAutoSplitter::_sampleKey(ChunkWrites* chunk, const BSONObj& shardKey) {
+        // Reservoir sampling, so that each write is as likely to be in the sample
+        chunk->numWrites++;
+        if (chunk->sampleKeys.size() < kMaxSampleKeys) {
+            chunk->sampleKeys.push_back(shardKey.getOwned());
+            return;
+        }
+
+        const unsigned long long slot =
+            static_cast<unsigned long long>(_random.nextInt64()) % chunk->numWrites;
+        if (slot < kMaxSampleKeys) {
+            chunk->sampleKeys[slot] = shardKey.getOwned();
+        }
+    }
+
+    bool ShardAutoSplitter::_nextJob(SplitJob* job) {
+        boost::mutex::scoped_lock lk(_mutex);
+        if (_jobs.empty()) {
+            const boost::system_time deadline =
+                boost::get_system_time() + boost::posix_time::seconds(kRefreshSettingsSecs);
+            _jobsChanged.timed_wait(lk, deadline);
+            if (_jobs.empty()) {
+                return false;
+            }
+        }
+
+        *job = _jobs.front();
+        _jobs.pop_front();
+        return true;
+    }
+
+    void ShardAutoSplitter::_split(OperationContext* txn, const SplitJob& job) {
+        const long long maxChunkSizeBytes = _maxChunkSizeBytes.load();
+        DBDirectClient client(txn);
+
+        BSONObj splitKey = medianSplitKey(job.sampleKeys, job.min, job.max);
+        if (!splitKey.isEmpty()) {
+            splitsFromSamples.increment();
+        }
+        else {
+            // The writes seen are not representative of the chunk, so look for its first split
+            // point in the shard key index.
+            BSONObj splitVectorResult;
+            const bool ok = client.runCommand("admin",
+                                              BSON("splitVector" << job.ns
+                                                   << "keyPattern" << job.keyPattern
+                                                   << "min" << job.min
+                                                   << "max" << job.max
+                                                   << "maxChunkSizeBytes" << maxChunkSizeBytes
+                                                   << "maxSplitPoints" << 1
+                                                   << "maxChunkObjects"
+                                                   << Chunk::MaxObjectPerChunk),
+                                              splitVectorResult);
+            if (ok && !splitVectorResult["splitKeys"].Array().empty()) {
+                splitKey = splitVectorResult["splitKeys"].Array().front().Obj().getOwned();
+            }
+            else {
+                // Nothing to split at (yet)
+                LOG(1) << "no auto-split point for " << job.ns << " " << job.min << " -->> "
+                       << job.max << ": " << splitVectorResult;
+                _splitDone(job, BSONObj());
+                return;
+            }
+        }
+
+        BSONObj splitChunkResult;
+        const bool ok = client.runCommand("admin",
+                                          BSON("splitChunk" << job.ns
+                                               << "keyPattern" << job.keyPattern
+                                               << "min" << job.min
+                                               << "max" << job.max
+                                               << "from" << shardingState.getShardName()
+                                               << "splitKeys" << BSON_ARRAY(splitKey)
+                                               << "shardId" << Chunk::genID(job.ns, job.min)
+                                               << "configdb" << shardingState.getConfigServer()
+                                               << "epoch" << job.epoch),
+                                          splitChunkResult);
+        if (!ok) {
+            warning() << "auto-split of " << job.ns << " " << job.min << " -->> " << job.max
+                      << " at " << splitKey << " failed: " << splitChunkResult;
+            splitsFailed.increment();
+            _splitDone(job, BSONObj());
+            return;
+        }
+
+        log() << "auto-split " << job.ns << " " << job.min << " -->> " << job.max << " at "
+              << splitKey << ", estimated size " << job.estimatedBytes << " bytes";
+        splitsDone.increment();
+        _splitDone(job, splitKey);
+    }
+
+    void ShardAutoSplitter::_splitDone(const SplitJob& job, const BSONObj& splitKey) {
+        boost::mutex::scoped_lock lk(_mutex);
+
+        CollectionWrites& collWrites = _collections[job.ns];
+        if (collWrites.epoch != job.epoch) {
+            return;
+        }
+
+        ChunkWritesMap::iterator it = collWrites.chunks.find(job.min);
+        if (it == collWrites.chunks.end() || it->second.max.woCompare(job.max) != 0) {
+            // Split or moved since
+            return;
+        }
+
+        ChunkWrites& chunkWrites = it->second;
+        if (splitKey.isEmpty()) {
+            // Waits for another half chunk of writes before trying again
+            const long long maxChunkSizeBytes = _maxChunkSizeBytes.load();
+            chunkWrites.splitQueued = false;
+            chunkWrites.splitAfterBytes =
+                chunkWrites.estimatedBytes + maxChunkSizeBytes / 2 - maxChunkSizeBytes;
+            return;
+        }
+
+        // The halves share the estimate and the bytes written, so that neither is sized from
+        // the whole collection again.
+        ChunkWrites lower;
+        ChunkWrites upper;
+        lower.max = splitKey.getOwned();
+        upper.max = chunkWrites.max;
+        lower.estimatedBytes = upper.estimatedBytes = chunkWrites.estimatedBytes / 2;
+        lower.bytesWritten = upper.bytesWritten = chunkWrites.bytesWritten / 2;
+        for (size_t i = 0; i < chunkWrites.sampleKeys.size(); ++i) {
+            const BSONObj& key = chunkWrites.sampleKeys[i];
+            ChunkWrites& half = key.woCompare(splitKey) < 0 ? lower : upper;
+            half.sampleKeys.push_back(key);
+            half.numWrites++;
+        }
+
+        collWrites.chunks.erase(it);
+        collWrites.chunks.insert(std::make_pair(job.min, lower));
+        collWrites.chunks.insert(std::make_pair(splitKey.getOwned(), upper));
+    }
+
+    void ShardAutoSplitter::_refreshMaxChunkSize() {
+        try {
+            ScopedDbConnection conn(shardingState.getConfigServer(), 30.0);
+            BSONObj settings = conn->findOne(SettingsType::ConfigNS,
+                                             BSON(SettingsType::key("chunksize")));
+            conn.done();
+
+            const int chunkSizeMB = settings[SettingsType::chunksize()].numberInt();
+            if (chunkSizeMB > 0) {
+                _maxChunkSizeBytes.store(static_cast<long long>(chunkSizeMB) << 20);
+            }
+        }
+        catch (const DBException& e) {
+            warning() << "could not read the chunk size setting: " << e.toString();
+        }
+    }
+
+} // namespace mongo
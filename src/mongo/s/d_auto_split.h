@@ -0,0 +1,150 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/bson/oid.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/random.h"
+#include "mongo/s/collection_metadata.h"
+
+namespace mongo {
+
+    class Collection;
+    class OperationContext;
+
+    /**
+     * Tracks the bytes written to each chunk this shard owns, and splits the chunks which grow
+     * past the max chunk size.  Every mongos only sees its own share of the writes, so when the
+     * shards are written to through many of them, the counters of Chunk::splitIfShould
+     * under-count.  The shard sees all of them.
+     *
+     * A chunk's size starts as the engine's estimate of the collection's data size, divided
+     * among the chunks the shard owns, and grows by the size of each write routed to it.  When
+     * the estimate reaches the max chunk size, the chunk is split once, in the background.  The
+     * split key is the median of a sample of the keys written to the chunk, when those writes
+     * make up at least half of its estimate.  Otherwise splitVector looks for it, stopping at
+     * the first split point.
+     *
+     * Only used when the shardAutoSplit server parameter is set, in which case the mongoses
+     * should run with --noAutoSplit.
+     */
+    class ShardAutoSplitter {
+    public:
+        ShardAutoSplitter();
+
+        /**
+         * Charges the inserts of 'docs' to their chunks.  Must be called with 'collection'
+         * locked, after the inserts committed.
+         */
+        void noteInserts(OperationContext* txn,
+                         const Collection* collection,
+                         const std::vector<BSONObj>& docs);
+
+        /**
+         * Charges 'bytes' written by an update to the chunk of the shard key of 'query', if it has
+         * one.  Must be called with 'collection' locked, after the update committed.
+         */
+        void noteUpdate(OperationContext* txn,
+                        const Collection* collection,
+                        const BSONObj& query,
+                        long long bytes);
+
+    private:
+        struct ChunkWrites {
+            ChunkWrites() : estimatedBytes(0), bytesWritten(0), numWrites(0),
+                            splitAfterBytes(0), splitQueued(false) { }
+
+            BSONObj max;
+            long long estimatedBytes;
+            long long bytesWritten;
+            long long numWrites;
+            // Extra bytes required before the next split attempt, after one failed
+            long long splitAfterBytes;
+            bool splitQueued;
+            std::vector<BSONObj> sampleKeys;
+        };
+
+        typedef std::map<BSONObj, ChunkWrites, BSONObjCmp> ChunkWritesMap;
+
+        struct CollectionWrites {
+            OID epoch;
+            ChunkWritesMap chunks;
+        };
+
+        struct SplitJob {
+            std::string ns;
+            BSONObj keyPattern;
+            BSONObj min;
+            BSONObj max;
+            OID epoch;
+            long long estimatedBytes;
+            // Empty unless the sampled keys represent the chunk
+            std::vector<BSONObj> sampleKeys;
+        };
+
+        class Worker;
+
+        void _noteWrite(OperationContext* txn,
+                        const Collection* collection,
+                        const CollectionMetadataPtr& metadata,
+                        const BSONObj& shardKey,
+                        long long bytes);
+
+        void _sampleKey(ChunkWrites* chunk, const BSONObj& shardKey);
+
+        // Called by the worker
+        bool _nextJob(SplitJob* job);
+        void _split(OperationContext* txn, const SplitJob& job);
+        void _splitDone(const SplitJob& job, const BSONObj& splitKey);
+        void _refreshMaxChunkSize();
+
+        AtomicInt64 _maxChunkSizeBytes;
+
+        boost::mutex _mutex;
+        boost::condition_variable _jobsChanged;
+
+        // Guarded by _mutex
+        std::map<std::string, CollectionWrites> _collections;
+        std::deque<SplitJob> _jobs;
+        bool _workerStarted;
+        PseudoRandom _random;
+    };
+
+    extern ShardAutoSplitter shardAutoSplitter;
+
+} // namespace mongo
@@ -65,6 +65,7 @@
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/range_deleter_service.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/repl_coordinator_global.h"
 #include "mongo/db/repl/rs.h"
@@ -78,7 +79,9 @@
 #include "mongo/s/distlock.h"
 #include "mongo/s/shard.h"
 #include "mongo/s/type_chunk.h"
+#include "mongo/stdx/functional.h"
 #include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/elapsed_tracker.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
@@ -1649,6 +1652,67 @@ namespace mongo {
     MONGO_FP_DECLARE(migrateThreadHangAtStep4);
     MONGO_FP_DECLARE(migrateThreadHangAtStep5);
 
+    // Number of cloned documents the recipient upserts under one acquisition of the write lock
+    MONGO_EXPORT_SERVER_PARAMETER(migrateCloneInsertBatchSize, int, 100);
+
+    // Number of writer threads the recipient applies each cloned batch with, read when the
+    // first migration that can use them starts; 1 applies them on the migrate thread only
+    MONGO_EXPORT_SERVER_PARAMETER(migrateCloneWriterThreads, int, 4);
+
+    /**
+     * Runs _migrateClone against the donor on a thread of its own, so that the recipient fetches
+     * the next batch of documents while it applies the current one. At most one fetch can be
+     * outstanding, and nothing else may use the connection until wait() has returned.
+     */
+    class CloneBatchFetcher : boost::noncopyable {
+    public:
+        explicit CloneBatchFetcher(DBClientBase* conn) : _conn(conn), _ok(false) {}
+
+        ~CloneBatchFetcher() {
+            if (_thread) {
+                _thread->join();
+            }
+        }
+
+        void start() {
+            invariant(!_thread);
+            _thread.reset(new boost::thread(stdx::bind(&CloneBatchFetcher::_fetch, this)));
+        }
+
+        /**
+         * Waits for the fetch started last and returns whether the command succeeded, with its
+         * reply in 'res'.
+         */
+        bool wait(BSONObj* res) {
+            invariant(_thread);
+            _thread->join();
+            _thread.reset();
+
+            *res = _res;
+            _res = BSONObj();
+            return _ok;
+        }
+
+    private:
+        void _fetch() {
+            Client::initThread("migrateCloneFetcher");
+            try {
+                // gets array of objects to copy, in disk order
+                _ok = _conn->runCommand("admin", BSON("_migrateClone" << 1), _res);
+            }
+            catch (const DBException& e) {
+                _ok = false;
+                _res = BSON("errmsg" << e.toString());
+            }
+            cc().shutdown();
+        }
+
+        DBClientBase* const _conn;
+        boost::scoped_ptr<boost::thread> _thread;
+        bool _ok;
+        BSONObj _res;
+    };
+
     class MigrateStatus {
     public:
         enum State {
@@ -1894,9 +1958,13 @@ namespace mongo {
                 // 3. initial bulk clone
                 setState(CLONE);
 
+                // Fetch the next batch from the donor while the current one is applied
+                CloneBatchFetcher fetcher( conn.get() );
+                fetcher.start();
+
                 while ( true ) {
                     BSONObj res;
-                    if ( ! conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res ) ) {  // gets array of objects to copy, in disk order
+                    if ( ! fetcher.wait( &res ) ) {
                         setState(FAIL);
                         errmsg = "_migrateClone failed: ";
                         errmsg += res.toString();
@@ -1905,62 +1973,25 @@ namespace mongo {
                         return;
                     }
 
-                    BSONObj arr = res["objects"].Obj();
-                    int thisTime = 0;
-
-                    BSONObjIterator i( arr );
+                    vector<BSONObj> docs;
+                    BSONObjIterator i( res["objects"].Obj() );
                     while( i.more() ) {
-                        txn->checkForInterrupt();
-
-                        if ( getState() == ABORT ) {
-                            errmsg = str::stream() << "Migration abort requested while "
-                                                   << "copying documents";
-                            error() << errmsg << migrateLog;
-                            return;
-                        }
-
-                        BSONObj o = i.next().Obj();
-                        {
-                            Client::WriteContext cx(txn, ns );
+                        docs.push_back( i.next().Obj() );
+                    }
 
-                            BSONObj localDoc;
-                            if ( willOverrideLocalId( txn, cx.ctx().db(), o, &localDoc ) ) {
-                                string errMsg =
-                                    str::stream() << "cannot migrate chunk, local document "
-                                    << localDoc
-                                    << " has same _id as cloned "
-                                    << "remote document " << o;
+                    if ( docs.empty() )
+                        break;
 
-                                warning() << errMsg << endl;
+                    fetcher.start();
 
-                                // Exception will abort migration cleanly
-                                uasserted( 16976, errMsg );
-                            }
+                    _applyCloneBatch( txn, docs );
 
-                            Helpers::upsert( txn, ns, o, true );
-                        }
-                        thisTime++;
-                        numCloned++;
-                        clonedBytes += o.objsize();
-
-                        if (writeConcern.shouldWaitForOtherNodes() && thisTime > 0) {
-                            repl::ReplicationCoordinator::StatusAndDuration replStatus =
-                                    repl::getGlobalReplicationCoordinator()->awaitReplication(
-                                            txn,
-                                            cc().getLastOp(),
-                                            writeConcern);
-                            if (replStatus.status.code() == ErrorCodes::ExceededTimeLimit) {
-                                warning() << "secondaryThrottle on, but doc insert timed out; "
-                                             "continuing";
-                            }
-                            else {
-                                massertStatusOK(replStatus.status);
-                            }
-                        }
+                    if ( getState() == ABORT ) {
+                        errmsg = str::stream() << "Migration abort requested while "
+                                               << "copying documents";
+                        error() << errmsg << migrateLog;
+                        return;
                     }
-
-                    if ( thisTime == 0 )
-                        break;
                 }
 
                 timing.done(3);
@@ -2211,6 +2242,161 @@ namespace mongo {
             return didAnything;
         }
 
+        struct CloneApplyResult {
+            CloneApplyResult() : status(Status::OK()), numDocs(0), numBytes(0) {}
+
+            Status status;
+            long long numDocs;
+            long long numBytes;
+            OpTime lastOp;
+        };
+
+        /**
+         * Applies a batch of documents from _migrateClone in groups of
+         * migrateCloneInsertBatchSize, each upserted under one acquisition of the write lock.
+         * With secondaryThrottle the groups go one at a time on this thread, waiting for them to
+         * replicate in between; otherwise they are spread over the writer threads. Returns early,
+         * without an error, if the migration is aborted.
+         */
+        void _applyCloneBatch( OperationContext* txn, const vector<BSONObj>& docs ) {
+            const size_t groupSize = std::max( migrateCloneInsertBatchSize, 1 );
+            const size_t numGroups = ( docs.size() + groupSize - 1 ) / groupSize;
+            vector<CloneApplyResult> results( numGroups );
+
+            const bool throttle = writeConcern.shouldWaitForOtherNodes();
+            if ( throttle || numGroups == 1 || migrateCloneWriterThreads <= 1 ) {
+                for ( size_t g = 0; g < numGroups; ++g ) {
+                    txn->checkForInterrupt();
+
+                    _applyCloneDocs( txn,
+                                     &docs,
+                                     g * groupSize,
+                                     std::min( docs.size(), ( g + 1 ) * groupSize ),
+                                     &results[g] );
+                    _noteCloneApplied( results[g] );
+
+                    if ( throttle && results[g].numDocs > 0 ) {
+                        repl::ReplicationCoordinator::StatusAndDuration replStatus =
+                                repl::getGlobalReplicationCoordinator()->awaitReplication(
+                                        txn,
+                                        cc().getLastOp(),
+                                        writeConcern);
+                        if (replStatus.status.code() == ErrorCodes::ExceededTimeLimit) {
+                            warning() << "secondaryThrottle on, but doc insert timed out; "
+                                         "continuing";
+                        }
+                        else {
+                            massertStatusOK(replStatus.status);
+                        }
+                    }
+
+                    if ( getState() == ABORT )
+                        return;
+                }
+                return;
+            }
+
+            if ( !_cloneWriterPool ) {
+                _cloneWriterPool.reset( new threadpool::ThreadPool( migrateCloneWriterThreads,
+                                                                    "migrateCloneWriter" ) );
+            }
+
+            txn->checkForInterrupt();
+
+            vector<threadpool::Task> tasks;
+            for ( size_t g = 0; g < numGroups; ++g ) {
+                tasks.push_back( stdx::bind( &MigrateStatus::_applyCloneDocsOnWriter,
+                                             this,
+                                             &docs,
+                                             g * groupSize,
+                                             std::min( docs.size(), ( g + 1 ) * groupSize ),
+                                             &results[g] ) );
+            }
+            _cloneWriterPool->scheduleBatch( tasks );
+            _cloneWriterPool->join();
+
+            // The writes happened on the writers' clients, and the replication waits that follow
+            // go by the last op of ours
+            OpTime lastOp = cc().getLastOp();
+            for ( size_t g = 0; g < numGroups; ++g ) {
+                if ( lastOp < results[g].lastOp ) {
+                    lastOp = results[g].lastOp;
+                }
+            }
+            cc().setLastOp( lastOp );
+
+            for ( size_t g = 0; g < numGroups; ++g ) {
+                _noteCloneApplied( results[g] );
+            }
+        }
+
+        void _noteCloneApplied( const CloneApplyResult& result ) {
+            numCloned += result.numDocs;
+            clonedBytes += result.numBytes;
+
+            // Exception will abort migration cleanly
+            uassertStatusOK( result.status );
+        }
+
+        /**
+         * Upserts docs [begin, end) of a cloned batch under one write lock acquisition.
+         */
+        void _applyCloneDocs( OperationContext* txn,
+                              const vector<BSONObj>* docs,
+                              size_t begin,
+                              size_t end,
+                              CloneApplyResult* result ) {
+            try {
+                Client::WriteContext cx(txn, ns );
+
+                for ( size_t i = begin; i < end; ++i ) {
+                    if ( getState() == ABORT )
+                        break;
+
+                    const BSONObj& o = ( *docs )[i];
+
+                    BSONObj localDoc;
+                    if ( willOverrideLocalId( txn, cx.ctx().db(), o, &localDoc ) ) {
+                        string errMsg =
+                            str::stream() << "cannot migrate chunk, local document "
+                            << localDoc
+                            << " has same _id as cloned "
+                            << "remote document " << o;
+
+                        warning() << errMsg << endl;
+
+                        uasserted( 16976, errMsg );
+                    }
+
+                    Helpers::upsert( txn, ns, o, true );
+
+                    result->numDocs++;
+                    result->numBytes += o.objsize();
+                }
+            }
+            catch ( const DBException& e ) {
+                result->status = e.toStatus();
+            }
+
+            result->lastOp = cc().getLastOp();
+        }
+
+        void _applyCloneDocsOnWriter( const vector<BSONObj>* docs,
+                                      size_t begin,
+                                      size_t end,
+                                      CloneApplyResult* result ) {
+            // Only do this once per thread
+            if ( !ClientBasic::getCurrent() ) {
+                Client::initThreadIfNotAlready();
+                if ( getGlobalAuthorizationManager()->isAuthEnabled() ) {
+                    cc().getAuthorizationSession()->grantInternalAuthorization();
+                }
+            }
+
+            OperationContextImpl txn;
+            _applyCloneDocs( &txn, docs, begin, end, result );
+        }
+
         /**
          * Checks if an upsert of a remote document will override a local document with the same _id
          * but in a different range on this shard.
@@ -2361,6 +2547,9 @@ namespace mongo {
         State state;
         string errmsg;
 
+        // applies cloned documents, created by the first migration which needs it
+        boost::scoped_ptr<threadpool::ThreadPool> _cloneWriterPool;
+
     } migrateStatus;
 
     void migrateThread() {
@@ -845,7 +845,20 @@ namespace mongo {
         _tl.reset();
     }
 
+    ShardedConnectionInfo* ShardedConnectionInfo::release() {
+        return _tl.release();
+    }
+
+    void ShardedConnectionInfo::attach( ShardedConnectionInfo* info ) {
+        invariant( _tl.get() == NULL );
+        _tl.reset( info );
+    }
+
     const ChunkVersion ShardedConnectionInfo::getVersion( const string& ns ) const {
+        if ( ! _requestNS.empty() && _requestNS == ns ) {
+            return _requestVersion;
+        }
+
         NSVersionMap::const_iterator it = _versions.find( ns );
         if ( it != _versions.end() ) {
             return it->second;
@@ -859,6 +872,39 @@ namespace mongo {
         _versions[ns] = version;
     }
 
+    void ShardedConnectionInfo::setRequestVersion( const string& ns,
+                                                   const ChunkVersion& version ) {
+        _requestNS = ns;
+        _requestVersion = version;
+    }
+
+    void ShardedConnectionInfo::clearRequestVersion() {
+        _requestNS.clear();
+    }
+
+    ShardRequestVersionBlock::ShardRequestVersionBlock( const string& ns,
+                                                        const BSONObj& query )
+        : info( NULL ) {
+
+        BSONElement versionElt = query["$shardVersion"];
+        if ( versionElt.eoo() )
+            return;
+
+        bool canParse;
+        const ChunkVersion version = ChunkVersion::fromBSON( versionElt, "", &canParse );
+        uassert( 28623,
+                 str::stream() << "invalid $shardVersion " << versionElt << " for " << ns,
+                 canParse );
+
+        info = ShardedConnectionInfo::get( true );
+        info->setRequestVersion( ns, version );
+    }
+
+    ShardRequestVersionBlock::~ShardRequestVersionBlock() {
+        if ( info )
+            info->clearRequestVersion();
+    }
+
     void ShardedConnectionInfo::addHook() {
         static mongo::mutex lock("ShardedConnectionInfo::addHook mutex");
         static bool done = false;
@@ -307,6 +307,17 @@ namespace mongo {
 
         static ShardedConnectionInfo* get( bool create );
         static void reset();
+
+        /**
+         * Relinquishes ownership of the calling thread's instance, if any, without destroying
+         * it.  Used to move a connection's state to another thread; see attach().
+         */
+        static ShardedConnectionInfo* release();
+
+        /**
+         * Makes 'info', which may be NULL, the calling thread's instance.
+         */
+        static void attach( ShardedConnectionInfo* info );
         static void addHook();
 
         bool inForceVersionOkMode() const {
@@ -316,10 +327,22 @@ namespace mongo {
         void enterForceVersionOkMode() { _forceVersionOk = true; }
         void leaveForceVersionOkMode() { _forceVersionOk = false; }
 
+        /**
+         * Until clearRequestVersion(), getVersion() returns 'version' for 'ns', which is the
+         * version attached to the request being processed, rather than the version set for
+         * the connection.
+         */
+        void setRequestVersion( const std::string& ns, const ChunkVersion& version );
+        void clearRequestVersion();
+
     private:
 
         bool _forceVersionOk; // if this is true, then chunk version #s aren't check, and all ops are allowed
 
+        // the version attached to the current request, if _requestNS is not empty
+        std::string _requestNS;
+        ChunkVersion _requestVersion;
+
         typedef std::map<std::string,ChunkVersion> NSVersionMap;
         NSVersionMap _versions;
 
@@ -340,6 +363,18 @@ namespace mongo {
         ShardedConnectionInfo * info;
     };
 
+    /**
+     * Checks the operation on 'ns' against the shard version mongos attached to the query,
+     * { $shardVersion : [ ts, epoch ] }, if there is one, instead of the version of the
+     * connection.  A connection sending a versioned query enters shard mode.
+     */
+    struct ShardRequestVersionBlock {
+        ShardRequestVersionBlock( const std::string& ns, const BSONObj& query );
+        ~ShardRequestVersionBlock();
+
+        ShardedConnectionInfo * info;
+    };
+
     // -----------------
     // --- core ---
     // -----------------
@@ -51,6 +51,7 @@ namespace mongo {
         dbName( dbName.toString() ),
         cmdObj( cmdObj ),
         conn( NULL ),
+        sent( false ),
         status( Status::OK() ) {
     }
 
@@ -156,7 +157,10 @@ namespace mongo {
             it != _pendingCommands.end(); ++it ) {
 
             PendingCommand* command = *it;
-            dassert( NULL == command->conn );
+
+            // Skip the commands sent by an earlier sendAll
+            if ( command->sent ) continue;
+            command->sent = true;
 
             try {
                 dassert( command->endpoint.type() == ConnectionString::MASTER ||
@@ -205,6 +209,7 @@ namespace mongo {
 
         scoped_ptr<PendingCommand> command( _pendingCommands.front() );
         _pendingCommands.pop_front();
+        dassert( command->sent );
 
         *endpoint = command->endpoint;
         if ( !command->status.isOK() ) return command->status;
@@ -77,6 +77,9 @@ namespace mongo {
             // Where to send it
             DBClientBase* conn;
 
+            // Whether sendAll() has dispatched it
+            bool sent;
+
             // If anything goes wrong
             Status status;
         };
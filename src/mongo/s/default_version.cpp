@@ -57,4 +57,8 @@ namespace mongo {
         return false;
     }
 
+    bool VersionManager::canAttachShardVersionCB( DBClientBase* conn_in , const string& ns ) {
+        return false;
+    }
+
 }  // namespace mongo
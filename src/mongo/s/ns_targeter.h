@@ -29,6 +29,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "mongo/bson/bsonobj.h"
 #include "mongo/base/status.h"
@@ -85,6 +86,21 @@ namespace mongo {
          */
         virtual Status targetInsert( const BSONObj& doc, ShardEndpoint** endpoint ) const = 0;
 
+        /**
+         * Same as targetInsert() on each of a batch of documents: fills 'statuses' and
+         * 'endpoints' in the same order as 'docs', with a NULL endpoint wherever the status is
+         * !OK.  Targeters which can do better for a whole batch override this.
+         */
+        virtual void targetInserts( const std::vector<BSONObj>& docs,
+                                    std::vector<Status>* statuses,
+                                    std::vector<ShardEndpoint*>* endpoints ) const {
+            for ( size_t i = 0; i < docs.size(); ++i ) {
+                ShardEndpoint* endpoint = NULL;
+                statuses->push_back( targetInsert( docs[i], &endpoint ) );
+                endpoints->push_back( endpoint );
+            }
+        }
+
         /**
          * Returns a vector of ShardEndpoints for a potentially multi-shard update.
          *
@@ -496,6 +496,12 @@ namespace mongo {
         : _shard( shard ) {
         _mapped = obj.getFieldDotted( "mem.mapped" ).numberLong();
         _writeLock = 0; // TODO
+        _queuedOps = obj.getFieldDotted( "globalLock.currentQueue.total" ).numberLong();
+        _totalOps = 0;
+        BSONObjIterator opcounters( obj.getObjectField( "opcounters" ) );
+        while ( opcounters.more() ) {
+            _totalOps += opcounters.next().numberLong();
+        }
         _mongoVersion = obj["version"].String();
     }
 
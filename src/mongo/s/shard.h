@@ -36,6 +36,7 @@
 
 namespace mongo {
 
+    struct ChunkVersion;
     class ShardConnection;
     class ShardStatus;
 
@@ -201,6 +202,7 @@ namespace mongo {
             ss << "shard: " << _shard 
                << " mapped: " << _mapped 
                << " writeLock: " << _writeLock
+               << " queuedOps: " << _queuedOps
                << " version: " << _mongoVersion;
             return ss.str();
         }
@@ -221,10 +223,22 @@ namespace mongo {
             return _mongoVersion;
         }
 
+        /** operations waiting for a lock, from globalLock.currentQueue.total */
+        long long queuedOps() const {
+            return _queuedOps;
+        }
+
+        /** operations served since the shard started, the sum of its opcounters */
+        long long totalOps() const {
+            return _totalOps;
+        }
+
     private:
         Shard _shard;
         long long _mapped;
         double _writeLock;
+        long long _queuedOps;
+        long long _totalOps;
         std::string _mongoVersion;
     };
 
@@ -286,6 +300,17 @@ namespace mongo {
             return _setVersion;
         }
 
+        /**
+         * Skips bringing the connection's shard version up to date with setShardVersion when
+         * the connection has already been versioned for the namespace, and instead returns in
+         * 'version' the version the caller must attach to its request.  The shard checks an
+         * attached version as if it had been set, and fails the request with a stale config
+         * error if it is incompatible, after which the caller should use setVersion().
+         *
+         * @return false if the version has to be set with setVersion()
+         */
+        bool attachVersion( ChunkVersion* version );
+
         static void sync();
 
         void donotCheckVersion() {
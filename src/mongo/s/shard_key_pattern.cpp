@@ -34,6 +34,9 @@
 #include "mongo/db/field_ref.h"
 #include "mongo/db/field_ref_set.h"
 #include "mongo/db/hasher.h"
+#include "mongo/db/index/expression_keys_private.h"
+#include "mongo/db/index/expression_params.h"
+#include "mongo/db/index/s2_common.h"
 #include "mongo/db/index_names.h"
 #include "mongo/db/ops/path_support.h"
 #include "mongo/db/query/canonical_query.h"
@@ -66,10 +69,15 @@ namespace mongo {
         return el.type() == String && el.String() == IndexNames::HASHED;
     }
 
+    static bool isGeoPatternEl(const BSONElement& el) {
+        return el.type() == String && el.String() == IndexNames::GEO_2DSPHERE;
+    }
+
     /**
      * Currently the allowable shard keys are either
      * i) a hashed single field, e.g. { a : "hashed" }, or
-     * ii) a compound list of ascending, potentially-nested field paths, e.g. { a : 1 , b.c : 1 }
+     * ii) a geo single field, e.g. { a : "2dsphere" }, or
+     * iii) a compound list of ascending, potentially-nested field paths, e.g. { a : 1 , b.c : 1 }
      */
     static vector<FieldRef*> parseShardKeyPattern(const BSONObj& keyPattern) {
 
@@ -97,9 +105,10 @@ namespace mongo {
                     return empty;
             }
 
-            // Numeric and ascending (1.0), or "hashed" and single field
+            // Numeric and ascending (1.0), or "hashed" or "2dsphere" and single field
             if (!patternEl.isNumber()) {
-                if (keyPattern.nFields() != 1 || !isHashedPatternEl(patternEl))
+                if (keyPattern.nFields() != 1
+                    || !(isHashedPatternEl(patternEl) || isGeoPatternEl(patternEl)))
                     return empty;
             }
             else if (patternEl.numberInt() != 1) {
@@ -128,6 +137,17 @@ namespace mongo {
         return isHashedPatternEl(_keyPattern.toBSON().firstElement());
     }
 
+    bool ShardKeyPattern::isGeoPattern() const {
+        return isGeoPatternEl(_keyPattern.toBSON().firstElement());
+    }
+
+    BSONObj ShardKeyPattern::getGeoIndexInfo() const {
+        dassert(isGeoPattern());
+        // The default levels of a new 2dsphere index
+        return BSON("key" << _keyPattern.toBSON()
+                    << "2dsphereIndexVersion" << S2_INDEX_VERSION_2);
+    }
+
     const KeyPattern& ShardKeyPattern::getKeyPattern() const {
         return _keyPattern;
     }
@@ -216,6 +236,27 @@ namespace mongo {
         return matchEl;
     }
 
+    /**
+     * Appends the geo shard key of 'pointEl' as 'fieldName', returns false if it has none.
+     */
+    static bool appendGeoShardKey(const ShardKeyPattern& pattern,
+                                  const BSONElement& pointEl,
+                                  const StringData& fieldName,
+                                  BSONObjBuilder* keyBuilder) {
+        if (pointEl.eoo())
+            return false;
+
+        S2IndexingParams params;
+        ExpressionParams::parse2dsphereParams(pattern.getGeoIndexInfo(), &params);
+
+        string key;
+        if (!ExpressionKeysPrivate::getS2PointKey(pointEl, params, &key))
+            return false;
+
+        keyBuilder->append(fieldName, key);
+        return true;
+    }
+
     BSONObj //
     ShardKeyPattern::extractShardKeyFromMatchable(const MatchableDocument& matchable) const {
 
@@ -231,6 +272,14 @@ namespace mongo {
             BSONElement matchEl = extractKeyElementFromMatchable(matchable,
                                                                  patternEl.fieldNameStringData());
 
+            // Legacy coordinate pairs are arrays, so check geo keys before the element itself
+            if (isGeoPatternEl(patternEl)) {
+                if (!appendGeoShardKey(*this, matchEl, patternEl.fieldNameStringData(),
+                                       &keyBuilder))
+                    return BSONObj();
+                continue;
+            }
+
             if (!isShardKeyElement(matchEl, true))
                 return BSONObj();
 
@@ -255,6 +304,42 @@ namespace mongo {
         return extractShardKeyFromMatchable(matchable);
     }
 
+    void ShardKeyPattern::extractShardKeysFromDocs(const std::vector<BSONObj>& docs,
+                                                   std::vector<BSONObj>* shardKeys) const {
+
+        shardKeys->clear();
+        shardKeys->reserve(docs.size());
+
+        if (!isValid() || !isHashedPattern()) {
+            for (size_t i = 0; i < docs.size(); ++i)
+                shardKeys->push_back(extractShardKeyFromDoc(docs[i]));
+            return;
+        }
+
+        // A hashed pattern has a single field, hash the values of all the documents that have a
+        // usable one at once
+        const BSONElement patternEl = _keyPattern.toBSON().firstElement();
+        std::vector<BSONElement> values;
+        std::vector<size_t> valueDocs;
+        for (size_t i = 0; i < docs.size(); ++i) {
+            BSONMatchableDocument matchable(docs[i]);
+            BSONElement matchEl = extractKeyElementFromMatchable(matchable,
+                                                                 patternEl.fieldNameStringData());
+            if (!isShardKeyElement(matchEl, true))
+                continue;
+            values.push_back(matchEl);
+            valueDocs.push_back(i);
+        }
+
+        std::vector<long long> hashes;
+        BSONElementHasher::hash64Batch(values, BSONElementHasher::DEFAULT_HASH_SEED, &hashes);
+
+        shardKeys->resize(docs.size());
+        for (size_t i = 0; i < valueDocs.size(); ++i) {
+            (*shardKeys)[valueDocs[i]] = BSON(patternEl.fieldName() << hashes[i]);
+        }
+    }
+
     static BSONElement findEqualityElement(const EqualityMatches& equalities,
                                            const FieldRef& path) {
 
@@ -312,6 +397,12 @@ namespace mongo {
             const FieldRef& patternPath = **it;
             BSONElement equalEl = findEqualityElement(equalities, patternPath);
 
+            if (isGeoPattern()) {
+                if (!appendGeoShardKey(*this, equalEl, patternPath.dottedField(), &keyBuilder))
+                    return StatusWith<BSONObj>(BSONObj());
+                continue;
+            }
+
             if (!isShardKeyElement(equalEl, false))
                 return StatusWith<BSONObj>(BSONObj());
 
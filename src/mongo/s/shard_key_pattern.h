@@ -88,6 +88,22 @@ namespace mongo {
 
         bool isHashedPattern() const;
 
+        /**
+         * Returns true if this is a geo shard key pattern, a single field { loc : "2dsphere" }.
+         *
+         * The shard key of a document is the key a 2dsphere index described by getGeoIndexInfo()
+         * stores for its point, so the covering of a geo predicate can be turned into shard key
+         * ranges.  Only GeoJSON points without a "crs" and legacy coordinate pairs have a geo
+         * shard key.
+         */
+        bool isGeoPattern() const;
+
+        /**
+         * Returns the index spec whose 2dsphere parameters geo shard keys are computed with.
+         * Only valid for geo shard key patterns.
+         */
+        BSONObj getGeoIndexInfo() const;
+
         const KeyPattern& getKeyPattern() const;
 
         const BSONObj& toBSON() const;
@@ -114,7 +130,8 @@ namespace mongo {
          *
          * Paths to shard key fields must not contain arrays at any level, and shard keys may not
          * be array fields, undefined, or non-storable sub-documents.  If the shard key pattern is
-         * a hashed key pattern, this method performs the hashing.
+         * a hashed key pattern, this method performs the hashing.  If the shard key pattern is a
+         * geo key pattern, the value must be a point, and its S2 cell id key is extracted.
          *
          * If a shard key cannot be extracted, returns an empty BSONObj().
          *
@@ -129,6 +146,9 @@ namespace mongo {
          *  If 'this' KeyPattern is { 'a.b' : 1 }
          *   { a : { b : "hi" } } --> returns { 'a.b' : "hi" }
          *   { a : [{ b : "hi" }] } --> returns {}
+         *  If 'this' KeyPattern is { a : "2dsphere" }
+         *   { a : [ 40, 5 ] } --> returns { a : "0f2332..." }
+         *   { a : { type : "LineString", coordinates : ... } } --> returns {}
          */
         BSONObj extractShardKeyFromMatchable(const MatchableDocument& matchable) const;
 
@@ -138,6 +158,13 @@ namespace mongo {
          */
         BSONObj extractShardKeyFromDoc(const BSONObj& doc) const;
 
+        /**
+         * Same as extractShardKeyFromDoc() on each of 'docs', into 'shardKeys' in the same order.
+         * For a hashed key pattern the values of the whole batch are hashed together.
+         */
+        void extractShardKeysFromDocs(const std::vector<BSONObj>& docs,
+                                      std::vector<BSONObj>* shardKeys) const;
+
         /**
          * Given a simple BSON query, extracts the shard key corresponding to the key pattern
          * from equality matches in the query.  The query expression *must not* be a complex query
@@ -176,8 +203,8 @@ namespace mongo {
          * when resolving duplicates that documents on other shards will have different shard keys,
          * and so are not duplicates.
          *
-         * Hashed shard key patterns are similar to ordinary patterns in that they guarantee similar
-         * shard keys go to the same shard.
+         * Hashed and geo shard key patterns are similar to ordinary patterns in that they guarantee
+         * similar shard keys go to the same shard.
          *
          * Examples:
          *     shard key {a : 1} is compatible with a unique index on {_id : 1}
@@ -28,6 +28,9 @@
 #include "mongo/s/shard_key_pattern.h"
 
 #include "mongo/db/hasher.h"
+#include "mongo/db/index/expression_keys_private.h"
+#include "mongo/db/index/expression_params.h"
+#include "mongo/db/index/s2_common.h"
 #include "mongo/db/json.h"
 #include "mongo/unittest/unittest.h"
 
@@ -55,6 +58,8 @@ namespace {
 
         ASSERT(ShardKeyPattern(BSON("a" << "hashed")).isValid());
         ASSERT(!ShardKeyPattern(BSON("a" << "hash")).isValid());
+        ASSERT(ShardKeyPattern(BSON("a" << "2dsphere")).isValid());
+        ASSERT(!ShardKeyPattern(BSON("a" << "2d")).isValid());
         ASSERT(!ShardKeyPattern(BSON("" << 1)).isValid());
         ASSERT(!ShardKeyPattern(BSON("." << 1)).isValid());
 
@@ -70,6 +75,7 @@ namespace {
         ASSERT(ShardKeyPattern(BSON("a" << 1.0f << "b" << 1.0)).isValid());
         ASSERT(!ShardKeyPattern(BSON("a" << 1 << "b" << -1)).isValid());
         ASSERT(!ShardKeyPattern(BSON("a" << 1 << "b" << "1")).isValid());
+        ASSERT(!ShardKeyPattern(BSON("a" << "2dsphere" << "b" << 1)).isValid());
 
         ASSERT(ShardKeyPattern(BSON("a" << 1 << "b" << 1.0 << "c" << 1.0f)).isValid());
         ASSERT(!ShardKeyPattern(BSON("a" << 1 << "b." << 1.0)).isValid());
@@ -244,6 +250,70 @@ namespace {
         ASSERT_EQUALS(docKey(pattern, BSON("a" << BSON_ARRAY(BSON("b" << value)))), BSONObj());
     }
 
+    // The only key a 2dsphere index with the geo shard key parameters has for 'doc'
+    static BSONObj geoIndexKey(const ShardKeyPattern& pattern, const BSONObj& doc) {
+        S2IndexingParams params;
+        ExpressionParams::parse2dsphereParams(pattern.getGeoIndexInfo(), &params);
+        BSONObjSet keys;
+        ExpressionKeysPrivate::getS2Keys(doc, pattern.toBSON(), params, &keys);
+        ASSERT_EQUALS(keys.size(), 1U);
+        const BSONElement keyEl = keys.begin()->firstElement();
+        ASSERT_EQUALS(keyEl.type(), String);
+        return BSON(pattern.toBSON().firstElementFieldName() << keyEl.str());
+    }
+
+    TEST(ShardKeyPattern, ExtractDocShardKeyGeo) {
+
+        //
+        // Geo ShardKeyPattern
+        //
+
+        ShardKeyPattern pattern(BSON("a.b" << "2dsphere"));
+        ASSERT(pattern.isGeoPattern());
+        ASSERT(!pattern.isHashedPattern());
+
+        const BSONObj point = fromjson("{a:{b:{type:'Point', coordinates:[40, 5]}}}");
+        const BSONObj key = geoIndexKey(pattern, point);
+        ASSERT_EQUALS(docKey(pattern, point), key);
+        ASSERT_EQUALS(docKey(pattern, fromjson("{a:{b:[40, 5]}, c:30}")), key);
+        ASSERT_EQUALS(docKey(pattern, fromjson("{a:{c:30, b:{x:40, y:5}}}")), key);
+        ASSERT_NOT_EQUALS(docKey(pattern, fromjson("{a:{b:[40, 6]}}")), key);
+
+        ASSERT_EQUALS(docKey(pattern, fromjson("{a:{c:[40, 5]}}")), BSONObj());
+        ASSERT_EQUALS(docKey(pattern, fromjson("{a:{b:[200, 5]}}")), BSONObj());
+        ASSERT_EQUALS(docKey(pattern, fromjson("{a:{b:'hi'}}")), BSONObj());
+        ASSERT_EQUALS(docKey(pattern, fromjson("{a:[{b:[40, 5]}]}")), BSONObj());
+        ASSERT_EQUALS(docKey(pattern,
+                             fromjson("{a:{b:{type:'LineString', "
+                                      "coordinates:[[40, 5], [41, 6]]}}}")),
+                      BSONObj());
+    }
+
+    TEST(ShardKeyPattern, ExtractDocShardKeysBatch) {
+
+        // The batch gives what extracting one document at a time would, hashed or not
+        vector<BSONObj> docs;
+        for (int i = 0; i < 10; i++) {
+            if (i % 4 == 3)
+                docs.push_back(BSON("a" << BSON("c" << i)));
+            else if (i % 4 == 2)
+                docs.push_back(BSON("a" << BSON("b" << BSON_ARRAY(i))));
+            else
+                docs.push_back(BSON("a" << BSON("b" << i << "c" << string(i * 10, 'x'))));
+        }
+
+        const BSONObj patterns[] = { BSON("a.b" << "hashed"), BSON("a.b" << 1) };
+        for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+            ShardKeyPattern pattern(patterns[p]);
+            vector<BSONObj> keys;
+            pattern.extractShardKeysFromDocs(docs, &keys);
+            ASSERT_EQUALS(docs.size(), keys.size());
+            for (size_t i = 0; i < docs.size(); i++) {
+                ASSERT_EQUALS(docKey(pattern, docs[i]), keys[i]);
+            }
+        }
+    }
+
     static BSONObj queryKey(const ShardKeyPattern& pattern, const BSONObj& query) {
         StatusWith<BSONObj> status = pattern.extractShardKeyFromQuery(query);
         if (!status.isOK())
@@ -407,6 +477,20 @@ namespace {
         ASSERT_EQUALS(queryKey(pattern, BSON("a" << BSON_ARRAY(BSON("b" << value)))), BSONObj());
     }
 
+    TEST(ShardKeyPattern, ExtractQueryShardKeyGeo) {
+
+        ShardKeyPattern pattern(BSON("a" << "2dsphere"));
+        const BSONObj key = geoIndexKey(pattern, fromjson("{a:[40, 5]}"));
+
+        // Equalities with a point target its cell, geo predicates have no single shard key
+        ASSERT_EQUALS(queryKey(pattern, fromjson("{a:[40, 5]}")), key);
+        ASSERT_EQUALS(queryKey(pattern, fromjson("{a:{type:'Point', coordinates:[40, 5]}}")),
+                      key);
+        ASSERT_EQUALS(queryKey(pattern, fromjson("{a:{$geoWithin:{$centerSphere:[[40, 5], 0.01]}}}")),
+                      BSONObj());
+        ASSERT_EQUALS(queryKey(pattern, fromjson("{a:'hi'}")), BSONObj());
+    }
+
     static bool indexComp(const ShardKeyPattern& pattern, const BSONObj& indexPattern) {
         return pattern.isUniqueIndexCompatible(indexPattern);
     }
@@ -423,6 +423,21 @@ namespace mongo {
         }
     }
 
+    bool ShardConnection::attachVersion( ChunkVersion* version ) {
+        if ( _finishedInit || ! _manager )
+            return false;
+
+        if ( ! versionManager.canAttachShardVersionCB( _conn, _ns ) )
+            return false;
+
+        verify( _manager->getns() == _ns );
+        *version = _manager->getVersion( Shard::make( _conn->getServerAddress() ).getName() );
+
+        _finishedInit = true;
+        _setVersion = false;
+        return true;
+    }
+
     void ShardConnection::done() {
         if ( _conn ) {
             ClientConnections::threadInstance()->done( _addr , _conn );
@@ -397,4 +397,26 @@ namespace mongo {
         return checkShardVersion( conn_in->get(), conn_in->getNS(), conn_in->getManager(), authoritative, tryNumber );
     }
 
+    /**
+     * A request may carry its shard version instead of the connection setting it with
+     * setShardVersion once the connection has been through a full handshake for the namespace,
+     * which initialized sharding on the shard and had it load the namespace's metadata.
+     */
+    bool VersionManager::canAttachShardVersionCB( DBClientBase* conn_in , const string& ns ) {
+        if ( ns.empty() || ! isVersionableCB( conn_in ) )
+            return false;
+
+        DBClientBase* conn = NULL;
+        try {
+            // May throw if replica set primary is down
+            conn = getVersionable( conn_in );
+        }
+        catch ( const DBException& ) {
+            return false;
+        }
+
+        unsigned long long sequenceNumber = 0;
+        return connectionShardStatus.getSequence( conn, ns, &sequenceNumber );
+    }
+
 }  // namespace mongo
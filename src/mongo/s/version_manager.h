@@ -43,6 +43,7 @@ namespace mongo {
         bool forceRemoteCheckShardVersionCB( const std::string& );
         bool checkShardVersionCB( DBClientBase*, const std::string&, bool, int );
         bool checkShardVersionCB( ShardConnection*, bool, int );
+        bool canAttachShardVersionCB( DBClientBase*, const std::string& );
         void resetShardVersionCB( DBClientBase* );
 
     };
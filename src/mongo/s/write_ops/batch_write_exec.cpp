@@ -32,8 +32,10 @@
 
 #include "mongo/s/write_ops/batch_write_exec.h"
 
+#include <deque>
+#include <map>
+
 #include "mongo/base/error_codes.h"
-#include "mongo/base/owned_pointer_map.h"
 #include "mongo/base/status.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/client/dbclientinterface.h" // ConnectionString (header-only)
@@ -60,7 +62,40 @@ namespace mongo {
         //
 
         // TODO: Unordered map?
-        typedef OwnedPointerMap<ConnectionString, TargetedWriteBatch> OwnedHostBatchMap;
+        typedef map<ConnectionString, deque<TargetedWriteBatch*> > HostBatchQueueMap;
+    }
+
+    // The number of child batches which may be outstanding at once on a single host
+    static const size_t kMaxInFlightBatchesPerHost( 4 );
+
+    // Helper to hand the next batches for a host to the dispatcher while its window has room
+    static void sendBatches( const ConnectionString& shardHost,
+                             const BatchWriteOp& batchOp,
+                             const BatchedCommandRequest& clientRequest,
+                             MultiCommandDispatch* dispatcher,
+                             deque<TargetedWriteBatch*>* unsent,
+                             HostBatchQueueMap* pendingBatches ) {
+
+        deque<TargetedWriteBatch*>& pending = ( *pendingBatches )[shardHost];
+        while ( !unsent->empty() && pending.size() < kMaxInFlightBatchesPerHost ) {
+
+            TargetedWriteBatch* nextBatch = unsent->front();
+            unsent->pop_front();
+
+            BatchedCommandRequest request( clientRequest.getBatchType() );
+            batchOp.buildBatchRequest( *nextBatch, &request );
+
+            // Internally we use full namespaces for request/response, but we send the
+            // command to a database with the collection name in the request.
+            NamespaceString nss( request.getNS() );
+            request.setNS( nss.coll() );
+
+            LOG( 4 ) << "sending write batch to " << shardHost.toString() << ": "
+                     << request.toString() << endl;
+
+            dispatcher->addCommand( shardHost, nss.db(), request );
+            pending.push_back( nextBatch );
+        }
     }
 
     static void buildErrorFrom( const Status& status, WriteErrorDetail* error ) {
@@ -151,161 +186,129 @@ namespace mongo {
             //
             // Send all child batches
             //
+            // Each host has up to kMaxInFlightBatchesPerHost of its batches in flight, and gets the
+            // next one as soon as it answers one, rather than once all the hosts have answered.
+            //
 
-            size_t numSent = 0;
-            size_t numToSend = childBatches.size();
             bool remoteMetadataChanging = false;
-            while ( numSent != numToSend ) {
-
-                // Collect batches out on the network, mapped by endpoint
-                OwnedHostBatchMap ownedPendingBatches;
-                OwnedHostBatchMap::MapType& pendingBatches = ownedPendingBatches.mutableMap();
-
-                //
-                // Send side
-                //
-
-                // Get as many batches as we can at once
-                for ( vector<TargetedWriteBatch*>::iterator it = childBatches.begin();
-                    it != childBatches.end(); ++it ) {
-
-                    //
-                    // Collect the info needed to dispatch our targeted batch
-                    //
-
-                    TargetedWriteBatch* nextBatch = *it;
-                    // If the batch is NULL, we sent it previously, so skip
-                    if ( nextBatch == NULL ) continue;
-
-                    // Figure out what host we need to dispatch our targeted batch
-                    ConnectionString shardHost;
-                    Status resolveStatus = _resolver->chooseWriteHost( nextBatch->getEndpoint()
-                                                                           .shardName,
-                                                                       &shardHost );
-                    if ( !resolveStatus.isOK() ) {
-
-                        ++_stats->numResolveErrors;
-
-                        // Record a resolve failure
-                        // TODO: It may be necessary to refresh the cache if stale, or maybe just
-                        // cancel and retarget the batch
-                        WriteErrorDetail error;
-                        buildErrorFrom( resolveStatus, &error );
-
-                        LOG( 4 ) << "unable to send write batch to " << shardHost.toString()
-                                 << causedBy( resolveStatus.toString() ) << endl;
-
-                        batchOp.noteBatchError( *nextBatch, error );
-
-                        // We're done with this batch
-                        // Clean up when we can't resolve a host
-                        delete *it;
-                        *it = NULL;
-                        --numToSend;
-                        continue;
-                    }
 
-                    // If we already have a batch for this host, wait until the next time
-                    OwnedHostBatchMap::MapType::iterator pendingIt = pendingBatches.find( shardHost );
-                    if ( pendingIt != pendingBatches.end() ) continue;
+            // Batches not sent yet and batches waiting for a response, by host.  The dispatcher
+            // returns the responses of a host in the order its batches were sent.
+            HostBatchQueueMap unsentBatches;
+            HostBatchQueueMap pendingBatches;
 
-                    //
-                    // We now have all the info needed to dispatch the batch
-                    //
+            for ( vector<TargetedWriteBatch*>::iterator it = childBatches.begin();
+                it != childBatches.end(); ++it ) {
 
-                    BatchedCommandRequest request( clientRequest.getBatchType() );
-                    batchOp.buildBatchRequest( *nextBatch, &request );
+                TargetedWriteBatch* nextBatch = *it;
 
-                    // Internally we use full namespaces for request/response, but we send the
-                    // command to a database with the collection name in the request.
-                    NamespaceString nss( request.getNS() );
-                    request.setNS( nss.coll() );
+                // Figure out what host we need to dispatch our targeted batch
+                ConnectionString shardHost;
+                Status resolveStatus = _resolver->chooseWriteHost( nextBatch->getEndpoint()
+                                                                       .shardName,
+                                                                   &shardHost );
+                if ( !resolveStatus.isOK() ) {
 
-                    LOG( 4 ) << "sending write batch to " << shardHost.toString() << ": "
-                             << request.toString() << endl;
+                    ++_stats->numResolveErrors;
 
-                    _dispatcher->addCommand( shardHost, nss.db(), request );
+                    // Record a resolve failure
+                    // TODO: It may be necessary to refresh the cache if stale, or maybe just
+                    // cancel and retarget the batch
+                    WriteErrorDetail error;
+                    buildErrorFrom( resolveStatus, &error );
 
-                    // Indicate we're done by setting the batch to NULL
-                    // We'll only get duplicate hostEndpoints if we have broadcast and non-broadcast
-                    // endpoints for the same host, so this should be pretty efficient without
-                    // moving stuff around.
-                    *it = NULL;
+                    LOG( 4 ) << "unable to send write batch to " << shardHost.toString()
+                             << causedBy( resolveStatus.toString() ) << endl;
 
-                    // Recv-side is responsible for cleaning up the nextBatch when used
-                    pendingBatches.insert( make_pair( shardHost, nextBatch ) );
+                    batchOp.noteBatchError( *nextBatch, error );
+                    continue;
                 }
 
-                // Send them all out
-                _dispatcher->sendAll();
-                numSent += pendingBatches.size();
+                unsentBatches[shardHost].push_back( nextBatch );
+            }
 
-                //
-                // Recv side
-                //
+            for ( HostBatchQueueMap::iterator it = unsentBatches.begin();
+                it != unsentBatches.end(); ++it ) {
+                sendBatches( it->first, batchOp, clientRequest, _dispatcher, &it->second,
+                             &pendingBatches );
+            }
+            _dispatcher->sendAll();
 
-                while ( _dispatcher->numPending() > 0 ) {
+            //
+            // Recv side
+            //
 
-                    // Get the response
-                    ConnectionString shardHost;
-                    BatchedCommandResponse response;
-                    Status dispatchStatus = _dispatcher->recvAny( &shardHost, &response );
+            while ( _dispatcher->numPending() > 0 ) {
 
-                    // Get the TargetedWriteBatch to find where to put the response
-                    dassert( pendingBatches.find( shardHost ) != pendingBatches.end() );
-                    TargetedWriteBatch* batch = pendingBatches.find( shardHost )->second;
+                // Get the response
+                ConnectionString shardHost;
+                BatchedCommandResponse response;
+                Status dispatchStatus = _dispatcher->recvAny( &shardHost, &response );
 
-                    if ( dispatchStatus.isOK() ) {
+                // Get the TargetedWriteBatch to find where to put the response
+                HostBatchQueueMap::iterator pendingIt = pendingBatches.find( shardHost );
+                dassert( pendingIt != pendingBatches.end() && !pendingIt->second.empty() );
+                TargetedWriteBatch* batch = pendingIt->second.front();
+                pendingIt->second.pop_front();
 
-                        TrackedErrors trackedErrors;
-                        trackedErrors.startTracking( ErrorCodes::StaleShardVersion );
+                if ( dispatchStatus.isOK() ) {
 
-                        LOG( 4 ) << "write results received from " << shardHost.toString() << ": "
-                                 << response.toString() << endl;
+                    TrackedErrors trackedErrors;
+                    trackedErrors.startTracking( ErrorCodes::StaleShardVersion );
 
-                        // Dispatch was ok, note response
-                        batchOp.noteBatchResponse( *batch, response, &trackedErrors );
+                    LOG( 4 ) << "write results received from " << shardHost.toString() << ": "
+                             << response.toString() << endl;
 
-                        // Note if anything was stale
-                        const vector<ShardError*>& staleErrors =
-                            trackedErrors.getErrors( ErrorCodes::StaleShardVersion );
+                    // Dispatch was ok, note response
+                    batchOp.noteBatchResponse( *batch, response, &trackedErrors );
 
-                        if ( staleErrors.size() > 0 ) {
-                            noteStaleResponses( staleErrors, _targeter );
-                            ++_stats->numStaleBatches;
-                        }
+                    // Note if anything was stale
+                    const vector<ShardError*>& staleErrors =
+                        trackedErrors.getErrors( ErrorCodes::StaleShardVersion );
 
-                        // Remember if the shard is actively changing metadata right now
-                        if ( isShardMetadataChanging( staleErrors ) ) {
-                            remoteMetadataChanging = true;
-                        }
+                    if ( staleErrors.size() > 0 ) {
+                        noteStaleResponses( staleErrors, _targeter );
+                        ++_stats->numStaleBatches;
+                    }
 
-                        // Remember that we successfully wrote to this shard
-                        // NOTE: This will record lastOps for shards where we actually didn't update
-                        // or delete any documents, which preserves old behavior but is conservative
-                        _stats->noteWriteAt( shardHost,
-                                             response.isLastOpSet() ? 
-                                             response.getLastOp() : OpTime(),
-                                             response.isElectionIdSet() ?
-                                             response.getElectionId() : OID());
+                    // Remember if the shard is actively changing metadata right now
+                    if ( isShardMetadataChanging( staleErrors ) ) {
+                        remoteMetadataChanging = true;
                     }
-                    else {
 
-                        // Error occurred dispatching, note it
+                    // Remember that we successfully wrote to this shard
+                    // NOTE: This will record lastOps for shards where we actually didn't update
+                    // or delete any documents, which preserves old behavior but is conservative
+                    _stats->noteWriteAt( shardHost,
+                                         response.isLastOpSet() ? 
+                                         response.getLastOp() : OpTime(),
+                                         response.isElectionIdSet() ?
+                                         response.getElectionId() : OID());
+                }
+                else {
 
-                        stringstream msg;
-                        msg << "write results unavailable from " << shardHost.toString()
-                            << causedBy( dispatchStatus.toString() );
+                    // Error occurred dispatching, note it
 
-                        WriteErrorDetail error;
-                        buildErrorFrom( Status( ErrorCodes::RemoteResultsUnavailable, msg.str() ),
-                                        &error );
+                    stringstream msg;
+                    msg << "write results unavailable from " << shardHost.toString()
+                        << causedBy( dispatchStatus.toString() );
 
-                        LOG( 4 ) << "unable to receive write results from " << shardHost.toString()
-                                 << causedBy( dispatchStatus.toString() ) << endl;
+                    WriteErrorDetail error;
+                    buildErrorFrom( Status( ErrorCodes::RemoteResultsUnavailable, msg.str() ),
+                                    &error );
 
-                        batchOp.noteBatchError( *batch, error );
-                    }
+                    LOG( 4 ) << "unable to receive write results from " << shardHost.toString()
+                             << causedBy( dispatchStatus.toString() ) << endl;
+
+                    batchOp.noteBatchError( *batch, error );
+                }
+
+                // Keep the host's window full
+                HostBatchQueueMap::iterator unsentIt = unsentBatches.find( shardHost );
+                if ( unsentIt != unsentBatches.end() && !unsentIt->second.empty() ) {
+                    sendBatches( shardHost, batchOp, clientRequest, _dispatcher,
+                                 &unsentIt->second, &pendingBatches );
+                    _dispatcher->sendAll();
                 }
             }
 
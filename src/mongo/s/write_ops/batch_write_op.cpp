@@ -29,6 +29,7 @@
 #include "mongo/s/write_ops/batch_write_op.h"
 
 #include "mongo/base/error_codes.h"
+#include "mongo/base/owned_pointer_vector.h"
 
 namespace mongo {
 
@@ -55,6 +56,10 @@ namespace mongo {
         return newWriteConcern.obj();
     }
 
+    // How many inserts at most are targeted together.  An ordered batch may stop early and
+    // target its remaining writes again in the next round, so this doesn't cover the whole batch.
+    static const size_t kInsertTargetingWindow = 128;
+
     BatchWriteStats::BatchWriteStats() :
         numInserted( 0 ), numUpserted( 0 ), numMatched( 0 ), numModified( 0 ), numDeleted( 0 ) {
     }
@@ -175,6 +180,22 @@ namespace mongo {
         }
     }
 
+    // Helper to determine whether a write doesn't fit in a targeted batch
+    static bool wouldMakeBatchTooBig(const BatchSize& batchSize, int writeSizeBytes) {
+
+        if (batchSize.numOps >= static_cast<int>(BatchedCommandRequest::kMaxWriteBatchSize)) {
+            // Too many items in batch
+            return true;
+        }
+
+        if (batchSize.sizeBytes + writeSizeBytes > BSONObjMaxUserSize) {
+            // Batch would be too big
+            return true;
+        }
+
+        return false;
+    }
+
     // Helper to determine whether a number of targeted writes require a new targeted batch
     static bool wouldMakeBatchesTooBig(const vector<TargetedWrite*>& writes,
                                        int writeSizeBytes,
@@ -190,15 +211,7 @@ namespace mongo {
                 continue;
             }
 
-            const BatchSize& batchSize = seenIt->second;
-
-            if (batchSize.numOps >= static_cast<int>(BatchedCommandRequest::kMaxWriteBatchSize)) {
-                // Too many items in batch
-                return true;
-            }
-
-            if (batchSize.sizeBytes + writeSizeBytes > BSONObjMaxUserSize) {
-                // Batch would be too big
+            if (wouldMakeBatchTooBig(seenIt->second, writeSizeBytes)) {
                 return true;
             }
         }
@@ -206,6 +219,34 @@ namespace mongo {
         return false;
     }
 
+    // Helper to move the targeted batches which have no room left for the writes out of the
+    // maps, so that the writes start new batches to the same endpoints
+    static void closeFullBatches(const vector<TargetedWrite*>& writes,
+                                 int writeSizeBytes,
+                                 TargetedBatchMap* batchMap,
+                                 TargetedBatchSizeMap* batchSizes,
+                                 vector<TargetedWriteBatch*>* fullBatches) {
+
+        for (vector<TargetedWrite*>::const_iterator it = writes.begin(); it != writes.end(); ++it) {
+
+            const TargetedWrite* write = *it;
+            TargetedBatchSizeMap::iterator seenIt = batchSizes->find(&write->endpoint);
+
+            if (seenIt == batchSizes->end() || !wouldMakeBatchTooBig(seenIt->second,
+                                                                     writeSizeBytes)) {
+                continue;
+            }
+
+            TargetedBatchMap::iterator batchIt = batchMap->find(&write->endpoint);
+            dassert(batchIt != batchMap->end());
+            fullBatches->push_back(batchIt->second);
+
+            // The map keys point into the batches, which are still alive
+            batchSizes->erase(seenIt);
+            batchMap->erase(batchIt);
+        }
+    }
+
     // Helper function to cancel all the write ops of targeted batches in a map
     static void cancelBatches( const WriteErrorDetail& why,
                                WriteOp* writeOps,
@@ -238,6 +279,27 @@ namespace mongo {
         batchMap->clear();
     }
 
+    // Helper function to cancel all the write ops of a list of targeted batches
+    static void cancelBatches( const WriteErrorDetail& why,
+                               WriteOp* writeOps,
+                               vector<TargetedWriteBatch*>* batches ) {
+
+        for ( vector<TargetedWriteBatch*>::iterator it = batches->begin(); it != batches->end();
+            ++it ) {
+
+            TargetedWriteBatch* batch = *it;
+            const vector<TargetedWrite*>& writes = batch->getWrites();
+
+            for ( vector<TargetedWrite*>::const_iterator writeIt = writes.begin();
+                writeIt != writes.end(); ++writeIt ) {
+                writeOps[( *writeIt )->writeOpRef.first].cancelWrites( &why );
+            }
+
+            delete batch;
+        }
+        batches->clear();
+    }
+
     Status BatchWriteOp::targetBatch( const NSTargeter& targeter,
                                       bool recordTargetErrors,
                                       vector<TargetedWriteBatch*>* targetedBatches ) {
@@ -280,9 +342,24 @@ namespace mongo {
         TargetedBatchMap batchMap;
         TargetedBatchSizeMap batchSizes;
 
+        // Unordered batches which were filled up, to be sent alongside the ones in batchMap
+        vector<TargetedWriteBatch*> fullBatches;
+
         int numTargetErrors = 0;
 
         size_t numWriteOps = _clientRequest->sizeWriteOps();
+
+        // Documents are targeted a window at a time, so the shard keys of a window can be
+        // extracted (and hashed) together. insertSlots maps a write op to its targeting result.
+        const bool targetInsertWindows =
+            _clientRequest->getBatchType() == BatchedCommandRequest::BatchType_Insert
+            && !_clientRequest->isInsertIndexRequest();
+        vector<int> insertSlots;
+        vector<Status> insertStatuses;
+        OwnedPointerVector<ShardEndpoint> insertEndpointsOwned;
+        vector<ShardEndpoint*>& insertEndpoints = insertEndpointsOwned.mutableVector();
+        if ( targetInsertWindows ) insertSlots.resize( numWriteOps, -1 );
+
         for ( size_t i = 0; i < numWriteOps; ++i ) {
 
             WriteOp& writeOp = _writeOps[i];
@@ -298,7 +375,30 @@ namespace mongo {
             OwnedPointerVector<TargetedWrite> writesOwned;
             vector<TargetedWrite*>& writes = writesOwned.mutableVector();
 
-            Status targetStatus = writeOp.targetWrites( targeter, &writes );
+            Status targetStatus = Status::OK();
+            if ( targetInsertWindows ) {
+
+                if ( insertSlots[i] < 0 ) {
+                    vector<BSONObj> docs;
+                    for ( size_t j = i; j < numWriteOps && docs.size() < kInsertTargetingWindow;
+                          ++j ) {
+                        if ( _writeOps[j].getWriteState() != WriteOpState_Ready ) continue;
+                        insertSlots[j] = insertStatuses.size() + docs.size();
+                        docs.push_back( _clientRequest->getInsertRequest()->getDocumentsAt( j ) );
+                    }
+                    targeter.targetInserts( docs, &insertStatuses, &insertEndpoints );
+                }
+
+                const int slot = insertSlots[i];
+                ShardEndpoint* endpoint = insertEndpoints[slot];
+                insertEndpoints[slot] = NULL;
+                targetStatus = writeOp.targetInsertWrites( insertStatuses[slot],
+                                                           endpoint,
+                                                           &writes );
+            }
+            else {
+                targetStatus = writeOp.targetWrites( targeter, &writes );
+            }
 
             if ( !targetStatus.isOK() ) {
 
@@ -310,6 +410,7 @@ namespace mongo {
                     // Cancel current batch state with an error
 
                     cancelBatches( targetError, _writeOps, &batchMap );
+                    cancelBatches( targetError, _writeOps, &fullBatches );
                     dassert( batchMap.empty() );
                     return targetStatus;
                 }
@@ -358,8 +459,15 @@ namespace mongo {
             int writeSizeBytes = getWriteSizeBytes(writeOp);
             if (wouldMakeBatchesTooBig(writes, writeSizeBytes, batchSizes)) {
                 invariant(!batchMap.empty());
-                writeOp.cancelWrites(NULL);
-                break;
+
+                if (ordered) {
+                    writeOp.cancelWrites(NULL);
+                    break;
+                }
+
+                // Unordered writes just start another batch to the endpoint, which is
+                // sent in the same round as the full one
+                closeFullBatches(writes, writeSizeBytes, &batchMap, &batchSizes, &fullBatches);
             }
 
             //
@@ -405,6 +513,13 @@ namespace mongo {
         // Send back our targeted batches
         //
 
+        // Full batches come first, so each endpoint's batches are returned in write op order
+        for ( vector<TargetedWriteBatch*>::iterator it = fullBatches.begin();
+            it != fullBatches.end(); ++it ) {
+            _targeted.insert( *it );
+            targetedBatches->push_back( *it );
+        }
+
         for ( TargetedBatchMap::iterator it = batchMap.begin(); it != batchMap.end(); ++it ) {
 
             TargetedWriteBatch* batch = it->second;
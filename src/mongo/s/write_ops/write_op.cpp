@@ -112,7 +112,33 @@ namespace mongo {
         // If we had an error, stop here
         if ( !targetStatus.isOK() ) return targetStatus;
 
-        for ( vector<ShardEndpoint*>::iterator it = endpoints.begin(); it != endpoints.end();
+        addTargetedWrites( endpoints, targetedWrites );
+        return Status::OK();
+    }
+
+    Status WriteOp::targetInsertWrites( const Status& targetStatus,
+                                        ShardEndpoint* endpoint,
+                                        std::vector<TargetedWrite*>* targetedWrites ) {
+
+        dassert( _itemRef.getOpType() == BatchedCommandRequest::BatchType_Insert );
+        dassert( !_itemRef.getRequest()->isInsertIndexRequest() );
+
+        OwnedPointerVector<ShardEndpoint> endpointsOwned;
+        if ( endpoint ) endpointsOwned.mutableVector().push_back( endpoint );
+
+        if ( !targetStatus.isOK() ) {
+            dassert( NULL == endpoint );
+            return targetStatus;
+        }
+
+        addTargetedWrites( endpointsOwned.vector(), targetedWrites );
+        return Status::OK();
+    }
+
+    void WriteOp::addTargetedWrites( const std::vector<ShardEndpoint*>& endpoints,
+                                     std::vector<TargetedWrite*>* targetedWrites ) {
+
+        for ( vector<ShardEndpoint*>::const_iterator it = endpoints.begin(); it != endpoints.end();
             ++it ) {
 
             ShardEndpoint* endpoint = *it;
@@ -136,7 +162,6 @@ namespace mongo {
         }
 
         _state = WriteOpState_Pending;
-        return Status::OK();
     }
 
     size_t WriteOp::getNumTargeted() {
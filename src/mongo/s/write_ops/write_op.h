@@ -129,6 +129,15 @@ namespace mongo {
         Status targetWrites( const NSTargeter& targeter,
                              std::vector<TargetedWrite*>* targetedWrites );
 
+        /**
+         * Same as targetWrites() for a (non-index) insert which was targeted together with the
+         * rest of its batch, with 'targetStatus' and 'endpoint' as NSTargeter::targetInserts()
+         * returned them.  Takes ownership of 'endpoint'.
+         */
+        Status targetInsertWrites( const Status& targetStatus,
+                                   ShardEndpoint* endpoint,
+                                   std::vector<TargetedWrite*>* targetedWrites );
+
         /**
          * Returns the number of child writes that were last targeted.
          */
@@ -168,6 +177,12 @@ namespace mongo {
 
     private:
 
+        /**
+         * Creates the child ops and TargetedWrites for the targeted 'endpoints'.
+         */
+        void addTargetedWrites( const std::vector<ShardEndpoint*>& endpoints,
+                                std::vector<TargetedWrite*>* targetedWrites );
+
         /**
          * Updates the op state after new information is received.
          */
@@ -302,6 +302,14 @@ namespace mongo {
                                            str.size());
         }
 
+        /**
+         * Create an internalized V8 string, which is faster to look properties up with
+         */
+        inline v8::Local<v8::String> v8Symbol(const StringData& str) {
+            return v8::String::NewFromUtf8(_isolate, str.rawData(),
+                                           v8::String::kInternalizedString, str.size());
+        }
+
         /**
          * Get the isolate this scope belongs to (can be called from any thread, but v8 requires
          *  the new thread enter the isolate and context.  Only one thread can enter the isolate.
@@ -351,6 +359,16 @@ namespace mongo {
         v8::Local<v8::FunctionTemplate> LazyBsonFT()       { return _LazyBsonFT.Get(_isolate); }
         v8::Local<v8::FunctionTemplate> ROBsonFT()         { return _ROBsonFT.Get(_isolate); }
 
+        // The functions of the templates BSON is converted to.  FunctionTemplate::GetFunction()
+        // looks the function up in the context each time, so they are kept here.
+        v8::Local<v8::Function> ObjectIdFunction()   { return _ObjectIdFunction.Get(_isolate); }
+        v8::Local<v8::Function> DBPointerFunction()  { return _DBPointerFunction.Get(_isolate); }
+        v8::Local<v8::Function> BinDataFunction()    { return _BinDataFunction.Get(_isolate); }
+        v8::Local<v8::Function> NumberLongFunction() { return _NumberLongFunction.Get(_isolate); }
+        v8::Local<v8::Function> TimestampFunction()  { return _TimestampFunction.Get(_isolate); }
+        v8::Local<v8::Function> LazyBsonFunction()   { return _LazyBsonFunction.Get(_isolate); }
+        v8::Local<v8::Function> ROBsonFunction()     { return _ROBsonFunction.Get(_isolate); }
+
         template <size_t N>
         v8::Local<v8::String> strLitToV8(const char (&str)[N]) {
             // Note that _strLitMap is keyed on string pointer not string
@@ -364,7 +382,7 @@ namespace mongo {
                 return it->second.Get(_isolate);
 
             StringData sd (str, StringData::LiteralTag());
-            v8::Local<v8::String> v8Str = v8StringData(sd);
+            v8::Local<v8::String> v8Str = v8Symbol(sd);
 
             // Eternal should last as long as V8Scope exists.
             _strLitMap[str].Set(_isolate, v8Str);
@@ -384,6 +402,15 @@ namespace mongo {
          */
         void wrapBSONObject(v8::Local<v8::Object> obj, BSONObj data, bool readOnly);
 
+        /**
+         * Converts a modified lazy object to BSON by walking the BSON it wraps, copying the
+         * fields which were never read or written from JS rather than converting them.
+         */
+        void v8ToMongoLazyObject(BSONObjBuilder& b,
+                                 v8::Local<v8::Object> obj,
+                                 BSONHolder* holder,
+                                 int depth);
+
         /**
          * Trampoline to call a c++ function with a specific signature (V8Scope*,
          * v8::FunctionCallbackInfo<v8::Value>&).
@@ -478,6 +505,14 @@ namespace mongo {
         v8::Eternal<v8::FunctionTemplate> _LazyBsonFT;
         v8::Eternal<v8::FunctionTemplate> _ROBsonFT;
 
+        v8::Eternal<v8::Function> _ObjectIdFunction;
+        v8::Eternal<v8::Function> _DBPointerFunction;
+        v8::Eternal<v8::Function> _BinDataFunction;
+        v8::Eternal<v8::Function> _NumberLongFunction;
+        v8::Eternal<v8::Function> _TimestampFunction;
+        v8::Eternal<v8::Function> _LazyBsonFunction;
+        v8::Eternal<v8::Function> _ROBsonFunction;
+
         v8::Eternal<v8::Function> _jsRegExpConstructor;
 
         /// Like v8::Isolate* but calls Dispose() in destructor.
@@ -559,7 +594,7 @@ namespace mongo {
          */
         DeadlineMonitor<V8Scope>* getDeadlineMonitor() { return &_deadlineMonitor; }
 
-        typedef map<unsigned, V8Scope*> OpIdToScopeMap;
+        typedef multimap<unsigned, V8Scope*> OpIdToScopeMap;
         mongo::mutex _globalInterruptLock;  // protects map of all operation ids -> scope
         OpIdToScopeMap _opToScopeMap;       // map of mongo op ids to scopes (protected by
                                             // _globalInterruptLock).
@@ -56,6 +56,47 @@ namespace mongo {
         extern const JSFile assert;
     }
 
+    /**
+     * Whether converting 'elem' to JS and back gives the same element, so that the fields of lazy
+     * objects that JS never touched can be copied.
+     */
+    static bool roundTripsUnchanged(const BSONElement& elem) {
+        switch (elem.type()) {
+        case mongo::NumberDouble:
+        case mongo::NumberInt:
+        case mongo::NumberLong:
+        case mongo::String:
+        case mongo::jstOID:
+        case mongo::Bool:
+        case mongo::jstNULL:
+        case mongo::BinData:
+        case mongo::MinKey:
+        case mongo::MaxKey:
+            return true;
+        case mongo::Date: {
+            // the range of JS dates
+            const long long millis = elem.date().asInt64();
+            return millis <= 8640000000000000LL && millis >= -8640000000000000LL;
+        }
+        case mongo::Object: {
+            // an unread object is still the unmodified lazy object, unless it was a DBRef
+            const BSONObj obj = elem.embeddedObject();
+            return !(obj.firstElementType() == mongo::String &&
+                     str::equals(obj.firstElementFieldName(), "$ref"));
+        }
+        default:
+            return false;
+        }
+    }
+
+    static bool hasIndexLikeFieldName(const BSONObj& obj) {
+        for (BSONObjIterator it(obj); it.more();) {
+            if (isdigit(static_cast<unsigned char>(*it.next().fieldName())))
+                return true;
+        }
+        return false;
+    }
+
     // The  unwrapXXX functions extract internal fields from an object wrapped by wrapBSONObject.
     // These functions are currently only used in places that should always have the correct
     // type of object, however it may be possible for users to come up with a way to make these
@@ -112,13 +153,15 @@ namespace mongo {
                 return handle_scope.Close(realObject->Get(name));
             }
 
-            string key = toSTLString(name);
+            V8String key (name);
             BSONHolder* holder = unwrapHolder(scope, info.Holder());
-            if (!holder || holder->_removed.count(key))
+            if (!holder)
+                return handle_scope.Close(v8::Handle<v8::Value>());
+            if (!holder->_removed.empty() && holder->_removed.count(StringData(key).toString()))
                 return handle_scope.Close(v8::Handle<v8::Value>());
 
             BSONObj obj = holder->_obj;
-            BSONElement elmt = obj.getField(key.c_str());
+            BSONElement elmt = obj.getField(key);
             if (elmt.eoo())
                 return handle_scope.Close(v8::Handle<v8::Value>());
 
@@ -179,10 +222,10 @@ namespace mongo {
         for (BSONObjIterator it(obj); it.more();) {
             const BSONElement& f = it.next();
             StringData sname (f.fieldName(), f.fieldNameSize()-1);
-            if (holder->_removed.count(sname.toString()))
+            if (!holder->_removed.empty() && holder->_removed.count(sname.toString()))
                 continue;
 
-            v8::Handle<v8::String> name = scope->v8StringData(sname);
+            v8::Handle<v8::String> name = scope->v8Symbol(sname);
             added.insert(sname);
             out->Set(outIndex++, name);
         }
@@ -366,15 +409,19 @@ namespace mongo {
 
      void V8ScriptEngine::interrupt(unsigned opId) {
          mongo::mutex::scoped_lock intLock(_globalInterruptLock);
-         OpIdToScopeMap::iterator iScope = _opToScopeMap.find(opId);
-         if (iScope == _opToScopeMap.end()) {
+         std::pair<OpIdToScopeMap::iterator, OpIdToScopeMap::iterator> scopes =
+             _opToScopeMap.equal_range(opId);
+         if (scopes.first == scopes.second) {
              // got interrupt request for a scope that no longer exists
              LOG(1) << "received interrupt request for unknown op: " << opId
                     << printKnownOps_inlock() << endl;
              return;
          }
          LOG(1) << "interrupting op: " << opId << printKnownOps_inlock() << endl;
-         iScope->second->kill();
+         // an operation may run several scopes at once, e.g. a parallel mapReduce map phase
+         for (OpIdToScopeMap::iterator iScope = scopes.first; iScope != scopes.second; ++iScope) {
+             iScope->second->kill();
+         }
      }
 
      void V8ScriptEngine::interruptAll() {
@@ -390,7 +437,7 @@ namespace mongo {
          if (_engine->haveGetCurrentOpIdCallback()) {
              // this scope has an associated operation
              _opId = _engine->getCurrentOpId();
-             _engine->_opToScopeMap[_opId] = this;
+             _engine->_opToScopeMap.insert(std::make_pair(_opId, this));
          }
          else
              // no associated op id (e.g. running from shell)
@@ -403,9 +450,14 @@ namespace mongo {
          LOG(2) << "V8Scope " << static_cast<const void*>(this) << " unregistered for op " << _opId << endl;
         if (_engine->haveGetCurrentOpIdCallback() || _opId != 0) {
             // scope is currently associated with an operation id
-            V8ScriptEngine::OpIdToScopeMap::iterator it = _engine->_opToScopeMap.find(_opId);
-            if (it != _engine->_opToScopeMap.end())
-                _engine->_opToScopeMap.erase(it);
+            typedef V8ScriptEngine::OpIdToScopeMap::iterator Iterator;
+            std::pair<Iterator, Iterator> scopes = _engine->_opToScopeMap.equal_range(_opId);
+            for (Iterator it = scopes.first; it != scopes.second; ++it) {
+                if (it->second == this) {
+                    _engine->_opToScopeMap.erase(it);
+                    break;
+                }
+            }
         }
     }
 
@@ -539,6 +591,9 @@ namespace mongo {
                                              v8::Boolean::New(true),
                                              v8::DontEnum);
 
+        _LazyBsonFunction = v8::Persistent<v8::Function>::New(LazyBsonFT()->GetFunction());
+        _ROBsonFunction = v8::Persistent<v8::Function>::New(ROBsonFT()->GetFunction());
+
         injectV8Function("print", Print);
         injectV8Function("version", Version);  // TODO: remove
         injectV8Function("gc", GCV8);
@@ -1299,6 +1354,13 @@ namespace mongo {
         injectV8Function("NumberInt", NumberIntFT(), _global);
         injectV8Function("Timestamp", TimestampFT(), _global);
 
+        typedef v8::Persistent<v8::Function> FuncPtr;
+        _ObjectIdFunction   = FuncPtr::New(ObjectIdFT()->GetFunction());
+        _DBPointerFunction  = FuncPtr::New(DBPointerFT()->GetFunction());
+        _BinDataFunction    = FuncPtr::New(BinDataFT()->GetFunction());
+        _NumberLongFunction = FuncPtr::New(NumberLongFT()->GetFunction());
+        _TimestampFunction  = FuncPtr::New(TimestampFT()->GetFunction());
+
         // These are instances created from the functions, not the functions themselves
         _global->ForceSet(strLitToV8("MinKey"), MinKeyFT()->GetFunction()->NewInstance());
         _global->ForceSet(strLitToV8("MaxKey"), MaxKeyFT()->GetFunction()->NewInstance());
@@ -1351,7 +1413,7 @@ namespace mongo {
 
     v8::Local<v8::Value> V8Scope::newId(const OID &id) {
         v8::HandleScope handle_scope;
-        v8::Handle<v8::Function> idCons = ObjectIdFT()->GetFunction();
+        v8::Handle<v8::Function> idCons = ObjectIdFunction();
         v8::Handle<v8::Value> argv[1];
         const string& idString = id.toString();
         argv[0] = v8::String::New(idString.c_str(), idString.length());
@@ -1374,14 +1436,14 @@ namespace mongo {
                 v8::Local<v8::Object> dbRef = DBRefFT()->GetFunction()->NewInstance(2, args);
                 while (it.more()) {
                     BSONElement elem = it.next();
-                    dbRef->Set(v8StringData(elem.fieldName()), mongoToV8Element(elem, readOnly));
+                    dbRef->Set(v8Symbol(elem.fieldName()), mongoToV8Element(elem, readOnly));
                 }
                 return dbRef;
             }
         }
 
-        v8::Handle<v8::FunctionTemplate> templ = readOnly ? ROBsonFT() : LazyBsonFT();
-        v8::Handle<v8::Object> o = templ->GetFunction()->NewInstance();
+        v8::Handle<v8::Function> cons = readOnly ? ROBsonFunction() : LazyBsonFunction();
+        v8::Handle<v8::Object> o = cons->NewInstance();
         massert(16496, str::stream() << "V8: NULL Object template instantiated. "
                                      << (v8::V8::IsExecutionTerminating() ?
                                         "v8 execution is terminating." :
@@ -1463,7 +1525,7 @@ namespace mongo {
             base64::encode(ss, data, len);
             argv[0] = v8::Number::New(elem.binDataType());
             argv[1] = v8::String::New(ss.str().c_str());
-            return BinDataFT()->GetFunction()->NewInstance(2, argv);
+            return BinDataFunction()->NewInstance(2, argv);
         }
         case mongo::Timestamp: {
             v8::TryCatch tryCatch;
@@ -1471,7 +1533,7 @@ namespace mongo {
             argv[0] = v8::Number::New(elem.timestampTime() / 1000);
             argv[1] = v8::Number::New(elem.timestampInc());
 
-            v8::Handle<v8::Value> ret = TimestampFT()->GetFunction()->NewInstance(2,argv);
+            v8::Handle<v8::Value> ret = TimestampFunction()->NewInstance(2,argv);
             uassert(17355, str::stream() << "Error converting " << elem.toString(false)
                                          << " in field " << elem.fieldName()
                                          << " to a JS Timestamp object: "
@@ -1487,14 +1549,14 @@ namespace mongo {
                 (long long)(double)(long long)(nativeUnsignedLong) &&
                     nativeUnsignedLong < 9007199254740992ULL) {
                 argv[0] = v8::Number::New((double)(long long)(nativeUnsignedLong));
-                return NumberLongFT()->GetFunction()->NewInstance(1, argv);
+                return NumberLongFunction()->NewInstance(1, argv);
             }
             else {
                 argv[0] = v8::Number::New((double)(long long)(nativeUnsignedLong));
                 argv[1] = v8::Integer::New(nativeUnsignedLong >> 32);
                 argv[2] = v8::Integer::New((unsigned long)
                                            (nativeUnsignedLong & 0x00000000ffffffff));
-                return NumberLongFT()->GetFunction()->NewInstance(3, argv);
+                return NumberLongFunction()->NewInstance(3, argv);
             }
         case mongo::MinKey:
             return MinKeyFT()->GetFunction()->NewInstance();
@@ -1503,7 +1565,7 @@ namespace mongo {
         case mongo::DBRef:
             argv[0] = v8StringData(elem.dbrefNS());
             argv[1] = newId(elem.dbrefOID());
-            return DBPointerFT()->GetFunction()->NewInstance(2, argv);
+            return DBPointerFunction()->NewInstance(2, argv);
         default:
             massert(16661, str::stream() << "can't handle type: " << elem.type()
                                          << " " << elem.toString(), false);
@@ -1646,9 +1708,16 @@ namespace mongo {
             BSONObjBuilder arrBuilder(b.subarrayStart(sname));
             v8::Handle<v8::Array> array = value.As<v8::Array>();
             const int len = array->Length();
+
+            // Numbers look their name up in originalParent to see whether they were NumberInts,
+            // which only finds the indexes of an array if the parent has names like them.
+            BSONObj noParent;
+            BSONObj* elementsParent =
+                originalParent && hasIndexLikeFieldName(*originalParent) ? originalParent
+                                                                         : &noParent;
             for (int i=0; i < len; i++) {
                 const string name = BSONObjBuilder::numStr(i);
-                v8ToMongoElement(arrBuilder, name, array->Get(i), depth+1, originalParent);
+                v8ToMongoElement(arrBuilder, name, array->Get(i), depth+1, elementsParent);
             }
             return;
         }
@@ -1680,11 +1749,55 @@ namespace mongo {
                                    << sname);
     }
 
+    void V8Scope::v8ToMongoLazyObject(BSONObjBuilder& b,
+                                      v8::Handle<v8::Object> o,
+                                      BSONHolder* holder,
+                                      int depth) {
+        // The fields come in the order namedEnumerator() gives them: those of the BSON which
+        // weren't deleted, then those only set from JS.  Reads cache objects and, for large
+        // BSON, any value in the real object, and writes go there too, so the fields which
+        // are not in it still hold their BSON value.
+        v8::Handle<v8::Object> realObject = unwrapObject(this, o);
+        BSONObj original = holder->_obj;
+
+        unordered_set<StringData, StringData::Hasher> inBSON;
+        for (BSONObjIterator it(original); it.more();) {
+            const BSONElement elem = it.next();
+            const StringData name (elem.fieldName(), elem.fieldNameSize() - 1);
+            const bool duplicate = !inBSON.insert(name).second;
+
+            if (depth == 0 && name == "_id")
+                continue; // already handled by v8ToMongo()
+            if (!holder->_removed.empty() && holder->_removed.count(name.toString()))
+                continue;
+
+            v8::Handle<v8::String> v8Name = v8Symbol(name);
+            if (!duplicate && !realObject->HasOwnProperty(v8Name) && roundTripsUnchanged(elem)) {
+                b.append(elem);
+                continue;
+            }
+            v8ToMongoElement(b, name, o->Get(v8Name), depth + 1, &original);
+        }
+
+        v8::Local<v8::Array> names = realObject->GetOwnPropertyNames();
+        for (unsigned int i=0; i<names->Length(); i++) {
+            v8::Local<v8::String> name = names->Get(i)->ToString();
+            V8String sname(name);
+            if (inBSON.count(sname))
+                continue;
+            if (depth == 0 && StringData(sname) == "_id")
+                continue; // already handled by v8ToMongo()
+
+            v8ToMongoElement(b, sname, realObject->Get(name), depth + 1, &original);
+        }
+    }
+
     BSONObj V8Scope::v8ToMongo(v8::Handle<v8::Object> o, int depth) {
         BSONObj originalBSON;
+        BSONHolder* holder = NULL;
         if (LazyBsonFT()->HasInstance(o)) {
             originalBSON = unwrapBSONObj(this, o);
-            BSONHolder* holder = unwrapHolder(this, o);
+            holder = unwrapHolder(this, o);
             if (holder && !holder->_modified) {
                 // object was not modified, use bson as is
                 return originalBSON;
@@ -1701,16 +1814,21 @@ namespace mongo {
             }
         }
 
-        v8::Local<v8::Array> names = o->GetOwnPropertyNames();
-        for (unsigned int i=0; i<names->Length(); i++) {
-            v8::Local<v8::String> name = names->Get(i)->ToString();
+        if (holder) {
+            v8ToMongoLazyObject(b, o, holder, depth);
+        }
+        else {
+            v8::Local<v8::Array> names = o->GetOwnPropertyNames();
+            for (unsigned int i=0; i<names->Length(); i++) {
+                v8::Local<v8::String> name = names->Get(i)->ToString();
 
-            if (depth == 0 && name->StrictEquals(strLitToV8("_id")))
-                continue; // already handled above
+                if (depth == 0 && name->StrictEquals(strLitToV8("_id")))
+                    continue; // already handled above
 
-            V8String sname(name);
-            v8::Local<v8::Value> value = o->Get(name);
-            v8ToMongoElement(b, sname, value, depth + 1, &originalBSON);
+                V8String sname(name);
+                v8::Local<v8::Value> value = o->Get(name);
+                v8ToMongoElement(b, sname, value, depth + 1, &originalBSON);
+            }
         }
 
         const int sizeWithEOO = b.len() + 1/*EOO*/ - 4/*BSONObj::Holder ref count*/;
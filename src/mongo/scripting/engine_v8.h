@@ -295,6 +295,13 @@ namespace mongo {
             return v8::String::New(str.rawData(), str.size());
         }
 
+        /**
+         * Create an internalized V8 string, which is faster to look properties up with
+         */
+        static inline v8::Handle<v8::String> v8Symbol(StringData str) {
+            return v8::String::NewSymbol(str.rawData(), str.size());
+        }
+
         /**
          * Get the isolate this scope belongs to (can be called from any thread, but v8 requires
          *  the new thread enter the isolate and context.  Only one thread can enter the isolate.
@@ -342,6 +349,16 @@ namespace mongo {
         v8::Handle<v8::FunctionTemplate> LazyBsonFT()       const { return _LazyBsonFT; }
         v8::Handle<v8::FunctionTemplate> ROBsonFT()         const { return _ROBsonFT; }
 
+        // The functions of the templates BSON is converted to.  FunctionTemplate::GetFunction()
+        // looks the function up in the context each time, so they are kept here.
+        v8::Handle<v8::Function> ObjectIdFunction()   const { return _ObjectIdFunction; }
+        v8::Handle<v8::Function> DBPointerFunction()  const { return _DBPointerFunction; }
+        v8::Handle<v8::Function> BinDataFunction()    const { return _BinDataFunction; }
+        v8::Handle<v8::Function> NumberLongFunction() const { return _NumberLongFunction; }
+        v8::Handle<v8::Function> TimestampFunction()  const { return _TimestampFunction; }
+        v8::Handle<v8::Function> LazyBsonFunction()   const { return _LazyBsonFunction; }
+        v8::Handle<v8::Function> ROBsonFunction()     const { return _ROBsonFunction; }
+
         template <size_t N>
         v8::Handle<v8::String> strLitToV8(const char (&str)[N]) {
             // Note that _strLitMap is keyed on std::string pointer not string
@@ -355,7 +372,7 @@ namespace mongo {
                 return it->second;
 
             StringData sd (str, StringData::LiteralTag());
-            v8::Handle<v8::String> v8Str = v8StringData(sd);
+            v8::Handle<v8::String> v8Str = v8Symbol(sd);
 
             // We never need to Dispose since this should last as long as V8Scope exists
             _strLitMap[str] = v8::Persistent<v8::String>::New(v8Str);
@@ -375,6 +392,15 @@ namespace mongo {
          */
         void wrapBSONObject(v8::Handle<v8::Object> obj, BSONObj data, bool readOnly);
 
+        /**
+         * Converts a modified lazy object to BSON by walking the BSON it wraps, copying the
+         * fields which were never read or written from JS rather than converting them.
+         */
+        void v8ToMongoLazyObject(BSONObjBuilder& b,
+                                 v8::Handle<v8::Object> obj,
+                                 BSONHolder* holder,
+                                 int depth);
+
         /**
          * Trampoline to call a c++ function with a specific signature (V8Scope*, v8::Arguments&).
          * Handles interruption, exceptions, etc.
@@ -460,6 +486,14 @@ namespace mongo {
         v8::Persistent<v8::FunctionTemplate> _LazyBsonFT;
         v8::Persistent<v8::FunctionTemplate> _ROBsonFT;
 
+        v8::Persistent<v8::Function> _ObjectIdFunction;
+        v8::Persistent<v8::Function> _DBPointerFunction;
+        v8::Persistent<v8::Function> _BinDataFunction;
+        v8::Persistent<v8::Function> _NumberLongFunction;
+        v8::Persistent<v8::Function> _TimestampFunction;
+        v8::Persistent<v8::Function> _LazyBsonFunction;
+        v8::Persistent<v8::Function> _ROBsonFunction;
+
         v8::Persistent<v8::Function> _jsRegExpConstructor;
 
         /// Like v8::Isolate* but calls Dispose() in destructor.
@@ -538,7 +572,7 @@ namespace mongo {
          */
         DeadlineMonitor<V8Scope>* getDeadlineMonitor() { return &_deadlineMonitor; }
 
-        typedef std::map<unsigned, V8Scope*> OpIdToScopeMap;
+        typedef std::multimap<unsigned, V8Scope*> OpIdToScopeMap;
         mongo::mutex _globalInterruptLock;  // protects map of all operation ids -> scope
         OpIdToScopeMap _opToScopeMap;       // map of mongo op ids to scopes (protected by
                                             // _globalInterruptLock).
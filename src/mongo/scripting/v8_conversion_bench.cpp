@@ -0,0 +1,197 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * Microbenchmarks for converting documents between BSON and the objects of the javascript
+ * engine, through the Scope interface the server's commands use.  Each benchmark logs a line
+ * of JSON starting with "SCRIPTING_BENCH" giving the time and the allocations per invocation:
+ *
+ *   SCRIPTING_BENCH { "benchmark" : "whereRead", "docs" : 20000, "micros" : 51000,
+ *                     "nsPerDoc" : 2550.0, "allocsPerDoc" : 3.1 }
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+#include "mongo/scripting/engine.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/allocation_counter.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+using namespace mongo;
+
+namespace {
+
+    const size_t kNumDocs = 20 * 1000;
+    const int kNumFields = 20;
+    const int kArrayLength = 1000;
+
+    /**
+     * Documents of kNumFields fields of mixed types, like { _id: i, a: i % 10, b: "...",
+     * n<k>: ..., sub: { x: i, y: "..." } }.
+     */
+    std::vector<BSONObj> generateDocs(size_t count) {
+        std::vector<BSONObj> docs;
+        for (size_t i = 0; i < count; i++) {
+            BSONObjBuilder doc;
+            doc.append("_id", static_cast<int>(i));
+            doc.append("a", static_cast<int>(i % 10));
+            doc.append("b", "abcdefghijklmnopqrstuvwxyz");
+            doc.append("sub", BSON("x" << static_cast<int>(i) << "y" << "nested"));
+            for (int f = 4; f < kNumFields; f++) {
+                const std::string name = str::stream() << "n" << f;
+                if (f % 2)
+                    doc.append(name, i * 1.5);
+                else
+                    doc.append(name, static_cast<long long>(i) << 20);
+            }
+            docs.push_back(doc.obj());
+        }
+        return docs;
+    }
+
+    void reportScriptingBenchmark(const std::string& name,
+                                  size_t docs,
+                                  long long micros,
+                                  unsigned long long allocations) {
+        BSONObjBuilder result;
+        result.append("benchmark", name);
+        result.appendNumber("docs", static_cast<long long>(docs));
+        result.appendNumber("micros", micros);
+        result.append("nsPerDoc", micros * 1000.0 / docs);
+        result.append("allocsPerDoc", static_cast<double>(allocations) / docs);
+        log() << "SCRIPTING_BENCH " << result.obj().jsonString();
+    }
+
+    class ScriptingBenchmark {
+    public:
+        ScriptingBenchmark() {
+            if (!globalScriptEngine)
+                ScriptEngine::setup();
+            _scope.reset(globalScriptEngine->newScope());
+        }
+
+        Scope* scope() { return _scope.get(); }
+
+        /**
+         * Invokes 'code' once per document of 'docs', passing the document as 'this' or, if
+         * 'asArgument', as its argument, and reports the time.  If 'readReturnValue' the
+         * function's return value is converted back to BSON, as the mapReduce finalize and
+         * group key functions are.
+         */
+        void run(const std::string& name,
+                 const char* code,
+                 const std::vector<BSONObj>& docs,
+                 bool asArgument,
+                 bool readReturnValue) {
+            ScriptingFunction func = _scope->createFunction(code);
+            ASSERT(func);
+
+            long long returned = 0;
+            const unsigned long long allocationsBefore = AllocationCounter::get();
+            Timer timer;
+
+            for (size_t i = 0; i < docs.size(); i++) {
+                if (asArgument) {
+                    BSONObj args = BSON("0" << docs[i]);
+                    _scope->invokeSafe(func, &args, NULL, 0, false, false, false);
+                }
+                else {
+                    _scope->invokeSafe(func, NULL, &docs[i], 0, false, true, true);
+                }
+                if (readReturnValue) {
+                    returned += _scope->getObject("__returnValue").objsize();
+                }
+            }
+
+            const long long micros = timer.micros();
+            reportScriptingBenchmark(name, docs.size(), micros,
+                                     AllocationCounter::get() - allocationsBefore);
+            ASSERT(!readReturnValue || returned > 0);
+        }
+
+    private:
+        boost::scoped_ptr<Scope> _scope;
+    };
+
+    BSONObj countEmits(const BSONObj& args, void* data) {
+        ++*static_cast<long long*>(data);
+        return BSONObj();
+    }
+
+    // Reads a few fields of a read only document, as a $where does.
+    TEST(ScriptingBench, WhereRead) {
+        ScriptingBenchmark bench;
+        bench.run("whereRead",
+                  "function() { return this.a > 5 && this.sub.x >= 0 && this.n5 > 0; }",
+                  generateDocs(kNumDocs), false, false);
+    }
+
+    // Changes one field of a document and returns it, which converts all of it back to BSON.
+    TEST(ScriptingBench, ModifyAndReturn) {
+        ScriptingBenchmark bench;
+        bench.run("modifyAndReturn",
+                  "function(doc) { doc.a = doc.a + 1; return doc; }",
+                  generateDocs(kNumDocs), true, true);
+    }
+
+    // Returns a document holding a long array of numbers.
+    TEST(ScriptingBench, NumericArray) {
+        std::vector<BSONObj> docs;
+        for (size_t i = 0; i < kNumDocs / 100; i++) {
+            BSONArrayBuilder values;
+            for (int v = 0; v < kArrayLength; v++) {
+                values.append(v * 0.5);
+            }
+            docs.push_back(BSON("_id" << static_cast<int>(i) << "values" << values.arr()));
+        }
+
+        ScriptingBenchmark bench;
+        bench.run("numericArray",
+                  "function(doc) { doc.values.push(1); return doc; }",
+                  docs, true, true);
+    }
+
+    // The map function of a mapReduce, emitting an object built from fields of the document.
+    TEST(ScriptingBench, MapEmit) {
+        long long emits = 0;
+        ScriptingBenchmark bench;
+        bench.scope()->injectNative("emit", countEmits, &emits);
+        bench.run("mapEmit",
+                  "function() { emit(this.a, { count: 1, x: this.sub.x, b: this.b }); }",
+                  generateDocs(kNumDocs), false, false);
+        ASSERT_EQUALS(static_cast<long long>(kNumDocs), emits);
+    }
+
+} // namespace
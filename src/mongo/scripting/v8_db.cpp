@@ -159,8 +159,8 @@ namespace mongo {
         ScriptEngine::runConnectCallback(*conn);
 
         args.This()->SetInternalField(0, connHandle);
-        args.This()->ForceSet(scope->v8StringData("slaveOk"), v8::Boolean::New(false));
-        args.This()->ForceSet(scope->v8StringData("host"), scope->v8StringData(host));
+        args.This()->ForceSet(scope->strLitToV8("slaveOk"), v8::Boolean::New(false));
+        args.This()->ForceSet(scope->strLitToV8("host"), scope->v8StringData(host));
 
         return v8::Undefined();
     }
@@ -178,8 +178,8 @@ namespace mongo {
         v8::Local<v8::External> connHandle = scope->dbClientBaseTracker.track(self, conn);
 
         args.This()->SetInternalField(0, connHandle);
-        args.This()->ForceSet(scope->v8StringData("slaveOk"), v8::Boolean::New(false));
-        args.This()->ForceSet(scope->v8StringData("host"), scope->v8StringData("EMBEDDED"));
+        args.This()->ForceSet(scope->strLitToV8("slaveOk"), v8::Boolean::New(false));
+        args.This()->ForceSet(scope->strLitToV8("host"), scope->strLitToV8("EMBEDDED"));
 
         return v8::Undefined();
     }
@@ -259,7 +259,7 @@ namespace mongo {
 
         verify(scope->MongoFT()->HasInstance(args.This()));
 
-        if (args.This()->Get(scope->v8StringData("readOnly"))->BooleanValue()) {
+        if (args.This()->Get(scope->strLitToV8("readOnly"))->BooleanValue()) {
             return v8AssertionException("js db in read only mode");
         }
 
@@ -279,9 +279,9 @@ namespace mongo {
                 argumentCheck(!el.IsEmpty(), "attempted to insert an array of non-object types")
 
                 // Set ID on the element if necessary
-                if (!el->Has(scope->v8StringData("_id"))) {
+                if (!el->Has(scope->strLitToV8("_id"))) {
                     v8::Handle<v8::Value> argv[1];
-                    el->ForceSet(scope->v8StringData("_id"),
+                    el->ForceSet(scope->strLitToV8("_id"),
                                  scope->ObjectIdFT()->GetFunction()->NewInstance(0, argv));
                 }
                 bos.push_back(scope->v8ToMongo(el));
@@ -290,9 +290,9 @@ namespace mongo {
         }
         else {
             v8::Handle<v8::Object> in = args[1]->ToObject();
-            if (!in->Has(scope->v8StringData("_id"))) {
+            if (!in->Has(scope->strLitToV8("_id"))) {
                 v8::Handle<v8::Value> argv[1];
-                in->ForceSet(scope->v8StringData("_id"),
+                in->ForceSet(scope->strLitToV8("_id"),
                              scope->ObjectIdFT()->GetFunction()->NewInstance(0, argv));
             }
             BSONObj o = scope->v8ToMongo(in);
@@ -307,7 +307,7 @@ namespace mongo {
 
         verify(scope->MongoFT()->HasInstance(args.This()));
 
-        if (args.This()->Get(scope->v8StringData("readOnly"))->BooleanValue()) {
+        if (args.This()->Get(scope->strLitToV8("readOnly"))->BooleanValue()) {
             return v8AssertionException("js db in read only mode");
         }
 
@@ -333,7 +333,7 @@ namespace mongo {
 
         verify(scope->MongoFT()->HasInstance(args.This()));
 
-        if (args.This()->Get(scope->v8StringData("readOnly"))->BooleanValue()) {
+        if (args.This()->Get(scope->strLitToV8("readOnly"))->BooleanValue()) {
             return v8AssertionException("js db in read only mode");
         }
 
@@ -548,8 +548,8 @@ namespace mongo {
 
         argumentCheck(args.Length() == 2, "db constructor requires 2 arguments")
 
-        args.This()->ForceSet(scope->v8StringData("_mongo"), args[0]);
-        args.This()->ForceSet(scope->v8StringData("_name"), args[1]);
+        args.This()->ForceSet(scope->strLitToV8("_mongo"), args[0]);
+        args.This()->ForceSet(scope->strLitToV8("_name"), args[1]);
 
         for (int i = 0; i < args.Length(); i++) {
             argumentCheck(!args[i]->IsUndefined(), "db initializer called with undefined argument")
@@ -578,9 +578,9 @@ namespace mongo {
                           "collection constructor called with undefined argument")
         }
 
-        args.This()->ForceSet(scope->v8StringData("_mongo"), args[0]);
-        args.This()->ForceSet(scope->v8StringData("_db"), args[1]);
-        args.This()->ForceSet(scope->v8StringData("_shortName"), args[2]);
+        args.This()->ForceSet(scope->strLitToV8("_mongo"), args[0]);
+        args.This()->ForceSet(scope->strLitToV8("_db"), args[1]);
+        args.This()->ForceSet(scope->strLitToV8("_shortName"), args[2]);
         args.This()->ForceSet(v8::String::New("_fullName"), args[3]);
 
         if (haveLocalShardingInfo(toSTLString(args[3]))) {
@@ -601,44 +601,44 @@ namespace mongo {
         argumentCheck(args.Length() >= 4, "dbQuery constructor requires at least 4 arguments")
 
         v8::Handle<v8::Object> t = args.This();
-        t->ForceSet(scope->v8StringData("_mongo"), args[0]);
-        t->ForceSet(scope->v8StringData("_db"), args[1]);
-        t->ForceSet(scope->v8StringData("_collection"), args[2]);
-        t->ForceSet(scope->v8StringData("_ns"), args[3]);
+        t->ForceSet(scope->strLitToV8("_mongo"), args[0]);
+        t->ForceSet(scope->strLitToV8("_db"), args[1]);
+        t->ForceSet(scope->strLitToV8("_collection"), args[2]);
+        t->ForceSet(scope->strLitToV8("_ns"), args[3]);
 
         if (args.Length() > 4 && args[4]->IsObject())
-            t->ForceSet(scope->v8StringData("_query"), args[4]);
+            t->ForceSet(scope->strLitToV8("_query"), args[4]);
         else
-            t->ForceSet(scope->v8StringData("_query"), v8::Object::New());
+            t->ForceSet(scope->strLitToV8("_query"), v8::Object::New());
 
         if (args.Length() > 5 && args[5]->IsObject())
-            t->ForceSet(scope->v8StringData("_fields"), args[5]);
+            t->ForceSet(scope->strLitToV8("_fields"), args[5]);
         else
-            t->ForceSet(scope->v8StringData("_fields"), v8::Null());
+            t->ForceSet(scope->strLitToV8("_fields"), v8::Null());
 
         if (args.Length() > 6 && args[6]->IsNumber())
-            t->ForceSet(scope->v8StringData("_limit"), args[6]);
+            t->ForceSet(scope->strLitToV8("_limit"), args[6]);
         else
-            t->ForceSet(scope->v8StringData("_limit"), v8::Number::New(0));
+            t->ForceSet(scope->strLitToV8("_limit"), v8::Number::New(0));
 
         if (args.Length() > 7 && args[7]->IsNumber())
-            t->ForceSet(scope->v8StringData("_skip"), args[7]);
+            t->ForceSet(scope->strLitToV8("_skip"), args[7]);
         else
-            t->ForceSet(scope->v8StringData("_skip"), v8::Number::New(0));
+            t->ForceSet(scope->strLitToV8("_skip"), v8::Number::New(0));
 
         if (args.Length() > 8 && args[8]->IsNumber())
-            t->ForceSet(scope->v8StringData("_batchSize"), args[8]);
+            t->ForceSet(scope->strLitToV8("_batchSize"), args[8]);
         else
-            t->ForceSet(scope->v8StringData("_batchSize"), v8::Number::New(0));
+            t->ForceSet(scope->strLitToV8("_batchSize"), v8::Number::New(0));
 
         if (args.Length() > 9 && args[9]->IsNumber())
-            t->ForceSet(scope->v8StringData("_options"), args[9]);
+            t->ForceSet(scope->strLitToV8("_options"), args[9]);
         else
-            t->ForceSet(scope->v8StringData("_options"), v8::Number::New(0));
+            t->ForceSet(scope->strLitToV8("_options"), v8::Number::New(0));
 
-        t->ForceSet(scope->v8StringData("_cursor"), v8::Null());
-        t->ForceSet(scope->v8StringData("_numReturned"), v8::Number::New(0));
-        t->ForceSet(scope->v8StringData("_special"), v8::Boolean::New(false));
+        t->ForceSet(scope->strLitToV8("_cursor"), v8::Null());
+        t->ForceSet(scope->strLitToV8("_numReturned"), v8::Number::New(0));
+        t->ForceSet(scope->strLitToV8("_special"), v8::Boolean::New(false));
 
         return v8::Undefined();
     }
@@ -781,7 +781,7 @@ namespace mongo {
             oid.init(s);
         }
 
-        it->ForceSet(scope->v8StringData("str"), v8::String::New(oid.toString().c_str()));
+        it->ForceSet(scope->strLitToV8("str"), v8::String::New(oid.toString().c_str()));
         return it;
     }
 
@@ -796,12 +796,12 @@ namespace mongo {
 
         argumentCheck(args.Length() >= 2 && args.Length() <= 3, "DBRef needs 2 or 3 arguments")
         argumentCheck(args[0]->IsString(), "DBRef 1st parameter must be a string")
-        it->ForceSet(scope->v8StringData("$ref"), args[0]);
-        it->ForceSet(scope->v8StringData("$id"),  args[1]);
+        it->ForceSet(scope->strLitToV8("$ref"), args[0]);
+        it->ForceSet(scope->strLitToV8("$id"),  args[1]);
 
         if (args.Length() == 3) {
             argumentCheck(args[2]->IsString(), "DBRef 3rd parameter must be a string")
-            it->ForceSet(scope->v8StringData("$db"), args[2]);
+            it->ForceSet(scope->strLitToV8("$db"), args[2]);
         }
 
         return it;
@@ -821,8 +821,8 @@ namespace mongo {
         argumentCheck(scope->ObjectIdFT()->HasInstance(args[1]),
                       "DBPointer 2nd parameter must be an ObjectId")
 
-        it->ForceSet(scope->v8StringData("ns"), args[0]);
-        it->ForceSet(scope->v8StringData("id"), args[1]);
+        it->ForceSet(scope->strLitToV8("ns"), args[0]);
+        it->ForceSet(scope->strLitToV8("id"), args[1]);
         return it;
     }
 
@@ -836,8 +836,8 @@ namespace mongo {
         verify(scope->TimestampFT()->HasInstance(it));
 
         if (args.Length() == 0) {
-            it->ForceSet(scope->v8StringData("t"), v8::Number::New(0));
-            it->ForceSet(scope->v8StringData("i"), v8::Number::New(0));
+            it->ForceSet(scope->strLitToV8("t"), v8::Number::New(0));
+            it->ForceSet(scope->strLitToV8("i"), v8::Number::New(0));
         }
         else if (args.Length() == 2) {
             if (!args[0]->IsNumber()) {
@@ -852,8 +852,8 @@ namespace mongo {
                 return v8AssertionException( str::stream()
                         << "The first argument must be in seconds; "
                         << t << " is too large (max " << largestVal << ")");
-            it->ForceSet(scope->v8StringData("t"), args[0]);
-            it->ForceSet(scope->v8StringData("i"), args[1]);
+            it->ForceSet(scope->strLitToV8("t"), args[0]);
+            it->ForceSet(scope->strLitToV8("i"), args[1]);
         }
         else {
             return v8AssertionException("Timestamp needs 0 or 2 arguments");
@@ -883,8 +883,8 @@ namespace mongo {
         // uassert if invalid base64 string
         string tmpBase64 = base64::decode(*utf);
         // length property stores the decoded length
-        it->ForceSet(scope->v8StringData("len"), v8::Number::New(tmpBase64.length()));
-        it->ForceSet(scope->v8StringData("type"), type);
+        it->ForceSet(scope->strLitToV8("len"), v8::Number::New(tmpBase64.length()));
+        it->ForceSet(scope->strLitToV8("type"), type);
         it->SetInternalField(0, args[1]);
 
         return it;
@@ -893,7 +893,7 @@ namespace mongo {
     v8::Handle<v8::Value> binDataToString(V8Scope* scope, const v8::Arguments& args) {
         v8::Handle<v8::Object> it = args.This();
         verify(scope->BinDataFT()->HasInstance(it));
-        int type = it->Get(v8::String::New("type"))->Int32Value();
+        int type = it->Get(scope->strLitToV8("type"))->Int32Value();
 
         stringstream ss;
         verify(it->InternalFieldCount() == 1);
@@ -911,7 +911,7 @@ namespace mongo {
     v8::Handle<v8::Value> binDataToHex(V8Scope* scope, const v8::Arguments& args) {
         v8::Handle<v8::Object> it = args.This();
         verify(scope->BinDataFT()->HasInstance(it));
-        int len = v8::Handle<v8::Number>::Cast(it->Get(v8::String::New("len")))->Int32Value();
+        int len = v8::Handle<v8::Number>::Cast(it->Get(scope->strLitToV8("len")))->Int32Value();
         verify(it->InternalFieldCount() == 1);
         string data = base64::decode(toSTLString(it->GetInternalField(0)));
         stringstream ss;
@@ -981,11 +981,11 @@ namespace mongo {
         verify(scope->NumberLongFT()->HasInstance(it));
 
         if (args.Length() == 0) {
-            it->ForceSet(scope->v8StringData("floatApprox"), v8::Number::New(0));
+            it->ForceSet(scope->strLitToV8("floatApprox"), v8::Number::New(0));
         }
         else if (args.Length() == 1) {
             if (args[0]->IsNumber()) {
-                it->ForceSet(scope->v8StringData("floatApprox"), args[0]);
+                it->ForceSet(scope->strLitToV8("floatApprox"), args[0]);
             }
             else {
                 v8::String::Utf8Value data(args[0]);
@@ -1004,34 +1004,34 @@ namespace mongo {
                 // values above 2^53 are not accurately represented in JS
                 if ((long long)val ==
                     (long long)(double)(long long)(val) && val < 9007199254740992ULL) {
-                    it->ForceSet(scope->v8StringData("floatApprox"),
+                    it->ForceSet(scope->strLitToV8("floatApprox"),
                             v8::Number::New((double)(long long)(val)));
                 }
                 else {
-                    it->ForceSet(scope->v8StringData("floatApprox"),
+                    it->ForceSet(scope->strLitToV8("floatApprox"),
                             v8::Number::New((double)(long long)(val)));
-                    it->ForceSet(scope->v8StringData("top"), v8::Integer::New(val >> 32));
-                    it->ForceSet(scope->v8StringData("bottom"),
+                    it->ForceSet(scope->strLitToV8("top"), v8::Integer::New(val >> 32));
+                    it->ForceSet(scope->strLitToV8("bottom"),
                             v8::Integer::New((unsigned long)(val & 0x00000000ffffffff)));
                 }
             }
         }
         else {
-            it->ForceSet(scope->v8StringData("floatApprox"), args[0]->ToNumber());
-            it->ForceSet(scope->v8StringData("top"), args[1]->ToUint32());
-            it->ForceSet(scope->v8StringData("bottom"), args[2]->ToUint32());
+            it->ForceSet(scope->strLitToV8("floatApprox"), args[0]->ToNumber());
+            it->ForceSet(scope->strLitToV8("top"), args[1]->ToUint32());
+            it->ForceSet(scope->strLitToV8("bottom"), args[2]->ToUint32());
         }
         return it;
     }
 
     long long numberLongVal(V8Scope* scope, const v8::Handle<v8::Object>& it) {
         verify(scope->NumberLongFT()->HasInstance(it));
-        if (!it->Has(v8::String::New("top")))
-            return (long long)(it->Get(v8::String::New("floatApprox"))->NumberValue());
+        if (!it->Has(scope->strLitToV8("top")))
+            return (long long)(it->Get(scope->strLitToV8("floatApprox"))->NumberValue());
         return
             (long long)
-            ((unsigned long long)(it->Get(v8::String::New("top"))->ToInt32()->Value()) << 32) +
-            (unsigned)(it->Get(v8::String::New("bottom"))->ToInt32()->Value());
+            ((unsigned long long)(it->Get(scope->strLitToV8("top"))->ToInt32()->Value()) << 32) +
+            (unsigned)(it->Get(scope->strLitToV8("bottom"))->ToInt32()->Value());
     }
 
     v8::Handle<v8::Value> numberLongValueOf(V8Scope* scope, const v8::Arguments& args) {
@@ -1071,17 +1071,17 @@ namespace mongo {
 
         argumentCheck(args.Length() == 0 || args.Length() == 1, "NumberInt needs 0 or 1 arguments")
         if (args.Length() == 0) {
-            it->SetHiddenValue(v8::String::New("__NumberInt"), v8::Number::New(0));
+            it->SetHiddenValue(scope->strLitToV8("__NumberInt"), v8::Number::New(0));
         }
         else if (args.Length() == 1) {
-            it->SetHiddenValue(v8::String::New("__NumberInt"), args[0]->ToInt32());
+            it->SetHiddenValue(scope->strLitToV8("__NumberInt"), args[0]->ToInt32());
         }
         return it;
     }
 
     int numberIntVal(V8Scope* scope, const v8::Handle<v8::Object>& it) {
         verify(scope->NumberIntFT()->HasInstance(it));
-        v8::Handle<v8::Value> value = it->GetHiddenValue(v8::String::New("__NumberInt"));
+        v8::Handle<v8::Value> value = it->GetHiddenValue(scope->strLitToV8("__NumberInt"));
         verify(!value.IsEmpty());
         return value->Int32Value();
     }
@@ -34,10 +34,15 @@
 
 #include "mongo/shell/bench.h"
 
+#include <algorithm>
+#include <fstream>
 #include <pcrecpp.h>
 
 #include <boost/thread/thread.hpp>
 
+#include "mongo/base/data_view.h"
+#include "mongo/db/dbmessage.h"
+#include "mongo/db/json.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context_noop.h"
 #include "mongo/client/dbclientcursor.h"
@@ -83,11 +88,15 @@ namespace mongo {
     void BenchRunEventCounter::reset() {
         _numEvents = 0;
         _totalTimeMicros = 0;
+        _latencies = LatencyHistogram();
+        _correctedLatencies = LatencyHistogram();
     }
 
     void BenchRunEventCounter::updateFrom(const BenchRunEventCounter &other) {
         _numEvents += other._numEvents;
         _totalTimeMicros += other._totalTimeMicros;
+        _latencies.merge(other._latencies);
+        _correctedLatencies.merge(other._correctedLatencies);
     }
 
     BenchRunStats::BenchRunStats() {
@@ -105,6 +114,7 @@ namespace mongo {
         insertCounter.reset();
         deleteCounter.reset();
         queryCounter.reset();
+        commandCounter.reset();
 
         trappedErrors.clear();
     }
@@ -119,6 +129,7 @@ namespace mongo {
         insertCounter.updateFrom(other.insertCounter);
         deleteCounter.updateFrom(other.deleteCounter);
         queryCounter.updateFrom(other.queryCounter);
+        commandCounter.updateFrom(other.commandCounter);
 
         for (size_t i = 0; i < other.trappedErrors.size(); ++i)
             trappedErrors.push_back(other.trappedErrors[i]);
@@ -136,6 +147,11 @@ namespace mongo {
 
         parallel = 1;
         seconds = 1;
+        opsPerSecond = 0;
+        schedule = "";
+        replay = "";
+        replaySpeed = 1;
+        replayConnections.clear();
         hideResults = true;
         handleErrors = false;
         hideErrors = false;
@@ -151,6 +167,51 @@ namespace mongo {
         breakOnTrap = true;
     }
 
+    /**
+     * Reads the operations of a workload file, one JSON object per line, into an array.
+     */
+    static BSONObj loadSchedule(const std::string& path) {
+        std::ifstream in(path.c_str());
+        uassert(28626, str::stream() << "could not open benchRun schedule " << path, in.good());
+
+        BSONArrayBuilder ops;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+
+            BSONObj op = fromjson(line);
+            uassert(28627,
+                    str::stream() << "benchRun schedule entry needs a numeric \"at\": " << op,
+                    op["at"].isNumber() && op["at"].number() >= 0);
+            ops.append(op);
+        }
+        return ops.arr();
+    }
+
+    /**
+     * Reads a recorded workload, splitting it up by connection.
+     */
+    static void loadReplay(const std::string& path,
+                           std::vector< std::vector<CapturedMessage> >* connections) {
+        std::vector<CapturedMessage> messages;
+        Status status = readWorkloadCapture(path, &messages);
+        uassert(28631, status.reason(), status.isOK());
+        uassert(28632, str::stream() << "nothing was recorded in " << path, !messages.empty());
+
+        std::map<long long, size_t> connectionIndex;
+        for (size_t i = 0; i < messages.size(); ++i) {
+            std::map<long long, size_t>::iterator it =
+                connectionIndex.find(messages[i].connectionId);
+            if (it == connectionIndex.end()) {
+                it = connectionIndex.insert(
+                        std::make_pair(messages[i].connectionId, connections->size())).first;
+                connections->push_back(std::vector<CapturedMessage>());
+            }
+            (*connections)[it->second].push_back(messages[i]);
+        }
+    }
+
     BenchRunConfig *BenchRunConfig::createFromBson( const BSONObj &args ) {
         BenchRunConfig *config = new BenchRunConfig();
         config->initializeFromBson( args );
@@ -173,6 +234,14 @@ namespace mongo {
             this->parallel = args["parallel"].numberInt();
         if ( args["seconds"].isNumber() )
             this->seconds = args["seconds"].number();
+        if ( args["opsPerSecond"].isNumber() )
+            this->opsPerSecond = args["opsPerSecond"].number();
+        if ( args["schedule"].type() == String )
+            this->schedule = args["schedule"].String();
+        if ( args["replay"].type() == String )
+            this->replay = args["replay"].String();
+        if ( args["replaySpeed"].isNumber() )
+            this->replaySpeed = args["replaySpeed"].number();
         if ( ! args["hideResults"].eoo() )
             this->hideResults = args["hideResults"].trueValue();
         if ( ! args["handleErrors"].eoo() )
@@ -210,7 +279,22 @@ namespace mongo {
             this->noWatchPattern = shared_ptr< pcrecpp::RE >( new pcrecpp::RE( regex, flags2options( flags ) ) );
         }
 
-        this->ops = args["ops"].Obj().getOwned();
+        uassert(28628, "benchRun opsPerSecond must not be negative", this->opsPerSecond >= 0);
+
+        if ( !this->replay.empty() ) {
+            uassert(28633, "benchRun replaySpeed must be positive", this->replaySpeed > 0);
+            uassert(28634, "benchRun takes only one of ops, a schedule or a replay",
+                    args["ops"].eoo() && this->schedule.empty());
+            loadReplay( this->replay, &this->replayConnections );
+            this->parallel = this->replayConnections.size();
+        }
+        else if ( !this->schedule.empty() ) {
+            uassert(28629, "benchRun takes either ops or a schedule", args["ops"].eoo());
+            this->ops = loadSchedule( this->schedule );
+        }
+        else {
+            this->ops = args["ops"].Obj().getOwned();
+        }
     }
 
     DBClientBase *BenchRunConfig::createConnection() const {
@@ -327,6 +411,149 @@ namespace mongo {
         return _brState->shouldWorkerFinish();
     }
 
+    long long BenchRunWorker::waitUntilDue(const BSONObj& op,
+                                           long long opIndex,
+                                           const Timer& elapsed) const {
+        long long dueMicros;
+        if (!_config->schedule.empty()) {
+            dueMicros = static_cast<long long>(op["at"].number() * 1000);
+        }
+        else if (_config->opsPerSecond > 0) {
+            // The workers take turns, so that together they issue evenly spaced operations
+            const double slot = static_cast<double>(opIndex) * _config->parallel + _id;
+            dueMicros = static_cast<long long>(slot * 1000 * 1000 / _config->opsPerSecond);
+        }
+        else {
+            return 0;
+        }
+
+        return waitUntil(dueMicros, elapsed);
+    }
+
+    long long BenchRunWorker::waitUntil(long long dueMicros, const Timer& elapsed) const {
+        while (true) {
+            const long long now = elapsed.micros();
+            if (now >= dueMicros)
+                return now - dueMicros;
+            if (shouldStop())
+                return 0;
+            sleepmicros(std::min(dueMicros - now, 100 * 1000LL));
+        }
+    }
+
+    namespace {
+
+        /**
+         * Replaces the cursor ids of a recorded getMore or killCursors request with those of the
+         * cursors the replay opened in their stead, and turns off exhaust on recorded queries,
+         * whose extra replies the replay would not read.
+         */
+        void adaptRecordedRequest(const std::map<long long, long long>& cursorIds, Message* m) {
+            char* data = m->singleData().data();
+            if (m->operation() == dbQuery) {
+                DataView flags(data);
+                flags.writeLE<int32_t>(flags.readLE<int32_t>() & ~QueryOption_Exhaust);
+                return;
+            }
+
+            std::vector<char*> cursorFields;
+            if (m->operation() == dbGetMore) {
+                // ZERO, ns, numberToReturn, cursorID
+                const char* ns = data + sizeof(int32_t);
+                cursorFields.push_back(data + sizeof(int32_t) + strlen(ns) + 1 + sizeof(int32_t));
+            }
+            else if (m->operation() == dbKillCursors) {
+                // ZERO, numberOfCursorIDs, cursorIDs
+                const int n = ConstDataView(data + sizeof(int32_t)).readLE<int32_t>();
+                for (int i = 0; i < n; ++i)
+                    cursorFields.push_back(data + 2 * sizeof(int32_t) + i * sizeof(int64_t));
+            }
+
+            for (size_t i = 0; i < cursorFields.size(); ++i) {
+                DataView field(cursorFields[i]);
+                std::map<long long, long long>::const_iterator it =
+                    cursorIds.find(field.readLE<int64_t>());
+                if (it != cursorIds.end())
+                    field.writeLE<int64_t>(it->second);
+            }
+        }
+
+    } // namespace
+
+    void BenchRunWorker::replayOnConnection( DBClientBase* conn ) {
+        const std::vector<CapturedMessage>& recorded = _config->replayConnections[_id];
+
+        // Cursors opened by the replay, by the id of the recorded request which opened them,
+        // and the recorded cursor ids mapped to the replayed ones.
+        std::map<int, long long> openedCursors;
+        std::map<long long, long long> cursorIds;
+
+        // Requests which are neither reads nor writes, killCursors for example
+        BenchRunEventCounter otherCounter;
+
+        Timer elapsed;
+        for ( size_t i = 0; i < recorded.size() && !shouldStop(); ++i ) {
+            Message m;
+            recorded[i].toMessage( &m );
+
+            if ( m.operation() == opReply ) {
+                std::map<int, long long>::iterator it =
+                    openedCursors.find( m.header().getResponseTo() );
+                if ( it != openedCursors.end() ) {
+                    cursorIds[m.header().getCursor()] = it->second;
+                    openedCursors.erase( it );
+                }
+                continue;
+            }
+
+            const long long dueMicros =
+                static_cast<long long>( recorded[i].offsetMicros / _config->replaySpeed );
+            const long long lagMicros = waitUntil( dueMicros, elapsed );
+            if ( shouldStop() ) break;
+
+            adaptRecordedRequest( cursorIds, &m );
+
+            BenchRunEventCounter* counter = &otherCounter;
+            switch ( m.operation() ) {
+            case dbQuery: {
+                DbMessage d( m );
+                counter = nsToCollectionSubstring( d.getns() ) == "$cmd" ?
+                    &_stats.commandCounter : &_stats.queryCounter;
+                break;
+            }
+            case dbGetMore: counter = &_stats.queryCounter; break;
+            case dbInsert: counter = &_stats.insertCounter; break;
+            case dbUpdate: counter = &_stats.updateCounter; break;
+            case dbDelete: counter = &_stats.deleteCounter; break;
+            }
+
+            const int recordedId = m.header().getId();
+            try {
+                BenchRunEventTrace _bret( counter, lagMicros );
+                if ( m.operation() == dbQuery || m.operation() == dbGetMore ) {
+                    Message response;
+                    conn->call( m, response );
+                    QueryResult::View reply = response.singleData().view2ptr();
+                    if ( reply.getCursorId() )
+                        openedCursors[recordedId] = reply.getCursorId();
+                }
+                else {
+                    conn->say( m );
+                }
+            }
+            catch ( DBException& ex ) {
+                if ( !_config->hideErrors )
+                    log() << "Error in benchRun replay thread" << causedBy( ex ) << endl;
+                if ( !_config->handleErrors ) return;
+
+                _stats.errCount++;
+            }
+        }
+
+        // Like the generated load, wait for the legacy writes to be applied
+        conn->getLastError();
+    }
+
     void doNothing(const BSONObj&) { }
 
     void BenchRunWorker::generateLoadOnConnection( DBClientBase* conn ) {
@@ -344,6 +571,17 @@ namespace mongo {
             }
         }
 
+        if ( !_config->replay.empty() ) {
+            replayOnConnection( conn );
+            return;
+        }
+
+        // A schedule is played once, each worker taking every parallel'th operation
+        const bool scheduled = !_config->schedule.empty();
+        long long scheduleIndex = 0;
+        long long opIndex = 0;
+        Timer elapsed;
+
         while ( !shouldStop() ) {
             BSONObjIterator i( _config->ops );
             while ( i.more() ) {
@@ -352,6 +590,12 @@ namespace mongo {
 
                 BSONElement e = i.next();
 
+                if ( scheduled && static_cast<size_t>( scheduleIndex++ % _config->parallel ) != _id )
+                    continue;
+
+                const long long lagMicros = waitUntilDue( e.Obj(), opIndex++, elapsed );
+                if ( shouldStop() ) break;
+
                 string ns = e["ns"].String();
                 string op = e["op"].String();
 
@@ -399,7 +643,7 @@ namespace mongo {
 
                         BSONObj result;
                         {
-                            BenchRunEventTrace _bret(&_stats.findOneCounter);
+                            BenchRunEventTrace _bret(&_stats.findOneCounter, lagMicros);
                             result = conn->findOne( ns , fixQuery( e["query"].Obj(),
                                                                    bsonTemplateEvaluator ) );
                         }
@@ -421,8 +665,12 @@ namespace mongo {
                     else if ( op == "command" ) {
 
                         BSONObj result;
-                        conn->runCommand( ns, fixQuery( e["command"].Obj(), bsonTemplateEvaluator ),
-                                          result, e["options"].numberInt() );
+                        {
+                            BenchRunEventTrace _bret(&_stats.commandCounter, lagMicros);
+                            conn->runCommand( ns,
+                                              fixQuery( e["command"].Obj(), bsonTemplateEvaluator ),
+                                              result, e["options"].numberInt() );
+                        }
 
                         if( check ){
                             int err = scope->invoke( scopeFunc , 0 , &result,  1000 * 60 , false );
@@ -454,12 +702,12 @@ namespace mongo {
 
                         // use special query function for exhaust query option
                         if (options & QueryOption_Exhaust) {
-                            BenchRunEventTrace _bret(&_stats.queryCounter);
+                            BenchRunEventTrace _bret(&_stats.queryCounter, lagMicros);
                             stdx::function<void (const BSONObj&)> castedDoNothing(doNothing);
                             count =  conn->query(castedDoNothing, ns, fixedQuery, &filter, options);
                         }
                         else {
-                            BenchRunEventTrace _bret(&_stats.queryCounter);
+                            BenchRunEventTrace _bret(&_stats.queryCounter, lagMicros);
                             cursor = conn->query(ns, fixedQuery, limit, skip, &filter, options,
                                                  batchSize);
                             count = cursor->itcount();
@@ -495,7 +743,7 @@ namespace mongo {
                         bool safe = e["safe"].trueValue();
 
                         {
-                            BenchRunEventTrace _bret(&_stats.updateCounter);
+                            BenchRunEventTrace _bret(&_stats.updateCounter, lagMicros);
                             BSONObj query = fixQuery(queryOrginal, bsonTemplateEvaluator);
                             BSONObj update = fixQuery(updateOriginal, bsonTemplateEvaluator);
 
@@ -547,7 +795,7 @@ namespace mongo {
                         BSONObj result;
 
                         {
-                            BenchRunEventTrace _bret(&_stats.insertCounter);
+                            BenchRunEventTrace _bret(&_stats.insertCounter, lagMicros);
 
                             BSONObj insertDoc = fixQuery(e["doc"].Obj(), bsonTemplateEvaluator);
 
@@ -596,7 +844,7 @@ namespace mongo {
                         bool safe = e["safe"].trueValue();
                         BSONObj result;
                         {
-                            BenchRunEventTrace _bret(&_stats.deleteCounter);
+                            BenchRunEventTrace _bret(&_stats.deleteCounter, lagMicros);
                             BSONObj predicate = fixQuery(query, bsonTemplateEvaluator);
                             if (useWriteCmd) {
 
@@ -704,6 +952,8 @@ namespace mongo {
                     sleepmillis( delay );
 
             }
+
+            if ( scheduled ) break;
         }
 
         conn->getLastError();
@@ -860,6 +1110,34 @@ namespace mongo {
                         static_cast<double>(counter.getTotalTimeMicros()) / counter.getNumEvents());
      }
 
+     static void appendPercentiles(BSONObjBuilder &buf,
+                                   const std::string &name,
+                                   const LatencyHistogram &latencies) {
+         BSONObjBuilder percentiles(buf.subobjStart(name));
+         percentiles.appendNumber("p50", static_cast<long long>(latencies.getPercentileMicros(50)));
+         percentiles.appendNumber("p99", static_cast<long long>(latencies.getPercentileMicros(99)));
+         percentiles.appendNumber("p999",
+                                  static_cast<long long>(latencies.getPercentileMicros(99.9)));
+         percentiles.done();
+     }
+
+     /**
+      * Appends the latency percentiles of an operation type, counted from the time each
+      * operation was sent, and also from the time it was due when the run was paced.
+      */
+     static void appendPercentilesIfAvailable(BSONObjBuilder &buf,
+                                              const std::string &name,
+                                              const BenchRunEventCounter &counter,
+                                              bool paced) {
+         if (counter.getNumEvents() == 0)
+             return;
+
+         appendPercentiles(buf, name + "LatencyMicros", counter.getLatencies());
+         if (paced)
+             appendPercentiles(buf, name + "CorrectedLatencyMicros",
+                               counter.getCorrectedLatencies());
+     }
+
      BSONObj BenchRunner::finish( BenchRunner* runner ) {
 
          runner->stop();
@@ -886,6 +1164,17 @@ namespace mongo {
          appendAverageMicrosIfAvailable(buf, "deleteLatencyAverageMicros", stats.deleteCounter);
          appendAverageMicrosIfAvailable(buf, "updateLatencyAverageMicros", stats.updateCounter);
          appendAverageMicrosIfAvailable(buf, "queryLatencyAverageMicros", stats.queryCounter);
+         appendAverageMicrosIfAvailable(buf, "commandLatencyAverageMicros", stats.commandCounter);
+
+         const BenchRunConfig &config = runner->config();
+         const bool paced =
+             config.opsPerSecond > 0 || !config.schedule.empty() || !config.replay.empty();
+         appendPercentilesIfAvailable(buf, "findOne", stats.findOneCounter, paced);
+         appendPercentilesIfAvailable(buf, "insert", stats.insertCounter, paced);
+         appendPercentilesIfAvailable(buf, "delete", stats.deleteCounter, paced);
+         appendPercentilesIfAvailable(buf, "update", stats.updateCounter, paced);
+         appendPercentilesIfAvailable(buf, "query", stats.queryCounter, paced);
+         appendPercentilesIfAvailable(buf, "command", stats.commandCounter, paced);
 
          {
              BSONObjIterator i( after );
@@ -917,7 +1206,10 @@ namespace mongo {
          OID oid = OID( start.firstElement().String() );
          BenchRunner* runner = BenchRunner::get( oid );
 
-         sleepmillis( (int)(1000.0 * runner->config().seconds) );
+         if ( runner->config().replay.empty() )
+             sleepmillis( (int)(1000.0 * runner->config().seconds) );
+         else
+             runner->_brState.waitForState( BenchRunState::BRS_FINISHED );
 
          return benchFinish( start, data );
      }
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/condition.hpp>
@@ -36,7 +37,9 @@
 
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/stats/latency_histogram.h"
 #include "mongo/platform/atomic_word.h"
+#include "mongo/util/net/workload_capture.h"
 #include "mongo/util/timer.h"
 
 namespace pcrecpp {
@@ -100,6 +103,40 @@ namespace mongo {
          */
         double seconds;
 
+        /**
+         * Target rate of operations per second across all threads, or 0 to have each thread
+         * issue its next operation as soon as the previous one returns.
+         *
+         * When set, each thread issues its operations at fixed intervals and measures the
+         * corrected latency of an operation from the time it was due, not from the time the
+         * thread got around to sending it, so that a stalled server is not hidden by the
+         * threads waiting on it.
+         */
+        double opsPerSecond;
+
+        /**
+         * Optional path of a workload file to replay instead of looping over "ops".  Each line
+         * of the file is a JSON benchRun operation with an extra "at" field, the number of
+         * milliseconds after the start of the run at which it is due.  The operations are
+         * dealt out to the threads in turn and each is issued once, at its due time, as long as
+         * the run lasts.
+         */
+        std::string schedule;
+
+        /**
+         * Optional path of a workload file recorded by mongobridge or mongosniff to replay
+         * instead of looping over "ops".  There is one thread per recorded connection, which
+         * sends that connection's requests at their recorded times divided by "replaySpeed",
+         * and the run finishes when they have all been sent.
+         */
+        std::string replay;
+        double replaySpeed;
+
+        /**
+         * The recorded messages of each connection in "replay", in order.
+         */
+        std::vector< std::vector<CapturedMessage> > replayConnections;
+
         bool hideResults;
         bool handleErrors;
         bool hideErrors;
@@ -152,11 +189,14 @@ namespace mongo {
         void updateFrom( const BenchRunEventCounter &other );
 
         /**
-         * Count one instance of the event, which took "timeMicros" microseconds.
+         * Count one instance of the event, which took "timeMicros" microseconds and was started
+         * "lagMicros" microseconds after it was due.
          */
-        void countOne(long long timeMicros) {
+        void countOne(long long timeMicros, long long lagMicros = 0) {
             ++_numEvents;
             _totalTimeMicros += timeMicros;
+            _latencies.record(timeMicros);
+            _correctedLatencies.record(timeMicros + lagMicros);
         }
 
         /**
@@ -169,9 +209,18 @@ namespace mongo {
          */
         unsigned long long getNumEvents() const { return _numEvents; }
 
+        /**
+         * Get the distribution of the events' durations, and of their durations counted from
+         * the time they were due.
+         */
+        const LatencyHistogram& getLatencies() const { return _latencies; }
+        const LatencyHistogram& getCorrectedLatencies() const { return _correctedLatencies; }
+
     private:
         unsigned long long _numEvents;
         long long _totalTimeMicros;
+        LatencyHistogram _latencies;
+        LatencyHistogram _correctedLatencies;
     };
 
     /**
@@ -189,8 +238,12 @@ namespace mongo {
      */
     class BenchRunEventTrace : private boost::noncopyable {
     public:
-        explicit BenchRunEventTrace(BenchRunEventCounter *eventCounter) {
+        /**
+         * "lagMicros" is how late the event was started, if it was scheduled.
+         */
+        explicit BenchRunEventTrace(BenchRunEventCounter *eventCounter, long long lagMicros = 0) {
             initialize(eventCounter, eventCounter, false);
+            _lagMicros = lagMicros;
         }
 
         BenchRunEventTrace(BenchRunEventCounter *successCounter,
@@ -200,7 +253,7 @@ namespace mongo {
         }
 
         ~BenchRunEventTrace() {
-            (_succeeded ? _successCounter : _failCounter)->countOne(_timer.micros());
+            (_succeeded ? _successCounter : _failCounter)->countOne(_timer.micros(), _lagMicros);
         }
 
         void succeed() { _succeeded = true; }
@@ -213,12 +266,14 @@ namespace mongo {
             _successCounter = successCounter;
             _failCounter = failCounter;
             _succeeded = !defaultToFailure;
+            _lagMicros = 0;
         }
 
         Timer _timer;
         BenchRunEventCounter *_successCounter;
         BenchRunEventCounter *_failCounter;
         bool _succeeded;
+        long long _lagMicros;
     };
 
     /**
@@ -241,6 +296,7 @@ namespace mongo {
         BenchRunEventCounter insertCounter;
         BenchRunEventCounter deleteCounter;
         BenchRunEventCounter queryCounter;
+        BenchRunEventCounter commandCounter;
 
         std::map<std::string, long long> opcounters;
         std::vector<BSONObj> trappedErrors;
@@ -349,6 +405,19 @@ namespace mongo {
         /// Predicate, used to decide whether or not it's time to terminate the worker.
         bool shouldStop() const;
 
+        /**
+         * Waits until the "opIndex"th operation taken by this worker, "op", is due and returns
+         * how many microseconds late it is, where "elapsed" was started with the run.  Returns
+         * 0 straight away if operations are not paced.
+         */
+        long long waitUntilDue(const BSONObj& op, long long opIndex, const Timer& elapsed) const;
+
+        /// Waits until "elapsed" reaches "dueMicros" and returns how many microseconds late it is.
+        long long waitUntil(long long dueMicros, const Timer& elapsed) const;
+
+        /// Sends the requests recorded on the connection of this worker, at their due times.
+        void replayOnConnection( DBClientBase *conn );
+
         size_t _id;
         const BenchRunConfig *_config;
         BenchRunState *_brState;
@@ -32,7 +32,7 @@ DBCollection.prototype.help = function () {
     var shortName = this.getName();
     print("DBCollection help");
     print("\tdb." + shortName + ".find().help() - show DBCursor help");
-    print("\tdb." + shortName + ".count()");
+    print("\tdb." + shortName + ".count( query, {approx: true} ) - approx lets an index estimate the count")
     print("\tdb." + shortName + ".copyTo(newColl) - duplicates collection by copying all documents to newColl; no indexes are copied.");
     print("\tdb." + shortName + ".convertToCapped(maxBytes) - calls {convertToCapped:'" + shortName + "', size:maxBytes}} command");
     print("\tdb." + shortName + ".dataSize()");
@@ -1037,8 +1037,8 @@ DBCollection.prototype.getIndexKeys = function(){
 }
 
 
-DBCollection.prototype.count = function( x ){
-    return this.find( x ).count();
+DBCollection.prototype.count = function( x, options ){
+    return this.find( x ).count( false, options );
 }
 
 /**
@@ -28,7 +28,7 @@ DBQuery.prototype.help = function () {
     print("\t.sort( {...} )")
     print("\t.limit( n )")
     print("\t.skip( n )")
-    print("\t.count(applySkipLimit) - total # of objects matching query. by default ignores skip,limit")
+    print("\t.count(applySkipLimit, {approx: true}) - total # of objects matching query. by default ignores skip,limit; approx lets an index estimate it")
     print("\t.size() - total # of objects cursor would return, honors skip,limit")
     print("\t.explain([verbose])")
     print("\t.hint(...)")
@@ -36,6 +36,8 @@ DBQuery.prototype.help = function () {
     print("\t._addSpecial(name, value) - http://dochub.mongodb.org/core/advancedqueries#AdvancedQueries-Metaqueryoperators")
     print("\t.batchSize(n) - sets the number of docs to return per getMore")
     print("\t.showDiskLoc() - adds a $diskLoc field to each returned object")
+    print("\t.allowDiskUse() - lets a blocking sort use temporary files when over its memory limit")
+    print("\t.readAhead() - has the server compute each next batch while the current one is consumed")
     print("\t.min(idxDoc)")
     print("\t.max(idxDoc)")
     print("\t.comment(comment)")
@@ -124,6 +126,14 @@ DBQuery.prototype._buildCmdOptions = function() {
         options["snapshot"] = this._query.$snapshot;
     }
 
+    if (this._query.$allowDiskUse) {
+        options["allowDiskUse"] = this._query.$allowDiskUse;
+    }
+
+    if (this._query.$readAhead) {
+        options["readAhead"] = this._query.$readAhead;
+    }
+
     if ((this._options & DBQuery.Option.tailable) != 0) {
         options["tailable"] = true;
     }
@@ -318,8 +328,11 @@ DBQuery.prototype._convertToCountCmd = function( applySkipLimit ) {
     return cmd;
 }
 
-DBQuery.prototype.count = function( applySkipLimit ) {
+DBQuery.prototype.count = function( applySkipLimit, options ) {
     var cmd = this._convertToCountCmd( applySkipLimit );
+    if ( options && options.approx ) {
+        cmd.approx = true;
+    }
 
     var res = this._db.runCommand( cmd );
     if( res && res.n != null ) return res.n;
@@ -384,6 +397,14 @@ DBQuery.prototype.showDiskLoc = function() {
     return this._addSpecial( "$showDiskLoc" , true );
 }
 
+DBQuery.prototype.allowDiskUse = function() {
+    return this._addSpecial( "$allowDiskUse" , true );
+}
+
+DBQuery.prototype.readAhead = function() {
+    return this._addSpecial( "$readAhead" , true );
+}
+
 DBQuery.prototype.maxTimeMS = function( maxTimeMS ) {
     return this._addSpecial( "$maxTimeMS" , maxTimeMS );
 }
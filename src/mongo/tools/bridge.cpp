@@ -35,10 +35,12 @@
 #include "mongo/base/initializer.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/dbmessage.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/tools/mongobridge_options.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/workload_capture.h"
 #include "mongo/util/stacktrace.h"
 #include "mongo/util/quick_exit.h"
 #include "mongo/util/text.h"
@@ -49,9 +51,13 @@ using namespace std;
 
 void cleanup( int sig );
 
+// Records the forwarded traffic when --record is given
+WorkloadCaptureWriter* recorder = NULL;
+AtomicInt64 nextConnectionId;
+
 class Forwarder {
 public:
-    Forwarder( MessagingPort &mp ) : mp_( mp ) {
+    Forwarder( MessagingPort &mp ) : mp_( mp ), connectionId_( nextConnectionId.fetchAndAdd( 1 ) ) {
     }
 
     void operator()() const {
@@ -84,6 +90,9 @@ public:
                 }
                 sleepmillis(mongoBridgeGlobalParams.delay);
 
+                if ( recorder )
+                    recorder->recordNow( connectionId_, m );
+
                 int oldId = m.header().getId();
                 if ( m.operation() == dbQuery || m.operation() == dbMsg || m.operation() == dbGetMore ) {
                     bool exhaust = false;
@@ -98,6 +107,9 @@ public:
                     // nothing to reply with?
                     if ( response.empty() ) cleanup(0);
 
+                    if ( recorder )
+                        recorder->recordNow( connectionId_, response );
+
                     mp_.reply( m, response, oldId );
                     while ( exhaust ) {
                         MsgData::View header = response.header();
@@ -123,6 +135,7 @@ public:
     }
 private:
     MessagingPort &mp_;
+    long long connectionId_;
 };
 
 set<MessagingPort*>& ports ( *(new std::set<MessagingPort*>()) );
@@ -173,6 +186,15 @@ int toolMain( int argc, char **argv, char** envp ) {
 
     setupSignals();
 
+    if ( !mongoBridgeGlobalParams.recordFile.empty() ) {
+        recorder = new WorkloadCaptureWriter();
+        Status status = recorder->open( mongoBridgeGlobalParams.recordFile );
+        if ( !status.isOK() ) {
+            cout << status.reason() << endl;
+            return -1;
+        }
+    }
+
     listener.reset(new MyListener(mongoBridgeGlobalParams.port));
     listener->setupSockets();
     listener->initAndListen();
@@ -0,0 +1,176 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mongo/base/initializer.h"
+#include "mongo/db/ftdc/ftdc_file.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/quick_exit.h"
+#include "mongo/util/text.h"
+
+using namespace mongo;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+    void usage() {
+        cout << "Usage: mongoftdcdump [--metadata] <file or diagnostic.data directory>...\n"
+             << "\n"
+             << "Prints the samples of diagnostic data files, one JSON document per line.\n"
+             << "Directories are read a file at a time, oldest first.\n"
+             << "\n"
+             << " --metadata  also print the metadata documents, such as buildInfo\n"
+             << " --help      print this message\n";
+    }
+
+    /**
+     * Returns false on errors, after printing the whole documents before them.
+     */
+    bool dumpFile(const string& path, bool printMetadata) {
+        vector<BSONObj> docs;
+        Status status = readFTDCFile(path, &docs);
+
+        for (size_t i = 0; i < docs.size(); ++i) {
+            if (docs[i]["type"].numberInt() == kFTDCMetadataDocument) {
+                if (printMetadata) {
+                    cout << docs[i].jsonString() << '\n';
+                }
+                continue;
+            }
+
+            vector<BSONObj> samples;
+            Status extracted = extractFTDCSamples(docs[i], &samples);
+            if (!extracted.isOK()) {
+                cerr << path << ": " << extracted.reason() << endl;
+                return false;
+            }
+            for (size_t j = 0; j < samples.size(); ++j) {
+                cout << samples[j].jsonString() << '\n';
+            }
+        }
+
+        if (!status.isOK()) {
+            cerr << status.reason() << endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool dumpPath(const string& path, bool printMetadata) {
+        if (!fs::is_directory(path)) {
+            return dumpFile(path, printMetadata);
+        }
+
+        // File names are the times the files were started, and the interim file sorts last
+        vector<string> files;
+        for (fs::directory_iterator it(path); it != fs::directory_iterator(); ++it) {
+            const string fileName = it->path().filename().string();
+            if (fileName.compare(0, 8, "metrics.") == 0) {
+                files.push_back(it->path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+
+        bool ok = true;
+        for (size_t i = 0; i < files.size(); ++i) {
+            ok = dumpFile(files[i], printMetadata) && ok;
+        }
+        return ok;
+    }
+
+} // namespace
+
+int toolMain(int argc, char** argv, char** envp) {
+    mongo::runGlobalInitializersOrDie(argc, argv, envp);
+
+    bool printMetadata = false;
+    vector<string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (arg == "--help") {
+            usage();
+            return 0;
+        }
+        else if (arg == "--metadata") {
+            printMetadata = true;
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.empty()) {
+        usage();
+        return 1;
+    }
+
+    bool ok = true;
+    try {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            ok = dumpPath(paths[i], printMetadata) && ok;
+        }
+    }
+    catch (const std::exception& ex) {
+        cerr << ex.what() << endl;
+        ok = false;
+    }
+    cout.flush();
+    return ok ? 0 : 1;
+}
+
+#if defined(_WIN32)
+// In Windows, wmain() is an alternate entry point for main(), and receives the same parameters
+// as main() but encoded in Windows Unicode (UTF-16); "wide" 16-bit wchar_t characters.  The
+// WindowsCommandLine object converts these wide character strings to a UTF-8 coded equivalent
+// and makes them available through the argv() and envp() members.  This enables toolMain()
+// to process UTF-8 encoded arguments and environment variables without regard to platform.
+int wmain(int argc, wchar_t* argvW[], wchar_t* envpW[]) {
+    WindowsCommandLine wcl(argc, argvW, envpW);
+    int exitCode = toolMain(argc, wcl.argv(), wcl.envp());
+    quickExit(exitCode);
+}
+#else
+int main(int argc, char* argv[], char** envp) {
+    int exitCode = toolMain(argc, argv, envp);
+    quickExit(exitCode);
+}
+#endif
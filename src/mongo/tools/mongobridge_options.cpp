@@ -51,11 +51,15 @@ namespace mongo {
                                   .setDefault(moe::Value(0));
 
 
+        options->addOptionChaining("record", "record", moe::String,
+                "file to record the forwarded workload to, for replay with benchRun");
+
+
         return Status::OK();
     }
 
     void printMongoBridgeHelp(std::ostream* out) {
-        *out << "Usage: mongobridge --port <port> --dest <dest> [ --delay <ms> ] [ --help ]"
+        *out << "Usage: mongobridge --port <port> --dest <dest> [ --delay <ms> ] [ --record <file> ] [ --help ]"
              << std::endl;
         *out << moe::startupOptions.helpString();
         *out << std::flush;
@@ -87,6 +91,10 @@ namespace mongo {
             mongoBridgeGlobalParams.delay = params["delay"].as<int>();
         }
 
+        if (params.count("record")) {
+            mongoBridgeGlobalParams.recordFile = params["record"].as<std::string>();
+        }
+
         return Status::OK();
     }
 
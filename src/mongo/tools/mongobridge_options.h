@@ -48,6 +48,7 @@ namespace mongo {
         int delay;
         int connectTimeoutSec;
         std::string destUri;
+        std::string recordFile;
 
         MongoBridgeGlobalParams() : port(0), delay(0), connectTimeoutSec(15) {}
     };
@@ -66,6 +66,7 @@
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/workload_capture.h"
 #include "mongo/util/mmap.h"
 #include "mongo/util/quick_exit.h"
 #include "mongo/util/text.h"
@@ -84,6 +85,7 @@ int captureHeaderSize;
 set<int> serverPorts;
 string forwardAddress;
 bool objcheck = false;
+mongo::WorkloadCaptureWriter* recorder = NULL;
 
 ostream *outPtr = &cout;
 ostream &out() { return *outPtr; }
@@ -167,6 +169,26 @@ map< Connection, boost::shared_ptr<DBClientConnection> > forwarder;
 map< Connection, long long > lastCursor;
 map< Connection, map< long long, long long > > mapCursor;
 
+// Recorded connections by their client to server direction, and when the first packet was seen
+map< Connection, long long > recordedConnectionId;
+long long firstPacketMicros = -1;
+
+void recordMessage( const Connection& c, bool toServer, const struct pcap_pkthdr *header,
+                    const Message& m ) {
+    const long long micros = header->ts.tv_sec * 1000LL * 1000 + header->ts.tv_usec;
+    if ( firstPacketMicros < 0 )
+        firstPacketMicros = micros;
+
+    const Connection clientToServer = toServer ? c : c.reverse();
+    map< Connection, long long >::iterator it = recordedConnectionId.find( clientToServer );
+    if ( it == recordedConnectionId.end() ) {
+        const long long id = recordedConnectionId.size();
+        it = recordedConnectionId.insert( make_pair( clientToServer, id ) ).first;
+    }
+
+    recorder->record( micros - firstPacketMicros, it->second, m );
+}
+
 void processMessage( Connection& c , Message& d );
 
 void got_packet(u_char *args, const struct pcap_pkthdr *header, const u_char *packet) {
@@ -253,6 +275,9 @@ void got_packet(u_char *args, const struct pcap_pkthdr *header, const u_char *pa
         messageBuilder[ c ].reset();
     }
 
+    if ( recorder )
+        recordMessage( c, serverPorts.count( ntohs( tcp->th_dport ) ), header, m );
+
     DbMessage d( m );
 
     out() << inet_ntoa(ip->ip_src) << ":" << ntohs( tcp->th_sport )
@@ -436,10 +461,12 @@ void processDiagLog( const char * file ) {
 
 void usage() {
     cout <<
-         "Usage: mongosniff [--help] [--forward host:port] [--objcheck] [--source (NET <interface> | (FILE | DIAGLOG) <filename>)] [<port0> <port1> ... ]\n"
+         "Usage: mongosniff [--help] [--forward host:port] [--record <file>] [--objcheck] [--source (NET <interface> | (FILE | DIAGLOG) <filename>)] [<port0> <port1> ... ]\n"
          "--help          Print this help message.\n"
          "--forward       Forward all parsed request messages to mongod instance at \n"
          "                specified host:port\n"
+         "--record        Record the sniffed traffic to a workload file, which benchRun\n"
+         "                can replay with its replay option.\n"
          "--source        Source of traffic to sniff, either a network interface or a\n"
          "                file containing previously captured packets in pcap format,\n"
          "                or a file containing output from mongod's --diaglog option.\n"
@@ -503,6 +530,15 @@ int toolMain(int argc, char **argv, char** envp) {
                 else
                     dev = args[ ++i ];
             }
+            else if ( arg == string( "--record" ) ) {
+                uassert( 28630, "--record needs a file name", args.size() > i + 1 );
+                recorder = new mongo::WorkloadCaptureWriter();
+                mongo::Status status = recorder->open( args[ ++i ] );
+                if ( !status.isOK() ) {
+                    cerr << status.reason() << endl;
+                    return -1;
+                }
+            }
             else if ( arg == string( "--objcheck" ) ) {
                 objcheck = true;
                 outPtr = &nullStream;
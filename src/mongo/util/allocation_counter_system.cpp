@@ -0,0 +1,115 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+#include "mongo/platform/atomic_word.h"
+
+namespace {
+
+    mongo::AtomicUInt64 allocations;
+
+    void* countedAllocate(size_t size) {
+        allocations.fetchAndAdd(1);
+        // malloc(0) may return NULL, which operator new may not.
+        void* ptr = std::malloc(size ? size : 1);
+        while (!ptr) {
+            std::new_handler handler = std::set_new_handler(NULL);
+            std::set_new_handler(handler);
+            if (!handler) {
+                throw std::bad_alloc();
+            }
+            handler();
+            ptr = std::malloc(size ? size : 1);
+        }
+        return ptr;
+    }
+
+} // namespace
+
+// The system allocator has no allocation hooks, so the global operator new is replaced instead.
+// Allocations which go to malloc() directly are not counted.
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+    return countedAllocate(size);
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc) {
+    return countedAllocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw() {
+    try {
+        return countedAllocate(size);
+    }
+    catch (const std::bad_alloc&) {
+        return NULL;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw() {
+    try {
+        return countedAllocate(size);
+    }
+    catch (const std::bad_alloc&) {
+        return NULL;
+    }
+}
+
+void operator delete(void* ptr) throw() {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) throw() {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) throw() {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) throw() {
+    std::free(ptr);
+}
+
+namespace mongo {
+
+    unsigned long long AllocationCounter::get() {
+        return allocations.load();
+    }
+
+    bool AllocationCounter::countsMalloc() {
+        return false;
+    }
+
+} // namespace mongo
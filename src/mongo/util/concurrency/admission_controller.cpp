@@ -0,0 +1,261 @@
+// admission_controller.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/admission_controller.h"
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <climits>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+    AdmissionController::Options::Options()
+        : minTickets( 8 ),
+          maxTickets( 512 ),
+          initialTickets( 128 ),
+          windowMicros( 100 * 1000 ),
+          latencyTolerance( 2.0 ) {
+    }
+
+    AdmissionController::AdmissionController( const std::string& name, const Options& options )
+        : _name( name ),
+          _windowMicros( options.windowMicros ),
+          _latencyTolerance( options.latencyTolerance ),
+          _minTickets( options.minTickets ),
+          _maxTickets( options.maxTickets ),
+          _tickets( options.initialTickets ),
+          _used( 0 ),
+          _waitingHigh( 0 ),
+          _waitingNormal( 0 ),
+          _windowStartMicros( 0 ),
+          _windowOps( 0 ),
+          _windowLatencyMicros( 0 ),
+          _windowSaturated( false ),
+          _baselineLatencyMicros( 0 ),
+          _lastLatencyMicros( 0 ),
+          _lastThroughput( 0 ),
+          _lastDecision( "none" ),
+          _totalAdmitted( 0 ),
+          _totalQueued( 0 ),
+          _totalTimedOut( 0 ),
+          _increases( 0 ),
+          _decreases( 0 ) {
+        invariant( options.minTickets > 0 );
+        invariant( options.minTickets <= options.maxTickets );
+        invariant( options.windowMicros > 0 );
+        _tickets = std::max( _minTickets, std::min( _maxTickets, _tickets ) );
+    }
+
+    bool AdmissionController::acquire( Priority priority, unsigned timeoutMs ) {
+        boost::unique_lock<boost::mutex> lk( _mutex );
+
+        const bool high = ( priority == kPriorityHigh );
+
+        // Normal priority operations also queue behind any waiting high priority ones.
+        if ( _used < _tickets && ( high || _waitingHigh == 0 ) ) {
+            _used++;
+            _totalAdmitted++;
+            if ( _used >= _tickets )
+                _windowSaturated = true;
+            return true;
+        }
+
+        _totalQueued++;
+        _windowSaturated = true;
+
+        boost::condition_variable& cond = high ? _highPriorityWaiters : _normalPriorityWaiters;
+        int& waiting = high ? _waitingHigh : _waitingNormal;
+
+        const boost::system_time deadline = ( timeoutMs == UINT_MAX ) ?
+            boost::system_time( boost::posix_time::pos_infin ) :
+            boost::get_system_time() + boost::posix_time::milliseconds( timeoutMs );
+
+        waiting++;
+        while ( _used >= _tickets || ( !high && _waitingHigh > 0 ) ) {
+            if ( !cond.timed_wait( lk, deadline ) &&
+                 ( _used >= _tickets || ( !high && _waitingHigh > 0 ) ) ) {
+                waiting--;
+                _totalTimedOut++;
+                // We may have been handed a wakeup meant to let someone else in.
+                _wakeWaiters_inlock();
+                return false;
+            }
+        }
+        waiting--;
+
+        _used++;
+        _totalAdmitted++;
+
+        // Tickets may have been added for more than one waiter.
+        _wakeWaiters_inlock();
+        return true;
+    }
+
+    void AdmissionController::release( long long acquiredMicros, long long nowMicros ) {
+        boost::lock_guard<boost::mutex> lk( _mutex );
+
+        invariant( _used > 0 );
+        _used--;
+
+        if ( _windowStartMicros == 0 )
+            _windowStartMicros = acquiredMicros;
+
+        _windowOps++;
+        _windowLatencyMicros += std::max( 0LL, nowMicros - acquiredMicros );
+
+        if ( nowMicros - _windowStartMicros >= _windowMicros )
+            _adjust_inlock( nowMicros );
+
+        _wakeWaiters_inlock();
+    }
+
+    void AdmissionController::setLimits( int minTickets, int maxTickets ) {
+        invariant( minTickets > 0 );
+
+        boost::lock_guard<boost::mutex> lk( _mutex );
+        _maxTickets = std::max( minTickets, maxTickets );
+        _minTickets = minTickets;
+        _tickets = std::max( _minTickets, std::min( _maxTickets, _tickets ) );
+        _wakeWaiters_inlock();
+    }
+
+    int AdmissionController::tickets() const {
+        boost::lock_guard<boost::mutex> lk( _mutex );
+        return _tickets;
+    }
+
+    int AdmissionController::used() const {
+        boost::lock_guard<boost::mutex> lk( _mutex );
+        return _used;
+    }
+
+    int AdmissionController::waiting() const {
+        boost::lock_guard<boost::mutex> lk( _mutex );
+        return _waitingHigh + _waitingNormal;
+    }
+
+    void AdmissionController::_wakeWaiters_inlock() {
+        const int available = _tickets - _used;
+        if ( available <= 0 )
+            return;
+
+        if ( _waitingHigh > 0 ) {
+            if ( available >= _waitingHigh )
+                _highPriorityWaiters.notify_all();
+            else
+                _highPriorityWaiters.notify_one();
+        }
+        else if ( _waitingNormal > 0 ) {
+            if ( available >= _waitingNormal )
+                _normalPriorityWaiters.notify_all();
+            else
+                _normalPriorityWaiters.notify_one();
+        }
+    }
+
+    void AdmissionController::_adjust_inlock( long long nowMicros ) {
+        const long long elapsedMicros = nowMicros - _windowStartMicros;
+        const double latency = double( _windowLatencyMicros ) / _windowOps;
+        const double throughput = _windowOps * 1000000.0 / elapsedMicros;
+
+        // Let the baseline drift up slowly, so that one unusually fast window (or a change in
+        // workload) doesn't pin it forever.
+        if ( _baselineLatencyMicros == 0 )
+            _baselineLatencyMicros = latency;
+        else
+            _baselineLatencyMicros = std::min( latency, _baselineLatencyMicros * 1.01 + 1 );
+
+        const bool congested = latency > _baselineLatencyMicros * _latencyTolerance;
+        const int before = _tickets;
+
+        if ( congested && throughput <= _lastThroughput ) {
+            _tickets = std::max( _minTickets, _tickets - std::max( 1, _tickets / 4 ) );
+        }
+        else if ( !congested && _windowSaturated ) {
+            _tickets = std::min( _maxTickets, _tickets + 1 );
+        }
+
+        if ( _tickets < before ) {
+            _decreases++;
+            _lastDecision = "decrease";
+            LOG(1) << _name << " admission: latency " << latency << "us over baseline "
+                   << _baselineLatencyMicros << "us, tickets " << before << " -> " << _tickets;
+        }
+        else if ( _tickets > before ) {
+            _increases++;
+            _lastDecision = "increase";
+        }
+        else {
+            _lastDecision = "hold";
+        }
+
+        _lastLatencyMicros = latency;
+        _lastThroughput = throughput;
+
+        _windowStartMicros = nowMicros;
+        _windowOps = 0;
+        _windowLatencyMicros = 0;
+        _windowSaturated = ( _used >= _tickets || _waitingHigh + _waitingNormal > 0 );
+    }
+
+    void AdmissionController::appendStats( BSONObjBuilder& b ) const {
+        boost::lock_guard<boost::mutex> lk( _mutex );
+
+        b.append( "out", _used );
+        b.append( "available", std::max( 0, _tickets - _used ) );
+        b.append( "totalTickets", _tickets );
+        b.append( "minTickets", _minTickets );
+        b.append( "maxTickets", _maxTickets );
+
+        BSONObjBuilder queue( b.subobjStart( "queue" ) );
+        queue.append( "high", _waitingHigh );
+        queue.append( "normal", _waitingNormal );
+        queue.done();
+
+        b.append( "admitted", _totalAdmitted );
+        b.append( "queued", _totalQueued );
+        b.append( "timedOut", _totalTimedOut );
+        b.append( "increases", _increases );
+        b.append( "decreases", _decreases );
+        b.append( "lastDecision", _lastDecision );
+        b.append( "latencyMicros", static_cast<long long>( _lastLatencyMicros ) );
+        b.append( "baselineLatencyMicros", static_cast<long long>( _baselineLatencyMicros ) );
+        b.append( "throughput", _lastThroughput );
+    }
+
+} // namespace mongo
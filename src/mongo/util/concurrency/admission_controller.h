@@ -0,0 +1,147 @@
+// admission_controller.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <string>
+
+#include "mongo/base/disallow_copying.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Limits the number of operations running concurrently, like TicketHolder, except that the
+     * limit adapts to the measured throughput and latency of the operations it admits.
+     *
+     * The controller works in windows of Options::windowMicros.  At the end of each window it
+     * compares the mean time operations held their ticket with the lowest mean seen recently
+     * (the baseline, much like TCP Vegas' base RTT):
+     *
+     *  - if latency rose above latencyTolerance times the baseline without throughput
+     *    improving, the extra concurrency is only adding queueing inside the server, so the
+     *    limit is cut by a quarter;
+     *  - otherwise, if operations had to wait for a ticket or every ticket was in use, the limit
+     *    grows by one;
+     *  - otherwise it is left alone.
+     *
+     * The limit always stays within [minTickets, maxTickets].  Lowering it below the number of
+     * tickets in use does not revoke anything; new operations wait until enough are released.
+     *
+     * Waiters of kPriorityHigh are always granted tickets before waiters of kPriorityNormal.
+     */
+    class AdmissionController {
+        MONGO_DISALLOW_COPYING(AdmissionController);
+    public:
+        enum Priority {
+            kPriorityNormal,
+            kPriorityHigh,  // internal operations, e.g. replication
+        };
+
+        struct Options {
+            Options();
+
+            int minTickets;
+            int maxTickets;
+            int initialTickets;
+            long long windowMicros;
+            double latencyTolerance;
+        };
+
+        AdmissionController( const std::string& name, const Options& options );
+
+        /**
+         * Waits up to 'timeoutMs' for a ticket; UINT_MAX waits forever.
+         *
+         * @return true if a ticket was acquired; it must be given back with release().
+         */
+        bool acquire( Priority priority, unsigned timeoutMs );
+
+        /**
+         * Gives back a ticket which was acquired at 'acquiredMicros' and samples its latency.
+         * 'nowMicros' is the current time, from the same clock.
+         */
+        void release( long long acquiredMicros, long long nowMicros );
+
+        /**
+         * Changes the bounds on the limit, moving the limit into them if necessary.
+         */
+        void setLimits( int minTickets, int maxTickets );
+
+        int tickets() const;
+        int used() const;
+
+        /** Number of operations currently waiting for a ticket, of either priority. */
+        int waiting() const;
+
+        void appendStats( BSONObjBuilder& b ) const;
+
+    private:
+        void _wakeWaiters_inlock();
+
+        /** Ends the current sampling window and adjusts the limit. */
+        void _adjust_inlock( long long nowMicros );
+
+        const std::string _name;
+        const long long _windowMicros;
+        const double _latencyTolerance;
+
+        mutable boost::mutex _mutex;
+        boost::condition_variable _highPriorityWaiters;
+        boost::condition_variable _normalPriorityWaiters;
+
+        // Everything below is guarded by _mutex
+        int _minTickets;
+        int _maxTickets;
+        int _tickets;
+        int _used;
+        int _waitingHigh;
+        int _waitingNormal;
+
+        long long _windowStartMicros;
+        long long _windowOps;
+        long long _windowLatencyMicros;
+        bool _windowSaturated;
+
+        double _baselineLatencyMicros;
+        double _lastLatencyMicros;
+        double _lastThroughput;  // operations per second
+        const char* _lastDecision;
+
+        long long _totalAdmitted;
+        long long _totalQueued;
+        long long _totalTimedOut;
+        long long _increases;
+        long long _decreases;
+    };
+
+} // namespace mongo
@@ -0,0 +1,190 @@
+// admission_controller_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/admission_controller.h"
+
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/time_support.h"
+
+namespace {
+
+    using namespace mongo;
+
+    // Far enough from zero that no sample looks like the first of a window.
+    const long long kStart = 1000 * 1000;
+
+    AdmissionController::Options makeOptions( int minTickets, int maxTickets, int initial ) {
+        AdmissionController::Options options;
+        options.minTickets = minTickets;
+        options.maxTickets = maxTickets;
+        options.initialTickets = initial;
+        options.windowMicros = 1000;
+        return options;
+    }
+
+    BSONObj stats( const AdmissionController& ac ) {
+        BSONObjBuilder b;
+        ac.appendStats( b );
+        return b.obj();
+    }
+
+    void waitForQueued( const AdmissionController& ac, const char* priority, int n ) {
+        for ( int i = 0; i < 10000; i++ ) {
+            if ( stats( ac )["queue"].Obj()[priority].numberInt() == n )
+                return;
+            sleepmillis( 1 );
+        }
+        FAIL( "waiter never queued" );
+    }
+
+    TEST(AdmissionController, LimitsConcurrency) {
+        AdmissionController ac( "test", makeOptions( 1, 10, 2 ) );
+        ASSERT_TRUE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+        ASSERT_TRUE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+        ASSERT_FALSE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+        ASSERT_FALSE( ac.acquire( AdmissionController::kPriorityHigh, 10 ) );
+        ASSERT_EQUALS( 2, ac.used() );
+
+        ac.release( kStart, kStart + 10 );
+        ASSERT_TRUE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+
+        BSONObj s = stats( ac );
+        ASSERT_EQUALS( 3, s["admitted"].numberLong() );
+        ASSERT_EQUALS( 2, s["timedOut"].numberLong() );
+    }
+
+    TEST(AdmissionController, GrowsWhenSaturatedWithoutLatencyIncrease) {
+        AdmissionController ac( "test", makeOptions( 1, 3, 2 ) );
+
+        long long now = kStart;
+        for ( int window = 0; window < 4; window++ ) {
+            const int tickets = ac.tickets();
+            for ( int i = 0; i < tickets; i++ )
+                ASSERT_TRUE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+            for ( int i = tickets - 1; i >= 0; i-- )
+                ac.release( now, now + 1000 - 100 * i );
+            now += 1000;
+        }
+
+        // Grew by one, then stopped at the maximum.
+        ASSERT_EQUALS( 3, ac.tickets() );
+        ASSERT_EQUALS( 1, stats( ac )["increases"].numberLong() );
+    }
+
+    TEST(AdmissionController, HoldsWhenNotSaturated) {
+        AdmissionController ac( "test", makeOptions( 1, 10, 4 ) );
+
+        ASSERT_TRUE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+        ac.release( kStart, kStart + 2000 );
+
+        ASSERT_EQUALS( 4, ac.tickets() );
+        ASSERT_EQUALS( "hold", stats( ac )["lastDecision"].str() );
+    }
+
+    TEST(AdmissionController, ShrinksWhenLatencyRisesWithoutThroughput) {
+        AdmissionController ac( "test", makeOptions( 2, 20, 16 ) );
+
+        // A fast, saturated window establishes the baseline.
+        for ( int i = 0; i < 16; i++ )
+            ASSERT_TRUE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+        for ( int i = 0; i < 16; i++ )
+            ac.release( kStart, kStart + 100 + 60 * i );
+        ASSERT_EQUALS( 17, ac.tickets() );
+
+        // Then everything gets much slower and fewer operations complete.
+        ASSERT_TRUE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+        ac.release( kStart + 1000, kStart + 11000 );
+
+        ASSERT_EQUALS( 13, ac.tickets() );
+        BSONObj s = stats( ac );
+        ASSERT_EQUALS( 1, s["decreases"].numberLong() );
+        ASSERT_EQUALS( "decrease", s["lastDecision"].str() );
+        ASSERT_EQUALS( 10000, s["latencyMicros"].numberLong() );
+    }
+
+    TEST(AdmissionController, SetLimitsClampsTickets) {
+        AdmissionController ac( "test", makeOptions( 1, 10, 8 ) );
+        ac.setLimits( 1, 4 );
+        ASSERT_EQUALS( 4, ac.tickets() );
+        ac.setLimits( 6, 12 );
+        ASSERT_EQUALS( 6, ac.tickets() );
+        ac.setLimits( 5, 3 );
+        ASSERT_EQUALS( 5, ac.tickets() );
+    }
+
+    void acquireAndRecord( AdmissionController* ac,
+                           AdmissionController::Priority priority,
+                           std::vector<int>* order,
+                           boost::mutex* mutex,
+                           int id ) {
+        ASSERT_TRUE( ac->acquire( priority, UINT_MAX ) );
+        {
+            boost::lock_guard<boost::mutex> lk( *mutex );
+            order->push_back( id );
+        }
+        ac->release( kStart, kStart + 1 );
+    }
+
+    TEST(AdmissionController, HighPriorityWaitersGoFirst) {
+        AdmissionController ac( "test", makeOptions( 1, 1, 1 ) );
+        ASSERT_TRUE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+
+        std::vector<int> order;
+        boost::mutex mutex;
+
+        boost::thread normal( stdx::bind( acquireAndRecord, &ac,
+                                          AdmissionController::kPriorityNormal,
+                                          &order, &mutex, 1 ) );
+        waitForQueued( ac, "normal", 1 );
+
+        boost::thread high( stdx::bind( acquireAndRecord, &ac,
+                                        AdmissionController::kPriorityHigh,
+                                        &order, &mutex, 2 ) );
+        waitForQueued( ac, "high", 1 );
+
+        // A new normal priority operation can't jump ahead of the queued high priority one.
+        ASSERT_FALSE( ac.acquire( AdmissionController::kPriorityNormal, 0 ) );
+
+        ac.release( kStart, kStart + 1 );
+        normal.join();
+        high.join();
+
+        ASSERT_EQUALS( 2U, order.size() );
+        ASSERT_EQUALS( 2, order[0] );
+        ASSERT_EQUALS( 1, order[1] );
+        ASSERT_EQUALS( 0, ac.used() );
+    }
+
+} // namespace
@@ -0,0 +1,151 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/fair_rwlock.h"
+
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    FairRWLock::FairRWLock()
+        : _mutex("FairRWLock"),
+          _readers(0),
+          _writer(false),
+          _waitingReaders(0),
+          _waitingWriters(0),
+          _readerBatch(0) {
+
+    }
+
+    void FairRWLock::lock() {
+        scoped_lock lk(_mutex);
+
+        _waitingWriters++;
+        while (_writer || _readers > 0) {
+            _writersCondition.wait(lk.boost());
+        }
+        _waitingWriters--;
+
+        _writer = true;
+    }
+
+    void FairRWLock::unlock() {
+        scoped_lock lk(_mutex);
+
+        invariant(_writer);
+        _writer = false;
+
+        if (_waitingReaders > 0) {
+            // Admit everybody who queued up behind us. The waiting writers get their turn once
+            // this batch has unlocked.
+            _readers += _waitingReaders;
+            _waitingReaders = 0;
+            _readerBatch++;
+            _readersCondition.notify_all();
+        }
+        else if (_waitingWriters > 0) {
+            _writersCondition.notify_one();
+        }
+    }
+
+    void FairRWLock::lock_shared() {
+        scoped_lock lk(_mutex);
+
+        if (!_writer && _waitingWriters == 0) {
+            _readers++;
+            return;
+        }
+
+        // Wait for the next batch, which the unlocking writer has already counted us into
+        _waitingReaders++;
+        const unsigned long long batch = _readerBatch;
+        while (_readerBatch == batch) {
+            _readersCondition.wait(lk.boost());
+        }
+    }
+
+    void FairRWLock::unlock_shared() {
+        scoped_lock lk(_mutex);
+
+        invariant(_readers > 0);
+        _readers--;
+
+        if (_readers == 0 && _waitingWriters > 0) {
+            _writersCondition.notify_one();
+        }
+    }
+
+
+    FairRWLock::Exclusive::Exclusive(FairRWLock& lock) : _lock(lock) {
+        const int state = _lock._state.get();
+        invariant(state <= 0);
+
+        if (state == 0) {
+            _lock.lock();
+        }
+
+        _lock._state.set(state - 1);
+    }
+
+    FairRWLock::Exclusive::~Exclusive() {
+        const int state = _lock._state.get() + 1;
+        _lock._state.set(state);
+
+        if (state == 0) {
+            _lock.unlock();
+        }
+    }
+
+
+    FairRWLock::Shared::Shared(FairRWLock& lock) : _lock(lock) {
+        const int state = _lock._state.get();
+        _alreadyLockedExclusiveByUs = state < 0;
+
+        if (!_alreadyLockedExclusiveByUs) {
+            if (state == 0) {
+                _lock.lock_shared();
+            }
+
+            _lock._state.set(state + 1);
+        }
+    }
+
+    FairRWLock::Shared::~Shared() {
+        if (_alreadyLockedExclusiveByUs) return;
+
+        const int state = _lock._state.get() - 1;
+        _lock._state.set(state);
+
+        if (state == 0) {
+            _lock.unlock_shared();
+        }
+    }
+
+} // namespace mongo
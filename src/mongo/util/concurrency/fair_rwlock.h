@@ -0,0 +1,106 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/condition.hpp>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/threadlocal.h"
+
+namespace mongo {
+
+    /**
+     * Reader-writer lock, which prefers writers without starving readers.
+     *
+     * Once a writer is waiting, new readers queue up behind it instead of joining the readers
+     * which hold the lock, so a steady stream of readers cannot keep a writer out. When the
+     * writer releases the lock, all readers which queued up in the meantime are admitted as one
+     * batch, even if more writers are already waiting, so writers cannot starve readers either.
+     *
+     * Use through the Shared and Exclusive guards below, which make acquisitions recursive per
+     * thread. A thread, which already holds the lock in shared mode, does not queue up behind
+     * waiting writers (that would deadlock), and a thread holding it exclusively may also lock it
+     * in shared mode. Upgrading from shared to exclusive is not supported.
+     */
+    class FairRWLock {
+        MONGO_DISALLOW_COPYING(FairRWLock);
+    public:
+        FairRWLock();
+
+        void lock();
+        void unlock();
+
+        void lock_shared();
+        void unlock_shared();
+
+        /**
+         * Returns whether the calling thread holds the lock in any mode through the guards.
+         */
+        bool isHeldByThisThread() const { return _state.get() != 0; }
+
+        class Exclusive {
+            MONGO_DISALLOW_COPYING(Exclusive);
+        public:
+            explicit Exclusive(FairRWLock& lock);
+            ~Exclusive();
+
+        private:
+            FairRWLock& _lock;
+        };
+
+        class Shared {
+            MONGO_DISALLOW_COPYING(Shared);
+        public:
+            explicit Shared(FairRWLock& lock);
+            ~Shared();
+
+        private:
+            FairRWLock& _lock;
+            bool _alreadyLockedExclusiveByUs;
+        };
+
+    private:
+        mongo::mutex _mutex;
+        boost::condition _readersCondition; // signalled when a batch of readers is admitted
+        boost::condition _writersCondition; // signalled when the lock may be free for a writer
+
+        int _readers;        // admitted readers, which have not unlocked yet
+        bool _writer;        // a writer holds the lock
+        int _waitingReaders; // readers queued up for the next batch
+        int _waitingWriters;
+
+        // Incremented whenever a batch of readers is admitted, which queued readers wait for
+        unsigned long long _readerBatch;
+
+        // Per thread recursion count of the guards: positive for shared, negative for exclusive
+        ThreadLocalValue<int> _state;
+    };
+
+} // namespace mongo
@@ -0,0 +1,166 @@
+// thread_pool_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/thread/thread.hpp>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/fair_rwlock.h"
+#include "mongo/util/time_support.h"
+
+namespace {
+
+    using namespace mongo;
+
+    // Takes the lock in the given mode, records in which order it got it and holds it until told
+    // to let go
+    class LockHolder {
+    public:
+        LockHolder(FairRWLock* lock, bool exclusive, AtomicUInt32* order)
+            : acquiredAs(0),
+              _lock(lock),
+              _exclusive(exclusive),
+              _order(order),
+              _thread(&LockHolder::run, this) {
+
+        }
+
+        ~LockHolder() {
+            release();
+            _thread.join();
+        }
+
+        void release() { _release.store(1); }
+
+        void run() {
+            if (_exclusive) {
+                FairRWLock::Exclusive lk(*_lock);
+                hold();
+            }
+            else {
+                FairRWLock::Shared lk(*_lock);
+                hold();
+            }
+        }
+
+        // 0 while waiting for the lock, then how many acquired it before, plus one
+        AtomicUInt32 acquiredAs;
+
+    private:
+        void hold() {
+            acquiredAs.store(_order->addAndFetch(1));
+            while (!_release.load()) {
+                sleepmillis(1);
+            }
+        }
+
+        FairRWLock* const _lock;
+        const bool _exclusive;
+        AtomicUInt32* const _order;
+        AtomicUInt32 _release;
+        boost::thread _thread;
+    };
+
+    TEST(FairRWLock, Recursion) {
+        FairRWLock lock;
+
+        {
+            FairRWLock::Exclusive exclusive(lock);
+            FairRWLock::Exclusive nestedExclusive(lock);
+            FairRWLock::Shared nestedShared(lock);
+            ASSERT(lock.isHeldByThisThread());
+        }
+        ASSERT(!lock.isHeldByThisThread());
+
+        {
+            FairRWLock::Shared shared(lock);
+            FairRWLock::Shared nestedShared(lock);
+            ASSERT(lock.isHeldByThisThread());
+        }
+        ASSERT(!lock.isHeldByThisThread());
+    }
+
+    TEST(FairRWLock, NewReadersQueueBehindWaitingWriter) {
+        FairRWLock lock;
+        AtomicUInt32 order;
+
+        LockHolder reader1(&lock, false, &order);
+        while (!reader1.acquiredAs.load()) sleepmillis(1);
+
+        LockHolder writer(&lock, true, &order);
+        sleepmillis(50);
+
+        // Must not overtake the waiting writer
+        LockHolder reader2(&lock, false, &order);
+        sleepmillis(50);
+        ASSERT_EQUALS(0U, writer.acquiredAs.load());
+        ASSERT_EQUALS(0U, reader2.acquiredAs.load());
+
+        reader1.release();
+        while (!writer.acquiredAs.load()) sleepmillis(1);
+        ASSERT_EQUALS(0U, reader2.acquiredAs.load());
+
+        writer.release();
+        while (!reader2.acquiredAs.load()) sleepmillis(1);
+        ASSERT_EQUALS(2U, writer.acquiredAs.load());
+        ASSERT_EQUALS(3U, reader2.acquiredAs.load());
+    }
+
+    TEST(FairRWLock, QueuedReadersAreAdmittedTogether) {
+        FairRWLock lock;
+        AtomicUInt32 order;
+
+        LockHolder writer1(&lock, true, &order);
+        while (!writer1.acquiredAs.load()) sleepmillis(1);
+
+        LockHolder reader1(&lock, false, &order);
+        LockHolder reader2(&lock, false, &order);
+        sleepmillis(50);
+
+        LockHolder writer2(&lock, true, &order);
+        sleepmillis(50);
+
+        // Both readers get in ahead of the second writer, and at the same time
+        writer1.release();
+        while (!reader1.acquiredAs.load() || !reader2.acquiredAs.load()) sleepmillis(1);
+        sleepmillis(50);
+        ASSERT_EQUALS(0U, writer2.acquiredAs.load());
+
+        reader1.release();
+        sleepmillis(50);
+        ASSERT_EQUALS(0U, writer2.acquiredAs.load());
+
+        reader2.release();
+        while (!writer2.acquiredAs.load()) sleepmillis(1);
+        ASSERT_EQUALS(4U, writer2.acquiredAs.load());
+    }
+
+} // namespace
@@ -0,0 +1,129 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include "mongo/platform/cstdint.h"
+#include "mongo/platform/unordered_set.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    /**
+     * A set of pointers split into shards, each guarded by its own mutex, so that registering and
+     * unregistering members from many threads at once does not serialize on one lock.
+     *
+     * A member always goes to the same shard, which is picked from its address. forEach visits
+     * one shard at a time with only that shard locked, so a walk over the registry blocks at most
+     * the 1/kNumShards of the registrations which fall into the shard being visited. Holding
+     * mutexFor(member) keeps the member from being removed from the registry.
+     */
+    template <typename T>
+    class ShardedRegistry : boost::noncopyable {
+    public:
+        enum { kShardBits = 4, kNumShards = 1 << kShardBits };
+
+        ShardedRegistry() { }
+
+        /**
+         * Adds the member, which must not be in the registry.
+         */
+        void add(T* member) {
+            Shard& shard = _shardFor(member);
+            scoped_lock lk(shard.mutex);
+            const bool inserted = shard.members.insert(member).second;
+            invariant(inserted);
+        }
+
+        /**
+         * Removes the member, if it is in the registry. Returns whether it was.
+         */
+        bool remove(T* member) {
+            Shard& shard = _shardFor(member);
+            scoped_lock lk(shard.mutex);
+            return shard.members.erase(member) != 0;
+        }
+
+        /**
+         * The mutex of the shard which the member does or would belong to, held by forEach
+         * while it calls the function with the member.
+         */
+        mongo::mutex& mutexFor(const T* member) {
+            return _shardFor(member).mutex;
+        }
+
+        /**
+         * Calls function(member) for each member, with the shard of the member locked. The
+         * function must not add or remove members, nor call back into forEach.
+         */
+        template <typename Function>
+        void forEach(Function& function) {
+            for (int i = 0; i < kNumShards; i++) {
+                scoped_lock lk(_shards[i].mutex);
+
+                typename MemberSet::const_iterator it;
+                for (it = _shards[i].members.begin(); it != _shards[i].members.end(); ++it) {
+                    function(*it);
+                }
+            }
+        }
+
+        size_t size() {
+            size_t total = 0;
+            for (int i = 0; i < kNumShards; i++) {
+                scoped_lock lk(_shards[i].mutex);
+                total += _shards[i].members.size();
+            }
+            return total;
+        }
+
+    private:
+        typedef unordered_set<T*> MemberSet;
+
+        struct Shard {
+            Shard() : mutex("ShardedRegistry") { }
+
+            mongo::mutex mutex;
+            MemberSet members;
+        };
+
+        Shard& _shardFor(const T* member) {
+            // Objects of the same type are allocated at regular strides, so mix the address
+            // before using its top bits
+            const uint64_t mixed = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(member))
+                                        * 0x9E3779B97F4A7C15ULL;
+            return _shards[mixed >> (64 - kShardBits)];
+        }
+
+        Shard _shards[kNumShards];
+    };
+
+}  // namespace mongo
@@ -0,0 +1,126 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <vector>
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/sharded_registry.h"
+
+namespace {
+
+    using namespace mongo;
+
+    struct Member {
+        Member() : visits(0) { }
+        int visits;
+    };
+
+    struct CountVisits {
+        CountVisits() : total(0) { }
+        void operator()(Member* member) { member->visits++; total++; }
+        int total;
+    };
+
+    TEST(ShardedRegistry, AddRemoveForEach) {
+        ShardedRegistry<Member> registry;
+        std::vector<Member> members(100);
+
+        for (size_t i = 0; i < members.size(); i++) {
+            registry.add(&members[i]);
+        }
+        ASSERT_EQUALS(100U, registry.size());
+
+        ASSERT(registry.remove(&members[0]));
+        ASSERT(!registry.remove(&members[0]));
+        ASSERT_EQUALS(99U, registry.size());
+
+        CountVisits counter;
+        registry.forEach(counter);
+        ASSERT_EQUALS(99, counter.total);
+
+        ASSERT_EQUALS(0, members[0].visits);
+        for (size_t i = 1; i < members.size(); i++) {
+            ASSERT_EQUALS(1, members[i].visits);
+        }
+    }
+
+    TEST(ShardedRegistry, MembersSpreadOverShards) {
+        ShardedRegistry<Member> registry;
+        std::vector<Member> members(1000);
+
+        int distinctMutexes = 0;
+        std::vector<mongo::mutex*> seen;
+        for (size_t i = 0; i < members.size(); i++) {
+            mongo::mutex* m = &registry.mutexFor(&members[i]);
+            if (std::find(seen.begin(), seen.end(), m) == seen.end()) {
+                seen.push_back(m);
+                distinctMutexes++;
+            }
+        }
+
+        // Adjacent members must not all collapse onto one shard
+        ASSERT_GREATER_THAN(distinctMutexes, 1);
+        ASSERT_LESS_THAN_OR_EQUALS(distinctMutexes,
+                                   static_cast<int>(ShardedRegistry<Member>::kNumShards));
+    }
+
+    void addAndRemove(ShardedRegistry<Member>* registry, std::vector<Member>* members) {
+        for (int round = 0; round < 10; round++) {
+            for (size_t i = 0; i < members->size(); i++) {
+                registry->add(&(*members)[i]);
+            }
+            for (size_t i = 0; i < members->size(); i++) {
+                ASSERT(registry->remove(&(*members)[i]));
+            }
+        }
+    }
+
+    TEST(ShardedRegistry, ConcurrentRegistration) {
+        ShardedRegistry<Member> registry;
+        std::vector<std::vector<Member> > members(4, std::vector<Member>(200));
+
+        boost::thread_group threads;
+        for (size_t i = 0; i < members.size(); i++) {
+            threads.create_thread(boost::bind(addAndRemove, &registry, &members[i]));
+        }
+
+        for (int i = 0; i < 100; i++) {
+            CountVisits counter;
+            registry.forEach(counter);
+        }
+
+        threads.join_all();
+        ASSERT_EQUALS(0U, registry.size());
+    }
+
+} // namespace
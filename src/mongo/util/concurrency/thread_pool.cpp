@@ -34,52 +34,102 @@
 
 #include "mongo/util/concurrency/thread_pool.h"
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread/thread.hpp>
 
-#include "mongo/util/concurrency/mvar.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/numa_placement.h"
 
 namespace mongo {
     namespace threadpool {
 
-        // Worker thread
+        namespace {
+            // Upper bound of the number of tasks a worker takes from the shared queue at once
+            const size_t kMaxBatchSize = 64;
+        }
+
+        // Worker thread slot. The thread of a slot may exit when the pool shrinks and a new one
+        // is started in it when the pool grows again, but the slot and its deque stay around
+        // until the pool is destroyed, so other workers can steal from it without any locking
+        // other than that of the deque.
         class Worker : boost::noncopyable {
         public:
-            explicit Worker(ThreadPool& owner, const std::string& threadName)
+            Worker(ThreadPool& owner, int index)
                 : _owner(owner)
-                , _is_done(true)
-                , _thread(stdx::bind(&Worker::loop, this, threadName))
+                , _index(index)
+                , _mutex("ThreadPoolWorker")
+                , _running(false)
             {}
 
-            // destructor will block until current operation is completed
-            // Acts as a "join" on this thread
-            ~Worker() {
-                _task.put(Task());
-                _thread.join();
+            // The pool's shutdown makes the thread exit. Every slot must be joined before any is
+            // destroyed, because a running thread may still be stealing from the others.
+            void join() {
+                if (_thread)
+                    _thread->join();
             }
 
-            void set_task(Task& func) {
-                verify(func);
-                verify(_is_done);
-                _is_done = false;
+            // must be called with the pool mutex held
+            void start(const std::string& threadName) {
+                verify(!_running);
+                if (_thread) {
+                    // The previous thread of this slot exited when the pool shrank
+                    _thread->join();
+                }
+
+                _running = true;
+                _thread.reset(new boost::thread(stdx::bind(&Worker::loop, this, threadName)));
+            }
+
+            int index() const { return _index; }
+
+            // These are protected by the pool mutex
+            bool running() const { return _running; }
+            void stopped() { _running = false; }
+
+            bool pop(Task* task) {
+                SimpleMutex::scoped_lock lock(_mutex);
+                if (_tasks.empty())
+                    return false;
+
+                task->swap(_tasks.front());
+                _tasks.pop_front();
+                return true;
+            }
+
+            void push(std::vector<Task>* tasks) {
+                SimpleMutex::scoped_lock lock(_mutex);
+                for (size_t i = 0; i < tasks->size(); i++) {
+                    _tasks.push_back(Task());
+                    _tasks.back().swap((*tasks)[i]);
+                }
+            }
 
-                _task.put(func);
+            // moves the newer half of the tasks of this worker to 'stolen'
+            void stealHalf(std::vector<Task>* stolen) {
+                SimpleMutex::scoped_lock lock(_mutex);
+                const size_t n = (_tasks.size() + 1) / 2;
+                stolen->resize(n);
+                for (size_t i = 0; i < n; i++) {
+                    (*stolen)[i].swap(_tasks.back());
+                    _tasks.pop_back();
+                }
             }
 
         private:
             ThreadPool& _owner;
-            MVar<Task> _task;
-            bool _is_done; // only used for error detection
-            boost::thread _thread;
+            const int _index;
+            SimpleMutex _mutex; // protects _tasks
+            std::deque<Task> _tasks;
+            bool _running;
+            boost::scoped_ptr<boost::thread> _thread;
 
             void loop(const std::string& threadName) {
                 setThreadName(threadName);
-                while (true) {
-                    Task task = _task.take();
-                    if (!task)
-                        break; // ends the thread
+                NumaPlacement::bindCurrentThread(NumaPlacement::nextNode());
 
+                Task task;
+                while (_owner._getTask(this, &task)) {
                     try {
                         task();
                     }
@@ -92,7 +142,9 @@ namespace mongo {
                     catch (...) {
                         log() << "Unhandled non-exception in worker thread" << endl;
                     }
-                    _is_done = true;
+
+                    // Release whatever the task holds on to before reporting it done
+                    task = Task();
                     _owner.task_done(this);
                 }
             }
@@ -100,7 +152,8 @@ namespace mongo {
 
         ThreadPool::ThreadPool(int nThreads, const std::string& threadNamePrefix)
             : _mutex("ThreadPool"), _tasksRemaining(0)
-            , _nThreads(nThreads)
+            , _nThreads(0), _nIdle(0), _nWakeups(0), _started(false), _shuttingDown(false)
+            , _minThreads(nThreads), _maxThreads(nThreads), _idleTimeoutMillis(0)
             , _threadNamePrefix(threadNamePrefix) {
             startThreads();
         }
@@ -109,75 +162,251 @@ namespace mongo {
                                int nThreads,
                                const std::string& threadNamePrefix)
             : _mutex("ThreadPool"), _tasksRemaining(0)
-            , _nThreads(nThreads)
+            , _nThreads(0), _nIdle(0), _nWakeups(0), _started(false), _shuttingDown(false)
+            , _minThreads(nThreads), _maxThreads(nThreads), _idleTimeoutMillis(0)
             , _threadNamePrefix(threadNamePrefix) {
         }
 
+        ThreadPool::ThreadPool(int minThreads,
+                               int maxThreads,
+                               const std::string& threadNamePrefix,
+                               int idleTimeoutMillis)
+            : _mutex("ThreadPool"), _tasksRemaining(0)
+            , _nThreads(0), _nIdle(0), _nWakeups(0), _started(false), _shuttingDown(false)
+            , _minThreads(minThreads), _maxThreads(maxThreads)
+            , _idleTimeoutMillis(idleTimeoutMillis)
+            , _threadNamePrefix(threadNamePrefix) {
+            verify(minThreads >= 0);
+            verify(maxThreads >= 1);
+            verify(minThreads <= maxThreads);
+            startThreads();
+        }
+
         void ThreadPool::startThreads() {
             scoped_lock lock(_mutex);
-            for (int i = 0; i < _nThreads; ++i) {
-                const std::string threadName(_threadNamePrefix.empty() ?
-                                                        _threadNamePrefix :
-                                                        str::stream() << _threadNamePrefix << i);
-                Worker* worker = new Worker(*this, threadName);
-                if (_tasks.empty()) {
-                    _freeWorkers.push_front(worker);
-                }
-                else {
-                    worker->set_task(_tasks.front());
-                    _tasks.pop_front();
-                }
+            verify(!_started);
+            _started = true;
+
+            for (int i = 0; i < _maxThreads; ++i) {
+                _workers.push_back(new Worker(*this, i));
             }
+
+            for (int i = 0; i < _minThreads; ++i) {
+                _startWorker_inlock();
+            }
+
+            // Tasks scheduled before the threads were started may warrant more of them
+            _dispatch_inlock(_tasks.size());
         }
 
         ThreadPool::~ThreadPool() {
             join();
 
-            verify(_tasksRemaining == 0);
+            verify(_tasksRemaining.load() == 0);
 
-            while(!_freeWorkers.empty()) {
-                delete _freeWorkers.front();
-                _freeWorkers.pop_front();
+            {
+                scoped_lock lock(_mutex);
+                _shuttingDown = true;
+                _condition.notify_all();
+            }
+
+            for (size_t i = 0; i < _workers.size(); i++) {
+                _workers[i]->join();
+            }
+
+            for (size_t i = 0; i < _workers.size(); i++) {
+                delete _workers[i];
             }
         }
 
         void ThreadPool::join() {
             scoped_lock lock(_mutex);
-            while(_tasksRemaining) {
-                _condition.wait(lock.boost());
+            while(_tasksRemaining.load()) {
+                _doneCondition.wait(lock.boost());
             }
         }
 
         void ThreadPool::schedule(Task task) {
             scoped_lock lock(_mutex);
 
-            _tasksRemaining++;
+            _tasksRemaining.addAndFetch(1);
+            _tasks.push_back(task);
+
+            _dispatch_inlock(1);
+        }
+
+        void ThreadPool::scheduleBatch(const std::vector<Task>& tasks) {
+            if (tasks.empty())
+                return;
+
+            scoped_lock lock(_mutex);
+
+            _tasksRemaining.addAndFetch(static_cast<int>(tasks.size()));
+            _tasks.insert(_tasks.end(), tasks.begin(), tasks.end());
 
-            if (!_freeWorkers.empty()) {
-                _freeWorkers.front()->set_task(task);
-                _freeWorkers.pop_front();
+            _dispatch_inlock(tasks.size());
+        }
+
+        int ThreadPool::threads_running() {
+            scoped_lock lock(_mutex);
+            return _nThreads;
+        }
+
+        void ThreadPool::_dispatch_inlock(size_t nTasks) {
+            if (!_started)
+                return;
+
+            size_t nWake = 0;
+            while ((nWake < nTasks) && _wakeOne_inlock()) {
+                nWake++;
             }
-            else {
-                _tasks.push_back(task);
+
+            for (size_t i = nWake; (i < nTasks) && (_nThreads < _maxThreads); i++) {
+                _startWorker_inlock();
             }
         }
 
+        bool ThreadPool::_wakeOne_inlock() {
+            if (_nIdle == 0)
+                return false;
+
+            // Count the thread as busy right away, so that schedules following in quick succession
+            // start new threads rather than notify the same sleeper again
+            _nIdle--;
+            _nWakeups++;
+            _condition.notify_one();
+            return true;
+        }
+
+        void ThreadPool::_startWorker_inlock() {
+            for (size_t i = 0; i < _workers.size(); i++) {
+                Worker* worker = _workers[i];
+                if (worker->running())
+                    continue;
+
+                const std::string threadName(_threadNamePrefix.empty() ?
+                                                        _threadNamePrefix :
+                                                        str::stream() << _threadNamePrefix << i);
+                worker->start(threadName);
+                _nThreads++;
+                return;
+            }
+
+            verify(false);
+        }
+
         // should only be called by a worker from the worker thread
-        void ThreadPool::task_done(Worker* worker) {
+        bool ThreadPool::_getTask(Worker* worker, Task* task) {
+            while (true) {
+                if (worker->pop(task))
+                    return true;
+
+                if (_takeBatch(worker, task))
+                    return true;
+
+                if (_stealTask(worker, task))
+                    return true;
+
+                scoped_lock lock(_mutex);
+
+                if (!_tasks.empty())
+                    continue;
+
+                if (_shuttingDown) {
+                    _nThreads--;
+                    worker->stopped();
+                    return false;
+                }
+
+                _nIdle++;
+
+                bool timedOut = false;
+                if (_minThreads < _maxThreads) {
+                    timedOut = !_condition.timed_wait(
+                                        lock.boost(),
+                                        boost::posix_time::milliseconds(_idleTimeoutMillis));
+                }
+                else {
+                    _condition.wait(lock.boost());
+                }
+
+                // Either this thread was woken by _wakeOne_inlock, or another one which was woken
+                // that way timed out at the same time and already counted itself as not idle
+                if (_nWakeups > 0) {
+                    _nWakeups--;
+                }
+                else {
+                    _nIdle--;
+                }
+
+                if (timedOut && _tasks.empty() && !_shuttingDown && (_nThreads > _minThreads)) {
+                    _nThreads--;
+                    worker->stopped();
+                    return false;
+                }
+            }
+        }
+
+        bool ThreadPool::_takeBatch(Worker* worker, Task* task) {
             scoped_lock lock(_mutex);
+            if (_tasks.empty())
+                return false;
 
-            if (!_tasks.empty()) {
-                worker->set_task(_tasks.front());
-                _tasks.pop_front();
+            // Take a share of the queue at once, the other workers can steal it back
+            const size_t batchSize =
+                std::min(kMaxBatchSize, std::max<size_t>(1, _tasks.size() / _nThreads));
+
+            task->swap(_tasks.front());
+            _tasks.pop_front();
+
+            if (batchSize > 1) {
+                std::vector<Task> batch(batchSize - 1);
+                for (size_t i = 0; i < batch.size(); i++) {
+                    batch[i].swap(_tasks.front());
+                    _tasks.pop_front();
+                }
+                worker->push(&batch);
             }
-            else {
-                _freeWorkers.push_front(worker);
+
+            if ((batchSize > 1) || !_tasks.empty()) {
+                _wakeOne_inlock();
             }
 
-            _tasksRemaining--;
+            return true;
+        }
 
-            if(_tasksRemaining == 0)
-                _condition.notify_all();
+        bool ThreadPool::_stealTask(Worker* thief, Task* task) {
+            std::vector<Task> stolen;
+
+            const size_t nWorkers = _workers.size();
+            for (size_t i = 1; i < nWorkers; i++) {
+                Worker* victim = _workers[(thief->index() + i) % nWorkers];
+                victim->stealHalf(&stolen);
+                if (stolen.empty())
+                    continue;
+
+                task->swap(stolen.back());
+                stolen.pop_back();
+
+                if (!stolen.empty()) {
+                    thief->push(&stolen);
+
+                    scoped_lock lock(_mutex);
+                    _wakeOne_inlock();
+                }
+
+                return true;
+            }
+
+            return false;
+        }
+
+        // should only be called by a worker from the worker thread
+        void ThreadPool::task_done(Worker* worker) {
+            if (_tasksRemaining.subtractAndFetch(1) == 0) {
+                scoped_lock lock(_mutex);
+                _doneCondition.notify_all();
+            }
         }
 
     } //namespace threadpool
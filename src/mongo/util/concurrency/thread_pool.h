@@ -29,10 +29,12 @@
 
 #pragma once
 
-#include <list>
+#include <deque>
+#include <vector>
 
 #include <boost/thread/condition.hpp>
 
+#include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/util/concurrency/mutex.h"
 
@@ -43,6 +45,17 @@ namespace mongo {
 
         typedef stdx::function<void(void)> Task; //nullary function or functor
 
+        /**
+         * Each worker thread keeps a deque of tasks. Scheduled tasks go on a shared queue, from
+         * which an idle worker takes a batch at a time, so that scheduling many small tasks does
+         * not mean one acquisition of the shared mutex per task on the worker side. A worker
+         * with nothing left steals half of the deque of another worker, so a few long tasks do
+         * not leave the rest of a batch waiting behind them.
+         *
+         * The pool can be sized dynamically: it then starts with the minimum number of threads,
+         * starts another one whenever a task is scheduled while all are busy, and lets threads
+         * above the minimum exit after they have been idle for a while.
+         */
         // exported to the mongo namespace
         class ThreadPool : boost::noncopyable {
         public:
@@ -53,6 +66,12 @@ namespace mongo {
                                 int nThreads=8,
                                 const std::string& threadNamePrefix="");
 
+            // dynamically sized between minThreads and maxThreads, see above
+            ThreadPool(int minThreads,
+                       int maxThreads,
+                       const std::string& threadNamePrefix,
+                       int idleTimeoutMillis=30000);
+
             // blocks until all tasks are complete (tasks_remaining() == 0)
             // You should not call schedule while in the destructor
             ~ThreadPool();
@@ -69,6 +88,9 @@ namespace mongo {
             // task will be copied a few times so make sure it's relatively cheap
             void schedule(Task task);
 
+            // schedules all of the tasks under a single acquisition of the pool mutex
+            void scheduleBatch(const std::vector<Task>& tasks);
+
             // Helpers that wrap schedule and stdx::bind.
             // Functor and args will be copied a few times so make sure it's relatively cheap
             template<typename F, typename A>
@@ -82,19 +104,40 @@ namespace mongo {
             template<typename F, typename A, typename B, typename C, typename D, typename E>
             void schedule(F f, A a, B b, C c, D d, E e) { schedule(stdx::bind(f,a,b,c,d,e)); }
 
-            int tasks_remaining() { return _tasksRemaining; }
+            int tasks_remaining() { return _tasksRemaining.load(); }
+
+            // number of worker threads currently running
+            int threads_running();
 
         private:
             mongo::mutex _mutex;
-            boost::condition _condition;
-
-            std::list<Worker*> _freeWorkers; //used as LIFO stack (always front)
-            std::list<Task> _tasks; //used as FIFO queue (push_back, pop_front)
-            int _tasksRemaining; // in queue + currently processing
-            int _nThreads; // only used for sanity checking. could be removed in the future.
+            boost::condition _condition; // signalled when there are tasks for idle workers
+            boost::condition _doneCondition; // signalled when _tasksRemaining drops to zero
+
+            std::deque<Task> _tasks; // shared FIFO queue, from which workers take batches
+            std::vector<Worker*> _workers; // one slot per possible thread, created on start
+            AtomicInt32 _tasksRemaining; // in any queue + currently processing
+            int _nThreads; // threads running
+            int _nIdle; // threads waiting on _condition, which have not been notified
+            int _nWakeups; // threads notified, which have not woken up yet
+            bool _started;
+            bool _shuttingDown;
+            const int _minThreads;
+            const int _maxThreads;
+            const int _idleTimeoutMillis;
             const std::string _threadNamePrefix; // used for logging/diagnostics
 
-            // should only be called by a worker from the worker's thread
+            // Wakes idle workers, or starts new ones if the pool may grow, for newly queued tasks.
+            // Must be called with _mutex held.
+            void _dispatch_inlock(size_t nTasks);
+            bool _wakeOne_inlock();
+            void _startWorker_inlock();
+
+            // should only be called by a worker from the worker's thread. Returns false if the
+            // worker should exit.
+            bool _getTask(Worker* worker, Task* task);
+            bool _takeBatch(Worker* worker, Task* task);
+            bool _stealTask(Worker* thief, Task* task);
             void task_done(Worker* worker);
             friend class Worker;
         };
@@ -0,0 +1,146 @@
+// thread_pool_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <vector>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/time_support.h"
+
+namespace {
+
+    using namespace mongo;
+
+    void increment(AtomicUInt32* counter) {
+        counter->fetchAndAdd(1);
+    }
+
+    void sleepAndIncrement(int millis, AtomicUInt32* counter) {
+        sleepmillis(millis);
+        counter->fetchAndAdd(1);
+    }
+
+    TEST(ThreadPool, ScheduleAndJoin) {
+        AtomicUInt32 counter;
+        ThreadPool pool(4, "test");
+
+        for (int i = 0; i < 10000; i++) {
+            pool.schedule(&increment, &counter);
+        }
+
+        pool.join();
+        ASSERT_EQUALS(10000U, counter.load());
+        ASSERT_EQUALS(0, pool.tasks_remaining());
+    }
+
+    TEST(ThreadPool, ScheduleBatch) {
+        AtomicUInt32 counter;
+        ThreadPool pool(4, "test");
+
+        std::vector<threadpool::Task> tasks;
+        for (int i = 0; i < 1000; i++) {
+            tasks.push_back(stdx::bind(&increment, &counter));
+        }
+
+        for (int i = 0; i < 10; i++) {
+            pool.scheduleBatch(tasks);
+        }
+
+        pool.join();
+        ASSERT_EQUALS(10000U, counter.load());
+    }
+
+    TEST(ThreadPool, TasksScheduledBeforeStart) {
+        AtomicUInt32 counter;
+        ThreadPool pool(ThreadPool::DoNotStartThreadsTag(), 2, "test");
+
+        for (int i = 0; i < 100; i++) {
+            pool.schedule(&increment, &counter);
+        }
+
+        ASSERT_EQUALS(100, pool.tasks_remaining());
+
+        pool.startThreads();
+        pool.join();
+        ASSERT_EQUALS(100U, counter.load());
+    }
+
+    TEST(ThreadPool, IdleWorkersStealFromBusyOnes) {
+        AtomicUInt32 counter;
+        ThreadPool pool(4, "test");
+
+        // Each worker takes a quarter of the batch at once. Without stealing, the worker which got
+        // the slow tasks would run them all one after the other.
+        std::vector<threadpool::Task> tasks;
+        for (int i = 0; i < 16; i++) {
+            tasks.push_back(stdx::bind(&sleepAndIncrement, i < 4 ? 200 : 1, &counter));
+        }
+
+        const Date_t start = jsTime();
+        pool.scheduleBatch(tasks);
+        pool.join();
+
+        ASSERT_EQUALS(16U, counter.load());
+        ASSERT_LESS_THAN(jsTime() - start, 700U);
+    }
+
+    TEST(ThreadPool, DynamicSizing) {
+        AtomicUInt32 counter;
+        ThreadPool pool(1, 4, "test", 100);
+        ASSERT_EQUALS(1, pool.threads_running());
+
+        for (int i = 0; i < 8; i++) {
+            pool.schedule(&sleepAndIncrement, 50, &counter);
+        }
+
+        ASSERT_EQUALS(4, pool.threads_running());
+
+        pool.join();
+        ASSERT_EQUALS(8U, counter.load());
+
+        // The threads above the minimum exit once idle
+        for (int i = 0; (i < 100) && (pool.threads_running() > 1); i++) {
+            sleepmillis(20);
+        }
+
+        ASSERT_EQUALS(1, pool.threads_running());
+
+        // ... and come back when needed
+        for (int i = 0; i < 8; i++) {
+            pool.schedule(&sleepAndIncrement, 10, &counter);
+        }
+
+        pool.join();
+        ASSERT_EQUALS(16U, counter.load());
+    }
+
+} // namespace
@@ -0,0 +1,107 @@
+// cycle_clock.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/cycle_clock.h"
+
+#include <ctime>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define MONGO_CYCLE_CLOCK_TSC
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MONGO_CYCLE_CLOCK_TSC
+#endif
+
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    namespace {
+        // Where both clocks were at startup, from which the counter's rate is worked out.
+        const unsigned long long startTicks = CycleClock::now();
+        const unsigned long long startMicros = curTimeMicros64();
+    }  // namespace
+
+    unsigned long long CycleClock::now() {
+#if defined(MONGO_CYCLE_CLOCK_TSC) && defined(_MSC_VER)
+        return __rdtsc();
+#elif defined(MONGO_CYCLE_CLOCK_TSC)
+        unsigned int lo, hi;
+        __asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+        return (static_cast<unsigned long long>(hi) << 32) | lo;
+#else
+        return curTimeMicros64() * 1000;
+#endif
+    }
+
+    long long CycleClock::toNanos(unsigned long long ticks) {
+#if defined(MONGO_CYCLE_CLOCK_TSC)
+        const unsigned long long elapsedTicks = now() - startTicks;
+        const unsigned long long elapsedMicros = curTimeMicros64() - startMicros;
+        if (0 == elapsedTicks || 0 == elapsedMicros) {
+            return 0;
+        }
+
+        return static_cast<long long>(static_cast<double>(ticks) *
+                                      (static_cast<double>(elapsedMicros) * 1000) /
+                                      static_cast<double>(elapsedTicks));
+#else
+        return static_cast<long long>(ticks);
+#endif
+    }
+
+    long long CycleClock::threadCpuNanos() {
+#if defined(_WIN32)
+        FILETIME creation, exit, kernel, user;
+        if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+            return 0;
+        }
+
+        // FILETIMEs count 100 nanosecond intervals.
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime;
+        k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = user.dwLowDateTime;
+        u.HighPart = user.dwHighDateTime;
+        return static_cast<long long>((k.QuadPart + u.QuadPart) * 100);
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+        timespec ts;
+        if (0 != clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) {
+            return 0;
+        }
+
+        return static_cast<long long>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+#else
+        return 0;
+#endif
+    }
+
+}  // namespace mongo
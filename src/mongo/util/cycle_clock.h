@@ -0,0 +1,60 @@
+// cycle_clock.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+namespace mongo {
+
+    /**
+     * A clock for timing short spans of code as cheaply as possible.  On x86 it reads the time
+     * stamp counter, which takes a few nanoseconds and no system call; elsewhere it falls back to
+     * the system clock.  A reading is only meaningful as the difference of two of them, which
+     * toNanos() converts.
+     *
+     * The counter's rate is measured against the system clock over the life of the process, so
+     * conversions made just after startup are the least accurate.  Readings taken on different
+     * CPUs are assumed comparable, as they are with the invariant TSC of current processors.
+     */
+    class CycleClock {
+    public:
+        static unsigned long long now();
+
+        /**
+         * Converts a difference of two now() readings to nanoseconds.
+         */
+        static long long toNanos(unsigned long long ticks);
+
+        /**
+         * The CPU time used so far by the calling thread, in nanoseconds, or 0 if the platform
+         * can't tell.  This costs a system call on most platforms.
+         */
+        static long long threadCpuNanos();
+    };
+
+}  // namespace mongo
@@ -0,0 +1,62 @@
+// cycle_clock_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/cycle_clock.h"
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/time_support.h"
+
+namespace {
+
+    using namespace mongo;
+
+    TEST(CycleClock, MeasuresASleep) {
+        const unsigned long long start = CycleClock::now();
+        sleepmillis(50);
+        const long long nanos = CycleClock::toNanos(CycleClock::now() - start);
+
+        ASSERT_GREATER_THAN_OR_EQUALS(nanos, 40LL * 1000 * 1000);
+        ASSERT_LESS_THAN(nanos, 5000LL * 1000 * 1000);
+    }
+
+    TEST(CycleClock, ThreadCpuTimeDoesNotGoBackwards) {
+        const long long start = CycleClock::threadCpuNanos();
+
+        // Keep the CPU busy for a little while.
+        volatile unsigned long long sum = 0;
+        for (int i = 0; i < 10 * 1000 * 1000; ++i) {
+            sum += i;
+        }
+
+        ASSERT_GREATER_THAN_OR_EQUALS(CycleClock::threadCpuNanos(), start);
+    }
+
+} // namespace
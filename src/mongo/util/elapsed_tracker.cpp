@@ -43,8 +43,9 @@ namespace mongo {
         _last( Listener::getElapsedTimeMillis() ) {
     }
 
-    bool ElapsedTracker::intervalHasElapsed() {
-        if ( ++_pings >= _hitsBetweenMarks ) {
+    bool ElapsedTracker::intervalHasElapsed( int32_t hits ) {
+        _pings += hits;
+        if ( _pings >= _hitsBetweenMarks ) {
             _pings = 0;
             _last = Listener::getElapsedTimeMillis();
             return true;
@@ -40,10 +40,10 @@ namespace mongo {
         ElapsedTracker( int32_t hitsBetweenMarks, int32_t msBetweenMarks );
 
         /**
-         * Call this for every iteration.
+         * Call this for every iteration, or once for every 'hits' iterations.
          * @return true if one of the triggers has gone off.
          */
-        bool intervalHasElapsed();
+        bool intervalHasElapsed( int32_t hits = 1 );
 
         void resetLastTime();
         
@@ -33,6 +33,7 @@
 
 #include "mongo/util/file_allocator.h"
 
+#include <algorithm>
 #include <boost/thread.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <errno.h>
@@ -44,13 +45,16 @@
 #endif
 
 #if defined(__linux__)
+#   include <sys/syscall.h>
 #   include <sys/vfs.h>
+#   include <unistd.h>
 #endif
 
 #if defined(_WIN32)
 #   include <io.h>
 #endif
 
+#include "mongo/db/server_parameters.h"
 #include "mongo/platform/posix_fadvise.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/util/concurrency/thread_name.h"
@@ -77,6 +81,10 @@ namespace mongo {
 
     MONGO_FP_DECLARE(allocateDiskFull);
 
+    // Number of files which may be allocated at the same time.  A burst of inserts into new
+    // databases otherwise waits for each file in turn.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(fileAllocatorThreads, int, 2);
+
     /**
      * Aliases for Win32 CRT functions
      */
@@ -106,7 +114,16 @@ namespace mongo {
 
 
     void FileAllocator::start() {
-        boost::thread t( stdx::bind( &FileAllocator::run , this ) );
+        {
+            // initialize unique temporary file name counter
+            // TODO: SERVER-6055 -- Unify temporary file name selection
+            SimpleMutex::scoped_lock lk(_uniqueNumberMutex);
+            _uniqueNumber = curTimeMicros64();
+        }
+        const int threads = std::max(1, fileAllocatorThreads);
+        for ( int i = 0; i < threads; i++ ) {
+            boost::thread t( stdx::bind( &FileAllocator::run , this ) );
+        }
     }
 
     void FileAllocator::requestAllocation( const string &name, long &size ) {
@@ -138,13 +155,11 @@ namespace mongo {
         }
         checkFailure();
         _pendingSize[ name ] = size;
-        if ( _pending.size() == 0 )
-            _pending.push_back( name );
-        else if ( _pending.front() != name ) {
+        if ( _pending.empty() || _pending.front() != name ) {
+            // the workers skip the files already being allocated, so the front of the list is
+            // the next one a free worker takes
             _pending.remove( name );
-            list< string >::iterator i = _pending.begin();
-            ++i;
-            _pending.insert( i, name );
+            _pending.push_front( name );
         }
         _pendingUpdated.notify_all();
         while( inProgress( name ) ) {
@@ -210,7 +225,22 @@ namespace mongo {
         }
 #endif
 
-#if defined(__linux__)
+#if defined(__linux__) && defined(SYS_fallocate)
+        // Ask the filesystem directly.  Where it can't allocate space, posix_fallocate would
+        // emulate it by writing to every block of the file, which takes minutes for a 2GB file;
+        // the fallback below is much cheaper.
+        if ( syscall(SYS_fallocate, fd, 0, (off_t)0, (off_t)size) == 0 )
+            return;
+
+        const int err = errno;
+        if ( err == EOPNOTSUPP || err == ENOSYS ) {
+            LOG(1) << "FileAllocator: fallocate not supported, falling back" << endl;
+        }
+        else {
+            log() << "FileAllocator: fallocate failed: " << errnoWithDescription( err )
+                  << " falling back" << endl;
+        }
+#elif defined(__linux__)
         int ret = posix_fallocate(fd,0,size);
         if ( ret == 0 )
             return;
@@ -282,6 +312,19 @@ namespace mongo {
         return false;
     }
 
+    // caller must hold _pendingMutex lock.
+    bool FileAllocator::claimNext( string* name, long* size ) {
+        for( list< string >::const_iterator i = _pending.begin(); i != _pending.end(); ++i ) {
+            if ( _allocating.count( *i ) )
+                continue;
+            *name = *i;
+            *size = _pendingSize[ *i ];
+            _allocating.insert( *i );
+            return true;
+        }
+        return false;
+    }
+
     string FileAllocator::makeTempFileName( boost::filesystem::path root ) {
         while( 1 ) {
             boost::filesystem::path p = root / "_tmp";
@@ -303,114 +346,111 @@ namespace mongo {
         return "";
 	}
 
-    void FileAllocator::run( FileAllocator * fa ) {
-        setThreadName( "FileAllocator" );
-        {
-            // initialize unique temporary file name counter
-            // TODO: SERVER-6055 -- Unify temporary file name selection
-            SimpleMutex::scoped_lock lk(_uniqueNumberMutex);
-            _uniqueNumber = curTimeMicros64();
-        }
-        while( 1 ) {
-            {
-                scoped_lock lk( fa->_pendingMutex );
-                if ( fa->_pending.size() == 0 )
-                    fa->_pendingUpdated.wait( lk.boost() );
-            }
-            while( 1 ) {
-                string name;
-                long size = 0;
-                {
-                    scoped_lock lk( fa->_pendingMutex );
-                    if ( fa->_pending.size() == 0 )
-                        break;
-                    name = fa->_pending.front();
-                    size = fa->_pendingSize[ name ];
-                }
+    void FileAllocator::allocate( const string &name, long size ) {
+        string tmp;
+        long fd = 0;
+        try {
+            log() << "allocating new datafile " << name << ", filling with zeroes..." << endl;
 
-                string tmp;
-                long fd = 0;
-                try {
-                    log() << "allocating new datafile " << name << ", filling with zeroes..." << endl;
-                    
-                    boost::filesystem::path parent = ensureParentDirCreated(name);
-                    tmp = fa->makeTempFileName( parent );
-                    ensureParentDirCreated(tmp);
+            boost::filesystem::path parent = ensureParentDirCreated(name);
+            tmp = makeTempFileName( parent );
+            ensureParentDirCreated(tmp);
 
 #if defined(_WIN32)
-                    fd = _open( tmp.c_str(), _O_RDWR | _O_CREAT | O_NOATIME, _S_IREAD | _S_IWRITE );
+            fd = _open( tmp.c_str(), _O_RDWR | _O_CREAT | O_NOATIME, _S_IREAD | _S_IWRITE );
 #else
-                    fd = open(tmp.c_str(), O_CREAT | O_RDWR | O_NOATIME, S_IRUSR | S_IWUSR);
+            fd = open(tmp.c_str(), O_CREAT | O_RDWR | O_NOATIME, S_IRUSR | S_IWUSR);
 #endif
-                    if ( fd < 0 ) {
-                        log() << "FileAllocator: couldn't create " << name << " (" << tmp << ") " << errnoWithDescription() << endl;
-                        uasserted(10439, "");
-                    }
+            if ( fd < 0 ) {
+                log() << "FileAllocator: couldn't create " << name << " (" << tmp << ") " << errnoWithDescription() << endl;
+                uasserted(10439, "");
+            }
 
 #if defined(POSIX_FADV_DONTNEED)
-                    if( posix_fadvise(fd, 0, size, POSIX_FADV_DONTNEED) ) {
-                        log() << "warning: posix_fadvise fails " << name << " (" << tmp << ") " << errnoWithDescription() << endl;
-                    }
+            if( posix_fadvise(fd, 0, size, POSIX_FADV_DONTNEED) ) {
+                log() << "warning: posix_fadvise fails " << name << " (" << tmp << ") " << errnoWithDescription() << endl;
+            }
 #endif
 
-                    Timer t;
+            Timer t;
 
-                    /* make sure the file is the full desired length */
-                    ensureLength( fd , size );
+            /* make sure the file is the full desired length */
+            ensureLength( fd , size );
 
-                    close( fd );
-                    fd = 0;
+            close( fd );
+            fd = 0;
 
-                    if( rename(tmp.c_str(), name.c_str()) ) {
-                        const string& errStr = errnoWithDescription();
-                        const string& errMessage = str::stream()
-                                << "error: couldn't rename " << tmp
-                                << " to " << name << ' ' << errStr;
-                        msgasserted(13653, errMessage);
-                    }
-                    flushMyDirectory(name);
+            if( rename(tmp.c_str(), name.c_str()) ) {
+                const string& errStr = errnoWithDescription();
+                const string& errMessage = str::stream()
+                        << "error: couldn't rename " << tmp
+                        << " to " << name << ' ' << errStr;
+                msgasserted(13653, errMessage);
+            }
+            flushMyDirectory(name);
 
-                    log() << "done allocating datafile " << name << ", "
-                          << "size: " << size/1024/1024 << "MB, "
-                          << " took " << ((double)t.millis())/1000.0 << " secs"
-                          << endl;
+            log() << "done allocating datafile " << name << ", "
+                  << "size: " << size/1024/1024 << "MB, "
+                  << " took " << ((double)t.millis())/1000.0 << " secs"
+                  << endl;
+        }
+        catch ( const std::exception& e ) {
+            log() << "error: failed to allocate new file: " << name
+                  << " size: " << size << ' ' << e.what()
+                  << ".  will try again in 10 seconds" << endl;
+            if ( fd > 0 )
+                close( fd );
+            try {
+                if ( ! tmp.empty() )
+                    boost::filesystem::remove( tmp );
+                boost::filesystem::remove( name );
+            } catch ( const std::exception& e ) {
+                log() << "error removing files: " << e.what() << endl;
+            }
+            throw;
+        }
+    }
 
-                    // no longer in a failed state. allow new writers.
-                    fa->_failed = false;
-                }
-                catch ( const std::exception& e ) {
-                    log() << "error: failed to allocate new file: " << name
-                          << " size: " << size << ' ' << e.what()
-                          << ".  will try again in 10 seconds" << endl;
-                    if ( fd > 0 )
-                        close( fd );
-                    try {
-                        if ( ! tmp.empty() )
-                            boost::filesystem::remove( tmp );
-                        boost::filesystem::remove( name );
-                    } catch ( const std::exception& e ) {
-                        log() << "error removing files: " << e.what() << endl;
-                    }
-
-                    {
-                        scoped_lock lk(fa->_pendingMutex);
-                        fa->_failed = true;
-
-                        // TODO: Should we remove the file from pending?
-                        fa->_pendingUpdated.notify_all();
-                    }
-                    
-                    
-                    sleepsecs(10);
-                    continue;
-                }
+    void FileAllocator::run( FileAllocator * fa ) {
+        setThreadName( "FileAllocator" );
+        while( 1 ) {
+            string name;
+            long size = 0;
+            {
+                scoped_lock lk( fa->_pendingMutex );
+                while ( !fa->claimNext( &name, &size ) )
+                    fa->_pendingUpdated.wait( lk.boost() );
+            }
 
+            try {
+                fa->allocate( name, size );
+            }
+            catch ( const std::exception& ) {
                 {
-                    scoped_lock lk( fa->_pendingMutex );
-                    fa->_pendingSize.erase( name );
-                    fa->_pending.pop_front();
+                    scoped_lock lk(fa->_pendingMutex);
+                    fa->_failed = true;
+
+                    // TODO: Should we remove the file from pending?
                     fa->_pendingUpdated.notify_all();
                 }
+
+                sleepsecs(10);
+
+                // keep the file claimed until now so another worker doesn't retry it at once
+                scoped_lock lk(fa->_pendingMutex);
+                fa->_allocating.erase( name );
+                fa->_pendingUpdated.notify_all();
+                continue;
+            }
+
+            {
+                scoped_lock lk( fa->_pendingMutex );
+                // no longer in a failed state. allow new writers.
+                fa->_failed = false;
+                fa->_allocating.erase( name );
+                fa->_pendingSize.erase( name );
+                fa->_pending.remove( name );
+                fa->_pendingUpdated.notify_all();
             }
         }
     }
@@ -30,6 +30,7 @@
 #include "mongo/pch.h"
 
 #include <list>
+#include <set>
 #include <boost/filesystem/path.hpp>
 #include <boost/thread/condition.hpp>
 
@@ -39,7 +40,8 @@ namespace mongo {
 
     /*
      * Handles allocation of contiguous files on disk.  Allocation may be
-     * requested asynchronously or synchronously.
+     * requested asynchronously or synchronously.  Several files may be
+     * allocated at once, each on its own worker thread.
      * singleton
      */
     class FileAllocator : boost::noncopyable {
@@ -49,6 +51,7 @@ namespace mongo {
          * size specified per file will be used.
         */
     public:
+        /** starts the worker threads, see the fileAllocatorThreads parameter */
         void start();
 
         /**
@@ -84,9 +87,16 @@ namespace mongo {
         // caller must hold pendingMutex_ lock.
         bool inProgress( const std::string &name ) const;
 
-        /** called from the worked thread */
+        // caller must hold pendingMutex_ lock.  Claims the first pending file no other worker
+        // is allocating; returns false if there is none.
+        bool claimNext( std::string* name, long* size );
+
+        /** called from each worker thread */
         static void run( FileAllocator * fa );
 
+        /** creates the file name of the given size, throws on failure */
+        void allocate( const std::string &name, long size );
+
         // generate a unique name for temporary files
         std::string makeTempFileName( boost::filesystem::path root );
 
@@ -96,6 +106,9 @@ namespace mongo {
         std::list< std::string > _pending;
         mutable std::map< std::string, long > _pendingSize;
 
+        // the pending files a worker is allocating right now
+        std::set< std::string > _allocating;
+
         // unique number for temporary files
         static unsigned long long _uniqueNumber;
 
@@ -167,11 +167,37 @@ namespace mongo {
 #include <sys/ioctl.h>
 
 #ifdef __linux__
+#include <linux/aio_abi.h>
 #include <linux/fs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #endif
 
 namespace mongo {
 
+#if defined(__linux__)
+    namespace {
+        // Direct appends are split into writes of this size, and up to MaxAioWrites of them are
+        // in flight at once.
+        const size_t AioWriteSize = 1024 * 1024;
+        const int MaxAioWrites = 32;
+
+        // glibc has no wrappers for these, and libaio would only wrap them.
+        int ioSetup(unsigned nr, aio_context_t* ctx) {
+            return syscall(__NR_io_setup, nr, ctx);
+        }
+        int ioDestroy(aio_context_t ctx) {
+            return syscall(__NR_io_destroy, ctx);
+        }
+        int ioSubmit(aio_context_t ctx, long nr, struct iocb** iocbs) {
+            return syscall(__NR_io_submit, ctx, nr, iocbs);
+        }
+        int ioGetEvents(aio_context_t ctx, long minNr, long nr, struct io_event* events) {
+            return syscall(__NR_io_getevents, ctx, minNr, nr, events, NULL);
+        }
+    }
+#endif
+
     LogFile::LogFile(const std::string& name, bool readwrite) : _name(name) {
         int options = O_CREAT
                     | (readwrite?O_RDWR:O_WRONLY)
@@ -208,10 +234,24 @@ namespace mongo {
             uasserted(13516, str::stream() << "couldn't open file " << name << " for writing " << errnoWithDescription());
         }
 
+#if defined(__linux__)
+        // Falls back to write() if the system is out of aio contexts (see fs.aio-max-nr).
+        aio_context_t ctx = 0;
+        if (_direct && ioSetup(MaxAioWrites, &ctx) != 0) {
+            ctx = 0;
+        }
+        _aioContext = ctx;
+#endif
+
         flushMyDirectory(name);
     }
 
     LogFile::~LogFile() {
+#if defined(__linux__)
+        if( _aioContext )
+            ioDestroy(_aioContext);
+        _aioContext = 0;
+#endif
         if( _fd >= 0 )
             close(_fd);
         _fd = -1;
@@ -261,6 +301,13 @@ namespace mongo {
         const off_t pos = lseek(_fd, 0, SEEK_CUR); // doesn't actually seek, just get current position
 #endif
 
+#if defined(__linux__)
+        if ( _aioContext ) {
+            aioAppend(buf, len);
+            charsToWrite = 0;
+        }
+#endif
+
         while ( charsToWrite > 0 ) {
             const ssize_t written = write( _fd, buf, static_cast<size_t>( charsToWrite ) );
             if ( -1 == written ) {
@@ -273,6 +320,8 @@ namespace mongo {
             charsToWrite -= written;
         }
 
+        // The journal files are preallocated and reused, so for direct writes this is only the
+        // wait for the device's cache: nothing is in the page cache, and no file size changes.
         if( 
 #if defined(__linux__)
            fdatasync(_fd) < 0 
@@ -290,6 +339,74 @@ namespace mongo {
 #endif
     }
 
+#if defined(__linux__)
+    /** writes len bytes at the current position, with all the pieces of a big append submitted
+        at once so that the device can work on them together, and moves the position past them.
+    */
+    void LogFile::aioAppend(const char *buf, size_t len) {
+        const off_t pos = lseek(_fd, 0, SEEK_CUR); // doesn't actually seek
+        fassert( 28617, pos >= 0 );
+
+        size_t done = 0;
+        while ( done < len ) {
+            struct iocb cbs[MaxAioWrites];
+            struct iocb* pending[MaxAioWrites];
+            int n = 0;
+            for ( ; n < MaxAioWrites && done < len; n++ ) {
+                const size_t size = std::min(AioWriteSize, len - done);
+                memset(&cbs[n], 0, sizeof(cbs[n]));
+                cbs[n].aio_fildes = _fd;
+                cbs[n].aio_lio_opcode = IOCB_CMD_PWRITE;
+                cbs[n].aio_buf = reinterpret_cast<unsigned long long>(buf + done);
+                cbs[n].aio_nbytes = size;
+                cbs[n].aio_offset = pos + done;
+                pending[n] = &cbs[n];
+                done += size;
+            }
+
+            for ( int submitted = 0; submitted < n; ) {
+                const int r = ioSubmit(_aioContext, n - submitted, pending + submitted);
+                if ( r < 0 && errno == EAGAIN ) {
+                    continue;
+                }
+                if ( r <= 0 ) {
+                    log() << "LogFile::synchronousAppend io_submit failed for " << len
+                          << " bytes;  b=" << (const void*) buf << ' '
+                          << errnoWithDescription() << std::endl;
+                    fassertFailed( 28618 );
+                }
+                submitted += r;
+            }
+
+            // Wait for every write submitted, even if one fails, as they all use buf.
+            struct io_event events[MaxAioWrites];
+            bool failed = false;
+            for ( int completed = 0; completed < n; ) {
+                const int r = ioGetEvents(_aioContext, n - completed, n - completed, events);
+                if ( r < 0 && errno == EINTR ) {
+                    continue;
+                }
+                fassert( 28619, r > 0 );
+                for ( int i = 0; i < r; i++ ) {
+                    const struct iocb* cb = reinterpret_cast<const struct iocb*>(events[i].obj);
+                    if ( events[i].res != static_cast<long long>(cb->aio_nbytes) ) {
+                        log() << "LogFile::synchronousAppend write of " << cb->aio_nbytes
+                              << " bytes at " << cb->aio_offset << " failed with "
+                              << events[i].res << ";  b=" << (const void*) buf << std::endl;
+                        failed = true;
+                    }
+                }
+                completed += r;
+            }
+            if ( failed ) {
+                fassertFailed( 13515 );
+            }
+        }
+
+        fassert( 28620, lseek(_fd, pos + len, SEEK_SET) == static_cast<off_t>(pos + len) );
+    }
+#endif
+
 }
 
 #endif
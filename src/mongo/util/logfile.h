@@ -44,7 +44,8 @@ namespace mongo {
         /** closes */
         ~LogFile();
 
-        /** append to file.  does not return until sync'd.  uses direct i/o when possible.
+        /** append to file.  does not return until sync'd.  uses direct i/o when possible, and on
+            linux submits the direct writes together through the kernel's asynchronous i/o.
             throws UserAssertion on an i/o error
             note direct i/o may have alignment requirements
         */
@@ -71,6 +72,13 @@ namespace mongo {
         // Block size, in case of direct I/O we need to test alignment against the page size,
         // which can be different than 4kB.
         size_t _blkSize;
+
+#if defined(__linux__)
+        // aio_context_t of the kernel's asynchronous i/o for direct appends, 0 if not in use
+        unsigned long _aioContext;
+
+        void aioAppend(const char *buf, size_t len);
+#endif
     };
 
 }
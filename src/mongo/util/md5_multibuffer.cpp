@@ -0,0 +1,228 @@
+// md5_multibuffer.cpp
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/md5_multibuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mongo {
+
+#if defined(__SSE2__)
+    namespace {
+
+        const int kLanes = 4;
+        const int kBlockSize = 64;
+
+        // Per step: the sine derived constant, the message word and the rotation of RFC 1321.
+        const md5_word_t kT[64] = {
+            0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+            0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+            0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+            0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+            0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+            0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+            0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+            0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+            0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+            0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+            0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391 };
+
+        const int kShift[4][4] = { { 7, 12, 17, 22 },
+                                   { 5, 9, 14, 20 },
+                                   { 4, 11, 16, 23 },
+                                   { 6, 10, 15, 21 } };
+
+        inline __m128i rotateLeft(__m128i x, int s) {
+            return _mm_or_si128(_mm_sll_epi32(x, _mm_cvtsi32_si128(s)),
+                                _mm_srl_epi32(x, _mm_cvtsi32_si128(32 - s)));
+        }
+
+        inline md5_word_t loadWord(const md5_byte_t* p) {
+            // x86, where SSE2 lives, is little-endian like the MD5 message words.
+            md5_word_t w;
+            memcpy(&w, p, sizeof(w));
+            return w;
+        }
+
+        /**
+         * One message in a lane: its whole blocks are read in place, and the last one or two
+         * blocks, which carry the padding and the bit length, are built in 'tail'.
+         */
+        struct Lane {
+            const md5_byte_t* message;
+            size_t wholeBlocks;
+            size_t totalBlocks;
+            md5_byte_t tail[2 * kBlockSize];
+
+            void init(const md5_byte_t* msg, size_t length) {
+                message = msg;
+                wholeBlocks = length / kBlockSize;
+                const size_t rest = length % kBlockSize;
+                const size_t tailBlocks = rest < kBlockSize - 8 ? 1 : 2;
+                totalBlocks = wholeBlocks + tailBlocks;
+
+                memset(tail, 0, sizeof(tail));
+                memcpy(tail, msg + wholeBlocks * kBlockSize, rest);
+                tail[rest] = 0x80;
+                unsigned long long bits = static_cast<unsigned long long>(length) << 3;
+                md5_byte_t* end = tail + tailBlocks * kBlockSize - 8;
+                for (int i = 0; i < 8; i++, bits >>= 8)
+                    end[i] = static_cast<md5_byte_t>(bits);
+            }
+
+            void initUnused() {
+                message = NULL;
+                wholeBlocks = 0;
+                totalBlocks = 0;
+                memset(tail, 0, sizeof(tail));
+            }
+
+            const md5_byte_t* block(size_t i) const {
+                if (i < wholeBlocks)
+                    return message + i * kBlockSize;
+                if (i < totalBlocks)
+                    return tail + (i - wholeBlocks) * kBlockSize;
+                return tail;  // lane is done, the result is masked off
+            }
+        };
+
+        void md5FourLanes(Lane* lanes, md5digest* digests, int used) {
+            __m128i a = _mm_set1_epi32(0x67452301);
+            __m128i b = _mm_set1_epi32(0xefcdab89);
+            __m128i c = _mm_set1_epi32(0x98badcfe);
+            __m128i d = _mm_set1_epi32(0x10325476);
+
+            size_t maxBlocks = 0;
+            for (int l = 0; l < kLanes; l++)
+                maxBlocks = std::max(maxBlocks, lanes[l].totalBlocks);
+
+            for (size_t i = 0; i < maxBlocks; i++) {
+                const md5_byte_t* blocks[kLanes];
+                int active[kLanes];
+                for (int l = 0; l < kLanes; l++) {
+                    blocks[l] = lanes[l].block(i);
+                    active[l] = i < lanes[l].totalBlocks ? -1 : 0;
+                }
+
+                __m128i x[16];
+                for (int w = 0; w < 16; w++) {
+                    x[w] = _mm_setr_epi32(loadWord(blocks[0] + 4 * w),
+                                          loadWord(blocks[1] + 4 * w),
+                                          loadWord(blocks[2] + 4 * w),
+                                          loadWord(blocks[3] + 4 * w));
+                }
+
+                __m128i aa = a, bb = b, cc = c, dd = d;
+                const __m128i ones = _mm_set1_epi32(-1);
+                for (int step = 0; step < 64; step++) {
+                    const int round = step / 16;
+                    __m128i f;
+                    int g;
+                    switch (round) {
+                    case 0:
+                        f = _mm_xor_si128(dd, _mm_and_si128(bb, _mm_xor_si128(cc, dd)));
+                        g = step;
+                        break;
+                    case 1:
+                        f = _mm_xor_si128(cc, _mm_and_si128(dd, _mm_xor_si128(bb, cc)));
+                        g = (5 * step + 1) % 16;
+                        break;
+                    case 2:
+                        f = _mm_xor_si128(_mm_xor_si128(bb, cc), dd);
+                        g = (3 * step + 5) % 16;
+                        break;
+                    default:
+                        f = _mm_xor_si128(cc, _mm_or_si128(bb, _mm_xor_si128(dd, ones)));
+                        g = (7 * step) % 16;
+                        break;
+                    }
+                    __m128i sum = _mm_add_epi32(_mm_add_epi32(aa, f),
+                                                _mm_add_epi32(_mm_set1_epi32(kT[step]), x[g]));
+                    const __m128i next = _mm_add_epi32(bb, rotateLeft(sum, kShift[round][step % 4]));
+                    aa = dd;
+                    dd = cc;
+                    cc = bb;
+                    bb = next;
+                }
+
+                // Lanes whose message has ended keep their state.
+                const __m128i mask = _mm_setr_epi32(active[0], active[1], active[2], active[3]);
+                a = _mm_add_epi32(a, _mm_and_si128(aa, mask));
+                b = _mm_add_epi32(b, _mm_and_si128(bb, mask));
+                c = _mm_add_epi32(c, _mm_and_si128(cc, mask));
+                d = _mm_add_epi32(d, _mm_and_si128(dd, mask));
+            }
+
+            md5_word_t words[4][kLanes];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(words[0]), a);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(words[1]), b);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(words[2]), c);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(words[3]), d);
+            for (int l = 0; l < used; l++) {
+                for (int w = 0; w < 4; w++)
+                    memcpy(digests[l] + 4 * w, &words[w][l], 4);
+            }
+        }
+
+    } // namespace
+
+    void md5MultiBuffer(const md5_byte_t* const* messages,
+                        const size_t* lengths,
+                        size_t count,
+                        md5digest* digests) {
+        Lane lanes[kLanes];
+        for (size_t i = 0; i < count; i += kLanes) {
+            const int used = static_cast<int>(std::min<size_t>(kLanes, count - i));
+            for (int l = 0; l < kLanes; l++) {
+                if (l < used)
+                    lanes[l].init(messages[i + l], lengths[i + l]);
+                else
+                    lanes[l].initUnused();
+            }
+            md5FourLanes(lanes, digests + i, used);
+        }
+    }
+#else
+    void md5MultiBuffer(const md5_byte_t* const* messages,
+                        const size_t* lengths,
+                        size_t count,
+                        md5digest* digests) {
+        for (size_t i = 0; i < count; i++)
+            md5(messages[i], static_cast<int>(lengths[i]), digests[i]);
+    }
+#endif
+
+} // namespace mongo
@@ -0,0 +1,49 @@
+// md5_multibuffer.h
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "mongo/util/md5.hpp"
+
+namespace mongo {
+
+    /**
+     * Computes the MD5 digest of each of 'count' independent messages into 'digests', bit for
+     * bit the same as md5() would.  Where SSE2 is available, four messages at a time go
+     * through the rounds side by side, one in each 32-bit lane, which pays off for the many
+     * short inputs of a batch of hashed shard key values.
+     */
+    void md5MultiBuffer(const md5_byte_t* const* messages,
+                        const size_t* lengths,
+                        size_t count,
+                        md5digest* digests);
+
+} // namespace mongo
@@ -58,6 +58,13 @@ namespace mongo {
         unsigned _len;
     };
 
+    /**
+     * Tells the OS that the pages of [p, p + len) will be needed soon, so that it can start
+     * reading them in without blocking the caller.  Only a hint: failures are ignored, and on
+     * some platforms it does nothing.
+     */
+    void adviseWillNeed(const void* p, size_t len);
+
     // lock order: lock dbMutex before this if you lock both
     class MONGO_CLIENT_API LockMongoFilesShared {
         friend class LockMongoFilesExclusive;
@@ -123,6 +123,8 @@ namespace mongo {
 #if defined(__sunos__)
     MAdvise::MAdvise(void *,unsigned, Advice) { }
     MAdvise::~MAdvise() { }
+
+    void adviseWillNeed(const void* p, size_t len) { }
 #else
     MAdvise::MAdvise(void *p, unsigned len, Advice a) {
 
@@ -149,6 +151,14 @@ namespace mongo {
     MAdvise::~MAdvise() {
         madvise(_p,_len,MADV_NORMAL);
     }
+
+    void adviseWillNeed(const void* p, size_t len) {
+        void* start = _pageAlign( const_cast<void*>( p ) );
+        len += reinterpret_cast<size_t>( p ) - reinterpret_cast<size_t>( start );
+
+        // A failure only costs us the read-ahead.
+        madvise( start, len, MADV_WILLNEED );
+    }
 #endif
 
     void* MemoryMappedFile::map(const char *filename, unsigned long long &length, int options) {
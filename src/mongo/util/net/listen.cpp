@@ -34,12 +34,17 @@
 
 #include "mongo/util/net/listen.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/db/server_options.h"
 #include "mongo/base/owned_pointer_vector.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/log.h"
 #include "mongo/util/net/message_port.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/scopeguard.h"
+#include "mongo/util/timer.h"
 
 #ifndef _WIN32
 
@@ -60,6 +65,10 @@
 #ifdef __openbsd__
 # include <sys/uio.h>
 #endif
+#ifdef __linux__
+# include <fcntl.h>
+# include <sys/epoll.h>
+#endif
 
 #else
 
@@ -137,6 +146,18 @@ namespace mongo {
         _mine = ipToAddrs(_ip.c_str(), _port, false);
 #endif
 
+        int numShards = numAcceptThreads();
+#if !defined(__linux__) || !defined(SO_REUSEPORT)
+        if (numShards > 1) {
+            warning() << "SO_REUSEPORT listener sharding is not supported on this platform, "
+                      << "accepting connections on a single thread" << endl;
+            numShards = 1;
+        }
+#endif
+        if (numShards > 1) {
+            _shardSocks.resize(numShards - 1);
+        }
+
         for (std::vector<SockAddr>::const_iterator it=_mine.begin(), end=_mine.end();
              it != end;
              ++it) {
@@ -148,55 +169,74 @@ namespace mongo {
                 return;
             }
 
-            SOCKET sock = ::socket(me.getType(), SOCK_STREAM, 0);
-            ScopeGuard socketGuard = MakeGuard(&closesocket, sock);
-            massert( 15863 , str::stream() << "listen(): invalid socket? " << errnoWithDescription() , sock >= 0 );
+            // TCP addresses get one SO_REUSEPORT socket per accept thread.
+            const int numSocks = (me.getType() == AF_UNIX) ? 1 : numShards;
+
+            for (int shard = 0; shard < numSocks; ++shard) {
+                SOCKET sock = ::socket(me.getType(), SOCK_STREAM, 0);
+                ScopeGuard socketGuard = MakeGuard(&closesocket, sock);
+                massert( 15863 , str::stream() << "listen(): invalid socket? " << errnoWithDescription() , sock >= 0 );
 
-            if (me.getType() == AF_UNIX) {
+                if (me.getType() == AF_UNIX) {
 #if !defined(_WIN32)
-                if (unlink(me.getAddr().c_str()) == -1) {
-                    int x = errno;
-                    if (x != ENOENT) {
-                        log() << "couldn't unlink socket file " << me << errnoWithDescription(x) << " skipping" << endl;
-                        continue;
+                    if (unlink(me.getAddr().c_str()) == -1) {
+                        int x = errno;
+                        if (x != ENOENT) {
+                            log() << "couldn't unlink socket file " << me << errnoWithDescription(x) << " skipping" << endl;
+                            continue;
+                        }
                     }
-                }
 #endif
-            }
-            else if (me.getType() == AF_INET6) {
-                // IPv6 can also accept IPv4 connections as mapped addresses (::ffff:127.0.0.1)
-                // That causes a conflict if we don't do set it to IPV6_ONLY
-                const int one = 1;
-                setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, (const char*) &one, sizeof(one));
-            }
+                }
+                else if (me.getType() == AF_INET6) {
+                    // IPv6 can also accept IPv4 connections as mapped addresses (::ffff:127.0.0.1)
+                    // That causes a conflict if we don't do set it to IPV6_ONLY
+                    const int one = 1;
+                    setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, (const char*) &one, sizeof(one));
+                }
 
 #if !defined(_WIN32)
-            {
-                const int one = 1;
-                if ( setsockopt( sock , SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 )
-                    log() << "Failed to set socket opt, SO_REUSEADDR" << endl;
-            }
+                {
+                    const int one = 1;
+                    if ( setsockopt( sock , SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 )
+                        log() << "Failed to set socket opt, SO_REUSEADDR" << endl;
+                }
 #endif
 
-            if ( ::bind(sock, me.raw(), me.addressSize) != 0 ) {
-                int x = errno;
-                error() << "listen(): bind() failed " << errnoWithDescription(x) << " for socket: " << me.toString() << endl;
-                if ( x == EADDRINUSE )
-                    error() << "  addr already in use" << endl;
-                return;
-            }
+#if defined(__linux__) && defined(SO_REUSEPORT)
+                if (numSocks > 1) {
+                    const int one = 1;
+                    if ( setsockopt( sock , SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0 ) {
+                        error() << "listen(): failed to set SO_REUSEPORT for socket: " << me.toString()
+                                << " " << errnoWithDescription() << endl;
+                        return;
+                    }
+                }
+#endif
+
+                if ( ::bind(sock, me.raw(), me.addressSize) != 0 ) {
+                    int x = errno;
+                    error() << "listen(): bind() failed " << errnoWithDescription(x) << " for socket: " << me.toString() << endl;
+                    if ( x == EADDRINUSE )
+                        error() << "  addr already in use" << endl;
+                    return;
+                }
 
 #if !defined(_WIN32)
-            if (me.getType() == AF_UNIX) {
-                if (chmod(me.getAddr().c_str(), serverGlobalParams.unixSocketPermissions) == -1) {
-                    error() << "couldn't chmod socket file " << me << errnoWithDescription() << endl;
+                if (me.getType() == AF_UNIX) {
+                    if (chmod(me.getAddr().c_str(), serverGlobalParams.unixSocketPermissions) == -1) {
+                        error() << "couldn't chmod socket file " << me << errnoWithDescription() << endl;
+                    }
+                    ListeningSockets::get()->addPath( me.getAddr() );
                 }
-                ListeningSockets::get()->addPath( me.getAddr() );
-            }
 #endif
 
-            _socks.push_back(sock);
-            socketGuard.Dismiss();
+                if (shard == 0)
+                    _socks.push_back(sock);
+                else
+                    _shardSocks[shard - 1].push_back(sock);
+                socketGuard.Dismiss();
+            }
         }
         
         _setupSocketsSuccessful = true;
@@ -209,7 +249,6 @@ namespace mongo {
             return;
         }
 
-        SOCKET maxfd = 0; // needed for select()
         for (unsigned i = 0; i < _socks.size(); i++) {
             if (::listen(_socks[i], 128) != 0) {
                 error() << "listen(): listen() failed " << errnoWithDescription() << endl;
@@ -217,7 +256,22 @@ namespace mongo {
             }
 
             ListeningSockets::get()->add(_socks[i]);
+        }
 
+        for (unsigned i = 0; i < _shardSocks.size(); i++) {
+            for (unsigned j = 0; j < _shardSocks[i].size(); j++) {
+                if (::listen(_shardSocks[i][j], 128) != 0) {
+                    error() << "listen(): listen() failed " << errnoWithDescription() << endl;
+                    return;
+                }
+
+                ListeningSockets::get()->add(_shardSocks[i][j]);
+            }
+        }
+
+#if !defined(__linux__)
+        SOCKET maxfd = 0; // needed for select()
+        for (unsigned i = 0; i < _socks.size(); i++) {
             if (_socks[i] > maxfd) {
                 maxfd = _socks[i];
             }
@@ -228,6 +282,7 @@ namespace mongo {
                 "; not supported" << warnings;
             return;
         }
+#endif
 
 #ifdef MONGO_SSL
         _logListen(_port, _ssl);
@@ -242,6 +297,15 @@ namespace mongo {
             _readyCondition.notify_all();
         }
 
+#if defined(__linux__)
+        // Each set of SO_REUSEPORT sockets gets its own accept thread; the kernel spreads
+        // incoming connections across them.
+        for (unsigned i = 0; i < _shardSocks.size(); i++) {
+            boost::thread thr(stdx::bind(&Listener::_acceptLoop, this, _shardSocks[i], false));
+        }
+
+        _acceptLoop(_socks, true);
+#else
         struct timeval maxSelectTime;
         while ( ! inShutdown() ) {
             fd_set fds[1];
@@ -256,11 +320,7 @@ namespace mongo {
             const int ret = select(maxfd+1, fds, NULL, NULL, &maxSelectTime);
 
             if (ret == 0) {
-#if defined(__linux__)
-                _elapsedTime += ( 10000 - maxSelectTime.tv_usec ) / 1000;
-#else
                 _elapsedTime += 10;
-#endif
                 continue;
             }
 
@@ -277,66 +337,147 @@ namespace mongo {
                 return;
             }
 
-#if defined(__linux__)
-            _elapsedTime += max(ret, (int)(( 10000 - maxSelectTime.tv_usec ) / 1000));
-#else
             _elapsedTime += ret; // assume 1ms to grab connection. very rough
-#endif
 
             for (vector<SOCKET>::iterator it=_socks.begin(), end=_socks.end(); it != end; ++it) {
                 if (! (FD_ISSET(*it, fds)))
                     continue;
-                SockAddr from;
-                int s = accept(*it, from.raw(), &from.addressSize);
-                if ( s < 0 ) {
-                    int x = errno; // so no global issues
-                    if (x == EBADF) {
-                        log() << "Port " << _port << " is no longer valid" << endl;
-                        return;
-                    }
-                    else if (x == ECONNABORTED) {
-                        log() << "Connection on port " << _port << " aborted" << endl;
-                        continue;
-                    }
-                    if ( x == 0 && inShutdown() ) {
-                        return;   // socket closed
-                    }
-                    if( !inShutdown() ) {
-                        log() << "Listener: accept() returns " << s << " " << errnoWithDescription(x) << endl;
-                        if (x == EMFILE || x == ENFILE) {
-                            // Connection still in listen queue but we can't accept it yet
-                            error() << "Out of file descriptors. Waiting one second before trying to accept more connections." << warnings;
-                            sleepsecs(1);
-                        }
-                    }
-                    continue;
-                }
-                if (from.getType() != AF_UNIX)
-                    disableNagle(s);
 
-#ifdef SO_NOSIGPIPE
-                // ignore SIGPIPE signals on osx, to avoid process exit
-                const int one = 1;
-                setsockopt( s , SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(int));
+                bool stop = false;
+                _acceptOne(*it, &stop);
+                if (stop)
+                    return;
+            }
+        }
 #endif
+    }
+
+#if defined(__linux__)
+    void Listener::_acceptLoop(std::vector<SOCKET> socks, bool trackTime) {
+        if (!trackTime)
+            setThreadName("listener");
 
-                long long myConnectionNumber = globalConnectionNumber.addAndFetch(1);
+        int epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd < 0) {
+            error() << "listen(): epoll_create1() failed " << errnoWithDescription() << endl;
+            return;
+        }
+        ON_BLOCK_EXIT(&::close, epfd);
+
+        for (unsigned i = 0; i < socks.size(); i++) {
+            // Non-blocking, so that we can drain the accept queue after each wakeup.  Accepted
+            // sockets do not inherit O_NONBLOCK on linux.
+            const int flags = fcntl(socks[i], F_GETFL);
+            if (flags < 0 || fcntl(socks[i], F_SETFL, flags | O_NONBLOCK) < 0) {
+                error() << "listen(): fcntl() failed " << errnoWithDescription() << endl;
+                return;
+            }
 
-                if (_logConnect && !serverGlobalParams.quiet) {
-                    int conns = globalTicketHolder.used()+1;
-                    const char* word = (conns == 1 ? " connection" : " connections");
-                    log() << "connection accepted from " << from.toString() << " #" << myConnectionNumber << " (" << conns << word << " now open)" << endl;
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = socks[i];
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, socks[i], &event) != 0) {
+                error() << "listen(): epoll_ctl() failed " << errnoWithDescription() << endl;
+                return;
+            }
+        }
+
+        // Accept at most this many connections from one socket before looking at the others.
+        const int maxAcceptsPerWakeup = 256;
+
+        const int maxEvents = 16;
+        struct epoll_event events[maxEvents];
+
+        Timer timer;
+        const long long startElapsedTime = _elapsedTime;
+
+        while ( ! inShutdown() ) {
+            const int ret = epoll_wait(epfd, events, maxEvents, 10);
+
+            if (trackTime)
+                _elapsedTime = startElapsedTime + timer.millis();
+
+            if (ret < 0) {
+                int x = errno;
+                if ( x == EINTR ) {
+                    log() << "epoll_wait() signal caught, continuing" << endl;
+                    continue;
                 }
-                
-                boost::shared_ptr<Socket> pnewSock( new Socket(s, from) );
-#ifdef MONGO_SSL
-                if (_ssl) {
-                    pnewSock->secureAccepted(_ssl);
+                if ( ! inShutdown() )
+                    log() << "epoll_wait() failure: ret=" << ret << " " << errnoWithDescription(x) << endl;
+                return;
+            }
+
+            for (int i = 0; i < ret; i++) {
+                for (int n = 0; n < maxAcceptsPerWakeup; n++) {
+                    bool stop = false;
+                    if (!_acceptOne(events[i].data.fd, &stop)) {
+                        if (stop)
+                            return;
+                        break;
+                    }
                 }
+            }
+        }
+    }
 #endif
-                accepted( pnewSock , myConnectionNumber );
+
+    bool Listener::_acceptOne(SOCKET sock, bool* stop) {
+        SockAddr from;
+        int s = accept(sock, from.raw(), &from.addressSize);
+        if ( s < 0 ) {
+            int x = errno; // so no global issues
+            if (x == EAGAIN || x == EWOULDBLOCK) {
+                return false;
+            }
+            if (x == EBADF) {
+                log() << "Port " << _port << " is no longer valid" << endl;
+                *stop = true;
+                return false;
+            }
+            else if (x == ECONNABORTED) {
+                log() << "Connection on port " << _port << " aborted" << endl;
+                return false;
             }
+            if ( x == 0 && inShutdown() ) {
+                *stop = true;
+                return false;   // socket closed
+            }
+            if( !inShutdown() ) {
+                log() << "Listener: accept() returns " << s << " " << errnoWithDescription(x) << endl;
+                if (x == EMFILE || x == ENFILE) {
+                    // Connection still in listen queue but we can't accept it yet
+                    error() << "Out of file descriptors. Waiting one second before trying to accept more connections." << warnings;
+                    sleepsecs(1);
+                }
+            }
+            return false;
         }
+        if (from.getType() != AF_UNIX)
+            disableNagle(s);
+
+#ifdef SO_NOSIGPIPE
+        // ignore SIGPIPE signals on osx, to avoid process exit
+        const int one = 1;
+        setsockopt( s , SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(int));
+#endif
+
+        long long myConnectionNumber = globalConnectionNumber.addAndFetch(1);
+
+        if (_logConnect && !serverGlobalParams.quiet) {
+            int conns = globalTicketHolder.used()+1;
+            const char* word = (conns == 1 ? " connection" : " connections");
+            log() << "connection accepted from " << from.toString() << " #" << myConnectionNumber << " (" << conns << word << " now open)" << endl;
+        }
+
+        boost::shared_ptr<Socket> pnewSock( new Socket(s, from) );
+#ifdef MONGO_SSL
+        if (_ssl) {
+            pnewSock->secureAccepted(_ssl);
+        }
+#endif
+        accepted( pnewSock , myConnectionNumber );
+        return true;
     }
 
 #else 
@@ -106,6 +106,9 @@ namespace mongo {
     private:
         std::vector<SockAddr> _mine;
         std::vector<SOCKET> _socks;
+        // Additional SO_REUSEPORT sockets, one set per extra accept thread.  See
+        // numAcceptThreads().
+        std::vector< std::vector<SOCKET> > _shardSocks;
         std::string _name;
         std::string _ip;
         bool _setupSocketsSuccessful;
@@ -122,10 +125,29 @@ namespace mongo {
         
         void _logListen( int port , bool ssl );
 
+        /**
+         * Waits with epoll for connections on 'socks' and accepts them until shutdown.
+         * Only the loop with 'trackTime' set advances getMyElapsedTimeMillis().
+         */
+        void _acceptLoop( std::vector<SOCKET> socks, bool trackTime );
+
+        /**
+         * Accepts one connection from 'sock' and passes it to accepted().
+         * @return false if nothing was accepted; '*stop' is set if listening should end.
+         */
+        bool _acceptOne( SOCKET sock, bool* stop );
+
         static const Listener* _timeTracker;
         
         virtual bool useUnixSockets() const { return false; }
 
+        /**
+         * How many threads accept connections.  Above one, each TCP address is bound once per
+         * thread with SO_REUSEPORT so the kernel can balance connections across the threads.
+         * Only supported on linux.
+         */
+        virtual int numAcceptThreads() const { return 1; }
+
     public:
         /** the "next" connection number.  every connection to this process has a unique number */
         static AtomicInt64 globalConnectionNumber;
@@ -39,6 +39,7 @@
 #include "mongo/util/goodies.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/net/hostandport.h"
+#include "mongo/util/net/message_buffer_pool.h"
 #include "mongo/util/net/sock.h"
 
 namespace mongo {
@@ -63,7 +64,8 @@ namespace mongo {
         dbQuery = 2004,
         dbGetMore = 2005,
         dbDelete = 2006,
-        dbKillCursors = 2007
+        dbKillCursors = 2007,
+        dbCompressed = 2012 /* envelope for another message; see message_compression.h */
     };
 
     bool doesOpGetAResponse( int op );
@@ -79,6 +81,7 @@ namespace mongo {
         case dbGetMore: return "getmore";
         case dbDelete: return "remove";
         case dbKillCursors: return "killcursors";
+        case dbCompressed: return "compressed";
         default:
             massert( 16141, str::stream() << "cannot translate opcode " << op, !op );
             return "";
@@ -94,6 +97,7 @@ namespace mongo {
         case dbQuery:
         case dbGetMore:
         case dbKillCursors:
+        case dbCompressed:
             return false;
 
         case dbUpdate:
@@ -324,12 +328,12 @@ namespace mongo {
     class Message {
     public:
         // we assume here that a vector with initial size 0 does no allocation (0 is the default, but wanted to make it explicit).
-        Message() : _buf( 0 ), _data( 0 ), _freeIt( false ) {}
+        Message() : _buf( 0 ), _data( 0 ), _freeIt( false ), _pooled( false ) {}
         Message( void * data , bool freeIt ) :
-            _buf( 0 ), _data( 0 ), _freeIt( false ) {
+            _buf( 0 ), _data( 0 ), _freeIt( false ), _pooled( false ) {
             _setData( reinterpret_cast< char* >( data ), freeIt );
         };
-        Message(Message& r) : _buf( 0 ), _data( 0 ), _freeIt( false ) {
+        Message(Message& r) : _buf( 0 ), _data( 0 ), _freeIt( false ), _pooled( false ) {
             *this = r;
         }
         ~Message() {
@@ -367,6 +371,20 @@ namespace mongo {
 
         int dataSize() const { return size() - sizeof(MSGHEADER::Value); }
 
+        bool isSingleBuffer() const { return _buf != 0; }
+
+        // copies the whole message into 'dest', which must have room for size() bytes
+        void copyTo(char* dest) const {
+            if ( _buf ) {
+                memcpy( dest, _buf, MsgData::ConstView(_buf).getLen() );
+                return;
+            }
+            for (MsgVec::const_iterator it = _data.begin(); it != _data.end(); ++it) {
+                memcpy( dest, it->first, it->second );
+                dest += it->second;
+            }
+        }
+
         // concat multiple buffers - noop if <2 buffers already, otherwise can be expensive copy
         // can get rid of this if we make response handling smarter
         void concat() {
@@ -402,22 +420,26 @@ namespace mongo {
             }
             r._freeIt = false;
             _freeIt = true;
+            _pooled = r._pooled;
+            r._pooled = false;
             return *this;
         }
 
         void reset() {
             if ( _freeIt ) {
+                // when pooled, the first buffer (whether in _buf or _data) came from the pool
                 if ( _buf ) {
-                    free( _buf );
+                    _freeBuffer( _buf, _pooled );
                 }
                 for (std::vector< std::pair< char *, int > >::const_iterator i = _data.begin();
                      i != _data.end(); ++i) {
-                    free(i->first);
+                    _freeBuffer( i->first, _pooled && i == _data.begin() );
                 }
             }
             _buf = 0;
             _data.clear();
             _freeIt = false;
+            _pooled = false;
         }
 
         // use to add a buffer
@@ -441,11 +463,35 @@ namespace mongo {
             header().setLen(header().getLen() + size);
         }
 
+        // use to add a buffer which is still owned by the caller, and which must outlive the
+        // message; the buffers are sent with one gathering write rather than copied into one.
+        // can't be mixed with buffers the message frees
+        void appendUnownedData(char *d, int size) {
+            if ( size <= 0 ) {
+                return;
+            }
+            verify( !_freeIt );
+            if ( empty() ) {
+                MsgData::View md = d;
+                md.setLen(size); // can be updated later if more buffers added
+            }
+            else {
+                header().setLen(header().getLen() + size);
+            }
+            _data.push_back(std::make_pair(d, size));
+        }
+
         // use to set first buffer if empty
         void setData(char* d, bool freeIt) {
             verify( empty() );
             _setData( d, freeIt );
         }
+        // use to set first buffer if empty, when it came from MessageBufferPool::allocate()
+        void setPooledData(char* d) {
+            verify( empty() );
+            _setData( d, true );
+            _pooled = true;
+        }
         void setData(int operation, const char *msgtxt) {
             setData(operation, msgtxt, strlen(msgtxt)+1);
         }
@@ -470,14 +516,24 @@ namespace mongo {
     private:
         void _setData( char* d, bool freeIt ) {
             _freeIt = freeIt;
+            _pooled = false;
             _buf = d;
         }
+        static void _freeBuffer( char* d, bool pooled ) {
+            if ( pooled ) {
+                MessageBufferPool::release( d );
+            }
+            else {
+                free( d );
+            }
+        }
         // if just one buffer, keep it in _buf, otherwise keep a sequence of buffers in _data
         char* _buf;
         // byte buffer(s) - the first must contain at least a full MsgData unless using _buf for storage instead
         typedef std::vector< std::pair< char*, int > > MsgVec;
         MsgVec _data;
         bool _freeIt;
+        bool _pooled;
     };
 
 
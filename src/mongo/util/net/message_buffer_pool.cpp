@@ -0,0 +1,166 @@
+// message_buffer_pool.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_buffer_pool.h"
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/allocator.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/threadlocal.h"
+#include "mongo/util/numa_placement.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Every buffer is preceded by a header recording its size class, so that release()
+        // doesn't need to be told the size, and the NUMA node of the thread which allocated
+        // it.  16 bytes keeps the buffer itself aligned as malloc's would be.
+        const size_t kHeaderSize = 16;
+        const int kNotPooled = -1;
+        const int kNumClasses = 7; // kMinPooledSize << (kNumClasses - 1) == kMaxPooledSize
+
+        AtomicInt64 poolHits;
+        AtomicInt64 poolMisses;
+        AtomicInt64 poolBytesHeld;
+        AtomicInt64 poolRemoteNodeReleases;
+
+        size_t classBytes( int sizeClass ) {
+            return MessageBufferPool::kMinPooledSize << sizeClass;
+        }
+
+        /** @return the smallest class whose buffers have room for 'size', or kNotPooled */
+        int sizeClassFor( size_t size ) {
+            const size_t total = size + kHeaderSize;
+            for ( int c = 0; c < kNumClasses; c++ ) {
+                if ( total <= classBytes( c ) )
+                    return c;
+            }
+            return kNotPooled;
+        }
+
+        struct ThreadCache {
+            ThreadCache() : bytesHeld( 0 ) {}
+
+            ~ThreadCache() {
+                for ( int c = 0; c < kNumClasses; c++ ) {
+                    for ( size_t i = 0; i < buffers[c].size(); i++ ) {
+                        free( buffers[c][i] );
+                    }
+                }
+                poolBytesHeld.fetchAndSubtract( bytesHeld );
+            }
+
+            std::vector<char*> buffers[kNumClasses];
+            size_t bytesHeld;
+        };
+
+        char* withHeader( char* block, int sizeClass ) {
+            reinterpret_cast<int*>( block )[0] = sizeClass;
+            reinterpret_cast<int*>( block )[1] =
+                NumaPlacement::isEnabled() ? NumaPlacement::currentNode() : -1;
+            return block + kHeaderSize;
+        }
+
+    } // namespace
+
+    TSP_DECLARE( ThreadCache, threadBufferCache );
+    TSP_DEFINE( ThreadCache, threadBufferCache );
+
+    char* MessageBufferPool::allocate( size_t size ) {
+        const int sizeClass = sizeClassFor( size );
+        if ( sizeClass == kNotPooled ) {
+            return withHeader( static_cast<char*>( mongoMalloc( size + kHeaderSize ) ),
+                               kNotPooled );
+        }
+
+        ThreadCache* cache = threadBufferCache.getMake();
+        std::vector<char*>& buffers = cache->buffers[sizeClass];
+        if ( buffers.empty() ) {
+            poolMisses.fetchAndAdd( 1 );
+            return withHeader( static_cast<char*>( mongoMalloc( classBytes( sizeClass ) ) ),
+                               sizeClass );
+        }
+
+        char* block = buffers.back();
+        buffers.pop_back();
+        cache->bytesHeld -= classBytes( sizeClass );
+        poolBytesHeld.fetchAndSubtract( classBytes( sizeClass ) );
+        poolHits.fetchAndAdd( 1 );
+        return withHeader( block, sizeClass );
+    }
+
+    void MessageBufferPool::release( char* buf ) {
+        if ( !buf )
+            return;
+
+        char* block = buf - kHeaderSize;
+        const int sizeClass = reinterpret_cast<int*>( block )[0];
+        if ( sizeClass == kNotPooled ) {
+            free( block );
+            return;
+        }
+        dassert( sizeClass >= 0 && sizeClass < kNumClasses );
+
+        // Don't let a thread on one node cache memory from another.
+        const int node = reinterpret_cast<int*>( block )[1];
+        if ( NumaPlacement::isEnabled() && node != NumaPlacement::currentNode() ) {
+            poolRemoteNodeReleases.fetchAndAdd( 1 );
+            free( block );
+            return;
+        }
+
+        ThreadCache* cache = threadBufferCache.getMake();
+        std::vector<char*>& buffers = cache->buffers[sizeClass];
+        const size_t bytes = classBytes( sizeClass );
+        if ( buffers.size() >= kMaxBuffersPerClass ||
+             cache->bytesHeld + bytes > kMaxBytesPerThread ) {
+            free( block );
+            return;
+        }
+
+        buffers.push_back( block );
+        cache->bytesHeld += bytes;
+        poolBytesHeld.fetchAndAdd( bytes );
+    }
+
+    void MessageBufferPool::appendStats( BSONObjBuilder& b ) {
+        b.append( "hits", poolHits.load() );
+        b.append( "misses", poolMisses.load() );
+        b.append( "bytesHeld", poolBytesHeld.load() );
+        if ( NumaPlacement::isEnabled() )
+            b.append( "remoteNodeReleases", poolRemoteNodeReleases.load() );
+    }
+
+} // namespace mongo
@@ -0,0 +1,76 @@
+// message_buffer_pool.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Per-thread cache of message buffers, so that receiving a message does not, in the steady
+     * state, go to the allocator.
+     *
+     * Buffers are grouped into power-of-two size classes from kMinPooledSize up to
+     * kMaxPooledSize.  Each thread keeps a few free buffers of each class, bounded by
+     * kMaxBytesPerThread in total; larger buffers and buffers which don't fit in the releasing
+     * thread's cache are returned to the allocator.  A buffer may be released on a different
+     * thread from the one that allocated it; with NumaPlacement enabled, a buffer released on a
+     * thread bound to another node is returned to the allocator rather than cached there.
+     *
+     * Message holds on to pooled buffers and gives them back; see Message::setPooledData().
+     */
+    class MessageBufferPool {
+    public:
+        static const size_t kMinPooledSize = 1024;
+        static const size_t kMaxPooledSize = 64 * 1024;
+        static const size_t kMaxBuffersPerClass = 4;
+        static const size_t kMaxBytesPerThread = 256 * 1024;
+
+        /**
+         * @return a buffer of at least 'size' bytes, which must be given back with release().
+         */
+        static char* allocate( size_t size );
+
+        /**
+         * Returns a buffer obtained from allocate() to the calling thread's cache, or frees it.
+         */
+        static void release( char* buf );
+
+        /**
+         * Appends the pool counters: allocations served from a cache (hits), pool sized
+         * allocations which had to go to the allocator (misses), and the bytes held in all
+         * threads' caches.
+         */
+        static void appendStats( BSONObjBuilder& b );
+    };
+
+} // namespace mongo
@@ -0,0 +1,167 @@
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_buffer_pool.h"
+
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message.h"
+
+namespace {
+
+    using namespace mongo;
+
+    BSONObj poolStats() {
+        BSONObjBuilder b;
+        MessageBufferPool::appendStats( b );
+        return b.obj();
+    }
+
+    long long hits() { return poolStats()["hits"].numberLong(); }
+    long long misses() { return poolStats()["misses"].numberLong(); }
+    long long bytesHeld() { return poolStats()["bytesHeld"].numberLong(); }
+
+    TEST(MessageBufferPool, ReleasedBufferIsReused) {
+        char* a = MessageBufferPool::allocate( 500 );
+        memset( a, 'x', 500 );
+        MessageBufferPool::release( a );
+
+        const long long hitsBefore = hits();
+        char* b = MessageBufferPool::allocate( 600 );
+        ASSERT_EQUALS( a, b );
+        ASSERT_EQUALS( hitsBefore + 1, hits() );
+        MessageBufferPool::release( b );
+    }
+
+    TEST(MessageBufferPool, SizeClassesAreSeparate) {
+        char* small = MessageBufferPool::allocate( 100 );
+        MessageBufferPool::release( small );
+
+        const long long missesBefore = misses();
+        char* large = MessageBufferPool::allocate( 20 * 1024 );
+        ASSERT_NOT_EQUALS( small, large );
+        ASSERT_EQUALS( missesBefore + 1, misses() );
+        memset( large, 'x', 20 * 1024 );
+        MessageBufferPool::release( large );
+    }
+
+    TEST(MessageBufferPool, OversizedBuffersAreNotPooled) {
+        const size_t size = MessageBufferPool::kMaxPooledSize * 2;
+        const long long heldBefore = bytesHeld();
+        const long long hitsBefore = hits();
+        const long long missesBefore = misses();
+
+        char* buf = MessageBufferPool::allocate( size );
+        memset( buf, 'x', size );
+        MessageBufferPool::release( buf );
+
+        ASSERT_EQUALS( heldBefore, bytesHeld() );
+        ASSERT_EQUALS( hitsBefore, hits() );
+        ASSERT_EQUALS( missesBefore, misses() );
+    }
+
+    TEST(MessageBufferPool, CacheIsBounded) {
+        const size_t n = MessageBufferPool::kMaxBuffersPerClass + 3;
+        std::vector<char*> bufs;
+        for ( size_t i = 0; i < n; i++ ) {
+            bufs.push_back( MessageBufferPool::allocate( 3000 ) );
+        }
+        const long long heldBefore = bytesHeld();
+        for ( size_t i = 0; i < n; i++ ) {
+            MessageBufferPool::release( bufs[i] );
+        }
+        ASSERT_LESS_THAN_OR_EQUALS( bytesHeld() - heldBefore,
+                                    static_cast<long long>( MessageBufferPool::kMaxBuffersPerClass *
+                                                            4096 ) );
+        ASSERT_LESS_THAN_OR_EQUALS( bytesHeld(),
+                                    static_cast<long long>( MessageBufferPool::kMaxBytesPerThread ) );
+    }
+
+    void allocateAndRelease( char** out ) {
+        *out = MessageBufferPool::allocate( 700 );
+        MessageBufferPool::release( *out );
+    }
+
+    TEST(MessageBufferPool, ThreadExitFreesCache) {
+        const long long heldBefore = bytesHeld();
+        char* buf;
+        boost::thread t( stdx::bind( allocateAndRelease, &buf ) );
+        t.join();
+        ASSERT_EQUALS( heldBefore, bytesHeld() );
+    }
+
+    TEST(MessageBufferPool, MessageReturnsPooledBuffer) {
+        const int len = 200;
+        char* buf = MessageBufferPool::allocate( len );
+        MsgData::View md = buf;
+        md.setLen( len );
+        md.setOperation( dbQuery );
+
+        const long long heldBefore = bytesHeld();
+        {
+            Message m;
+            m.setPooledData( buf );
+
+            // Ownership, including where the buffer goes back to, moves with the message.
+            Message moved( m );
+            ASSERT( m.empty() );
+            ASSERT_EQUALS( len, moved.size() );
+            ASSERT_EQUALS( heldBefore, bytesHeld() );
+        }
+        ASSERT_EQUALS( heldBefore + 1024, bytesHeld() );
+
+        const long long hitsBefore = hits();
+        char* again = MessageBufferPool::allocate( len );
+        ASSERT_EQUALS( buf, again );
+        ASSERT_EQUALS( hitsBefore + 1, hits() );
+        MessageBufferPool::release( again );
+    }
+
+    TEST(MessageBufferPool, AppendToPooledMessage) {
+        const int len = 64;
+        char* buf = MessageBufferPool::allocate( len );
+        MsgData::View md = buf;
+        md.setLen( len );
+        md.setOperation( dbQuery );
+
+        Message m;
+        m.setPooledData( buf );
+        char* extra = static_cast<char*>( mongoMalloc( 32 ) );
+        m.appendData( extra, 32 );
+        ASSERT_EQUALS( len + 32, m.size() );
+
+        const long long heldBefore = bytesHeld();
+        m.reset();
+        ASSERT_EQUALS( heldBefore + 1024, bytesHeld() );
+    }
+
+} // namespace
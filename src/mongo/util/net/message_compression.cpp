@@ -0,0 +1,254 @@
+// message_compression.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compression.h"
+
+#include <vector>
+
+#include "mongo/base/data_view.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/allocator.h"
+#include "mongo/util/compress.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_buffer_pool.h"
+#include "mongo/util/net/message_port.h"
+
+namespace mongo {
+
+namespace {
+
+    const char kSnappyCompressorName[] = "snappy";
+    const char kCompressionFieldName[] = "compression";
+
+    const int kHeaderSize = MsgData::MsgDataHeaderSize;
+
+    // originalOpcode, uncompressedSize, compressorId
+    const int kEnvelopeSize = 4 + 4 + 1;
+
+    // "snappy" compresses messages on connections where the other end agrees to it,
+    // "disabled" never asks for or agrees to compression.
+    std::string networkMessageCompressors = "disabled";
+
+    class ExportedMessageCompressorsParameter : public ExportedServerParameter<std::string> {
+    public:
+        ExportedMessageCompressorsParameter() :
+            ExportedServerParameter<std::string>(ServerParameterSet::getGlobal(),
+                                                 "networkMessageCompressors",
+                                                 &networkMessageCompressors,
+                                                 true,
+                                                 false) {}
+
+        virtual Status validate( const std::string& potentialNewValue ) {
+            if ( potentialNewValue != kSnappyCompressorName && potentialNewValue != "disabled" ) {
+                return Status( ErrorCodes::BadValue,
+                               "networkMessageCompressors must be \"snappy\" or \"disabled\"" );
+            }
+            return Status::OK();
+        }
+    } exportedMessageCompressorsParam;
+
+    AtomicInt64 compressorBytesIn;
+    AtomicInt64 compressorBytesOut;
+    AtomicInt64 decompressorBytesIn;
+    AtomicInt64 decompressorBytesOut;
+
+    bool requestsSnappy( const BSONElement& compression ) {
+        if ( compression.type() != Array )
+            return false;
+        BSONForEach( e, compression.Obj() ) {
+            if ( e.type() == String && e.valuestrsafe() == StringData( kSnappyCompressorName ) )
+                return true;
+        }
+        return false;
+    }
+
+} // namespace
+
+    bool isMessageCompressionEnabled() {
+        return networkMessageCompressors == kSnappyCompressorName;
+    }
+
+    void appendMessageCompressionRequest( BSONObjBuilder* isMasterCmd ) {
+        if ( !isMessageCompressionEnabled() )
+            return;
+        BSONArrayBuilder compressors( isMasterCmd->subarrayStart( kCompressionFieldName ) );
+        compressors.append( kSnappyCompressorName );
+        compressors.done();
+    }
+
+    void negotiateMessageCompression( const BSONObj& cmdObj,
+                                      AbstractMessagingPort* port,
+                                      BSONObjBuilder* result ) {
+        if ( !port || !isMessageCompressionEnabled() )
+            return;
+        if ( !requestsSnappy( cmdObj[kCompressionFieldName] ) )
+            return;
+
+        port->setCompressionEnabled( true );
+        BSONArrayBuilder compressors( result->subarrayStart( kCompressionFieldName ) );
+        compressors.append( kSnappyCompressorName );
+        compressors.done();
+    }
+
+    void finishMessageCompressionNegotiation( const BSONObj& isMasterReply,
+                                              AbstractMessagingPort* port ) {
+        if ( !isMessageCompressionEnabled() )
+            return;
+        if ( requestsSnappy( isMasterReply[kCompressionFieldName] ) )
+            port->setCompressionEnabled( true );
+    }
+
+    bool compressMessage( const Message& in, Message* out ) {
+        verify( out->empty() );
+
+        const int len = in.size();
+        if ( len < kMinCompressibleMessageSize )
+            return false;
+
+        MsgData::ConstView header = in.header().view2ptr();
+        if ( header.getOperation() == dbCompressed )
+            return false;
+
+        std::vector<char> scratch;
+        const char* whole = header.view2ptr();
+        if ( !in.isSingleBuffer() ) {
+            scratch.resize( len );
+            in.copyTo( &scratch[0] );
+            whole = &scratch[0];
+        }
+
+        const char* body = whole + kHeaderSize;
+        const size_t bodyLen = len - kHeaderSize;
+        const size_t maxLen = kHeaderSize + kEnvelopeSize + maxCompressedLength( bodyLen );
+        char* buf = static_cast<char*>( mongoMalloc( maxLen ) );
+
+        size_t compressedLen;
+        rawCompress( body, bodyLen, buf + kHeaderSize + kEnvelopeSize, &compressedLen );
+        const size_t totalLen = kHeaderSize + kEnvelopeSize + compressedLen;
+        if ( totalLen >= static_cast<size_t>( len ) ) {
+            free( buf );
+            return false;
+        }
+
+        MsgData::View md = buf;
+        md.setLen( totalLen );
+        md.setId( header.getId() );
+        md.setResponseTo( header.getResponseTo() );
+        md.setOperation( dbCompressed );
+        DataView( md.data() )
+            .writeLE<int32_t>( header.getOperation() )
+            .writeLE<int32_t>( bodyLen, 4 )
+            .writeLE<uint8_t>( kSnappyCompressorId, 8 );
+        out->setData( buf, true );
+
+        compressorBytesIn.fetchAndAdd( len );
+        compressorBytesOut.fetchAndAdd( totalLen );
+        return true;
+    }
+
+    Status decompressMessage( const Message& in, Message* out ) {
+        verify( out->empty() );
+
+        MsgData::ConstView envelope = in.singleData().view2ptr();
+        invariant( envelope.getOperation() == dbCompressed );
+
+        if ( envelope.dataLen() < kEnvelopeSize ) {
+            return Status( ErrorCodes::BadValue,
+                           str::stream() << "compressed message too short: "
+                                         << envelope.getLen() );
+        }
+
+        ConstDataView fields( envelope.data() );
+        const int32_t originalOpcode = fields.readLE<int32_t>();
+        const int32_t uncompressedSize = fields.readLE<int32_t>( 4 );
+        const uint8_t compressorId = fields.readLE<uint8_t>( 8 );
+
+        if ( compressorId != kSnappyCompressorId ) {
+            return Status( ErrorCodes::BadValue,
+                           str::stream() << "unknown message compressor: "
+                                         << static_cast<int>( compressorId ) );
+        }
+        if ( originalOpcode == dbCompressed ) {
+            return Status( ErrorCodes::BadValue, "compressed message contains another" );
+        }
+        if ( uncompressedSize < 0 ||
+             static_cast<size_t>( uncompressedSize ) + kHeaderSize > MaxMessageSizeBytes ) {
+            return Status( ErrorCodes::BadValue,
+                           str::stream() << "invalid uncompressed message size: "
+                                         << uncompressedSize );
+        }
+
+        const char* compressed = envelope.data() + kEnvelopeSize;
+        const size_t compressedLen = envelope.dataLen() - kEnvelopeSize;
+        size_t actualSize;
+        if ( !uncompressedLength( compressed, compressedLen, &actualSize ) ||
+             actualSize != static_cast<size_t>( uncompressedSize ) ) {
+            return Status( ErrorCodes::BadValue,
+                           str::stream() << "compressed message doesn't match its stated size of "
+                                         << uncompressedSize );
+        }
+
+        const int len = kHeaderSize + uncompressedSize;
+        char* buf = MessageBufferPool::allocate( len );
+        if ( !rawUncompress( compressed, compressedLen, buf + kHeaderSize ) ) {
+            MessageBufferPool::release( buf );
+            return Status( ErrorCodes::BadValue, "invalid compressed message" );
+        }
+
+        MsgData::View md = buf;
+        md.setLen( len );
+        md.setId( envelope.getId() );
+        md.setResponseTo( envelope.getResponseTo() );
+        md.setOperation( originalOpcode );
+        out->setPooledData( buf );
+
+        decompressorBytesIn.fetchAndAdd( envelope.getLen() );
+        decompressorBytesOut.fetchAndAdd( len );
+        return Status::OK();
+    }
+
+    void appendMessageCompressionStats( BSONObjBuilder& b ) {
+        BSONObjBuilder snappy( b.subobjStart( kSnappyCompressorName ) );
+        BSONObjBuilder compressor( snappy.subobjStart( "compressor" ) );
+        compressor.append( "bytesIn", compressorBytesIn.load() );
+        compressor.append( "bytesOut", compressorBytesOut.load() );
+        compressor.done();
+        BSONObjBuilder decompressor( snappy.subobjStart( "decompressor" ) );
+        decompressor.append( "bytesIn", decompressorBytesIn.load() );
+        decompressor.append( "bytesOut", decompressorBytesOut.load() );
+        decompressor.done();
+        snappy.done();
+    }
+
+} // namespace mongo
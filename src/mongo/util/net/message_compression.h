@@ -0,0 +1,108 @@
+// message_compression.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/status.h"
+
+namespace mongo {
+
+    class AbstractMessagingPort;
+    class BSONObj;
+    class BSONObjBuilder;
+    class Message;
+
+    /**
+     * Compressed message envelope.
+     *
+     * A dbCompressed message carries another message's body, compressed:
+     *
+     *   standard message header, with operation dbCompressed
+     *   int32 originalOpcode
+     *   int32 uncompressedSize   body size of the original message, without its header
+     *   uint8 compressorId       kSnappyCompressorId
+     *   compressed body
+     *
+     * The envelope's requestID and responseTo are those of the original message.
+     *
+     * A connection starts out uncompressed.  A client which wants compression sends
+     * "compression: [ 'snappy' ]" in an isMaster command; a server which has compression
+     * enabled answers with the same field, and from then on either end may compress what it
+     * sends on that connection.  Enabled with the networkMessageCompressors server parameter,
+     * for both the connections a process accepts and the ones it makes.
+     */
+
+    const int kSnappyCompressorId = 1;
+
+    /** Messages smaller than this aren't worth compressing. */
+    const int kMinCompressibleMessageSize = 512;
+
+    /**
+     * @return true if this process requests and accepts compression in isMaster.
+     */
+    bool isMessageCompressionEnabled();
+
+    /**
+     * Adds the compression request to an isMaster command an outgoing connection sends.
+     */
+    void appendMessageCompressionRequest(BSONObjBuilder* isMasterCmd);
+
+    /**
+     * Server side of isMaster: if 'cmdObj' requests a compressor we support, enables
+     * compression on 'port' and tells the client in 'result'.  'port' may be NULL, for
+     * DBDirectClient.
+     */
+    void negotiateMessageCompression(const BSONObj& cmdObj,
+                                     AbstractMessagingPort* port,
+                                     BSONObjBuilder* result);
+
+    /**
+     * Client side of isMaster: enables compression on 'port' if the server agreed to it.
+     */
+    void finishMessageCompressionNegotiation(const BSONObj& isMasterReply,
+                                             AbstractMessagingPort* port);
+
+    /**
+     * Compresses 'in', whose header must already be complete, into an envelope in 'out'.
+     *
+     * @return false, leaving 'out' empty, if 'in' is too small or didn't get any smaller
+     */
+    bool compressMessage(const Message& in, Message* out);
+
+    /**
+     * Recovers the original message from the envelope 'in' into 'out', which must be empty.
+     */
+    Status decompressMessage(const Message& in, Message* out);
+
+    /**
+     * Appends the compression byte counters.
+     */
+    void appendMessageCompressionStats(BSONObjBuilder& b);
+
+} // namespace mongo
@@ -0,0 +1,199 @@
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compression.h"
+
+#include <string>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+
+namespace {
+
+    using namespace mongo;
+
+    // Builds a query message with a body of 'bodyLen' bytes of compressible text.
+    void makeMessage( int bodyLen, Message* m ) {
+        const std::string body( bodyLen, 'x' );
+        m->setData( dbQuery, body.data(), body.size() );
+        m->header().setId( 1234 );
+        m->header().setResponseTo( 5678 );
+    }
+
+    void setCompressors( const std::string& value ) {
+        ServerParameter* param =
+            ServerParameterSet::getGlobal()->getMap().find( "networkMessageCompressors" )->second;
+        ASSERT_OK( param->setFromString( value ) );
+    }
+
+    TEST(MessageCompression, RoundTrip) {
+        Message original;
+        makeMessage( 10000, &original );
+
+        Message compressed;
+        ASSERT_TRUE( compressMessage( original, &compressed ) );
+        ASSERT_EQUALS( dbCompressed, compressed.operation() );
+        ASSERT_LESS_THAN( compressed.size(), original.size() );
+        ASSERT_EQUALS( 1234, compressed.header().getId() );
+        ASSERT_EQUALS( 5678, compressed.header().getResponseTo() );
+
+        Message decompressed;
+        ASSERT_OK( decompressMessage( compressed, &decompressed ) );
+        ASSERT_EQUALS( original.size(), decompressed.size() );
+        ASSERT_EQUALS( dbQuery, decompressed.operation() );
+        ASSERT_EQUALS( 1234, decompressed.header().getId() );
+        ASSERT_EQUALS( 5678, decompressed.header().getResponseTo() );
+        ASSERT_EQUALS( 0, memcmp( original.singleData().view2ptr(),
+                                  decompressed.singleData().view2ptr(),
+                                  original.size() ) );
+    }
+
+    TEST(MessageCompression, MultipleBuffers) {
+        char header[MsgData::MsgDataHeaderSize];
+        MsgData::View md = header;
+        md.setOperation( opReply );
+        const std::string body( 5000, 'y' );
+
+        Message original;
+        original.appendUnownedData( header, sizeof(header) );
+        original.appendUnownedData( const_cast<char*>( body.data() ), body.size() );
+
+        Message compressed;
+        ASSERT_TRUE( compressMessage( original, &compressed ) );
+
+        Message decompressed;
+        ASSERT_OK( decompressMessage( compressed, &decompressed ) );
+        ASSERT_EQUALS( original.size(), decompressed.size() );
+        ASSERT_EQUALS( opReply, decompressed.operation() );
+        ASSERT_TRUE( body == std::string( decompressed.singleData().data(), body.size() ) );
+    }
+
+    TEST(MessageCompression, SmallMessagesAreNotCompressed) {
+        Message original;
+        makeMessage( 100, &original );
+
+        Message compressed;
+        ASSERT_FALSE( compressMessage( original, &compressed ) );
+        ASSERT_TRUE( compressed.empty() );
+    }
+
+    TEST(MessageCompression, CorruptMessagesAreRejected) {
+        Message original;
+        makeMessage( 10000, &original );
+        Message compressed;
+        ASSERT_TRUE( compressMessage( original, &compressed ) );
+
+        // Overstate the uncompressed size.
+        MsgData::View md = compressed.singleData().view2ptr();
+        DataView( md.data() ).writeLE<int32_t>( 20000, 4 );
+        Message decompressed;
+        ASSERT_NOT_OK( decompressMessage( compressed, &decompressed ) );
+        ASSERT_TRUE( decompressed.empty() );
+
+        // Unknown compressor.
+        DataView( md.data() ).writeLE<int32_t>( original.dataSize(), 4 );
+        DataView( md.data() ).writeLE<uint8_t>( 77, 8 );
+        ASSERT_NOT_OK( decompressMessage( compressed, &decompressed ) );
+
+        // Garbage in place of the compressed body.
+        DataView( md.data() ).writeLE<uint8_t>( kSnappyCompressorId, 8 );
+        memset( md.data() + 9, 0xff, md.dataLen() - 9 );
+        ASSERT_NOT_OK( decompressMessage( compressed, &decompressed ) );
+    }
+
+    class TestPort : public AbstractMessagingPort {
+    public:
+        virtual void reply(Message& received, Message& response, MSGID responseTo) {}
+        virtual void reply(Message& received, Message& response) {}
+        virtual HostAndPort remote() const { return HostAndPort(); }
+        virtual unsigned remotePort() const { return 0; }
+        virtual SockAddr remoteAddr() const { return SockAddr(); }
+        virtual SockAddr localAddr() const { return SockAddr(); }
+    };
+
+    TEST(MessageCompression, Negotiation) {
+        setCompressors( "snappy" );
+
+        BSONObjBuilder cmd;
+        cmd.append( "isMaster", 1 );
+        appendMessageCompressionRequest( &cmd );
+        const BSONObj cmdObj = cmd.obj();
+        ASSERT_EQUALS( BSON( "isMaster" << 1 << "compression" << BSON_ARRAY( "snappy" ) ),
+                       cmdObj );
+
+        TestPort serverPort;
+        BSONObjBuilder result;
+        negotiateMessageCompression( cmdObj, &serverPort, &result );
+        ASSERT_TRUE( serverPort.compressionEnabled() );
+        const BSONObj reply = result.obj();
+
+        TestPort clientPort;
+        finishMessageCompressionNegotiation( reply, &clientPort );
+        ASSERT_TRUE( clientPort.compressionEnabled() );
+
+        // A client which doesn't ask doesn't get it.
+        TestPort oldClientPort;
+        BSONObjBuilder oldResult;
+        negotiateMessageCompression( BSON( "isMaster" << 1 ), &oldClientPort, &oldResult );
+        ASSERT_FALSE( oldClientPort.compressionEnabled() );
+        ASSERT_FALSE( oldResult.obj().hasField( "compression" ) );
+
+        setCompressors( "disabled" );
+    }
+
+    TEST(MessageCompression, NegotiationWhenDisabled) {
+        setCompressors( "disabled" );
+
+        BSONObjBuilder cmd;
+        cmd.append( "isMaster", 1 );
+        appendMessageCompressionRequest( &cmd );
+        ASSERT_FALSE( cmd.obj().hasField( "compression" ) );
+
+        TestPort serverPort;
+        BSONObjBuilder result;
+        negotiateMessageCompression( BSON( "isMaster" << 1 <<
+                                           "compression" << BSON_ARRAY( "snappy" ) ),
+                                     &serverPort,
+                                     &result );
+        ASSERT_FALSE( serverPort.compressionEnabled() );
+        ASSERT_FALSE( result.obj().hasField( "compression" ) );
+    }
+
+    TEST(MessageCompression, InvalidCompressorsParameter) {
+        ServerParameter* param =
+            ServerParameterSet::getGlobal()->getMap().find( "networkMessageCompressors" )->second;
+        ASSERT_NOT_OK( param->setFromString( "zlib" ) );
+    }
+
+} // namespace
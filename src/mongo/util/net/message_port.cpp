@@ -42,6 +42,7 @@
 #include "mongo/util/log.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compression.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/net/ssl_options.h"
 #include "mongo/util/scopeguard.h"
@@ -227,10 +228,8 @@ again:
             }
 
             psock->setHandshakeReceived();
-            int z = (len+1023)&0xfffffc00;
-            verify(z>=len);
-            MsgData::View md = reinterpret_cast<char *>(mongoMalloc(z));
-            ScopeGuard guard = MakeGuard(free, md.view2ptr());
+            MsgData::View md = MessageBufferPool::allocate(len);
+            ScopeGuard guard = MakeGuard(MessageBufferPool::release, md.view2ptr());
             verify(md.view2ptr());
 
             memcpy(md.view2ptr(), &header, headerLen);
@@ -239,7 +238,18 @@ again:
             psock->recv( md.data(), left );
 
             guard.Dismiss();
-            m.setData(md.view2ptr(), true);
+            if ( md.getOperation() != dbCompressed ) {
+                m.setPooledData(md.view2ptr());
+                return true;
+            }
+
+            Message compressed;
+            compressed.setPooledData(md.view2ptr());
+            Status status = decompressMessage(compressed, &m);
+            if ( !status.isOK() ) {
+                LOG(0) << "recv(): " << status.reason() << " from " << remote();
+                return false;
+            }
             return true;
 
         }
@@ -299,20 +309,24 @@ again:
         toSend.header().setId(nextMessageId());
         toSend.header().setResponseTo(responseTo);
 
+        Message compressed;
+        Message& wire = ( compressionEnabled() && compressMessage( toSend, &compressed ) ) ?
+            compressed : toSend;
+
         if ( piggyBackData && piggyBackData->len() ) {
             mmm( log() << "*     have piggy back" << endl; )
-            if ( ( piggyBackData->len() + toSend.header().getLen() ) > 1300 ) {
+            if ( ( piggyBackData->len() + wire.header().getLen() ) > 1300 ) {
                 // won't fit in a packet - so just send it off
                 piggyBackData->flush();
             }
             else {
-                piggyBackData->append( toSend );
+                piggyBackData->append( wire );
                 piggyBackData->flush();
                 return;
             }
         }
 
-        toSend.send( *this, "say" );
+        wire.send( *this, "say" );
     }
 
     void MessagingPort::piggyBack( Message& toSend , int responseTo ) {
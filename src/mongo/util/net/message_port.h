@@ -41,7 +41,7 @@ namespace mongo {
 
     class AbstractMessagingPort : boost::noncopyable {
     public:
-        AbstractMessagingPort() : tag(0), _connectionId(0) {}
+        AbstractMessagingPort() : tag(0), _connectionId(0), _compressionEnabled(false) {}
         virtual ~AbstractMessagingPort() { }
         virtual void reply(Message& received, Message& response, MSGID responseTo) = 0; // like the reply below, but doesn't rely on received.data still being available
         virtual void reply(Message& received, Message& response) = 0;
@@ -62,6 +62,13 @@ namespace mongo {
         long long connectionId() const { return _connectionId; }
         void setConnectionId( long long connectionId );
 
+        /**
+         * Set once both ends have agreed, in isMaster, to exchange compressed messages; see
+         * message_compression.h.  Compressed messages are accepted either way.
+         */
+        void setCompressionEnabled(bool enabled) { _compressionEnabled = enabled; }
+        bool compressionEnabled() const { return _compressionEnabled; }
+
     public:
         // TODO make this private with some helpers
 
@@ -71,6 +78,7 @@ namespace mongo {
     private:
         long long _connectionId;
         std::string _x509SubjectName;
+        bool _compressionEnabled;
     };
 
     class MessagingPort : public AbstractMessagingPort {
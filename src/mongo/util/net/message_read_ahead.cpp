@@ -0,0 +1,157 @@
+// message_read_ahead.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetworking
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_read_ahead.h"
+
+#include <boost/thread/thread.hpp>
+#include <memory>
+
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/log.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/numa_placement.h"
+
+namespace mongo {
+
+    MessageReadAhead::MessageReadAhead( MessagingPort* port, int depth )
+        : _port( port ),
+          _depth( depth ),
+          _done( false ),
+          _stopping( false ) {
+        invariant( depth > 0 );
+        _thread.reset( new boost::thread( stdx::bind( &MessageReadAhead::_run,
+                                                      this,
+                                                      NumaPlacement::currentNode() ) ) );
+    }
+
+    MessageReadAhead::~MessageReadAhead() {
+        stop();
+    }
+
+    void MessageReadAhead::_run( int numaNode ) {
+        setThreadName( "readAhead" );
+
+        // Stay on the connection thread's node; buffers received here are released there.
+        if ( numaNode >= 0 )
+            NumaPlacement::bindCurrentThread( numaNode );
+
+        while ( true ) {
+            {
+                boost::unique_lock<boost::mutex> lk( _mutex );
+                while ( !_stopping && _queue.size() >= _depth ) {
+                    _messageTaken.wait( lk );
+                }
+                if ( _stopping )
+                    break;
+            }
+
+            // We are the only thread receiving, so the change in bytes in is all this message.
+            std::auto_ptr<Message> m( new Message() );
+            const long long bytesInBefore = _port->psock->getBytesIn();
+            bool ok;
+            try {
+                ok = !inShutdown() && _port->recv( *m );
+            }
+            catch ( const DBException& e ) {
+                log() << "error receiving request, closing client connection: " << e;
+                ok = false;
+            }
+
+            boost::lock_guard<boost::mutex> lk( _mutex );
+            if ( !ok )
+                break;
+
+            Received r;
+            r.bytesIn = _port->psock->getBytesIn() - bytesInBefore;
+            r.m = m.release();
+            _queue.push_back( r );
+            _messageReceived.notify_one();
+        }
+
+        boost::lock_guard<boost::mutex> lk( _mutex );
+        _done = true;
+        _messageReceived.notify_one();
+    }
+
+    bool MessageReadAhead::next( Message& m, long long* bytesIn ) {
+        boost::unique_lock<boost::mutex> lk( _mutex );
+        while ( _queue.empty() && !_done ) {
+            _messageReceived.wait( lk );
+        }
+        if ( _queue.empty() )
+            return false;
+
+        std::auto_ptr<Message> received( _queue.front().m );
+        *bytesIn = _queue.front().bytesIn;
+        _queue.pop_front();
+        _messageTaken.notify_one();
+
+        m = *received;
+        return true;
+    }
+
+    void MessageReadAhead::stop() {
+        if ( !_thread )
+            return;
+
+        {
+            boost::lock_guard<boost::mutex> lk( _mutex );
+            _stopping = true;
+            _messageTaken.notify_one();
+        }
+
+        // Wake the thread if it's waiting for the client.  Only shut down, rather than close,
+        // the socket, so that the descriptor can't be reused while the thread might still
+        // receive on it.
+        const int fd = _port->psock->rawFD();
+        if ( fd >= 0 ) {
+#if defined(_WIN32)
+            ::shutdown( fd, SD_RECEIVE );
+#else
+            ::shutdown( fd, SHUT_RD );
+#endif
+        }
+
+        _thread->join();
+        _thread.reset();
+
+        for ( std::deque<Received>::iterator i = _queue.begin(); i != _queue.end(); ++i ) {
+            delete i->m;
+        }
+        _queue.clear();
+    }
+
+} // namespace mongo
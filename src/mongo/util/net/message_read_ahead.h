@@ -0,0 +1,107 @@
+// message_read_ahead.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+
+#include "mongo/base/disallow_copying.h"
+
+namespace boost {
+    class thread;
+}
+
+namespace mongo {
+
+    class Message;
+    class MessagingPort;
+
+    /**
+     * Receives a connection's messages on a thread of its own, up to a fixed number ahead of
+     * the one being processed, so that a client which pipelines its requests doesn't wait for
+     * each to be read and decoded in turn.  Messages are handed out, and so processed and
+     * answered, in the order they arrived.
+     *
+     * Only the read-ahead thread receives on the port once started; the owner still sends on
+     * it.  Not for SSL connections, whose reads and writes share state.
+     */
+    class MessageReadAhead {
+        MONGO_DISALLOW_COPYING(MessageReadAhead);
+    public:
+        /**
+         * Starts reading from 'port', which must outlive this object.
+         *
+         * @param depth the most messages to hold which haven't been taken with next()
+         * @throws boost::thread_resource_error if the thread can't be started
+         */
+        MessageReadAhead( MessagingPort* port, int depth );
+
+        /** Calls stop(). */
+        ~MessageReadAhead();
+
+        /**
+         * Waits for the next message.
+         *
+         * @param bytesIn set to the bytes read from the socket for 'm'
+         * @return false, once every message has been taken, if the connection has closed or
+         *     a message couldn't be received
+         */
+        bool next( Message& m, long long* bytesIn );
+
+        /**
+         * Shuts down reading on the socket, waits for the read-ahead thread and discards any
+         * messages not taken.  Safe to call more than once.
+         */
+        void stop();
+
+    private:
+        struct Received {
+            Message* m;
+            long long bytesIn;
+        };
+
+        void _run( int numaNode );
+
+        MessagingPort* const _port;
+        const size_t _depth;
+
+        boost::mutex _mutex;
+        boost::condition_variable _messageReceived;
+        boost::condition_variable _messageTaken;
+        std::deque<Received> _queue; // guarded by _mutex
+        bool _done;                  // guarded by _mutex; the thread has stopped reading
+        bool _stopping;              // guarded by _mutex
+
+        boost::scoped_ptr<boost::thread> _thread;
+    };
+
+} // namespace mongo
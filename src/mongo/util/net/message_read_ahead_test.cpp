@@ -0,0 +1,135 @@
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_read_ahead.h"
+
+#include <boost/shared_ptr.hpp>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/sock.h"
+
+namespace {
+
+    using namespace mongo;
+
+#ifndef _WIN32  // uses ::socketpair
+
+    class MessageReadAheadTest : public unittest::Test {
+    public:
+        MessageReadAheadTest() {
+            int socks[2];
+            ASSERT_EQUALS( 0, ::socketpair( PF_UNIX, SOCK_STREAM, 0, socks ) );
+            _client.reset( new MessagingPort(
+                boost::shared_ptr<Socket>( new Socket( socks[0], SockAddr() ) ) ) );
+            _server.reset( new MessagingPort(
+                boost::shared_ptr<Socket>( new Socket( socks[1], SockAddr() ) ) ) );
+        }
+
+        void send( int i ) {
+            Message toSend;
+            toSend.setData( dbQuery, reinterpret_cast<const char*>( &i ), sizeof( i ) );
+            _client->say( toSend );
+        }
+
+        int payload( Message& m ) {
+            return ConstDataView( m.singleData().data() ).readLE<int>();
+        }
+
+        boost::scoped_ptr<MessagingPort> _client;
+        boost::scoped_ptr<MessagingPort> _server;
+    };
+
+    TEST_F(MessageReadAheadTest, MessagesArriveInOrder) {
+        // More messages than the read-ahead holds, so that it has to wait for next().
+        for ( int i = 0; i < 10; i++ ) {
+            send( i );
+        }
+
+        MessageReadAhead readAhead( _server.get(), 2 );
+        for ( int i = 0; i < 10; i++ ) {
+            Message m;
+            long long bytesIn = 0;
+            ASSERT_TRUE( readAhead.next( m, &bytesIn ) );
+            ASSERT_EQUALS( i, payload( m ) );
+            ASSERT_EQUALS( m.size(), bytesIn );
+        }
+    }
+
+    TEST_F(MessageReadAheadTest, ReceivedMessagesOutliveClose) {
+        send( 1 );
+        send( 2 );
+        _client->shutdown();
+
+        MessageReadAhead readAhead( _server.get(), 4 );
+        Message m1;
+        Message m2;
+        Message m3;
+        long long bytesIn;
+        ASSERT_TRUE( readAhead.next( m1, &bytesIn ) );
+        ASSERT_EQUALS( 1, payload( m1 ) );
+        ASSERT_TRUE( readAhead.next( m2, &bytesIn ) );
+        ASSERT_EQUALS( 2, payload( m2 ) );
+        ASSERT_FALSE( readAhead.next( m3, &bytesIn ) );
+        ASSERT_TRUE( m3.empty() );
+    }
+
+    TEST_F(MessageReadAheadTest, StopWhileWaitingForClient) {
+        MessageReadAhead readAhead( _server.get(), 2 );
+        readAhead.stop();
+
+        Message m;
+        long long bytesIn;
+        ASSERT_FALSE( readAhead.next( m, &bytesIn ) );
+
+        // Safe to repeat, and again on destruction.
+        readAhead.stop();
+    }
+
+    TEST_F(MessageReadAheadTest, StopDiscardsUntakenMessages) {
+        send( 1 );
+        send( 2 );
+
+        MessageReadAhead readAhead( _server.get(), 1 );
+        Message m;
+        long long bytesIn;
+        ASSERT_TRUE( readAhead.next( m, &bytesIn ) );
+        readAhead.stop();
+    }
+
+#endif  // _WIN32
+
+} // namespace
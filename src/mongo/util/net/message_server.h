@@ -59,6 +59,35 @@ namespace mongo {
          * called once when a socket is disconnected
          */
         virtual void disconnected( AbstractMessagingPort* p ) = 0;
+
+        /**
+         * Thread-local state a handler keeps for a connection while the connection is not
+         * being serviced by any thread.  See detach() and attach().
+         */
+        class ThreadState {
+        public:
+            virtual ~ThreadState() {}
+        };
+
+        /**
+         * @return true if detach() and attach() can move a connection's thread-local state
+         * between threads.  Only such handlers are serviced by a pooled service executor;
+         * all others get a thread per connection.
+         */
+        virtual bool canDetach() const { return false; }
+
+        /**
+         * called after connected() or process() to remove the connection's thread-local state
+         * from the calling thread.  The caller owns the result until it is handed to attach().
+         */
+        virtual ThreadState* detach( AbstractMessagingPort* p ) { return NULL; }
+
+        /**
+         * called before process() or disconnected() to install state previously returned by
+         * detach() on the calling thread, which may differ from the thread that detached it.
+         * Takes ownership of 'state'.
+         */
+        virtual void attach( AbstractMessagingPort* p , ThreadState* state ) {}
     };
 
     class MessageServer {
@@ -38,6 +38,7 @@
 
 #include "mongo/db/lasterror.h"
 #include "mongo/db/server_options.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/util/concurrency/thread_name.h"
@@ -47,8 +48,11 @@
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_read_ahead.h"
 #include "mongo/util/net/message_server.h"
+#include "mongo/util/net/service_executor_epoll.h"
 #include "mongo/util/net/ssl_manager.h"
+#include "mongo/util/numa_placement.h"
 
 #ifdef __linux__  // TODO: consider making this ifndef _WIN32
 # include <sys/resource.h>
@@ -60,6 +64,52 @@
 
 namespace mongo {
 
+namespace {
+
+    // How accepted connections are serviced: "threadPerConnection" starts a thread for each
+    // one, "epoll" multiplexes them over a few network threads and a pool of workers.
+    std::string serviceExecutor = "threadPerConnection";
+
+    class ExportedServiceExecutorParameter : public ExportedServerParameter<std::string> {
+    public:
+        ExportedServiceExecutorParameter() :
+            ExportedServerParameter<std::string>(ServerParameterSet::getGlobal(),
+                                                 "serviceExecutor",
+                                                 &serviceExecutor,
+                                                 true,
+                                                 false) {}
+
+        virtual Status validate( const std::string& potentialNewValue ) {
+            if ( potentialNewValue != "threadPerConnection" && potentialNewValue != "epoll" ) {
+                return Status( ErrorCodes::BadValue,
+                               "serviceExecutor must be \"threadPerConnection\" or \"epoll\"" );
+            }
+            return Status::OK();
+        }
+    } exportedServiceExecutorParam;
+
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(serviceExecutorNetworkThreads, int, 2);
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(serviceExecutorMaxWorkerThreads, int, 512);
+
+    // Number of threads accepting connections, each on its own SO_REUSEPORT sockets.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(listenerAcceptThreads, int, 1);
+
+    // With a thread per connection, how many requests to receive ahead of the one being
+    // processed, on a second thread for the connection.  0 receives each in turn.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(connectionReadAheadMessages, int, 0);
+
+    bool canReadAhead() {
+        if ( connectionReadAheadMessages <= 0 )
+            return false;
+#ifdef MONGO_SSL
+        if ( getSSLManager() )
+            return false;
+#endif
+        return true;
+    }
+
+} // namespace
+
     class PortMessageServer : public MessageServer , public Listener {
     public:
         /**
@@ -86,6 +136,11 @@ namespace mongo {
                 return;
             }
 
+            if ( _executor ) {
+                _executor->addConnection( p );
+                return;
+            }
+
             try {
 #ifndef __linux__  // TODO: consider making this ifdef _WIN32
                 {
@@ -155,13 +210,52 @@ namespace mongo {
         }
 
         void run() {
+            if ( serviceExecutor == "epoll" )
+                _startExecutor();
             initAndListen();
         }
 
         virtual bool useUnixSockets() const { return true; }
 
+        virtual int numAcceptThreads() const { return std::max(listenerAcceptThreads, 1); }
+
     private:
         MessageHandler* _handler;
+        scoped_ptr<EpollServiceExecutor> _executor;
+
+        void _startExecutor() {
+            if ( !EpollServiceExecutor::isSupported() ) {
+                warning() << "serviceExecutor \"epoll\" is not supported on this platform, "
+                          << "using a thread per connection" << endl;
+                return;
+            }
+            if ( !_handler->canDetach() ) {
+                warning() << "serviceExecutor \"epoll\" is not supported by this process, "
+                          << "using a thread per connection" << endl;
+                return;
+            }
+#ifdef MONGO_SSL
+            // SSL sockets may hold decrypted data that epoll cannot see.
+            if ( getSSLManager() ) {
+                warning() << "serviceExecutor \"epoll\" is not supported with SSL, "
+                          << "using a thread per connection" << endl;
+                return;
+            }
+#endif
+            if ( serviceExecutorNetworkThreads < 1 || serviceExecutorMaxWorkerThreads < 1 ) {
+                warning() << "serviceExecutorNetworkThreads and serviceExecutorMaxWorkerThreads "
+                          << "must be positive, using a thread per connection" << endl;
+                return;
+            }
+
+            log() << "servicing connections with " << serviceExecutorNetworkThreads
+                  << " network threads and up to " << serviceExecutorMaxWorkerThreads
+                  << " workers" << endl;
+            _executor.reset( new EpollServiceExecutor( _handler,
+                                                       serviceExecutorNetworkThreads,
+                                                       serviceExecutorMaxWorkerThreads ) );
+            _executor->start();
+        }
 
         /**
          * Simple holder for threadRun parameters. Should not destroy the objects it holds -
@@ -202,6 +296,8 @@ namespace mongo {
                 setThreadName( threadName.c_str() );
             }
 
+            NumaPlacement::bindCurrentThread( NumaPlacement::nextNode() );
+
             verify( inPort );
             inPort->psock->setLogLevel(logger::LogSeverity::Debug(1));
             scoped_ptr<MessagingPort> p( inPort );
@@ -209,6 +305,7 @@ namespace mongo {
             string otherSide;
 
             Message m;
+            scoped_ptr<MessageReadAhead> readAhead;
             try {
                 LastError * le = new LastError();
                 lastError.reset( le ); // lastError now has ownership
@@ -217,11 +314,35 @@ namespace mongo {
 
                 handler->connected( p.get() );
 
+                if ( canReadAhead() ) {
+                    try {
+                        readAhead.reset( new MessageReadAhead( p.get(),
+                                                               connectionReadAheadMessages ) );
+                    }
+                    catch ( boost::thread_resource_error& ) {
+                        warning() << "can't start read-ahead thread for " << otherSide
+                                  << ", receiving requests in turn" << endl;
+                    }
+                }
+
                 while ( ! inShutdown() ) {
                     m.reset();
-                    p->psock->clearCounters();
 
-                    if ( ! p->recv(m) ) {
+                    // The read-ahead thread owns the bytes in counter, so count ours from
+                    // where they are instead of clearing them.
+                    bool received;
+                    long long bytesIn = 0;
+                    long long bytesOutBefore = 0;
+                    if ( readAhead ) {
+                        received = readAhead->next( m, &bytesIn );
+                        bytesOutBefore = p->psock->getBytesOut();
+                    }
+                    else {
+                        p->psock->clearCounters();
+                        received = p->recv( m );
+                    }
+
+                    if ( ! received ) {
                         if (!serverGlobalParams.quiet) {
                             int conns = Listener::globalTicketHolder.used()-1;
                             const char* word = (conns == 1 ? " connection" : " connections");
@@ -232,7 +353,9 @@ namespace mongo {
                     }
 
                     handler->process( m , p.get() , le );
-                    networkCounter.hit( p->psock->getBytesIn() , p->psock->getBytesOut() );
+                    if ( !readAhead )
+                        bytesIn = p->psock->getBytesIn();
+                    networkCounter.hit( bytesIn, p->psock->getBytesOut() - bytesOutBefore );
                 }
             }
             catch ( AssertionException& e ) {
@@ -252,6 +375,9 @@ namespace mongo {
                 dbexit( EXIT_UNCAUGHT );
             }
 
+            if ( readAhead )
+                readAhead->stop();
+
             // Normal disconnect path.
 #ifdef MONGO_SSL
             SSLManagerInterface* manager = getSSLManager();
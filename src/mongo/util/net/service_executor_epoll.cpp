@@ -0,0 +1,354 @@
+// service_executor_epoll.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetworking
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/service_executor_epoll.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#ifdef __linux__
+# include <sys/epoll.h>
+# include <unistd.h>
+#endif
+
+#include "mongo/db/lasterror.h"
+#include "mongo/db/server_options.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_server.h"
+#include "mongo/util/numa_placement.h"
+
+namespace mongo {
+
+    struct EpollServiceExecutor::Session {
+        Session( MessagingPort* inPort, int inEpfd )
+            : port( inPort ), epfd( inEpfd ), fd( -1 ), connected( false ) {
+            name = "conn";
+            if ( port->connectionId() > 0 )
+                name = str::stream() << name << port->connectionId();
+        }
+
+        boost::scoped_ptr<MessagingPort> port;
+        std::string name;
+        std::string otherSide;
+
+        // The epoll set this session is registered with, and our own descriptor for the
+        // socket.  The socket is dup()'d so that the registration survives the port being
+        // closed from another thread (see MessagingPort::closeAllSockets); the close wakes us
+        // up and the failed recv() ends the session.
+        const int epfd;
+        int fd;
+
+        bool connected;
+        boost::scoped_ptr<LastError> lastError;
+        std::auto_ptr<MessageHandler::ThreadState> state;
+    };
+
+#ifdef __linux__
+
+    bool EpollServiceExecutor::isSupported() {
+        return true;
+    }
+
+    EpollServiceExecutor::EpollServiceExecutor( MessageHandler* handler,
+                                                int numNetworkThreads,
+                                                int maxWorkers )
+        : _handler( handler ),
+          _maxWorkers( maxWorkers ),
+          _idleWorkers( 0 ) {
+        invariant( numNetworkThreads > 0 );
+        invariant( maxWorkers > 0 );
+        for ( int i = 0; i < numNetworkThreads; i++ ) {
+            int epfd = epoll_create1( EPOLL_CLOEXEC );
+            if ( epfd < 0 ) {
+                const int err = errno;
+                severe() << "epoll_create1 failed: " << errnoWithDescription( err );
+                fassertFailed( 28600 );
+            }
+            _epollFds.push_back( epfd );
+        }
+    }
+
+    void EpollServiceExecutor::start() {
+        for ( size_t i = 0; i < _epollFds.size(); i++ ) {
+            boost::thread thr( stdx::bind( &EpollServiceExecutor::_networkThread,
+                                           this,
+                                           _epollFds[i],
+                                           static_cast<int>( i ) ) );
+        }
+    }
+
+    void EpollServiceExecutor::addConnection( MessagingPort* p ) {
+        p->psock->setLogLevel( logger::LogSeverity::Debug(1) );
+
+        const int epfd = _epollFds[ _nextEpollFd.fetchAndAdd(1) % _epollFds.size() ];
+        Session* s = new Session( p, epfd );
+
+        // The first run on a worker calls MessageHandler::connected() and registers the
+        // session with its network thread.
+        _schedule( s );
+    }
+
+    void EpollServiceExecutor::_networkThread( int epfd, int index ) {
+        setThreadName( "serviceNetwork" );
+        NumaPlacement::bindCurrentThread( index % NumaPlacement::numNodes() );
+
+        const int maxEvents = 256;
+        struct epoll_event events[maxEvents];
+
+        while ( ! inShutdown() ) {
+            int n = epoll_wait( epfd, events, maxEvents, 500 );
+            if ( n < 0 ) {
+                const int err = errno;
+                if ( err == EINTR )
+                    continue;
+                severe() << "epoll_wait failed: " << errnoWithDescription( err );
+                fassertFailed( 28601 );
+            }
+
+            for ( int i = 0; i < n; i++ ) {
+                // Sessions are registered EPOLLONESHOT, so this one is ours until re-armed.
+                _schedule( static_cast<Session*>( events[i].data.ptr ) );
+            }
+        }
+    }
+
+    void EpollServiceExecutor::_schedule( Session* s ) {
+        bool startWorker = false;
+        {
+            boost::lock_guard<boost::mutex> lk( _mutex );
+            _queue.push_back( s );
+            if ( _idleWorkers == 0 && _numWorkers.load() < _maxWorkers ) {
+                _numWorkers.fetchAndAdd(1);
+                startWorker = true;
+            }
+        }
+
+        if ( !startWorker ) {
+            _workAvailable.notify_one();
+            return;
+        }
+
+        try {
+            boost::thread thr( stdx::bind( &EpollServiceExecutor::_workerThread, this ) );
+        }
+        catch ( boost::thread_resource_error& ) {
+            // The queued session will be picked up by one of the existing workers.
+            _numWorkers.fetchAndSubtract(1);
+            warning() << "can't create new service worker thread, "
+                      << _numWorkers.load() << " workers running" << endl;
+            _workAvailable.notify_one();
+        }
+    }
+
+    void EpollServiceExecutor::_workerThread() {
+        setThreadName( "serviceWorker" );
+        NumaPlacement::bindCurrentThread( NumaPlacement::nextNode() );
+
+        while ( true ) {
+            Session* s;
+            {
+                boost::unique_lock<boost::mutex> lk( _mutex );
+                _idleWorkers++;
+                while ( _queue.empty() ) {
+                    _workAvailable.wait( lk );
+                }
+                _idleWorkers--;
+
+                s = _queue.front();
+                _queue.pop_front();
+            }
+
+            _service( s );
+        }
+    }
+
+    void EpollServiceExecutor::_service( Session* s ) {
+        setThreadName( s->name );
+
+        MessagingPort* p = s->port.get();
+
+        try {
+            if ( !s->connected ) {
+                s->connected = true;
+
+                s->fd = dup( p->psock->rawFD() );
+                if ( s->fd < 0 ) {
+                    const int err = errno;
+                    log() << "can't service connection " << s->name << ": dup failed: "
+                          << errnoWithDescription( err ) << endl;
+                    p->shutdown();
+                }
+
+                s->lastError.reset( new LastError() );
+                lastError.reset( s->lastError.get() );
+                s->otherSide = p->psock->remoteString();
+
+                _handler->connected( p );
+
+                if ( s->fd < 0 ) {
+                    _end( s );
+                    return;
+                }
+            }
+            else {
+                lastError.reset( s->lastError.get() );
+                _handler->attach( p, s->state.release() );
+
+                Message m;
+                p->psock->clearCounters();
+
+                if ( inShutdown() || !p->recv( m ) ) {
+                    if ( !serverGlobalParams.quiet ) {
+                        int conns = Listener::globalTicketHolder.used() - 1;
+                        const char* word = ( conns == 1 ? " connection" : " connections" );
+                        log() << "end connection " << s->otherSide << " (" << conns << word
+                              << " now open)" << endl;
+                    }
+                    p->shutdown();
+                    _end( s );
+                    return;
+                }
+
+                _handler->process( m, p, s->lastError.get() );
+                networkCounter.hit( p->psock->getBytesIn(), p->psock->getBytesOut() );
+            }
+        }
+        catch ( AssertionException& e ) {
+            log() << "AssertionException handling request, closing client connection: " << e
+                  << endl;
+            p->shutdown();
+            _end( s );
+            return;
+        }
+        catch ( SocketException& e ) {
+            log() << "SocketException handling request, closing client connection: " << e
+                  << endl;
+            p->shutdown();
+            _end( s );
+            return;
+        }
+        catch ( const DBException& e ) { // must be right above std::exception
+            log() << "DBException handling request, closing client connection: " << e << endl;
+            p->shutdown();
+            _end( s );
+            return;
+        }
+        catch ( std::exception &e ) {
+            error() << "Uncaught std::exception: " << e.what() << ", terminating" << endl;
+            dbexit( EXIT_UNCAUGHT );
+        }
+
+        s->state.reset( _handler->detach( p ) );
+        lastError.release();
+        setThreadName( "serviceWorker" );
+
+        _rearm( s );
+    }
+
+    void EpollServiceExecutor::_rearm( Session* s ) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = s;
+
+        // The first re-arm adds the descriptor; epoll reports it immediately if a request
+        // arrived while the session was with a worker.
+        int ret = epoll_ctl( s->epfd, EPOLL_CTL_MOD, s->fd, &event );
+        if ( ret < 0 && errno == ENOENT )
+            ret = epoll_ctl( s->epfd, EPOLL_CTL_ADD, s->fd, &event );
+
+        if ( ret < 0 ) {
+            const int err = errno;
+            log() << "epoll_ctl failed for " << s->name << ", closing client connection: "
+                  << errnoWithDescription( err ) << endl;
+
+            lastError.reset( s->lastError.get() );
+            _handler->attach( s->port.get(), s->state.release() );
+            s->port->shutdown();
+            _end( s );
+        }
+    }
+
+    void EpollServiceExecutor::_end( Session* s ) {
+        TicketHolderReleaser connTicketReleaser( &Listener::globalTicketHolder );
+
+        _handler->disconnected( s->port.get() );
+
+        // Destroying the detached state plays the part of thread exit for the
+        // connection's thread-local objects.
+        s->state.reset( _handler->detach( s->port.get() ) );
+        lastError.release();
+
+        if ( s->fd >= 0 ) {
+            epoll_ctl( s->epfd, EPOLL_CTL_DEL, s->fd, NULL );
+            close( s->fd );
+        }
+
+        delete s;
+        setThreadName( "serviceWorker" );
+    }
+
+#else
+
+    bool EpollServiceExecutor::isSupported() {
+        return false;
+    }
+
+    EpollServiceExecutor::EpollServiceExecutor( MessageHandler* handler,
+                                                int numNetworkThreads,
+                                                int maxWorkers )
+        : _handler( handler ),
+          _maxWorkers( maxWorkers ),
+          _idleWorkers( 0 ) {
+        fassertFailed( 28602 );
+    }
+
+    void EpollServiceExecutor::start() {
+        fassertFailed( 28603 );
+    }
+
+    void EpollServiceExecutor::addConnection( MessagingPort* p ) {
+        fassertFailed( 28604 );
+    }
+
+#endif  // __linux__
+
+} // namespace mongo
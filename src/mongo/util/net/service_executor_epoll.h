@@ -0,0 +1,119 @@
+// service_executor_epoll.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    class MessageHandler;
+    class MessagingPort;
+
+    /**
+     * Services connections with a small, fixed set of network threads and a bounded pool of
+     * worker threads, instead of a thread per connection.
+     *
+     * Each network thread waits with epoll for any of its connections to become readable and
+     * then queues that connection for a worker.  The worker receives one message, processes it
+     * and replies, then hands the connection back to its network thread.  Idle connections
+     * therefore cost a file descriptor and a little memory, but no thread or stack.
+     *
+     * A connection's thread-local state follows it between workers through
+     * MessageHandler::detach() and MessageHandler::attach(), so the handler must support both.
+     * Workers are started on demand, up to the configured maximum, whenever a connection is
+     * queued and no worker is idle; operations which block for a long time (exhaust cursors,
+     * awaitData, fsyncLock) each hold a worker while they run.
+     *
+     * Only available on linux; see isSupported().
+     */
+    class EpollServiceExecutor {
+        MONGO_DISALLOW_COPYING(EpollServiceExecutor);
+    public:
+        static bool isSupported();
+
+        /**
+         * @param handler processes messages; must outlive the executor and support detach().
+         */
+        EpollServiceExecutor( MessageHandler* handler, int numNetworkThreads, int maxWorkers );
+
+        /**
+         * Starts the network threads.  Must be called once, before addConnection().
+         */
+        void start();
+
+        /**
+         * Begins servicing 'p', of which the executor takes ownership.  The connection's
+         * Listener::globalTicketHolder ticket is released when the connection is closed.
+         */
+        void addConnection( MessagingPort* p );
+
+    private:
+        struct Session;
+
+        /**
+         * Waits on one epoll set and queues each session that becomes readable.  'index' picks
+         * the thread's NUMA node.
+         */
+        void _networkThread( int epfd, int index );
+
+        void _workerThread();
+
+        /** Queues 's' for a worker, starting a new worker if none is idle. */
+        void _schedule( Session* s );
+
+        /** Runs on a worker: receives and processes one message, or finishes connecting. */
+        void _service( Session* s );
+
+        /** Re-enables readiness notification for 's', after a worker has finished with it. */
+        void _rearm( Session* s );
+
+        /** Runs on a worker with the session's state attached; destroys the session. */
+        void _end( Session* s );
+
+        MessageHandler* const _handler;
+        const int _maxWorkers;
+
+        std::vector<int> _epollFds;
+        AtomicUInt32 _nextEpollFd;
+
+        boost::mutex _mutex;
+        boost::condition_variable _workAvailable;
+        std::deque<Session*> _queue; // guarded by _mutex
+        int _idleWorkers;            // guarded by _mutex
+        AtomicInt32 _numWorkers;
+    };
+
+} // namespace mongo
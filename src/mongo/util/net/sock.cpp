@@ -41,6 +41,7 @@
 # include <netinet/tcp.h>
 # include <arpa/inet.h>
 # include <errno.h>
+# include <limits.h>
 # include <netdb.h>
 # if defined(__openbsd__)
 #  include <sys/uio.h>
@@ -657,10 +658,17 @@ namespace mongo {
                 _bytesOut += j->second;
             }
         }
+        if ( i == 0 ) {
+            return;
+        }
+
+        // sendmsg() takes at most IOV_MAX buffers at a time, which a reply made of many
+        // separately held documents can exceed
+        struct iovec* const end = &d[ 0 ] + i;
         struct msghdr meta;
         memset( &meta, 0, sizeof( meta ) );
         meta.msg_iov = &d[ 0 ];
-        meta.msg_iovlen = d.size();
+        meta.msg_iovlen = std::min( i, IOV_MAX );
 
         while( meta.msg_iovlen > 0 ) {
             int ret = -1;
@@ -701,6 +709,9 @@ namespace mongo {
                         --(meta.msg_iovlen);
                     }
                 }
+                if ( meta.msg_iovlen == 0 ) {
+                    meta.msg_iovlen = std::min( static_cast<int>( end - i ), IOV_MAX );
+                }
             }
         }
 #endif
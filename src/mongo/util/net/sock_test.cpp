@@ -289,6 +289,26 @@ namespace {
         ASSERT_TRUE(tryRecv());
     }
 
+    // More buffers than one sendmsg() call accepts, some of them empty.
+    TEST_F(SocketFailPointTest, TestSendVectorOfManyBuffers) {
+        const int numBuffers = 2500;
+        std::vector<char> bytes(numBuffers * 2);
+        std::vector<std::pair<char*, int> > data;
+        for (int i = 0; i < numBuffers; ++i) {
+            bytes[i * 2] = static_cast<char>(i);
+            bytes[i * 2 + 1] = static_cast<char>(i >> 8);
+            data.push_back(std::make_pair(&bytes[i * 2], 2));
+            if (i % 100 == 0) {
+                data.push_back(std::make_pair(&bytes[i * 2], 0));
+            }
+        }
+        _sockets.first->send(data, "SocketFailPointTest::TestSendVectorOfManyBuffers");
+
+        std::vector<char> received(bytes.size());
+        _sockets.second->recv(&received[0], received.size());
+        ASSERT_TRUE(bytes == received);
+    }
+
     TEST_F(SocketFailPointTest, TestRecv) {
         ASSERT_TRUE(trySend()); // data for recv
         ASSERT_TRUE(tryRecv());
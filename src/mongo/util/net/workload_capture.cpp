@@ -0,0 +1,147 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/workload_capture.h"
+
+#include <cstring>
+
+#include "mongo/base/data_view.h"
+#include "mongo/db/dbmessage.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compression.h"
+
+namespace mongo {
+
+    namespace {
+        const char kMagic[] = "MWLCAP01";
+        const size_t kMagicSize = sizeof(kMagic) - 1;
+        const size_t kRecordHeaderSize = 2 * sizeof(int64_t);
+    }
+
+    void CapturedMessage::toMessage(Message* out) const {
+        char* buf = static_cast<char*>(mongoMalloc(data.size()));
+        memcpy(buf, data.data(), data.size());
+        out->reset();
+        out->setData(buf, true);
+    }
+
+    WorkloadCaptureWriter::WorkloadCaptureWriter() {
+
+    }
+
+    Status WorkloadCaptureWriter::open(const std::string& path) {
+        boost::mutex::scoped_lock lk(_mutex);
+        _out.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!_out.good()) {
+            return Status(ErrorCodes::FileNotOpen,
+                          str::stream() << "could not open workload capture file " << path);
+        }
+        _out.write(kMagic, kMagicSize);
+        _timer.reset();
+        return Status::OK();
+    }
+
+    void WorkloadCaptureWriter::record(long long offsetMicros,
+                                       long long connectionId,
+                                       const Message& m) {
+        Message decompressed;
+        const Message* message = &m;
+        if (m.operation() == dbCompressed) {
+            if (!decompressMessage(m, &decompressed).isOK()) {
+                return;
+            }
+            message = &decompressed;
+        }
+
+        std::string data(message->size(), '\0');
+        message->copyTo(&data[0]);
+        if (message->operation() == opReply && data.size() > sizeof(QueryResult::Layout)) {
+            data.resize(sizeof(QueryResult::Layout));
+            MsgData::View(&data[0]).setLen(data.size());
+        }
+
+        char recordHeader[kRecordHeaderSize];
+        DataView(recordHeader).writeLE<int64_t>(offsetMicros, 0);
+        DataView(recordHeader).writeLE<int64_t>(connectionId, sizeof(int64_t));
+
+        boost::mutex::scoped_lock lk(_mutex);
+        _out.write(recordHeader, kRecordHeaderSize);
+        _out.write(data.data(), data.size());
+        // The capturing tools exit without unwinding, so don't leave records in the buffer
+        _out.flush();
+    }
+
+    void WorkloadCaptureWriter::recordNow(long long connectionId, const Message& m) {
+        record(_timer.micros(), connectionId, m);
+    }
+
+    Status readWorkloadCapture(const std::string& path, std::vector<CapturedMessage>* out) {
+        std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+        if (!in.good()) {
+            return Status(ErrorCodes::FileNotOpen,
+                          str::stream() << "could not open workload capture file " << path);
+        }
+
+        char magic[kMagicSize];
+        if (!in.read(magic, kMagicSize) || memcmp(magic, kMagic, kMagicSize) != 0) {
+            return Status(ErrorCodes::FailedToParse,
+                          str::stream() << path << " is not a workload capture file");
+        }
+
+        char recordHeader[kRecordHeaderSize + sizeof(int32_t)];
+        while (in.read(recordHeader, sizeof(recordHeader))) {
+            CapturedMessage captured;
+            captured.offsetMicros = ConstDataView(recordHeader).readLE<int64_t>(0);
+            captured.connectionId = ConstDataView(recordHeader).readLE<int64_t>(sizeof(int64_t));
+            const int32_t len = ConstDataView(recordHeader).readLE<int32_t>(kRecordHeaderSize);
+            if (len < MsgData::MsgDataHeaderSize || len > 4 * BSONObjMaxInternalSize) {
+                return Status(ErrorCodes::FailedToParse,
+                              str::stream() << "invalid message length " << len
+                                            << " in workload capture file " << path);
+            }
+
+            captured.data.resize(len);
+            memcpy(&captured.data[0], recordHeader + kRecordHeaderSize, sizeof(int32_t));
+            if (!in.read(&captured.data[sizeof(int32_t)], len - sizeof(int32_t))) {
+                return Status(ErrorCodes::FileStreamFailed,
+                              str::stream() << "truncated workload capture file " << path);
+            }
+            out->push_back(captured);
+        }
+
+        if (in.gcount() != 0) {
+            return Status(ErrorCodes::FileStreamFailed,
+                          str::stream() << "truncated workload capture file " << path);
+        }
+        return Status::OK();
+    }
+
+} // namespace mongo
@@ -0,0 +1,109 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    class Message;
+
+    /**
+     * A wire protocol message seen on a client connection during a workload capture.
+     *
+     * Requests are kept whole.  Replies are cut down to their header, which is all that is
+     * needed to follow the cursors a replayed workload opens.
+     */
+    struct CapturedMessage {
+        CapturedMessage() : offsetMicros(0), connectionId(0) {}
+
+        /**
+         * Copies the message into a newly allocated Message, ready to be sent.
+         */
+        void toMessage(Message* out) const;
+
+        // Microseconds from the start of the capture to when the message was seen
+        long long offsetMicros;
+
+        // Identifies the client connection within the capture
+        long long connectionId;
+
+        // The message bytes, starting with the header
+        std::string data;
+    };
+
+    /**
+     * Appends captured messages to a workload file.
+     *
+     * The file starts with a magic string, followed by one record per message: the offset in
+     * microseconds and the connection id as little endian 64 bit integers, then the message
+     * itself, which starts with its length.
+     *
+     * Thread safe.
+     */
+    class WorkloadCaptureWriter {
+        MONGO_DISALLOW_COPYING(WorkloadCaptureWriter);
+    public:
+        WorkloadCaptureWriter();
+
+        /**
+         * Creates or truncates the workload file at 'path' and starts the capture clock.
+         */
+        Status open(const std::string& path);
+
+        /**
+         * Records a message seen on 'connectionId' at 'offsetMicros' from the start of the
+         * capture.  Compressed messages are recorded decompressed.
+         */
+        void record(long long offsetMicros, long long connectionId, const Message& m);
+
+        /**
+         * Records a message seen just now, by the writer's clock.
+         */
+        void recordNow(long long connectionId, const Message& m);
+
+    private:
+        boost::mutex _mutex;
+        std::ofstream _out;
+        Timer _timer;
+    };
+
+    /**
+     * Reads all the messages of the workload file at 'path' into 'out', in recorded order.
+     */
+    Status readWorkloadCapture(const std::string& path, std::vector<CapturedMessage>* out);
+
+} // namespace mongo
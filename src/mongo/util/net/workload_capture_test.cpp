@@ -0,0 +1,137 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/workload_capture.h"
+
+#include <fstream>
+
+#include "mongo/base/data_view.h"
+#include "mongo/db/dbmessage.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message.h"
+
+namespace {
+
+    using namespace mongo;
+
+    TEST(WorkloadCapture, RoundTrip) {
+        unittest::TempDir tempDir("workload_capture_test");
+        const std::string path = tempDir.path() + "/capture";
+
+        Message query;
+        const std::string queryBody(100, 'q');
+        query.setData(dbQuery, queryBody.data(), queryBody.size());
+        query.header().setId(7);
+
+        // A reply carrying a cursor id and a document body which isn't worth keeping
+        std::string replyBody(20 + 1000, 'r');
+        DataView(&replyBody[0]).writeLE<int32_t>(0, 0);
+        DataView(&replyBody[0]).writeLE<int64_t>(123456789LL, 4);
+        Message reply;
+        reply.setData(opReply, replyBody.data(), replyBody.size());
+        reply.header().setResponseTo(7);
+
+        {
+            WorkloadCaptureWriter writer;
+            ASSERT_OK(writer.open(path));
+            writer.record(10, 1, query);
+            writer.record(25, 1, reply);
+            writer.record(30, 2, query);
+        }
+
+        std::vector<CapturedMessage> captured;
+        ASSERT_OK(readWorkloadCapture(path, &captured));
+        ASSERT_EQUALS(3U, captured.size());
+
+        ASSERT_EQUALS(10, captured[0].offsetMicros);
+        ASSERT_EQUALS(1, captured[0].connectionId);
+        Message replayedQuery;
+        captured[0].toMessage(&replayedQuery);
+        ASSERT_EQUALS(dbQuery, replayedQuery.operation());
+        ASSERT_EQUALS(7, replayedQuery.header().getId());
+        ASSERT_EQUALS(query.size(), replayedQuery.size());
+        ASSERT_EQUALS(0, memcmp(query.singleData().view2ptr(),
+                                replayedQuery.singleData().view2ptr(),
+                                query.size()));
+
+        ASSERT_EQUALS(25, captured[1].offsetMicros);
+        Message replayedReply;
+        captured[1].toMessage(&replayedReply);
+        ASSERT_EQUALS(opReply, replayedReply.operation());
+        ASSERT_EQUALS(static_cast<int>(sizeof(QueryResult::Layout)), replayedReply.size());
+        ASSERT_EQUALS(7, replayedReply.header().getResponseTo());
+        ASSERT_EQUALS(123456789LL, replayedReply.header().getCursor());
+
+        ASSERT_EQUALS(30, captured[2].offsetMicros);
+        ASSERT_EQUALS(2, captured[2].connectionId);
+    }
+
+    TEST(WorkloadCapture, RejectsOtherFiles) {
+        unittest::TempDir tempDir("workload_capture_test");
+        const std::string path = tempDir.path() + "/other";
+        {
+            std::ofstream out(path.c_str());
+            out << "not a capture";
+        }
+
+        std::vector<CapturedMessage> captured;
+        ASSERT_NOT_OK(readWorkloadCapture(path, &captured));
+        ASSERT_NOT_OK(readWorkloadCapture(tempDir.path() + "/missing", &captured));
+    }
+
+    TEST(WorkloadCapture, RejectsTruncatedFiles) {
+        unittest::TempDir tempDir("workload_capture_test");
+        const std::string path = tempDir.path() + "/capture";
+
+        Message query;
+        const std::string queryBody(100, 'q');
+        query.setData(dbQuery, queryBody.data(), queryBody.size());
+        {
+            WorkloadCaptureWriter writer;
+            ASSERT_OK(writer.open(path));
+            writer.record(10, 1, query);
+        }
+
+        std::string contents;
+        {
+            std::ifstream in(path.c_str(), std::ios::binary);
+            contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+            out.write(contents.data(), contents.size() - 10);
+        }
+
+        std::vector<CapturedMessage> captured;
+        ASSERT_NOT_OK(readWorkloadCapture(path, &captured));
+    }
+
+} // namespace
@@ -0,0 +1,218 @@
+// numa_placement.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kControl
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/numa_placement.h"
+
+#include <fstream>
+
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include "mongo/base/parse_number.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/threadlocal.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Filled in once by enable(), before any other threads look at them.
+        bool numaEnabled = false;
+        std::vector< std::vector<int> > nodeCpus;
+
+        AtomicUInt32 nextNodeCounter;
+
+        ThreadLocalValue<int> threadNode( -1 );
+
+#ifdef __linux__
+        // From <numaif.h>, which is only available with libnuma.
+        const int kMpolPreferred = 1;
+        const int kMpolInterleave = 3;
+
+        const int kMaxNodes = 1024;
+        const int kBitsPerWord = 8 * sizeof(unsigned long);
+
+        bool setMemoryPolicy( int mode, const std::vector<int>& nodes ) {
+            std::vector<unsigned long> mask( kMaxNodes / kBitsPerWord, 0 );
+            for ( size_t i = 0; i < nodes.size(); i++ ) {
+                mask[ nodes[i] / kBitsPerWord ] |= 1UL << ( nodes[i] % kBitsPerWord );
+            }
+
+            if ( syscall( SYS_set_mempolicy, mode, &mask[0], kMaxNodes ) != 0 ) {
+                const int err = errno;
+                warning() << "set_mempolicy failed: " << errnoWithDescription( err );
+                return false;
+            }
+            return true;
+        }
+
+        /** Reads the CPUs of each node from sysfs; nodes are numbered densely from 0. */
+        void readTopology( std::vector< std::vector<int> >* out ) {
+            for ( int node = 0; node < kMaxNodes; node++ ) {
+                const std::string path = str::stream() << "/sys/devices/system/node/node"
+                                                       << node << "/cpulist";
+                std::ifstream f( path.c_str() );
+                if ( !f.is_open() )
+                    break;
+
+                std::string line;
+                std::getline( f, line );
+
+                std::vector<int> cpus;
+                if ( !NumaPlacement::parseCpuList( line, &cpus ) ) {
+                    warning() << "can't parse " << path << ": '" << line << "'";
+                    out->clear();
+                    return;
+                }
+                out->push_back( cpus );
+            }
+        }
+#endif
+
+    } // namespace
+
+    bool NumaPlacement::parseCpuList( const std::string& list, std::vector<int>* cpus ) {
+        cpus->clear();
+
+        std::string rest = list;
+        while ( !rest.empty() && isspace( rest[rest.size() - 1] ) )
+            rest.erase( rest.size() - 1 );
+
+        while ( !rest.empty() ) {
+            const std::string::size_type comma = rest.find( ',' );
+            const std::string range = rest.substr( 0, comma );
+            rest = ( comma == std::string::npos ) ? std::string() : rest.substr( comma + 1 );
+
+            const std::string::size_type dash = range.find( '-' );
+            int first;
+            int last;
+            if ( !parseNumberFromString( range.substr( 0, dash ), &first ).isOK() )
+                return false;
+            if ( dash == std::string::npos )
+                last = first;
+            else if ( !parseNumberFromString( range.substr( dash + 1 ), &last ).isOK() )
+                return false;
+
+            if ( first < 0 || last < first )
+                return false;
+            for ( int cpu = first; cpu <= last; cpu++ )
+                cpus->push_back( cpu );
+        }
+        return true;
+    }
+
+#ifdef __linux__
+
+    bool NumaPlacement::enable() {
+        invariant( !numaEnabled );
+
+        std::vector< std::vector<int> > topology;
+        readTopology( &topology );
+        if ( topology.size() < 2 ) {
+            log() << "NUMA placement requested, but this machine has "
+                  << topology.size() << " NUMA node(s); ignoring";
+            return false;
+        }
+
+        std::vector<int> allNodes;
+        for ( size_t i = 0; i < topology.size(); i++ )
+            allNodes.push_back( i );
+
+        if ( !setMemoryPolicy( kMpolInterleave, allNodes ) )
+            return false;
+
+        nodeCpus.swap( topology );
+        numaEnabled = true;
+        log() << "NUMA placement enabled over " << nodeCpus.size() << " nodes";
+        return true;
+    }
+
+    void NumaPlacement::bindCurrentThread( int node ) {
+        if ( !numaEnabled )
+            return;
+
+        node %= nodeCpus.size();
+
+        cpu_set_t cpus;
+        CPU_ZERO( &cpus );
+        for ( size_t i = 0; i < nodeCpus[node].size(); i++ ) {
+            if ( nodeCpus[node][i] < CPU_SETSIZE )
+                CPU_SET( nodeCpus[node][i], &cpus );
+        }
+
+        const int ret = pthread_setaffinity_np( pthread_self(), sizeof(cpus), &cpus );
+        if ( ret != 0 ) {
+            LOG(1) << "can't bind thread to NUMA node " << node << ": "
+                   << errnoWithDescription( ret );
+            return;
+        }
+
+        setMemoryPolicy( kMpolPreferred, std::vector<int>( 1, node ) );
+        threadNode.set( node );
+    }
+
+#else
+
+    bool NumaPlacement::enable() {
+        log() << "NUMA placement is only supported on linux; ignoring";
+        return false;
+    }
+
+    void NumaPlacement::bindCurrentThread( int node ) {
+    }
+
+#endif  // __linux__
+
+    bool NumaPlacement::isEnabled() {
+        return numaEnabled;
+    }
+
+    int NumaPlacement::numNodes() {
+        return numaEnabled ? nodeCpus.size() : 1;
+    }
+
+    int NumaPlacement::nextNode() {
+        return nextNodeCounter.fetchAndAdd( 1 ) % numNodes();
+    }
+
+    int NumaPlacement::currentNode() {
+        return threadNode.get();
+    }
+
+} // namespace mongo
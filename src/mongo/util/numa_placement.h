@@ -0,0 +1,81 @@
+// numa_placement.h
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace mongo {
+
+    /**
+     * Optional placement of threads and memory on NUMA nodes, as an alternative to running the
+     * whole server under "numactl --interleave=all".
+     *
+     * When enabled, memory shared by the whole process (the storage engine's cache, mapped
+     * files, etc) is interleaved across nodes, while the network, worker and thread pool threads
+     * are each bound to a node, round robin, and prefer that node's memory for their own
+     * allocations.  Per-thread caches (e.g. MessageBufferPool) use currentNumaNode() to avoid
+     * holding on to memory from other nodes.
+     *
+     * Only supported on linux; elsewhere, and on single node machines, enabling it does
+     * nothing.
+     */
+    class NumaPlacement {
+    public:
+        /**
+         * Discovers the node topology and sets the interleaved memory policy for the calling
+         * thread, which is inherited by the threads it goes on to create.  Must be called
+         * early in startup, before the process' shared caches are allocated.
+         *
+         * @return false if the machine has fewer than two nodes, or the policy couldn't be set.
+         */
+        static bool enable();
+
+        static bool isEnabled();
+
+        static int numNodes();
+
+        /** @return the node to bind the next thread to, round robin over all nodes. */
+        static int nextNode();
+
+        /**
+         * Binds the calling thread to the CPUs of 'node' and makes it prefer that node's memory.
+         * Does nothing unless placement is enabled.
+         */
+        static void bindCurrentThread( int node );
+
+        /** @return the node the calling thread is bound to, or -1 if it isn't bound. */
+        static int currentNode();
+
+        /** Parses a sysfs CPU list such as "0-3,8-11" into CPU numbers. Exposed for testing. */
+        static bool parseCpuList( const std::string& list, std::vector<int>* cpus );
+    };
+
+} // namespace mongo
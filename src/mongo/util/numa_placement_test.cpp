@@ -0,0 +1,76 @@
+// numa_placement_test.cpp
+
+/*    Copyright 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/numa_placement.h"
+
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+    using namespace mongo;
+
+    std::vector<int> parse( const std::string& list ) {
+        std::vector<int> cpus;
+        ASSERT_TRUE( NumaPlacement::parseCpuList( list, &cpus ) );
+        return cpus;
+    }
+
+    TEST(NumaPlacement, ParseCpuList) {
+        std::vector<int> cpus = parse( "0-3,8,10-11\n" );
+        ASSERT_EQUALS( 7U, cpus.size() );
+        ASSERT_EQUALS( 0, cpus[0] );
+        ASSERT_EQUALS( 3, cpus[3] );
+        ASSERT_EQUALS( 8, cpus[4] );
+        ASSERT_EQUALS( 11, cpus[6] );
+
+        ASSERT_EQUALS( 1U, parse( "5" ).size() );
+        ASSERT_TRUE( parse( "" ).empty() );
+    }
+
+    TEST(NumaPlacement, ParseCpuListRejectsGarbage) {
+        std::vector<int> cpus;
+        ASSERT_FALSE( NumaPlacement::parseCpuList( "0-", &cpus ) );
+        ASSERT_FALSE( NumaPlacement::parseCpuList( "3-1", &cpus ) );
+        ASSERT_FALSE( NumaPlacement::parseCpuList( "a,b", &cpus ) );
+        ASSERT_FALSE( NumaPlacement::parseCpuList( "1,,2", &cpus ) );
+    }
+
+    TEST(NumaPlacement, DisabledPlacementDoesNothing) {
+        ASSERT_FALSE( NumaPlacement::isEnabled() );
+        ASSERT_EQUALS( 1, NumaPlacement::numNodes() );
+        ASSERT_EQUALS( 0, NumaPlacement::nextNode() );
+        ASSERT_EQUALS( 0, NumaPlacement::nextNode() );
+
+        NumaPlacement::bindCurrentThread( 0 );
+        ASSERT_EQUALS( -1, NumaPlacement::currentNode() );
+    }
+
+} // namespace
@@ -40,7 +40,10 @@
 #include "processinfo.h"
 #include "boost/filesystem.hpp"
 #include <mongo/util/file.h>
+#include <fstream>
+#include <sstream>
 #include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
 
 using namespace std;
 
@@ -374,6 +377,54 @@ namespace mongo {
             return 0;
         }
 
+        /**
+        * Append the memory totals and allocation counters of each NUMA node, from
+        * /sys/devices/system/node/node<N>/{meminfo,numastat}
+        */
+        static void appendNumaNodeStats( BSONArrayBuilder& nodes ) {
+            for ( int node = 0; ; node++ ) {
+                const string dir = str::stream() << "/sys/devices/system/node/node" << node;
+
+                ifstream meminfo( ( dir + "/meminfo" ).c_str() );
+                if ( !meminfo.is_open() )
+                    break;
+
+                BSONObjBuilder b( nodes.subobjStart() );
+                b.append( "node", node );
+
+                // e.g. "Node 0 MemTotal:       16333380 kB"
+                string line;
+                while ( getline( meminfo, line ) ) {
+                    istringstream fields( line );
+                    string nodeWord, nodeNum, name;
+                    long long kb;
+                    if ( !( fields >> nodeWord >> nodeNum >> name >> kb ) )
+                        continue;
+
+                    if ( name == "MemTotal:" )
+                        b.append( "memTotalBytes", kb * 1024 );
+                    else if ( name == "MemFree:" )
+                        b.append( "memFreeBytes", kb * 1024 );
+                    else if ( name == "FilePages:" )
+                        b.append( "filePagesBytes", kb * 1024 );
+                    else if ( name == "AnonPages:" )
+                        b.append( "anonPagesBytes", kb * 1024 );
+                }
+
+                // e.g. "numa_hit 123456"
+                ifstream numastat( ( dir + "/numastat" ).c_str() );
+                while ( getline( numastat, line ) ) {
+                    istringstream fields( line );
+                    string name;
+                    long long count;
+                    if ( fields >> name >> count )
+                        b.append( name, count );
+                }
+
+                b.done();
+            }
+        }
+
     };
 
 
@@ -405,6 +456,13 @@ namespace mongo {
 
         LinuxProc p(_pid);
         info.appendNumber("page_faults", static_cast<long long>(p._maj_flt) );
+
+        boost::system::error_code ec;
+        if ( boost::filesystem::exists( "/sys/devices/system/node/node1", ec ) ) {
+            BSONArrayBuilder nodes( info.subarrayStart( "numa" ) );
+            LinuxSysHelper::appendNumaNodeStats( nodes );
+            nodes.done();
+        }
     }
 
     /**